@@ -4,9 +4,13 @@
 // open source releases of s2.
 
 %{
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
 #include <memory>
 #include <sstream>
 #include <string>
+#include <vector>
 
 #include "s2/s2boolean_operation.h"
 #include "s2/s2buffer_operation.h"
@@ -14,6 +18,8 @@
 #include "s2/s2builder_layer.h"
 #include "s2/s2builderutil_s2polygon_layer.h"
 #include "s2/s2cell_id.h"
+#include "s2/s2closest_edge_query.h"
+#include "s2/s2contains_point_query.h"
 #include "s2/s2region.h"
 #include "s2/s2cap.h"
 #include "s2/s2edge_crossings.h"
@@ -216,6 +222,353 @@ std::vector<S2Polyline *> *out(std::vector<S2Polyline *> temp) {
   }
 %}
 
+// Bulk conversion functions.  These operate on objects that support the
+// Python buffer protocol (e.g. NumPy arrays or array.array), so that large
+// arrays can be processed without creating a Python object per element.
+// Results are written to a caller-allocated output buffer, which must have
+// the same number of elements as the input.  The GIL is released while the
+// elements are processed.  For example:
+//
+//   lats = numpy.array([...], dtype=numpy.float64)
+//   lngs = numpy.array([...], dtype=numpy.float64)
+//   ids = numpy.empty(len(lats), dtype=numpy.uint64)
+//   s2.LatLngDegreesToS2CellIds(lats, lngs, ids)
+%{
+namespace {
+
+// Owns a C-contiguous buffer exported by a Python object.
+class PyBufferView {
+ public:
+  PyBufferView() = default;
+  ~PyBufferView() {
+    if (view_.obj != nullptr) PyBuffer_Release(&view_);
+  }
+  PyBufferView(const PyBufferView&) = delete;
+  PyBufferView& operator=(const PyBufferView&) = delete;
+
+  // Acquires the buffer of "obj", whose elements must have type T.  If
+  // "writable" is true the buffer must also be writable.  Sets a Python
+  // exception and returns false on failure.
+  template <class T>
+  bool Init(PyObject* obj, const char* name, bool writable);
+
+  template <class T>
+  T* data() const { return static_cast<T*>(view_.buf); }
+
+  size_t size() const { return view_.len / view_.itemsize; }
+
+ private:
+  Py_buffer view_ = {};
+};
+
+// Returns the struct module type codes that are accepted for T.
+template <class T> const char* BufferTypeCodes();
+template <> const char* BufferTypeCodes<double>() { return "d"; }
+template <> const char* BufferTypeCodes<int32_t>() { return "il"; }
+template <> const char* BufferTypeCodes<uint64_t>() { return "LQ"; }
+template <> const char* BufferTypeCodes<bool>() { return "?"; }
+
+template <class T>
+bool PyBufferView::Init(PyObject* obj, const char* name, bool writable) {
+  int flags = PyBUF_C_CONTIGUOUS | PyBUF_FORMAT;
+  if (writable) flags |= PyBUF_WRITABLE;
+  if (PyObject_GetBuffer(obj, &view_, flags) != 0) return false;
+
+  // Accept native byte order, and explicit byte orders that match it.
+  const char* format = view_.format;
+  if (*format == '@' || *format == '=' ||
+      *format == (PY_LITTLE_ENDIAN ? '<' : '>')) {
+    ++format;
+  }
+  if (view_.itemsize != sizeof(T) || format[0] == '\0' || format[1] != '\0' ||
+      std::strchr(BufferTypeCodes<T>(), format[0]) == nullptr) {
+    PyErr_Format(PyExc_TypeError, "%s has unsupported element type '%s'",
+                 name, view_.format);
+    return false;
+  }
+  return true;
+}
+
+// Sets a Python exception and returns false unless "actual" == "expected".
+bool CheckBufferSize(const char* name, size_t actual, size_t expected) {
+  if (actual == expected) return true;
+  PyErr_Format(PyExc_ValueError, "%s has %zu elements, expected %zu", name,
+               actual, expected);
+  return false;
+}
+
+// Sets a Python exception and returns false if cell_ids[i] is invalid for
+// some i.  The GIL is released while the ids are checked.
+bool CheckS2CellIds(const uint64_t* cell_ids, size_t n) {
+  size_t i = 0;
+  Py_BEGIN_ALLOW_THREADS
+  while (i < n && S2CellId(cell_ids[i]).is_valid()) ++i;
+  Py_END_ALLOW_THREADS
+  if (i == n) return true;
+  PyErr_Format(PyExc_ValueError, "Invalid S2CellId %llu at index %zu",
+               static_cast<unsigned long long>(cell_ids[i]), i);
+  return false;
+}
+
+}  // namespace
+%}
+
+%inline %{
+  // Sets cell_ids[i] to the leaf S2CellId containing the point at latitude
+  // lat_degrees[i] and longitude lng_degrees[i].  The inputs are float64
+  // arrays and the output is a uint64 array.
+  static PyObject *LatLngDegreesToS2CellIds(PyObject *lat_degrees,
+                                            PyObject *lng_degrees,
+                                            PyObject *cell_ids) {
+    PyBufferView lat, lng, out;
+    if (!lat.Init<double>(lat_degrees, "lat_degrees", false) ||
+        !lng.Init<double>(lng_degrees, "lng_degrees", false) ||
+        !out.Init<uint64_t>(cell_ids, "cell_ids", true) ||
+        !CheckBufferSize("lng_degrees", lng.size(), lat.size()) ||
+        !CheckBufferSize("cell_ids", out.size(), lat.size())) {
+      return nullptr;
+    }
+    Py_BEGIN_ALLOW_THREADS
+    for (size_t i = 0; i < lat.size(); ++i) {
+      out.data<uint64_t>()[i] =
+          S2CellId(S2LatLng::FromDegrees(lat.data<double>()[i],
+                                         lng.data<double>()[i]))
+              .id();
+    }
+    Py_END_ALLOW_THREADS
+    Py_RETURN_NONE;
+  }
+
+  // Sets points[i] to the unit-length S2Point at latitude lat_degrees[i] and
+  // longitude lng_degrees[i].  The inputs are float64 arrays and the output
+  // is a float64 array of shape (n, 3).
+  static PyObject *LatLngDegreesToS2Points(PyObject *lat_degrees,
+                                           PyObject *lng_degrees,
+                                           PyObject *points) {
+    PyBufferView lat, lng, out;
+    if (!lat.Init<double>(lat_degrees, "lat_degrees", false) ||
+        !lng.Init<double>(lng_degrees, "lng_degrees", false) ||
+        !out.Init<double>(points, "points", true) ||
+        !CheckBufferSize("lng_degrees", lng.size(), lat.size()) ||
+        !CheckBufferSize("points", out.size(), 3 * lat.size())) {
+      return nullptr;
+    }
+    Py_BEGIN_ALLOW_THREADS
+    for (size_t i = 0; i < lat.size(); ++i) {
+      S2Point p = S2LatLng::FromDegrees(lat.data<double>()[i],
+                                        lng.data<double>()[i]).ToPoint();
+      std::copy(p.Data(), p.Data() + 3, out.data<double>() + 3 * i);
+    }
+    Py_END_ALLOW_THREADS
+    Py_RETURN_NONE;
+  }
+
+  // Returns a list containing the token of each S2CellId in the given uint64
+  // array.
+  static PyObject *S2CellIdsToTokens(PyObject *cell_ids) {
+    PyBufferView ids;
+    if (!ids.Init<uint64_t>(cell_ids, "cell_ids", false)) return nullptr;
+    std::vector<std::string> tokens(ids.size());
+    Py_BEGIN_ALLOW_THREADS
+    for (size_t i = 0; i < ids.size(); ++i) {
+      tokens[i] = S2CellId(ids.data<uint64_t>()[i]).ToToken();
+    }
+    Py_END_ALLOW_THREADS
+    PyObject *result = PyList_New(tokens.size());
+    if (result == nullptr) return nullptr;
+    for (size_t i = 0; i < tokens.size(); ++i) {
+      PyObject *token =
+          PyUnicode_FromStringAndSize(tokens[i].data(), tokens[i].size());
+      if (token == nullptr) {
+        Py_DECREF(result);
+        return nullptr;
+      }
+      PyList_SET_ITEM(result, i, token);
+    }
+    return result;
+  }
+
+  // Sets levels[i] to the level of cell_ids[i].  The input is a uint64 array
+  // of valid S2CellIds and the output is an int32 array.
+  static PyObject *S2CellIdsLevel(PyObject *cell_ids, PyObject *levels) {
+    PyBufferView ids, out;
+    if (!ids.Init<uint64_t>(cell_ids, "cell_ids", false) ||
+        !out.Init<int32_t>(levels, "levels", true) ||
+        !CheckBufferSize("levels", out.size(), ids.size()) ||
+        !CheckS2CellIds(ids.data<uint64_t>(), ids.size())) {
+      return nullptr;
+    }
+    Py_BEGIN_ALLOW_THREADS
+    for (size_t i = 0; i < ids.size(); ++i) {
+      out.data<int32_t>()[i] = S2CellId(ids.data<uint64_t>()[i]).level();
+    }
+    Py_END_ALLOW_THREADS
+    Py_RETURN_NONE;
+  }
+
+  // Sets parents[i] to the ancestor of cell_ids[i] at the given level.  The
+  // input is a uint64 array of valid S2CellIds whose levels are all at least
+  // "level", and the output is a uint64 array (which may be the input).
+  static PyObject *S2CellIdsParent(PyObject *cell_ids, int level,
+                                   PyObject *parents) {
+    PyBufferView ids, out;
+    if (!ids.Init<uint64_t>(cell_ids, "cell_ids", false) ||
+        !out.Init<uint64_t>(parents, "parents", true) ||
+        !CheckBufferSize("parents", out.size(), ids.size()) ||
+        !CheckS2CellIds(ids.data<uint64_t>(), ids.size())) {
+      return nullptr;
+    }
+    if (level < 0 || level > S2CellId::kMaxLevel) {
+      PyErr_Format(PyExc_ValueError, "Invalid level %d", level);
+      return nullptr;
+    }
+    // Check the levels before modifying "parents", since it may be the same
+    // buffer as "cell_ids".
+    size_t num_valid = 0;
+    Py_BEGIN_ALLOW_THREADS
+    while (num_valid < ids.size() &&
+           S2CellId(ids.data<uint64_t>()[num_valid]).level() >= level) {
+      ++num_valid;
+    }
+    Py_END_ALLOW_THREADS
+    if (num_valid < ids.size()) {
+      PyErr_Format(PyExc_ValueError,
+                   "S2CellId at index %zu has level less than %d", num_valid,
+                   level);
+      return nullptr;
+    }
+    Py_BEGIN_ALLOW_THREADS
+    for (size_t i = 0; i < ids.size(); ++i) {
+      out.data<uint64_t>()[i] =
+          S2CellId(ids.data<uint64_t>()[i]).parent(level).id();
+    }
+    Py_END_ALLOW_THREADS
+    Py_RETURN_NONE;
+  }
+
+  // Sets contains[i] to polygon.Contains(points[i]).  The input is a float64
+  // array of shape (n, 3) containing unit-length points, and the output is
+  // a bool array.
+  static PyObject *S2PolygonContainsPoints(const S2Polygon& polygon,
+                                           PyObject *points,
+                                           PyObject *contains) {
+    PyBufferView in, out;
+    if (!in.Init<double>(points, "points", false) ||
+        !out.Init<bool>(contains, "contains", true) ||
+        !CheckBufferSize("points", in.size(), 3 * out.size())) {
+      return nullptr;
+    }
+    Py_BEGIN_ALLOW_THREADS
+    for (size_t i = 0; i < out.size(); ++i) {
+      const double* p = in.data<double>() + 3 * i;
+      out.data<bool>()[i] = polygon.Contains(S2Point(p[0], p[1], p[2]));
+    }
+    Py_END_ALLOW_THREADS
+    Py_RETURN_NONE;
+  }
+%}
+
+%inline %{
+  // Sets contains[i] to true if any shape in "index" contains points[i],
+  // using the semi-open boundary model (see S2ContainsPointQuery).  The
+  // input is a float64 array of shape (n, 3) containing unit-length points,
+  // and the output is a bool array.
+  static PyObject *S2ShapeIndexContainsPoints(const S2ShapeIndex& index,
+                                              PyObject *points,
+                                              PyObject *contains) {
+    PyBufferView in, out;
+    if (!in.Init<double>(points, "points", false) ||
+        !out.Init<bool>(contains, "contains", true) ||
+        !CheckBufferSize("points", in.size(), 3 * out.size())) {
+      return nullptr;
+    }
+    Py_BEGIN_ALLOW_THREADS
+    auto query = MakeS2ContainsPointQuery(&index);
+    for (size_t i = 0; i < out.size(); ++i) {
+      const double* p = in.data<double>() + 3 * i;
+      out.data<bool>()[i] = query.Contains(S2Point(p[0], p[1], p[2]));
+    }
+    Py_END_ALLOW_THREADS
+    Py_RETURN_NONE;
+  }
+
+  // Sets distances[i] to the distance in radians from points[i] to the
+  // closest edge of any shape in "index" (or zero if a polygon contains it),
+  // as computed by S2ClosestEdgeQuery.  The distance is infinity if the index
+  // is empty.  The input is a float64 array of shape (n, 3) containing
+  // unit-length points, and the output is a float64 array.
+  static PyObject *S2ShapeIndexGetDistances(const S2ShapeIndex& index,
+                                            PyObject *points,
+                                            PyObject *distances) {
+    PyBufferView in, out;
+    if (!in.Init<double>(points, "points", false) ||
+        !out.Init<double>(distances, "distances", true) ||
+        !CheckBufferSize("points", in.size(), 3 * out.size())) {
+      return nullptr;
+    }
+    Py_BEGIN_ALLOW_THREADS
+    S2ClosestEdgeQuery query(&index);
+    for (size_t i = 0; i < out.size(); ++i) {
+      const double* p = in.data<double>() + 3 * i;
+      S2ClosestEdgeQuery::PointTarget target(S2Point(p[0], p[1], p[2]));
+      out.data<double>()[i] = query.GetDistance(&target).ToAngle().radians();
+    }
+    Py_END_ALLOW_THREADS
+    Py_RETURN_NONE;
+  }
+
+  // Sets within[i] to true if the distance from points[i] to "index" (as
+  // defined above) is less than "limit".  This is much faster than computing
+  // the distances.  The input is a float64 array of shape (n, 3) containing
+  // unit-length points, and the output is a bool array.
+  static PyObject *S2ShapeIndexIsDistanceLess(const S2ShapeIndex& index,
+                                              PyObject *points,
+                                              S1Angle limit,
+                                              PyObject *within) {
+    PyBufferView in, out;
+    if (!in.Init<double>(points, "points", false) ||
+        !out.Init<bool>(within, "within", true) ||
+        !CheckBufferSize("points", in.size(), 3 * out.size())) {
+      return nullptr;
+    }
+    Py_BEGIN_ALLOW_THREADS
+    S2ClosestEdgeQuery query(&index);
+    const S1ChordAngle chord_limit(limit);
+    for (size_t i = 0; i < out.size(); ++i) {
+      const double* p = in.data<double>() + 3 * i;
+      S2ClosestEdgeQuery::PointTarget target(S2Point(p[0], p[1], p[2]));
+      out.data<bool>()[i] = query.IsDistanceLess(&target, chord_limit);
+    }
+    Py_END_ALLOW_THREADS
+    Py_RETURN_NONE;
+  }
+%}
+
+// Releases the GIL while the given C++ function or method runs, so that
+// other Python threads can run at the same time.  This must only be used for
+// calls that do not access Python objects.  As in C++, objects that are
+// modified by such a call must not be used concurrently by other threads.
+%define RELEASE_GIL(function)
+%exception function {
+  Py_BEGIN_ALLOW_THREADS
+  $action
+  Py_END_ALLOW_THREADS
+}
+%enddef
+
+RELEASE_GIL(MutableS2ShapeIndex::ForceBuild)
+RELEASE_GIL(S2BooleanOperation::Build)
+RELEASE_GIL(S2BufferOperation::Build)
+RELEASE_GIL(S2Builder::Build)
+RELEASE_GIL(S2Polygon::InitNested)
+RELEASE_GIL(S2Polygon::InitToIntersection)
+RELEASE_GIL(S2Polygon::InitToUnion)
+RELEASE_GIL(S2Polygon::IntersectWithPolyline)
+RELEASE_GIL(S2RegionCoverer::GetCovering)
+RELEASE_GIL(S2RegionCoverer::GetInteriorCovering)
+RELEASE_GIL(S2RegionTermIndexer::GetIndexTerms)
+RELEASE_GIL(S2RegionTermIndexer::GetQueryTerms)
+
 // We provide our own definition of S2Point, because the real one is too
 // difficult to wrap correctly.
 class S2Point {
@@ -515,6 +868,7 @@ public:
 %unignore MutableS2ShapeIndex;
 %unignore MutableS2ShapeIndex::~MutableS2ShapeIndex;
 %unignore MutableS2ShapeIndex::Add(S2Shape*);
+%unignore MutableS2ShapeIndex::ForceBuild;
 %unignore R1Interval;
 %ignore R1Interval::operator[];
 %unignore R1Interval::GetLength;
@@ -835,6 +1189,7 @@ public:
 %ignore S2Polygon::Init(std::unique_ptr<S2Loop>);
 %unignore S2Polygon::InitNested;
 %ignore S2Polygon::InitNested(std::vector<std::unique_ptr<S2Loop>>);
+%unignore S2Polygon::InitToIntersection;
 %unignore S2Polygon::InitToUnion;
 %unignore S2Polygon::Intersects;
 %unignore S2Polygon::IsValid;
@@ -14,6 +14,8 @@
 # limitations under the License.
 #
 
+import array
+import threading
 import unittest
 from collections import defaultdict
 
@@ -63,6 +65,59 @@ class PyWrapS2TestCase(unittest.TestCase):
     self.assertEqual(cell.ToToken(), "X")
     self.assertEqual(cell.id(), 0)
 
+  def testLatLngDegreesToS2CellIds(self):
+    lats = array.array("d", [51.5001525, -33.8688197])
+    lngs = array.array("d", [-0.1262355, 151.2092955])
+    ids = array.array("Q", [0, 0])
+    s2.LatLngDegreesToS2CellIds(lats, lngs, ids)
+    for i in range(len(lats)):
+      cell = s2.S2CellId(s2.S2LatLng.FromDegrees(lats[i], lngs[i]))
+      self.assertEqual(cell.id(), ids[i])
+    self.assertEqual([s2.S2CellId(x).ToToken() for x in ids],
+                     s2.S2CellIdsToTokens(ids))
+
+  def testLatLngDegreesToS2Points(self):
+    points = array.array("d", [0.0] * 6)
+    s2.LatLngDegreesToS2Points(array.array("d", [0.0, 90.0]),
+                               array.array("d", [0.0, 0.0]), points)
+    self.assertAlmostEqual(1.0, points[0])
+    self.assertAlmostEqual(1.0, points[5])
+
+  def testS2CellIdsLevelAndParent(self):
+    ids = array.array("Q", [0x487604c489f841c3, 0x4870000000000000])
+    levels = array.array("i", [0, 0])
+    s2.S2CellIdsLevel(ids, levels)
+    self.assertEqual([30, 4], list(levels))
+    parents = array.array("Q", [0, 0])
+    s2.S2CellIdsParent(ids, 3, parents)
+    self.assertEqual(["487", "487"], s2.S2CellIdsToTokens(parents))
+    # The output may be the same array as the input.
+    s2.S2CellIdsParent(ids, 4, ids)
+    self.assertEqual(["487", "487"], s2.S2CellIdsToTokens(ids))
+
+  def testS2CellIdsBulkErrors(self):
+    with self.assertRaises(ValueError):
+      s2.S2CellIdsLevel(array.array("Q", [0]), array.array("i", [0]))
+    with self.assertRaises(ValueError):
+      s2.S2CellIdsParent(array.array("Q", [0x4870000000000000]), 5,
+                         array.array("Q", [0]))
+    with self.assertRaises(ValueError):
+      s2.S2CellIdsLevel(array.array("Q", [0x4870000000000000]),
+                        array.array("i", [0, 0]))
+    with self.assertRaises(TypeError):
+      s2.S2CellIdsLevel(array.array("Q", [0x4870000000000000]),
+                        array.array("d", [0]))
+
+  def testS2PolygonContainsPoints(self):
+    polygon = s2.S2Polygon(s2.S2Cell(s2.S2CellId.FromToken("487")))
+    lats = array.array("d", [51.5001525, -33.8688197])
+    lngs = array.array("d", [-0.1262355, 151.2092955])
+    points = array.array("d", [0.0] * 6)
+    s2.LatLngDegreesToS2Points(lats, lngs, points)
+    contains = memoryview(bytearray(2)).cast("?")
+    s2.S2PolygonContainsPoints(polygon, points, contains)
+    self.assertEqual([True, False], contains.tolist())
+
   def testS2CellIdGetEdgeNeighborsIsWrappedCorrectly(self):
     cell = s2.S2CellId(0x466d319000000000)
     expected_neighbors = [s2.S2CellId(0x466d31b000000000),
@@ -1037,6 +1092,66 @@ class S2PolygonTestCase(unittest.TestCase):
     loop = polygon3.loop(1)
     self.assertEqual(4, loop.num_vertices())
 
+  def testInitToIntersection(self):
+    cell = s2.S2Cell(s2.S2CellId(s2.S2LatLng.FromDegrees(3.0, 4.0)).parent(8))
+    polygon1 = s2.S2Polygon(cell)
+    polygon2 = s2.S2Polygon(s2.S2Cell(cell.id().child(0)))
+
+    polygon3 = s2.S2Polygon()
+    polygon3.InitToIntersection(polygon1, polygon2)
+    self.assertTrue(polygon2.BoundaryNear(polygon3))
+
+  def testInitToUnionInParallel(self):
+    # The GIL is released during InitToUnion, so this exercises concurrent
+    # calls with shared inputs.
+    cells = [s2.S2Cell(s2.S2CellId(s2.S2LatLng.FromDegrees(3.0 * i, 4.0))
+                       .parent(8)) for i in range(8)]
+    polygons = [s2.S2Polygon(cell) for cell in cells]
+    results = [s2.S2Polygon() for _ in range(len(polygons) - 1)]
+    threads = [
+        threading.Thread(target=results[i].InitToUnion,
+                         args=(polygons[i], polygons[i + 1]))
+        for i in range(len(results))
+    ]
+    for thread in threads:
+      thread.start()
+    for thread in threads:
+      thread.join()
+    for result in results:
+      self.assertEqual(2, result.num_loops())
+
+class S2ShapeIndexBulkQueryTest(unittest.TestCase):
+  def setUp(self):
+    self.index = s2.MutableS2ShapeIndex()
+    cell = s2.S2Cell(s2.S2CellId.FromToken("487"))
+    self.index.Add(s2.S2Polygon(cell))
+    self.index.ForceBuild()
+    lats = array.array("d", [51.5001525, -33.8688197])
+    lngs = array.array("d", [-0.1262355, 151.2092955])
+    self.points = array.array("d", [0.0] * 6)
+    s2.LatLngDegreesToS2Points(lats, lngs, self.points)
+
+  def testContainsPoints(self):
+    contains = memoryview(bytearray(2)).cast("?")
+    s2.S2ShapeIndexContainsPoints(self.index, self.points, contains)
+    self.assertEqual([True, False], contains.tolist())
+
+  def testGetDistances(self):
+    distances = array.array("d", [-1.0, -1.0])
+    s2.S2ShapeIndexGetDistances(self.index, self.points, distances)
+    self.assertEqual(0.0, distances[0])
+    self.assertGreater(distances[1], 1.0)
+
+    within = memoryview(bytearray(2)).cast("?")
+    s2.S2ShapeIndexIsDistanceLess(self.index, self.points,
+                                  s2.S1Angle.Radians(distances[1] + 0.01),
+                                  within)
+    self.assertEqual([True, True], within.tolist())
+    s2.S2ShapeIndexIsDistanceLess(self.index, self.points,
+                                  s2.S1Angle.Radians(distances[1] - 0.01),
+                                  within)
+    self.assertEqual([True, False], within.tolist())
+
 class S2ChordAngleTest(unittest.TestCase):
   def testBasic(self):
     ca = s2.S1ChordAngle(s2.S1Angle.Degrees(100))
@@ -0,0 +1,101 @@
+// Copyright 2024 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "s2/chunked_decoder.h"
+
+#include <cstddef>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "absl/functional/function_ref.h"
+#include "absl/log/absl_check.h"
+#include "absl/strings/cord.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+#include "s2/util/coding/coder.h"
+
+using absl::string_view;
+using std::vector;
+
+namespace s2coding {
+
+ChunkedDecoder::ChunkedDecoder(absl::Span<const string_view> chunks)
+    : chunks_(chunks.begin(), chunks.end()),
+      storage_(std::make_shared<Storage>()) {}
+
+ChunkedDecoder::ChunkedDecoder(const absl::Cord& cord)
+    : storage_(std::make_shared<Storage>()) {
+  for (string_view chunk : cord.Chunks()) chunks_.push_back(chunk);
+}
+
+size_t ChunkedDecoder::avail() const {
+  if (chunk_ == chunks_.size()) return 0;
+  size_t avail = chunks_[chunk_].size() - offset_;
+  for (size_t i = chunk_ + 1; i < chunks_.size(); ++i) {
+    avail += chunks_[i].size();
+  }
+  return avail;
+}
+
+void ChunkedDecoder::set_chunk_owner(std::shared_ptr<const void> chunk_owner) {
+  storage_->chunk_owner = std::move(chunk_owner);
+}
+
+void ChunkedDecoder::Advance(size_t n) {
+  while (chunk_ < chunks_.size() && offset_ + n >= chunks_[chunk_].size()) {
+    n -= chunks_[chunk_].size() - offset_;
+    ++chunk_;
+    offset_ = 0;
+  }
+  ABSL_DCHECK(n == 0 || chunk_ < chunks_.size());
+  offset_ += n;
+}
+
+bool ChunkedDecoder::Decode(absl::FunctionRef<bool(Decoder*)> init) {
+  Advance(0);  // Skip any empty chunks.
+  if (chunk_ == chunks_.size()) {
+    Decoder decoder(nullptr, 0);
+    return init(&decoder);
+  }
+  // First try decoding the object directly from the current chunk.
+  string_view rest = chunks_[chunk_].substr(offset_);
+  {
+    Decoder decoder(rest.data(), rest.size());
+    if (init(&decoder)) {
+      Advance(decoder.pos());
+      return true;
+    }
+  }
+  // The object straddles a chunk boundary (or is invalid).  Append the
+  // following chunks one at a time until the object can be decoded.
+  vector<char> buffer(rest.begin(), rest.end());
+  for (size_t i = chunk_ + 1; i < chunks_.size(); ++i) {
+    if (chunks_[i].empty()) continue;
+    buffer.insert(buffer.end(), chunks_[i].begin(), chunks_[i].end());
+    Decoder decoder(buffer.data(), buffer.size());
+    if (init(&decoder)) {
+      bytes_copied_ += buffer.size();
+      Advance(decoder.pos());
+      // Moving a vector does not move its elements, so the pointers that
+      // "init" saved remain valid.
+      storage_->buffers.push_back(std::move(buffer));
+      return true;
+    }
+  }
+  return false;
+}
+
+}  // namespace s2coding
@@ -0,0 +1,130 @@
+// Copyright 2024 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef S2_CHUNKED_DECODER_H_
+#define S2_CHUNKED_DECODER_H_
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+#include "absl/functional/function_ref.h"
+#include "absl/strings/cord.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+#include "s2/util/coding/coder.h"
+
+namespace s2coding {
+
+// ChunkedDecoder decodes a sequence of encoded objects (such as an encoded
+// shape vector followed by an EncodedS2ShapeIndex) from data that is split
+// into non-contiguous chunks, e.g. an absl::Cord received over RPC.
+//
+// The encoded types (EncodedS2ShapeIndex, EncodedS2PointVector,
+// EncodedStringVector, etc) keep pointers into the data they were decoded
+// from, so each object needs its encoding to be contiguous.  ChunkedDecoder
+// passes each object a Decoder that points directly into the current chunk,
+// and only when the object turns out to straddle a chunk boundary does it
+// copy that object's bytes into a contiguous buffer.  This avoids flattening
+// the entire input, which would double the peak memory usage.  Example:
+//
+//   absl::Cord encoded = ...;  // Output of CompactEncodeTaggedShapes()
+//                              // followed by EncodedS2ShapeIndex::Encode().
+//   s2coding::ChunkedDecoder decoder(encoded);
+//   std::optional<s2shapeutil::TaggedShapeFactory> factory;
+//   EncodedS2ShapeIndex index;
+//   if (!decoder.Decode([&](Decoder* d) {
+//         S2Error error;
+//         factory.emplace(s2shapeutil::LazyDecodeShapeFactory(
+//             d, decoder.data_owner(), error));
+//         return error.ok();
+//       }) ||
+//       !decoder.Decode([&](Decoder* d) {
+//         return index.Init(d, *factory, decoder.data_owner());
+//       })) {
+//     ...
+//   }
+//
+// The chunks must remain alive and unchanged while the decoded objects are in
+// use, and so must any copies made by this class.  The copies are owned by
+// data_owner(), which can be passed to methods such as
+// EncodedS2ShapeIndex::Init() so that the decoded objects keep them alive.
+//
+// All the encoded types above store the length of their encoding (or can
+// determine it from their header), so decoding an object from a prefix of
+// its encoding fails rather than succeeding with different contents.  This
+// is what allows ChunkedDecoder to detect objects that straddle a boundary.
+class ChunkedDecoder {
+ public:
+  // Decodes the concatenation of the given chunks.  The chunks themselves
+  // are not copied.  Empty chunks are allowed.
+  explicit ChunkedDecoder(absl::Span<const absl::string_view> chunks);
+
+  // Decodes the contents of "cord", which must not be modified while this
+  // object or any object decoded from it is in use.
+  explicit ChunkedDecoder(const absl::Cord& cord);
+
+  // Returns the number of bytes that have not been decoded yet.
+  size_t avail() const;
+
+  // Decodes one object by calling "init" with a Decoder positioned at the
+  // current offset, which should return true on success.  On success, this
+  // object then advances past the bytes that "init" consumed.
+  //
+  // "init" is first called with a Decoder over the rest of the current
+  // chunk.  If it fails and more chunks remain, the data is copied into a
+  // contiguous buffer one chunk at a time and "init" is called again, until
+  // it either succeeds or there is no more data.  Therefore "init" must be
+  // safe to call more than once, and it must fail (rather than succeed with
+  // different results) when the data is truncated.  Returns false if "init"
+  // never succeeds.
+  bool Decode(absl::FunctionRef<bool(Decoder*)> init);
+
+  // Returns an object that owns all copies made so far or in the future by
+  // Decode(), plus the chunk owner passed to set_chunk_owner() (if any).
+  std::shared_ptr<const void> data_owner() const { return storage_; }
+
+  // Optionally, an object that keeps the chunks alive (e.g. a
+  // std::shared_ptr<const absl::Cord>).  The object is then also kept alive
+  // by data_owner().
+  void set_chunk_owner(std::shared_ptr<const void> chunk_owner);
+
+  // Returns the number of bytes copied by Decode() because an object
+  // straddled a chunk boundary.
+  size_t bytes_copied() const { return bytes_copied_; }
+
+ private:
+  struct Storage {
+    std::shared_ptr<const void> chunk_owner;
+    std::vector<std::vector<char>> buffers;
+  };
+
+  // Advances the current position by "n" bytes.
+  void Advance(size_t n);
+
+  std::vector<absl::string_view> chunks_;
+
+  // The current position is byte "offset_" of chunks_[chunk_].  This is
+  // always a valid position unless chunk_ == chunks_.size().
+  size_t chunk_ = 0;
+  size_t offset_ = 0;
+
+  size_t bytes_copied_ = 0;
+  std::shared_ptr<Storage> storage_;
+};
+
+}  // namespace s2coding
+
+#endif  // S2_CHUNKED_DECODER_H_
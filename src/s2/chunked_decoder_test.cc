@@ -0,0 +1,138 @@
+// Copyright 2024 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "s2/chunked_decoder.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include "absl/log/log_streamer.h"
+#include "absl/random/random.h"
+#include "absl/strings/cord.h"
+#include "absl/strings/string_view.h"
+#include "s2/util/coding/coder.h"
+#include "s2/encoded_s2shape_index.h"
+#include "s2/encoded_string_vector.h"
+#include "s2/mutable_s2shape_index.h"
+#include "s2/s2error.h"
+#include "s2/s2shapeutil_coding.h"
+#include "s2/s2shapeutil_testing.h"
+#include "s2/s2testing.h"
+#include "s2/s2text_format.h"
+
+using absl::string_view;
+using s2coding::ChunkedDecoder;
+using s2coding::EncodedStringVector;
+using s2coding::StringVectorEncoder;
+using std::string;
+using std::vector;
+
+namespace {
+
+// Decodes an EncodedS2ShapeIndex (preceded by its shapes) from "decoder".
+bool DecodeIndex(ChunkedDecoder& decoder, EncodedS2ShapeIndex* index) {
+  std::optional<s2shapeutil::TaggedShapeFactory> factory;
+  return decoder.Decode([&](Decoder* d) {
+           S2Error error;
+           factory.emplace(s2shapeutil::LazyDecodeShapeFactory(
+               d, decoder.data_owner(), error));
+           return error.ok();
+         }) &&
+         decoder.Decode([&](Decoder* d) {
+           return index->Init(d, *factory, decoder.data_owner());
+         });
+}
+
+// Splits "data" into chunks at the given offsets.
+vector<string_view> Split(string_view data, const vector<size_t>& offsets) {
+  vector<string_view> chunks;
+  size_t begin = 0;
+  for (size_t offset : offsets) {
+    chunks.push_back(data.substr(begin, offset - begin));
+    begin = offset;
+  }
+  chunks.push_back(data.substr(begin));
+  return chunks;
+}
+
+TEST(ChunkedDecoder, StringVectors) {
+  // Encode two string vectors back to back.
+  Encoder encoder;
+  StringVectorEncoder::Encode({"a", "bc", "def"}, &encoder);
+  const size_t first_length = encoder.length();
+  StringVectorEncoder::Encode({"ghij", "", "k"}, &encoder);
+  string_view data(encoder.base(), encoder.length());
+
+  for (size_t split = 0; split <= data.size(); ++split) {
+    ChunkedDecoder decoder(Split(data, {split}));
+    EncodedStringVector v1, v2;
+    ASSERT_TRUE(decoder.Decode([&](Decoder* d) { return v1.Init(d); }));
+    ASSERT_TRUE(decoder.Decode([&](Decoder* d) { return v2.Init(d); }));
+    EXPECT_EQ(0, decoder.avail());
+    EXPECT_EQ((vector<string_view>{"a", "bc", "def"}), v1.Decode());
+    EXPECT_EQ((vector<string_view>{"ghij", "", "k"}), v2.Decode());
+    // Objects are only copied when they straddle the split.
+    bool straddles = split > 0 && split < data.size() && split != first_length;
+    EXPECT_EQ(straddles, decoder.bytes_copied() > 0) << split;
+  }
+}
+
+TEST(ChunkedDecoder, TruncatedData) {
+  Encoder encoder;
+  StringVectorEncoder::Encode({"abc", "def"}, &encoder);
+  string_view data(encoder.base(), encoder.length() - 1);
+  ChunkedDecoder decoder(Split(data, {2}));
+  EncodedStringVector v;
+  EXPECT_FALSE(decoder.Decode([&](Decoder* d) { return v.Init(d); }));
+}
+
+TEST(ChunkedDecoder, EncodedS2ShapeIndex) {
+  absl::BitGen bitgen(S2Testing::MakeTaggedSeedSeq(
+      "ENCODED_S2SHAPE_INDEX",
+      absl::LogInfoStreamer(__FILE__, __LINE__).stream()));
+  auto expected = s2textformat::MakeIndexOrDie(
+      "0:0 | 1:1 # 2:2, 3:3, 4:4 # 5:5, 5:6, 6:6; 10:10, 10:12, 12:12, 12:10");
+  Encoder encoder;
+  ASSERT_TRUE(s2shapeutil::CompactEncodeTaggedShapes(*expected, &encoder));
+  expected->Encode(&encoder);
+  string data(encoder.base(), encoder.length());
+
+  for (int iter = 0; iter < 20; ++iter) {
+    // Split the data into a random number of chunks, and store them in a
+    // Cord without copying.
+    vector<size_t> offsets;
+    for (int i = absl::Uniform(bitgen, 0, 5); i > 0; --i) {
+      offsets.push_back(absl::Uniform<size_t>(bitgen, 0, data.size()));
+    }
+    std::sort(offsets.begin(), offsets.end());
+    absl::Cord cord;
+    for (string_view chunk : Split(data, offsets)) {
+      cord.Append(absl::MakeCordFromExternal(chunk, [] {}));
+    }
+    auto decoder = std::make_unique<ChunkedDecoder>(cord);
+    EncodedS2ShapeIndex actual;
+    ASSERT_TRUE(DecodeIndex(*decoder, &actual));
+    // The index must not depend on the ChunkedDecoder itself.
+    decoder.reset();
+    s2testing::ExpectEqual(*expected, actual);
+  }
+}
+
+}  // namespace
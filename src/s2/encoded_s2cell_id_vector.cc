@@ -18,7 +18,9 @@
 #include "s2/encoded_s2cell_id_vector.h"
 
 #include <algorithm>
+#include <cstddef>
 #include <cstdint>
+#include <utility>
 #include <vector>
 
 #include "absl/log/absl_check.h"
@@ -31,6 +33,7 @@
 using absl::Span;
 using std::max;
 using std::min;
+using std::pair;
 using std::vector;
 
 namespace s2coding {
@@ -180,12 +183,54 @@ bool EncodedS2CellIdVector::Init(Decoder* decoder) {
 
 vector<S2CellId> EncodedS2CellIdVector::Decode() const {
   vector<S2CellId> result(size());
-  for (size_t i = 0; i < size(); ++i) {
-    result[i] = (*this)[i];
-  }
+  Decode(0, size(), result.data());
   return result;
 }
 
+void EncodedS2CellIdVector::Decode(size_t begin, size_t end,
+                                   S2CellId* out) const {
+  // Decode the deltas in blocks using a small buffer, then apply the shift
+  // and base to each block.
+  constexpr size_t kBlockSize = 256;
+  uint64_t deltas[kBlockSize];
+  while (begin < end) {
+    size_t n = std::min(kBlockSize, end - begin);
+    deltas_.Decode(begin, begin + n, deltas);
+    for (size_t i = 0; i < n; ++i) {
+      *out++ = S2CellId((deltas[i] << shift_) + base_);
+    }
+    begin += n;
+  }
+}
+
+vector<pair<int, int>> EncodedS2CellIdVector::GetIntersectingRanges(
+    Span<const S2CellId> cells) const {
+  vector<pair<int, int>> ranges;
+  const int n = size();
+  for (S2CellId id : cells) {
+    int begin = lower_bound(id.range_min());
+    if (begin > 0 && (*this)[begin - 1].range_max() >= id.range_min()) {
+      --begin;  // The previous element contains "id".
+    }
+    // An element that contains "id" may also sort after id.range_max() (if
+    // "id" is in the first half of that element).
+    int end = lower_bound(id.range_max().next());
+    if (end < n && (*this)[end].range_min() <= id.range_max()) {
+      ++end;  // The next element contains "id".
+    }
+    if (!ranges.empty() && begin < ranges.back().second) {
+      begin = ranges.back().second;  // Skip elements already included.
+    }
+    if (begin >= end) continue;
+    if (!ranges.empty() && begin == ranges.back().second) {
+      ranges.back().second = end;
+    } else {
+      ranges.emplace_back(begin, end);
+    }
+  }
+  return ranges;
+}
+
 void EncodedS2CellIdVector::Encode(Encoder* encoder) const {
   // Re-encode the base and shift values.
   EncodeBaseShift(encoder, shift_, base_, base_len_);
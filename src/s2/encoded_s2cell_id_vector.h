@@ -20,6 +20,7 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <utility>
 #include <vector>
 
 #include "absl/types/span.h"
@@ -75,9 +76,25 @@ class EncodedS2CellIdVector {
   // REQUIRES: The vector elements are sorted in non-decreasing order.
   size_t lower_bound(S2CellId target) const;
 
+  // Returns a sorted list of disjoint ranges [begin, end) of the positions of
+  // the elements that intersect any of the given cells.  Adjacent ranges are
+  // merged.
+  //
+  // REQUIRES: The vector elements are sorted and do not overlap (e.g., the
+  //           cells of an S2ShapeIndex), and so are "cells" (e.g., the cells
+  //           of an S2CellUnion).
+  std::vector<std::pair<int, int>> GetIntersectingRanges(
+      absl::Span<const S2CellId> cells) const;
+
   // Decodes and returns the entire original vector.
   std::vector<S2CellId> Decode() const;
 
+  // Decodes the elements in the range [begin, end) into "out", which must
+  // have room for (end - begin) values.
+  //
+  // REQUIRES: begin <= end <= size()
+  void Decode(size_t begin, size_t end, S2CellId* out) const;
+
   // Copies the encoded byte stream to a new encoder.
   void Encode(Encoder* encoder) const;
 
@@ -0,0 +1,87 @@
+// Copyright 2024 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "s2/encoded_s2cell_id_vector.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+#include "absl/log/absl_check.h"
+#include "s2/util/coding/coder.h"
+#include "s2/s2cell_id.h"
+#include "s2/s2random.h"
+
+using std::string;
+using std::vector;
+
+namespace {
+
+constexpr int kNumTargets = 4096;
+
+// Returns "n" sorted random cell ids at the given level.
+vector<S2CellId> MakeSortedCellIds(std::mt19937_64& bitgen, int n,
+                                   int level) {
+  vector<S2CellId> ids;
+  for (int i = 0; i < n; ++i) ids.push_back(s2random::CellId(bitgen, level));
+  std::sort(ids.begin(), ids.end());
+  return ids;
+}
+
+string EncodeCellIds(const vector<S2CellId>& ids) {
+  Encoder encoder;
+  s2coding::EncodeS2CellIdVector(ids, &encoder);
+  return string(encoder.base(), encoder.length());
+}
+
+// Measures lower_bound() for random leaf cell targets in a vector of
+// state.range(0) level-20 cell ids.  This is the search used by
+// EncodedS2ShapeIndex::Seek().
+void BM_EncodedS2CellIdVectorLowerBound(benchmark::State& state) {
+  std::mt19937_64 bitgen(1);
+  const string encoded =
+      EncodeCellIds(MakeSortedCellIds(bitgen, state.range(0), 20));
+  vector<S2CellId> targets =
+      MakeSortedCellIds(bitgen, kNumTargets, S2CellId::kMaxLevel);
+  Decoder decoder(encoded.data(), encoded.size());
+  s2coding::EncodedS2CellIdVector cell_ids;
+  ABSL_CHECK(cell_ids.Init(&decoder));
+  std::shuffle(targets.begin(), targets.end(), bitgen);
+  size_t i = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(cell_ids.lower_bound(targets[i++ % kNumTargets]));
+  }
+}
+BENCHMARK(BM_EncodedS2CellIdVectorLowerBound)->Range(64, 1 << 20);
+
+// Measures the time to decode a vector of state.range(0) cell ids.
+void BM_EncodedS2CellIdVectorDecode(benchmark::State& state) {
+  std::mt19937_64 bitgen(1);
+  const string encoded =
+      EncodeCellIds(MakeSortedCellIds(bitgen, state.range(0), 20));
+  Decoder decoder(encoded.data(), encoded.size());
+  s2coding::EncodedS2CellIdVector cell_ids;
+  ABSL_CHECK(cell_ids.Init(&decoder));
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(cell_ids.Decode());
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_EncodedS2CellIdVectorDecode)->Range(64, 1 << 16);
+
+}  // namespace
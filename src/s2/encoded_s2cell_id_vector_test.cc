@@ -20,6 +20,7 @@
 #include <cstddef>
 #include <cstdint>
 #include <memory>
+#include <utility>
 #include <vector>
 
 #include <gtest/gtest.h>
@@ -41,6 +42,7 @@
 
 using s2textformat::MakeCellIdOrDie;
 using std::make_unique;
+using std::pair;
 using std::vector;
 
 namespace s2coding {
@@ -254,6 +256,28 @@ TEST(EncodedS2CellIdVector, CoveringCells) {
   TestEncodedS2CellIdVector(ids, 488);
 }
 
+TEST(EncodedS2CellIdVector, DecodeRange) {
+  // Uses enough cells to span several of the blocks used internally.
+  vector<S2CellId> expected;
+  for (S2CellId id = S2CellId::Begin(5); id != S2CellId::End(5);
+       id = id.next()) {
+    if (id.id() % 3 == 0) expected.push_back(id);
+  }
+  ASSERT_GT(expected.size(), 1000);
+  Encoder encoder;
+  EncodedS2CellIdVector cell_ids =
+      MakeEncodedS2CellIdVector(expected, &encoder);
+  EXPECT_EQ(cell_ids.Decode(), expected);
+  for (size_t begin : {0, 100, 255, 256, 1000}) {
+    for (size_t end : {begin, begin + 1, begin + 300, expected.size()}) {
+      vector<S2CellId> actual(end - begin);
+      cell_ids.Decode(begin, end, actual.data());
+      EXPECT_EQ(actual, vector<S2CellId>(expected.begin() + begin,
+                                         expected.begin() + end));
+    }
+  }
+}
+
 TEST(EncodedS2CellIdVector, LowerBoundLimits) {
   // Test seeking before the beginning and past the end of the vector.
   S2CellId first = S2CellId::Begin(S2CellId::kMaxLevel);
@@ -270,5 +294,38 @@ TEST(EncodedS2CellIdVector, LowerBoundLimits) {
   EXPECT_EQ(2, cell_ids.lower_bound(S2CellId::Sentinel()));
 }
 
+TEST(EncodedS2CellIdVector, GetIntersectingRanges) {
+  const S2CellId face0 = S2CellId::FromFace(0), face1 = S2CellId::FromFace(1);
+  Encoder encoder;
+  EncodedS2CellIdVector cell_ids = MakeEncodedS2CellIdVector(
+      {face0.child(0).child(0), face0.child(0).child(1), face1,
+       S2CellId::FromFace(2).child(3)},
+      &encoder);
+  using Ranges = vector<pair<int, int>>;
+  EXPECT_EQ(cell_ids.GetIntersectingRanges({}), Ranges{});
+  EXPECT_EQ(cell_ids.GetIntersectingRanges({face0.child(0)}), (Ranges{{0, 2}}));
+  EXPECT_EQ(cell_ids.GetIntersectingRanges({face0.child(1)}), Ranges{});
+
+  // Small cells before and after the center of an element that contains
+  // them (the first sorts before the element).
+  EXPECT_EQ(cell_ids.GetIntersectingRanges({face1.child_begin(10)}),
+            (Ranges{{2, 3}}));
+  EXPECT_EQ(cell_ids.GetIntersectingRanges({face1.child_end(10).prev()}),
+            (Ranges{{2, 3}}));
+
+  // Adjacent ranges are merged.
+  EXPECT_EQ(cell_ids.GetIntersectingRanges(
+                {face0.child(0).child(1).child_begin(5), face1.child(2)}),
+            (Ranges{{1, 3}}));
+  EXPECT_EQ(cell_ids.GetIntersectingRanges(
+                {face0.child(0).child(0), face0.child(0).child(1).child(3),
+                 S2CellId::FromFace(2).child(1),
+                 S2CellId::FromFace(2).child(3).child_begin(20)}),
+            (Ranges{{0, 2}, {3, 4}}));
+  EXPECT_EQ(cell_ids.GetIntersectingRanges(
+                {face0, face1, S2CellId::FromFace(2)}),
+            (Ranges{{0, 4}}));
+}
+
 }  // namespace
 }  // namespace s2coding
@@ -0,0 +1,113 @@
+// Copyright 2024 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "s2/encoded_s2cell_index.h"
+
+#include <algorithm>
+#include <cstdint>
+
+#include "absl/container/flat_hash_set.h"
+#include "s2/util/coding/coder.h"
+#include "s2/s2cell_id.h"
+#include "s2/s2cell_union.h"
+
+using absl::flat_hash_set;
+
+using Label = EncodedS2CellIndex::Label;
+
+// Must match the version written by S2CellIndex::Encode().
+static constexpr uint32_t kCurrentEncodingVersion = 1;
+
+bool EncodedS2CellIndex::Init(Decoder* decoder) {
+  uint32_t version;
+  if (!decoder->get_varint32(&version) || version != kCurrentEncodingVersion) {
+    return false;
+  }
+  if (!cell_ids_.Init(decoder) || !labels_.Init(decoder) ||
+      !parents_.Init(decoder) || !range_start_ids_.Init(decoder) ||
+      !range_contents_.Init(decoder)) {
+    return false;
+  }
+  // There is always a range at the beginning and end of the S2CellId range.
+  const size_t num_ranges = range_start_ids_.size();
+  return labels_.size() == cell_ids_.size() &&
+         parents_.size() == cell_ids_.size() &&
+         range_contents_.size() == num_ranges && num_ranges >= 2 &&
+         range_start_ids_[0] == S2CellId::Begin(S2CellId::kMaxLevel) &&
+         range_start_ids_[num_ranges - 1] ==
+             S2CellId::End(S2CellId::kMaxLevel);
+}
+
+void EncodedS2CellIndex::ContentsIterator::StartUnion(
+    const RangeIterator& range) {
+  if (range.start_id() < prev_start_id_) {
+    node_cutoff_ = -1;  // Can't automatically eliminate duplicates.
+  }
+  prev_start_id_ = range.start_id();
+
+  int32_t contents = range.contents();
+  if (contents <= node_cutoff_) {
+    node_ = -1;
+  } else {
+    SetNode(contents);
+  }
+  // Nodes are numbered using a preorder traversal, so ancestors with smaller
+  // indexes than any previously visited node have already been reported.
+  next_node_cutoff_ = contents;
+}
+
+bool EncodedS2CellIndex::VisitIntersectingCells(
+    const S2CellUnion& target, const CellVisitor& visitor) const {
+  // This is the same algorithm as S2CellIndex::VisitIntersectingCells().
+  if (target.empty()) return true;
+  auto it = target.begin();
+  ContentsIterator contents(this);
+  RangeIterator range(this);
+  range.Begin();
+  do {
+    if (range.limit_id() <= it->range_min()) {
+      range.Seek(it->range_min());  // Only seek when necessary.
+    }
+    for (; range.start_id() <= it->range_max(); range.Next()) {
+      for (contents.StartUnion(range); !contents.done(); contents.Next()) {
+        if (!visitor(contents.cell_id(), contents.label())) {
+          return false;
+        }
+      }
+    }
+    // Skip over target cells contained by the range that was just processed.
+    if (++it != target.end() && it->range_max() < range.start_id()) {
+      it = std::lower_bound(it + 1, target.end(), range.start_id());
+      if ((it - 1)->range_max() >= range.start_id()) --it;
+    }
+  } while (it != target.end());
+  return true;
+}
+
+flat_hash_set<Label> EncodedS2CellIndex::GetIntersectingLabels(
+    const S2CellUnion& target) const {
+  flat_hash_set<Label> labels;
+  GetIntersectingLabels(target, &labels);
+  return labels;
+}
+
+void EncodedS2CellIndex::GetIntersectingLabels(
+    const S2CellUnion& target, flat_hash_set<Label>* labels) const {
+  labels->clear();
+  VisitIntersectingCells(target, [labels](S2CellId cell_id, Label label) {
+    labels->insert(label);
+    return true;
+  });
+}
@@ -0,0 +1,375 @@
+// Copyright 2024 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef S2_ENCODED_S2CELL_INDEX_H_
+#define S2_ENCODED_S2CELL_INDEX_H_
+
+#include <cstddef>
+#include <cstdint>
+
+#include "absl/container/flat_hash_set.h"
+#include "absl/log/absl_check.h"
+#include "s2/util/coding/coder.h"
+#include "s2/encoded_s2cell_id_vector.h"
+#include "s2/encoded_uint_vector.h"
+#include "s2/s2cell_id.h"
+#include "s2/s2cell_index.h"
+#include "s2/s2cell_union.h"
+
+// EncodedS2CellIndex is a read-only S2CellIndex that is queried directly in
+// its encoded form (as written by S2CellIndex::Encode), without decoding it
+// into memory first.  Initialization takes constant time and the index uses
+// only a small fixed amount of memory beyond the encoded data itself, which
+// makes it possible to share one copy of a large index between processes by
+// memory-mapping the encoded data:
+//
+//   S2CellIndex index;
+//   ... Add() cells, Build() ...
+//   Encoder encoder;
+//   index.Encode(&encoder);
+//   ... write encoder.base() to a file ...
+//
+//   // In each process:
+//   Decoder decoder(mmap_data, mmap_size);
+//   EncodedS2CellIndex encoded_index;
+//   if (!encoded_index.Init(&decoder)) { ... }
+//   auto labels = encoded_index.GetIntersectingLabels(target);
+//
+// The iterator types below have the same interface as the corresponding
+// S2CellIndex types, although EncodedS2CellIndex is somewhat slower since
+// values must be decoded on every access.
+//
+// Since the encoded data is not decoded, Init() only checks that it is
+// well-formed at the top level.  Use S2CellIndex::Decode() to validate data
+// from untrusted sources.
+class EncodedS2CellIndex {
+ public:
+  using Label = S2CellIndex::Label;
+  using LabelledCell = S2CellIndex::LabelledCell;
+  using CellVisitor = S2CellIndex::CellVisitor;
+
+  // Default constructor; the index must be initialized by calling Init().
+  EncodedS2CellIndex() = default;
+
+  // Initializes the index from data written by S2CellIndex::Encode().  The
+  // index keeps pointers into the decoder's underlying buffer, which must
+  // persist for the lifetime of the index.  Returns false on errors.
+  bool Init(Decoder* decoder);
+
+  // Returns the number of (cell_id, label) pairs in the index.
+  int num_cells() const;
+
+  // Visits all (cell_id, label) pairs in the index that intersect the given
+  // S2CellUnion "target".  See S2CellIndex::VisitIntersectingCells.
+  bool VisitIntersectingCells(const S2CellUnion& target,
+                              const CellVisitor& visitor) const;
+
+  // Convenience function that returns the labels of all indexed cells that
+  // intersect the given S2CellUnion "target".
+  absl::flat_hash_set<Label> GetIntersectingLabels(const S2CellUnion& target)
+      const;
+
+  // This version can be more efficient when it is called many times, since it
+  // does not require allocating a new set on each call.
+  void GetIntersectingLabels(const S2CellUnion& target,
+                             absl::flat_hash_set<Label>* labels) const;
+
+  class ContentsIterator;
+
+  // An iterator that visits the entire set of indexed (cell_id, label) pairs
+  // in an unspecified order.  See S2CellIndex::CellIterator.
+  class CellIterator {
+   public:
+    explicit CellIterator(const EncodedS2CellIndex* index);
+    S2CellId cell_id() const;
+    Label label() const;
+    LabelledCell labelled_cell() const;
+    bool done() const;
+    void Next();
+
+   private:
+    const EncodedS2CellIndex* index_;
+    int32_t pos_ = 0;
+  };
+
+  // An iterator that seeks and iterates over the non-overlapping leaf cell
+  // ranges.  See S2CellIndex::RangeIterator.
+  class RangeIterator {
+   public:
+    // The iterator is initially *unpositioned*; you must call a positioning
+    // method such as Begin() or Seek() before accessing its contents.
+    explicit RangeIterator(const EncodedS2CellIndex* index);
+    S2CellId start_id() const;
+    S2CellId limit_id() const;
+    bool done() const;
+    void Begin();
+    void Finish();
+    void Next();
+    bool Prev();
+    void Seek(S2CellId target);
+    bool is_empty() const;
+    bool Advance(int n);
+
+   private:
+    friend class ContentsIterator;
+
+    // The index of the cell_tree node representing the current range.
+    int32_t contents() const;
+
+    const EncodedS2CellIndex* index_;
+    // The current position within the ranges, or -1 if unpositioned.
+    int32_t pos_ = -1;
+  };
+
+  // Like RangeIterator, but only visits leaf cell ranges that overlap at
+  // least one (cell_id, label) pair.
+  class NonEmptyRangeIterator : public RangeIterator {
+   public:
+    explicit NonEmptyRangeIterator(const EncodedS2CellIndex* index);
+    void Begin();
+    void Next();
+    bool Prev();
+    void Seek(S2CellId target);
+  };
+
+  // An iterator that visits the (cell_id, label) pairs that cover a set of
+  // leaf cell ranges.  Duplicate values are suppressed exactly as described
+  // for S2CellIndex::ContentsIterator.
+  class ContentsIterator {
+   public:
+    ContentsIterator() = default;
+    explicit ContentsIterator(const EncodedS2CellIndex* index);
+    void Init(const EncodedS2CellIndex* index);
+    void Clear();
+    void StartUnion(const RangeIterator& range);
+    S2CellId cell_id() const;
+    Label label() const;
+    LabelledCell labelled_cell() const;
+    bool done() const;
+    void Next();
+
+   private:
+    // Positions the iterator at the given node index of the cell tree.
+    void SetNode(int32_t node);
+
+    const EncodedS2CellIndex* index_ = nullptr;
+    S2CellId prev_start_id_;
+    int32_t node_cutoff_;
+    int32_t next_node_cutoff_;
+    // The current node of the cell tree, or -1 if done().
+    int32_t node_ = -1;
+    S2CellId cell_id_;
+    Label label_;
+  };
+
+ private:
+  // Returns the index of the parent of the given cell tree node, or -1.
+  int32_t parent(int32_t node) const;
+
+  // The cell tree and leaf cell ranges, as described in s2cell_index.h.
+  // Parent and contents values are offset by one so that -1 is encoded as 0.
+  s2coding::EncodedS2CellIdVector cell_ids_;
+  s2coding::EncodedUintVector<uint32_t> labels_;
+  s2coding::EncodedUintVector<uint32_t> parents_;
+  s2coding::EncodedS2CellIdVector range_start_ids_;
+  s2coding::EncodedUintVector<uint32_t> range_contents_;
+};
+
+
+//////////////////   Implementation details follow   ////////////////////
+
+
+inline int EncodedS2CellIndex::num_cells() const { return cell_ids_.size(); }
+
+inline int32_t EncodedS2CellIndex::parent(int32_t node) const {
+  return static_cast<int32_t>(parents_[node]) - 1;
+}
+
+inline EncodedS2CellIndex::CellIterator::CellIterator(
+    const EncodedS2CellIndex* index)
+    : index_(index) {}
+
+inline S2CellId EncodedS2CellIndex::CellIterator::cell_id() const {
+  ABSL_DCHECK(!done());
+  return index_->cell_ids_[pos_];
+}
+
+inline EncodedS2CellIndex::Label EncodedS2CellIndex::CellIterator::label()
+    const {
+  ABSL_DCHECK(!done());
+  return index_->labels_[pos_];
+}
+
+inline EncodedS2CellIndex::LabelledCell
+EncodedS2CellIndex::CellIterator::labelled_cell() const {
+  return LabelledCell(cell_id(), label());
+}
+
+inline bool EncodedS2CellIndex::CellIterator::done() const {
+  return pos_ == index_->num_cells();
+}
+
+inline void EncodedS2CellIndex::CellIterator::Next() {
+  ABSL_DCHECK(!done());
+  ++pos_;
+}
+
+inline EncodedS2CellIndex::RangeIterator::RangeIterator(
+    const EncodedS2CellIndex* index)
+    : index_(index) {}
+
+inline int32_t EncodedS2CellIndex::RangeIterator::contents() const {
+  return static_cast<int32_t>(index_->range_contents_[pos_]) - 1;
+}
+
+inline S2CellId EncodedS2CellIndex::RangeIterator::start_id() const {
+  return index_->range_start_ids_[pos_];
+}
+
+inline S2CellId EncodedS2CellIndex::RangeIterator::limit_id() const {
+  ABSL_DCHECK(!done());
+  return index_->range_start_ids_[pos_ + 1];
+}
+
+inline bool EncodedS2CellIndex::RangeIterator::done() const {
+  ABSL_DCHECK_GE(pos_, 0) << "Call Begin() or Seek() first.";
+  // Note that the last range is a sentinel value.
+  return pos_ >= static_cast<int32_t>(index_->range_start_ids_.size()) - 1;
+}
+
+inline void EncodedS2CellIndex::RangeIterator::Begin() { pos_ = 0; }
+
+inline void EncodedS2CellIndex::RangeIterator::Finish() {
+  pos_ = index_->range_start_ids_.size() - 1;
+}
+
+inline void EncodedS2CellIndex::RangeIterator::Next() {
+  ABSL_DCHECK(!done());
+  ++pos_;
+}
+
+inline bool EncodedS2CellIndex::RangeIterator::Prev() {
+  if (pos_ == 0) return false;
+  --pos_;
+  return true;
+}
+
+inline void EncodedS2CellIndex::RangeIterator::Seek(S2CellId target) {
+  ABSL_DCHECK(target.is_leaf());
+  // Find the last range that starts at or before "target".
+  pos_ = index_->range_start_ids_.lower_bound(target);
+  if (index_->range_start_ids_[pos_] != target) --pos_;
+}
+
+inline bool EncodedS2CellIndex::RangeIterator::is_empty() const {
+  return index_->range_contents_[pos_] == 0;
+}
+
+inline bool EncodedS2CellIndex::RangeIterator::Advance(int n) {
+  // Note that the last range is a sentinel value.
+  if (n >= static_cast<int32_t>(index_->range_start_ids_.size()) - 1 - pos_) {
+    return false;
+  }
+  pos_ += n;
+  return true;
+}
+
+inline EncodedS2CellIndex::NonEmptyRangeIterator::NonEmptyRangeIterator(
+    const EncodedS2CellIndex* index)
+    : RangeIterator(index) {}
+
+inline void EncodedS2CellIndex::NonEmptyRangeIterator::Begin() {
+  RangeIterator::Begin();
+  while (is_empty() && !done()) RangeIterator::Next();
+}
+
+inline void EncodedS2CellIndex::NonEmptyRangeIterator::Next() {
+  do {
+    RangeIterator::Next();
+  } while (is_empty() && !done());
+}
+
+inline bool EncodedS2CellIndex::NonEmptyRangeIterator::Prev() {
+  while (RangeIterator::Prev()) {
+    if (!is_empty()) return true;
+  }
+  // Return the iterator to its original position.
+  if (is_empty() && !done()) Next();
+  return false;
+}
+
+inline void EncodedS2CellIndex::NonEmptyRangeIterator::Seek(S2CellId target) {
+  RangeIterator::Seek(target);
+  while (is_empty() && !done()) RangeIterator::Next();
+}
+
+inline EncodedS2CellIndex::ContentsIterator::ContentsIterator(
+    const EncodedS2CellIndex* index) {
+  Init(index);
+}
+
+inline void EncodedS2CellIndex::ContentsIterator::Init(
+    const EncodedS2CellIndex* index) {
+  index_ = index;
+  Clear();
+}
+
+inline void EncodedS2CellIndex::ContentsIterator::Clear() {
+  prev_start_id_ = S2CellId::None();
+  node_cutoff_ = -1;
+  next_node_cutoff_ = -1;
+  node_ = -1;
+}
+
+inline void EncodedS2CellIndex::ContentsIterator::SetNode(int32_t node) {
+  node_ = node;
+  cell_id_ = index_->cell_ids_[node];
+  label_ = index_->labels_[node];
+}
+
+inline S2CellId EncodedS2CellIndex::ContentsIterator::cell_id() const {
+  ABSL_DCHECK(!done());
+  return cell_id_;
+}
+
+inline EncodedS2CellIndex::Label EncodedS2CellIndex::ContentsIterator::label()
+    const {
+  ABSL_DCHECK(!done());
+  return label_;
+}
+
+inline EncodedS2CellIndex::LabelledCell
+EncodedS2CellIndex::ContentsIterator::labelled_cell() const {
+  ABSL_DCHECK(!done());
+  return LabelledCell(cell_id_, label_);
+}
+
+inline bool EncodedS2CellIndex::ContentsIterator::done() const {
+  return node_ < 0;
+}
+
+inline void EncodedS2CellIndex::ContentsIterator::Next() {
+  ABSL_DCHECK(!done());
+  int32_t parent = index_->parent(node_);
+  if (parent <= node_cutoff_) {
+    // We have already processed this node and its ancestors.
+    node_cutoff_ = next_node_cutoff_;
+    node_ = -1;
+  } else {
+    SetNode(parent);
+  }
+}
+
+#endif  // S2_ENCODED_S2CELL_INDEX_H_
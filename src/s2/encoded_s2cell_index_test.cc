@@ -0,0 +1,176 @@
+// Copyright 2024 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "s2/encoded_s2cell_index.h"
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include "absl/log/log_streamer.h"
+#include "absl/random/random.h"
+#include "s2/util/coding/coder.h"
+#include "s2/s2cell_id.h"
+#include "s2/s2cell_index.h"
+#include "s2/s2cell_union.h"
+#include "s2/s2random.h"
+#include "s2/s2testing.h"
+
+using std::vector;
+
+using LabelledCell = S2CellIndex::LabelledCell;
+
+namespace {
+
+class EncodedS2CellIndexTest : public ::testing::Test {
+ protected:
+  // Builds index_ from the given cells and initializes encoded_ from its
+  // encoding.
+  void Build(const vector<LabelledCell>& cells) {
+    for (const LabelledCell& cell : cells) {
+      index_.Add(cell.cell_id, cell.label);
+    }
+    index_.Build();
+    index_.Encode(&encoder_);
+    Decoder decoder(encoder_.base(), encoder_.length());
+    ASSERT_TRUE(encoded_.Init(&decoder));
+    EXPECT_EQ(decoder.avail(), 0);
+  }
+
+  // Expects that the ranges and contents of encoded_ match index_.
+  void ExpectSameRanges() const {
+    S2CellIndex::RangeIterator it(&index_);
+    EncodedS2CellIndex::RangeIterator encoded_it(&encoded_);
+    S2CellIndex::ContentsIterator contents(&index_);
+    EncodedS2CellIndex::ContentsIterator encoded_contents(&encoded_);
+    for (it.Begin(), encoded_it.Begin(); !it.done();
+         it.Next(), encoded_it.Next()) {
+      ASSERT_FALSE(encoded_it.done());
+      ASSERT_EQ(it.start_id(), encoded_it.start_id());
+      ASSERT_EQ(it.limit_id(), encoded_it.limit_id());
+      ASSERT_EQ(it.is_empty(), encoded_it.is_empty());
+
+      // Seeking to the range start and last leaf cell finds the same range.
+      EncodedS2CellIndex::RangeIterator seek_it(&encoded_);
+      seek_it.Seek(it.start_id());
+      EXPECT_EQ(it.start_id(), seek_it.start_id());
+      seek_it.Seek(it.limit_id().prev());
+      EXPECT_EQ(it.start_id(), seek_it.start_id());
+
+      contents.StartUnion(it);
+      encoded_contents.StartUnion(encoded_it);
+      for (; !contents.done(); contents.Next(), encoded_contents.Next()) {
+        ASSERT_FALSE(encoded_contents.done());
+        ASSERT_EQ(contents.labelled_cell(), encoded_contents.labelled_cell());
+      }
+      ASSERT_TRUE(encoded_contents.done());
+    }
+    EXPECT_TRUE(encoded_it.done());
+
+    // Check the non-empty ranges in both directions.
+    S2CellIndex::NonEmptyRangeIterator non_empty(&index_);
+    EncodedS2CellIndex::NonEmptyRangeIterator encoded_non_empty(&encoded_);
+    for (non_empty.Begin(), encoded_non_empty.Begin(); !non_empty.done();
+         non_empty.Next(), encoded_non_empty.Next()) {
+      ASSERT_EQ(non_empty.start_id(), encoded_non_empty.start_id());
+    }
+    EXPECT_TRUE(encoded_non_empty.done());
+    while (non_empty.Prev()) {
+      ASSERT_TRUE(encoded_non_empty.Prev());
+      ASSERT_EQ(non_empty.start_id(), encoded_non_empty.start_id());
+    }
+    EXPECT_FALSE(encoded_non_empty.Prev());
+  }
+
+  Encoder encoder_;
+  S2CellIndex index_;
+  EncodedS2CellIndex encoded_;
+};
+
+TEST_F(EncodedS2CellIndexTest, Empty) {
+  Build({});
+  EXPECT_EQ(encoded_.num_cells(), 0);
+  EXPECT_TRUE(EncodedS2CellIndex::CellIterator(&encoded_).done());
+  ExpectSameRanges();
+  EXPECT_TRUE(encoded_.GetIntersectingLabels(S2CellUnion::WholeSphere())
+                  .empty());
+}
+
+TEST_F(EncodedS2CellIndexTest, MatchesS2CellIndex) {
+  absl::BitGen bitgen(S2Testing::MakeTaggedSeedSeq(
+      "MATCHES_S2CELL_INDEX",
+      absl::LogInfoStreamer(__FILE__, __LINE__).stream()));
+  // Random cells at random levels overlap frequently.  Also include a face
+  // cell and the first and last leaf cells.
+  vector<LabelledCell> cells = {
+      {S2CellId::FromFace(2), 0},
+      {S2CellId::Begin(S2CellId::kMaxLevel), 1},
+      {S2CellId::End(S2CellId::kMaxLevel).prev(), 2}};
+  for (int i = 0; i < 2000; ++i) {
+    cells.push_back({s2random::CellId(bitgen), absl::Uniform(bitgen, 0, 100)});
+  }
+  Build(cells);
+  EXPECT_EQ(encoded_.num_cells(), index_.num_cells());
+
+  vector<LabelledCell> expected, actual;
+  for (S2CellIndex::CellIterator it(&index_); !it.done(); it.Next()) {
+    expected.push_back(it.labelled_cell());
+  }
+  for (EncodedS2CellIndex::CellIterator it(&encoded_); !it.done(); it.Next()) {
+    actual.push_back(it.labelled_cell());
+  }
+  EXPECT_EQ(expected, actual);
+  ExpectSameRanges();
+
+  for (int i = 0; i < 100; ++i) {
+    vector<S2CellId> ids;
+    for (int j = 0; j < 10; ++j) ids.push_back(s2random::CellId(bitgen));
+    S2CellUnion target(std::move(ids));
+    EXPECT_EQ(index_.GetIntersectingLabels(target),
+              encoded_.GetIntersectingLabels(target));
+  }
+}
+
+TEST_F(EncodedS2CellIndexTest, DecodeMatchesEncoded) {
+  Build({{S2CellId::FromDebugString("1/0123"), 5},
+         {S2CellId::FromDebugString("1/01"), 7},
+         {S2CellId::FromDebugString("1/0123"), 5},
+         {S2CellId::FromDebugString("4/3"), 9}});
+  Decoder decoder(encoder_.base(), encoder_.length());
+  S2CellIndex decoded;
+  ASSERT_TRUE(decoded.Decode(&decoder));
+  S2CellIndex::RangeIterator it(&decoded);
+  EncodedS2CellIndex::RangeIterator encoded_it(&encoded_);
+  for (it.Begin(), encoded_it.Begin(); !it.done();
+       it.Next(), encoded_it.Next()) {
+    EXPECT_EQ(it.start_id(), encoded_it.start_id());
+  }
+  EXPECT_TRUE(encoded_it.done());
+}
+
+TEST_F(EncodedS2CellIndexTest, TruncatedEncodingFails) {
+  Build({{S2CellId::FromFace(0), 0}, {S2CellId::FromFace(1), 1}});
+  for (size_t length = 0; length < encoder_.length(); ++length) {
+    Decoder decoder(encoder_.base(), length);
+    EncodedS2CellIndex encoded;
+    EXPECT_FALSE(encoded.Init(&decoder));
+    Decoder decoder2(encoder_.base(), length);
+    S2CellIndex decoded;
+    EXPECT_FALSE(decoded.Decode(&decoder2));
+  }
+}
+
+}  // namespace
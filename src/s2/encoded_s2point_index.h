@@ -0,0 +1,307 @@
+// Copyright 2024 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef S2_ENCODED_S2POINT_INDEX_H_
+#define S2_ENCODED_S2POINT_INDEX_H_
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+#include "absl/log/absl_check.h"
+
+#include "s2/util/coding/coder.h"
+#include "s2/encoded_s2cell_id_vector.h"
+#include "s2/encoded_s2point_vector.h"
+#include "s2/encoded_uint_vector.h"
+#include "s2/s2cell_id.h"
+#include "s2/s2cell_iterator.h"
+#include "s2/s2coder.h"
+#include "s2/s2point.h"
+#include "s2/s2point_index.h"
+
+namespace s2coding {
+
+// Encodes an S2PointIndex in a format that can later be decoded as an
+// EncodedS2PointIndex.  The cell ids are encoded as an EncodedS2CellIdVector,
+// the points as an EncodedS2PointVector (using the given CodingHint), and
+// the data (if any) as an EncodedUintVector.
+//
+// REQUIRES: "Data" is an empty class or an integral type.
+// REQUIRES: "encoder" uses the default constructor, so that its buffer
+//           can be enlarged as necessary by calling Ensure(int).
+template <class Data>
+void EncodeS2PointIndex(const S2PointIndex<Data>& index, Encoder* encoder,
+                        CodingHint hint = CodingHint::COMPACT);
+
+}  // namespace s2coding
+
+// EncodedS2PointIndex is a read-only S2PointIndex that works directly with
+// the data produced by s2coding::EncodeS2PointIndex().  Init() does not
+// decode anything (it only allocates one pointer per kBlockSize points), and
+// points are decoded only when they are accessed, one block of kBlockSize
+// points at a time.  This makes it possible to load a large point index
+// (e.g., from a memory-mapped file) and start querying it immediately rather
+// than rebuilding the index from the raw points.
+//
+// It can be used with S2ClosestPointQuery by specifying it as the second
+// template argument:
+//
+//   Encoder encoder;
+//   s2coding::EncodeS2PointIndex(index, &encoder);
+//   ...
+//   Decoder decoder(data, size);
+//   EncodedS2PointIndex<int> encoded_index;
+//   if (!encoded_index.Init(&decoder)) { ... }
+//   S2ClosestPointQuery<int, EncodedS2PointIndex<int>> query(&encoded_index);
+//
+// The index has the same Iterator interface as S2PointIndex and iterates
+// through the points in the same order.  Like EncodedS2ShapeIndex, it is
+// thread-safe for concurrent readers.
+//
+// REQUIRES: "Data" is an empty class or an integral type.
+template <class Data = std::tuple<> /*empty class*/>
+class EncodedS2PointIndex {
+ public:
+  using PointData = typename S2PointIndex<Data>::PointData;
+
+  // Creates an index that must be initialized by calling Init().
+  EncodedS2PointIndex() = default;
+
+  ~EncodedS2PointIndex();
+
+  // Initializes the index from data written by s2coding::EncodeS2PointIndex().
+  // Returns false on errors.  (This method can be called only once.)
+  //
+  // REQUIRES: The Decoder data buffer must outlive this object.
+  bool Init(Decoder* decoder);
+
+  // Returns the number of points in the index.
+  int num_points() const { return ids_.size(); }
+
+  // Returns the number of bytes currently occupied by the index, including
+  // any points that have been decoded but not the encoded data itself.
+  size_t SpaceUsed() const;
+
+  class Iterator final : public S2CellIterator {
+   public:
+    // Default constructor; must be followed by a call to Init().
+    Iterator() = default;
+
+    // Convenience constructor that calls Init().
+    explicit Iterator(const EncodedS2PointIndex* index) { Init(index); }
+
+    // Initializes an iterator for the given EncodedS2PointIndex.  If the
+    // index is non-empty, the iterator is positioned at the first cell.
+    void Init(const EncodedS2PointIndex* index) {
+      index_ = index;
+      pos_ = 0;
+    }
+
+    // The S2CellId for the current index entry.
+    // REQUIRES: !done()
+    S2CellId id() const override {
+      ABSL_DCHECK(!done());
+      return index_->ids_[pos_];
+    }
+
+    // The point associated with the current index entry.
+    // REQUIRES: !done()
+    const S2Point& point() const { return point_data().point(); }
+
+    // The client-supplied data associated with the current index entry.
+    // REQUIRES: !done()
+    const Data& data() const { return point_data().data(); }
+
+    // The (S2Point, data) pair associated with the current index entry.  The
+    // returned reference remains valid for the lifetime of the index.
+    const PointData& point_data() const {
+      ABSL_DCHECK(!done());
+      return index_->GetPointData(pos_);
+    }
+
+    // Returns true if the iterator is positioned past the last index entry.
+    bool done() const override { return pos_ == index_->num_points(); }
+
+    // Positions the iterator at the first index entry (if any).
+    void Begin() override { pos_ = 0; }
+
+    // Positions the iterator so that done() is true.
+    void Finish() override { pos_ = index_->num_points(); }
+
+    // Advances the iterator to the next index entry.
+    // REQUIRES: !done()
+    void Next() override {
+      ABSL_DCHECK(!done());
+      ++pos_;
+    }
+
+    // If the iterator is already positioned at the beginning, returns false.
+    // Otherwise positions the iterator at the previous entry and returns true.
+    bool Prev() override {
+      if (pos_ == 0) return false;
+      --pos_;
+      return true;
+    }
+
+    // Positions the iterator at the first entry with id() >= target, or at
+    // the end of the index if no such entry exists.
+    void Seek(S2CellId target) override {
+      pos_ = index_->ids_.lower_bound(target);
+    }
+
+    bool Locate(const S2Point& target) override {
+      return LocateImpl(*this, target);
+    }
+
+    S2CellRelation Locate(S2CellId target) override {
+      return LocateImpl(*this, target);
+    }
+
+   private:
+    const EncodedS2PointIndex* index_ = nullptr;
+    int pos_ = 0;
+  };
+
+ private:
+  // The number of consecutive points that are decoded together.
+  static constexpr int kBlockSize = 16;
+
+  // Returns the decoded (point, data) pair at the given position, decoding
+  // the block that contains it if necessary.
+  const PointData& GetPointData(int i) const;
+
+  s2coding::EncodedS2CellIdVector ids_;
+  s2coding::EncodedS2PointVector points_;
+  s2coding::EncodedUintVector<uint64_t> data_;  // Empty if Data is empty.
+
+  // Decoded blocks of points, indexed by block number.  A block is decoded
+  // the first time one of its points is accessed and is never modified
+  // afterwards, so readers need no locking.
+  std::unique_ptr<std::atomic<PointData*>[]> blocks_;
+  int num_blocks_ = 0;
+
+  EncodedS2PointIndex(const EncodedS2PointIndex&) = delete;
+  void operator=(const EncodedS2PointIndex&) = delete;
+};
+
+
+//////////////////   Implementation details follow   ////////////////////
+
+namespace s2coding {
+
+template <class Data>
+void EncodeS2PointIndex(const S2PointIndex<Data>& index, Encoder* encoder,
+                        CodingHint hint) {
+  static_assert(std::is_empty_v<Data> || std::is_integral_v<Data>,
+                "Data must be an empty class or an integral type");
+  std::vector<S2CellId> ids;
+  std::vector<S2Point> points;
+  std::vector<uint64_t> data;
+  ids.reserve(index.num_points());
+  points.reserve(index.num_points());
+  for (typename S2PointIndex<Data>::Iterator it(&index); !it.done();
+       it.Next()) {
+    ids.push_back(it.id());
+    points.push_back(it.point());
+    if constexpr (!std::is_empty_v<Data>) {
+      // Convert to the unsigned type of the same size first so that negative
+      // values are not sign-extended (which would make them 8 bytes long).
+      data.push_back(static_cast<std::make_unsigned_t<Data>>(it.data()));
+    }
+  }
+  EncodeS2CellIdVector(ids, encoder);
+  EncodeS2PointVector(points, hint, encoder);
+  if constexpr (!std::is_empty_v<Data>) {
+    EncodeUintVector<uint64_t>(data, encoder);
+  }
+}
+
+}  // namespace s2coding
+
+template <class Data>
+EncodedS2PointIndex<Data>::~EncodedS2PointIndex() {
+  for (int i = 0; i < num_blocks_; ++i) {
+    delete[] blocks_[i].load(std::memory_order_relaxed);
+  }
+}
+
+template <class Data>
+bool EncodedS2PointIndex<Data>::Init(Decoder* decoder) {
+  static_assert(std::is_empty_v<Data> || std::is_integral_v<Data>,
+                "Data must be an empty class or an integral type");
+  ABSL_DCHECK(blocks_ == nullptr);
+  if (!ids_.Init(decoder)) return false;
+  if (!points_.Init(decoder)) return false;
+  if (points_.size() != ids_.size()) return false;
+  if constexpr (!std::is_empty_v<Data>) {
+    if (!data_.Init(decoder)) return false;
+    if (data_.size() != ids_.size()) return false;
+  }
+  num_blocks_ = (num_points() + kBlockSize - 1) / kBlockSize;
+  blocks_ = std::make_unique<std::atomic<PointData*>[]>(num_blocks_);
+  for (int i = 0; i < num_blocks_; ++i) {
+    blocks_[i].store(nullptr, std::memory_order_relaxed);
+  }
+  return true;
+}
+
+template <class Data>
+size_t EncodedS2PointIndex<Data>::SpaceUsed() const {
+  size_t size = sizeof(*this) + num_blocks_ * sizeof(blocks_[0]);
+  for (int i = 0; i < num_blocks_; ++i) {
+    if (blocks_[i].load(std::memory_order_relaxed) != nullptr) {
+      size += kBlockSize * sizeof(PointData);
+    }
+  }
+  return size;
+}
+
+template <class Data>
+const typename EncodedS2PointIndex<Data>::PointData&
+EncodedS2PointIndex<Data>::GetPointData(int i) const {
+  // memory_order_acquire ensures that the contents of the block are visible
+  // to this thread once the pointer to it is (see EncodedS2ShapeIndex).
+  const int b = i / kBlockSize;
+  PointData* block = blocks_[b].load(std::memory_order_acquire);
+  if (block != nullptr) return block[i % kBlockSize];
+
+  // Decode the block without holding a lock.  If another thread installs
+  // the same block first, we simply discard our copy.
+  const int first = b * kBlockSize;
+  const int last = std::min(first + kBlockSize, num_points());
+  auto decoded = std::make_unique<PointData[]>(kBlockSize);
+  for (int j = first; j < last; ++j) {
+    Data data{};
+    if constexpr (!std::is_empty_v<Data>) {
+      data = static_cast<Data>(
+          static_cast<std::make_unsigned_t<Data>>(data_[j]));
+    }
+    decoded[j - first] = PointData(points_[j], data);
+  }
+  if (blocks_[b].compare_exchange_strong(block, decoded.get(),
+                                         std::memory_order_acq_rel,
+                                         std::memory_order_acquire)) {
+    block = decoded.release();  // Ownership has been transferred to blocks_.
+  }
+  return block[i % kBlockSize];
+}
+
+#endif  // S2_ENCODED_S2POINT_INDEX_H_
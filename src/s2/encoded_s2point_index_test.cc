@@ -0,0 +1,196 @@
+// Copyright 2024 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "s2/encoded_s2point_index.h"
+
+#include <cstddef>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include "absl/log/log_streamer.h"
+#include "absl/random/random.h"
+#include "s2/util/coding/coder.h"
+#include "s2/s2cap.h"
+#include "s2/s2cell_id.h"
+#include "s2/s2closest_point_query.h"
+#include "s2/s2coder.h"
+#include "s2/s2point.h"
+#include "s2/s2point_index.h"
+#include "s2/s2random.h"
+#include "s2/s2testing.h"
+
+using s2coding::CodingHint;
+using std::string;
+using std::vector;
+
+namespace {
+
+template <class Data>
+string Encode(const S2PointIndex<Data>& index, CodingHint hint) {
+  Encoder encoder;
+  s2coding::EncodeS2PointIndex(index, &encoder, hint);
+  return string(encoder.base(), encoder.length());
+}
+
+// Checks that "encoded" contains the same points in the same order as
+// "index", and that seeking gives the same results.
+template <class Data>
+void ExpectSameAsPointIndex(const S2PointIndex<Data>& index,
+                            const EncodedS2PointIndex<Data>& encoded,
+                            absl::BitGenRef bitgen) {
+  ASSERT_EQ(encoded.num_points(), index.num_points());
+  typename S2PointIndex<Data>::Iterator it(&index);
+  typename EncodedS2PointIndex<Data>::Iterator encoded_it(&encoded);
+  EXPECT_FALSE(encoded_it.Prev());
+  for (; !it.done(); it.Next(), encoded_it.Next()) {
+    ASSERT_FALSE(encoded_it.done());
+    EXPECT_EQ(encoded_it.id(), it.id());
+    EXPECT_EQ(encoded_it.point_data(), it.point_data());
+  }
+  EXPECT_TRUE(encoded_it.done());
+
+  for (int i = 0; i < 100; ++i) {
+    S2CellId target = s2random::CellId(bitgen).range_min();
+    it.Seek(target);
+    encoded_it.Seek(target);
+    ASSERT_EQ(encoded_it.done(), it.done());
+    if (!it.done()) EXPECT_EQ(encoded_it.id(), it.id());
+  }
+}
+
+TEST(EncodedS2PointIndex, NoPoints) {
+  absl::BitGen bitgen;
+  S2PointIndex<int> index;
+  string encoded = Encode(index, CodingHint::COMPACT);
+  Decoder decoder(encoded.data(), encoded.size());
+  EncodedS2PointIndex<int> encoded_index;
+  ASSERT_TRUE(encoded_index.Init(&decoder));
+  ExpectSameAsPointIndex(index, encoded_index, bitgen);
+}
+
+TEST(EncodedS2PointIndex, RandomPoints) {
+  absl::BitGen bitgen(S2Testing::MakeTaggedSeedSeq(
+      "RANDOM_POINTS",
+      absl::LogInfoStreamer(__FILE__, __LINE__).stream()));
+  for (CodingHint hint : {CodingHint::FAST, CodingHint::COMPACT}) {
+    for (int num_points : {1, 16, 17, 1000}) {
+      S2PointIndex<int> index;
+      for (int i = 0; i < num_points; ++i) {
+        // Include some duplicate points and negative data values.
+        S2Point p = (i % 10 == 5) ? S2Point(1, 0, 0) : s2random::Point(bitgen);
+        index.Add(p, i - num_points / 2);
+      }
+      string encoded = Encode(index, hint);
+      Decoder decoder(encoded.data(), encoded.size());
+      EncodedS2PointIndex<int> encoded_index;
+      ASSERT_TRUE(encoded_index.Init(&decoder));
+      ExpectSameAsPointIndex(index, encoded_index, bitgen);
+    }
+  }
+}
+
+TEST(EncodedS2PointIndex, EmptyData) {
+  absl::BitGen bitgen;
+  S2PointIndex<> index;
+  for (int i = 0; i < 100; ++i) {
+    // Cell centers are encoded very compactly.
+    index.Add(s2random::CellId(bitgen, 20).ToPoint());
+  }
+  string encoded = Encode(index, CodingHint::COMPACT);
+  Decoder decoder(encoded.data(), encoded.size());
+  EncodedS2PointIndex<> encoded_index;
+  ASSERT_TRUE(encoded_index.Init(&decoder));
+  ExpectSameAsPointIndex(index, encoded_index, bitgen);
+  EXPECT_LT(encoded.size(), 100 * sizeof(S2Point));
+}
+
+TEST(EncodedS2PointIndex, TruncatedData) {
+  absl::BitGen bitgen;
+  S2PointIndex<int> index;
+  for (int i = 0; i < 100; ++i) {
+    index.Add(s2random::Point(bitgen), i);
+  }
+  string encoded = Encode(index, CodingHint::COMPACT);
+  Decoder decoder(encoded.data(), encoded.size() - 1);
+  EncodedS2PointIndex<int> encoded_index;
+  EXPECT_FALSE(encoded_index.Init(&decoder));
+}
+
+TEST(EncodedS2PointIndex, ClosestPointQueryMatchesPointIndex) {
+  absl::BitGen bitgen(S2Testing::MakeTaggedSeedSeq(
+      "CLOSEST_POINT_QUERY_MATCHES_POINT_INDEX",
+      absl::LogInfoStreamer(__FILE__, __LINE__).stream()));
+  S2Cap cap(s2random::Point(bitgen), S2Testing::KmToAngle(100));
+  S2PointIndex<int> index;
+  for (int i = 0; i < 10000; ++i) {
+    index.Add(s2random::SamplePoint(bitgen, cap), i);
+  }
+  string encoded = Encode(index, CodingHint::COMPACT);
+  Decoder decoder(encoded.data(), encoded.size());
+  EncodedS2PointIndex<int> encoded_index;
+  ASSERT_TRUE(encoded_index.Init(&decoder));
+
+  S2ClosestPointQuery<int> query(&index);
+  S2ClosestPointQuery<int, EncodedS2PointIndex<int>> encoded_query(
+      &encoded_index);
+  for (auto* options : {query.mutable_options(),
+                        encoded_query.mutable_options()}) {
+    options->set_max_results(10);
+    options->set_max_distance(S2Testing::KmToAngle(5));
+  }
+  for (int i = 0; i < 100; ++i) {
+    S2ClosestPointQueryPointTarget target(s2random::SamplePoint(bitgen, cap));
+    auto expected = query.FindClosestPoints(&target);
+    auto actual = encoded_query.FindClosestPoints(&target);
+    ASSERT_EQ(actual.size(), expected.size());
+    for (size_t j = 0; j < expected.size(); ++j) {
+      EXPECT_EQ(actual[j].distance(), expected[j].distance());
+      EXPECT_EQ(actual[j].data(), expected[j].data());
+    }
+    // Only the blocks near the query targets should have been decoded.  (The
+    // check is made after a few queries, since all 100 queries together
+    // decode about half of the blocks in the cap.)
+    if (i == 9) EXPECT_LT(encoded_index.SpaceUsed(), index.SpaceUsed() / 4);
+  }
+}
+
+TEST(EncodedS2PointIndex, ConcurrentReaders) {
+  absl::BitGen bitgen;
+  S2PointIndex<int> index;
+  for (int i = 0; i < 10000; ++i) {
+    index.Add(s2random::Point(bitgen), i);
+  }
+  string encoded = Encode(index, CodingHint::COMPACT);
+  Decoder decoder(encoded.data(), encoded.size());
+  EncodedS2PointIndex<int> encoded_index;
+  ASSERT_TRUE(encoded_index.Init(&decoder));
+
+  vector<std::thread> readers;
+  for (int r = 0; r < 4; ++r) {
+    readers.emplace_back([&]() {
+      S2PointIndex<int>::Iterator it(&index);
+      EncodedS2PointIndex<int>::Iterator encoded_it(&encoded_index);
+      for (; !it.done(); it.Next(), encoded_it.Next()) {
+        EXPECT_EQ(encoded_it.point_data(), it.point_data());
+      }
+    });
+  }
+  for (auto& reader : readers) reader.join();
+}
+
+}  // namespace
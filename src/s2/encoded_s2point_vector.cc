@@ -23,6 +23,7 @@
 #include <limits>
 #include <vector>
 
+#include "absl/base/casts.h"
 #include "absl/base/optimization.h"
 #include "absl/log/absl_check.h"
 #include "absl/log/absl_log.h"
@@ -93,11 +94,13 @@ inline void DeinterleaveUint32BitPairs(uint64_t code, uint32_t* val0,
 
 // Forward declarations.
 void EncodeS2PointVectorFast(Span<const S2Point> points, Encoder* encoder);
-void EncodeS2PointVectorCompact(Span<const S2Point> points, Encoder* encoder);
+void EncodeS2PointVectorCompact(Span<const S2Point> points, bool xor_blocks,
+                                Encoder* encoder);
+void EncodeS2PointVectorXorBlocks(Span<const S2Point> points, Encoder* encoder);
 
 // To save space (especially for vectors of length 0, 1, and 2), the encoding
 // format is encoded in the low-order 3 bits of the vector size.  Up to 7
-// encoding formats are supported (only 2 are currently defined).  Additional
+// encoding formats are supported (only 3 are currently defined).  Additional
 // formats could be supported by using "7" as an overflow indicator and
 // encoding the actual format separately, but it seems unlikely we will ever
 // need to do that.
@@ -111,7 +114,10 @@ void EncodeS2PointVector(Span<const S2Point> points, CodingHint hint,
       return EncodeS2PointVectorFast(points, encoder);
 
     case CodingHint::COMPACT:
-      return EncodeS2PointVectorCompact(points, encoder);
+      return EncodeS2PointVectorCompact(points, false, encoder);
+
+    case CodingHint::COMPACT_UNSNAPPED:
+      return EncodeS2PointVectorCompact(points, true, encoder);
 
     default:
       ABSL_LOG(ERROR) << "Unknown CodingHint: " << static_cast<int>(hint);
@@ -131,6 +137,9 @@ bool EncodedS2PointVector::Init(Decoder* decoder) {
     case CELL_IDS:
       return InitCellIdsFormat(decoder);
 
+    case XOR_BLOCKS:
+      return InitXorBlocksFormat(decoder);
+
     default:
       return false;
   }
@@ -188,7 +197,12 @@ void EncodedS2PointVector::Encode(Encoder* encoder) const {
 
     case CELL_IDS: {
       // This is a full decode/encode dance, and not at all efficient.
-      EncodeS2PointVectorCompact(Decode(), encoder);
+      EncodeS2PointVectorCompact(Decode(), false, encoder);
+      break;
+    }
+
+    case XOR_BLOCKS: {
+      EncodeS2PointVectorCompact(Decode(), true, encoder);
       break;
     }
 
@@ -314,8 +328,11 @@ uint64_t ChooseBase(absl::Span<const uint64_t> values, int level,
 BlockCode GetBlockCode(Span<const uint64_t> values, uint64_t base,
                        bool have_exceptions);
 
-// Encodes a vector of points, optimizing for space.
-void EncodeS2PointVectorCompact(Span<const S2Point> points, Encoder* encoder) {
+// Encodes a vector of points, optimizing for space.  If "xor_blocks" is true,
+// points that are not S2CellId centers are encoded using the XOR_BLOCKS
+// format rather than the UNCOMPRESSED format.
+void EncodeS2PointVectorCompact(Span<const S2Point> points, bool xor_blocks,
+                                Encoder* encoder) {
   // OVERVIEW
   // --------
   //
@@ -323,7 +340,9 @@ void EncodeS2PointVectorCompact(Span<const S2Point> points, Encoder* encoder) {
   // S2CellIds must be at the same level.  Any points that cannot be encoded
   // exactly as S2CellId centers are stored as exceptions using 24 bytes each.
   // If there are so many exceptions that the CELL_IDS encoding does not save
-  // significant space, we give up and use the uncompressed encoding.
+  // significant space, we give up and use the uncompressed encoding (or the
+  // XOR_BLOCKS encoding if requested, which itself falls back to the
+  // uncompressed encoding when it does not save any space).
   //
   // The first step is to choose the best S2CellId level.  This requires
   // converting each point to (face, si, ti) coordinates and checking whether
@@ -474,6 +493,7 @@ void EncodeS2PointVectorCompact(Span<const S2Point> points, Encoder* encoder) {
   vector<CellPoint> cell_points;
   int level = ChooseBestLevel(points, &cell_points);
   if (level < 0) {
+    if (xor_blocks) return EncodeS2PointVectorXorBlocks(points, encoder);
     return EncodeS2PointVectorFast(points, encoder);
   }
 
@@ -936,4 +956,175 @@ S2Point EncodedS2PointVector::DecodeCellIdsFormat(int i, S2Error* error) const {
                          S2::STtoUV(S2::SiTitoST(ti))).Normalize();
 }
 
+
+//////////////////////////////////////////////////////////////////////////////
+//                     XOR_BLOCKS Encoding Format
+//////////////////////////////////////////////////////////////////////////////
+
+// Appends the low-order "width" bits of "value" to "bits" starting at the
+// given bit position.  "bits" must be zero-initialized.
+static void PutBits(uint64_t value, int width, uint64_t bit_pos,
+                    vector<uint8_t>* bits) {
+  while (width > 0) {
+    int shift = bit_pos & 7;
+    int n = min(8 - shift, width);
+    (*bits)[bit_pos >> 3] |= (value & BitMask(n)) << shift;
+    value >>= n;
+    bit_pos += n;
+    width -= n;
+  }
+}
+
+// Returns the "width" bits starting at the given bit position of "ptr".  The
+// caller is responsible for checking that these bits are within bounds.
+inline uint64_t GetBits(const char* ptr, uint64_t bit_pos, int width) {
+  if (width == 0) return 0;
+  ptr += bit_pos >> 3;
+  int shift = bit_pos & 7;
+  int bytes = (shift + width + 7) >> 3;  // 1-9 bytes.
+  uint64_t value = GetUintWithLength<uint64_t>(ptr, min(bytes, 8)) >> shift;
+  if (bytes > 8) {
+    value |= uint64_t{static_cast<uint8_t>(ptr[8])} << (64 - shift);
+  }
+  return value & BitMask(width);
+}
+
+// Returns the number of bytes used to encode a coordinate prefix when the
+// low-order "width" bits of each coordinate are stored separately.
+inline int PrefixBytes(int width) { return (64 - width + 7) >> 3; }
+
+// Encodes points that are not S2CellId centers (e.g. raw GPS positions).
+void EncodeS2PointVectorXorBlocks(Span<const S2Point> points,
+                                  Encoder* encoder) {
+  // The XOR_BLOCKS format stores the bit patterns of the point coordinates
+  // (as 64-bit doubles) in blocks of kBlockSize points.  Nearby points have
+  // coordinates with the same sign, exponent, and leading mantissa bits, so
+  // within each block we XOR each coordinate with the corresponding
+  // coordinate of the first point to find the number of trailing bits that
+  // differ ("width").  The shared leading bits ("prefix") are then stored
+  // once per block and each point stores only its trailing "width" bits.
+  // Since every value has a fixed width within its block, any point can be
+  // decoded in constant time.
+  //
+  // The encoding consists of a varint64 in the following format:
+  //
+  //   bits 0-2:  encoding format (XOR_BLOCKS)
+  //   bits 3-63: vector size
+  //
+  // followed by an EncodedStringVector containing the blocks.  Each block
+  // consists of:
+  //
+  //   3 bytes: width of the x, y, and z coordinates (0-64 bits each)
+  //   PrefixBytes(width) bytes for each coordinate: (bits >> width)
+  //   Bit-packed array of (x, y, z) trailing bits for each point in the block
+  //
+  // For example, points within a few hundred meters of each other typically
+  // need about 38 bits per coordinate, which is about 35% smaller than the
+  // UNCOMPRESSED format.  If the result would not be smaller than the
+  // UNCOMPRESSED format then that format is used instead.
+  StringVectorEncoder blocks;
+  vector<uint8_t> bits;
+  for (size_t i = 0; i < points.size(); i += kBlockSize) {
+    int block_size = min(kBlockSize, points.size() - i);
+    int width[3];
+    uint64_t first[3];
+    for (int c = 0; c < 3; ++c) {
+      first[c] = absl::bit_cast<uint64_t>(points[i][c]);
+      uint64_t diff = 0;
+      for (int j = 1; j < block_size; ++j) {
+        diff |= absl::bit_cast<uint64_t>(points[i + j][c]) ^ first[c];
+      }
+      width[c] = 64 - absl::countl_zero(diff);
+    }
+    int point_bits = width[0] + width[1] + width[2];
+    Encoder* block = blocks.AddViaEncoder();
+    block->Ensure(3 + 3 * sizeof(uint64_t) + (block_size * point_bits + 7) / 8);
+    for (int c = 0; c < 3; ++c) block->put8(width[c]);
+    for (int c = 0; c < 3; ++c) {
+      if (width[c] == 64) continue;  // No prefix bits.
+      EncodeUintWithLength(first[c] >> width[c], PrefixBytes(width[c]), block);
+    }
+    bits.assign((block_size * point_bits + 7) >> 3, 0);
+    uint64_t bit_pos = 0;
+    for (int j = 0; j < block_size; ++j) {
+      for (int c = 0; c < 3; ++c) {
+        PutBits(absl::bit_cast<uint64_t>(points[i + j][c]), width[c], bit_pos,
+                &bits);
+        bit_pos += width[c];
+      }
+    }
+    block->putn(bits.data(), bits.size());
+  }
+  Encoder xor_encoder;
+  xor_encoder.Ensure(Varint::kMax64);
+  xor_encoder.put_varint64(points.size() << kEncodingFormatBits |
+                           EncodedS2PointVector::XOR_BLOCKS);
+  blocks.Encode(&xor_encoder);
+  if (xor_encoder.length() >=
+      Varint::Length64(points.size() << kEncodingFormatBits) +
+          points.size() * sizeof(S2Point)) {
+    return EncodeS2PointVectorFast(points, encoder);
+  }
+  encoder->Ensure(xor_encoder.length());
+  encoder->putn(xor_encoder.base(), xor_encoder.length());
+}
+
+bool EncodedS2PointVector::InitXorBlocksFormat(Decoder* decoder) {
+  uint64_t size;
+  if (!decoder->get_varint64(&size)) return false;
+  size >>= kEncodingFormatBits;
+
+  // See the comment in InitUncompressedFormat.
+  if (size > std::numeric_limits<int32_t>::max()) return false;
+  size_ = size;
+
+  if (!xor_blocks_.blocks.Init(decoder)) return false;
+  return xor_blocks_.blocks.size() == (size_ + kBlockSize - 1) >> kBlockShift;
+}
+
+S2Point EncodedS2PointVector::DecodeXorBlocksFormat(int i,
+                                                    S2Error* error) const {
+  // This function inverts the encoding documented above.
+  const auto Error = [error](absl::string_view message) {
+    if (error != nullptr) {
+      *error = S2Error::DataLoss(message);
+    }
+    return S2Point();
+  };
+
+  const absl::string_view block = xor_blocks_.blocks[i >> kBlockShift];
+  if (block.size() < 3) {
+    return Error("Invalid block header");
+  }
+  const char* ptr = block.data();
+  int width[3], point_bits = 0, prefix_bytes = 0;
+  for (int c = 0; c < 3; ++c) {
+    width[c] = static_cast<uint8_t>(ptr[c]);
+    if (width[c] > 64) {
+      return Error("Invalid coordinate width");
+    }
+    point_bits += width[c];
+    prefix_bytes += PrefixBytes(width[c]);
+  }
+  int block_size = min<size_t>(kBlockSize, size_ - (i & ~(kBlockSize - 1)));
+  if (3 + prefix_bytes + ((block_size * point_bits + 7) >> 3) > block.size()) {
+    return Error("Invalid block size");
+  }
+  ptr += 3;
+  const char* residuals = ptr + prefix_bytes;
+  uint64_t bit_pos = (i & (kBlockSize - 1)) * point_bits;
+  S2Point point;
+  for (int c = 0; c < 3; ++c) {
+    uint64_t value = GetBits(residuals, bit_pos, width[c]);
+    bit_pos += width[c];
+    if (width[c] < 64) {
+      int bytes = PrefixBytes(width[c]);
+      value |= GetUintWithLength<uint64_t>(ptr, bytes) << width[c];
+      ptr += bytes;
+    }
+    point[c] = absl::bit_cast<double>(value);
+  }
+  return point;
+}
+
 }  // namespace s2coding
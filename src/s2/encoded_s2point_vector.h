@@ -110,7 +110,9 @@ class EncodedS2PointVector {
   friend void EncodeS2PointVector(absl::Span<const S2Point>, CodingHint,
                                   Encoder*);
   friend void EncodeS2PointVectorFast(absl::Span<const S2Point>, Encoder*);
-  friend void EncodeS2PointVectorCompact(absl::Span<const S2Point>, Encoder*);
+  friend void EncodeS2PointVectorCompact(absl::Span<const S2Point>, bool,
+                                         Encoder*);
+  friend void EncodeS2PointVectorXorBlocks(absl::Span<const S2Point>, Encoder*);
 
   // Decodes and returns the point at the given index.  If any errors occur when
   // decoding, the error is set and a default constructed point returned.
@@ -119,6 +121,8 @@ class EncodedS2PointVector {
   bool InitUncompressedFormat(Decoder* decoder);
   bool InitCellIdsFormat(Decoder* decoder);
   S2Point DecodeCellIdsFormat(int i, S2Error* error) const;
+  bool InitXorBlocksFormat(Decoder* decoder);
+  S2Point DecodeXorBlocksFormat(int i, S2Error* error) const;
 
   // We use a tagged union to represent multiple formats, as opposed to an
   // abstract base class or templating.  This represents the best compromise
@@ -132,6 +136,7 @@ class EncodedS2PointVector {
   enum Format : uint8_t {
     UNCOMPRESSED = 0,
     CELL_IDS = 1,
+    XOR_BLOCKS = 2,
   };
   Format format_;
   uint32_t size_;
@@ -149,6 +154,9 @@ class EncodedS2PointVector {
       // a thread-safe way.  This reduces benchmark times for actual polygon
       // operations (e.g. S2ClosestEdgeQuery) by about 15%.
     } cell_ids_;
+    struct {
+      EncodedStringVector blocks;
+    } xor_blocks_;
   };
 };
 
@@ -168,6 +176,9 @@ inline S2Point EncodedS2PointVector::At(int i, S2Error& error) const {
     case Format::CELL_IDS:
       return DecodeCellIdsFormat(i, &error);
 
+    case Format::XOR_BLOCKS:
+      return DecodeXorBlocksFormat(i, &error);
+
     default:
       error = S2Error::DataLoss("Unrecognized format");
       return {};
@@ -193,6 +204,9 @@ inline S2Point EncodedS2PointVector::operator[](int i) const {
     case Format::CELL_IDS:
       return DecodeCellIdsFormat(i, nullptr);
 
+    case Format::XOR_BLOCKS:
+      return DecodeXorBlocksFormat(i, nullptr);
+
     default:
       return {};
   }
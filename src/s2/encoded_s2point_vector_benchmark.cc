@@ -0,0 +1,118 @@
+// Copyright 2024 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "s2/encoded_s2point_vector.h"
+
+#include <cstddef>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+#include "absl/log/absl_check.h"
+#include "s2/util/coding/coder.h"
+#include "s2/s1angle.h"
+#include "s2/s2cap.h"
+#include "s2/s2cell_id.h"
+#include "s2/s2coder.h"
+#include "s2/s2point.h"
+#include "s2/s2random.h"
+
+using s2coding::CodingHint;
+using std::string;
+using std::vector;
+
+namespace {
+
+constexpr int kNumIndices = 4096;
+
+// Returns a random walk of "n" unsnapped points with 20 meter steps, similar
+// to a GPS trace.
+vector<S2Point> MakeTrace(std::mt19937_64& bitgen, int n) {
+  const S1Angle step = S1Angle::Radians(20 / 6371010.0);
+  vector<S2Point> points;
+  S2Point p = s2random::Point(bitgen);
+  for (int i = 0; i < n; ++i) {
+    points.push_back(p);
+    p = s2random::SamplePoint(bitgen, S2Cap(p, step));
+  }
+  return points;
+}
+
+string EncodePoints(const vector<S2Point>& points, CodingHint hint) {
+  Encoder encoder;
+  s2coding::EncodeS2PointVector(points, hint, &encoder);
+  return string(encoder.base(), encoder.length());
+}
+
+// Measures random access to a trace of state.range(0) points encoded using
+// the given hint.  Unsnapped traces use the XOR_BLOCKS format with
+// COMPACT_UNSNAPPED and the UNCOMPRESSED format otherwise, while traces
+// snapped to leaf cell centers use the CELL_IDS format.
+void BM_EncodedS2PointVectorRandomAccess(benchmark::State& state,
+                                         CodingHint hint, bool snap) {
+  std::mt19937_64 bitgen(1);
+  const int n = state.range(0);
+  vector<S2Point> trace = MakeTrace(bitgen, n);
+  if (snap) {
+    for (S2Point& p : trace) p = S2CellId(p).ToPoint();
+  }
+  const string encoded = EncodePoints(trace, hint);
+  Decoder decoder(encoded.data(), encoded.size());
+  s2coding::EncodedS2PointVector points;
+  ABSL_CHECK(points.Init(&decoder));
+  vector<int> indices;
+  for (int i = 0; i < kNumIndices; ++i) {
+    indices.push_back(std::uniform_int_distribution<int>(0, n - 1)(bitgen));
+  }
+  size_t i = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(points[indices[i++ % kNumIndices]]);
+  }
+  state.counters["bytes_per_point"] = static_cast<double>(encoded.size()) / n;
+}
+BENCHMARK_CAPTURE(BM_EncodedS2PointVectorRandomAccess, Fast, CodingHint::FAST,
+                  false)
+    ->Range(16, 1 << 16);
+BENCHMARK_CAPTURE(BM_EncodedS2PointVectorRandomAccess, Compact,
+                  CodingHint::COMPACT, false)
+    ->Range(16, 1 << 16);
+BENCHMARK_CAPTURE(BM_EncodedS2PointVectorRandomAccess, CompactUnsnapped,
+                  CodingHint::COMPACT_UNSNAPPED, false)
+    ->Range(16, 1 << 16);
+BENCHMARK_CAPTURE(BM_EncodedS2PointVectorRandomAccess, CompactSnapped,
+                  CodingHint::COMPACT, true)
+    ->Range(16, 1 << 16);
+
+// Measures the time to encode a trace of state.range(0) points.
+void BM_EncodeS2PointVector(benchmark::State& state, CodingHint hint) {
+  std::mt19937_64 bitgen(1);
+  const vector<S2Point> points = MakeTrace(bitgen, state.range(0));
+  for (auto _ : state) {
+    Encoder encoder;
+    s2coding::EncodeS2PointVector(points, hint, &encoder);
+    benchmark::DoNotOptimize(encoder.length());
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK_CAPTURE(BM_EncodeS2PointVector, Fast, CodingHint::FAST)
+    ->Range(16, 1 << 16);
+BENCHMARK_CAPTURE(BM_EncodeS2PointVector, Compact, CodingHint::COMPACT)
+    ->Range(16, 1 << 16);
+BENCHMARK_CAPTURE(BM_EncodeS2PointVector, CompactUnsnapped,
+                  CodingHint::COMPACT_UNSNAPPED)
+    ->Range(16, 1 << 16);
+
+}  // namespace
@@ -18,6 +18,7 @@
 #include "s2/encoded_s2point_vector.h"
 
 #include <atomic>
+#include <cmath>
 #include <cstddef>
 #include <cstdint>
 #include <vector>
@@ -26,14 +27,18 @@
 
 #include "absl/log/absl_check.h"
 #include "absl/log/log_streamer.h"
+#include "absl/random/bit_gen_ref.h"
 #include "absl/random/random.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/str_format.h"
+#include "absl/strings/string_view.h"
 
 #include "s2/base/log_severity.h"
 #include "s2/base/types.h"
 #include "s2/util/bits/bit-interleave.h"
 #include "s2/util/coding/coder.h"
+#include "s2/s1angle.h"
+#include "s2/s2cap.h"
 #include "s2/s2cell_id.h"
 #include "s2/s2coder.h"
 #include "s2/s2coords.h"
@@ -421,6 +426,76 @@ TEST(EncodedS2PointVectorTest, SnappedFractalLoops) {
   }
 }
 
+// Returns a random walk of "n" unsnapped points with steps of up to "step",
+// similar to a GPS trace.
+vector<S2Point> MakeRandomWalk(absl::BitGenRef bitgen, int n, S1Angle step) {
+  vector<S2Point> points;
+  S2Point p = s2random::Point(bitgen);
+  for (int i = 0; i < n; ++i) {
+    points.push_back(p);
+    p = s2random::SamplePoint(bitgen, S2Cap(p, step));
+  }
+  return points;
+}
+
+TEST(EncodedS2PointVectorTest, UnsnappedPointsUseXorBlocks) {
+  absl::BitGen bitgen(S2Testing::MakeTaggedSeedSeq(
+      "UNSNAPPED_POINTS_USE_XOR_BLOCKS",
+      absl::LogInfoStreamer(__FILE__, __LINE__).stream()));
+  for (int n : {2, 15, 16, 17, 100, 1000}) {
+    vector<S2Point> points =
+        MakeRandomWalk(bitgen, n, S2Testing::MetersToAngle(20));
+    size_t fast_size = TestEncodedS2PointVector(points, CodingHint::FAST, -1);
+
+    // COMPACT still uses the UNCOMPRESSED format for unsnapped points, so
+    // that its output can be read by older versions of the library.
+    EXPECT_EQ(TestEncodedS2PointVector(points, CodingHint::COMPACT, -1),
+              fast_size);
+    size_t xor_size =
+        TestEncodedS2PointVector(points, CodingHint::COMPACT_UNSNAPPED, -1);
+    EXPECT_LE(xor_size, fast_size);
+    // The savings for a single block depend on where the walk starts, so
+    // only check the ratio once the overhead is amortized over many blocks.
+    if (n >= 4 * kBlockSize) {
+      EXPECT_LT(xor_size, 0.75 * fast_size) << n;
+    }
+  }
+}
+
+TEST(EncodedS2PointVectorTest, XorBlocksRandomAccess) {
+  absl::BitGen bitgen(S2Testing::MakeTaggedSeedSeq(
+      "XOR_BLOCKS_RANDOM_ACCESS",
+      absl::LogInfoStreamer(__FILE__, __LINE__).stream()));
+  // Include points whose coordinates differ in sign and exponent, and some
+  // duplicate points (where the coordinate width is zero).
+  vector<S2Point> points =
+      MakeRandomWalk(bitgen, 300, S2Testing::MetersToAngle(100));
+  points.insert(points.end(), kBlockSize, points.back());
+  for (int i = 0; i < 40; ++i) points.push_back(s2random::Point(bitgen));
+  points.push_back(S2Point(-0.0, 0.0, 1.0));
+  Encoder encoder;
+  EncodeS2PointVector(points, CodingHint::COMPACT_UNSNAPPED, &encoder);
+  Decoder decoder(encoder.base(), encoder.length());
+  EncodedS2PointVector actual;
+  ASSERT_TRUE(actual.Init(&decoder));
+  ASSERT_EQ(actual.size(), points.size());
+  for (int iter = 0; iter < 1000; ++iter) {
+    int i = absl::Uniform<int>(bitgen, 0, points.size());
+    ASSERT_EQ(actual[i], points[i]) << i;
+  }
+  EXPECT_TRUE(std::signbit(actual[points.size() - 1].x()));
+
+  // Re-encoding yields the same bytes.
+  Encoder reencoded;
+  actual.Encode(&reencoded);
+  EXPECT_EQ(absl::string_view(reencoded.base(), reencoded.length()),
+            absl::string_view(encoder.base(), encoder.length()));
+
+  // Truncated encodings are detected.
+  Decoder truncated(encoder.base(), encoder.length() - 1);
+  EXPECT_FALSE(actual.Init(&truncated));
+}
+
 void TestRoundtripEncoding(s2coding::CodingHint hint) {
   // Ensures that the EncodedS2PointVector can be encoded and decoded without
   // loss.
@@ -462,4 +537,8 @@ TEST(EncodedS2PointVectorTest, RoundtripEncodingCompact) {
   TestRoundtripEncoding(s2coding::CodingHint::COMPACT);
 }
 
+TEST(EncodedS2PointVectorTest, RoundtripEncodingCompactUnsnapped) {
+  TestRoundtripEncoding(s2coding::CodingHint::COMPACT_UNSNAPPED);
+}
+
 }  // namespace s2coding
@@ -17,26 +17,36 @@
 
 #include "s2/encoded_s2shape_index.h"
 
+#include <algorithm>
 #include <atomic>
 #include <cstddef>
 #include <cstdint>
 #include <memory>
+#include <memory_resource>
+#include <new>
+#include <utility>
 #include <vector>
 
 #include "s2/base/casts.h"
 #include "absl/base/optimization.h"
 #include "absl/numeric/bits.h"
+#include "absl/strings/string_view.h"
 #include "s2/util/coding/coder.h"
 #include "s2/util/coding/varint.h"
 #include "s2/encoded_s2cell_id_vector.h"
 #include "s2/encoded_string_vector.h"
+#include "s2/internal/s2parallel.h"
 #include "s2/mutable_s2shape_index.h"
 #include "s2/s2cell_id.h"
+#include "s2/s2cell_union.h"
 #include "s2/s2point.h"
 #include "s2/s2shape.h"
 #include "s2/s2shape_index.h"
+#include "s2/s2shape_metadata.h"
+#include "s2/s2space_usage.h"
 
-using std::make_unique;
+using std::pair;
+using std::shared_ptr;
 using std::unique_ptr;
 using std::vector;
 
@@ -46,11 +56,95 @@ S2Shape* EncodedS2ShapeIndex::GetShape(int id) const {
   S2Shape* expected = kUndecodedShape();
   if (shapes_[id].compare_exchange_strong(expected, shape.get(),
                                           std::memory_order_acq_rel)) {
+    if (max_decoded_shapes_ >= 0 && shape != nullptr) AddDecodedShape(id);
     return shape.release();  // Ownership has been transferred to shapes_.
   }
   return expected;  // Another thread updated shapes_[id] first.
 }
 
+void EncodedS2ShapeIndex::AddDecodedShape(int id) const {
+  // The new shape is marked as referenced so that it is not evicted before
+  // the caller has had a chance to use it.
+  shape_referenced_[id].store(1, std::memory_order_relaxed);
+  SpinLockHolder l(&shapes_lock_);
+  decoded_shape_ids_.push_back(id);
+  while (decoded_shape_ids_.size() > static_cast<size_t>(max_decoded_shapes_)) {
+    if (clock_hand_ >= static_cast<int>(decoded_shape_ids_.size())) {
+      clock_hand_ = 0;
+    }
+    int victim = decoded_shape_ids_[clock_hand_];
+    if (shape_referenced_[victim].exchange(0, std::memory_order_relaxed)) {
+      ++clock_hand_;  // Give the shape a second chance.
+      continue;
+    }
+    // Only shapes in decoded_shape_ids_ are evicted, and a shape is added to
+    // it only after it has been stored in shapes_, so this exchange always
+    // returns a decoded shape.
+    evicted_shapes_.push_back(
+        shapes_[victim].exchange(kUndecodedShape(), std::memory_order_acq_rel));
+    decoded_shape_ids_[clock_hand_] = decoded_shape_ids_.back();
+    decoded_shape_ids_.pop_back();
+  }
+  if (reclaim_evicted_ && !evicted_shapes_.empty()) ReclaimEvictedShapes();
+}
+
+// Deletes the shapes evicted during the previous epoch and advances the epoch,
+// provided that no ReaderScope created before the current epoch remains.
+//
+// A ReaderScope can only be using a shape if it loaded the shape pointer
+// before the shape was evicted.  The scope increments its reader count and
+// then executes a fence before loading any shape pointers, and this method
+// executes a fence after evicting shapes and before checking the counts.
+// Therefore either the reader saw kUndecodedShape() (and decoded a new copy)
+// or this method sees the reader.  The epoch that the scope used to choose
+// its counter is no later than the epoch in which the shape was evicted (call
+// it E), so the scope blocks either the advance from E to E + 1 or the advance
+// from E + 1 to E + 2, and the shape is deleted only by the latter.
+//
+// REQUIRES: shapes_lock_ is held
+void EncodedS2ShapeIndex::ReclaimEvictedShapes() const {
+  ABSL_DCHECK(shapes_lock_.IsHeld());
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  uint32_t epoch = reader_epoch_.load(std::memory_order_relaxed);
+  if (num_readers_[(epoch + 1) & 1].load(std::memory_order_acquire) != 0) {
+    return;  // Some readers from the previous epoch are still active.
+  }
+  for (S2Shape* shape : previous_evicted_shapes_) delete shape;
+  previous_evicted_shapes_.clear();
+  previous_evicted_shapes_.swap(evicted_shapes_);
+  reader_epoch_.store(epoch + 1, std::memory_order_relaxed);
+}
+
+void EncodedS2ShapeIndex::set_max_decoded_shapes(int max_decoded_shapes) {
+  max_decoded_shapes_ = max_decoded_shapes;
+  if (max_decoded_shapes_ < 0) return;
+  shape_referenced_ = vector<std::atomic<uint8_t>>(shapes_.size());
+
+  // Shapes that were decoded before the limit was set become eviction
+  // candidates.
+  decoded_shape_ids_.clear();
+  clock_hand_ = 0;
+  for (int id = 0; id < num_shape_ids(); ++id) {
+    S2Shape* shape = shapes_[id].load(std::memory_order_relaxed);
+    if (shape != kUndecodedShape() && shape != nullptr) {
+      decoded_shape_ids_.push_back(id);
+    }
+  }
+  while (decoded_shape_ids_.size() > static_cast<size_t>(max_decoded_shapes_)) {
+    int id = decoded_shape_ids_.back();
+    decoded_shape_ids_.pop_back();
+    evicted_shapes_.push_back(
+        shapes_[id].exchange(kUndecodedShape(), std::memory_order_relaxed));
+  }
+}
+
+void EncodedS2ShapeIndex::ReleaseEvictedShapes() {
+  for (S2Shape* shape : evicted_shapes_) delete shape;
+  evicted_shapes_.clear();
+  for (S2Shape* shape : previous_evicted_shapes_) delete shape;
+  previous_evicted_shapes_.clear();
+}
+
 const S2ShapeIndexCell* EncodedS2ShapeIndex::GetCell(int i) const {
   // memory_order_release ensures that no reads or writes in the current
   // thread can be reordered after this store, and all writes in the current
@@ -70,27 +164,205 @@ const S2ShapeIndexCell* EncodedS2ShapeIndex::GetCell(int i) const {
   //
   // Note that we do still use a lock for the write path to ensure that
   // cells_[i] and cell_decoded(i) are updated together atomically.
-  if (cell_decoded(i)) return cells_[i];
+  //
+  // Once the index is frozen all cells are decoded and cells_ is no longer
+  // modified, so no synchronization is needed at all.
+  if (frozen_ || cell_decoded(i)) return cells_[i];
 
+  if (cell_data_loader_ && !cell_data_loader_(encoded_cells_[i])) {
+    return nullptr;
+  }
   // Decode the cell before acquiring the spinlock in order to minimize the
   // time that the lock is held.
-  auto cell = make_unique<S2ShapeIndexCell>();
+  S2ShapeIndexCell* cell = NewCell();
   Decoder decoder = encoded_cells_.GetDecoder(i);
   if (!cell->Decode(num_shape_ids(), &decoder)) {
+    DeleteCell(cell);
     return nullptr;
   }
   // Recheck cell_decoded(i) once we hold the lock in case another thread
   // has decoded this cell in the meantime.
-  SpinLockHolder l(&cells_lock_);
-  if (cell_decoded(i)) return cells_[i];
+  {
+    SpinLockHolder l(&cells_lock_);
+    if (!cell_decoded(i)) {
+      // Update the cell, setting cells_[i] before cell_decoded(i).
+      cells_[i] = cell;
+      set_cell_decoded(i);
+      if (cell_cache_.size() < static_cast<size_t>(max_cell_cache_size())) {
+        cell_cache_.push_back(i);
+      }
+      return cell;  // Ownership has been transferred to cells_.
+    }
+  }
+  DeleteCell(cell);
+  return cells_[i];
+}
 
-  // Update the cell, setting cells_[i] before cell_decoded(i).
-  cells_[i] = cell.get();
-  set_cell_decoded(i);
-  if (cell_cache_.size() < static_cast<size_t>(max_cell_cache_size())) {
-    cell_cache_.push_back(i);
+S2ShapeIndexCell* EncodedS2ShapeIndex::NewCell() const {
+  if (memory_resource_ == nullptr) return new S2ShapeIndexCell;
+  return new (memory_resource_->allocate(sizeof(S2ShapeIndexCell),
+                                         alignof(S2ShapeIndexCell)))
+      S2ShapeIndexCell;
+}
+
+void EncodedS2ShapeIndex::DeleteCell(S2ShapeIndexCell* cell) const {
+  if (memory_resource_ == nullptr) {
+    delete cell;
+  } else {
+    cell->~S2ShapeIndexCell();
+    memory_resource_->deallocate(cell, sizeof(S2ShapeIndexCell),
+                                 alignof(S2ShapeIndexCell));
+  }
+}
+
+void EncodedS2ShapeIndex::set_memory_resource(
+    std::pmr::memory_resource* resource) {
+  Minimize();
+  memory_resource_ = resource;
+}
+
+void EncodedS2ShapeIndex::DecodeCellRanges(const vector<pair<int, int>>& ranges,
+                                           bool all_shapes,
+                                           int num_threads) const {
+  // Split the ranges into tasks of at most kMaxTaskCells cells so that the
+  // work is balanced across threads.
+  constexpr int kMaxTaskCells = 256;
+  vector<pair<int, int>> tasks;
+  for (const auto& [begin, end] : ranges) {
+    for (int i = begin; i < end; i += kMaxTaskCells) {
+      tasks.emplace_back(i, std::min(end, i + kMaxTaskCells));
+    }
+  }
+  // Each task records the shapes referenced by its cells in its own vector.
+  vector<vector<int>> task_shape_ids(all_shapes ? 0 : tasks.size());
+  s2internal::ParallelFor(num_threads, tasks.size(), [&](int t) {
+    for (int i = tasks[t].first; i < tasks[t].second; ++i) {
+      const S2ShapeIndexCell* cell = GetCell(i);
+      if (cell == nullptr || all_shapes) continue;
+      for (const S2ClippedShape& clipped : cell->clipped_shapes()) {
+        task_shape_ids[t].push_back(clipped.shape_id());
+      }
+    }
+  });
+
+  vector<int> shape_ids;
+  if (all_shapes) {
+    shape_ids.resize(num_shape_ids());
+    for (int i = 0; i < num_shape_ids(); ++i) shape_ids[i] = i;
+  } else {
+    for (const auto& ids : task_shape_ids) {
+      shape_ids.insert(shape_ids.end(), ids.begin(), ids.end());
+    }
+    std::sort(shape_ids.begin(), shape_ids.end());
+    shape_ids.erase(std::unique(shape_ids.begin(), shape_ids.end()),
+                    shape_ids.end());
   }
-  return cell.release();  // Ownership has been transferred to cells_.
+  s2internal::ParallelFor(num_threads, shape_ids.size(),
+                          [&](int i) { shape(shape_ids[i]); });
+}
+
+void EncodedS2ShapeIndex::Prefetch(const S2CellUnion& region,
+                                   int num_threads) const {
+  DecodeCellRanges(cell_ids_.GetIntersectingRanges(region.cell_ids()),
+                   false /*all_shapes*/, num_threads);
+}
+
+void EncodedS2ShapeIndex::DecodeAll(int num_threads) const {
+  DecodeCellRanges({{0, static_cast<int>(cell_ids_.size())}},
+                   true /*all_shapes*/, num_threads);
+}
+
+namespace {
+
+// A ShapeFactory that returns only the shapes marked in "wanted".
+class SubsetShapeFactory final : public S2ShapeIndex::ShapeFactory {
+ public:
+  SubsetShapeFactory(const S2ShapeIndex::ShapeFactory& factory,
+                     const vector<bool>& wanted)
+      : factory_(factory), wanted_(wanted) {}
+
+  int size() const override { return wanted_.size(); }
+
+  unique_ptr<S2Shape> operator[](int shape_id) const override {
+    return wanted_[shape_id] ? factory_[shape_id] : nullptr;
+  }
+
+  unique_ptr<ShapeFactory> Clone() const override {
+    return std::make_unique<SubsetShapeFactory>(*this);
+  }
+
+ private:
+  const S2ShapeIndex::ShapeFactory& factory_;
+  const vector<bool>& wanted_;
+};
+
+}  // namespace
+
+unique_ptr<MutableS2ShapeIndex> EncodedS2ShapeIndex::DecodeRegion(
+    const S2CellUnion& region, const ShapeFactory& shape_factory) const {
+  // Build an encoding of the cells that intersect "region".  The encoded
+  // cells are copied verbatim, and are decoded into temporary cells only to
+  // find the shapes that they refer to (so that they are not cached here).
+  vector<S2CellId> cell_ids;
+  s2coding::StringVectorEncoder encoded_cells;
+  vector<bool> wanted(num_shape_ids());
+  vector<absl::string_view> range_data;
+  for (const auto& [begin, end] :
+       cell_ids_.GetIntersectingRanges(region.cell_ids())) {
+    // The encoded cells of each range are contiguous, so their offsets can be
+    // decoded together.
+    range_data.resize(end - begin);
+    encoded_cells_.Decode(begin, end, range_data.data());
+    for (int i = begin; i < end; ++i) {
+      absl::string_view data = range_data[i - begin];
+      S2ShapeIndexCell cell;
+      Decoder decoder(data.data(), data.size());
+      if (!cell.Decode(num_shape_ids(), &decoder)) return nullptr;
+      for (const S2ClippedShape& clipped : cell.clipped_shapes()) {
+        wanted[clipped.shape_id()] = true;
+      }
+      cell_ids.push_back(cell_ids_[i]);
+      Encoder* cell_encoder = encoded_cells.AddViaEncoder();
+      cell_encoder->Ensure(data.size());
+      cell_encoder->putn(data.data(), data.size());
+    }
+  }
+  Encoder encoder;
+  encoder.Ensure(Varint::kMax64);
+  uint64_t max_edges = options_.max_edges_per_cell();
+  encoder.put_varint64(max_edges << 2 | version_);
+  s2coding::EncodeS2CellIdVector(cell_ids, &encoder);
+  encoded_cells.Encode(&encoder);
+  if (has_shape_metadata()) {
+    // Shapes that are not included have no metadata.
+    s2coding::StringVectorEncoder encoded_metadata;
+    for (int id = 0; id < num_shape_ids(); ++id) {
+      Encoder* metadata_encoder = encoded_metadata.AddViaEncoder();
+      if (!wanted[id]) continue;
+      absl::string_view data = shape_metadata_[id];
+      metadata_encoder->Ensure(data.size());
+      metadata_encoder->putn(data.data(), data.size());
+    }
+    encoded_metadata.Encode(&encoder);
+  }
+
+  auto index = std::make_unique<MutableS2ShapeIndex>();
+  Decoder decoder(encoder.base(), encoder.length());
+  if (!index->Init(&decoder, SubsetShapeFactory(shape_factory, wanted))) {
+    return nullptr;
+  }
+  return index;
+}
+
+void EncodedS2ShapeIndex::Freeze(int num_threads) {
+  if (cells_ == nullptr) return;  // Not initialized yet.
+  DecodeAll(num_threads);
+  // Cells that fail to decode are not marked as decoded, in which case
+  // GetCell() must keep trying (and failing) to decode them.
+  for (size_t i = 0; i < cell_ids_.size(); ++i) {
+    if (!cell_decoded(i)) return;
+  }
+  frozen_ = true;
 }
 
 EncodedS2ShapeIndex::EncodedS2ShapeIndex() = default;
@@ -104,19 +376,35 @@ EncodedS2ShapeIndex::~EncodedS2ShapeIndex() {
 
 bool EncodedS2ShapeIndex::Init(Decoder* decoder,
                                const ShapeFactory& shape_factory) {
+  return Init(decoder, shape_factory, nullptr);
+}
+
+bool EncodedS2ShapeIndex::Init(Decoder* decoder,
+                               const ShapeFactory& shape_factory,
+                               shared_ptr<const void> data_owner) {
+  // Shapes and cells decoded from the previous buffer (and the factory that
+  // produced them) must be released before the buffer itself.
   Minimize();
+  shape_factory_.reset();
+  data_owner_ = std::move(data_owner);
+
   uint64_t max_edges_version;
   if (!decoder->get_varint64(&max_edges_version)) return false;
   version_ = max_edges_version & 3;
-  if (version_ != MutableS2ShapeIndex::kCurrentEncodingVersionNumber) {
+  if (version_ != MutableS2ShapeIndex::kCurrentEncodingVersionNumber &&
+      version_ != MutableS2ShapeIndex::kShapeMetadataEncodingVersionNumber) {
     return false;
   }
   options_.set_max_edges_per_cell(max_edges_version >> 2);
+  options_.set_cache_shape_metadata(has_shape_metadata());
 
   // AtomicShape is a subtype of std::atomic<S2Shape*> that changes the
   // default constructor value to kUndecodedShape().  This saves the effort of
   // initializing all the elements twice.
   shapes_ = vector<AtomicShape>(shape_factory.size());
+  if (max_decoded_shapes_ >= 0) {
+    shape_referenced_ = vector<std::atomic<uint8_t>>(shapes_.size());
+  }
   shape_factory_ = shape_factory.Clone();
   if (!cell_ids_.Init(decoder)) return false;
 
@@ -139,9 +427,18 @@ bool EncodedS2ShapeIndex::Init(Decoder* decoder,
   // ^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^
   //                                NO NO NO
   cells_.reset(new S2ShapeIndexCell*[cell_ids_.size()]);
-  cells_decoded_ = vector<std::atomic<uint64_t>>((cell_ids_.size() + 63) >> 6);
+  decoded_group_stride_ = pad_decoded_cell_flags_
+                              ? ABSL_CACHELINE_SIZE / sizeof(uint64_t)
+                              : 1;
+  cells_decoded_ = vector<std::atomic<uint64_t>>(
+      ((cell_ids_.size() + 63) >> 6) * decoded_group_stride_);
 
-  return encoded_cells_.Init(decoder);
+  if (!encoded_cells_.Init(decoder)) return false;
+  if (has_shape_metadata()) {
+    if (!shape_metadata_.Init(decoder)) return false;
+    if (shape_metadata_.size() != shapes_.size()) return false;
+  }
+  return true;
 }
 
 void EncodedS2ShapeIndex::Encode(Encoder* encoder) const {
@@ -153,9 +450,22 @@ void EncodedS2ShapeIndex::Encode(Encoder* encoder) const {
   // And copy the encoded cell ids and cells.
   cell_ids_.Encode(encoder);
   encoded_cells_.Encode(encoder);
+  if (has_shape_metadata()) shape_metadata_.Encode(encoder);
+}
+
+bool EncodedS2ShapeIndex::GetShapeMetadata(int id,
+                                           S2ShapeMetadata* metadata) const {
+  if (!has_shape_metadata()) return false;
+  Decoder decoder = shape_metadata_.GetDecoder(id);
+  // Removed shapes have empty encodings.
+  return decoder.avail() > 0 && metadata->Decode(&decoder);
 }
 
 void EncodedS2ShapeIndex::Minimize() {
+  ReleaseEvictedShapes();
+  decoded_shape_ids_.clear();
+  clock_hand_ = 0;
+  frozen_ = false;
   if (cells_ == nullptr) return;  // Not initialized yet.
 
   for (auto& atomic_shape : shapes_) {
@@ -171,18 +481,20 @@ void EncodedS2ShapeIndex::Minimize() {
     // cells_decoded_ vector.  (The cost is only about 1 cycle per 64 cells,
     // but for a huge polygon with 1 million cells that's still 16000 cycles.)
     for (int pos : cell_cache_) {
-      cells_decoded_[pos >> 6].store(0, std::memory_order_relaxed);
-      delete cells_[pos];
+      decoded_group(pos).store(0, std::memory_order_relaxed);
+      DeleteCell(cells_[pos]);
     }
   } else {
     // Scan the cells_decoded_ vector looking for cells that must be deleted.
+    // (When the flags are padded, the unused words are always zero.)
     for (int i = cells_decoded_.size(); --i >= 0;) {
       uint64_t bits = cells_decoded_[i].load(std::memory_order_relaxed);
       if (bits == 0) continue;
+      int group = i / decoded_group_stride_;
       do {
         ABSL_ASSUME(bits != 0);
         int offset = absl::countr_zero(bits);
-        delete cells_[(i << 6) + offset];
+        DeleteCell(cells_[(group << 6) + offset]);
         bits &= bits - 1;
       } while (bits != 0);
       cells_decoded_[i].store(0, std::memory_order_relaxed);
@@ -192,12 +504,25 @@ void EncodedS2ShapeIndex::Minimize() {
 }
 
 size_t EncodedS2ShapeIndex::SpaceUsed() const {
+  S2SpaceUsage usage;
+  GetSpaceUsage(&usage);
+  return usage.total_bytes();
+}
+
+void EncodedS2ShapeIndex::GetSpaceUsage(S2SpaceUsage* usage) const {
   // TODO(ericv): Add SpaceUsed() method to S2Shape base class,and include
   // memory owned by the allocated S2Shapes (here and in S2ShapeIndex).
-  size_t size = sizeof(*this);
-  size += shapes_.capacity() * sizeof(std::atomic<S2Shape*>);
-  size += cell_ids_.size() * sizeof(std::atomic<S2ShapeIndexCell*>);  // cells_
-  size += cells_decoded_.capacity() * sizeof(std::atomic<uint64_t>);
-  size += cell_cache_.capacity() * sizeof(int);
-  return size;
+  usage->Add("object", sizeof(*this));
+  usage->Add("shapes", shapes_.capacity() * sizeof(std::atomic<S2Shape*>));
+  usage->Add("cells",
+             cell_ids_.size() * sizeof(std::atomic<S2ShapeIndexCell*>));
+  usage->Add("cell_cache",
+             cells_decoded_.capacity() * sizeof(std::atomic<uint64_t>) +
+                 cell_cache_.capacity() * sizeof(int));
+  usage->Add("decoded_shapes",
+             shape_referenced_.capacity() * sizeof(std::atomic<uint8_t>) +
+                 decoded_shape_ids_.capacity() * sizeof(int) +
+                 (evicted_shapes_.capacity() +
+                  previous_evicted_shapes_.capacity()) *
+                     sizeof(S2Shape*));
 }
@@ -21,19 +21,27 @@
 #include <atomic>
 #include <cstddef>
 #include <cstdint>
+#include <functional>
 #include <memory>
+#include <memory_resource>
+#include <utility>
 #include <vector>
 
+#include "absl/base/optimization.h"
 #include "absl/log/absl_check.h"
 #include "absl/strings/cord.h"
+#include "absl/strings/string_view.h"
 #include "s2/util/coding/coder.h"
 #include "s2/encoded_s2cell_id_vector.h"
 #include "s2/encoded_string_vector.h"
 #include "s2/mutable_s2shape_index.h"
 #include "s2/s2cell_id.h"
+#include "s2/s2cell_union.h"
 #include "s2/s2point.h"
 #include "s2/s2shape.h"
 #include "s2/s2shape_index.h"
+#include "s2/s2shape_metadata.h"
+#include "s2/s2space_usage.h"
 
 // EncodedS2ShapeIndex is an S2ShapeIndex implementation that works directly
 // with encoded data.  Rather than decoding everything in advance, geometry is
@@ -95,7 +103,15 @@
 //
 // Note that EncodedS2ShapeIndex does not make a copy of the encoded data, and
 // therefore the client must ensure that this data outlives the
-// EncodedS2ShapeIndex object.
+// EncodedS2ShapeIndex object.  Alternatively the encoded data can be owned by
+// the index itself; this is how indexes are served directly from a
+// memory-mapped file (see S2MemoryMappedFile):
+//
+//   auto file = S2MemoryMappedFile::Open(path, error);
+//   Decoder decoder(file->data(), file->size());
+//   EncodedS2ShapeIndex index;
+//   index.Init(&decoder, s2shapeutil::LazyDecodeShapeFactory(&decoder, file,
+//                                                            error), file);
 //
 // There are a number of built-in classes that work with S2ShapeIndex objects.
 // Generally these classes accept any collection of geometry that can be
@@ -120,10 +136,12 @@
 //
 // EncodedS2ShapeIndex is thread-compatible, meaning that const methods are
 // thread safe, and non-const methods are not thread safe.  The only non-const
-// method is Minimize(), so if you plan to call Minimize() while other threads
-// are actively using the index that you must use an external reader-writer
-// lock such as absl::Mutex to guard access to it.  (There is no global state
-// and therefore each index can be guarded independently.)
+// methods (after initialization) are Minimize(), Freeze(),
+// set_max_decoded_shapes(), set_reclaim_evicted_shapes(), and
+// ReleaseEvictedShapes(), so if you plan to call them while other threads are
+// actively using the index that you must use an external reader-writer lock
+// such as absl::Mutex to guard access to it.  (There is no global state and
+// therefore each index can be guarded independently.)
 class EncodedS2ShapeIndex final : public S2ShapeIndex {
  public:
   using Options = MutableS2ShapeIndex::Options;
@@ -146,6 +164,14 @@ class EncodedS2ShapeIndex final : public S2ShapeIndex {
   // in the Decoder's data buffer in this example.
   bool Init(Decoder* decoder, const ShapeFactory& shape_factory);
 
+  // Like the method above, but the index also shares ownership of
+  // "data_owner", which must keep the decoder's data buffer alive (e.g., a
+  // std::shared_ptr<const S2MemoryMappedFile>).  The buffer is released when
+  // the index is destroyed or re-initialized, after all decoded shapes and
+  // cells that point into it.
+  bool Init(Decoder* decoder, const ShapeFactory& shape_factory,
+            std::shared_ptr<const void> data_owner);
+
   // Copies the encoded byte stream into a new encoder.
   void Encode(Encoder* encoder) const override;
 
@@ -161,12 +187,172 @@ class EncodedS2ShapeIndex final : public S2ShapeIndex {
   // REQUIRES: 0 <= id < num_shape_ids()
   const S2Shape* shape(int id) const override;
 
+  // Returns the shape metadata stored in the encoding, if any (see
+  // MutableS2ShapeIndex::Options::cache_shape_metadata).  The shape itself
+  // is not decoded.
+  bool GetShapeMetadata(int id, S2ShapeMetadata* metadata) const override;
+
   // Minimizes memory usage by requesting that any data structures that can be
   // rebuilt should be discarded.  This method invalidates all iterators.
   //
   // Like all non-const methods, this method is not thread-safe.
   void Minimize() override;
 
+  // Decodes all index cells that intersect "region", together with all the
+  // shapes that those cells refer to, using up to "num_threads" threads
+  // (including the calling thread).  Normally cells and shapes are decoded
+  // the first time they are accessed; this method lets clients move that
+  // work into a warmup step (e.g., using a covering of the expected query
+  // region) so that later queries have predictable latency.
+  //
+  // Like the other const methods, this method is thread-safe, and it may be
+  // called while other threads are using the index.
+  void Prefetch(const S2CellUnion& region, int num_threads = 1) const;
+
+  // Decodes every cell and shape in the index using up to "num_threads"
+  // threads.  Equivalent to Prefetch(S2CellUnion::WholeSphere(), num_threads)
+  // but somewhat faster.
+  void DecodeAll(int num_threads = 1) const;
+
+  // Returns a MutableS2ShapeIndex that contains only the cells of this index
+  // that intersect "region", together with the shapes that those cells refer
+  // to.  The shapes are obtained from "shape_factory" (typically
+  // s2shapeutil::FullDecodeShapeFactory, so that the result does not refer
+  // to the encoded data), and shape ids are unchanged; all other shapes are
+  // null, as though they had been removed.  When "region" is much smaller
+  // than the area covered by the index (e.g., a server that only handles
+  // queries for one metropolitan area), the result is correspondingly
+  // smaller than the fully decoded index.
+  //
+  // Queries on the result return the same answers as queries on this index
+  // provided that they only involve points and edges within "region".
+  // Shapes should not be added to or removed from the result.
+  //
+  // This method does not decode any cells or shapes of this index.  Returns
+  // nullptr if the encoded cells cannot be decoded.
+  std::unique_ptr<MutableS2ShapeIndex> DecodeRegion(
+      const S2CellUnion& region, const ShapeFactory& shape_factory) const;
+
+  // Limits the number of decoded shapes that are kept in memory.  Normally
+  // every shape stays decoded until Minimize() is called; with a limit, once
+  // more than "max_decoded_shapes" shapes have been decoded the index evicts
+  // shapes that have not been accessed recently (using the CLOCK algorithm),
+  // and they are decoded again if they are needed later.  This allows serving
+  // indexes whose fully decoded shapes would not fit in memory.  A negative
+  // value means no limit (the default).
+  //
+  // Since shape() returns a pointer that other threads may still be using,
+  // evicted shapes are not deleted immediately.  By default they are kept
+  // until the next call to ReleaseEvictedShapes() or Minimize(), which means
+  // that memory usage is NOT bounded by this limit: a workload that keeps
+  // evicting and re-decoding shapes grows without limit until one of those
+  // methods is called.  To bound memory usage without such quiescent points,
+  // see set_reclaim_evicted_shapes() below.
+  //
+  // Like all non-const methods, this method is not thread-safe.
+  void set_max_decoded_shapes(int max_decoded_shapes);
+  int max_decoded_shapes() const { return max_decoded_shapes_; }
+
+  // Specifies that evicted shapes (see set_max_decoded_shapes) should be
+  // deleted automatically as soon as no ReaderScope that existed when they
+  // were evicted remains.  This bounds the number of decoded shapes in memory
+  // to about max_decoded_shapes() plus the number of shapes evicted while the
+  // oldest active ReaderScope has existed.
+  //
+  // REQUIRES: Every use of the index (including the pointers returned by
+  //           shape(), and queries such as S2ClosestEdgeQuery that call it)
+  //           takes place within a ReaderScope.  Scopes should be short-lived
+  //           (e.g., one per query), since each one delays reclamation.
+  //
+  // Like all non-const methods, this method is not thread-safe.
+  void set_reclaim_evicted_shapes(bool reclaim) { reclaim_evicted_ = reclaim; }
+  bool reclaim_evicted_shapes() const { return reclaim_evicted_; }
+
+  // An RAII object that keeps the shapes returned by shape() valid while it
+  // exists (see set_reclaim_evicted_shapes).  Creating and destroying a scope
+  // costs two atomic operations on a shared counter.  For example:
+  //
+  //   {
+  //     EncodedS2ShapeIndex::ReaderScope scope(index);
+  //     S2ClosestEdgeQuery query(&index);
+  //     ...
+  //   }
+  class ReaderScope {
+   public:
+    explicit ReaderScope(const EncodedS2ShapeIndex& index);
+    ~ReaderScope();
+
+    ReaderScope(const ReaderScope&) = delete;
+    void operator=(const ReaderScope&) = delete;
+
+   private:
+    std::atomic<int>& num_readers_;
+  };
+
+  // Specifies that the flags recording which cells have been decoded should
+  // be spread out so that each group of 64 flags occupies its own cache line.
+  // This reduces false sharing when many threads decode neighboring cells
+  // concurrently (e.g., while a large shared index is warming up), at the
+  // cost of 8 times more memory for the flags (one byte per cell rather than
+  // one bit).  Once an index is warm the flags are only read, so this option
+  // mainly helps indexes that are shared by many threads and are rarely
+  // fully decoded (see also Freeze()).
+  //
+  // This method must be called before Init().
+  void set_pad_decoded_cell_flags(bool pad) { pad_decoded_cell_flags_ = pad; }
+  bool pad_decoded_cell_flags() const { return pad_decoded_cell_flags_; }
+
+  // Specifies a memory resource from which decoded cells are allocated.  For
+  // example, allocating the cells of a large index from an
+  // S2HugePageMemoryResource (wrapped in a std::pmr::synchronized_pool_resource
+  // so that the memory of minimized cells is reused) reduces TLB misses when
+  // queries visit cells in random order.  Since cells are decoded lazily by
+  // any thread that uses the index, the resource must be thread-safe.  It
+  // must also outlive the index.
+  //
+  // Calling this method discards all decoded cells and shapes (see
+  // Minimize).  A null resource means that the default allocator is used.
+  void set_memory_resource(std::pmr::memory_resource* resource);
+  std::pmr::memory_resource* memory_resource() const {
+    return memory_resource_;
+  }
+
+  // Decodes every cell and shape in the index (see DecodeAll) and switches
+  // to a mode where cells are looked up without any atomic operations.  This
+  // is useful for long-lived indexes that are shared by many threads, since
+  // after Freeze() returns the read path no longer touches the decoded cell
+  // flags at all.  The index remains frozen until the next call to
+  // Minimize() or Init().
+  //
+  // Like all non-const methods, this method is not thread-safe.
+  void Freeze(int num_threads = 1);
+  bool is_frozen() const { return frozen_; }
+
+  // Deletes the shapes that have been evicted (see set_max_decoded_shapes).
+  // This invalidates any pointers to them previously returned by shape(), so
+  // unless set_reclaim_evicted_shapes(true) is used, clients should call it
+  // periodically at a point where no other threads are using the index.
+  //
+  // Like all non-const methods, this method is not thread-safe.
+  void ReleaseEvictedShapes();
+
+  // A function that is called before the encoded contents of a cell are
+  // decoded, and that must ensure that the bytes of "encoded_cell" are
+  // readable (e.g., by fetching them from remote storage).  It returns false
+  // if the bytes are not available, in which case the cell is treated as
+  // undecodable.  It may be called concurrently from multiple threads.
+  using CellDataLoader = std::function<bool(absl::string_view encoded_cell)>;
+
+  // Specifies a function that loads the encoded contents of cells on demand
+  // (see EncodedS2ShapeIndexLoader).  This lets the index be initialized
+  // from a buffer that is only partially filled in.  The function is not
+  // called for cells that have already been decoded.
+  //
+  // Like all non-const methods, this method is not thread-safe.
+  void set_cell_data_loader(CellDataLoader loader) {
+    cell_data_loader_ = std::move(loader);
+  }
+
   class Iterator final : public IteratorBase {
    public:
     // Default constructor; must be followed by a call to Init().
@@ -222,6 +408,13 @@ class EncodedS2ShapeIndex final : public S2ShapeIndex {
   // as the other "const" methods (see introduction).
   size_t SpaceUsed() const override;
 
+  // Reports the components "object" (sizeof(*this)), "shapes" (the vector of
+  // shape pointers), "cells" (the array of decoded cell pointers),
+  // "cell_cache" (bookkeeping for decoded cells), and "decoded_shapes"
+  // (bookkeeping for decoded shapes).  The memory used by the decoded cells
+  // and shapes themselves is not included.
+  void GetSpaceUsage(S2SpaceUsage* usage) const override;
+
  protected:
   std::unique_ptr<IteratorBase> NewIterator(InitialPosition pos) const override;
 
@@ -240,11 +433,30 @@ class EncodedS2ShapeIndex final : public S2ShapeIndex {
   };
 
   S2Shape* GetShape(int id) const;
+  bool has_shape_metadata() const {
+    return version_ == MutableS2ShapeIndex::kShapeMetadataEncodingVersionNumber;
+  }
+  void AddDecodedShape(int id) const;
+  void MarkShapeReferenced(int id) const;
+  void ReclaimEvictedShapes() const;
   const S2ShapeIndexCell* GetCell(int i) const;
+
+  // Decodes the cells in the given ranges [begin, end) of cell positions,
+  // followed by the shapes they refer to (or all shapes if "all_shapes" is
+  // true), using up to "num_threads" threads.
+  void DecodeCellRanges(const std::vector<std::pair<int, int>>& ranges,
+                        bool all_shapes, int num_threads) const;
+  std::atomic<uint64_t>& decoded_group(int i) const;
   bool cell_decoded(int i) const;
   void set_cell_decoded(int i) const;
+  S2ShapeIndexCell* NewCell() const;
+  void DeleteCell(S2ShapeIndexCell* cell) const;
   int max_cell_cache_size() const;
 
+  // Keeps the encoded data alive when it is owned by the index (see Init).
+  // This field is declared first so that it is destroyed last.
+  std::shared_ptr<const void> data_owner_;
+
   std::unique_ptr<ShapeFactory> shape_factory_;
 
   // The options specified for this index.
@@ -264,6 +476,10 @@ class EncodedS2ShapeIndex final : public S2ShapeIndex {
   // A vector containing the encoded contents of each cell in the index.
   s2coding::EncodedStringVector encoded_cells_;
 
+  // If the encoding includes shape metadata, a vector containing the encoded
+  // S2ShapeMetadata of each shape (or an empty string for removed shapes).
+  s2coding::EncodedStringVector shape_metadata_;
+
   // A raw array containing the decoded contents of each cell in the index.
   // Initially all values are *uninitialized memory*.  The cells_decoded_
   // field below keeps track of which elements are present.
@@ -271,7 +487,40 @@ class EncodedS2ShapeIndex final : public S2ShapeIndex {
 
   // A bit vector indicating which elements of cells_ have been decoded.
   // All other elements of cells_ contain uninitialized (random) memory.
+  // Each group of 64 flags is stored in cells_decoded_[group * stride],
+  // where the stride is 1 unless pad_decoded_cell_flags() is true.
   mutable std::vector<std::atomic<uint64_t>> cells_decoded_;
+  int decoded_group_stride_ = 1;
+  bool pad_decoded_cell_flags_ = false;
+
+  // True if all cells have been decoded by Freeze().
+  bool frozen_ = false;
+
+  // The resource used to allocate cells, or nullptr to use operator new.
+  std::pmr::memory_resource* memory_resource_ = nullptr;
+
+  // If non-empty, called before each cell is decoded (see above).
+  CellDataLoader cell_data_loader_;
+
+  // The maximum number of decoded shapes, or -1 if there is no limit.
+  int max_decoded_shapes_ = -1;
+
+  // True if evicted shapes are deleted once no ReaderScope refers to them.
+  bool reclaim_evicted_ = false;
+
+  // When max_decoded_shapes_ >= 0, the following fields implement the CLOCK
+  // eviction algorithm.  shape_referenced_[id] is set each time a decoded
+  // shape is accessed, and cleared when the clock hand passes over it.
+  mutable std::vector<std::atomic<uint8_t>> shape_referenced_;
+
+  // The fields above are read by every query, whereas the fields below are
+  // written while cells and shapes are being decoded.  The two groups of
+  // fields written under each lock are aligned to separate cache lines so
+  // that decoding in one thread does not invalidate the cache lines that
+  // other threads are reading (false sharing).
+
+  // Protects all updates to cells_ and cells_decoded_.
+  alignas(ABSL_CACHELINE_SIZE) mutable SpinLock cells_lock_;
 
   // In order to minimize destructor time when very few cells of a large
   // S2ShapeIndex are needed, we keep track of the indices of the first few
@@ -279,8 +528,31 @@ class EncodedS2ShapeIndex final : public S2ShapeIndex {
   // vector when the number of cells decoded is very small.
   mutable std::vector<int> cell_cache_;
 
-  // Protects all updates to cells_ and cells_decoded_.
-  mutable SpinLock cells_lock_;
+  // Protects decoded_shape_ids_, clock_hand_, evicted_shapes_, and
+  // previous_evicted_shapes_.
+  alignas(ABSL_CACHELINE_SIZE) mutable SpinLock shapes_lock_;
+
+  // The ids of the currently decoded shapes, in clock order.
+  mutable std::vector<int> decoded_shape_ids_;
+  mutable int clock_hand_ = 0;
+
+  // Shapes that have been evicted during the current reclamation epoch (see
+  // below) but not yet deleted.
+  mutable std::vector<S2Shape*> evicted_shapes_;
+
+  // Shapes that were evicted during the previous epoch.  They are deleted
+  // when the epoch advances again.
+  mutable std::vector<S2Shape*> previous_evicted_shapes_;
+
+  // The fields below implement epoch-based reclamation of evicted shapes
+  // (see ReclaimEvictedShapes).  Each ReaderScope increments the reader
+  // count for the parity of the epoch in which it was created.  The epoch is
+  // only advanced (under shapes_lock_) once there are no readers left from
+  // the previous epoch, so that shapes evicted two epochs ago can no longer
+  // be in use.  These fields are written by every ReaderScope and are
+  // therefore kept on their own cache line.
+  alignas(ABSL_CACHELINE_SIZE) mutable std::atomic<uint32_t> reader_epoch_ = 0;
+  mutable std::atomic<int> num_readers_[2] = {0, 0};
 
   EncodedS2ShapeIndex(const EncodedS2ShapeIndex&) = delete;
   void operator=(const EncodedS2ShapeIndex&) = delete;
@@ -349,14 +621,45 @@ EncodedS2ShapeIndex::NewIterator(InitialPosition pos) const {
 
 inline const S2Shape* EncodedS2ShapeIndex::shape(int id) const {
   const S2Shape* shape = shapes_[id].load(std::memory_order_acquire);
-  if (shape != kUndecodedShape()) return shape;
+  if (shape != kUndecodedShape()) {
+    if (ABSL_PREDICT_FALSE(max_decoded_shapes_ >= 0)) MarkShapeReferenced(id);
+    return shape;
+  }
   return GetShape(id);
 }
 
+inline EncodedS2ShapeIndex::ReaderScope::ReaderScope(
+    const EncodedS2ShapeIndex& index)
+    : num_readers_(index.num_readers_[
+          index.reader_epoch_.load(std::memory_order_relaxed) & 1]) {
+  num_readers_.fetch_add(1, std::memory_order_relaxed);
+  // Ensures that the increment is visible to ReclaimEvictedShapes() before
+  // this thread loads any shape pointers (see the .cc file).
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+}
+
+inline EncodedS2ShapeIndex::ReaderScope::~ReaderScope() {
+  // Ensures that all uses of shapes happen before they are deleted.
+  num_readers_.fetch_sub(1, std::memory_order_release);
+}
+
+inline void EncodedS2ShapeIndex::MarkShapeReferenced(int id) const {
+  // Avoid writing to the cache line unless necessary.
+  std::atomic<uint8_t>* referenced = &shape_referenced_[id];
+  if (!referenced->load(std::memory_order_relaxed)) {
+    referenced->store(1, std::memory_order_relaxed);
+  }
+}
+
+// Returns the word of cells_decoded_ that contains the flag for cell "i".
+inline std::atomic<uint64_t>& EncodedS2ShapeIndex::decoded_group(int i) const {
+  return cells_decoded_[(i >> 6) * decoded_group_stride_];
+}
+
 // Returns true if the given cell has already been decoded.
 inline bool EncodedS2ShapeIndex::cell_decoded(int i) const {
   // cell_decoded(i) uses acquire/release synchronization (see .cc file).
-  uint64_t group_bits = cells_decoded_[i >> 6].load(std::memory_order_acquire);
+  uint64_t group_bits = decoded_group(i).load(std::memory_order_acquire);
   return (group_bits & (1ULL << (i & 63))) != 0;
 }
 
@@ -367,7 +670,7 @@ inline void EncodedS2ShapeIndex::set_cell_decoded(int i) const {
   // We use memory_order_release for the store operation below to ensure that
   // cells_decoded(i) sees the most recent value, however we can use
   // memory_order_relaxed for the load because cells_lock_ is held.
-  std::atomic<uint64_t>* group = &cells_decoded_[i >> 6];
+  std::atomic<uint64_t>* group = &decoded_group(i);
   uint64_t bits = group->load(std::memory_order_relaxed);
   group->store(bits | 1ULL << (i & 63), std::memory_order_release);
 }
@@ -0,0 +1,143 @@
+// Copyright 2024 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "s2/encoded_s2shape_index.h"
+
+#include <cstddef>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+#include "absl/log/absl_check.h"
+#include "s2/util/coding/coder.h"
+#include "s2/mutable_s2shape_index.h"
+#include "s2/s2benchmark_testing.h"
+#include "s2/s2contains_point_query.h"
+#include "s2/s2error.h"
+#include "s2/s2lax_polygon_shape.h"
+#include "s2/s2loop.h"
+#include "s2/s2point.h"
+#include "s2/s2point_span.h"
+#include "s2/s2shape_index.h"
+#include "s2/s2shapeutil_coding.h"
+
+using std::string;
+using std::vector;
+
+namespace {
+
+using s2benchmark::kSeed;
+
+// Returns the encoding of an index containing one fractal polygon (including
+// the encoded shapes themselves).
+string MakeEncodedFractalIndex(int num_edges) {
+  std::mt19937_64 bitgen(kSeed);
+  std::unique_ptr<S2Loop> loop =
+      s2benchmark::MakeFractalLoop(bitgen, num_edges);
+  MutableS2ShapeIndex index;
+  S2PointLoopSpan vertices = loop->vertices_span();
+  vector<vector<S2Point>> loops = {{vertices.begin(), vertices.end()}};
+  index.Add(std::make_unique<S2LaxPolygonShape>(loops));
+  Encoder encoder;
+  ABSL_CHECK(s2shapeutil::CompactEncodeTaggedShapes(index, &encoder));
+  index.Encode(&encoder);
+  return string(encoder.base(), encoder.length());
+}
+
+// Measures the time to initialize an EncodedS2ShapeIndex.  This does not
+// decode any cells or shapes.
+void BM_EncodedS2ShapeIndexInit(benchmark::State& state) {
+  const string encoded = MakeEncodedFractalIndex(state.range(0));
+  for (auto _ : state) {
+    Decoder decoder(encoded.data(), encoded.size());
+    EncodedS2ShapeIndex index;
+    S2Error error;
+    auto factory = s2shapeutil::LazyDecodeShapeFactory(&decoder, error);
+    ABSL_CHECK(error.ok()) << error;
+    ABSL_CHECK(index.Init(&decoder, factory));
+    benchmark::DoNotOptimize(index);
+  }
+  state.SetBytesProcessed(state.iterations() * encoded.size());
+}
+BENCHMARK(BM_EncodedS2ShapeIndexInit)->Apply(s2benchmark::EdgeCounts);
+
+// Measures the time to initialize an EncodedS2ShapeIndex and then decode
+// every cell (together with the shape it refers to).
+void BM_EncodedS2ShapeIndexDecodeAll(benchmark::State& state) {
+  const string encoded = MakeEncodedFractalIndex(state.range(0));
+  for (auto _ : state) {
+    Decoder decoder(encoded.data(), encoded.size());
+    EncodedS2ShapeIndex index;
+    S2Error error;
+    auto factory = s2shapeutil::LazyDecodeShapeFactory(&decoder, error);
+    ABSL_CHECK(error.ok()) << error;
+    ABSL_CHECK(index.Init(&decoder, factory));
+    int num_edges = 0;
+    for (EncodedS2ShapeIndex::Iterator it(&index, S2ShapeIndex::BEGIN);
+         !it.done(); it.Next()) {
+      num_edges += it.cell().clipped(0).num_edges();
+    }
+    benchmark::DoNotOptimize(num_edges);
+    benchmark::DoNotOptimize(index.shape(0));
+  }
+  state.SetBytesProcessed(state.iterations() * encoded.size());
+}
+BENCHMARK(BM_EncodedS2ShapeIndexDecodeAll)->Apply(s2benchmark::EdgeCounts);
+
+// Like the benchmark above, but uses DecodeAll() with the given number of
+// threads (state.range(1)).
+void BM_EncodedS2ShapeIndexDecodeAllThreads(benchmark::State& state) {
+  const string encoded = MakeEncodedFractalIndex(state.range(0));
+  const int num_threads = state.range(1);
+  for (auto _ : state) {
+    Decoder decoder(encoded.data(), encoded.size());
+    EncodedS2ShapeIndex index;
+    S2Error error;
+    auto factory = s2shapeutil::LazyDecodeShapeFactory(&decoder, error);
+    ABSL_CHECK(error.ok()) << error;
+    ABSL_CHECK(index.Init(&decoder, factory));
+    index.DecodeAll(num_threads);
+    benchmark::DoNotOptimize(index);
+  }
+  state.SetBytesProcessed(state.iterations() * encoded.size());
+}
+BENCHMARK(BM_EncodedS2ShapeIndexDecodeAllThreads)
+    ->ArgsProduct({{1 << 12, 1 << 16, 1 << 20}, {1, 4}});
+
+// Measures point containment against a freshly decoded index, which is the
+// typical use case for EncodedS2ShapeIndex (only the cells that are needed
+// are decoded).
+void BM_EncodedS2ShapeIndexContainsPoint(benchmark::State& state) {
+  const string encoded = MakeEncodedFractalIndex(state.range(0));
+  const vector<S2Point> points = s2benchmark::MakeQueryPoints(
+      *s2benchmark::MakeFractalIndex(state.range(0)), 1000);
+  size_t i = 0;
+  for (auto _ : state) {
+    Decoder decoder(encoded.data(), encoded.size());
+    EncodedS2ShapeIndex index;
+    S2Error error;
+    auto factory = s2shapeutil::LazyDecodeShapeFactory(&decoder, error);
+    ABSL_CHECK(error.ok()) << error;
+    ABSL_CHECK(index.Init(&decoder, factory));
+    auto query = MakeS2ContainsPointQuery(&index);
+    benchmark::DoNotOptimize(query.Contains(points[i++ % points.size()]));
+  }
+}
+BENCHMARK(BM_EncodedS2ShapeIndexContainsPoint)
+    ->Apply(s2benchmark::EdgeCounts);
+
+}  // namespace
@@ -0,0 +1,391 @@
+// Copyright 2024 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "s2/encoded_s2shape_index_loader.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "absl/log/absl_check.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/synchronization/notification.h"
+#include "s2/util/coding/coder.h"
+#include "s2/util/coding/varint.h"
+#include "s2/encoded_s2shape_index.h"
+#include "s2/encoded_uint_vector.h"
+#include "s2/mutable_s2shape_index.h"
+#include "s2/s2cell_id.h"
+#include "s2/s2cell_union.h"
+#include "s2/s2error.h"
+#include "s2/s2shape.h"
+#include "s2/s2shape_index.h"
+#include "s2/s2shapeutil_coding.h"
+
+using std::make_unique;
+using std::pair;
+using std::unique_ptr;
+using std::vector;
+
+// Ensures that the data of each shape has been fetched before it is decoded.
+class EncodedS2ShapeIndexLoader::ShapeFactory final
+    : public S2ShapeIndex::ShapeFactory {
+ public:
+  ShapeFactory(EncodedS2ShapeIndexLoader* loader,
+               s2shapeutil::TaggedShapeFactory factory)
+      : loader_(loader), factory_(std::move(factory)) {}
+
+  int size() const override { return factory_.size(); }
+
+  unique_ptr<S2Shape> operator[](int shape_id) const override {
+    if (!loader_->LoadSync(
+            {loader_->RangeOf(loader_->encoded_shapes_[shape_id])})) {
+      return nullptr;
+    }
+    return factory_[shape_id];
+  }
+
+  unique_ptr<S2ShapeIndex::ShapeFactory> Clone() const override {
+    return make_unique<ShapeFactory>(*this);
+  }
+
+ private:
+  EncodedS2ShapeIndexLoader* loader_;
+  s2shapeutil::TaggedShapeFactory factory_;
+};
+
+EncodedS2ShapeIndexLoader::EncodedS2ShapeIndexLoader(
+    unique_ptr<S2ByteSource> source, const Options& options)
+    : options_(options),
+      source_(std::move(source)),
+      size_(source_->size()),
+      // The buffer is deliberately left uninitialized (see class comment).
+      data_(new char[size_]) {
+  ABSL_CHECK_GT(options_.page_size(), 0);
+  pages_.resize((size_ + options_.page_size() - 1) / options_.page_size(),
+                PageState::kAbsent);
+}
+
+EncodedS2ShapeIndexLoader::~EncodedS2ShapeIndexLoader() = default;
+
+void EncodedS2ShapeIndexLoader::Open(DoneCallback done) {
+  // Each pass parses as much of the metadata as has been fetched so far.
+  // Since every page that is fetched usually contains several of the small
+  // headers that make up the metadata, only a few passes are needed.
+  Range missing;
+  S2Error error;
+  if (ParseMetadata(&missing, error)) {
+    done(InitIndex());
+  } else if (!error.ok()) {
+    done(error);
+  } else {
+    Load({missing}, [this, done = std::move(done)](S2Error load_error) {
+      if (!load_error.ok()) {
+        done(load_error);
+      } else {
+        Open(std::move(done));
+      }
+    });
+  }
+}
+
+bool EncodedS2ShapeIndexLoader::ParseMetadata(Range* missing,
+                                              S2Error& error) const {
+  uint64_t pos = 0;
+
+  // Returns true if the next "n" bytes have been fetched.
+  auto available = [&](uint64_t n) {
+    if (n > size_ - pos) {
+      error = S2Error::DataLoss("Truncated EncodedS2ShapeIndex");
+      return false;
+    }
+    Range range{pos, pos + n};
+    if (!IsLoaded(range)) {
+      *missing = range;
+      return false;
+    }
+    return true;
+  };
+  auto get_varint = [&](uint64_t* value) {
+    uint64_t n = std::min<uint64_t>(Varint::kMax64, size_ - pos);
+    if (!available(n)) return false;
+    Decoder decoder(data_.get() + pos, n);
+    if (!decoder.get_varint64(value)) {
+      error = S2Error::DataLoss("Invalid varint in EncodedS2ShapeIndex");
+      return false;
+    }
+    pos += decoder.pos();
+    return true;
+  };
+  // Skips over an EncodedUintVector<uint64_t>, whose contents must be
+  // fetched.  Sets "last" to its last element (or 0 if it is empty).
+  auto skip_uint_vector = [&](uint64_t* last) {
+    uint64_t size_len;
+    if (!get_varint(&size_len)) return false;
+    uint64_t size = size_len / sizeof(uint64_t);
+    int len = (size_len & (sizeof(uint64_t) - 1)) + 1;
+    if (size > (size_ - pos) / len) {
+      error = S2Error::DataLoss("Truncated EncodedS2ShapeIndex");
+      return false;
+    }
+    if (!available(size * len)) return false;
+    *last = size == 0 ? 0
+                      : s2coding::GetUintWithLength<uint64_t>(
+                            data_.get() + pos + (size - 1) * len, len);
+    pos += size * len;
+    return true;
+  };
+  // Skips over an EncodedStringVector.  The offsets must be fetched, but
+  // the strings themselves only if "fetch_strings" is true.
+  auto skip_string_vector = [&](bool fetch_strings) {
+    uint64_t length;
+    if (!skip_uint_vector(&length)) return false;
+    if (length > size_ - pos) {
+      error = S2Error::DataLoss("Truncated EncodedS2ShapeIndex");
+      return false;
+    }
+    if (fetch_strings && !available(length)) return false;
+    pos += length;
+    return true;
+  };
+  // Skips over an EncodedS2CellIdVector (see EncodedS2CellIdVector::Init).
+  auto skip_cell_id_vector = [&]() {
+    if (!available(1)) return false;
+    int code_plus_len = static_cast<uint8_t>(data_[pos++]);
+    if ((code_plus_len >> 3) == 31) {
+      if (!available(1)) return false;
+      ++pos;
+    }
+    if (!available(code_plus_len & 7)) return false;
+    pos += code_plus_len & 7;
+    uint64_t last;
+    return skip_uint_vector(&last);
+  };
+
+  // The shapes encoded by s2shapeutil::EncodeTaggedShapes().
+  if (!skip_string_vector(false)) return false;
+  // The EncodedS2ShapeIndex (see EncodedS2ShapeIndex::Init).
+  uint64_t max_edges_version;
+  if (!get_varint(&max_edges_version)) return false;
+  if (!skip_cell_id_vector()) return false;
+  if (!skip_string_vector(false)) return false;
+  if ((max_edges_version & 3) ==
+      MutableS2ShapeIndex::kShapeMetadataEncodingVersionNumber) {
+    // The shape metadata is small, so it is simply fetched in full.
+    if (!skip_string_vector(true)) return false;
+  }
+  return true;
+}
+
+S2Error EncodedS2ShapeIndexLoader::InitIndex() {
+  const S2Error kInvalid =
+      S2Error::DataLoss("Cannot decode EncodedS2ShapeIndex");
+  Decoder decoder(data_.get(), size_);
+  S2Error error;
+  auto factory = s2shapeutil::LazyDecodeShapeFactory(&decoder, error);
+  if (!error.ok()) return error;
+
+  // Make a second pass to find the data of each shape and cell.
+  Decoder vectors(data_.get(), size_);
+  uint64_t max_edges_version;
+  if (!encoded_shapes_.Init(&vectors) ||
+      !vectors.get_varint64(&max_edges_version) ||
+      !cell_ids_.Init(&vectors) || !encoded_cells_.Init(&vectors)) {
+    return kInvalid;
+  }
+  index_.set_cell_data_loader([this](absl::string_view encoded_cell) {
+    return LoadSync({RangeOf(encoded_cell)});
+  });
+  if (!index_.Init(&decoder, ShapeFactory(this, std::move(factory)))) {
+    return kInvalid;
+  }
+  return S2Error::Ok();
+}
+
+void EncodedS2ShapeIndexLoader::Prefetch(const S2CellUnion& region,
+                                         DoneCallback done) {
+  // Convert "region" to a sorted list of disjoint ranges of cell positions
+  // (as in EncodedS2ShapeIndex::Prefetch), extended by the readahead.
+  const int num_cells = cell_ids_.size();
+  const int readahead = std::max(0, options_.readahead_cells());
+  vector<pair<int, int>> cell_ranges;
+  for (auto [begin, end] : cell_ids_.GetIntersectingRanges(region.cell_ids())) {
+    begin = std::max(0, begin - readahead);
+    end = std::min(num_cells, end + readahead);
+    if (!cell_ranges.empty() && begin <= cell_ranges.back().second) {
+      cell_ranges.back().second = std::max(cell_ranges.back().second, end);
+    } else {
+      cell_ranges.emplace_back(begin, end);
+    }
+  }
+  // The cells in each range are stored contiguously.
+  vector<Range> ranges;
+  for (const auto& [begin, end] : cell_ranges) {
+    ranges.push_back({RangeOf(encoded_cells_[begin]).begin,
+                      RangeOf(encoded_cells_[end - 1]).end});
+  }
+  Load(ranges, [this, cell_ranges = std::move(cell_ranges),
+                done = std::move(done)](S2Error error) {
+    if (!error.ok()) {
+      done(error);
+      return;
+    }
+    // Decode the cells to find the shapes that they refer to.  (This does
+    // not block since the cells have been fetched.)
+    vector<int> shape_ids;
+    EncodedS2ShapeIndex::Iterator it(&index_);
+    for (const auto& [begin, end] : cell_ranges) {
+      it.Seek(cell_ids_[begin]);
+      for (int i = begin; i < end; ++i, it.Next()) {
+        for (const S2ClippedShape& clipped : it.cell().clipped_shapes()) {
+          shape_ids.push_back(clipped.shape_id());
+        }
+      }
+    }
+    std::sort(shape_ids.begin(), shape_ids.end());
+    shape_ids.erase(std::unique(shape_ids.begin(), shape_ids.end()),
+                    shape_ids.end());
+    vector<Range> shape_ranges;
+    for (int id : shape_ids) {
+      shape_ranges.push_back(RangeOf(encoded_shapes_[id]));
+    }
+    Load(shape_ranges, std::move(done));
+  });
+}
+
+void EncodedS2ShapeIndexLoader::Load(const vector<Range>& ranges,
+                                     DoneCallback done) {
+  const size_t page_size = options_.page_size();
+  PendingLoad load;
+  vector<pair<size_t, size_t>> reads;
+  bool ready;
+  {
+    absl::MutexLock lock(&mutex_);
+    for (const Range& range : ranges) {
+      if (range.begin >= range.end) continue;
+      const size_t first = range.begin / page_size;
+      const size_t last = (range.end - 1) / page_size + 1;
+      load.pages.emplace_back(first, last);
+      for (size_t page = first; page < last; ++page) {
+        if (pages_[page] != PageState::kAbsent) continue;
+        pages_[page] = PageState::kLoading;
+        // Coalesce adjacent pages into a single read.
+        if (!reads.empty() && reads.back().second == page) {
+          ++reads.back().second;
+        } else {
+          reads.emplace_back(page, page + 1);
+        }
+      }
+    }
+    ready = AllPagesLoaded(load);
+    if (!ready) {
+      load.done = std::move(done);
+      pending_.push_back(std::move(load));
+    }
+    num_reads_ += reads.size();
+  }
+  if (ready) done(S2Error::Ok());
+  for (const auto& [first, last] : reads) IssueRead(first, last);
+}
+
+bool EncodedS2ShapeIndexLoader::LoadSync(const vector<Range>& ranges) {
+  absl::Notification loaded;
+  S2Error result;
+  Load(ranges, [&](S2Error error) {
+    result = std::move(error);
+    loaded.Notify();
+  });
+  loaded.WaitForNotification();
+  return result.ok();
+}
+
+void EncodedS2ShapeIndexLoader::IssueRead(size_t first, size_t last) {
+  const uint64_t begin = first * options_.page_size();
+  const uint64_t end = std::min<uint64_t>(size_, last * options_.page_size());
+  source_->Read(begin, end - begin, data_.get() + begin,
+                [this, first, last](S2Error error) {
+                  OnReadDone(first, last, std::move(error));
+                });
+}
+
+void EncodedS2ShapeIndexLoader::OnReadDone(size_t first, size_t last,
+                                           S2Error error) {
+  vector<DoneCallback> callbacks;
+  {
+    absl::MutexLock lock(&mutex_);
+    for (size_t page = first; page < last; ++page) {
+      // Failed pages become absent again so that they can be retried.
+      pages_[page] = error.ok() ? PageState::kLoaded : PageState::kAbsent;
+    }
+    if (error.ok()) {
+      bytes_loaded_ +=
+          std::min<uint64_t>(size_, last * options_.page_size()) -
+          first * options_.page_size();
+    }
+    // Complete the loads that are now satisfied, and fail those that were
+    // waiting for the pages that could not be read.
+    auto is_done = [&](const PendingLoad& load) {
+      if (!error.ok()) {
+        for (const auto& [load_first, load_last] : load.pages) {
+          if (load_first < last && first < load_last) return true;
+        }
+        return false;
+      }
+      return AllPagesLoaded(load);
+    };
+    auto it = std::stable_partition(
+        pending_.begin(), pending_.end(),
+        [&](const PendingLoad& load) { return !is_done(load); });
+    for (auto i = it; i != pending_.end(); ++i) {
+      callbacks.push_back(std::move(i->done));
+    }
+    pending_.erase(it, pending_.end());
+  }
+  for (DoneCallback& done : callbacks) done(error);
+}
+
+bool EncodedS2ShapeIndexLoader::IsLoaded(const Range& range) const {
+  if (range.begin >= range.end) return true;
+  const size_t page_size = options_.page_size();
+  absl::MutexLock lock(&mutex_);
+  for (size_t page = range.begin / page_size;
+       page <= (range.end - 1) / page_size; ++page) {
+    if (pages_[page] != PageState::kLoaded) return false;
+  }
+  return true;
+}
+
+bool EncodedS2ShapeIndexLoader::AllPagesLoaded(const PendingLoad& load) const {
+  for (const auto& [first, last] : load.pages) {
+    for (size_t page = first; page < last; ++page) {
+      if (pages_[page] != PageState::kLoaded) return false;
+    }
+  }
+  return true;
+}
+
+uint64_t EncodedS2ShapeIndexLoader::bytes_loaded() const {
+  absl::MutexLock lock(&mutex_);
+  return bytes_loaded_;
+}
+
+int64_t EncodedS2ShapeIndexLoader::num_reads() const {
+  absl::MutexLock lock(&mutex_);
+  return num_reads_;
+}
@@ -0,0 +1,226 @@
+// Copyright 2024 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef S2_ENCODED_S2SHAPE_INDEX_LOADER_H_
+#define S2_ENCODED_S2SHAPE_INDEX_LOADER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "s2/encoded_s2cell_id_vector.h"
+#include "s2/encoded_s2shape_index.h"
+#include "s2/encoded_string_vector.h"
+#include "s2/s2cell_union.h"
+#include "s2/s2error.h"
+
+// An abstract source of bytes whose reads may complete asynchronously, such
+// as a file in a distributed file system or an object in a blob store.
+class S2ByteSource {
+ public:
+  // Called exactly once when a read completes.  The error is OK on success.
+  using ReadCallback = std::function<void(S2Error)>;
+
+  virtual ~S2ByteSource() = default;
+
+  // Returns the total number of bytes available.
+  virtual uint64_t size() const = 0;
+
+  // Copies the bytes [offset, offset + length) to "dst" and then calls
+  // "done".  The callback may be invoked from any thread, including the
+  // calling thread before Read() returns.  Multiple reads may be
+  // outstanding at the same time.
+  //
+  // REQUIRES: offset + length <= size()
+  virtual void Read(uint64_t offset, size_t length, char* dst,
+                    ReadCallback done) = 0;
+};
+
+// EncodedS2ShapeIndexLoader serves an EncodedS2ShapeIndex (together with the
+// shapes encoded in front of it by s2shapeutil::EncodeTaggedShapes) from an
+// S2ByteSource, fetching the encoded data in pages as it is needed.  Open()
+// fetches only the metadata (the cell ids and the offsets of the encoded
+// cells and shapes); the cells and shapes themselves are fetched in batches
+// by Prefetch(), which also reads ahead a few neighboring cells:
+//
+//   EncodedS2ShapeIndexLoader loader(std::move(source));
+//   loader.Open([&](S2Error error) {
+//     if (!error.ok()) return Fail(error);
+//     loader.Prefetch(covering, [&](S2Error error) {
+//       if (!error.ok()) return Fail(error);
+//       RunQuery(loader.index());  // Does not wait for any I/O.
+//     });
+//   });
+//
+// Both methods report completion through a callback rather than blocking,
+// so that a server can suspend a request while its data is being fetched and
+// resume it afterwards without tying up a thread.  (The callback can also be
+// used to resume a coroutine.)
+//
+// Queries are always correct even if some of the data they need has not
+// been prefetched: the missing cells and shapes are then fetched on demand,
+// and the querying thread blocks until they arrive.  This means that queries
+// must not be run on a thread that the S2ByteSource needs in order to
+// complete its reads.  If an on-demand fetch fails, the affected cell or
+// shape is treated as undecodable.
+//
+// Fetched pages are kept until the loader is destroyed.  The memory for the
+// whole encoding is reserved up front, but on most operating systems it is
+// only committed as pages are written.
+//
+// This class is thread-safe.  The loader must outlive all pending callbacks
+// and all uses of index().
+class EncodedS2ShapeIndexLoader {
+ public:
+  class Options {
+   public:
+    Options() = default;
+
+    // The granularity at which data is fetched and tracked.  Adjacent pages
+    // that are needed at the same time are fetched with a single read.
+    //
+    // DEFAULT: 64 KiB
+    size_t page_size() const { return page_size_; }
+    void set_page_size(size_t page_size) { page_size_ = page_size; }
+
+    // The number of additional cells fetched on each side of every range of
+    // cells requested by Prefetch().  Neighboring cells are usually stored
+    // nearby, so reading ahead is cheap and often saves a round trip when a
+    // later query strays slightly outside the prefetched region.
+    //
+    // DEFAULT: 16
+    int readahead_cells() const { return readahead_cells_; }
+    void set_readahead_cells(int readahead_cells) {
+      readahead_cells_ = readahead_cells;
+    }
+
+   private:
+    size_t page_size_ = size_t{64} << 10;
+    int readahead_cells_ = 16;
+  };
+
+  // Called exactly once when an operation completes.
+  using DoneCallback = std::function<void(S2Error)>;
+
+  explicit EncodedS2ShapeIndexLoader(std::unique_ptr<S2ByteSource> source)
+      : EncodedS2ShapeIndexLoader(std::move(source), Options()) {}
+  EncodedS2ShapeIndexLoader(std::unique_ptr<S2ByteSource> source,
+                            const Options& options);
+  ~EncodedS2ShapeIndexLoader();
+
+  EncodedS2ShapeIndexLoader(const EncodedS2ShapeIndexLoader&) = delete;
+  EncodedS2ShapeIndexLoader& operator=(const EncodedS2ShapeIndexLoader&) =
+      delete;
+
+  const Options& options() const { return options_; }
+
+  // Fetches the index metadata and initializes index(), then calls "done".
+  //
+  // REQUIRES: Called once, before any other method.
+  void Open(DoneCallback done);
+
+  // Fetches the encoded cells that intersect "region" (plus readahead) and
+  // the shapes that those cells refer to, then calls "done".  The fetched
+  // data is decoded lazily by index() as usual.
+  //
+  // REQUIRES: Open() has completed successfully.
+  void Prefetch(const S2CellUnion& region, DoneCallback done);
+
+  // Returns the index.  Valid once Open() has completed successfully.
+  const EncodedS2ShapeIndex& index() const { return index_; }
+
+  // Returns the number of bytes fetched so far.
+  uint64_t bytes_loaded() const;
+
+  // Returns the number of reads issued to the S2ByteSource so far.
+  int64_t num_reads() const;
+
+ private:
+  class ShapeFactory;
+
+  // A range of bytes [begin, end) of the encoding.
+  struct Range {
+    uint64_t begin, end;
+  };
+
+  enum class PageState : uint8_t { kAbsent, kLoading, kLoaded };
+
+  // A call to Load() that is waiting for reads to complete.
+  struct PendingLoad {
+    std::vector<std::pair<size_t, size_t>> pages;  // [first, last) ranges.
+    DoneCallback done;
+  };
+
+  // Returns the range of bytes occupied by "data", which must point into
+  // data_.
+  Range RangeOf(absl::string_view data) const {
+    uint64_t begin = data.data() - data_.get();
+    return {begin, begin + data.size()};
+  }
+
+  // Fetches all pages that intersect the given ranges and are not already
+  // present, then calls "done".
+  void Load(const std::vector<Range>& ranges, DoneCallback done);
+
+  // Like Load(), but blocks until the data is present.  Returns false if it
+  // could not be fetched.
+  bool LoadSync(const std::vector<Range>& ranges);
+
+  // Issues a read for the pages [first, last).
+  void IssueRead(size_t first, size_t last);
+  void OnReadDone(size_t first, size_t last, S2Error error);
+
+  bool IsLoaded(const Range& range) const;
+  bool AllPagesLoaded(const PendingLoad& load) const
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  // Walks the metadata of the encoding using only the pages that have been
+  // fetched.  Returns true once all of the metadata is present.  Otherwise
+  // returns false and either sets "missing" to a range that must be fetched
+  // before trying again, or sets "error" if the encoding is invalid.
+  bool ParseMetadata(Range* missing, S2Error& error) const;
+
+  // Initializes index_ once all of the metadata is present.
+  S2Error InitIndex();
+
+  const Options options_;
+  std::unique_ptr<S2ByteSource> source_;
+  const uint64_t size_;
+
+  // A buffer for the whole encoding, of which only the pages in the
+  // kLoaded state are valid.
+  std::unique_ptr<char[]> data_;
+
+  // The encoded shapes and cells, used to locate the data of each one.
+  s2coding::EncodedStringVector encoded_shapes_;
+  s2coding::EncodedS2CellIdVector cell_ids_;
+  s2coding::EncodedStringVector encoded_cells_;
+
+  EncodedS2ShapeIndex index_;
+
+  mutable absl::Mutex mutex_;
+  std::vector<PageState> pages_ ABSL_GUARDED_BY(mutex_);
+  std::vector<PendingLoad> pending_ ABSL_GUARDED_BY(mutex_);
+  uint64_t bytes_loaded_ ABSL_GUARDED_BY(mutex_) = 0;
+  int64_t num_reads_ ABSL_GUARDED_BY(mutex_) = 0;
+};
+
+#endif  // S2_ENCODED_S2SHAPE_INDEX_LOADER_H_
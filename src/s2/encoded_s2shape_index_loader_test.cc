@@ -0,0 +1,248 @@
+// Copyright 2024 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "s2/encoded_s2shape_index_loader.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include "absl/synchronization/mutex.h"
+#include "absl/synchronization/notification.h"
+#include "s2/util/coding/coder.h"
+#include "s2/mutable_s2shape_index.h"
+#include "s2/s1angle.h"
+#include "s2/s2cell_id.h"
+#include "s2/s2cell_union.h"
+#include "s2/s2contains_point_query.h"
+#include "s2/s2error.h"
+#include "s2/s2lax_polygon_shape.h"
+#include "s2/s2loop.h"
+#include "s2/s2polygon.h"
+#include "s2/s2shapeutil_coding.h"
+#include "s2/s2shapeutil_testing.h"
+#include "s2/s2text_format.h"
+
+using std::make_unique;
+using std::string;
+using std::unique_ptr;
+using std::vector;
+
+namespace {
+
+// An S2ByteSource that reads from a string.  Reads complete either
+// immediately or on a separate thread.
+class StringByteSource final : public S2ByteSource {
+ public:
+  StringByteSource(string data, bool async)
+      : data_(std::move(data)), async_(async) {}
+
+  ~StringByteSource() override {
+    vector<std::thread> threads;
+    {
+      absl::MutexLock lock(&mutex_);
+      threads.swap(threads_);
+    }
+    for (auto& thread : threads) thread.join();
+  }
+
+  uint64_t size() const override { return data_.size(); }
+
+  void Read(uint64_t offset, size_t length, char* dst,
+            ReadCallback done) override {
+    auto read = [this, offset, length, dst, done]() {
+      std::memcpy(dst, data_.data() + offset, length);
+      done(S2Error::Ok());
+    };
+    if (!async_) {
+      read();
+      return;
+    }
+    absl::MutexLock lock(&mutex_);
+    threads_.emplace_back(read);
+  }
+
+ private:
+  const string data_;
+  const bool async_;
+  absl::Mutex mutex_;
+  vector<std::thread> threads_;
+};
+
+// An S2ByteSource whose reads always fail.
+class FailingByteSource final : public S2ByteSource {
+ public:
+  uint64_t size() const override { return 1000; }
+  void Read(uint64_t offset, size_t length, char* dst,
+            ReadCallback done) override {
+    done(S2Error::Unknown("Read failed"));
+  }
+};
+
+// Returns an index containing one loop centered on each cube face, and
+// stores its encoding (preceded by the encoded shapes) in "encoded".
+unique_ptr<MutableS2ShapeIndex> MakeIndex(string* encoded) {
+  auto index = make_unique<MutableS2ShapeIndex>();
+  s2testing::AddFaceLoops(1000, index.get());
+  *encoded = s2testing::CompactEncodeIndexAndShapes(*index);
+  return index;
+}
+
+// Opens the loader and waits for the result.
+S2Error Open(EncodedS2ShapeIndexLoader& loader) {
+  absl::Notification opened;
+  S2Error result;
+  loader.Open([&](S2Error error) {
+    result = std::move(error);
+    opened.Notify();
+  });
+  opened.WaitForNotification();
+  return result;
+}
+
+S2Error Prefetch(EncodedS2ShapeIndexLoader& loader,
+                 const S2CellUnion& region) {
+  absl::Notification prefetched;
+  S2Error result;
+  loader.Prefetch(region, [&](S2Error error) {
+    result = std::move(error);
+    prefetched.Notify();
+  });
+  prefetched.WaitForNotification();
+  return result;
+}
+
+EncodedS2ShapeIndexLoader::Options SmallPages() {
+  EncodedS2ShapeIndexLoader::Options options;
+  options.set_page_size(256);
+  options.set_readahead_cells(1);
+  return options;
+}
+
+TEST(EncodedS2ShapeIndexLoader, OpenFetchesOnlyMetadata) {
+  string encoded;
+  auto input = MakeIndex(&encoded);
+  EncodedS2ShapeIndexLoader loader(
+      make_unique<StringByteSource>(encoded, false), SmallPages());
+  ASSERT_TRUE(Open(loader).ok());
+  EXPECT_LT(loader.bytes_loaded(), encoded.size() / 4);
+
+  // Everything else is fetched on demand.
+  s2testing::ExpectEqual(*input, loader.index());
+  EXPECT_EQ(loader.bytes_loaded(), encoded.size());
+}
+
+TEST(EncodedS2ShapeIndexLoader, PrefetchedQueriesDoNotRead) {
+  string encoded;
+  auto input = MakeIndex(&encoded);
+  EncodedS2ShapeIndexLoader loader(
+      make_unique<StringByteSource>(encoded, false), SmallPages());
+  ASSERT_TRUE(Open(loader).ok());
+  S2Point center = S2CellId::FromFace(0).ToPoint();
+  ASSERT_TRUE(Prefetch(loader, S2CellUnion({S2CellId(center)})).ok());
+  const uint64_t bytes_loaded = loader.bytes_loaded();
+  const int64_t num_reads = loader.num_reads();
+  EXPECT_LT(bytes_loaded, encoded.size() / 2);
+
+  auto query = MakeS2ContainsPointQuery(&loader.index());
+  EXPECT_TRUE(query.Contains(center));
+  EXPECT_EQ(loader.bytes_loaded(), bytes_loaded);
+  EXPECT_EQ(loader.num_reads(), num_reads);
+
+  // Prefetching the same region again does not read anything either.
+  ASSERT_TRUE(Prefetch(loader, S2CellUnion({S2CellId(center)})).ok());
+  EXPECT_EQ(loader.num_reads(), num_reads);
+}
+
+TEST(EncodedS2ShapeIndexLoader, PrefetchInsideLargeIndexCell) {
+  // Face 0 contains only a small triangle, so its index cell is the whole
+  // face.  The id of that cell is greater than every id in the first half of
+  // the face, but prefetching a small cell in that half must still fetch the
+  // index cell and the triangle.
+  MutableS2ShapeIndex input;
+  for (int face = 1; face < 6; ++face) {
+    S2Polygon polygon(S2Loop::MakeRegularLoop(
+        S2CellId::FromFace(face).ToPoint(), S1Angle::Degrees(5), 1000));
+    input.Add(make_unique<S2LaxPolygonShape>(polygon));
+  }
+  input.Add(s2textformat::MakeLaxPolygonOrDie("0:0, 0:1, 1:0"));
+  Encoder encoder;
+  ASSERT_TRUE(s2shapeutil::CompactEncodeTaggedShapes(input, &encoder));
+  input.Encode(&encoder);
+  string encoded(encoder.base(), encoder.length());
+  EncodedS2ShapeIndexLoader::Options options = SmallPages();
+  options.set_readahead_cells(0);
+  EncodedS2ShapeIndexLoader loader(
+      make_unique<StringByteSource>(encoded, false), options);
+  ASSERT_TRUE(Open(loader).ok());
+  const S2CellId small = S2CellId::FromFace(0).child_begin(10);
+  ASSERT_TRUE(Prefetch(loader, S2CellUnion({small})).ok());
+  const int64_t num_reads = loader.num_reads();
+
+  auto query = MakeS2ContainsPointQuery(&loader.index());
+  EXPECT_FALSE(query.Contains(small.ToPoint()));
+  EXPECT_EQ(loader.num_reads(), num_reads);
+}
+
+TEST(EncodedS2ShapeIndexLoader, AsynchronousReads) {
+  string encoded;
+  auto input = MakeIndex(&encoded);
+  EncodedS2ShapeIndexLoader loader(
+      make_unique<StringByteSource>(encoded, true), SmallPages());
+  ASSERT_TRUE(Open(loader).ok());
+  ASSERT_TRUE(Prefetch(loader, S2CellUnion::WholeSphere()).ok());
+  EXPECT_EQ(loader.bytes_loaded(), encoded.size());
+  s2testing::ExpectEqual(*input, loader.index());
+}
+
+TEST(EncodedS2ShapeIndexLoader, ConcurrentOnDemandReads) {
+  string encoded;
+  MakeIndex(&encoded);
+  EncodedS2ShapeIndexLoader loader(
+      make_unique<StringByteSource>(encoded, true), SmallPages());
+  ASSERT_TRUE(Open(loader).ok());
+  vector<std::thread> threads;
+  for (int t = 0; t < 4; ++t) {
+    threads.emplace_back([&loader]() {
+      auto query = MakeS2ContainsPointQuery(&loader.index());
+      for (int face = 0; face < 6; ++face) {
+        S2CellId id = S2CellId::FromFace(face);
+        EXPECT_TRUE(query.Contains(id.ToPoint()));
+        EXPECT_FALSE(query.Contains(id.child(0).ToPoint()));
+      }
+    });
+  }
+  for (auto& thread : threads) thread.join();
+}
+
+TEST(EncodedS2ShapeIndexLoader, ReadErrorsAreReported) {
+  EncodedS2ShapeIndexLoader loader(make_unique<FailingByteSource>());
+  S2Error error = Open(loader);
+  EXPECT_EQ(error.code(), S2Error::UNKNOWN);
+}
+
+TEST(EncodedS2ShapeIndexLoader, InvalidData) {
+  EncodedS2ShapeIndexLoader loader(
+      make_unique<StringByteSource>("not an index", false));
+  EXPECT_FALSE(Open(loader).ok());
+}
+
+}  // namespace
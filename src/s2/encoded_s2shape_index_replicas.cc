@@ -0,0 +1,211 @@
+// Copyright 2024 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "s2/encoded_s2shape_index_replicas.h"
+
+#include <cstddef>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "absl/strings/numbers.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_split.h"
+#include "absl/strings/string_view.h"
+#include "s2/util/coding/coder.h"
+#include "s2/encoded_s2shape_index.h"
+#include "s2/s2error.h"
+#include "s2/s2shapeutil_coding.h"
+
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+using absl::string_view;
+using std::make_unique;
+using std::string;
+using std::unique_ptr;
+using std::vector;
+
+namespace {
+
+// The CPUs that belong to each NUMA node.  Nodes are numbered consecutively
+// from zero even if the operating system's node ids have gaps.
+struct NumaTopology {
+  vector<vector<int>> node_cpus;
+  vector<int> cpu_node;  // Indexed by CPU number; -1 if unknown.
+};
+
+// Parses a list in the Linux "cpulist" format (e.g., "0-3,8,10-11") and
+// appends its elements to "result".  Returns false on parse errors.
+bool ParseList(string_view str, vector<int>* result) {
+  for (string_view range : absl::StrSplit(str, ',', absl::SkipWhitespace())) {
+    std::pair<string_view, string_view> bounds = absl::StrSplit(range, '-');
+    int lo, hi;
+    if (!absl::SimpleAtoi(bounds.first, &lo)) return false;
+    if (bounds.second.empty()) {
+      hi = lo;
+    } else if (!absl::SimpleAtoi(bounds.second, &hi) || hi < lo) {
+      return false;
+    }
+    for (int i = lo; i <= hi; ++i) result->push_back(i);
+  }
+  return true;
+}
+
+// Reads the first line of the given file and parses it using ParseList().
+bool ReadList(const string& path, vector<int>* result) {
+  std::ifstream in(path);
+  string line;
+  return std::getline(in, line) && ParseList(line, result);
+}
+
+NumaTopology ReadNumaTopology() {
+  NumaTopology topology;
+#ifdef __linux__
+  vector<int> node_ids;
+  if (ReadList("/sys/devices/system/node/online", &node_ids)) {
+    for (int node_id : node_ids) {
+      vector<int> cpus;
+      if (!ReadList(absl::StrCat("/sys/devices/system/node/node", node_id,
+                                 "/cpulist"),
+                    &cpus) ||
+          cpus.empty()) {
+        continue;  // Skip memory-only nodes.
+      }
+      const int node = topology.node_cpus.size();
+      for (int cpu : cpus) {
+        if (cpu >= static_cast<int>(topology.cpu_node.size())) {
+          topology.cpu_node.resize(cpu + 1, -1);
+        }
+        topology.cpu_node[cpu] = node;
+      }
+      topology.node_cpus.push_back(std::move(cpus));
+    }
+  }
+#endif
+  if (topology.node_cpus.empty()) {
+    // The topology is unknown, so treat the machine as a single node.
+    topology.node_cpus.emplace_back();
+    topology.cpu_node.clear();
+  }
+  return topology;
+}
+
+const NumaTopology& GetNumaTopology() {
+  static const NumaTopology* const topology =
+      new NumaTopology(ReadNumaTopology());
+  return *topology;
+}
+
+// Restricts the calling thread to the CPUs of the given node, so that the
+// memory it allocates and initializes is placed on that node.  This is a
+// best-effort operation; failures are ignored.
+void BindCurrentThreadToNode(int node) {
+#ifdef __linux__
+  const vector<int>& cpus = GetNumaTopology().node_cpus[node];
+  if (cpus.empty()) return;
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  for (int cpu : cpus) {
+    if (cpu < CPU_SETSIZE) CPU_SET(cpu, &set);
+  }
+  sched_setaffinity(0, sizeof(set), &set);
+#endif
+}
+
+unique_ptr<EncodedS2ShapeIndex> MakeReplica(
+    string_view encoded, const EncodedS2ShapeIndexReplicas::Options& options,
+    S2Error& error) {
+  auto data = std::make_shared<const string>(encoded);
+  Decoder decoder(data->data(), data->size());
+  auto factory = s2shapeutil::LazyDecodeShapeFactory(&decoder, data, error);
+  if (!error.ok()) return nullptr;
+  auto index = make_unique<EncodedS2ShapeIndex>();
+  index->set_pad_decoded_cell_flags(options.pad_decoded_cell_flags());
+  if (!index->Init(&decoder, factory, data)) {
+    error = S2Error::DataLoss("Cannot decode EncodedS2ShapeIndex");
+    return nullptr;
+  }
+  if (options.freeze()) index->Freeze();
+  return index;
+}
+
+}  // namespace
+
+EncodedS2ShapeIndexReplicas::EncodedS2ShapeIndexReplicas(
+    const Options& options)
+    : options_(options) {}
+
+bool EncodedS2ShapeIndexReplicas::Init(string_view encoded, S2Error& error) {
+  replicas_.clear();
+  encoded_size_ = encoded.size();
+  const int num_nodes = NumNumaNodes();
+  const int n = options_.num_replicas() > 0 ? options_.num_replicas()
+                                            : num_nodes;
+
+  // Each replica is initialized by its own thread bound to the replica's
+  // node.  (The threads exit immediately afterwards.)
+  vector<unique_ptr<EncodedS2ShapeIndex>> replicas(n);
+  vector<S2Error> errors(n);
+  vector<std::thread> threads;
+  threads.reserve(n);
+  for (int i = 0; i < n; ++i) {
+    threads.emplace_back([&, i]() {
+      BindCurrentThreadToNode(i % num_nodes);
+      replicas[i] = MakeReplica(encoded, options_, errors[i]);
+    });
+  }
+  for (auto& thread : threads) thread.join();
+  for (const S2Error& replica_error : errors) {
+    if (!replica_error.ok()) {
+      error = replica_error;
+      return false;
+    }
+  }
+  replicas_ = std::move(replicas);
+  return true;
+}
+
+int EncodedS2ShapeIndexReplicas::local_replica() const {
+#ifdef __linux__
+  const vector<int>& cpu_node = GetNumaTopology().cpu_node;
+  const int cpu = sched_getcpu();
+  if (cpu >= 0 && cpu < static_cast<int>(cpu_node.size()) &&
+      cpu_node[cpu] >= 0) {
+    return cpu_node[cpu] % num_replicas();
+  }
+#endif
+  return 0;
+}
+
+void EncodedS2ShapeIndexReplicas::Minimize() {
+  for (auto& replica : replicas_) replica->Minimize();
+}
+
+size_t EncodedS2ShapeIndexReplicas::SpaceUsed() const {
+  size_t size = sizeof(*this) + replicas_.capacity() * sizeof(replicas_[0]);
+  for (const auto& replica : replicas_) {
+    size += replica->SpaceUsed() + encoded_size_;
+  }
+  return size;
+}
+
+int EncodedS2ShapeIndexReplicas::NumNumaNodes() {
+  return GetNumaTopology().node_cpus.size();
+}
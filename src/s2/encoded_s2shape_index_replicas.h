@@ -0,0 +1,142 @@
+// Copyright 2024 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef S2_ENCODED_S2SHAPE_INDEX_REPLICAS_H_
+#define S2_ENCODED_S2SHAPE_INDEX_REPLICAS_H_
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+#include "absl/strings/string_view.h"
+#include "s2/encoded_s2shape_index.h"
+#include "s2/s2error.h"
+
+// EncodedS2ShapeIndexReplicas holds several identical read-only copies of an
+// encoded S2ShapeIndex, one per NUMA node by default, so that threads on
+// multi-socket machines can query a copy that lives in memory local to the
+// CPU they are running on.
+//
+// Each replica has its own copy of the encoded data and its own caches of
+// decoded cells and shapes.  Replicas are initialized by threads running on
+// the corresponding NUMA node, so that the operating system's first-touch
+// policy places each copy of the encoded data on that node.  Cells and
+// shapes are decoded lazily by whichever threads query the replica, which
+// are normally threads on the same node.
+//
+// The encoded data must consist of the shapes encoded by
+// s2shapeutil::CompactEncodeTaggedShapes() followed by the index encoded by
+// S2ShapeIndex::Encode(), e.g. the contents of an S2MemoryMappedFile.
+//
+// Example usage:
+//
+//   auto file = S2MemoryMappedFile::Open(path, error);
+//   EncodedS2ShapeIndexReplicas replicas;
+//   if (!replicas.Init({file->data(), file->size()}, error)) ...
+//
+//   // Query threads:
+//   auto query = MakeS2ContainsPointQuery(&replicas.local());
+//   ... query.Contains(point) ...
+//
+// Note that a query object must be constructed from local() (rather than
+// calling local() for every operation) because the query keeps iterators
+// into a single replica.  Threads that migrate to another node continue to
+// get correct results, just with remote memory accesses.
+//
+// This class is thread-compatible: const methods may be called concurrently
+// from any number of threads, but Init() and Minimize() may not.
+class EncodedS2ShapeIndexReplicas {
+ public:
+  class Options {
+   public:
+    Options() = default;
+
+    // The number of replicas to create.  Replica "i" is placed on NUMA node
+    // (i % NumNumaNodes()), and threads on node "n" use replica
+    // (n % num_replicas()).  A value of zero creates one replica per node.
+    //
+    // DEFAULT: 0
+    int num_replicas() const { return num_replicas_; }
+    void set_num_replicas(int num_replicas) { num_replicas_ = num_replicas; }
+
+    // If true, each replica is fully decoded (on its own node) and frozen
+    // during Init(), so that queries never decode anything and never touch
+    // the decoded cell flags (see EncodedS2ShapeIndex::Freeze).  This uses
+    // more memory but gives the most predictable query latency.
+    //
+    // DEFAULT: false
+    bool freeze() const { return freeze_; }
+    void set_freeze(bool freeze) { freeze_ = freeze; }
+
+    // Passed to EncodedS2ShapeIndex::set_pad_decoded_cell_flags() for each
+    // replica.
+    //
+    // DEFAULT: false
+    bool pad_decoded_cell_flags() const { return pad_decoded_cell_flags_; }
+    void set_pad_decoded_cell_flags(bool pad) { pad_decoded_cell_flags_ = pad; }
+
+   private:
+    int num_replicas_ = 0;
+    bool freeze_ = false;
+    bool pad_decoded_cell_flags_ = false;
+  };
+
+  EncodedS2ShapeIndexReplicas() = default;
+  explicit EncodedS2ShapeIndexReplicas(const Options& options);
+
+  EncodedS2ShapeIndexReplicas(const EncodedS2ShapeIndexReplicas&) = delete;
+  EncodedS2ShapeIndexReplicas& operator=(const EncodedS2ShapeIndexReplicas&) =
+      delete;
+
+  const Options& options() const { return options_; }
+
+  // Creates the replicas from the given encoded data, which is copied and
+  // need not outlive this call.  Returns false and sets "error" if the data
+  // cannot be decoded, in which case there are no replicas.
+  bool Init(absl::string_view encoded, S2Error& error);
+
+  // Returns the number of replicas (zero before Init() succeeds).
+  int num_replicas() const { return replicas_.size(); }
+
+  // Returns the given replica.
+  //
+  // REQUIRES: 0 <= i < num_replicas()
+  const EncodedS2ShapeIndex& replica(int i) const { return *replicas_[i]; }
+
+  // Returns the replica that should be used by the calling thread, i.e. the
+  // one placed on the NUMA node of the CPU that the thread is running on.
+  //
+  // REQUIRES: num_replicas() > 0
+  const EncodedS2ShapeIndex& local() const { return replica(local_replica()); }
+  int local_replica() const;
+
+  // Calls Minimize() on every replica.  (This also unfreezes them.)
+  void Minimize();
+
+  // Returns the total number of bytes used by all replicas, including their
+  // copies of the encoded data.
+  size_t SpaceUsed() const;
+
+  // Returns the number of NUMA nodes on this machine, or 1 if the topology
+  // is unknown (e.g., on platforms other than Linux).
+  static int NumNumaNodes();
+
+ private:
+  Options options_;
+  std::vector<std::unique_ptr<EncodedS2ShapeIndex>> replicas_;
+  size_t encoded_size_ = 0;
+};
+
+#endif  // S2_ENCODED_S2SHAPE_INDEX_REPLICAS_H_
@@ -0,0 +1,132 @@
+// Copyright 2024 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "s2/encoded_s2shape_index_replicas.h"
+
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include "s2/mutable_s2shape_index.h"
+#include "s2/s2cell_id.h"
+#include "s2/s2contains_point_query.h"
+#include "s2/s2error.h"
+#include "s2/s2shapeutil_testing.h"
+
+using std::make_unique;
+using std::string;
+using std::vector;
+
+namespace {
+
+// Returns an index containing one small loop centered on each cube face,
+// and stores its encoding in "encoded".
+std::unique_ptr<MutableS2ShapeIndex> MakeIndex(string* encoded) {
+  auto index = make_unique<MutableS2ShapeIndex>();
+  s2testing::AddFaceLoops(100, index.get());
+  *encoded = s2testing::CompactEncodeIndexAndShapes(*index);
+  return index;
+}
+
+TEST(EncodedS2ShapeIndexReplicas, DefaultIsOneReplicaPerNode) {
+  EXPECT_GE(EncodedS2ShapeIndexReplicas::NumNumaNodes(), 1);
+  string encoded;
+  auto input = MakeIndex(&encoded);
+  EncodedS2ShapeIndexReplicas replicas;
+  EXPECT_EQ(replicas.num_replicas(), 0);
+  S2Error error;
+  ASSERT_TRUE(replicas.Init(encoded, error)) << error;
+  EXPECT_EQ(replicas.num_replicas(),
+            EncodedS2ShapeIndexReplicas::NumNumaNodes());
+  s2testing::ExpectEqual(*input, replicas.local());
+}
+
+TEST(EncodedS2ShapeIndexReplicas, ReplicasAreIndependentCopies) {
+  string encoded;
+  auto input = MakeIndex(&encoded);
+  EncodedS2ShapeIndexReplicas::Options options;
+  options.set_num_replicas(3);
+  EncodedS2ShapeIndexReplicas replicas(options);
+  S2Error error;
+  ASSERT_TRUE(replicas.Init(encoded, error)) << error;
+  encoded.clear();  // The replicas have their own copies.
+  ASSERT_EQ(replicas.num_replicas(), 3);
+  for (int i = 0; i < 3; ++i) {
+    s2testing::ExpectEqual(*input, replicas.replica(i));
+    EXPECT_FALSE(replicas.replica(i).is_frozen());
+    for (int j = 0; j < i; ++j) {
+      EXPECT_NE(replicas.replica(i).shape(0), replicas.replica(j).shape(0));
+    }
+  }
+  EXPECT_GE(replicas.local_replica(), 0);
+  EXPECT_LT(replicas.local_replica(), 3);
+  EXPECT_GT(replicas.SpaceUsed(), 3 * replicas.replica(0).SpaceUsed());
+}
+
+TEST(EncodedS2ShapeIndexReplicas, Freeze) {
+  string encoded;
+  auto input = MakeIndex(&encoded);
+  EncodedS2ShapeIndexReplicas::Options options;
+  options.set_num_replicas(2);
+  options.set_freeze(true);
+  options.set_pad_decoded_cell_flags(true);
+  EncodedS2ShapeIndexReplicas replicas(options);
+  S2Error error;
+  ASSERT_TRUE(replicas.Init(encoded, error)) << error;
+  for (int i = 0; i < 2; ++i) {
+    EXPECT_TRUE(replicas.replica(i).is_frozen());
+    EXPECT_TRUE(replicas.replica(i).pad_decoded_cell_flags());
+    s2testing::ExpectEqual(*input, replicas.replica(i));
+  }
+  replicas.Minimize();
+  for (int i = 0; i < 2; ++i) {
+    EXPECT_FALSE(replicas.replica(i).is_frozen());
+    s2testing::ExpectEqual(*input, replicas.replica(i));
+  }
+}
+
+TEST(EncodedS2ShapeIndexReplicas, ConcurrentQueries) {
+  string encoded;
+  auto input = MakeIndex(&encoded);
+  EncodedS2ShapeIndexReplicas::Options options;
+  options.set_num_replicas(2);
+  EncodedS2ShapeIndexReplicas replicas(options);
+  S2Error error;
+  ASSERT_TRUE(replicas.Init(encoded, error)) << error;
+  vector<std::thread> threads;
+  for (int t = 0; t < 4; ++t) {
+    threads.emplace_back([&replicas]() {
+      auto query = MakeS2ContainsPointQuery(&replicas.local());
+      for (int face = 0; face < 6; ++face) {
+        S2CellId id = S2CellId::FromFace(face);
+        EXPECT_TRUE(query.Contains(id.ToPoint()));
+        EXPECT_FALSE(query.Contains(id.child(0).ToPoint()));
+      }
+    });
+  }
+  for (auto& thread : threads) thread.join();
+}
+
+TEST(EncodedS2ShapeIndexReplicas, InvalidData) {
+  EncodedS2ShapeIndexReplicas replicas;
+  S2Error error;
+  EXPECT_FALSE(replicas.Init("not an index", error));
+  EXPECT_FALSE(error.ok());
+  EXPECT_EQ(replicas.num_replicas(), 0);
+}
+
+}  // namespace
@@ -18,8 +18,11 @@
 #include "s2/encoded_s2shape_index.h"
 
 #include <algorithm>
+#include <atomic>
 #include <cstddef>
+#include <cstdio>
 #include <cstring>
+#include <fstream>
 #include <memory>
 #include <random>
 #include <utility>
@@ -34,6 +37,7 @@
 #include "absl/random/random.h"
 #include "absl/strings/escaping.h"
 #include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
 #include "s2/util/coding/coder.h"
 #include "s2/mutable_s2shape_index.h"
 #include "s2/s1angle.h"
@@ -43,6 +47,7 @@
 #include "s2/s2builderutil_snap_functions.h"
 #include "s2/s2cap.h"
 #include "s2/s2cell_id.h"
+#include "s2/s2cell_union.h"
 #include "s2/s2closest_edge_query.h"
 #include "s2/s2coder.h"
 #include "s2/s2contains_point_query.h"
@@ -53,6 +58,7 @@
 #include "s2/s2lax_polygon_shape.h"
 #include "s2/s2lax_polyline_shape.h"
 #include "s2/s2loop.h"
+#include "s2/s2memory_mapped_file.h"
 #include "s2/s2point.h"
 #include "s2/s2point_vector_shape.h"
 #include "s2/s2pointutil.h"
@@ -60,10 +66,13 @@
 #include "s2/s2polyline.h"
 #include "s2/s2random.h"
 #include "s2/s2shape.h"
+#include "s2/s2shape_index_measures.h"
+#include "s2/s2shape_metadata.h"
 #include "s2/s2shapeutil_coding.h"
 #include "s2/s2shapeutil_testing.h"
 #include "s2/s2testing.h"
 #include "s2/s2text_format.h"
+#include "s2/s2wrapped_shape.h"
 #include "s2/thread_testing.h"
 #include "s2/util/math/matrix3x3.h"
 #include "s2/util/random/shared_bit_gen.h"
@@ -298,7 +307,9 @@ TEST(EncodedS2ShapeIndex, SnappedFractalPolylines) {
 // concurrently with the const methods.
 class LazyDecodeTest : public s2testing::ReaderWriterTest {
  public:
-  LazyDecodeTest() {
+  explicit LazyDecodeTest(int max_decoded_shapes = -1,
+                          bool pad_decoded_cell_flags = false,
+                          bool reclaim_evicted_shapes = false) {
     // We generate one shape per dimension.  Each shape has vertices uniformly
     // distributed across the sphere, and the vertices for each dimension are
     // different.  Having fewer cells in the index is more likely to trigger
@@ -327,8 +338,11 @@ class LazyDecodeTest : public s2testing::ReaderWriterTest {
     encoded_.assign(encoder.base(), encoder.length());
 
     Decoder decoder(encoded_.data(), encoded_.size());
+    index_.set_pad_decoded_cell_flags(pad_decoded_cell_flags);
     ABSL_CHECK(
         index_.Init(&decoder, s2shapeutil::LazyDecodeShapeFactory(&decoder)));
+    index_.set_max_decoded_shapes(max_decoded_shapes);
+    index_.set_reclaim_evicted_shapes(reclaim_evicted_shapes);
   }
 
   void WriteOp() override {
@@ -337,6 +351,7 @@ class LazyDecodeTest : public s2testing::ReaderWriterTest {
 
   void ReadOp() override {
     util_random::SharedBitGen bitgen;
+    EncodedS2ShapeIndex::ReaderScope scope(index_);
     S2ClosestEdgeQuery query(&index_);
     for (int iter = 0; iter < 10; ++iter) {
       S2ClosestEdgeQuery::PointTarget target(s2random::Point(bitgen));
@@ -362,6 +377,404 @@ TEST(EncodedS2ShapeIndex, LazyDecode) {
   test.Run(kNumReaders, kIters);
 }
 
+// A shape that owns another shape and counts the number of live instances.
+class LiveCountedShape : public S2WrappedShape {
+ public:
+  LiveCountedShape(unique_ptr<S2Shape> shape, std::atomic<int>* num_live)
+      : S2WrappedShape(shape.get()),
+        shape_(std::move(shape)),
+        num_live_(num_live) {
+    num_live_->fetch_add(1, std::memory_order_relaxed);
+  }
+  ~LiveCountedShape() override {
+    num_live_->fetch_sub(1, std::memory_order_relaxed);
+  }
+
+ private:
+  unique_ptr<S2Shape> shape_;
+  std::atomic<int>* num_live_;
+};
+
+// A ShapeFactory that counts the number of shapes decoded by all of its
+// copies.  If "num_live" is non-null, it also counts the number of decoded
+// shapes that have not been deleted yet.
+class CountingShapeFactory : public S2ShapeIndex::ShapeFactory {
+ public:
+  CountingShapeFactory(const ShapeFactory& base, std::atomic<int>* count,
+                       std::atomic<int>* num_live = nullptr)
+      : base_(base.Clone()), count_(count), num_live_(num_live) {}
+
+  int size() const override { return base_->size(); }
+
+  unique_ptr<S2Shape> operator[](int shape_id) const override {
+    count_->fetch_add(1, std::memory_order_relaxed);
+    unique_ptr<S2Shape> shape = (*base_)[shape_id];
+    if (num_live_ == nullptr || shape == nullptr) return shape;
+    return make_unique<LiveCountedShape>(std::move(shape), num_live_);
+  }
+
+  unique_ptr<ShapeFactory> Clone() const override {
+    return make_unique<CountingShapeFactory>(*base_, count_, num_live_);
+  }
+
+ private:
+  unique_ptr<ShapeFactory> base_;
+  std::atomic<int>* count_;
+  std::atomic<int>* num_live_;
+};
+
+TEST(EncodedS2ShapeIndex, PrefetchAndDecodeAll) {
+  MutableS2ShapeIndex input;
+  s2testing::AddFaceLoops(100, &input);
+  const string encoded = s2testing::CompactEncodeIndexAndShapes(input);
+
+  for (int num_threads : {1, 4}) {
+    // Prefetching a region decodes only the shapes that intersect it.
+    std::atomic<int> count = 0;
+    Decoder decoder(encoded.data(), encoded.size());
+    EncodedS2ShapeIndex index;
+    ASSERT_TRUE(index.Init(
+        &decoder, CountingShapeFactory(
+                      s2shapeutil::LazyDecodeShapeFactory(&decoder), &count)));
+    index.Prefetch(S2CellUnion(), num_threads);
+    EXPECT_EQ(count, 0);
+    index.Prefetch(S2CellUnion({S2CellId::FromFace(2).child(1)}), num_threads);
+    EXPECT_EQ(count, 1);
+    index.Prefetch(S2CellUnion({S2CellId::FromFace(2), S2CellId::FromFace(4)}),
+                   num_threads);
+    EXPECT_EQ(count, 2);
+
+    // DecodeAll() decodes the remaining shapes, and calling it again has no
+    // effect.
+    index.DecodeAll(num_threads);
+    EXPECT_EQ(count, 6);
+    index.DecodeAll(num_threads);
+    EXPECT_EQ(count, 6);
+    s2testing::ExpectEqual(input, index);
+  }
+}
+
+TEST(EncodedS2ShapeIndex, DecodeRegion) {
+  MutableS2ShapeIndex input;
+  s2testing::AddFaceLoops(100, &input);
+  const string encoded = s2testing::CompactEncodeIndexAndShapes(input);
+
+  std::atomic<int> count = 0;
+  Decoder decoder(encoded.data(), encoded.size());
+  EncodedS2ShapeIndex index;
+  ASSERT_TRUE(index.Init(
+      &decoder, CountingShapeFactory(
+                    s2shapeutil::LazyDecodeShapeFactory(&decoder), &count)));
+
+  // Only the shape near the center of face 2 is decoded.
+  S2Error error;
+  Decoder shape_decoder(encoded.data(), encoded.size());
+  auto factory = s2shapeutil::FullDecodeShapeFactory(&shape_decoder, error);
+  ASSERT_TRUE(error.ok()) << error;
+  const S2Point center = S2CellId::FromFace(2).ToPoint();
+  auto region = index.DecodeRegion(
+      S2CellUnion({S2CellId(center).parent(10)}), factory);
+  ASSERT_NE(region, nullptr);
+  EXPECT_EQ(count, 0);
+  ASSERT_EQ(region->num_shape_ids(), 6);
+  for (int id = 0; id < 6; ++id) {
+    EXPECT_EQ(region->shape(id) != nullptr, id == 2);
+  }
+  EXPECT_LT(region->SpaceUsed(), input.SpaceUsed());
+
+  // Queries within the region give the same results as the full index.
+  auto query = MakeS2ContainsPointQuery(region.get());
+  EXPECT_TRUE(query.Contains(center));
+  EXPECT_FALSE(query.Contains(S2CellId::FromFace(2).child(0).ToPoint()));
+
+  // An empty region produces an empty index.
+  auto empty = index.DecodeRegion(S2CellUnion(), factory);
+  ASSERT_NE(empty, nullptr);
+  EXPECT_TRUE(MutableS2ShapeIndex::Iterator(empty.get(), S2ShapeIndex::BEGIN)
+                  .done());
+}
+
+TEST(EncodedS2ShapeIndex, DecodeRegionInsideLargeIndexCell) {
+  // An index with a single edge has one cell covering the whole face.  The
+  // id of that cell is greater than every id in the first half of the face,
+  // but it still needs to be found for a small region cell in that half.
+  auto input = s2textformat::MakeIndexOrDie("# 0:0, 0:1 #");
+  Encoder encoder;
+  ASSERT_TRUE(s2shapeutil::CompactEncodeTaggedShapes(*input, &encoder));
+  input->Encode(&encoder);
+  Decoder decoder(encoder.base(), encoder.length());
+  EncodedS2ShapeIndex index;
+  ASSERT_TRUE(
+      index.Init(&decoder, s2shapeutil::LazyDecodeShapeFactory(&decoder)));
+  EncodedS2ShapeIndex::Iterator it(&index, S2ShapeIndex::BEGIN);
+  ASSERT_EQ(it.id(), S2CellId::FromFace(0));
+
+  const S2CellId small = S2CellId::FromFace(0).child_begin(10);
+  ASSERT_LT(small.range_max(), it.id());
+  S2Error error;
+  Decoder shape_decoder(encoder.base(), encoder.length());
+  auto factory = s2shapeutil::FullDecodeShapeFactory(&shape_decoder, error);
+  ASSERT_TRUE(error.ok()) << error;
+  auto region = index.DecodeRegion(S2CellUnion({small}), factory);
+  ASSERT_NE(region, nullptr);
+  ASSERT_EQ(region->num_shape_ids(), 1);
+  EXPECT_NE(region->shape(0), nullptr);
+  MutableS2ShapeIndex::Iterator region_it(region.get(), S2ShapeIndex::BEGIN);
+  ASSERT_FALSE(region_it.done());
+  EXPECT_EQ(region_it.id(), S2CellId::FromFace(0));
+}
+
+TEST(EncodedS2ShapeIndex, ShapeMetadataWithoutDecodingShapes) {
+  MutableS2ShapeIndex::Options options;
+  options.set_cache_shape_metadata(true);
+  MutableS2ShapeIndex input(options);
+  s2testing::AddFaceLoops(100, &input);
+  const string encoded = s2testing::CompactEncodeIndexAndShapes(input);
+
+  // The metadata, and the measures that use it, are available without
+  // decoding any shapes.
+  std::atomic<int> count = 0;
+  Decoder decoder(encoded.data(), encoded.size());
+  EncodedS2ShapeIndex index;
+  ASSERT_TRUE(index.Init(
+      &decoder, CountingShapeFactory(
+                    s2shapeutil::LazyDecodeShapeFactory(&decoder), &count)));
+  EXPECT_TRUE(index.options().cache_shape_metadata());
+  for (int id = 0; id < input.num_shape_ids(); ++id) {
+    S2ShapeMetadata expected, actual;
+    ASSERT_TRUE(input.GetShapeMetadata(id, &expected));
+    ASSERT_TRUE(index.GetShapeMetadata(id, &actual));
+    EXPECT_EQ(expected.bound, actual.bound);
+    EXPECT_EQ(expected.area, actual.area);
+    EXPECT_EQ(expected.centroid, actual.centroid);
+  }
+  EXPECT_EQ(S2::GetArea(input), S2::GetArea(index));
+  EXPECT_EQ(S2::GetCentroid(input), S2::GetCentroid(index));
+  EXPECT_EQ(count, 0);
+
+  // Re-encoding the index preserves the metadata.
+  Encoder reencoded;
+  index.Encode(&reencoded);
+  Encoder expected_encoder;
+  input.Encode(&expected_encoder);
+  EXPECT_EQ(
+      absl::string_view(expected_encoder.base(), expected_encoder.length()),
+      absl::string_view(reencoded.base(), reencoded.length()));
+}
+
+TEST(EncodedS2ShapeIndex, MaxDecodedShapes) {
+  MutableS2ShapeIndex input;
+  s2testing::AddFaceLoops(100, &input);
+  const string encoded = s2testing::CompactEncodeIndexAndShapes(input);
+
+  std::atomic<int> count = 0;
+  Decoder decoder(encoded.data(), encoded.size());
+  EncodedS2ShapeIndex index;
+  index.set_max_decoded_shapes(2);
+  EXPECT_EQ(index.max_decoded_shapes(), 2);
+  ASSERT_TRUE(index.Init(
+      &decoder, CountingShapeFactory(
+                    s2shapeutil::LazyDecodeShapeFactory(&decoder), &count)));
+
+  // Shapes that are accessed repeatedly stay decoded.
+  for (int iter = 0; iter < 3; ++iter) {
+    EXPECT_EQ(index.shape(0)->num_edges(), 100);
+    EXPECT_EQ(index.shape(1)->num_edges(), 100);
+  }
+  EXPECT_EQ(count, 2);
+
+  // Decoding more shapes evicts older ones, so that decoding all shapes a
+  // second time decodes at least 6 - 2 of them again.
+  for (int id = 0; id < 6; ++id) index.shape(id);
+  EXPECT_EQ(count, 6);
+  index.ReleaseEvictedShapes();
+  for (int id = 0; id < 6; ++id) index.shape(id);
+  EXPECT_GE(count, 10);
+
+  // Evicted shapes are decoded again as needed.
+  s2testing::ExpectEqual(input, index);
+
+  // Removing the limit stops evictions.
+  index.set_max_decoded_shapes(-1);
+  index.DecodeAll();
+  const int num_decoded = count;
+  index.DecodeAll();
+  s2testing::ExpectEqual(input, index);
+  EXPECT_EQ(count, num_decoded);
+}
+
+TEST(EncodedS2ShapeIndex, LazyDecodeWithEviction) {
+  // Like the test above, but shapes are also evicted while other threads are
+  // using them.
+  LazyDecodeTest test(1 /*max_decoded_shapes*/);
+  constexpr int kNumReaders = 8;
+  constexpr int kIters = 1000;
+  test.Run(kNumReaders, kIters);
+}
+
+TEST(EncodedS2ShapeIndex, ReclaimEvictedShapes) {
+  // Create an index with one single-point shape per level 2 cell.
+  MutableS2ShapeIndex input;
+  for (auto id = S2CellId::Begin(2); id != S2CellId::End(2); id = id.next()) {
+    input.Add(make_unique<S2PointVectorShape>(vector<S2Point>{id.ToPoint()}));
+  }
+  const string encoded = s2testing::CompactEncodeIndexAndShapes(input);
+  const int num_shapes = input.num_shape_ids();
+  constexpr int kMaxDecodedShapes = 4;
+
+  for (bool reclaim : {false, true}) {
+    std::atomic<int> count = 0, num_live = 0;
+    Decoder decoder(encoded.data(), encoded.size());
+    EncodedS2ShapeIndex index;
+    S2Error error;
+    auto factory = s2shapeutil::LazyDecodeShapeFactory(&decoder, error);
+    ASSERT_TRUE(error.ok()) << error;
+    ASSERT_TRUE(index.Init(
+        &decoder, CountingShapeFactory(factory, &count, &num_live)));
+    index.set_max_decoded_shapes(kMaxDecodedShapes);
+    index.set_reclaim_evicted_shapes(reclaim);
+
+    // Access the shapes round-robin, so that every access evicts a shape.
+    int max_live = 0;
+    for (int iter = 0; iter < 20 * num_shapes; ++iter) {
+      EncodedS2ShapeIndex::ReaderScope scope(index);
+      EXPECT_EQ(index.shape(iter % num_shapes)->num_edges(), 1);
+      max_live = max(max_live, num_live.load());
+    }
+    EXPECT_GE(count, 20 * num_shapes);
+    if (reclaim) {
+      EXPECT_LE(max_live, kMaxDecodedShapes + 2);
+    } else {
+      // Without reclamation, every evicted shape is kept until
+      // ReleaseEvictedShapes() is called.
+      EXPECT_EQ(max_live, count);
+      index.ReleaseEvictedShapes();
+      EXPECT_EQ(num_live, kMaxDecodedShapes);
+    }
+  }
+}
+
+TEST(EncodedS2ShapeIndex, ReaderScopeDelaysReclamation) {
+  MutableS2ShapeIndex input;
+  s2testing::AddFaceLoops(100, &input);
+  const string encoded = s2testing::CompactEncodeIndexAndShapes(input);
+
+  std::atomic<int> count = 0, num_live = 0;
+  Decoder decoder(encoded.data(), encoded.size());
+  EncodedS2ShapeIndex index;
+  S2Error error;
+  auto factory = s2shapeutil::LazyDecodeShapeFactory(&decoder, error);
+  ASSERT_TRUE(error.ok()) << error;
+  ASSERT_TRUE(index.Init(
+      &decoder, CountingShapeFactory(factory, &count, &num_live)));
+  index.set_max_decoded_shapes(1);
+  index.set_reclaim_evicted_shapes(true);
+
+  // Shapes evicted while a scope exists are not deleted until it is gone.
+  {
+    EncodedS2ShapeIndex::ReaderScope scope(index);
+    const S2Shape* shape = index.shape(0);
+    for (int iter = 0; iter < 3; ++iter) {
+      for (int id = 1; id < 6; ++id) {
+        EncodedS2ShapeIndex::ReaderScope inner_scope(index);
+        index.shape(id);
+      }
+    }
+    EXPECT_EQ(shape->num_edges(), 100);
+    EXPECT_GT(num_live, 3);
+  }
+  // Once all scopes have ended, later evictions delete them.
+  for (int id = 0; id < 6; ++id) {
+    EncodedS2ShapeIndex::ReaderScope scope(index);
+    index.shape(id);
+  }
+  EXPECT_LE(num_live, 3);
+}
+
+TEST(EncodedS2ShapeIndex, LazyDecodeWithReclamation) {
+  // Like LazyDecodeWithEviction, but evicted shapes are deleted while other
+  // threads are still reading the index.
+  LazyDecodeTest test(1 /*max_decoded_shapes*/,
+                      false /*pad_decoded_cell_flags*/,
+                      true /*reclaim_evicted_shapes*/);
+  constexpr int kNumReaders = 8;
+  constexpr int kIters = 1000;
+  test.Run(kNumReaders, kIters);
+}
+
+TEST(EncodedS2ShapeIndex, LazyDecodeWithPaddedFlags) {
+  LazyDecodeTest test(-1 /*max_decoded_shapes*/,
+                      true /*pad_decoded_cell_flags*/);
+  constexpr int kNumReaders = 8;
+  constexpr int kIters = 1000;
+  test.Run(kNumReaders, kIters);
+}
+
+TEST(EncodedS2ShapeIndex, Freeze) {
+  MutableS2ShapeIndex input;
+  s2testing::AddFaceLoops(100, &input);
+  const string encoded = s2testing::CompactEncodeIndexAndShapes(input);
+
+  for (bool pad : {false, true}) {
+    Decoder decoder(encoded.data(), encoded.size());
+    EncodedS2ShapeIndex index;
+    index.set_pad_decoded_cell_flags(pad);
+    EXPECT_EQ(index.pad_decoded_cell_flags(), pad);
+    ASSERT_TRUE(
+        index.Init(&decoder, s2shapeutil::LazyDecodeShapeFactory(&decoder)));
+    EXPECT_FALSE(index.is_frozen());
+    s2testing::ExpectEqual(input, index);
+
+    // Freezing decodes everything, and the frozen index is unchanged.
+    index.Minimize();
+    index.Freeze(4 /*num_threads*/);
+    EXPECT_TRUE(index.is_frozen());
+    s2testing::ExpectEqual(input, index);
+
+    // Minimize() discards the decoded cells and unfreezes the index.
+    index.Minimize();
+    EXPECT_FALSE(index.is_frozen());
+    s2testing::ExpectEqual(input, index);
+  }
+}
+
+TEST(EncodedS2ShapeIndex, MemoryMappedFile) {
+  // Checks that an index can be decoded directly from a region of a file, and
+  // that the index keeps the mapping alive after the caller releases it.
+  MutableS2ShapeIndex expected;
+  expected.Add(make_unique<S2PointVectorShape>(
+      s2textformat::ParsePointsOrDie("0:0, 1:1")));
+  expected.Add(s2textformat::MakeLaxPolylineOrDie("0:0, 5:5, 10:0"));
+  expected.Add(s2textformat::MakeLaxPolygonOrDie("0:0, 0:10, 10:10, 10:0"));
+  Encoder encoder;
+  ASSERT_TRUE(s2shapeutil::CompactEncodeTaggedShapes(expected, &encoder));
+  expected.Encode(&encoder);
+
+  // Place the encoded index after some unrelated data so that it does not
+  // start at the beginning of the file.
+  const string prefix(5000, 'x');
+  const string path = StrCat(testing::TempDir(), "/encoded_index");
+  {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out << prefix;
+    out.write(encoder.base(), encoder.length());
+  }
+  S2Error error;
+  auto file = S2MemoryMappedFile::Open(path, error, prefix.size());
+  ASSERT_NE(file, nullptr) << error;
+  ASSERT_EQ(file->size(), encoder.length());
+
+  EncodedS2ShapeIndex actual;
+  Decoder decoder(file->data(), file->size());
+  ASSERT_TRUE(actual.Init(
+      &decoder, s2shapeutil::LazyDecodeShapeFactory(&decoder, file, error),
+      file));
+  ASSERT_TRUE(error.ok()) << error;
+  file.reset();
+  std::remove(path.c_str());  // The mapping remains valid.
+  s2testing::ExpectEqual(expected, actual);
+}
+
 TEST(EncodedS2ShapeIndex, JavaByteCompatibility) {
   MutableS2ShapeIndex expected;
   expected.Add(make_unique<S2Polyline::OwningShape>(
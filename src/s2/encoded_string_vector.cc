@@ -17,15 +17,20 @@
 
 #include "s2/encoded_string_vector.h"
 
+#include <algorithm>
+#include <atomic>
 #include <cstddef>
 #include <cstdint>
 #include <string>
 #include <vector>
 
+#include "absl/functional/function_ref.h"
+#include "absl/log/absl_check.h"
 #include "absl/strings/string_view.h"
 #include "absl/types/span.h"
 #include "s2/util/coding/coder.h"
 #include "s2/encoded_uint_vector.h"
+#include "s2/internal/s2parallel.h"
 
 using absl::MakeSpan;
 using absl::Span;
@@ -53,6 +58,90 @@ void StringVectorEncoder::Encode(Span<const string> v, Encoder* encoder) {
   string_vector.Encode(encoder);
 }
 
+bool StringVectorEncoder::EncodeStreaming(
+    size_t n, absl::FunctionRef<bool(size_t, Encoder*)> encode_string,
+    EncodedDataSink sink) {
+  // The first pass computes the offsets.  As in Encode(), the initial zero
+  // offset is not stored.
+  vector<uint64_t> offsets;
+  offsets.reserve(n);
+  Encoder buffer;
+  uint64_t length = 0;
+  for (size_t i = 0; i < n; ++i) {
+    buffer.clear();
+    if (!encode_string(i, &buffer)) return false;
+    length += buffer.length();
+    offsets.push_back(length);
+  }
+  buffer.clear();
+  EncodeUintVector<uint64_t>(offsets, &buffer);
+
+  // The second pass writes the strings, buffering them so that "sink" is
+  // called with pieces of a reasonable size.
+  constexpr size_t kMinPieceBytes = 64 << 10;
+  for (size_t i = 0; i < n; ++i) {
+    const size_t begin = buffer.length();
+    if (!encode_string(i, &buffer)) return false;
+    ABSL_DCHECK_EQ(buffer.length() - begin,
+                   offsets[i] - (i == 0 ? 0 : offsets[i - 1]))
+        << "encode_string is not deterministic";
+    if (buffer.length() >= kMinPieceBytes) {
+      if (!sink(string_view(buffer.base(), buffer.length()))) {
+        return false;
+      }
+      buffer.clear();
+    }
+  }
+  return buffer.length() == 0 ||
+         sink(string_view(buffer.base(), buffer.length()));
+}
+
+bool StringVectorEncoder::EncodeParallel(
+    size_t n, absl::FunctionRef<bool(size_t, Encoder*)> encode_string,
+    int num_threads, Encoder* encoder) {
+  ABSL_DCHECK_GE(num_threads, 1);
+  // Each chunk of consecutive strings is encoded into its own buffer.  Using
+  // several chunks per thread balances the load when string sizes vary.
+  constexpr size_t kMinStringsPerChunk = 64;
+  const size_t num_chunks = std::clamp<size_t>(
+      n / kMinStringsPerChunk, 1, 4 * static_cast<size_t>(num_threads));
+  auto chunk_begin = [n, num_chunks](size_t i) { return n * i / num_chunks; };
+
+  // offsets[i] is the end offset of string "i" relative to the start of its
+  // chunk's buffer until the chunks are stitched together below.
+  vector<uint64_t> offsets(n);
+  vector<Encoder> buffers(num_chunks);
+  std::atomic<bool> ok{true};
+  s2internal::ParallelFor(
+      num_threads, static_cast<int>(num_chunks), [&](int chunk) {
+        Encoder* buffer = &buffers[chunk];
+        for (size_t i = chunk_begin(chunk); i < chunk_begin(chunk + 1); ++i) {
+          if (!ok.load(std::memory_order_relaxed)) return;
+          if (!encode_string(i, buffer)) {
+            ok.store(false, std::memory_order_relaxed);
+            return;
+          }
+          offsets[i] = buffer->length();
+        }
+      });
+  if (!ok.load()) return false;
+
+  uint64_t base = 0;
+  for (size_t chunk = 0; chunk < num_chunks; ++chunk) {
+    for (size_t i = chunk_begin(chunk); i < chunk_begin(chunk + 1); ++i) {
+      offsets[i] += base;
+    }
+    base += buffers[chunk].length();
+  }
+  // As in Encode(), the initial zero offset is not stored.
+  EncodeUintVector<uint64_t>(offsets, encoder);
+  encoder->Ensure(base);
+  for (const Encoder& buffer : buffers) {
+    if (buffer.length() > 0) encoder->putn(buffer.base(), buffer.length());
+  }
+  return true;
+}
+
 bool EncodedStringVector::Init(Decoder* decoder) {
   if (!offsets_.Init(decoder)) return false;
   data_ = decoder->skip(0);
@@ -70,14 +159,30 @@ bool EncodedStringVector::Init(Decoder* decoder) {
 }
 
 vector<string_view> EncodedStringVector::Decode() const {
-  size_t n = size();
-  vector<string_view> result(n);
-  for (size_t i = 0; i < n; ++i) {
-    result[i] = (*this)[i];
-  }
+  vector<string_view> result(size());
+  Decode(0, size(), result.data());
   return result;
 }
 
+void EncodedStringVector::Decode(size_t begin, size_t end,
+                                 string_view* out) const {
+  ABSL_DCHECK(begin <= end && end <= size());
+  // Decode the offsets in fixed-size batches so that no memory is allocated.
+  // offsets[0] is the start of the first string in each batch.
+  constexpr size_t kBatchSize = 64;
+  uint64_t offsets[kBatchSize + 1];
+  offsets[0] = (begin == 0) ? 0 : offsets_[begin - 1];
+  while (begin < end) {
+    size_t n = std::min(end - begin, kBatchSize);
+    offsets_.Decode(begin, begin + n, offsets + 1);
+    for (size_t i = 0; i < n; ++i) {
+      *out++ = string_view(data_ + offsets[i], offsets[i + 1] - offsets[i]);
+    }
+    offsets[0] = offsets[n];
+    begin += n;
+  }
+}
+
 // The encoding must be identical to StringVectorEncoder::Encode().
 void EncodedStringVector::Encode(Encoder* encoder) const {
   offsets_.Encode(encoder);
@@ -24,6 +24,7 @@
 #include <string>
 #include <vector>
 
+#include "absl/functional/function_ref.h"
 #include "absl/strings/string_view.h"
 #include "absl/types/span.h"
 #include "s2/util/coding/coder.h"
@@ -31,6 +32,11 @@
 
 namespace s2coding {
 
+// A function that receives consecutive pieces of an encoding (e.g., to write
+// them to a file or a socket).  Returns false to stop encoding, for example
+// because of an I/O error.
+using EncodedDataSink = absl::FunctionRef<bool(absl::string_view)>;
+
 // This class allows an EncodedStringVector to be created by adding strings
 // incrementally.  It also supports adding strings that are the output of
 // another Encoder.  For example, to create a vector of encoded S2Polygons,
@@ -68,6 +74,38 @@ class StringVectorEncoder {
   //           can be enlarged as necessary by calling Ensure(int).
   static void Encode(absl::Span<const std::string> v, Encoder* encoder);
 
+  // Encodes a vector of "n" strings in a format that can later be decoded as
+  // an EncodedStringVector, and passes the result to "sink" in pieces rather
+  // than building it in memory.  String "i" is the output of calling
+  // encode_string(i, encoder); this function should return false on errors.
+  //
+  // Since the string offsets precede the string data in the encoding, each
+  // string is encoded twice: once to compute its length, and again to write
+  // it.  Memory usage is therefore proportional to "n" plus the length of
+  // the longest string, rather than the total length of the strings.
+  // Returns false if "encode_string" or "sink" does.
+  //
+  // REQUIRES: "encode_string" produces the same output when called twice
+  //           with the same arguments.
+  static bool EncodeStreaming(
+      size_t n, absl::FunctionRef<bool(size_t, Encoder*)> encode_string,
+      EncodedDataSink sink);
+
+  // Like EncodeStreaming(), except that the strings are encoded concurrently
+  // using up to "num_threads" threads (including the calling thread) and the
+  // result is appended to "encoder".  Each string is encoded only once, into
+  // a per-thread buffer; the buffers are then concatenated.  The output does
+  // not depend on "num_threads".  Returns false if "encode_string" does.
+  //
+  // REQUIRES: "encode_string" can be called concurrently from multiple
+  //           threads.
+  // REQUIRES: "encoder" uses the default constructor, so that its buffer
+  //           can be enlarged as necessary by calling Ensure(int).
+  // REQUIRES: num_threads >= 1
+  static bool EncodeParallel(
+      size_t n, absl::FunctionRef<bool(size_t, Encoder*)> encode_string,
+      int num_threads, Encoder* encoder);
+
  private:
   // A vector consisting of the starting offset of each string in the
   // encoder's data buffer, plus a final entry pointing just past the end of
@@ -118,6 +156,13 @@ class EncodedStringVector {
   // no longer needed.
   std::vector<absl::string_view> Decode() const;
 
+  // Decodes the strings in the range [begin, end) into "out", which must
+  // have room for (end - begin) values.  The offsets are decoded in batches,
+  // which is several times faster than calling operator[] for each string.
+  //
+  // REQUIRES: begin <= end <= size()
+  void Decode(size_t begin, size_t end, absl::string_view* out) const;
+
   // Copies the encoded byte stream to a new encoder.
   void Encode(Encoder* encoder) const;
 
@@ -19,6 +19,7 @@
 
 #include <cstddef>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include <gtest/gtest.h>
@@ -27,6 +28,7 @@
 #include "s2/util/coding/coder.h"
 
 using absl::string_view;
+using std::pair;
 using std::string;
 using std::vector;
 
@@ -47,12 +49,53 @@ void TestEncodedStringVector(absl::Span<const string> input,
   }
   EXPECT_EQ(actual.Decode(), expected);
 
+  // Check that ranges are decoded correctly, including ranges that do not
+  // start at the beginning of the vector.
+  const size_t n = input.size();
+  for (const auto& [begin, end] : vector<pair<size_t, size_t>>{
+           {0, n}, {n / 3, n}, {n / 3, n / 2}, {n, n}}) {
+    vector<string_view> range(end - begin);
+    actual.Decode(begin, end, range.data());
+    EXPECT_EQ(range, vector<string_view>(expected.begin() + begin,
+                                         expected.begin() + end));
+  }
+
   // Check that `EncodedStringVector::Encode` produces the same result as
   // `StringVectorEncoder::Encode`, as documented.
   Encoder reencoder;
   actual.Encode(&reencoder);
   EXPECT_EQ(string_view(encoder.base(), encoder.length()),
             string_view(reencoder.base(), reencoder.length()));
+
+  // Check that `StringVectorEncoder::EncodeStreaming` does too.
+  string streamed;
+  ASSERT_TRUE(StringVectorEncoder::EncodeStreaming(
+      input.size(),
+      [&](size_t i, Encoder* string_encoder) {
+        string_encoder->Ensure(input[i].size());
+        string_encoder->putn(input[i].data(), input[i].size());
+        return true;
+      },
+      [&](string_view piece) {
+        streamed.append(piece.data(), piece.size());
+        return true;
+      }));
+  EXPECT_EQ(string_view(encoder.base(), encoder.length()), streamed);
+
+  // And `StringVectorEncoder::EncodeParallel`.
+  for (int num_threads : {1, 4}) {
+    Encoder parallel_encoder;
+    ASSERT_TRUE(StringVectorEncoder::EncodeParallel(
+        input.size(),
+        [&](size_t i, Encoder* string_encoder) {
+          string_encoder->Ensure(input[i].size());
+          string_encoder->putn(input[i].data(), input[i].size());
+          return true;
+        },
+        num_threads, &parallel_encoder));
+    EXPECT_EQ(string_view(encoder.base(), encoder.length()),
+              string_view(parallel_encoder.base(), parallel_encoder.length()));
+  }
 }
 
 TEST(EncodedStringVectorTest, Empty) {
@@ -80,4 +123,22 @@ TEST(EncodedStringVectorTest, TwoBigStrings) {
                           110007);
 }
 
+TEST(EncodedStringVectorTest, ManyStrings) {
+  // Enough strings that EncodeParallel splits them into several chunks.
+  vector<string> input;
+  size_t total_length = 0;
+  for (int i = 0; i < 1000; ++i) {
+    input.push_back(string(i % 7, 'a' + i % 26));
+    total_length += input.back().size();
+  }
+  // 1000 offsets of 2 bytes each, plus a 2-byte header.
+  TestEncodedStringVector(input, total_length + 2002);
+}
+
+TEST(EncodedStringVectorTest, EncodeParallelError) {
+  Encoder encoder;
+  EXPECT_FALSE(StringVectorEncoder::EncodeParallel(
+      1000, [](size_t i, Encoder*) { return i != 500; }, 4, &encoder));
+}
+
 }  // namespace s2coding
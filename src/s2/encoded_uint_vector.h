@@ -93,10 +93,19 @@ class EncodedUintVector {
   // Decodes and returns the entire original vector.
   std::vector<T> Decode() const;
 
+  // Decodes the elements in the range [begin, end) into "out", which must
+  // have room for (end - begin) values.  This is several times faster than
+  // calling operator[] for each element.
+  //
+  // REQUIRES: begin <= end <= size()
+  void Decode(size_t begin, size_t end, T* out) const;
+
   void Encode(Encoder* encoder) const;
 
  private:
   template <int length> size_t lower_bound(T target) const;
+  template <int length> void DecodeRange(size_t begin, size_t end,
+                                         T* out) const;
 
   const char* data_;
   uint32_t size_;
@@ -286,28 +295,54 @@ size_t EncodedUintVector<T>::lower_bound(T target) const {
 
 template <class T> template <int length>
 inline size_t EncodedUintVector<T>::lower_bound(T target) const {
-  size_t lo = 0, hi = size_;
-  while (lo < hi) {
-    size_t mid = (lo + hi) >> 1;
-    T value = GetUintWithLength<T>(data_ + mid * length, length);
-    if (value < target) {
-      lo = mid + 1;
-    } else {
-      hi = mid;
-    }
+  // This is a branch-free binary search: the number of iterations depends
+  // only on size_, and the comparison compiles to a conditional move.  This
+  // avoids the branch mispredictions of a conventional binary search (about
+  // one per two iterations for random targets), which dominate its cost.
+  if (size_ == 0) return 0;
+  size_t lo = 0, n = size_;
+  while (n > 1) {
+    size_t half = n >> 1;
+    T value = GetUintWithLength<T>(data_ + (lo + half) * length, length);
+    lo = (value < target) ? lo + half : lo;
+    n -= half;
   }
-  return lo;
+  return lo + (GetUintWithLength<T>(data_ + lo * length, length) < target);
 }
 
 template <class T>
 std::vector<T> EncodedUintVector<T>::Decode() const {
   std::vector<T> result(size_);
-  for (int i = 0; i < size_; ++i) {
-    result[i] = (*this)[i];
-  }
+  Decode(0, size_, result.data());
   return result;
 }
 
+template <class T>
+void EncodedUintVector<T>::Decode(size_t begin, size_t end, T* out) const {
+  ABSL_DCHECK(begin <= end && end <= size_);
+  switch (len_) {
+    case 1: return DecodeRange<1>(begin, end, out);
+    case 2: return DecodeRange<2>(begin, end, out);
+    case 3: return DecodeRange<3>(begin, end, out);
+    case 4: return DecodeRange<4>(begin, end, out);
+    case 5: return DecodeRange<5>(begin, end, out);
+    case 6: return DecodeRange<6>(begin, end, out);
+    case 7: return DecodeRange<7>(begin, end, out);
+    default: return DecodeRange<8>(begin, end, out);
+  }
+}
+
+template <class T> template <int length>
+inline void EncodedUintVector<T>::DecodeRange(size_t begin, size_t end,
+                                              T* out) const {
+  // Since "length" is a compile-time constant, GetUintWithLength() reduces to
+  // a few unaligned loads and shifts per element with no branches.
+  const char* ptr = data_ + begin * length;
+  for (size_t i = begin; i < end; ++i, ptr += length) {
+    *out++ = GetUintWithLength<T>(ptr, length);
+  }
+}
+
 template <class T>
 // The encoding must be identical to StringVectorEncoder::Encode().
 void EncodedUintVector<T>::Encode(Encoder* encoder) const {
@@ -130,6 +130,45 @@ TEST(EncodedUintVector, LowerBound) {
   }
 }
 
+TEST(EncodedUintVector, LowerBoundAllLengthsAndSizes) {
+  // Exercises every byte length and small sizes (including sizes that are not
+  // powers of two), checking all targets near each value.
+  for (int bytes_per_value = 1; bytes_per_value <= 8; ++bytes_per_value) {
+    for (int num_values = 0; num_values <= 40; ++num_values) {
+      vector<uint64_t> v;
+      if (num_values > 0) {
+        v = MakeSortedTestVector<uint64_t>(bytes_per_value, num_values);
+      }
+      Encoder encoder;
+      auto actual = MakeEncodedVector(v, &encoder);
+      vector<uint64_t> targets = {0, ~uint64_t{0}};
+      for (uint64_t x : v) {
+        targets.insert(targets.end(), {x - 1, x, x + 1});
+      }
+      for (uint64_t x : targets) {
+        EXPECT_EQ(std::lower_bound(v.begin(), v.end(), x) - v.begin(),
+                  actual.lower_bound(x))
+            << bytes_per_value << " " << num_values << " " << x;
+      }
+    }
+  }
+}
+
+TEST(EncodedUintVector, DecodeRange) {
+  for (int bytes_per_value = 1; bytes_per_value <= 4; ++bytes_per_value) {
+    auto v = MakeSortedTestVector<uint32_t>(bytes_per_value, 100);
+    Encoder encoder;
+    auto actual = MakeEncodedVector(v, &encoder);
+    for (size_t begin : {0, 1, 37, 100}) {
+      for (size_t end = begin; end <= v.size(); end += 13) {
+        vector<uint32_t> out(end - begin);
+        actual.Decode(begin, end, out.data());
+        EXPECT_EQ(out, vector<uint32_t>(v.begin() + begin, v.begin() + end));
+      }
+    }
+  }
+}
+
 TEST(EncodedUintVectorTest, RoundtripEncoding) {
   vector<uint64_t> values{10, 20, 30, 40};
 
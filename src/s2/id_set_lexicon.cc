@@ -75,6 +75,15 @@ int32_t IdSetLexicon::AddInternal(vector<int32_t>* ids) {
   }
 }
 
+IdSetLexicon::SetIdMap::SetIdMap(vector<uint32_t> sequence_ids)
+    : sequence_ids_(std::move(sequence_ids)) {}
+
+IdSetLexicon::SetIdMap IdSetLexicon::Merge(const IdSetLexicon& other) {
+  // The sets of "other" are already canonical (sorted, without duplicates,
+  // and with at least two elements), so they can be merged directly.
+  return SetIdMap(id_sets_.Merge(other.id_sets_));
+}
+
 IdSetLexicon::IdSet IdSetLexicon::id_set(int32_t set_id) const {
   if (set_id >= 0) {
     return IdSet(set_id);
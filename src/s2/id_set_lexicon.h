@@ -71,6 +71,19 @@
 // 2. Sets are represented rather than sequences; values are reordered to be in
 //    sorted order, and duplicates are removed.
 // 3. The values must be 32-bit non-negative integers (only).
+//
+// Like SequenceLexicon, const methods are thread safe and non-const methods
+// are not.  To build id sets from several threads, give each thread its own
+// IdSetLexicon and combine them afterwards using Merge(), e.g.
+//
+//   vector<IdSetLexicon> lexicons(num_threads);
+//   vector<vector<int32_t>> set_ids(num_threads);
+//   ... thread "i" calls lexicons[i].Add() and saves the ids in set_ids[i] ...
+//   IdSetLexicon merged;
+//   for (int i = 0; i < num_threads; ++i) {
+//     IdSetLexicon::SetIdMap map = merged.Merge(lexicons[i]);
+//     for (int32_t& id : set_ids[i]) id = map(id);
+//   }
 class IdSetLexicon {
  public:
   IdSetLexicon();
@@ -111,6 +124,27 @@ class IdSetLexicon {
   // method is static.  Equivalent to calling Add() with an empty container.
   static int32_t EmptySetId();
 
+  // Maps the set ids of a lexicon passed to Merge() to the corresponding set
+  // ids of the merged lexicon.
+  class SetIdMap {
+   public:
+    // Returns the merged id of the set with the given id in the original
+    // lexicon.  Empty and singleton sets keep their ids.
+    int32_t operator()(int32_t set_id) const;
+
+   private:
+    friend class IdSetLexicon;
+    explicit SetIdMap(std::vector<uint32_t> sequence_ids);
+    std::vector<uint32_t> sequence_ids_;
+  };
+
+  // Adds every id set of "other" to this lexicon, and returns the mapping
+  // from the set ids of "other" to the set ids of this lexicon.  The merged
+  // ids depend only on the order in which lexicons are merged.
+  //
+  // REQUIRES: &other != this
+  SetIdMap Merge(const IdSetLexicon& other);
+
   // Iterator type; please treat this as an opaque forward iterator.
   using Iterator = const int32_t*;
 
@@ -183,6 +217,11 @@ inline int32_t IdSetLexicon::AddSingleton(int32_t id) const {
 
 /*static*/ inline int32_t IdSetLexicon::EmptySetId() { return kEmptySetId; }
 
+inline int32_t IdSetLexicon::SetIdMap::operator()(int32_t set_id) const {
+  if (set_id >= 0 || set_id == kEmptySetId) return set_id;
+  return ~sequence_ids_[~set_id];
+}
+
 template <class FwdIterator>
 int32_t IdSetLexicon::Add(FwdIterator begin, FwdIterator end) {
   tmp_.clear();
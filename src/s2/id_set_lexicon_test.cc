@@ -25,6 +25,7 @@
 
 #include <gtest/gtest.h>
 #include "absl/types/span.h"
+#include "s2/internal/s2parallel.h"
 
 using std::vector;
 
@@ -75,3 +76,43 @@ TEST(IdSetLexicon, Clear) {
   EXPECT_EQ(~0, lexicon.Add(Seq{3, 4}));
   EXPECT_EQ(~1, lexicon.Add(Seq{1, 2}));
 }
+
+TEST(IdSetLexicon, Merge) {
+  IdSetLexicon lex1, lex2;
+  EXPECT_EQ(~0, lex1.Add(Seq{1, 2}));
+  EXPECT_EQ(~0, lex2.Add(Seq{3, 4}));
+  EXPECT_EQ(~1, lex2.Add(Seq{2, 1}));
+  IdSetLexicon::SetIdMap map = lex1.Merge(lex2);
+  EXPECT_EQ(~1, map(~0));
+  EXPECT_EQ(~0, map(~1));
+  EXPECT_EQ(7, map(7));
+  EXPECT_EQ(IdSetLexicon::EmptySetId(), map(IdSetLexicon::EmptySetId()));
+  ExpectIdSet({3, 4}, lex1.id_set(~1));
+}
+
+TEST(IdSetLexicon, MergePerThreadLexicons) {
+  // Each thread adds its sets to a separate lexicon, and the lexicons are
+  // then merged.  The result should be the same as adding all the sets to a
+  // single lexicon.
+  constexpr int kNumThreads = 4, kSetsPerThread = 100;
+  vector<IdSetLexicon> lexicons(kNumThreads);
+  vector<vector<int32_t>> set_ids(kNumThreads);
+  auto make_set = [](int i) { return Seq{i % 7, i % 11, i % 13}; };
+  s2internal::ParallelFor(kNumThreads, kNumThreads, [&](int t) {
+    for (int i = 0; i < kSetsPerThread; ++i) {
+      set_ids[t].push_back(lexicons[t].Add(make_set(t * kSetsPerThread + i)));
+    }
+  });
+  IdSetLexicon merged;
+  for (int t = 0; t < kNumThreads; ++t) {
+    IdSetLexicon::SetIdMap map = merged.Merge(lexicons[t]);
+    for (int32_t& id : set_ids[t]) id = map(id);
+  }
+  IdSetLexicon expected;
+  for (int t = 0; t < kNumThreads; ++t) {
+    for (int i = 0; i < kSetsPerThread; ++i) {
+      int32_t id = expected.Add(make_set(t * kSetsPerThread + i));
+      ASSERT_EQ(id, set_ids[t][i]);
+    }
+  }
+}
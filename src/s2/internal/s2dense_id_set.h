@@ -0,0 +1,77 @@
+// Copyright 2024 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#ifndef S2_INTERNAL_S2DENSE_ID_SET_H_
+#define S2_INTERNAL_S2DENSE_ID_SET_H_
+
+#include <cstdint>
+#include <vector>
+
+#include "absl/log/absl_check.h"
+#include "s2/util/bitmap/bitmap.h"
+
+namespace s2internal {
+
+// A set of integers in the range [0, size()) represented as a bitmap, such as
+// the shape ids of an S2ShapeIndex.  Insert() and Contains() take constant
+// time, and Clear() takes time proportional to the number of elements that
+// were inserted rather than to size(), so that the set can be reused cheaply
+// by many small queries over a large id space.
+class DenseIdSet {
+ public:
+  DenseIdSet() = default;
+
+  // Returns the number of ids that the set can hold.
+  int64_t size() const { return bits_.bits(); }
+
+  // Removes all elements and changes the range of valid ids to [0, size).
+  void Reset(int64_t size) {
+    Clear();
+    bits_.Resize(size, false);
+  }
+
+  // Adds "id" to the set.  Returns true if it was not already present.
+  bool Insert(int64_t id) {
+    ABSL_DCHECK(id >= 0 && id < size());
+    if (bits_.Set(id, true)) return false;
+    touched_.push_back(id);
+    return true;
+  }
+
+  bool Contains(int64_t id) const {
+    ABSL_DCHECK(id >= 0 && id < size());
+    return bits_.Get(id);
+  }
+
+  bool empty() const { return touched_.empty(); }
+
+  // Returns the elements of the set in insertion order.
+  const std::vector<int64_t>& elements() const { return touched_; }
+
+  // Removes all elements, keeping the allocated storage.
+  void Clear() {
+    for (int64_t id : touched_) bits_.Set(id, false);
+    touched_.clear();
+  }
+
+ private:
+  util::bitmap::Bitmap64 bits_;
+  std::vector<int64_t> touched_;
+};
+
+}  // namespace s2internal
+
+#endif  // S2_INTERNAL_S2DENSE_ID_SET_H_
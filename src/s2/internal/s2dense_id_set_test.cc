@@ -0,0 +1,63 @@
+// Copyright 2024 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#include "s2/internal/s2dense_id_set.h"
+
+#include <cstdint>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+namespace s2internal {
+namespace {
+
+TEST(DenseIdSet, InsertAndContains) {
+  DenseIdSet set;
+  set.Reset(200);
+  EXPECT_EQ(set.size(), 200);
+  EXPECT_TRUE(set.empty());
+  EXPECT_TRUE(set.Insert(150));
+  EXPECT_TRUE(set.Insert(3));
+  EXPECT_FALSE(set.Insert(150));
+  EXPECT_TRUE(set.Contains(3));
+  EXPECT_TRUE(set.Contains(150));
+  EXPECT_FALSE(set.Contains(4));
+  EXPECT_EQ(set.elements(), (std::vector<int64_t>{150, 3}));
+}
+
+TEST(DenseIdSet, ClearRemovesOnlyInsertedIds) {
+  DenseIdSet set;
+  set.Reset(1000);
+  for (int64_t id = 0; id < 1000; id += 7) set.Insert(id);
+  set.Clear();
+  EXPECT_TRUE(set.empty());
+  for (int64_t id = 0; id < 1000; ++id) EXPECT_FALSE(set.Contains(id));
+  EXPECT_TRUE(set.Insert(7));
+}
+
+TEST(DenseIdSet, ResetChangesSize) {
+  DenseIdSet set;
+  set.Reset(10);
+  set.Insert(9);
+  set.Reset(100);
+  EXPECT_EQ(set.size(), 100);
+  EXPECT_TRUE(set.empty());
+  EXPECT_FALSE(set.Contains(9));
+  EXPECT_TRUE(set.Insert(99));
+}
+
+}  // namespace
+}  // namespace s2internal
@@ -15,9 +15,11 @@
 
 #include "s2/internal/s2incident_edge_tracker.h"
 
+#include <algorithm>
 #include <cstdint>
-#include <utility>
+#include <tuple>
 
+#include "absl/base/optimization.h"
 #include "absl/log/absl_check.h"
 
 namespace internal {
@@ -40,28 +42,22 @@ void S2IncidentEdgeTracker::AddEdge(int edge_id, const S2Shape::Edge& edge) {
 void S2IncidentEdgeTracker::FinishShape() {
   ABSL_DCHECK_GE(current_shape_, 0);
 
-  using std::swap;
-
-  // We want to keep any vertices with more than two incident edges.  We could
-  // sort the array by vertex and remove any with fewer, but that would require
-  // shifting the array and could turn quadratic quickly.
-  //
-  // Instead we'll scan forward from each vertex, swapping entries with the same
-  // vertex into a contiguous range.  Once we've done all the swapping we can
-  // just make sure that we have at least three edges in the range.
+  // We want to keep any vertices with more than two incident edges.  Sorting
+  // the nursery by vertex groups the entries for each vertex into a
+  // contiguous range in O(n log n) time, which matters for index cells with
+  // many edges.  (The nursery is reused between calls, so this does not
+  // allocate.)  Sorting by edge id within each vertex also lets us skip
+  // duplicate entries before inserting them into the hash set.
+  std::sort(nursery_.begin(), nursery_.end(),
+            [](const VertexEdge& a, const VertexEdge& b) {
+              return std::tie(a.vertex, a.edge_id) <
+                     std::tie(b.vertex, b.edge_id);
+            });
   const int nursery_size = nursery_.size();
   for (int start = 0; start < nursery_size;) {
-    int end = start + 1;
-
-    // Scan to the end of the array, swap entries so that entries with the same
-    // vertex as the start are adjacent.
-    int next = start;
     const S2Point& curr_vertex = nursery_[start].vertex;
-    while (++next < nursery_size) {
-      if (nursery_[next].vertex == curr_vertex) {
-        swap(nursery_[next], nursery_[end++]);
-      }
-    }
+    int end = start + 1;
+    while (end < nursery_size && nursery_[end].vertex == curr_vertex) ++end;
 
     // Most vertices will have two incident edges (the incoming edge and the
     // outgoing edge), which aren't interesting, skip them.
@@ -71,7 +67,7 @@ void S2IncidentEdgeTracker::FinishShape() {
       continue;
     }
 
-    const IncidentEdgeKey key = {current_shape_, nursery_[start].vertex};
+    const IncidentEdgeKey key = {current_shape_, curr_vertex};
 
     // If we don't have this key yet, create it manually with a pre-sized
     // hash set to avoid rehashes.  Start with a size of 8, which is four
@@ -83,10 +79,19 @@ void S2IncidentEdgeTracker::FinishShape() {
 
     absl::flat_hash_set<int32_t>& edges = iter->second;
     edges.reserve(edges.size() + num_edges);
-    while (start != end) {
-      edges.insert({nursery_[start++].edge_id});
+    for (int prev_id = -1; start != end; ++start) {
+      const int32_t edge_id = nursery_[start].edge_id;
+      if (edge_id != prev_id) edges.insert(edge_id);
+      prev_id = edge_id;
     }
   }
 }
 
+void S2IncidentEdgeTracker::Merge(const S2IncidentEdgeTracker& other) {
+  for (const auto& item : other.incident_edge_map_) {
+    incident_edge_map_[item.first].insert(item.second.begin(),
+                                          item.second.end());
+  }
+}
+
 }  // namespace internal
@@ -110,6 +110,10 @@ class S2IncidentEdgeTracker {
   // Clear any accumulated state.
   void Reset() { incident_edge_map_.clear(); }
 
+  // Adds the incident edges tracked by "other" to this tracker.  This allows
+  // disjoint sets of index cells to be processed by different trackers.
+  void Merge(const S2IncidentEdgeTracker& other);
+
   // Returns a const reference to the incident edge map.
   const IncidentEdgeSet& IncidentEdges() const { return incident_edge_map_; }
 
@@ -0,0 +1,148 @@
+// Copyright 2024 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef S2_INTERNAL_S2PARALLEL_H_
+#define S2_INTERNAL_S2PARALLEL_H_
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "absl/log/absl_check.h"
+
+namespace s2internal {
+
+// Calls fn(i) for every "i" in the range [0, n) using at most "num_threads"
+// threads (including the calling thread).  Tasks are handed out dynamically
+// in increasing order of "i", so that expensive tasks are balanced across
+// threads automatically.  Returns only once all tasks have finished.
+//
+// The order in which tasks are executed is unspecified, so "fn" must not
+// depend on being called in any particular order.  Callers that need
+// deterministic output should write the result of task "i" to slot "i" of a
+// pre-sized vector and then combine the results after this function returns.
+//
+// When num_threads <= 1 or n <= 1, all tasks are executed in the calling
+// thread in increasing order of "i" without creating any threads.
+template <class Fn>
+void ParallelFor(int num_threads, int n, const Fn& fn) {
+  ABSL_DCHECK_GE(n, 0);
+  num_threads = std::min(num_threads, n);
+  if (num_threads <= 1) {
+    for (int i = 0; i < n; ++i) fn(i);
+    return;
+  }
+  std::atomic<int> next_task{0};
+  auto worker = [&next_task, n, &fn]() {
+    for (int i; (i = next_task.fetch_add(1, std::memory_order_relaxed)) < n;) {
+      fn(i);
+    }
+  };
+  std::vector<std::thread> threads;
+  threads.reserve(num_threads - 1);
+  for (int t = 1; t < num_threads; ++t) threads.emplace_back(worker);
+  worker();
+  for (auto& thread : threads) thread.join();
+}
+
+// Returns the number of workers that ParallelForChunks() uses to process
+// "n" elements in chunks of "chunk_size" using at most "num_threads"
+// threads.  This is always at least 1.
+inline int NumChunkWorkers(int num_threads, int n, int chunk_size) {
+  const int num_chunks = n / chunk_size + (n % chunk_size != 0);
+  return std::max(1, std::min(num_threads, num_chunks));
+}
+
+// Splits the range [0, n) into chunks of "chunk_size" consecutive elements
+// and calls fn(worker, begin, end) for each chunk [begin, end) using at most
+// "num_threads" threads.  Each worker is a number in the range
+// [0, NumChunkWorkers(num_threads, n, chunk_size)) that calls "fn"
+// sequentially, so "fn" can use per-worker state (e.g. a query object)
+// without synchronization.  When there is only one worker, it runs in the
+// calling thread.
+//
+// Chunks are handed out dynamically in increasing order.  "fn" may return
+// either void or bool.  If it returns false, chunks after that one are
+// skipped, but every chunk before it still runs, so that the lowest failing
+// chunk does not depend on the number of threads.  Returns the first element
+// of the lowest failing chunk, or "n" if no chunk failed.
+template <class Fn>
+int ParallelForChunks(int num_threads, int n, int chunk_size, const Fn& fn) {
+  ABSL_DCHECK_GE(n, 0);
+  ABSL_DCHECK_GE(chunk_size, 1);
+  const int num_chunks = n / chunk_size + (n % chunk_size != 0);
+  const int num_workers = NumChunkWorkers(num_threads, n, chunk_size);
+  std::atomic<int> next_chunk{0}, first_failure{num_chunks};
+  ParallelFor(num_workers, num_workers, [&](int worker) {
+    for (int c; (c = next_chunk.fetch_add(1, std::memory_order_relaxed)) <
+                num_chunks;) {
+      int min_failure = first_failure.load(std::memory_order_relaxed);
+      if (c > min_failure) break;
+      const int begin = c * chunk_size;
+      const int end = std::min(n, begin + chunk_size);
+      if constexpr (std::is_void_v<decltype(fn(worker, begin, end))>) {
+        fn(worker, begin, end);
+      } else if (!fn(worker, begin, end)) {
+        while (c < min_failure &&
+               !first_failure.compare_exchange_weak(
+                   min_failure, c, std::memory_order_relaxed)) {
+        }
+      }
+    }
+  });
+  const int failure = first_failure.load(std::memory_order_relaxed);
+  return failure == num_chunks ? n : failure * chunk_size;
+}
+
+// Sorts the range [begin, end) according to "less" using at most
+// "num_threads" threads.  The range is split into one chunk per thread, the
+// chunks are sorted concurrently, and then adjacent chunks are merged in
+// rounds.  Like std::sort(), the sort is not stable.  Small ranges are
+// sorted by the calling thread.
+template <class RandomIt, class Compare>
+void ParallelSort(int num_threads, RandomIt begin, RandomIt end,
+                  const Compare& less) {
+  // Chunks smaller than this are not worth sorting separately.
+  constexpr ptrdiff_t kMinChunkSize = 1 << 14;
+  const ptrdiff_t n = end - begin;
+  const int num_chunks = std::min<ptrdiff_t>(num_threads, n / kMinChunkSize);
+  if (num_chunks <= 1) {
+    std::sort(begin, end, less);
+    return;
+  }
+  auto chunk_begin = [begin, n, num_chunks](int i) {
+    return begin + n * i / num_chunks;
+  };
+  ParallelFor(num_threads, num_chunks, [&](int i) {
+    std::sort(chunk_begin(i), chunk_begin(i + 1), less);
+  });
+  for (int width = 1; width < num_chunks; width *= 2) {
+    const int num_merges = (num_chunks + 2 * width - 1) / (2 * width);
+    ParallelFor(num_threads, num_merges, [&](int j) {
+      const int lo = 2 * j * width;
+      const int mid = std::min(lo + width, num_chunks);
+      const int hi = std::min(lo + 2 * width, num_chunks);
+      std::inplace_merge(chunk_begin(lo), chunk_begin(mid), chunk_begin(hi),
+                         less);
+    });
+  }
+}
+
+}  // namespace s2internal
+
+#endif  // S2_INTERNAL_S2PARALLEL_H_
@@ -0,0 +1,127 @@
+// Copyright 2024 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "s2/internal/s2parallel.h"
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+namespace s2internal {
+namespace {
+
+TEST(ParallelFor, NoTasks) {
+  int num_calls = 0;
+  ParallelFor(4, 0, [&](int) { ++num_calls; });
+  EXPECT_EQ(num_calls, 0);
+}
+
+TEST(ParallelFor, SingleThreadRunsTasksInOrder) {
+  const std::thread::id caller = std::this_thread::get_id();
+  std::vector<int> order;
+  ParallelFor(1, 5, [&](int i) {
+    EXPECT_EQ(std::this_thread::get_id(), caller);
+    order.push_back(i);
+  });
+  EXPECT_EQ(order, (std::vector<int>{0, 1, 2, 3, 4}));
+}
+
+TEST(ParallelFor, EveryTaskRunsExactlyOnce) {
+  constexpr int kNumTasks = 1000;
+  std::vector<std::atomic<int>> counts(kNumTasks);
+  std::atomic<int> total{0};
+  ParallelFor(8, kNumTasks, [&](int i) {
+    counts[i].fetch_add(1);
+    total.fetch_add(i);
+  });
+  for (int i = 0; i < kNumTasks; ++i) EXPECT_EQ(counts[i].load(), 1);
+  EXPECT_EQ(total.load(), kNumTasks * (kNumTasks - 1) / 2);
+}
+
+TEST(ParallelFor, MoreThreadsThanTasks) {
+  std::vector<int> results(3);
+  ParallelFor(16, 3, [&](int i) { results[i] = i * i; });
+  EXPECT_EQ(results, (std::vector<int>{0, 1, 4}));
+}
+
+TEST(ParallelForChunks, NumChunkWorkers) {
+  EXPECT_EQ(NumChunkWorkers(4, 0, 10), 1);
+  EXPECT_EQ(NumChunkWorkers(4, 10, 10), 1);
+  EXPECT_EQ(NumChunkWorkers(4, 11, 10), 2);
+  EXPECT_EQ(NumChunkWorkers(4, 1000, 10), 4);
+  EXPECT_EQ(NumChunkWorkers(0, 1000, 10), 1);
+}
+
+TEST(ParallelForChunks, EveryElementRunsExactlyOnce) {
+  constexpr int kNumElements = 1000, kChunkSize = 7;
+  const int num_workers = NumChunkWorkers(8, kNumElements, kChunkSize);
+  std::vector<std::atomic<int>> counts(kNumElements);
+  // Each worker appends to its own vector without synchronization.
+  std::vector<std::vector<std::pair<int, int>>> chunks(num_workers);
+  EXPECT_EQ(ParallelForChunks(8, kNumElements, kChunkSize,
+                              [&](int worker, int begin, int end) {
+                                chunks[worker].emplace_back(begin, end);
+                                for (int i = begin; i < end; ++i) {
+                                  counts[i].fetch_add(1);
+                                }
+                              }),
+            kNumElements);
+  for (int i = 0; i < kNumElements; ++i) EXPECT_EQ(counts[i].load(), 1);
+  std::vector<std::pair<int, int>> all;
+  for (const auto& worker_chunks : chunks) {
+    // Chunks are handed out in increasing order.
+    EXPECT_TRUE(std::is_sorted(worker_chunks.begin(), worker_chunks.end()));
+    all.insert(all.end(), worker_chunks.begin(), worker_chunks.end());
+  }
+  std::sort(all.begin(), all.end());
+  ASSERT_EQ(all.size(), (kNumElements + kChunkSize - 1) / kChunkSize);
+  for (int c = 0; c < static_cast<int>(all.size()); ++c) {
+    EXPECT_EQ(all[c].first, c * kChunkSize);
+    EXPECT_EQ(all[c].second, std::min(kNumElements, (c + 1) * kChunkSize));
+  }
+}
+
+TEST(ParallelForChunks, SingleWorkerRunsInCallingThread) {
+  const std::thread::id caller = std::this_thread::get_id();
+  std::vector<int> begins;
+  ParallelForChunks(1, 10, 3, [&](int worker, int begin, int end) {
+    EXPECT_EQ(worker, 0);
+    EXPECT_EQ(std::this_thread::get_id(), caller);
+    begins.push_back(begin);
+  });
+  EXPECT_EQ(begins, (std::vector<int>{0, 3, 6, 9}));
+}
+
+TEST(ParallelForChunks, LowestFailureIsReported) {
+  for (int num_threads : {1, 2, 8}) {
+    std::vector<std::atomic<int>> counts(1000);
+    // Chunks 300 and 700 fail.
+    EXPECT_EQ(ParallelForChunks(num_threads, 1000, 1,
+                                [&](int, int begin, int) {
+                                  counts[begin].fetch_add(1);
+                                  return begin != 300 && begin != 700;
+                                }),
+              300);
+    // Every chunk before the lowest failure runs.
+    for (int i = 0; i <= 300; ++i) EXPECT_EQ(counts[i].load(), 1) << i;
+  }
+}
+
+}  // namespace
+}  // namespace s2internal
@@ -0,0 +1,48 @@
+// Copyright 2024 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef S2_INTERNAL_S2POINT_ORDER_H_
+#define S2_INTERNAL_S2POINT_ORDER_H_
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+#include "absl/types/span.h"
+#include "s2/s2cell_id.h"
+#include "s2/s2point.h"
+
+namespace s2internal {
+
+// Returns the pairs (S2CellId(points[i]), i) sorted by leaf cell id.  Batch
+// queries process points in this order so that consecutive points tend to
+// visit the same index cells.  Points that are already sorted are not
+// sorted again.
+inline std::vector<std::pair<S2CellId, int>> SortPointsByCellId(
+    absl::Span<const S2Point> points) {
+  std::vector<std::pair<S2CellId, int>> order;
+  order.reserve(points.size());
+  for (int i = 0; i < static_cast<int>(points.size()); ++i) {
+    order.emplace_back(S2CellId(points[i]), i);
+  }
+  if (!std::is_sorted(order.begin(), order.end())) {
+    std::sort(order.begin(), order.end());
+  }
+  return order;
+}
+
+}  // namespace s2internal
+
+#endif  // S2_INTERNAL_S2POINT_ORDER_H_
@@ -0,0 +1,50 @@
+// Copyright 2024 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "s2/internal/s2point_order.h"
+
+#include <utility>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include "s2/s2cell_id.h"
+#include "s2/s2point.h"
+#include "s2/s2text_format.h"
+
+namespace s2internal {
+namespace {
+
+TEST(SortPointsByCellId, Empty) {
+  EXPECT_TRUE(SortPointsByCellId({}).empty());
+}
+
+TEST(SortPointsByCellId, RemembersOriginalPositions) {
+  const std::vector<S2Point> points =
+      s2textformat::ParsePointsOrDie("0:0, 0:180, 0:90, 90:0, 0:0");
+  const std::vector<std::pair<S2CellId, int>> order =
+      SortPointsByCellId(points);
+  ASSERT_EQ(order.size(), points.size());
+  std::vector<bool> seen(points.size());
+  for (int k = 0; k < static_cast<int>(order.size()); ++k) {
+    const auto& [id, i] = order[k];
+    EXPECT_EQ(id, S2CellId(points[i]));
+    EXPECT_FALSE(seen[i]);
+    seen[i] = true;
+    if (k > 0) EXPECT_LE(order[k - 1], order[k]);
+  }
+}
+
+}  // namespace
+}  // namespace s2internal
@@ -0,0 +1,42 @@
+// Copyright 2024 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef S2_INTERNAL_S2PRIORITY_QUEUE_H_
+#define S2_INTERNAL_S2PRIORITY_QUEUE_H_
+
+#include <cstddef>
+#include <queue>
+
+#include "absl/container/inlined_vector.h"
+
+namespace s2internal {
+
+// A priority queue that stores up to "N" elements inline and whose clear()
+// method keeps the allocated storage, so that a query object that is reused
+// many times does not reallocate its queue for every query.
+template <class T, size_t N>
+class ReusablePriorityQueue
+    : public std::priority_queue<T, absl::InlinedVector<T, N>> {
+ public:
+  // InlinedVector::clear() deallocates, but erase() does not.
+  void clear() { this->c.erase(this->c.begin(), this->c.end()); }
+
+  // Returns the number of elements that can be held without reallocating.
+  size_t capacity() const { return this->c.capacity(); }
+};
+
+}  // namespace s2internal
+
+#endif  // S2_INTERNAL_S2PRIORITY_QUEUE_H_
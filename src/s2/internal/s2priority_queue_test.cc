@@ -0,0 +1,45 @@
+// Copyright 2024 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "s2/internal/s2priority_queue.h"
+
+#include <gtest/gtest.h>
+
+namespace s2internal {
+namespace {
+
+TEST(ReusablePriorityQueue, PopsLargestFirst) {
+  ReusablePriorityQueue<int, 4> queue;
+  for (int x : {3, 1, 4, 1, 5, 9, 2, 6}) queue.push(x);
+  for (int expected : {9, 6, 5, 4, 3, 2, 1, 1}) {
+    ASSERT_FALSE(queue.empty());
+    EXPECT_EQ(queue.top(), expected);
+    queue.pop();
+  }
+  EXPECT_TRUE(queue.empty());
+}
+
+TEST(ReusablePriorityQueue, ClearKeepsStorage) {
+  ReusablePriorityQueue<int, 4> queue;
+  for (int i = 0; i < 100; ++i) queue.push(i);
+  const size_t capacity = queue.capacity();
+  EXPECT_GE(capacity, 100);
+  queue.clear();
+  EXPECT_TRUE(queue.empty());
+  EXPECT_EQ(queue.capacity(), capacity);
+}
+
+}  // namespace
+}  // namespace s2internal
@@ -18,11 +18,17 @@
 #include "s2/mutable_s2shape_index.h"
 
 #include <algorithm>
+#include <array>
 #include <atomic>
 #include <cmath>
 #include <cstddef>
 #include <cstdint>
+#include <functional>
+#include <future>
+#include <iterator>
 #include <memory>
+#include <memory_resource>
+#include <new>
 #include <utility>
 #include <vector>
 
@@ -30,9 +36,12 @@
 #include "s2/base/commandlineflags.h"
 #include "absl/base/attributes.h"
 #include "absl/container/btree_map.h"
+#include "absl/container/flat_hash_set.h"
+#include "absl/container/fixed_array.h"
 #include "absl/flags/flag.h"
 #include "absl/log/absl_check.h"
 #include "absl/log/absl_log.h"
+#include "absl/strings/string_view.h"
 #include "absl/synchronization/mutex.h"
 #include "absl/types/span.h"
 #include "absl/utility/utility.h"
@@ -40,6 +49,7 @@
 #include "s2/util/coding/varint.h"
 #include "s2/encoded_s2cell_id_vector.h"
 #include "s2/encoded_string_vector.h"
+#include "s2/internal/s2parallel.h"
 #include "s2/r1interval.h"
 #include "s2/r2.h"
 #include "s2/r2rect.h"
@@ -54,8 +64,10 @@
 #include "s2/s2point.h"
 #include "s2/s2shape.h"
 #include "s2/s2shape_index.h"
+#include "s2/s2shape_metadata.h"
 #include "s2/s2shapeutil_contains_brute_force.h"
 #include "s2/s2shapeutil_shape_edge_id.h"
+#include "s2/s2space_usage.h"
 #include "s2/util/gtl/compact_array.h"
 
 using std::fabs;
@@ -193,6 +205,11 @@ void MutableS2ShapeIndex::Options::set_max_edges_per_cell(
   max_edges_per_cell_ = max_edges_per_cell;
 }
 
+void MutableS2ShapeIndex::Options::set_num_threads(int num_threads) {
+  ABSL_DCHECK_GE(num_threads, 1);
+  num_threads_ = max(1, num_threads);
+}
+
 // FaceEdge and ClippedEdge store temporary edge data while the index is being
 // updated.  FaceEdge represents an edge that has been projected onto a given
 // face, while ClippedEdge represents the portion of that edge that has been
@@ -220,6 +237,13 @@ struct MutableS2ShapeIndex::FaceEdge {
   S2Shape::Edge edge;  // The edge endpoints
 };
 
+// A point being indexed by BuildPointIndex().
+struct MutableS2ShapeIndex::PointEntry {
+  S2CellId id;       // The leaf cell containing the point
+  int32_t shape_id;  // The shape that this point belongs to
+  int32_t edge_id;   // Edge id within that shape
+};
+
 struct MutableS2ShapeIndex::ClippedEdge {
   const FaceEdge* face_edge;  // The original unclipped edge
   R2Rect bound;               // Bounding box for the clipped portion
@@ -432,6 +456,122 @@ void MutableS2ShapeIndex::InteriorTracker::RestoreStateBefore(
   is_active_ = saved_is_active_;
 }
 
+// CellArena allocates S2ShapeIndexCells in slabs of geometrically increasing
+// size, so that building a large index does not need a separate heap
+// allocation for every cell.  Deleted cells are recycled using a free list,
+// and all the slabs are freed together when the arena is destroyed.  (The
+// clipped shapes of each cell are allocated separately; see also
+// Options::packed_cells.)
+//
+// The slabs are allocated from the given memory resource (see
+// Options::memory_resource).  The arena does not destroy the cells it
+// contains; all cells must be deleted before the arena is destroyed.
+class MutableS2ShapeIndex::CellArena {
+ public:
+  explicit CellArena(std::pmr::memory_resource* resource)
+      : resource_(resource != nullptr ? resource
+                                      : std::pmr::new_delete_resource()) {}
+
+  ~CellArena() {
+    for (const Slab& slab : slabs_) {
+      resource_->deallocate(slab.slots, slab.size * sizeof(Slot),
+                            alignof(Slot));
+    }
+  }
+
+  // Returns a new empty cell.  The arena retains ownership of the memory.
+  S2ShapeIndexCell* New() {
+    Slot* slot = free_list_;
+    if (slot != nullptr) {
+      free_list_ = slot->next_free;
+    } else {
+      if (slab_used_ == slab_size_) {
+        // Each new slab doubles the arena size, up to a maximum slab size.
+        slab_size_ = std::clamp(num_slots_, kMinSlabSize, kMaxSlabSize);
+        slabs_.push_back({static_cast<Slot*>(resource_->allocate(
+                              slab_size_ * sizeof(Slot), alignof(Slot))),
+                          slab_size_});
+        slab_used_ = 0;
+        num_slots_ += slab_size_;
+      }
+      slot = &slabs_.back().slots[slab_used_++];
+    }
+    return new (slot->cell) S2ShapeIndexCell;
+  }
+
+  // Destroys a cell returned by New() and makes its memory available for
+  // reuse.
+  void Delete(S2ShapeIndexCell* cell) {
+    cell->~S2ShapeIndexCell();
+    Slot* slot = reinterpret_cast<Slot*>(cell);
+    slot->next_free = free_list_;
+    free_list_ = slot;
+  }
+
+  // Transfers all the memory owned by "other", including the cells that it
+  // has allocated, to this arena.
+  //
+  // REQUIRES: Both arenas use the same memory resource.
+  void Splice(CellArena* other) {
+    ABSL_DCHECK(resource_->is_equal(*other->resource_));
+    // Any unused slots at the end of the other arena's last slab are added
+    // to the free list, so that this arena can keep allocating from its own
+    // last slab.
+    if (!other->slabs_.empty()) {
+      Slot* slab = other->slabs_.back().slots;
+      for (size_t i = other->slab_used_; i < other->slab_size_; ++i) {
+        slab[i].next_free = other->free_list_;
+        other->free_list_ = &slab[i];
+      }
+    }
+    while (other->free_list_ != nullptr) {
+      Slot* slot = other->free_list_;
+      other->free_list_ = slot->next_free;
+      slot->next_free = free_list_;
+      free_list_ = slot;
+    }
+    slabs_.insert(slabs_.end() - (slabs_.empty() ? 0 : 1),
+                  std::make_move_iterator(other->slabs_.begin()),
+                  std::make_move_iterator(other->slabs_.end()));
+    num_slots_ += std::exchange(other->num_slots_, 0);
+    other->slabs_.clear();
+    other->slab_size_ = other->slab_used_ = 0;
+  }
+
+  // Returns the number of bytes allocated by this arena.
+  size_t SpaceUsed() const {
+    return sizeof(*this) + slabs_.capacity() * sizeof(slabs_[0]) +
+           num_slots_ * sizeof(Slot);
+  }
+
+ private:
+  static constexpr size_t kMinSlabSize = 8;
+  static constexpr size_t kMaxSlabSize = 4096;
+
+  union Slot {
+    Slot* next_free;
+    alignas(S2ShapeIndexCell) char cell[sizeof(S2ShapeIndexCell)];
+  };
+
+  struct Slab {
+    Slot* slots;
+    size_t size;
+  };
+
+  std::pmr::memory_resource* resource_;
+
+  // New cells are allocated from the end of the last slab, which has
+  // "slab_size_" slots of which "slab_used_" have been allocated.
+  vector<Slab> slabs_;
+  size_t slab_size_ = 0;
+  size_t slab_used_ = 0;
+  size_t num_slots_ = 0;
+  Slot* free_list_ = nullptr;
+
+  CellArena(const CellArena&) = delete;
+  void operator=(const CellArena&) = delete;
+};
+
 MutableS2ShapeIndex::MutableS2ShapeIndex() = default;
 
 MutableS2ShapeIndex::MutableS2ShapeIndex(const Options& options) {
@@ -442,7 +582,10 @@ MutableS2ShapeIndex::MutableS2ShapeIndex(MutableS2ShapeIndex&& b) noexcept
     // S2ShapeIndex has no members.
     : shapes_(std::move(b.shapes_)),
       cell_map_(std::move(b.cell_map_)),
+      cell_arena_(std::move(b.cell_arena_)),
+      frozen_(std::move(b.frozen_)),
       options_(std::move(b.options_)),
+      shape_metadata_(std::move(b.shape_metadata_)),
       pending_additions_begin_(std::exchange(b.pending_additions_begin_, 0)),
       pending_removals_(std::move(b.pending_removals_)),
       index_status_(b.index_status_.exchange(FRESH, std::memory_order_relaxed)),
@@ -453,7 +596,10 @@ MutableS2ShapeIndex& MutableS2ShapeIndex::operator=(
   // S2ShapeIndex has no members.
   shapes_ = std::move(b.shapes_);
   cell_map_.swap(b.cell_map_);
+  cell_arena_.swap(b.cell_arena_);
+  frozen_.swap(b.frozen_);
   options_ = std::move(b.options_);
+  shape_metadata_ = std::move(b.shape_metadata_);
   pending_additions_begin_ = std::exchange(b.pending_additions_begin_, 0);
   pending_removals_ = std::move(b.pending_removals_);
   index_status_.store(
@@ -492,7 +638,14 @@ void MutableS2ShapeIndex::MarkIndexStale() {
 
 void MutableS2ShapeIndex::Minimize() {
   mem_tracker_.Tally(-mem_tracker_.client_usage_bytes());
+  for (const auto& [id, cell] : cell_map_) cell_arena_->Delete(cell);
   cell_map_.clear();
+  if (frozen_ != nullptr) {
+    for (S2ShapeIndexCell* cell : frozen_->cells) cell_arena_->Delete(cell);
+    frozen_.reset();
+  }
+  cell_arena_.reset();
+  vector<S2ShapeMetadata>().swap(shape_metadata_);
   pending_removals_.reset();
   pending_additions_begin_ = 0;
   MarkIndexStale();
@@ -510,6 +663,19 @@ int MutableS2ShapeIndex::Add(unique_ptr<S2Shape> shape) {
   return id;
 }
 
+int MutableS2ShapeIndex::Add(vector<unique_ptr<S2Shape>> shapes) {
+  const int id = shapes_.size();
+  mem_tracker_.AddSpace(&shapes_, shapes.size());
+  for (auto& shape : shapes) shapes_.push_back(std::move(shape));
+  MarkIndexStale();
+  return id;
+}
+
+void MutableS2ShapeIndex::Reserve(int num_shapes) {
+  if (num_shapes <= static_cast<int>(shapes_.size())) return;
+  mem_tracker_.AddSpaceExact(&shapes_, num_shapes - shapes_.size());
+}
+
 unique_ptr<S2Shape> MutableS2ShapeIndex::Release(int shape_id) {
   // This class updates itself lazily, because it is much more efficient to
   // process additions and removals in batches.  However this means that when
@@ -533,7 +699,7 @@ unique_ptr<S2Shape> MutableS2ShapeIndex::Release(int shape_id) {
     removed.shape_id = shape_id;
     removed.has_interior = (shape->dimension() == 2);
     removed.contains_tracker_origin =
-        s2shapeutil::ContainsBruteForce(*shape, InteriorTracker::Origin());
+        ContainsBruteForce(*shape, shape_id, InteriorTracker::Origin());
     int num_edges = shape->num_edges();
     if (!mem_tracker_.AddSpace(&removed.edges, num_edges) ||
         !mem_tracker_.AddSpace(pending_removals_.get(), 1)) {
@@ -562,6 +728,21 @@ void MutableS2ShapeIndex::Clear() {
 }
 
 // Apply any pending updates in a thread-safe way.
+std::future<void> MutableS2ShapeIndex::BuildAsync(
+    const Executor& executor) const {
+  auto done = std::make_shared<std::promise<void>>();
+  std::future<void> future = done->get_future();
+  if (index_status_.load(std::memory_order_acquire) == FRESH) {
+    done->set_value();
+  } else {
+    executor([this, done]() {
+      ForceBuild();
+      done->set_value();
+    });
+  }
+  return future;
+}
+
 void MutableS2ShapeIndex::ApplyUpdatesThreadSafe() {
   lock_.Lock();
   if (index_status_.load(std::memory_order_relaxed) == FRESH) {
@@ -623,9 +804,109 @@ inline void MutableS2ShapeIndex::UnlockAndSignal() {
   }
 }
 
+// Like s2shapeutil::ContainsBruteForce(), but uses the cached reference point
+// of the given shape if available.
+bool MutableS2ShapeIndex::ContainsBruteForce(const S2Shape& shape,
+                                             int shape_id,
+                                             const S2Point& point) const {
+  if (shape_id < static_cast<int>(shape_metadata_.size())) {
+    return s2shapeutil::ContainsBruteForce(
+        shape, shape_metadata_[shape_id].reference_point, point);
+  }
+  return s2shapeutil::ContainsBruteForce(shape, point);
+}
+
+// Computes the metadata of all shapes that have been added since the last
+// call, using up to options_.num_threads() threads.  Returns false if the
+// memory tracker limit was exceeded.
+bool MutableS2ShapeIndex::UpdateShapeMetadata() {
+  const int begin = shape_metadata_.size(), end = shapes_.size();
+  if (begin == end) return true;
+  if (!mem_tracker_.AddSpace(&shape_metadata_, end - begin)) return false;
+  shape_metadata_.resize(end);
+  s2internal::ParallelFor(options_.num_threads(), end - begin, [&](int i) {
+    const S2Shape* shape = shapes_[begin + i].get();
+    if (shape != nullptr) {
+      shape_metadata_[begin + i] = S2ShapeMetadata::Compute(*shape);
+    }
+  });
+  return true;
+}
+
+bool MutableS2ShapeIndex::GetShapeMetadata(int id,
+                                           S2ShapeMetadata* metadata) const {
+  if (!options_.cache_shape_metadata() || shapes_[id] == nullptr) {
+    return false;
+  }
+  MaybeApplyUpdates();
+  // The metadata may be missing if the memory tracker limit was exceeded.
+  if (id >= static_cast<int>(shape_metadata_.size())) return false;
+  *metadata = shape_metadata_[id];
+  return true;
+}
+
+void MutableS2ShapeIndex::Freeze() {
+  ForceBuild();
+  if (frozen_ != nullptr) return;
+  auto frozen = make_unique<FrozenCells>();
+  frozen->ids.reserve(cell_map_.size() + 1);
+  frozen->cells.reserve(cell_map_.size());
+  frozen->block_ids.reserve(
+      (cell_map_.size() + FrozenCells::kBlockSize - 1) /
+      FrozenCells::kBlockSize);
+  for (const auto& [id, cell] : cell_map_) {
+    if (frozen->cells.size() % FrozenCells::kBlockSize == 0) {
+      frozen->block_ids.push_back(id);
+    }
+    frozen->ids.push_back(id);
+    frozen->cells.push_back(cell);
+  }
+  frozen->ids.push_back(S2CellId::Sentinel());
+  cell_map_.clear();
+  frozen_ = std::move(frozen);
+  if (mem_tracker_.is_active()) {
+    mem_tracker_.Tally(-mem_tracker_.client_usage_bytes());
+    mem_tracker_.Tally(SpaceUsed());
+  }
+}
+
+// Converts a frozen index back to the regular form so that it can be
+// updated.  Returns false if the memory tracker limit was exceeded.
+bool MutableS2ShapeIndex::Thaw() {
+  ABSL_DCHECK(frozen_ != nullptr);
+  for (size_t i = 0; i < frozen_->size(); ++i) {
+    cell_map_.insert(cell_map_.end(),
+                     make_pair(frozen_->ids[i], frozen_->cells[i]));
+  }
+  frozen_.reset();
+  if (mem_tracker_.is_active()) {
+    mem_tracker_.Tally(-mem_tracker_.client_usage_bytes());
+    return mem_tracker_.Tally(SpaceUsed());
+  }
+  return true;
+}
+
 // This method updates the index by applying all pending additions and
 // removals.  It does *not* update index_status_ (see ApplyUpdatesThreadSafe).
 void MutableS2ShapeIndex::ApplyUpdatesInternal() {
+  if (frozen_ != nullptr && !Thaw()) return Minimize();
+  if (options_.cache_shape_metadata() && !UpdateShapeMetadata()) {
+    return Minimize();
+  }
+  if (RemoveShapesInPlace()) {
+    if (mem_tracker_.is_active()) {
+      mem_tracker_.Tally(-mem_tracker_.client_usage_bytes());
+      if (!mem_tracker_.Tally(SpaceUsed())) return Minimize();
+    }
+    return;
+  }
+  if (BuildPointIndex()) {
+    if (mem_tracker_.is_active()) {
+      mem_tracker_.Tally(-mem_tracker_.client_usage_bytes());
+      if (!mem_tracker_.Tally(SpaceUsed())) return Minimize();
+    }
+    return;
+  }
   // Check whether we have so many edges to process that we should process
   // them in multiple batches to save memory.  Building the index can use up
   // to 20x as much memory (per edge) as the final index size.
@@ -640,6 +921,10 @@ void MutableS2ShapeIndex::ApplyUpdatesInternal() {
     if (!mem_tracker_.ok()) return Minimize();
 
     InteriorTracker tracker;
+    // The cube faces can be indexed independently only if there are no
+    // existing index cells that need to be merged with the new edges.
+    const bool index_faces_in_parallel =
+        options_.num_threads() > 1 && cell_map_.empty() && !pending_removals_;
     if (pending_removals_) {
       // The first batch implicitly includes all shapes being removed.
       for (const auto& pending_removal : *pending_removals_) {
@@ -647,21 +932,30 @@ void MutableS2ShapeIndex::ApplyUpdatesInternal() {
       }
       pending_removals_.reset(nullptr);
     }
-    // A batch consists of zero or more full shapes followed by zero or one
-    // partial shapes.  The loop below handles all such cases.
-    for (auto begin = batch.begin; begin < batch.end;
-         ++begin.shape_id, begin.edge_id = 0) {
-      const S2Shape* shape = this->shape(begin.shape_id);
-      if (shape == nullptr) continue;  // Already removed.
-      int edges_end = begin.shape_id == batch.end.shape_id ? batch.end.edge_id
-                                                           : shape->num_edges();
-      AddShape(shape, begin.shape_id, begin.edge_id, edges_end, all_edges,
-               &tracker);
+    if (options_.num_threads() > 1) {
+      AddShapesParallel(batch, all_edges, &tracker);
+    } else {
+      // A batch consists of zero or more full shapes followed by zero or one
+      // partial shapes.  The loop below handles all such cases.
+      for (auto begin = batch.begin; begin < batch.end;
+           ++begin.shape_id, begin.edge_id = 0) {
+        const S2Shape* shape = this->shape(begin.shape_id);
+        if (shape == nullptr) continue;  // Already removed.
+        int edges_end = begin.shape_id == batch.end.shape_id
+                            ? batch.end.edge_id
+                            : shape->num_edges();
+        AddShape(shape, begin.shape_id, begin.edge_id, edges_end, all_edges,
+                 &tracker);
+      }
     }
-    for (int face = 0; face < 6; ++face) {
-      UpdateFaceEdges(face, all_edges[face], &tracker);
-      // Save memory by clearing vectors after we are done with them.
-      vector<FaceEdge>().swap(all_edges[face]);
+    if (index_faces_in_parallel) {
+      UpdateFacesParallel(batch, all_edges, tracker);
+    } else {
+      for (int face = 0; face < 6; ++face) {
+        UpdateFaceEdges(face, all_edges[face], &tracker);
+        // Save memory by clearing vectors after we are done with them.
+        vector<FaceEdge>().swap(all_edges[face]);
+      }
     }
     pending_additions_begin_ = batch.end.shape_id;
     if (batch.begin.edge_id > 0 && batch.end.edge_id == 0) {
@@ -678,6 +972,182 @@ void MutableS2ShapeIndex::ApplyUpdatesInternal() {
   // It is the caller's responsibility to update index_status_.
 }
 
+// Applies the pending removals by deleting the removed shapes from the index
+// cells that contain them, rather than absorbing those cells and clipping all
+// of their remaining edges again.  This makes removing a few shapes from a
+// large index proportional to the number of cells that contain them.
+//
+// Removing a shape never requires a cell to be subdivided further, but it can
+// cause a cell to become empty (in which case it is deleted) or leave it with
+// more "short" edges than MakeIndexCell() would allow.  In the latter case,
+// and also when shapes are being added or a removed shape contains the entire
+// sphere, this method returns false without modifying the index and the
+// updates are applied in the usual way.
+bool MutableS2ShapeIndex::RemoveShapesInPlace() {
+  if (!pending_removals_) return false;
+  for (size_t id = pending_additions_begin_; id < shapes_.size(); ++id) {
+    if (shapes_[id] != nullptr) return false;
+  }
+  vector<int> removed_ids;
+  vector<S2CellId> cell_ids;
+  for (const RemovedShape& removed : *pending_removals_) {
+    if (removed.edges.empty() && removed.has_interior &&
+        removed.contains_tracker_origin) {
+      return false;  // A full shape is present in every cell.
+    }
+    removed_ids.push_back(removed.shape_id);
+    FindCellsContainingShape(removed, &cell_ids);
+  }
+  std::sort(removed_ids.begin(), removed_ids.end());
+  std::sort(cell_ids.begin(), cell_ids.end());
+  cell_ids.erase(std::unique(cell_ids.begin(), cell_ids.end()),
+                 cell_ids.end());
+
+  // Check all the cells before modifying any of them.
+  vector<S2ShapeIndexCell*> cells;
+  cells.reserve(cell_ids.size());
+  for (S2CellId id : cell_ids) {
+    auto it = cell_map_.find(id);
+    ABSL_DCHECK(it != cell_map_.end());
+    if (!IsValidAfterRemoval(id, *it->second, removed_ids)) return false;
+    cells.push_back(it->second);
+  }
+  for (size_t i = 0; i < cells.size(); ++i) {
+    S2ShapeIndexCell* cell = cells[i];
+    auto& shapes = cell->shapes_;
+    for (auto it = shapes.begin(); it != shapes.end();) {
+      if (std::binary_search(removed_ids.begin(), removed_ids.end(),
+                             it->shape_id())) {
+        // Packed edges are freed together with the cell.
+        if (cell->packed_edges_ == nullptr) it->Destruct();
+        it = shapes.erase(it);
+      } else {
+        ++it;
+      }
+    }
+    if (shapes.empty()) {
+      cell_map_.erase(cell_ids[i]);
+      cell_arena()->Delete(cell);
+    }
+  }
+  pending_removals_.reset();
+  pending_additions_begin_ = shapes_.size();
+  return true;
+}
+
+// Appends the ids of all index cells that contain the given removed shape.
+// The cells that intersect its edges are found by descending from the face
+// cells, and the cells in its interior (if any) are found by visiting the
+// neighbors of the cells found so far.  Each connected component of the
+// shape's interior is bounded by its edges, so this finds every index cell
+// whose contains_center() is set for it.
+void MutableS2ShapeIndex::FindCellsContainingShape(
+    const RemovedShape& removed, vector<S2CellId>* cell_ids) const {
+  Iterator iter;
+  iter.InitStale(this);
+  absl::flat_hash_set<S2CellId> visited;
+  vector<S2CellId> queue;
+  auto visit = [&](S2CellId id, const S2ShapeIndexCell& cell) {
+    if (cell.find_clipped(removed.shape_id) == nullptr) return;
+    if (!visited.insert(id).second) return;
+    cell_ids->push_back(id);
+    queue.push_back(id);
+  };
+
+  // Find the cells that intersect the edges, using the same padded face
+  // clipping as when the edges were added.
+  vector<FaceEdge> all_edges[6];
+  FaceEdge face_edge{};
+  for (const S2Shape::Edge& edge : removed.edges) {
+    face_edge.edge = edge;
+    AddFaceEdge(&face_edge, all_edges);
+  }
+  vector<S2PaddedCell> stack;
+  for (int face = 0; face < 6; ++face) {
+    for (const FaceEdge& edge : all_edges[face]) {
+      const R2Rect bound = R2Rect::FromPointPair(edge.a, edge.b);
+      stack.emplace_back(S2CellId::FromFace(face), kCellPadding);
+      while (!stack.empty()) {
+        S2PaddedCell pcell = stack.back();
+        stack.pop_back();
+        S2CellRelation r = iter.Locate(pcell.id());
+        if (r == S2CellRelation::INDEXED) {
+          visit(iter.id(), iter.cell());
+        } else if (r == S2CellRelation::SUBDIVIDED) {
+          for (int pos = 0; pos < 4; ++pos) {
+            int i, j;
+            pcell.GetChildIJ(pos, &i, &j);
+            S2PaddedCell child(pcell, i, j);
+            if (child.bound().Intersects(bound)) stack.push_back(child);
+          }
+        }
+      }
+    }
+  }
+
+  // Flood fill the interior through the neighbors of the cells found so far.
+  if (removed.has_interior) {
+    while (!queue.empty()) {
+      S2CellId id = queue.back();
+      queue.pop_back();
+      S2CellId neighbors[4];
+      id.GetEdgeNeighbors(neighbors);
+      for (S2CellId neighbor : neighbors) {
+        S2CellRelation r = iter.Locate(neighbor);
+        if (r == S2CellRelation::INDEXED) {
+          visit(iter.id(), iter.cell());
+        } else if (r == S2CellRelation::SUBDIVIDED) {
+          for (; !iter.done() && iter.id() <= neighbor.range_max();
+               iter.Next()) {
+            visit(iter.id(), iter.cell());
+          }
+        }
+      }
+    }
+  }
+}
+
+// Returns true if the given index cell would still satisfy the subdivision
+// criteria of MakeIndexCell() once the given shapes are removed from it.
+bool MutableS2ShapeIndex::IsValidAfterRemoval(
+    S2CellId id, const S2ShapeIndexCell& cell,
+    absl::Span<const int> removed_ids) const {
+  auto is_removed = [removed_ids](int shape_id) {
+    return std::binary_search(removed_ids.begin(), removed_ids.end(),
+                              shape_id);
+  };
+  int num_edges = 0;
+  for (const S2ClippedShape& clipped : cell.clipped_shapes()) {
+    if (!is_removed(clipped.shape_id())) num_edges += clipped.num_edges();
+  }
+  if (num_edges <= options_.max_edges_per_cell()) return true;
+
+  // Count the short edges and the shapes that contain the cell's entry
+  // vertex, exactly as MakeIndexCell() would.
+  S2PaddedCell pcell(id, kCellPadding);
+  S2CopyingEdgeCrosser crosser(pcell.GetCenter(), pcell.GetEntryVertex());
+  int num_short_edges = 0, num_containing_shapes = 0;
+  for (const S2ClippedShape& clipped : cell.clipped_shapes()) {
+    if (is_removed(clipped.shape_id())) continue;
+    const S2Shape* shape = this->shape(clipped.shape_id());
+    bool contains = clipped.contains_center();
+    for (int i = 0; i < clipped.num_edges(); ++i) {
+      S2Shape::Edge edge = shape->edge(clipped.edge(i));
+      num_short_edges += id.level() < GetEdgeMaxLevel(edge);
+      if (crosser.EdgeOrVertexCrossing(edge.v0, edge.v1)) {
+        contains = !contains;
+      }
+    }
+    if (shape->dimension() == 2) num_containing_shapes += contains;
+  }
+  int max_short_edges =
+      max(options_.max_edges_per_cell(),
+          static_cast<int>(
+              absl::GetFlag(FLAGS_s2shape_index_min_short_edge_fraction) *
+              (num_edges + num_containing_shapes)));
+  return num_short_edges <= max_short_edges;
+}
+
 // Count the number of edges being updated, and break them into several
 // batches if necessary to reduce the amount of memory needed.  (See the
 // documentation for FLAGS_s2shape_index_tmp_memory_budget.)
@@ -696,7 +1166,7 @@ MutableS2ShapeIndex::GetUpdateBatches() const {
     if (shape) num_edges_added += shape->num_edges();
   }
   BatchGenerator batch_gen(num_edges_removed, num_edges_added,
-                           pending_additions_begin_);
+                           pending_additions_begin_, options_.sorted_input());
   for (size_t id = pending_additions_begin_; id < shapes_.size(); ++id) {
     const S2Shape* shape = this->shape(id);
     if (shape) batch_gen.AddShape(id, shape->num_edges());
@@ -733,10 +1203,18 @@ static constexpr size_t kTmpBytesPerEdge = 226;
 // when building an index of 350 million edges.
 static constexpr int kMaxBatches = 100;
 
+// The maximum number of edges in each batch when Options::sorted_input() is
+// true.  Each batch uses about 4 MB of temporary memory.  Much smaller
+// batches are slower because the index cells along the boundary between
+// consecutive batches need to be rebuilt.
+static constexpr int kSortedInputBatchSize = 16384;
+
 MutableS2ShapeIndex::BatchGenerator::BatchGenerator(int num_edges_removed,
                                                     int num_edges_added,
-                                                    int shape_id_begin)
-    : max_batch_sizes_(GetMaxBatchSizes(num_edges_removed, num_edges_added)),
+                                                    int shape_id_begin,
+                                                    bool sorted_input)
+    : max_batch_sizes_(GetMaxBatchSizes(num_edges_removed, num_edges_added,
+                                        sorted_input)),
       batch_begin_(shape_id_begin, 0),
       shape_id_end_(shape_id_begin) {
   if (max_batch_sizes_.size() > 1) {
@@ -825,11 +1303,27 @@ void MutableS2ShapeIndex::BatchGenerator::FinishBatch(int num_edges,
 // indicating the desired number of edges in each batch.
 /* static */
 vector<int> MutableS2ShapeIndex::BatchGenerator::GetMaxBatchSizes(
-    int num_edges_removed, int num_edges_added) {
+    int num_edges_removed, int num_edges_added, bool sorted_input) {
   // Check whether we can update all the edges at once.
   int num_edges_total = num_edges_removed + num_edges_added;
   const double tmp_memory_budget_bytes =
       absl::GetFlag(FLAGS_s2shape_index_tmp_memory_budget);
+  if (sorted_input && num_edges_total > kSortedInputBatchSize) {
+    // Each batch only modifies the index cells near its own edges, so the
+    // batches can all have the same size and there is no limit on their
+    // number.  Removed edges are processed first as usual.
+    vector<int> batch_sizes;
+    int num_edges_left = num_edges_added;
+    if (num_edges_removed > kSortedInputBatchSize) {
+      batch_sizes.push_back(num_edges_removed);
+    } else {
+      num_edges_left += num_edges_removed;
+    }
+    for (; num_edges_left > 0; num_edges_left -= kSortedInputBatchSize) {
+      batch_sizes.push_back(kSortedInputBatchSize);
+    }
+    return batch_sizes;
+  }
   if (num_edges_total * kTmpBytesPerEdge <= tmp_memory_budget_bytes) {
     return vector<int>{num_edges_total};
   }
@@ -1007,7 +1501,7 @@ void MutableS2ShapeIndex::AddShape(const S2Shape* shape, int shape_id,
       edge.has_interior = true;
       tracker->AddShape(
           edge.shape_id,
-          s2shapeutil::ContainsBruteForce(*shape, tracker->focus()));
+          ContainsBruteForce(*shape, edge.shape_id, tracker->focus()));
     }
   }
   for (int e = edges_begin; e < edges_end; ++e) {
@@ -1035,6 +1529,96 @@ void MutableS2ShapeIndex::RemoveShape(const RemovedShape& removed,
   }
 }
 
+// Equivalent to calling AddShape() for every shape in the given batch, except
+// that the work is divided among options_.num_threads() threads.  The edges
+// are appended to "all_edges" in exactly the same order as AddShape() would
+// append them, so that the resulting index does not depend on the number of
+// threads used.
+void MutableS2ShapeIndex::AddShapesParallel(const BatchDescriptor& batch,
+                                            vector<FaceEdge> all_edges[6],
+                                            InteriorTracker* tracker) const {
+  // A contiguous range of edges from a single shape.
+  struct EdgeRange {
+    const S2Shape* shape;
+    int shape_id;
+    int edges_begin, edges_end;
+    bool has_interior;
+  };
+  // Shapes are split into ranges of at most this many edges so that a batch
+  // consisting of a few huge shapes is still balanced across threads.
+  constexpr int kMaxEdgesPerRange = 10000;
+
+  // First update the InteriorTracker state.  Testing whether a shape contains
+  // the tracker focus is linear in the number of shape edges, so this is
+  // done in parallel as well.
+  vector<EdgeRange> ranges;
+  vector<const EdgeRange*> interior_shapes;
+  for (auto begin = batch.begin; begin < batch.end;
+       ++begin.shape_id, begin.edge_id = 0) {
+    const S2Shape* shape = this->shape(begin.shape_id);
+    if (shape == nullptr) continue;  // Already removed.
+    int edges_end = begin.shape_id == batch.end.shape_id ? batch.end.edge_id
+                                                         : shape->num_edges();
+    bool has_interior = false;
+    if (shape->dimension() == 2) {
+      // See AddShape() for how shapes split over several batches are handled.
+      if (begin.edge_id > 0 || edges_end < shape->num_edges()) {
+        tracker->set_partial_shape_id(begin.shape_id);
+      } else {
+        has_interior = true;
+      }
+    }
+    ranges.push_back(EdgeRange{shape, begin.shape_id, begin.edge_id,
+                               edges_end, has_interior});
+  }
+  for (const EdgeRange& range : ranges) {
+    if (range.has_interior) interior_shapes.push_back(&range);
+  }
+  vector<char> contains_focus(interior_shapes.size());
+  const S2Point focus = tracker->focus();
+  s2internal::ParallelFor(
+      options_.num_threads(), interior_shapes.size(), [&](int i) {
+        contains_focus[i] = ContainsBruteForce(
+            *interior_shapes[i]->shape, interior_shapes[i]->shape_id, focus);
+      });
+  for (size_t i = 0; i < interior_shapes.size(); ++i) {
+    tracker->AddShape(interior_shapes[i]->shape_id, contains_focus[i]);
+  }
+
+  // Now split the shapes into tasks and clip their edges to the cube faces.
+  vector<EdgeRange> tasks;
+  for (const EdgeRange& range : ranges) {
+    for (int e = range.edges_begin; e < range.edges_end;
+         e += kMaxEdgesPerRange) {
+      EdgeRange task = range;
+      task.edges_begin = e;
+      task.edges_end = min(range.edges_end, e + kMaxEdgesPerRange);
+      tasks.push_back(task);
+    }
+  }
+  vector<std::array<vector<FaceEdge>, 6>> task_edges(tasks.size());
+  s2internal::ParallelFor(options_.num_threads(), tasks.size(), [&](int t) {
+    const EdgeRange& task = tasks[t];
+    FaceEdge edge;
+    edge.shape_id = task.shape_id;
+    edge.has_interior = task.has_interior;
+    for (int e = task.edges_begin; e < task.edges_end; ++e) {
+      edge.edge_id = e;
+      edge.edge = task.shape->edge(e);
+      edge.max_level = GetEdgeMaxLevel(edge.edge);
+      AddFaceEdge(&edge, task_edges[t].data());
+    }
+  });
+  // Concatenate the results in task order.
+  for (int face = 0; face < 6; ++face) {
+    for (auto& edges : task_edges) {
+      all_edges[face].insert(all_edges[face].end(), edges[face].begin(),
+                             edges[face].end());
+      vector<FaceEdge>().swap(edges[face]);
+    }
+  }
+}
+
 void MutableS2ShapeIndex::FinishPartialShape(int shape_id) {
   if (shape_id < 0) return;  // The partial shape did not have an interior.
   const S2Shape* shape = this->shape(shape_id);
@@ -1072,7 +1656,7 @@ void MutableS2ShapeIndex::FinishPartialShape(int shape_id) {
   vector<S2Shape::Edge> tmp_edges;  // Temporary storage.
   InteriorTracker tracker;
   tracker.AddShape(shape_id,
-                   s2shapeutil::ContainsBruteForce(*shape, tracker.focus()));
+                   ContainsBruteForce(*shape, shape_id, tracker.focus()));
   S2CellId begin = S2CellId::Begin(S2CellId::kMaxLevel);
   for (CellMap::iterator index_it = cell_map_.begin(); ; ++index_it) {
     if (!tracker.shape_ids().empty()) {
@@ -1083,12 +1667,11 @@ void MutableS2ShapeIndex::FinishPartialShape(int shape_id) {
                                         : S2CellId::End(S2CellId::kMaxLevel);
       if (begin != fill_end) {
         for (S2CellId cellid : S2CellUnion::FromBeginEnd(begin, fill_end)) {
-          auto cell = make_unique<S2ShapeIndexCell>();
+          S2ShapeIndexCell* cell = cell_arena()->New();
           S2ClippedShape* clipped = cell->add_shapes(1);
           clipped->Init(shape_id, 0);
           clipped->set_contains_center(true);
-          index_it =
-              cell_map_.insert(index_it, make_pair(cellid, std::move(cell)));
+          index_it = cell_map_.insert(index_it, make_pair(cellid, cell));
           ++index_it;
         }
       }
@@ -1164,6 +1747,13 @@ inline void MutableS2ShapeIndex::AddFaceEdge(
 
 // Returns the first level for which the given edge will be considered "long",
 // i.e. it will not count towards the max_edges_per_cell() limit.
+MutableS2ShapeIndex::CellArena* MutableS2ShapeIndex::cell_arena() {
+  if (cell_arena_ == nullptr) {
+    cell_arena_ = make_unique<CellArena>(options_.memory_resource());
+  }
+  return cell_arena_.get();
+}
+
 int MutableS2ShapeIndex::GetEdgeMaxLevel(const S2Shape::Edge& edge) const {
   // Compute the maximum cell edge length for which this edge is considered
   // "long".  The calculation does not need to be perfectly accurate, so we
@@ -1227,6 +1817,27 @@ class MutableS2ShapeIndex::EdgeAllocator {
 void MutableS2ShapeIndex::UpdateFaceEdges(int face,
                                           absl::Span<const FaceEdge> face_edges,
                                           InteriorTracker* tracker) {
+  // "disjoint_from_index" means that the current cell being processed (and
+  // all its descendants) are not already present in the index.  It is set to
+  // true during the recursion whenever we detect that the current cell is
+  // disjoint from the index.  We could save a tiny bit of work by setting
+  // this flag to true here on the very first update, however currently there
+  // is no easy way to check that.  (It's not sufficient to test whether
+  // cell_map_.empty() or pending_additions_begin_ == 0.)
+  UpdateFaceEdges(face, face_edges, tracker, &cell_map_, cell_arena(),
+                  false /*disjoint_from_index*/);
+}
+
+// As above, but inserts the new index cells into "cell_map" and allocates
+// them from "cell_arena".  If "disjoint_from_index" is true then cell_map_ is
+// not consulted at all, which allows several faces to be updated concurrently
+// (see UpdateFacesParallel).
+void MutableS2ShapeIndex::UpdateFaceEdges(int face,
+                                          absl::Span<const FaceEdge> face_edges,
+                                          InteriorTracker* tracker,
+                                          CellMap* cell_map,
+                                          CellArena* cell_arena,
+                                          bool disjoint_from_index) {
   int num_edges = face_edges.size();
   if (num_edges == 0 && tracker->shape_ids().empty()) return;
 
@@ -1253,39 +1864,108 @@ void MutableS2ShapeIndex::UpdateFaceEdges(int face,
   EdgeAllocator alloc;
   S2CellId face_id = S2CellId::FromFace(face);
   S2PaddedCell pcell(face_id, kCellPadding);
-
-  // "disjoint_from_index" means that the current cell being processed (and
-  // all its descendants) are not already present in the index.  It is set to
-  // true during the recursion whenever we detect that the current cell is
-  // disjoint from the index.  We could save a tiny bit of work by setting
-  // this flag to true here on the very first update, however currently there
-  // is no easy way to check that.  (It's not sufficient to test whether
-  // cell_map_.empty() or pending_additions_begin_ == 0.)
-  bool disjoint_from_index = false;
   if (num_edges > 0) {
-    S2CellId shrunk_id = ShrinkToFit(pcell, bound);
+    S2CellId shrunk_id = ShrinkToFit(pcell, bound, disjoint_from_index);
     if (shrunk_id != pcell.id()) {
       // All the edges are contained by some descendant of the face cell.  We
       // can save a lot of work by starting directly with that cell, but if we
       // are in the interior of at least one shape then we need to create
       // index entries for the cells we are skipping over.
       SkipCellRange(face_id.range_min(), shrunk_id.range_min(),
-                    tracker, &alloc, disjoint_from_index);
+                    tracker, &alloc, cell_map, cell_arena,
+                    disjoint_from_index);
       pcell = S2PaddedCell(shrunk_id, kCellPadding);
-      UpdateEdges(pcell, &clipped_edges, tracker, &alloc, disjoint_from_index);
+      UpdateEdges(pcell, &clipped_edges, tracker, &alloc, cell_map,
+                  cell_arena, disjoint_from_index);
       SkipCellRange(shrunk_id.range_max().next(), face_id.range_max().next(),
-                    tracker, &alloc, disjoint_from_index);
+                    tracker, &alloc, cell_map, cell_arena,
+                    disjoint_from_index);
       return;
     }
   }
   // Otherwise (no edges, or no shrinking is possible), subdivide normally.
-  UpdateEdges(pcell, &clipped_edges, tracker, &alloc, disjoint_from_index);
+  UpdateEdges(pcell, &clipped_edges, tracker, &alloc, cell_map, cell_arena,
+              disjoint_from_index);
+}
+
+// Indexes the six cube faces concurrently and then merges the results into
+// cell_map_.  "tracker" is the InteriorTracker that would have been used to
+// index the faces sequentially (positioned at InteriorTracker::Origin()).
+//
+// REQUIRES: cell_map_ is empty and no shapes are being removed.
+void MutableS2ShapeIndex::UpdateFacesParallel(const BatchDescriptor& batch,
+                                              vector<FaceEdge> all_edges[6],
+                                              const InteriorTracker& tracker) {
+  ABSL_DCHECK(cell_map_.empty());
+
+  // When the faces are processed sequentially, the InteriorTracker state
+  // carries over from the end of one face to the start of the next.  Here we
+  // instead compute the set of shapes that contain the entry vertex of each
+  // face directly.  (Face 0 starts at the tracker origin, so we can use the
+  // existing tracker state for that face.)
+  vector<int> interior_shapes;
+  for (auto begin = batch.begin; begin < batch.end;
+       ++begin.shape_id, begin.edge_id = 0) {
+    const S2Shape* shape = this->shape(begin.shape_id);
+    if (shape != nullptr && shape->dimension() == 2 &&
+        begin.shape_id != tracker.partial_shape_id()) {
+      interior_shapes.push_back(begin.shape_id);
+    }
+  }
+  const int num_shapes = interior_shapes.size();
+  vector<char> contains_entry(6 * num_shapes);
+  for (int i = 0; i < num_shapes; ++i) {
+    contains_entry[i] = std::binary_search(tracker.shape_ids().begin(),
+                                           tracker.shape_ids().end(),
+                                           interior_shapes[i]);
+  }
+  s2internal::ParallelFor(
+      options_.num_threads(), 5 * num_shapes, [&](int task) {
+        int face = 1 + task / num_shapes, i = task % num_shapes;
+        S2Point entry = S2PaddedCell(S2CellId::FromFace(face), kCellPadding)
+                            .GetEntryVertex();
+        contains_entry[face * num_shapes + i] = ContainsBruteForce(
+            *shape(interior_shapes[i]), interior_shapes[i], entry);
+      });
+
+  CellMap face_cell_maps[6];
+  unique_ptr<CellArena> face_cell_arenas[6];
+  for (auto& arena : face_cell_arenas) {
+    arena = make_unique<CellArena>(options_.memory_resource());
+  }
+  s2internal::ParallelFor(options_.num_threads(), 6, [&](int face) {
+    InteriorTracker face_tracker;
+    face_tracker.set_partial_shape_id(tracker.partial_shape_id());
+    for (int i = 0; i < num_shapes; ++i) {
+      face_tracker.AddShape(interior_shapes[i],
+                            contains_entry[face * num_shapes + i]);
+    }
+    // The tracker is already positioned at the start of face 0.
+    if (face > 0) {
+      S2CellId face_id = S2CellId::FromFace(face);
+      face_tracker.MoveTo(S2PaddedCell(face_id, kCellPadding).GetEntryVertex());
+      face_tracker.set_next_cellid(face_id);
+    }
+    UpdateFaceEdges(face, all_edges[face], &face_tracker,
+                    &face_cell_maps[face], face_cell_arenas[face].get(),
+                    true /*disjoint_from_index*/);
+    vector<FaceEdge>().swap(all_edges[face]);
+  });
+  // The faces are disjoint and appear in face order along the S2CellId
+  // space-filling curve, so every insertion is at the end of cell_map_.
+  for (int face = 0; face < 6; ++face) {
+    for (const auto& [id, cell] : face_cell_maps[face]) {
+      cell_map_.insert(cell_map_.end(), make_pair(id, cell));
+    }
+    cell_arena()->Splice(face_cell_arenas[face].get());
+  }
 }
 
 S2CellId MutableS2ShapeIndex::ShrinkToFit(const S2PaddedCell& pcell,
-                                          const R2Rect& bound) const {
+                                          const R2Rect& bound,
+                                          bool disjoint_from_index) const {
   S2CellId shrunk_id = pcell.ShrinkToFit(bound);
-  if (shrunk_id != pcell.id()) {
+  if (shrunk_id != pcell.id() && !disjoint_from_index) {
     // Don't shrink any smaller than the existing index cells, since we need
     // to combine the new edges with those cells.  Use InitStale() to avoid
     // applying updates recursively.
@@ -1304,6 +1984,8 @@ S2CellId MutableS2ShapeIndex::ShrinkToFit(const S2PaddedCell& pcell,
 void MutableS2ShapeIndex::SkipCellRange(S2CellId begin, S2CellId end,
                                         InteriorTracker* tracker,
                                         EdgeAllocator* alloc,
+                                        CellMap* cell_map,
+                                        CellArena* cell_arena,
                                         bool disjoint_from_index) {
   // If we aren't in the interior of a shape, then skipping over cells is easy.
   if (tracker->shape_ids().empty()) return;
@@ -1313,7 +1995,8 @@ void MutableS2ShapeIndex::SkipCellRange(S2CellId begin, S2CellId end,
   for (S2CellId skipped_id : S2CellUnion::FromBeginEnd(begin, end)) {
     vector<const ClippedEdge*> clipped_edges;
     UpdateEdges(S2PaddedCell(skipped_id, kCellPadding),
-                &clipped_edges, tracker, alloc, disjoint_from_index);
+                &clipped_edges, tracker, alloc, cell_map, cell_arena,
+                disjoint_from_index);
   }
 }
 
@@ -1339,15 +2022,55 @@ inline void MutableS2ShapeIndex::ClipVAxis(
   }
 }
 
+// Given an edge and the "middle" of a padded cell (the rectangle that belongs
+// to all four padded children), clip the edge against the boundaries of
+// "middle" and add it to the corresponding children.  The (i,j) directions
+// are left (i=0), right (i=1), lower (j=0), and upper (j=1).  Note that the
+// vast majority of edges are propagated to a single child.  This case is very
+// fast, consisting of between 2 and 4 floating-point comparisons and copying
+// one pointer.  (ClipVAxis is inline.)
+/* static */ ABSL_ATTRIBUTE_ALWAYS_INLINE
+inline void MutableS2ShapeIndex::ClipToChildren(
+    const ClippedEdge* edge, const R2Rect& middle,
+    vector<const ClippedEdge*> child_edges[2][2], EdgeAllocator* alloc) {
+  if (edge->bound[0].hi() <= middle[0].lo()) {
+    // Edge is entirely contained in the two left children.
+    ClipVAxis(edge, middle[1], child_edges[0], alloc);
+  } else if (edge->bound[0].lo() >= middle[0].hi()) {
+    // Edge is entirely contained in the two right children.
+    ClipVAxis(edge, middle[1], child_edges[1], alloc);
+  } else if (edge->bound[1].hi() <= middle[1].lo()) {
+    // Edge is entirely contained in the two lower children.
+    child_edges[0][0].push_back(ClipUBound(edge, 1, middle[0].hi(), alloc));
+    child_edges[1][0].push_back(ClipUBound(edge, 0, middle[0].lo(), alloc));
+  } else if (edge->bound[1].lo() >= middle[1].hi()) {
+    // Edge is entirely contained in the two upper children.
+    child_edges[0][1].push_back(ClipUBound(edge, 1, middle[0].hi(), alloc));
+    child_edges[1][1].push_back(ClipUBound(edge, 0, middle[0].lo(), alloc));
+  } else {
+    // The edge bound spans all four children.  The edge itself intersects
+    // either three or four (padded) children.
+    const ClippedEdge* left = ClipUBound(edge, 1, middle[0].hi(), alloc);
+    ClipVAxis(left, middle[1], child_edges[0], alloc);
+    const ClippedEdge* right = ClipUBound(edge, 0, middle[0].lo(), alloc);
+    ClipVAxis(right, middle[1], child_edges[1], alloc);
+  }
+}
+
 // Given a cell and a set of ClippedEdges whose bounding boxes intersect that
 // cell, add or remove all the edges from the index.  Temporary space for
 // edges that need to be subdivided is allocated from the given EdgeAllocator.
-// "disjoint_from_index" is an optimization hint indicating that cell_map_
-// does not contain any entries that overlap the given cell.
+// New index cells are allocated from "cell_arena" and inserted into
+// "cell_map".  "disjoint_from_index" is an optimization hint indicating that
+// cell_map_ does not contain any entries that overlap the given cell.
+//
+// REQUIRES: cell_map == &cell_map_ unless disjoint_from_index is true.
 void MutableS2ShapeIndex::UpdateEdges(const S2PaddedCell& pcell,
                                       vector<const ClippedEdge*>* edges,
                                       InteriorTracker* tracker,
                                       EdgeAllocator* alloc,
+                                      CellMap* cell_map,
+                                      CellArena* cell_arena,
                                       bool disjoint_from_index) {
   // Cases where an index cell is not needed should be detected before this.
   ABSL_DCHECK(!edges->empty() || !tracker->shape_ids().empty());
@@ -1400,7 +2123,9 @@ void MutableS2ShapeIndex::UpdateEdges(const S2PaddedCell& pcell,
   // subdividing so that we can merge with those cells.  Otherwise,
   // MakeIndexCell checks if the number of edges is small enough, and creates
   // an index cell if possible (returning true when it does so).
-  if (!disjoint_from_index || !MakeIndexCell(pcell, *edges, tracker)) {
+  ABSL_DCHECK(disjoint_from_index || cell_map == &cell_map_);
+  if (!disjoint_from_index ||
+      !MakeIndexCell(pcell, *edges, tracker, cell_map, cell_arena)) {
     // Reserve space for the edges that will be passed to each child.  This is
     // important since otherwise the running time is dominated by the time
     // required to grow the vectors.  The amount of memory involved is
@@ -1423,35 +2148,9 @@ void MutableS2ShapeIndex::UpdateEdges(const S2PaddedCell& pcell,
     // each edge needs to be propagated to.
     const R2Rect& middle = pcell.middle();
 
-    // Build up a vector edges to be passed to each child cell.  The (i,j)
-    // directions are left (i=0), right (i=1), lower (j=0), and upper (j=1).
-    // Note that the vast majority of edges are propagated to a single child.
-    // This case is very fast, consisting of between 2 and 4 floating-point
-    // comparisons and copying one pointer.  (ClipVAxis is inline.)
+    // Build up a vector edges to be passed to each child cell.
     for (int e = 0; e < num_edges; ++e) {
-      const ClippedEdge* edge = (*edges)[e];
-      if (edge->bound[0].hi() <= middle[0].lo()) {
-        // Edge is entirely contained in the two left children.
-        ClipVAxis(edge, middle[1], child_edges[0], alloc);
-      } else if (edge->bound[0].lo() >= middle[0].hi()) {
-        // Edge is entirely contained in the two right children.
-        ClipVAxis(edge, middle[1], child_edges[1], alloc);
-      } else if (edge->bound[1].hi() <= middle[1].lo()) {
-        // Edge is entirely contained in the two lower children.
-        child_edges[0][0].push_back(ClipUBound(edge, 1, middle[0].hi(), alloc));
-        child_edges[1][0].push_back(ClipUBound(edge, 0, middle[0].lo(), alloc));
-      } else if (edge->bound[1].lo() >= middle[1].hi()) {
-        // Edge is entirely contained in the two upper children.
-        child_edges[0][1].push_back(ClipUBound(edge, 1, middle[0].hi(), alloc));
-        child_edges[1][1].push_back(ClipUBound(edge, 0, middle[0].lo(), alloc));
-      } else {
-        // The edge bound spans all four children.  The edge itself intersects
-        // either three or four (padded) children.
-        const ClippedEdge* left = ClipUBound(edge, 1, middle[0].hi(), alloc);
-        ClipVAxis(left, middle[1], child_edges[0], alloc);
-        const ClippedEdge* right = ClipUBound(edge, 0, middle[0].lo(), alloc);
-        ClipVAxis(right, middle[1], child_edges[1], alloc);
-      }
+      ClipToChildren((*edges)[e], middle, child_edges, alloc);
     }
     // Free any memory reserved for children that turned out to be empty.  This
     // step is cheap and reduces peak memory usage by about 10% when building
@@ -1471,7 +2170,8 @@ void MutableS2ShapeIndex::UpdateEdges(const S2PaddedCell& pcell,
       pcell.GetChildIJ(pos, &i, &j);
       if (!child_edges[i][j].empty() || !tracker->shape_ids().empty()) {
         UpdateEdges(S2PaddedCell(pcell, i, j), &child_edges[i][j],
-                    tracker, alloc, disjoint_from_index);
+                    tracker, alloc, cell_map, cell_arena,
+                    disjoint_from_index);
       }
     }
     // Free any temporary edges that were allocated during clipping.
@@ -1549,6 +2249,254 @@ MutableS2ShapeIndex::UpdateBound(const ClippedEdge* edge, int u_end, double u,
   return clipped;
 }
 
+// Builds the index directly when it is empty and all the shapes being added
+// are points (i.e., have dimension 0), which is much faster than clipping
+// each point as a degenerate edge.  Instead each point is assigned to the
+// leaf cell that contains it, the points are sorted by leaf cell, and the
+// index cells are formed by splitting the sorted points at child cell
+// boundaries.  Points that are so close to a leaf cell boundary that they
+// intersect more than one padded cell are clipped as usual.  The resulting
+// index is identical to the one built by the general algorithm.
+//
+// Returns false without modifying the index if this method does not apply.
+bool MutableS2ShapeIndex::BuildPointIndex() {
+  if (!cell_map_.empty() || pending_removals_) return false;
+  vector<int> shape_ids;
+  vector<int64_t> offsets = {0};  // Offset of each shape's first point.
+  for (size_t id = pending_additions_begin_; id < shapes_.size(); ++id) {
+    const S2Shape* shape = this->shape(id);
+    if (shape == nullptr) continue;
+    if (shape->dimension() != 0) return false;
+    shape_ids.push_back(id);
+    offsets.push_back(offsets.back() + shape->num_edges());
+  }
+  const int64_t num_points = offsets.back();
+  if (num_points == 0 ||
+      num_points * sizeof(PointEntry) >
+          static_cast<size_t>(
+              absl::GetFlag(FLAGS_s2shape_index_tmp_memory_budget))) {
+    return false;
+  }
+  if (!mem_tracker_.TallyTemp(num_points * sizeof(PointEntry))) {
+    Minimize();
+    return true;
+  }
+
+  // Convert the points in chunks.  Points that cannot be assigned to a
+  // single leaf cell are marked with S2CellId::Sentinel() (so that they sort
+  // last) and are added to "boundary_edges" instead.
+  constexpr int64_t kChunkSize = 1 << 16;
+  const int num_chunks = (num_points + kChunkSize - 1) / kChunkSize;
+  vector<PointEntry> points(num_points);
+  vector<std::array<vector<FaceEdge>, 6>> chunk_edges(num_chunks);
+  vector<std::array<R2Rect, 6>> chunk_bounds(num_chunks);
+  const int max_level = GetEdgeMaxLevel(S2Shape::Edge(S2Point(), S2Point()));
+  s2internal::ParallelFor(options_.num_threads(), num_chunks, [&](int chunk) {
+    std::array<R2Rect, 6>& bounds = chunk_bounds[chunk];
+    bounds.fill(R2Rect::Empty());
+    const int64_t begin = chunk * kChunkSize;
+    const int64_t end = min(begin + kChunkSize, num_points);
+    int i = std::upper_bound(offsets.begin(), offsets.end(), begin) -
+            offsets.begin() - 1;
+    for (int64_t p = begin; p < end; ++p) {
+      while (p >= offsets[i + 1]) ++i;
+      PointEntry& entry = points[p];
+      entry.shape_id = shape_ids[i];
+      entry.edge_id = p - offsets[i];
+      const S2Point& point = shape(entry.shape_id)->edge(entry.edge_id).v0;
+      int face = S2::GetFace(point);
+      R2Point uv;
+      S2::ValidFaceXYZtoUV(face, point, &uv);
+      const double kMaxUV = 1 - kCellPadding;
+      if (fabs(uv[0]) <= kMaxUV && fabs(uv[1]) <= kMaxUV) {
+        int ij[2] = {S2::STtoIJ(S2::UVtoST(uv[0])),
+                     S2::STtoIJ(S2::UVtoST(uv[1]))};
+        R2Rect leaf = S2CellId::IJLevelToBoundUV(ij, S2CellId::kMaxLevel);
+        // The margin ensures that the point does not intersect the padded
+        // bound of any cell other than those containing its leaf cell.
+        if (leaf.Expanded(-2 * kCellPadding).Contains(uv)) {
+          entry.id = S2CellId::FromFaceIJ(face, ij[0], ij[1]);
+          bounds[face].AddPoint(uv);
+          continue;
+        }
+      }
+      entry.id = S2CellId::Sentinel();
+      FaceEdge edge;
+      edge.shape_id = entry.shape_id;
+      edge.edge_id = entry.edge_id;
+      edge.max_level = max_level;
+      edge.has_interior = false;
+      edge.edge = S2Shape::Edge(point, point);
+      AddFaceEdge(&edge, chunk_edges[chunk].data());
+    }
+  });
+  s2internal::ParallelSort(options_.num_threads(), points.begin(),
+                           points.end(),
+                           [](const PointEntry& a, const PointEntry& b) {
+                             return a.id < b.id;
+                           });
+  vector<FaceEdge> boundary_edges[6];
+  R2Rect bounds[6];
+  for (int face = 0; face < 6; ++face) {
+    bounds[face] = R2Rect::Empty();
+    for (int chunk = 0; chunk < num_chunks; ++chunk) {
+      const vector<FaceEdge>& edges = chunk_edges[chunk][face];
+      boundary_edges[face].insert(boundary_edges[face].end(), edges.begin(),
+                                  edges.end());
+      bounds[face].AddRect(chunk_bounds[chunk][face]);
+    }
+  }
+  vector<std::array<vector<FaceEdge>, 6>>().swap(chunk_edges);
+
+  // Index the faces independently and then merge the results, exactly as
+  // UpdateFacesParallel() does.
+  CellMap face_cell_maps[6];
+  unique_ptr<CellArena> face_cell_arenas[6];
+  for (auto& arena : face_cell_arenas) {
+    arena = make_unique<CellArena>(options_.memory_resource());
+  }
+  s2internal::ParallelFor(options_.num_threads(), 6, [&](int face) {
+    S2CellId face_id = S2CellId::FromFace(face);
+    auto begin = std::lower_bound(
+        points.begin(), points.end(), face_id.range_min(),
+        [](const PointEntry& a, S2CellId id) { return a.id < id; });
+    auto end = std::upper_bound(
+        begin, points.end(), face_id.range_max(),
+        [](S2CellId id, const PointEntry& a) { return id < a.id; });
+    const vector<FaceEdge>& face_edges = boundary_edges[face];
+    if (begin == end && face_edges.empty()) return;
+
+    vector<ClippedEdge> clipped_edge_storage;
+    vector<const ClippedEdge*> clipped_edges;
+    clipped_edge_storage.reserve(face_edges.size());
+    clipped_edges.reserve(face_edges.size());
+    R2Rect bound = bounds[face];
+    for (const FaceEdge& face_edge : face_edges) {
+      ClippedEdge clipped;
+      clipped.face_edge = &face_edge;
+      clipped.bound = R2Rect::FromPointPair(face_edge.a, face_edge.b);
+      clipped_edge_storage.push_back(clipped);
+      clipped_edges.push_back(&clipped_edge_storage.back());
+      bound.AddRect(clipped.bound);
+    }
+    // As in UpdateFaceEdges(), start with the smallest cell that contains
+    // all the points.
+    S2PaddedCell pcell(face_id, kCellPadding);
+    S2CellId shrunk_id = pcell.ShrinkToFit(bound);
+    if (shrunk_id != face_id) pcell = S2PaddedCell(shrunk_id, kCellPadding);
+    EdgeAllocator alloc;
+    UpdatePoints(pcell, absl::MakeConstSpan(&*begin, end - begin),
+                 &clipped_edges, &alloc, &face_cell_maps[face],
+                 face_cell_arenas[face].get());
+  });
+  for (int face = 0; face < 6; ++face) {
+    for (const auto& [id, cell] : face_cell_maps[face]) {
+      cell_map_.insert(cell_map_.end(), make_pair(id, cell));
+    }
+    cell_arena()->Splice(face_cell_arenas[face].get());
+  }
+  pending_additions_begin_ = shapes_.size();
+  return true;
+}
+
+// Like UpdateEdges(), but for an index that consists only of points.
+// "points" contains the points whose leaf cells are contained by "pcell"
+// (sorted by leaf cell), while "edges" contains the points near leaf cell
+// boundaries that intersect the padded cell.
+void MutableS2ShapeIndex::UpdatePoints(const S2PaddedCell& pcell,
+                                       absl::Span<const PointEntry> points,
+                                       vector<const ClippedEdge*>* edges,
+                                       EdgeAllocator* alloc,
+                                       CellMap* cell_map,
+                                       CellArena* cell_arena) {
+  // This mirrors the subdivision criterion in MakeIndexCell().  Points have
+  // no length, so they are "short" at every level below their max_level.
+  const int num_points = points.size() + edges->size();
+  if (num_points <= options_.max_edges_per_cell() ||
+      pcell.level() >= GetEdgeMaxLevel(S2Shape::Edge(S2Point(), S2Point())) ||
+      num_points <=
+          static_cast<int>(
+              absl::GetFlag(FLAGS_s2shape_index_min_short_edge_fraction) *
+              num_points)) {
+    return MakePointCell(pcell.id(), points, *edges, cell_map, cell_arena);
+  }
+  vector<const ClippedEdge*> child_edges[2][2];
+  size_t alloc_size = alloc->size();
+  const R2Rect& middle = pcell.middle();
+  for (const ClippedEdge* edge : *edges) {
+    ClipToChildren(edge, middle, child_edges, alloc);
+  }
+  auto begin = points.begin();
+  for (int pos = 0; pos < 4; ++pos) {
+    int i, j;
+    pcell.GetChildIJ(pos, &i, &j);
+    S2PaddedCell child(pcell, i, j);
+    const S2CellId range_max = child.id().range_max();
+    auto end = std::partition_point(
+        begin, points.end(),
+        [range_max](const PointEntry& p) { return p.id <= range_max; });
+    if (begin != end || !child_edges[i][j].empty()) {
+      UpdatePoints(child, absl::Span<const PointEntry>(&*begin, end - begin),
+                   &child_edges[i][j], alloc, cell_map, cell_arena);
+    }
+    begin = end;
+  }
+  alloc->Reset(alloc_size);
+}
+
+// Creates an index cell containing the given points, which are represented
+// as degenerate edges exactly as MakeIndexCell() would do.
+void MutableS2ShapeIndex::MakePointCell(
+    S2CellId id, absl::Span<const PointEntry> points,
+    const vector<const ClippedEdge*>& edges, CellMap* cell_map,
+    CellArena* cell_arena) const {
+  vector<std::pair<int32_t, int32_t>> edge_ids;  // (shape_id, edge_id)
+  edge_ids.reserve(points.size() + edges.size());
+  for (const PointEntry& point : points) {
+    edge_ids.push_back({point.shape_id, point.edge_id});
+  }
+  for (const ClippedEdge* edge : edges) {
+    edge_ids.push_back({edge->face_edge->shape_id, edge->face_edge->edge_id});
+  }
+  std::sort(edge_ids.begin(), edge_ids.end());
+
+  int num_shapes = 0;
+  size_t num_packed_edges = 0;
+  for (size_t begin = 0, end; begin < edge_ids.size(); begin = end) {
+    for (end = begin + 1; end < edge_ids.size() &&
+                          edge_ids[end].first == edge_ids[begin].first;
+         ++end) {
+    }
+    ++num_shapes;
+    if (end - begin > S2ClippedShape::kMaxInlineEdges) {
+      num_packed_edges += end - begin;
+    }
+  }
+  S2ShapeIndexCell* cell = cell_arena->New();
+  S2ClippedShape* clipped = cell->add_shapes(num_shapes);
+  int32_t* packed_edges = nullptr;
+  if (options_.packed_cells() && num_packed_edges > 0) {
+    cell->packed_edges_ = make_unique<int32_t[]>(num_packed_edges);
+    packed_edges = cell->packed_edges_.get();
+  }
+  for (size_t begin = 0, end; begin < edge_ids.size();
+       begin = end, ++clipped) {
+    const int shape_id = edge_ids[begin].first;
+    for (end = begin + 1;
+         end < edge_ids.size() && edge_ids[end].first == shape_id; ++end) {
+    }
+    if (packed_edges != nullptr) {
+      clipped->InitPacked(shape_id, end - begin, &packed_edges);
+    } else {
+      clipped->Init(shape_id, end - begin);
+    }
+    for (size_t e = begin; e < end; ++e) {
+      clipped->set_edge(e - begin, edge_ids[e].second);
+    }
+  }
+  cell_map->insert(cell_map->end(), make_pair(id, cell));
+}
+
 // Absorb an index cell by transferring its contents to "edges" and/or
 // "tracker", and then delete this cell from the index.  If "edges" includes
 // any edges that are being removed, this method also updates their
@@ -1649,12 +2597,21 @@ void MutableS2ShapeIndex::AbsorbIndexCell(const S2PaddedCell& pcell,
     }
   }
   // Now create a ClippedEdge for each FaceEdge, and put them in "new_edges".
+  // The edge bounds are computed in a batch since most edges are contained
+  // by the padded cell and do not need to be clipped.
+  const int num_face_edges = face_edges->size();
+  absl::FixedArray<R2Point, 64> a(num_face_edges), b(num_face_edges);
+  absl::FixedArray<R2Rect, 64> bounds(num_face_edges);
+  for (int i = 0; i < num_face_edges; ++i) {
+    a[i] = (*face_edges)[i].a;
+    b[i] = (*face_edges)[i].b;
+  }
+  S2::GetClippedEdgeBounds(a, b, pcell.bound(), absl::MakeSpan(bounds));
   vector<const ClippedEdge*> new_edges;
-  for (const FaceEdge& face_edge : *face_edges) {
+  for (int i = 0; i < num_face_edges; ++i) {
     ClippedEdge* clipped = alloc->NewClippedEdge();
-    clipped->face_edge = &face_edge;
-    clipped->bound = S2::GetClippedEdgeBound(face_edge.a, face_edge.b,
-                                                     pcell.bound());
+    clipped->face_edge = &(*face_edges)[i];
+    clipped->bound = bounds[i];
     new_edges.push_back(clipped);
   }
   // Discard any edges from "edges" that are being removed, and append the
@@ -1668,14 +2625,18 @@ void MutableS2ShapeIndex::AbsorbIndexCell(const S2PaddedCell& pcell,
   }
   // Update the edge list and delete this cell from the index.
   edges->swap(new_edges);
-  cell_map_.erase(pcell.id());
+  auto cell_it = cell_map_.find(pcell.id());
+  cell_arena_->Delete(cell_it->second);
+  cell_map_.erase(cell_it);
 }
 
 // Attempt to build an index cell containing the given edges, and return true
 // if successful.  (Otherwise the edges should be subdivided further.)
 bool MutableS2ShapeIndex::MakeIndexCell(const S2PaddedCell& pcell,
                                         const vector<const ClippedEdge*>& edges,
-                                        InteriorTracker* tracker) {
+                                        InteriorTracker* tracker,
+                                        CellMap* cell_map,
+                                        CellArena* cell_arena) {
   if (edges.empty() && tracker->shape_ids().empty()) {
     // No index cell is needed.  (In most cases this situation is detected
     // before we get to this point, but this can happen when all shapes in a
@@ -1834,9 +2795,30 @@ bool MutableS2ShapeIndex::MakeIndexCell(const S2PaddedCell& pcell,
   // with the shapes that happen to contain the cell center.
   const ShapeIdSet& cshape_ids = tracker->shape_ids();
   int num_shapes = CountShapes(edges, cshape_ids);
-  auto cell = make_unique<S2ShapeIndexCell>();
+  S2ShapeIndexCell* cell = cell_arena->New();
   S2ClippedShape* base = cell->add_shapes(num_shapes);
 
+  // If requested, store the edge ids of all shapes that don't fit inline in a
+  // single array owned by the cell rather than one array per shape.
+  int32_t* packed_edges = nullptr;
+  if (options_.packed_cells()) {
+    size_t num_packed_edges = 0;
+    for (size_t ebegin = 0, eend; ebegin < edges.size(); ebegin = eend) {
+      int shape_id = edges[ebegin]->face_edge->shape_id;
+      for (eend = ebegin + 1; eend < edges.size() &&
+                              edges[eend]->face_edge->shape_id == shape_id;
+           ++eend) {
+      }
+      if (eend - ebegin > S2ClippedShape::kMaxInlineEdges) {
+        num_packed_edges += eend - ebegin;
+      }
+    }
+    if (num_packed_edges > 0) {
+      cell->packed_edges_ = make_unique<int32_t[]>(num_packed_edges);
+      packed_edges = cell->packed_edges_.get();
+    }
+  }
+
   // To fill the index cell we merge the two sources of shapes: "edge shapes"
   // (those that have at least one edge that intersects this cell), and
   // "containing shapes" (those that contain the cell center).  We keep track
@@ -1865,7 +2847,11 @@ bool MutableS2ShapeIndex::MakeIndexCell(const S2PaddedCell& pcell,
              edges[enext]->face_edge->shape_id == eshape_id) {
         ++enext;
       }
-      clipped->Init(eshape_id, enext - ebegin);
+      if (packed_edges != nullptr) {
+        clipped->InitPacked(eshape_id, enext - ebegin, &packed_edges);
+      } else {
+        clipped->Init(eshape_id, enext - ebegin);
+      }
       for (size_t e = ebegin; e < enext; ++e) {
         clipped->set_edge(e - ebegin, edges[e]->face_edge->edge_id);
       }
@@ -1880,7 +2866,7 @@ bool MutableS2ShapeIndex::MakeIndexCell(const S2PaddedCell& pcell,
   // is much faster to give an insertion hint in this case.  Otherwise the
   // hint doesn't do much harm.  With more effort we could provide a hint even
   // during incremental updates, but this is probably not worth the effort.
-  cell_map_.insert(cell_map_.end(), make_pair(pcell.id(), std::move(cell)));
+  cell_map->insert(cell_map->end(), make_pair(pcell.id(), cell));
 
   // Shift the InteriorTracker focus point to the exit vertex of this cell.
   if (tracker->is_active() && !edges.empty()) {
@@ -1929,62 +2915,355 @@ int MutableS2ShapeIndex::CountShapes(const vector<const ClippedEdge*>& edges,
 }
 
 size_t MutableS2ShapeIndex::SpaceUsed() const {
-  size_t size = sizeof(*this);
-  size += shapes_.capacity() * sizeof(unique_ptr<S2Shape>);
+  S2SpaceUsage usage;
+  GetSpaceUsage(&usage);
+  return usage.total_bytes();
+}
+
+void MutableS2ShapeIndex::GetSpaceUsage(S2SpaceUsage* usage) const {
+  usage->Add("object", sizeof(*this));
+  usage->Add("shapes", shapes_.capacity() * sizeof(unique_ptr<S2Shape>));
   // cell_map_ itself is already included in sizeof(*this).
-  size += cell_map_.bytes_used() - sizeof(cell_map_);
-  size += cell_map_.size() * sizeof(S2ShapeIndexCell);
+  usage->Add("cells", cell_map_.bytes_used() - sizeof(cell_map_) +
+                          (cell_arena_ ? cell_arena_->SpaceUsed() : 0));
+  if (frozen_ != nullptr) {
+    usage->Add("frozen_cells",
+               sizeof(*frozen_) +
+                   frozen_->ids.capacity() * sizeof(S2CellId) +
+                   frozen_->cells.capacity() * sizeof(S2ShapeIndexCell*) +
+                   frozen_->block_ids.capacity() * sizeof(S2CellId));
+  }
+  size_t clipped_shapes = 0, clipped_edges = 0;
   Iterator it;
   for (it.InitStale(this, S2ShapeIndex::BEGIN); !it.done(); it.Next()) {
     const S2ShapeIndexCell& cell = it.cell();
-    size += cell.shapes_.capacity() * sizeof(S2ClippedShape);
+    clipped_shapes += cell.shapes_.capacity() * sizeof(S2ClippedShape);
     for (int s = 0; s < cell.num_clipped(); ++s) {
       const S2ClippedShape& clipped = cell.clipped(s);
       if (!clipped.is_inline()) {
-        size += clipped.num_edges() * sizeof(int32_t);
+        clipped_edges += clipped.num_edges() * sizeof(int32_t);
       }
     }
   }
+  usage->Add("clipped_shapes", clipped_shapes);
+  usage->Add("clipped_edges", clipped_edges);
+  size_t pending_removals = 0;
   if (pending_removals_ != nullptr) {
-    size += sizeof(*pending_removals_);
-    size += pending_removals_->capacity() * sizeof(RemovedShape);
+    pending_removals += sizeof(*pending_removals_);
+    pending_removals += pending_removals_->capacity() * sizeof(RemovedShape);
     for (const RemovedShape& removed : *pending_removals_) {
-      size += removed.edges.capacity() * sizeof(S2Shape::Edge);
+      pending_removals += removed.edges.capacity() * sizeof(S2Shape::Edge);
     }
   }
-  return size;
+  usage->Add("pending_removals", pending_removals);
+  usage->Add("shape_metadata",
+             shape_metadata_.capacity() * sizeof(S2ShapeMetadata));
 }
 
 void MutableS2ShapeIndex::Encode(Encoder* encoder) const {
+  Encode(encoder, 1);
+}
+
+void MutableS2ShapeIndex::Encode(Encoder* encoder, int num_threads) const {
   // The version number is encoded in 2 bits, under the assumption that by the
   // time we need 5 versions the first version can be permanently retired.
   // This only saves 1 byte, but that's significant for very small indexes.
   encoder->Ensure(Varint::kMax64);
   uint64_t max_edges = options_.max_edges_per_cell();
-  encoder->put_varint64(max_edges << 2 | kCurrentEncodingVersionNumber);
+  encoder->put_varint64(max_edges << 2 | encoding_version());
 
   // The index will be built anyway when we iterate through it, but building
   // it in advance lets us size the cell_ids vector correctly.
   ForceBuild();
   vector<S2CellId> cell_ids;
-  cell_ids.reserve(cell_map_.size());
-  s2coding::StringVectorEncoder encoded_cells;
+  vector<const S2ShapeIndexCell*> cells;
+  size_t num_cells = frozen_ ? frozen_->size() : cell_map_.size();
+  cell_ids.reserve(num_cells);
+  cells.reserve(num_cells);
   for (Iterator it(this, S2ShapeIndex::BEGIN); !it.done(); it.Next()) {
     cell_ids.push_back(it.id());
-    it.cell().Encode(num_shape_ids(), encoded_cells.AddViaEncoder());
+    cells.push_back(&it.cell());
+  }
+  s2coding::EncodeS2CellIdVector(cell_ids, encoder);
+  s2coding::StringVectorEncoder::EncodeParallel(
+      cells.size(),
+      [&](size_t i, Encoder* cell_encoder) {
+        cells[i]->Encode(num_shape_ids(), cell_encoder);
+        return true;
+      },
+      num_threads, encoder);
+  if (encoding_version() == kShapeMetadataEncodingVersionNumber) {
+    s2coding::StringVectorEncoder::EncodeParallel(
+        num_shape_ids(),
+        [&](size_t i, Encoder* metadata_encoder) {
+          return EncodeShapeMetadata(i, metadata_encoder);
+        },
+        num_threads, encoder);
+  }
+}
+
+bool MutableS2ShapeIndex::Encode(s2coding::EncodedDataSink sink) const {
+  // This must produce the same output as Encode(Encoder*, int) above.
+  Encoder encoder;
+  encoder.Ensure(Varint::kMax64);
+  uint64_t max_edges = options_.max_edges_per_cell();
+  encoder.put_varint64(max_edges << 2 | encoding_version());
+
+  ForceBuild();
+  vector<S2CellId> cell_ids;
+  vector<const S2ShapeIndexCell*> cells;
+  size_t num_cells = frozen_ ? frozen_->size() : cell_map_.size();
+  cell_ids.reserve(num_cells);
+  cells.reserve(num_cells);
+  for (Iterator it(this, S2ShapeIndex::BEGIN); !it.done(); it.Next()) {
+    cell_ids.push_back(it.id());
+    cells.push_back(&it.cell());
+  }
+  s2coding::EncodeS2CellIdVector(cell_ids, &encoder);
+  if (!sink(absl::string_view(encoder.base(), encoder.length()))) {
+    return false;
+  }
+  if (!s2coding::StringVectorEncoder::EncodeStreaming(
+          cells.size(),
+          [&](size_t i, Encoder* cell_encoder) {
+            cells[i]->Encode(num_shape_ids(), cell_encoder);
+            return true;
+          },
+          sink)) {
+    return false;
+  }
+  if (encoding_version() != kShapeMetadataEncodingVersionNumber) return true;
+  return s2coding::StringVectorEncoder::EncodeStreaming(
+      num_shape_ids(),
+      [&](size_t i, Encoder* metadata_encoder) {
+        return EncodeShapeMetadata(i, metadata_encoder);
+      },
+      sink);
+}
+
+vector<int> MutableS2ShapeIndex::EncodeRegion(const S2CellUnion& region,
+                                              Encoder* encoder) const {
+  encoder->Ensure(Varint::kMax64);
+  uint64_t max_edges = options_.max_edges_per_cell();
+  encoder->put_varint64(max_edges << 2 | encoding_version());
+
+  // Find the index cells that intersect "region".  Normalizing the region
+  // ensures that its cells are disjoint and sorted, so that the index cells
+  // are found in increasing order.  (An index cell that contains several
+  // region cells is found more than once but included only once.)
+  ForceBuild();
+  S2CellUnion normalized = region;
+  normalized.Normalize();
+  vector<S2CellId> cell_ids;
+  vector<const S2ShapeIndexCell*> cells;
+  Iterator it(this);
+  for (S2CellId id : normalized) {
+    if (it.Locate(id) == S2CellRelation::DISJOINT) continue;
+    for (; !it.done() && it.id().range_min() <= id.range_max(); it.Next()) {
+      if (!cell_ids.empty() && it.id() <= cell_ids.back()) continue;
+      cell_ids.push_back(it.id());
+      cells.push_back(&it.cell());
+    }
+  }
+  vector<bool> referenced(num_shape_ids());
+  for (const S2ShapeIndexCell* cell : cells) {
+    for (const S2ClippedShape& clipped : cell->clipped_shapes()) {
+      referenced[clipped.shape_id()] = true;
+    }
+  }
+  s2coding::EncodeS2CellIdVector(cell_ids, encoder);
+  s2coding::StringVectorEncoder::EncodeParallel(
+      cells.size(),
+      [&](size_t i, Encoder* cell_encoder) {
+        cells[i]->Encode(num_shape_ids(), cell_encoder);
+        return true;
+      },
+      1 /*num_threads*/, encoder);
+  if (encoding_version() == kShapeMetadataEncodingVersionNumber) {
+    s2coding::StringVectorEncoder::EncodeParallel(
+        num_shape_ids(),
+        [&](size_t i, Encoder* metadata_encoder) {
+          return !referenced[i] || EncodeShapeMetadata(i, metadata_encoder);
+        },
+        1 /*num_threads*/, encoder);
+  }
+  vector<int> shape_ids;
+  for (int id = 0; id < num_shape_ids(); ++id) {
+    if (referenced[id]) shape_ids.push_back(id);
+  }
+  return shape_ids;
+}
+
+namespace {
+
+// Returns true if "shape" contains the point "p", given the clipped shape of
+// the index cell "cell_id" that contains "p".  This is equivalent to
+// S2ContainsPointQuery::ShapeContains() with the SEMI_OPEN vertex model,
+// which is the model used to compute S2ClippedShape::contains_center().
+bool ClippedShapeContains(const S2Shape& shape, S2CellId cell_id,
+                          const S2ClippedShape& clipped, const S2Point& p) {
+  if (shape.dimension() < 2) return false;
+  bool inside = clipped.contains_center();
+  S2CopyingEdgeCrosser crosser(cell_id.ToPoint(), p);
+  for (int i = 0; i < clipped.num_edges(); ++i) {
+    S2Shape::Edge edge = shape.edge(clipped.edge(i));
+    inside ^= crosser.EdgeOrVertexCrossing(edge.v0, edge.v1);
+  }
+  return inside;
+}
+
+}  // namespace
+
+void MutableS2ShapeIndex::EncodeMerged(
+    absl::Span<const S2ShapeIndex* const> indexes, const Options& options,
+    Encoder* encoder) {
+  encoder->Ensure(Varint::kMax64);
+  uint64_t max_edges = options.max_edges_per_cell();
+  encoder->put_varint64(max_edges << 2 | kCurrentEncodingVersionNumber);
+
+  vector<S2ShapeIndex::Iterator> iters;
+  vector<int> id_offsets;
+  int num_shape_ids = 0;
+  for (const S2ShapeIndex* index : indexes) {
+    iters.emplace_back(index, S2ShapeIndex::BEGIN);
+    id_offsets.push_back(num_shape_ids);
+    num_shape_ids += index->num_shape_ids();
+  }
+
+  // A clipped shape of the merged cell, whose "edges" may contain
+  // duplicates until it is complete.
+  struct MergedShape {
+    int shape_id;
+    bool contains_center;
+    vector<int> edges;
+  };
+  vector<S2CellId> cell_ids;
+  s2coding::StringVectorEncoder encoded_cells;
+  vector<MergedShape> merged;
+  vector<std::pair<S2CellId, const S2ShapeIndexCell*>> contained;
+  for (;;) {
+    // The next merged cell is the input cell with the smallest range_min(),
+    // choosing the largest such cell in case of ties.  No other input cell
+    // can contain it, so every input cell that it intersects is either equal
+    // to it or one of its descendants.
+    S2CellId id = S2CellId::None();
+    for (const auto& it : iters) {
+      if (it.done()) continue;
+      if (id == S2CellId::None() || it.id().range_min() < id.range_min() ||
+          (it.id().range_min() == id.range_min() &&
+           it.id().range_max() > id.range_max())) {
+        id = it.id();
+      }
+    }
+    if (id == S2CellId::None()) break;
+
+    merged.clear();
+    const S2Point center = id.ToPoint();
+    const S2CellId center_id(center);
+    for (size_t k = 0; k < iters.size(); ++k) {
+      contained.clear();
+      for (auto& it = iters[k]; !it.done() && it.id() <= id.range_max();
+           it.Next()) {
+        contained.emplace_back(it.id(), &it.cell());
+      }
+      if (contained.empty()) continue;
+      const int offset = id_offsets[k];
+      if (contained.size() == 1 && contained[0].first == id) {
+        // The cell is unchanged apart from the shape ids.
+        for (const S2ClippedShape& clipped :
+             contained[0].second->clipped_shapes()) {
+          MergedShape& shape = merged.emplace_back();
+          shape.shape_id = offset + clipped.shape_id();
+          shape.contains_center = clipped.contains_center();
+          for (int i = 0; i < clipped.num_edges(); ++i) {
+            shape.edges.push_back(clipped.edge(i));
+          }
+        }
+        continue;
+      }
+      // Otherwise the cell is subdivided in this index.  Each shape's edges
+      // are the union of its edges in the descendant cells, and it contains
+      // the center of the merged cell if it contains that point within the
+      // descendant cell that the point belongs to (if any).
+      const size_t begin = merged.size();
+      for (const auto& [cell_id, cell] : contained) {
+        for (const S2ClippedShape& clipped : cell->clipped_shapes()) {
+          auto it = std::find_if(
+              merged.begin() + begin, merged.end(),
+              [&](const MergedShape& shape) {
+                return shape.shape_id == offset + clipped.shape_id();
+              });
+          if (it == merged.end()) {
+            it = merged.insert(
+                merged.end(), {offset + clipped.shape_id(), false, {}});
+          }
+          for (int i = 0; i < clipped.num_edges(); ++i) {
+            it->edges.push_back(clipped.edge(i));
+          }
+          if (cell_id.contains(center_id)) {
+            it->contains_center = ClippedShapeContains(
+                *indexes[k]->shape(clipped.shape_id()), cell_id, clipped,
+                center);
+          }
+        }
+      }
+      std::sort(merged.begin() + begin, merged.end(),
+                [](const MergedShape& a, const MergedShape& b) {
+                  return a.shape_id < b.shape_id;
+                });
+      for (auto it = merged.begin() + begin; it != merged.end(); ++it) {
+        std::sort(it->edges.begin(), it->edges.end());
+        it->edges.erase(std::unique(it->edges.begin(), it->edges.end()),
+                        it->edges.end());
+      }
+    }
+
+    S2ShapeIndexCell cell;
+    S2ClippedShape* clipped = cell.add_shapes(merged.size());
+    for (const MergedShape& shape : merged) {
+      clipped->Init(shape.shape_id, shape.edges.size());
+      clipped->set_contains_center(shape.contains_center);
+      for (size_t i = 0; i < shape.edges.size(); ++i) {
+        clipped->set_edge(i, shape.edges[i]);
+      }
+      ++clipped;
+    }
+    cell_ids.push_back(id);
+    cell.Encode(num_shape_ids, encoded_cells.AddViaEncoder());
   }
   s2coding::EncodeS2CellIdVector(cell_ids, encoder);
   encoded_cells.Encode(encoder);
 }
 
+unsigned char MutableS2ShapeIndex::encoding_version() const {
+  return options_.cache_shape_metadata() ? kShapeMetadataEncodingVersionNumber
+                                         : kCurrentEncodingVersionNumber;
+}
+
+// Encodes the metadata of the given shape as one element of an
+// EncodedStringVector.  Shapes that have been removed are encoded as empty
+// strings.  REQUIRES: the index has been built.
+bool MutableS2ShapeIndex::EncodeShapeMetadata(size_t shape_id,
+                                              Encoder* encoder) const {
+  if (shapes_[shape_id] != nullptr && shape_id < shape_metadata_.size()) {
+    shape_metadata_[shape_id].Encode(encoder);
+  }
+  return true;
+}
+
 bool MutableS2ShapeIndex::Init(Decoder* decoder,
                                const ShapeFactory& shape_factory) {
   Clear();
   uint64_t max_edges_version;
   if (!decoder->get_varint64(&max_edges_version)) return false;
   int version = max_edges_version & 3;
-  if (version != kCurrentEncodingVersionNumber) return false;
+  if (version != kCurrentEncodingVersionNumber &&
+      version != kShapeMetadataEncodingVersionNumber) {
+    return false;
+  }
   options_.set_max_edges_per_cell(max_edges_version >> 2);
+  options_.set_cache_shape_metadata(version ==
+                                    kShapeMetadataEncodingVersionNumber);
   uint32_t num_shapes = shape_factory.size();
   shapes_.reserve(num_shapes);
   for (size_t shape_id = 0; shape_id < num_shapes; ++shape_id) {
@@ -1999,12 +3278,26 @@ bool MutableS2ShapeIndex::Init(Decoder* decoder,
 
   for (size_t i = 0; i < cell_ids.size(); ++i) {
     S2CellId id = cell_ids[i];
-    auto cell = make_unique<S2ShapeIndexCell>();
+    S2ShapeIndexCell* cell = cell_arena()->New();
     Decoder decoder = encoded_cells.GetDecoder(i);
     if (!cell->Decode(num_shapes, &decoder)) {
+      cell_arena_->Delete(cell);
       return false;
     }
-    cell_map_.insert(cell_map_.end(), make_pair(id, std::move(cell)));
+    cell_map_.insert(cell_map_.end(), make_pair(id, cell));
+  }
+  if (version == kShapeMetadataEncodingVersionNumber) {
+    s2coding::EncodedStringVector encoded_metadata;
+    if (!encoded_metadata.Init(decoder)) return false;
+    if (encoded_metadata.size() != num_shapes) return false;
+    shape_metadata_.resize(num_shapes);
+    for (size_t i = 0; i < num_shapes; ++i) {
+      Decoder decoder = encoded_metadata.GetDecoder(i);
+      if (decoder.avail() == 0) continue;  // The shape was removed.
+      if (!shape_metadata_[i].Decode(&decoder)) return false;
+    }
   }
+  // The decoded cells already include all the shapes.
+  pending_additions_begin_ = num_shapes;
   return true;
 }
@@ -18,11 +18,15 @@
 #ifndef S2_MUTABLE_S2SHAPE_INDEX_H_
 #define S2_MUTABLE_S2SHAPE_INDEX_H_
 
+#include <algorithm>
 #include <array>
 #include <atomic>
 #include <cstddef>
 #include <cstdint>
+#include <functional>
+#include <future>
 #include <memory>
+#include <memory_resource>
 #include <utility>
 #include <vector>
 
@@ -37,6 +41,7 @@
 #include "s2/base/commandlineflags.h"
 #include "s2/base/commandlineflags_declare.h"
 #include "s2/base/spinlock.h"
+#include "s2/encoded_string_vector.h"
 #include "s2/r1interval.h"
 #include "s2/r2rect.h"
 #include "s2/s2cell_id.h"
@@ -45,9 +50,12 @@
 #include "s2/s2pointutil.h"
 #include "s2/s2shape.h"
 #include "s2/s2shape_index.h"
+#include "s2/s2shape_metadata.h"
 #include "s2/s2shapeutil_shape_edge_id.h"
+#include "s2/s2space_usage.h"
 #include "s2/util/coding/coder.h"
 
+class S2CellUnion;
 class S2PaddedCell;
 
 namespace s2internal {
@@ -137,8 +145,32 @@ class BTreeMap : public absl::btree_map<Key, Value> {
 // in the S2ShapeIndexCell that contains that point.
 class MutableS2ShapeIndex final : public S2ShapeIndex {
  private:
-  using CellMap =
-      s2internal::BTreeMap<S2CellId, std::unique_ptr<S2ShapeIndexCell>>;
+  // The cells are owned by the index's CellArena (see below).
+  using CellMap = s2internal::BTreeMap<S2CellId, S2ShapeIndexCell*>;
+
+  // The representation of the index cells after Freeze() has been called.
+  struct FrozenCells {
+    // Returns the position of the first cell whose id is >= "target", or
+    // size() if there is no such cell.
+    size_t LowerBound(S2CellId target) const;
+
+    size_t size() const { return cells.size(); }
+
+    // The number of consecutive ids summarized by each entry of "block_ids"
+    // (one 64-byte cache line).
+    static constexpr size_t kBlockSize = 8;
+
+    // The cell ids in sorted order, followed by S2CellId::Sentinel().
+    std::vector<S2CellId> ids;
+
+    // The cell corresponding to each id.
+    std::vector<S2ShapeIndexCell*> cells;
+
+    // Every kBlockSize-th element of "ids".  This array is much smaller than
+    // "ids", so a binary search over it touches few cache lines, after which
+    // only a single block of "ids" needs to be searched.
+    std::vector<S2CellId> block_ids;
+  };
 
  public:
   // The amount by which cells are "padded" to compensate for numerical errors
@@ -170,8 +202,101 @@ class MutableS2ShapeIndex final : public S2ShapeIndex {
     int max_edges_per_cell() const { return max_edges_per_cell_; }
     void set_max_edges_per_cell(int max_edges_per_cell);
 
+    // The maximum number of threads (including the calling thread) that may
+    // be used to apply pending updates.  When this value is greater than one,
+    // the edges of each update batch are clipped to the cube faces in
+    // parallel, and when the index is being built from scratch the six cube
+    // faces are also indexed concurrently.  The per-face results are merged
+    // into the index in S2CellId order, so the resulting index is identical
+    // to the one built by a single thread.
+    //
+    // Note that only the first update batch of a newly built index can be
+    // indexed face by face (since later batches need to merge with existing
+    // index cells).  When building very large indexes you may therefore want
+    // to increase FLAGS_s2shape_index_tmp_memory_budget so that fewer batches
+    // are needed.
+    //
+    // DEFAULT: 1
+    int num_threads() const { return num_threads_; }
+    void set_num_threads(int num_threads);
+
+    // If true, the S2ShapeMetadata of each shape (its reference point, bound,
+    // area, and centroid) is computed when the shape is indexed and is
+    // available via GetShapeMetadata().  The metadata is also used while
+    // building the index, which saves repeated reference point computations
+    // for shapes where these are expensive (e.g., S2LaxPolygonShape).
+    //
+    // The metadata is included in the output of Encode(), so that it is also
+    // available from the decoded index (MutableS2ShapeIndex or
+    // EncodedS2ShapeIndex) without decoding the shapes.  This increases the
+    // encoded size by S2ShapeMetadata::kEncodedSize bytes per shape, and the
+    // resulting encoding can't be decoded by older binaries.
+    //
+    // DEFAULT: false
+    bool cache_shape_metadata() const { return cache_shape_metadata_; }
+    void set_cache_shape_metadata(bool cache_shape_metadata) {
+      cache_shape_metadata_ = cache_shape_metadata;
+    }
+
+    // If true, the edge ids of all the clipped shapes in each index cell that
+    // have too many edges to be stored inline are allocated as a single
+    // contiguous array owned by the cell, rather than as one array per
+    // clipped shape.  This reduces the number of heap allocations while
+    // building the index and improves the memory locality of queries that
+    // visit many shapes per cell (e.g., S2BooleanOperation and
+    // S2ClosestEdgeQuery on indexes with many overlapping shapes).
+    //
+    // This option only affects cells created by building the index; cells
+    // created by Decode() always use the regular layout.  It does not affect
+    // the index contents or its encoding.
+    //
+    // DEFAULT: false
+    bool packed_cells() const { return packed_cells_; }
+    void set_packed_cells(bool packed_cells) { packed_cells_ = packed_cells; }
+
+    // Specifies a memory resource from which the index cells are allocated
+    // (in slabs of up to a few thousand cells).  For example, allocating the
+    // cells of a large index from an S2HugePageMemoryResource reduces TLB
+    // misses when queries visit cells in random order.  The resource must
+    // outlive the index, and it must be thread-safe if num_threads() > 1.
+    //
+    // Only the S2ShapeIndexCell objects themselves are allocated from the
+    // resource; clipped shapes that do not fit inline in the cell, and the
+    // shapes, still use the default allocator.
+    //
+    // DEFAULT: nullptr (uses the default allocator)
+    std::pmr::memory_resource* memory_resource() const {
+      return memory_resource_;
+    }
+    void set_memory_resource(std::pmr::memory_resource* resource) {
+      memory_resource_ = resource;
+    }
+
+    // If true, indicates that shapes are added in approximately S2CellId
+    // order (e.g., sorted by the S2CellId of their centroids), so that
+    // shapes with nearby ids are close together on the sphere.  The index is
+    // then built in many small batches of consecutive shapes rather than all
+    // at once.  Each batch only modifies the index cells near its own shapes,
+    // so the cells behind the batch are finished and never revisited, and
+    // the temporary memory used while building is a small constant rather
+    // than proportional to the number of edges.  Building is also somewhat
+    // faster due to better memory locality.
+    //
+    // The index contents are correct regardless of the order in which shapes
+    // are added, but building unsorted input this way is slower and yields
+    // a slightly different (still valid) subdivision.
+    //
+    // DEFAULT: false
+    bool sorted_input() const { return sorted_input_; }
+    void set_sorted_input(bool sorted_input) { sorted_input_ = sorted_input; }
+
    private:
     int max_edges_per_cell_;
+    int num_threads_ = 1;
+    bool cache_shape_metadata_ = false;
+    bool packed_cells_ = false;
+    std::pmr::memory_resource* memory_resource_ = nullptr;
+    bool sorted_input_ = false;
   };
 
   // Creates a MutableS2ShapeIndex that uses the default option settings.
@@ -253,12 +378,35 @@ class MutableS2ShapeIndex final : public S2ShapeIndex {
   // has been removed from the index.
   const S2Shape* shape(int id) const override { return shapes_[id].get(); }
 
+  // Returns the cached metadata for the given shape, provided that the
+  // cache_shape_metadata() option is enabled and the shape has not been
+  // removed.  The metadata of newly added shapes is computed when the index
+  // is next built.
+  bool GetShapeMetadata(int id, S2ShapeMetadata* metadata) const override;
+
   // Minimizes memory usage by requesting that any data structures that can be
   // rebuilt should be discarded.  This method invalidates all iterators.
   //
   // Like all non-const methods, this method is not thread-safe.
   void Minimize() override;
 
+  // Applies any pending updates and then converts the index cells into a
+  // compact read-only form where they are stored in a sorted array rather
+  // than a btree.  This reduces the space used by the index and makes
+  // iterating and seeking faster, which is worthwhile for indexes that are
+  // built once and then queried many times.  (The cost is between that of a
+  // regular MutableS2ShapeIndex and an EncodedS2ShapeIndex.)  Iterators use
+  // the new form automatically.
+  //
+  // The index can still be modified after calling this method, in which
+  // case the cells are converted back to the regular form when the next
+  // update is applied.  This method invalidates all iterators.
+  void Freeze();
+
+  // Returns true if Freeze() has been called and no updates have been
+  // applied since.
+  bool is_frozen() const { return frozen_ != nullptr; }
+
   // Appends an encoded representation of the S2ShapeIndex to "encoder".
   //
   // This method does not encode the S2Shapes in the index; it is the client's
@@ -283,6 +431,55 @@ class MutableS2ShapeIndex final : public S2ShapeIndex {
   //           can be enlarged as necessary by calling Ensure(int).
   void Encode(Encoder* encoder) const override;
 
+  // Like Encode(), but encodes the index cells concurrently using up to
+  // "num_threads" threads (including the calling thread).  The output does
+  // not depend on "num_threads".
+  //
+  // REQUIRES: num_threads >= 1
+  void Encode(Encoder* encoder, int num_threads) const;
+
+  // Like Encode(), but passes the encoding to "sink" in pieces rather than
+  // building it in memory.  This is intended for indexes whose encoding is
+  // too large to hold in memory alongside the index itself.  Each index cell
+  // is encoded twice (once to compute the offsets that precede the cells),
+  // so memory usage is proportional to the number of cells rather than the
+  // encoded size.  The output is identical to Encode().  Returns false if
+  // "sink" does.  Example:
+  //
+  //   std::ofstream out(path, std::ios::binary | std::ios::app);
+  //   index.Encode([&](absl::string_view piece) {
+  //     return bool(out.write(piece.data(), piece.size()));
+  //   });
+  bool Encode(s2coding::EncodedDataSink sink) const;
+
+  // Like Encode(), but only encodes the index cells that intersect "region".
+  // Shape ids are unchanged, and the metadata of shapes that are not
+  // referenced by any of those cells is omitted.  Returns the sorted ids of
+  // the shapes that are referenced, which are the only shapes that need to
+  // be encoded alongside the result (see s2shapeutil::EncodeTaggedShards).
+  //
+  // The result is built from the existing cells without reindexing any
+  // shapes.  Decoding it yields an index that gives the same query results
+  // as this one for points and edges within "region".
+  std::vector<int> EncodeRegion(const S2CellUnion& region,
+                                Encoder* encoder) const;
+
+  // Encodes the combination of the given indexes in the format produced by
+  // Encode(), by merging their cell sequences rather than reindexing their
+  // shapes.  The shapes of each index are renumbered by adding the total
+  // number of shape ids in the preceding indexes, so the shapes must be
+  // encoded in the same order (see s2shapeutil::EncodeMergedIndexes).
+  //
+  // Wherever cells of different indexes overlap, the larger cell is kept and
+  // the edges of the smaller cells within it are merged into it.  This means
+  // that cells may have more than options.max_edges_per_cell() edges where
+  // the indexes overlap, which makes queries there slower but does not
+  // affect their results.  The merge is most efficient when the indexes
+  // overlap only near their boundaries (e.g., per-country indexes being
+  // combined into a continent).  Shape metadata is not included.
+  static void EncodeMerged(absl::Span<const S2ShapeIndex* const> indexes,
+                           const Options& options, Encoder* encoder);
+
   // Decodes an S2ShapeIndex, returning true on success.
   //
   // This method does not decode the S2Shape objects in the index; this is
@@ -327,6 +524,7 @@ class MutableS2ShapeIndex final : public S2ShapeIndex {
                    InitialPosition pos = UNPOSITIONED);
 
     S2CellId id() const override {
+      if (frozen_ != nullptr) return frozen_->ids[pos_];
       S2CellId id = S2CellId::Sentinel();
       if (!done()) {
         id = iter_->first;
@@ -336,10 +534,14 @@ class MutableS2ShapeIndex final : public S2ShapeIndex {
 
     const S2ShapeIndexCell& cell() const override {
       ABSL_DCHECK(!done());
+      if (frozen_ != nullptr) return *frozen_->cells[pos_];
       return *iter_->second;
     }
 
-    bool done() const override { return iter_ == end_; }
+    bool done() const override {
+      if (frozen_ != nullptr) return pos_ == frozen_->size();
+      return iter_ == end_;
+    }
 
     // S2CellIterator API:
     void Begin() override;
@@ -363,6 +565,11 @@ class MutableS2ShapeIndex final : public S2ShapeIndex {
    private:
     const MutableS2ShapeIndex* index_ = nullptr;
     CellMap::const_iterator iter_, end_;
+
+    // If the index is frozen, the cells are accessed through "frozen_"
+    // rather than "iter_" and "end_", and "pos_" is the current position.
+    const FrozenCells* frozen_ = nullptr;
+    size_t pos_ = 0;
   };
 
   // Takes ownership of the given shape and adds it to the index.  Assigns a
@@ -374,6 +581,21 @@ class MutableS2ShapeIndex final : public S2ShapeIndex {
   // continue to be added even once the specified limit has been reached.
   int Add(std::unique_ptr<S2Shape> shape);
 
+  // Adds all of the given shapes to the index and returns the id assigned to
+  // the first one (the others are assigned consecutive ids).  This is
+  // equivalent to calling Add() on each shape, except that the shape vector
+  // is enlarged only once.  When adding a large number of shapes, consider
+  // also setting Options::num_threads() so that the edges of the new shapes
+  // are clipped to the cube faces in parallel when the index is built.
+  //
+  // Like Add(), this method is not affected by S2MemoryTracker.
+  int Add(std::vector<std::unique_ptr<S2Shape>> shapes);
+
+  // Ensures that at least "num_shapes" shapes in total can be added without
+  // reallocating the shape vector.  This is useful when shapes are produced
+  // one at a time (e.g. by a factory) and the total is known in advance.
+  void Reserve(int num_shapes);
+
   // Removes the given shape from the index and return ownership to the caller.
   // Invalidates all iterators and their associated data.
   std::unique_ptr<S2Shape> Release(int shape_id);
@@ -392,6 +614,11 @@ class MutableS2ShapeIndex final : public S2ShapeIndex {
   // as the other "const" methods (see introduction).
   size_t SpaceUsed() const override;
 
+  // Reports the components "object" (sizeof(*this)), "shapes" (the vector of
+  // shape pointers, not the shapes themselves), "cells" (the cell map),
+  // "clipped_shapes", "clipped_edges", and "pending_removals".
+  void GetSpaceUsage(S2SpaceUsage* usage) const override;
+
   // Calls to Add() and Release() are normally queued and processed on the
   // first subsequent query (in a thread-safe way).  Building the index lazily
   // in this way has several advantages, the most important of which is that
@@ -415,6 +642,30 @@ class MutableS2ShapeIndex final : public S2ShapeIndex {
   // Note that this method is thread-safe.
   void ForceBuild() const;
 
+  // A function that runs the given task, typically on some other thread
+  // (e.g. by adding it to a thread pool).  The task may also be run inline.
+  using Executor = std::function<void(std::function<void()>)>;
+
+  // Like ForceBuild(), except that pending updates are applied by a task
+  // passed to "executor" rather than by the calling thread.  Returns a future
+  // that becomes ready once the index is fresh.  This avoids placing the cost
+  // of building the index on whichever query happens to arrive first.
+  //
+  // Queries issued before the build has finished block until it is complete,
+  // exactly as when several threads query a stale index concurrently.  (If a
+  // query arrives before the executor starts the task, that query builds the
+  // index itself and the task then has nothing to do.)  To keep serving the
+  // previous contents of the index while it is rebuilt, see
+  // S2ShapeIndexPublisher::PublishAsync().
+  //
+  // If there are no pending updates, "executor" is not called and the
+  // returned future is already ready.  Like ForceBuild(), this method is
+  // thread-safe with respect to other "const" methods.
+  //
+  // REQUIRES: The index is not modified or destroyed until the returned
+  //           future is ready.
+  std::future<void> BuildAsync(const Executor& executor) const;
+
   // Returns true if there are no pending updates that need to be applied.
   // This can be useful to avoid building the index unnecessarily, or for
   // choosing between two different algorithms depending on whether the index
@@ -431,16 +682,19 @@ class MutableS2ShapeIndex final : public S2ShapeIndex {
 
  private:
   friend class EncodedS2ShapeIndex;
+  friend class EncodedS2ShapeIndexLoader;
   friend class Iterator;
   friend class MutableS2ShapeIndexTest;
   friend class S2Stats;
 
   class BatchGenerator;
+  class CellArena;
   class EdgeAllocator;
   class InteriorTracker;
   struct BatchDescriptor;
   struct ClippedEdge;
   struct FaceEdge;
+  struct PointEntry;
   struct RemovedShape;
 
   using ShapeEdgeId = s2shapeutil::ShapeEdgeId;
@@ -450,8 +704,17 @@ class MutableS2ShapeIndex final : public S2ShapeIndex {
   // to decode it.
   static constexpr unsigned char kCurrentEncodingVersionNumber = 0;
 
+  // The encoding used when Options::cache_shape_metadata() is true.  It is
+  // the same as version 0 followed by the encoded shape metadata.
+  static constexpr unsigned char kShapeMetadataEncodingVersionNumber = 1;
+
   // Internal methods are documented with their definitions.
   bool is_shape_being_removed(int shape_id) const;
+  bool ContainsBruteForce(const S2Shape& shape, int shape_id,
+                          const S2Point& point) const;
+  bool UpdateShapeMetadata();
+  unsigned char encoding_version() const;
+  bool EncodeShapeMetadata(size_t shape_id, Encoder* encoder) const;
   void MarkIndexStale();
   void MaybeApplyUpdates() const;
   void ApplyUpdatesThreadSafe();
@@ -466,27 +729,56 @@ class MutableS2ShapeIndex final : public S2ShapeIndex {
                    std::vector<FaceEdge> all_edges[6],
                    InteriorTracker* tracker) const;
   void FinishPartialShape(int shape_id);
+  bool RemoveShapesInPlace();
+  void FindCellsContainingShape(const RemovedShape& removed,
+                                std::vector<S2CellId>* cell_ids) const;
+  bool IsValidAfterRemoval(S2CellId id, const S2ShapeIndexCell& cell,
+                           absl::Span<const int> removed_ids) const;
+  bool BuildPointIndex();
+  void UpdatePoints(const S2PaddedCell& pcell,
+                    absl::Span<const PointEntry> points,
+                    std::vector<const ClippedEdge*>* edges,
+                    EdgeAllocator* alloc, CellMap* cell_map,
+                    CellArena* cell_arena);
+  void MakePointCell(S2CellId id, absl::Span<const PointEntry> points,
+                     const std::vector<const ClippedEdge*>& edges,
+                     CellMap* cell_map, CellArena* cell_arena) const;
+  void AddShapesParallel(const BatchDescriptor& batch,
+                         std::vector<FaceEdge> all_edges[6],
+                         InteriorTracker* tracker) const;
   void AddFaceEdge(FaceEdge* edge, std::vector<FaceEdge> all_edges[6]) const;
   void UpdateFaceEdges(int face, absl::Span<const FaceEdge> face_edges,
                        InteriorTracker* tracker);
-  S2CellId ShrinkToFit(const S2PaddedCell& pcell, const R2Rect& bound) const;
+  void UpdateFaceEdges(int face, absl::Span<const FaceEdge> face_edges,
+                       InteriorTracker* tracker, CellMap* cell_map,
+                       CellArena* cell_arena, bool disjoint_from_index);
+  void UpdateFacesParallel(const BatchDescriptor& batch,
+                           std::vector<FaceEdge> all_edges[6],
+                           const InteriorTracker& tracker);
+  S2CellId ShrinkToFit(const S2PaddedCell& pcell, const R2Rect& bound,
+                       bool disjoint_from_index) const;
   void SkipCellRange(S2CellId begin, S2CellId end, InteriorTracker* tracker,
-                     EdgeAllocator* alloc, bool disjoint_from_index);
+                     EdgeAllocator* alloc, CellMap* cell_map,
+                     CellArena* cell_arena, bool disjoint_from_index);
   void UpdateEdges(const S2PaddedCell& pcell,
                    std::vector<const ClippedEdge*>* edges,
                    InteriorTracker* tracker, EdgeAllocator* alloc,
+                   CellMap* cell_map, CellArena* cell_arena,
                    bool disjoint_from_index);
   void AbsorbIndexCell(const S2PaddedCell& pcell,
                        const Iterator& iter,
                        std::vector<const ClippedEdge*>* edges,
                        InteriorTracker* tracker,
                        EdgeAllocator* alloc);
+  CellArena* cell_arena();
+  bool Thaw();
   int GetEdgeMaxLevel(const S2Shape::Edge& edge) const;
   static int CountShapes(const std::vector<const ClippedEdge*>& edges,
                          const ShapeIdSet& cshape_ids);
   bool MakeIndexCell(const S2PaddedCell& pcell,
                      const std::vector<const ClippedEdge*>& edges,
-                     InteriorTracker* tracker);
+                     InteriorTracker* tracker, CellMap* cell_map,
+                     CellArena* cell_arena);
   static void TestAllEdges(const std::vector<const ClippedEdge*>& edges,
                            InteriorTracker* tracker);
   inline static const ClippedEdge* UpdateBound(const ClippedEdge* edge,
@@ -502,6 +794,9 @@ class MutableS2ShapeIndex final : public S2ShapeIndex {
   static void ClipVAxis(const ClippedEdge* edge, const R1Interval& middle,
                         std::vector<const ClippedEdge*> child_edges[2],
                         EdgeAllocator* alloc);
+  static void ClipToChildren(const ClippedEdge* edge, const R2Rect& middle,
+                             std::vector<const ClippedEdge*> child_edges[2][2],
+                             EdgeAllocator* alloc);
 
   // The shapes in the index, accessed by their shape id.  Removed shapes are
   // replaced by nullptr pointers.
@@ -514,9 +809,23 @@ class MutableS2ShapeIndex final : public S2ShapeIndex {
   // (The easiest way to achieve this is simply to use an Iterator.)
   CellMap cell_map_;
 
+  // The arena that owns the cells in cell_map_.  It is allocated when the
+  // first cell is created and freed (releasing the memory of all cells at
+  // once) by Minimize().
+  std::unique_ptr<CellArena> cell_arena_;
+
+  // If the index is frozen, the cells are stored here instead of in
+  // cell_map_ (which is then empty).
+  std::unique_ptr<FrozenCells> frozen_;
+
   // The options supplied for this index.
   Options options_;
 
+  // If options_.cache_shape_metadata() is true, the metadata of every shape
+  // that has been indexed (see UpdateShapeMetadata).  Entries for shapes that
+  // have been removed are not meaningful.
+  std::vector<S2ShapeMetadata> shape_metadata_;
+
   // The id of the first shape that has been queued for addition but not
   // processed yet.
   int pending_additions_begin_ = 0;
@@ -626,9 +935,10 @@ class MutableS2ShapeIndex::BatchGenerator {
  public:
   // Given the total number of edges that will be removed and added, prepares
   // to divide the edges into batches.  "shape_id_begin" identifies the first
-  // shape whose edges will be added.
+  // shape whose edges will be added.  If "sorted_input" is true, the edges
+  // are divided into many small batches (see Options::sorted_input).
   BatchGenerator(int num_edges_removed, int num_edges_added,
-                 int shape_id_begin);
+                 int shape_id_begin, bool sorted_input);
 
   // Indicates that the given shape will be added to the index.  Shapes with
   // few edges will be grouped together into a single batch, while shapes with
@@ -644,7 +954,8 @@ class MutableS2ShapeIndex::BatchGenerator {
   // (The actual batch sizes are adjusted later in order to avoid splitting
   // shapes between batches unnecessarily.)
   static std::vector<int> GetMaxBatchSizes(int num_edges_removed,
-                                           int num_edges_added);
+                                           int num_edges_added,
+                                           bool sorted_input);
 
   // Returns the maximum number of edges in the current batch.
   int max_batch_size() const { return max_batch_sizes_[batch_index_]; }
@@ -698,11 +1009,14 @@ inline void MutableS2ShapeIndex::Iterator::Init(
 inline void MutableS2ShapeIndex::Iterator::InitStale(
     const MutableS2ShapeIndex* index, InitialPosition pos) {
   index_ = index;
+  frozen_ = index_->frozen_.get();
   end_ = index_->cell_map_.end();
   iter_ = end_;
+  pos_ = frozen_ ? frozen_->size() : 0;
 
   if (pos == BEGIN) {
     iter_ = index_->cell_map_.begin();
+    pos_ = 0;
   }
 }
 
@@ -710,18 +1024,29 @@ inline void MutableS2ShapeIndex::Iterator::Begin() {
   // Make sure that the index has not been modified since Init() was called.
   ABSL_DCHECK(index_->is_fresh());
   iter_ = index_->cell_map_.begin();
+  pos_ = 0;
 }
 
 inline void MutableS2ShapeIndex::Iterator::Finish() {
   iter_ = end_;
+  if (frozen_ != nullptr) pos_ = frozen_->size();
 }
 
 inline void MutableS2ShapeIndex::Iterator::Next() {
   ABSL_DCHECK(!done());
-  ++iter_;
+  if (frozen_ != nullptr) {
+    ++pos_;
+  } else {
+    ++iter_;
+  }
 }
 
 inline bool MutableS2ShapeIndex::Iterator::Prev() {
+  if (frozen_ != nullptr) {
+    if (pos_ == 0) return false;
+    --pos_;
+    return true;
+  }
   if (iter_ == index_->cell_map_.begin()) {
     return false;
   }
@@ -730,7 +1055,24 @@ inline bool MutableS2ShapeIndex::Iterator::Prev() {
 }
 
 inline void MutableS2ShapeIndex::Iterator::Seek(S2CellId target) {
-  iter_ = index_->cell_map_.lower_bound(target);
+  if (frozen_ != nullptr) {
+    pos_ = frozen_->LowerBound(target);
+  } else {
+    iter_ = index_->cell_map_.lower_bound(target);
+  }
+}
+
+inline size_t MutableS2ShapeIndex::FrozenCells::LowerBound(
+    S2CellId target) const {
+  // Find the last block whose first id is <= target.  The result is then
+  // either in that block or is the first position of the following block.
+  size_t block = std::upper_bound(block_ids.begin(), block_ids.end(), target) -
+                 block_ids.begin();
+  if (block == 0) return 0;
+  size_t begin = (block - 1) * kBlockSize;
+  size_t end = std::min(begin + kBlockSize, size());
+  return std::lower_bound(ids.begin() + begin, ids.begin() + end, target) -
+         ids.begin();
 }
 
 inline std::unique_ptr<MutableS2ShapeIndex::IteratorBase>
@@ -0,0 +1,64 @@
+// Copyright 2024 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "s2/mutable_s2shape_index.h"
+
+#include <memory>
+#include <random>
+
+#include <benchmark/benchmark.h>
+#include "s2/s2benchmark_testing.h"
+#include "s2/s2loop.h"
+
+namespace {
+
+using s2benchmark::kSeed;
+
+// Measures the time to build an index containing one fractal loop.
+void BM_MutableS2ShapeIndexBuild(benchmark::State& state) {
+  const int num_edges = state.range(0);
+  std::mt19937_64 bitgen(kSeed);
+  std::unique_ptr<S2Loop> loop =
+      s2benchmark::MakeFractalLoop(bitgen, num_edges);
+  for (auto _ : state) {
+    MutableS2ShapeIndex index;
+    index.Add(std::make_unique<S2Loop::Shape>(loop.get()));
+    index.ForceBuild();
+    benchmark::DoNotOptimize(index);
+  }
+  state.SetItemsProcessed(state.iterations() * loop->num_vertices());
+}
+BENCHMARK(BM_MutableS2ShapeIndexBuild)->Apply(s2benchmark::EdgeCounts);
+
+// Like the above, but uses multiple threads to build the index.
+void BM_MutableS2ShapeIndexBuildParallel(benchmark::State& state) {
+  const int num_edges = state.range(0);
+  std::mt19937_64 bitgen(kSeed);
+  std::unique_ptr<S2Loop> loop =
+      s2benchmark::MakeFractalLoop(bitgen, num_edges);
+  MutableS2ShapeIndex::Options options;
+  options.set_num_threads(state.range(1));
+  for (auto _ : state) {
+    MutableS2ShapeIndex index(options);
+    index.Add(std::make_unique<S2Loop::Shape>(loop.get()));
+    index.ForceBuild();
+    benchmark::DoNotOptimize(index);
+  }
+  state.SetItemsProcessed(state.iterations() * loop->num_vertices());
+}
+BENCHMARK(BM_MutableS2ShapeIndexBuildParallel)
+    ->ArgsProduct({{49152, 786432}, {2, 4, 8}});
+
+}  // namespace
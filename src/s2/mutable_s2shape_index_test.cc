@@ -18,10 +18,14 @@
 #include "s2/mutable_s2shape_index.h"
 
 #include <algorithm>
+#include <chrono>
 #include <cmath>
 #include <cstddef>
+#include <functional>
+#include <future>
 #include <memory>
 #include <numeric>
+#include <random>
 #include <thread>
 #include <cstdint>
 #include <string>
@@ -35,9 +39,11 @@
 #include "absl/log/absl_check.h"
 #include "absl/log/absl_log.h"
 #include "absl/log/log_streamer.h"
+#include "absl/random/bit_gen_ref.h"
 #include "absl/random/random.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/str_format.h"
+#include "absl/strings/string_view.h"
 #include "absl/types/span.h"
 
 #include "s2/base/commandlineflags.h"
@@ -46,9 +52,11 @@
 #include "s2/r2.h"
 #include "s2/r2rect.h"
 #include "s2/s1angle.h"
+#include "s2/s2cap.h"
 #include "s2/s2cell.h"
 #include "s2/s2cell_id.h"
 #include "s2/s2cell_union.h"
+#include "s2/s2contains_point_query.h"
 #include "s2/s2coords.h"
 #include "s2/s2edge_clipping.h"
 #include "s2/s2edge_distances.h"
@@ -67,11 +75,13 @@
 #include "s2/s2random.h"
 #include "s2/s2shape.h"
 #include "s2/s2shape_index.h"
+#include "s2/s2shape_metadata.h"
 #include "s2/s2shapeutil_coding.h"
 #include "s2/s2shapeutil_contains_brute_force.h"
 #include "s2/s2shapeutil_testing.h"
 #include "s2/s2testing.h"
 #include "s2/s2text_format.h"
+#include "s2/s2wrapped_shape.h"
 #include "s2/thread_testing.h"
 #include "s2/util/coding/coder.h"
 #include "s2/util/math/matrix3x3.h"
@@ -119,7 +129,8 @@ class MutableS2ShapeIndexTest : public ::testing::Test {
   void TestBatchGenerator(int num_edges_removed,
                           absl::Span<const int> shape_edges_added,
                           int64_t tmp_memory_budget, int shape_id_begin,
-                          absl::Span<const BatchDescriptor> expected_batches);
+                          absl::Span<const BatchDescriptor> expected_batches,
+                          bool sorted_input = false);
 };
 
 void MutableS2ShapeIndexTest::QuadraticValidate() {
@@ -233,6 +244,21 @@ void MutableS2ShapeIndexTest::TestEncodeDecode() {
   MutableS2ShapeIndex index2;
   ASSERT_TRUE(index2.Init(&decoder, s2shapeutil::WrappedShapeFactory(&index_)));
   s2testing::ExpectEqual(index_, index2);
+
+  // Streaming the encoding must produce the same bytes.
+  string streamed;
+  ASSERT_TRUE(index_.Encode([&](absl::string_view piece) {
+    streamed.append(piece.data(), piece.size());
+    return true;
+  }));
+  EXPECT_EQ(absl::string_view(encoder.base(), encoder.length()), streamed);
+
+  // So must encoding the cells in parallel.
+  Encoder parallel_encoder;
+  index_.Encode(&parallel_encoder, 4);
+  EXPECT_EQ(absl::string_view(encoder.base(), encoder.length()),
+            absl::string_view(parallel_encoder.base(),
+                              parallel_encoder.length()));
 }
 
 /*static*/ string MutableS2ShapeIndexTest::ToString(
@@ -251,14 +277,14 @@ void MutableS2ShapeIndexTest::TestEncodeDecode() {
 void MutableS2ShapeIndexTest::TestBatchGenerator(
     int num_edges_removed, absl::Span<const int> shape_edges_added,
     int64_t tmp_memory_budget, int shape_id_begin,
-    absl::Span<const BatchDescriptor> expected_batches) {
+    absl::Span<const BatchDescriptor> expected_batches, bool sorted_input) {
   absl::FlagSaver fs;
   absl::SetFlag(&FLAGS_s2shape_index_tmp_memory_budget, tmp_memory_budget);
 
   int num_edges_added = 0;
   for (auto n : shape_edges_added) num_edges_added += n;
   MutableS2ShapeIndex::BatchGenerator bgen(num_edges_removed, num_edges_added,
-                                           shape_id_begin);
+                                           shape_id_begin, sorted_input);
   for (int i = 0; i < shape_edges_added.size(); ++i) {
     bgen.AddShape(shape_id_begin + i, shape_edges_added[i]);
   }
@@ -433,6 +459,21 @@ TEST_F(MutableS2ShapeIndexTest, SplitShapeIntoManyBatches) {
                       {{9, 0}, {10, 0}, 5}});
 }
 
+TEST_F(MutableS2ShapeIndexTest, SortedInputUsesFixedSizeBatches) {
+  // With sorted input, every batch has up to 16384 edges regardless of the
+  // memory budget, and shapes are split across batches as usual.
+  TestBatchGenerator(0, {10000, 10000, 30000}, 100 << 20 /*bytes*/, 7,
+                     {{{7, 0}, {8, 0}, 10000},
+                      {{8, 0}, {9, 6384}, 16384},
+                      {{9, 6384}, {9, 18192}, 11808},
+                      {{9, 18192}, {10, 0}, 11808}},
+                     true /*sorted_input*/);
+
+  // Small updates are processed in a single batch as usual.
+  TestBatchGenerator(0, {10000, 5000}, 100 << 20 /*bytes*/, 7,
+                     {{{7, 0}, {9, 0}, 15000}}, true /*sorted_input*/);
+}
+
 TEST_F(MutableS2ShapeIndexTest, SpaceUsed) {
   index_.Add(make_unique<S2EdgeVectorShape>(S2Point(1, 0, 0),
                                             S2Point(0, 1, 0)));
@@ -570,6 +611,103 @@ TEST_F(MutableS2ShapeIndexTest, SimpleUpdates) {
   }
 }
 
+TEST_F(MutableS2ShapeIndexTest, ReleaseShapesInPlace) {
+  // Build an index with enough small shapes that it is subdivided, and then
+  // release shapes (including ones with large interiors and holes) one or two
+  // at a time.  These removals are applied in place, which never creates
+  // new cells.
+  absl::BitGen bitgen(S2Testing::MakeTaggedSeedSeq(
+      "RELEASE_SHAPES_IN_PLACE",
+      absl::LogInfoStreamer(__FILE__, __LINE__).stream()));
+  S2Cap cap(S2Point(1, 0, 0), S1Angle::Degrees(20));
+  for (int i = 0; i < 50; ++i) {
+    index_.Add(make_unique<S2Loop::OwningShape>(S2Loop::MakeRegularLoop(
+        s2random::SamplePoint(bitgen, cap), S1Angle::Degrees(0.5), 8)));
+  }
+  index_.Add(make_unique<S2Polyline::OwningShape>(
+      MakePolylineOrDie("-10:-10, 10:10, -10:10")));
+  S2Polygon polygon;
+  S2Testing::ConcentricLoopsPolygon(S2Point(1, 0, 0), 3, 20, &polygon);
+  index_.Add(make_unique<S2Polygon::Shape>(&polygon));
+  index_.Add(make_unique<S2Loop::OwningShape>(S2Loop::MakeRegularLoop(
+      S2Point(-1, 0, 0), S1Angle::Degrees(100), 30)));
+  index_.ForceBuild();
+  QuadraticValidate();
+
+  auto num_cells = [this]() {
+    int count = 0;
+    for (MutableS2ShapeIndex::Iterator it(&index_, S2ShapeIndex::BEGIN);
+         !it.done(); it.Next()) {
+      ++count;
+    }
+    return count;
+  };
+  vector<unique_ptr<S2Shape>> released;
+  for (int id : {52, 50, 51, 3}) {
+    const int old_num_cells = num_cells();
+    released.push_back(index_.Release(id));
+    if (id == 3) released.push_back(index_.Release(4));
+    EXPECT_LE(num_cells(), old_num_cells);
+    QuadraticValidate();
+    TestEncodeDecode();
+  }
+}
+
+// Indexes the given point sets both by themselves (which uses the special
+// algorithm for point-only indexes) and together with an empty polyline
+// (which uses the general algorithm), and checks that the results are equal.
+void TestPointIndex(const vector<vector<S2Point>>& point_sets,
+                    const MutableS2ShapeIndex::Options& options) {
+  MutableS2ShapeIndex points_only(options), general(options);
+  for (const auto& points : point_sets) {
+    points_only.Add(make_unique<S2PointVectorShape>(points));
+    general.Add(make_unique<S2PointVectorShape>(points));
+  }
+  points_only.ForceBuild();
+  points_only.Add(make_unique<S2LaxPolylineShape>());
+  general.Add(make_unique<S2LaxPolylineShape>());
+  s2testing::ExpectEqual(general, points_only);
+}
+
+TEST(MutableS2ShapeIndex, PointIndexMatchesGeneralAlgorithm) {
+  absl::BitGen bitgen(S2Testing::MakeTaggedSeedSeq(
+      "POINT_INDEX_MATCHES_GENERAL_ALGORITHM",
+      absl::LogInfoStreamer(__FILE__, __LINE__).stream()));
+
+  // Points on cube face boundaries, at cube vertices, and at the corners of
+  // leaf cells need to be clipped rather than assigned to a leaf cell.
+  vector<S2Point> special =
+      s2textformat::ParsePointsOrDie("0:0, 0:45, 45:45, 0:90, 90:0, -90:0");
+  special.push_back(S2Point(1, 1, 1).Normalize());
+  special.push_back(S2Point(-1, 1, -1).Normalize());
+  for (int i = 0; i < 10; ++i) {
+    S2Cell leaf(s2random::CellId(bitgen, S2CellId::kMaxLevel));
+    special.push_back(leaf.GetVertex(0));
+    special.push_back(leaf.GetCenter());
+  }
+  vector<vector<S2Point>> point_sets = {special, {}, special};
+  // Clusters of points force the index to subdivide down to small cells.
+  for (int i = 0; i < 5; ++i) {
+    S2Cap cap(s2random::Point(bitgen), S1Angle::Radians(1e-3 * i));
+    vector<S2Point> points;
+    for (int j = 0; j < 200; ++j) {
+      points.push_back(s2random::SamplePoint(bitgen, cap));
+    }
+    point_sets.push_back(std::move(points));
+  }
+  for (bool packed_cells : {false, true}) {
+    for (int num_threads : {1, 3}) {
+      SCOPED_TRACE(absl::StrCat("packed_cells=", packed_cells,
+                                " num_threads=", num_threads));
+      MutableS2ShapeIndex::Options options;
+      options.set_max_edges_per_cell(3);
+      options.set_packed_cells(packed_cells);
+      options.set_num_threads(num_threads);
+      TestPointIndex(point_sets, options);
+    }
+  }
+}
+
 TEST_F(MutableS2ShapeIndexTest, RandomUpdates) {
   // Set the temporary memory budget such that at least one shape needs to be
   // split into multiple update batches (namely, the "5 concentric rings"
@@ -711,6 +849,323 @@ TEST(MutableS2ShapeIndex, MixedGeometry) {
   EXPECT_EQ(S2CellRelation::DISJOINT, it.Locate(S2CellId::FromFace(1)));
 }
 
+// Adds a variety of geometry that spans all six cube faces to "index".  The
+// same geometry is generated for generators with the same state.
+void AddMultiFaceGeometry(absl::BitGenRef bitgen, MutableS2ShapeIndex* index) {
+  S2Fractal fractal(bitgen);
+  fractal.SetLevelForApproxMaxEdges(3 * 256);
+  for (const S2Point& center :
+       {S2Point(1, -1, -1), S2Point(-1, 1, 1), S2Point(0, 0, 1),
+        S2Point(1, 1, 0)}) {
+    index->Add(make_unique<S2Loop::OwningShape>(fractal.MakeLoop(
+        S2::GetFrame(center.Normalize()), S1Angle::Degrees(70))));
+  }
+  // A polygon that contains most of the sphere (so that the entry vertices
+  // of several faces are inside it) and a full polygon without any edges.
+  index->Add(make_unique<S2Loop::OwningShape>(S2Loop::MakeRegularLoop(
+      S2Point(-1, -1, 0.5).Normalize(), S1Angle::Degrees(160), 300)));
+  index->Add(make_unique<S2LaxPolygonShape>(
+      vector<S2LaxPolygonShape::Loop>{{}}));
+  index->Add(make_unique<S2Polyline::OwningShape>(
+      MakePolylineOrDie("0:0, 0:90, 0:180, 0:-90, 45:0, 90:0, -45:0")));
+  index->Add(make_unique<S2PointVectorShape>(
+      s2textformat::ParsePointsOrDie("0:0, 89:0, -89:0, 0:179, 10:-60")));
+}
+
+TEST(MutableS2ShapeIndex, MultiThreadedBuildMatchesSingleThreaded) {
+  std::mt19937_64 bitgen1(1), bitgen4(1);
+  MutableS2ShapeIndex index1;
+  AddMultiFaceGeometry(bitgen1, &index1);
+  index1.ForceBuild();
+
+  MutableS2ShapeIndex::Options options;
+  options.set_num_threads(4);
+  MutableS2ShapeIndex index4(options);
+  AddMultiFaceGeometry(bitgen4, &index4);
+  index4.ForceBuild();
+
+  Encoder encoder1, encoder4;
+  index1.Encode(&encoder1);
+  index4.Encode(&encoder4);
+  EXPECT_EQ(absl::string_view(encoder1.base(), encoder1.length()),
+            absl::string_view(encoder4.base(), encoder4.length()));
+  s2testing::ExpectEqual(index1, index4);
+}
+
+TEST(MutableS2ShapeIndex, AddShapeVector) {
+  std::mt19937_64 bitgen(3);
+  MutableS2ShapeIndex expected;
+  AddMultiFaceGeometry(bitgen, &expected);
+
+  MutableS2ShapeIndex::Options options;
+  options.set_num_threads(2);
+  MutableS2ShapeIndex index(options);
+  index.Reserve(expected.num_shape_ids());
+  vector<unique_ptr<S2Shape>> shapes;
+  for (int id = 0; id < expected.num_shape_ids(); ++id) {
+    shapes.push_back(make_unique<S2WrappedShape>(expected.shape(id)));
+  }
+  EXPECT_EQ(0, index.Add(std::move(shapes)));
+  EXPECT_EQ(expected.num_shape_ids(), index.num_shape_ids());
+  s2testing::ExpectEqual(expected, index);
+
+  // Shapes added later are assigned consecutive ids.
+  shapes.clear();
+  shapes.push_back(make_unique<S2EdgeVectorShape>(S2Point(1, 0, 0),
+                                                  S2Point(0, 1, 0)));
+  EXPECT_EQ(expected.num_shape_ids(), index.Add(std::move(shapes)));
+  EXPECT_EQ(1, index.shape(expected.num_shape_ids())->num_edges());
+}
+
+TEST(MutableS2ShapeIndex, MultiThreadedUpdatesMatchSingleThreaded) {
+  // Split the updates into several batches, and also apply an incremental
+  // update to an existing index (where the faces cannot be indexed
+  // independently).
+  absl::FlagSaver fs;
+  absl::SetFlag(&FLAGS_s2shape_index_tmp_memory_budget, 100000);
+  MutableS2ShapeIndex::Options options;
+  options.set_num_threads(3);
+  MutableS2ShapeIndex index1, index3(options);
+  for (MutableS2ShapeIndex* index : {&index1, &index3}) {
+    std::mt19937_64 bitgen(2);
+    AddMultiFaceGeometry(bitgen, index);
+    index->ForceBuild();
+    index->Release(1);
+    index->Add(make_unique<S2Loop::OwningShape>(S2Loop::MakeRegularLoop(
+        S2Point(0, 1, 0), S1Angle::Degrees(10), 100)));
+    index->ForceBuild();
+  }
+  s2testing::ExpectEqual(index1, index3);
+}
+
+TEST(MutableS2ShapeIndex, RepeatedUpdatesReuseCellMemory) {
+  // Cells that are deleted by incremental updates are recycled, so the index
+  // does not grow when the same shape is repeatedly removed and re-added.
+  MutableS2ShapeIndex index;
+  index.Add(make_unique<S2Loop::OwningShape>(S2Loop::MakeRegularLoop(
+      S2Point(1, 0, 0), S1Angle::Degrees(20), 1000)));
+  index.ForceBuild();
+  size_t initial_space_used = index.SpaceUsed();
+  for (int iter = 0; iter < 10; ++iter) {
+    auto shape = index.Release(index.num_shape_ids() - 1);
+    index.ForceBuild();
+    index.Add(std::move(shape));
+    index.ForceBuild();
+  }
+  EXPECT_LE(index.SpaceUsed(), 2 * initial_space_used);
+  index.Minimize();
+  EXPECT_LT(index.SpaceUsed(), initial_space_used / 10);
+}
+
+TEST(MutableS2ShapeIndex, FrozenIndexMatchesRegularIndex) {
+  MutableS2ShapeIndex index, frozen;
+  for (MutableS2ShapeIndex* i : {&index, &frozen}) {
+    std::mt19937_64 bitgen(4);
+    AddMultiFaceGeometry(bitgen, i);
+  }
+  frozen.Freeze();
+  EXPECT_TRUE(frozen.is_frozen());
+  s2testing::ExpectEqual(index, frozen);
+  EXPECT_LT(frozen.SpaceUsed(), index.SpaceUsed());
+
+  // Check that seeking and stepping backwards agree with the regular index.
+  std::mt19937_64 bitgen(5);
+  MutableS2ShapeIndex::Iterator it(&index), frozen_it(&frozen);
+  for (int iter = 0; iter < 1000; ++iter) {
+    S2CellId target = s2random::CellId(bitgen);
+    it.Seek(target);
+    frozen_it.Seek(target);
+    ASSERT_EQ(it.id(), frozen_it.id());
+    ASSERT_EQ(it.Prev(), frozen_it.Prev());
+    ASSERT_EQ(it.id(), frozen_it.id());
+    ASSERT_EQ(it.Locate(target), frozen_it.Locate(target));
+  }
+
+  // Updating a frozen index converts it back to the regular form.
+  for (MutableS2ShapeIndex* i : {&index, &frozen}) {
+    i->Release(0);
+    i->Add(make_unique<S2Loop::OwningShape>(S2Loop::MakeRegularLoop(
+        S2Point(0, 0, 1), S1Angle::Degrees(5), 100)));
+    i->ForceBuild();
+  }
+  EXPECT_FALSE(frozen.is_frozen());
+  s2testing::ExpectEqual(index, frozen);
+}
+
+TEST(MutableS2ShapeIndex, PackedCellsMatchRegularCells) {
+  MutableS2ShapeIndex::Options options;
+  options.set_packed_cells(true);
+  MutableS2ShapeIndex index1, packed(options);
+  for (MutableS2ShapeIndex* index : {&index1, &packed}) {
+    std::mt19937_64 bitgen(3);
+    AddMultiFaceGeometry(bitgen, index);
+    index->ForceBuild();
+  }
+  Encoder encoder1, encoder_packed;
+  index1.Encode(&encoder1);
+  packed.Encode(&encoder_packed);
+  EXPECT_EQ(absl::string_view(encoder1.base(), encoder1.length()),
+            absl::string_view(encoder_packed.base(), encoder_packed.length()));
+  s2testing::ExpectEqual(index1, packed);
+  EXPECT_EQ(index1.SpaceUsed(), packed.SpaceUsed());
+
+  // Incremental updates replace some packed cells and keep others.
+  for (MutableS2ShapeIndex* index : {&index1, &packed}) {
+    index->Release(0);
+    index->Add(make_unique<S2Loop::OwningShape>(S2Loop::MakeRegularLoop(
+        S2Point(1, 0, 0), S1Angle::Degrees(5), 100)));
+    index->ForceBuild();
+  }
+  s2testing::ExpectEqual(index1, packed);
+}
+
+TEST(MutableS2ShapeIndex, SortedInputMatchesUnsortedInput) {
+  absl::BitGen bitgen(S2Testing::MakeTaggedSeedSeq(
+      "SORTED_INPUT_MATCHES_UNSORTED_INPUT",
+      absl::LogInfoStreamer(__FILE__, __LINE__).stream()));
+
+  // Add enough small loops sorted by S2CellId to require several batches.
+  S2Cap cap(s2random::Point(bitgen), S1Angle::Degrees(5));
+  vector<S2Point> centers;
+  for (int i = 0; i < 5000; ++i) {
+    centers.push_back(s2random::SamplePoint(bitgen, cap));
+  }
+  std::sort(centers.begin(), centers.end(),
+            [](const S2Point& a, const S2Point& b) {
+              return S2CellId(a) < S2CellId(b);
+            });
+  MutableS2ShapeIndex::Options options;
+  options.set_sorted_input(true);
+  MutableS2ShapeIndex sorted(options), unsorted;
+  for (const S2Point& center : centers) {
+    for (MutableS2ShapeIndex* index : {&sorted, &unsorted}) {
+      index->Add(make_unique<S2Loop::OwningShape>(S2Loop::MakeRegularLoop(
+          center, S2Testing::KmToAngle(5), 10)));
+    }
+  }
+  sorted.ForceBuild();
+  unsorted.ForceBuild();
+
+  // The subdivision may differ slightly near batch boundaries, so we check
+  // that point containment agrees near the loop boundaries instead.
+  auto sorted_query = MakeS2ContainsPointQuery(&sorted);
+  auto unsorted_query = MakeS2ContainsPointQuery(&unsorted);
+  for (int i = 0; i < 5000; ++i) {
+    S2Cap loop_cap(centers[absl::Uniform(bitgen, size_t{0}, centers.size())],
+                   S2Testing::KmToAngle(6));
+    S2Point p = s2random::SamplePoint(bitgen, loop_cap);
+    EXPECT_EQ(unsorted_query.GetContainingShapeIds(p),
+              sorted_query.GetContainingShapeIds(p));
+  }
+}
+
+static void ExpectMetadataEqual(const S2ShapeMetadata& expected,
+                                const S2ShapeMetadata& actual) {
+  EXPECT_EQ(expected.dimension, actual.dimension);
+  EXPECT_EQ(expected.reference_point, actual.reference_point);
+  EXPECT_EQ(expected.bound, actual.bound);
+  EXPECT_EQ(expected.area, actual.area);
+  EXPECT_EQ(expected.centroid, actual.centroid);
+}
+
+TEST(MutableS2ShapeIndex, CachedShapeMetadata) {
+  MutableS2ShapeIndex::Options options;
+  options.set_cache_shape_metadata(true);
+  options.set_num_threads(2);
+  MutableS2ShapeIndex index(options), plain_index;
+  for (MutableS2ShapeIndex* index : {&index, &plain_index}) {
+    std::mt19937_64 bitgen(3);
+    AddMultiFaceGeometry(bitgen, index);
+    index->Release(2);
+  }
+  // Caching the metadata does not change the index cells.
+  s2testing::ExpectEqual(plain_index, index);
+
+  S2ShapeMetadata metadata;
+  for (int id = 0; id < index.num_shape_ids(); ++id) {
+    EXPECT_FALSE(plain_index.GetShapeMetadata(id, &metadata));
+    const S2Shape* shape = index.shape(id);
+    if (shape == nullptr) {
+      EXPECT_FALSE(index.GetShapeMetadata(id, &metadata));
+      continue;
+    }
+    ASSERT_TRUE(index.GetShapeMetadata(id, &metadata));
+    ExpectMetadataEqual(S2ShapeMetadata::Compute(*shape), metadata);
+  }
+
+  // The metadata is preserved by encoding and decoding, and the streaming
+  // encoding is still identical to the regular one.
+  Encoder encoder;
+  index.Encode(&encoder);
+  string streamed;
+  ASSERT_TRUE(index.Encode([&](absl::string_view piece) {
+    streamed.append(piece.data(), piece.size());
+    return true;
+  }));
+  EXPECT_EQ(absl::string_view(encoder.base(), encoder.length()), streamed);
+
+  Decoder decoder(encoder.base(), encoder.length());
+  MutableS2ShapeIndex decoded;
+  ASSERT_TRUE(decoded.Init(&decoder,
+                           s2shapeutil::WrappedShapeFactory(&index)));
+  EXPECT_TRUE(decoded.options().cache_shape_metadata());
+  s2testing::ExpectEqual(index, decoded);
+  for (int id = 0; id < index.num_shape_ids(); ++id) {
+    S2ShapeMetadata decoded_metadata;
+    bool has_metadata = index.GetShapeMetadata(id, &metadata);
+    ASSERT_EQ(has_metadata, decoded.GetShapeMetadata(id, &decoded_metadata));
+    if (has_metadata) ExpectMetadataEqual(metadata, decoded_metadata);
+  }
+}
+
+TEST(MutableS2ShapeIndex, BuildAsyncMatchesForceBuild) {
+  std::mt19937_64 bitgen1(3), bitgen2(3);
+  MutableS2ShapeIndex expected, index;
+  AddMultiFaceGeometry(bitgen1, &expected);
+  expected.ForceBuild();
+  AddMultiFaceGeometry(bitgen2, &index);
+
+  vector<std::thread> threads;
+  auto future = index.BuildAsync([&threads](std::function<void()> task) {
+    threads.emplace_back(std::move(task));
+  });
+  ASSERT_EQ(threads.size(), 1);
+  future.wait();
+  EXPECT_TRUE(index.is_fresh());
+  threads[0].join();
+  s2testing::ExpectEqual(expected, index);
+}
+
+TEST(MutableS2ShapeIndex, BuildAsyncFreshIndexDoesNotCallExecutor) {
+  MutableS2ShapeIndex index;
+  int num_tasks = 0;
+  auto future =
+      index.BuildAsync([&num_tasks](std::function<void()>) { ++num_tasks; });
+  EXPECT_EQ(future.wait_for(std::chrono::seconds(0)),
+            std::future_status::ready);
+  EXPECT_EQ(num_tasks, 0);
+}
+
+TEST(MutableS2ShapeIndex, QueriesDuringBuildAsyncWaitForBuild) {
+  // Queries that arrive while the asynchronous build is running (or before
+  // it has started) must see the fully updated index.
+  std::mt19937_64 bitgen(4);
+  MutableS2ShapeIndex index;
+  AddMultiFaceGeometry(bitgen, &index);
+  MutableS2ShapeIndex expected;
+  for (int i = 0; i < index.num_shape_ids(); ++i) {
+    expected.Add(make_unique<S2WrappedShape>(index.shape(i)));
+  }
+  std::thread thread;
+  auto future = index.BuildAsync([&thread](std::function<void()> task) {
+    thread = std::thread(std::move(task));
+  });
+  s2testing::ExpectEqual(expected, index);
+  EXPECT_TRUE(index.is_fresh());
+  future.wait();
+  thread.join();
+}
+
 TEST_F(MutableS2ShapeIndexTest, LinearSpace) {
   // Build an index that requires FLAGS_s2shape_index_min_short_edge_fraction
   // to be non-zero in order to use a non-quadratic amount of space.
@@ -800,6 +1255,31 @@ TEST_F(MutableS2ShapeIndexTest, DecoderCatchesInvalidIndex) {
   EXPECT_FALSE(ok);
 }
 
+TEST(MutableS2ShapeIndex, UpdateDecodedIndex) {
+  // Checks that shapes can be added to and removed from a decoded index
+  // without indexing the decoded shapes a second time.
+  const string kIndex = "# 0:0, 1:1 | 5:5, 6:6 # 0:3, 0:4, 1:4, 1:3";
+  auto expected = s2textformat::MakeIndexOrDie(kIndex);
+  auto source = s2textformat::MakeIndexOrDie(kIndex);
+  Encoder encoder;
+  source->Encode(&encoder);
+  Decoder decoder(encoder.base(), encoder.length());
+  MutableS2ShapeIndex actual;
+  ASSERT_TRUE(actual.Init(&decoder, s2shapeutil::WrappedShapeFactory(
+                                        source.get())));
+  for (MutableS2ShapeIndex* index : {expected.get(), &actual}) {
+    index->Release(0);
+    index->Add(s2textformat::MakeLaxPolygonOrDie("3:3, 3:4, 4:4, 4:3"));
+  }
+  s2testing::ExpectEqual(*expected, actual);
+  Encoder expected_encoder, actual_encoder;
+  expected->Encode(&expected_encoder);
+  actual.Encode(&actual_encoder);
+  EXPECT_EQ(
+      absl::string_view(expected_encoder.base(), expected_encoder.length()),
+      absl::string_view(actual_encoder.base(), actual_encoder.length()));
+}
+
 TEST(S2Shape, user_data) {
   struct MyData {
     int x, y;
@@ -0,0 +1,171 @@
+// Copyright 2024 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "s2/mutable_s2shape_index_tuning.h"
+
+#include <algorithm>
+#include <chrono>
+#include <limits>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/flags/flag.h"
+#include "absl/flags/reflection.h"
+#include "absl/log/absl_check.h"
+#include "absl/random/bit_gen_ref.h"
+#include "absl/strings/str_format.h"
+#include "s2/base/commandlineflags.h"
+#include "s2/base/commandlineflags_declare.h"
+#include "s2/mutable_s2shape_index.h"
+#include "s2/s1angle.h"
+#include "s2/s2cap.h"
+#include "s2/s2closest_edge_query.h"
+#include "s2/s2contains_point_query.h"
+#include "s2/s2point.h"
+#include "s2/s2random.h"
+#include "s2/s2shape.h"
+#include "s2/s2shape_index.h"
+#include "s2/s2shape_index_region.h"
+#include "s2/s2wrapped_shape.h"
+
+S2_DECLARE_double(s2shape_index_cell_size_to_long_edge_ratio);
+
+using std::make_unique;
+using std::min;
+using std::string;
+using std::vector;
+
+namespace s2testing {
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// Returns the elapsed time since "start" in nanoseconds.
+double ElapsedNs(Clock::time_point start) {
+  return std::chrono::duration<double, std::nano>(Clock::now() - start)
+      .count();
+}
+
+}  // namespace
+
+ShapeIndexWorkload MakeShapeIndexWorkload(const S2ShapeIndex& index,
+                                          int num_points,
+                                          absl::BitGenRef bitgen) {
+  S2Cap cap = MakeS2ShapeIndexRegion(&index).GetCapBound();
+  if (cap.is_empty() || cap.is_full()) {
+    cap = S2Cap::Full();
+  } else {
+    cap = S2Cap(cap.center(), 1.5 * cap.GetRadius());
+  }
+  ShapeIndexWorkload workload;
+  for (int i = 0; i < num_points; ++i) {
+    workload.contains_points.push_back(s2random::SamplePoint(bitgen, cap));
+    workload.closest_edge_points.push_back(s2random::SamplePoint(bitgen, cap));
+  }
+  return workload;
+}
+
+MutableS2ShapeIndexTuner::Options::Options()
+    : max_edges_per_cell_values_({4, 10, 20, 50}),
+      cell_size_to_long_edge_ratio_values_({1.0}) {}
+
+void MutableS2ShapeIndexTuner::Options::set_num_repetitions(
+    int num_repetitions) {
+  ABSL_DCHECK_GE(num_repetitions, 1);
+  num_repetitions_ = std::max(1, num_repetitions);
+}
+
+vector<ShapeIndexTuningResult> MutableS2ShapeIndexTuner::Run(
+    const S2ShapeIndex& index, const ShapeIndexWorkload& workload) const {
+  absl::FlagSaver flag_saver;
+  vector<ShapeIndexTuningResult> results;
+  for (double ratio : options_.cell_size_to_long_edge_ratio_values()) {
+    absl::SetFlag(&FLAGS_s2shape_index_cell_size_to_long_edge_ratio, ratio);
+    for (int max_edges : options_.max_edges_per_cell_values()) {
+      ShapeIndexTuningResult result;
+      result.max_edges_per_cell = max_edges;
+      result.cell_size_to_long_edge_ratio = ratio;
+      result.build_ms = result.contains_point_ns = result.closest_edge_ns =
+          std::numeric_limits<double>::infinity();
+      for (int rep = 0; rep < options_.num_repetitions(); ++rep) {
+        MutableS2ShapeIndex::Options index_options;
+        index_options.set_max_edges_per_cell(max_edges);
+        MutableS2ShapeIndex tuned(index_options);
+
+        // The shapes are wrapped rather than copied, so that the build time
+        // does not include any shape decoding or copying.
+        auto start = Clock::now();
+        for (const S2Shape* shape : index) {
+          if (shape != nullptr) {
+            tuned.Add(make_unique<S2WrappedShape>(shape));
+          }
+        }
+        tuned.ForceBuild();
+        result.build_ms = min(result.build_ms, ElapsedNs(start) / 1e6);
+
+        if (!workload.contains_points.empty()) {
+          auto query = MakeS2ContainsPointQuery(&tuned);
+          start = Clock::now();
+          for (const S2Point& p : workload.contains_points) {
+            query.Contains(p);
+          }
+          result.contains_point_ns =
+              min(result.contains_point_ns,
+                  ElapsedNs(start) / workload.contains_points.size());
+        }
+        if (!workload.closest_edge_points.empty()) {
+          S2ClosestEdgeQuery query(&tuned);
+          start = Clock::now();
+          for (const S2Point& p : workload.closest_edge_points) {
+            S2ClosestEdgeQuery::PointTarget target(p);
+            query.FindClosestEdge(&target);
+          }
+          result.closest_edge_ns =
+              min(result.closest_edge_ns,
+                  ElapsedNs(start) / workload.closest_edge_points.size());
+        }
+        if (rep == 0) {
+          result.space_used = tuned.SpaceUsed();
+          for (MutableS2ShapeIndex::Iterator it(&tuned, S2ShapeIndex::BEGIN);
+               !it.done(); it.Next()) {
+            ++result.num_cells;
+          }
+        }
+      }
+      if (workload.contains_points.empty()) result.contains_point_ns = 0;
+      if (workload.closest_edge_points.empty()) result.closest_edge_ns = 0;
+      results.push_back(result);
+    }
+  }
+  return results;
+}
+
+string MutableS2ShapeIndexTuner::ToString(
+    const vector<ShapeIndexTuningResult>& results) {
+  string str = absl::StrFormat("%9s %6s %9s %12s %10s %12s %12s\n",
+                               "max_edges", "ratio", "cells", "bytes",
+                               "build_ms", "contains_ns", "closest_ns");
+  for (const auto& r : results) {
+    absl::StrAppendFormat(&str, "%9d %6.2f %9d %12d %10.3f %12.1f %12.1f\n",
+                          r.max_edges_per_cell, r.cell_size_to_long_edge_ratio,
+                          r.num_cells, r.space_used, r.build_ms,
+                          r.contains_point_ns, r.closest_edge_ns);
+  }
+  return str;
+}
+
+}  // namespace s2testing
@@ -0,0 +1,148 @@
+// Copyright 2024 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+// Tools for choosing MutableS2ShapeIndex settings for a particular dataset.
+
+#ifndef S2_MUTABLE_S2SHAPE_INDEX_TUNING_H_
+#define S2_MUTABLE_S2SHAPE_INDEX_TUNING_H_
+
+#include <cstddef>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/random/bit_gen_ref.h"
+#include "s2/s2point.h"
+#include "s2/s2shape_index.h"
+
+namespace s2testing {
+
+// A sample query workload used to evaluate MutableS2ShapeIndex settings.
+struct ShapeIndexWorkload {
+  // Points passed to S2ContainsPointQuery::Contains().
+  std::vector<S2Point> contains_points;
+
+  // Points passed to S2ClosestEdgeQuery::FindClosestEdge().
+  std::vector<S2Point> closest_edge_points;
+};
+
+// Returns a workload of "num_points" points of each kind, sampled uniformly
+// from a cap slightly larger than the bounding cap of "index" so that some
+// points are near the indexed geometry and some are not.
+ShapeIndexWorkload MakeShapeIndexWorkload(const S2ShapeIndex& index,
+                                          int num_points,
+                                          absl::BitGenRef bitgen);
+
+// The measurements for one combination of index settings.
+struct ShapeIndexTuningResult {
+  // MutableS2ShapeIndex::Options::max_edges_per_cell().
+  int max_edges_per_cell = 0;
+
+  // The value of --s2shape_index_cell_size_to_long_edge_ratio.
+  double cell_size_to_long_edge_ratio = 0;
+
+  // The number of index cells and MutableS2ShapeIndex::SpaceUsed().
+  int num_cells = 0;
+  size_t space_used = 0;
+
+  // The time to build the index, and the average time per query point of
+  // each kind.  Each time is the minimum over all repetitions.
+  double build_ms = 0;
+  double contains_point_ns = 0;
+  double closest_edge_ns = 0;
+};
+
+// MutableS2ShapeIndexTuner builds a MutableS2ShapeIndex of the same shapes
+// for every combination of the given max_edges_per_cell() values and
+// --s2shape_index_cell_size_to_long_edge_ratio values, runs the given
+// workload against each one, and reports the memory usage and latency of
+// each setting.  This makes it easy to choose the settings that give the
+// best size/speed tradeoff for a particular dataset.
+//
+// Example usage:
+//
+//   s2testing::MutableS2ShapeIndexTuner tuner;
+//   auto results = tuner.Run(index, s2testing::MakeShapeIndexWorkload(
+//                                       index, 10000, bitgen));
+//   std::cout << s2testing::MutableS2ShapeIndexTuner::ToString(results);
+//
+// Note that the timings are only meaningful in optimized builds, and that
+// the flag is temporarily modified while each index is built.
+class MutableS2ShapeIndexTuner {
+ public:
+  class Options {
+   public:
+    Options();
+
+    // The values of MutableS2ShapeIndex::Options::max_edges_per_cell() to
+    // evaluate.
+    //
+    // DEFAULT: {4, 10, 20, 50}
+    const std::vector<int>& max_edges_per_cell_values() const {
+      return max_edges_per_cell_values_;
+    }
+    void set_max_edges_per_cell_values(std::vector<int> values) {
+      max_edges_per_cell_values_ = std::move(values);
+    }
+
+    // The values of --s2shape_index_cell_size_to_long_edge_ratio to
+    // evaluate.
+    //
+    // DEFAULT: {1.0}
+    const std::vector<double>& cell_size_to_long_edge_ratio_values() const {
+      return cell_size_to_long_edge_ratio_values_;
+    }
+    void set_cell_size_to_long_edge_ratio_values(std::vector<double> values) {
+      cell_size_to_long_edge_ratio_values_ = std::move(values);
+    }
+
+    // The number of times each measurement is repeated.  The minimum time
+    // over all repetitions is reported.
+    //
+    // DEFAULT: 3
+    int num_repetitions() const { return num_repetitions_; }
+    void set_num_repetitions(int num_repetitions);
+
+   private:
+    std::vector<int> max_edges_per_cell_values_;
+    std::vector<double> cell_size_to_long_edge_ratio_values_;
+    int num_repetitions_ = 3;
+  };
+
+  MutableS2ShapeIndexTuner() = default;
+  explicit MutableS2ShapeIndexTuner(const Options& options)
+      : options_(options) {}
+
+  const Options& options() const { return options_; }
+  Options* mutable_options() { return &options_; }
+
+  // Evaluates every combination of settings for the shapes in "index" (which
+  // may be any S2ShapeIndex type) and returns one result per combination,
+  // ordered by cell_size_to_long_edge_ratio and then max_edges_per_cell.
+  // The shapes must outlive this call.
+  std::vector<ShapeIndexTuningResult> Run(
+      const S2ShapeIndex& index, const ShapeIndexWorkload& workload) const;
+
+  // Returns a table of the given results, one line per result.
+  static std::string ToString(
+      const std::vector<ShapeIndexTuningResult>& results);
+
+ private:
+  Options options_;
+};
+
+}  // namespace s2testing
+
+#endif  // S2_MUTABLE_S2SHAPE_INDEX_TUNING_H_
@@ -0,0 +1,74 @@
+// Copyright 2024 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "s2/mutable_s2shape_index_tuning.h"
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include "absl/flags/flag.h"
+#include "absl/random/random.h"
+#include "s2/base/commandlineflags.h"
+#include "s2/base/commandlineflags_declare.h"
+#include "s2/mutable_s2shape_index.h"
+#include "s2/s2fractal.h"
+#include "s2/s2loop.h"
+#include "s2/s2random.h"
+#include "s2/s2testing.h"
+
+S2_DECLARE_double(s2shape_index_cell_size_to_long_edge_ratio);
+
+namespace s2testing {
+namespace {
+
+TEST(MutableS2ShapeIndexTuner, EvaluatesAllSettings) {
+  absl::BitGen bitgen;
+  MutableS2ShapeIndex index;
+  S2Fractal fractal(bitgen);
+  fractal.SetLevelForApproxMaxEdges(3000);
+  index.Add(std::make_unique<S2Loop::OwningShape>(fractal.MakeLoop(
+      s2random::Frame(bitgen), S2Testing::KmToAngle(100))));
+  ShapeIndexWorkload workload = MakeShapeIndexWorkload(index, 100, bitgen);
+  EXPECT_EQ(workload.contains_points.size(), 100);
+  EXPECT_EQ(workload.closest_edge_points.size(), 100);
+
+  MutableS2ShapeIndexTuner tuner;
+  tuner.mutable_options()->set_max_edges_per_cell_values({4, 50});
+  tuner.mutable_options()->set_cell_size_to_long_edge_ratio_values({0.5, 2});
+  tuner.mutable_options()->set_num_repetitions(1);
+  std::vector<ShapeIndexTuningResult> results = tuner.Run(index, workload);
+  ASSERT_EQ(results.size(), 4);
+  for (int i = 0; i < 4; ++i) {
+    EXPECT_EQ(results[i].max_edges_per_cell, i % 2 == 0 ? 4 : 50);
+    EXPECT_EQ(results[i].cell_size_to_long_edge_ratio, i < 2 ? 0.5 : 2);
+    EXPECT_GT(results[i].num_cells, 0);
+    EXPECT_GT(results[i].space_used, 0);
+  }
+  // Fewer edges per cell requires more cells.
+  EXPECT_GT(results[0].num_cells, results[1].num_cells);
+
+  // The flag is restored afterwards.
+  EXPECT_EQ(absl::GetFlag(FLAGS_s2shape_index_cell_size_to_long_edge_ratio),
+            1.0);
+
+  std::string table = MutableS2ShapeIndexTuner::ToString(results);
+  EXPECT_EQ(std::count(table.begin(), table.end(), '\n'), 5);
+}
+
+}  // namespace
+}  // namespace s2testing
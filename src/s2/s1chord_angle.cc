@@ -20,9 +20,11 @@
 #include <algorithm>
 #include <cfloat>
 #include <cmath>
+#include <cstddef>
 #include <ostream>
 
 #include "absl/log/absl_check.h"
+#include "absl/types/span.h"
 #include "s2/s1angle.h"
 
 using std::max;
@@ -37,6 +39,24 @@ using std::nextafter;
 
 static constexpr double kMaxLength2 = 4.0;
 
+void S1ChordAngle::FromPoints(const S2Point& x, absl::Span<const S2Point> y,
+                              absl::Span<S1ChordAngle> result) {
+  ABSL_DCHECK_EQ(y.size(), result.size());
+  // This loop has no branches, so that it can be vectorized.
+  for (size_t k = 0; k < y.size(); ++k) {
+    result[k] = FromLength2((x - y[k]).Norm2());
+  }
+}
+
+void S1ChordAngle::FromPoints(absl::Span<const S2Point> x,
+                              absl::Span<const S2Point> y,
+                              absl::Span<S1ChordAngle> result) {
+  ABSL_DCHECK_EQ(x.size() * y.size(), result.size());
+  for (size_t i = 0; i < x.size(); ++i) {
+    FromPoints(x[i], y, result.subspan(i * y.size(), y.size()));
+  }
+}
+
 S1Angle S1ChordAngle::ToAngle() const {
   if (is_negative()) return S1Angle::Radians(-1);
   if (is_infinity()) return S1Angle::Infinity();
@@ -27,6 +27,7 @@
 #include <type_traits>
 
 #include "absl/log/absl_check.h"
+#include "absl/types/span.h"
 #include "s2/_fp_contract_off.h"  // IWYU pragma: keep
 #include "s2/s1angle.h"
 #include "s2/s2point.h"
@@ -136,6 +137,22 @@ class S1ChordAngle {
   // given points.  The points must be unit length.
   S1ChordAngle(const S2Point& x, const S2Point& y);
 
+  // Batch versions of the constructor above.  The first version computes the
+  // angle between "x" and each point of "y", while the second computes the
+  // angle between every point of "x" and every point of "y" (storing the
+  // results in row-major order, i.e. result[i * y.size() + j] is the angle
+  // between x[i] and y[j]).  The results are identical to constructing each
+  // S1ChordAngle individually, but these functions are faster when many
+  // distances are needed (e.g., to rank candidate points by distance).
+  //
+  // REQUIRES: result.size() == y.size() (first version) or
+  //           result.size() == x.size() * y.size() (second version).
+  static void FromPoints(const S2Point& x, absl::Span<const S2Point> y,
+                         absl::Span<S1ChordAngle> result);
+  static void FromPoints(absl::Span<const S2Point> x,
+                         absl::Span<const S2Point> y,
+                         absl::Span<S1ChordAngle> result);
+
   // Return the zero chord angle.
   static constexpr S1ChordAngle Zero();
 
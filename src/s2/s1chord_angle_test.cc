@@ -18,10 +18,12 @@
 #include <cfloat>
 #include <cmath>
 #include <limits>
+#include <vector>
 
 #include <gtest/gtest.h>
 #include "absl/log/log_streamer.h"
 #include "absl/random/random.h"
+#include "absl/types/span.h"
 #include "s2/s1angle.h"
 #include "s2/s2edge_distances.h"
 #include "s2/s2point.h"
@@ -84,6 +86,29 @@ TEST(S1ChordAngle, TwoPointConstructor) {
   }
 }
 
+TEST(S1ChordAngle, BatchFromPoints) {
+  absl::BitGen bitgen(S2Testing::MakeTaggedSeedSeq(
+      "BATCH_FROM_POINTS",
+      absl::LogInfoStreamer(__FILE__, __LINE__).stream()));
+  std::vector<S2Point> x, y;
+  for (int i = 0; i < 5; ++i) x.push_back(s2random::Point(bitgen));
+  for (int i = 0; i < 37; ++i) y.push_back(s2random::Point(bitgen));
+  y.push_back(-x[0]);  // Antipodal, which must be clamped to Straight().
+
+  std::vector<S1ChordAngle> row(y.size());
+  S1ChordAngle::FromPoints(x[0], y, absl::MakeSpan(row));
+  for (size_t j = 0; j < y.size(); ++j) {
+    EXPECT_EQ(row[j], S1ChordAngle(x[0], y[j]));
+  }
+  std::vector<S1ChordAngle> matrix(x.size() * y.size());
+  S1ChordAngle::FromPoints(x, y, absl::MakeSpan(matrix));
+  for (size_t i = 0; i < x.size(); ++i) {
+    for (size_t j = 0; j < y.size(); ++j) {
+      EXPECT_EQ(matrix[i * y.size() + j], S1ChordAngle(x[i], y[j]));
+    }
+  }
+}
+
 TEST(S1ChordAngle, FromLength2) {
   EXPECT_EQ(0, S1ChordAngle::FromLength2(0).degrees());
   EXPECT_DOUBLE_EQ(60, S1ChordAngle::FromLength2(1).degrees());
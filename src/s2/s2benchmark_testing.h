@@ -0,0 +1,249 @@
+// Copyright 2024 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+// Fixtures shared by the *_benchmark.cc files that make up the s2_benchmarks
+// target.  All geometry is generated from fixed seeds so that results are
+// comparable across runs and library versions.
+
+#ifndef S2_S2BENCHMARK_TESTING_H_
+#define S2_S2BENCHMARK_TESTING_H_
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+#include "absl/log/absl_check.h"
+#include "absl/random/bit_gen_ref.h"
+#include "absl/random/random.h"
+#include "s2/mutable_s2shape_index.h"
+#include "s2/s1angle.h"
+#include "s2/s2cap.h"
+#include "s2/s2fractal.h"
+#include "s2/s2lax_polygon_shape.h"
+#include "s2/s2loop.h"
+#include "s2/s2point.h"
+#include "s2/s2random.h"
+#include "s2/s2testing.h"
+#include "s2/s2text_format.h"
+
+namespace s2benchmark {
+
+// The seed used for all benchmark geometry.
+inline constexpr uint64_t kSeed = 0x5eed5eed;
+
+// The nominal radius of fractal loops, and of the region in which query
+// points are sampled.
+inline S1Angle FractalRadius() { return S2Testing::KmToAngle(100); }
+
+// Registers the standard geometry sizes (measured in edges) used to track
+// how each operation scales: 3 * 4**n for n = 3, 5, 7, 9.
+inline void EdgeCounts(benchmark::internal::Benchmark* b) {
+  for (int num_edges : {192, 3072, 49152, 786432}) b->Arg(num_edges);
+}
+
+// Returns a fractal loop with approximately "num_edges" edges, centered
+// around a random point with the radius above.
+inline std::unique_ptr<S2Loop> MakeFractalLoop(absl::BitGenRef bitgen,
+                                               int num_edges) {
+  S2Fractal fractal(bitgen);
+  fractal.SetLevelForApproxMaxEdges(num_edges);
+  return fractal.MakeLoop(s2random::Frame(bitgen), FractalRadius());
+}
+
+// Returns an index containing a single fractal loop with approximately
+// "num_edges" edges.  The index is fully built.
+inline std::unique_ptr<MutableS2ShapeIndex> MakeFractalIndex(int num_edges) {
+  std::mt19937_64 bitgen(kSeed);
+  auto index = std::make_unique<MutableS2ShapeIndex>();
+  index->Add(std::make_unique<S2Loop::OwningShape>(
+      MakeFractalLoop(bitgen, num_edges)));
+  index->ForceBuild();
+  return index;
+}
+
+// Returns "n" query points sampled uniformly from a cap slightly larger than
+// the fractals above, so that some points are inside and some are outside.
+inline std::vector<S2Point> MakeQueryPoints(const MutableS2ShapeIndex& index,
+                                            int n) {
+  std::mt19937_64 bitgen(kSeed + 1);
+  const S2Loop& loop = *static_cast<const S2Loop::Shape*>(index.shape(0))
+                            ->loop();
+  S2Cap cap(loop.GetCapBound().center(), 1.5 * FractalRadius());
+  std::vector<S2Point> points;
+  for (int i = 0; i < n; ++i) {
+    points.push_back(s2random::SamplePoint(bitgen, cap));
+  }
+  return points;
+}
+
+// Real-world geographic data is strongly clustered: a few cities contain
+// most of the points of interest or building footprints, and density falls
+// off roughly as a power law.  Such data exercises the index very differently
+// from uniformly random points (e.g., deep index cells and long tails in
+// query latency).  The following functions generate synthetic workloads of
+// this kind from "num_clusters" caps whose weights follow Zipf's law and
+// whose radii vary from 0.5 km to 20 km.  All clusters are located within
+// 1000 km of a fixed random point.
+struct Cluster {
+  S2Cap cap;
+  double weight;
+};
+
+inline std::vector<Cluster> MakeClusters(int num_clusters) {
+  std::mt19937_64 bitgen(kSeed + 2);
+  const S2Cap region(s2random::Point(bitgen), S2Testing::KmToAngle(1000));
+  std::vector<Cluster> clusters;
+  for (int i = 0; i < num_clusters; ++i) {
+    double radius_km = 0.5 * std::pow(40.0, absl::Uniform(bitgen, 0.0, 1.0));
+    clusters.push_back({S2Cap(s2random::SamplePoint(bitgen, region),
+                              S2Testing::KmToAngle(radius_km)),
+                        1.0 / (i + 1)});
+  }
+  return clusters;
+}
+
+// Returns "n" points sampled from the given clusters in proportion to their
+// weights.  Different seeds yield independent samples (e.g., for the indexed
+// points and the query points).
+inline std::vector<S2Point> MakeClusteredPoints(
+    const std::vector<Cluster>& clusters, int n, uint64_t seed) {
+  std::mt19937_64 bitgen(seed);
+  std::vector<double> weights;
+  for (const Cluster& cluster : clusters) weights.push_back(cluster.weight);
+  std::discrete_distribution<int> choose(weights.begin(), weights.end());
+  std::vector<S2Point> points;
+  points.reserve(n);
+  for (int i = 0; i < n; ++i) {
+    const S2Cap& cap = clusters[choose(bitgen)].cap;
+    points.push_back(s2random::SamplePoint(bitgen, cap));
+  }
+  return points;
+}
+
+// Returns a fully built index containing one small regular polygon (5 to 100
+// meters in radius, with 4 to 32 vertices) centered at each given point,
+// similar to a layer of building footprints.
+inline std::unique_ptr<MutableS2ShapeIndex> MakeFootprintIndex(
+    const std::vector<S2Point>& centers) {
+  std::mt19937_64 bitgen(kSeed + 3);
+  auto index = std::make_unique<MutableS2ShapeIndex>();
+  for (const S2Point& center : centers) {
+    S1Angle radius = S2Testing::KmToAngle(
+        0.005 * std::pow(20.0, absl::Uniform(bitgen, 0.0, 1.0)));
+    int num_vertices = absl::Uniform(absl::IntervalClosed, bitgen, 4, 32);
+    index->Add(std::make_unique<S2Loop::OwningShape>(
+        S2Loop::MakeRegularLoop(center, radius, num_vertices)));
+  }
+  index->ForceBuild();
+  return index;
+}
+
+// Reads an external dataset containing one point per line in the format
+// accepted by s2textformat::MakePoint (e.g. "37.78:-122.41").  Blank lines
+// are ignored.  ABSL_CHECK-fails if the file cannot be read or parsed.
+inline std::vector<S2Point> LoadPoints(const std::string& path) {
+  std::ifstream input(path);
+  ABSL_CHECK(input) << "Cannot open " << path;
+  std::vector<S2Point> points;
+  std::string line;
+  while (std::getline(input, line)) {
+    if (line.empty()) continue;
+    S2Point point;
+    ABSL_CHECK(s2textformat::MakePoint(line, &point)) << path << ": " << line;
+    points.push_back(point);
+  }
+  return points;
+}
+
+// Reads an external dataset containing one polygon per line in the format
+// accepted by s2textformat::MakeLaxPolygon (e.g. "0:0, 0:1, 1:0; 5:5, ...")
+// and returns a fully built index containing those polygons.  Blank lines
+// are ignored.  ABSL_CHECK-fails if the file cannot be read or parsed.
+inline std::unique_ptr<MutableS2ShapeIndex> LoadPolygonIndex(
+    const std::string& path) {
+  std::ifstream input(path);
+  ABSL_CHECK(input) << "Cannot open " << path;
+  auto index = std::make_unique<MutableS2ShapeIndex>();
+  std::string line;
+  while (std::getline(input, line)) {
+    if (line.empty()) continue;
+    std::unique_ptr<S2LaxPolygonShape> polygon;
+    ABSL_CHECK(s2textformat::MakeLaxPolygon(line, &polygon))
+        << path << ": " << line;
+    index->Add(std::move(polygon));
+  }
+  index->ForceBuild();
+  return index;
+}
+
+// Records the latency of individual operations so that benchmarks can
+// report tail latencies, which are hidden by the mean time per iteration.
+// Example usage:
+//
+//   LatencyRecorder recorder(state);
+//   for (auto _ : state) {
+//     recorder.Time([&]() { benchmark::DoNotOptimize(query.Contains(p)); });
+//   }
+//   recorder.Report();
+//
+// Report() adds the counters "p50_ns", "p99_ns", and "p999_ns" (averaged
+// over the benchmark threads) and sets the number of items processed, so
+// that the reported throughput is the number of operations per second
+// summed over all threads.
+class LatencyRecorder {
+ public:
+  explicit LatencyRecorder(benchmark::State& state) : state_(state) {}
+
+  template <class Op>
+  void Time(Op&& op) {
+    auto start = std::chrono::steady_clock::now();
+    op();
+    auto end = std::chrono::steady_clock::now();
+    latencies_.push_back(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(end - start)
+            .count());
+  }
+
+  void Report() {
+    state_.SetItemsProcessed(latencies_.size());
+    if (latencies_.empty()) return;
+    const std::pair<const char*, double> kPercentiles[] = {
+        {"p50_ns", 0.5}, {"p99_ns", 0.99}, {"p999_ns", 0.999}};
+    for (const auto& [name, quantile] : kPercentiles) {
+      auto nth = latencies_.begin() +
+                 std::min<size_t>(quantile * latencies_.size(),
+                                  latencies_.size() - 1);
+      std::nth_element(latencies_.begin(), nth, latencies_.end());
+      state_.counters[name] =
+          benchmark::Counter(*nth, benchmark::Counter::kAvgThreads);
+    }
+  }
+
+ private:
+  benchmark::State& state_;
+  std::vector<int64_t> latencies_;
+};
+
+}  // namespace s2benchmark
+
+#endif  // S2_S2BENCHMARK_TESTING_H_
@@ -89,6 +89,7 @@
 #include "s2/s2builder.h"
 #include "s2/s2builder_graph.h"
 #include "s2/s2builder_layer.h"
+#include "s2/s2builder_tracer.h"
 #include "s2/s2builderutil_snap_functions.h"
 #include "s2/s2cell_id.h"
 #include "s2/s2contains_point_query.h"
@@ -102,6 +103,7 @@
 #include "s2/s2shape.h"
 #include "s2/s2shape_index.h"
 #include "s2/s2shape_index_measures.h"
+#include "s2/s2shapeutil_count_edges.h"
 #include "s2/s2shapeutil_shape_edge.h"
 #include "s2/s2shapeutil_shape_edge_id.h"
 #include "s2/s2shapeutil_visit_crossing_edge_pairs.h"
@@ -963,8 +965,11 @@ class S2BooleanOperation::Impl {
                             S2ContainsPointQuery<S2ShapeIndex>* query,
                             CrossingProcessor* cp);
   static bool HasInterior(const S2ShapeIndex& index);
+  static IndexCrossing MakeIndexCrossing(const ShapeEdge& a,
+                                         const ShapeEdge& b, bool is_interior);
   bool AddIndexCrossing(const ShapeEdge& a, const ShapeEdge& b,
                         bool is_interior, IndexCrossings* crossings);
+  bool AddIndexCrossingsParallel(int num_threads);
   bool InitIndexCrossings(int region_id);
   bool AddBoundaryPair(bool invert_a, bool invert_b, bool invert_result,
                        CrossingProcessor* cp);
@@ -2197,30 +2202,84 @@ bool S2BooleanOperation::Impl::HasInterior(const S2ShapeIndex& index) {
   return false;
 }
 
-inline bool S2BooleanOperation::Impl::AddIndexCrossing(
-    const ShapeEdge& a, const ShapeEdge& b, bool is_interior,
-    IndexCrossings* crossings) {
-  if (!tracker_.AddSpace(crossings, 1)) return false;
-  crossings->push_back(IndexCrossing(a.id(), b.id()));
-  IndexCrossing* crossing = &crossings->back();
+inline S2BooleanOperation::Impl::IndexCrossing
+S2BooleanOperation::Impl::MakeIndexCrossing(const ShapeEdge& a,
+                                            const ShapeEdge& b,
+                                            bool is_interior) {
+  IndexCrossing crossing(a.id(), b.id());
   if (is_interior) {
-    crossing->is_interior_crossing = true;
+    crossing.is_interior_crossing = true;
     if (s2pred::Sign(a.v0(), a.v1(), b.v0()) > 0) {
-      crossing->left_to_right = true;
+      crossing.left_to_right = true;
     }
-    builder_->AddIntersection(
-        S2::GetIntersection(a.v0(), a.v1(), b.v0(), b.v1()));
   } else {
     // TODO(ericv): This field isn't used unless one shape is a polygon and
     // the other is a polyline or polygon, but we don't have the shape
     // dimension information readily available here.
     if (S2::VertexCrossing(a.v0(), a.v1(), b.v0(), b.v1())) {
-      crossing->is_vertex_crossing = true;
+      crossing.is_vertex_crossing = true;
     }
   }
+  return crossing;
+}
+
+inline bool S2BooleanOperation::Impl::AddIndexCrossing(
+    const ShapeEdge& a, const ShapeEdge& b, bool is_interior,
+    IndexCrossings* crossings) {
+  if (!tracker_.AddSpace(crossings, 1)) return false;
+  crossings->push_back(MakeIndexCrossing(a, b, is_interior));
+  if (is_interior) {
+    builder_->AddIntersection(
+        S2::GetIntersection(a.v0(), a.v1(), b.v0(), b.v1()));
+  }
   return true;  // Continue visiting.
 }
 
+// Like the serial loop in InitIndexCrossings(), except that the S2CellId
+// space is divided into shards whose crossings are found concurrently.  The
+// crossings and intersection points of each shard are buffered separately
+// and then appended in shard order, which yields exactly the same
+// index_crossings_ and S2Builder input as visiting the crossings serially.
+//
+// The per-shard buffers are not counted by the memory tracker until they
+// are merged, so the peak memory usage may briefly exceed its limit.
+bool S2BooleanOperation::Impl::AddIndexCrossingsParallel(int num_threads) {
+  // Use several shards per thread so that shards containing many crossings
+  // are balanced automatically.
+  static constexpr int kShardsPerThread = 4;
+  struct Shard {
+    IndexCrossings crossings;
+    vector<S2Point> intersections;
+  };
+  vector<Shard> shards(kShardsPerThread * num_threads);
+  if (!s2shapeutil::VisitCrossingEdgePairs(
+          *op_->regions_[0], *op_->regions_[1],
+          s2shapeutil::CrossingType::ALL, shards.size(), num_threads,
+          [this, &shards](int shard, const ShapeEdge& a, const ShapeEdge& b,
+                          bool is_interior) {
+            if (is_interior && is_boolean_output()) return false;
+            shards[shard].crossings.push_back(
+                MakeIndexCrossing(a, b, is_interior));
+            if (is_interior) {
+              shards[shard].intersections.push_back(
+                  S2::GetIntersection(a.v0(), a.v1(), b.v0(), b.v1()));
+            }
+            return true;
+          })) {
+    return false;
+  }
+  for (Shard& shard : shards) {
+    if (!tracker_.AddSpace(&index_crossings_, shard.crossings.size())) {
+      return false;
+    }
+    index_crossings_.insert(index_crossings_.end(), shard.crossings.begin(),
+                            shard.crossings.end());
+    for (const S2Point& p : shard.intersections) builder_->AddIntersection(p);
+    shard = Shard();  // Release memory as we go.
+  }
+  return true;
+}
+
 // Initialize index_crossings_ to the set of crossing edge pairs such that the
 // first element of each pair is an edge from "region_id".
 //
@@ -2233,16 +2292,23 @@ bool S2BooleanOperation::Impl::InitIndexCrossings(int region_id) {
     // TODO(ericv): This would be more efficient if VisitCrossingEdgePairs()
     // returned the sign (+1 or -1) of the interior crossing, i.e.
     // "int interior_crossing_sign" rather than "bool is_interior".
-    if (!s2shapeutil::VisitCrossingEdgePairs(
-            *op_->regions_[0], *op_->regions_[1],
-            s2shapeutil::CrossingType::ALL,
-            [this](const ShapeEdge& a, const ShapeEdge& b, bool is_interior) {
-              // For all supported operations (union, intersection, and
-              // difference), if the input edges have an interior crossing
-              // then the output is guaranteed to have at least one edge.
-              if (is_interior && is_boolean_output()) return false;
-              return AddIndexCrossing(a, b, is_interior, &index_crossings_);
-            })) {
+    if (op_->options_.num_threads() > 1) {
+      if (!AddIndexCrossingsParallel(op_->options_.num_threads())) {
+        return false;
+      }
+    } else if (!s2shapeutil::VisitCrossingEdgePairs(
+                   *op_->regions_[0], *op_->regions_[1],
+                   s2shapeutil::CrossingType::ALL,
+                   [this](const ShapeEdge& a, const ShapeEdge& b,
+                          bool is_interior) {
+                     // For all supported operations (union, intersection,
+                     // and difference), if the input edges have an interior
+                     // crossing then the output is guaranteed to have at
+                     // least one edge.
+                     if (is_interior && is_boolean_output()) return false;
+                     return AddIndexCrossing(a, b, is_interior,
+                                             &index_crossings_);
+                   })) {
       return false;
     }
     if (index_crossings_.size() > 1) {
@@ -2269,6 +2335,35 @@ bool S2BooleanOperation::Impl::InitIndexCrossings(int region_id) {
   return tracker_.ok();
 }
 
+// Positions "it" at the first index cell that intersects "target" or follows
+// it.  (Note that Seek(target.range_min()) may skip over a cell that contains
+// "target".)
+static void SeekToIntersecting(S2CellId target, S2ShapeIndex::Iterator* it) {
+  it->Seek(target.range_min());
+  if (it->Prev() && it->id().range_max() < target.range_min()) it->Next();
+}
+
+// Returns true if any index cell of "a" intersects any index cell of "b".
+// Since the index cells of each region cover its geometry, the two regions
+// are disjoint when this function returns false.  The cells are visited in
+// merged order, seeking past runs of cells that cannot intersect the other
+// index, so the cost is usually much smaller than the number of cells.
+static bool IndexCellsIntersect(const S2ShapeIndex& a,
+                                const S2ShapeIndex& b) {
+  S2ShapeIndex::Iterator ai(&a, S2ShapeIndex::BEGIN);
+  S2ShapeIndex::Iterator bi(&b, S2ShapeIndex::BEGIN);
+  while (!ai.done() && !bi.done()) {
+    if (ai.id().range_max() < bi.id().range_min()) {
+      SeekToIntersecting(bi.id(), &ai);
+    } else if (bi.id().range_max() < ai.id().range_min()) {
+      SeekToIntersecting(ai.id(), &bi);
+    } else {
+      return true;
+    }
+  }
+  return false;
+}
+
 // Supports "early exit" in the case of boolean results by returning false
 // as soon as the result is known to be non-empty.
 bool S2BooleanOperation::Impl::AddBoundaryPair(
@@ -2280,6 +2375,14 @@ bool S2BooleanOperation::Impl::AddBoundaryPair(
   if (type == OpType::DIFFERENCE || type == OpType::SYMMETRIC_DIFFERENCE) {
     if (AreRegionsIdentical()) return true;
   } else if (is_boolean_output()) {
+    // If no index cell of A intersects an index cell of B then the regions
+    // are disjoint and their intersection is empty.  This is much cheaper
+    // than computing chain starts and crossings, and handles the common case
+    // of testing whether two distant regions intersect.
+    if (type == OpType::INTERSECTION &&
+        !IndexCellsIntersect(*op_->regions_[0], *op_->regions_[1])) {
+      return true;
+    }
     // TODO(ericv): When boolean output is requested there are other quick
     // checks that could be done here, such as checking whether a full cell from
     // one S2ShapeIndex intersects a non-empty cell of the other S2ShapeIndex.
@@ -2588,6 +2691,7 @@ void S2BooleanOperation::Impl::DoBuild(S2Error* error) {
   builder_options_ = S2Builder::Options(op_->options_.snap_function());
   builder_options_.set_intersection_tolerance(S2::kIntersectionError);
   builder_options_.set_memory_tracker(tracker_.tracker());
+  builder_options_.set_tracer(op_->options_.tracer());
   if (op_->options_.split_all_crossing_polyline_edges()) {
     builder_options_.set_split_crossing_edges(true);
   }
@@ -2595,8 +2699,16 @@ void S2BooleanOperation::Impl::DoBuild(S2Error* error) {
   // expect vertices closer than the full "snap_radius" to be snapped.
   builder_options_.set_idempotent(false);
 
+  S2BuilderTracer::Counts counts;
+  if (op_->options_.tracer() != nullptr) {
+    counts.num_input_edges = s2shapeutil::CountEdges(*op_->regions_[0]) +
+                             s2shapeutil::CountEdges(*op_->regions_[1]);
+  }
   if (is_boolean_output()) {
     // BuildOpType() returns true if and only if the result has no edges.
+    S2BuilderTracer::ScopedPhase trace(
+        op_->options_.tracer(), S2BuilderTracer::Phase::BOOLEAN_OPERATION,
+        counts);
     S2Builder::Graph g;  // Unused by IsFullPolygonResult() implementation.
     *op_->result_empty_ =
         BuildOpType(op_->op_type_) && !IsFullPolygonResult(g, error);
@@ -2612,7 +2724,12 @@ void S2BooleanOperation::Impl::DoBuild(S2Error* error) {
       [this](const S2Builder::Graph& g, S2Error* error) {
         return IsFullPolygonResult(g, error);
       });
-  (void) BuildOpType(op_->op_type_);
+  {
+    S2BuilderTracer::ScopedPhase trace(
+        op_->options_.tracer(), S2BuilderTracer::Phase::BOOLEAN_OPERATION,
+        counts);
+    (void) BuildOpType(op_->op_type_);
+  }
 
   // Release memory that is no longer needed.
   if (!tracker_.Clear(&index_crossings_)) return;
@@ -2646,7 +2763,9 @@ S2BooleanOperation::Options::Options(const Options& options)
       precision_(options.precision_),
       conservative_output_(options.conservative_output_),
       source_id_lexicon_(options.source_id_lexicon_),
-      memory_tracker_(options.memory_tracker_) {
+      memory_tracker_(options.memory_tracker_),
+      num_threads_(options.num_threads_),
+      tracer_(options.tracer_) {
 }
 
 S2BooleanOperation::Options& S2BooleanOperation::Options::operator=(
@@ -2661,6 +2780,8 @@ S2BooleanOperation::Options& S2BooleanOperation::Options::operator=(
   conservative_output_ = options.conservative_output_;
   source_id_lexicon_ = options.source_id_lexicon_;
   memory_tracker_ = options.memory_tracker_;
+  num_threads_ = options.num_threads_;
+  tracer_ = options.tracer_;
   return *this;
 }
 
@@ -2728,6 +2849,23 @@ void S2BooleanOperation::Options::set_memory_tracker(S2MemoryTracker* tracker) {
   memory_tracker_ = tracker;
 }
 
+int S2BooleanOperation::Options::num_threads() const {
+  return num_threads_;
+}
+
+void S2BooleanOperation::Options::set_num_threads(int num_threads) {
+  ABSL_DCHECK_GE(num_threads, 1);
+  num_threads_ = max(1, num_threads);
+}
+
+S2BuilderTracer* S2BooleanOperation::Options::tracer() const {
+  return tracer_;
+}
+
+void S2BooleanOperation::Options::set_tracer(S2BuilderTracer* tracer) {
+  tracer_ = tracer;
+}
+
 string_view S2BooleanOperation::OpTypeToString(OpType op_type) {
   switch (op_type) {
     case OpType::UNION:                return "UNION";
@@ -27,6 +27,7 @@
 #include "s2/s2builder.h"
 #include "s2/s2builder_graph.h"
 #include "s2/s2builder_layer.h"
+#include "s2/s2builder_tracer.h"
 #include "s2/s2error.h"
 #include "s2/s2memory_tracker.h"
 #include "s2/s2shape_index.h"
@@ -439,6 +440,30 @@ class S2BooleanOperation {
     S2MemoryTracker* memory_tracker() const;
     void set_memory_tracker(S2MemoryTracker* tracker);
 
+    // The maximum number of threads (including the calling thread) that may
+    // be used to find the edge crossings between the two input regions.
+    // When this value is greater than one the S2CellId space is divided into
+    // shards containing roughly equal numbers of index edges, and the shards
+    // are processed concurrently.  The crossings of each shard are then
+    // merged in S2CellId order, so the output is identical to the output
+    // computed by a single thread.
+    //
+    // Note that only crossing discovery is parallelized; snapping the
+    // result using S2Builder is always done by the calling thread.  This
+    // option is most useful for large inputs with many edges.
+    //
+    // DEFAULT: 1
+    int num_threads() const;
+    void set_num_threads(int num_threads);
+
+    // Specifies an object that is notified at the start and end of each
+    // phase of Build(), including the phases of the S2Builder used to snap
+    // the result (see s2builder_tracer.h).
+    //
+    // DEFAULT: nullptr (tracing disabled)
+    S2BuilderTracer* tracer() const;
+    void set_tracer(S2BuilderTracer* tracer);
+
     // Options may be assigned and copied.
     Options(const Options& options);
     Options& operator=(const Options& options);
@@ -453,6 +478,8 @@ class S2BooleanOperation {
     bool conservative_output_ = false;
     ValueLexicon<SourceId>* source_id_lexicon_ = nullptr;
     S2MemoryTracker* memory_tracker_ = nullptr;
+    int num_threads_ = 1;
+    S2BuilderTracer* tracer_ = nullptr;
   };
 
 #ifndef SWIG
@@ -0,0 +1,102 @@
+// Copyright 2024 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "s2/s2boolean_operation.h"
+
+#include <memory>
+#include <random>
+
+#include <benchmark/benchmark.h>
+#include "absl/log/absl_check.h"
+#include "s2/mutable_s2shape_index.h"
+#include "s2/s2benchmark_testing.h"
+#include "s2/s2builderutil_lax_polygon_layer.h"
+#include "s2/s2error.h"
+#include "s2/s2fractal.h"
+#include "s2/s2lax_polygon_shape.h"
+#include "s2/s2loop.h"
+#include "s2/s2point.h"
+#include "s2/s2random.h"
+
+using std::make_unique;
+
+namespace {
+
+using s2benchmark::kSeed;
+
+// Builds two fractal loops with the given number of edges that share the
+// same center but are rotated relative to each other, so that their
+// boundaries cross many times.
+void MakeOverlappingFractals(int num_edges, MutableS2ShapeIndex* a,
+                             MutableS2ShapeIndex* b) {
+  std::mt19937_64 bitgen(kSeed);
+  S2Fractal fractal(bitgen);
+  fractal.SetLevelForApproxMaxEdges(num_edges);
+  const S2Point center = s2random::Point(bitgen);
+  for (MutableS2ShapeIndex* index : {a, b}) {
+    index->Add(make_unique<S2Loop::OwningShape>(fractal.MakeLoop(
+        s2random::FrameAt(bitgen, center), s2benchmark::FractalRadius())));
+    index->ForceBuild();
+  }
+}
+
+void BenchmarkOperation(benchmark::State& state,
+                        S2BooleanOperation::OpType op_type,
+                        int num_threads = 1) {
+  MutableS2ShapeIndex a, b;
+  MakeOverlappingFractals(state.range(0), &a, &b);
+  S2BooleanOperation::Options options;
+  options.set_num_threads(num_threads);
+  for (auto _ : state) {
+    S2LaxPolygonShape result;
+    S2BooleanOperation op(
+        op_type, make_unique<s2builderutil::LaxPolygonLayer>(&result),
+        options);
+    S2Error error;
+    ABSL_CHECK(op.Build(a, b, &error)) << error;
+    benchmark::DoNotOptimize(result);
+  }
+}
+
+void BM_S2BooleanOperationUnion(benchmark::State& state) {
+  BenchmarkOperation(state, S2BooleanOperation::OpType::UNION);
+}
+BENCHMARK(BM_S2BooleanOperationUnion)->Apply(s2benchmark::EdgeCounts);
+
+// Like the above, but finds the edge crossings using multiple threads.
+void BM_S2BooleanOperationUnionParallel(benchmark::State& state) {
+  BenchmarkOperation(state, S2BooleanOperation::OpType::UNION,
+                     state.range(1));
+}
+BENCHMARK(BM_S2BooleanOperationUnionParallel)
+    ->ArgsProduct({{49152, 786432}, {2, 4, 8}});
+
+void BM_S2BooleanOperationIntersection(benchmark::State& state) {
+  BenchmarkOperation(state, S2BooleanOperation::OpType::INTERSECTION);
+}
+BENCHMARK(BM_S2BooleanOperationIntersection)->Apply(s2benchmark::EdgeCounts);
+
+// Measures the boolean predicate Intersects(), which can often terminate
+// early.
+void BM_S2BooleanOperationIntersects(benchmark::State& state) {
+  MutableS2ShapeIndex a, b;
+  MakeOverlappingFractals(state.range(0), &a, &b);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(S2BooleanOperation::Intersects(a, b));
+  }
+}
+BENCHMARK(BM_S2BooleanOperationIntersects)->Apply(s2benchmark::EdgeCounts);
+
+}  // namespace
@@ -45,12 +45,14 @@
 #include "s2/s2builder_graph.h"
 #include "s2/s2builder_layer.h"
 #include "s2/s2builderutil_lax_polygon_layer.h"
+#include "s2/s2builderutil_s2polygon_layer.h"
 #include "s2/s2builderutil_s2point_vector_layer.h"
 #include "s2/s2builderutil_s2polyline_vector_layer.h"
 #include "s2/s2builderutil_snap_functions.h"
 #include "s2/s2builderutil_testing.h"
 #include "s2/s2edge_crossings.h"
 #include "s2/s2error.h"
+#include "s2/s2fractal.h"
 #include "s2/s2latlng.h"
 #include "s2/s2lax_polygon_shape.h"
 #include "s2/s2lax_polyline_shape.h"
@@ -2302,6 +2304,30 @@ TEST(S2BooleanOperation, IntersectsEmptyAndFull) {
   EXPECT_TRUE(S2BooleanOperation::Intersects(*full, *full));
 }
 
+// Tests Intersects() on geometry whose index cells are disjoint, touch, or
+// overlap without the geometry itself intersecting.
+TEST(S2BooleanOperation, IntersectsDistantGeometry) {
+  auto a = s2textformat::MakeIndexOrDie("0:0 # 0:0, 0:1 # 0:0, 0:1, 1:0");
+  auto distant = s2textformat::MakeIndexOrDie(
+      "40:40 # 40:40, 40:41 # 40:40, 40:41, 41:40");
+  auto nearby = s2textformat::MakeIndexOrDie("# 0.6:0.6, 0.6:0.7 #");
+  EXPECT_FALSE(S2BooleanOperation::Intersects(*a, *distant));
+  EXPECT_FALSE(S2BooleanOperation::Intersects(*distant, *a));
+  EXPECT_FALSE(S2BooleanOperation::Intersects(*a, *nearby));
+  EXPECT_TRUE(S2BooleanOperation::Intersects(*a, *a));
+
+  // Polygons that touch at a single vertex intersect only if the polygon
+  // model includes their boundaries.
+  auto poly_a = s2textformat::MakeIndexOrDie("# # 0:0, 0:1, 1:0");
+  auto touching = s2textformat::MakeIndexOrDie("# # 0:1, 0:2, 1:1");
+  S2BooleanOperation::Options options;
+  options.set_polygon_model(S2BooleanOperation::PolygonModel::OPEN);
+  EXPECT_FALSE(S2BooleanOperation::Intersects(*poly_a, *touching, options));
+  options.set_polygon_model(S2BooleanOperation::PolygonModel::CLOSED);
+  EXPECT_TRUE(S2BooleanOperation::Intersects(*poly_a, *touching, options));
+  EXPECT_TRUE(S2BooleanOperation::Intersects(*touching, *poly_a, options));
+}
+
 TEST(S2BooleanOperation, OptionsFieldsCopied) {
   S2BooleanOperation::Options options;
 
@@ -2319,6 +2345,55 @@ TEST(S2BooleanOperation, OptionsFieldsCopied) {
   EXPECT_TRUE(boundary_op.options().polyline_loops_have_boundaries());
 }
 
+// Returns the result of the given operation on two overlapping fractal
+// polygons using the given number of threads.
+static unique_ptr<S2Polygon> FractalOperation(
+    S2BooleanOperation::OpType op_type, int num_threads) {
+  absl::BitGen bitgen(S2Testing::MakeTaggedSeedSeq(
+      "FRACTAL_OPERATION", absl::LogInfoStreamer(__FILE__, __LINE__).stream()));
+  S2Fractal fractal(bitgen);
+  fractal.SetLevelForApproxMaxEdges(3000);
+  const Matrix3x3_d frame = s2random::Frame(bitgen);
+  S2Polygon a(fractal.MakeLoop(frame, S1Angle::Degrees(1)));
+  S2Polygon b(fractal.MakeLoop(frame, S1Angle::Degrees(1.1)));
+  S2BooleanOperation::Options options;
+  options.set_num_threads(num_threads);
+  auto result = make_unique<S2Polygon>();
+  S2BooleanOperation op(
+      op_type, make_unique<s2builderutil::S2PolygonLayer>(result.get()),
+      options);
+  S2Error error;
+  EXPECT_TRUE(op.Build(a.index(), b.index(), &error)) << error;
+  return result;
+}
+
+TEST(S2BooleanOperation, MultiThreadedMatchesSingleThreaded) {
+  for (auto op_type : {S2BooleanOperation::OpType::UNION,
+                       S2BooleanOperation::OpType::INTERSECTION,
+                       S2BooleanOperation::OpType::DIFFERENCE}) {
+    auto expected = FractalOperation(op_type, 1);
+    ASSERT_GT(expected->num_vertices(), 100);
+    for (int num_threads : {2, 8}) {
+      auto actual = FractalOperation(op_type, num_threads);
+      // The output must be identical, including the order of the vertices.
+      EXPECT_TRUE(actual->Equals(*expected))
+          << S2BooleanOperation::OpTypeToString(op_type)
+          << ", num_threads = " << num_threads;
+    }
+  }
+}
+
+TEST(S2BooleanOperation, MultiThreadedBooleanOutput) {
+  auto a = s2textformat::MakeIndexOrDie("# # 0:0, 0:10, 10:10, 10:0");
+  auto b = s2textformat::MakeIndexOrDie("# # 5:5, 5:15, 15:15, 15:5");
+  auto c = s2textformat::MakeIndexOrDie("# # 20:20, 20:30, 30:30, 30:20");
+  S2BooleanOperation::Options options;
+  options.set_num_threads(4);
+  EXPECT_TRUE(S2BooleanOperation::Intersects(*a, *b, options));
+  EXPECT_FALSE(S2BooleanOperation::Intersects(*a, *c, options));
+  EXPECT_FALSE(S2BooleanOperation::Contains(*a, *b, options));
+}
+
 TEST(S2BooleanOperationSourceIdTest, Accessors) {
   // region_id may only be 0 or 1.
   S2BooleanOperation::SourceId id(/*region_id=*/1, /*shape_id=*/2,
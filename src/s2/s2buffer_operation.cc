@@ -50,6 +50,7 @@
 
 #include <algorithm>
 #include <cmath>
+#include <cstddef>
 #include <iterator>
 #include <memory>
 #include <utility>
@@ -57,17 +58,22 @@
 
 #include "absl/log/absl_check.h"
 #include "absl/types/span.h"
+#include "s2/internal/s2parallel.h"
 #include "s2/s1angle.h"
 #include "s2/s1chord_angle.h"
 #include "s2/s2builder.h"
 #include "s2/s2builder_layer.h"
+#include "s2/s2builder_tracer.h"
+#include "s2/s2builderutil_lax_polygon_layer.h"
 #include "s2/s2builderutil_snap_functions.h"
+#include "s2/s2cell_id.h"
 #include "s2/s2contains_point_query.h"
 #include "s2/s2edge_crosser.h"
 #include "s2/s2edge_crossings.h"
 #include "s2/s2edge_distances.h"
 #include "s2/s2error.h"
 #include "s2/s2lax_loop_shape.h"
+#include "s2/s2lax_polygon_shape.h"
 #include "s2/s2memory_tracker.h"
 #include "s2/s2point.h"
 #include "s2/s2point_span.h"
@@ -78,6 +84,7 @@
 #include "s2/s2shape_index.h"
 #include "s2/s2shape_measures.h"
 #include "s2/s2shapeutil_contains_brute_force.h"
+#include "s2/s2shapeutil_count_edges.h"
 #include "s2/s2winding_operation.h"
 #include "s2/util/math/mathutil.h"
 
@@ -141,6 +148,10 @@ static constexpr S1Angle kMinRequestedError = S1Angle::Radians(2 * DBL_ERR);
 static constexpr S1Angle kMaxAbsoluteInterpolationError =
     S2::kGetPointOnLineError + S2::kGetPointOnRayPerpendicularError;
 
+// The minimum number of shapes buffered by each chunk of a parallel
+// AddShapeIndex() operation.  Smaller indexes are buffered by one thread.
+static constexpr int kMinShapesPerChunk = 256;
+
 // TODO(user, b/210097200): Remove when we require c++17 for opensource.
 constexpr double S2BufferOperation::Options::kMinErrorFraction;
 constexpr double S2BufferOperation::Options::kMaxCircleSegments;
@@ -160,7 +171,9 @@ S2BufferOperation::Options::Options(const Options& options)
       end_cap_style_(options.end_cap_style_),
       polyline_side_(options.polyline_side_),
       snap_function_(options.snap_function_->Clone()),
-      memory_tracker_(options.memory_tracker_) {
+      memory_tracker_(options.memory_tracker_),
+      num_threads_(options.num_threads_),
+      tracer_(options.tracer_) {
 }
 
 S2BufferOperation::Options& S2BufferOperation::Options::operator=(
@@ -171,6 +184,8 @@ S2BufferOperation::Options& S2BufferOperation::Options::operator=(
   polyline_side_ = options.polyline_side_;
   snap_function_ = options.snap_function_->Clone();
   memory_tracker_ = options.memory_tracker_;
+  num_threads_ = options.num_threads_;
+  tracer_ = options.tracer_;
   return *this;
 }
 
@@ -276,6 +291,23 @@ void S2BufferOperation::Options::set_memory_tracker(S2MemoryTracker* tracker) {
   memory_tracker_ = tracker;
 }
 
+int S2BufferOperation::Options::num_threads() const {
+  return num_threads_;
+}
+
+void S2BufferOperation::Options::set_num_threads(int num_threads) {
+  ABSL_DCHECK_GE(num_threads, 1);
+  num_threads_ = max(1, num_threads);
+}
+
+S2BuilderTracer* S2BufferOperation::Options::tracer() const {
+  return tracer_;
+}
+
+void S2BufferOperation::Options::set_tracer(S2BuilderTracer* tracer) {
+  tracer_ = tracer;
+}
+
 S2BufferOperation::S2BufferOperation() = default;
 
 S2BufferOperation::S2BufferOperation(unique_ptr<S2Builder::Layer> result_layer,
@@ -290,6 +322,7 @@ void S2BufferOperation::Init(unique_ptr<S2Builder::Layer> result_layer,
   ref_winding_ = 0;
   have_input_start_ = false;
   have_offset_start_ = false;
+  chunk_error_ = S2Error();
   buffer_sign_ = sgn(options_.buffer_radius().radians());
   S1Angle abs_radius = abs(options_.buffer_radius());
   S1Angle requested_error = max(kMinRequestedError,
@@ -336,6 +369,7 @@ void S2BufferOperation::Init(unique_ptr<S2Builder::Layer> result_layer,
   winding_options.set_include_degeneracies(
       buffer_sign_ == 0 && options_.buffer_radius() >= S1Angle::Zero());
   winding_options.set_memory_tracker(options.memory_tracker());
+  winding_options.set_tracer(options.tracer());
   op_.Init(std::move(result_layer), winding_options);
   tracker_.Init(options.memory_tracker());
 }
@@ -749,7 +783,76 @@ void S2BufferOperation::AddShape(const S2Shape& shape) {
   num_polygon_layers_ += (shape.dimension() == 2);
 }
 
+// Buffers the shapes of "index" in spatially coherent chunks using multiple
+// threads, and then adds the loops of each buffered chunk to op_.  This is
+// valid only for positive buffer radii, since then the buffered union of the
+// chunks equals the buffered union of all shapes.
+void S2BufferOperation::AddShapeIndexInParallel(const S2ShapeIndex& index) {
+  struct ShapeKey {
+    S2CellId id;
+    const S2Shape* shape;
+  };
+  vector<ShapeKey> keys;
+  for (const S2Shape* shape : index) {
+    if (shape == nullptr) continue;
+    S2CellId id = S2CellId::None();
+    if (shape->num_edges() > 0) id = S2CellId(shape->edge(0).v0);
+    keys.push_back({id, shape});
+  }
+  std::sort(keys.begin(), keys.end(),
+            [](const ShapeKey& x, const ShapeKey& y) { return x.id < y.id; });
+
+  // Using several chunks per thread evens out the load when the geometry
+  // is unevenly distributed, while keeping the number of chunk boundaries
+  // (whose buffered edges need to be snapped a second time) small.
+  const int num_threads = options_.num_threads();
+  const int num_chunks = static_cast<int>(min<size_t>(
+      4 * num_threads, keys.size() / kMinShapesPerChunk));
+  Options chunk_options = options_;
+  chunk_options.set_memory_tracker(nullptr);
+  chunk_options.set_num_threads(1);
+  chunk_options.set_tracer(nullptr);
+  vector<S2LaxPolygonShape> chunks(num_chunks);
+  vector<S2Error> errors(num_chunks);
+  s2internal::ParallelFor(num_threads, num_chunks, [&](int i) {
+    S2BufferOperation op(
+        make_unique<s2builderutil::LaxPolygonLayer>(&chunks[i]),
+        chunk_options);
+    size_t begin = keys.size() * i / num_chunks;
+    size_t end = keys.size() * (i + 1) / num_chunks;
+    for (size_t j = begin; j < end; ++j) op.AddShape(*keys[j].shape);
+    op.Build(&errors[i]);
+  });
+  for (int i = 0; i < num_chunks; ++i) {
+    if (!errors[i].ok()) {
+      if (chunk_error_.ok()) chunk_error_ = std::move(errors[i]);
+      continue;
+    }
+    const S2LaxPolygonShape& chunk = chunks[i];
+    if (chunk.is_full()) {
+      AddFullPolygon();
+      continue;
+    }
+    for (int c = 0; c < chunk.num_chains(); ++c) {
+      S2::GetChainVertices(chunk, c, &tmp_vertices_);
+      op_.AddLoop(tmp_vertices_);
+    }
+    ref_winding_ += s2shapeutil::ContainsBruteForce(chunk, ref_point_);
+  }
+}
+
 void S2BufferOperation::AddShapeIndex(const S2ShapeIndex& index) {
+  S2BuilderTracer::Counts counts;
+  if (options_.tracer() != nullptr) {
+    counts.num_input_edges = s2shapeutil::CountEdges(index);
+  }
+  S2BuilderTracer::ScopedPhase trace(
+      options_.tracer(), S2BuilderTracer::Phase::BUFFER_OPERATION, counts);
+  if (options_.num_threads() > 1 && buffer_sign_ > 0 &&
+      index.num_shape_ids() >= 2 * kMinShapesPerChunk) {
+    AddShapeIndexInParallel(index);
+    return;
+  }
   int max_dimension = -1;
   for (const S2Shape* shape : index) {
     if (shape == nullptr) continue;
@@ -761,6 +864,10 @@ void S2BufferOperation::AddShapeIndex(const S2ShapeIndex& index) {
 }
 
 bool S2BufferOperation::Build(S2Error* error) {
+  if (!chunk_error_.ok()) {
+    *error = chunk_error_;
+    return false;
+  }
   if (buffer_sign_ < 0 && num_polygon_layers_ > 1) {
     *error = S2Error::FailedPrecondition(
         "Negative buffer radius requires at most one polygon layer");
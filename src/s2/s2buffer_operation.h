@@ -25,6 +25,7 @@
 #include "s2/s1angle.h"
 #include "s2/s1chord_angle.h"
 #include "s2/s2builder.h"
+#include "s2/s2builder_tracer.h"
 #include "s2/s2error.h"
 #include "s2/s2memory_tracker.h"
 #include "s2/s2point.h"
@@ -205,6 +206,33 @@ class S2BufferOperation {
     S2MemoryTracker* memory_tracker() const;
     void set_memory_tracker(S2MemoryTracker* tracker);
 
+    // The maximum number of threads (including the calling thread) that may
+    // be used by AddShapeIndex().  When this value is greater than one and
+    // the buffer radius is positive, the shapes of a large index are sorted
+    // along the S2CellId space-filling curve and split into spatially
+    // coherent chunks.  Each chunk is buffered into a polygon by its own
+    // S2BufferOperation, and the chunk polygons are then combined with the
+    // other input layers by the S2WindingOperation as usual.  Since
+    // buffering distributes over union, the result is the same region as
+    // the one computed by a single thread.  However the output vertices are
+    // snapped twice, so they may differ from the serial output by up to the
+    // snap radius (which is zero for the default snap function except for
+    // the vertices created at edge crossings).
+    //
+    // Memory used by the chunk operations is not tracked by memory_tracker().
+    //
+    // DEFAULT: 1
+    int num_threads() const;
+    void set_num_threads(int num_threads);
+
+    // Specifies an object that is notified at the start and end of each
+    // phase of the operation, including the phases of the S2Builder used to
+    // snap the result (see s2builder_tracer.h).
+    //
+    // DEFAULT: nullptr (tracing disabled)
+    S2BuilderTracer* tracer() const;
+    void set_tracer(S2BuilderTracer* tracer);
+
     // Options may be assigned and copied.
     Options(const Options& options);
     Options& operator=(const Options& options);
@@ -217,6 +245,8 @@ class S2BufferOperation {
     PolylineSide polyline_side_ = PolylineSide::BOTH;
     std::unique_ptr<S2Builder::SnapFunction> snap_function_;
     S2MemoryTracker* memory_tracker_ = nullptr;
+    int num_threads_ = 1;
+    S2BuilderTracer* tracer_ = nullptr;
   };
 
   // Default constructor; requires Init() to be called.
@@ -307,6 +337,7 @@ class S2BufferOperation {
   void AddEndCap(const S2Point& a, const S2Point& b);
   void BufferLoop(S2PointLoopSpan loop);
   void BufferShape(const S2Shape& shape);
+  void AddShapeIndexInParallel(const S2ShapeIndex& index);
 
   Options options_;
 
@@ -353,6 +384,9 @@ class S2BufferOperation {
   // Used internally as a temporary to avoid excessive memory allocation.
   std::vector<S2Point> tmp_vertices_;
 
+  // The first error reported by a chunk of AddShapeIndexInParallel().
+  S2Error chunk_error_;
+
   S2MemoryTracker::Client tracker_;
 };
 
@@ -47,6 +47,7 @@
 #include "s2/s2builder_layer.h"
 #include "s2/s2builderutil_lax_polygon_layer.h"
 #include "s2/s2builderutil_snap_functions.h"
+#include "s2/s2cap.h"
 #include "s2/s2cell_id.h"
 #include "s2/s2closest_edge_query.h"
 #include "s2/s2closest_edge_query_base.h"
@@ -55,6 +56,8 @@
 #include "s2/s2edge_distances.h"
 #include "s2/s2error.h"
 #include "s2/s2fractal.h"
+#include "s2/s2hausdorff_distance_query.h"
+#include "s2/s2shape_measures.h"
 #include "s2/s2lax_loop_shape.h"
 #include "s2/s2lax_polygon_shape.h"
 #include "s2/s2lax_polyline_shape.h"
@@ -711,4 +714,42 @@ TEST(S2BufferOperation, ZigZagPolyline) {
   }
 }
 
+// Checks that buffering a large collection of polylines using multiple
+// threads yields the same region as buffering it using a single thread.
+TEST(S2BufferOperation, ParallelPolylines) {
+  absl::BitGen bitgen(S2Testing::MakeTaggedSeedSeq(
+      "PARALLEL_POLYLINES",
+      absl::LogInfoStreamer(__FILE__, __LINE__).stream()));
+  MutableS2ShapeIndex input;
+  const S2Cap cap(S2Point(1, 0, 0), S1Angle::Degrees(1));
+  for (int i = 0; i < 2000; ++i) {
+    vector<S2Point> vertices;
+    S2Point p = s2random::SamplePoint(bitgen, cap);
+    for (int j = 0; j < 5; ++j) {
+      vertices.push_back(p);
+      p = s2random::SamplePoint(bitgen, S2Cap(p, S1Angle::Degrees(0.02)));
+    }
+    input.Add(make_unique<S2LaxPolylineShape>(vertices));
+  }
+  S2BufferOperation::Options options(S1Angle::Degrees(0.01));
+  auto expected = DoBuffer(
+      [&input](S2BufferOperation* op) { op->AddShapeIndex(input); }, options);
+  options.set_num_threads(4);
+  auto actual = DoBuffer(
+      [&input](S2BufferOperation* op) { op->AddShapeIndex(input); }, options);
+  EXPECT_EQ(actual->num_chains(), expected->num_chains());
+  EXPECT_NEAR(S2::GetArea(*actual), S2::GetArea(*expected), 1e-15);
+
+  // The two boundaries may differ only by the error in the vertices created
+  // at edge crossings (which are snapped a second time).
+  MutableS2ShapeIndex expected_index, actual_index;
+  expected_index.Add(std::move(expected));
+  actual_index.Add(std::move(actual));
+  S2HausdorffDistanceQuery::Options hausdorff_options;
+  hausdorff_options.set_include_interiors(false);
+  EXPECT_LE(S2HausdorffDistanceQuery(hausdorff_options)
+                .GetDistance(&expected_index, &actual_index),
+            S1ChordAngle::Radians(1e-15));
+}
+
 }  // namespace
@@ -69,13 +69,17 @@
 #include "s2/s2builder.h"
 
 #include <algorithm>
+#include <atomic>
 #include <cfloat>
 #include <cmath>
 #include <cstddef>
 #include <cstdint>
 #include <iostream>
 #include <memory>
+#include <memory_resource>
+#include <numeric>
 #include <ostream>
+#include <tuple>
 #include <utility>
 #include <vector>
 
@@ -91,11 +95,13 @@
 #include "s2/base/log_severity.h"
 #include "s2/base/types.h"
 #include "s2/id_set_lexicon.h"
+#include "s2/internal/s2parallel.h"
 #include "s2/mutable_s2shape_index.h"
 #include "s2/s1angle.h"
 #include "s2/s1chord_angle.h"
 #include "s2/s2builder_graph.h"
 #include "s2/s2builder_layer.h"
+#include "s2/s2builder_tracer.h"
 #include "s2/s2builderutil_snap_functions.h"
 #include "s2/s2cell_id.h"
 #include "s2/s2closest_edge_query.h"
@@ -132,6 +138,39 @@ using std::vector;
 // Internal flag intended to be set from within a debugger.
 bool s2builder_verbose = false;
 
+namespace {
+
+// The number of consecutive input vertices or edges processed by each task
+// when a phase of Build() is split across threads.
+constexpr int kParallelTaskSize = 1024;
+
+// Phases that use multiple threads process the input in batches of this size,
+// so that the memory used for their results stays small and the memory
+// tracker is checked regularly.
+constexpr int kParallelBatchSize = 64 * kParallelTaskSize;
+
+// Calls fn(task_begin, task_end) for consecutive subranges of [begin, end)
+// of kParallelTaskSize elements using at most "num_threads" threads.
+template <class Fn>
+void ParallelForRange(int num_threads, int begin, int end, const Fn& fn) {
+  const int num_tasks = (end - begin + kParallelTaskSize - 1) /
+                        kParallelTaskSize;
+  s2internal::ParallelFor(num_threads, num_tasks, [&](int task) {
+    const int task_begin = begin + task * kParallelTaskSize;
+    fn(task_begin, std::min(task_begin + kParallelTaskSize, end));
+  });
+}
+
+}  // namespace
+
+void S2Builder::SnapFunction::SnapPoints(absl::Span<const S2Point> points,
+                                         absl::Span<S2Point> output) const {
+  ABSL_DCHECK_EQ(points.size(), output.size());
+  for (size_t i = 0; i < points.size(); ++i) {
+    output[i] = SnapPoint(points[i]);
+  }
+}
+
 S2Builder::Options::Options()
     : snap_function_(
           make_unique<s2builderutil::IdentitySnapFunction>(S1Angle::Zero())) {
@@ -147,7 +186,12 @@ S2Builder::Options::Options(const Options& options)
       intersection_tolerance_(options.intersection_tolerance_),
       simplify_edge_chains_(options.simplify_edge_chains_),
       idempotent_(options.idempotent_),
-      memory_tracker_(options.memory_tracker_) {
+      snap_shared_edges_once_(options.snap_shared_edges_once_),
+      memory_tracker_(options.memory_tracker_),
+      memory_resource_(options.memory_resource_),
+      retain_capacity_(options.retain_capacity_),
+      num_threads_(options.num_threads_),
+      tracer_(options.tracer_) {
 }
 
 S2Builder::Options& S2Builder::Options::operator=(const Options& options) {
@@ -156,7 +200,12 @@ S2Builder::Options& S2Builder::Options::operator=(const Options& options) {
   intersection_tolerance_ = options.intersection_tolerance_;
   simplify_edge_chains_ = options.simplify_edge_chains_;
   idempotent_ = options.idempotent_;
+  snap_shared_edges_once_ = options.snap_shared_edges_once_;
   memory_tracker_ = options.memory_tracker_;
+  memory_resource_ = options.memory_resource_;
+  retain_capacity_ = options.retain_capacity_;
+  num_threads_ = options.num_threads_;
+  tracer_ = options.tracer_;
   return *this;
 }
 
@@ -381,6 +430,12 @@ void S2Builder::StartLayer(unique_ptr<Layer> layer) {
 // Edges are represented as (VertexId, VertexId) pairs.  All edges are stored
 // in a single vector; each layer corresponds to a contiguous range.
 
+// Returns the memory resource used for temporary data structures.
+std::pmr::memory_resource* S2Builder::temp_resource() const {
+  std::pmr::memory_resource* resource = options_.memory_resource();
+  return resource ? resource : std::pmr::get_default_resource();
+}
+
 S2Builder::InputVertexId S2Builder::AddVertex(const S2Point& v) {
   // Remove duplicate vertices that follow the pattern AB, BC, CD.  If we want
   // to do anything more sophisticated, either use a ValueLexicon, or sort the
@@ -525,6 +580,43 @@ class VertexIdEdgeVectorShape final : public S2Shape {
 };
 }  // namespace
 
+// Reports the start of a phase to options().tracer() (if any) when
+// constructed, and the end of the phase when destroyed.
+class S2Builder::PhaseTrace {
+ public:
+  PhaseTrace(const S2Builder& builder, S2BuilderTracer::Phase phase)
+      : builder_(builder), phase_(phase) {
+    if (S2BuilderTracer* tracer = builder_.options_.tracer()) {
+      tracer->StartPhase(phase_, GetCounts());
+    }
+  }
+
+  ~PhaseTrace() {
+    if (S2BuilderTracer* tracer = builder_.options_.tracer()) {
+      tracer->EndPhase(phase_, GetCounts());
+    }
+  }
+
+  void set_num_edge_crossings(int64_t n) { num_edge_crossings_ = n; }
+
+  PhaseTrace(const PhaseTrace&) = delete;
+  PhaseTrace& operator=(const PhaseTrace&) = delete;
+
+ private:
+  S2BuilderTracer::Counts GetCounts() const {
+    S2BuilderTracer::Counts counts;
+    counts.num_input_vertices = builder_.input_vertices_.size();
+    counts.num_input_edges = builder_.input_edges_.size();
+    counts.num_sites = builder_.sites_.size();
+    counts.num_edge_crossings = num_edge_crossings_;
+    return counts;
+  }
+
+  const S2Builder& builder_;
+  S2BuilderTracer::Phase phase_;
+  int64_t num_edge_crossings_ = 0;
+};
+
 bool S2Builder::Build(S2Error* error) {
   // ABSL_CHECK rather than ABSL_DCHECK because this is friendlier than crashing
   // on the "error->Clear()" call below.  It would be easy to allow (error ==
@@ -561,12 +653,18 @@ void S2Builder::Reset() {
   label_set_.clear();
   label_set_modified_ = false;
   sites_.clear();
-  edge_sites_.clear();
+  if (options_.retain_capacity()) {
+    tracker_.RetainEdgeSites(&edge_sites_);
+  } else {
+    edge_sites_.clear();
+  }
+  tracker_.Clear(&shared_edges_);
   snapping_needed_ = false;
 }
 
 void S2Builder::ChooseSites() {
   if (!tracker_.ok() || input_vertices_.empty()) return;
+  PhaseTrace trace(*this, S2BuilderTracer::Phase::CHOOSE_SITES);
 
   // Note that although we always create an S2ShapeIndex, often it is not
   // actually built (because this happens lazily).  Therefore we only test
@@ -579,6 +677,17 @@ void S2Builder::ChooseSites() {
     AddEdgeCrossings(input_edge_index);
   }
 
+  // Inputs that were already snapped (e.g. the output of a previous S2Builder
+  // invocation) can be detected much more cheaply than by choosing the sites
+  // and collecting the sites near each edge.  Forced sites are rare, so we
+  // don't bother with them here.
+  if (snapping_requested_ && !snapping_needed_ && sites_.empty() &&
+      IsAlreadySnapped()) {
+    ChooseAllVerticesAsSites();
+    return;
+  }
+  if (!tracker_.ok()) return;
+
   if (snapping_requested_) {
     S2PointIndex<SiteId> site_index;
     auto _ = absl::MakeCleanup([&]() { tracker_.DoneSiteIndex(site_index); });
@@ -594,6 +703,98 @@ void S2Builder::ChooseSites() {
   }
 }
 
+// Returns true if snapping is not needed, i.e. if ChooseInitialSites() and
+// CollectSiteEdges() would leave snapping_needed_ false.  This is the case
+// when every input vertex is unchanged by the snap function, no two distinct
+// vertices are closer than min_site_separation_, and no vertex is closer than
+// min_edge_vertex_separation() to an edge that it is not an endpoint of.
+//
+// This is much faster than the general algorithm for inputs that were already
+// snapped because the sites are not selected incrementally, the query radius
+// for edges is much smaller, and the nearby sites are not saved or sorted.
+// Returns false as soon as any requirement is known not to be met.
+bool S2Builder::IsAlreadySnapped() {
+  const SnapFunction& snap_function = options_.snap_function();
+  const int num_threads = options_.num_threads();
+  const int num_vertices = input_vertices_.size();
+  std::atomic<bool> failed = false;
+  ParallelForRange(num_threads, 0, num_vertices, [&](int begin, int end) {
+    // Vertices are snapped in small batches so that SnapPoints() can be used.
+    constexpr int kBatchSize = 256;
+    S2Point snapped[kBatchSize];
+    for (int i = begin; i < end && !failed.load(std::memory_order_relaxed);
+         i += kBatchSize) {
+      const int n = std::min(kBatchSize, end - i);
+      auto points = absl::MakeConstSpan(&input_vertices_[i], n);
+      snap_function.SnapPoints(points, absl::MakeSpan(snapped, n));
+      if (!std::equal(points.begin(), points.end(), snapped)) {
+        failed.store(true, std::memory_order_relaxed);
+      }
+    }
+  });
+  if (failed) return false;
+
+  // Since all vertices are sites, they can be indexed in any order.
+  S2PointIndex<SiteId> site_index;
+  auto _ = absl::MakeCleanup([&]() { tracker_.DoneSiteIndex(site_index); });
+  for (InputVertexId i = 0; i < num_vertices; ++i) {
+    if (!tracker_.TallyIndexedSite()) return false;
+    site_index.Add(input_vertices_[i], i);
+  }
+  if (!tracker_.FixSiteIndexTally(site_index)) return false;
+
+  // Check that distinct sites are far enough apart.  (As in
+  // ChooseInitialSites, there is no such requirement when the snap radius is
+  // zero.)
+  if (site_snap_radius_ca_ != S1ChordAngle::Zero()) {
+    S2ClosestPointQueryOptions options;
+    options.set_conservative_max_distance(min_site_separation_ca_);
+    ParallelForRange(num_threads, 0, num_vertices, [&](int begin, int end) {
+      S2ClosestPointQuery<SiteId> site_query(&site_index, options);
+      vector<S2ClosestPointQuery<SiteId>::Result> results;
+      for (int i = begin; i < end && !failed.load(std::memory_order_relaxed);
+           ++i) {
+        const S2Point& site = input_vertices_[i];
+        S2ClosestPointQueryPointTarget target(site);
+        site_query.FindClosestPoints(&target, &results);
+        for (const auto& result : results) {
+          if (result.point() != site &&
+              s2pred::CompareDistance(site, result.point(),
+                                      min_site_separation_ca_) <= 0) {
+            failed.store(true, std::memory_order_relaxed);
+          }
+        }
+      }
+    });
+    if (failed) return false;
+  }
+
+  // Check that sites are far enough from the edges that they are not an
+  // endpoint of (see CollectSiteEdges).
+  S2ClosestPointQueryOptions options;
+  options.set_conservative_max_distance(min_edge_site_separation_ca_);
+  ParallelForRange(num_threads, 0, input_edges_.size(),
+                   [&](InputEdgeId begin, InputEdgeId end) {
+    S2ClosestPointQuery<SiteId> site_query(&site_index, options);
+    vector<S2ClosestPointQuery<SiteId>::Result> results;
+    for (InputEdgeId e = begin;
+         e < end && !failed.load(std::memory_order_relaxed); ++e) {
+      const S2Point& v0 = input_vertices_[input_edges_[e].first];
+      const S2Point& v1 = input_vertices_[input_edges_[e].second];
+      S2ClosestPointQueryEdgeTarget target(v0, v1);
+      site_query.FindClosestPoints(&target, &results);
+      for (const auto& result : results) {
+        if (result.point() != v0 && result.point() != v1 &&
+            s2pred::CompareEdgeDistance(result.point(), v0, v1,
+                                        min_edge_site_separation_ca_) < 0) {
+          failed.store(true, std::memory_order_relaxed);
+        }
+      }
+    }
+  });
+  return !failed;
+}
+
 void S2Builder::ChooseAllVerticesAsSites() {
   // Sort the input vertices, discard duplicates, and use the result as the
   // list of sites.  (We sort in the same order used by ChooseInitialSites()
@@ -605,8 +806,8 @@ void S2Builder::ChooseAllVerticesAsSites() {
   if (!tracker_.AddSpaceExact(&sites_, input_vertices_.size())) return;
   const int64_t kTempPerVertex = sizeof(InputVertexKey) + sizeof(InputVertexId);
   if (!tracker_.TallyTemp(input_vertices_.size() * kTempPerVertex)) return;
-  vector<InputVertexKey> sorted = SortInputVertices();
-  vector<InputVertexId> vmap(input_vertices_.size());
+  TempVector<InputVertexKey> sorted = SortInputVertices();
+  TempVector<InputVertexId> vmap(input_vertices_.size(), temp_resource());
   for (size_t in = 0; in < sorted.size();) {
     const S2Point& site = input_vertices_[sorted[in].second];
     vmap[sorted[in].second] = sites_.size();
@@ -622,7 +823,8 @@ void S2Builder::ChooseAllVerticesAsSites() {
   }
 }
 
-vector<S2Builder::InputVertexKey> S2Builder::SortInputVertices() {
+S2Builder::TempVector<S2Builder::InputVertexKey>
+S2Builder::SortInputVertices() {
   // Sort all the input vertices in the order that we wish to consider them as
   // candidate Voronoi sites.  ChooseAllVerticesAsSites() requires duplicate
   // points be adjacent in the sorted output for deduplication.  Otherwise, any
@@ -635,7 +837,9 @@ vector<S2Builder::InputVertexKey> S2Builder::SortInputVertices() {
   // performance of many S2Builder phases (due to better spatial locality).  It
   // also allows the possibility of replacing the current S2PointIndex approach
   // with a more efficient recursive divide-and-conquer algorithm.  Ties are
-  // broken by comparing the S2Point values of vertices lexicographically.
+  // broken by comparing the S2Point values of vertices lexicographically,
+  // and then by InputVertexId so that the order does not depend on how the
+  // sort is split across threads.
   //
   // However, sorting by leaf S2CellId alone has two small disadvantages in
   // the case where the candidate sites are densely spaced relative to the
@@ -677,18 +881,23 @@ vector<S2Builder::InputVertexKey> S2Builder::SortInputVertices() {
   //
   // TODO(ericv): Experiment with these approaches.
 
-  vector<InputVertexKey> keys;
+  TempVector<InputVertexKey> keys(temp_resource());
   keys.reserve(input_vertices_.size());
   for (InputVertexId i = 0; static_cast<size_t>(i) < input_vertices_.size();
        ++i) {
     keys.push_back(InputVertexKey(S2CellId(input_vertices_[i]), i));
   }
-  std::sort(keys.begin(), keys.end(),
-            [this](const InputVertexKey& a, const InputVertexKey& b) {
-      if (a.first < b.first) return true;
-      if (b.first < a.first) return false;
-      return input_vertices_[a.second] < input_vertices_[b.second];
-    });
+  s2internal::ParallelSort(
+      options_.num_threads(), keys.begin(), keys.end(),
+      [this](const InputVertexKey& a, const InputVertexKey& b) {
+        if (a.first < b.first) return true;
+        if (b.first < a.first) return false;
+        const S2Point& pa = input_vertices_[a.second];
+        const S2Point& pb = input_vertices_[b.second];
+        if (pa < pb) return true;
+        if (pb < pa) return false;
+        return a.second < b.second;
+      });
   return keys;
 }
 
@@ -696,12 +905,13 @@ vector<S2Builder::InputVertexKey> S2Builder::SortInputVertices() {
 // points to input_vertices_.  (The intersection points will be snapped and
 // merged with the other vertices during site selection.)
 void S2Builder::AddEdgeCrossings(const MutableS2ShapeIndex& input_edge_index) {
+  PhaseTrace trace(*this, S2BuilderTracer::Phase::ADD_EDGE_CROSSINGS);
   input_edge_index.ForceBuild();
   if (!tracker_.ok()) return;
 
   // We need to build a list of intersections and add them afterwards so that
   // we don't reallocate vertices_ during the VisitCrossings() call.
-  vector<S2Point> new_vertices;
+  TempVector<S2Point> new_vertices(temp_resource());
   auto _ = absl::MakeCleanup([&]() { tracker_.Untally(new_vertices); });
   s2shapeutil::VisitCrossingEdgePairs(
       input_edge_index, s2shapeutil::CrossingType::INTERIOR,
@@ -712,6 +922,7 @@ void S2Builder::AddEdgeCrossings(const MutableS2ShapeIndex& input_edge_index) {
             S2::GetIntersection(a.v0(), a.v1(), b.v0(), b.v1()));
         return true;
       });
+  trace.set_num_edge_crossings(new_vertices.size());
   if (new_vertices.empty()) return;
 
   snapping_needed_ = true;
@@ -756,11 +967,38 @@ void S2Builder::ChooseInitialSites(S2PointIndex<SiteId>* site_index) {
   //
   // Track the memory used by SortInputVertices() before calling it.
   if (!tracker_.Tally(input_vertices_.size() * sizeof(InputVertexKey))) return;
-  vector<InputVertexKey> sorted_keys = SortInputVertices();
+  TempVector<InputVertexKey> sorted_keys = SortInputVertices();
   auto _ = absl::MakeCleanup([&]() { tracker_.Untally(sorted_keys); });
-  for (const InputVertexKey& key : sorted_keys) {
-    const S2Point& vertex = input_vertices_[key.second];
-    S2Point site = SnapSite(vertex);
+
+  // Choosing the sites is inherently sequential, but applying the snap
+  // function is not, so the vertices are snapped ahead of time in batches
+  // (using multiple threads if requested).
+  ABSL_DCHECK(snapping_requested_);
+  const int num_vertices = sorted_keys.size();
+  vector<S2Point> snapped_vertices;
+  for (int i = 0; i < num_vertices; ++i) {
+    const int offset = i % kParallelBatchSize;
+    if (offset == 0) {
+      const int batch_end = std::min(i + kParallelBatchSize, num_vertices);
+      snapped_vertices.resize(batch_end - i);
+      ParallelForRange(options_.num_threads(), i, batch_end,
+                       [&](int task_begin, int task_end) {
+        // Gather the input vertices so that they can be snapped as a batch.
+        // They are sorted by S2CellId, which allows SnapPoints() to reuse
+        // work between nearby points.
+        vector<S2Point> points;
+        points.reserve(task_end - task_begin);
+        for (int j = task_begin; j < task_end; ++j) {
+          points.push_back(input_vertices_[sorted_keys[j].second]);
+        }
+        options_.snap_function().SnapPoints(
+            points, absl::MakeSpan(&snapped_vertices[task_begin - i],
+                                   task_end - task_begin));
+      });
+    }
+    const S2Point& vertex = input_vertices_[sorted_keys[i].second];
+    const S2Point& site = snapped_vertices[offset];
+    CheckSnappedSite(vertex, site);
     // If any vertex moves when snapped, the output cannot be idempotent.
     snapping_needed_ = snapping_needed_ || site != vertex;
 
@@ -799,6 +1037,14 @@ void S2Builder::ChooseInitialSites(S2PointIndex<SiteId>* site_index) {
 S2Point S2Builder::SnapSite(const S2Point& point) const {
   if (!snapping_requested_) return point;
   S2Point site = options_.snap_function().SnapPoint(point);
+  CheckSnappedSite(point, site);
+  return site;
+}
+
+// Reports an error if "site" (the result of snapping "point") is further than
+// the snap radius from "point".
+void S2Builder::CheckSnappedSite(const S2Point& point,
+                                 const S2Point& site) const {
   S1ChordAngle dist_moved(site, point);
   if (dist_moved > site_snap_radius_ca_) {
     *error_ = S2Error(
@@ -810,7 +1056,6 @@ S2Point S2Builder::SnapSite(const S2Point& point) const {
                         dist_moved.ToAngle().radians(),
                         site_snap_radius_ca_.ToAngle().radians()));
   }
-  return site;
 }
 
 // For each edge, find all sites within edge_site_query_radius_ca_ and
@@ -824,37 +1069,116 @@ void S2Builder::CollectSiteEdges(const S2PointIndex<SiteId>& site_index) {
   // typically insignificant, and does not affect the high water mark.
   S2ClosestPointQueryOptions options;
   options.set_conservative_max_distance(edge_site_query_radius_ca_);
-  S2ClosestPointQuery<SiteId> site_query(&site_index, options);
-  vector<S2ClosestPointQuery<SiteId>::Result> results;
-  if (!tracker_.AddSpaceExact(&edge_sites_, input_edges_.size())) return;
+  // Note that edge_sites_ may already contain empty elements whose memory was
+  // retained from a previous Build() call (see Options::retain_capacity).
+  if (!tracker_.AddSpaceExact(&edge_sites_,
+                              input_edges_.size() - edge_sites_.size())) {
+    return;
+  }
   edge_sites_.resize(input_edges_.size());  // Construct all elements.
-  for (InputEdgeId e = 0; static_cast<size_t>(e) < input_edges_.size(); ++e) {
-    const InputEdge& edge = input_edges_[e];
-    const S2Point& v0 = input_vertices_[edge.first];
-    const S2Point& v1 = input_vertices_[edge.second];
-    if (s2builder_verbose) {
-      std::cout << "S2Polyline: " << s2textformat::ToString(v0)
-                << ", " << s2textformat::ToString(v1) << "\n";
-    }
-    S2ClosestPointQueryEdgeTarget target(v0, v1);
-    site_query.FindClosestPoints(&target, &results);
-    auto* sites = &edge_sites_[e];
-    sites->reserve(results.size());
-    for (const auto& result : results) {
-      sites->push_back(result.data());
-      if (!snapping_needed_ &&
-          result.distance() < min_edge_site_separation_ca_limit_ &&
-          result.point() != v0 && result.point() != v1 &&
-          s2pred::CompareEdgeDistance(result.point(), v0, v1,
-                                      min_edge_site_separation_ca_) < 0) {
-        snapping_needed_ = true;
+  if (options_.snap_shared_edges_once()) {
+    FindSharedEdges();
+    if (!tracker_.ok()) return;
+  }
+
+  // The edges are independent, so they are processed in batches using
+  // multiple threads if requested.  The memory used by each batch is tallied
+  // once the batch is complete.
+  const int num_edges = input_edges_.size();
+  for (int batch_begin = 0; batch_begin < num_edges;
+       batch_begin += kParallelBatchSize) {
+    const int batch_end = std::min(batch_begin + kParallelBatchSize,
+                                   num_edges);
+    std::atomic<bool> found_snapping_needed = false;
+    ParallelForRange(options_.num_threads(), batch_begin, batch_end,
+                     [&](InputEdgeId begin, InputEdgeId end) {
+      S2ClosestPointQuery<SiteId> site_query(&site_index, options);
+      vector<S2ClosestPointQuery<SiteId>::Result> results;
+      bool snapping_needed = snapping_needed_;
+      for (InputEdgeId e = begin; e < end; ++e) {
+        if (is_shared_copy(e)) continue;  // Copied below.
+        const InputEdge& edge = input_edges_[e];
+        const S2Point& v0 = input_vertices_[edge.first];
+        const S2Point& v1 = input_vertices_[edge.second];
+        if (s2builder_verbose) {
+          std::cout << "S2Polyline: " << s2textformat::ToString(v0)
+                    << ", " << s2textformat::ToString(v1) << "\n";
+        }
+        S2ClosestPointQueryEdgeTarget target(v0, v1);
+        site_query.FindClosestPoints(&target, &results);
+        auto* sites = &edge_sites_[e];
+        sites->reserve(results.size());
+        for (const auto& result : results) {
+          sites->push_back(result.data());
+          if (!snapping_needed &&
+              result.distance() < min_edge_site_separation_ca_limit_ &&
+              result.point() != v0 && result.point() != v1 &&
+              s2pred::CompareEdgeDistance(result.point(), v0, v1,
+                                          min_edge_site_separation_ca_) < 0) {
+            snapping_needed = true;
+          }
+        }
+        SortSitesByDistance(v0, sites);
+      }
+      if (snapping_needed && !snapping_needed_) {
+        found_snapping_needed.store(true, std::memory_order_relaxed);
       }
+    });
+    snapping_needed_ = snapping_needed_ || found_snapping_needed.load();
+    for (InputEdgeId e = batch_begin; e < batch_end; ++e) {
+      if (is_shared_copy(e)) {
+        // The sites near an edge don't depend on its direction, but they are
+        // sorted by distance from the edge origin.
+        const InputEdgeId shared = shared_edges_[e];
+        edge_sites_[e] = edge_sites_[shared];
+        const S2Point& v0 = input_vertices_[input_edges_[e].first];
+        if (v0 != input_vertices_[input_edges_[shared].first]) {
+          SortSitesByDistance(v0, &edge_sites_[e]);
+        }
+      }
+      if (!tracker_.TallyEdgeSites(edge_sites_[e])) return;
     }
-    SortSitesByDistance(v0, sites);
-    if (!tracker_.TallyEdgeSites(*sites)) return;
   }
 }
 
+// Sets shared_edges_[e] to the first input edge with the same endpoints as
+// "e" (in either direction).
+void S2Builder::FindSharedEdges() {
+  const int num_edges = input_edges_.size();
+  if (!tracker_.TallyTemp(num_edges * sizeof(InputEdgeId))) return;
+  if (!tracker_.AddSpaceExact(&shared_edges_, num_edges)) return;
+  shared_edges_.resize(num_edges);
+
+  // Sort the edges by their endpoints (smallest first) and then by id, so
+  // that edges with the same endpoints are adjacent.
+  const auto key = [this](InputEdgeId e) {
+    const S2Point& v0 = input_vertices_[input_edges_[e].first];
+    const S2Point& v1 = input_vertices_[input_edges_[e].second];
+    return v0 < v1 ? std::make_tuple(v0, v1, e) : std::make_tuple(v1, v0, e);
+  };
+  TempVector<InputEdgeId> order(num_edges, temp_resource());
+  std::iota(order.begin(), order.end(), 0);
+  s2internal::ParallelSort(options_.num_threads(), order.begin(), order.end(),
+                           [&key](InputEdgeId a, InputEdgeId b) {
+                             return key(a) < key(b);
+                           });
+  for (int i = 0; i < num_edges; ++i) {
+    const InputEdgeId e = order[i];
+    shared_edges_[e] = e;
+    if (i > 0) {
+      const auto [a0, a1, a] = key(order[i - 1]);
+      const auto [b0, b1, b] = key(e);
+      if (a0 == b0 && a1 == b1) shared_edges_[e] = shared_edges_[a];
+    }
+  }
+}
+
+// Returns true if "e" has the same endpoints as an earlier input edge and
+// should therefore be snapped in the same way.
+inline bool S2Builder::is_shared_copy(InputEdgeId e) const {
+  return !shared_edges_.empty() && shared_edges_[e] != e;
+}
+
 // Sorts the sites in increasing order of distance to X.
 void S2Builder::SortSitesByDistance(const S2Point& x,
                                     compact_array<SiteId>* sites) const {
@@ -895,6 +1219,8 @@ void S2Builder::InsertSiteByDistance(SiteId new_site_id, const S2Point& x,
 // Voronoi sites and then testing each edge in the chain.  If a site needs to
 // be added, we mark all nearby edges for re-snapping.
 void S2Builder::AddExtraSites(const MutableS2ShapeIndex& input_edge_index) {
+  PhaseTrace trace(*this, S2BuilderTracer::Phase::ADD_EXTRA_SITES);
+
   // Note that we could save some work in AddSnappedEdges() by saving the
   // snapped edge chains in a vector, but currently this is not worthwhile
   // since SnapEdge() accounts for less than 5% of the runtime.
@@ -903,16 +1229,22 @@ void S2Builder::AddExtraSites(const MutableS2ShapeIndex& input_edge_index) {
   // `expected_max_elements` used by the old `dense_hash_set` version.
   // This will actually get us 31 buckets since it gets rounded up.
   // We could experiment with different values here.
-  flat_hash_set<InputEdgeId> edges_to_resnap(/*bucket_count=*/18);
+  InputEdgeIdSet edges_to_resnap(/*bucket_count=*/18,
+                                 InputEdgeIdSet::hasher(),
+                                 InputEdgeIdSet::key_equal(), temp_resource());
 
-  vector<SiteId> chain;  // Temporary storage.
+  TempVector<SiteId> chain(temp_resource());  // Temporary storage.
   int num_edges_after_snapping = 0;
 
   // CheckEdge() defines the body of the loops below.
   const auto CheckEdge = [&](InputEdgeId e) -> bool {
       if (!tracker_.ok()) return false;
-      SnapEdge(e, &chain);
       edges_to_resnap.erase(e);
+      // Since the copies of a shared edge are snapped to the same chain of
+      // sites, only the first copy needs to be checked.  (The extra sites
+      // near all the copies are found whenever it is resnapped.)
+      if (is_shared_copy(e)) return true;
+      SnapEdge(e, &chain);
       num_edges_after_snapping += chain.size();
       MaybeAddExtraSites(e, chain, input_edge_index, &edges_to_resnap);
       return true;
@@ -929,7 +1261,8 @@ void S2Builder::AddExtraSites(const MutableS2ShapeIndex& input_edge_index) {
                << ", sites=" << sites_.size();
 
   for (int num_passes = 1; !edges_to_resnap.empty(); ++num_passes) {
-    auto edges_to_snap = edges_to_resnap;
+    InputEdgeIdSet edges_to_snap(edges_to_resnap,
+                                 edges_to_resnap.get_allocator());
     edges_to_resnap.clear();
     num_edges_after_snapping = 0;
     for (InputEdgeId e : edges_to_snap) {
@@ -945,7 +1278,7 @@ void S2Builder::AddExtraSites(const MutableS2ShapeIndex& input_edge_index) {
 void S2Builder::MaybeAddExtraSites(
     InputEdgeId edge_id, absl::Span<const SiteId> chain,
     const MutableS2ShapeIndex& input_edge_index,
-    flat_hash_set<InputEdgeId>* edges_to_resnap) {
+    InputEdgeIdSet* edges_to_resnap) {
   // If the memory tracker has a periodic callback function, tally an amount
   // of memory proportional to the work being done so that the caller has an
   // opportunity to cancel the operation if necessary.
@@ -1070,7 +1403,7 @@ void S2Builder::MaybeAddExtraSites(
 // and adds them to "edges_to_resnap" for resnapping.
 void S2Builder::AddExtraSite(const S2Point& new_site,
                              const MutableS2ShapeIndex& input_edge_index,
-                             flat_hash_set<InputEdgeId>* edges_to_resnap) {
+                             InputEdgeIdSet* edges_to_resnap) {
   if (!sites_.empty()) ABSL_DCHECK_NE(new_site, sites_.back());
   if (!tracker_.AddSpace(&sites_, 1)) return;
   SiteId new_site_id = sites_.size();
@@ -1168,7 +1501,7 @@ S2Point S2Builder::GetCoverageEndpoint(const S2Point& p, const S2Point& n)
   return (om + mr).Normalize();
 }
 
-void S2Builder::SnapEdge(InputEdgeId e, vector<SiteId>* chain) const {
+void S2Builder::SnapEdge(InputEdgeId e, TempVector<SiteId>* chain) const {
   chain->clear();
   const InputEdge& edge = input_edges_[e];
   if (!snapping_needed_) {
@@ -1179,6 +1512,18 @@ void S2Builder::SnapEdge(InputEdgeId e, vector<SiteId>* chain) const {
     return;
   }
 
+  if (is_shared_copy(e)) {
+    // This edge is snapped in the same way as the first edge with the same
+    // endpoints, reversing the chain if necessary.
+    const InputEdgeId shared = shared_edges_[e];
+    SnapEdge(shared, chain);
+    if (input_vertices_[edge.first] !=
+        input_vertices_[input_edges_[shared].first]) {
+      std::reverse(chain->begin(), chain->end());
+    }
+    return;
+  }
+
   const S2Point& x = input_vertices_[edge.first];
   const S2Point& y = input_vertices_[edge.second];
 
@@ -1267,22 +1612,37 @@ void S2Builder::SnapEdge(InputEdgeId e, vector<SiteId>* chain) const {
 
 void S2Builder::BuildLayers() {
   if (!tracker_.ok()) return;
+  PhaseTrace trace(*this, S2BuilderTracer::Phase::BUILD_LAYERS);
 
   // Each output edge has an "input edge id set id" (an int32_t) representing
   // the set of input edge ids that were snapped to this edge.  The actual
   // InputEdgeIds can be retrieved using "input_edge_id_set_lexicon".
-  vector<vector<Edge>> layer_edges;
-  vector<vector<InputEdgeIdSetId>> layer_input_edge_ids;
-  IdSetLexicon input_edge_id_set_lexicon;
+  vector<vector<Edge>>& layer_edges = layer_edges_;
+  vector<vector<InputEdgeIdSetId>>& layer_input_edge_ids =
+      layer_input_edge_ids_;
+  IdSetLexicon& input_edge_id_set_lexicon = input_edge_id_set_lexicon_;
   vector<vector<S2Point>> layer_vertices;
   BuildLayerEdges(&layer_edges, &layer_input_edge_ids,
                   &input_edge_id_set_lexicon);
   auto _ = absl::MakeCleanup([&]() {
     for (size_t i = 0; i < layers_.size(); ++i) {
-      tracker_.Untally(layer_edges[i]);
-      tracker_.Untally(layer_input_edge_ids[i]);
       if (!layer_vertices.empty()) tracker_.Untally(layer_vertices[i]);
     }
+    if (options_.retain_capacity()) {
+      // The retained vectors remain tallied since their memory is still
+      // allocated.  (The next call to BuildLayerEdges only tallies growth.)
+      for (auto& edges : layer_edges) edges.clear();
+      for (auto& input_edge_ids : layer_input_edge_ids) input_edge_ids.clear();
+      input_edge_id_set_lexicon.Clear();
+    } else {
+      for (size_t i = 0; i < layers_.size(); ++i) {
+        tracker_.Untally(layer_edges[i]);
+        tracker_.Untally(layer_input_edge_ids[i]);
+      }
+      vector<vector<Edge>>().swap(layer_edges);
+      vector<vector<InputEdgeIdSetId>>().swap(layer_input_edge_ids);
+      input_edge_id_set_lexicon = IdSetLexicon();
+    }
   });
 
   // If there are a large number of layers, then we build a minimal subset of
@@ -1318,16 +1678,41 @@ void S2Builder::BuildLayers() {
   }
   if (!tracker_.ok()) return;
 
-  for (size_t i = 0; i < layers_.size(); ++i) {
+  auto build_layer = [&](int i, S2Error* error) {
     const vector<S2Point>& vertices = (layer_vertices.empty() ?
                                        sites_ : layer_vertices[i]);
     Graph graph(layer_options_[i], &vertices, &layer_edges[i],
                 &layer_input_edge_ids[i], &input_edge_id_set_lexicon,
                 &label_set_ids_, &label_set_lexicon_,
                 layer_is_full_polygon_predicates_[i]);
-    layers_[i]->Build(graph, error_);
+    graph.set_num_threads(options_.num_threads());
+    layers_[i]->Build(graph, error);
     // Don't free the layer data until all layers have been built, in order to
     // support building multiple layers at once (e.g. ClosedSetNormalizer).
+  };
+
+  // Layers that allow it are built concurrently.  Each one reports errors
+  // separately, and the errors are then applied in layer order so that the
+  // result does not depend on how the layers are scheduled.
+  vector<bool> built(layers_.size(), false);
+  if (options_.num_threads() > 1) {
+    vector<int> concurrent_layers;
+    for (size_t i = 0; i < layers_.size(); ++i) {
+      if (layers_[i]->allow_concurrent_build()) concurrent_layers.push_back(i);
+    }
+    if (concurrent_layers.size() > 1) {
+      vector<S2Error> errors(concurrent_layers.size());
+      s2internal::ParallelFor(
+          options_.num_threads(), concurrent_layers.size(),
+          [&](int k) { build_layer(concurrent_layers[k], &errors[k]); });
+      for (size_t k = 0; k < concurrent_layers.size(); ++k) {
+        if (!errors[k].ok()) *error_ = errors[k];
+        built[concurrent_layers[k]] = true;
+      }
+    }
+  }
+  for (size_t i = 0; i < layers_.size(); ++i) {
+    if (!built[i]) build_layer(i, error_);
   }
 }
 
@@ -1356,7 +1741,7 @@ void S2Builder::BuildLayerEdges(
   // If so, we build a map from each site to the set of input vertices that
   // snapped to that site.  (Note that site_vertices is relatively small and
   // that its memory tracking is deferred until TallySimplifyEdgeChains.)
-  vector<compact_array<InputVertexId>> site_vertices;
+  SiteVertices site_vertices(temp_resource());
   bool simplify = snapping_needed_ && options_.simplify_edge_chains();
   if (simplify) site_vertices.resize(sites_.size());
 
@@ -1374,14 +1759,18 @@ void S2Builder::BuildLayerEdges(
   if (simplify) {
     SimplifyEdgeChains(site_vertices, layer_edges, layer_input_edge_ids,
                        input_edge_id_set_lexicon);
-    vector<compact_array<InputVertexId>>().swap(site_vertices);
+    SiteVertices(temp_resource()).swap(site_vertices);
   }
 
   // At this point we have no further need for nearby site data, so we clear
   // it to save space.  We keep input_vertices_ and input_edges_ so that
   // S2Builder::Layer implementations can access them if desired.  (This is
   // useful for determining how snapping has changed the input geometry.)
-  tracker_.ClearEdgeSites(&edge_sites_);
+  if (options_.retain_capacity()) {
+    tracker_.RetainEdgeSites(&edge_sites_);
+  } else {
+    tracker_.ClearEdgeSites(&edge_sites_);
+  }
   for (size_t i = 0; i < layers_.size(); ++i) {
     // The errors generated by ProcessEdges are really warnings, so we simply
     // record them and continue.
@@ -1399,14 +1788,34 @@ void S2Builder::BuildLayerEdges(
 void S2Builder::AddSnappedEdges(
     InputEdgeId begin, InputEdgeId end, const GraphOptions& options,
     vector<Edge>* edges, vector<InputEdgeIdSetId>* input_edge_ids,
-    IdSetLexicon* input_edge_id_set_lexicon,
-    vector<compact_array<InputVertexId>>* site_vertices) {
+    IdSetLexicon* input_edge_id_set_lexicon, SiteVertices* site_vertices) {
   bool discard_degenerate_edges = (options.degenerate_edges() ==
                                    GraphOptions::DegenerateEdges::DISCARD);
-  vector<SiteId> chain;
+  // SnapEdge() does not modify any state, so when multiple threads are
+  // requested the edges are snapped ahead of time in batches.  (The chains
+  // are then allocated by the worker threads, so they can't use
+  // temp_resource().)
+  const int num_threads = options_.num_threads();
+  const int batch_size = num_threads > 1 ? kParallelBatchSize : 1;
+  std::pmr::memory_resource* chain_resource =
+      num_threads > 1 ? std::pmr::new_delete_resource() : temp_resource();
+  vector<TempVector<SiteId>> chains;
   for (InputEdgeId e = begin; e < end; ++e) {
+    const int offset = (e - begin) % batch_size;
+    if (offset == 0) {
+      const InputEdgeId batch_end = std::min(e + batch_size, end);
+      while (chains.size() < static_cast<size_t>(batch_end - e)) {
+        chains.emplace_back(chain_resource);
+      }
+      ParallelForRange(num_threads, e, batch_end,
+                       [&](InputEdgeId task_begin, InputEdgeId task_end) {
+        for (InputEdgeId i = task_begin; i < task_end; ++i) {
+          SnapEdge(i, &chains[i - e]);
+        }
+      });
+    }
+    const TempVector<SiteId>& chain = chains[offset];
     InputEdgeIdSetId id = input_edge_id_set_lexicon->AddSingleton(e);
-    SnapEdge(e, &chain);
     if (chain.empty()) {
       continue;
     }
@@ -1436,8 +1845,7 @@ void S2Builder::AddSnappedEdges(
 // build a map so that SimplifyEdgeChains() can quickly find all the input
 // vertices that snapped to a particular site.
 inline void S2Builder::MaybeAddInputVertex(
-    InputVertexId v, SiteId id,
-    vector<compact_array<InputVertexId>>* site_vertices) const {
+    InputVertexId v, SiteId id, SiteVertices* site_vertices) const {
   if (site_vertices->empty()) return;
 
   // Optimization: check if we just added this vertex.  This is worthwhile
@@ -1476,8 +1884,7 @@ class S2Builder::EdgeChainSimplifier {
   // not sorted.
   EdgeChainSimplifier(
       const S2Builder& builder, const Graph& g,
-      const vector<int>& edge_layers,
-      const vector<compact_array<InputVertexId>>& site_vertices,
+      const TempVector<int>& edge_layers, const SiteVertices& site_vertices,
       vector<vector<Edge>>* layer_edges,
       vector<vector<InputEdgeIdSetId>>* layer_input_edge_ids,
       IdSetLexicon* input_edge_id_set_lexicon);
@@ -1488,19 +1895,25 @@ class S2Builder::EdgeChainSimplifier {
   using VertexId = Graph::VertexId;
 
   class InteriorVertexMatcher;
+  struct ChainOutput;
 
   void OutputEdge(EdgeId e);
   int graph_edge_layer(EdgeId e) const;
   int input_edge_layer(InputEdgeId id) const;
   bool IsInterior(VertexId v);
-  void SimplifyChain(VertexId v0, VertexId v1);
+  void AddChainStart(EdgeId start, TempVector<EdgeId>* chain_starts);
+  bool IsChainStart(EdgeId e) const;
+  void OutputChains(absl::Span<const EdgeId> chain_starts,
+                    vector<ChainOutput>* outputs);
+  void SimplifyChain(VertexId v0, VertexId v1, ChainOutput* output) const;
   Graph::VertexId FollowChain(VertexId v0, VertexId v1) const;
-  void OutputAllEdges(VertexId v0, VertexId v1);
+  void OutputAllEdges(VertexId v0, VertexId v1, ChainOutput* output) const;
   bool TargetInputVertices(VertexId v, S2PolylineSimplifier* simplifier) const;
   bool AvoidSites(VertexId v0, VertexId v1, VertexId v2,
                   flat_hash_set<VertexId>* used_vertices,
                   S2PolylineSimplifier* simplifier) const;
-  void MergeChain(const vector<VertexId>& vertices);
+  void MergeChain(absl::Span<const VertexId> vertices,
+                  ChainOutput* output) const;
   void AssignDegenerateEdges(absl::Span<const InputEdgeId> degenerate_ids,
                              vector<vector<InputEdgeId>>* merged_ids) const;
 
@@ -1509,8 +1922,8 @@ class S2Builder::EdgeChainSimplifier {
   const Graph& g_;
   Graph::VertexInMap in_;
   Graph::VertexOutMap out_;
-  const vector<int>& edge_layers_;
-  const vector<compact_array<InputVertexId>>& site_vertices_;
+  const TempVector<int>& edge_layers_;
+  const SiteVertices& site_vertices_;
   vector<vector<Edge>>* layer_edges_;
   vector<vector<InputEdgeIdSetId>>* layer_input_edge_ids_;
   IdSetLexicon* input_edge_id_set_lexicon_;
@@ -1522,35 +1935,34 @@ class S2Builder::EdgeChainSimplifier {
   // vertex of a simplified edge chain.  You can think of it as vertex whose
   // indegree and outdegree are both 1 (although the actual definition is a
   // bit more complicated because of duplicate edges and layers).
-  vector<bool> is_interior_;
+  TempVector<bool> is_interior_;
 
   // used_[e] indicates that EdgeId "e" has already been processed.
-  vector<bool> used_;
+  TempVector<bool> used_;
 
-  // Temporary objects declared here to avoid repeated allocation.
-  vector<VertexId> tmp_vertices_;
-  vector<EdgeId> tmp_edges_;
-  flat_hash_set<VertexId> tmp_vertex_set_;
+  // Temporary object declared here to avoid repeated allocation.
+  TempVector<EdgeId> tmp_edges_;
 
   // The output edges after simplification.
-  vector<Edge> new_edges_;
-  vector<InputEdgeIdSetId> new_input_edge_ids_;
-  vector<int> new_edge_layers_;
+  TempVector<Edge> new_edges_;
+  TempVector<InputEdgeIdSetId> new_input_edge_ids_;
+  TempVector<int> new_edge_layers_;
 };
 
 // Simplifies edge chains, updating its input/output arguments as necessary.
 void S2Builder::SimplifyEdgeChains(
-    const vector<compact_array<InputVertexId>>& site_vertices,
+    const SiteVertices& site_vertices,
     vector<vector<Edge>>* layer_edges,
     vector<vector<InputEdgeIdSetId>>* layer_input_edge_ids,
     IdSetLexicon* input_edge_id_set_lexicon) {
   if (layers_.empty()) return;
+  PhaseTrace trace(*this, S2BuilderTracer::Phase::SIMPLIFY_EDGE_CHAINS);
   if (!tracker_.TallySimplifyEdgeChains(site_vertices, *layer_edges)) return;
 
   // Merge the edges from all layers (in order to build a single graph).
   vector<Edge> merged_edges;
   vector<InputEdgeIdSetId> merged_input_edge_ids;
-  vector<int> merged_edge_layers;
+  TempVector<int> merged_edge_layers(temp_resource());
   MergeLayerEdges(*layer_edges, *layer_input_edge_ids,
                   &merged_edges, &merged_input_edge_ids, &merged_edge_layers);
 
@@ -1581,8 +1993,8 @@ void S2Builder::MergeLayerEdges(
     absl::Span<const vector<Edge>> layer_edges,
     absl::Span<const vector<InputEdgeIdSetId>> layer_input_edge_ids,
     vector<Edge>* edges, vector<InputEdgeIdSetId>* input_edge_ids,
-    vector<int>* edge_layers) const {
-  vector<LayerEdgeId> order;
+    TempVector<int>* edge_layers) const {
+  TempVector<LayerEdgeId> order(temp_resource());
   for (size_t i = 0; i < layer_edges.size(); ++i) {
     for (size_t e = 0; e < layer_edges[i].size(); ++e) {
       order.push_back(LayerEdgeId(i, e));
@@ -1619,8 +2031,8 @@ inline bool S2Builder::StableLessThan(
 }
 
 S2Builder::EdgeChainSimplifier::EdgeChainSimplifier(
-    const S2Builder& builder, const Graph& g, const vector<int>& edge_layers,
-    const vector<compact_array<InputVertexId>>& site_vertices,
+    const S2Builder& builder, const Graph& g,
+    const TempVector<int>& edge_layers, const SiteVertices& site_vertices,
     vector<vector<Edge>>* layer_edges,
     vector<vector<InputEdgeIdSetId>>* layer_input_edge_ids,
     IdSetLexicon* input_edge_id_set_lexicon)
@@ -1629,30 +2041,76 @@ S2Builder::EdgeChainSimplifier::EdgeChainSimplifier(
       layer_input_edge_ids_(layer_input_edge_ids),
       input_edge_id_set_lexicon_(input_edge_id_set_lexicon),
       layer_begins_(builder_.layer_begins_),
-      is_interior_(g.num_vertices()), used_(g.num_edges()),
-      // See `AddExtraSites` for explanation of `bucket_count`.
-      tmp_vertex_set_(/*bucket_count=*/18) {
+      is_interior_(g.num_vertices(), false, builder.temp_resource()),
+      used_(g.num_edges(), false, builder.temp_resource()),
+      tmp_edges_(builder.temp_resource()),
+      new_edges_(builder.temp_resource()),
+      new_input_edge_ids_(builder.temp_resource()),
+      new_edge_layers_(builder.temp_resource()) {
   new_edges_.reserve(g.num_edges());
   new_input_edge_ids_.reserve(g.num_edges());
   new_edge_layers_.reserve(g.num_edges());
 }
 
+// The edges output by simplifying the edge chains in one parallel task.  The
+// chains are simplified concurrently, but their output is copied to the
+// result in the order that the chains were found, and the input edge id sets
+// of merged edges are added to the IdSetLexicon at that time.  This ensures
+// that the output does not depend on the number of threads.
+struct S2Builder::EdgeChainSimplifier::ChainOutput {
+  explicit ChainOutput(std::pmr::memory_resource* resource)
+      : edges(resource), edge_layers(resource), input_edge_ids(resource),
+        is_merged(resource), chain_ends(resource), used_edges(resource),
+        tmp_vertices(resource),
+        // See `AddExtraSites` for explanation of `bucket_count`.
+        tmp_vertex_set(/*bucket_count=*/18) {}
+
+  void Clear() {
+    edges.clear();
+    edge_layers.clear();
+    input_edge_ids.clear();
+    is_merged.clear();
+    merged_input_ids.clear();
+    chain_ends.clear();
+    used_edges.clear();
+  }
+
+  TempVector<Edge> edges;
+  TempVector<int> edge_layers;
+
+  // The InputEdgeIdSetId of each edge, unless is_merged[i] is true in which
+  // case its input edge ids are the next entry of "merged_input_ids".
+  TempVector<InputEdgeIdSetId> input_edge_ids;
+  TempVector<bool> is_merged;
+  vector<vector<InputEdgeId>> merged_input_ids;
+
+  // The number of edges in "edges" after each chain was simplified.
+  TempVector<int> chain_ends;
+
+  // Degenerate edges that were merged into simplified edges.
+  TempVector<EdgeId> used_edges;
+
+  // Temporary objects declared here to avoid repeated allocation.
+  TempVector<VertexId> tmp_vertices;
+  flat_hash_set<VertexId> tmp_vertex_set;
+};
+
 void S2Builder::EdgeChainSimplifier::Run() {
   // Determine which vertices can be interior vertices of an edge chain.
   for (VertexId v = 0; v < g_.num_vertices(); ++v) {
     is_interior_[v] = IsInterior(v);
   }
-  // Attempt to simplify all edge chains that start from a non-interior
-  // vertex.  (This takes care of all chains except loops.)
+  // Find all the edge chains that start from a non-interior vertex.  (This
+  // takes care of all chains except loops.)  Each chain is represented by
+  // its first edge, and the edges that do not belong to any chain are also
+  // recorded so that the output edges are in the same order as they are
+  // found.  Simplifying each chain is independent of the others, so this
+  // allows the chains to be simplified in parallel below.
+  TempVector<EdgeId> chain_starts(builder_.temp_resource());
   for (EdgeId e = 0; e < g_.num_edges(); ++e) {
     if (used_[e]) continue;
-    Edge edge = g_.edge(e);
-    if (is_interior_[edge.first]) continue;
-    if (!is_interior_[edge.second]) {
-      OutputEdge(e);  // An edge between two non-interior vertices.
-    } else {
-      SimplifyChain(edge.first, edge.second);
-    }
+    if (is_interior_[g_.edge(e).first]) continue;
+    AddChainStart(e, &chain_starts);
   }
   // If there are any edges left, they form one or more disjoint loops where
   // all vertices are interior vertices.
@@ -1668,15 +2126,19 @@ void S2Builder::EdgeChainSimplifier::Run() {
   // towards the preferred output ordering.)
   for (EdgeId e = 0; e < g_.num_edges(); ++e) {
     if (used_[e]) continue;
-    Edge edge = g_.edge(e);
-    if (edge.first == edge.second) {
-      // Note that it is safe to output degenerate edges as we go along,
-      // because this vertex has at least one non-degenerate outgoing edge and
-      // therefore we will (or just did) start an edge chain here.
-      OutputEdge(e);
-    } else {
-      SimplifyChain(edge.first, edge.second);
-    }
+    if (!is_interior_[g_.edge(e).first]) continue;  // Found above.
+    AddChainStart(e, &chain_starts);
+  }
+
+  // Now simplify the chains in batches, copying the output of each batch
+  // before starting the next one.
+  const int num_threads = builder_.options_.num_threads();
+  const int batch_size = num_threads > 1 ? kParallelBatchSize
+                                         : kParallelTaskSize;
+  vector<ChainOutput> outputs;
+  for (size_t i = 0; i < chain_starts.size(); i += batch_size) {
+    OutputChains(absl::MakeConstSpan(chain_starts).subspan(i, batch_size),
+                 &outputs);
   }
   // TODO(ericv): The graph is not needed past here, so we could save some
   // memory by clearing the underlying Edge and InputEdgeIdSetId vectors.
@@ -1690,6 +2152,96 @@ void S2Builder::EdgeChainSimplifier::Run() {
   }
 }
 
+// Adds the given unused edge to "chain_starts".  If the edge starts an edge
+// chain, also marks all the non-degenerate edges of the chain as used.  (The
+// chain follows the same path as SimplifyChain, and every such edge is
+// either merged or copied to the output.)
+void S2Builder::EdgeChainSimplifier::AddChainStart(
+    EdgeId start, TempVector<EdgeId>* chain_starts) {
+  chain_starts->push_back(start);
+  if (!IsChainStart(start)) return;
+  VertexId v0 = g_.edge(start).first, v1 = g_.edge(start).second;
+  const VertexId vstart = v0;
+  for (;;) {
+    for (EdgeId e : out_.edge_ids(v0, v1)) used_[e] = true;
+    for (EdgeId e : out_.edge_ids(v1, v0)) used_[e] = true;
+    if (!is_interior_[v1] || v1 == vstart) return;
+    VertexId vprev = v0;
+    v0 = v1;
+    v1 = FollowChain(vprev, v0);
+  }
+}
+
+// Returns true if the given edge, which was passed to AddChainStart, is the
+// first edge of an edge chain.  Otherwise it is either an edge between two
+// non-interior vertices, or a degenerate edge at an interior vertex (which
+// is copied to the output unless it was merged into an edge chain).
+inline bool S2Builder::EdgeChainSimplifier::IsChainStart(EdgeId e) const {
+  Edge edge = g_.edge(e);
+  return is_interior_[edge.first] ? edge.first != edge.second
+                                  : is_interior_[edge.second];
+}
+
+// Simplifies the edge chains starting with the given edges and copies the
+// results to the output, along with the edges that do not belong to a chain.
+void S2Builder::EdgeChainSimplifier::OutputChains(
+    absl::Span<const EdgeId> chain_starts, vector<ChainOutput>* outputs) {
+  // The chains are simplified by worker threads when multiple threads are
+  // requested, so the outputs can't use temp_resource().
+  const int num_threads = builder_.options_.num_threads();
+  std::pmr::memory_resource* output_resource =
+      num_threads > 1 ? std::pmr::new_delete_resource()
+                      : builder_.temp_resource();
+  const int num_tasks = (chain_starts.size() + kParallelTaskSize - 1) /
+                        kParallelTaskSize;
+  while (outputs->size() < static_cast<size_t>(num_tasks)) {
+    outputs->emplace_back(output_resource);
+  }
+  ParallelForRange(num_threads, 0, chain_starts.size(),
+                   [&](int task_begin, int task_end) {
+    ChainOutput* output = &(*outputs)[task_begin / kParallelTaskSize];
+    output->Clear();
+    for (int i = task_begin; i < task_end; ++i) {
+      if (!IsChainStart(chain_starts[i])) continue;
+      Edge edge = g_.edge(chain_starts[i]);
+      SimplifyChain(edge.first, edge.second, output);
+      output->chain_ends.push_back(output->edges.size());
+    }
+  });
+  // Degenerate edges that were merged into a chain must not be copied to the
+  // output.  Such edges are always merged by a chain that was found earlier.
+  for (int t = 0; t < num_tasks; ++t) {
+    for (EdgeId e : (*outputs)[t].used_edges) used_[e] = true;
+  }
+  for (int t = 0; t < num_tasks; ++t) {
+    const ChainOutput& output = (*outputs)[t];
+    const int begin = t * kParallelTaskSize;
+    const int end = std::min<int>(begin + kParallelTaskSize,
+                                  chain_starts.size());
+    int j = 0, chain = 0, merged = 0;
+    for (int i = begin; i < end; ++i) {
+      EdgeId e = chain_starts[i];
+      if (!IsChainStart(e)) {
+        // Note that it is safe to output degenerate edges as we go along,
+        // because this vertex has at least one non-degenerate outgoing edge
+        // and therefore we will (or just did) start an edge chain here.
+        if (!used_[e]) OutputEdge(e);
+        continue;
+      }
+      for (; j < output.chain_ends[chain]; ++j) {
+        new_edges_.push_back(output.edges[j]);
+        new_edge_layers_.push_back(output.edge_layers[j]);
+        new_input_edge_ids_.push_back(
+            output.is_merged[j]
+                ? input_edge_id_set_lexicon_->Add(
+                      output.merged_input_ids[merged++])
+                : output.input_edge_ids[j]);
+      }
+      ++chain;
+    }
+  }
+}
+
 // Copies the given edge to the output and marks it as used.
 inline void S2Builder::EdgeChainSimplifier::OutputEdge(EdgeId e) {
   new_edges_.push_back(g_.edge(e));
@@ -1789,7 +2341,7 @@ bool S2Builder::EdgeChainSimplifier::IsInterior(VertexId v) {
   if (builder_.is_forced(v)) return false;  // Keep forced vertices.
 
   // Sort the edges so that they are grouped by layer.
-  vector<EdgeId>& edges = tmp_edges_;  // Avoid allocating each time.
+  TempVector<EdgeId>& edges = tmp_edges_;  // Avoid allocating each time.
   edges.clear();
   for (EdgeId e : out_.edge_ids(v)) edges.push_back(e);
   for (EdgeId e : in_.edge_ids(v)) edges.push_back(e);
@@ -1814,13 +2366,14 @@ bool S2Builder::EdgeChainSimplifier::IsInterior(VertexId v) {
 // Follows the edge chain starting with (v0, v1) until either we find a
 // non-interior vertex or we return to the original vertex v0.  At each vertex
 // we simplify a subchain of edges that is as long as possible.
-void S2Builder::EdgeChainSimplifier::SimplifyChain(VertexId v0, VertexId v1) {
+void S2Builder::EdgeChainSimplifier::SimplifyChain(
+    VertexId v0, VertexId v1, ChainOutput* output) const {
   // Avoid allocating "chain" each time by reusing it.
-  vector<VertexId>& chain = tmp_vertices_;
+  TempVector<VertexId>& chain = output->tmp_vertices;
   // Contains the set of vertices that have either been avoided or added to
   // the chain so far.  This is necessary so that AvoidSites() doesn't try to
   // avoid vertices that have already been added to the chain.
-  flat_hash_set<VertexId>& used_vertices = tmp_vertex_set_;
+  flat_hash_set<VertexId>& used_vertices = output->tmp_vertex_set;
   S2PolylineSimplifier simplifier;
   VertexId vstart = v0;
   bool done = false;
@@ -1848,12 +2401,12 @@ void S2Builder::EdgeChainSimplifier::SimplifyChain(VertexId v0, VertexId v1) {
              simplifier.Extend(g_.vertex(v1)));
 
     if (chain.size() == 2) {
-      OutputAllEdges(chain[0], chain[1]);  // Could not simplify.
+      OutputAllEdges(chain[0], chain[1], output);  // Could not simplify.
     } else {
-      MergeChain(chain);
+      MergeChain(chain, output);
     }
     // Note that any degenerate edges that were not merged into a chain are
-    // output by EdgeChainSimplifier::Run().
+    // output by EdgeChainSimplifier::OutputChains().
     chain.clear();
     used_vertices.clear();
   } while (!done);
@@ -1872,9 +2425,16 @@ S2Builder::Graph::VertexId S2Builder::EdgeChainSimplifier::FollowChain(
 }
 
 // Copies all input edges between v0 and v1 (in both directions) to the output.
-void S2Builder::EdgeChainSimplifier::OutputAllEdges(VertexId v0, VertexId v1) {
-  for (EdgeId e : out_.edge_ids(v0, v1)) OutputEdge(e);
-  for (EdgeId e : out_.edge_ids(v1, v0)) OutputEdge(e);
+void S2Builder::EdgeChainSimplifier::OutputAllEdges(
+    VertexId v0, VertexId v1, ChainOutput* output) const {
+  auto copy_edge = [this, output](EdgeId e) {
+    output->edges.push_back(g_.edge(e));
+    output->edge_layers.push_back(graph_edge_layer(e));
+    output->input_edge_ids.push_back(g_.input_edge_id_set_id(e));
+    output->is_merged.push_back(false);
+  };
+  for (EdgeId e : out_.edge_ids(v0, v1)) copy_edge(e);
+  for (EdgeId e : out_.edge_ids(v1, v0)) copy_edge(e);
 }
 
 // Ensures that the simplified edge passes within "edge_snap_radius" of all
@@ -1970,7 +2530,7 @@ bool S2Builder::EdgeChainSimplifier::AvoidSites(
 // there may be more than one copy of an edge chain (in either direction)
 // within a single layer.
 void S2Builder::EdgeChainSimplifier::MergeChain(
-    const vector<VertexId>& vertices) {
+    absl::Span<const VertexId> vertices, ChainOutput* output) const {
   // Suppose that all interior vertices have M outgoing edges and N incoming
   // edges.  Our goal is to group the edges into M outgoing chains and N
   // incoming chains, and then replace each chain by a single edge.
@@ -1999,25 +2559,24 @@ void S2Builder::EdgeChainSimplifier::MergeChain(
         for (InputEdgeId id : g_.input_edge_ids(e)) {
           degenerate_ids.push_back(id);
         }
-        used_[e] = true;
+        output->used_edges.push_back(e);
       }
     }
     // Because the edges were created in layer order, and all sorts used are
     // stable, the edges are still in layer order.  Therefore we can simply
-    // merge together all the edges in the same relative position.
+    // merge together all the edges in the same relative position.  (These
+    // edges were already marked as used by AddChainStart.)
     int j = 0;
     for (EdgeId e : out_edges) {
       for (InputEdgeId id : g_.input_edge_ids(e)) {
         merged_input_ids[j].push_back(id);
       }
-      used_[e] = true;
       ++j;
     }
     for (EdgeId e : in_edges) {
       for (InputEdgeId id : g_.input_edge_ids(e)) {
         merged_input_ids[j].push_back(id);
       }
-      used_[e] = true;
       ++j;
     }
     ABSL_DCHECK_EQ(merged_input_ids.size(), j);
@@ -2029,15 +2588,17 @@ void S2Builder::EdgeChainSimplifier::MergeChain(
   // Output the merged edges.
   VertexId v0 = vertices[0], v1 = vertices[1], vb = vertices.back();
   for (EdgeId e : out_.edge_ids(v0, v1)) {
-    new_edges_.push_back(Edge(v0, vb));
-    new_edge_layers_.push_back(graph_edge_layer(e));
+    output->edges.push_back(Edge(v0, vb));
+    output->edge_layers.push_back(graph_edge_layer(e));
   }
   for (EdgeId e : out_.edge_ids(v1, v0)) {
-    new_edges_.push_back(Edge(vb, v0));
-    new_edge_layers_.push_back(graph_edge_layer(e));
+    output->edges.push_back(Edge(vb, v0));
+    output->edge_layers.push_back(graph_edge_layer(e));
   }
-  for (const auto& ids : merged_input_ids) {
-    new_input_edge_ids_.push_back(input_edge_id_set_lexicon_->Add(ids));
+  for (auto& ids : merged_input_ids) {
+    output->input_edge_ids.push_back(IdSetLexicon::EmptySetId());
+    output->is_merged.push_back(true);
+    output->merged_input_ids.push_back(std::move(ids));
   }
 }
 
@@ -2129,6 +2690,17 @@ bool S2Builder::MemoryTracker::ClearEdgeSites(
   return Clear(edge_sites);
 }
 
+// Like ClearEdgeSites(), except that the vector elements are cleared but not
+// freed so that their memory can be reused.  This memory is tallied again by
+// TallyEdgeSites() if and when it is reused.
+bool S2Builder::MemoryTracker::RetainEdgeSites(
+    vector<compact_array<SiteId>>* edge_sites) {
+  Tally(-edge_sites_bytes_);
+  edge_sites_bytes_ = 0;
+  for (auto& sites : *edge_sites) sites.clear();
+  return ok();
+}
+
 // Called when a site is added to the S2PointIndex.
 bool S2Builder::MemoryTracker::TallyIndexedSite() {
   // S2PointIndex stores its data in a btree.  In general btree nodes are only
@@ -2185,12 +2757,15 @@ bool S2Builder::MemoryTracker::TallySimplifyEdgeChains(
   //  vector<Edge> new_edges_;                         // EdgeChainSimplifier
   //  vector<InputEdgeIdSetId> new_input_edge_ids_;    // EdgeChainSimplifier
   //  vector<int> new_edge_layers_;                    // EdgeChainSimplifier
+  //  vector<EdgeId> chain_starts;                     // EdgeChainSimplifier
+  //  ChainOutput::edges, edge_layers, input_edge_ids  // EdgeChainSimplifier
+  //   - at most one batch of edges, but tallied for all edges
   //
   // Note that the temporary vector<LayerEdgeId> in MergeLayerEdges() does not
   // affect peak usage.
-  const int64_t kTempPerEdge = sizeof(bool) + sizeof(EdgeId) +
-                               2 * sizeof(Edge) + 2 * sizeof(InputEdgeIdSetId) +
-                               2 * sizeof(int);
+  const int64_t kTempPerEdge = sizeof(bool) + 2 * sizeof(EdgeId) +
+                               3 * sizeof(Edge) + 3 * sizeof(InputEdgeIdSetId) +
+                               3 * sizeof(int);
   int64_t simplify_bytes = site_vertices.size() * kTempPerSite;
   for (const auto& array : site_vertices) {
     simplify_bytes += GetCompactArrayAllocBytes(array);
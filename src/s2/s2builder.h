@@ -25,6 +25,7 @@
 #include <cstdint>
 #include <functional>
 #include <memory>
+#include <memory_resource>
 #include <utility>
 #include <vector>
 
@@ -39,6 +40,7 @@
 #include "s2/mutable_s2shape_index.h"
 #include "s2/s1angle.h"
 #include "s2/s1chord_angle.h"
+#include "s2/s2builder_tracer.h"
 #include "s2/s2cell_id.h"
 #include "s2/s2edge_crossings.h"
 #include "s2/s2edge_distances.h"
@@ -265,6 +267,19 @@ class S2Builder {
     // distance from "x" is no greater than "snap_radius".
     virtual S2Point SnapPoint(const S2Point& point) const = 0;
 
+    // Snaps a batch of points, setting output[i] = SnapPoint(points[i]).
+    // The default implementation simply calls SnapPoint() for each point, but
+    // subclasses may override it with a faster version (e.g., one that
+    // hoists per-call setup out of the loop or reuses work for nearby input
+    // points).  S2Builder calls this method with runs of points sorted by
+    // S2CellId, so consecutive points are often close together.
+    //
+    // The results must be identical to calling SnapPoint() on each point.
+    //
+    // REQUIRES: output.size() == points.size()
+    virtual void SnapPoints(absl::Span<const S2Point> points,
+                            absl::Span<S2Point> output) const;
+
     // Returns a deep copy of this SnapFunction.
     virtual std::unique_ptr<SnapFunction> Clone() const = 0;
   };
@@ -443,6 +458,24 @@ class S2Builder {
     bool idempotent() const;
     void set_idempotent(bool idempotent);
 
+    // If true, input edges that have the same endpoints as an earlier input
+    // edge (in either direction) are snapped only once, and every copy is
+    // snapped to the same chain of sites (reversed as necessary).  This is
+    // useful when a coverage (such as a set of adjacent administrative
+    // regions) is built with one layer per polygon, since the boundary
+    // shared by two polygons is then snapped once rather than once per
+    // polygon.  It saves the time needed to find the sites near each copy,
+    // and guarantees that the two sides of a shared boundary are snapped
+    // identically even in the rare cases where the nearby sites are exactly
+    // equidistant from the edge endpoints.
+    //
+    // This option requires finding the duplicate edges, which is a waste of
+    // time if there aren't any.
+    //
+    // DEFAULT: false
+    bool snap_shared_edges_once() const;
+    void set_snap_shared_edges_once(bool snap_shared_edges_once);
+
     // Specifies that internal memory usage should be tracked using the given
     // S2MemoryTracker.  If a memory limit is specified and more more memory
     // than this is required then an error will be returned.  Example usage:
@@ -472,6 +505,79 @@ class S2Builder {
     S2MemoryTracker* memory_tracker() const;
     void set_memory_tracker(S2MemoryTracker* tracker);
 
+    // Specifies a memory resource from which the temporary data structures
+    // used internally by each Build() call are allocated (e.g., sorted
+    // vertex lists, snapped edge chains, and the scratch space used to
+    // simplify edge chains).  All such memory is released before Build()
+    // returns, so for example a std::pmr::monotonic_buffer_resource may be
+    // reset between calls in order to eliminate most of the allocator
+    // overhead of many small builds:
+    //
+    //   std::pmr::monotonic_buffer_resource arena;
+    //   S2Builder::Options options;
+    //   options.set_memory_resource(&arena);
+    //   S2Builder builder{options};
+    //   for (...) {
+    //     builder.StartLayer(...);
+    //     ...
+    //     builder.Build(&error);
+    //     arena.release();
+    //   }
+    //
+    // The resource must outlive every Build() call that uses it, and it is
+    // only used by the thread calling Build().  Note that the data passed to
+    // S2Builder layers (S2Builder::Graph and its edge vectors) is still
+    // allocated using std::allocator since it is part of the public API.
+    //
+    // DEFAULT: nullptr (uses std::pmr::get_default_resource())
+    std::pmr::memory_resource* memory_resource() const;
+    void set_memory_resource(std::pmr::memory_resource* resource);
+
+    // If true, the memory allocated for S2Builder's internal data structures
+    // is kept (cleared but not freed) after each Build() call so that it can
+    // be reused by the next one.  In addition to the input vertices, input
+    // edges, and Voronoi sites (which are always retained), this includes the
+    // list of nearby sites for each edge and the snapped edges passed to each
+    // layer's S2Builder::Graph.  When the same S2Builder is used for many
+    // small builds, this eliminates most allocations by S2Builder itself once
+    // the buffers have reached their steady-state size.  (The temporary
+    // S2ShapeIndex and S2PointIndex used during snapping are btree-based and
+    // are not retained.)
+    //
+    // Note that memory_tracker() measures memory while it is used by Build(),
+    // so retained memory is not necessarily counted between calls.
+    //
+    // DEFAULT: false
+    bool retain_capacity() const;
+    void set_retain_capacity(bool retain_capacity);
+
+    // The maximum number of threads (including the calling thread) that
+    // Build() uses to snap the input vertices, find the sites near each input
+    // edge, and snap the input edges to those sites.  These phases usually
+    // account for most of the running time when snapping is requested.  The
+    // output does not depend on the number of threads.
+    //
+    // Output layers that allow it (see Layer::allow_concurrent_build()) are
+    // also built concurrently, which is useful when there are many layers.
+    //
+    // When num_threads() > 1, snap_function().SnapPoint() may be called
+    // concurrently from several threads (this is safe for all the standard
+    // snap functions).  Similarly the output objects of layers that are built
+    // concurrently must not be shared between layers (e.g., a label set
+    // lexicon), and their IsFullPolygonPredicates may be called concurrently.
+    //
+    // DEFAULT: 1
+    int num_threads() const;
+    void set_num_threads(int num_threads);
+
+    // Specifies an object that is notified at the start and end of each
+    // phase of Build() (see s2builder_tracer.h), e.g. in order to measure the
+    // time spent in each phase.  The tracer must outlive the S2Builder.
+    //
+    // DEFAULT: nullptr (tracing disabled)
+    S2BuilderTracer* tracer() const;
+    void set_tracer(S2BuilderTracer* tracer);
+
     // Options may be assigned and copied.
     Options(const Options& options);
     Options& operator=(const Options& options);
@@ -482,7 +588,12 @@ class S2Builder {
     S1Angle intersection_tolerance_ = S1Angle::Zero();
     bool simplify_edge_chains_ = false;
     bool idempotent_ = true;
+    bool snap_shared_edges_once_ = false;
     S2MemoryTracker* memory_tracker_ = nullptr;
+    std::pmr::memory_resource* memory_resource_ = nullptr;
+    bool retain_capacity_ = false;
+    int num_threads_ = 1;
+    S2BuilderTracer* tracer_ = nullptr;
   };
 
   class Graph;
@@ -772,6 +883,7 @@ class S2Builder {
 
   //////////////////////  Internal Types  /////////////////////////
   class EdgeChainSimplifier;
+  class PhaseTrace;
 
   // MemoryTracker is a helper class to measure S2Builder memory usage.  It is
   // based on a detailed analysis of the data structures used.  This approach
@@ -798,6 +910,7 @@ class S2Builder {
     bool TallyEdgeSites(const gtl::compact_array<SiteId>& sites);
     bool ReserveEdgeSite(gtl::compact_array<SiteId>* sites);
     bool ClearEdgeSites(std::vector<gtl::compact_array<SiteId>>* edge_sites);
+    bool RetainEdgeSites(std::vector<gtl::compact_array<SiteId>>* edge_sites);
 
     bool TallyIndexedSite();
     bool FixSiteIndexTally(const S2PointIndex<SiteId>& index);
@@ -822,16 +935,30 @@ class S2Builder {
     int64_t filter_vertices_bytes_ = 0;
   };
 
+  // Temporary data structures allocated from options_.memory_resource().
+  template <class T>
+  using TempVector = std::pmr::vector<T>;
+  using SiteVertices = TempVector<gtl::compact_array<InputVertexId>>;
+  using InputEdgeIdSet = absl::flat_hash_set<
+      InputEdgeId, absl::flat_hash_set<InputEdgeId>::hasher,
+      absl::flat_hash_set<InputEdgeId>::key_equal,
+      std::pmr::polymorphic_allocator<InputEdgeId>>;
+
+  std::pmr::memory_resource* temp_resource() const;
   InputVertexId AddVertex(const S2Point& v);
   void ChooseSites();
+  bool IsAlreadySnapped();
   void ChooseAllVerticesAsSites();
-  std::vector<InputVertexKey> SortInputVertices();
+  TempVector<InputVertexKey> SortInputVertices();
   void AddEdgeCrossings(const MutableS2ShapeIndex& input_edge_index);
   void AddForcedSites(S2PointIndex<SiteId>* site_index);
   bool is_forced(SiteId v) const;
   void ChooseInitialSites(S2PointIndex<SiteId>* site_index);
   S2Point SnapSite(const S2Point& point) const;
+  void CheckSnappedSite(const S2Point& point, const S2Point& site) const;
   void CollectSiteEdges(const S2PointIndex<SiteId>& site_index);
+  void FindSharedEdges();
+  bool is_shared_copy(InputEdgeId e) const;
   void SortSitesByDistance(const S2Point& x,
                            gtl::compact_array<SiteId>* sites) const;
   void InsertSiteByDistance(SiteId new_site_id, const S2Point& x,
@@ -839,15 +966,15 @@ class S2Builder {
   void AddExtraSites(const MutableS2ShapeIndex& input_edge_index);
   void MaybeAddExtraSites(InputEdgeId edge_id, absl::Span<const SiteId> chain,
                           const MutableS2ShapeIndex& input_edge_index,
-                          absl::flat_hash_set<InputEdgeId>* edges_to_resnap);
+                          InputEdgeIdSet* edges_to_resnap);
   void AddExtraSite(const S2Point& new_site,
                     const MutableS2ShapeIndex& input_edge_index,
-                    absl::flat_hash_set<InputEdgeId>* edges_to_resnap);
+                    InputEdgeIdSet* edges_to_resnap);
   S2Point GetSeparationSite(const S2Point& site_to_avoid,
                             const S2Point& v0, const S2Point& v1,
                             InputEdgeId input_edge_id) const;
   S2Point GetCoverageEndpoint(const S2Point& p, const S2Point& n) const;
-  void SnapEdge(InputEdgeId e, std::vector<SiteId>* chain) const;
+  void SnapEdge(InputEdgeId e, TempVector<SiteId>* chain) const;
 
   void BuildLayers();
   void BuildLayerEdges(
@@ -857,16 +984,14 @@ class S2Builder {
   void AddSnappedEdges(
       InputEdgeId begin, InputEdgeId end, const GraphOptions& options,
       std::vector<Edge>* edges, std::vector<InputEdgeIdSetId>* input_edge_ids,
-      IdSetLexicon* input_edge_id_set_lexicon,
-      std::vector<gtl::compact_array<InputVertexId>>* site_vertices);
-  void MaybeAddInputVertex(
-      InputVertexId v, SiteId id,
-      std::vector<gtl::compact_array<InputVertexId>>* site_vertices) const;
+      IdSetLexicon* input_edge_id_set_lexicon, SiteVertices* site_vertices);
+  void MaybeAddInputVertex(InputVertexId v, SiteId id,
+                           SiteVertices* site_vertices) const;
   void AddSnappedEdge(SiteId src, SiteId dst, InputEdgeIdSetId id,
                       EdgeType edge_type, std::vector<Edge>* edges,
                       std::vector<InputEdgeIdSetId>* input_edge_ids) const;
   void SimplifyEdgeChains(
-      const std::vector<gtl::compact_array<InputVertexId>>& site_vertices,
+      const SiteVertices& site_vertices,
       std::vector<std::vector<Edge>>* layer_edges,
       std::vector<std::vector<InputEdgeIdSetId>>* layer_input_edge_ids,
       IdSetLexicon* input_edge_id_set_lexicon);
@@ -874,7 +999,7 @@ class S2Builder {
       absl::Span<const std::vector<Edge>> layer_edges,
       absl::Span<const std::vector<InputEdgeIdSetId>> layer_input_edge_ids,
       std::vector<Edge>* edges, std::vector<InputEdgeIdSetId>* input_edge_ids,
-      std::vector<int>* edge_layers) const;
+      TempVector<int>* edge_layers) const;
   static bool StableLessThan(const Edge& a, const Edge& b,
                              const LayerEdgeId& ai, const LayerEdgeId& bi);
 
@@ -981,6 +1106,19 @@ class S2Builder {
   // the "sites to avoid" (needed for simplification).
   std::vector<gtl::compact_array<SiteId>> edge_sites_;
 
+  // When options_.snap_shared_edges_once() is true, a map from each input
+  // edge to the first input edge with the same endpoints (in either
+  // direction).  Such edges are snapped to the same chain of sites.
+  std::vector<InputEdgeId> shared_edges_;
+
+  // The snapped edges for each layer and the lexicon for their input edge id
+  // sets.  These fields are only valid during BuildLayers(); they are members
+  // only so that their memory can be reused when options_.retain_capacity()
+  // is true.
+  std::vector<std::vector<Edge>> layer_edges_;
+  std::vector<std::vector<InputEdgeIdSetId>> layer_input_edge_ids_;
+  IdSetLexicon input_edge_id_set_lexicon_;
+
   // An object to track the memory usage of this class.
   MemoryTracker tracker_;
 
@@ -1243,6 +1381,15 @@ inline void S2Builder::Options::set_idempotent(bool idempotent) {
   idempotent_ = idempotent;
 }
 
+inline bool S2Builder::Options::snap_shared_edges_once() const {
+  return snap_shared_edges_once_;
+}
+
+inline void S2Builder::Options::set_snap_shared_edges_once(
+    bool snap_shared_edges_once) {
+  snap_shared_edges_once_ = snap_shared_edges_once;
+}
+
 inline S2MemoryTracker* S2Builder::Options::memory_tracker() const {
   return memory_tracker_;
 }
@@ -1252,6 +1399,39 @@ inline void S2Builder::Options::set_memory_tracker(
   memory_tracker_ = tracker;
 }
 
+inline std::pmr::memory_resource* S2Builder::Options::memory_resource() const {
+  return memory_resource_;
+}
+
+inline void S2Builder::Options::set_memory_resource(
+    std::pmr::memory_resource* resource) {
+  memory_resource_ = resource;
+}
+
+inline bool S2Builder::Options::retain_capacity() const {
+  return retain_capacity_;
+}
+
+inline void S2Builder::Options::set_retain_capacity(bool retain_capacity) {
+  retain_capacity_ = retain_capacity;
+}
+
+inline int S2Builder::Options::num_threads() const {
+  return num_threads_;
+}
+
+inline void S2Builder::Options::set_num_threads(int num_threads) {
+  num_threads_ = num_threads;
+}
+
+inline S2BuilderTracer* S2Builder::Options::tracer() const {
+  return tracer_;
+}
+
+inline void S2Builder::Options::set_tracer(S2BuilderTracer* tracer) {
+  tracer_ = tracer;
+}
+
 inline S2Builder::GraphOptions::EdgeType
 S2Builder::GraphOptions::edge_type() const {
   return edge_type_;
@@ -0,0 +1,114 @@
+// Copyright 2024 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "s2/s2builder.h"
+
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <random>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+#include "absl/log/absl_check.h"
+#include "s2/s2benchmark_testing.h"
+#include "s2/s2builderutil_lax_polygon_layer.h"
+#include "s2/s2builderutil_snap_functions.h"
+#include "s2/s2error.h"
+#include "s2/s2lax_polygon_shape.h"
+#include "s2/s2loop.h"
+
+using s2builderutil::IdentitySnapFunction;
+using s2builderutil::IntLatLngSnapFunction;
+using s2builderutil::S2CellIdSnapFunction;
+using std::make_unique;
+
+namespace {
+
+using s2benchmark::kSeed;
+
+void BenchmarkSnapping(benchmark::State& state,
+                       const S2Builder::SnapFunction& snap_function,
+                       std::pmr::monotonic_buffer_resource* arena = nullptr) {
+  std::mt19937_64 bitgen(kSeed);
+  std::unique_ptr<S2Loop> loop =
+      s2benchmark::MakeFractalLoop(bitgen, state.range(0));
+  S2Builder::Options options(snap_function);
+  options.set_memory_resource(arena);
+  for (auto _ : state) {
+    S2Builder builder{options};
+    S2LaxPolygonShape output;
+    builder.StartLayer(make_unique<s2builderutil::LaxPolygonLayer>(&output));
+    builder.AddLoop(*loop);
+    S2Error error;
+    ABSL_CHECK(builder.Build(&error)) << error;
+    benchmark::DoNotOptimize(output);
+    if (arena) arena->release();
+  }
+  state.SetItemsProcessed(state.iterations() * loop->num_vertices());
+}
+
+// Measures the time to rebuild a fractal loop without snapping, which is
+// dominated by edge crossing and sorting costs.
+void BM_S2BuilderIdentitySnap(benchmark::State& state) {
+  BenchmarkSnapping(state, IdentitySnapFunction());
+}
+BENCHMARK(BM_S2BuilderIdentitySnap)->Apply(s2benchmark::EdgeCounts);
+
+// Measures snapping a fractal loop to S2CellId centers.  The level is fine
+// enough that most vertices do not move, which is the typical case.
+void BM_S2BuilderS2CellIdSnap(benchmark::State& state) {
+  BenchmarkSnapping(state, S2CellIdSnapFunction(20));
+}
+BENCHMARK(BM_S2BuilderS2CellIdSnap)->Apply(s2benchmark::EdgeCounts);
+
+// Measures snapping a fractal loop to E7 lat/lng coordinates.
+void BM_S2BuilderIntLatLngSnap(benchmark::State& state) {
+  BenchmarkSnapping(state, IntLatLngSnapFunction(7));
+}
+BENCHMARK(BM_S2BuilderIntLatLngSnap)->Apply(s2benchmark::EdgeCounts);
+
+// Like BM_S2BuilderIntLatLngSnap, but allocates temporary data structures
+// from a monotonic arena that is released after each build.  The arena uses a
+// preallocated buffer so that it does not need to allocate memory itself.
+void BM_S2BuilderIntLatLngSnapArena(benchmark::State& state) {
+  std::vector<std::byte> buffer(1 << 24);
+  std::pmr::monotonic_buffer_resource arena(buffer.data(), buffer.size());
+  BenchmarkSnapping(state, IntLatLngSnapFunction(7), &arena);
+}
+BENCHMARK(BM_S2BuilderIntLatLngSnapArena)->Apply(s2benchmark::EdgeCounts);
+
+// Measures many small builds that reuse the same S2Builder, optionally
+// retaining its internal buffers between builds.
+void BM_S2BuilderReuse(benchmark::State& state) {
+  std::mt19937_64 bitgen(kSeed);
+  std::unique_ptr<S2Loop> loop =
+      s2benchmark::MakeFractalLoop(bitgen, state.range(0));
+  S2Builder::Options options{IntLatLngSnapFunction(7)};
+  options.set_retain_capacity(state.range(1));
+  S2Builder builder(options);
+  for (auto _ : state) {
+    S2LaxPolygonShape output;
+    builder.StartLayer(make_unique<s2builderutil::LaxPolygonLayer>(&output));
+    builder.AddLoop(*loop);
+    S2Error error;
+    ABSL_CHECK(builder.Build(&error)) << error;
+    benchmark::DoNotOptimize(output);
+  }
+  state.SetItemsProcessed(state.iterations() * loop->num_vertices());
+}
+BENCHMARK(BM_S2BuilderReuse)->ArgsProduct({{12, 48, 192}, {false, true}});
+
+}  // namespace
@@ -19,6 +19,7 @@
 
 #include <algorithm>
 #include <array>
+#include <cstddef>
 #include <cstdint>
 #include <limits>
 #include <numeric>
@@ -29,6 +30,7 @@
 #include "absl/log/absl_check.h"
 #include "absl/types/span.h"
 #include "s2/id_set_lexicon.h"
+#include "s2/internal/s2parallel.h"
 #include "s2/s2builder.h"
 #include "s2/s2error.h"
 #include "s2/s2memory_tracker.h"
@@ -66,15 +68,38 @@ Graph::Graph(const GraphOptions& options,
 }
 
 vector<Graph::EdgeId> Graph::GetInEdgeIds() const {
-  vector<EdgeId> in_edge_ids(num_edges());
-  std::iota(in_edge_ids.begin(), in_edge_ids.end(), 0);
-  std::sort(in_edge_ids.begin(), in_edge_ids.end(),
-            [this](EdgeId ai, EdgeId bi) {
-      return StableLessThan(reverse(edge(ai)), reverse(edge(bi)), ai, bi);
-    });
+  vector<EdgeId> in_edge_ids, in_edge_begins;
+  GetInEdgeIds(&in_edge_ids, &in_edge_begins);
   return in_edge_ids;
 }
 
+void Graph::GetInEdgeIds(vector<EdgeId>* in_edge_ids,
+                         vector<EdgeId>* in_edge_begins) const {
+  // Since the edges are sorted by (origin, destination), a counting sort by
+  // destination that visits the edges in order yields the edges sorted by
+  // (destination, origin) with ties broken by edge id.  This is the same
+  // order as sorting with StableLessThan() on the reversed edges.
+  in_edge_begins->assign(num_vertices() + 1, 0);
+  for (const Edge& e : edges()) ++(*in_edge_begins)[e.second];
+  EdgeId begin = 0;
+  for (EdgeId& count : *in_edge_begins) {
+    EdgeId degree = count;
+    count = begin;
+    begin += degree;
+  }
+  // Advancing each vertex's position as its edges are placed leaves
+  // (*in_edge_begins)[v] at the start of vertex (v + 1); this is corrected
+  // below.
+  in_edge_ids->resize(num_edges());
+  for (EdgeId e = 0; e < num_edges(); ++e) {
+    (*in_edge_ids)[(*in_edge_begins)[edge(e).second]++] = e;
+  }
+  for (VertexId v = num_vertices(); v > 0; --v) {
+    (*in_edge_begins)[v] = (*in_edge_begins)[v - 1];
+  }
+  (*in_edge_begins)[0] = 0;
+}
+
 vector<Graph::EdgeId> Graph::GetSiblingMap() const {
   vector<EdgeId> in_edge_ids = GetInEdgeIds();
   MakeSiblingMap(&in_edge_ids);
@@ -123,13 +148,7 @@ void Graph::VertexOutMap::Init(const Graph& g) {
 }
 
 void Graph::VertexInMap::Init(const Graph& g) {
-  in_edge_ids_ = g.GetInEdgeIds();
-  in_edge_begins_.reserve(g.num_vertices() + 1);
-  EdgeId e = 0;
-  for (VertexId v = 0; v <= g.num_vertices(); ++v) {
-    while (e < g.num_edges() && g.edge(in_edge_ids_[e]).second < v) ++e;
-    in_edge_begins_.push_back(e);
-  }
+  g.GetInEdgeIds(&in_edge_ids_, &in_edge_begins_);
 }
 
 void Graph::LabelFetcher::Init(const Graph& g, S2Builder::EdgeType edge_type) {
@@ -238,18 +257,57 @@ bool Graph::GetLeftTurnMap(absl::Span<const EdgeId> in_edge_ids,
   left_turn_map->assign(num_edges(), -1);
   if (num_edges() == 0) return true;
 
+  // Each vertex only creates entries for its own incoming edges, so ranges
+  // of vertices can be processed independently.  Each task processes
+  // approximately kTaskSize edges.
+  constexpr int kTaskSize = 8192;
+  const int num_tasks =
+      num_threads_ <= 1
+          ? 1
+          : min<int>(num_vertices(), (num_edges() + kTaskSize - 1) / kTaskSize);
+  vector<char> task_ok(num_tasks);  // Not vector<bool>, which isn't threadsafe.
+  s2internal::ParallelFor(num_threads_, num_tasks, [&](int task) {
+    const VertexId begin = int64_t{num_vertices()} * task / num_tasks;
+    const VertexId end = int64_t{num_vertices()} * (task + 1) / num_tasks;
+    task_ok[task] = AddLeftTurns(in_edge_ids, begin, end, left_turn_map);
+  });
+  if (std::find(task_ok.begin(), task_ok.end(), false) != task_ok.end() &&
+      error->ok()) {
+    *error = S2Error(S2Error::BUILDER_EDGES_DO_NOT_FORM_LOOPS,
+                     "Given edges do not form loops (indegree != outdegree)");
+  }
+  return error->ok();
+}
+
+bool Graph::AddLeftTurns(absl::Span<const EdgeId> in_edge_ids, VertexId begin,
+                         VertexId end, vector<EdgeId>* left_turn_map) const {
+  // Find the outgoing and incoming edges of the given vertices.
+  auto out_position = [this](VertexId v) -> EdgeId {
+    return std::lower_bound(edges().begin(), edges().end(), Edge(v, -1)) -
+           edges().begin();
+  };
+  auto in_position = [this, in_edge_ids](VertexId v) -> EdgeId {
+    return std::partition_point(
+               in_edge_ids.begin(), in_edge_ids.end(),
+               [this, v](EdgeId e) { return edge(e).second < v; }) -
+           in_edge_ids.begin();
+  };
+  int out = out_position(begin), in = in_position(begin);
+  const EdgeId out_limit = out_position(end), in_limit = in_position(end);
+
   // Declare vectors outside the loop to avoid reallocating them each time.
   vector<VertexEdge> v0_edges;
   vector<EdgeId> e_in, e_out;
+  bool ok = true;
 
   // Walk through the two sorted arrays of edges (outgoing and incoming) and
   // gather all the edges incident to each vertex.  Then we sort those edges
   // and add an entry to the left turn map from each incoming edge to the
   // immediately following outgoing edge in clockwise order.
-  int out = 0, in = 0;
-  const Edge* out_edge = &edge(out);
-  const Edge* in_edge = &edge(in_edge_ids[in]);
   Edge sentinel(num_vertices(), num_vertices());
+  const Edge* out_edge = (out == out_limit) ? &sentinel : &edge(out);
+  const Edge* in_edge =
+      (in == in_limit) ? &sentinel : &edge(in_edge_ids[in]);
   Edge min_edge = min(*out_edge, reverse(*in_edge));
   while (min_edge != sentinel) {
     // Gather all incoming and outgoing edges around vertex "v0".
@@ -259,10 +317,10 @@ bool Graph::GetLeftTurnMap(absl::Span<const EdgeId> in_edge_ids,
       // Count the number of copies of "min_edge" in each direction.
       int out_begin = out, in_begin = in;
       while (*out_edge == min_edge) {
-        out_edge = (++out == num_edges()) ? &sentinel : &edge(out);
+        out_edge = (++out == out_limit) ? &sentinel : &edge(out);
       }
       while (reverse(*in_edge) == min_edge) {
-        in_edge = (++in == num_edges()) ? &sentinel : &edge(in_edge_ids[in]);
+        in_edge = (++in == in_limit) ? &sentinel : &edge(in_edge_ids[in]);
       }
       if (v0 != v1) {
         AddVertexEdges(out_begin, out, in_begin, in, v1, &v0_edges);
@@ -307,15 +365,12 @@ bool Graph::GetLeftTurnMap(absl::Span<const EdgeId> in_edge_ids,
     }
     // We only need to process unmatched incoming edges, since we are only
     // responsible for creating left turn map entries for those edges.
-    if (!e_in.empty() && error->ok()) {
-      *error = S2Error(S2Error::BUILDER_EDGES_DO_NOT_FORM_LOOPS,
-                       "Given edges do not form loops (indegree != outdegree)");
-    }
+    if (!e_in.empty()) ok = false;
     e_in.clear();
     e_out.clear();
     v0_edges.clear();
   }
-  return error->ok();
+  return ok;
 }
 
 void Graph::CanonicalizeLoopOrder(absl::Span<const InputEdgeId> min_input_ids,
@@ -353,9 +408,10 @@ void Graph::CanonicalizeLoopOrder(absl::Span<const InputEdgeId> min_input_ids,
 }
 
 void Graph::CanonicalizeVectorOrder(absl::Span<const InputEdgeId> min_input_ids,
-                                    vector<vector<EdgeId>>* chains) {
-  std::sort(
-      chains->begin(), chains->end(),
+                                    vector<vector<EdgeId>>* chains,
+                                    int num_threads) {
+  s2internal::ParallelSort(
+      num_threads, chains->begin(), chains->end(),
       [min_input_ids](absl::Span<const EdgeId> a, absl::Span<const EdgeId> b) {
         // Comparison function ensures sort is stable.
         return make_pair(min_input_ids[a[0]], a[0]) <
@@ -379,6 +435,9 @@ bool Graph::GetDirectedLoops(LoopType loop_type, vector<EdgeLoop>* loops,
   if (loop_type == LoopType::SIMPLE) path_index.assign(num_vertices(), -1);
 
   // Visit edges in arbitrary order, and try to build a loop from each edge.
+  // The loops are canonicalized afterwards since this can be done in
+  // parallel.
+  const size_t first_loop = loops->size();
   vector<EdgeId> path;
   for (EdgeId start = 0; start < num_edges(); ++start) {
     if (left_turn_map[start] < 0) continue;
@@ -401,19 +460,21 @@ bool Graph::GetDirectedLoops(LoopType loop_type, vector<EdgeLoop>* loops,
         vector<EdgeId> loop(path.begin() + loop_start, path.end());
         path.erase(path.begin() + loop_start, path.end());
         for (EdgeId e2 : loop) path_index[edge(e2).first] = -1;
-        CanonicalizeLoopOrder(min_input_ids, &loop);
         loops->push_back(std::move(loop));
       }
     }
     if (loop_type == LoopType::SIMPLE) {
       ABSL_DCHECK(path.empty());  // Invariant.
     } else {
-      CanonicalizeLoopOrder(min_input_ids, &path);
       loops->push_back(std::move(path));
       path.clear();
     }
   }
-  CanonicalizeVectorOrder(min_input_ids, loops);
+  s2internal::ParallelFor(
+      num_threads_, loops->size() - first_loop, [&](int i) {
+        CanonicalizeLoopOrder(min_input_ids, &(*loops)[first_loop + i]);
+      });
+  CanonicalizeVectorOrder(min_input_ids, loops, num_threads_);
   return true;
 }
 
@@ -121,6 +121,15 @@ class S2Builder::Graph {
 
   const GraphOptions& options() const;
 
+  // The maximum number of threads that may be used by methods that assemble
+  // loops (e.g., GetDirectedLoops()).  S2Builder sets this to
+  // S2Builder::Options::num_threads() for the graphs passed to its layers.
+  // The results do not depend on this value.
+  //
+  // DEFAULT: 1
+  int num_threads() const;
+  void set_num_threads(int num_threads);
+
   // Returns the number of vertices in the graph.
   VertexId num_vertices() const;
 
@@ -451,10 +460,11 @@ class S2Builder::Graph {
   // Sorts the given edge chains (i.e., loops or polylines) by the minimum
   // input edge id of each chains's first edge.  This ensures that when the
   // output consists of multiple loops or polylines, they are sorted in the
-  // same order as they were provided in the input.
+  // same order as they were provided in the input.  Uses at most
+  // "num_threads" threads.
   static void CanonicalizeVectorOrder(
       absl::Span<const InputEdgeId> min_input_ids,
-      std::vector<std::vector<EdgeId>>* chains);
+      std::vector<std::vector<EdgeId>>* chains, int num_threads = 1);
 
   // A loop consisting of a sequence of edge ids.
   using EdgeLoop = std::vector<EdgeId>;
@@ -693,8 +703,22 @@ class S2Builder::Graph {
   class EdgeProcessor;
   class PolylineBuilder;
 
+  // Sets "in_edge_ids" to GetInEdgeIds(), and "in_edge_begins" to the
+  // position in that vector of the first incoming edge of each vertex
+  // followed by num_edges(), i.e. a compressed sparse row representation of
+  // the incoming edges.  Runs in O(num_vertices() + num_edges()) time.
+  void GetInEdgeIds(std::vector<EdgeId>* in_edge_ids,
+                    std::vector<EdgeId>* in_edge_begins) const;
+
+  // Adds the left turn map entries for the incoming edges of the vertices in
+  // the range [begin, end).  Returns false if some incoming edge could not
+  // be matched with an outgoing edge.  (See GetLeftTurnMap.)
+  bool AddLeftTurns(absl::Span<const EdgeId> in_edge_ids, VertexId begin,
+                    VertexId end, std::vector<EdgeId>* left_turn_map) const;
+
   GraphOptions options_;
   VertexId num_vertices_ = -1;  // Cached to avoid division by 24.
+  int num_threads_ = 1;
 
   const std::vector<S2Point>* vertices_ = nullptr;
   const std::vector<Edge>* edges_ = nullptr;
@@ -714,6 +738,14 @@ inline const S2Builder::GraphOptions& S2Builder::Graph::options() const {
   return options_;
 }
 
+inline int S2Builder::Graph::num_threads() const {
+  return num_threads_;
+}
+
+inline void S2Builder::Graph::set_num_threads(int num_threads) {
+  num_threads_ = num_threads;
+}
+
 inline S2Builder::Graph::VertexId S2Builder::Graph::num_vertices() const {
   return num_vertices_;  // vertices_.size() requires division by 24.
 }
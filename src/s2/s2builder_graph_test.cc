@@ -20,8 +20,10 @@
 
 #include "s2/s2builder_graph.h"
 
+#include <algorithm>
 #include <array>
 #include <memory>
+#include <numeric>
 #include <ostream>
 #include <string>
 #include <vector>
@@ -33,6 +35,7 @@
 #include "s2/s2builder_layer.h"
 #include "s2/s2builderutil_testing.h"
 #include "s2/s2error.h"
+#include "s2/s2latlng.h"
 #include "s2/s2lax_polyline_shape.h"
 #include "s2/s2point.h"
 #include "s2/s2text_format.h"
@@ -108,6 +111,60 @@ TEST(GetDirectedLoops, DegenerateEdges) {
   EXPECT_EQ(loops[2].size(), 2);
 }
 
+TEST(GetDirectedLoops, ResultsDoNotDependOnNumThreads) {
+  // Builds a grid of adjacent squares, so that most vertices have 8 incident
+  // edges and most edges have a sibling.  The graph is large enough that the
+  // left turn map is computed in several pieces.
+  GraphClone gc;
+  S2Builder builder{S2Builder::Options()};
+  GraphOptions graph_options(
+      EdgeType::DIRECTED, DegenerateEdges::DISCARD,
+      DuplicateEdges::KEEP, SiblingPairs::KEEP);
+  builder.StartLayer(make_unique<GraphCloningLayer>(graph_options, &gc));
+  auto grid_point = [](int i, int j) {
+    return S2LatLng::FromDegrees(0.1 * i, 0.1 * j).ToPoint();
+  };
+  for (int i = 0; i < 60; ++i) {
+    for (int j = 0; j < 60; ++j) {
+      builder.AddLoop(vector<S2Point>{grid_point(i, j), grid_point(i, j + 1),
+                                      grid_point(i + 1, j + 1),
+                                      grid_point(i + 1, j)});
+    }
+  }
+  S2Error error;
+  ASSERT_TRUE(builder.Build(&error)) << error;
+  Graph g = gc.graph();
+  ASSERT_GT(g.num_edges(), 10000);
+  for (LoopType loop_type : {LoopType::SIMPLE, LoopType::CIRCUIT}) {
+    vector<vector<vector<EdgeId>>> results;
+    for (int num_threads : {1, 4}) {
+      g.set_num_threads(num_threads);
+      vector<EdgeId> left_turn_map;
+      ASSERT_TRUE(g.GetLeftTurnMap(g.GetInEdgeIds(), &left_turn_map, &error));
+      EXPECT_EQ(std::count(left_turn_map.begin(), left_turn_map.end(), -1), 0);
+      vector<vector<EdgeId>> loops;
+      ASSERT_TRUE(g.GetDirectedLoops(loop_type, &loops, &error));
+      results.push_back(std::move(loops));
+    }
+    EXPECT_EQ(results[0].size(), 3600);
+    EXPECT_EQ(results[0], results[1]);
+  }
+
+  // Edges that do not form loops are reported regardless of which piece of
+  // the left turn map they belong to.
+  vector<Edge> edges = g.edges();
+  vector<InputEdgeIdSetId> input_edge_id_set_ids = g.input_edge_id_set_ids();
+  edges.pop_back();
+  input_edge_id_set_ids.pop_back();
+  Graph unbalanced(g.options(), &g.vertices(), &edges, &input_edge_id_set_ids,
+                   &g.input_edge_id_set_lexicon(),
+                   &g.label_set_ids(), &g.label_set_lexicon(), nullptr);
+  unbalanced.set_num_threads(4);
+  vector<vector<EdgeId>> loops;
+  EXPECT_FALSE(unbalanced.GetDirectedLoops(LoopType::CIRCUIT, &loops, &error));
+  EXPECT_EQ(error.code(), S2Error::BUILDER_EDGES_DO_NOT_FORM_LOOPS);
+}
+
 TEST(GetDirectedComponents, DegenerateEdges) {
   GraphClone gc;
   S2Builder builder{S2Builder::Options()};
@@ -159,6 +216,43 @@ TEST(S2BuilderGraph, BasicVertexOutApi) {
   }
 }
 
+TEST(S2BuilderGraph, InEdgeIdsMatchSortedOrder) {
+  // Checks GetInEdgeIds() and VertexInMap against sorting the edges, using a
+  // graph with duplicate and degenerate edges and isolated vertices.
+  GraphOptions options(EdgeType::DIRECTED, DegenerateEdges::KEEP,
+                       DuplicateEdges::KEEP, SiblingPairs::KEEP);
+  auto vertices = ParsePointsOrDie("0:0, 0:1, 1:1, 1:0, 2:2, 3:3");
+  vector<Edge> edges{{0, 1}, {0, 1}, {0, 3}, {1, 1}, {1, 2},
+                     {2, 0}, {2, 1}, {3, 0}, {3, 3}, {3, 3}};
+  vector<InputEdgeIdSetId> input_edge_id_set_ids(edges.size(), 0);
+  vector<LabelSetId> label_set_ids;
+  IdSetLexicon input_edge_id_set_lexicon, label_set_lexicon;
+  Graph graph{
+    options, &vertices, &edges, &input_edge_id_set_ids,
+    &input_edge_id_set_lexicon, &label_set_ids, &label_set_lexicon, nullptr};
+
+  vector<EdgeId> expected(edges.size());
+  std::iota(expected.begin(), expected.end(), 0);
+  std::sort(expected.begin(), expected.end(), [&](EdgeId a, EdgeId b) {
+    return Graph::StableLessThan(Graph::reverse(edges[a]),
+                                 Graph::reverse(edges[b]), a, b);
+  });
+  EXPECT_EQ(graph.GetInEdgeIds(), expected);
+
+  Graph::VertexInMap in(graph);
+  EXPECT_EQ(in.in_edge_ids(), expected);
+  int num_edges = 0;
+  for (VertexId v = 0; v < graph.num_vertices(); ++v) {
+    for (EdgeId e : in.edge_ids(v)) {
+      EXPECT_EQ(graph.edge(e).second, v);
+      EXPECT_EQ(e, expected[num_edges++]);
+    }
+  }
+  EXPECT_EQ(num_edges, edges.size());
+  EXPECT_EQ(in.degree(4), 0);
+  EXPECT_EQ(in.degree(5), 0);
+}
+
 TEST(GetUndirectedComponents, DegenerateEdges) {
   GraphClone gc;
   S2Builder builder{S2Builder::Options()};
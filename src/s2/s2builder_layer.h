@@ -47,6 +47,15 @@ class S2Builder::Layer {
   // from several layers and process them all at once (such as
   // s2builderutil::ClosedSetNormalizer).
   virtual void Build(const Graph& g, S2Error* error) = 0;
+
+  // Returns true if Build() may be called concurrently with the Build()
+  // methods of other layers that also return true, which S2Builder does when
+  // S2Builder::Options::num_threads() > 1.  This requires that Build() does
+  // not depend on the other layers having been built and does not modify
+  // any state shared with them.  Such layers are built before all other
+  // layers, while the remaining layers are built sequentially in the order
+  // they were added.
+  virtual bool allow_concurrent_build() const { return false; }
 };
 
 #endif  // S2_S2BUILDER_LAYER_H_
@@ -23,6 +23,7 @@
 #include <cstdint>
 #include <iostream>
 #include <memory>
+#include <memory_resource>
 #include <string>
 #include <utility>
 #include <vector>
@@ -72,17 +73,20 @@
 #include "s2/s2loop.h"
 #include "s2/s2memory_tracker.h"
 #include "s2/s2point.h"
+#include "s2/s2pointutil.h"
 #include "s2/s2polygon.h"
 #include "s2/s2polyline.h"
 #include "s2/s2predicates.h"
 #include "s2/s2random.h"
 #include "s2/s2testing.h"
 #include "s2/s2text_format.h"
+#include "s2/util/math/matrix3x3.h"
 
 using absl::StrAppend;
 using absl::StrCat;
 using absl::string_view;
 using s2builderutil::GraphClone;
+using s2builderutil::GraphCloningLayer;
 using s2builderutil::IdentitySnapFunction;
 using s2builderutil::IntLatLngSnapFunction;
 using s2builderutil::LaxPolylineLayer;
@@ -470,6 +474,37 @@ TEST(S2Builder, IdempotencyDoesNotSnapAdequatelySeparatedEdges) {
   EXPECT_EQ(expected, s2textformat::ToString(output2));
 }
 
+TEST(S2Builder, IdempotencyPreservesSnappedFractal) {
+  // Rebuilding the output of a previous snapping operation leaves it
+  // unchanged.  This exercises the check for already snapped input.
+  absl::BitGen bitgen(S2Testing::MakeTaggedSeedSeq(
+      "IDEMPOTENCY_PRESERVES_SNAPPED_FRACTAL",
+      absl::LogInfoStreamer(__FILE__, __LINE__).stream()));
+  S2Fractal fractal(bitgen);
+  fractal.SetLevelForApproxMaxEdges(5000);
+  S2Polygon input(
+      fractal.MakeLoop(s2random::Frame(bitgen), S1Angle::Degrees(10)));
+  for (int num_threads : {1, 4}) {
+    for (const S2Builder::Options& options :
+         {S2Builder::Options(S2CellIdSnapFunction(14)),
+          S2Builder::Options(IntLatLngSnapFunction(3))}) {
+      S2Builder::Options threaded_options = options;
+      threaded_options.set_num_threads(num_threads);
+      S2Builder builder(threaded_options);
+      S2Polygon output1, output2;
+      builder.StartLayer(make_unique<S2PolygonLayer>(&output1));
+      builder.AddPolygon(input);
+      S2Error error;
+      ASSERT_TRUE(builder.Build(&error)) << error;
+      builder.StartLayer(make_unique<S2PolygonLayer>(&output2));
+      builder.AddPolygon(output1);
+      ASSERT_TRUE(builder.Build(&error)) << error;
+      EXPECT_GT(output1.num_vertices(), 100);
+      EXPECT_TRUE(output1.Equals(output2));
+    }
+  }
+}
+
 TEST(S2Builder, NearbyVerticesSnappedWithZeroSnapRadiusEdgeSplitting) {
   // Verify that even when the split_crossing_edges() option is used with a snap
   // radius of zero, edges are snapped to nearby vertices (those within a
@@ -1046,6 +1081,335 @@ TEST(S2Builder, SimplifyPreservesTopology) {
   }
 }
 
+TEST(S2Builder, MultithreadedSimplifyMatches) {
+  // Simplifying edge chains with several threads produces the same output as
+  // with one thread.  There are enough chains to be split across tasks.
+  absl::BitGen bitgen(S2Testing::MakeTaggedSeedSeq(
+      "MULTITHREADED_SIMPLIFY_MATCHES",
+      absl::LogInfoStreamer(__FILE__, __LINE__).stream()));
+  const S1Angle kSnapRadius = S1Angle::Degrees(0.005);
+  vector<vector<S2Point>> polylines;
+  for (int i = 0; i < 3000; ++i) {
+    Matrix3x3_d frame = s2random::Frame(bitgen);
+    vector<S2Point>& vertices = polylines.emplace_back();
+    for (int j = 0; j < 20; ++j) {
+      S2LatLng ll = S2LatLng::FromDegrees(
+          absl::Uniform(bitgen, -1e-3, 1e-3), 0.01 * j);
+      vertices.push_back(S2::FromFrame(frame, ll.ToPoint()));
+    }
+  }
+  const auto build = [&](int num_threads, GraphClone* clone,
+                         S2Polygon* polygon) {
+    S2Builder::Options options((IdentitySnapFunction(kSnapRadius)));
+    options.set_simplify_edge_chains(true);
+    options.set_num_threads(num_threads);
+    S2Builder builder(options);
+    builder.StartLayer(make_unique<GraphCloningLayer>(
+        GraphOptions(EdgeType::DIRECTED, GraphOptions::DegenerateEdges::KEEP,
+                     GraphOptions::DuplicateEdges::KEEP,
+                     GraphOptions::SiblingPairs::KEEP),
+        clone));
+    for (const auto& vertices : polylines) {
+      builder.AddPolyline(S2Polyline(vertices));
+    }
+    builder.StartLayer(make_unique<S2PolygonLayer>(polygon));
+    builder.AddPolygon(S2Polygon(S2Loop::MakeRegularLoop(
+        S2Point(1, 0, 0), S1Angle::Degrees(5), 1000)));
+    S2Error error;
+    EXPECT_TRUE(builder.Build(&error)) << error;
+  };
+  GraphClone expected, actual;
+  S2Polygon expected_polygon, actual_polygon;
+  build(1, &expected, &expected_polygon);
+  build(4, &actual, &actual_polygon);
+  const Graph& g = expected.graph();
+  ASSERT_LT(g.num_edges(), 3000 * 19);  // Some chains were simplified.
+  ASSERT_EQ(g.edges(), actual.graph().edges());
+  for (Graph::EdgeId e = 0; e < g.num_edges(); ++e) {
+    auto ids = g.input_edge_ids(e);
+    auto actual_ids = actual.graph().input_edge_ids(e);
+    EXPECT_EQ(vector<InputEdgeId>(ids.begin(), ids.end()),
+              vector<InputEdgeId>(actual_ids.begin(), actual_ids.end()));
+  }
+  EXPECT_LT(expected_polygon.num_vertices(), 1000);
+  EXPECT_TRUE(expected_polygon.Equals(actual_polygon));
+}
+
+TEST(S2Builder, SnapSharedEdgesOnce) {
+  // Builds a coverage of adjacent quadrilaterals (one per layer) whose shared
+  // boundaries have many jittered vertices, and checks that snapping each
+  // shared edge once produces the same output.
+  absl::BitGen bitgen(S2Testing::MakeTaggedSeedSeq(
+      "SNAP_SHARED_EDGES_ONCE",
+      absl::LogInfoStreamer(__FILE__, __LINE__).stream()));
+  constexpr int kGridSize = 8, kEdgeVertices = 10;
+  const auto jitter = [&bitgen](double lat, double lng) {
+    return S2LatLng::FromDegrees(lat + absl::Uniform(bitgen, -0.03, 0.03),
+                                 lng + absl::Uniform(bitgen, -0.03, 0.03))
+        .ToPoint();
+  };
+  // The vertices of each grid edge, from the first grid point to the second.
+  vector<vector<vector<S2Point>>> horizontal(kGridSize + 1),
+      vertical(kGridSize + 1);
+  for (int i = 0; i <= kGridSize; ++i) {
+    for (int j = 0; j <= kGridSize; ++j) {
+      horizontal[i].emplace_back();
+      vertical[i].emplace_back();
+      for (int k = 0; k <= kEdgeVertices; ++k) {
+        const double t = static_cast<double>(k) / kEdgeVertices;
+        horizontal[i][j].push_back(
+            k == 0 || k == kEdgeVertices
+                ? S2LatLng::FromDegrees(i, j + t).ToPoint()
+                : jitter(i, j + t));
+        vertical[i][j].push_back(
+            k == 0 || k == kEdgeVertices
+                ? S2LatLng::FromDegrees(i + t, j).ToPoint()
+                : jitter(i + t, j));
+      }
+    }
+  }
+  vector<S2Polygon> input;
+  for (int i = 0; i < kGridSize; ++i) {
+    for (int j = 0; j < kGridSize; ++j) {
+      // Traverse the boundary of cell (i, j) counter-clockwise.
+      vector<S2Point> loop;
+      const auto add = [&loop](const vector<S2Point>& v, bool reverse) {
+        for (int k = 0; k < kEdgeVertices; ++k) {
+          loop.push_back(reverse ? v[kEdgeVertices - k] : v[k]);
+        }
+      };
+      add(horizontal[i][j], false);
+      add(vertical[i][j + 1], false);
+      add(horizontal[i + 1][j], true);
+      add(vertical[i][j], true);
+      input.emplace_back(make_unique<S2Loop>(loop));
+    }
+  }
+  const auto build = [&input](bool snap_shared_edges_once) {
+    S2Builder::Options options((IntLatLngSnapFunction(1)));
+    options.set_snap_shared_edges_once(snap_shared_edges_once);
+    S2Builder builder(options);
+    vector<S2Polygon> output(input.size());
+    for (size_t i = 0; i < input.size(); ++i) {
+      builder.StartLayer(make_unique<S2PolygonLayer>(&output[i]));
+      builder.AddPolygon(input[i]);
+    }
+    S2Error error;
+    EXPECT_TRUE(builder.Build(&error)) << error;
+    return output;
+  };
+  const vector<S2Polygon> expected = build(false);
+  const vector<S2Polygon> actual = build(true);
+  double area = 0;
+  S2Polygon coverage;
+  for (size_t i = 0; i < input.size(); ++i) {
+    EXPECT_FALSE(expected[i].Equals(input[i]));
+    EXPECT_TRUE(expected[i].Equals(actual[i])) << i;
+    area += actual[i].GetArea();
+    S2Polygon tmp;
+    tmp.InitToUnion(coverage, actual[i]);
+    coverage = std::move(tmp);
+  }
+  // The snapped polygons still form a coverage (with no overlaps).
+  EXPECT_NEAR(area, coverage.GetArea(), 1e-12);
+}
+
+// A memory resource that counts the allocations made through it.
+class CountingMemoryResource : public std::pmr::memory_resource {
+ public:
+  int64_t num_allocations() const { return num_allocations_; }
+  int64_t bytes_in_use() const { return bytes_in_use_; }
+
+ private:
+  void* do_allocate(size_t bytes, size_t alignment) override {
+    ++num_allocations_;
+    bytes_in_use_ += bytes;
+    return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+  }
+  void do_deallocate(void* p, size_t bytes, size_t alignment) override {
+    bytes_in_use_ -= bytes;
+    std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+  }
+  bool do_is_equal(const memory_resource& other) const noexcept override {
+    return this == &other;
+  }
+
+  int64_t num_allocations_ = 0;
+  int64_t bytes_in_use_ = 0;
+};
+
+// Snaps and simplifies two crossing loops using the given memory resource for
+// temporary storage, and returns the resulting polylines as a string.
+static string SnapCrossingLoops(std::pmr::memory_resource* resource) {
+  S2Builder::Options options((IdentitySnapFunction(S1Angle::Degrees(0.1))));
+  options.set_split_crossing_edges(true);
+  options.set_simplify_edge_chains(true);
+  options.set_memory_resource(resource);
+  S2Builder builder(options);
+  vector<unique_ptr<S2Polyline>> output;
+  builder.StartLayer(make_unique<S2PolylineVectorLayer>(&output));
+  for (double lng : {0.0, 3.0}) {
+    builder.AddLoop(*S2Loop::MakeRegularLoop(
+        S2LatLng::FromDegrees(0, lng).ToPoint(), S1Angle::Degrees(5), 500));
+  }
+  S2Error error;
+  EXPECT_TRUE(builder.Build(&error)) << error;
+  EXPECT_GT(output.size(), 1);
+  string result;
+  for (const auto& polyline : output) {
+    StrAppend(&result, s2textformat::ToString(*polyline), "\n");
+  }
+  return result;
+}
+
+TEST(S2Builder, MemoryResourceUsedForTemporaries) {
+  const string expected = SnapCrossingLoops(nullptr);
+  CountingMemoryResource resource;
+  EXPECT_EQ(SnapCrossingLoops(&resource), expected);
+  EXPECT_GT(resource.num_allocations(), 0);
+  // All temporary memory is released before Build() returns.
+  EXPECT_EQ(resource.bytes_in_use(), 0);
+}
+
+TEST(S2Builder, MonotonicMemoryResourceCanBeReleased) {
+  const string expected = SnapCrossingLoops(nullptr);
+  std::pmr::monotonic_buffer_resource arena;
+  for (int i = 0; i < 3; ++i) {
+    EXPECT_EQ(SnapCrossingLoops(&arena), expected);
+    arena.release();
+  }
+}
+
+TEST(S2Builder, RetainCapacityMatchesFreshBuilder) {
+  // Builds a sequence of inputs of varying sizes and numbers of layers with a
+  // single S2Builder, and checks that the results match those obtained using
+  // a new S2Builder each time.
+  S2Builder::Options options((IdentitySnapFunction(S1Angle::Degrees(0.1))));
+  options.set_split_crossing_edges(true);
+  options.set_simplify_edge_chains(true);
+  const auto build = [](S2Builder* builder, int num_layers,
+                        int num_vertices) {
+    vector<vector<unique_ptr<S2Polyline>>> output(num_layers);
+    for (int i = 0; i < num_layers; ++i) {
+      builder->StartLayer(make_unique<S2PolylineVectorLayer>(&output[i]));
+      for (double lng : {0.0, 3.0}) {
+        builder->AddLoop(*S2Loop::MakeRegularLoop(
+            S2LatLng::FromDegrees(i, lng).ToPoint(), S1Angle::Degrees(5),
+            num_vertices));
+      }
+    }
+    S2Error error;
+    EXPECT_TRUE(builder->Build(&error)) << error;
+    string result;
+    for (const auto& layer : output) {
+      for (const auto& polyline : layer) {
+        StrAppend(&result, s2textformat::ToString(*polyline), "\n");
+      }
+      StrAppend(&result, "--\n");
+    }
+    return result;
+  };
+  S2Builder::Options retain_options = options;
+  retain_options.set_retain_capacity(true);
+  S2Builder reused(retain_options);
+  for (auto [num_layers, num_vertices] :
+       {pair{1, 500}, pair{3, 50}, pair{2, 1000}, pair{1, 20}}) {
+    S2Builder fresh(options);
+    EXPECT_EQ(build(&reused, num_layers, num_vertices),
+              build(&fresh, num_layers, num_vertices));
+  }
+}
+
+TEST(S2Builder, RetainCapacityMemoryTracking) {
+  // Repeating the same build with retained capacity should not increase the
+  // tracked memory usage.
+  S2MemoryTracker tracker;
+  S2Builder::Options options((IdentitySnapFunction(S1Angle::Degrees(0.1))));
+  options.set_simplify_edge_chains(true);
+  options.set_retain_capacity(true);
+  options.set_memory_tracker(&tracker);
+  S2Builder builder(options);
+  int64_t usage_bytes = 0;
+  for (int i = 0; i < 3; ++i) {
+    S2Polygon output;
+    builder.StartLayer(make_unique<S2PolygonLayer>(&output));
+    builder.AddLoop(*S2Loop::MakeRegularLoop(S2Point(1, 0, 0),
+                                             S1Angle::Degrees(5), 1000));
+    S2Error error;
+    ASSERT_TRUE(builder.Build(&error)) << error;
+    if (i > 0) EXPECT_EQ(tracker.usage_bytes(), usage_bytes);
+    usage_bytes = tracker.usage_bytes();
+  }
+  EXPECT_GT(usage_bytes, 0);
+}
+
+TEST(S2Builder, MultithreadedBuildMatches) {
+  // Builds with several threads produce the same output as with one thread.
+  // The input is large enough to be processed in several batches.
+  absl::BitGen bitgen(S2Testing::MakeTaggedSeedSeq(
+      "MULTITHREADED_BUILD_MATCHES",
+      absl::LogInfoStreamer(__FILE__, __LINE__).stream()));
+  S2Fractal fractal(bitgen);
+  fractal.SetLevelForApproxMaxEdges(100'000);
+  fractal.set_fractal_dimension(1.5);
+  S2Polygon input(
+      fractal.MakeLoop(s2random::Frame(bitgen), S1Angle::Degrees(5)));
+  ASSERT_GT(input.num_vertices(), 70'000);
+  const auto build = [&](S2Builder::Options options, int num_threads) {
+    options.set_num_threads(num_threads);
+    S2Builder builder(options);
+    S2Polygon output;
+    builder.StartLayer(make_unique<S2PolygonLayer>(&output));
+    builder.AddPolygon(input);
+    S2Error error;
+    EXPECT_TRUE(builder.Build(&error)) << error;
+    return output;
+  };
+  S2Builder::Options options((S2CellIdSnapFunction(16)));
+  options.set_split_crossing_edges(true);
+  EXPECT_TRUE(build(options, 1).Equals(build(options, 4)));
+}
+
+TEST(S2Builder, MultithreadedLayersMatch) {
+  // Layers built concurrently produce the same output as when they are built
+  // sequentially, including when only some layers allow concurrent building
+  // and when a layer reports an error.
+  const auto build = [](int num_threads, vector<S2Polygon>* polygons,
+                        GraphClone* clone, S2Error* error) {
+    S2Builder::Options options((IntLatLngSnapFunction(1)));
+    options.set_num_threads(num_threads);
+    S2Builder builder(options);
+    for (size_t i = 0; i < polygons->size(); ++i) {
+      builder.StartLayer(make_unique<S2PolygonLayer>(&(*polygons)[i]));
+      builder.AddPolygon(*MakePolygonOrDie(absl::StrFormat(
+          "%d:0.02, %d.03:1, %d.98:1.01, %d.97:0", i, i, i, i)));
+    }
+    builder.StartLayer(make_unique<GraphCloningLayer>(
+        GraphOptions(EdgeType::DIRECTED, GraphOptions::DegenerateEdges::KEEP,
+                     GraphOptions::DuplicateEdges::KEEP,
+                     GraphOptions::SiblingPairs::KEEP),
+        clone));
+    builder.AddPolyline(*MakePolylineOrDie("20:20, 20:21.06"));
+    S2Polyline polyline;
+    builder.StartLayer(make_unique<S2PolylineLayer>(&polyline));
+    builder.AddPolyline(*MakePolylineOrDie("30:30, 30:31"));
+    builder.AddPolyline(*MakePolylineOrDie("32:32, 32:33"));
+    builder.Build(error);
+  };
+  vector<S2Polygon> expected(12), actual(12);
+  GraphClone expected_clone, actual_clone;
+  S2Error expected_error, actual_error;
+  build(1, &expected, &expected_clone, &expected_error);
+  build(4, &actual, &actual_clone, &actual_error);
+  for (size_t i = 0; i < expected.size(); ++i) {
+    EXPECT_EQ(expected[i].num_vertices(), 4);
+    EXPECT_TRUE(expected[i].Equals(actual[i])) << i;
+  }
+  EXPECT_EQ(expected_clone.graph().edges(), actual_clone.graph().edges());
+  EXPECT_EQ(expected_error.code(), S2Error::BUILDER_EDGES_DO_NOT_FORM_POLYLINE);
+  EXPECT_EQ(actual_error.code(), expected_error.code());
+}
+
 TEST(S2Builder, SimplifyRemovesSiblingPairs) {
   S2Builder::Options options(IntLatLngSnapFunction(0));  // E0 coords
   S2PolylineVectorLayer::Options layer_options;
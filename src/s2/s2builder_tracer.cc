@@ -0,0 +1,72 @@
+// Copyright 2024 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "s2/s2builder_tracer.h"
+
+#include <string>
+
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+
+using std::string;
+
+absl::string_view S2BuilderTracer::PhaseName(Phase phase) {
+  switch (phase) {
+    case Phase::CHOOSE_SITES:         return "CHOOSE_SITES";
+    case Phase::ADD_EDGE_CROSSINGS:   return "ADD_EDGE_CROSSINGS";
+    case Phase::ADD_EXTRA_SITES:      return "ADD_EXTRA_SITES";
+    case Phase::BUILD_LAYERS:         return "BUILD_LAYERS";
+    case Phase::SIMPLIFY_EDGE_CHAINS: return "SIMPLIFY_EDGE_CHAINS";
+    case Phase::BOOLEAN_OPERATION:    return "BOOLEAN_OPERATION";
+    case Phase::BUFFER_OPERATION:     return "BUFFER_OPERATION";
+  }
+  return "UNKNOWN";
+}
+
+void S2BuilderPhaseTimer::StartPhase(Phase phase, const Counts& counts) {
+  start_[static_cast<int>(phase)] = absl::Now();
+}
+
+void S2BuilderPhaseTimer::EndPhase(Phase phase, const Counts& counts) {
+  int i = static_cast<int>(phase);
+  total_time_[i] += absl::Now() - start_[i];
+  ++count_[i];
+}
+
+absl::Duration S2BuilderPhaseTimer::total_time(Phase phase) const {
+  return total_time_[static_cast<int>(phase)];
+}
+
+int S2BuilderPhaseTimer::count(Phase phase) const {
+  return count_[static_cast<int>(phase)];
+}
+
+void S2BuilderPhaseTimer::Clear() {
+  *this = S2BuilderPhaseTimer();
+}
+
+string S2BuilderPhaseTimer::ToString() const {
+  string result;
+  for (int i = 0; i < kNumPhases; ++i) {
+    if (count_[i] == 0) continue;
+    absl::StrAppend(&result, result.empty() ? "" : " ",
+                    PhaseName(static_cast<Phase>(i)), "=",
+                    absl::FormatDuration(total_time_[i]));
+    if (count_[i] > 1) absl::StrAppend(&result, "(x", count_[i], ")");
+  }
+  return result;
+}
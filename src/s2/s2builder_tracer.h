@@ -0,0 +1,150 @@
+// Copyright 2024 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef S2_S2BUILDER_TRACER_H_
+#define S2_S2BUILDER_TRACER_H_
+
+#include <cstdint>
+#include <string>
+
+#include "absl/strings/string_view.h"
+#include "absl/time/time.h"
+
+// S2BuilderTracer receives an event at the start and end of each phase of
+// S2Builder::Build(), and of the phases that S2BooleanOperation and
+// S2BufferOperation perform before handing their edges to S2Builder.  Its
+// purpose is to attribute the running time of large operations to specific
+// phases and inputs (e.g., a slow job might turn out to be dominated by
+// AddExtraSites because the input has many nearly-coincident vertices).
+//
+// A tracer is installed using the set_tracer() method of S2Builder::Options,
+// S2BooleanOperation::Options, S2WindingOperation::Options, or
+// S2BufferOperation::Options.  Events are always delivered on the thread
+// that called Build(), even when Options::num_threads() > 1.  Phases may be
+// nested (e.g., ADD_EXTRA_SITES is reported within CHOOSE_SITES), and a
+// phase may be reported more than once per operation (e.g., when an
+// operation builds several S2Builder instances).
+//
+// Example usage:
+//
+//   S2BuilderPhaseTimer timer;
+//   S2BooleanOperation::Options options;
+//   options.set_tracer(&timer);
+//   ...
+//   ABSL_LOG(INFO) << timer.ToString();
+class S2BuilderTracer {
+ public:
+  enum class Phase : uint8_t {
+    // S2Builder: snapping the input vertices and choosing the Voronoi sites.
+    // This phase includes ADD_EDGE_CROSSINGS and ADD_EXTRA_SITES.
+    CHOOSE_SITES,
+
+    // S2Builder: adding the crossings between input edges as new vertices
+    // (only when Options::split_crossing_edges() is true).
+    ADD_EDGE_CROSSINGS,
+
+    // S2Builder: adding extra sites to maintain topology while snapping.
+    ADD_EXTRA_SITES,
+
+    // S2Builder: snapping the input edges and building the output layers.
+    // This phase includes SIMPLIFY_EDGE_CHAINS.
+    BUILD_LAYERS,
+
+    // S2Builder: simplifying edge chains (only when
+    // Options::simplify_edge_chains() is true).
+    SIMPLIFY_EDGE_CHAINS,
+
+    // S2BooleanOperation: finding the crossings between the two input
+    // regions and selecting the edges of the result (which are then snapped
+    // by S2Builder).
+    BOOLEAN_OPERATION,
+
+    // S2BufferOperation: buffering the shapes passed to AddShapeIndex().
+    BUFFER_OPERATION,
+  };
+  static constexpr int kNumPhases = 7;
+
+  // The size of the problem at the time of each event.  Fields that are not
+  // meaningful for a given phase are zero.
+  struct Counts {
+    // The number of input vertices and edges.
+    int64_t num_input_vertices = 0;
+    int64_t num_input_edges = 0;
+
+    // The number of Voronoi sites chosen so far.
+    int64_t num_sites = 0;
+
+    // The number of edge crossings found by ADD_EDGE_CROSSINGS (reported by
+    // its end event).
+    int64_t num_edge_crossings = 0;
+  };
+
+  virtual ~S2BuilderTracer() = default;
+
+  // Called at the start and end of each phase.  The default implementations
+  // do nothing.
+  virtual void StartPhase(Phase phase, const Counts& counts) {}
+  virtual void EndPhase(Phase phase, const Counts& counts) {}
+
+  // Returns the name of the given phase, e.g. "CHOOSE_SITES".
+  static absl::string_view PhaseName(Phase phase);
+
+  // Reports the start of a phase when constructed and the end of the phase
+  // when destroyed (with the same counts).  Does nothing if "tracer" is null.
+  class ScopedPhase {
+   public:
+    ScopedPhase(S2BuilderTracer* tracer, Phase phase, const Counts& counts)
+        : tracer_(tracer), phase_(phase), counts_(counts) {
+      if (tracer_ != nullptr) tracer_->StartPhase(phase_, counts_);
+    }
+    ~ScopedPhase() {
+      if (tracer_ != nullptr) tracer_->EndPhase(phase_, counts_);
+    }
+
+    ScopedPhase(const ScopedPhase&) = delete;
+    ScopedPhase& operator=(const ScopedPhase&) = delete;
+
+   private:
+    S2BuilderTracer* tracer_;
+    Phase phase_;
+    Counts counts_;
+  };
+};
+
+// An S2BuilderTracer that accumulates the wall time spent in each phase.
+// Since phases may be nested, the times of different phases may overlap.
+class S2BuilderPhaseTimer : public S2BuilderTracer {
+ public:
+  void StartPhase(Phase phase, const Counts& counts) override;
+  void EndPhase(Phase phase, const Counts& counts) override;
+
+  // Returns the total time spent in the given phase, and the number of times
+  // that the phase was entered.
+  absl::Duration total_time(Phase phase) const;
+  int count(Phase phase) const;
+
+  // Resets all times and counts to zero.
+  void Clear();
+
+  // Returns a one-line summary of the phases that were entered at least once.
+  std::string ToString() const;
+
+ private:
+  absl::Time start_[kNumPhases];
+  absl::Duration total_time_[kNumPhases];
+  int count_[kNumPhases] = {};
+};
+
+#endif  // S2_S2BUILDER_TRACER_H_
@@ -0,0 +1,177 @@
+// Copyright 2024 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "s2/s2builder_tracer.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include "absl/time/time.h"
+#include "s2/s1angle.h"
+#include "s2/s2boolean_operation.h"
+#include "s2/s2buffer_operation.h"
+#include "s2/s2builder.h"
+#include "s2/s2builderutil_lax_polygon_layer.h"
+#include "s2/s2builderutil_s2polyline_vector_layer.h"
+#include "s2/s2builderutil_snap_functions.h"
+#include "s2/s2error.h"
+#include "s2/s2lax_polygon_shape.h"
+#include "s2/s2polyline.h"
+#include "s2/s2text_format.h"
+
+using s2textformat::MakeIndexOrDie;
+using s2textformat::MakePolylineOrDie;
+using std::make_unique;
+using std::unique_ptr;
+using std::vector;
+
+namespace {
+
+using Phase = S2BuilderTracer::Phase;
+
+// Records every event, and checks that phases are properly nested.
+class RecordingTracer : public S2BuilderTracer {
+ public:
+  struct Event {
+    Phase phase;
+    bool start;
+    Counts counts;
+  };
+
+  void StartPhase(Phase phase, const Counts& counts) override {
+    events_.push_back({phase, true, counts});
+    open_.push_back(phase);
+  }
+
+  void EndPhase(Phase phase, const Counts& counts) override {
+    events_.push_back({phase, false, counts});
+    ASSERT_FALSE(open_.empty());
+    EXPECT_EQ(open_.back(), phase);
+    open_.pop_back();
+  }
+
+  const vector<Event>& events() const { return events_; }
+  bool all_closed() const { return open_.empty(); }
+
+  // Returns the first event for the given phase and direction.
+  const Event* Find(Phase phase, bool start) const {
+    for (const Event& event : events_) {
+      if (event.phase == phase && event.start == start) return &event;
+    }
+    return nullptr;
+  }
+
+ private:
+  vector<Event> events_;
+  vector<Phase> open_;
+};
+
+TEST(S2BuilderTracer, BuilderReportsAllPhases) {
+  RecordingTracer tracer;
+  S2Builder::Options options(
+      s2builderutil::IdentitySnapFunction(S1Angle::Degrees(0.1)));
+  options.set_split_crossing_edges(true);
+  options.set_simplify_edge_chains(true);
+  options.set_tracer(&tracer);
+  S2Builder builder(options);
+  vector<unique_ptr<S2Polyline>> output;
+  builder.StartLayer(
+      make_unique<s2builderutil::S2PolylineVectorLayer>(&output));
+  builder.AddPolyline(*MakePolylineOrDie("0:-2, 0:-1, 0:1, 0:2"));
+  builder.AddPolyline(*MakePolylineOrDie("-2:0, -1:0, 1:0, 2:0"));
+  S2Error error;
+  ASSERT_TRUE(builder.Build(&error)) << error;
+  EXPECT_TRUE(tracer.all_closed());
+
+  for (Phase phase : {Phase::CHOOSE_SITES, Phase::ADD_EDGE_CROSSINGS,
+                      Phase::ADD_EXTRA_SITES, Phase::BUILD_LAYERS,
+                      Phase::SIMPLIFY_EDGE_CHAINS}) {
+    EXPECT_NE(tracer.Find(phase, true), nullptr)
+        << S2BuilderTracer::PhaseName(phase);
+  }
+  const auto* choose = tracer.Find(Phase::CHOOSE_SITES, true);
+  EXPECT_EQ(choose->counts.num_input_vertices, 8);
+  EXPECT_EQ(choose->counts.num_input_edges, 6);
+  EXPECT_EQ(choose->counts.num_sites, 0);
+  EXPECT_EQ(tracer.Find(Phase::ADD_EDGE_CROSSINGS, false)
+                ->counts.num_edge_crossings, 1);
+  EXPECT_GT(tracer.Find(Phase::CHOOSE_SITES, false)->counts.num_sites, 0);
+  EXPECT_EQ(tracer.Find(Phase::BOOLEAN_OPERATION, true), nullptr);
+}
+
+TEST(S2BuilderTracer, BooleanOperationForwardsTracer) {
+  auto a = MakeIndexOrDie("# # 0:0, 0:2, 2:2, 2:0");
+  auto b = MakeIndexOrDie("# # 1:1, 1:3, 3:3, 3:1");
+  RecordingTracer tracer;
+  S2BooleanOperation::Options options;
+  options.set_tracer(&tracer);
+  S2LaxPolygonShape result;
+  S2BooleanOperation op(S2BooleanOperation::OpType::UNION,
+                        make_unique<s2builderutil::LaxPolygonLayer>(&result),
+                        options);
+  S2Error error;
+  ASSERT_TRUE(op.Build(*a, *b, &error)) << error;
+  EXPECT_TRUE(tracer.all_closed());
+  ASSERT_FALSE(tracer.events().empty());
+  EXPECT_EQ(tracer.events().front().phase, Phase::BOOLEAN_OPERATION);
+  EXPECT_EQ(tracer.events().front().counts.num_input_edges, 8);
+  EXPECT_NE(tracer.Find(Phase::BUILD_LAYERS, true), nullptr);
+}
+
+TEST(S2BuilderTracer, BufferOperationForwardsTracer) {
+  auto index = MakeIndexOrDie("# 0:0, 0:1, 1:1 #");
+  RecordingTracer tracer;
+  S2BufferOperation::Options options(S1Angle::Degrees(0.1));
+  options.set_tracer(&tracer);
+  S2LaxPolygonShape result;
+  S2BufferOperation op(make_unique<s2builderutil::LaxPolygonLayer>(&result),
+                       options);
+  op.AddShapeIndex(*index);
+  S2Error error;
+  ASSERT_TRUE(op.Build(&error)) << error;
+  EXPECT_TRUE(tracer.all_closed());
+  const auto* buffer = tracer.Find(Phase::BUFFER_OPERATION, true);
+  ASSERT_NE(buffer, nullptr);
+  EXPECT_EQ(buffer->counts.num_input_edges, 2);
+  EXPECT_NE(tracer.Find(Phase::CHOOSE_SITES, true), nullptr);
+  EXPECT_NE(tracer.Find(Phase::BUILD_LAYERS, true), nullptr);
+}
+
+TEST(S2BuilderPhaseTimer, AccumulatesPhases) {
+  S2BuilderPhaseTimer timer;
+  S2BuilderTracer::Counts counts;
+  for (int i = 0; i < 2; ++i) {
+    S2BuilderTracer::ScopedPhase outer(&timer, Phase::CHOOSE_SITES, counts);
+    S2BuilderTracer::ScopedPhase inner(&timer, Phase::ADD_EXTRA_SITES, counts);
+  }
+  EXPECT_EQ(timer.count(Phase::CHOOSE_SITES), 2);
+  EXPECT_EQ(timer.count(Phase::ADD_EXTRA_SITES), 2);
+  EXPECT_EQ(timer.count(Phase::BUILD_LAYERS), 0);
+  EXPECT_GE(timer.total_time(Phase::CHOOSE_SITES),
+            timer.total_time(Phase::ADD_EXTRA_SITES));
+  EXPECT_EQ(timer.total_time(Phase::BUILD_LAYERS), absl::ZeroDuration());
+  std::string str = timer.ToString();
+  EXPECT_NE(str.find("CHOOSE_SITES="), std::string::npos);
+  EXPECT_NE(str.find("(x2)"), std::string::npos);
+  EXPECT_EQ(str.find("BUILD_LAYERS"), std::string::npos);
+
+  timer.Clear();
+  EXPECT_EQ(timer.count(Phase::CHOOSE_SITES), 0);
+  EXPECT_EQ(timer.ToString(), "");
+}
+
+}  // namespace
@@ -0,0 +1,73 @@
+// Copyright 2024 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "s2/s2builderutil_area_layer.h"
+
+#include <cmath>
+#include <vector>
+
+#include "s2/s2builder.h"
+#include "s2/s2builder_graph.h"
+#include "s2/s2error.h"
+#include "s2/s2loop_measures.h"
+#include "s2/s2point.h"
+#include "s2/s2point_span.h"
+
+using std::vector;
+
+using EdgeType = S2Builder::EdgeType;
+using Graph = S2Builder::Graph;
+using GraphOptions = S2Builder::GraphOptions;
+
+using DegenerateEdges = GraphOptions::DegenerateEdges;
+using DuplicateEdges = GraphOptions::DuplicateEdges;
+using SiblingPairs = GraphOptions::SiblingPairs;
+
+namespace s2builderutil {
+
+GraphOptions AreaLayer::graph_options() const {
+  // Degenerate edges and sibling pairs do not affect the area.
+  return GraphOptions(EdgeType::DIRECTED, DegenerateEdges::DISCARD,
+                      DuplicateEdges::KEEP, SiblingPairs::DISCARD);
+}
+
+void AreaLayer::Build(const Graph& g, S2Error* error) {
+  *area_ = 0;
+  if (g.num_edges() == 0) {
+    // The polygon is either full or empty.
+    if (g.IsFullPolygon(error)) *area_ = 4 * M_PI;
+    return;
+  }
+  vector<Graph::EdgeLoop> edge_loops;
+  if (!g.GetDirectedLoops(Graph::LoopType::SIMPLE, &edge_loops, error)) {
+    return;
+  }
+  // As in S2::GetArea(const S2Shape&), the loop areas are computed with
+  // S2::GetSignedArea() so that small polygons with holes do not suffer
+  // from cancellation error, and the sum is then reduced modulo 4*Pi.
+  double area = 0;
+  vector<S2Point> vertices;
+  for (const auto& edge_loop : edge_loops) {
+    vertices.clear();
+    for (Graph::EdgeId e : edge_loop) {
+      vertices.push_back(g.vertex(g.edge(e).first));
+    }
+    area += S2::GetSignedArea(S2PointLoopSpan(vertices));
+  }
+  if (area < 0.0) area += 4 * M_PI;
+  *area_ = area;
+}
+
+}  // namespace s2builderutil
@@ -0,0 +1,63 @@
+// Copyright 2024 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef S2_S2BUILDERUTIL_AREA_LAYER_H_
+#define S2_S2BUILDERUTIL_AREA_LAYER_H_
+
+#include "s2/s2builder.h"
+#include "s2/s2builder_graph.h"
+#include "s2/s2builder_layer.h"
+#include "s2/s2error.h"
+
+namespace s2builderutil {
+
+// A layer type that computes the area of the polygon formed by a set of
+// directed edges, without constructing the polygon itself.  The edges must
+// be oriented such that the polygon interior is to the left of all edges.
+//
+// This is useful in conjunction with S2BooleanOperation in order to compute
+// the area of an intersection, union, etc., since it is much faster than
+// building an S2Polygon (which requires constructing and validating S2Loops,
+// determining their nesting, etc.) and then calling GetArea().  Degenerate
+// boundaries have no area and are ignored.
+//
+// If the given edge graph is empty, the IsFullPolygonPredicate associated
+// with the edge graph is called to determine whether the area is zero or
+// 4*Pi.  (S2BooleanOperation specifies this predicate automatically.)
+//
+// Example usage:
+//
+//   double area;
+//   S2BooleanOperation op(S2BooleanOperation::OpType::INTERSECTION,
+//                         std::make_unique<s2builderutil::AreaLayer>(&area));
+//   S2Error error;
+//   if (!op.Build(a_index, b_index, &error)) { ... }
+class AreaLayer : public S2Builder::Layer {
+ public:
+  // Specifies that the area of the polygon should be stored in "area".
+  explicit AreaLayer(double* area) : area_(area) {}
+
+  // Layer interface:
+  GraphOptions graph_options() const override;
+  void Build(const Graph& g, S2Error* error) override;
+  bool allow_concurrent_build() const override { return true; }
+
+ private:
+  double* area_;
+};
+
+}  // namespace s2builderutil
+
+#endif  // S2_S2BUILDERUTIL_AREA_LAYER_H_
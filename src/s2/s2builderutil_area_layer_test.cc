@@ -0,0 +1,122 @@
+// Copyright 2024 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "s2/s2builderutil_area_layer.h"
+
+#include <cmath>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include "absl/log/log_streamer.h"
+#include "absl/random/random.h"
+#include "absl/strings/string_view.h"
+#include "s2/util/math/matrix3x3.h"
+#include "s2/s1angle.h"
+#include "s2/s2boolean_operation.h"
+#include "s2/s2builder.h"
+#include "s2/s2builderutil_s2polygon_layer.h"
+#include "s2/s2error.h"
+#include "s2/s2fractal.h"
+#include "s2/s2loop.h"
+#include "s2/s2polygon.h"
+#include "s2/s2random.h"
+#include "s2/s2testing.h"
+#include "s2/s2text_format.h"
+
+using absl::string_view;
+using s2builderutil::AreaLayer;
+using s2builderutil::S2PolygonLayer;
+using std::make_unique;
+using std::unique_ptr;
+using std::vector;
+
+using OpType = S2BooleanOperation::OpType;
+
+namespace {
+
+// Returns the area computed by AreaLayer for the given operation.
+double GetOperationArea(OpType op_type, const S2Polygon& a,
+                        const S2Polygon& b) {
+  double area = -1;
+  S2BooleanOperation op(op_type, make_unique<AreaLayer>(&area));
+  S2Error error;
+  EXPECT_TRUE(op.Build(a.index(), b.index(), &error)) << error;
+  return area;
+}
+
+// Returns the area of the S2Polygon built by S2PolygonLayer for the given
+// operation.
+double GetPolygonArea(OpType op_type, const S2Polygon& a, const S2Polygon& b) {
+  S2Polygon result;
+  S2BooleanOperation op(op_type, make_unique<S2PolygonLayer>(&result));
+  S2Error error;
+  EXPECT_TRUE(op.Build(a.index(), b.index(), &error)) << error;
+  return result.GetArea();
+}
+
+TEST(AreaLayer, Polygons) {
+  for (string_view str :
+       {"0:0, 0:10, 10:0", "0:0, 0:10, 10:10, 10:0; 2:2, 8:2, 5:5",
+        "0:0, 0:1, 1:0; 5:5, 5:6, 6:5"}) {
+    auto polygon = s2textformat::MakePolygonOrDie(str);
+    double area = -1;
+    S2Builder builder{S2Builder::Options()};
+    builder.StartLayer(make_unique<AreaLayer>(&area));
+    builder.AddPolygon(*polygon);
+    S2Error error;
+    ASSERT_TRUE(builder.Build(&error)) << error;
+    EXPECT_NEAR(polygon->GetArea(), area, 1e-15) << str;
+  }
+}
+
+TEST(AreaLayer, EmptyAndFull) {
+  auto empty = s2textformat::MakePolygonOrDie("");
+  auto full = s2textformat::MakePolygonOrDie("full");
+  auto triangle = s2textformat::MakePolygonOrDie("0:0, 0:10, 10:0");
+  EXPECT_EQ(0, GetOperationArea(OpType::INTERSECTION, *empty, *full));
+  EXPECT_EQ(4 * M_PI, GetOperationArea(OpType::UNION, *empty, *full));
+  EXPECT_EQ(0, GetOperationArea(OpType::DIFFERENCE, *triangle, *full));
+
+  // The complement of a small polygon has an area close to 4*Pi.
+  EXPECT_NEAR(4 * M_PI - triangle->GetArea(),
+              GetOperationArea(OpType::DIFFERENCE, *full, *triangle), 1e-14);
+}
+
+TEST(AreaLayer, MatchesS2PolygonLayer) {
+  absl::BitGen bitgen(S2Testing::MakeTaggedSeedSeq(
+      "AREA_LAYER", absl::LogInfoStreamer(__FILE__, __LINE__).stream()));
+  S2Fractal fractal(bitgen);
+  fractal.SetLevelForApproxMaxEdges(300);
+  for (int iter = 0; iter < 10; ++iter) {
+    const Matrix3x3_d frame = s2random::Frame(bitgen);
+    vector<unique_ptr<S2Loop>> loops;
+    loops.push_back(fractal.MakeLoop(frame, S1Angle::Degrees(5)));
+    loops.push_back(
+        S2Loop::MakeRegularLoop(frame.Col(2), S1Angle::Degrees(0.5), 10));
+    S2Polygon a, b;
+    a.InitNested(std::move(loops));
+    b.Init(fractal.MakeLoop(frame, S1Angle::Degrees(6)));
+    for (OpType op_type : {OpType::UNION, OpType::INTERSECTION,
+                           OpType::DIFFERENCE, OpType::SYMMETRIC_DIFFERENCE}) {
+      EXPECT_NEAR(GetPolygonArea(op_type, a, b),
+                  GetOperationArea(op_type, a, b), 1e-13)
+          << S2BooleanOperation::OpTypeToString(op_type);
+    }
+  }
+}
+
+}  // namespace
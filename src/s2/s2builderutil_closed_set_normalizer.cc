@@ -85,6 +85,18 @@ const vector<Graph>& ClosedSetNormalizer::Run(
   for (int dim = 0; dim < 3; ++dim) {
     ABSL_DCHECK(g[dim].options() == graph_options_in_[dim]);
   }
+  // Find the degenerate polygon edges and sibling pairs, and classify each
+  // edge as belonging to either a shell or a hole.
+  vector<PolygonDegeneracy> degeneracies = FindPolygonDegeneracies(g[2], error);
+
+  // In the common case where there are no polygon degeneracies, points, or
+  // polylines (e.g., when S2BooleanOperation builds a polygon), the graphs
+  // are already normalized.
+  if (degeneracies.empty() && g[0].num_edges() == 0 &&
+      g[1].num_edges() == 0) {
+    CopyGraphs(g);
+    return new_graphs_;
+  }
   if (options_.suppress_lower_dimensions()) {
     // Build the auxiliary data needed to suppress lower-dimensional edges.
     in_edges2_ = g[2].GetInEdgeIds();
@@ -101,7 +113,7 @@ const vector<Graph>& ClosedSetNormalizer::Run(
   }
 
   // Compute the edges that belong in the output graphs.
-  NormalizeEdges(g, error);
+  NormalizeEdges(g, degeneracies);
 
   // If any edges were added or removed, we need to run Graph::ProcessEdges to
   // ensure that the edges satisfy the requested GraphOptions.  Note that
@@ -117,15 +129,7 @@ const vector<Graph>& ClosedSetNormalizer::Run(
     modified[dim] = any_modified;
   }
   if (!any_modified) {
-    for (int dim = 0; dim < 3; ++dim) {
-      // Copy the graphs to ensure that they have the GraphOptions that were
-      // originally requested.
-      new_graphs_.push_back(Graph(
-          graph_options_out_[dim], &g[dim].vertices(), &g[dim].edges(),
-          &g[dim].input_edge_id_set_ids(), &g[dim].input_edge_id_set_lexicon(),
-          &g[dim].label_set_ids(), &g[dim].label_set_lexicon(),
-          g[dim].is_full_polygon_predicate()));
-    }
+    CopyGraphs(g);
   } else {
     // Make a copy of input_edge_id_set_lexicon() so that ProcessEdges can
     // merge edges if necessary.
@@ -141,11 +145,25 @@ const vector<Graph>& ClosedSetNormalizer::Run(
           &new_input_edge_ids_[dim], &new_input_edge_id_set_lexicon_,
           &g[dim].label_set_ids(), &g[dim].label_set_lexicon(),
           g[dim].is_full_polygon_predicate()));
+      new_graphs_.back().set_num_threads(g[dim].num_threads());
     }
   }
   return new_graphs_;
 }
 
+// Copies the input graphs unchanged except that they are given the
+// GraphOptions that were originally requested.
+void ClosedSetNormalizer::CopyGraphs(absl::Span<const Graph> g) {
+  for (int dim = 0; dim < 3; ++dim) {
+    new_graphs_.push_back(Graph(
+        graph_options_out_[dim], &g[dim].vertices(), &g[dim].edges(),
+        &g[dim].input_edge_id_set_ids(), &g[dim].input_edge_id_set_lexicon(),
+        &g[dim].label_set_ids(), &g[dim].label_set_lexicon(),
+        g[dim].is_full_polygon_predicate()));
+    new_graphs_.back().set_num_threads(g[dim].num_threads());
+  }
+}
+
 // Helper function that advances to the next edge in the given graph,
 // returning a sentinel value once all edges are exhausted.
 inline Edge ClosedSetNormalizer::Advance(const Graph& g, EdgeId* e) const {
@@ -161,11 +179,9 @@ inline Edge ClosedSetNormalizer::AdvanceIncoming(
               : Graph::reverse(g.edge(in_edges[*i])));
 }
 
-void ClosedSetNormalizer::NormalizeEdges(absl::Span<const Graph> g,
-                                         S2Error* error) {
-  // Find the degenerate polygon edges and sibling pairs, and classify each
-  // edge as belonging to either a shell or a hole.
-  auto degeneracies = FindPolygonDegeneracies(g[2], error);
+void ClosedSetNormalizer::NormalizeEdges(
+    absl::Span<const Graph> g,
+    absl::Span<const PolygonDegeneracy> degeneracies) {
   auto degeneracy = degeneracies.begin();
 
   // Walk through the three edge vectors performing a merge join.  We also
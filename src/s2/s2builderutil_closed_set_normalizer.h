@@ -133,7 +133,9 @@ class ClosedSetNormalizer {
   S2Builder::Graph::Edge AdvanceIncoming(
       const S2Builder::Graph& g,
       absl::Span<const S2Builder::Graph::EdgeId> in_edges, int* i) const;
-  void NormalizeEdges(absl::Span<const S2Builder::Graph> g, S2Error* error);
+  void CopyGraphs(absl::Span<const S2Builder::Graph> g);
+  void NormalizeEdges(absl::Span<const S2Builder::Graph> g,
+                      absl::Span<const PolygonDegeneracy> degeneracies);
   void AddEdge(int new_dim, const S2Builder::Graph& g,
                S2Builder::Graph::EdgeId e);
   bool is_suppressed(S2Builder::Graph::VertexId v) const;
@@ -24,6 +24,7 @@
 
 #include "absl/log/absl_check.h"
 #include "absl/log/absl_log.h"
+#include "s2/internal/s2parallel.h"
 #include "s2/mutable_s2shape_index.h"
 #include "s2/s2builder.h"
 #include "s2/s2builder_graph.h"
@@ -321,29 +322,42 @@ void DegeneracyFinder::ComputeUnknownSignsBruteForce(
 }
 
 // Like ComputeUnknownSignsBruteForce, except that this method uses an index
-// to find the set of edges that cross a given edge.
+// to find the set of edges that cross a given edge.  The components are
+// processed using up to g_.num_threads() threads.
 void DegeneracyFinder::ComputeUnknownSignsIndexed(
     VertexId known_vertex, int known_vertex_sign,
     vector<Component>* components) const {
   MutableS2ShapeIndex index;
   index.Add(make_unique<GraphShape>(&g_));
-  S2CrossingEdgeQuery query(&index);
-  vector<ShapeEdgeId> crossing_edges;
-  S2EdgeCrosser crosser;
-  for (Component& component : *components) {
-    if (component.root_sign != 0) continue;
-    bool inside = known_vertex_sign > 0;
-    crosser.Init(&g_.vertex(known_vertex), &g_.vertex(component.root));
-    query.GetCandidates(g_.vertex(known_vertex), g_.vertex(component.root), 0,
-                        *index.shape(0), &crossing_edges);
-    for (ShapeEdgeId id : crossing_edges) {
-      int e = id.edge_id;
-      if (is_edge_degeneracy_[e]) continue;
-      inside ^= crosser.EdgeOrVertexCrossing(&g_.vertex(g_.edge(e).first),
-                                             &g_.vertex(g_.edge(e).second));
+  index.ForceBuild();  // Required before querying from several threads.
+
+  // Each task processes a range of components so that the query and its
+  // temporary storage can be reused.
+  constexpr int kComponentsPerTask = 16;
+  const int num_components = components->size();
+  const int num_tasks =
+      (num_components + kComponentsPerTask - 1) / kComponentsPerTask;
+  s2internal::ParallelFor(g_.num_threads(), num_tasks, [&](int task) {
+    S2CrossingEdgeQuery query(&index);
+    vector<ShapeEdgeId> crossing_edges;
+    S2EdgeCrosser crosser;
+    const int end = std::min(num_components, (task + 1) * kComponentsPerTask);
+    for (int i = task * kComponentsPerTask; i < end; ++i) {
+      Component& component = (*components)[i];
+      if (component.root_sign != 0) continue;
+      bool inside = known_vertex_sign > 0;
+      crosser.Init(&g_.vertex(known_vertex), &g_.vertex(component.root));
+      query.GetCandidates(g_.vertex(known_vertex), g_.vertex(component.root),
+                          0, *index.shape(0), &crossing_edges);
+      for (ShapeEdgeId id : crossing_edges) {
+        int e = id.edge_id;
+        if (is_edge_degeneracy_[e]) continue;
+        inside ^= crosser.EdgeOrVertexCrossing(&g_.vertex(g_.edge(e).first),
+                                               &g_.vertex(g_.edge(e).second));
+      }
+      component.root_sign = inside ? 1 : -1;
     }
-    component.root_sign = inside ? 1 : -1;
-  }
+  });
 }
 
 // Merges the degeneracies from all components together, and computes the
@@ -363,6 +377,23 @@ vector<PolygonDegeneracy> DegeneracyFinder::MergeDegeneracies(
   return result;
 }
 
+// Returns true if "g" has any degenerate edges or sibling pairs.  This is
+// much cheaper than DegeneracyFinder::ComputeDegeneracies(), which requires
+// the incoming edge map, so it is used to quickly handle the common case
+// where there are no degeneracies.
+bool HasDegeneracies(const Graph& g) {
+  Graph::VertexOutMap out(g);
+  for (const Edge& edge : g.edges()) {
+    if (edge.first == edge.second) return true;
+    // Each sibling pair only needs to be checked once.
+    if (edge.first < edge.second &&
+        out.edges(edge.second, edge.first).size() > 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
 void CheckGraphOptions(const Graph& g) {
   ABSL_DCHECK(g.options().edge_type() == EdgeType::DIRECTED);
   ABSL_DCHECK(g.options().degenerate_edges() == DegenerateEdges::DISCARD ||
@@ -381,6 +412,7 @@ vector<PolygonDegeneracy> FindPolygonDegeneracies(const Graph& g,
       g.options().sibling_pairs() == SiblingPairs::DISCARD) {
     return {};  // All degeneracies have already been discarded.
   }
+  if (!HasDegeneracies(g)) return {};
   return DegeneracyFinder(&g).Run(error);
 }
 
@@ -119,8 +119,11 @@ void DegeneracyCheckingLayer::Build(const Graph& g, S2Error* error) {
 }
 
 void ExpectDegeneracies(string_view polygon_str,
-                        const vector<TestDegeneracy>& expected) {
-  S2Builder builder{S2Builder::Options()};
+                        const vector<TestDegeneracy>& expected,
+                        int num_threads = 1) {
+  S2Builder::Options options;
+  options.set_num_threads(num_threads);
+  S2Builder builder{options};
   builder.StartLayer(make_unique<DegeneracyCheckingLayer>(expected));
   auto polygon = s2textformat::MakeLaxPolygonOrDie(polygon_str);
   builder.AddIsFullPolygonPredicate(
@@ -180,6 +183,23 @@ TEST(FindPolygonDegeneracies, DegenerateHolesWithinLoop) {
     });
 }
 
+TEST(FindPolygonDegeneracies, ManyDegeneraciesWithThreads) {
+  // Enough isolated degeneracies that an index is used to classify them.
+  string polygon_str = "0:0, 0:10, 10:10, 10:0";
+  vector<TestDegeneracy> expected;
+  for (int i = 1; i < 10; ++i) {
+    for (int j = 1; j < 5; ++j) {
+      absl::StrAppend(&polygon_str, "; ", i, ":", j, "; ", i + 20, ":", j);
+      expected.push_back({absl::StrCat(i, ":", j, ", ", i, ":", j), true});
+      expected.push_back(
+          {absl::StrCat(i + 20, ":", j, ", ", i + 20, ":", j), false});
+    }
+  }
+  for (int num_threads : {1, 4}) {
+    ExpectDegeneracies(polygon_str, expected, num_threads);
+  }
+}
+
 TEST(FindPolygonDegeneracies, PointHoleWithinFull) {
   ExpectDegeneracies("full; 0:0", {{"0:0, 0:0", true}});
 }
@@ -187,10 +187,12 @@ void LaxPolygonLayer::BuildDirected(Graph g, S2Error* error) {
       // Construct a new graph that discards the unwanted edges.
       std::sort(edges_to_discard.begin(), edges_to_discard.end());
       DiscardEdges(g, edges_to_discard, &new_edges, &new_input_edge_id_set_ids);
+      const int num_threads = g.num_threads();
       g = Graph(g.options(), &g.vertices(),
                 &new_edges, &new_input_edge_id_set_ids,
                 &g.input_edge_id_set_lexicon(), &g.label_set_ids(),
                 &g.label_set_lexicon(), g.is_full_polygon_predicate());
+      g.set_num_threads(num_threads);
     }
   }
   vector<Graph::EdgeLoop> edge_loops;
@@ -0,0 +1,84 @@
+// Copyright 2024 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "s2/s2builderutil_polygon_pyramid.h"
+
+#include <cmath>
+#include <memory>
+#include <vector>
+
+#include "absl/log/absl_check.h"
+#include "absl/types/span.h"
+#include "s2/s2builder.h"
+#include "s2/s2builderutil_s2polygon_layer.h"
+#include "s2/s2error.h"
+#include "s2/s2polygon.h"
+
+using std::make_unique;
+using std::unique_ptr;
+using std::vector;
+
+namespace s2builderutil {
+
+bool BuildPolygonPyramid(
+    absl::Span<const S2Polygon* const> polygons,
+    absl::Span<const S2Builder::SnapFunction* const> snap_functions,
+    const S2Builder::Options& options,
+    vector<vector<unique_ptr<S2Polygon>>>* output, S2Error* error) {
+  ABSL_DCHECK(error != nullptr);
+  *error = S2Error::Ok();
+  output->clear();
+  for (size_t i = 1; i < snap_functions.size(); ++i) {
+    if (snap_functions[i]->snap_radius() <
+        snap_functions[i - 1]->snap_radius()) {
+      *error = S2Error::InvalidArgument(
+          "Snap functions must be sorted by non-decreasing snap radius");
+      return false;
+    }
+  }
+  // Each level is built from the previous one (or the original polygons).
+  absl::Span<const S2Polygon* const> input = polygons;
+  vector<const S2Polygon*> previous;
+  for (const S2Builder::SnapFunction* snap_function : snap_functions) {
+    S2Builder::Options level_options = options;
+    level_options.set_snap_function(*snap_function);
+    if (!output->empty()) {
+      // The previous level has no crossing edges.
+      level_options.set_split_crossing_edges(false);
+    }
+    S2Builder builder(level_options);
+    vector<unique_ptr<S2Polygon>>& level = output->emplace_back();
+    for (const S2Polygon* polygon : input) {
+      level.push_back(make_unique<S2Polygon>());
+      builder.StartLayer(make_unique<S2PolygonLayer>(level.back().get()));
+      builder.AddPolygon(*polygon);
+    }
+    if (!builder.Build(error)) return false;
+
+    // As with S2Polygon::InitToSnapped, a polygon with no loops is full if
+    // its input covered more than half the sphere.
+    for (size_t j = 0; j < input.size(); ++j) {
+      if (level[j]->num_loops() == 0 && input[j]->GetArea() > 2 * M_PI) {
+        level[j]->Invert();
+      }
+    }
+    previous.clear();
+    for (const auto& polygon : level) previous.push_back(polygon.get());
+    input = previous;
+  }
+  return true;
+}
+
+}  // namespace s2builderutil
@@ -0,0 +1,73 @@
+// Copyright 2024 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef S2_S2BUILDERUTIL_POLYGON_PYRAMID_H_
+#define S2_S2BUILDERUTIL_POLYGON_PYRAMID_H_
+
+#include <memory>
+#include <vector>
+
+#include "absl/types/span.h"
+#include "s2/s2builder.h"
+#include "s2/s2error.h"
+#include "s2/s2polygon.h"
+
+namespace s2builderutil {
+
+// Builds a "pyramid" of progressively coarser versions of a set of polygons,
+// e.g. for generating map tiles at several zoom levels.  "snap_functions"
+// must be sorted in order of non-decreasing snap radius (i.e., from the
+// finest level to the coarsest), and the polygons are snapped with each one
+// in turn.  On success (*output)[i][j] is polygon j snapped with
+// snap_functions[i].  All the polygons are built together at each level, so
+// that their topology is preserved (e.g., disjoint polygons remain disjoint).
+//
+// Rather than snapping the original polygons at every level, each level is
+// built from the output of the previous level.  This is much faster since
+// the input to each level is already snapped to the previous level (which
+// typically means many fewer vertices and no crossing edges, so that
+// split_crossing_edges() is only needed for the finest level).  Vertices may
+// move by up to the sum of the snap radii of all the levels so far, which for
+// snap functions whose snap radius doubles at each level (such as
+// S2CellIdSnapFunction) is less than twice the snap radius of the current
+// level.  Example usage:
+//
+//   vector<S2CellIdSnapFunction> snap_functions;
+//   for (int level = 20; level >= 5; --level) {
+//     snap_functions.emplace_back(level);
+//   }
+//   vector<const S2Builder::SnapFunction*> levels;
+//   for (const auto& f : snap_functions) levels.push_back(&f);
+//   vector<vector<unique_ptr<S2Polygon>>> pyramid;
+//   S2Error error;
+//   if (!s2builderutil::BuildPolygonPyramid(polygons, levels,
+//                                           S2Builder::Options(), &pyramid,
+//                                           &error)) {
+//     ...
+//   }
+//
+// "options" specifies the remaining S2Builder options; its snap function is
+// ignored.  Returns false and sets "error" if "snap_functions" is not sorted
+// or if building any level fails.
+bool BuildPolygonPyramid(
+    absl::Span<const S2Polygon* const> polygons,
+    absl::Span<const S2Builder::SnapFunction* const> snap_functions,
+    const S2Builder::Options& options,
+    std::vector<std::vector<std::unique_ptr<S2Polygon>>>* output,
+    S2Error* error);
+
+}  // namespace s2builderutil
+
+#endif  // S2_S2BUILDERUTIL_POLYGON_PYRAMID_H_
@@ -0,0 +1,124 @@
+// Copyright 2024 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "s2/s2builderutil_polygon_pyramid.h"
+
+#include <memory>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include "absl/log/log_streamer.h"
+#include "absl/random/random.h"
+#include "s2/s1angle.h"
+#include "s2/s1chord_angle.h"
+#include "s2/s2builder.h"
+#include "s2/s2builderutil_snap_functions.h"
+#include "s2/s2closest_edge_query.h"
+#include "s2/s2error.h"
+#include "s2/s2fractal.h"
+#include "s2/s2latlng.h"
+#include "s2/s2loop.h"
+#include "s2/s2point.h"
+#include "s2/s2pointutil.h"
+#include "s2/s2polygon.h"
+#include "s2/s2testing.h"
+
+using s2builderutil::BuildPolygonPyramid;
+using s2builderutil::IntLatLngSnapFunction;
+using s2builderutil::S2CellIdSnapFunction;
+using std::make_unique;
+using std::unique_ptr;
+using std::vector;
+
+namespace {
+
+TEST(BuildPolygonPyramid, LevelsAreSnappedAndDisjoint) {
+  absl::BitGen bitgen(S2Testing::MakeTaggedSeedSeq(
+      "LEVELS_ARE_SNAPPED_AND_DISJOINT",
+      absl::LogInfoStreamer(__FILE__, __LINE__).stream()));
+  // Two fractal loops that nearly touch, so that snapping them separately
+  // would make them overlap at the coarser levels.
+  S2Fractal fractal(bitgen);
+  fractal.SetLevelForApproxMaxEdges(1000);
+  vector<unique_ptr<S2Polygon>> input;
+  for (double lng : {-1.01, 1.01}) {
+    S2Point center = S2LatLng::FromDegrees(0, lng).ToPoint();
+    input.push_back(make_unique<S2Polygon>(
+        fractal.MakeLoop(S2::GetFrame(center), S1Angle::Degrees(1))));
+  }
+  ASSERT_FALSE(input[0]->Intersects(*input[1]));
+
+  vector<S2CellIdSnapFunction> snap_functions;
+  for (int level = 16; level >= 8; --level) snap_functions.emplace_back(level);
+  vector<const S2Builder::SnapFunction*> levels;
+  for (const auto& f : snap_functions) levels.push_back(&f);
+  S2Builder::Options options;
+  options.set_split_crossing_edges(true);
+  vector<vector<unique_ptr<S2Polygon>>> pyramid;
+  S2Error error;
+  ASSERT_TRUE(BuildPolygonPyramid({input[0].get(), input[1].get()}, levels,
+                                  options, &pyramid, &error))
+      << error;
+  ASSERT_EQ(pyramid.size(), levels.size());
+
+  S1Angle max_distance = S1Angle::Zero();
+  int num_vertices = input[0]->num_vertices() + input[1]->num_vertices();
+  for (size_t i = 0; i < pyramid.size(); ++i) {
+    ASSERT_EQ(pyramid[i].size(), 2);
+    max_distance += snap_functions[i].snap_radius();
+    for (int j = 0; j < 2; ++j) {
+      // Every output vertex is snapped, and is near the input boundary.
+      const S2Polygon& polygon = *pyramid[i][j];
+      EXPECT_FALSE(polygon.is_empty());
+      S2ClosestEdgeQuery query(&input[j]->index());
+      for (int k = 0; k < polygon.num_loops(); ++k) {
+        for (const S2Point& v : polygon.loop(k)->vertices_span()) {
+          EXPECT_EQ(snap_functions[i].SnapPoint(v), v);
+          S2ClosestEdgeQuery::PointTarget target(v);
+          EXPECT_TRUE(query.IsDistanceLessOrEqual(
+              &target, S1ChordAngle(max_distance)));
+        }
+      }
+    }
+    S2Polygon intersection;
+    intersection.InitToIntersection(*pyramid[i][0], *pyramid[i][1]);
+    EXPECT_TRUE(intersection.is_empty()) << i;
+    const int level_vertices =
+        pyramid[i][0]->num_vertices() + pyramid[i][1]->num_vertices();
+    EXPECT_LE(level_vertices, num_vertices);
+    num_vertices = level_vertices;
+  }
+}
+
+TEST(BuildPolygonPyramid, UnsortedSnapFunctions) {
+  S2Polygon polygon(S2Loop::MakeRegularLoop(S2Point(1, 0, 0),
+                                            S1Angle::Degrees(1), 10));
+  IntLatLngSnapFunction coarse(2), fine(4);
+  vector<vector<unique_ptr<S2Polygon>>> pyramid;
+  S2Error error;
+  EXPECT_FALSE(BuildPolygonPyramid({&polygon}, {&coarse, &fine},
+                                   S2Builder::Options(), &pyramid, &error));
+  EXPECT_EQ(error.code(), S2Error::INVALID_ARGUMENT);
+
+  EXPECT_TRUE(BuildPolygonPyramid({&polygon}, {&fine, &coarse},
+                                  S2Builder::Options(), &pyramid, &error))
+      << error;
+  ASSERT_EQ(pyramid.size(), 2);
+  EXPECT_TRUE(pyramid[1][0]->ApproxEquals(
+      polygon, S2Builder::Options(fine).max_edge_deviation() +
+                   S2Builder::Options(coarse).max_edge_deviation()));
+}
+
+}  // namespace
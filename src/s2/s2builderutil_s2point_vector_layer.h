@@ -65,6 +65,7 @@ class S2PointVectorLayer : public S2Builder::Layer {
   // Layer interface:
   GraphOptions graph_options() const override;
   void Build(const Graph& g, S2Error* error) override;
+  bool allow_concurrent_build() const override { return true; }
 
  private:
   std::vector<S2Point>* points_;
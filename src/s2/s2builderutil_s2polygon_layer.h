@@ -130,6 +130,7 @@ class S2PolygonLayer : public S2Builder::Layer {
   // Layer interface:
   GraphOptions graph_options() const override;
   void Build(const Graph& g, S2Error* error) override;
+  bool allow_concurrent_build() const override { return true; }
 
  private:
   void Init(S2Polygon* polygon, LabelSetIds* label_set_ids,
@@ -169,6 +169,7 @@ class S2PolylineVectorLayer : public S2Builder::Layer {
   // Layer interface:
   GraphOptions graph_options() const override;
   void Build(const Graph& g, S2Error* error) override;
+  bool allow_concurrent_build() const override { return true; }
 
  private:
   void Init(std::vector<std::unique_ptr<S2Polyline>>* polylines,
@@ -20,10 +20,12 @@
 #include <algorithm>
 #include <cfloat>
 #include <cmath>
+#include <cstddef>
 #include <cstdint>
 #include <memory>
 
 #include "absl/log/absl_check.h"
+#include "absl/types/span.h"
 #include "s2/s1angle.h"
 #include "s2/s2builder.h"
 #include "s2/s2cell_id.h"
@@ -75,6 +77,12 @@ S2Point IdentitySnapFunction::SnapPoint(const S2Point& point) const {
   return point;
 }
 
+void IdentitySnapFunction::SnapPoints(absl::Span<const S2Point> points,
+                                      absl::Span<S2Point> output) const {
+  ABSL_DCHECK_EQ(points.size(), output.size());
+  std::copy(points.begin(), points.end(), output.begin());
+}
+
 unique_ptr<S2Builder::SnapFunction> IdentitySnapFunction::Clone() const {
   return make_unique<IdentitySnapFunction>(*this);
 }
@@ -206,6 +214,21 @@ S2Point S2CellIdSnapFunction::SnapPoint(const S2Point& point) const {
   return S2CellId(point).parent(level_).ToPoint();
 }
 
+void S2CellIdSnapFunction::SnapPoints(absl::Span<const S2Point> points,
+                                      absl::Span<S2Point> output) const {
+  ABSL_DCHECK_EQ(points.size(), output.size());
+  S2CellId last_id = S2CellId::None();
+  S2Point last_center;
+  for (size_t i = 0; i < points.size(); ++i) {
+    S2CellId id = S2CellId(points[i]).parent(level_);
+    if (id != last_id) {
+      last_id = id;
+      last_center = id.ToPoint();
+    }
+    output[i] = last_center;
+  }
+}
+
 unique_ptr<S2Builder::SnapFunction> S2CellIdSnapFunction::Clone() const {
   return make_unique<S2CellIdSnapFunction>(*this);
 }
@@ -349,6 +372,33 @@ S2Point IntLatLngSnapFunction::SnapPoint(const S2Point& point) const {
   return S2LatLng::FromDegrees(lat * to_degrees_, lng * to_degrees_).ToPoint();
 }
 
+void IntLatLngSnapFunction::SnapPoints(absl::Span<const S2Point> points,
+                                       absl::Span<S2Point> output) const {
+  ABSL_DCHECK_GE(exponent_, 0);  // Make sure the snap function was initialized.
+  ABSL_DCHECK_EQ(points.size(), output.size());
+
+  // This computes the same values as S2LatLng::ToPoint(), but caches the
+  // trigonometric functions of the most recent latitude and longitude.
+  int64_t last_lat = 0, last_lng = 0;
+  S1Angle::SinCosPair phi{}, theta{};
+  for (size_t i = 0; i < points.size(); ++i) {
+    S2LatLng input(points[i]);
+    int64_t lat =
+        MathUtil::Round<int64_t>(input.lat().degrees() * from_degrees_);
+    int64_t lng =
+        MathUtil::Round<int64_t>(input.lng().degrees() * from_degrees_);
+    if (i == 0 || lat != last_lat) {
+      last_lat = lat;
+      phi = S1Angle::Degrees(lat * to_degrees_).SinCos();
+    }
+    if (i == 0 || lng != last_lng) {
+      last_lng = lng;
+      theta = S1Angle::Degrees(lng * to_degrees_).SinCos();
+    }
+    output[i] = S2Point(theta.cos * phi.cos, theta.sin * phi.cos, phi.sin);
+  }
+}
+
 unique_ptr<S2Builder::SnapFunction> IntLatLngSnapFunction::Clone() const {
   return make_unique<IntLatLngSnapFunction>(*this);
 }
@@ -20,6 +20,7 @@
 
 #include <memory>
 
+#include "absl/types/span.h"
 #include "s2/s1angle.h"
 #include "s2/s2builder.h"
 #include "s2/s2cell_id.h"
@@ -58,6 +59,8 @@ class IdentitySnapFunction : public S2Builder::SnapFunction {
   S1Angle min_edge_vertex_separation() const override;
 
   S2Point SnapPoint(const S2Point& point) const override;
+  void SnapPoints(absl::Span<const S2Point> points,
+                  absl::Span<S2Point> output) const override;
 
   std::unique_ptr<SnapFunction> Clone() const override;
 
@@ -136,6 +139,13 @@ class S2CellIdSnapFunction : public S2Builder::SnapFunction {
 
   S2Point SnapPoint(const S2Point& point) const override;
 
+  // Snaps a batch of points.  The center of the most recent snapped cell is
+  // reused when consecutive points snap to the same cell, which avoids most
+  // S2CellId::ToPoint() calls when the input is sorted and dense relative to
+  // the cell size.
+  void SnapPoints(absl::Span<const S2Point> points,
+                  absl::Span<S2Point> output) const override;
+
   std::unique_ptr<SnapFunction> Clone() const override;
 
  private:
@@ -227,6 +237,13 @@ class IntLatLngSnapFunction : public S2Builder::SnapFunction {
   // or more.
   S1Angle min_edge_vertex_separation() const override;
   S2Point SnapPoint(const S2Point& point) const override;
+
+  // Snaps a batch of points.  The sine and cosine of the most recent snapped
+  // latitude and longitude are reused, since consecutive points often share
+  // one or both rounded coordinates.
+  void SnapPoints(absl::Span<const S2Point> points,
+                  absl::Span<S2Point> output) const override;
+
   std::unique_ptr<SnapFunction> Clone() const override;
 
  private:
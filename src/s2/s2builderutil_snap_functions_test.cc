@@ -29,6 +29,7 @@
 #include <cmath>
 #include <cstdint>
 #include <cstdlib>
+#include <memory>
 #include <string>
 #include <utility>
 #include <vector>
@@ -43,12 +44,14 @@
 #include "absl/random/random.h"
 #include "absl/strings/str_format.h"
 #include "absl/strings/string_view.h"
+#include "absl/types/span.h"
 
 #include "s2/base/types.h"
 #include "s2/base/log_severity.h"
 #include "s2/r2.h"
 #include "s2/s1angle.h"
 #include "s2/s2builder.h"
+#include "s2/s2cap.h"
 #include "s2/s2cell.h"
 #include "s2/s2cell_id.h"
 #include "s2/s2edge_distances.h"
@@ -145,6 +148,44 @@ TEST(IntLatLngSnapFunction, SnapPoint) {
   }
 }
 
+// Checks that SnapPoints() returns the same results as SnapPoint() for
+// points that are clustered and sorted, so that consecutive points often snap
+// to the same site or share a rounded latitude or longitude.
+TEST(SnapFunction, SnapPointsMatchesSnapPoint) {
+  absl::BitGen bitgen(S2Testing::MakeTaggedSeedSeq(
+      "SNAP_POINTS",
+      absl::LogInfoStreamer(__FILE__, __LINE__).stream()));
+  vector<S2Point> points;
+  for (int i = 0; i < 50; ++i) {
+    S2Cap cap(s2random::Point(bitgen),
+              S1Angle::Radians(absl::Uniform(bitgen, 1e-7, 1e-2)));
+    for (int j = 0; j < 100; ++j) {
+      points.push_back(s2random::SamplePoint(bitgen, cap));
+    }
+  }
+  std::sort(points.begin(), points.end(),
+            [](const S2Point& a, const S2Point& b) {
+              return S2CellId(a) < S2CellId(b);
+            });
+  vector<std::unique_ptr<S2Builder::SnapFunction>> functions;
+  functions.push_back(std::make_unique<s2builderutil::IdentitySnapFunction>(
+      S1Angle::Degrees(1)));
+  for (int level : {0, 10, 20, S2CellId::kMaxLevel}) {
+    functions.push_back(std::make_unique<S2CellIdSnapFunction>(level));
+  }
+  for (int exponent = IntLatLngSnapFunction::kMinExponent;
+       exponent <= IntLatLngSnapFunction::kMaxExponent; ++exponent) {
+    functions.push_back(std::make_unique<IntLatLngSnapFunction>(exponent));
+  }
+  for (const auto& f : functions) {
+    vector<S2Point> output(points.size());
+    f->SnapPoints(points, absl::MakeSpan(output));
+    for (size_t i = 0; i < points.size(); ++i) {
+      ASSERT_EQ(f->SnapPoint(points[i]), output[i]);
+    }
+  }
+}
+
 // S2CellIdSnapFunction MinEdgeVertexSeparationForLevel has a difference of
 // 3.88e-8 between S2_DEBUG_MODE and non-S2_DEBUG_MODE results, but otherwise results
 // are the same within 1e-15.
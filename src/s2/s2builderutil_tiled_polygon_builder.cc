@@ -0,0 +1,117 @@
+// Copyright 2024 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "s2/s2builderutil_tiled_polygon_builder.h"
+
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "absl/log/absl_check.h"
+#include "absl/types/span.h"
+#include "s2/mutable_s2shape_index.h"
+#include "s2/s1angle.h"
+#include "s2/s2boolean_operation.h"
+#include "s2/s2builder.h"
+#include "s2/s2builderutil_lax_polygon_layer.h"
+#include "s2/s2cap.h"
+#include "s2/s2cell.h"
+#include "s2/s2cell_id.h"
+#include "s2/s2error.h"
+#include "s2/s2lax_polygon_shape.h"
+#include "s2/s2point.h"
+#include "s2/s2wrapped_shape.h"
+
+using std::make_unique;
+using std::unique_ptr;
+using std::vector;
+
+namespace s2builderutil {
+
+TiledPolygonBuilder::Options::Options() = default;
+
+TiledPolygonBuilder::Options::Options(
+    const S2Builder::SnapFunction& snap_function)
+    : builder_options_(snap_function) {}
+
+const S2Builder::Options& TiledPolygonBuilder::Options::builder_options()
+    const {
+  return builder_options_;
+}
+
+void TiledPolygonBuilder::Options::set_builder_options(
+    const S2Builder::Options& builder_options) {
+  builder_options_ = builder_options;
+}
+
+S1Angle TiledPolygonBuilder::Options::tile_margin() const {
+  if (tile_margin_ >= S1Angle::Zero()) return tile_margin_;
+  return 2 * (builder_options_.max_edge_deviation() +
+              builder_options_.snap_function().min_edge_vertex_separation());
+}
+
+void TiledPolygonBuilder::Options::set_tile_margin(S1Angle tile_margin) {
+  ABSL_DCHECK_GE(tile_margin, S1Angle::Zero());
+  tile_margin_ = tile_margin;
+}
+
+TiledPolygonBuilder::TiledPolygonBuilder(const Options& options)
+    : options_(options) {}
+
+bool TiledPolygonBuilder::Build(absl::Span<const S2CellId> tiles,
+                                const InputFunction& input,
+                                const OutputFunction& output,
+                                S2Error* error) const {
+  for (S2CellId tile : tiles) {
+    if (!BuildTile(tile, input, output, error)) return false;
+  }
+  return true;
+}
+
+bool TiledPolygonBuilder::BuildTile(S2CellId tile, const InputFunction& input,
+                                    const OutputFunction& output,
+                                    S2Error* error) const {
+  ABSL_DCHECK(error != nullptr);
+  *error = S2Error::Ok();
+  const S2Cell cell(tile);
+  const S2Cap bound = cell.GetCapBound();
+  const S2Cap region(bound.center(),
+                     bound.GetRadius() + options_.tile_margin());
+
+  // Snap all the polygons near the tile.
+  S2LaxPolygonShape snapped;
+  S2Builder builder(options_.builder_options());
+  builder.StartLayer(make_unique<LaxPolygonLayer>(&snapped));
+  if (!input(region, &builder, error)) return false;
+  if (!builder.Build(error)) return false;
+  if (snapped.num_loops() == 0) return true;
+
+  // Clip the result to the tile.  No further snapping is done, so that the
+  // vertices along the tile boundary are exact edge intersections.
+  MutableS2ShapeIndex snapped_index, tile_index;
+  snapped_index.Add(make_unique<S2WrappedShape>(&snapped));
+  vector<S2Point> tile_vertices;
+  for (int k = 0; k < 4; ++k) tile_vertices.push_back(cell.GetVertex(k));
+  tile_index.Add(make_unique<S2LaxPolygonShape>(
+      vector<absl::Span<const S2Point>>{tile_vertices}));
+  auto piece = make_unique<S2LaxPolygonShape>();
+  S2BooleanOperation op(S2BooleanOperation::OpType::INTERSECTION,
+                        make_unique<LaxPolygonLayer>(piece.get()));
+  if (!op.Build(snapped_index, tile_index, error)) return false;
+  if (piece->num_loops() == 0) return true;
+  return output(tile, std::move(piece), error);
+}
+
+}  // namespace s2builderutil
@@ -0,0 +1,145 @@
+// Copyright 2024 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef S2_S2BUILDERUTIL_TILED_POLYGON_BUILDER_H_
+#define S2_S2BUILDERUTIL_TILED_POLYGON_BUILDER_H_
+
+#include <functional>
+#include <memory>
+
+#include "absl/types/span.h"
+#include "s2/s1angle.h"
+#include "s2/s2builder.h"
+#include "s2/s2cap.h"
+#include "s2/s2cell_id.h"
+#include "s2/s2error.h"
+#include "s2/s2lax_polygon_shape.h"
+
+namespace s2builderutil {
+
+// TiledPolygonBuilder snaps a large collection of polygons one tile (S2Cell)
+// at a time, so that only the geometry near the current tile needs to be in
+// memory.  S2Builder itself buffers all of its input and then builds every
+// layer at once, which makes it unsuitable for inputs that are larger than
+// the available memory.
+//
+// For each tile, the client's InputFunction adds the polygons near the tile
+// to an S2Builder.  This includes every polygon within tile_margin() of the
+// tile, so that snapping near the tile boundary takes the geometry in the
+// neighboring tiles into account.  The snapped result is then clipped to the
+// tile and passed to the client's OutputFunction as an S2LaxPolygonShape.
+// Example usage:
+//
+//   s2builderutil::TiledPolygonBuilder::Options options(
+//       s2builderutil::IntLatLngSnapFunction(7));
+//   s2builderutil::TiledPolygonBuilder builder(options);
+//   S2Error error;
+//   if (!builder.Build(
+//           tiles,
+//           [&](const S2Cap& region, S2Builder* builder, S2Error* error) {
+//             for (const S2Polygon* polygon : store.Lookup(region)) {
+//               builder->AddPolygon(*polygon);
+//             }
+//             return true;
+//           },
+//           [&](S2CellId tile, std::unique_ptr<S2LaxPolygonShape> piece,
+//               S2Error* error) {
+//             return output.Write(tile, *piece, error);
+//           },
+//           &error)) {
+//     ...
+//   }
+//
+// Since each tile is snapped separately, the pieces emitted for adjacent
+// tiles are consistent only to the extent that snapping near their common
+// boundary makes the same decisions in both tiles.  When the input does not
+// need snapping (e.g. for IdentitySnapFunction with a zero snap radius, or
+// input that was already snapped with the same snap function), the pieces
+// meet along the tile boundaries up to the error in computing edge
+// intersections (S2::kIntersectionError).  Otherwise they may differ by up
+// to the snap radius along the tile boundaries.
+class TiledPolygonBuilder {
+ public:
+  class Options {
+   public:
+    Options();
+
+    // Convenience constructor that sets the snap function of
+    // builder_options().
+    explicit Options(const S2Builder::SnapFunction& snap_function);
+
+    // The options used to build each tile.
+    //
+    // DEFAULT: S2Builder::Options()
+    const S2Builder::Options& builder_options() const;
+    void set_builder_options(const S2Builder::Options& builder_options);
+
+    // The distance from each tile within which input polygons are included
+    // when that tile is built.  Geometry further away than
+    // max_edge_deviation() + min_edge_vertex_separation() cannot affect how
+    // an edge is snapped, but geometry within that distance is affected by
+    // further geometry in turn (e.g., when nearby vertices are merged).
+    //
+    // DEFAULT: 2 * (builder_options().max_edge_deviation() +
+    //               snap_function().min_edge_vertex_separation())
+    S1Angle tile_margin() const;
+    void set_tile_margin(S1Angle tile_margin);
+
+   private:
+    S2Builder::Options builder_options_;
+    S1Angle tile_margin_ = S1Angle::Radians(-1);  // Negative means default.
+  };
+
+  // Called once per tile to add the input polygons that intersect "region"
+  // (a cap containing the tile and its margin) to "builder".  Polygons must
+  // be added in full (e.g., using S2Builder::AddPolygon or AddShape), since
+  // the output is clipped to the tile after snapping.  Returns false (and
+  // sets "error") to stop building.
+  using InputFunction = std::function<bool(const S2Cap& region,
+                                           S2Builder* builder,
+                                           S2Error* error)>;
+
+  // Called once for each tile whose snapped geometry is non-empty, in the
+  // order that the tiles were given.  "piece" is the part of the output
+  // within "tile".  Returns false (and sets "error") to stop building.
+  using OutputFunction =
+      std::function<bool(S2CellId tile,
+                         std::unique_ptr<S2LaxPolygonShape> piece,
+                         S2Error* error)>;
+
+  explicit TiledPolygonBuilder(const Options& options = Options());
+
+  const Options& options() const { return options_; }
+
+  // Builds the given tiles one at a time.  The tiles should not overlap,
+  // and the output covers only the region they cover.  Returns false if an
+  // error occurs while building a tile (including errors returned by
+  // "input" or "output"), in which case the remaining tiles are not built.
+  bool Build(absl::Span<const S2CellId> tiles, const InputFunction& input,
+             const OutputFunction& output, S2Error* error) const;
+
+  // Like the above, but builds a single tile.  This method may be called
+  // concurrently from several threads (provided that "input" and "output"
+  // allow this), so that clients can build tiles in parallel.
+  bool BuildTile(S2CellId tile, const InputFunction& input,
+                 const OutputFunction& output, S2Error* error) const;
+
+ private:
+  Options options_;
+};
+
+}  // namespace s2builderutil
+
+#endif  // S2_S2BUILDERUTIL_TILED_POLYGON_BUILDER_H_
@@ -0,0 +1,182 @@
+// Copyright 2024 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "s2/s2builderutil_tiled_polygon_builder.h"
+
+#include <cmath>
+#include <memory>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include "absl/log/log_streamer.h"
+#include "absl/random/bit_gen_ref.h"
+#include "absl/random/random.h"
+#include "s2/s1angle.h"
+#include "s2/s1chord_angle.h"
+#include "s2/s2builder.h"
+#include "s2/s2builderutil_snap_functions.h"
+#include "s2/s2cap.h"
+#include "s2/s2cell.h"
+#include "s2/s2cell_id.h"
+#include "s2/s2edge_crossings.h"
+#include "s2/s2error.h"
+#include "s2/s2fractal.h"
+#include "s2/s2lax_polygon_shape.h"
+#include "s2/s2loop.h"
+#include "s2/s2pointutil.h"
+#include "s2/s2polygon.h"
+#include "s2/s2shape_measures.h"
+#include "s2/s2testing.h"
+
+using s2builderutil::S2CellIdSnapFunction;
+using s2builderutil::TiledPolygonBuilder;
+using std::make_unique;
+using std::unique_ptr;
+using std::vector;
+
+namespace {
+
+// Returns a few disjoint fractal polygons.
+vector<unique_ptr<S2Polygon>> MakeFractalPolygons(absl::BitGenRef bitgen) {
+  vector<unique_ptr<S2Polygon>> polygons;
+  S2Fractal fractal(bitgen);
+  fractal.SetLevelForApproxMaxEdges(2000);
+  for (int face = 0; face < 3; ++face) {
+    polygons.push_back(make_unique<S2Polygon>(fractal.MakeLoop(
+        S2::GetFrame(S2CellId::FromFace(face).ToPoint()),
+        S1Angle::Degrees(10))));
+  }
+  return polygons;
+}
+
+// Returns an InputFunction that adds the polygons whose bounds intersect the
+// given region.
+TiledPolygonBuilder::InputFunction PolygonInput(
+    const vector<unique_ptr<S2Polygon>>& polygons) {
+  return [&polygons](const S2Cap& region, S2Builder* builder, S2Error*) {
+    for (const auto& polygon : polygons) {
+      if (polygon->GetCapBound().Intersects(region)) {
+        builder->AddPolygon(*polygon);
+      }
+    }
+    return true;
+  };
+}
+
+// Builds the given polygons using all tiles at the given level, checks that
+// each piece is within its tile, and returns the total area of the pieces.
+double BuildTiles(const TiledPolygonBuilder& builder,
+                  const vector<unique_ptr<S2Polygon>>& polygons, int level) {
+  vector<S2CellId> tiles;
+  for (S2CellId id = S2CellId::Begin(level); id != S2CellId::End(level);
+       id = id.next()) {
+    tiles.push_back(id);
+  }
+  double area = 0;
+  S2Error error;
+  EXPECT_TRUE(builder.Build(
+      tiles, PolygonInput(polygons),
+      [&](S2CellId tile, unique_ptr<S2LaxPolygonShape> piece, S2Error*) {
+        const S2Cell cell(tile);
+        for (int i = 0; i < piece->num_loops(); ++i) {
+          for (int j = 0; j < piece->num_loop_vertices(i); ++j) {
+            EXPECT_LE(cell.GetDistance(piece->loop_vertex(i, j)),
+                      S1ChordAngle(S2::kIntersectionError));
+          }
+        }
+        area += S2::GetArea(*piece);
+        return true;
+      },
+      &error))
+      << error;
+  return area;
+}
+
+double TotalArea(const vector<unique_ptr<S2Polygon>>& polygons) {
+  double area = 0;
+  for (const auto& polygon : polygons) area += polygon->GetArea();
+  return area;
+}
+
+TEST(TiledPolygonBuilder, ZeroSnapRadiusPreservesArea) {
+  absl::BitGen bitgen(S2Testing::MakeTaggedSeedSeq(
+      "ZERO_SNAP_RADIUS_PRESERVES_AREA",
+      absl::LogInfoStreamer(__FILE__, __LINE__).stream()));
+  const auto polygons = MakeFractalPolygons(bitgen);
+  TiledPolygonBuilder builder;
+  EXPECT_NEAR(BuildTiles(builder, polygons, 3), TotalArea(polygons), 1e-12);
+}
+
+TEST(TiledPolygonBuilder, SnappedPiecesApproximateGlobalBuild) {
+  absl::BitGen bitgen(S2Testing::MakeTaggedSeedSeq(
+      "SNAPPED_PIECES_APPROXIMATE_GLOBAL_BUILD",
+      absl::LogInfoStreamer(__FILE__, __LINE__).stream()));
+  const auto polygons = MakeFractalPolygons(bitgen);
+  const S2CellIdSnapFunction snap_function(10);
+
+  // Snap all the polygons at once.
+  vector<unique_ptr<S2Polygon>> snapped;
+  for (const auto& polygon : polygons) {
+    snapped.push_back(make_unique<S2Polygon>());
+    snapped.back()->InitToSnapped(*polygon, snap_function);
+  }
+
+  // Building tiles from the original input is close to the global result,
+  // and building tiles from the snapped input matches it.
+  TiledPolygonBuilder builder{TiledPolygonBuilder::Options(snap_function)};
+  const double snapped_area = TotalArea(snapped);
+  EXPECT_NEAR(BuildTiles(builder, polygons, 3), snapped_area,
+              1e-3 * snapped_area);
+  EXPECT_NEAR(BuildTiles(builder, snapped, 3), snapped_area, 1e-12);
+}
+
+TEST(TiledPolygonBuilder, ErrorsStopBuild) {
+  const vector<S2CellId> tiles = {S2CellId::FromFace(0),
+                                  S2CellId::FromFace(1)};
+  TiledPolygonBuilder builder;
+  int num_calls = 0;
+  S2Error error;
+  EXPECT_FALSE(builder.Build(
+      tiles,
+      [&](const S2Cap&, S2Builder* builder, S2Error* error) {
+        ++num_calls;
+        *error = S2Error::DataLoss("Input unavailable");
+        return false;
+      },
+      [](S2CellId, unique_ptr<S2LaxPolygonShape>, S2Error*) { return true; },
+      &error));
+  EXPECT_EQ(num_calls, 1);
+  EXPECT_EQ(error.code(), S2Error::DATA_LOSS);
+
+  // Errors returned by the OutputFunction also stop the build.
+  vector<unique_ptr<S2Polygon>> polygons;
+  polygons.push_back(make_unique<S2Polygon>(make_unique<S2Loop>(
+      S2Cell(S2CellId::FromFace(0)))));
+  polygons.push_back(make_unique<S2Polygon>(make_unique<S2Loop>(
+      S2Cell(S2CellId::FromFace(1)))));
+  int num_pieces = 0;
+  EXPECT_FALSE(builder.Build(
+      tiles, PolygonInput(polygons),
+      [&](S2CellId tile, unique_ptr<S2LaxPolygonShape>, S2Error* error) {
+        ++num_pieces;
+        *error = S2Error::ResourceExhausted("Output full");
+        return false;
+      },
+      &error));
+  EXPECT_EQ(num_pieces, 1);
+  EXPECT_EQ(error.code(), S2Error::RESOURCE_EXHAUSTED);
+}
+
+}  // namespace
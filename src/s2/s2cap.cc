@@ -20,11 +20,13 @@
 #include <algorithm>
 #include <cfloat>
 #include <cmath>
+#include <cstddef>
 #include <ostream>
 #include <vector>
 
 #include "absl/flags/flag.h"
 #include "absl/log/absl_check.h"
+#include "absl/types/span.h"
 #include "s2/util/coding/coder.h"
 #include "s2/r1interval.h"
 #include "s2/s1angle.h"
@@ -297,6 +299,18 @@ bool S2Cap::Contains(const S2Point& p) const {
   return S1ChordAngle(center_, p) <= radius_;
 }
 
+void S2Cap::ContainsPoints(absl::Span<const S2Point> points,
+                           absl::Span<bool> results) const {
+  ABSL_DCHECK_EQ(points.size(), results.size());
+  // This is S1ChordAngle(center_, p) <= radius_ with the loop invariants
+  // hoisted out.
+  const S2Point center = center_;
+  const double length2 = radius_.length2();
+  for (size_t i = 0; i < points.size(); ++i) {
+    results[i] = std::min(4.0, (center - points[i]).Norm2()) <= length2;
+  }
+}
+
 bool S2Cap::InteriorContains(const S2Point& p) const {
   ABSL_DCHECK(S2::IsUnitLength(p));
   return is_full() || S1ChordAngle(center_, p) < radius_;
@@ -25,6 +25,7 @@
 #include <vector>
 
 #include "absl/log/absl_check.h"
+#include "absl/types/span.h"
 #include "s2/util/coding/coder.h"
 #include "s2/_fp_contract_off.h"  // IWYU pragma: keep
 #include "s2/s1angle.h"
@@ -192,6 +193,11 @@ class S2Cap final : public S2Region {
   // The point "p" should be a unit-length vector.
   bool Contains(const S2Point& p) const override;
 
+  // Like Contains(const S2Point&) for each point, but the loop has no
+  // branches or function calls so that the compiler can vectorize it.
+  void ContainsPoints(absl::Span<const S2Point> points,
+                      absl::Span<bool> results) const override;
+
   // Appends a serialized representation of the S2Cap to "encoder".
   //
   // REQUIRES: "encoder" uses the default constructor, so that its buffer
@@ -19,12 +19,15 @@
 
 #include <cfloat>
 #include <cmath>
+#include <cstddef>
 #include <string>
 #include <vector>
 
 #include <gtest/gtest.h>
+#include "absl/container/fixed_array.h"
 #include "absl/log/log_streamer.h"
 #include "absl/random/random.h"
+#include "absl/types/span.h"
 #include "s2/util/coding/coder.h"
 #include "s2/r1interval.h"
 #include "s2/s1angle.h"
@@ -34,6 +37,7 @@
 #include "s2/s2cell_id.h"
 #include "s2/s2coder_testing.h"
 #include "s2/s2coords.h"
+#include "s2/s2edge_distances.h"
 #include "s2/s2error.h"
 #include "s2/s2latlng.h"
 #include "s2/s2latlng_rect.h"
@@ -406,3 +410,30 @@ TEST(S2Cap, S2CoderWorks) {
   EXPECT_EQ(cap, decoded);
 }
 
+TEST(S2Cap, ContainsPointsMatchesContains) {
+  absl::BitGen bitgen(S2Testing::MakeTaggedSeedSeq(
+      "CONTAINS_POINTS_MATCHES_CONTAINS",
+      absl::LogInfoStreamer(__FILE__, __LINE__).stream()));
+  vector<S2Cap> caps = {S2Cap::Empty(), S2Cap::Full()};
+  for (int i = 0; i < 20; ++i) {
+    caps.push_back(S2Cap::FromCenterHeight(s2random::Point(bitgen),
+                                           absl::Uniform(bitgen, 0.0, 2.0)));
+  }
+  for (const S2Cap& cap : caps) {
+    // Test random points as well as points on the cap boundary.
+    vector<S2Point> points = {cap.center(), -cap.center()};
+    for (int i = 0; i < 100; ++i) {
+      points.push_back(s2random::Point(bitgen));
+      if (!cap.is_empty() && !cap.is_full()) {
+        S2Point dir = s2random::Point(bitgen).CrossProd(cap.center());
+        points.push_back(S2::GetPointOnRay(cap.center(), dir.Normalize(),
+                                           cap.radius().ToAngle()));
+      }
+    }
+    absl::FixedArray<bool> results(points.size());
+    cap.ContainsPoints(points, absl::MakeSpan(results));
+    for (size_t i = 0; i < points.size(); ++i) {
+      EXPECT_EQ(results[i], cap.Contains(points[i])) << cap << " " << points[i];
+    }
+  }
+}
@@ -20,9 +20,11 @@
 #include <algorithm>
 #include <cfloat>
 #include <cmath>
+#include <cstddef>
 #include <new>
 
 #include "absl/log/absl_check.h"
+#include "absl/types/span.h"
 #include "s2/util/coding/coder.h"
 #include "s2/r1interval.h"
 #include "s2/r2.h"
@@ -367,7 +369,8 @@ inline static S1ChordAngle EdgeDistance(double dirIJ, double uv) {
 }
 
 S1ChordAngle S2Cell::GetDistanceInternal(const S2Point& target_xyz,
-                                         bool to_interior) const {
+                                         bool to_interior,
+                                         const S2Point* uvw_vertices) const {
   // All calculations are done in the (u,v,w) coordinates of this cell's face.
   S2Point target = S2::FaceXYZtoUVW(face_, target_xyz);
 
@@ -412,6 +415,12 @@ S1ChordAngle S2Cell::GetDistanceInternal(const S2Point& target_xyz,
   // tests above, because (1) the edges don't meet at right angles and (2)
   // there are points on the far side of the sphere that are both above *and*
   // below the cell, etc.
+  if (uvw_vertices != nullptr) {
+    return min(min(S1ChordAngle(target, uvw_vertices[0]),
+                   S1ChordAngle(target, uvw_vertices[1])),
+               min(S1ChordAngle(target, uvw_vertices[2]),
+                   S1ChordAngle(target, uvw_vertices[3])));
+  }
   return min(min(VertexChordDist(target, 0, 0),
                  VertexChordDist(target, 1, 0)),
              min(VertexChordDist(target, 0, 1),
@@ -426,6 +435,32 @@ S1ChordAngle S2Cell::GetBoundaryDistance(const S2Point& target) const {
   return GetDistanceInternal(target, false /*to_interior*/);
 }
 
+void S2Cell::GetDistances(absl::Span<const S2Point> targets,
+                          absl::Span<S1ChordAngle> distances) const {
+  GetDistancesInternal(targets, true /*to_interior*/, distances);
+}
+
+void S2Cell::GetBoundaryDistances(absl::Span<const S2Point> targets,
+                                  absl::Span<S1ChordAngle> distances) const {
+  GetDistancesInternal(targets, false /*to_interior*/, distances);
+}
+
+void S2Cell::GetDistancesInternal(absl::Span<const S2Point> targets,
+                                  bool to_interior,
+                                  absl::Span<S1ChordAngle> distances) const {
+  ABSL_DCHECK_EQ(targets.size(), distances.size());
+  // These are the same vertices computed by VertexChordDist().
+  S2Point uvw_vertices[4];
+  for (int j = 0; j < 2; ++j) {
+    for (int i = 0; i < 2; ++i) {
+      uvw_vertices[2 * j + i] = S2Point(uv_[0][i], uv_[1][j], 1).Normalize();
+    }
+  }
+  for (size_t k = 0; k < targets.size(); ++k) {
+    distances[k] = GetDistanceInternal(targets[k], to_interior, uvw_vertices);
+  }
+}
+
 S1ChordAngle S2Cell::GetMaxDistance(const S2Point& target) const {
   // First check the 4 cell vertices.  If all are within the hemisphere
   // centered around target, the max distance will be to one of these vertices.
@@ -22,6 +22,8 @@
 #include <cstdint>
 #include <vector>
 
+#include "absl/types/span.h"
+
 #include "s2/_fp_contract_off.h"  // IWYU pragma: keep
 #include "s2/r2rect.h"
 #include "s2/s1chord_angle.h"
@@ -220,6 +222,18 @@ class S2Cell final : public S2Region {
   // Return the distance from the cell boundary to the given point.
   S1ChordAngle GetBoundaryDistance(const S2Point& target) const;
 
+  // Batch versions of GetDistance(S2Point) and GetBoundaryDistance(S2Point)
+  // that set distances[i] to the distance to targets[i].  The results are
+  // identical to calling the single-point methods, but work that depends only
+  // on the cell (such as normalizing its vertices) is done once per call
+  // rather than once per target.
+  //
+  // REQUIRES: distances.size() == targets.size()
+  void GetDistances(absl::Span<const S2Point> targets,
+                    absl::Span<S1ChordAngle> distances) const;
+  void GetBoundaryDistances(absl::Span<const S2Point> targets,
+                            absl::Span<S1ChordAngle> distances) const;
+
   // Returns the maximum distance from the cell (including its interior) to the
   // given point.
   S1ChordAngle GetMaxDistance(const S2Point& target) const;
@@ -282,9 +296,18 @@ class S2Cell final : public S2Region {
   bool VEdgeIsClosest(const S2Point& target, int u_end) const;
 
   // Returns the distance from the given point to the interior of the cell if
-  // "to_interior" is true, and to the boundary of the cell otherwise.
-  S1ChordAngle GetDistanceInternal(const S2Point& target_xyz,
-                                   bool to_interior) const;
+  // "to_interior" is true, and to the boundary of the cell otherwise.  If
+  // "uvw_vertices" is not nullptr, it contains the four unit-length cell
+  // vertices in the (u,v,w) coordinates of this cell's face, in the order
+  // (u0,v0), (u1,v0), (u0,v1), (u1,v1).
+  S1ChordAngle GetDistanceInternal(
+      const S2Point& target_xyz, bool to_interior,
+      const S2Point* uvw_vertices = nullptr) const;
+
+  // Implements GetDistances() and GetBoundaryDistances().
+  void GetDistancesInternal(absl::Span<const S2Point> targets,
+                            bool to_interior,
+                            absl::Span<S1ChordAngle> distances) const;
 
   // This structure occupies 44 bytes plus one pointer for the vtable.
   int8_t face_;
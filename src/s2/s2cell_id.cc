@@ -18,10 +18,12 @@
 #include "s2/s2cell_id.h"
 
 #include <algorithm>
+#include <array>
 #include <cfloat>
 #include <cmath>
 #include <cstddef>
 #include <cstdint>
+#include <cstring>
 #include <ostream>
 #include <string>
 #include <vector>
@@ -207,13 +209,52 @@ int S2CellId::GetCommonAncestorLevel(S2CellId other) const {
   return max(61 - absl::bit_width(bits), -1) >> 1;
 }
 
-// Print the num_digits low order hex digits.
-static string HexFormatString(uint64_t val, size_t num_digits) {
-  string result(num_digits, ' ');
-  for (; num_digits--; val >>= 4)
-    result[num_digits] = "0123456789abcdef"[val & 0xF];
-  return result;
+namespace {
+
+// The two lowercase hex digits of every byte value, used to format tokens
+// one byte at a time.
+constexpr std::array<char, 512> MakeHexPairs() {
+  std::array<char, 512> pairs = {};
+  for (int i = 0; i < 256; ++i) {
+    pairs[2 * i] = "0123456789abcdef"[i >> 4];
+    pairs[2 * i + 1] = "0123456789abcdef"[i & 0xF];
+  }
+  return pairs;
+}
+constexpr std::array<char, 512> kHexPairs = MakeHexPairs();
+
+// The value of every hex digit (in either case), or -1 for other characters.
+constexpr std::array<int8_t, 256> MakeHexValues() {
+  std::array<int8_t, 256> values = {};
+  for (int i = 0; i < 256; ++i) {
+    values[i] = ('0' <= i && i <= '9')   ? i - '0'
+                : ('a' <= i && i <= 'f') ? i - 'a' + 10
+                : ('A' <= i && i <= 'F') ? i - 'A' + 10
+                                         : -1;
+  }
+  return values;
 }
+constexpr std::array<int8_t, 256> kHexValues = MakeHexValues();
+
+// Parses a token consisting of 1 to 16 hex digits, returning false if it is
+// malformed.
+//
+// REQUIRES: !token.empty()
+bool ParseHexToken(string_view token, uint64_t* id) {
+  if (token.length() > S2CellId::kMaxTokenLength) return false;
+  uint64_t result = 0;
+  int bad = 0;
+  for (size_t i = 0; i < token.length(); ++i) {
+    int d = kHexValues[static_cast<unsigned char>(token[i])];
+    bad |= d;
+    result = (result << 4) | (d & 0xF);
+  }
+  if (bad < 0) return false;
+  *id = result << 4 * (S2CellId::kMaxTokenLength - token.length());
+  return true;
+}
+
+}  // namespace
 
 string S2CellId::ToToken() const {
   // Simple implementation: print the id in hex without trailing zeros.
@@ -225,33 +266,59 @@ string S2CellId::ToToken() const {
   // Using base 64 would produce slightly shorter tokens, but for typical cell
   // sizes used during indexing (up to level 15 or so) the average savings
   // would be less than 2 bytes per cell which doesn't seem worth it.
+  char buf[kMaxTokenLength];
+  return string(buf, ToToken(buf));
+}
 
+int S2CellId::ToToken(char* buf) const {
   // "0" with trailing 0s stripped is the empty string, which is not a
   // reasonable token.  Encode as "X".
-  if (id_ == 0) return "X";
-  const size_t num_zero_digits = absl::countr_zero(id_) / 4;
-  return HexFormatString(id_ >> (4 * num_zero_digits), 16 - num_zero_digits);
+  if (id_ == 0) {
+    buf[0] = 'X';
+    return 1;
+  }
+  // Format all 16 digits two at a time, and then discard the trailing zeros.
+  uint64_t val = id_;
+  for (int i = kMaxTokenLength / 2 - 1; i >= 0; --i, val >>= 8) {
+    std::memcpy(buf + 2 * i, &kHexPairs[2 * (val & 0xFF)], 2);
+  }
+  return kMaxTokenLength - absl::countr_zero(id_) / 4;
 }
 
 S2CellId S2CellId::FromToken(const string_view token) {
-  if (token.length() > 16) return S2CellId::None();
-  uint64_t id = 0;
-  // Use size_t to fix signed/unsigned comparison for client that use `-Wextra`
-  // (e.g. Chrome).
-  for (size_t i = 0, pos = 60; i < token.length(); ++i, pos -= 4) {
-    uint64_t d;
-    if ('0' <= token[i] && token[i] <= '9') {
-      d = token[i] - '0';
-    } else if ('a' <= token[i] && token[i] <= 'f') {
-      d = token[i] - 'a' + 10;
-    } else if ('A' <= token[i] && token[i] <= 'F') {
-      d = token[i] - 'A' + 10;
-    } else {
-      return S2CellId::None();
+  uint64_t id;
+  if (token.empty() || !ParseHexToken(token, &id)) return S2CellId::None();
+  return S2CellId(id);
+}
+
+void S2CellId::AppendTokens(absl::Span<const S2CellId> ids, char separator,
+                            string* out) {
+  // Resize the output once for the longest possible tokens, and then shrink
+  // it to the actual size.
+  const size_t begin = out->size();
+  out->resize(begin + ids.size() * (kMaxTokenLength + 1));
+  char* p = out->data() + begin;
+  for (S2CellId id : ids) {
+    p += id.ToToken(p);
+    *p++ = separator;
+  }
+  out->resize(p - out->data());
+}
+
+bool S2CellId::FromTokens(string_view tokens, char separator,
+                          vector<S2CellId>* ids) {
+  while (!tokens.empty()) {
+    size_t end = tokens.find(separator);
+    string_view token = tokens.substr(0, end);
+    uint64_t id = 0;
+    if (token != "X" && (token.empty() || !ParseHexToken(token, &id))) {
+      return false;
     }
-    id |= d << pos;
+    ids->push_back(S2CellId(id));
+    if (end == string_view::npos) break;
+    tokens.remove_prefix(end + 1);
   }
-  return S2CellId(id);
+  return true;
 }
 
 void S2CellId::Encode(Encoder* const encoder) const {
@@ -265,17 +332,17 @@ bool S2CellId::Decode(Decoder* const decoder) {
   return true;
 }
 
-S2CellId S2CellId::FromFaceIJ(int face, int i, int j) {
-  // Initialization if not done yet
-  MaybeInit();
-
+// Returns the leaf cell id for the given (face, i, j) coordinates.  This is
+// the implementation of FromFaceIJ(), except that the lookup tables must
+// already have been initialized.
+static inline uint64_t FaceIJToId(int face, int i, int j) {
   // Optimization notes:
   //  - Non-overlapping bit fields can be combined with either "+" or "|".
   //    Generally "+" seems to produce better code, but not always.
 
   // Note that this value gets shifted one bit to the left at the end
   // of the function.
-  uint64_t n = absl::implicit_cast<uint64_t>(face) << (kPosBits - 1);
+  uint64_t n = absl::implicit_cast<uint64_t>(face) << (S2CellId::kPosBits - 1);
 
   // Alternating faces have opposite Hilbert curve orientations; this
   // is necessary in order for all faces to have a right-handed
@@ -306,7 +373,13 @@ S2CellId S2CellId::FromFaceIJ(int face, int i, int j) {
   GET_BITS(0);
 #undef GET_BITS
 
-  return S2CellId(n * 2 + 1);
+  return n * 2 + 1;
+}
+
+S2CellId S2CellId::FromFaceIJ(int face, int i, int j) {
+  // Initialization if not done yet
+  MaybeInit();
+  return S2CellId(FaceIJToId(face, i, j));
 }
 
 S2CellId::S2CellId(const S2Point& p) {
@@ -321,12 +394,13 @@ S2CellId::S2CellId(const S2LatLng& ll)
   : S2CellId(ll.ToPoint()) {
 }
 
-int S2CellId::ToFaceIJOrientation(int* pi, int* pj, int* orientation) const {
-  // Initialization if not done yet
-  MaybeInit();
-
+// Sets (i, j) to the coordinates of the given cell id and returns the
+// Hilbert curve orientation of its leaf cells.  This is the implementation
+// of ToFaceIJOrientation(), except that the lookup tables must already have
+// been initialized.
+static inline int IdToFaceIJ(uint64_t id, int* pi, int* pj) {
   int i = 0, j = 0;
-  int face = this->face();
+  int face = id >> S2CellId::kPosBits;
   int bits = (face & kSwapMask);
 
   // Each iteration maps 8 bits of the Hilbert curve position into
@@ -338,8 +412,9 @@ int S2CellId::ToFaceIJOrientation(int* pi, int* pj, int* orientation) const {
   // On the first iteration we need to be careful to clear out the bits
   // representing the cube face.
 #define GET_BITS(k) do { \
-    const int nbits = (k == 7) ? (kMaxLevel - 7 * kLookupBits) : kLookupBits; \
-    bits += (static_cast<int>(id_ >> (k * 2 * kLookupBits + 1)) \
+    const int nbits = (k == 7) ? (S2CellId::kMaxLevel - 7 * kLookupBits) \
+                               : kLookupBits; \
+    bits += (static_cast<int>(id >> (k * 2 * kLookupBits + 1)) \
              & ((1 << (2 * nbits)) - 1)) << 2; \
     bits = lookup_ij[bits]; \
     i += (bits >> (kLookupBits + 2)) << (k * kLookupBits); \
@@ -359,6 +434,14 @@ int S2CellId::ToFaceIJOrientation(int* pi, int* pj, int* orientation) const {
 
   *pi = i;
   *pj = j;
+  return bits;
+}
+
+int S2CellId::ToFaceIJOrientation(int* pi, int* pj, int* orientation) const {
+  // Initialization if not done yet
+  MaybeInit();
+
+  int bits = IdToFaceIJ(id_, pi, pj);
 
   if (orientation != nullptr) {
     // The position of a non-leaf cell at level "n" consists of a prefix of
@@ -375,7 +458,7 @@ int S2CellId::ToFaceIJOrientation(int* pi, int* pj, int* orientation) const {
     }
     *orientation = bits;
   }
-  return face;
+  return face();
 }
 
 S2Point S2CellId::ToPointRaw() const {
@@ -388,6 +471,52 @@ S2LatLng S2CellId::ToLatLng() const {
   return S2LatLng(ToPointRaw());
 }
 
+// The batch conversion functions below initialize the lookup tables once and
+// then inline the whole conversion pipeline into a single loop, which avoids
+// the function call and initialization check per point.
+
+void S2CellId::FromPoints(absl::Span<const S2Point> points,
+                          absl::Span<S2CellId> ids) {
+  ABSL_DCHECK_EQ(points.size(), ids.size());
+  MaybeInit();
+  for (size_t k = 0; k < points.size(); ++k) {
+    double u, v;
+    int face = S2::XYZtoFaceUV(points[k], &u, &v);
+    int i = S2::STtoIJ(S2::UVtoST(u));
+    int j = S2::STtoIJ(S2::UVtoST(v));
+    ids[k] = S2CellId(FaceIJToId(face, i, j));
+  }
+}
+
+void S2CellId::FromLatLngs(absl::Span<const S2LatLng> latlngs,
+                           absl::Span<S2CellId> ids) {
+  ABSL_DCHECK_EQ(latlngs.size(), ids.size());
+  MaybeInit();
+  for (size_t k = 0; k < latlngs.size(); ++k) {
+    double u, v;
+    int face = S2::XYZtoFaceUV(latlngs[k].ToPoint(), &u, &v);
+    int i = S2::STtoIJ(S2::UVtoST(u));
+    int j = S2::STtoIJ(S2::UVtoST(v));
+    ids[k] = S2CellId(FaceIJToId(face, i, j));
+  }
+}
+
+void S2CellId::ToPoints(absl::Span<const S2CellId> ids,
+                        absl::Span<S2Point> points) {
+  ABSL_DCHECK_EQ(ids.size(), points.size());
+  MaybeInit();
+  for (size_t k = 0; k < ids.size(); ++k) {
+    // See GetCenterSiTi() for an explanation of "delta".
+    const S2CellId id = ids[k];
+    int i, j;
+    IdToFaceIJ(id.id(), &i, &j);
+    int delta = id.is_leaf() ? 1 :
+                ((i ^ (static_cast<int>(id.id()) >> 2)) & 1) ? 2 : 0;
+    points[k] =
+        S2::FaceSiTitoXYZ(id.face(), 2 * i + delta, 2 * j + delta).Normalize();
+  }
+}
+
 R2Point S2CellId::GetCenterST() const {
   int si, ti;
   GetCenterSiTi(&si, &ti);
@@ -606,6 +735,64 @@ void S2CellId::AppendAllNeighbors(int nbr_level,
   }
 }
 
+// Sorts the cells of "output" starting at position "begin" and removes
+// duplicates.
+static void SortUniqueFrom(size_t begin, vector<S2CellId>* output) {
+  auto first = output->begin() + begin;
+  if (!std::is_sorted(first, output->end())) std::sort(first, output->end());
+  output->erase(std::unique(first, output->end()), output->end());
+}
+
+void S2CellId::AppendParents(absl::Span<const S2CellId> ids, int level,
+                             vector<S2CellId>* output, bool dedup) {
+  ABSL_DCHECK_GE(level, 0);
+  const size_t begin = output->size();
+  output->resize(begin + ids.size());
+  S2CellId* out = output->data() + begin;
+  // This loop has no branches (in optimized builds) so it vectorizes well.
+  const uint64_t new_lsb = lsb_for_level(level);
+  for (size_t k = 0; k < ids.size(); ++k) {
+    ABSL_DCHECK(ids[k].is_valid());
+    ABSL_DCHECK_LE(level, ids[k].level());
+    out[k] = S2CellId((ids[k].id() & (~new_lsb + 1)) | new_lsb);
+  }
+  if (dedup) SortUniqueFrom(begin, output);
+}
+
+void S2CellId::AppendChildren(absl::Span<const S2CellId> ids, int level,
+                              vector<S2CellId>* output, bool dedup) {
+  ABSL_DCHECK_LE(level, kMaxLevel);
+  size_t num_children = 0;
+  for (S2CellId id : ids) {
+    ABSL_DCHECK(id.is_valid());
+    ABSL_DCHECK_GE(level, id.level());
+    num_children += size_t{1} << (2 * (level - id.level()));
+  }
+  const size_t begin = output->size();
+  output->resize(begin + num_children);
+  S2CellId* out = output->data() + begin;
+  // The children of each cell are consecutive cells at the given level, so
+  // their ids form an arithmetic sequence.
+  const uint64_t child_lsb = lsb_for_level(level);
+  for (S2CellId id : ids) {
+    const uint64_t first = id.id() - id.lsb() + child_lsb;
+    const size_t n = size_t{1} << (2 * (level - id.level()));
+    for (size_t i = 0; i < n; ++i) {
+      out[i] = S2CellId(first + 2 * child_lsb * i);
+    }
+    out += n;
+  }
+  if (dedup) SortUniqueFrom(begin, output);
+}
+
+void S2CellId::AppendAllNeighbors(absl::Span<const S2CellId> ids,
+                                  int nbr_level, vector<S2CellId>* output,
+                                  bool dedup) {
+  const size_t begin = output->size();
+  for (S2CellId id : ids) id.AppendAllNeighbors(nbr_level, output);
+  if (dedup) SortUniqueFrom(begin, output);
+}
+
 string S2CellId::ToString() const {
   if (!is_valid()) {
     return StrCat("Invalid: ", absl::Hex(id(), absl::kZeroPad16));
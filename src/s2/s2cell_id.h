@@ -34,6 +34,7 @@
 #include "absl/log/absl_check.h"
 #include "absl/numeric/bits.h"
 #include "absl/strings/string_view.h"
+#include "absl/types/span.h"
 
 #include "s2/_fp_contract_off.h"  // IWYU pragma: keep
 #include "s2/r2.h"
@@ -134,7 +135,7 @@ class S2CellId {
   static constexpr S2CellId Sentinel() { return S2CellId(~uint64_t{0}); }
 
   // Return the cell corresponding to a given S2 cube face.
-  static S2CellId FromFace(int face);
+  static constexpr S2CellId FromFace(int face);
 
   // Return a cell given its face (range 0..5), Hilbert curve position within
   // that face (an unsigned integer with S2CellId::kPosBits bits), and level
@@ -144,6 +145,13 @@ class S2CellId {
   // the arguments represent.
   static S2CellId FromFacePosLevel(int face, uint64_t pos, int level);
 
+  // Like FromFacePosLevel(), but the level is a compile-time constant.  This
+  // allows the cell id to be computed in constant expressions, and the bit
+  // masks to be folded into constants in hot loops.  The arguments are not
+  // validated.
+  template <int level>
+  static constexpr S2CellId FromFacePosLevel(int face, uint64_t pos);
+
   // Return the direction vector corresponding to the center of the given
   // cell.  The vector returned by ToPointRaw is not necessarily unit length.
   // This method returns the same result as S2Cell::GetCenter().
@@ -154,6 +162,18 @@ class S2CellId {
   S2Point ToPoint() const { return ToPointRaw().Normalize(); }
   S2Point ToPointRaw() const;
 
+  // Batch versions of S2CellId(S2Point), S2CellId(S2LatLng), and ToPoint().
+  // The results are identical to converting each element individually, but
+  // these functions are faster when converting many values at once.
+  //
+  // REQUIRES: The input and output spans have the same size.
+  static void FromPoints(absl::Span<const S2Point> points,
+                         absl::Span<S2CellId> ids);
+  static void FromLatLngs(absl::Span<const S2LatLng> latlngs,
+                          absl::Span<S2CellId> ids);
+  static void ToPoints(absl::Span<const S2CellId> ids,
+                       absl::Span<S2Point> points);
+
   // Return the center of the cell in (s,t) coordinates (see s2coords.h).
   R2Point GetCenterST() const;
 
@@ -293,6 +313,11 @@ class S2CellId {
   IFNDEF_SWIG(ABSL_MUST_USE_RESULT) S2CellId parent() const;
   IFNDEF_SWIG(ABSL_MUST_USE_RESULT) S2CellId parent(int level) const;
 
+  // Like parent(level), but the level is a compile-time constant (e.g.,
+  // parent<13>()), so that the bit masks are folded into constants.
+  template <int level>
+  IFNDEF_SWIG(ABSL_MUST_USE_RESULT) S2CellId parent() const;
+
   // Return the immediate child of this cell at the given traversal order
   // position (in the range 0 to 3).  This cell must not be a leaf cell.
   IFNDEF_SWIG(ABSL_MUST_USE_RESULT) S2CellId child(int position) const;
@@ -314,6 +339,13 @@ class S2CellId {
   IFNDEF_SWIG(ABSL_MUST_USE_RESULT) S2CellId child_end() const;
   IFNDEF_SWIG(ABSL_MUST_USE_RESULT) S2CellId child_end(int level) const;
 
+  // Like child_begin(level) and child_end(level), but the level is a
+  // compile-time constant.
+  template <int level>
+  IFNDEF_SWIG(ABSL_MUST_USE_RESULT) S2CellId child_begin() const;
+  template <int level>
+  IFNDEF_SWIG(ABSL_MUST_USE_RESULT) S2CellId child_end() const;
+
   // Return the next/previous cell at the same level along the Hilbert curve.
   // Works correctly when advancing from one face to the next, but
   // does *not* wrap around from the last face to the first or vice versa.
@@ -388,6 +420,25 @@ class S2CellId {
   std::string ToToken() const;
   static S2CellId FromToken(absl::string_view token);
 
+  // The maximum length of the string returned by ToToken().
+  static constexpr int kMaxTokenLength = 16;
+
+  // Like ToToken(), but writes the token to "buf" rather than allocating a
+  // string.  Returns the token length.  "buf" must have room for
+  // kMaxTokenLength characters (it is not null-terminated).
+  int ToToken(char* buf) const;
+
+  // Batch versions of ToToken() and FromToken() for bulk I/O.
+  // AppendTokens() appends each token to "out", followed by "separator".
+  // FromTokens() parses such a sequence of tokens (where the final separator
+  // is optional) and appends the cell ids to "ids".  Unlike FromToken(), it
+  // returns false if any token is malformed (the only token accepted for
+  // S2CellId::None() is "X").
+  static void AppendTokens(absl::Span<const S2CellId> ids, char separator,
+                           std::string* out);
+  static bool FromTokens(absl::string_view tokens, char separator,
+                         std::vector<S2CellId>* ids);
+
   // Legacy coder for S2CellId that delegates to the token representation.
   // Storage is variable depending on the level of the cell.
   class Coder : public s2coding::S2Coder<S2CellId> {
@@ -443,6 +494,24 @@ class S2CellId {
   // REQUIRES: nbr_level >= this->level().
   void AppendAllNeighbors(int nbr_level, std::vector<S2CellId>* output) const;
 
+  // Batch versions of parent(level), child_begin(level)...child_end(level),
+  // and AppendAllNeighbors(level).  The results for each cell in "ids" are
+  // appended to "output" in order, which is resized only once for parents
+  // and children.  If "dedup" is true, the appended cells are then sorted and
+  // duplicates are removed (e.g., to compute the ring of cells around a set
+  // of cells).  Cells already in "output" are not affected.
+  //
+  // REQUIRES: Every cell in "ids" is valid, and its level is >= "level" for
+  //           AppendParents() and <= "level" for the other methods.
+  static void AppendParents(absl::Span<const S2CellId> ids, int level,
+                            std::vector<S2CellId>* output, bool dedup = false);
+  static void AppendChildren(absl::Span<const S2CellId> ids, int level,
+                             std::vector<S2CellId>* output,
+                             bool dedup = false);
+  static void AppendAllNeighbors(absl::Span<const S2CellId> ids,
+                                 int nbr_level, std::vector<S2CellId>* output,
+                                 bool dedup = false);
+
   /////////////////////////////////////////////////////////////////////
   // Low-level methods.
 
@@ -522,7 +591,7 @@ inline constexpr bool operator>=(S2CellId x, S2CellId y) {
   return x.id() >= y.id();
 }
 
-inline S2CellId S2CellId::FromFace(int face) {
+inline constexpr S2CellId S2CellId::FromFace(int face) {
   return S2CellId((static_cast<uint64_t>(face) << kPosBits) + lsb_for_level(0));
 }
 
@@ -532,6 +601,15 @@ inline S2CellId S2CellId::FromFacePosLevel(int face, uint64_t pos, int level) {
   return cell.parent(level);
 }
 
+template <int level>
+inline constexpr S2CellId S2CellId::FromFacePosLevel(int face, uint64_t pos) {
+  static_assert(level >= 0 && level <= kMaxLevel);
+  constexpr uint64_t kLsb = lsb_for_level(level);
+  return S2CellId(
+      (((static_cast<uint64_t>(face) << kPosBits) + (pos | 1)) & (~kLsb + 1)) |
+      kLsb);
+}
+
 inline int S2CellId::GetCenterSiTi(int* psi, int* pti) const {
   // First we compute the discrete (i,j) coordinates of a leaf cell contained
   // within the given cell.  Given that cells are represented by the Hilbert
@@ -647,6 +725,15 @@ inline S2CellId S2CellId::parent(int level) const {
   return S2CellId((id_ & (~new_lsb + 1)) | new_lsb);
 }
 
+template <int level>
+inline S2CellId S2CellId::parent() const {
+  static_assert(level >= 0 && level <= kMaxLevel);
+  ABSL_DCHECK(is_valid());
+  ABSL_DCHECK_LE(level, this->level());
+  constexpr uint64_t kNewLsb = lsb_for_level(level);
+  return S2CellId((id_ & (~kNewLsb + 1)) | kNewLsb);
+}
+
 inline S2CellId S2CellId::parent() const {
   ABSL_DCHECK(is_valid());
   ABSL_DCHECK(!is_face());
@@ -679,6 +766,14 @@ inline S2CellId S2CellId::child_begin(int level) const {
   return S2CellId(id_ - lsb() + lsb_for_level(level));
 }
 
+template <int level>
+inline S2CellId S2CellId::child_begin() const {
+  static_assert(level >= 0 && level <= kMaxLevel);
+  ABSL_DCHECK(is_valid());
+  ABSL_DCHECK_GE(level, this->level());
+  return S2CellId(id_ - lsb() + lsb_for_level(level));
+}
+
 inline S2CellId S2CellId::child_end() const {
   ABSL_DCHECK(is_valid());
   ABSL_DCHECK(!is_leaf());
@@ -693,6 +788,14 @@ inline S2CellId S2CellId::child_end(int level) const {
   return S2CellId(id_ + lsb() + lsb_for_level(level));
 }
 
+template <int level>
+inline S2CellId S2CellId::child_end() const {
+  static_assert(level >= 0 && level <= kMaxLevel);
+  ABSL_DCHECK(is_valid());
+  ABSL_DCHECK_GE(level, this->level());
+  return S2CellId(id_ + lsb() + lsb_for_level(level));
+}
+
 inline S2CellId S2CellId::next() const {
   return S2CellId(id_ + (lsb() << 1));
 }
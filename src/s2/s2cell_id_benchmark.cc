@@ -0,0 +1,123 @@
+// Copyright 2024 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "s2/s2cell_id.h"
+
+#include <cstddef>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+#include "absl/random/random.h"
+#include "absl/types/span.h"
+#include "s2/s2latlng.h"
+#include "s2/s2point.h"
+#include "s2/s2random.h"
+
+using std::vector;
+
+namespace {
+
+constexpr int kNumValues = 4096;
+
+vector<S2Point> MakePoints() {
+  absl::BitGen bitgen;
+  vector<S2Point> points;
+  for (int i = 0; i < kNumValues; ++i) {
+    points.push_back(s2random::Point(bitgen));
+  }
+  return points;
+}
+
+vector<S2CellId> MakeCellIds() {
+  absl::BitGen bitgen;
+  vector<S2CellId> ids;
+  for (int i = 0; i < kNumValues; ++i) {
+    ids.push_back(s2random::CellId(bitgen, S2CellId::kMaxLevel));
+  }
+  return ids;
+}
+
+// The benchmarks below measure the time per value converted, either one
+// value at a time or using the batch conversion functions.
+
+void BM_S2CellIdFromPoint(benchmark::State& state) {
+  const vector<S2Point> points = MakePoints();
+  vector<S2CellId> ids(points.size());
+  for (auto _ : state) {
+    for (size_t i = 0; i < points.size(); ++i) ids[i] = S2CellId(points[i]);
+    benchmark::DoNotOptimize(ids.data());
+  }
+  state.SetItemsProcessed(state.iterations() * points.size());
+}
+BENCHMARK(BM_S2CellIdFromPoint);
+
+void BM_S2CellIdFromPoints(benchmark::State& state) {
+  const vector<S2Point> points = MakePoints();
+  vector<S2CellId> ids(points.size());
+  for (auto _ : state) {
+    S2CellId::FromPoints(points, absl::MakeSpan(ids));
+    benchmark::DoNotOptimize(ids.data());
+  }
+  state.SetItemsProcessed(state.iterations() * points.size());
+}
+BENCHMARK(BM_S2CellIdFromPoints);
+
+void BM_S2CellIdFromLatLng(benchmark::State& state) {
+  const vector<S2Point> points = MakePoints();
+  const vector<S2LatLng> latlngs(points.begin(), points.end());
+  vector<S2CellId> ids(latlngs.size());
+  for (auto _ : state) {
+    for (size_t i = 0; i < latlngs.size(); ++i) ids[i] = S2CellId(latlngs[i]);
+    benchmark::DoNotOptimize(ids.data());
+  }
+  state.SetItemsProcessed(state.iterations() * latlngs.size());
+}
+BENCHMARK(BM_S2CellIdFromLatLng);
+
+void BM_S2CellIdFromLatLngs(benchmark::State& state) {
+  const vector<S2Point> points = MakePoints();
+  const vector<S2LatLng> latlngs(points.begin(), points.end());
+  vector<S2CellId> ids(latlngs.size());
+  for (auto _ : state) {
+    S2CellId::FromLatLngs(latlngs, absl::MakeSpan(ids));
+    benchmark::DoNotOptimize(ids.data());
+  }
+  state.SetItemsProcessed(state.iterations() * latlngs.size());
+}
+BENCHMARK(BM_S2CellIdFromLatLngs);
+
+void BM_S2CellIdToPoint(benchmark::State& state) {
+  const vector<S2CellId> ids = MakeCellIds();
+  vector<S2Point> points(ids.size());
+  for (auto _ : state) {
+    for (size_t i = 0; i < ids.size(); ++i) points[i] = ids[i].ToPoint();
+    benchmark::DoNotOptimize(points.data());
+  }
+  state.SetItemsProcessed(state.iterations() * ids.size());
+}
+BENCHMARK(BM_S2CellIdToPoint);
+
+void BM_S2CellIdToPoints(benchmark::State& state) {
+  const vector<S2CellId> ids = MakeCellIds();
+  vector<S2Point> points(ids.size());
+  for (auto _ : state) {
+    S2CellId::ToPoints(ids, absl::MakeSpan(points));
+    benchmark::DoNotOptimize(points.data());
+  }
+  state.SetItemsProcessed(state.iterations() * ids.size());
+}
+BENCHMARK(BM_S2CellIdToPoints);
+
+}  // namespace
@@ -38,6 +38,7 @@
 #include "absl/random/random.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/string_view.h"
+#include "absl/types/span.h"
 
 #include "s2/r1interval.h"
 #include "s2/r2.h"
@@ -123,6 +124,36 @@ TEST(S2CellId, ParentChildRelationships) {
   EXPECT_EQ(2 * id.id(), id.range_min().id() + id.range_max().id());
 }
 
+TEST(S2CellId, CompileTimeLevels) {
+  // FromFacePosLevel<level>() can be evaluated at compile time.
+  static_assert(S2CellId::FromFacePosLevel<0>(2, 0) == S2CellId::FromFace(2));
+  constexpr S2CellId kId =
+      S2CellId::FromFacePosLevel<S2CellId::kMaxLevel - 4>(3, 0x12345678);
+  EXPECT_EQ(S2CellId::FromFacePosLevel(3, 0x12345678, S2CellId::kMaxLevel - 4),
+            kId);
+
+  absl::BitGen bitgen(S2Testing::MakeTaggedSeedSeq(
+      "COMPILE_TIME_LEVELS",
+      absl::LogInfoStreamer(__FILE__, __LINE__).stream()));
+  for (int iter = 0; iter < 100; ++iter) {
+    S2CellId leaf = s2random::CellId(bitgen, S2CellId::kMaxLevel);
+    EXPECT_EQ(leaf.parent(0), leaf.parent<0>());
+    EXPECT_EQ(leaf.parent(13), leaf.parent<13>());
+    EXPECT_EQ(leaf, leaf.parent<S2CellId::kMaxLevel>());
+
+    S2CellId id = leaf.parent(10);
+    EXPECT_EQ(id.child_begin(10), id.child_begin<10>());
+    EXPECT_EQ(id.child_begin(13), id.child_begin<13>());
+    EXPECT_EQ(id.child_end(13), id.child_end<13>());
+    EXPECT_EQ(id.range_min(), id.child_begin<S2CellId::kMaxLevel>());
+    EXPECT_EQ(id.range_max().next(), id.child_end<S2CellId::kMaxLevel>());
+
+    uint64_t pos = absl::Uniform<uint64_t>(bitgen) >> S2CellId::kFaceBits;
+    EXPECT_EQ(S2CellId::FromFacePosLevel(leaf.face(), pos, 20),
+              S2CellId::FromFacePosLevel<20>(leaf.face(), pos));
+  }
+}
+
 TEST(S2CellId, SentinelRangeMinMax) {
   EXPECT_EQ(S2CellId::Sentinel(), S2CellId::Sentinel().range_min());
   EXPECT_EQ(S2CellId::Sentinel(), S2CellId::Sentinel().range_max());
@@ -310,6 +341,44 @@ TEST(S2CellId, Inverses) {
   }
 }
 
+TEST(S2CellId, BatchConversions) {
+  // Check that the batch conversion functions give exactly the same results
+  // as converting each value individually.
+  absl::BitGen bitgen(S2Testing::MakeTaggedSeedSeq(
+      "BATCH_CONVERSIONS",
+      absl::LogInfoStreamer(__FILE__, __LINE__).stream()));
+  constexpr int kNumValues = 10000;
+  vector<S2CellId> ids;
+  vector<S2Point> points;
+  vector<S2LatLng> latlngs;
+  for (int i = 0; i < kNumValues; ++i) {
+    ids.push_back(s2random::CellId(bitgen));  // Random level.
+    points.push_back(s2random::Point(bitgen));
+    latlngs.push_back(S2LatLng(points.back()));
+  }
+  // Include a few points on cube face boundaries.
+  points.push_back(S2Point(1, 1, 1));
+  points.push_back(S2Point(-1, 0, 0));
+  latlngs.push_back(S2LatLng::FromDegrees(90, 0));
+  latlngs.push_back(S2LatLng::FromDegrees(0, -180));
+
+  vector<S2Point> centers(ids.size());
+  S2CellId::ToPoints(ids, absl::MakeSpan(centers));
+  for (size_t i = 0; i < ids.size(); ++i) {
+    EXPECT_EQ(centers[i], ids[i].ToPoint());
+  }
+  vector<S2CellId> point_ids(points.size());
+  S2CellId::FromPoints(points, absl::MakeSpan(point_ids));
+  for (size_t i = 0; i < points.size(); ++i) {
+    EXPECT_EQ(point_ids[i], S2CellId(points[i]));
+  }
+  vector<S2CellId> latlng_ids(latlngs.size());
+  S2CellId::FromLatLngs(latlngs, absl::MakeSpan(latlng_ids));
+  for (size_t i = 0; i < latlngs.size(); ++i) {
+    EXPECT_EQ(latlng_ids[i], S2CellId(latlngs[i]));
+  }
+}
+
 TEST(S2CellId, Tokens) {
   // Test random cell ids at all levels.
   absl::BitGen bitgen(S2Testing::MakeTaggedSeedSeq(
@@ -342,6 +411,45 @@ TEST(S2CellId, Tokens) {
   EXPECT_EQ(S2CellId::None(), S2CellId::FromToken(" 876bee99"));
 }
 
+TEST(S2CellId, BatchTokens) {
+  absl::BitGen bitgen(S2Testing::MakeTaggedSeedSeq(
+      "BATCH_TOKENS",
+      absl::LogInfoStreamer(__FILE__, __LINE__).stream()));
+  vector<S2CellId> ids = {S2CellId::None(), S2CellId::Sentinel(),
+                          S2CellId::FromFace(3)};
+  for (int i = 0; i < 1000; ++i) ids.push_back(s2random::CellId(bitgen));
+
+  string tokens = "prefix;";
+  S2CellId::AppendTokens(ids, ';', &tokens);
+  string expected = "prefix;";
+  for (S2CellId id : ids) {
+    char buf[S2CellId::kMaxTokenLength];
+    string token = id.ToToken();
+    EXPECT_EQ(string(buf, id.ToToken(buf)), token);
+    absl::StrAppend(&expected, token, ";");
+  }
+  EXPECT_EQ(tokens, expected);
+
+  vector<S2CellId> decoded = {S2CellId::FromFace(1)};
+  ASSERT_TRUE(S2CellId::FromTokens(
+      string_view(tokens).substr(7), ';', &decoded));
+  decoded.erase(decoded.begin());
+  EXPECT_EQ(decoded, ids);
+
+  // The final separator is optional, and upper case is accepted.
+  decoded.clear();
+  EXPECT_TRUE(S2CellId::FromTokens("X,1,89C259", ',', &decoded));
+  EXPECT_EQ(decoded, (vector<S2CellId>{S2CellId::None(),
+                                       S2CellId::FromFace(0),
+                                       S2CellId::FromToken("89c259")}));
+  decoded.clear();
+  EXPECT_TRUE(S2CellId::FromTokens("", ',', &decoded));
+  EXPECT_TRUE(decoded.empty());
+  EXPECT_FALSE(S2CellId::FromTokens("1,,3", ',', &decoded));
+  EXPECT_FALSE(S2CellId::FromTokens("1,g", ',', &decoded));
+  EXPECT_FALSE(S2CellId::FromTokens("1,12345678901234567", ',', &decoded));
+}
+
 TEST(S2CellId, EncodeDecode) {
   S2CellId id(0x7837423);
   Encoder encoder;
@@ -634,6 +742,46 @@ TEST(S2CellId, Neighbors) {
   }
 }
 
+TEST(S2CellId, BatchParentsChildrenAndNeighbors) {
+  absl::BitGen bitgen(S2Testing::MakeTaggedSeedSeq(
+      "BATCH_PARENTS_CHILDREN_AND_NEIGHBORS",
+      absl::LogInfoStreamer(__FILE__, __LINE__).stream()));
+  vector<S2CellId> ids;
+  for (int i = 0; i < 100; ++i) {
+    ids.push_back(s2random::CellId(bitgen, 10 + i % 5));
+  }
+  ids.push_back(ids[0]);  // A duplicate.
+
+  // The batch methods append to the existing contents of "output".
+  const vector<S2CellId> prefix = {S2CellId::FromFace(5), S2CellId::None()};
+  for (bool dedup : {false, true}) {
+    vector<S2CellId> expected_parents = prefix, expected_children = prefix,
+                     expected_neighbors = prefix;
+    for (S2CellId id : ids) {
+      expected_parents.push_back(id.parent(8));
+      for (S2CellId c = id.child_begin(15); c != id.child_end(15);
+           c = c.next()) {
+        expected_children.push_back(c);
+      }
+      id.AppendAllNeighbors(16, &expected_neighbors);
+    }
+    if (dedup) {
+      for (vector<S2CellId>* v :
+           {&expected_parents, &expected_children, &expected_neighbors}) {
+        std::sort(v->begin() + prefix.size(), v->end());
+        v->erase(std::unique(v->begin() + prefix.size(), v->end()), v->end());
+      }
+    }
+    vector<S2CellId> parents = prefix, children = prefix, neighbors = prefix;
+    S2CellId::AppendParents(ids, 8, &parents, dedup);
+    S2CellId::AppendChildren(ids, 15, &children, dedup);
+    S2CellId::AppendAllNeighbors(ids, 16, &neighbors, dedup);
+    EXPECT_EQ(parents, expected_parents);
+    EXPECT_EQ(children, expected_children);
+    EXPECT_EQ(neighbors, expected_neighbors);
+  }
+}
+
 TEST(S2CellId, CornerCellHas7Neighbors) {
   // NOTE: This is a very special case, this cell is a corner of one face and
   // has thus only 7 neighbors.
@@ -18,14 +18,25 @@
 #include "s2/s2cell_index.h"
 
 #include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <utility>
 #include <vector>
 
 #include "absl/container/flat_hash_set.h"
 #include "absl/log/absl_check.h"
+#include "absl/types/span.h"
+#include "s2/util/coding/coder.h"
+#include "s2/encoded_s2cell_id_vector.h"
+#include "s2/encoded_uint_vector.h"
+#include "s2/internal/s2parallel.h"
 #include "s2/s2cell_id.h"
 #include "s2/s2cell_union.h"
+#include "s2/s2space_usage.h"
 
 using absl::flat_hash_set;
+using std::pair;
 using std::vector;
 
 using Label = S2CellIndex::Label;
@@ -72,70 +83,177 @@ void S2CellIndex::Add(const S2CellUnion& cell_ids, Label label) {
   }
 }
 
-void S2CellIndex::Build() {
+namespace {
+
+// The current version of the S2CellIndex encoding.
+constexpr uint32_t kCurrentEncodingVersion = 1;
+
+// Implements LessInBuildOrder() for any type with a "cell_id" and a "label".
+struct BuildOrderLess {
+  template <class Cell>
+  bool operator()(const Cell& x, const Cell& y) const {
+    S2CellId x_min = x.cell_id.range_min(), y_min = y.cell_id.range_min();
+    if (x_min < y_min) return true;
+    if (y_min < x_min) return false;
+    // Larger cells starting at the same leaf cell have larger ids.
+    if (y.cell_id < x.cell_id) return true;
+    if (x.cell_id < y.cell_id) return false;
+    return x.label < y.label;
+  }
+};
+
+}  // namespace
+
+bool S2CellIndex::LessInBuildOrder(const LabelledCell& x,
+                                   const LabelledCell& y) {
+  return BuildOrderLess()(x, y);
+}
+
+void S2CellIndex::Build(int num_threads) {
+  ABSL_DCHECK_GE(num_threads, 1);
+  vector<CellNode> cells;
+  cells.swap(cell_tree_);
+  s2internal::ParallelSort(num_threads, cells.begin(), cells.end(),
+                           BuildOrderLess());
+  BuildFromSorted(absl::MakeConstSpan(cells));
+}
+
+void S2CellIndex::BuildSorted(absl::Span<const LabelledCell> cells) {
+  ABSL_DCHECK(cell_tree_.empty() && range_nodes_.empty());
+  ABSL_DCHECK(std::is_sorted(cells.begin(), cells.end(), BuildOrderLess()));
+  BuildFromSorted(cells);
+}
+
+template <class Cell>
+void S2CellIndex::BuildFromSorted(absl::Span<const Cell> cells) {
   // To build the cell tree and leaf cell ranges, we maintain a stack of
-  // (cell_id, label) pairs that contain the current leaf cell.  This class
-  // represents an instruction to push or pop a (cell_id, label) pair.
+  // (cell_id, label) pairs that contain the current leaf cell.  The stack is
+  // represented by "contents", the cell_tree_ node at the top of the stack,
+  // since each node points to the node below it.  Because the cells are
+  // sorted by their first leaf cell (with larger cells first), every stack
+  // entry contains the cells that are pushed on top of it.
   //
-  // If label >= 0, the (cell_id, label) pair is pushed on the stack.
-  // If cell_id == S2CellId::Sentinel(), a pair is popped from the stack.
-  // Otherwise the stack is unchanged but a RangeNode is still emitted.
-  struct Delta {
-    S2CellId start_id, cell_id;
-    Label label;
-
-    Delta(S2CellId _start_id, S2CellId _cell_id, Label _label)
-        : start_id(_start_id), cell_id(_cell_id), label(_label) {}
-
-    // Deltas are sorted first by start_id, then in reverse order by cell_id,
-    // and then by label.  This is necessary to ensure that (1) larger cells
-    // are pushed on the stack before smaller cells, and (2) cells are popped
-    // off the stack before any new cells are added.
-    bool operator<(const Delta& y) const {
-      if (start_id < y.start_id) return true;
-      if (y.start_id < start_id) return false;
-      if (y.cell_id < cell_id) return true;
-      if (cell_id < y.cell_id) return false;
-      return label < y.label;
-    }
-  };
-
-  vector<Delta> deltas;
-  deltas.reserve(2 * cell_tree_.size() + 2);
-  // Create two deltas for each (cell_id, label) pair: one to add the pair to
-  // the stack (at the start of its leaf cell range), and one to remove it from
-  // the stack (at the end of its leaf cell range).
-  for (const CellNode& node : cell_tree_) {
-    deltas.push_back(Delta(node.cell_id.range_min(), node.cell_id, node.label));
-    deltas.push_back(Delta(node.cell_id.range_max().next(),
-                           S2CellId::Sentinel(), -1));
-  }
-  // We also create two special deltas to ensure that a RangeNode is emitted at
-  // the beginning and end of the S2CellId range.
-  deltas.push_back(
-      Delta(S2CellId::Begin(S2CellId::kMaxLevel), S2CellId::None(), -1));
-  deltas.push_back(
-      Delta(S2CellId::End(S2CellId::kMaxLevel), S2CellId::None(), -1));
-  std::sort(deltas.begin(), deltas.end());
-
-  // Now walk through the deltas to build the leaf cell ranges and cell tree
-  // (which is essentially a permanent form of the "stack" described above).
+  // We visit every leaf cell where a cell is pushed or popped in increasing
+  // order, and emit a RangeNode after processing all the cells that are
+  // pushed or popped there.  A RangeNode is also emitted at the beginning
+  // and end of the S2CellId range.
   cell_tree_.clear();
-  range_nodes_.reserve(deltas.size());
+  cell_tree_.reserve(cells.size());
+  range_nodes_.clear();
+  range_nodes_.reserve(2 * cells.size() + 2);
+  const S2CellId end_id = S2CellId::End(S2CellId::kMaxLevel);
   int contents = -1;
-  for (size_t i = 0; i < deltas.size();) {
-    S2CellId start_id = deltas[i].start_id;
-    // Process all the deltas associated with the current start_id.
-    for (; i < deltas.size() && deltas[i].start_id == start_id; ++i) {
-      if (deltas[i].label >= 0) {
-        cell_tree_.push_back({deltas[i].cell_id, deltas[i].label, contents});
-        contents = cell_tree_.size() - 1;
-      } else if (deltas[i].cell_id == S2CellId::Sentinel()) {
-        contents = cell_tree_[contents].parent;
-      }
+  size_t i = 0;
+  for (S2CellId start_id = S2CellId::Begin(S2CellId::kMaxLevel);;) {
+    // Pop all the cells that end just before "start_id".
+    while (contents >= 0 &&
+           cell_tree_[contents].cell_id.range_max().next() == start_id) {
+      contents = cell_tree_[contents].parent;
+    }
+    // Push all the cells that start at "start_id".
+    for (; i < cells.size() && cells[i].cell_id.range_min() == start_id; ++i) {
+      cell_tree_.push_back({cells[i].cell_id, cells[i].label, contents});
+      contents = cell_tree_.size() - 1;
     }
     range_nodes_.push_back({start_id, contents});
+    if (start_id == end_id) break;
+
+    // Advance to the next leaf cell where a cell is pushed or popped.
+    start_id = end_id;
+    if (i < cells.size()) start_id = cells[i].cell_id.range_min();
+    if (contents >= 0) {
+      start_id = std::min(start_id,
+                          cell_tree_[contents].cell_id.range_max().next());
+    }
+  }
+}
+
+size_t S2CellIndex::SpaceUsed() const {
+  S2SpaceUsage usage;
+  GetSpaceUsage(&usage);
+  return usage.total_bytes();
+}
+
+void S2CellIndex::GetSpaceUsage(S2SpaceUsage* usage) const {
+  usage->Add("object", sizeof(*this));
+  usage->Add("cell_tree", cell_tree_.capacity() * sizeof(CellNode));
+  usage->Add("range_nodes", range_nodes_.capacity() * sizeof(RangeNode));
+}
+
+void S2CellIndex::Encode(Encoder* encoder) const {
+  ABSL_DCHECK(!range_nodes_.empty()) << "Call Build() first.";
+  // The cell tree and leaf cell ranges are encoded as flat arrays so that
+  // EncodedS2CellIndex can query them in place.  Parent and contents indexes
+  // are offset by one so that -1 is encoded as 0.
+  vector<S2CellId> cell_ids, start_ids;
+  vector<uint32_t> labels, parents, contents;
+  cell_ids.reserve(cell_tree_.size());
+  labels.reserve(cell_tree_.size());
+  parents.reserve(cell_tree_.size());
+  for (const CellNode& node : cell_tree_) {
+    cell_ids.push_back(node.cell_id);
+    labels.push_back(node.label);
+    parents.push_back(node.parent + 1);
+  }
+  start_ids.reserve(range_nodes_.size());
+  contents.reserve(range_nodes_.size());
+  for (const RangeNode& range : range_nodes_) {
+    start_ids.push_back(range.start_id);
+    contents.push_back(range.contents + 1);
+  }
+  encoder->Ensure(Encoder::kVarintMax32);
+  encoder->put_varint32(kCurrentEncodingVersion);
+  s2coding::EncodeS2CellIdVector(cell_ids, encoder);
+  s2coding::EncodeUintVector<uint32_t>(labels, encoder);
+  s2coding::EncodeUintVector<uint32_t>(parents, encoder);
+  s2coding::EncodeS2CellIdVector(start_ids, encoder);
+  s2coding::EncodeUintVector<uint32_t>(contents, encoder);
+}
+
+bool S2CellIndex::Decode(Decoder* decoder) {
+  uint32_t version;
+  if (!decoder->get_varint32(&version) || version != kCurrentEncodingVersion) {
+    return false;
+  }
+  s2coding::EncodedS2CellIdVector cell_ids, start_ids;
+  s2coding::EncodedUintVector<uint32_t> labels, parents, contents;
+  if (!cell_ids.Init(decoder) || !labels.Init(decoder) ||
+      !parents.Init(decoder) || !start_ids.Init(decoder) ||
+      !contents.Init(decoder)) {
+    return false;
+  }
+  const size_t num_cells = cell_ids.size(), num_ranges = start_ids.size();
+  if (labels.size() != num_cells || parents.size() != num_cells ||
+      contents.size() != num_ranges || num_ranges < 2 ||
+      start_ids[0] != S2CellId::Begin(S2CellId::kMaxLevel) ||
+      start_ids[num_ranges - 1] != S2CellId::End(S2CellId::kMaxLevel)) {
+    return false;
+  }
+  // Check that every node's parent precedes it (which ensures that the
+  // ContentsIterator terminates) and that the ranges are sorted.
+  vector<CellNode> cell_tree;
+  cell_tree.reserve(num_cells);
+  for (size_t i = 0; i < num_cells; ++i) {
+    if (!cell_ids[i].is_valid() ||
+        labels[i] > std::numeric_limits<Label>::max() || parents[i] > i) {
+      return false;
+    }
+    cell_tree.push_back(CellNode(cell_ids[i], labels[i],
+                                 static_cast<int32_t>(parents[i]) - 1));
+  }
+  vector<RangeNode> range_nodes;
+  range_nodes.reserve(num_ranges);
+  for (size_t i = 0; i < num_ranges; ++i) {
+    if (contents[i] > num_cells ||
+        (i > 0 && start_ids[i] <= range_nodes.back().start_id)) {
+      return false;
+    }
+    range_nodes.push_back(RangeNode(start_ids[i],
+                                     static_cast<int32_t>(contents[i]) - 1));
   }
+  cell_tree_.swap(cell_tree);
+  range_nodes_.swap(range_nodes);
+  return true;
 }
 
 flat_hash_set<Label> S2CellIndex::GetIntersectingLabels(
@@ -153,3 +271,60 @@ void S2CellIndex::GetIntersectingLabels(const S2CellUnion& target,
     return true;
   });
 }
+
+void S2CellIndex::GetIntersectingLabels(absl::Span<const S2CellUnion> targets,
+                                        vector<int>* offsets,
+                                        vector<Label>* labels) const {
+  offsets->assign(1, 0);
+  labels->clear();
+  if (targets.empty()) return;
+
+  // Sort the targets by their first cell, remembering their original
+  // positions.  (Empty targets have no first cell and are sorted first.)
+  vector<pair<S2CellId, int>> order;
+  order.reserve(targets.size());
+  for (int i = 0; i < static_cast<int>(targets.size()); ++i) {
+    order.emplace_back(
+        targets[i].empty() ? S2CellId::None() : targets[i].begin()->range_min(),
+        i);
+  }
+  if (!std::is_sorted(order.begin(), order.end())) {
+    std::sort(order.begin(), order.end());
+  }
+
+  // Compute the labels for each target in sorted order.  "starts" and "ends"
+  // record where the labels of each target begin and end within "sorted".
+  vector<Label> sorted;
+  vector<int> starts(targets.size()), ends(targets.size());
+  ContentsIterator contents(this);
+  RangeIterator range(this);
+  range.Begin();
+  for (const auto& [start_id, i] : order) {
+    const int start = sorted.size();
+    if (!targets[i].empty()) {
+      // The range iterator only needs to move backward when this target
+      // starts before the range reached by the previous one.
+      if (start_id < range.start_id()) range.Seek(start_id);
+      contents.Clear();
+      VisitIntersectingCells(targets[i], &range, &contents,
+                             [&sorted](S2CellId cell_id, Label label) {
+                               sorted.push_back(label);
+                               return true;
+                             });
+      std::sort(sorted.begin() + start, sorted.end());
+      sorted.erase(std::unique(sorted.begin() + start, sorted.end()),
+                   sorted.end());
+    }
+    starts[i] = start;
+    ends[i] = sorted.size();
+  }
+
+  // Copy the labels to the output in the original order of the targets.
+  offsets->reserve(targets.size() + 1);
+  labels->reserve(sorted.size());
+  for (int i = 0; i < static_cast<int>(targets.size()); ++i) {
+    labels->insert(labels->end(), sorted.begin() + starts[i],
+                   sorted.begin() + ends[i]);
+    offsets->push_back(labels->size());
+  }
+}
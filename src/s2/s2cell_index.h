@@ -19,6 +19,7 @@
 #define S2_S2CELL_INDEX_H_
 
 #include <algorithm>
+#include <cstddef>
 #include <cstdint>
 #include <functional>
 #include <ostream>
@@ -26,11 +27,14 @@
 
 #include "absl/container/flat_hash_set.h"
 #include "absl/log/absl_check.h"
+#include "absl/types/span.h"
 
+#include "s2/util/coding/coder.h"
 #include "s2/base/types.h"
 #include "s2/base/log_severity.h"
 #include "s2/s2cell_id.h"
 #include "s2/s2cell_union.h"
+#include "s2/s2space_usage.h"
 
 // S2CellIndex stores a collection of (cell_id, label) pairs.  The S2CellIds
 // may be overlapping or contain duplicate values.  For example, an
@@ -66,6 +70,12 @@
 // Note that the index is not dynamic; the contents of the index cannot be
 // changed once it has been built.
 //
+// Very large indexes can be built more quickly by passing a number of threads
+// to Build(), or by calling BuildSorted() with cells that are already sorted
+// (see LessInBuildOrder).  A built index can be saved with Encode() and then
+// either loaded with Decode() (which does not need to build it again) or
+// queried in place using EncodedS2CellIndex.
+//
 // There are several options for retrieving data from the index.  The simplest
 // is to use a built-in method such as GetIntersectingLabels (which returns
 // the labels of all cells that intersect a given target S2CellUnion):
@@ -163,12 +173,49 @@ class S2CellIndex {
   void Add(const S2CellUnion& cell_ids, Label label);
 
   // Constructs the index.  This method may only be called once.  No iterators
-  // may be used until the index is built.
-  void Build();
+  // may be used until the index is built.  Up to "num_threads" threads
+  // (including the calling thread) are used to sort the cells.
+  //
+  // REQUIRES: num_threads >= 1
+  void Build(int num_threads = 1);
+
+  // Returns true if "x" must precede "y" in the input to BuildSorted(), i.e.
+  // if x.cell_id.range_min() < y.cell_id.range_min(), or if the ranges
+  // start at the same leaf cell and "x" is larger than "y" (or the cells are
+  // equal and x.label < y.label).  For cells that do not overlap, this is the
+  // same as S2CellId order.
+  static bool LessInBuildOrder(const LabelledCell& x, const LabelledCell& y);
+
+  // Like Add() followed by Build(), except that "cells" must already be
+  // sorted according to LessInBuildOrder().  This avoids copying and sorting
+  // the cells, so it is much faster than Build() for large indexes.
+  //
+  // REQUIRES: The index is empty (e.g., Clear() was called).
+  // REQUIRES: absl::c_is_sorted(cells, LessInBuildOrder)
+  void BuildSorted(absl::Span<const LabelledCell> cells);
 
   // Clears the index so that it can be re-used.
   void Clear();
 
+  // Returns the number of bytes currently occupied by the index (including
+  // any unused space at the end of vectors, etc).
+  size_t SpaceUsed() const;
+
+  // Appends a breakdown of SpaceUsed() to "usage", consisting of the
+  // components "object" (sizeof(*this)), "cell_tree", and "range_nodes".
+  void GetSpaceUsage(S2SpaceUsage* usage) const;
+
+  // Appends an encoded representation of the index to "encoder".
+  //
+  // REQUIRES: Build() or BuildSorted() has been called.
+  // REQUIRES: "encoder" uses the default constructor, so that its buffer
+  //           can be enlarged as necessary by calling Ensure(int).
+  void Encode(Encoder* encoder) const;
+
+  // Decodes an S2CellIndex encoded with Encode(), replacing any existing
+  // contents.  Returns true on success.
+  bool Decode(Decoder* decoder);
+
   // A function that is called with each (cell_id, label) pair to be visited.
   // The function may return false in order to indicate that no further
   // (cell_id, label) pairs are needed.
@@ -192,6 +239,21 @@ class S2CellIndex {
   void GetIntersectingLabels(const S2CellUnion& target,
                              absl::flat_hash_set<Label>* labels) const;
 
+  // Batch version of GetIntersectingLabels() that is much faster when there
+  // are many small targets.  The labels of the cells that intersect
+  // targets[i] are returned in (*labels)[(*offsets)[i], (*offsets)[i + 1])
+  // in increasing order without duplicates, and "offsets" has
+  // targets.size() + 1 elements.
+  //
+  // The targets are processed in order of their first cell, reusing the
+  // index iterators in a single pass over the leaf cell ranges so that
+  // nearby targets do not need to seek again.  Targets that are already
+  // sorted this way are detected and not re-sorted.  No sets are allocated,
+  // and the output vectors keep their storage when they are reused.
+  void GetIntersectingLabels(absl::Span<const S2CellUnion> targets,
+                             std::vector<int>* offsets,
+                             std::vector<Label>* labels) const;
+
  private:
   // Represents a node in the set of non-overlapping leaf cell ranges.
   struct RangeNode;
@@ -422,6 +484,20 @@ class S2CellIndex {
   friend class RangeIterator;
   friend class ContentsIterator;
 
+  // Like VisitIntersectingCells(), but starts from the current positions of
+  // the given iterators.  "range" is only moved forward (and "contents" only
+  // suppresses duplicates) within the given target.
+  template <class Visitor>
+  bool VisitIntersectingCells(const S2CellUnion& target, RangeIterator* range,
+                              ContentsIterator* contents,
+                              const Visitor& visitor) const;
+
+  // Builds cell_tree_ and range_nodes_ from "cells", which must be sorted
+  // according to LessInBuildOrder().  "Cell" may be any type with "cell_id"
+  // and "label" fields.
+  template <class Cell>
+  void BuildFromSorted(absl::Span<const Cell> cells);
+
   // A tree of (cell_id, label) pairs such that if X is an ancestor of Y, then
   // X.cell_id contains Y.cell_id.  The contents of a given range of leaf
   // cells can be represented by pointing to a node of this tree.
@@ -637,17 +713,25 @@ inline void S2CellIndex::Clear() {
 inline bool S2CellIndex::VisitIntersectingCells(
     const S2CellUnion& target, const CellVisitor& visitor) const {
   if (target.empty()) return true;
-  auto it = target.begin();
   ContentsIterator contents(this);
   RangeIterator range(this);
   range.Begin();
+  return VisitIntersectingCells(target, &range, &contents, visitor);
+}
+
+template <class Visitor>
+inline bool S2CellIndex::VisitIntersectingCells(
+    const S2CellUnion& target, RangeIterator* range,
+    ContentsIterator* contents, const Visitor& visitor) const {
+  if (target.empty()) return true;
+  auto it = target.begin();
   do {
-    if (range.limit_id() <= it->range_min()) {
-      range.Seek(it->range_min());  // Only seek when necessary.
+    if (range->limit_id() <= it->range_min()) {
+      range->Seek(it->range_min());  // Only seek when necessary.
     }
-    for (; range.start_id() <= it->range_max(); range.Next()) {
-      for (contents.StartUnion(range); !contents.done(); contents.Next()) {
-        if (!visitor(contents.cell_id(), contents.label())) {
+    for (; range->start_id() <= it->range_max(); range->Next()) {
+      for (contents->StartUnion(*range); !contents->done(); contents->Next()) {
+        if (!visitor(contents->cell_id(), contents->label())) {
           return false;
         }
       }
@@ -656,10 +740,10 @@ inline bool S2CellIndex::VisitIntersectingCells(
     // range that we just processed.  If so, we can skip over all such cells
     // using binary search.  This speeds up benchmarks by between 2x and 10x
     // when the average number of intersecting cells is small (< 1).
-    if (++it != target.end() && it->range_max() < range.start_id()) {
+    if (++it != target.end() && it->range_max() < range->start_id()) {
       // Skip to the first target cell that extends past the previous range.
-      it = std::lower_bound(it + 1, target.end(), range.start_id());
-      if ((it - 1)->range_max() >= range.start_id()) --it;
+      it = std::lower_bound(it + 1, target.end(), range->start_id());
+      if ((it - 1)->range_max() >= range->start_id()) --it;
     }
   } while (it != target.end());
   return true;
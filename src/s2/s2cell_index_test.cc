@@ -33,6 +33,7 @@
 #include "absl/strings/str_format.h"
 #include "absl/strings/string_view.h"
 #include "absl/types/span.h"
+#include "s2/util/coding/coder.h"
 #include "s2/s1angle.h"
 #include "s2/s2cell_id.h"
 #include "s2/s2cell_union.h"
@@ -290,6 +291,92 @@ TEST_F(S2CellIndexTest, RandomCellUnions) {
   QuadraticValidate();
 }
 
+// Verifies that two built indexes have identical cell trees and leaf cell
+// ranges.
+void ExpectIdentical(const S2CellIndex& expected, const S2CellIndex& actual) {
+  vector<LabelledCell> expected_cells, actual_cells;
+  for (S2CellIndex::CellIterator it(&expected); !it.done(); it.Next()) {
+    expected_cells.push_back(it.labelled_cell());
+  }
+  for (S2CellIndex::CellIterator it(&actual); !it.done(); it.Next()) {
+    actual_cells.push_back(it.labelled_cell());
+  }
+  EXPECT_EQ(expected_cells, actual_cells);
+
+  S2CellIndex::RangeIterator expected_range(&expected), actual_range(&actual);
+  S2CellIndex::ContentsIterator expected_contents(&expected),
+      actual_contents(&actual);
+  for (expected_range.Begin(), actual_range.Begin(); !expected_range.done();
+       expected_range.Next(), actual_range.Next()) {
+    ASSERT_FALSE(actual_range.done());
+    ASSERT_EQ(expected_range.start_id(), actual_range.start_id());
+    ASSERT_EQ(expected_range.is_empty(), actual_range.is_empty());
+    expected_contents.StartUnion(expected_range);
+    actual_contents.StartUnion(actual_range);
+    for (; !expected_contents.done();
+         expected_contents.Next(), actual_contents.Next()) {
+      ASSERT_FALSE(actual_contents.done());
+      ASSERT_EQ(expected_contents.labelled_cell(),
+                actual_contents.labelled_cell());
+    }
+    ASSERT_TRUE(actual_contents.done());
+  }
+  EXPECT_TRUE(actual_range.done());
+}
+
+TEST_F(S2CellIndexTest, BuildVariantsAgree) {
+  absl::BitGen bitgen(S2Testing::MakeTaggedSeedSeq(
+      "BUILD_VARIANTS_AGREE",
+      absl::LogInfoStreamer(__FILE__, __LINE__).stream()));
+  // Enough cells that Build() sorts them using several threads.  Cells are
+  // concentrated within one face cell so that they often overlap, and some
+  // cells are added twice.
+  S2CellId root = S2CellId::FromDebugString("3/0121");
+  S2CellIndex parallel;
+  for (int i = 0; i < 100000; ++i) {
+    S2CellId id = s2random::CellId(bitgen);
+    id = root.child_begin(S2CellId::kMaxLevel)
+             .advance(id.pos() >> (2 * root.level() + 1))
+             .parent(absl::Uniform(bitgen, root.level(), 18));
+    Label label = absl::Uniform(bitgen, 0, 1000);
+    int copies = absl::Bernoulli(bitgen, 0.05) ? 2 : 1;
+    for (int j = 0; j < copies; ++j) {
+      Add(id, label);
+      parallel.Add(id, label);
+    }
+  }
+  Build();
+  parallel.Build(4);
+  ExpectIdentical(index_, parallel);
+
+  S2CellIndex sorted;
+  std::sort(contents_.begin(), contents_.end(), S2CellIndex::LessInBuildOrder);
+  sorted.BuildSorted(contents_);
+  ExpectIdentical(index_, sorted);
+
+  Encoder encoder;
+  index_.Encode(&encoder);
+  S2CellIndex decoded;
+  Decoder decoder(encoder.base(), encoder.length());
+  ASSERT_TRUE(decoded.Decode(&decoder));
+  EXPECT_EQ(decoder.avail(), 0);
+  ExpectIdentical(index_, decoded);
+
+  // Truncated encodings are rejected.
+  Decoder truncated(encoder.base(), encoder.length() - 1);
+  EXPECT_FALSE(decoded.Decode(&truncated));
+}
+
+TEST_F(S2CellIndexTest, EncodeEmpty) {
+  Build();
+  Encoder encoder;
+  index_.Encode(&encoder);
+  S2CellIndex decoded;
+  Decoder decoder(encoder.base(), encoder.length());
+  ASSERT_TRUE(decoded.Decode(&decoder));
+  ExpectIdentical(index_, decoded);
+}
+
 // Given an S2CellId "target_str" in human-readable form, expects that the
 // first leaf cell contained by this target will intersect the exact set of
 // (cell_id, label) pairs given by "expected_strs".
@@ -434,4 +521,53 @@ TEST_F(S2CellIndexTest, IntersectionSemiRandomUnions) {
   }
 }
 
+TEST_F(S2CellIndexTest, BatchIntersectingLabels) {
+  absl::BitGen bitgen(S2Testing::MakeTaggedSeedSeq(
+      "BATCH_INTERSECTING_LABELS",
+      absl::LogInfoStreamer(__FILE__, __LINE__).stream()));
+  for (int i = 0; i < 100; ++i) {
+    Add(GetRandomCellUnion(bitgen), i);
+  }
+  Build();
+
+  // The targets overlap each other and are not sorted.  Also include some
+  // empty targets and a target that is repeated.
+  vector<S2CellUnion> targets;
+  for (int i = 0; i < 200; ++i) {
+    targets.push_back(absl::Bernoulli(bitgen, 0.05)
+                          ? S2CellUnion()
+                          : GetRandomCellUnion(bitgen));
+  }
+  targets.push_back(targets[0]);
+
+  vector<int> offsets = {5, 6};
+  vector<Label> labels = {7};
+  for (int iter = 0; iter < 2; ++iter) {
+    index_.GetIntersectingLabels(targets, &offsets, &labels);
+    ASSERT_EQ(offsets.size(), targets.size() + 1);
+    EXPECT_EQ(offsets.front(), 0);
+    EXPECT_EQ(offsets.back(), static_cast<int>(labels.size()));
+    for (int i = 0; i < static_cast<int>(targets.size()); ++i) {
+      vector<Label> expected;
+      for (Label label : index_.GetIntersectingLabels(targets[i])) {
+        expected.push_back(label);
+      }
+      std::sort(expected.begin(), expected.end());
+      EXPECT_EQ(vector<Label>(labels.begin() + offsets[i],
+                              labels.begin() + offsets[i + 1]),
+                expected);
+    }
+    // Sorted targets are handled the same way.
+    std::sort(targets.begin(), targets.end(),
+              [](const S2CellUnion& a, const S2CellUnion& b) {
+                return (a.empty() ? S2CellId::None() : a.cell_id(0)) <
+                       (b.empty() ? S2CellId::None() : b.cell_id(0));
+              });
+  }
+
+  index_.GetIntersectingLabels({}, &offsets, &labels);
+  EXPECT_EQ(offsets, vector<int>{0});
+  EXPECT_TRUE(labels.empty());
+}
+
 }  // namespace
@@ -16,6 +16,8 @@
 #ifndef S2_S2CELL_ITERATOR_JOIN_H_
 #define S2_S2CELL_ITERATOR_JOIN_H_
 
+#include <algorithm>
+#include <atomic>
 #include <cstdint>
 #include <functional>
 #include <type_traits>
@@ -23,8 +25,10 @@
 
 #include "absl/base/optimization.h"
 #include "absl/container/inlined_vector.h"
+#include "absl/log/absl_check.h"
 #include "absl/types/span.h"
 #include "s2/internal/s2meta.h"
+#include "s2/internal/s2parallel.h"
 #include "s2/s1chord_angle.h"
 #include "s2/s2cell.h"
 #include "s2/s2cell_id.h"
@@ -131,6 +135,72 @@ class S2CellIteratorJoin {
     }
   }
 
+  // Like Join(), but splits the work into "partitions" and processes them
+  // concurrently using up to "num_threads" threads (including the calling
+  // thread).  Each pair of overlapping cells is assigned to the partition
+  // containing the first leaf cell of their intersection, and is reported by
+  // calling visitor(i, iter_a, iter_b) where "i" is the partition index.
+  // Pairs whose intersection starts outside all of the partitions are not
+  // reported.
+  //
+  // All the pairs of a given partition are reported from a single thread and
+  // in the same order as Join(), so the visitor can append its output to a
+  // per-partition buffer without locking.  If the partitions are sorted and
+  // cover the sphere, concatenating these buffers yields the same output as
+  // Join().  For example:
+  //
+  //   // Balance the work using the density of one of the indexes.
+  //   auto partitions = density_tree.GetPartitioning(max_weight, &error);
+  //   vector<vector<Pair>> output(partitions.size());
+  //   join.ParallelJoin(partitions, num_threads,
+  //                     [&](int i, const auto& iter_a, const auto& iter_b) {
+  //                       output[i].push_back({iter_a.id(), iter_b.id()});
+  //                       return true;
+  //                     });
+  //
+  // Alternatively the partitions can be the six faces, or any other set of
+  // disjoint cells.  There should be several times more partitions than
+  // threads so that the threads stay busy.
+  //
+  // Each thread uses its own copy of the iterators, so the underlying
+  // containers must support concurrent reads (as S2ShapeIndex and
+  // S2PointIndex do once they are built).  Returns false if the visitor ever
+  // does, in which case the remaining partitions are skipped.
+  //
+  // REQUIRES: The cells of all partitions are disjoint.
+  // REQUIRES: The tolerance is zero.
+  template <typename Visitor>
+  bool ParallelJoin(absl::Span<const S2CellUnion> partitions, int num_threads,
+                    Visitor visitor) const {
+    static_assert(
+        std::is_convertible<
+            Visitor,
+            std::function<bool(int, const IteratorA&, const IteratorB&)>>{},
+        "Visitor must return bool and be callable with a partition index "
+        "and two const references to the iterators");
+    ABSL_DCHECK(tolerance_ == S1ChordAngle::Zero())
+        << "ParallelJoin() does not support tolerant joins";
+
+    std::atomic<bool> cancelled{false};
+    s2internal::ParallelFor(
+        num_threads, static_cast<int>(partitions.size()), [&](int i) {
+          auto iter_a = iter_a_;
+          auto iter_b = iter_b_;
+          for (S2CellId range : partitions[i]) {
+            if (cancelled.load(std::memory_order_relaxed)) return;
+            if (!ExactJoinRange(
+                    range, iter_a, iter_b,
+                    [&](const IteratorA& a, const IteratorB& b) {
+                      return visitor(i, a, b);
+                    })) {
+              cancelled.store(true, std::memory_order_relaxed);
+              return;
+            }
+          }
+        });
+    return !cancelled.load(std::memory_order_relaxed);
+  }
+
  private:
   S2CellRangeIterator<IteratorA> iter_a_;
   S2CellRangeIterator<IteratorB> iter_b_;
@@ -143,6 +213,14 @@ class S2CellIteratorJoin {
   template <typename Visitor>
   bool ExactJoin(Visitor& visitor);
 
+  // Like ExactJoin(), but using the given iterators and visiting only the
+  // pairs whose intersection starts within "range".
+  template <typename Visitor>
+  static bool ExactJoinRange(S2CellId range,
+                             S2CellRangeIterator<IteratorA>& iter_a,
+                             S2CellRangeIterator<IteratorB>& iter_b,
+                             const Visitor& visitor);
+
   // ---- Tolerant join related code.
 
   // Maximum number of cross-terms before we recurse.
@@ -266,6 +344,58 @@ bool S2CellIteratorJoin<A, B>::ExactJoin(Visitor& visitor) {
   return true;
 }
 
+template <typename A, typename B>
+template <typename Visitor>
+bool S2CellIteratorJoin<A, B>::ExactJoinRange(
+    S2CellId range, S2CellRangeIterator<A>& iter_a,
+    S2CellRangeIterator<B>& iter_b, const Visitor& visitor) {
+  const S2CellId begin = range.range_min(), end = range.range_max();
+
+  // Start at the last cell that precedes "begin" (if any), since it may
+  // overlap the range.
+  iter_a.Seek(begin);
+  iter_a.Prev();
+  iter_b.Seek(begin);
+  iter_b.Prev();
+
+  // Since cells are nested, the intersection of two overlapping cells starts
+  // at the larger of their range_min() values.  This value never decreases
+  // as the iterators advance, which lets us stop once it passes "end".
+  while (!iter_a.done() && !iter_b.done()) {
+    const S2CellId start = std::max(iter_a.range_min(), iter_b.range_min());
+    if (start > end) break;
+    int order = iter_a.Relation(iter_b);
+    switch (order) {
+      case -1:
+        iter_a.SeekTo(iter_b);
+        break;
+
+      case +1:
+        iter_b.SeekTo(iter_a);
+        break;
+
+      case 0: {
+        // Pairs that start before "begin" belong to a different range.
+        if (start >= begin && !visitor(iter_a.iterator(), iter_b.iterator())) {
+          return false;
+        }
+        const uint64_t lsb_a = iter_a.id().lsb();
+        const uint64_t lsb_b = iter_b.id().lsb();
+        if (lsb_a < lsb_b) {
+          iter_a.Next();
+        } else if (lsb_a > lsb_b) {
+          iter_b.Next();
+        } else {
+          iter_a.Next();
+          iter_b.Next();
+        }
+        break;
+      }
+    }
+  }
+  return true;
+}
+
 template <typename A, typename B>
 template <typename Iterator, typename Visitor>
 inline bool S2CellIteratorJoin<A, B>::ScanCellRange(Iterator& iter, S2CellId id,
@@ -32,6 +32,7 @@
 #include "s2/s1chord_angle.h"
 #include "s2/s2cell.h"
 #include "s2/s2cell_id.h"
+#include "s2/s2cell_union.h"
 #include "s2/s2cell_iterator_testing.h"
 #include "s2/s2edge_crossings.h"
 #include "s2/s2fractal.h"
@@ -336,6 +337,71 @@ TEST(S2CellIteratorJoin, AllPairsSeen) {
   EXPECT_THAT(brute_pairs, Eq(join_pairs));
 }
 
+TEST(S2CellIteratorJoin, ParallelJoinMatchesJoin) {
+  absl::BitGen bitgen(S2Testing::MakeTaggedSeedSeq(
+      "PARALLEL_JOIN_MATCHES_JOIN",
+      absl::LogInfoStreamer(__FILE__, __LINE__).stream()));
+  S2Fractal fractal(bitgen);
+
+  // Two overlapping polygons of different complexity that span the boundary
+  // between faces, so that their indexes have cells of different sizes.
+  fractal.SetLevelForApproxMaxEdges(3000);
+  S2Polygon polygon_a(
+      fractal.MakeLoop(UpFrameAt(0, -45), S1Angle::Degrees(20)));
+  fractal.SetLevelForApproxMaxEdges(100);
+  S2Polygon polygon_b(
+      fractal.MakeLoop(UpFrameAt(5, -40), S1Angle::Degrees(20)));
+  polygon_a.index().ForceBuild();
+  polygon_b.index().ForceBuild();
+
+  using Iter = MutableS2ShapeIndex::Iterator;
+  const auto join = MakeS2CellIteratorJoin(&polygon_a.index(),
+                                           &polygon_b.index());
+  vector<std::pair<S2CellId, S2CellId>> expected;
+  auto serial_join = join;
+  serial_join.Join([&](const Iter& a, const Iter& b) {
+    expected.emplace_back(a.id(), b.id());
+    return true;
+  });
+  ASSERT_GT(expected.size(), 100);
+
+  // Split the sphere into cells of various levels, which are grouped into
+  // partitions of consecutive cells.
+  for (int level : {0, 2, 4}) {
+    vector<S2CellUnion> partitions;
+    vector<S2CellId> cells;
+    for (S2CellId id = S2CellId::Begin(level); id != S2CellId::End(level);
+         id = id.next()) {
+      cells.push_back(id);
+      if (cells.size() == 3 || id.next() == S2CellId::End(level)) {
+        partitions.push_back(S2CellUnion::FromVerbatim(std::move(cells)));
+        cells.clear();
+      }
+    }
+    for (int num_threads : {1, 4}) {
+      vector<vector<std::pair<S2CellId, S2CellId>>> output(partitions.size());
+      EXPECT_TRUE(join.ParallelJoin(
+          partitions, num_threads, [&](int i, const Iter& a, const Iter& b) {
+            output[i].emplace_back(a.id(), b.id());
+            return true;
+          }));
+      vector<std::pair<S2CellId, S2CellId>> actual;
+      for (const auto& pairs : output) {
+        actual.insert(actual.end(), pairs.begin(), pairs.end());
+      }
+      EXPECT_THAT(actual, Eq(expected)) << level << " " << num_threads;
+    }
+  }
+
+  // Stopping early.
+  vector<S2CellUnion> faces;
+  for (int face = 0; face < 6; ++face) {
+    faces.push_back(S2CellUnion::FromVerbatim({S2CellId::FromFace(face)}));
+  }
+  EXPECT_FALSE(join.ParallelJoin(
+      faces, 4, [](int, const Iter&, const Iter&) { return false; }));
+}
+
 TEST(S2CellIteratorJoin, b299938257Regression) {
   // This triggers a bug where the join wasn't checking for the end of the
   // iterator before de-referencing it to check for the cell id.
@@ -36,6 +36,7 @@
 #include "absl/strings/str_cat.h"
 #include "absl/strings/str_format.h"
 #include "absl/strings/string_view.h"
+#include "absl/types/span.h"
 
 #include "s2/base/log_severity.h"
 #include "s2/r2.h"
@@ -567,6 +568,33 @@ TEST(S2Cell, GetDistanceToPoint) {
   }
 }
 
+TEST(S2Cell, GetDistancesMatchesGetDistance) {
+  absl::BitGen bitgen(S2Testing::MakeTaggedSeedSeq(
+      "GET_DISTANCES",
+      absl::LogInfoStreamer(__FILE__, __LINE__).stream()));
+  for (int iter = 0; iter < 100; ++iter) {
+    S2Cell cell(s2random::CellId(bitgen));
+    // Choose targets both near the cell and anywhere on the sphere.
+    S2Cap cap = cell.GetCapBound();
+    vector<S2Point> targets;
+    for (int i = 0; i < 100; ++i) {
+      targets.push_back(
+          absl::Bernoulli(bitgen, 0.5)
+              ? s2random::Point(bitgen)
+              : s2random::SamplePoint(
+                    bitgen, S2Cap(cap.center(), 2 * cap.GetRadius())));
+    }
+    vector<S1ChordAngle> distances(targets.size());
+    vector<S1ChordAngle> boundary_distances(targets.size());
+    cell.GetDistances(targets, absl::MakeSpan(distances));
+    cell.GetBoundaryDistances(targets, absl::MakeSpan(boundary_distances));
+    for (int i = 0; i < targets.size(); ++i) {
+      EXPECT_EQ(cell.GetDistance(targets[i]), distances[i]);
+      EXPECT_EQ(cell.GetBoundaryDistance(targets[i]), boundary_distances[i]);
+    }
+  }
+}
+
 static void ChooseEdgeNearCell(absl::BitGenRef bitgen, const S2Cell& cell,
                                S2Point* a, S2Point* b) {
   S2Cap cap = cell.GetCapBound();
@@ -27,9 +27,11 @@
 #include "absl/flags/flag.h"
 #include "absl/log/absl_check.h"
 #include "absl/strings/str_cat.h"
+#include "absl/types/span.h"
 
 #include "s2/base/commandlineflags.h"
 #include "s2/base/types.h"
+#include "s2/internal/s2parallel.h"
 #include "s2/s1angle.h"
 #include "s2/s2cap.h"
 #include "s2/s2cell.h"
@@ -164,6 +166,29 @@ void S2CellUnion::Normalize() {
   Normalize(&cell_ids_);
 }
 
+// Appends "id" to the normalized cell union out[0..*size), discarding cells
+// contained by other cells and replacing groups of four siblings by their
+// parent.  "id" must not precede any cell already in the union.
+static inline void AppendNormalized(S2CellId id, S2CellId* out, size_t* size) {
+  ABSL_DCHECK(id.is_valid()) << id;
+  size_t n = *size;
+  // Check whether this cell is contained by the previous cell.
+  if (n > 0 && out[n - 1].contains(id)) return;
+
+  // Discard any previous cells contained by this cell.
+  while (n > 0 && id.contains(out[n - 1])) --n;
+
+  // Check whether the last 3 elements plus "id" can be collapsed into a
+  // single parent cell.
+  while (n >= 3 && AreSiblings(out[n - 3], out[n - 2], out[n - 1], id)) {
+    // Replace four children by their parent cell.
+    id = id.parent();
+    n -= 3;
+  }
+  out[n++] = id;
+  *size = n;
+}
+
 /*static*/ void S2CellUnion::Normalize(vector<S2CellId>* ids) {
   // Optimize the representation by discarding cells contained by other cells,
   // and looking for cases where all subcells of a parent cell are present.
@@ -171,22 +196,7 @@ void S2CellUnion::Normalize() {
   std::sort(ids->begin(), ids->end());
   size_t out = 0;
   for (S2CellId id : *ids) {
-    ABSL_DCHECK(id.is_valid()) << id;
-    // Check whether this cell is contained by the previous cell.
-    if (out > 0 && (*ids)[out-1].contains(id)) continue;
-
-    // Discard any previous cells contained by this cell.
-    while (out > 0 && id.contains((*ids)[out-1])) --out;
-
-    // Check whether the last 3 elements plus "id" can be collapsed into a
-    // single parent cell.
-    while (out >= 3 && AreSiblings((*ids)[out - 3], (*ids)[out - 2],
-                                   (*ids)[out - 1], id)) {
-      // Replace four children by their parent cell.
-      id = id.parent();
-      out -= 3;
-    }
-    (*ids)[out++] = id;
+    AppendNormalized(id, ids->data(), &out);
   }
   if (ids->size() != out)
     ids->resize(out);
@@ -282,6 +292,23 @@ static inline bool EntirelyPrecedes(S2CellId a, S2CellId b) {
   return a.range_max() < b.range_min();
 }
 
+// Equivalent to std::lower_bound(first, last, id, EntirelyPrecedes), except
+// that it uses galloping search: the range is probed at exponentially
+// increasing distances from "first" before doing a binary search.  This
+// takes time logarithmic in the distance skipped rather than in the size of
+// the range, which is faster when merging two unions whose cells are
+// interleaved.
+template <class Iter>
+static Iter SkipPreceding(Iter first, Iter last, S2CellId id) {
+  ptrdiff_t step = 1;
+  while (step < last - first && EntirelyPrecedes(first[step], id)) {
+    first += step;
+    step *= 2;
+  }
+  return std::lower_bound(first, first + min(step, last - first), id,
+                          EntirelyPrecedes);
+}
+
 bool S2CellUnion::Contains(S2CellId id) const {
   // This is an exact test.  Each cell occupies a linear span of the S2
   // space-filling curve, and the cell id is simply the position at the center
@@ -311,7 +338,7 @@ bool S2CellUnion::Contains(const S2CellUnion& y) const {
     // If our first cell ends before the one we need to contain, advance
     // where we start searching.
     if (EntirelyPrecedes(*i, y_id)) {
-      i = std::lower_bound(i + 1, end(), y_id, EntirelyPrecedes);
+      i = SkipPreceding(i + 1, end(), y_id);
       // If we're at the end, we don't contain the current y_id.
       if (i == end()) return false;
     }
@@ -325,12 +352,12 @@ bool S2CellUnion::Intersects(const S2CellUnion& y) const {
   for (auto i = begin(), j = y.begin(); i != end() && j != y.end(); ) {
     if (EntirelyPrecedes(*i, *j)) {
       // Advance "i" to the first cell that might overlap *j.
-      i = std::lower_bound(i + 1, end(), *j, EntirelyPrecedes);
+      i = SkipPreceding(i + 1, end(), *j);
       continue;
     }
     if (EntirelyPrecedes(*j, *i)) {
       // Advance "j" to the first cell that might overlap *i.
-      j = std::lower_bound(j + 1, y.end(), *i, EntirelyPrecedes);
+      j = SkipPreceding(j + 1, y.end(), *i);
       continue;
     }
     // Neither cell is to the left of the other, so they must intersect.
@@ -341,11 +368,49 @@ bool S2CellUnion::Intersects(const S2CellUnion& y) const {
 }
 
 S2CellUnion S2CellUnion::Union(const S2CellUnion& y) const {
-  vector<S2CellId> cell_ids;
-  cell_ids.reserve(num_cells() + y.num_cells());
-  cell_ids = cell_ids_;
-  cell_ids.insert(cell_ids.end(), y.cell_ids_.begin(), y.cell_ids_.end());
-  return S2CellUnion(std::move(cell_ids));
+  S2CellUnion result;
+  GetUnion(cell_ids_, y.cell_ids_, &result.cell_ids_);
+  return result;
+}
+
+/*static*/ void S2CellUnion::GetUnion(absl::Span<const S2CellId> x,
+                                      absl::Span<const S2CellId> y,
+                                      vector<S2CellId>* out) {
+  ABSL_DCHECK(y.empty() || y.data() != out->data());
+  ABSL_DCHECK(is_sorted(x.begin(), x.end()));
+  ABSL_DCHECK(is_sorted(y.begin(), y.end()));
+
+  // Since both inputs are sorted, merging them yields a sorted sequence that
+  // can be normalized as it is generated.  The output never has more cells
+  // than the two inputs combined.
+  const size_t nx = x.size(), ny = y.size();
+  const S2CellId* xp;
+  if (nx > 0 && x.data() == out->data()) {
+    // To compute the union in place, we first move "x" to the end of the
+    // enlarged output vector.  Every output cell is written at or before the
+    // position of the next unread cell of "x", since at most one cell is
+    // written for each input cell consumed.
+    ABSL_DCHECK_EQ(nx, out->size());
+    out->resize(nx + ny);
+    std::copy_backward(out->begin(), out->begin() + nx, out->end());
+    xp = out->data() + ny;
+  } else {
+    out->clear();
+    out->resize(nx + ny);
+    xp = x.data();
+  }
+  S2CellId* data = out->data();
+  size_t i = 0, j = 0, size = 0;
+  while (i < nx && j < ny) {
+    if (xp[i] < y[j]) {
+      AppendNormalized(xp[i++], data, &size);
+    } else {
+      AppendNormalized(y[j++], data, &size);
+    }
+  }
+  while (i < nx) AppendNormalized(xp[i++], data, &size);
+  while (j < ny) AppendNormalized(y[j++], data, &size);
+  out->resize(size);
 }
 
 S2CellUnion S2CellUnion::Intersection(S2CellId id) const {
@@ -372,21 +437,21 @@ S2CellUnion S2CellUnion::Intersection(const S2CellUnion& y) const {
   return result;
 }
 
-/*static*/ void S2CellUnion::GetIntersection(const vector<S2CellId>& x,
-                                             const vector<S2CellId>& y,
+/*static*/ void S2CellUnion::GetIntersection(absl::Span<const S2CellId> x,
+                                             absl::Span<const S2CellId> y,
                                              vector<S2CellId>* out) {
-  ABSL_DCHECK_NE(out, &x);
-  ABSL_DCHECK_NE(out, &y);
+  ABSL_DCHECK(x.empty() || x.data() != out->data());
+  ABSL_DCHECK(y.empty() || y.data() != out->data());
   ABSL_DCHECK(is_sorted(x.begin(), x.end()));
   ABSL_DCHECK(is_sorted(y.begin(), y.end()));
 
-  // This is a fairly efficient calculation that uses binary search to skip
+  // This is a fairly efficient calculation that uses galloping search to skip
   // over sections of both input vectors.  It takes logarithmic time if all the
   // cells of "x" come before or after all the cells of "y" in S2CellId order.
 
   out->clear();
-  vector<S2CellId>::const_iterator i = x.begin();
-  vector<S2CellId>::const_iterator j = y.begin();
+  auto i = x.begin();
+  auto j = y.begin();
   while (i != x.end() && j != y.end()) {
     S2CellId imin = i->range_min();
     S2CellId jmin = j->range_min();
@@ -396,14 +461,14 @@ S2CellUnion S2CellUnion::Intersection(const S2CellUnion& y) const {
         out->push_back(*i++);
       } else {
         // Advance "j" to the first cell that might overlap *i.
-        j = std::lower_bound(j + 1, y.end(), *i, EntirelyPrecedes);
+        j = SkipPreceding(j + 1, y.end(), *i);
       }
     } else if (jmin > imin) {
       // Identical to the code above with "i" and "j" reversed.
       if (*j <= i->range_max()) {
         out->push_back(*j++);
       } else {
-        i = std::lower_bound(i + 1, x.end(), *j, EntirelyPrecedes);
+        i = SkipPreceding(i + 1, x.end(), *j);
       }
     } else {
       // "i" and "j" have the same range_min(), so one contains the other.
@@ -417,54 +482,129 @@ S2CellUnion S2CellUnion::Intersection(const S2CellUnion& y) const {
   ABSL_DCHECK(is_sorted(out->begin(), out->end()));
 }
 
-static void GetDifferenceInternal(S2CellId cell,
-                                  const S2CellUnion& y,
-                                  vector<S2CellId>* cell_ids) {
-  // Add the difference between cell and y to cell_ids.
-  // If they intersect but the difference is non-empty, divide and conquer.
-  if (!y.Intersects(cell)) {
-    cell_ids->push_back(cell);
-  } else if (!y.Contains(cell)) {
-    S2CellId child = cell.child_begin();
-    for (int i = 0; ; ++i) {
-      GetDifferenceInternal(child, y, cell_ids);
-      if (i == 3) break;  // Avoid unnecessary next() computation.
-      child = child.next();
+// Appends the difference between "cell" and the cells "y" to "out".
+//
+// REQUIRES: "y" is non-empty, sorted, and non-overlapping.
+// REQUIRES: Every cell of "y" is contained by "cell".
+static void GetDifferenceInternal(S2CellId cell, absl::Span<const S2CellId> y,
+                                  vector<S2CellId>* out) {
+  if (y[0] == cell) return;
+
+  // Otherwise every cell of "y" is a proper descendant of "cell", so divide
+  // and conquer.  Children that do not intersect "y" are added to the
+  // output directly.
+  S2CellId child = cell.child_begin();
+  for (int i = 0; ; ++i) {
+    const auto end = std::upper_bound(y.begin(), y.end(), child.range_max());
+    if (end == y.begin()) {
+      out->push_back(child);
+    } else {
+      GetDifferenceInternal(child, y.first(end - y.begin()), out);
+      y.remove_prefix(end - y.begin());
     }
+    if (i == 3) break;  // Avoid unnecessary next() computation.
+    child = child.next();
   }
 }
 
 S2CellUnion S2CellUnion::Difference(const S2CellUnion& y) const {
-  // TODO(ericv): this is approximately O(N*log(N)), but could probably
-  // use similar techniques as GetIntersection() to be more efficient.
-
   S2CellUnion result;
-  for (S2CellId id : *this) {
-    GetDifferenceInternal(id, y, &result.cell_ids_);
-  }
+  GetDifference(cell_ids_, y.cell_ids_, &result.cell_ids_);
   // The output is normalized as long as the first argument is normalized.
   ABSL_DCHECK(result.IsNormalized() || !IsNormalized());
   return result;
 }
 
-void S2CellUnion::Expand(int expand_level) {
-  vector<S2CellId> output;
+/*static*/ void S2CellUnion::GetDifference(absl::Span<const S2CellId> x,
+                                           absl::Span<const S2CellId> y,
+                                           vector<S2CellId>* out) {
+  ABSL_DCHECK(x.empty() || x.data() != out->data());
+  ABSL_DCHECK(y.empty() || y.data() != out->data());
+  ABSL_DCHECK(is_sorted(x.begin(), x.end()));
+  ABSL_DCHECK(is_sorted(y.begin(), y.end()));
+
+  // For each cell of "x", we find the cells of "y" that intersect it.  Since
+  // both inputs are non-overlapping, either a single cell of "y" contains
+  // the cell of "x", or all the intersecting cells of "y" are contained by
+  // it.  As in GetIntersection(), galloping search is used to skip over cells
+  // of "y" that precede the next cell of "x".
+  out->clear();
+  auto j = y.begin();
+  for (S2CellId cell : x) {
+    j = SkipPreceding(j, y.end(), cell);
+    if (j == y.end() || j->range_min() > cell.range_max()) {
+      out->push_back(cell);  // No intersection.
+      continue;
+    }
+    if (j->contains(cell)) continue;
+    const auto end = std::upper_bound(j, y.end(), cell.range_max());
+    GetDifferenceInternal(cell, absl::MakeConstSpan(j, end), out);
+    j = end;
+  }
+}
+
+// Appends the cells of "ids" and all their neighbors at "expand_level" to
+// "output" (see S2CellUnion::Expand).
+static void AppendExpanded(absl::Span<const S2CellId> ids, int expand_level,
+                           vector<S2CellId>* output) {
   uint64_t level_lsb = S2CellId::lsb_for_level(expand_level);
-  for (int i = num_cells(); --i >= 0; ) {
-    S2CellId id = cell_id(i);
+  for (int i = ids.size(); --i >= 0; ) {
+    S2CellId id = ids[i];
     if (id.lsb() < level_lsb) {
       id = id.parent(expand_level);
       // Optimization: skip over any cells contained by this one.  This is
       // especially important when very small regions are being expanded.
-      while (i > 0 && id.contains(cell_id(i - 1))) --i;
+      while (i > 0 && id.contains(ids[i - 1])) --i;
     }
-    output.push_back(id);
-    id.AppendAllNeighbors(expand_level, &output);
+    output->push_back(id);
+    id.AppendAllNeighbors(expand_level, output);
   }
+}
+
+void S2CellUnion::Expand(int expand_level) {
+  vector<S2CellId> output;
+  AppendExpanded(cell_ids_, expand_level, &output);
   Init(std::move(output));
 }
 
+void S2CellUnion::Expand(int expand_level, int num_threads) {
+  // Neighbors of a range of cells may belong anywhere in the output, so each
+  // range is normalized separately and the ranges are then merged.  Since
+  // normalized cell unions are unique, the result does not depend on the
+  // number of ranges.
+  const int num_ranges = min<int>(max(1, num_threads), num_cells());
+  if (num_ranges <= 1) {
+    Expand(expand_level);
+    return;
+  }
+  vector<vector<S2CellId>> ranges(num_ranges);
+  s2internal::ParallelFor(num_threads, num_ranges, [&](int r) {
+    const size_t begin = num_cells() * r / num_ranges;
+    const size_t end = num_cells() * (r + 1) / num_ranges;
+    AppendExpanded(absl::MakeConstSpan(cell_ids_).subspan(begin, end - begin),
+                   expand_level, &ranges[r]);
+    Normalize(&ranges[r]);
+  });
+  while (ranges.size() > 1) {
+    const int num_pairs = ranges.size() / 2;
+    s2internal::ParallelFor(num_threads, num_pairs, [&](int i) {
+      GetUnion(ranges[2 * i], ranges[2 * i + 1], &ranges[2 * i]);
+      vector<S2CellId>().swap(ranges[2 * i + 1]);
+    });
+    for (size_t i = 2; i < ranges.size(); i += 2) {
+      ranges[i / 2] = std::move(ranges[i]);
+    }
+    ranges.resize((ranges.size() + 1) / 2);
+  }
+  cell_ids_ = std::move(ranges[0]);
+}
+
 void S2CellUnion::Expand(S1Angle min_radius, int max_level_diff) {
+  Expand(min_radius, max_level_diff, 1);
+}
+
+void S2CellUnion::Expand(S1Angle min_radius, int max_level_diff,
+                         int num_threads) {
   int min_level = S2CellId::kMaxLevel;
   for (S2CellId id : *this) {
     min_level = min(min_level, id.level());
@@ -474,9 +614,9 @@ void S2CellUnion::Expand(S1Angle min_radius, int max_level_diff) {
   if (radius_level == 0 && min_radius.radians() > S2::kMinWidth.GetValue(0)) {
     // The requested expansion is greater than the width of a face cell.
     // The easiest way to handle this is to expand twice.
-    Expand(0);
+    Expand(0, num_threads);
   }
-  Expand(min(min_level + max_level_diff, radius_level));
+  Expand(min(min_level + max_level_diff, radius_level), num_threads);
 }
 
 uint64_t S2CellUnion::LeafCellsCovered() const {
@@ -30,6 +30,7 @@
 #include "absl/flags/flag.h"
 #include "absl/hash/hash.h"
 #include "absl/log/absl_check.h"
+#include "absl/types/span.h"
 
 #include "s2/_fp_contract_off.h"  // IWYU pragma: keep
 #include "s2/base/commandlineflags.h"
@@ -297,6 +298,13 @@ class S2CellUnion final : public S2Region {
   // number of cells in the input.
   void Expand(S1Angle min_radius, int max_level_diff);
 
+  // Like the two methods above, but uses up to "num_threads" threads.  The
+  // union is divided into ranges of consecutive cells that are expanded and
+  // normalized independently, and the partial results are then merged in
+  // pairs.  The result is identical to the single-threaded version.
+  void Expand(int expand_level, int num_threads);
+  void Expand(S1Angle min_radius, int max_level_diff, int num_threads);
+
   // The number of leaf cells covered by the union.
   // This will be no more than 6*2^60 for the whole sphere.
   uint64_t LeafCellsCovered() const;
@@ -370,7 +378,28 @@ class S2CellUnion final : public S2Region {
                           int min_level, int level_mod,
                           std::vector<S2CellId>* out);
 
-  // Like GetIntersection(), but works directly with vectors of S2CellIds,
+  // The following methods compute set operations directly on sorted,
+  // non-overlapping sequences of S2CellIds (such as the contents of another
+  // S2CellUnion) in a single linear merge pass.  The result replaces the
+  // previous contents of "out", reusing its existing capacity, so calling
+  // these methods repeatedly with the same output vector avoids allocation.
+
+  // Like Union(), but works directly with sequences of S2CellIds.
+  // Equivalent to:
+  //
+  //    *out = S2CellUnion(x).Union(S2CellUnion(y)).Release()
+  //
+  // The inputs need not be normalized, but the output always is.  "out" may
+  // be the same vector as "x", in which case the union is computed in place
+  // (e.g., when merging many cell unions into an accumulated result).
+  //
+  // REQUIRES: "x" and "y" are sorted and non-overlapping.
+  // REQUIRES: "out" does not refer to the data of "y".
+  static void GetUnion(absl::Span<const S2CellId> x,
+                       absl::Span<const S2CellId> y,
+                       std::vector<S2CellId>* out);
+
+  // Like Intersection(), but works directly with sequences of S2CellIds.
   // Equivalent to:
   //
   //    *out = S2CellUnion(x).Intersection(S2CellUnion(y)).Release()
@@ -379,10 +408,25 @@ class S2CellUnion final : public S2Region {
   // requirements: the input vectors may contain groups of 4 child cells that
   // all have the same parent.  (In a normalized S2CellUnion, such groups are
   // always replaced by the parent cell.)
-  static void GetIntersection(const std::vector<S2CellId>& x,
-                              const std::vector<S2CellId>& y,
+  //
+  // REQUIRES: "out" does not refer to the data of "x" or "y".
+  static void GetIntersection(absl::Span<const S2CellId> x,
+                              absl::Span<const S2CellId> y,
                               std::vector<S2CellId>* out);
 
+  // Like Difference(), but works directly with sequences of S2CellIds.
+  // Equivalent to:
+  //
+  //    *out = S2CellUnion(x).Difference(S2CellUnion(y)).Release()
+  //
+  // The output is normalized as long as "x" is normalized.
+  //
+  // REQUIRES: "x" and "y" are sorted and non-overlapping.
+  // REQUIRES: "out" does not refer to the data of "x" or "y".
+  static void GetDifference(absl::Span<const S2CellId> x,
+                            absl::Span<const S2CellId> y,
+                            std::vector<S2CellId>* out);
+
   // Returns a human-readable string describing the S2CellUnion, consisting of
   // the number of cells and the list of S2CellIds in S2CellId::ToToken()
   // format (limited to at most 500 cells).
@@ -0,0 +1,62 @@
+// Copyright 2024 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "s2/s2cell_union.h"
+
+#include <vector>
+
+#include <benchmark/benchmark.h>
+#include "absl/random/random.h"
+#include "s2/s2cap.h"
+#include "s2/s2cell_id.h"
+#include "s2/s2random.h"
+#include "s2/s2region_coverer.h"
+#include "s2/s2testing.h"
+
+using std::vector;
+
+namespace {
+
+// Returns a pair of overlapping cell unions with roughly "num_cells" cells
+// each, similar to the coverings of two adjacent tiles.
+std::pair<S2CellUnion, S2CellUnion> MakeCellUnions(int num_cells) {
+  absl::BitGen bitgen;
+  S2Point center = s2random::Point(bitgen);
+  S2RegionCoverer::Options options;
+  options.set_max_cells(num_cells);
+  S2RegionCoverer coverer(options);
+  S2Cap a(center, S2Testing::KmToAngle(100));
+  S2Cap b(S2Point(center + 0.01 * s2random::Point(bitgen)).Normalize(),
+          S2Testing::KmToAngle(100));
+  return {coverer.GetCovering(a), coverer.GetCovering(b)};
+}
+
+void BM_S2CellUnionUnion(benchmark::State& state) {
+  auto [x, y] = MakeCellUnions(state.range(0));
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(x.Union(y));
+  }
+}
+BENCHMARK(BM_S2CellUnionUnion)->Range(64, 1 << 16);
+
+void BM_S2CellUnionDifference(benchmark::State& state) {
+  auto [x, y] = MakeCellUnions(state.range(0));
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(x.Difference(y));
+  }
+}
+BENCHMARK(BM_S2CellUnionDifference)->Range(64, 1 << 16);
+
+}  // namespace
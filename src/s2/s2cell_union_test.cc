@@ -444,6 +444,82 @@ TEST(S2CellUnion, DifferenceInclusionExclusion) {
   }
 }
 
+// The original recursive implementation of S2CellUnion::Difference(), which
+// is used to check the results of GetDifference().
+static void GetDifferenceReference(S2CellId cell, const S2CellUnion& y,
+                                   vector<S2CellId>* cell_ids) {
+  if (!y.Intersects(cell)) {
+    cell_ids->push_back(cell);
+  } else if (!y.Contains(cell)) {
+    for (S2CellId child = cell.child_begin(); child != cell.child_end();
+         child = child.next()) {
+      GetDifferenceReference(child, y, cell_ids);
+    }
+  }
+}
+
+TEST(S2CellUnion, GetDifferenceMatchesReference) {
+  absl::BitGen bitgen(S2Testing::MakeTaggedSeedSeq(
+      "GET_DIFFERENCE_MATCHES_REFERENCE",
+      absl::LogInfoStreamer(__FILE__, __LINE__).stream()));
+  const int num_iters = absl::GetFlag(FLAGS_iters);
+  vector<S2CellId> actual;  // Reused across iterations.
+  for (int i = 0; i < num_iters; ++i) {
+    vector<S2CellId> input;
+    AddCells(bitgen, S2CellId::None(), /*selected=*/false, &input,
+             /*expected=*/nullptr);
+    vector<S2CellId> x, y;
+    for (S2CellId input_id : input) {
+      if (absl::Bernoulli(bitgen, 0.5)) x.push_back(input_id);
+      if (absl::Bernoulli(bitgen, 0.5)) y.push_back(input_id);
+    }
+    S2CellUnion xcells(std::move(x));
+    S2CellUnion ycells(std::move(y));
+    vector<S2CellId> expected;
+    for (S2CellId id : xcells) {
+      GetDifferenceReference(id, ycells, &expected);
+    }
+    S2CellUnion::GetDifference(xcells.cell_ids(), ycells.cell_ids(), &actual);
+    EXPECT_EQ(actual, expected);
+  }
+}
+
+TEST(S2CellUnion, GetUnionInPlace) {
+  // Accumulate the union of many cell unions in place, and check that the
+  // result is the same as computing the union of all the cells at once.
+  absl::BitGen bitgen(S2Testing::MakeTaggedSeedSeq(
+      "GET_UNION_IN_PLACE",
+      absl::LogInfoStreamer(__FILE__, __LINE__).stream()));
+  vector<S2CellId> input;
+  AddCells(bitgen, S2CellId::None(), /*selected=*/false, &input,
+           /*expected=*/nullptr);
+  vector<S2CellId> all, accumulated;
+  while (!input.empty()) {
+    vector<S2CellId> tile;
+    for (int i = 0; i < 10 && !input.empty(); ++i) {
+      tile.push_back(input[absl::Uniform<size_t>(bitgen, 0, input.size())]);
+      input.erase(std::find(input.begin(), input.end(), tile.back()));
+    }
+    all.insert(all.end(), tile.begin(), tile.end());
+    S2CellUnion tile_union(std::move(tile));
+    S2CellUnion::GetUnion(accumulated, tile_union.cell_ids(), &accumulated);
+    EXPECT_TRUE(S2CellUnion::FromVerbatim(accumulated).IsNormalized());
+  }
+  EXPECT_EQ(accumulated, S2CellUnion(std::move(all)).cell_ids());
+}
+
+TEST(S2CellUnion, GetUnionNormalizesSortedInputs) {
+  // The inputs only need to be sorted and non-overlapping.
+  S2CellId parent = S2CellId::FromFace(1).child(2);
+  vector<S2CellId> x = {parent.child(0), parent.child(2)};
+  vector<S2CellId> y = {parent.child(1), parent.child(3)};
+  vector<S2CellId> out;
+  S2CellUnion::GetUnion(x, y, &out);
+  EXPECT_THAT(out, ElementsAre(parent));
+  S2CellUnion::GetUnion(x, vector<S2CellId>{}, &x);
+  EXPECT_THAT(x, ElementsAre(parent.child(0), parent.child(2)));
+}
+
 TEST(S2CellUnion, ContainsIntersectsBruteForce) {
   absl::BitGen bitgen(S2Testing::MakeTaggedSeedSeq(
       "CONTAINS_INTERSECTS_BRUTE_FORCE",
@@ -574,6 +650,43 @@ TEST(S2CellUnion, Expand) {
   }
 }
 
+TEST(S2CellUnion, ExpandWithThreads) {
+  absl::BitGen bitgen(S2Testing::MakeTaggedSeedSeq(
+      "EXPAND_WITH_THREADS",
+      absl::LogInfoStreamer(__FILE__, __LINE__).stream()));
+  for (int iter = 0; iter < 20; ++iter) {
+    SCOPED_TRACE(StrCat("Iteration ", iter));
+    const S2Cap cap = s2random::Cap(bitgen, 1e-6, 1e-2);
+    vector<S2CellId> ids;
+    for (int i = absl::Uniform(bitgen, 0, 500); i > 0; --i) {
+      ids.push_back(S2CellId(s2random::SamplePoint(bitgen, cap))
+                        .parent(absl::Uniform(bitgen, 8, 20)));
+    }
+    const S2CellUnion cells(std::move(ids));
+    const int expand_level = absl::Uniform(bitgen, 8, 16);
+    S2CellUnion expected = cells;
+    expected.Expand(expand_level);
+    const S1Angle radius =
+        S1Angle::Radians(s2random::LogUniform(bitgen, 1e-6, 1e-2));
+    S2CellUnion expected_radius = cells;
+    expected_radius.Expand(radius, 4);
+    for (int num_threads : {1, 2, 3, 8}) {
+      S2CellUnion actual = cells;
+      actual.Expand(expand_level, num_threads);
+      EXPECT_EQ(expected, actual) << num_threads;
+      EXPECT_TRUE(actual.IsNormalized());
+      actual = cells;
+      actual.Expand(radius, 4, num_threads);
+      EXPECT_EQ(expected_radius, actual) << num_threads;
+    }
+    // The expanded union interleaves with the original one, which exercises
+    // the search used to skip over cells.
+    EXPECT_EQ(cells, cells.Intersection(expected));
+    EXPECT_EQ(cells, expected.Intersection(cells));
+    EXPECT_TRUE(cells.Difference(expected).empty());
+  }
+}
+
 TEST(S2CellUnion, EncodeDecode) {
   vector<S2CellId> cell_ids = {S2CellId(0x33),
                                S2CellId(0x8e3748fab),
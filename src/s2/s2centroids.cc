@@ -38,14 +38,21 @@ S2Point TrueCentroid(const S2Point& a, const S2Point& b, const S2Point& c) {
   // spherical triangle...  I have a truly marvellous demonstration of this
   // formula which this margin is too narrow to contain :)
 
+  return internal::TrueCentroid(a, b, c,
+                                internal::TrueCentroidSideRatio(b, c),
+                                internal::TrueCentroidSideRatio(c, a),
+                                internal::TrueCentroidSideRatio(a, b));
+}
+
+double internal::TrueCentroidSideRatio(const S2Point& a, const S2Point& b) {
   // Use Angle() in order to get accurate results for small triangles.
-  double angle_a = b.Angle(c);
-  double angle_b = c.Angle(a);
-  double angle_c = a.Angle(b);
-  double ra = (angle_a == 0) ? 1 : (angle_a / std::sin(angle_a));
-  double rb = (angle_b == 0) ? 1 : (angle_b / std::sin(angle_b));
-  double rc = (angle_c == 0) ? 1 : (angle_c / std::sin(angle_c));
+  double angle = a.Angle(b);
+  return (angle == 0) ? 1 : (angle / std::sin(angle));
+}
 
+S2Point internal::TrueCentroid(const S2Point& a, const S2Point& b,
+                               const S2Point& c, double ra, double rb,
+                               double rc) {
   // Now compute a point M such that:
   //
   //  [Ax Ay Az] [Mx]                       [ra]
@@ -82,6 +82,23 @@ S2Point TrueCentroid(const S2Point& a, const S2Point& b, const S2Point& c);
 // if the edge is degenerate (and that this is intended behavior).
 S2Point TrueCentroid(const S2Point& a, const S2Point& b);
 
+namespace internal {
+
+// Returns the ratio (angle / sin(angle)) used by TrueCentroid(a, b, c) for
+// the triangle side between "a" and "b", where "angle" is a.Angle(b).  The
+// result is exactly symmetric in "a" and "b".
+double TrueCentroidSideRatio(const S2Point& a, const S2Point& b);
+
+// Like TrueCentroid(a, b, c), but takes the side ratios
+// ra = TrueCentroidSideRatio(b, c), rb = TrueCentroidSideRatio(c, a), and
+// rc = TrueCentroidSideRatio(a, b).  This allows callers that compute the
+// centroids of many triangles with shared sides (such as a triangle fan) to
+// compute each ratio only once.  The result is identical to TrueCentroid().
+S2Point TrueCentroid(const S2Point& a, const S2Point& b, const S2Point& c,
+                     double ra, double rb, double rc);
+
+}  // namespace internal
+
 }  // namespace S2
 
 #endif  // S2_S2CENTROIDS_H_
@@ -16,9 +16,11 @@
 #include "s2/s2chain_interpolation_query.h"
 
 #include <algorithm>
+#include <cstddef>
 #include <vector>
 
 #include "absl/log/absl_check.h"
+#include "absl/types/span.h"
 #include "s2/s1angle.h"
 #include "s2/s2edge_distances.h"
 #include "s2/s2point.h"
@@ -94,9 +96,15 @@ S2ChainInterpolationQuery::Result S2ChainInterpolationQuery::AtDistance(
 
   // Binary search in the list of cumulative values, which by construction are
   // sorted in ascending order.
-  const auto it = std::lower_bound(cumulative_values_.begin(),
-                                   cumulative_values_.end(), distance);
+  return GetResult(std::lower_bound(cumulative_values_.begin(),
+                                    cumulative_values_.end(), distance),
+                   distance);
+}
 
+// Returns the result for "distance" given the first cumulative value that is
+// not less than "distance".
+S2ChainInterpolationQuery::Result S2ChainInterpolationQuery::GetResult(
+    ValueIterator it, const S1Angle& distance) const {
   if (it == cumulative_values_.begin()) {
     // Corner case: the first vertex of the shape at distance = 0.
     return Result(shape_->edge(first_edge_id_).v0, first_edge_id_,
@@ -117,6 +125,55 @@ S2ChainInterpolationQuery::Result S2ChainInterpolationQuery::AtDistance(
   }
 }
 
+// Like AtDistance(), except that the search starts at "*hint" (which must not
+// be greater than the result of the search) and "*hint" is updated to the
+// position found.  Uses an exponential search so that a sweep over sorted
+// distances takes time proportional to the number of distances multiplied by
+// the logarithm of the average number of edges between them.
+S2ChainInterpolationQuery::Result S2ChainInterpolationQuery::AtDistance(
+    const S1Angle& distance, ValueIterator* hint) const {
+  ValueIterator begin = *hint, end = cumulative_values_.end();
+  for (ptrdiff_t step = 1; begin != end && *begin < distance; step *= 2) {
+    ValueIterator next = end - begin > step ? begin + step : end;
+    if (next == end || !(*next < distance)) {
+      *hint = std::lower_bound(begin + 1, next, distance);
+      return GetResult(*hint, distance);
+    }
+    begin = next + 1;
+  }
+  *hint = begin;
+  return GetResult(begin, distance);
+}
+
+void S2ChainInterpolationQuery::AtDistances(
+    absl::Span<const S1Angle> distances, absl::Span<Result> results) const {
+  ABSL_DCHECK_EQ(distances.size(), results.size());
+  ABSL_DCHECK(std::is_sorted(distances.begin(), distances.end()));
+  if (cumulative_values_.empty()) {
+    std::fill(results.begin(), results.end(), Result());
+    return;
+  }
+  ValueIterator hint = cumulative_values_.begin();
+  for (size_t i = 0; i < distances.size(); ++i) {
+    results[i] = AtDistance(distances[i], &hint);
+  }
+}
+
+void S2ChainInterpolationQuery::AtFractions(
+    absl::Span<const double> fractions, absl::Span<Result> results) const {
+  ABSL_DCHECK_EQ(fractions.size(), results.size());
+  ABSL_DCHECK(std::is_sorted(fractions.begin(), fractions.end()));
+  if (cumulative_values_.empty()) {
+    std::fill(results.begin(), results.end(), Result());
+    return;
+  }
+  const S1Angle length = GetLength();
+  ValueIterator hint = cumulative_values_.begin();
+  for (size_t i = 0; i < fractions.size(); ++i) {
+    results[i] = AtDistance(fractions[i] * length, &hint);
+  }
+}
+
 S2ChainInterpolationQuery::Result S2ChainInterpolationQuery::AtFraction(
     double fraction) const {
   return AtDistance(fraction * GetLength());
@@ -162,3 +219,31 @@ void S2ChainInterpolationQuery::AddSlice(double begin_fraction,
     std::reverse(slice.begin() + original_size, slice.end());
   }
 }
+
+void S2ChainInterpolationQuery::AddSlices(
+    absl::Span<const double> fractions, std::vector<S2Point>& points,
+    std::vector<int>& slice_starts) const {
+  ABSL_DCHECK(std::is_sorted(fractions.begin(), fractions.end()));
+  if (cumulative_values_.empty() || fractions.empty()) {
+    return;
+  }
+
+  const S1Angle length = GetLength();
+  ValueIterator hint = cumulative_values_.begin();
+  Result begin = AtDistance(fractions[0] * length, &hint);
+  for (size_t i = 1; i < fractions.size(); ++i) {
+    Result end = AtDistance(fractions[i] * length, &hint);
+    slice_starts.push_back(points.size());
+    S2Point last_point = begin.point();
+    points.push_back(last_point);
+    for (int edge_id = begin.edge_id(); edge_id < end.edge_id(); ++edge_id) {
+      const auto edge = shape_->edge(edge_id);
+      if (last_point != edge.v1) {
+        last_point = edge.v1;
+        points.push_back(last_point);
+      }
+    }
+    points.push_back(end.point());
+    begin = end;
+  }
+}
@@ -20,6 +20,7 @@
 #include <memory>
 #include <vector>
 
+#include "absl/types/span.h"
 #include "s2/s1angle.h"
 #include "s2/s2point.h"
 #include "s2/s2shape.h"
@@ -135,6 +136,20 @@ class S2ChainInterpolationQuery {
   // fraction to distance by multiplying it by the total length.
   Result AtFraction(double fraction) const;
 
+  // Batch versions of AtDistance() and AtFraction() that compute
+  // results[i] for each element of "distances" (or "fractions").  The inputs
+  // are processed in a single forward sweep over the edges, which is much
+  // faster than calling the methods above individually when there are many
+  // values per chain (e.g., when resampling a trajectory at fixed intervals).
+  // The results are identical to those of the single-value methods.
+  //
+  // REQUIRES: "distances" (or "fractions") is sorted in non-decreasing order.
+  // REQUIRES: results.size() == distances.size() (or fractions.size())
+  void AtDistances(absl::Span<const S1Angle> distances,
+                   absl::Span<Result> results) const;
+  void AtFractions(absl::Span<const double> fractions,
+                   absl::Span<Result> results) const;
+
   // Returns the vector of points that is a slice of the chain from
   // begin_fraction to end_fraction. If begin_fraction is greater than
   // end_fraction, then the points are returned in reverse order.
@@ -158,7 +173,29 @@ class S2ChainInterpolationQuery {
   void AddSlice(double begin_fraction, double end_fraction,
                 std::vector<S2Point>& slice) const;
 
+  // Appends the slices between each pair of consecutive values in
+  // "fractions" to "points", i.e. the slice from fractions[0] to
+  // fractions[1], followed by the slice from fractions[1] to fractions[2],
+  // etc, and appends the offset of the first point of each slice to
+  // "slice_starts".  Each slice is identical to the one computed by
+  // AddSlice(), and slice i ends where slice i+1 starts (or at the end of
+  // "points" for the last slice).  The fractions are processed in a single
+  // sweep, and no memory is allocated once the output vectors have grown to
+  // their working size, so this method is suitable for splitting a chain
+  // into many pieces.  If the query is either uninitialized, or initialized
+  // with a shape containing no edges, then nothing is appended.
+  //
+  // REQUIRES: "fractions" is sorted in non-decreasing order.
+  void AddSlices(absl::Span<const double> fractions,
+                 std::vector<S2Point>& points,
+                 std::vector<int>& slice_starts) const;
+
  private:
+  using ValueIterator = std::vector<S1Angle>::const_iterator;
+
+  Result GetResult(ValueIterator it, const S1Angle& distance) const;
+  Result AtDistance(const S1Angle& distance, ValueIterator* hint) const;
+
   const S2Shape* shape_;
   std::vector<S1Angle> cumulative_values_;
   int first_edge_id_;
@@ -0,0 +1,100 @@
+// Copyright 2024 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "s2/s2chain_interpolation_query.h"
+
+#include <random>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+#include "absl/types/span.h"
+#include "s2/s1angle.h"
+#include "s2/s2cap.h"
+#include "s2/s2lax_polyline_shape.h"
+#include "s2/s2point.h"
+#include "s2/s2random.h"
+
+using std::vector;
+
+namespace {
+
+// Returns a random walk polyline with "num_vertices" vertices.
+S2LaxPolylineShape MakeTrajectory(int num_vertices) {
+  std::mt19937_64 bitgen(1);
+  vector<S2Point> vertices;
+  S2Point p = s2random::Point(bitgen);
+  for (int i = 0; i < num_vertices; ++i) {
+    vertices.push_back(p);
+    p = s2random::SamplePoint(bitgen, S2Cap(p, S1Angle::Degrees(1e-3)));
+  }
+  return S2LaxPolylineShape(vertices);
+}
+
+// Returns "n" evenly spaced fractions in [0, 1].
+vector<double> MakeFractions(int n) {
+  vector<double> fractions;
+  for (int i = 0; i < n; ++i) fractions.push_back(i / (n - 1.0));
+  return fractions;
+}
+
+// Measures resampling a polyline with state.range(0) vertices at the same
+// number of evenly spaced points using one AtFraction() call per point.
+void BM_AtFraction(benchmark::State& state) {
+  const int n = state.range(0);
+  const S2LaxPolylineShape polyline = MakeTrajectory(n);
+  const vector<double> fractions = MakeFractions(n);
+  S2ChainInterpolationQuery query(&polyline);
+  vector<S2ChainInterpolationQuery::Result> results(n);
+  for (auto _ : state) {
+    for (int i = 0; i < n; ++i) results[i] = query.AtFraction(fractions[i]);
+    benchmark::DoNotOptimize(results.data());
+  }
+  state.SetItemsProcessed(state.iterations() * n);
+}
+BENCHMARK(BM_AtFraction)->Range(64, 1 << 16);
+
+// Like BM_AtFraction, but uses a single AtFractions() call.
+void BM_AtFractions(benchmark::State& state) {
+  const int n = state.range(0);
+  const S2LaxPolylineShape polyline = MakeTrajectory(n);
+  const vector<double> fractions = MakeFractions(n);
+  S2ChainInterpolationQuery query(&polyline);
+  vector<S2ChainInterpolationQuery::Result> results(n);
+  for (auto _ : state) {
+    query.AtFractions(fractions, absl::MakeSpan(results));
+    benchmark::DoNotOptimize(results.data());
+  }
+  state.SetItemsProcessed(state.iterations() * n);
+}
+BENCHMARK(BM_AtFractions)->Range(64, 1 << 16);
+
+// Measures splitting a polyline with state.range(0) vertices into 64 pieces
+// using AddSlices().
+void BM_AddSlices(benchmark::State& state) {
+  const S2LaxPolylineShape polyline = MakeTrajectory(state.range(0));
+  const vector<double> fractions = MakeFractions(65);
+  S2ChainInterpolationQuery query(&polyline);
+  vector<S2Point> points;
+  vector<int> slice_starts;
+  for (auto _ : state) {
+    points.clear();
+    slice_starts.clear();
+    query.AddSlices(fractions, points, slice_starts);
+    benchmark::DoNotOptimize(points.data());
+  }
+}
+BENCHMARK(BM_AddSlices)->Range(64, 1 << 16);
+
+}  // namespace
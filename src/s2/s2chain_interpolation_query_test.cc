@@ -306,3 +306,58 @@ TEST(S2ChainInterpolationQueryTest, Slice) {
   EXPECT_EQ(s2textformat::ToString(query.Slice(0.25, 0.75)),
             "0:0.5, 0:1, 0:1.5");
 }
+
+TEST(S2ChainInterpolationQueryTest, BatchMatchesSingleQueries) {
+  // Include a degenerate edge and values before, between and after vertices.
+  auto polyline = s2textformat::MakeLaxPolylineOrDie(
+      "0:0, 0:1, 0:1, 0:3, 1:3, 1:4, 2:4, 2:5, 3:5, 3:6, 4:6");
+  S2ChainInterpolationQuery query(polyline.get());
+  vector<double> fractions = {-0.1, 0, 0, 0.1, 0.1, 0.15, 0.3,
+                              0.31, 0.5, 0.95, 1, 1.2};
+  vector<S1Angle> distances;
+  for (double fraction : fractions) {
+    distances.push_back(fraction * query.GetLength());
+  }
+  vector<S2ChainInterpolationQuery::Result> by_distance(distances.size());
+  vector<S2ChainInterpolationQuery::Result> by_fraction(fractions.size());
+  query.AtDistances(distances, absl::MakeSpan(by_distance));
+  query.AtFractions(fractions, absl::MakeSpan(by_fraction));
+  for (int i = 0; i < distances.size(); ++i) {
+    const auto expected = query.AtDistance(distances[i]);
+    for (const auto& actual : {by_distance[i], by_fraction[i]}) {
+      ASSERT_TRUE(actual.is_valid());
+      EXPECT_EQ(actual.point(), expected.point());
+      EXPECT_EQ(actual.edge_id(), expected.edge_id());
+      EXPECT_EQ(actual.distance(), expected.distance());
+    }
+  }
+
+  S2ChainInterpolationQuery empty_query;
+  vector<S2ChainInterpolationQuery::Result> results(2);
+  empty_query.AtFractions({0, 1}, absl::MakeSpan(results));
+  EXPECT_FALSE(results[0].is_valid());
+  EXPECT_FALSE(results[1].is_valid());
+}
+
+TEST(S2ChainInterpolationQueryTest, AddSlices) {
+  auto polyline =
+      s2textformat::MakeLaxPolylineOrDie("0:0, 0:1, 0:1, 0:2, 1:2, 1:4");
+  S2ChainInterpolationQuery query(polyline.get());
+  const vector<double> fractions = {0, 0.1, 0.1, 0.3, 0.6, 1};
+  vector<S2Point> points = {S2Point(1, 0, 0)};  // Existing points are kept.
+  vector<int> slice_starts;
+  query.AddSlices(fractions, points, slice_starts);
+  ASSERT_EQ(slice_starts.size(), fractions.size() - 1);
+  for (int i = 0; i < slice_starts.size(); ++i) {
+    const int end =
+        i + 1 < slice_starts.size() ? slice_starts[i + 1] : points.size();
+    EXPECT_EQ(vector<S2Point>(points.begin() + slice_starts[i],
+                              points.begin() + end),
+              query.Slice(fractions[i], fractions[i + 1]));
+  }
+  EXPECT_EQ(slice_starts[0], 1);
+
+  S2ChainInterpolationQuery empty_query;
+  empty_query.AddSlices(fractions, points, slice_starts);
+  EXPECT_EQ(slice_starts.size(), fractions.size() - 1);
+}
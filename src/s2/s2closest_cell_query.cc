@@ -17,10 +17,22 @@
 
 #include "s2/s2closest_cell_query.h"
 
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "absl/log/absl_check.h"
+#include "absl/types/span.h"
+#include "s2/internal/s2parallel.h"
+#include "s2/internal/s2point_order.h"
 #include "s2/s1angle.h"
 #include "s2/s1chord_angle.h"
+#include "s2/s2cell_id.h"
 #include "s2/s2closest_cell_query_base.h"
 #include "s2/s2edge_distances.h"
+#include "s2/s2point.h"
+
+using std::vector;
 
 void S2ClosestCellQuery::Options::set_conservative_max_distance(
     S1ChordAngle max_distance) {
@@ -115,3 +127,73 @@ bool S2ClosestCellQuery::IsConservativeDistanceLessOrEqual(
   tmp_options.set_max_error(S1ChordAngle::Straight());
   return !base_.FindClosestCell(target, tmp_options).is_empty();
 }
+
+vector<vector<S2ClosestCellQuery::Result>>
+S2ClosestCellQuery::FindClosestCells(absl::Span<const S2Point> points,
+                                     int num_threads) {
+  vector<vector<Result>> results;
+  FindClosestCells(points, &results, num_threads);
+  return results;
+}
+
+void S2ClosestCellQuery::FindClosestCells(absl::Span<const S2Point> points,
+                                          vector<vector<Result>>* results,
+                                          int num_threads) {
+  ABSL_DCHECK_GE(num_threads, 1);
+  const auto order = s2internal::SortPointsByCellId(points);
+
+  // Chunks are small enough to balance the load between threads, but large
+  // enough that most points can use the distance bound from their
+  // predecessor.
+  constexpr int kChunkSize = 64;
+  const int num_points = points.size();
+  results->resize(num_points);
+  // Worker 0 uses this query's own state, so that the single-threaded case
+  // does not need to initialize a new query.
+  std::vector<std::unique_ptr<Base>> worker_bases(
+      s2internal::NumChunkWorkers(num_threads, num_points, kChunkSize));
+  s2internal::ParallelForChunks(
+      num_threads, num_points, kChunkSize, [&](int worker, int begin, int end) {
+        Base* base = &base_;
+        if (worker > 0) {
+          if (!worker_bases[worker]) {
+            worker_bases[worker] = std::make_unique<Base>(&index());
+          }
+          base = worker_bases[worker].get();
+        }
+        static_assert(sizeof(Options) <= 32,
+                      "Consider not copying Options here");
+        Options tmp_options = options_;
+        // The last point with max_results() results, and the distance to its
+        // farthest result.
+        const S2Point* prev_point = nullptr;
+        S1ChordAngle prev_distance;
+        for (int k = begin; k < end; ++k) {
+          const S2Point& point = points[order[k].second];
+          tmp_options.set_max_distance(options_.max_distance());
+          if (prev_point != nullptr) {
+            // Add a margin for the errors in the distances computed for both
+            // points and in the distance between them.  This bound is only
+            // used to limit the search, so being conservative merely costs a
+            // bit of time.
+            S1ChordAngle step(*prev_point, point);
+            S1ChordAngle bound = prev_distance + step;
+            bound = bound.PlusError(
+                2 * S2::GetUpdateMinDistanceMaxError(bound) +
+                step.GetS2PointConstructorMaxError() +
+                bound.GetS1AngleConstructorMaxError());
+            if (Distance(bound) < options_.max_distance()) {
+              tmp_options.set_max_distance(bound.Successor());
+            }
+          }
+          PointTarget target(point);
+          vector<Result>* point_results = &(*results)[order[k].second];
+          base->FindClosestCells(&target, tmp_options, point_results);
+          if (static_cast<int>(point_results->size()) ==
+              options_.max_results()) {
+            prev_point = &point;
+            prev_distance = point_results->back().distance();
+          }
+        }
+      });
+}
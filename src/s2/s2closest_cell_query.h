@@ -22,6 +22,7 @@
 #include <vector>
 
 #include "s2/_fp_contract_off.h"  // IWYU pragma: keep
+#include "absl/types/span.h"
 #include "s2/s1angle.h"
 #include "s2/s1chord_angle.h"
 #include "s2/s2cell.h"
@@ -247,6 +248,38 @@ class S2ClosestCellQuery {
   // since it does not require allocating a new vector on each call.
   void FindClosestCells(Target* target, std::vector<Result>* results);
 
+  // Batch version of FindClosestCells() for point targets, which is much
+  // faster when finding the closest cells to a large number of points.
+  // Returns a vector whose i-th element contains the closest cells to
+  // points[i], as if FindClosestCells() had been called with a PointTarget
+  // for each point.  (The only difference is that when several cells are at
+  // the same distance, a different subset of them may be returned.)
+  //
+  // The points are sorted by S2CellId and divided into small chunks of
+  // nearby points.  Within a chunk, after finding max_results() cells within
+  // a distance "d" of some point "p", the cells closest to the next point "q"
+  // must all be within "d + distance(p, q)" (by the triangle inequality).
+  // This is used as max_distance() for "q", which lets the search start from
+  // a small neighborhood of "q" rather than from the entire index.
+  //
+  // Up to "num_threads" threads (including the calling thread) are used, each
+  // with its own query state.  Chunks are handed out to the threads
+  // dynamically, which keeps all threads busy even when some regions are
+  // much more expensive to query than others.
+  //
+  // REQUIRES: num_threads >= 1
+  // REQUIRES: If options().region() is set, its methods must be thread-safe
+  //           (as is true for all S2Region types in this library).
+  std::vector<std::vector<Result>> FindClosestCells(
+      absl::Span<const S2Point> points, int num_threads = 1);
+
+  // Like the method above, but stores the results in "results".  The memory
+  // used by its elements is reused, so that calling this method repeatedly
+  // with the same "results" vector usually does not allocate memory.
+  void FindClosestCells(absl::Span<const S2Point> points,
+                        std::vector<std::vector<Result>>* results,
+                        int num_threads = 1);
+
   //////////////////////// Convenience Methods ////////////////////////
 
   // Returns the closest cell to the target.  If no cell satisfies the search
@@ -24,16 +24,15 @@
 #include <cstddef>
 #include <iterator>
 #include <limits>
-#include <queue>
 #include <type_traits>
 #include <vector>
 
 #include "absl/container/btree_set.h"
 #include "absl/container/flat_hash_set.h"
-#include "absl/container/inlined_vector.h"
 #include "absl/hash/hash.h"
 #include "absl/log/absl_check.h"
 #include "absl/log/absl_log.h"
+#include "s2/internal/s2priority_queue.h"
 #include "s2/s1chord_angle.h"
 #include "s2/s2cap.h"
 #include "s2/s2cell.h"
@@ -308,13 +307,24 @@ class S2ClosestCellQueryBase {
   //  - If max_results() == kMaxMaxResults, results are appended to
   //    result_vector_ and sorted/uniqued at the end.
   //
+  //  - If max_results() <= kMaxSortedVectorResults, results are kept in
+  //    result_vector_ in sorted order without duplicates.  This lets us
+  //    progressively reduce the distance limit once max_results() results
+  //    have been found, and unlike a btree_set it does not allocate memory
+  //    when the same query object is reused.
+  //
   //  - Otherwise results are kept in a btree_set so that we can progressively
   //    reduce the distance limit once max_results() results have been found.
   //    (A priority queue is not sufficient because we need to be able to
   //    check whether a candidate cell is already in the result set.)
   //
+  // All of these containers (as well as tested_cells_ and queue_) keep their
+  // storage between queries, so that repeated queries using the same object
+  // usually do not allocate memory.
+  //
   // TODO(ericv): Check whether it would be faster to use avoid_duplicates_
   // when result_set_ is used so that we could use a priority queue instead.
+  static constexpr int kMaxSortedVectorResults = 64;
   Result result_singleton_;
   std::vector<Result> result_vector_;
   absl::btree_set<Result> result_set_;
@@ -358,8 +368,7 @@ class S2ClosestCellQueryBase {
       return other.distance < distance;
     }
   };
-  using CellQueue =
-      std::priority_queue<QueueEntry, absl::InlinedVector<QueueEntry, 16>>;
+  using CellQueue = s2internal::ReusablePriorityQueue<QueueEntry, 16>;
   CellQueue queue_;
 
   // Used to iterate over the contents of an S2CellIndex range.  It is defined
@@ -504,6 +513,9 @@ void S2ClosestCellQueryBase<Distance>::FindClosestCells(
     std::unique_copy(result_vector_.begin(), result_vector_.end(),
                      std::back_inserter(*results));
     result_vector_.clear();
+  } else if (options.max_results() <= kMaxSortedVectorResults) {
+    results->assign(result_vector_.begin(), result_vector_.end());
+    result_vector_.clear();
   } else {
     results->assign(result_set_.begin(), result_set_.end());
     result_set_.clear();
@@ -516,11 +528,15 @@ void S2ClosestCellQueryBase<Distance>::FindClosestCellsInternal(
   target_ = target;
   options_ = &options;
 
-  tested_cells_.clear();
+  // Unlike clear(), erase() keeps the allocated storage for the next query.
+  tested_cells_.erase(tested_cells_.begin(), tested_cells_.end());
   contents_it_.Clear();
   distance_limit_ = options.max_distance();
   result_singleton_ = Result();
   ABSL_DCHECK(result_vector_.empty());
+  if (options.max_results() <= kMaxSortedVectorResults) {
+    result_vector_.reserve(options.max_results());
+  }
   ABSL_DCHECK(result_set_.empty());
   ABSL_DCHECK_GE(target->max_brute_force_index_size(), 0);
   if (distance_limit_ == Distance::Zero()) return;
@@ -591,7 +607,7 @@ void S2ClosestCellQueryBase<Distance>::FindClosestCellsOptimized() {
     QueueEntry entry = queue_.top();
     queue_.pop();
     if (!(entry.distance < distance_limit_)) {
-      queue_ = CellQueue();  // Clear any remaining entries.
+      queue_.clear();  // Clear any remaining entries.
       break;
     }
     S2CellId child = entry.id.child_begin();
@@ -767,6 +783,25 @@ void S2ClosestCellQueryBase<Distance>::MaybeAddResult(S2CellId cell_id,
     distance_limit_ = result.distance() - options().max_error();
   } else if (options().max_results() == Options::kMaxMaxResults) {
     result_vector_.push_back(result);  // Sort/unique at end.
+  } else if (options().max_results() <= kMaxSortedVectorResults) {
+    // Keep result_vector_ sorted, in the same way as result_set_ below.  Once
+    // it is full, a new result replaces the current worst one, so the vector
+    // never grows beyond the capacity reserved when the query starts.
+    const size_t max_results = options().max_results();
+    if (result_vector_.size() == max_results &&
+        !(result < result_vector_.back())) {
+      return;
+    }
+    auto it = std::lower_bound(result_vector_.begin(), result_vector_.end(),
+                               result);
+    if (it != result_vector_.end() && *it == result) return;  // Duplicate.
+    size_t pos = it - result_vector_.begin();
+    if (result_vector_.size() == max_results) result_vector_.pop_back();
+    result_vector_.insert(result_vector_.begin() + pos, result);
+    if (result_vector_.size() == max_results) {
+      distance_limit_ = result_vector_.back().distance() -
+                        options().max_error();
+    }
   } else {
     // Add this cell to result_set_.  Note that even if we already have enough
     // edges, we can't erase an element before insertion because the "new"
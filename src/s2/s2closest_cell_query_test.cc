@@ -441,4 +441,49 @@ TEST(S2ClosestCellQuery, ConservativeCellDistanceIsUsed) {
   TestWithIndexFactory(PointCloudCellIndexFactory(), 5, 100, 10, bitgen);
 }
 
+TEST(S2ClosestCellQuery, BatchPointTargets) {
+  absl::BitGen bitgen(S2Testing::MakeTaggedSeedSeq(
+      "BATCH_POINT_TARGETS",
+      absl::LogInfoStreamer(__FILE__, __LINE__).stream()));
+  // Most indexed cells are in a small dense cluster, so that queries near
+  // the cluster are much more expensive than queries elsewhere.
+  S2Cap dense_cap(s2random::Point(bitgen), S2Testing::KmToAngle(1));
+  S2Cap sparse_cap(dense_cap.center(), S2Testing::KmToAngle(1000));
+  S2CellIndex index;
+  for (int i = 0; i < 5000; ++i) {
+    S2Point p = s2random::SamplePoint(bitgen, i % 10 ? dense_cap : sparse_cap);
+    index.Add(S2CellId(p).parent(absl::Uniform(bitgen, 10, 31)), i);
+  }
+  index.Build();
+  vector<S2Point> targets;
+  for (int i = 0; i < 1000; ++i) {
+    targets.push_back(
+        s2random::SamplePoint(bitgen, i % 2 ? dense_cap : sparse_cap));
+  }
+
+  S2ClosestCellQuery query(&index);
+  for (int max_results : {1, 10}) {
+    query.mutable_options()->set_max_results(max_results);
+    for (int num_threads : {1, 4}) {
+      auto batch = query.FindClosestCells(targets, num_threads);
+      ASSERT_EQ(batch.size(), targets.size());
+      for (size_t i = 0; i < targets.size(); ++i) {
+        S2ClosestCellQuery::PointTarget target(targets[i]);
+        auto expected = query.FindClosestCells(&target);
+        ASSERT_EQ(batch[i].size(), expected.size());
+        for (size_t j = 0; j < expected.size(); ++j) {
+          // Cells at the same distance (e.g. nested cells that all contain
+          // the target) may be returned in either order, so we check that
+          // each result has the expected distance.
+          EXPECT_EQ(batch[i][j].distance(), expected[j].distance());
+          S2MinDistance distance = S2MinDistance::Infinity();
+          target.UpdateMinDistance(S2Cell(batch[i][j].cell_id()), &distance);
+          EXPECT_EQ(batch[i][j].distance(), distance);
+        }
+      }
+    }
+  }
+  EXPECT_TRUE(query.FindClosestCells(vector<S2Point>{}, 4).empty());
+}
+
 }  // namespace
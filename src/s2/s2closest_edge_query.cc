@@ -17,10 +17,21 @@
 
 #include "s2/s2closest_edge_query.h"
 
+#include <utility>
+#include <vector>
+
+#include "absl/types/span.h"
+#include "s2/internal/s2point_order.h"
 #include "s2/s1angle.h"
 #include "s2/s1chord_angle.h"
+#include "s2/s2cell_id.h"
 #include "s2/s2closest_edge_query_base.h"
 #include "s2/s2edge_distances.h"
+#include "s2/s2min_distance_targets.h"
+#include "s2/s2point.h"
+#include "s2/s2shape.h"
+
+using std::vector;
 
 void S2ClosestEdgeQuery::Options::set_conservative_max_distance(
     S1ChordAngle max_distance) {
@@ -72,18 +83,13 @@ S2ClosestEdgeQuery::~S2ClosestEdgeQuery() {
 
 bool S2ClosestEdgeQuery::IsDistanceLess(Target* target, S1ChordAngle limit,
                                         ShapeFilter filter) {
-  static_assert(sizeof(Options) <= 32, "Consider not copying Options here");
-  Options tmp_options = options_;
-  tmp_options.set_max_results(1);
-  tmp_options.set_max_distance(limit);
-  tmp_options.set_max_error(S1ChordAngle::Straight());
-  return !base_.FindClosestEdge(target, tmp_options, filter).is_empty();
+  return IsDistanceLessInternal(target, limit, filter);
 }
 
 bool S2ClosestEdgeQuery::IsDistanceLessOrEqual(Target* target,
                                                S1ChordAngle limit,
                                                ShapeFilter filter) {
-  static_assert(sizeof(Options) <= 32, "Consider not copying Options here");
+  static_assert(sizeof(Options) <= 48, "Consider not copying Options here");
   Options tmp_options = options_;
   tmp_options.set_max_results(1);
   tmp_options.set_inclusive_max_distance(limit);
@@ -94,10 +100,158 @@ bool S2ClosestEdgeQuery::IsDistanceLessOrEqual(Target* target,
 bool S2ClosestEdgeQuery::IsConservativeDistanceLessOrEqual(Target* target,
                                                            S1ChordAngle limit,
                                                            ShapeFilter filter) {
-  static_assert(sizeof(Options) <= 32, "Consider not copying Options here");
+  static_assert(sizeof(Options) <= 48, "Consider not copying Options here");
   Options tmp_options = options_;
   tmp_options.set_max_results(1);
   tmp_options.set_conservative_max_distance(limit);
   tmp_options.set_max_error(S1ChordAngle::Straight());
   return !base_.FindClosestEdge(target, tmp_options, filter).is_empty();
 }
+
+void S2ClosestEdgeQuery::FindClosestEdges(Target* target,
+                                          absl::Span<const Result> hint,
+                                          vector<Result>* results,
+                                          ShapeFilter filter) {
+  // Compute the distance from the target to each edge of the hint.  The
+  // max_results()-th smallest such distance is an upper bound on the
+  // distance to the max_results()-th closest edge.
+  const int max_results = options_.max_results();
+  vector<S1ChordAngle> distances;
+  if (static_cast<int>(hint.size()) >= max_results) {
+    distances.reserve(hint.size());
+    for (const Result& result : hint) {
+      if (result.is_interior()) continue;
+      if (filter && !(*filter)(result.shape_id())) continue;
+      const S2Shape* shape = index().shape(result.shape_id());
+      if (shape == nullptr || result.edge_id() >= shape->num_edges()) continue;
+      S2Shape::Edge edge = shape->edge(result.edge_id());
+      S2MinDistance distance = S2MinDistance::Infinity();
+      target->UpdateMinDistance(edge.v0, edge.v1, &distance);
+      distances.push_back(distance);
+    }
+  }
+  if (static_cast<int>(distances.size()) < max_results) {
+    base_.FindClosestEdges(target, options_, results, filter);
+    return;
+  }
+  std::nth_element(distances.begin(), distances.begin() + (max_results - 1),
+                   distances.end());
+  S1ChordAngle bound = distances[max_results - 1];
+
+  // Add a margin for the error in the computed distances.  This bound is
+  // only used to limit the search, so being conservative merely costs a bit
+  // of time.
+  bound = bound.PlusError(2 * S2::GetUpdateMinDistanceMaxError(bound));
+  if (Distance(bound) >= options_.max_distance()) {
+    base_.FindClosestEdges(target, options_, results, filter);
+    return;
+  }
+  static_assert(sizeof(Options) <= 48, "Consider not copying Options here");
+  Options tmp_options = options_;
+  tmp_options.set_max_distance(bound.Successor());
+  base_.FindClosestEdges(target, tmp_options, results, filter);
+}
+
+vector<bool> S2ClosestEdgeQuery::IsDistanceLess(
+    absl::Span<const S2Point> points, S1ChordAngle limit, ShapeFilter filter) {
+  static_assert(sizeof(Options) <= 48, "Consider not copying Options here");
+  Options tmp_options = options_;
+  tmp_options.set_max_distance(limit);
+  return IsDistanceLessInternal(points, tmp_options, filter);
+}
+
+vector<bool> S2ClosestEdgeQuery::IsConservativeDistanceLessOrEqual(
+    absl::Span<const S2Point> points, S1ChordAngle limit, ShapeFilter filter) {
+  static_assert(sizeof(Options) <= 48, "Consider not copying Options here");
+  Options tmp_options = options_;
+  tmp_options.set_conservative_max_distance(limit);
+  return IsDistanceLessInternal(points, tmp_options, filter);
+}
+
+vector<bool> S2ClosestEdgeQuery::IsDistanceLessInternal(
+    absl::Span<const S2Point> points, const Options& options,
+    ShapeFilter filter) {
+  const auto order = s2internal::SortPointsByCellId(points);
+
+  vector<bool> results(points.size());
+  static_assert(sizeof(Options) <= 48, "Consider not copying Options here");
+  Options tmp_options = options;
+  tmp_options.set_max_results(1);
+  tmp_options.set_max_error(S1ChordAngle::Straight());
+  const S2Point* prev_point = nullptr;  // Last point with a result.
+  S1ChordAngle prev_distance;           // Distance to that result.
+  for (const auto& [id, i] : order) {
+    const S2Point& point = points[i];
+    if (prev_point != nullptr) {
+      // The result edge of the previous point is at most this far away (see
+      // the batch version of FindClosestEdges).
+      S1ChordAngle step(*prev_point, point);
+      S1ChordAngle bound = prev_distance + step;
+      bound = bound.PlusError(2 * S2::GetUpdateMinDistanceMaxError(bound) +
+                              step.GetS2PointConstructorMaxError() +
+                              bound.GetS1AngleConstructorMaxError());
+      if (Distance(bound) < tmp_options.max_distance()) {
+        results[i] = true;
+        continue;
+      }
+    }
+    PointTarget target(point);
+    Result result = base_.FindClosestEdge(&target, tmp_options, filter);
+    if (!result.is_empty()) {
+      results[i] = true;
+      prev_point = &point;
+      prev_distance = result.distance();
+    }
+  }
+  return results;
+}
+
+vector<vector<S2ClosestEdgeQuery::Result>>
+S2ClosestEdgeQuery::FindClosestEdges(absl::Span<const S2Point> points,
+                                     ShapeFilter filter) {
+  vector<vector<Result>> results;
+  FindClosestEdges(points, &results, filter);
+  return results;
+}
+
+void S2ClosestEdgeQuery::FindClosestEdges(absl::Span<const S2Point> points,
+                                          vector<vector<Result>>* results,
+                                          ShapeFilter filter) {
+  const auto order = s2internal::SortPointsByCellId(points);
+
+  results->resize(points.size());
+  static_assert(sizeof(Options) <= 48, "Consider not copying Options here");
+  Options tmp_options = options_;
+  const S2Point* prev_point = nullptr;  // Last point with max_results() edges.
+  S1ChordAngle prev_distance;           // Distance to its farthest result.
+  for (const auto& [id, i] : order) {
+    const S2Point& point = points[i];
+    tmp_options.set_max_distance(options_.max_distance());
+    if (prev_point != nullptr) {
+      // Add a margin for the errors in the distances computed for both
+      // points and in the distance between them.  This bound is only used to
+      // limit the search, so being conservative merely costs a bit of time.
+      S1ChordAngle step(*prev_point, point);
+      S1ChordAngle bound = prev_distance + step;
+      bound = bound.PlusError(2 * S2::GetUpdateMinDistanceMaxError(bound) +
+                              step.GetS2PointConstructorMaxError() +
+                              bound.GetS1AngleConstructorMaxError());
+      if (Distance(bound) < options_.max_distance()) {
+        tmp_options.set_max_distance(bound.Successor());
+      }
+    }
+    PointTarget target(point);
+    vector<Result>* point_results = &(*results)[i];
+    base_.FindClosestEdges(&target, tmp_options, point_results, filter);
+
+    // The bound above is valid only if it is derived from max_results()
+    // distinct edges.  (An interior result does not correspond to an edge, so
+    // it cannot be used to bound the distance to the next point.)
+    if (static_cast<int>(point_results->size()) == options_.max_results() &&
+        std::none_of(point_results->begin(), point_results->end(),
+                     [](const Result& r) { return r.is_interior(); })) {
+      prev_point = &point;
+      prev_distance = point_results->back().distance();
+    }
+  }
+}
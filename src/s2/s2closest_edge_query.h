@@ -21,11 +21,13 @@
 #include <memory>
 #include <queue>
 #include <type_traits>
+#include <utility>
 #include <vector>
 
 #include "absl/base/macros.h"
 #include "absl/container/inlined_vector.h"
 #include "absl/functional/function_ref.h"
+#include "absl/types/span.h"
 #include "s2/_fp_contract_off.h"  // IWYU pragma: keep
 #include "s2/s1angle.h"
 #include "s2/s1chord_angle.h"
@@ -37,6 +39,7 @@
 #include "s2/s2point.h"
 #include "s2/s2shape.h"
 #include "s2/s2shape_index.h"
+#include "s2/s2shape_index_category_summary.h"
 
 // S2ClosestEdgeQuery is a helper class for searching within an S2ShapeIndex
 // to find the closest edge(s) to a given point, edge, S2Cell, or geometry
@@ -185,6 +188,7 @@ class S2ClosestEdgeQuery {
 
     // Inherited options (see s2closest_edge_query_base.h for details):
     using Base::Options::set_max_results;
+    using Base::Options::set_max_relative_error;
     using Base::Options::set_include_interiors;
     using Base::Options::set_use_brute_force;
   };
@@ -255,10 +259,29 @@ class S2ClosestEdgeQuery {
   // Returns a reference to the underlying S2ShapeIndex.
   const S2ShapeIndex& index() const;
 
+  // Returns true if the most recent query was stopped early because
+  // Options::deadline() had passed.
+  bool deadline_exceeded() const { return base_.deadline_exceeded(); }
+
   // Returns the query options.  Options can be modified between queries.
   const Options& options() const;
   Options* mutable_options();
 
+  // Specifies a predicate that edges must satisfy in order to be returned by
+  // subsequent queries.  The predicate is evaluated during the search, so
+  // that the max_results() edges returned all satisfy it.  It is called with
+  // edge_id == -1 for polygon interiors.  (See S2ClosestEdgeQueryBase for
+  // details.)
+  using EdgeFilter = Base::EdgeFilter;
+  void set_edge_filter(EdgeFilter edge_filter);
+
+  // Restricts subsequent queries to shapes whose category (as recorded in
+  // "summary") belongs to "categories", skipping index cells that contain no
+  // such shapes.  (See S2ClosestEdgeQueryBase for details.)
+  void set_category_filter(
+      const S2ShapeIndexCategorySummary* summary,
+      S2ShapeIndexCategorySummary::CategoryMask categories);
+
   // Returns the closest edges to the given target that satisfy the current
   // options.  This method may be called multiple times.
   //
@@ -281,6 +304,63 @@ class S2ClosestEdgeQuery {
   void VisitClosestEdges(Target* target, Options options, ResultVisitor visitor,
                          ShapeFilter filter = {});
 
+  // Incremental version of VisitClosestEdges() that returns the closest edges
+  // one at a time, in order of increasing distance.  Each call to
+  // NextClosestEdge() does only as much work as necessary to find the next
+  // edge, and returns false once there are no more edges that satisfy the
+  // current options.  For example, to find the closest edge that satisfies
+  // some criteria that cannot be expressed as a ShapeFilter:
+  //
+  //   query.StartClosestEdges(&target);
+  //   for (Result result; query.NextClosestEdge(&result);) {
+  //     if (IsAcceptable(result)) break;
+  //   }
+  //
+  // The search state is kept in the query object between calls, so "target"
+  // and the state accessed by "filter" must remain valid until the search is
+  // finished.  The options must not be modified during the search, and
+  // calling any other query method abandons it.
+  void StartClosestEdges(Target* target, ShapeFilter filter = {});
+  bool NextClosestEdge(Result* result);
+
+  // Batch version of FindClosestEdges() for point targets, which is much
+  // faster when finding the closest edges to a large number of points (e.g.,
+  // when matching GPS points to a road network).  Returns a vector whose i-th
+  // element contains the closest edges to points[i], exactly as if
+  // FindClosestEdges() had been called with a PointTarget for each point.
+  //
+  // The points are processed in S2CellId order so that consecutive targets
+  // are usually close together.  After finding max_results() edges within a
+  // distance "d" of some point "p", the edges closest to the next point "q"
+  // must all be within "d + distance(p, q)" (by the triangle inequality).
+  // This is used as max_distance() for "q", which lets the search start from
+  // a small neighborhood of "q" rather than from the entire index.
+  std::vector<std::vector<Result>> FindClosestEdges(
+      absl::Span<const S2Point> points, ShapeFilter filter = {});
+
+  // Like the method above, but stores the results in "results".  The memory
+  // used by its elements is reused, so that calling this method repeatedly
+  // with the same "results" vector usually does not allocate memory.
+  void FindClosestEdges(absl::Span<const S2Point> points,
+                        std::vector<std::vector<Result>>* results,
+                        ShapeFilter filter = {});
+
+  // Warm-start version of FindClosestEdges() for a stream of targets that
+  // are not all known in advance (e.g., successive GPS fixes a few meters
+  // apart).  "hint" should contain the results of the query for a previous
+  // nearby target, although any set of distinct edges gives correct results.
+  // The results are exactly the same as for FindClosestEdges(target).
+  //
+  // If "hint" contains at least max_results() edges, the distance from
+  // "target" to the max_results()-th closest of these edges is used as
+  // max_distance(), which lets the search start from a small neighborhood
+  // of the target rather than from the entire index.  This costs
+  // max_results() edge distance computations, so it is most useful when
+  // max_results() is small.  (Interior results cannot be used to bound the
+  // distance and are ignored.)
+  void FindClosestEdges(Target* target, absl::Span<const Result> hint,
+                        std::vector<Result>* results, ShapeFilter filter = {});
+
   //////////////////////// Convenience Methods ////////////////////////
 
   // Returns the closest edge to the target.  If no edge satisfies the search
@@ -326,6 +406,41 @@ class S2ClosestEdgeQuery {
   bool IsConservativeDistanceLessOrEqual(Target* target, S1ChordAngle limit,
                                          ShapeFilter filter = {});
 
+  // Batch versions of IsDistanceLess() and IsConservativeDistanceLessOrEqual()
+  // for point targets (e.g., to check whether each of many points is within
+  // some distance of a road network).  Returns a vector whose i-th element
+  // is the result for points[i], exactly as if the method above had been
+  // called with a PointTarget for each point.
+  //
+  // As with the batch version of FindClosestEdges(), the points are
+  // processed in S2CellId order.  If an edge is found within distance "d" of
+  // some point "p", then any point "q" such that "d + distance(p, q)" is
+  // below the limit is also within the limit, and the index does not need
+  // to be searched at all for "q".
+  std::vector<bool> IsDistanceLess(absl::Span<const S2Point> points,
+                                   S1ChordAngle limit,
+                                   ShapeFilter filter = {});
+  std::vector<bool> IsConservativeDistanceLessOrEqual(
+      absl::Span<const S2Point> points, S1ChordAngle limit,
+      ShapeFilter filter = {});
+
+  // Overloads of the methods above for point and edge targets, which are
+  // chosen when the static type of the argument is PointTarget* or
+  // EdgeTarget*.  The search is instantiated for the concrete target type, so
+  // that the distance computations in its inner loops are inlined rather
+  // than being virtual calls.  The results are identical to the methods that
+  // accept any Target.  (Batch queries for points use this automatically.)
+  void FindClosestEdges(PointTarget* target, std::vector<Result>* results,
+                        ShapeFilter filter = {});
+  void FindClosestEdges(EdgeTarget* target, std::vector<Result>* results,
+                        ShapeFilter filter = {});
+  Result FindClosestEdge(PointTarget* target, ShapeFilter filter = {});
+  Result FindClosestEdge(EdgeTarget* target, ShapeFilter filter = {});
+  bool IsDistanceLess(PointTarget* target, S1ChordAngle limit,
+                      ShapeFilter filter = {});
+  bool IsDistanceLess(EdgeTarget* target, S1ChordAngle limit,
+                      ShapeFilter filter = {});
+
   // Returns the endpoints of the given result edge.
   // REQUIRES: !result.is_interior()
   S2Shape::Edge GetEdge(const Result& result) const;
@@ -334,6 +449,20 @@ class S2ClosestEdgeQuery {
   S2Point Project(const S2Point& point, const Result& result) const;
 
  private:
+  // Implementations of FindClosestEdge() and IsDistanceLess() for a target
+  // whose static type is "T".
+  template <class T>
+  Result FindClosestEdgeInternal(T* target, ShapeFilter filter);
+  template <class T>
+  bool IsDistanceLessInternal(T* target, S1ChordAngle limit,
+                              ShapeFilter filter);
+
+  // Implementation of the batch IsDistanceLess() methods, where "options"
+  // specifies the limit as max_distance().
+  std::vector<bool> IsDistanceLessInternal(absl::Span<const S2Point> points,
+                                           const Options& options,
+                                           ShapeFilter filter);
+
   Options options_;
   Base base_;
 
@@ -414,6 +543,16 @@ inline S2ClosestEdgeQuery::Options* S2ClosestEdgeQuery::mutable_options() {
   return &options_;
 }
 
+inline void S2ClosestEdgeQuery::set_edge_filter(EdgeFilter edge_filter) {
+  base_.set_edge_filter(std::move(edge_filter));
+}
+
+inline void S2ClosestEdgeQuery::set_category_filter(
+    const S2ShapeIndexCategorySummary* summary,
+    S2ShapeIndexCategorySummary::CategoryMask categories) {
+  base_.set_category_filter(summary, categories);
+}
+
 inline std::vector<S2ClosestEdgeQuery::Result>
 S2ClosestEdgeQuery::FindClosestEdges(Target* target, ShapeFilter filter) {
   return base_.FindClosestEdges(target, options_, filter);
@@ -425,12 +564,64 @@ inline void S2ClosestEdgeQuery::FindClosestEdges(Target* target,
   base_.FindClosestEdges(target, options_, results, filter);
 }
 
+inline void S2ClosestEdgeQuery::FindClosestEdges(PointTarget* target,
+                                                 std::vector<Result>* results,
+                                                 ShapeFilter filter) {
+  base_.FindClosestEdges(target, options_, results, filter);
+}
+
+inline void S2ClosestEdgeQuery::FindClosestEdges(EdgeTarget* target,
+                                                 std::vector<Result>* results,
+                                                 ShapeFilter filter) {
+  base_.FindClosestEdges(target, options_, results, filter);
+}
+
+template <class T>
+inline S2ClosestEdgeQuery::Result S2ClosestEdgeQuery::FindClosestEdgeInternal(
+    T* target, ShapeFilter filter) {
+  static_assert(sizeof(Options) <= 48, "Consider not copying Options here");
+  Options tmp_options = options_;
+  tmp_options.set_max_results(1);
+  return base_.FindClosestEdge(target, tmp_options, filter);
+}
+
 inline S2ClosestEdgeQuery::Result S2ClosestEdgeQuery::FindClosestEdge(
     Target* target, ShapeFilter filter) {
-  static_assert(sizeof(Options) <= 32, "Consider not copying Options here");
+  return FindClosestEdgeInternal(target, filter);
+}
+
+inline S2ClosestEdgeQuery::Result S2ClosestEdgeQuery::FindClosestEdge(
+    PointTarget* target, ShapeFilter filter) {
+  return FindClosestEdgeInternal(target, filter);
+}
+
+inline S2ClosestEdgeQuery::Result S2ClosestEdgeQuery::FindClosestEdge(
+    EdgeTarget* target, ShapeFilter filter) {
+  return FindClosestEdgeInternal(target, filter);
+}
+
+template <class T>
+inline bool S2ClosestEdgeQuery::IsDistanceLessInternal(T* target,
+                                                       S1ChordAngle limit,
+                                                       ShapeFilter filter) {
+  static_assert(sizeof(Options) <= 48, "Consider not copying Options here");
   Options tmp_options = options_;
   tmp_options.set_max_results(1);
-  return base_.FindClosestEdge(target, tmp_options, filter);
+  tmp_options.set_max_distance(limit);
+  tmp_options.set_max_error(S1ChordAngle::Straight());
+  return !base_.FindClosestEdge(target, tmp_options, filter).is_empty();
+}
+
+inline bool S2ClosestEdgeQuery::IsDistanceLess(PointTarget* target,
+                                               S1ChordAngle limit,
+                                               ShapeFilter filter) {
+  return IsDistanceLessInternal(target, limit, filter);
+}
+
+inline bool S2ClosestEdgeQuery::IsDistanceLess(EdgeTarget* target,
+                                               S1ChordAngle limit,
+                                               ShapeFilter filter) {
+  return IsDistanceLessInternal(target, limit, filter);
 }
 
 inline void S2ClosestEdgeQuery::VisitClosestEdges(  //
@@ -441,6 +632,15 @@ inline void S2ClosestEdgeQuery::VisitClosestEdges(  //
       filter);
 }
 
+inline void S2ClosestEdgeQuery::StartClosestEdges(Target* target,
+                                                  ShapeFilter filter) {
+  base_.StartClosestEdges(target, options_, filter);
+}
+
+inline bool S2ClosestEdgeQuery::NextClosestEdge(Result* result) {
+  return base_.NextClosestEdge(result);
+}
+
 inline S1ChordAngle S2ClosestEdgeQuery::GetDistance(Target* target,
                                                     ShapeFilter filter) {
   return FindClosestEdge(target, filter).distance();
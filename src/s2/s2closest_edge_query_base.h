@@ -19,13 +19,14 @@
 #define S2_S2CLOSEST_EDGE_QUERY_BASE_H_
 
 #include <algorithm>
+#include <cfloat>
 #include <cstdint>
 #include <cstdlib>
+#include <functional>
 #include <iterator>
 #include <limits>
 #include <memory>
 #include <optional>
-#include <queue>
 #include <type_traits>
 #include <utility>
 #include <vector>
@@ -36,7 +37,12 @@
 #include "absl/functional/function_ref.h"
 #include "absl/log/absl_check.h"
 #include "absl/log/absl_log.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "absl/types/span.h"
 #include "s2/_fp_contract_off.h"  // IWYU pragma: keep
+#include "s2/internal/s2dense_id_set.h"
+#include "s2/internal/s2priority_queue.h"
 #include "s2/s1angle.h"
 #include "s2/s1chord_angle.h"
 #include "s2/s2cap.h"
@@ -44,10 +50,13 @@
 #include "s2/s2cell_id.h"
 #include "s2/s2cell_union.h"
 #include "s2/s2distance_target.h"
+#include "s2/s2metrics.h"
 #include "s2/s2point.h"
+#include "s2/s2query_stats.h"
 #include "s2/s2region_coverer.h"
 #include "s2/s2shape.h"
 #include "s2/s2shape_index.h"
+#include "s2/s2shape_index_category_summary.h"
 #include "s2/s2shapeutil_count_edges.h"
 #include "s2/s2shapeutil_shape_edge_id.h"
 
@@ -199,6 +208,29 @@ class S2ClosestEdgeQueryBase {
     Delta max_error() const;
     void set_max_error(Delta max_error);
 
+    // Like max_error(), but specified as a fraction of the distance to the
+    // edges found so far.  Once max_results() edges have been found, the
+    // search stops examining any cell or edge that cannot be closer than the
+    // current worst result by more than this fraction.  This guarantees that
+    // the distance to each returned edge is at most (1 + max_relative_error)
+    // times the distance to the corresponding true closest edge.
+    //
+    // The distances reported in the results are always computed exactly; only
+    // the set of edges returned is approximate.  For example, a value of 0.01
+    // is often appropriate for ranking the edges near a point (as opposed to
+    // computing exact nearest neighbors), and can make queries with
+    // max_results() > 1 considerably faster.
+    //
+    // This option may be combined with max_error(), in which case the search
+    // stops as soon as either bound is satisfied.  It is only supported for
+    // minimum distances (i.e., S2ClosestEdgeQuery).
+    //
+    // REQUIRES: max_relative_error >= 0
+    //
+    // DEFAULT: 0
+    double max_relative_error() const;
+    void set_max_relative_error(double max_relative_error);
+
     // Specifies that polygon interiors should be included when measuring
     // distances.  In other words, polygons that contain the target should
     // have a distance of zero.  (For targets consisting of multiple connected
@@ -222,12 +254,66 @@ class S2ClosestEdgeQueryBase {
     bool use_brute_force() const;
     void set_use_brute_force(bool use_brute_force);
 
+    // Specifies that the sets used to avoid reporting the same polygon
+    // interior or testing the same edge more than once should be bitmaps
+    // indexed by shape id and edge id rather than hash sets or btree sets.
+    // These bitmaps have one bit for every shape and every edge of the index
+    // and are kept between queries; they are cleared in time proportional to
+    // the number of elements that were inserted.  This is much faster for
+    // queries that return or test a large number of edges (e.g., with a large
+    // max_distance() and many shapes), at the cost of memory proportional to
+    // the size of the index.
+    //
+    // DEFAULT: false
+    bool use_dense_id_sets() const { return use_dense_id_sets_; }
+    void set_use_dense_id_sets(bool use_dense_id_sets) {
+      use_dense_id_sets_ = use_dense_id_sets;
+    }
+
+    // If non-null, the number of index cells visited, clipped shapes scanned,
+    // edges tested, and cells enqueued by each query are added to the given
+    // object (see s2query_stats.h).  The object must outlive the query.
+    //
+    // DEFAULT: nullptr
+    S2QueryStats* stats() const { return stats_; }
+    void set_stats(S2QueryStats* stats) { stats_ = stats; }
+
+    // Specifies a deadline for each query.  The deadline is checked
+    // periodically while index cells are being processed, and once it has
+    // passed the search stops and returns the closest edges found so far
+    // (which are not necessarily the true closest edges).  This can be used
+    // to bound the latency of queries on pathological inputs.  Use
+    // deadline_exceeded() to check whether a query was stopped early.
+    //
+    // Brute force queries (see use_brute_force) do not check the deadline.
+    //
+    // DEFAULT: absl::InfiniteFuture()
+    absl::Time deadline() const {
+      return deadline_nanos_ == kNoDeadline
+                 ? absl::InfiniteFuture()
+                 : absl::FromUnixNanos(deadline_nanos_);
+    }
+    void set_deadline(absl::Time deadline) {
+      deadline_nanos_ = deadline == absl::InfiniteFuture()
+                            ? kNoDeadline
+                            : absl::ToUnixNanos(deadline);
+    }
+
    private:
     Distance max_distance_ = Distance::Infinity();
     Delta max_error_ = Delta::Zero();
+    double max_relative_error_ = 0;
     int max_results_ = kMaxMaxResults;
     bool include_interiors_ = true;
     bool use_brute_force_ = false;
+    bool use_dense_id_sets_ = false;
+    S2QueryStats* stats_ = nullptr;
+
+    // The deadline is stored as nanoseconds since the Unix epoch rather than
+    // as an absl::Time, which is twice as large, because Options are copied
+    // for every query.
+    static constexpr int64_t kNoDeadline = std::numeric_limits<int64_t>::max();
+    int64_t deadline_nanos_ = kNoDeadline;
   };
 
   // The Target class represents the geometry to which the distance is
@@ -261,18 +347,61 @@ class S2ClosestEdgeQueryBase {
   // Returns a reference to the underlying S2ShapeIndex.
   const S2ShapeIndex& index() const;
 
+  // Specifies a predicate that edges must satisfy in order to be returned by
+  // subsequent queries (e.g., a road class or one-way restriction looked up
+  // by shape and edge id).  Unlike filtering the results afterwards, the
+  // predicate is evaluated during the search before the distance to each
+  // edge is computed.  This means that the max_results() edges returned all
+  // satisfy the predicate, and that the search is only narrowed by edges
+  // that satisfy it.  The predicate is called with edge_id == -1 for polygon
+  // interiors (see Options::include_interiors).
+  //
+  // The predicate may be called more than once for the same edge.  Note that
+  // a ShapeFilter is more efficient when entire shapes should be excluded,
+  // since it is evaluated once per shape.  The filter is not part of Options
+  // so that Options remain cheap to copy.
+  //
+  // DEFAULT: an empty function (all edges are accepted)
+  using EdgeFilter = std::function<bool(int shape_id, int edge_id)>;
+  const EdgeFilter& edge_filter() const { return edge_filter_; }
+  void set_edge_filter(EdgeFilter edge_filter) {
+    edge_filter_ = std::move(edge_filter);
+  }
+
+  // Restricts subsequent queries to shapes whose category (as recorded in
+  // "summary") belongs to "categories".  This is similar to a ShapeFilter,
+  // except that entire index cells (and ranges of cells) that contain no
+  // matching shapes are skipped without computing their distance to the
+  // target.  Call set_category_filter(nullptr, 0) to remove the filter.
+  //
+  // REQUIRES: "summary" was built from the current index contents and
+  //           outlives its use by this object.
+  void set_category_filter(
+      const S2ShapeIndexCategorySummary* summary,
+      S2ShapeIndexCategorySummary::CategoryMask categories) {
+    category_summary_ = summary;
+    categories_ = categories;
+  }
+
   // Returns the closest edges to the given target that satisfy the given
   // options.  This method may be called multiple times.
   //
   // Note that if options().include_interiors() is true, the result vector may
   // include some entries with edge_id == -1.  This indicates that the target
   // intersects the indexed polygon with the given shape_id.
-  std::vector<Result> FindClosestEdges(Target* target, const Options& options,
+  //
+  // The search is instantiated for the static type "T" of the target, which
+  // must be Target or a subclass of it.  If "T" is a final class (such as
+  // S2MinDistancePointTarget), the distance computations in the inner loops
+  // are not virtual calls and can be inlined.
+  template <class T>
+  std::vector<Result> FindClosestEdges(T* target, const Options& options,
                                        ShapeFilter filter = {});
 
   // This version can be more efficient when this method is called many times,
   // since it does not require allocating a new vector on each call.
-  void FindClosestEdges(Target* target, const Options& options,
+  template <class T>
+  void FindClosestEdges(T* target, const Options& options,
                         std::vector<Result>* results, ShapeFilter filter = {});
 
   // Calls a callback with the closest edges to the given target that satisfy
@@ -283,6 +412,27 @@ class S2ClosestEdgeQueryBase {
   void VisitClosestEdges(Target* target, Options options, ResultVisitor visitor,
                          ShapeFilter filter = {});
 
+  // Incremental version of VisitClosestEdges().  StartClosestEdges() begins
+  // a new search, and each call to NextClosestEdge() then returns the next
+  // closest edge (in order of increasing distance) that satisfies the given
+  // options, doing only as much work as necessary to find it.  Returns false
+  // once there are no more such edges.  For example:
+  //
+  //   query.StartClosestEdges(&target, options);
+  //   for (Result result; query.NextClosestEdge(&result); ) {
+  //     if (IsAcceptable(result)) break;
+  //   }
+  //
+  // This is useful when the number of edges needed is not known in advance,
+  // e.g. when most of the closest edges are rejected by some other criteria.
+  // The search state (including the priority queue of unprocessed cells) is
+  // kept in the query object between calls, so "target", "options", and the
+  // state accessed by "filter" must remain valid until the search is
+  // finished.  Calling any other query method abandons the search.
+  void StartClosestEdges(Target* target, const Options& options,
+                         ShapeFilter filter = {});
+  bool NextClosestEdge(Result* result);
+
   // Convenience method that returns exactly one edge.  If no edges satisfy
   // the given search criteria, then a Result with distance == Infinity() and
   // shape_id == edge_id == -1 is returned.
@@ -292,31 +442,75 @@ class S2ClosestEdgeQueryBase {
   // that case distance == Zero() and shape_id >= 0).
   //
   // REQUIRES: options.max_results() == 1
-  Result FindClosestEdge(Target* target, const Options& options,
+  template <class T>
+  Result FindClosestEdge(T* target, const Options& options,
                          ShapeFilter filter = {});
 
+  // Returns true if the most recent query was stopped early because
+  // Options::deadline() had passed.
+  bool deadline_exceeded() const { return deadline_exceeded_; }
+
  private:
   struct QueueEntry;
 
   const Options& options() const { return *options_; }
-  void FindClosestEdgesInternal(Target* target, const Options& options,
+  // The methods below that are templated on "T" (the static type of target_)
+  // contain the inner loops of the search, so that targets of a known final
+  // type avoid a virtual call per edge and per cell.
+  template <class T>
+  void FindClosestEdgesInternal(T* target, const Options& options,
                                 std::optional<ResultVisitor> visitor = {});
+  // The search algorithm chosen by InitSearch(), where kNone indicates that
+  // no further search is needed.
+  enum class Algorithm { kNone, kBruteForce, kOptimized };
+  Algorithm InitSearch(Target* target, const Options& options, bool visiting);
+  // Returns true if options().deadline() has passed, in which case
+  // deadline_exceeded_ is also set.  The clock is only read once every
+  // kDeadlineCheckInterval calls.
+  bool CheckDeadline();
+  template <class T = Target>
   void FindClosestEdgesBruteForce(std::optional<ResultVisitor> visitor = {});
+  template <class T = Target>
   void FindClosestEdgesOptimized(std::optional<ResultVisitor> visitor = {});
+  template <class T = Target>
   void InitQueue();
   void InitCovering();
   void AddInitialRange(const S2ShapeIndex::Iterator& first,
                        const S2ShapeIndex::Iterator& last);
-  void MaybeAddResult(const S2Shape& shape, int shape_id, int edge_id);
+  bool IsNewEdge(int shape_id, int edge_id);
+  template <class T = Target>
+  void MaybeAddResult(int shape_id, int edge_id, const S2Shape::Edge& edge);
+  // Returns the distance limit implied by having found max_results() edges,
+  // the worst of which is at the given distance.
+  Distance GetDistanceLimit(Distance distance) const;
   void AddResult(const Result& result);
+  template <class T = Target>
+  void ProcessQueueEntry(const QueueEntry& entry);
+  template <class T = Target>
   void ProcessEdges(const QueueEntry& entry);
+  template <class T = Target>
   void ProcessOrEnqueue(S2CellId id);
+  template <class T = Target>
   void ProcessOrEnqueue(S2CellId id, const S2ShapeIndexCell* index_cell);
+  bool IsCellBeyondDistanceLimit(S2CellId id) const;
 
   // An optional call back for filtering shapes out as we scan the index.  This
   // is only set temporarily while a query is running.
   ShapeFilter shape_filter_;
 
+  // See set_edge_filter().
+  EdgeFilter edge_filter_;
+
+  // See set_category_filter().
+  const S2ShapeIndexCategorySummary* category_summary_ = nullptr;
+  S2ShapeIndexCategorySummary::CategoryMask categories_ = 0;
+
+  // Returns true if the given shape passes the category filter (if any).
+  bool MatchesCategory(int shape_id) const {
+    return category_summary_ == nullptr ||
+           (category_summary_->shape_categories(shape_id) & categories_) != 0;
+  }
+
   // Reports results that are less than cell_distance to the visitor.
   //
   // Returns true if result generation should continue, false otherwise.
@@ -336,20 +530,40 @@ class S2ClosestEdgeQueryBase {
 
   const S2ShapeIndex* index_;
   const Options* options_;
+
+  // True if the current query was stopped because the deadline passed, and
+  // the number of calls to CheckDeadline() since the clock was last read.
+  static constexpr int kDeadlineCheckInterval = 16;
+  bool deadline_exceeded_ = false;
+  int deadline_check_count_ = 0;
   Target* target_;
 
+  // Equal to options().stats(); cached here for the inner loops.
+  S2QueryStats* stats_ = nullptr;
+
   // Indicates we're sending results to a visitor instead of accumulating them
   // entirely in internal storage.
   //
   // Placed here in padding intentionally to avoid increasing class size.
   bool visiting_ = false;
 
+  // True while a search started by StartClosestEdges() is in progress, in
+  // which case incremental_filter_ is its shape filter and
+  // num_incremental_results_ is the number of results returned so far.
+  bool incremental_ = false;
+  ShapeFilter incremental_filter_;
+  int num_incremental_results_ = 0;
+
   // True if max_error() must be subtracted from priority queue cell distances
   // in order to ensure that such distances are measured conservatively.  This
   // is true only if the target takes advantage of max_error() in order to
   // return faster results, and 0 < max_error() < distance_limit_.
   bool use_conservative_cell_distance_;
 
+  // The bounding cap of the target, which is used to discard distant cells
+  // cheaply (see IsCellBeyondDistanceLimit).  Set by InitQueue().
+  S2Cap target_cap_;
+
   // For the optimized algorithm we precompute the top-level S2CellIds that
   // will be added to the priority queue.  There can be at most 6 of these
   // cells.  Essentially this is just a covering of the indexed edges, except
@@ -385,13 +599,24 @@ class S2ClosestEdgeQueryBase {
   //  - If max_results() == "infinity", results are appended to result_vector_
   //    and sorted/uniqued at the end.
   //
-  //  - Otherwise results are kept in a btree_set so that we can progressively
-  //    reduce the distance limit once max_results() results have been found.
-  //    (A priority queue is not sufficient because we need to be able to
-  //    check whether a candidate edge is already in the result set.)
+  //  - If max_results() <= kMaxSortedVectorResults, results are kept in
+  //    result_vector_ in sorted order without duplicates.  This lets us
+  //    progressively reduce the distance limit once max_results() results
+  //    have been found, and unlike a btree_set it does not allocate memory
+  //    when the same query object is reused.
+  //
+  //  - Otherwise (or when results are being sent to a visitor) results are
+  //    kept in a btree_set so that we can progressively reduce the distance
+  //    limit.  (A priority queue is not sufficient because we need to be able
+  //    to check whether a candidate edge is already in the result set.)
+  //
+  // All of these containers (as well as tested_edges_ and queue_) keep their
+  // storage between queries, so that repeated queries using the same object
+  // usually do not allocate memory.
   //
   // TODO(ericv): Check whether it would be faster to use avoid_duplicates_
   // when result_set_ is used so that we could use a priority queue instead.
+  static constexpr int kMaxSortedVectorResults = 64;
   Result result_singleton_;
   std::vector<Result> result_vector_;
   absl::btree_set<Result> result_set_;
@@ -417,6 +642,16 @@ class S2ClosestEdgeQueryBase {
   using ShapeEdgeId = s2shapeutil::ShapeEdgeId;
   absl::flat_hash_set<ShapeEdgeId> tested_edges_;
 
+  // When Options::use_dense_id_sets() is true, tested_edge_ids_ is used
+  // instead of tested_edges_.  Edge (shape_id, edge_id) has the dense id
+  // edge_id_offsets_[shape_id] + edge_id.  Both are computed on first use and
+  // discarded by ReInit().
+  void InitDenseIdSets();
+  bool use_dense_id_sets_ = false;
+  std::vector<int64_t> edge_id_offsets_;
+  s2internal::DenseIdSet tested_edge_ids_;
+  s2internal::DenseIdSet interior_shape_ids_;
+
   // The algorithm maintains a priority queue of unprocessed S2CellIds, sorted
   // in increasing order of distance from the target.
   struct QueueEntry {
@@ -443,8 +678,7 @@ class S2ClosestEdgeQueryBase {
       return other.distance < distance;
     }
   };
-  using CellQueue =
-      std::priority_queue<QueueEntry, absl::InlinedVector<QueueEntry, 16>>;
+  using CellQueue = s2internal::ReusablePriorityQueue<QueueEntry, 16>;
   CellQueue queue_;
 
   // Temporaries, defined here to avoid multiple allocations / initializations.
@@ -496,6 +730,22 @@ inline void S2ClosestEdgeQueryBase<Distance>::Options::set_max_error(
   max_error_ = max_error;
 }
 
+template <class Distance>
+inline double S2ClosestEdgeQueryBase<Distance>::Options::max_relative_error()
+    const {
+  return max_relative_error_;
+}
+
+template <class Distance>
+inline void S2ClosestEdgeQueryBase<Distance>::Options::set_max_relative_error(
+    double max_relative_error) {
+  ABSL_DCHECK_GE(max_relative_error, 0);
+  ABSL_DCHECK(max_relative_error == 0 ||
+              (std::is_base_of_v<S1ChordAngle, Distance>))
+      << "max_relative_error() is only supported for minimum distances";
+  max_relative_error_ = max_relative_error;
+}
+
 template <class Distance>
 inline bool S2ClosestEdgeQueryBase<Distance>::Options::include_interiors()
     const {
@@ -544,6 +794,7 @@ template <class Distance>
 void S2ClosestEdgeQueryBase<Distance>::ReInit() {
   index_num_edges_ = 0;
   index_num_edges_limit_ = 0;
+  edge_id_offsets_.clear();
   index_covering_.clear();
   index_cells_.clear();
   // We don't initialize iter_ here to make queries on small indexes a bit
@@ -556,8 +807,9 @@ inline const S2ShapeIndex& S2ClosestEdgeQueryBase<Distance>::index() const {
 }
 
 template <class Distance>
+template <class T>
 inline std::vector<typename S2ClosestEdgeQueryBase<Distance>::Result>
-S2ClosestEdgeQueryBase<Distance>::FindClosestEdges(Target* target,
+S2ClosestEdgeQueryBase<Distance>::FindClosestEdges(T* target,
                                                    const Options& options,
                                                    ShapeFilter filter) {
   std::vector<Result> results;
@@ -578,8 +830,6 @@ inline void S2ClosestEdgeQueryBase<Distance>::VisitClosestEdges(
     shape_filter_.emplace(*filter);
   }
 
-  result_set_.clear();
-
   visiting_ = true;
 
   int num_results_ = 0;
@@ -594,8 +844,9 @@ inline void S2ClosestEdgeQueryBase<Distance>::VisitClosestEdges(
 }
 
 template <class Distance>
+template <class T>
 typename S2ClosestEdgeQueryBase<Distance>::Result
-S2ClosestEdgeQueryBase<Distance>::FindClosestEdge(Target* target,
+S2ClosestEdgeQueryBase<Distance>::FindClosestEdge(T* target,
                                                   const Options& options,
                                                   ShapeFilter filter) {
   ABSL_DCHECK_EQ(options.max_results(), 1);
@@ -608,8 +859,9 @@ S2ClosestEdgeQueryBase<Distance>::FindClosestEdge(Target* target,
 }
 
 template <class Distance>
+template <class T>
 void S2ClosestEdgeQueryBase<Distance>::FindClosestEdges(
-    Target* target, const Options& options, std::vector<Result>* results,
+    T* target, const Options& options, std::vector<Result>* results,
     ShapeFilter filter) {
   if (filter) {
     shape_filter_.emplace(*filter);
@@ -627,6 +879,9 @@ void S2ClosestEdgeQueryBase<Distance>::FindClosestEdges(
     std::unique_copy(result_vector_.begin(), result_vector_.end(),
                      std::back_inserter(*results));
     result_vector_.clear();
+  } else if (options.max_results() <= kMaxSortedVectorResults) {
+    results->assign(result_vector_.begin(), result_vector_.end());
+    result_vector_.clear();
   } else {
     results->assign(result_set_.begin(), result_set_.end());
     result_set_.clear();
@@ -634,19 +889,54 @@ void S2ClosestEdgeQueryBase<Distance>::FindClosestEdges(
 }
 
 template <class Distance>
+template <class T>
 void S2ClosestEdgeQueryBase<Distance>::FindClosestEdgesInternal(
-    Target* target, const Options& options,
-    std::optional<ResultVisitor> visitor) {
+    T* target, const Options& options, std::optional<ResultVisitor> visitor) {
+  static_assert(std::is_base_of_v<Target, T>, "T must be a Target subclass");
+  switch (InitSearch(target, options, visitor.has_value())) {
+    case Algorithm::kNone:
+      // Report any results found while initializing the search (i.e.,
+      // polygons that contain the target).
+      if (visitor) ReportResults(*visitor, Distance::Infinity());
+      break;
+    case Algorithm::kBruteForce:
+      FindClosestEdgesBruteForce<T>(visitor);
+      break;
+    case Algorithm::kOptimized:
+      FindClosestEdgesOptimized<T>(visitor);
+      break;
+  }
+}
+
+template <class Distance>
+typename S2ClosestEdgeQueryBase<Distance>::Algorithm
+S2ClosestEdgeQueryBase<Distance>::InitSearch(Target* target,
+                                             const Options& options,
+                                             bool visiting) {
   target_ = target;
   options_ = &options;
+  stats_ = options.stats();
+  deadline_exceeded_ = false;
+  deadline_check_count_ = 0;
+
+  // Discard any state left over from a search that was stopped early (see
+  // VisitClosestEdges and StartClosestEdges).
+  incremental_ = false;
+  queue_.clear();
+  result_set_.clear();
 
-  tested_edges_.clear();
+  // Unlike clear(), erase() keeps the allocated storage for the next query.
+  tested_edges_.erase(tested_edges_.begin(), tested_edges_.end());
+  use_dense_id_sets_ = options.use_dense_id_sets();
+  if (use_dense_id_sets_) InitDenseIdSets();
   distance_limit_ = options.max_distance();
   result_singleton_ = Result();
   ABSL_DCHECK(result_vector_.empty());
-  ABSL_DCHECK(result_set_.empty());
+  if (options.max_results() <= kMaxSortedVectorResults) {
+    result_vector_.reserve(options.max_results());
+  }
   ABSL_DCHECK_GE(target->max_brute_force_index_size(), 0);
-  if (distance_limit_ == Distance::Zero()) return;
+  if (distance_limit_ == Distance::Zero()) return Algorithm::kNone;
 
   if (options.max_results() == Options::kMaxMaxResults &&
       options.max_distance() == Distance::Infinity()) {
@@ -657,30 +947,52 @@ void S2ClosestEdgeQueryBase<Distance>::FindClosestEdgesInternal(
   if (options.include_interiors()) {
     absl::btree_set<int32_t> shape_ids;
 
+    // Adds "id" to the set of containing shapes and returns the number of
+    // shapes found so far.
+    auto insert_shape_id = [&](int id) -> size_t {
+      if (use_dense_id_sets_) {
+        interior_shape_ids_.Insert(id);
+        return interior_shape_ids_.elements().size();
+      }
+      shape_ids.insert(id);
+      return shape_ids.size();
+    };
     const size_t max_results = static_cast<size_t>(options.max_results());
-    if (!shape_filter_) {
+    if (!shape_filter_ && !edge_filter_ && !category_summary_) {
       // By default just insert shape ids into the output set.
       (void)target->VisitContainingShapeIds(
           *index_, [&](int id, const S2Point&) {
-            shape_ids.insert(id);
-            return shape_ids.size() < max_results;
+            return insert_shape_id(id) < max_results;
           });
     } else {
-      // If we have a shape filter, then filter shape ids before storing them.
+      // If we have a shape, category, or edge filter, then filter shape ids
+      // before storing them.
       (void)target->VisitContainingShapeIds(
           *index_, [&](int id, const S2Point&) {
-            if ((*shape_filter_)(id)) {
-              shape_ids.insert(id);
+            if ((!shape_filter_ || (*shape_filter_)(id)) &&
+                MatchesCategory(id) &&
+                (!edge_filter_ || edge_filter_(id, -1))) {
+              return insert_shape_id(id) < max_results;
             }
-            return shape_ids.size() < max_results;
+            return true;
           });
     }
 
     const Distance kZero = Distance::Zero();
-    for (int shape_id : shape_ids) {
-      AddResult(Result(kZero, shape_id, -1));
+    if (use_dense_id_sets_) {
+      // Add the results in increasing order of shape id, as above.
+      std::vector<int64_t> ids = interior_shape_ids_.elements();
+      std::sort(ids.begin(), ids.end());
+      for (int64_t shape_id : ids) {
+        AddResult(Result(kZero, shape_id, -1));
+      }
+      interior_shape_ids_.Clear();
+    } else {
+      for (int shape_id : shape_ids) {
+        AddResult(Result(kZero, shape_id, -1));
+      }
     }
-    if (distance_limit_ == kZero) return;
+    if (distance_limit_ == kZero) return Algorithm::kNone;
   }
 
   // If max_error() > 0 and the target takes advantage of this, then we may
@@ -728,18 +1040,18 @@ void S2ClosestEdgeQueryBase<Distance>::FindClosestEdgesInternal(
   if (options.use_brute_force() || index_num_edges_ < min_optimized_edges) {
     // The brute force algorithm considers each edge exactly once.
     avoid_duplicates_ = false;
-    FindClosestEdgesBruteForce(visitor);
-  } else {
-    // If we're passing results to a visitor or the target takes advantage of
-    // max_error() then we need to avoid duplicate edges explicitly.  (Otherwise
-    // it happens automatically.)
-    avoid_duplicates_ =
-        (visitor || (target_uses_max_error && options.max_results() > 1));
-    FindClosestEdgesOptimized(visitor);
+    return Algorithm::kBruteForce;
   }
+  // If we're passing results to a visitor or the target takes advantage of
+  // max_error() then we need to avoid duplicate edges explicitly.  (Otherwise
+  // it happens automatically.)
+  avoid_duplicates_ =
+      (visiting || (target_uses_max_error && options.max_results() > 1));
+  return Algorithm::kOptimized;
 }
 
 template <class Distance>
+template <class T>
 void S2ClosestEdgeQueryBase<Distance>::FindClosestEdgesBruteForce(
     std::optional<ResultVisitor> visitor) {
   for (int shape_id = 0; shape_id < index_->num_shape_ids(); ++shape_id) {
@@ -748,10 +1060,19 @@ void S2ClosestEdgeQueryBase<Distance>::FindClosestEdgesBruteForce(
       continue;
     }
 
-    if (!shape_filter_ || (*shape_filter_)(shape_id)) {
+    if ((!shape_filter_ || (*shape_filter_)(shape_id)) &&
+        MatchesCategory(shape_id)) {
+      // Fetch the edges in batches to avoid a virtual call per edge.
+      constexpr int kBatchSize = 64;
+      S2Shape::Edge edges[kBatchSize];
       int num_edges = shape->num_edges();
-      for (int e = 0; e < num_edges; ++e) {
-        MaybeAddResult(*shape, shape_id, e);
+      for (int begin = 0; begin < num_edges; begin += kBatchSize) {
+        int n = std::min(kBatchSize, num_edges - begin);
+        shape->GetEdges(begin, absl::MakeSpan(edges, n));
+        for (int i = 0; i < n; ++i) {
+          if (edge_filter_ && !edge_filter_(shape_id, begin + i)) continue;
+          MaybeAddResult<T>(shape_id, begin + i, edges[i]);
+        }
       }
     }
   }
@@ -763,11 +1084,12 @@ void S2ClosestEdgeQueryBase<Distance>::FindClosestEdgesBruteForce(
 }
 
 template <class Distance>
+template <class T>
 void S2ClosestEdgeQueryBase<Distance>::FindClosestEdgesOptimized(
     std::optional<ResultVisitor> visitor) {
   Distance last_cell_distance = Distance::Zero();
 
-  InitQueue();
+  InitQueue<T>();
   // Repeatedly find the closest S2Cell to "target" and either split it into
   // its four children or process all of its edges.
   while (!queue_.empty()) {
@@ -776,7 +1098,11 @@ void S2ClosestEdgeQueryBase<Distance>::FindClosestEdgesOptimized(
     QueueEntry entry = queue_.top();
     queue_.pop();
     if (!(entry.distance < distance_limit_)) {
-      queue_ = CellQueue();  // Clear any remaining entries.
+      queue_.clear();  // Clear any remaining entries.
+      break;
+    }
+    if (CheckDeadline()) {
+      queue_.clear();
       break;
     }
 
@@ -789,30 +1115,7 @@ void S2ClosestEdgeQueryBase<Distance>::FindClosestEdgesOptimized(
       }
     }
 
-    // If this is already known to be an index cell, just process it.
-    if (entry.index_cell != nullptr) {
-      ProcessEdges(entry);
-      continue;
-    }
-    // Otherwise split the cell into its four children.  Before adding a
-    // child back to the queue, we first check whether it is empty.  We do
-    // this in two seek operations rather than four by seeking to the key
-    // between children 0 and 1 and to the key between children 2 and 3.
-    S2CellId id = entry.id;
-    iter_.Seek(id.child(1).range_min());
-    if (!iter_.done() && iter_.id() <= id.child(1).range_max()) {
-      ProcessOrEnqueue(id.child(1));
-    }
-    if (iter_.Prev() && iter_.id() >= id.range_min()) {
-      ProcessOrEnqueue(id.child(0));
-    }
-    iter_.Seek(id.child(3).range_min());
-    if (!iter_.done() && iter_.id() <= id.range_max()) {
-      ProcessOrEnqueue(id.child(3));
-    }
-    if (iter_.Prev() && iter_.id() >= id.child(2).range_min()) {
-      ProcessOrEnqueue(id.child(2));
-    }
+    ProcessQueueEntry<T>(entry);
   }
 
   // Flush results to the visitor if we have one.
@@ -822,6 +1125,117 @@ void S2ClosestEdgeQueryBase<Distance>::FindClosestEdgesOptimized(
 }
 
 template <class Distance>
+bool S2ClosestEdgeQueryBase<Distance>::CheckDeadline() {
+  if (options().deadline() == absl::InfiniteFuture()) return false;
+  if (deadline_exceeded_) return true;
+  if (++deadline_check_count_ < kDeadlineCheckInterval) return false;
+  deadline_check_count_ = 0;
+  deadline_exceeded_ = absl::Now() >= options().deadline();
+  return deadline_exceeded_;
+}
+
+template <class Distance>
+template <class T>
+void S2ClosestEdgeQueryBase<Distance>::ProcessQueueEntry(
+    const QueueEntry& entry) {
+  // If this is already known to be an index cell, just process it.
+  if (entry.index_cell != nullptr) {
+    ProcessEdges<T>(entry);
+    return;
+  }
+  // Otherwise split the cell into its four children.  Before adding a
+  // child back to the queue, we first check whether it is empty.  We do
+  // this in two seek operations rather than four by seeking to the key
+  // between children 0 and 1 and to the key between children 2 and 3.
+  S2CellId id = entry.id;
+  iter_.Seek(id.child(1).range_min());
+  if (!iter_.done() && iter_.id() <= id.child(1).range_max()) {
+    ProcessOrEnqueue<T>(id.child(1));
+  }
+  if (iter_.Prev() && iter_.id() >= id.range_min()) {
+    ProcessOrEnqueue<T>(id.child(0));
+  }
+  iter_.Seek(id.child(3).range_min());
+  if (!iter_.done() && iter_.id() <= id.range_max()) {
+    ProcessOrEnqueue<T>(id.child(3));
+  }
+  if (iter_.Prev() && iter_.id() >= id.child(2).range_min()) {
+    ProcessOrEnqueue<T>(id.child(2));
+  }
+}
+
+template <class Distance>
+void S2ClosestEdgeQueryBase<Distance>::StartClosestEdges(
+    Target* target, const Options& options, ShapeFilter filter) {
+  if (filter) {
+    shape_filter_.emplace(*filter);
+  }
+  visiting_ = true;
+  Algorithm algorithm = InitSearch(target, options, /*visiting=*/true);
+  if (algorithm == Algorithm::kBruteForce) {
+    FindClosestEdgesBruteForce();
+  } else if (algorithm == Algorithm::kOptimized) {
+    InitQueue();
+  }
+  visiting_ = false;
+  shape_filter_.reset();
+
+  incremental_ = true;
+  if (filter) {
+    incremental_filter_.emplace(*filter);
+  } else {
+    incremental_filter_.reset();
+  }
+  num_incremental_results_ = 0;
+}
+
+template <class Distance>
+bool S2ClosestEdgeQueryBase<Distance>::NextClosestEdge(Result* result) {
+  if (!incremental_) return false;
+  if (incremental_filter_) {
+    shape_filter_.emplace(*incremental_filter_);
+  }
+  visiting_ = true;
+  bool found = false;
+  while (true) {
+    if (!queue_.empty() && !(queue_.top().distance < distance_limit_)) {
+      queue_.clear();  // No remaining cell can contain a closer edge.
+    }
+    // The closest pending result can be returned once every unprocessed cell
+    // is further away, in the same way as ReportResults().
+    if (!result_set_.empty() &&
+        (queue_.empty() ||
+         result_set_.begin()->distance() < queue_.top().distance)) {
+      Result next = *result_set_.begin();
+      result_set_.erase(result_set_.begin());
+      // Re-check the shape filtering in case the user is updating it as we go.
+      if (shape_filter_ && !(*shape_filter_)(next.shape_id())) continue;
+      found = (++num_incremental_results_ <= options().max_results());
+      if (found) *result = next;
+      break;
+    }
+    if (queue_.empty()) break;
+    if (CheckDeadline()) {
+      queue_.clear();
+      continue;  // Return any results found so far.
+    }
+    QueueEntry entry = queue_.top();
+    queue_.pop();
+    ProcessQueueEntry(entry);
+  }
+  visiting_ = false;
+  shape_filter_.reset();
+  if (!found) {
+    // The search is finished, so release the remaining state.
+    incremental_ = false;
+    queue_.clear();
+    result_set_.clear();
+  }
+  return found;
+}
+
+template <class Distance>
+template <class T>
 void S2ClosestEdgeQueryBase<Distance>::InitQueue() {
   ABSL_DCHECK(queue_.empty());
   if (index_covering_.empty()) {
@@ -841,10 +1255,11 @@ void S2ClosestEdgeQueryBase<Distance>::InitQueue() {
   // TODO(ericv): Even if the cap center is not contained, we could still
   // process one or both of the adjacent index cells in S2CellId order,
   // provided that those cells are closer than distance_limit_.
-  S2Cap cap = target_->GetCapBound();
+  target_cap_ = target_->GetCapBound();
+  const S2Cap& cap = target_cap_;
   if (cap.is_empty()) return;  // Empty target.
   if (options().max_results() == 1 && iter_.Locate(cap.center())) {
-    ProcessEdges(QueueEntry(Distance::Zero(), iter_.id(), &iter_.cell()));
+    ProcessEdges<T>(QueueEntry(Distance::Zero(), iter_.id(), &iter_.cell()));
     // Skip the rest of the algorithm if we found an intersecting edge.
     if (distance_limit_ == Distance::Zero()) return;
   }
@@ -852,7 +1267,7 @@ void S2ClosestEdgeQueryBase<Distance>::InitQueue() {
   if (distance_limit_ == Distance::Infinity()) {
     // Start with the precomputed index covering.
     for (size_t i = 0; i < index_covering_.size(); ++i) {
-      ProcessOrEnqueue(index_covering_[i], index_cells_[i]);
+      ProcessOrEnqueue<T>(index_covering_[i], index_cells_[i]);
     }
   } else {
     // Compute a covering of the search disc and intersect it with the
@@ -876,7 +1291,7 @@ void S2ClosestEdgeQueryBase<Distance>::InitQueue() {
       if (id_i == id_j) {
         // This initial cell is one of the top-level cells.  Use the
         // precomputed S2ShapeIndexCell pointer to avoid an index seek.
-        ProcessOrEnqueue(id_j, index_cells_[j]);
+        ProcessOrEnqueue<T>(id_j, index_cells_[j]);
         ++i, ++j;
       } else {
         // This initial cell is a proper descendant of a top-level cell.
@@ -885,13 +1300,15 @@ void S2ClosestEdgeQueryBase<Distance>::InitQueue() {
         if (r == S2CellRelation::INDEXED) {
           // This cell is a descendant of an index cell.  Enqueue it and skip
           // any other initial cells that are also descendants of this cell.
-          ProcessOrEnqueue(iter_.id(), &iter_.cell());
+          ProcessOrEnqueue<T>(iter_.id(), &iter_.cell());
           const S2CellId last_id = iter_.id().range_max();
           while (++i < initial_cells_.size() && initial_cells_[i] <= last_id)
             continue;
         } else {
           // Enqueue the cell only if it contains at least one index cell.
-          if (r == S2CellRelation::SUBDIVIDED) ProcessOrEnqueue(id_i, nullptr);
+          if (r == S2CellRelation::SUBDIVIDED) {
+            ProcessOrEnqueue<T>(id_i, nullptr);
+          }
           ++i;
         }
       }
@@ -971,33 +1388,101 @@ void S2ClosestEdgeQueryBase<Distance>::AddInitialRange(
   }
 }
 
+// Returns true if the given edge passes the edge filter (if any) and has not
+// been tested already (if duplicates need to be avoided).
 template <class Distance>
-void S2ClosestEdgeQueryBase<Distance>::MaybeAddResult(const S2Shape& shape,
-                                                      int shape_id,
-                                                      int edge_id) {
-  if (avoid_duplicates_ &&
-      !tested_edges_.insert(ShapeEdgeId(shape_id, edge_id)).second) {
-    return;
+inline bool S2ClosestEdgeQueryBase<Distance>::IsNewEdge(int shape_id,
+                                                        int edge_id) {
+  if (edge_filter_ && !edge_filter_(shape_id, edge_id)) {
+    return false;
   }
+  if (!avoid_duplicates_) return true;
+  if (use_dense_id_sets_) {
+    return tested_edge_ids_.Insert(edge_id_offsets_[shape_id] + edge_id);
+  }
+  return tested_edges_.insert(ShapeEdgeId(shape_id, edge_id)).second;
+}
 
-  auto edge = shape.edge(edge_id);
+template <class Distance>
+void S2ClosestEdgeQueryBase<Distance>::InitDenseIdSets() {
+  if (edge_id_offsets_.empty()) {
+    // Compute the first dense edge id of every shape.
+    edge_id_offsets_.reserve(index_->num_shape_ids() + 1);
+    int64_t num_edges = 0;
+    for (int shape_id = 0; shape_id < index_->num_shape_ids(); ++shape_id) {
+      edge_id_offsets_.push_back(num_edges);
+      const S2Shape* shape = index_->shape(shape_id);
+      if (shape != nullptr) num_edges += shape->num_edges();
+    }
+    edge_id_offsets_.push_back(num_edges);
+    tested_edge_ids_.Reset(num_edges);
+    interior_shape_ids_.Reset(index_->num_shape_ids());
+  } else {
+    tested_edge_ids_.Clear();
+  }
+}
+
+// Computes the distance to the given edge and adds it to the results if it
+// is close enough.
+template <class Distance>
+template <class T>
+void S2ClosestEdgeQueryBase<Distance>::MaybeAddResult(
+    int shape_id, int edge_id, const S2Shape::Edge& edge) {
+  if (stats_ != nullptr) ++stats_->edges_tested;
   Distance distance = distance_limit_;
-  if (target_->UpdateMinDistance(edge.v0, edge.v1, &distance)) {
+  if (static_cast<T*>(target_)->UpdateMinDistance(edge.v0, edge.v1,
+                                                  &distance)) {
     AddResult(Result(distance, shape_id, edge_id));
   }
 }
 
+template <class Distance>
+Distance S2ClosestEdgeQueryBase<Distance>::GetDistanceLimit(
+    Distance distance) const {
+  Distance limit = distance - options().max_error();
+  if constexpr (std::is_base_of_v<S1ChordAngle, Distance>) {
+    if (options().max_relative_error() > 0) {
+      // Scaling the chord length (rather than the angle) is conservative,
+      // since the chord length is a concave function of the angle.
+      double scale = 1 / (1 + options().max_relative_error());
+      Distance scaled(
+          S1ChordAngle::FromLength2(distance.length2() * scale * scale));
+      if (scaled < limit) limit = scaled;
+    }
+  }
+  return limit;
+}
+
 template <class Distance>
 void S2ClosestEdgeQueryBase<Distance>::AddResult(const Result& result) {
   if (!visiting_) {
     if (options().max_results() == 1) {
       // Optimization for the common case where only the closest edge is wanted.
       result_singleton_ = result;
-      distance_limit_ = result.distance() - options().max_error();
+      distance_limit_ = GetDistanceLimit(result.distance());
       return;
     } else if (options().max_results() == Options::kMaxMaxResults) {
       result_vector_.push_back(result);  // Sort/unique at end.
       return;
+    } else if (options().max_results() <= kMaxSortedVectorResults) {
+      // Keep result_vector_ sorted, in the same way as result_set_ below.  Once
+      // it is full, a new result replaces the current worst one, so the vector
+      // never grows beyond the capacity reserved when the query starts.
+      const size_t max_results = options().max_results();
+      if (result_vector_.size() == max_results &&
+          !(result < result_vector_.back())) {
+        return;
+      }
+      auto it = std::lower_bound(result_vector_.begin(), result_vector_.end(),
+                                 result);
+      if (it != result_vector_.end() && *it == result) return;  // Duplicate.
+      size_t pos = it - result_vector_.begin();
+      if (result_vector_.size() == max_results) result_vector_.pop_back();
+      result_vector_.insert(result_vector_.begin() + pos, result);
+      if (result_vector_.size() == max_results) {
+        distance_limit_ = GetDistanceLimit(result_vector_.back().distance());
+      }
+      return;
     }
   }
 
@@ -1010,7 +1495,7 @@ void S2ClosestEdgeQueryBase<Distance>::AddResult(const Result& result) {
     if (size > options().max_results()) {
       result_set_.erase(--result_set_.end());
     }
-    distance_limit_ = (--result_set_.end())->distance() - options().max_error();
+    distance_limit_ = GetDistanceLimit((--result_set_.end())->distance());
   }
 }
 
@@ -1025,32 +1510,73 @@ inline static int CountEdges(const S2ShapeIndexCell* cell) {
 
 // Process all the edges of the given index cell.
 template <class Distance>
+template <class T>
 void S2ClosestEdgeQueryBase<Distance>::ProcessEdges(const QueueEntry& entry) {
   const S2ShapeIndexCell* index_cell = entry.index_cell;
+  if (stats_ != nullptr) {
+    ++stats_->cells_visited;
+    stats_->clipped_shapes_scanned += index_cell->num_clipped();
+  }
 
   for (int s = 0; s < index_cell->num_clipped(); ++s) {
     const S2ClippedShape& clipped = index_cell->clipped(s);
 
     int shape_id = clipped.shape_id();
-    if (!shape_filter_ || (*shape_filter_)(shape_id)) {
+    if ((!shape_filter_ || (*shape_filter_)(shape_id)) &&
+        MatchesCategory(shape_id)) {
       const S2Shape* shape = index_->shape(shape_id);
-      for (int j = 0; j < clipped.num_edges(); ++j) {
-        MaybeAddResult(*shape, shape_id, clipped.edge(j));
-      }
+      clipped.VisitEdges(*shape, [&](int edge_id, const S2Shape::Edge& edge) {
+        if (IsNewEdge(shape_id, edge_id)) {
+          MaybeAddResult<T>(shape_id, edge_id, edge);
+        }
+        return true;
+      });
     }
   }
 }
 
+// Returns true if every point of the given cell is at least distance_limit_
+// away from the target, using a lower bound that is much cheaper than the
+// exact cell distance: every point of the cell is within S2::kMaxDiag of
+// id.ToPoint(), and every point of the target is within target_cap_.
+// This is only implemented for S1ChordAngle-based minimum distances.
+template <class Distance>
+inline bool S2ClosestEdgeQueryBase<Distance>::IsCellBeyondDistanceLimit(
+    S2CellId id) const {
+  if constexpr (std::is_base_of_v<S1ChordAngle, Distance>) {
+    if (distance_limit_ == Distance::Infinity()) return false;
+    static const auto* const kCellRadius = [] {
+      auto* radius = new S1ChordAngle[S2CellId::kMaxLevel + 1];
+      for (int level = 0; level <= S2CellId::kMaxLevel; ++level) {
+        radius[level] =
+            S1ChordAngle(S1Angle::Radians(S2::kMaxDiag.GetValue(level)));
+      }
+      return radius;
+    }();
+    S1ChordAngle limit = S1ChordAngle(distance_limit_) +
+                         target_cap_.radius() + kCellRadius[id.level()];
+    if (limit == S1ChordAngle::Straight()) return false;
+    // The two additions above each have a relative error of at most
+    // 2.02 * DBL_EPSILON in length2(), and kCellRadius has a relative error
+    // of at most DBL_EPSILON (see GetS1AngleConstructorMaxError).
+    limit = limit.PlusError(6 * DBL_EPSILON * limit.length2());
+    S1ChordAngle distance(target_cap_.center(), id.ToPoint());
+    distance = distance.PlusError(-distance.GetS2PointConstructorMaxError());
+    return limit < distance;
+  }
+  return false;
+}
+
 // Enqueue the given cell id.
 // REQUIRES: iter_ is positioned at a cell contained by "id".
 template <class Distance>
-inline void S2ClosestEdgeQueryBase<Distance>::ProcessOrEnqueue(
-    S2CellId id) {
+template <class T>
+inline void S2ClosestEdgeQueryBase<Distance>::ProcessOrEnqueue(S2CellId id) {
   ABSL_DCHECK(id.contains(iter_.id()));
   if (iter_.id() == id) {
-    ProcessOrEnqueue(id, &iter_.cell());
+    ProcessOrEnqueue<T>(id, &iter_.cell());
   } else {
-    ProcessOrEnqueue(id, nullptr);
+    ProcessOrEnqueue<T>(id, nullptr);
   }
 }
 
@@ -1059,8 +1585,14 @@ inline void S2ClosestEdgeQueryBase<Distance>::ProcessOrEnqueue(
 //
 // This version is called directly only by InitQueue().
 template <class Distance>
+template <class T>
 void S2ClosestEdgeQueryBase<Distance>::ProcessOrEnqueue(
     S2CellId id, const S2ShapeIndexCell* index_cell) {
+  // Skip cells that do not contain any shapes in the requested categories.
+  if (category_summary_ &&
+      (category_summary_->GetCategories(id) & categories_) == 0) {
+    return;
+  }
   if (index_cell) {
     // If this index cell has only a few edges, then it is faster to check
     // them directly rather than computing the minimum distance to the S2Cell
@@ -1070,7 +1602,7 @@ void S2ClosestEdgeQueryBase<Distance>::ProcessOrEnqueue(
     if (num_edges == 0) return;
     if (num_edges < kMinEdgesToEnqueue) {
       // Set "distance" to zero to avoid the expense of computing it.
-      ProcessEdges(QueueEntry(Distance::Zero(), id, index_cell));
+      ProcessEdges<T>(QueueEntry(Distance::Zero(), id, index_cell));
       return;
     }
 
@@ -1092,15 +1624,26 @@ void S2ClosestEdgeQueryBase<Distance>::ProcessOrEnqueue(
   }
 
   // Otherwise compute the minimum distance to any point in the cell and add
-  // it to the priority queue.
+  // it to the priority queue.  Constructing the S2Cell and measuring the
+  // distance to it is relatively expensive, so we first try to discard the
+  // cell using a cheaper lower bound.
+  if (IsCellBeyondDistanceLimit(id)) {
+    if (stats_ != nullptr) ++stats_->cells_pruned;
+    return;
+  }
   S2Cell cell(id);
   Distance distance = distance_limit_;
-  if (!target_->UpdateMinDistance(cell, &distance)) return;
+  if (!static_cast<T*>(target_)->UpdateMinDistance(cell, &distance)) return;
   if (use_conservative_cell_distance_) {
     // Ensure that "distance" is a lower bound on the true distance to the cell.
     distance = distance - options().max_error();  // operator-=() not defined.
   }
   queue_.push(QueueEntry(distance, id, index_cell));
+  if (stats_ != nullptr) {
+    ++stats_->cells_enqueued;
+    stats_->max_queue_size =
+        std::max<int64_t>(stats_->max_queue_size, queue_.size());
+  }
 }
 
 #endif  // S2_S2CLOSEST_EDGE_QUERY_BASE_H_
@@ -0,0 +1,102 @@
+// Copyright 2024 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "s2/s2closest_edge_query.h"
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+#include "s2/mutable_s2shape_index.h"
+#include "s2/s1angle.h"
+#include "s2/s2benchmark_testing.h"
+#include "s2/s2point.h"
+#include "s2/s2testing.h"
+
+using std::vector;
+
+namespace {
+
+constexpr int kNumQueryPoints = 10000;
+
+// Measures the time to find the closest edge to a point.
+void BM_S2ClosestEdgeQueryFindClosestEdge(benchmark::State& state) {
+  auto index = s2benchmark::MakeFractalIndex(state.range(0));
+  const vector<S2Point> points =
+      s2benchmark::MakeQueryPoints(*index, kNumQueryPoints);
+  S2ClosestEdgeQuery query(index.get());
+  size_t i = 0;
+  for (auto _ : state) {
+    S2ClosestEdgeQuery::PointTarget target(points[i]);
+    benchmark::DoNotOptimize(query.FindClosestEdge(&target));
+    if (++i == points.size()) i = 0;
+  }
+}
+BENCHMARK(BM_S2ClosestEdgeQueryFindClosestEdge)
+    ->Apply(s2benchmark::EdgeCounts);
+
+// Measures the time to test whether a point is within a small distance of
+// any edge, which is typically much faster than finding the closest edge.
+void BM_S2ClosestEdgeQueryIsDistanceLess(benchmark::State& state) {
+  auto index = s2benchmark::MakeFractalIndex(state.range(0));
+  const vector<S2Point> points =
+      s2benchmark::MakeQueryPoints(*index, kNumQueryPoints);
+  S2ClosestEdgeQuery query(index.get());
+  const S1ChordAngle limit(S2Testing::KmToAngle(1));
+  size_t i = 0;
+  for (auto _ : state) {
+    S2ClosestEdgeQuery::PointTarget target(points[i]);
+    benchmark::DoNotOptimize(query.IsDistanceLess(&target, limit));
+    if (++i == points.size()) i = 0;
+  }
+}
+BENCHMARK(BM_S2ClosestEdgeQueryIsDistanceLess)
+    ->Apply(s2benchmark::EdgeCounts);
+
+// Measures the time per point to find the 5 closest edges to each point,
+// one point at a time.
+void BM_S2ClosestEdgeQueryFindClosestEdges(benchmark::State& state) {
+  auto index = s2benchmark::MakeFractalIndex(state.range(0));
+  const vector<S2Point> points =
+      s2benchmark::MakeQueryPoints(*index, kNumQueryPoints);
+  S2ClosestEdgeQuery query(index.get());
+  query.mutable_options()->set_max_results(5);
+  size_t i = 0;
+  for (auto _ : state) {
+    S2ClosestEdgeQuery::PointTarget target(points[i]);
+    benchmark::DoNotOptimize(query.FindClosestEdges(&target));
+    if (++i == points.size()) i = 0;
+  }
+}
+BENCHMARK(BM_S2ClosestEdgeQueryFindClosestEdges)
+    ->Apply(s2benchmark::EdgeCounts);
+
+// Like the above, but finds the closest edges to all points in one batch.
+void BM_S2ClosestEdgeQueryFindClosestEdgesBatch(benchmark::State& state) {
+  auto index = s2benchmark::MakeFractalIndex(state.range(0));
+  const vector<S2Point> points =
+      s2benchmark::MakeQueryPoints(*index, kNumQueryPoints);
+  S2ClosestEdgeQuery query(index.get());
+  query.mutable_options()->set_max_results(5);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(query.FindClosestEdges(points));
+  }
+  state.SetItemsProcessed(state.iterations() * points.size());
+}
+BENCHMARK(BM_S2ClosestEdgeQueryFindClosestEdgesBatch)
+    ->Apply(s2benchmark::EdgeCounts);
+
+}  // namespace
@@ -34,6 +34,9 @@
 #include "absl/log/log_streamer.h"
 #include "absl/random/bit_gen_ref.h"
 #include "absl/random/random.h"
+#include "absl/strings/str_cat.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
 #include "absl/types/span.h"
 
 #include "s2/encoded_s2shape_index.h"
@@ -57,6 +60,7 @@
 #include "s2/s2pointutil.h"
 #include "s2/s2polygon.h"
 #include "s2/s2predicates.h"
+#include "s2/s2query_stats.h"
 #include "s2/s2random.h"
 #include "s2/s2shape.h"
 #include "s2/s2shapeutil_coding.h"
@@ -605,6 +609,530 @@ TEST(S2ClosestEdgeQuery, IsConservativeDistanceLessOrEqual) {
       ConfidenceBound(kExpectedConservativeNeededFrac, kNumIters, /*z=*/3));
 }
 
+// Checks that the batch version of FindClosestEdges() returns exactly the
+// same results as querying each point individually.
+static void TestBatchMatchesIndividualQueries(
+    S2ClosestEdgeQuery* query, const vector<S2Point>& points) {
+  vector<vector<S2ClosestEdgeQuery::Result>> batch =
+      query->FindClosestEdges(points);
+  ASSERT_EQ(batch.size(), points.size());
+  for (size_t i = 0; i < points.size(); ++i) {
+    S2ClosestEdgeQuery::PointTarget target(points[i]);
+    auto expected = query->FindClosestEdges(&target);
+    ASSERT_EQ(batch[i].size(), expected.size()) << "point " << i;
+    for (size_t j = 0; j < expected.size(); ++j) {
+      EXPECT_EQ(batch[i][j].distance(), expected[j].distance());
+      EXPECT_EQ(batch[i][j].shape_id(), expected[j].shape_id());
+      EXPECT_EQ(batch[i][j].edge_id(), expected[j].edge_id());
+    }
+  }
+}
+
+TEST(S2ClosestEdgeQuery, BatchPointTargets) {
+  absl::BitGen bitgen(S2Testing::MakeTaggedSeedSeq(
+      "BATCH_POINT_TARGETS",
+      absl::LogInfoStreamer(__FILE__, __LINE__).stream()));
+  S2Cap cap(s2random::Point(bitgen), S2Testing::KmToAngle(10));
+  S2Fractal fractal(bitgen);
+  fractal.SetLevelForApproxMaxEdges(3000);
+  MutableS2ShapeIndex index;
+  index.Add(make_unique<S2Loop::OwningShape>(fractal.MakeLoop(
+      s2random::FrameAt(bitgen, cap.center()), cap.GetRadius())));
+
+  // Generate points along a random walk (like a GPS track) as well as some
+  // isolated points, so that consecutive targets are sometimes close
+  // together and sometimes far apart.
+  vector<S2Point> points;
+  S2Point p = cap.center();
+  for (int i = 0; i < 500; ++i) {
+    p = S2::GetPointOnLine(p, s2random::Point(bitgen),
+                           S2Testing::KmToAngle(0.1));
+    points.push_back(p);
+  }
+  S2Cap wide_cap(cap.center(), 2 * cap.GetRadius());
+  for (int i = 0; i < 100; ++i) {
+    points.push_back(s2random::SamplePoint(bitgen, wide_cap));
+  }
+
+  S2ClosestEdgeQuery query(&index);
+  for (int max_results : {1, 3, 10}) {
+    query.mutable_options()->set_max_results(max_results);
+    query.mutable_options()->set_max_distance(S1ChordAngle::Infinity());
+    TestBatchMatchesIndividualQueries(&query, points);
+    query.mutable_options()->set_max_distance(S2Testing::KmToAngle(0.5));
+    TestBatchMatchesIndividualQueries(&query, points);
+  }
+  query.mutable_options()->set_include_interiors(false);
+  query.mutable_options()->set_max_distance(S1ChordAngle::Infinity());
+  TestBatchMatchesIndividualQueries(&query, points);
+}
+
+TEST(S2ClosestEdgeQuery, BatchIsDistanceLess) {
+  absl::BitGen bitgen(S2Testing::MakeTaggedSeedSeq(
+      "BATCH_IS_DISTANCE_LESS",
+      absl::LogInfoStreamer(__FILE__, __LINE__).stream()));
+  S2Cap cap(s2random::Point(bitgen), S2Testing::KmToAngle(10));
+  S2Fractal fractal(bitgen);
+  fractal.SetLevelForApproxMaxEdges(3000);
+  MutableS2ShapeIndex index;
+  index.Add(make_unique<S2Loop::OwningShape>(fractal.MakeLoop(
+      s2random::FrameAt(bitgen, cap.center()), cap.GetRadius())));
+
+  vector<S2Point> points;
+  S2Point p = cap.center();
+  for (int i = 0; i < 500; ++i) {
+    p = S2::GetPointOnLine(p, s2random::Point(bitgen),
+                           S2Testing::KmToAngle(0.05));
+    points.push_back(p);
+  }
+  S2Cap wide_cap(cap.center(), 2 * cap.GetRadius());
+  for (int i = 0; i < 100; ++i) {
+    points.push_back(s2random::SamplePoint(bitgen, wide_cap));
+  }
+
+  S2ClosestEdgeQuery query(&index);
+  for (bool include_interiors : {false, true}) {
+    query.mutable_options()->set_include_interiors(include_interiors);
+    for (double limit_km : {0.0, 0.1, 0.5, 2.0}) {
+      S1ChordAngle limit(S2Testing::KmToAngle(limit_km));
+      vector<bool> less = query.IsDistanceLess(points, limit);
+      vector<bool> conservative =
+          query.IsConservativeDistanceLessOrEqual(points, limit);
+      ASSERT_EQ(less.size(), points.size());
+      ASSERT_EQ(conservative.size(), points.size());
+      for (size_t i = 0; i < points.size(); ++i) {
+        S2ClosestEdgeQuery::PointTarget target(points[i]);
+        EXPECT_EQ(less[i], query.IsDistanceLess(&target, limit)) << i;
+        EXPECT_EQ(conservative[i],
+                  query.IsConservativeDistanceLessOrEqual(&target, limit))
+            << i;
+      }
+    }
+  }
+}
+
+TEST(S2ClosestEdgeQuery, WarmStartMatchesColdStart) {
+  absl::BitGen bitgen(S2Testing::MakeTaggedSeedSeq(
+      "WARM_START_MATCHES_COLD_START",
+      absl::LogInfoStreamer(__FILE__, __LINE__).stream()));
+  S2Cap cap(s2random::Point(bitgen), S2Testing::KmToAngle(10));
+  S2Fractal fractal(bitgen);
+  fractal.SetLevelForApproxMaxEdges(3000);
+  MutableS2ShapeIndex index;
+  index.Add(make_unique<S2Loop::OwningShape>(fractal.MakeLoop(
+      s2random::FrameAt(bitgen, cap.center()), cap.GetRadius())));
+
+  // Interior results cannot be used as hints, so only edges are returned
+  // (as when matching points to a road network).
+  S2QueryStats warm_stats, cold_stats;
+  S2ClosestEdgeQuery query(&index);
+  query.mutable_options()->set_include_interiors(false);
+  for (int max_results : {1, 3, 10}) {
+    query.mutable_options()->set_max_results(max_results);
+    vector<S2ClosestEdgeQuery::Result> previous, warm, cold;
+    S2Point p = cap.center();
+    for (int i = 0; i < 200; ++i) {
+      // Every 50th point jumps far away, so that the hint is a poor one.
+      p = (i % 50 == 49) ? s2random::SamplePoint(bitgen, cap)
+                         : S2::GetPointOnLine(p, s2random::Point(bitgen),
+                                              S2Testing::KmToAngle(0.01));
+      S2ClosestEdgeQuery::PointTarget target(p);
+      query.mutable_options()->set_stats(&warm_stats);
+      query.FindClosestEdges(&target, previous, &warm);
+      query.mutable_options()->set_stats(&cold_stats);
+      query.FindClosestEdges(&target, &cold);
+      ASSERT_EQ(warm.size(), cold.size());
+      for (size_t j = 0; j < cold.size(); ++j) {
+        EXPECT_EQ(warm[j].distance(), cold[j].distance());
+      }
+      previous = warm;
+    }
+  }
+  EXPECT_LT(warm_stats.cells_enqueued, cold_stats.cells_enqueued);
+}
+
+TEST(S2ClosestEdgeQuery, SpecializedTargetsMatchGenericTargets) {
+  // Point and edge targets use a search that is instantiated for their
+  // concrete type.  Check that it gives the same results as the generic
+  // search, which is used when the static type of the target is Target*.
+  absl::BitGen bitgen(S2Testing::MakeTaggedSeedSeq(
+      "SPECIALIZED_TARGETS_MATCH_GENERIC_TARGETS",
+      absl::LogInfoStreamer(__FILE__, __LINE__).stream()));
+  S2Cap cap(s2random::Point(bitgen), S2Testing::KmToAngle(10));
+  S2Fractal fractal(bitgen);
+  fractal.SetLevelForApproxMaxEdges(3000);
+  MutableS2ShapeIndex index;
+  index.Add(make_unique<S2Loop::OwningShape>(fractal.MakeLoop(
+      s2random::FrameAt(bitgen, cap.center()), cap.GetRadius())));
+  S2ClosestEdgeQuery query(&index);
+  vector<S2ClosestEdgeQuery::Result> expected, actual;
+  for (int iter = 0; iter < 50; ++iter) {
+    S2Point a = s2random::SamplePoint(bitgen, cap);
+    S2Point b = s2random::SamplePoint(bitgen, cap);
+    S2ClosestEdgeQuery::PointTarget point_target(a);
+    S2ClosestEdgeQuery::EdgeTarget edge_target(a, b);
+    S1ChordAngle limit(S2Testing::KmToAngle(0.1 * iter));
+    for (int max_results : {1, 5}) {
+      query.mutable_options()->set_max_results(max_results);
+      query.mutable_options()->set_use_brute_force(iter % 10 == 0);
+
+      S2ClosestEdgeQuery::Target* target = &point_target;
+      query.FindClosestEdges(target, &expected);
+      query.FindClosestEdges(&point_target, &actual);
+      EXPECT_EQ(actual, expected);
+      EXPECT_EQ(query.FindClosestEdge(&point_target),
+                query.FindClosestEdge(target));
+      EXPECT_EQ(query.IsDistanceLess(&point_target, limit),
+                query.IsDistanceLess(target, limit));
+
+      target = &edge_target;
+      query.FindClosestEdges(target, &expected);
+      query.FindClosestEdges(&edge_target, &actual);
+      EXPECT_EQ(actual, expected);
+      EXPECT_EQ(query.FindClosestEdge(&edge_target),
+                query.FindClosestEdge(target));
+      EXPECT_EQ(query.IsDistanceLess(&edge_target, limit),
+                query.IsDistanceLess(target, limit));
+    }
+  }
+}
+
+TEST(S2ClosestEdgeQuery, StatsAreCollected) {
+  absl::BitGen bitgen(S2Testing::MakeTaggedSeedSeq(
+      "STATS_ARE_COLLECTED",
+      absl::LogInfoStreamer(__FILE__, __LINE__).stream()));
+  S2Cap cap(s2random::Point(bitgen), S2Testing::KmToAngle(10));
+  S2Fractal fractal(bitgen);
+  fractal.SetLevelForApproxMaxEdges(3000);
+  MutableS2ShapeIndex index;
+  index.Add(make_unique<S2Loop::OwningShape>(fractal.MakeLoop(
+      s2random::FrameAt(bitgen, cap.center()), cap.GetRadius())));
+  S2ClosestEdgeQuery query(&index);
+  query.mutable_options()->set_max_results(5);
+  S2ClosestEdgeQuery::PointTarget target(s2random::SamplePoint(bitgen, cap));
+  auto expected = query.FindClosestEdges(&target);
+
+  // Collecting statistics must not change the results.
+  S2QueryStats stats;
+  query.mutable_options()->set_stats(&stats);
+  EXPECT_EQ(query.FindClosestEdges(&target), expected);
+  EXPECT_GT(stats.cells_visited, 0);
+  EXPECT_GE(stats.clipped_shapes_scanned, stats.cells_visited);
+  EXPECT_GT(stats.edges_tested, 0);
+  EXPECT_GT(stats.cells_enqueued, 0);
+  EXPECT_GT(stats.max_queue_size, 0);
+  EXPECT_LE(stats.max_queue_size, stats.cells_enqueued);
+
+  // Counters accumulate across queries until cleared.
+  S2QueryStats first = stats;
+  query.FindClosestEdges(&target);
+  EXPECT_EQ(stats.edges_tested, 2 * first.edges_tested);
+  stats.Clear();
+  EXPECT_EQ(stats.edges_tested, 0);
+}
+
+TEST(S2ClosestEdgeQuery, Deadline) {
+  absl::BitGen bitgen(S2Testing::MakeTaggedSeedSeq(
+      "DEADLINE",
+      absl::LogInfoStreamer(__FILE__, __LINE__).stream()));
+  S2Cap cap(s2random::Point(bitgen), S2Testing::KmToAngle(10));
+  S2Fractal fractal(bitgen);
+  fractal.SetLevelForApproxMaxEdges(3000);
+  MutableS2ShapeIndex index;
+  index.Add(make_unique<S2Loop::OwningShape>(fractal.MakeLoop(
+      s2random::FrameAt(bitgen, cap.center()), cap.GetRadius())));
+  S2ClosestEdgeQuery query(&index);
+  S2ClosestEdgeQuery::PointTarget target(s2random::SamplePoint(bitgen, cap));
+  auto expected = query.FindClosestEdges(&target);
+  EXPECT_FALSE(query.deadline_exceeded());
+
+  // A deadline in the future does not change the results.
+  query.mutable_options()->set_deadline(absl::Now() + absl::Hours(1));
+  EXPECT_EQ(query.FindClosestEdges(&target), expected);
+  EXPECT_FALSE(query.deadline_exceeded());
+
+  // An expired deadline stops the search early and returns a subset of the
+  // results.
+  query.mutable_options()->set_deadline(absl::InfinitePast());
+  auto actual = query.FindClosestEdges(&target);
+  EXPECT_TRUE(query.deadline_exceeded());
+  EXPECT_LT(actual.size(), expected.size());
+  for (const auto& result : actual) {
+    EXPECT_TRUE(std::find(expected.begin(), expected.end(), result) !=
+                expected.end());
+  }
+
+  // The incremental interface also stops early.
+  S2ClosestEdgeQueryBase<S2MinDistance>::Options base_options;
+  base_options.set_deadline(absl::InfinitePast());
+  S2ClosestEdgeQueryBase<S2MinDistance> base(&index);
+  base.StartClosestEdges(&target, base_options);
+  int num_results = 0;
+  for (S2ClosestEdgeQueryBase<S2MinDistance>::Result result;
+       base.NextClosestEdge(&result);) {
+    ++num_results;
+  }
+  EXPECT_TRUE(base.deadline_exceeded());
+  EXPECT_LT(num_results, static_cast<int>(expected.size()));
+}
+
+TEST(S2ClosestEdgeQuery, DistantCellsArePruned) {
+  // Cells that are clearly beyond the distance limit are discarded without
+  // computing their exact distance.  Check that this happens and that the
+  // results are the same as those of the brute force algorithm.
+  absl::BitGen bitgen(S2Testing::MakeTaggedSeedSeq(
+      "DISTANT_CELLS_ARE_PRUNED",
+      absl::LogInfoStreamer(__FILE__, __LINE__).stream()));
+  S2Cap cap(s2random::Point(bitgen), S2Testing::KmToAngle(10));
+  S2Fractal fractal(bitgen);
+  fractal.SetLevelForApproxMaxEdges(10000);
+  MutableS2ShapeIndex index;
+  index.Add(make_unique<S2Loop::OwningShape>(fractal.MakeLoop(
+      s2random::FrameAt(bitgen, cap.center()), cap.GetRadius())));
+  S2QueryStats stats;
+  S2ClosestEdgeQuery query(&index);
+  query.mutable_options()->set_stats(&stats);
+  query.mutable_options()->set_max_results(5);
+  vector<S2ClosestEdgeQuery::Result> expected, actual;
+  for (int iter = 0; iter < 100; ++iter) {
+    query.mutable_options()->set_max_distance(
+        S2Testing::KmToAngle(absl::Uniform(bitgen, 0.0, 2.0)));
+    S2ClosestEdgeQuery::PointTarget target(s2random::SamplePoint(bitgen, cap));
+    query.mutable_options()->set_use_brute_force(true);
+    query.FindClosestEdges(&target, &expected);
+    query.mutable_options()->set_use_brute_force(false);
+    query.FindClosestEdges(&target, &actual);
+    // Edges whose distance equals the 5th closest distance may be chosen
+    // differently, so only the distances are compared.
+    ASSERT_EQ(actual.size(), expected.size());
+    for (size_t i = 0; i < actual.size(); ++i) {
+      EXPECT_EQ(actual[i].distance(), expected[i].distance());
+    }
+  }
+  EXPECT_GT(stats.cells_pruned, 0);
+}
+
+TEST(S2ClosestEdgeQuery, SortedVectorMatchesBtree) {
+  // Small values of max_results() keep the results in a sorted vector rather
+  // than a btree.  Check that both representations give the same results,
+  // and that reusing the query and the result vector gives the same results
+  // each time.
+  auto index = MakeIndexOrDie("## 0:0, 0:3, 3:3, 3:0; 1:1, 1:2, 2:2, 2:1");
+  S2ClosestEdgeQuery query(index.get());
+  S2ClosestEdgeQuery::PointTarget target(MakePointOrDie("1.5:1.5"));
+  constexpr int kMaxVector = 64;
+  query.mutable_options()->set_max_results(kMaxVector + 1);
+  auto expected = query.FindClosestEdges(&target);
+  ASSERT_EQ(expected.size(), 8);
+  ASSERT_TRUE(std::is_sorted(expected.begin(), expected.end()));
+  vector<S2ClosestEdgeQuery::Result> results;
+  for (int max_results : {kMaxVector, 5, kMaxVector, 5}) {
+    query.mutable_options()->set_max_results(max_results);
+    query.FindClosestEdges(&target, &results);
+    size_t n = std::min<size_t>(max_results, expected.size());
+    EXPECT_EQ(results, vector<S2ClosestEdgeQuery::Result>(
+                           expected.begin(), expected.begin() + n));
+  }
+}
+
+TEST(S2ClosestEdgeQuery, DenseIdSetsMatchHashSets) {
+  // Many overlapping polygons, so that each target point is contained by
+  // many shapes and many edges are tested more than once.
+  MutableS2ShapeIndex index;
+  const S2Point center = S2LatLng::FromDegrees(10, 10).ToPoint();
+  for (int i = 0; i < 100; ++i) {
+    index.Add(make_unique<S2Polygon::OwningShape>(
+        make_unique<S2Polygon>(S2Loop::MakeRegularLoop(
+            center, S1Angle::Degrees(1 + 0.05 * i), 20 + i))));
+  }
+  auto target_index =
+      MakeIndexOrDie("10:10 | 10.1:10.1 # # 9.9:9.9, 9.9:10.2, 10.2:9.9");
+  S2ClosestEdgeQuery::ShapeIndexTarget target(target_index.get());
+
+  S2ClosestEdgeQuery query(&index), dense_query(&index);
+  dense_query.mutable_options()->set_use_dense_id_sets(true);
+  for (int max_results :
+       {1, 10, 150, S2ClosestEdgeQuery::Options::kMaxMaxResults}) {
+    for (S1Angle max_error : {S1Angle::Zero(), S1Angle::Degrees(0.1)}) {
+      SCOPED_TRACE(absl::StrCat(max_results, " ", max_error.degrees()));
+      for (auto* q : {&query, &dense_query}) {
+        q->mutable_options()->set_max_results(max_results);
+        q->mutable_options()->set_max_distance(S1Angle::Degrees(3));
+        q->mutable_options()->set_max_error(max_error);
+      }
+      // Run the dense query twice to check that its sets are cleared.
+      auto expected = query.FindClosestEdges(&target);
+      EXPECT_EQ(dense_query.FindClosestEdges(&target), expected);
+      EXPECT_EQ(dense_query.FindClosestEdges(&target), expected);
+    }
+  }
+
+  // Visiting results also requires avoiding duplicates.
+  absl::flat_hash_set<ShapeEdgeId> visited;
+  dense_query.VisitClosestEdges(
+      &target, dense_query.options(),
+      [&](const S2ClosestEdgeQuery::Result& result) {
+        EXPECT_TRUE(
+            visited.insert(ShapeEdgeId(result.shape_id(), result.edge_id()))
+                .second);
+        return true;
+      });
+  EXPECT_GT(visited.size(), 100);
+}
+
+TEST(S2ClosestEdgeQuery, MaxRelativeError) {
+  absl::BitGen bitgen(S2Testing::MakeTaggedSeedSeq(
+      "MAX_RELATIVE_ERROR",
+      absl::LogInfoStreamer(__FILE__, __LINE__).stream()));
+  S2Cap cap(s2random::Point(bitgen), S2Testing::KmToAngle(10));
+  S2Fractal fractal(bitgen);
+  fractal.SetLevelForApproxMaxEdges(3000);
+  MutableS2ShapeIndex index;
+  index.Add(make_unique<S2Loop::OwningShape>(fractal.MakeLoop(
+      s2random::FrameAt(bitgen, cap.center()), cap.GetRadius())));
+
+  constexpr double kMaxRelativeError = 0.01;
+  S2ClosestEdgeQuery exact_query(&index);
+  S2ClosestEdgeQuery approx_query(&index);
+  approx_query.mutable_options()->set_max_relative_error(kMaxRelativeError);
+  for (int max_results : {1, 5, 100}) {
+    exact_query.mutable_options()->set_max_results(max_results);
+    approx_query.mutable_options()->set_max_results(max_results);
+    for (int i = 0; i < 100; ++i) {
+      S2Point point = s2random::SamplePoint(bitgen, cap);
+      S2ClosestEdgeQuery::PointTarget target(point);
+      auto expected = exact_query.FindClosestEdges(&target);
+      auto actual = approx_query.FindClosestEdges(&target);
+      ASSERT_EQ(actual.size(), expected.size());
+      for (size_t j = 0; j < actual.size(); ++j) {
+        // Distances are computed exactly, so each result must be an edge at
+        // the reported distance and within the relative error bound.
+        if (actual[j].is_interior()) {
+          EXPECT_EQ(actual[j].distance(), S1ChordAngle::Zero());
+          continue;
+        }
+        const S2Shape::Edge edge =
+            index.shape(actual[j].shape_id())->edge(actual[j].edge_id());
+        S1ChordAngle distance = S1ChordAngle::Infinity();
+        S2::UpdateMinDistance(point, edge.v0, edge.v1, &distance);
+        EXPECT_EQ(distance, actual[j].distance());
+        EXPECT_LE(actual[j].distance().ToAngle().radians(),
+                  (1 + kMaxRelativeError) *
+                      expected[j].distance().ToAngle().radians());
+      }
+    }
+  }
+}
+
+// Checks that pulling results one at a time with NextClosestEdge() gives the
+// same results as FindClosestEdges().
+static void TestIncrementalMatchesFindClosestEdges(
+    S2ClosestEdgeQuery* query, S2ClosestEdgeQuery::Target* target) {
+  auto expected = query->FindClosestEdges(target);
+  vector<S2ClosestEdgeQuery::Result> actual;
+  query->StartClosestEdges(target);
+  for (S2ClosestEdgeQuery::Result result; query->NextClosestEdge(&result);) {
+    actual.push_back(result);
+  }
+  EXPECT_EQ(actual, expected);
+  S2ClosestEdgeQuery::Result result;
+  EXPECT_FALSE(query->NextClosestEdge(&result));
+}
+
+TEST(S2ClosestEdgeQuery, IncrementalResults) {
+  absl::BitGen bitgen(S2Testing::MakeTaggedSeedSeq(
+      "INCREMENTAL_RESULTS",
+      absl::LogInfoStreamer(__FILE__, __LINE__).stream()));
+  S2Cap cap(s2random::Point(bitgen), S2Testing::KmToAngle(10));
+  S2Fractal fractal(bitgen);
+  fractal.SetLevelForApproxMaxEdges(3000);
+  MutableS2ShapeIndex index;
+  index.Add(make_unique<S2Loop::OwningShape>(fractal.MakeLoop(
+      s2random::FrameAt(bitgen, cap.center()), cap.GetRadius())));
+
+  S2ClosestEdgeQuery query(&index);
+  for (int i = 0; i < 20; ++i) {
+    S2ClosestEdgeQuery::PointTarget target(s2random::SamplePoint(bitgen, cap));
+    query.mutable_options()->set_max_results(25);
+    query.mutable_options()->set_max_distance(S1ChordAngle::Infinity());
+    TestIncrementalMatchesFindClosestEdges(&query, &target);
+    query.mutable_options()->set_max_results(
+        S2ClosestEdgeQuery::Options::kMaxMaxResults);
+    query.mutable_options()->set_max_distance(S2Testing::KmToAngle(0.5));
+    TestIncrementalMatchesFindClosestEdges(&query, &target);
+    query.mutable_options()->set_use_brute_force(true);
+    TestIncrementalMatchesFindClosestEdges(&query, &target);
+    query.mutable_options()->set_use_brute_force(false);
+  }
+
+  // Stopping a search early and then starting another query is allowed.
+  S2ClosestEdgeQuery::PointTarget target(cap.center());
+  query.StartClosestEdges(&target);
+  S2ClosestEdgeQuery::Result first;
+  ASSERT_TRUE(query.NextClosestEdge(&first));
+  EXPECT_EQ(query.FindClosestEdge(&target), first);
+  S2ClosestEdgeQuery::Result result;
+  EXPECT_FALSE(query.NextClosestEdge(&result));  // Search was abandoned.
+}
+
+TEST(S2ClosestEdgeQuery, IncrementalResultsWithFilter) {
+  auto index = MakeIndexOrDie("## 0:0, 0:3, 3:3, 3:0 | 5:5, 5:6, 6:6");
+  S2ClosestEdgeQuery query(index.get());
+  S2ClosestEdgeQuery::PointTarget target(MakePointOrDie("1:1"));
+  query.StartClosestEdges(&target, [](int shape_id) { return shape_id == 1; });
+  S2ClosestEdgeQuery::Result result;
+  int count = 0;
+  while (query.NextClosestEdge(&result)) {
+    EXPECT_EQ(result.shape_id(), 1);
+    ++count;
+  }
+  EXPECT_EQ(count, 3);
+
+  // The polygon interior is returned first when the target is inside it.
+  query.StartClosestEdges(&target);
+  ASSERT_TRUE(query.NextClosestEdge(&result));
+  EXPECT_TRUE(result.is_interior());
+  ASSERT_TRUE(query.NextClosestEdge(&result));
+  EXPECT_EQ(result.shape_id(), 0);
+}
+
+TEST(S2ClosestEdgeQuery, EdgeFilter) {
+  absl::BitGen bitgen(S2Testing::MakeTaggedSeedSeq(
+      "EDGE_FILTER", absl::LogInfoStreamer(__FILE__, __LINE__).stream()));
+  S2Cap cap(s2random::Point(bitgen), S2Testing::KmToAngle(10));
+  S2Fractal fractal(bitgen);
+  fractal.SetLevelForApproxMaxEdges(3000);
+  MutableS2ShapeIndex index;
+  for (int i = 0; i < 2; ++i) {
+    index.Add(make_unique<S2Loop::OwningShape>(fractal.MakeLoop(
+        s2random::FrameAt(bitgen, cap.center()), cap.GetRadius())));
+  }
+  auto accept = [](int shape_id, int edge_id) {
+    return edge_id == -1 ? shape_id == 1 : edge_id % 3 == shape_id;
+  };
+
+  S2ClosestEdgeQuery all_query(&index);
+  S2ClosestEdgeQuery query(&index);
+  query.mutable_options()->set_max_results(5);
+  query.set_edge_filter(accept);
+  for (bool brute_force : {false, true}) {
+    query.mutable_options()->set_use_brute_force(brute_force);
+    for (int i = 0; i < 50; ++i) {
+      S2ClosestEdgeQuery::PointTarget target(
+          s2random::SamplePoint(bitgen, cap));
+      // The results must be the 5 closest edges that pass the filter.
+      vector<S2ClosestEdgeQuery::Result> expected;
+      for (const auto& result : all_query.FindClosestEdges(&target)) {
+        if (expected.size() < 5 &&
+            accept(result.shape_id(), result.edge_id())) {
+          expected.push_back(result);
+        }
+      }
+      EXPECT_EQ(query.FindClosestEdges(&target), expected);
+    }
+  }
+}
+
 // The approximate radius of S2Cap from which query edges are chosen.
 static const S1Angle kTestCapRadius = S2Testing::KmToAngle(10);
 
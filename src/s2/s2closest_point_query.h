@@ -20,11 +20,18 @@
 #ifndef S2_S2CLOSEST_POINT_QUERY_H_
 #define S2_S2CLOSEST_POINT_QUERY_H_
 
+#include <memory>
+#include <utility>
 #include <vector>
 
+#include "absl/log/absl_check.h"
+#include "absl/types/span.h"
+#include "s2/internal/s2parallel.h"
+#include "s2/internal/s2point_order.h"
 #include "s2/s1angle.h"
 #include "s2/s1chord_angle.h"
 #include "s2/s2cell.h"
+#include "s2/s2cell_id.h"
 #include "s2/s2closest_point_query_base.h"
 #include "s2/s2min_distance_targets.h"
 #include "s2/s2point.h"
@@ -199,18 +206,23 @@ class S2ClosestPointQueryShapeIndexTarget final :
 //
 // The implementation is designed to be fast for both small and large
 // point sets.
-template <class Data>
+//
+// The optional IndexType argument allows other point index types with the
+// same interface to be queried, e.g.
+//
+//   S2ClosestPointQuery<int, S2FrozenPointIndex<int>> query(&frozen_index);
+template <class Data, class IndexType = S2PointIndex<Data>>
 class S2ClosestPointQuery {
  public:
   // See S2ClosestPointQueryBase for full documentation.
 
-  using Index = S2PointIndex<Data>;
+  using Index = IndexType;
   using PointData = typename Index::PointData;
 
   // S2MinDistance is a thin wrapper around S1ChordAngle that implements the
   // Distance concept required by S2ClosestPointQueryBase.
   using Distance = S2MinDistance;
-  using Base = S2ClosestPointQueryBase<Distance, Data>;
+  using Base = S2ClosestPointQueryBase<Distance, Data, IndexType>;
 
   // Each "Result" object represents a closest point.  Here are its main
   // methods (see S2ClosestPointQueryBase::Result for details):
@@ -269,6 +281,29 @@ class S2ClosestPointQuery {
   // since it does not require allocating a new vector on each call.
   void FindClosestPoints(Target* target, std::vector<Result>* results);
 
+  // Batch version of FindClosestPoints() for point targets.  Returns a vector
+  // whose i-th element contains the closest points to points[i], exactly as
+  // if FindClosestPoints() had been called with a PointTarget for each point.
+  //
+  // Up to "num_threads" threads (including the calling thread) are used, each
+  // with its own query state.  The points are sorted by S2CellId and divided
+  // into small chunks of nearby points, which are handed out to the threads
+  // dynamically.  This keeps all threads busy even when some regions are
+  // much more expensive to query than others (e.g., dense cities vs. ocean).
+  //
+  // REQUIRES: num_threads >= 1
+  // REQUIRES: If options().region() is set, its methods must be thread-safe
+  //           (as is true for all S2Region types in this library).
+  std::vector<std::vector<Result>> FindClosestPoints(
+      absl::Span<const S2Point> points, int num_threads = 1);
+
+  // Like the method above, but stores the results in "results".  The memory
+  // used by its elements is reused, so that calling this method repeatedly
+  // with the same "results" vector usually does not allocate memory.
+  void FindClosestPoints(absl::Span<const S2Point> points,
+                         std::vector<std::vector<Result>>* results,
+                         int num_threads = 1);
+
   //////////////////////// Convenience Methods ////////////////////////
 
   // Returns the closest point to the target.  If no point satisfies the search
@@ -360,79 +395,124 @@ inline S2ClosestPointQueryShapeIndexTarget::S2ClosestPointQueryShapeIndexTarget(
     : S2MinDistanceShapeIndexTarget(index) {
 }
 
-template <class Data>
-inline S2ClosestPointQuery<Data>::S2ClosestPointQuery(const Index* index,
-                                                      const Options& options) {
+template <class Data, class IndexType>
+inline S2ClosestPointQuery<Data, IndexType>::S2ClosestPointQuery(
+    const Index* index, const Options& options) {
   Init(index, options);
 }
 
-template <class Data>
-S2ClosestPointQuery<Data>::S2ClosestPointQuery() {
+template <class Data, class IndexType>
+S2ClosestPointQuery<Data, IndexType>::S2ClosestPointQuery() {
   // Prevent inline constructor bloat by defining here.
 }
 
-template <class Data>
-S2ClosestPointQuery<Data>::~S2ClosestPointQuery() {
+template <class Data, class IndexType>
+S2ClosestPointQuery<Data, IndexType>::~S2ClosestPointQuery() {
   // Prevent inline destructor bloat by defining here.
 }
 
-template <class Data>
-void S2ClosestPointQuery<Data>::Init(const Index* index,
-                                     const Options& options) {
+template <class Data, class IndexType>
+void S2ClosestPointQuery<Data, IndexType>::Init(const Index* index,
+                                                const Options& options) {
   options_ = options;
   base_.Init(index);
 }
 
-template <class Data>
-inline void S2ClosestPointQuery<Data>::ReInit() {
+template <class Data, class IndexType>
+inline void S2ClosestPointQuery<Data, IndexType>::ReInit() {
   base_.ReInit();
 }
 
-template <class Data>
-inline const S2PointIndex<Data>& S2ClosestPointQuery<Data>::index() const {
+template <class Data, class IndexType>
+inline const IndexType& S2ClosestPointQuery<Data, IndexType>::index() const {
   return base_.index();
 }
 
-template <class Data>
-inline const S2ClosestPointQueryOptions& S2ClosestPointQuery<Data>::options()
-    const {
+template <class Data, class IndexType>
+inline const S2ClosestPointQueryOptions&
+S2ClosestPointQuery<Data, IndexType>::options() const {
   return options_;
 }
 
-template <class Data>
+template <class Data, class IndexType>
 inline S2ClosestPointQueryOptions*
-S2ClosestPointQuery<Data>::mutable_options() {
+S2ClosestPointQuery<Data, IndexType>::mutable_options() {
   return &options_;
 }
 
-template <class Data>
-inline std::vector<typename S2ClosestPointQuery<Data>::Result>
-S2ClosestPointQuery<Data>::FindClosestPoints(Target* target) {
+template <class Data, class IndexType>
+inline std::vector<typename S2ClosestPointQuery<Data, IndexType>::Result>
+S2ClosestPointQuery<Data, IndexType>::FindClosestPoints(Target* target) {
   return base_.FindClosestPoints(target, options_);
 }
 
-template <class Data>
-inline void S2ClosestPointQuery<Data>::FindClosestPoints(
+template <class Data, class IndexType>
+inline void S2ClosestPointQuery<Data, IndexType>::FindClosestPoints(
     Target* target, std::vector<Result>* results) {
   base_.FindClosestPoints(target, options_, results);
 }
 
-template <class Data>
-inline typename S2ClosestPointQuery<Data>::Result
-S2ClosestPointQuery<Data>::FindClosestPoint(Target* target) {
+template <class Data, class IndexType>
+std::vector<std::vector<typename S2ClosestPointQuery<Data, IndexType>::Result>>
+S2ClosestPointQuery<Data, IndexType>::FindClosestPoints(
+    absl::Span<const S2Point> points, int num_threads) {
+  std::vector<std::vector<Result>> results;
+  FindClosestPoints(points, &results, num_threads);
+  return results;
+}
+
+template <class Data, class IndexType>
+void S2ClosestPointQuery<Data, IndexType>::FindClosestPoints(
+    absl::Span<const S2Point> points, std::vector<std::vector<Result>>* results,
+    int num_threads) {
+  ABSL_DCHECK_GE(num_threads, 1);
+  // Sort the points by leaf cell id, so that each chunk consists of points
+  // that are close together and can share the index cells they visit.
+  const auto order = s2internal::SortPointsByCellId(points);
+
+  // Chunks are small enough to balance the load between threads, but large
+  // enough that handing them out is cheap compared to querying them.
+  constexpr int kChunkSize = 64;
+  const int num_points = points.size();
+  results->resize(num_points);
+  // Worker 0 uses this query's own state, so that the single-threaded case
+  // does not need to initialize a new query.
+  std::vector<std::unique_ptr<Base>> worker_bases(
+      s2internal::NumChunkWorkers(num_threads, num_points, kChunkSize));
+  s2internal::ParallelForChunks(
+      num_threads, num_points, kChunkSize, [&](int worker, int begin, int end) {
+        Base* base = &base_;
+        if (worker > 0) {
+          if (!worker_bases[worker]) {
+            worker_bases[worker] = std::make_unique<Base>(&index());
+          }
+          base = worker_bases[worker].get();
+        }
+        for (int k = begin; k < end; ++k) {
+          const int i = order[k].second;
+          PointTarget target(points[i]);
+          base->FindClosestPoints(&target, options_, &(*results)[i]);
+        }
+      });
+}
+
+template <class Data, class IndexType>
+inline typename S2ClosestPointQuery<Data, IndexType>::Result
+S2ClosestPointQuery<Data, IndexType>::FindClosestPoint(Target* target) {
   static_assert(sizeof(Options) <= 32, "Consider not copying Options here");
   Options tmp_options = options_;
   tmp_options.set_max_results(1);
   return base_.FindClosestPoint(target, tmp_options);
 }
 
-template <class Data>
-inline S1ChordAngle S2ClosestPointQuery<Data>::GetDistance(Target* target) {
+template <class Data, class IndexType>
+inline S1ChordAngle S2ClosestPointQuery<Data, IndexType>::GetDistance(
+    Target* target) {
   return FindClosestPoint(target).distance();
 }
 
-template <class Data>
-bool S2ClosestPointQuery<Data>::IsDistanceLess(
+template <class Data, class IndexType>
+bool S2ClosestPointQuery<Data, IndexType>::IsDistanceLess(
     Target* target, S1ChordAngle limit) {
   static_assert(sizeof(Options) <= 32, "Consider not copying Options here");
   Options tmp_options = options_;
@@ -442,8 +522,8 @@ bool S2ClosestPointQuery<Data>::IsDistanceLess(
   return !base_.FindClosestPoint(target, tmp_options).is_empty();
 }
 
-template <class Data>
-bool S2ClosestPointQuery<Data>::IsDistanceLessOrEqual(
+template <class Data, class IndexType>
+bool S2ClosestPointQuery<Data, IndexType>::IsDistanceLessOrEqual(
     Target* target, S1ChordAngle limit) {
   static_assert(sizeof(Options) <= 32, "Consider not copying Options here");
   Options tmp_options = options_;
@@ -453,8 +533,8 @@ bool S2ClosestPointQuery<Data>::IsDistanceLessOrEqual(
   return !base_.FindClosestPoint(target, tmp_options).is_empty();
 }
 
-template <class Data>
-bool S2ClosestPointQuery<Data>::IsConservativeDistanceLessOrEqual(
+template <class Data, class IndexType>
+bool S2ClosestPointQuery<Data, IndexType>::IsConservativeDistanceLessOrEqual(
     Target* target, S1ChordAngle limit) {
   static_assert(sizeof(Options) <= 32, "Consider not copying Options here");
   Options tmp_options = options_;
@@ -342,3 +342,50 @@ TEST(S2ClosestPointQueryTest, ConservativeCellDistanceIsUsed) {
   TestWithIndexFactory(FractalPointIndexFactory(), 5, 100, 10, bitgen);
 }
 
+
+TEST(S2ClosestPointQuery, BatchPointTargets) {
+  absl::BitGen bitgen(S2Testing::MakeTaggedSeedSeq(
+      "BATCH_POINT_TARGETS",
+      absl::LogInfoStreamer(__FILE__, __LINE__).stream()));
+  // Most indexed points are in a small dense cluster, so that queries near
+  // the cluster are much more expensive than queries elsewhere.
+  S2Cap dense_cap(s2random::Point(bitgen), S2Testing::KmToAngle(1));
+  S2Cap sparse_cap(dense_cap.center(), S2Testing::KmToAngle(1000));
+  TestIndex index;
+  for (int i = 0; i < 5000; ++i) {
+    index.Add(s2random::SamplePoint(bitgen, i % 10 ? dense_cap : sparse_cap),
+              i);
+  }
+  vector<S2Point> targets;
+  for (int i = 0; i < 1000; ++i) {
+    targets.push_back(
+        s2random::SamplePoint(bitgen, i % 2 ? dense_cap : sparse_cap));
+  }
+
+  TestQuery query(&index);
+  query.mutable_options()->set_max_results(10);
+  query.mutable_options()->set_max_distance(S2Testing::KmToAngle(100));
+  for (int num_threads : {1, 4}) {
+    auto batch = query.FindClosestPoints(targets, num_threads);
+    ASSERT_EQ(batch.size(), targets.size());
+    for (size_t i = 0; i < targets.size(); ++i) {
+      S2ClosestPointQueryPointTarget target(targets[i]);
+      auto expected = query.FindClosestPoints(&target);
+      ASSERT_EQ(batch[i].size(), expected.size());
+      for (size_t j = 0; j < expected.size(); ++j) {
+        EXPECT_EQ(batch[i][j].distance(), expected[j].distance());
+        EXPECT_EQ(batch[i][j].data(), expected[j].data());
+      }
+    }
+  }
+  EXPECT_TRUE(query.FindClosestPoints(vector<S2Point>{}, 4).empty());
+
+  // The caller-buffer overload produces the same results when the result
+  // vector is reused.
+  auto expected = query.FindClosestPoints(targets, 4);
+  vector<vector<TestQuery::Result>> results;
+  for (int iter = 0; iter < 2; ++iter) {
+    query.FindClosestPoints(targets, &results, 4);
+    EXPECT_EQ(results, expected);
+  }
+}
@@ -39,9 +39,15 @@
 namespace s2coding {
 
 // Controls whether to optimize for speed or size when encoding shapes.  (Note
-// that encoding is always lossless, and that compact encodings are currently
-// only possible when points have been snapped to S2CellId centers.)
-enum class CodingHint : uint8_t { FAST, COMPACT };
+// that encoding is always lossless, and that COMPACT encodings only save
+// space when points have been snapped to S2CellId centers.)
+//
+// COMPACT_UNSNAPPED is like COMPACT except that vectors of points that are
+// not S2CellId centers are encoded using the XOR_BLOCKS format (see
+// EncodedS2PointVector).  This saves space for unsnapped data such as GPS
+// traces, but the result cannot be decoded by older versions of the library
+// that do not support that format.
+enum class CodingHint : uint8_t { FAST, COMPACT, COMPACT_UNSNAPPED };
 
 // S2Coder interface.
 template <class T>
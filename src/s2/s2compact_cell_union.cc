@@ -0,0 +1,161 @@
+// Copyright 2024 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "s2/s2compact_cell_union.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/log/absl_check.h"
+#include "s2/util/coding/coder.h"
+#include "s2/encoded_s2cell_id_vector.h"
+#include "s2/s2cap.h"
+#include "s2/s2cell_id.h"
+#include "s2/s2cell_union.h"
+#include "s2/s2latlng_rect.h"
+
+using std::vector;
+
+// Returns the encoding of an empty vector of S2CellIds.  Empty cell unions
+// refer to this buffer rather than allocating their own.
+static const std::string& EmptyEncoding() {
+  static const std::string* const encoding = [] {
+    Encoder encoder;
+    s2coding::EncodeS2CellIdVector({}, &encoder);
+    return new std::string(encoder.base(), encoder.length());
+  }();
+  return *encoding;
+}
+
+S2CompactCellUnion::S2CompactCellUnion() {
+  Decoder decoder(EmptyEncoding().data(), EmptyEncoding().size());
+  ABSL_CHECK(cell_ids_.Init(&decoder));
+}
+
+S2CompactCellUnion::S2CompactCellUnion(const S2CellUnion& cell_union)
+    : S2CompactCellUnion() {
+  if (cell_union.empty()) return;
+  Encoder encoder;
+  s2coding::EncodeS2CellIdVector(cell_union.cell_ids(), &encoder);
+  ABSL_CHECK(Init(encoder.base(), encoder.length()));
+}
+
+S2CompactCellUnion::S2CompactCellUnion(const S2CompactCellUnion& other)
+    : S2CompactCellUnion() {
+  *this = other;
+}
+
+S2CompactCellUnion& S2CompactCellUnion::operator=(
+    const S2CompactCellUnion& other) {
+  if (this == &other) return *this;
+  if (other.data_ == nullptr) {
+    *this = S2CompactCellUnion();
+  } else {
+    ABSL_CHECK(Init(other.data_.get(), other.size_));
+  }
+  return *this;
+}
+
+S2CompactCellUnion::S2CompactCellUnion(S2CompactCellUnion&& other)
+    : S2CompactCellUnion() {
+  *this = std::move(other);
+}
+
+S2CompactCellUnion& S2CompactCellUnion::operator=(
+    S2CompactCellUnion&& other) {
+  // Moving the buffer does not change its address, so "cell_ids_" remains
+  // valid.  The moved-from object is left empty.
+  data_ = std::move(other.data_);
+  size_ = other.size_;
+  cell_ids_ = other.cell_ids_;
+  Decoder decoder(EmptyEncoding().data(), EmptyEncoding().size());
+  ABSL_CHECK(other.cell_ids_.Init(&decoder));
+  other.size_ = 0;
+  return *this;
+}
+
+bool S2CompactCellUnion::Init(const char* data, size_t size) {
+  auto copy = std::make_unique<char[]>(size);
+  std::memcpy(copy.get(), data, size);
+  Decoder decoder(copy.get(), size);
+  s2coding::EncodedS2CellIdVector cell_ids;
+  if (!cell_ids.Init(&decoder)) return false;
+  data_ = std::move(copy);
+  size_ = size;
+  cell_ids_ = cell_ids;
+  return true;
+}
+
+S2CellUnion S2CompactCellUnion::ToCellUnion() const {
+  return S2CellUnion::FromVerbatim(cell_ids_.Decode());
+}
+
+int S2CompactCellUnion::FirstNotPreceding(S2CellId id) const {
+  // Since the cells are sorted and disjoint, the first cell that does not
+  // entirely precede "id" is either the cell before the first cell >=
+  // id.range_min() (if that cell extends far enough), or that cell itself.
+  int i = cell_ids_.lower_bound(id.range_min());
+  if (i > 0 && cell_ids_[i - 1].range_max() >= id.range_min()) --i;
+  return i;
+}
+
+bool S2CompactCellUnion::Contains(S2CellId id) const {
+  ABSL_DCHECK(id.is_valid()) << id;
+  int i = FirstNotPreceding(id);
+  return i != num_cells() && cell_ids_[i].contains(id);
+}
+
+bool S2CompactCellUnion::Intersects(S2CellId id) const {
+  ABSL_DCHECK(id.is_valid()) << id;
+  int i = FirstNotPreceding(id);
+  return i != num_cells() && cell_ids_[i].intersects(id);
+}
+
+size_t S2CompactCellUnion::SpaceUsed() const {
+  return sizeof(*this) + size_;
+}
+
+void S2CompactCellUnion::Encode(Encoder* encoder) const {
+  cell_ids_.Encode(encoder);
+}
+
+bool S2CompactCellUnion::Decode(Decoder* decoder) {
+  // Determine the length of the encoded data by decoding its header.
+  const char* start = decoder->skip(0);
+  s2coding::EncodedS2CellIdVector cell_ids;
+  if (!cell_ids.Init(decoder)) return false;
+  return Init(start, decoder->skip(0) - start);
+}
+
+S2CompactCellUnion* S2CompactCellUnion::Clone() const {
+  return new S2CompactCellUnion(*this);
+}
+
+S2Cap S2CompactCellUnion::GetCapBound() const {
+  return ToCellUnion().GetCapBound();
+}
+
+S2LatLngRect S2CompactCellUnion::GetRectBound() const {
+  return ToCellUnion().GetRectBound();
+}
+
+void S2CompactCellUnion::GetCellUnionBound(vector<S2CellId>* cell_ids) const {
+  GetCapBound().GetCellUnionBound(cell_ids);
+}
@@ -0,0 +1,171 @@
+// Copyright 2024 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef S2_S2COMPACT_CELL_UNION_H_
+#define S2_S2COMPACT_CELL_UNION_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "absl/log/absl_check.h"
+#include "s2/util/coding/coder.h"
+#include "s2/encoded_s2cell_id_vector.h"
+#include "s2/s1angle.h"
+#include "s2/s2cap.h"
+#include "s2/s2cell.h"
+#include "s2/s2cell_id.h"
+#include "s2/s2cell_iterator.h"
+#include "s2/s2cell_union.h"
+#include "s2/s2latlng_rect.h"
+#include "s2/s2point.h"
+#include "s2/s2region.h"
+
+// S2CompactCellUnion is an immutable S2CellUnion that keeps its cells in the
+// compressed form used by s2coding::EncodedS2CellIdVector, i.e. as a common
+// base value plus a fixed-width delta per cell.  Typical coverings need 2-5
+// bytes per cell rather than 8 (e.g., about 3 bytes per cell for coverings
+// with at most 100 cells), which makes this class useful for storing very
+// large numbers of cell unions in memory.
+//
+// Point and cell containment queries, as well as iteration, work directly on
+// the compressed form; each cell is decoded in constant time when accessed.
+// Operations that produce new cell unions (Union, Intersection, etc) are not
+// provided; use ToCellUnion() first.
+//
+// The memory overhead per object is sizeof(S2CompactCellUnion) plus one heap
+// allocation for the encoded cells (empty cell unions do not allocate).
+//
+// This class is copyable and movable.  A moved-from object is empty.
+class S2CompactCellUnion final : public S2Region {
+ public:
+  // S2CellIterator compatible iterator to support joining.
+  class Iterator final : public S2CellIterator {
+   public:
+    Iterator() = default;
+
+    // Builds an iterator positioned at the first cell of "cell_union".  The
+    // union must outlive the iterator.
+    explicit Iterator(const S2CompactCellUnion* cell_union)
+        : cell_union_(cell_union), pos_(0) {}
+
+    S2CellId id() const override {
+      ABSL_DCHECK(!done());
+      return cell_union_->cell_id(pos_);
+    }
+    bool done() const override { return pos_ == cell_union_->num_cells(); }
+    void Begin() override { pos_ = 0; }
+    void Finish() override { pos_ = cell_union_->num_cells(); }
+    void Next() override {
+      ABSL_DCHECK(!done());
+      ++pos_;
+    }
+    bool Prev() override {
+      if (pos_ == 0) return false;
+      --pos_;
+      return true;
+    }
+    void Seek(S2CellId target) override {
+      pos_ = cell_union_->cell_ids_.lower_bound(target);
+    }
+    bool Locate(const S2Point& target) override {
+      return LocateImpl(*this, target);
+    }
+    S2CellRelation Locate(S2CellId target) override {
+      return LocateImpl(*this, target);
+    }
+
+   private:
+    const S2CompactCellUnion* cell_union_ = nullptr;
+    int pos_ = 0;
+  };
+
+  // Creates an empty cell union.
+  S2CompactCellUnion();
+
+  // Creates a compact copy of the given cell union.  Cell unions do not need
+  // to be normalized, but the semantics of Contains() and Intersects() are
+  // the same as for S2CellUnion (which assumes normalization).
+  explicit S2CompactCellUnion(const S2CellUnion& cell_union);
+
+  S2CompactCellUnion(const S2CompactCellUnion& other);
+  S2CompactCellUnion& operator=(const S2CompactCellUnion& other);
+  S2CompactCellUnion(S2CompactCellUnion&& other);
+  S2CompactCellUnion& operator=(S2CompactCellUnion&& other);
+
+  int num_cells() const { return static_cast<int>(cell_ids_.size()); }
+  bool empty() const { return num_cells() == 0; }
+
+  // Returns the cell id at the given index.  Takes constant time.
+  // REQUIRES: 0 <= i < num_cells()
+  S2CellId cell_id(int i) const { return cell_ids_[i]; }
+
+  // Decodes all the cells into an ordinary S2CellUnion.
+  S2CellUnion ToCellUnion() const;
+
+  // Returns true if the cell union contains (or intersects) the given cell
+  // id.  This is an exact test that takes logarithmic time, with the same
+  // semantics as the corresponding S2CellUnion methods.
+  bool Contains(S2CellId id) const;
+  bool Intersects(S2CellId id) const;
+
+  // Returns the number of bytes used by this object, including the encoded
+  // cells.
+  size_t SpaceUsed() const;
+
+  // Appends an encoded representation of the cells to "encoder".  The format
+  // is that of s2coding::EncodeS2CellIdVector(), so this simply copies the
+  // internal representation.
+  void Encode(Encoder* encoder) const;
+
+  // Decodes a cell union encoded with Encode() (or EncodeS2CellIdVector()),
+  // copying the encoded data.  Returns true on success.
+  bool Decode(Decoder* decoder);
+
+  ////////////////////////////////////////////////////////////////////////
+  // S2Region interface (see s2region.h for details):
+
+  S2CompactCellUnion* Clone() const override;
+  S2Cap GetCapBound() const override;
+  S2LatLngRect GetRectBound() const override;
+  void GetCellUnionBound(std::vector<S2CellId>* cell_ids) const override;
+
+  // The point/cell containment methods are exact (see Contains(S2CellId)).
+  bool Contains(const S2Cell& cell) const override {
+    return Contains(cell.id());
+  }
+  bool MayIntersect(const S2Cell& cell) const override {
+    return Intersects(cell.id());
+  }
+  bool Contains(const S2Point& p) const override {
+    return Contains(S2CellId(p));
+  }
+
+ private:
+  // Initializes the object from "size" bytes of encoded data.
+  bool Init(const char* data, size_t size);
+
+  // Returns the index of the first cell that does not entirely precede "id"
+  // (see S2CellUnion::Contains), or num_cells() if there is no such cell.
+  int FirstNotPreceding(S2CellId id) const;
+
+  // The encoded cells, which are owned by this object.
+  std::unique_ptr<char[]> data_;
+  uint32_t size_ = 0;
+  s2coding::EncodedS2CellIdVector cell_ids_;
+};
+
+#endif  // S2_S2COMPACT_CELL_UNION_H_
@@ -0,0 +1,157 @@
+// Copyright 2024 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "s2/s2compact_cell_union.h"
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include "absl/log/log_streamer.h"
+#include "absl/random/random.h"
+#include "s2/util/coding/coder.h"
+#include "s2/s2cap.h"
+#include "s2/s2cell_id.h"
+#include "s2/s2cell_union.h"
+#include "s2/s2point.h"
+#include "s2/s2random.h"
+#include "s2/s2region_coverer.h"
+#include "s2/s2testing.h"
+
+using std::vector;
+
+namespace {
+
+S2CellUnion MakeCovering(absl::BitGenRef bitgen, int max_cells) {
+  S2RegionCoverer::Options options;
+  options.set_max_cells(max_cells);
+  S2RegionCoverer coverer(options);
+  S2Cap cap(s2random::Point(bitgen),
+            S2Testing::KmToAngle(absl::Uniform(bitgen, 1.0, 1000.0)));
+  return coverer.GetCovering(cap);
+}
+
+// Returns a random cell id near the given cell union, at a level that may be
+// larger or smaller than the levels of its cells.
+S2CellId MakeNearbyCellId(absl::BitGenRef bitgen,
+                          const S2CellUnion& cell_union) {
+  S2CellId id = cell_union.cell_id(
+      absl::Uniform(bitgen, 0, cell_union.num_cells()));
+  int level = absl::Uniform(bitgen, 0, S2CellId::kMaxLevel + 1);
+  if (level < id.level()) return id.parent(level);
+  // Choose a random descendant, or a neighbor of a random descendant.
+  const uint64_t num_leaves =
+      (id.range_max().id() - id.range_min().id()) / 2 + 1;
+  S2CellId descendant =
+      S2CellId(id.range_min().id() +
+               2 * absl::Uniform<uint64_t>(bitgen, 0, num_leaves))
+          .parent(level);
+  return absl::Bernoulli(bitgen, 0.5) ? descendant : descendant.next();
+}
+
+void ExpectSameAsCellUnion(const S2CellUnion& expected,
+                           const S2CompactCellUnion& actual,
+                           absl::BitGenRef bitgen) {
+  ASSERT_EQ(actual.num_cells(), expected.num_cells());
+  EXPECT_EQ(actual.ToCellUnion(), expected);
+  S2CompactCellUnion::Iterator it(&actual);
+  for (S2CellId id : expected) {
+    ASSERT_FALSE(it.done());
+    EXPECT_EQ(it.id(), id);
+    it.Next();
+  }
+  EXPECT_TRUE(it.done());
+  if (expected.empty()) return;
+
+  for (int i = 0; i < 1000; ++i) {
+    S2CellId id = MakeNearbyCellId(bitgen, expected);
+    if (!id.is_valid()) continue;
+    EXPECT_EQ(actual.Contains(id), expected.Contains(id)) << id;
+    EXPECT_EQ(actual.Intersects(id), expected.Intersects(id)) << id;
+    S2Point p = id.ToPoint();
+    EXPECT_EQ(actual.Contains(p), expected.Contains(p)) << id;
+  }
+}
+
+TEST(S2CompactCellUnion, Empty) {
+  absl::BitGen bitgen;
+  S2CompactCellUnion empty;
+  ExpectSameAsCellUnion(S2CellUnion(), empty, bitgen);
+  EXPECT_FALSE(empty.Contains(S2CellId::FromFace(0)));
+  EXPECT_FALSE(empty.Intersects(S2CellId::FromFace(0)));
+  EXPECT_TRUE(empty.GetCapBound().is_empty());
+}
+
+TEST(S2CompactCellUnion, MatchesCellUnion) {
+  absl::BitGen bitgen(S2Testing::MakeTaggedSeedSeq(
+      "MATCHES_CELL_UNION",
+      absl::LogInfoStreamer(__FILE__, __LINE__).stream()));
+  for (int iter = 0; iter < 100; ++iter) {
+    S2CellUnion cell_union =
+        MakeCovering(bitgen, absl::Uniform(bitgen, 1, 1000));
+    ExpectSameAsCellUnion(cell_union, S2CompactCellUnion(cell_union), bitgen);
+  }
+  // Also test a cell union that includes every face.
+  S2CellUnion whole_sphere = S2CellUnion::WholeSphere();
+  ExpectSameAsCellUnion(whole_sphere, S2CompactCellUnion(whole_sphere),
+                        bitgen);
+}
+
+TEST(S2CompactCellUnion, CopyAndMove) {
+  absl::BitGen bitgen;
+  S2CellUnion cell_union = MakeCovering(bitgen, 100);
+  S2CompactCellUnion original(cell_union);
+  S2CompactCellUnion copy(original);
+  ExpectSameAsCellUnion(cell_union, copy, bitgen);
+  S2CompactCellUnion moved(std::move(original));
+  ExpectSameAsCellUnion(cell_union, moved, bitgen);
+  EXPECT_TRUE(original.empty());  // NOLINT(bugprone-use-after-move)
+  original = moved;
+  ExpectSameAsCellUnion(cell_union, original, bitgen);
+  copy = S2CompactCellUnion();
+  EXPECT_TRUE(copy.empty());
+}
+
+TEST(S2CompactCellUnion, EncodeDecode) {
+  absl::BitGen bitgen;
+  S2CellUnion cell_union = MakeCovering(bitgen, 100);
+  S2CompactCellUnion compact(cell_union);
+  Encoder encoder;
+  compact.Encode(&encoder);
+  encoder.put8(0xAB);  // Check that Decode() consumes only its own data.
+
+  Decoder decoder(encoder.base(), encoder.length());
+  S2CompactCellUnion decoded;
+  ASSERT_TRUE(decoded.Decode(&decoder));
+  ExpectSameAsCellUnion(cell_union, decoded, bitgen);
+  ASSERT_EQ(decoder.avail(), 1);
+  EXPECT_EQ(decoder.get8(), 0xAB);
+
+  Decoder truncated(encoder.base(), 1);
+  EXPECT_FALSE(decoded.Decode(&truncated));
+}
+
+TEST(S2CompactCellUnion, UsesLessSpaceThanCellUnion) {
+  absl::BitGen bitgen(S2Testing::MakeTaggedSeedSeq(
+      "USES_LESS_SPACE_THAN_CELL_UNION",
+      absl::LogInfoStreamer(__FILE__, __LINE__).stream()));
+  S2CellUnion cell_union = MakeCovering(bitgen, 100);
+  S2CompactCellUnion compact(cell_union);
+  EXPECT_LT(compact.SpaceUsed(),
+            sizeof(cell_union) + cell_union.num_cells() * sizeof(S2CellId));
+}
+
+}  // namespace
@@ -19,13 +19,17 @@
 #define S2_S2CONTAINS_POINT_QUERY_H_
 
 #include <functional>
+#include <utility>
 #include <vector>
 
 #include "absl/functional/function_ref.h"
+#include "absl/types/span.h"
+#include "s2/internal/s2point_order.h"
 #include "s2/s2cell_id.h"
 #include "s2/s2edge_crosser.h"
 #include "s2/s2edge_crossings.h"
 #include "s2/s2point.h"
+#include "s2/s2query_stats.h"
 #include "s2/s2shape.h"
 #include "s2/s2shape_index.h"
 #include "s2/s2shapeutil_shape_edge.h"
@@ -65,8 +69,17 @@ class S2ContainsPointQueryOptions {
   S2VertexModel vertex_model() const;
   void set_vertex_model(S2VertexModel model);
 
+  // If non-null, the number of index cells visited, clipped shapes scanned,
+  // and edges tested by each query are added to the given object (see
+  // s2query_stats.h).  The object must outlive the query.
+  //
+  // DEFAULT: nullptr
+  S2QueryStats* stats() const { return stats_; }
+  void set_stats(S2QueryStats* stats) { stats_ = stats; }
+
  private:
   S2VertexModel vertex_model_ = S2VertexModel::SEMI_OPEN;
+  S2QueryStats* stats_ = nullptr;
 };
 
 // S2ContainsPointQuery determines whether one or more shapes in an
@@ -155,6 +168,28 @@ class S2ContainsPointQuery {
   // point "p".
   std::vector<int> GetContainingShapeIds(const S2Point& p);
 
+  // Batch version of VisitContainingShapeIds() that is much faster when
+  // testing a large number of points.  Calls visitor(i, shape_id) for every
+  // shape that contains points[i], terminating early if the visitor returns
+  // false (in which case this method returns false as well).
+  //
+  // Rather than locating each point independently, the points are sorted by
+  // S2CellId and the index is traversed in a single monotonic pass, so that
+  // nearby points reuse the same index cell and the cost of seeking is
+  // amortized.  (This is similar to how S2CellIteratorJoin merges two
+  // indexes.)  Consequently the points are visited in S2CellId order rather
+  // than in the order given, although the shapes containing any particular
+  // point are visited in increasing order of shape id.  Input that is already
+  // sorted is detected and not re-sorted.
+  bool VisitContainingShapeIds(
+      absl::Span<const S2Point> points,
+      absl::FunctionRef<bool(int point_index, int shape_id)> visitor);
+
+  // Convenience function that returns a vector whose i-th element contains
+  // the ids of all shapes that contain points[i].
+  std::vector<std::vector<int>> GetContainingShapeIds(
+      absl::Span<const S2Point> points);
+
   // Visits all edges in the given index() that are incident to the point "p"
   // (i.e., "p" is one of the edge endpoints), terminating early if the given
   // EdgeVisitor function returns false (in which case VisitIncidentEdges
@@ -178,6 +213,19 @@ class S2ContainsPointQuery {
                      const S2Point& p) const;
 
  private:
+  // Like it_.Locate(S2Point(target)), except that when the targets passed to
+  // successive calls are non-decreasing it avoids seeking whenever the
+  // target is in the current cell or the one after it.  "positioned"
+  // indicates whether the previous call left the iterator at the first cell
+  // whose range_max() is at least the previous target (this is true after
+  // every call).
+  bool LocateMonotonic(S2CellId target, bool positioned);
+
+  // Counts a visit to the current index cell if stats are being collected.
+  void CountCellVisit() const {
+    if (options_.stats() != nullptr) ++options_.stats()->cells_visited;
+  }
+
   const IndexType* index_ = nullptr;
   Options options_;
   Iterator it_;
@@ -236,6 +284,7 @@ void S2ContainsPointQuery<IndexType>::Init(const IndexType* index,
 template <class IndexType>
 bool S2ContainsPointQuery<IndexType>::Contains(const S2Point& p) {
   if (!it_.Locate(p)) return false;
+  CountCellVisit();
 
   const S2ShapeIndexCell& cell = it_.cell();
   int num_clipped = cell.num_clipped();
@@ -251,6 +300,7 @@ bool S2ContainsPointQuery<IndexType>::ShapeContains(int shape_id,
   if (!it_.Locate(p)) {
     return false;
   }
+  CountCellVisit();
 
   const S2ClippedShape* clipped = it_.cell().find_clipped(shape_id);
   if (clipped == nullptr) {
@@ -266,6 +316,7 @@ bool S2ContainsPointQuery<IndexType>::VisitContainingShapeIds(
   // This function returns "false" only if the algorithm terminates early
   // because the "visitor" function returned false.
   if (!it_.Locate(p)) return true;
+  CountCellVisit();
 
   for (const S2ClippedShape& clipped : it_.cell().clipped_shapes()) {
     if (ShapeContains(it_.id(), clipped, p) && !visitor(clipped.shape_id())) {
@@ -296,14 +347,13 @@ bool S2ContainsPointQuery<IndexType>::VisitIncidentEdges(
     int num_edges = clipped.num_edges();
     if (num_edges == 0) continue;
     const S2Shape& shape = *index_->shape(clipped.shape_id());
-    for (int i = 0; i < num_edges; ++i) {
-      int edge_id = clipped.edge(i);
-      auto edge = shape.edge(edge_id);
-      if ((edge.v0 == p || edge.v1 == p) &&
-          !visitor(s2shapeutil::ShapeEdge(clipped.shape_id(), edge_id, edge))) {
-        return false;
-      }
-    }
+    bool keep_going =
+        clipped.VisitEdges(shape, [&](int edge_id, const S2Shape::Edge& edge) {
+          return (edge.v0 != p && edge.v1 != p) ||
+                 visitor(s2shapeutil::ShapeEdge(clipped.shape_id(), edge_id,
+                                                edge));
+        });
+    if (!keep_going) return false;
   }
   return true;
 }
@@ -330,11 +380,74 @@ std::vector<int> S2ContainsPointQuery<IndexType>::GetContainingShapeIds(
   return results;
 }
 
+template <class IndexType>
+bool S2ContainsPointQuery<IndexType>::VisitContainingShapeIds(
+    absl::Span<const S2Point> points,
+    absl::FunctionRef<bool(int point_index, int shape_id)> visitor) {
+  const auto targets = s2internal::SortPointsByCellId(points);
+  bool positioned = false;
+  for (const auto& [target, i] : targets) {
+    bool found = LocateMonotonic(target, positioned);
+    positioned = true;
+    if (!found) continue;
+    CountCellVisit();
+    const S2Point& p = points[i];
+    for (const S2ClippedShape& clipped : it_.cell().clipped_shapes()) {
+      if (ShapeContains(it_.id(), clipped, p) &&
+          !visitor(i, clipped.shape_id())) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+template <class IndexType>
+std::vector<std::vector<int>>
+S2ContainsPointQuery<IndexType>::GetContainingShapeIds(
+    absl::Span<const S2Point> points) {
+  std::vector<std::vector<int>> results(points.size());
+  VisitContainingShapeIds(points, [&results](int i, int shape_id) {
+    results[i].push_back(shape_id);
+    return true;
+  });
+  return results;
+}
+
+template <class IndexType>
+bool S2ContainsPointQuery<IndexType>::LocateMonotonic(S2CellId target,
+                                                      bool positioned) {
+  if (positioned) {
+    // The iterator is at the first cell whose range_max() is at least the
+    // previous target.  Since index cells are disjoint and sorted, the same
+    // is true for the current target if the current cell (or failing that,
+    // the next one) ends at or after it.
+    if (it_.done()) return false;
+    if (it_.id().range_max() >= target) {
+      return it_.id().range_min() <= target;
+    }
+    it_.Next();
+    if (it_.done()) return false;
+    if (it_.id().range_max() >= target) {
+      return it_.id().range_min() <= target;
+    }
+  }
+  // Otherwise seek to the first cell whose range_max() is at least "target",
+  // which is either the first cell with id() >= target or its predecessor.
+  it_.Seek(target);
+  if (it_.Prev() && it_.id().range_max() < target) it_.Next();
+  return !it_.done() && it_.id().range_min() <= target;
+}
+
 template <class IndexType>
 bool S2ContainsPointQuery<IndexType>::ShapeContains(
     S2CellId cell_id, const S2ClippedShape& clipped, const S2Point& p) const {
   bool inside = clipped.contains_center();
   const int num_edges = clipped.num_edges();
+  if (S2QueryStats* stats = options_.stats()) {
+    ++stats->clipped_shapes_scanned;
+    stats->edges_tested += num_edges;
+  }
   if (num_edges > 0) {
     const S2Shape& shape = *index_->shape(clipped.shape_id());
     if (shape.dimension() < 2) {
@@ -342,29 +455,28 @@ bool S2ContainsPointQuery<IndexType>::ShapeContains(
       if (options_.vertex_model() != S2VertexModel::CLOSED) return false;
 
       // Otherwise, the point is contained if and only if it matches a vertex.
-      for (int i = 0; i < num_edges; ++i) {
-        auto edge = shape.edge(clipped.edge(i));
-        if (edge.v0 == p || edge.v1 == p) return true;
-      }
-      return false;
+      return !clipped.VisitEdges(shape, [&](int, const S2Shape::Edge& edge) {
+        return edge.v0 != p && edge.v1 != p;
+      });
     }
     // Test containment by drawing a line segment from the cell center to the
     // given point and counting edge crossings.
     S2CopyingEdgeCrosser crosser(cell_id.ToPoint(), p);
-    for (int i = 0; i < num_edges; ++i) {
-      auto edge = shape.edge(clipped.edge(i));
+    clipped.VisitEdges(shape, [&](int, const S2Shape::Edge& edge) {
       int sign = crosser.CrossingSign(edge.v0, edge.v1);
-      if (sign < 0) continue;
+      if (sign < 0) return true;
       if (sign == 0) {
         // For the OPEN and CLOSED models, check whether "p" is a vertex.
         if (options_.vertex_model() != S2VertexModel::SEMI_OPEN &&
             (edge.v0 == p || edge.v1 == p)) {
-          return (options_.vertex_model() == S2VertexModel::CLOSED);
+          inside = (options_.vertex_model() == S2VertexModel::CLOSED);
+          return false;
         }
         sign = S2::VertexCrossing(crosser.a(), crosser.b(), edge.v0, edge.v1);
       }
       inside ^= sign;
-    }
+      return true;
+    });
   }
   return inside;
 }
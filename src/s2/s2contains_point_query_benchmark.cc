@@ -0,0 +1,65 @@
+// Copyright 2024 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "s2/s2contains_point_query.h"
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+#include "s2/mutable_s2shape_index.h"
+#include "s2/s2benchmark_testing.h"
+#include "s2/s2point.h"
+
+using std::vector;
+
+namespace {
+
+constexpr int kNumQueryPoints = 10000;
+
+// Measures the time per point to test containment one point at a time.
+void BM_S2ContainsPointQueryContains(benchmark::State& state) {
+  auto index = s2benchmark::MakeFractalIndex(state.range(0));
+  const vector<S2Point> points =
+      s2benchmark::MakeQueryPoints(*index, kNumQueryPoints);
+  auto query = MakeS2ContainsPointQuery(index.get());
+  size_t i = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(query.Contains(points[i]));
+    if (++i == points.size()) i = 0;
+  }
+}
+BENCHMARK(BM_S2ContainsPointQueryContains)->Apply(s2benchmark::EdgeCounts);
+
+// Measures the time per point to test containment in batches.
+void BM_S2ContainsPointQueryBatch(benchmark::State& state) {
+  auto index = s2benchmark::MakeFractalIndex(state.range(0));
+  const vector<S2Point> points =
+      s2benchmark::MakeQueryPoints(*index, kNumQueryPoints);
+  auto query = MakeS2ContainsPointQuery(index.get());
+  for (auto _ : state) {
+    int num_contained = 0;
+    query.VisitContainingShapeIds(points, [&](int, int) {
+      ++num_contained;
+      return true;
+    });
+    benchmark::DoNotOptimize(num_contained);
+  }
+  state.SetItemsProcessed(state.iterations() * points.size());
+}
+BENCHMARK(BM_S2ContainsPointQueryBatch)->Apply(s2benchmark::EdgeCounts);
+
+}  // namespace
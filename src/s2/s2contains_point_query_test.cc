@@ -17,6 +17,7 @@
 
 #include "s2/s2contains_point_query.h"
 
+#include <algorithm>
 #include <memory>
 #include <string>
 #include <utility>
@@ -26,11 +27,14 @@
 #include <gtest/gtest.h>
 #include "absl/log/log_streamer.h"
 #include "absl/random/random.h"
+#include "absl/types/span.h"
 #include "s2/mutable_s2shape_index.h"
 #include "s2/s1angle.h"
 #include "s2/s2cap.h"
+#include "s2/s2cell_id.h"
 #include "s2/s2loop.h"
 #include "s2/s2point.h"
+#include "s2/s2query_stats.h"
 #include "s2/s2random.h"
 #include "s2/s2shape.h"
 #include "s2/s2shapeutil_shape_edge.h"
@@ -173,6 +177,88 @@ TEST(S2ContainsPointQuery, GetContainingShapes) {
   }
 }
 
+TEST(S2ContainsPointQuery, BatchMatchesSinglePoint) {
+  absl::BitGen bitgen(S2Testing::MakeTaggedSeedSeq(
+      "BATCH_MATCHES_SINGLE_POINT",
+      absl::LogInfoStreamer(__FILE__, __LINE__).stream()));
+  const S1Angle kMaxLoopRadius = S2Testing::KmToAngle(10);
+  const S2Cap center_cap(s2random::Point(bitgen), kMaxLoopRadius);
+  MutableS2ShapeIndex index;
+  vector<S2Point> points;
+  for (int i = 0; i < 100; ++i) {
+    unique_ptr<S2Loop> loop = S2Loop::MakeRegularLoop(
+        s2random::SamplePoint(bitgen, center_cap),
+        absl::Uniform(bitgen, 0.0, 1.0) * kMaxLoopRadius, 10);
+    // Include some vertices so that the vertex model matters.
+    points.push_back(loop->vertex(0));
+    index.Add(make_unique<S2Loop::OwningShape>(std::move(loop)));
+  }
+  index.Add(s2textformat::MakeLaxPolylineOrDie("0:0, 0:1, 1:1"));
+  points.push_back(MakePointOrDie("0:1"));
+  // Most points are near the loops, but some are far away so that the query
+  // must skip over empty parts of the index.
+  for (int i = 0; i < 1000; ++i) {
+    points.push_back(s2random::SamplePoint(bitgen, center_cap));
+  }
+  for (int i = 0; i < 100; ++i) points.push_back(s2random::Point(bitgen));
+
+  for (auto model : {S2VertexModel::OPEN, S2VertexModel::SEMI_OPEN,
+                     S2VertexModel::CLOSED}) {
+    auto query =
+        MakeS2ContainsPointQuery(&index, S2ContainsPointQueryOptions(model));
+    vector<vector<int>> expected;
+    for (const S2Point& p : points) {
+      expected.push_back(query.GetContainingShapeIds(p));
+    }
+    EXPECT_EQ(query.GetContainingShapeIds(points), expected);
+
+    // Also check input that is already sorted.
+    vector<S2Point> sorted = points;
+    std::sort(sorted.begin(), sorted.end(),
+              [](const S2Point& a, const S2Point& b) {
+                return S2CellId(a) < S2CellId(b);
+              });
+    vector<vector<int>> sorted_expected;
+    for (const S2Point& p : sorted) {
+      sorted_expected.push_back(query.GetContainingShapeIds(p));
+    }
+    EXPECT_EQ(query.GetContainingShapeIds(sorted), sorted_expected);
+  }
+}
+
+TEST(S2ContainsPointQuery, StatsAreCollected) {
+  auto index = MakeIndexOrDie("# 0:0, 0:1 # 0:0, 0:5, 5:5, 5:0");
+  S2QueryStats stats;
+  S2ContainsPointQueryOptions options;
+  options.set_stats(&stats);
+  auto query = MakeS2ContainsPointQuery(index.get(), options);
+  EXPECT_TRUE(query.Contains(MakePointOrDie("1:1")));
+  EXPECT_EQ(stats.cells_visited, 1);
+  EXPECT_GE(stats.clipped_shapes_scanned, 1);
+
+  // Points on a face with no index cells do not visit any cells.
+  S2QueryStats before = stats;
+  EXPECT_FALSE(query.Contains(MakePointOrDie("0:180")));
+  EXPECT_EQ(stats.cells_visited, before.cells_visited);
+
+  vector<S2Point> points = {MakePointOrDie("1:1"), MakePointOrDie("2:2"),
+                            MakePointOrDie("0:180")};
+  stats.Clear();
+  query.GetContainingShapeIds(points);
+  EXPECT_EQ(stats.cells_visited, 2);
+}
+
+TEST(S2ContainsPointQuery, BatchCanStopEarly) {
+  auto index = MakeIndexOrDie("# # 0:0, 0:2, 2:2, 2:0 | 0:0, 0:3, 3:3, 3:0");
+  auto query = MakeS2ContainsPointQuery(index.get());
+  vector<S2Point> points = {MakePointOrDie("1:1"), MakePointOrDie("1:1")};
+  int num_visited = 0;
+  EXPECT_FALSE(query.VisitContainingShapeIds(
+      points, [&num_visited](int, int) { return ++num_visited < 3; }));
+  EXPECT_EQ(num_visited, 3);
+  EXPECT_TRUE(query.GetContainingShapeIds(absl::Span<const S2Point>()).empty());
+}
+
 using EdgeIdVector = vector<ShapeEdgeId>;
 
 void ExpectIncidentEdgeIds(const EdgeIdVector& expected,
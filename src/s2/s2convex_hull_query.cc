@@ -26,10 +26,13 @@
 #include "s2/s2convex_hull_query.h"
 
 #include <algorithm>
+#include <cstdint>
 #include <memory>
 #include <vector>
 
 #include "absl/log/absl_check.h"
+#include "absl/types/span.h"
+#include "s2/internal/s2parallel.h"
 #include "s2/s2cap.h"
 #include "s2/s2edge_distances.h"
 #include "s2/s2latlng_rect.h"
@@ -112,7 +115,8 @@ class OrderedCcwAround {
   S2Point center_;
 };
 
-unique_ptr<S2Loop> S2ConvexHullQuery::GetConvexHull() {
+unique_ptr<S2Loop> S2ConvexHullQuery::GetConvexHull(int num_threads) {
+  ABSL_DCHECK_GE(num_threads, 1);
   // Test whether the bounding cap is convex.  We need this to proceed with
   // the algorithm below in order to construct a point "origin" that is
   // definitely outside the convex hull.
@@ -128,7 +132,8 @@ unique_ptr<S2Loop> S2ConvexHullQuery::GetConvexHull() {
   // belong at the end of the chain (i.e., the chain is monotone in terms of
   // the angle around O from the starting point).
   S2Point origin = cap.center().Ortho();
-  std::sort(points_.begin(), points_.end(), OrderedCcwAround(origin));
+  s2internal::ParallelSort(num_threads, points_.begin(), points_.end(),
+                           OrderedCcwAround(origin));
 
   // Remove duplicates.  We need to do this before checking whether there are
   // fewer than 3 points.
@@ -152,9 +157,9 @@ unique_ptr<S2Loop> S2ConvexHullQuery::GetConvexHull() {
   // consists of the maximal subset of vertices such that the edge chain makes
   // only left (CCW) turns.
   vector<S2Point> lower, upper;
-  GetMonotoneChain(&lower);
+  GetMonotoneChain(num_threads, &lower);
   std::reverse(points_.begin(), points_.end());
-  GetMonotoneChain(&upper);
+  GetMonotoneChain(num_threads, &upper);
 
   // Remove the duplicate vertices and combine the chains.
   ABSL_DCHECK_EQ(lower.front(), upper.back());
@@ -167,9 +172,9 @@ unique_ptr<S2Loop> S2ConvexHullQuery::GetConvexHull() {
 
 // Iterate through the given points, selecting the maximal subset of points
 // such that the edge chain makes only left (CCW) turns.
-void S2ConvexHullQuery::GetMonotoneChain(vector<S2Point>* output) {
-  ABSL_DCHECK(output->empty());
-  for (const S2Point& p : points_) {
+static void AppendMonotoneChain(absl::Span<const S2Point> points,
+                                vector<S2Point>* output) {
+  for (const S2Point& p : points) {
     // Remove any points that would cause the chain to make a clockwise turn.
     while (output->size() >= 2 &&
            s2pred::Sign(output->end()[-2], output->back(), p) <= 0) {
@@ -179,6 +184,42 @@ void S2ConvexHullQuery::GetMonotoneChain(vector<S2Point>* output) {
   }
 }
 
+// Computes the monotone chain of "points_" using up to "num_threads" threads.
+//
+// A point that is removed from the chain of any contiguous subsequence of
+// "points_" is not a vertex of the chain of the whole sequence either, since
+// the two chain vertices on either side of it are also part of the whole
+// sequence.  (Note that s2pred::Sign() never returns zero for distinct
+// points, so there are no ties.)  We therefore compute the chain of each
+// chunk independently, and then compute the chain of their concatenation.
+// Each chunk chain is usually much shorter than the chunk itself, so the
+// final pass is cheap.
+void S2ConvexHullQuery::GetMonotoneChain(int num_threads,
+                                         vector<S2Point>* output) {
+  ABSL_DCHECK(output->empty());
+  // Chunks smaller than this are not worth processing separately.
+  constexpr int kMinChunkSize = 1 << 14;
+  const int n = points_.size();
+  const int num_chunks = std::min(num_threads, n / kMinChunkSize);
+  if (num_chunks <= 1) {
+    AppendMonotoneChain(points_, output);
+    return;
+  }
+  auto chunk_begin = [n, num_chunks](int i) {
+    return static_cast<int>(static_cast<int64_t>(n) * i / num_chunks);
+  };
+  vector<vector<S2Point>> chains(num_chunks);
+  s2internal::ParallelFor(num_threads, num_chunks, [&](int i) {
+    AppendMonotoneChain(
+        absl::MakeConstSpan(points_).subspan(
+            chunk_begin(i), chunk_begin(i + 1) - chunk_begin(i)),
+        &chains[i]);
+  });
+  for (const vector<S2Point>& chain : chains) {
+    AppendMonotoneChain(chain, output);
+  }
+}
+
 unique_ptr<S2Loop> S2ConvexHullQuery::GetSinglePointLoop(const S2Point& p) {
   // Construct a 3-vertex polygon consisting of "p" and two nearby vertices.
   // Note that Contains(p) may be false for the resulting loop (see comments
@@ -94,10 +94,19 @@ class S2ConvexHullQuery {
   //
   // Note that this method does not clear the geometry; you can continue
   // adding to it and call this method again if desired.
-  std::unique_ptr<S2Loop> GetConvexHull();
+  //
+  // Up to "num_threads" threads (including the calling thread) are used.  The
+  // points are sorted in parallel, and then each thread computes the partial
+  // hull of a contiguous chunk of the sorted points.  The partial hulls are
+  // concatenated and a final pass over them yields the result, which is
+  // identical to the single-threaded result.  Small inputs are handled by the
+  // calling thread alone.
+  //
+  // REQUIRES: num_threads >= 1
+  std::unique_ptr<S2Loop> GetConvexHull(int num_threads = 1);
 
  private:
-  void GetMonotoneChain(std::vector<S2Point>* output);
+  void GetMonotoneChain(int num_threads, std::vector<S2Point>* output);
   std::unique_ptr<S2Loop> GetSinglePointLoop(const S2Point& p);
   std::unique_ptr<S2Loop> GetSingleEdgeLoop(const S2Point& a, const S2Point& b);
 
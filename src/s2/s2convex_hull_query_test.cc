@@ -244,4 +244,26 @@ TEST(S2ConvexHullQuery, PointsInsideHull) {
   }
 }
 
+TEST(S2ConvexHullQuery, MultiThreadedMatchesSingleThreaded) {
+  absl::BitGen bitgen(S2Testing::MakeTaggedSeedSeq(
+      "MULTI_THREADED_MATCHES_SINGLE_THREADED",
+      absl::LogInfoStreamer(__FILE__, __LINE__).stream()));
+
+  // Use enough points that the monotone chains are split into several chunks,
+  // and include many points on a circle so that the hull has many vertices.
+  for (int iter = 0; iter < 5; ++iter) {
+    S2Cap cap = s2random::Cap(bitgen, 1e-10, 1.999 * M_PI);
+    S2ConvexHullQuery query;
+    for (int i = 0; i < 60000; ++i) {
+      query.AddPoint(s2random::SamplePoint(bitgen, cap));
+    }
+    vector<S2Point> circle =
+        S2Testing::MakeRegularPoints(cap.center(), cap.GetRadius(), 20000);
+    for (const S2Point& p : circle) query.AddPoint(p);
+    unique_ptr<S2Loop> expected = query.GetConvexHull();
+    unique_ptr<S2Loop> actual = query.GetConvexHull(4);
+    EXPECT_TRUE(actual->BoundaryEquals(*expected)) << "Iteration: " << iter;
+  }
+}
+
 }  // namespace
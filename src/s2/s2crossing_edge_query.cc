@@ -18,13 +18,16 @@
 #include "s2/s2crossing_edge_query.h"
 
 #include <algorithm>
+#include <cstddef>
 #include <vector>
 
 #include "absl/log/absl_check.h"
+#include "absl/types/span.h"
 #include "s2/r1interval.h"
 #include "s2/r2.h"
 #include "s2/r2rect.h"
 #include "s2/s2cell_id.h"
+#include "s2/s2coords.h"
 #include "s2/s2edge_clipping.h"
 #include "s2/s2edge_crosser.h"
 #include "s2/s2padded_cell.h"
@@ -72,21 +75,17 @@ void S2CrossingEdgeQuery::GetCrossingEdges(
     vector<ShapeEdge>* edges) {
   edges->clear();
   GetCandidates(a0, a1, &tmp_candidates_);
-  int min_sign = (type == CrossingType::ALL) ? 0 : 1;
-  S2CopyingEdgeCrosser crosser(a0, a1);
   int shape_id = -1;
   const S2Shape* shape = nullptr;
+  tmp_edges_.clear();
   for (ShapeEdgeId candidate : tmp_candidates_) {
     if (candidate.shape_id != shape_id) {
       shape_id = candidate.shape_id;
       shape = index_->shape(shape_id);
     }
-    int edge_id = candidate.edge_id;
-    S2Shape::Edge b = shape->edge(edge_id);
-    if (crosser.CrossingSign(b.v0, b.v1) >= min_sign) {
-      edges->push_back(ShapeEdge(shape_id, edge_id, b));
-    }
+    tmp_edges_.push_back(shape->edge(candidate.edge_id));
   }
+  AppendCrossingEdges(a0, a1, type, edges);
 }
 
 void S2CrossingEdgeQuery::GetCrossingEdges(const S2Point& a0, const S2Point& a1,
@@ -95,17 +94,102 @@ void S2CrossingEdgeQuery::GetCrossingEdges(const S2Point& a0, const S2Point& a1,
                                            vector<ShapeEdge>* edges) {
   edges->clear();
   GetCandidates(a0, a1, shape_id, shape, &tmp_candidates_);
+  tmp_edges_.clear();
+  for (ShapeEdgeId candidate : tmp_candidates_) {
+    tmp_edges_.push_back(shape.edge(candidate.edge_id));
+  }
+  AppendCrossingEdges(a0, a1, type, edges);
+}
+
+// Given that tmp_edges_[i] is the edge identified by tmp_candidates_[i],
+// appends the candidates that cross edge A0A1 to "edges".  All candidates are
+// tested at once, since this lets most of them be rejected by a fast first
+// pass (see S2EdgeCrosserBase::CrossingSigns).
+void S2CrossingEdgeQuery::AppendCrossingEdges(const S2Point& a0,
+                                              const S2Point& a1,
+                                              CrossingType type,
+                                              vector<ShapeEdge>* edges) {
   int min_sign = (type == CrossingType::ALL) ? 0 : 1;
+  tmp_signs_.resize(tmp_edges_.size());
   S2CopyingEdgeCrosser crosser(a0, a1);
-  for (ShapeEdgeId candidate : tmp_candidates_) {
-    int edge_id = candidate.edge_id;
-    S2Shape::Edge b = shape.edge(edge_id);
-    if (crosser.CrossingSign(b.v0, b.v1) >= min_sign) {
-      edges->push_back(ShapeEdge(shape_id, edge_id, b));
+  crosser.CrossingSigns(absl::MakeConstSpan(tmp_edges_),
+                        absl::MakeSpan(tmp_signs_));
+  for (size_t i = 0; i < tmp_candidates_.size(); ++i) {
+    if (tmp_signs_[i] >= min_sign) {
+      const ShapeEdgeId& candidate = tmp_candidates_[i];
+      edges->push_back(
+          ShapeEdge(candidate.shape_id, candidate.edge_id, tmp_edges_[i]));
     }
   }
 }
 
+void S2CrossingEdgeQuery::GetChainCrossingEdges(
+    absl::Span<const S2Point> vertices, CrossingType type,
+    vector<vector<ShapeEdge>>* edges) {
+  const int num_chain_edges = std::max<int>(0, vertices.size() - 1);
+  edges->resize(num_chain_edges);
+  int num_edges = s2shapeutil::CountEdgesUpTo(*index_, kMaxBruteForceEdges + 1);
+  if (num_edges <= kMaxBruteForceEdges) {
+    // Every edge of the index is a candidate anyway.
+    for (int i = 0; i < num_chain_edges; ++i) {
+      GetCrossingEdges(vertices[i], vertices[i + 1], type, &(*edges)[i]);
+    }
+    return;
+  }
+  // The index cell containing the end vertex of the previous edge, if any.
+  // Its edges are stored in tmp_candidates_ and tmp_edges_.
+  S2CellId cell_id = S2CellId::None();
+  R2Rect cell_bound;
+  for (int i = 0; i < num_chain_edges; ++i) {
+    const S2Point& a0 = vertices[i];
+    const S2Point& a1 = vertices[i + 1];
+    vector<ShapeEdge>* result = &(*edges)[i];
+    result->clear();
+
+    // If both endpoints project into the cached cell, then so does the edge
+    // (since geodesics are straight lines in the face's (u,v) coordinates),
+    // and every index edge that it crosses must intersect that cell.  The
+    // (u,v) coordinates are slightly inexact, but index cells are padded by
+    // more than this error when their edges are chosen.
+    R2Point uv0, uv1;
+    if (cell_id.is_valid() && S2::FaceXYZtoUV(cell_id.face(), a0, &uv0) &&
+        S2::FaceXYZtoUV(cell_id.face(), a1, &uv1) &&
+        cell_bound.Contains(uv0) && cell_bound.Contains(uv1)) {
+      AppendCrossingEdges(a0, a1, type, result);
+      continue;
+    }
+    GetCrossingEdges(a0, a1, type, result);
+
+    // Remember the index cell containing "a1", since it most likely also
+    // contains the next edge.
+    if (iter_.Locate(a1)) {
+      cell_id = iter_.id();
+      cell_bound = cell_id.GetBoundUV();
+      SetCellCandidates(iter_.cell());
+    } else {
+      cell_id = S2CellId::None();
+    }
+  }
+}
+
+// Sets tmp_candidates_ and tmp_edges_ to all edges of the given index cell.
+// (The candidates are already sorted and unique, since clipped shapes are
+// sorted by shape id and their edges are sorted by edge id.)
+void S2CrossingEdgeQuery::SetCellCandidates(const S2ShapeIndexCell& cell) {
+  tmp_candidates_.clear();
+  tmp_edges_.clear();
+  for (int s = 0; s < cell.num_clipped(); ++s) {
+    const S2ClippedShape& clipped = cell.clipped(s);
+    const int shape_id = clipped.shape_id();
+    const S2Shape& shape = *index_->shape(shape_id);
+    clipped.VisitEdges(shape, [&](int edge_id, const S2Shape::Edge& edge) {
+      tmp_candidates_.push_back(ShapeEdgeId(shape_id, edge_id));
+      tmp_edges_.push_back(edge);
+      return true;
+    });
+  }
+}
+
 vector<ShapeEdgeId> S2CrossingEdgeQuery::GetCandidates(
     const S2Point& a0, const S2Point& a1) {
   vector<ShapeEdgeId> edges;
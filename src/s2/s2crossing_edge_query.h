@@ -26,6 +26,7 @@
 #include "absl/base/macros.h"
 #include "absl/container/inlined_vector.h"
 #include "absl/log/absl_check.h"
+#include "absl/types/span.h"
 #include "s2/_fp_contract_off.h"  // IWYU pragma: keep
 #include "s2/r2.h"
 #include "s2/r2rect.h"
@@ -111,6 +112,21 @@ class S2CrossingEdgeQuery {
                         const S2Shape& shape, CrossingType type,
                         std::vector<s2shapeutil::ShapeEdge>* edges);
 
+  // Returns the edges crossed by each edge of the vertex chain "vertices",
+  // i.e. (*edges)[i] is set to GetCrossingEdges(vertices[i], vertices[i+1],
+  // type).  The result has max(0, vertices.size() - 1) elements, and their
+  // memory is reused across calls.
+  //
+  // This is much faster than querying each edge separately when the chain
+  // has many short edges (e.g. a GPS trace).  The query remembers the index
+  // cell that contains the end vertex of the previous edge, and when the next
+  // edge lies entirely within that cell its candidates are simply the edges
+  // of that cell.  This avoids descending from the edge root cell, and the
+  // candidate edges are not fetched again from their shapes.
+  void GetChainCrossingEdges(
+      absl::Span<const S2Point> vertices, CrossingType type,
+      std::vector<std::vector<s2shapeutil::ShapeEdge>>* edges);
+
   /////////////////////////// Low-Level Methods ////////////////////////////
   //
   // Most clients will not need the following methods.  They can be slightly
@@ -195,6 +211,10 @@ class S2CrossingEdgeQuery {
 
  private:
   // Internal methods are documented with their definitions.
+  void AppendCrossingEdges(const S2Point& a0, const S2Point& a1,
+                           CrossingType type,
+                           std::vector<s2shapeutil::ShapeEdge>* edges);
+  void SetCellCandidates(const S2ShapeIndexCell& cell);
   bool VisitCells(const S2PaddedCell& pcell, const R2Rect& edge_bound);
   bool ClipVAxis(const R2Rect& edge_bound, double center, int i,
                  const S2PaddedCell& pcell);
@@ -215,6 +235,8 @@ class S2CrossingEdgeQuery {
 
   // Avoids repeated allocation when methods are called many times.
   std::vector<s2shapeutil::ShapeEdgeId> tmp_candidates_;
+  std::vector<S2Shape::Edge> tmp_edges_;
+  std::vector<int> tmp_signs_;
 };
 
 
@@ -419,6 +419,71 @@ TEST(VisitCells, QueryEdgeOnFaceBoundary) {
   }
 }
 
+// Checks that GetChainCrossingEdges() returns the same edges as calling
+// GetCrossingEdges() for each edge of the chain.
+void TestChainCrossings(const S2ShapeIndex& index,
+                        absl::Span<const S2Point> vertices) {
+  S2CrossingEdgeQuery query(&index);
+  for (auto type : {CrossingType::ALL, CrossingType::INTERIOR}) {
+    vector<vector<ShapeEdge>> actual;
+    query.GetChainCrossingEdges(vertices, type, &actual);
+    ASSERT_EQ(actual.size(), std::max<int>(0, vertices.size() - 1));
+    for (size_t i = 0; i + 1 < vertices.size(); ++i) {
+      vector<ShapeEdgeId> actual_ids, expected_ids;
+      for (const auto& edge : actual[i]) actual_ids.push_back(edge.id());
+      for (const auto& edge :
+           query.GetCrossingEdges(vertices[i], vertices[i + 1], type)) {
+        expected_ids.push_back(edge.id());
+      }
+      EXPECT_EQ(actual_ids, expected_ids) << "Chain edge " << i;
+    }
+  }
+}
+
+TEST(GetChainCrossingEdges, RandomWalkAcrossPolylines) {
+  absl::BitGen bitgen(S2Testing::MakeTaggedSeedSeq(
+      "RANDOM_WALK_ACROSS_POLYLINES",
+      absl::LogInfoStreamer(__FILE__, __LINE__).stream()));
+  // Index many random polylines within a small cap, so that the index has
+  // many cells and the walk below crosses many of them.
+  S2Cap cap(s2random::Point(bitgen), S1Angle::Degrees(1));
+  MutableS2ShapeIndex index;
+  for (int i = 0; i < 50; ++i) {
+    vector<S2Point> vertices;
+    for (int j = 0; j < 20; ++j) {
+      vertices.push_back(s2random::SamplePoint(bitgen, cap));
+    }
+    index.Add(make_unique<S2Polyline::OwningShape>(
+        make_unique<S2Polyline>(vertices)));
+  }
+
+  // A random walk with short steps, similar to a GPS trace.  Most steps stay
+  // within the same index cell, but some cross cell boundaries.
+  vector<S2Point> walk = {cap.center()};
+  for (int i = 0; i < 2000; ++i) {
+    S2Cap step(walk.back(), S1Angle::Degrees(0.005));
+    walk.push_back(s2random::SamplePoint(bitgen, step));
+  }
+  TestChainCrossings(index, walk);
+
+  // A chain whose edges jump across the whole cap.
+  vector<S2Point> jumps;
+  for (int i = 0; i < 200; ++i) {
+    jumps.push_back(s2random::SamplePoint(bitgen, cap));
+  }
+  TestChainCrossings(index, jumps);
+}
+
+TEST(GetChainCrossingEdges, SmallIndexAndShortChains) {
+  MutableS2ShapeIndex index;
+  index.Add(make_unique<S2Polyline::OwningShape>(
+      MakePolylineOrDie("0:0, 2:1, 0:2, 2:3, 0:4, 2:5, 0:6")));
+  TestChainCrossings(index, {});
+  TestChainCrossings(index, {MakePointOrDie("1:0")});
+  TestChainCrossings(index, {MakePointOrDie("1:0"), MakePointOrDie("1:4"),
+                             MakePointOrDie("3:4"), MakePointOrDie("1:6")});
+}
+
 TEST(S2CrossingEdgeQuery, Index) {
   // Just give this some test coverage so it's not marked as dead code.
   MutableS2ShapeIndex index;
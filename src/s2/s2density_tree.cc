@@ -22,6 +22,7 @@
 #include <functional>
 #include <iterator>
 #include <limits>
+#include <memory>
 #include <optional>
 #include <string>
 #include <type_traits>
@@ -37,8 +38,11 @@
 #include "absl/numeric/int128.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/string_view.h"
+#include "absl/types/span.h"
 #include "s2/util/coding/coder.h"
 #include "s2/util/coding/varint.h"
+#include "s2/internal/s2parallel.h"
+#include "s2/mutable_s2shape_index.h"
 #include "s2/s2cell.h"
 #include "s2/s2cell_id.h"
 #include "s2/s2cell_union.h"
@@ -47,6 +51,7 @@
 #include "s2/s2shape.h"
 #include "s2/s2shape_index.h"
 #include "s2/s2shape_index_region.h"
+#include "s2/s2wrapped_shape.h"
 #include "s2/util/math/mathutil.h"
 
 using absl::btree_map;
@@ -196,24 +201,32 @@ class Node {
 bool S2DensityTree::InitToShapeDensity(const S2ShapeIndex& index,
                                        const ShapeWeightFunction& weight_fn,
                                        int64_t approximate_size_bytes,
-                                       int max_level, S2Error* error) {
+                                       int max_level, S2Error* error,
+                                       int num_threads) {
   ABSL_DCHECK(error != nullptr) << "error must be non-nullptr";
   *error = S2Error::Ok();
 
-  IndexCellWeightFunction index_cell_weight_fn(&index, weight_fn);
+  // Each thread needs its own S2ShapeIndexRegion.
+  vector<std::unique_ptr<IndexCellWeightFunction>> measures;
+  vector<BreadthFirstTreeBuilder::CellWeightFunction> weight_fns;
+  for (int i = 0; i < std::max(1, num_threads); ++i) {
+    auto& measure = measures.emplace_back(
+        std::make_unique<IndexCellWeightFunction>(&index, weight_fn));
+    weight_fns.push_back(
+        [measure = measure.get()](const S2CellId cell_id, S2Error* error) {
+          return measure->WeighCell(cell_id, error);
+        });
+  }
 
   TreeEncoder encoder;
   BreadthFirstTreeBuilder builder(approximate_size_bytes, max_level, encoder);
-  return builder.Build(
-      [&](const S2CellId cell_id, S2Error* error) {
-        return index_cell_weight_fn.WeighCell(cell_id, error);
-      },
-      this, error);
+  return builder.Build(weight_fns, this, error);
 }
 
 bool S2DensityTree::InitToVertexDensity(const S2ShapeIndex& index,
                                         int64_t approximate_size_bytes,
-                                        int max_level, S2Error* error) {
+                                        int max_level, S2Error* error,
+                                        int num_threads) {
   return InitToShapeDensity(
       index,
       [&](const S2Shape& shape) {
@@ -229,66 +242,171 @@ bool S2DensityTree::InitToVertexDensity(const S2ShapeIndex& index,
                          << " dimensions";
         return 0;
       },
-      approximate_size_bytes, max_level, error);
+      approximate_size_bytes, max_level, error, num_threads);
 }
 
 bool S2DensityTree::InitToSumDensity(vector<const S2DensityTree*>& trees,
                                      int64_t approximate_size_bytes,
-                                     int max_level, S2Error* error) {
+                                     int max_level, S2Error* error,
+                                     int num_threads) {
   ABSL_DCHECK(error != nullptr) << "error must be non-nullptr";
   *error = S2Error::Ok();
 
-  vector<DecodedPath> cell_paths;
-  cell_paths.reserve(trees.size());
-  for (const auto* tree : trees) {
-    cell_paths.emplace_back(tree);
+  // Each thread needs its own DecodedPath for every tree.
+  vector<vector<DecodedPath>> thread_cell_paths(std::max(1, num_threads));
+  vector<BreadthFirstTreeBuilder::CellWeightFunction> weight_fns;
+  for (vector<DecodedPath>& cell_paths : thread_cell_paths) {
+    cell_paths.reserve(trees.size());
+    for (const auto* tree : trees) {
+      cell_paths.emplace_back(tree);
+    }
+    weight_fns.push_back([&cell_paths](S2CellId cell_id,
+                                       S2Error* error) -> int64_t {
+      int64_t sum = 0;
+      bool contained = true;
+
+      for (auto& cell_path : cell_paths) {
+        const Cell* cell = cell_path.GetCell(cell_id, error);
+        if (!error->ok()) {
+          return 0;
+        }
+
+        sum += cell->weight();
+        contained &= !cell->has_children();
+
+        sum = std::min(sum, kMaxWeight);
+      }
+
+      return contained ? -sum : sum;
+    });
   }
 
   TreeEncoder encoder;
   BreadthFirstTreeBuilder builder(approximate_size_bytes, max_level, encoder);
-  return builder.Build(
-      [&](S2CellId cell_id, S2Error* error) -> int64_t {
-        int64_t sum = 0;
-        bool contained = true;
-
-        for (auto& cell_path : cell_paths) {
-          const Cell* cell = cell_path.GetCell(cell_id, error);
-          if (!error->ok()) {
-            return 0;
-          }
+  return builder.Build(weight_fns, this, error);
+}
+
+bool S2DensityTree::InitToSumDensity(vector<const S2DensityTree*>& trees,
+                                     int max_level, S2Error* error,
+                                     int num_threads) {
+  ABSL_DCHECK(error != nullptr) << "error must be non-nullptr";
+  *error = S2Error::Ok();
 
-          sum += cell->weight();
-          contained &= !cell->has_children();
+  // Each thread sums the trees it is given into its own encoder.  If any
+  // tree fails to decode, the error from the first such tree is returned.
+  const int num_trees = trees.size();
+  const int num_encoders =
+      s2internal::NumChunkWorkers(num_threads, num_trees, 1);
+  vector<TreeEncoder> encoders(num_encoders);
+  vector<S2Error> errors(num_trees);
+  const int first_error = s2internal::ParallelForChunks(
+      num_threads, num_trees, 1, [&](int e, int i, int) {
+        trees[i]->VisitCells(
+            [&](S2CellId cell_id, const Cell& cell) {
+              if (cell_id.level() > max_level) {
+                return VisitAction::SKIP_CELL;
+              }
+
+              encoders[e].Put(cell_id, cell.weight());
+              return VisitAction::ENTER_CELL;
+            },
+            &errors[i]);
+        return errors[i].ok();
+      });
+  if (first_error < num_trees) {
+    *error = errors[first_error];
+    return false;
+  }
 
-          sum = std::min(sum, kMaxWeight);
-        }
+  // Merge the partial sums pairwise.
+  for (int width = 1; width < num_encoders; width *= 2) {
+    s2internal::ParallelFor(
+        num_threads, (num_encoders + 2 * width - 1) / (2 * width), [&](int j) {
+          const int e = 2 * j * width;
+          if (e + width < num_encoders) {
+            encoders[e].Merge(encoders[e + width]);
+            encoders[e + width].Clear();
+          }
+        });
+  }
 
-        return contained ? -sum : sum;
-      },
-      this, error);
+  encoders[0].Build(this);
+  return true;
 }
 
-bool S2DensityTree::InitToSumDensity(vector<const S2DensityTree*>& trees,
-                                     int max_level, S2Error* error) {
+bool S2DensityTree::InitToUpdatedDensity(
+    const S2DensityTree& tree, absl::Span<const ShapeWeightDelta> deltas,
+    S2Error* error) {
   ABSL_DCHECK(error != nullptr) << "error must be non-nullptr";
   *error = S2Error::Ok();
 
-  TreeEncoder encoder;
+  const btree_map<S2CellId, int64_t> weights = tree.Decode(error);
+  if (!error->ok()) {
+    return false;
+  }
 
-  for (const auto* tree : trees) {
-    tree->VisitCells(
-        [&](S2CellId cell_id, const Cell& cell) {
-          if (cell_id.level() > max_level) {
-            return VisitAction::SKIP_CELL;
-          }
+  // Index the changed shapes so that the cells they intersect can be found
+  // with the same semantics as InitToShapeDensity.
+  MutableS2ShapeIndex index;
+  absl::flat_hash_map<const S2Shape*, int64_t> shape_weights;
+  for (const ShapeWeightDelta& delta : deltas) {
+    auto shape = std::make_unique<S2WrappedShape>(delta.shape);
+    shape_weights[shape.get()] = delta.weight;
+    index.Add(std::move(shape));
+  }
+  S2ShapeIndexRegion<MutableS2ShapeIndex> region(&index);
 
-          encoder.Put(cell_id, cell.weight());
-          return VisitAction::ENTER_CELL;
-        },
-        error);
+  // Visit the cells of the tree from the top down, starting with the faces.
+  // Only cells that intersect a changed shape are revisited.
+  TreeEncoder encoder;
+  vector<S2CellId> stack;
+  for (int face = S2CellId::kNumFaces - 1; face >= 0; --face) {
+    stack.push_back(S2CellId::FromFace(face));
+  }
+  while (!stack.empty()) {
+    const S2CellId cell_id = stack.back();
+    stack.pop_back();
+    const auto iter = weights.find(cell_id);
+    const bool in_tree = iter != weights.end();
+
+    bool intersects = false;
+    int64_t weight = in_tree ? iter->second : 0;
+    region.VisitIntersectingShapes(
+        S2Cell(cell_id), [&](const S2Shape* shape, bool) {
+          intersects = true;
+          weight += shape_weights.at(shape);
+          return true;
+        });
+    if (!intersects) {
+      // Copy the subtree unchanged.
+      if (in_tree) {
+        for (auto it = weights.lower_bound(cell_id.range_min());
+             it != weights.end() && it->first <= cell_id.range_max(); ++it) {
+          encoder.Put(it->first, it->second);
+        }
+      }
+      continue;
+    }
 
-    if (!error->ok()) {
-      return false;
+    // Drop cells that no longer have any weight, along with their subtrees.
+    weight = std::min(weight, kMaxWeight);
+    if (weight <= 0) {
+      continue;
+    }
+    encoder.Put(cell_id, weight);
+
+    // Visit the children of face cells and of cells that have children in
+    // the tree.  Children that are not in the tree become new leaf cells.
+    bool has_children = cell_id.is_face();
+    if (in_tree && !cell_id.is_leaf()) {
+      for (int i = 0; i < 4; ++i) {
+        has_children |= weights.contains(cell_id.child(i));
+      }
+    }
+    if (in_tree && has_children) {
+      for (int i = 3; i >= 0; --i) {
+        stack.push_back(cell_id.child(i));
+      }
     }
   }
 
@@ -409,6 +527,42 @@ int64_t S2DensityTree::GetNormalCellWeight(const S2CellId cell_id,
 
 vector<S2CellUnion> S2DensityTree::GetPartitioning(int64_t max_weight,
                                                    S2Error* error) const {
+  PartitionCells cells(*this, max_weight, error);
+  if (!error->ok()) {
+    return {};
+  }
+  return cells.GetPartitioning(max_weight);
+}
+
+vector<S2CellUnion> S2DensityTree::GetBalancedPartitioning(
+    int num_partitions, S2Error* error) const {
+  ABSL_DCHECK(error != nullptr) << "error must be non-nullptr";
+  ABSL_DCHECK_GT(num_partitions, 0);
+  *error = S2Error::Ok();
+
+  // The total weight is the sum of the weights of the face cells.
+  int64_t total_weight = 0;
+  VisitCells(
+      [&](const S2CellId cell_id, const S2DensityTree::Cell& cell) {
+        total_weight += cell.weight();
+        return VisitAction::SKIP_CELL;
+      },
+      error);
+  if (!error->ok()) {
+    return {};
+  }
+
+  PartitionCells cells(
+      *this, std::max<int64_t>(1, total_weight / num_partitions), error);
+  if (!error->ok()) {
+    return {};
+  }
+  return cells.GetBalancedPartitioning(num_partitions);
+}
+
+S2DensityTree::PartitionCells::PartitionCells(const S2DensityTree& tree,
+                                              int64_t max_weight,
+                                              S2Error* error) {
   ABSL_DCHECK(error != nullptr) << "error must be non-nullptr";
   *error = S2Error::Ok();
 
@@ -417,13 +571,13 @@ vector<S2CellUnion> S2DensityTree::GetPartitioning(int64_t max_weight,
   // max_weight.
   const int64_t target_weight = max_weight / 16;
 
-  DecodedPath decoder(this);
+  DecodedPath decoder(&tree);
   btree_set<Node> candidates;
 
   // Collect an initial set of cells which are either less than target_weight,
   // or single cells with no children (which may be greater than
   // target_weight).
-  VisitCells(
+  tree.VisitCells(
       [&](const S2CellId cell_id, const S2DensityTree::Cell& cell) {
         if (!error->ok()) {
           return VisitAction::STOP;
@@ -438,7 +592,7 @@ vector<S2CellUnion> S2DensityTree::GetPartitioning(int64_t max_weight,
       },
       error);
   if (!error->ok()) {
-    return {};
+    return;
   }
 
   // Revise the initial set of candidates by looking for optimizations.
@@ -481,27 +635,68 @@ vector<S2CellUnion> S2DensityTree::GetPartitioning(int64_t max_weight,
     }
   }
 
-  vector<S2CellUnion> partitioning;
-  vector<S2CellId> cover;
-
-  int64_t current_weight = 0;
+  cell_ids_.reserve(nodes.size());
+  prefix_weights_.reserve(nodes.size() + 1);
   for (const Node& node : nodes) {
-    const int64_t normal_weight = node.GetNormalCellWeight();
+    cell_ids_.push_back(node.cell_id());
+    prefix_weights_.push_back(prefix_weights_.back() +
+                              node.GetNormalCellWeight());
+  }
+}
 
-    if (!cover.empty() && current_weight + normal_weight >= max_weight) {
-      partitioning.push_back(S2CellUnion::FromVerbatim(std::move(cover)));
-      cover.clear();
-      current_weight = 0;
-    }
+S2CellUnion S2DensityTree::PartitionCells::MakeUnion(int begin,
+                                                     int end) const {
+  return S2CellUnion::FromVerbatim(
+      vector<S2CellId>(cell_ids_.begin() + begin, cell_ids_.begin() + end));
+}
 
-    cover.push_back(node.cell_id());
-    current_weight += normal_weight;
+vector<S2CellUnion> S2DensityTree::PartitionCells::GetPartitioning(
+    int64_t max_weight) const {
+  // A partition starting at cell "begin" is closed just before the first
+  // later cell "i" that would bring its weight to at least 'max_weight',
+  // i.e. the first "i > begin" such that prefix_weights_[i + 1] >=
+  // prefix_weights_[begin] + max_weight.  Since the prefix sums are
+  // non-decreasing this is found by binary search.
+  vector<S2CellUnion> partitioning;
+  for (int begin = 0; begin < num_cells();) {
+    int end = num_cells();
+    if (max_weight <= total_weight() - prefix_weights_[begin]) {
+      end = std::lower_bound(prefix_weights_.begin() + begin + 2,
+                             prefix_weights_.end(),
+                             prefix_weights_[begin] + max_weight) -
+            prefix_weights_.begin() - 1;
+    }
+    partitioning.push_back(MakeUnion(begin, end));
+    begin = end;
   }
+  return partitioning;
+}
 
-  if (!cover.empty()) {
-    partitioning.push_back(S2CellUnion::FromVerbatim(std::move(cover)));
+vector<S2CellUnion> S2DensityTree::PartitionCells::GetBalancedPartitioning(
+    int num_partitions) const {
+  ABSL_DCHECK_GT(num_partitions, 0);
+  const int n = std::min(num_partitions, num_cells());
+  vector<S2CellUnion> partitioning;
+  partitioning.reserve(n);
+  for (int k = 0, begin = 0; k < n; ++k) {
+    // Partition "k" ends at the cell boundary closest to the ideal cumulative
+    // weight, leaving at least one cell for each of the later partitions.
+    int end = num_cells();
+    if (k + 1 < n) {
+      const int64_t target = static_cast<int64_t>(
+          absl::int128(total_weight()) * (k + 1) / n);
+      end = std::lower_bound(prefix_weights_.begin(), prefix_weights_.end(),
+                             target) -
+            prefix_weights_.begin();
+      if (end > 0 &&
+          target - prefix_weights_[end - 1] < prefix_weights_[end] - target) {
+        --end;
+      }
+      end = std::clamp(end, begin + 1, num_cells() - (n - k - 1));
+    }
+    partitioning.push_back(MakeUnion(begin, end));
+    begin = end;
   }
-
   return partitioning;
 }
 
@@ -561,58 +756,117 @@ int64_t S2DensityTree::IndexCellWeightFunction::WeighCell(
 
 // BreadthFirstTreeBuilder ///////////////////////////////////
 
+namespace {
+
+using CellWeightFunction =
+    S2DensityTree::BreadthFirstTreeBuilder::CellWeightFunction;
+
+// Sets "weights" to the weight of each cell, using one thread per weight
+// function.  Returns false if any cell could not be weighed, in which case
+// "error" is set to the error for the first such cell.
+bool WeighCells(absl::Span<const CellWeightFunction> weight_fns,
+                absl::Span<const S2CellId> cells, vector<int64_t>* weights,
+                S2Error* error) {
+  const int num_cells = cells.size();
+  weights->resize(num_cells);
+  if (weight_fns.size() == 1) {
+    for (int i = 0; i < num_cells; ++i) {
+      (*weights)[i] = weight_fns[0](cells[i], error);
+      if (!error->ok()) return false;
+    }
+    return true;
+  }
+
+  // The error returned is the same as for a single thread, because every cell
+  // before the first failure is weighed.
+  const int num_workers = weight_fns.size();
+  vector<S2Error> errors(num_workers);
+  vector<int> error_cells(num_workers, num_cells);
+  const int first_error = s2internal::ParallelForChunks(
+      num_workers, num_cells, 1, [&](int worker, int i, int) {
+        (*weights)[i] = weight_fns[worker](cells[i], &errors[worker]);
+        if (errors[worker].ok()) return true;
+        error_cells[worker] = i;
+        return false;
+      });
+  if (first_error == num_cells) return true;
+  for (int worker = 0; worker < num_workers; ++worker) {
+    if (error_cells[worker] == first_error) {
+      *error = errors[worker];
+      break;
+    }
+  }
+  return false;
+}
+
+}  // namespace
+
 bool S2DensityTree::BreadthFirstTreeBuilder::Build(
     const CellWeightFunction& weight_fn, S2DensityTree* tree,
     S2Error* error) const {
+  return Build(absl::MakeConstSpan(&weight_fn, 1), tree, error);
+}
+
+bool S2DensityTree::BreadthFirstTreeBuilder::Build(
+    absl::Span<const CellWeightFunction> weight_fns, S2DensityTree* tree,
+    S2Error* error) const {
+  ABSL_DCHECK(!weight_fns.empty());
   vector<std::pair<S2CellId, S2CellId>> ranges{{
       S2CellId::Begin(S2CellId::kMaxLevel),
       S2CellId::End(S2CellId::kMaxLevel),
   }};
   vector<std::pair<S2CellId, S2CellId>> next_level_ranges;
+  vector<S2CellId> cells;
+  vector<int64_t> weights;
 
   for (int level = 0, size_estimate_bytes = 0;
        !ranges.empty() && level <= max_level_ &&
        size_estimate_bytes < approximate_size_bytes_;
        ++level) {
-    S2CellId last_range_end = S2CellId::Sentinel();
-
+    // Weigh every cell at this level within the ranges.
+    cells.clear();
     for (auto& range : ranges) {
       for (S2CellId cell_id = range.first.parent(level); cell_id < range.second;
            cell_id = cell_id.next()) {
-        // Get the weight and skip this cell_id unless it's larger than 0.
-        int64_t weight = weight_fn(cell_id, error);
-        if (!error->ok()) {
-          return false;
-        }
+        cells.push_back(cell_id);
+      }
+    }
+    if (!WeighCells(weight_fns, cells, &weights, error)) {
+      return false;
+    }
 
-        if (weight == 0) {
-          // Skip disjoint cells.
-          continue;
-        } else if (weight < 0) {
-          // Get the absolute weight and skip searching the children.
-          weight = -weight;
+    S2CellId last_range_end = S2CellId::Sentinel();
+    for (size_t i = 0; i < cells.size(); ++i) {
+      const S2CellId cell_id = cells[i];
+      // Skip this cell_id unless its weight is larger than 0.
+      int64_t weight = weights[i];
+      if (weight == 0) {
+        // Skip disjoint cells.
+        continue;
+      } else if (weight < 0) {
+        // Get the absolute weight and skip searching the children.
+        weight = -weight;
+      } else {
+        // Add this hilbert range to the ranges to scan at the next level.
+        const S2CellId begin = cell_id.range_min();
+        const S2CellId end = cell_id.range_max().next();
+        if (begin == last_range_end) {
+          // Extend the existing range.
+          next_level_ranges.back().second = end;
         } else {
-          // Add this hilbert range to the ranges to scan at the next level.
-          const S2CellId begin = cell_id.range_min();
-          const S2CellId end = cell_id.range_max().next();
-          if (begin == last_range_end) {
-            // Extend the existing range.
-            next_level_ranges.back().second = end;
-          } else {
-            // Add a new range.
-            next_level_ranges.push_back({begin, end});
-          }
-          last_range_end = end;
+          // Add a new range.
+          next_level_ranges.push_back({begin, end});
         }
-
-        // Save the weight for repacking later and estimate the size it will
-        // consume.
-        ABSL_DCHECK_LE(weight, kMaxWeight)
-            << "CellIdWeightFn produced weight greater than kMaxWeight: "
-            << weight;
-        encoder_.Put(cell_id, std::min(weight, kMaxWeight));
-        size_estimate_bytes += TreeEncoder::EstimateSize(weight);
+        last_range_end = end;
       }
+
+      // Save the weight for repacking later and estimate the size it will
+      // consume.
+      ABSL_DCHECK_LE(weight, kMaxWeight)
+          << "CellIdWeightFn produced weight greater than kMaxWeight: "
+          << weight;
+      encoder_.Put(cell_id, std::min(weight, kMaxWeight));
+      size_estimate_bytes += TreeEncoder::EstimateSize(weight);
     }
 
     ranges = std::move(next_level_ranges);
@@ -718,6 +972,12 @@ void S2DensityTree::TreeEncoder::Put(const S2CellId cell_id, int64_t weight) {
   weights_[cell_id] += weight;
 }
 
+void S2DensityTree::TreeEncoder::Merge(const TreeEncoder& other) {
+  for (const auto& [cell_id, weight] : other.weights_) {
+    weights_[cell_id] += weight;
+  }
+}
+
 void S2DensityTree::TreeEncoder::Build(S2DensityTree* tree) {
   ReversibleBytes output;
   EncodeTreeReversed(&output);
@@ -853,7 +1113,7 @@ const S2DensityTree::Cell* S2DensityTree::DecodedPath::GetCell(
   // If the new cell is on a different face, load the new face and reset the
   // cell stack before proceeding.
   if (last_.face() != cell_id.face()) {
-    last_ = cell_id.parent(0);
+    last_ = cell_id.parent<0>();
     LoadFace(cell_id.face(), error);
     if (!error->ok()) {
       return nullptr;
@@ -22,6 +22,7 @@
 #include <cstdint>
 #include <functional>
 #include <limits>
+#include <memory>
 #include <string>
 #include <utility>
 #include <vector>
@@ -30,6 +31,7 @@
 #include "absl/container/btree_map.h"
 #include "absl/container/flat_hash_set.h"
 #include "absl/log/absl_check.h"
+#include "absl/types/span.h"
 #include "s2/util/coding/coder.h"
 #include "s2/s2cell_id.h"
 #include "s2/s2cell_union.h"
@@ -75,6 +77,12 @@
 // Initializers such as InitToShapeDensity accept approximate byte size and cell
 // level limits.
 //
+// The initializers also accept an optional number of threads.  When it is
+// greater than one, the cells at each level of the tree are weighed
+// concurrently (or the input trees are summed concurrently), and so the given
+// weight, lookup and feature functions must be safe to call from multiple
+// threads.  The resulting tree is the same regardless of the thread count.
+//
 // As a more complete example:
 //
 //   MutableS2ShapeIndex index;
@@ -145,16 +153,18 @@ class S2DensityTree {
   //
   // If this function returns false, the 'error' object can be expected to
   // contain a reason the tree could not be initialized.
+  //
+  // Up to "num_threads" threads (including the calling thread) are used.
   bool InitToShapeDensity(const S2ShapeIndex& index,
                           const ShapeWeightFunction& weight_fn,
                           int64_t approximate_size_bytes, int max_level,
-                          S2Error* error);
+                          S2Error* error, int num_threads = 1);
 
   // A wrapper around InitToShapeDensity which uses the number of vertices in
   // each shape to calculate weights.
   bool InitToVertexDensity(const S2ShapeIndex& index,
                            int64_t approximate_size_bytes, int max_level,
-                           S2Error* error);
+                           S2Error* error, int num_threads = 1);
 
   // Type definition for a function that returns a pointer to the associated T
   // for a given S2Shape. This function is allowed to return nullptr if the user
@@ -183,7 +193,7 @@ class S2DensityTree {
                             const FeatureLookupFunction<T>& feature_lookup_fn,
                             const FeatureWeightFunction<T>& feature_weight_fn,
                             int64_t approximate_size_bytes, int max_level,
-                            S2Error* error);
+                            S2Error* error, int num_threads = 1);
 
   // Returns a new S2DensityTree that contains the combined weights across the
   // cells the given input trees.  The new tree will be held to the constraints
@@ -192,12 +202,40 @@ class S2DensityTree {
   // operation allows.
   bool InitToSumDensity(std::vector<const S2DensityTree*>& trees,
                         int64_t approximate_size_bytes, int max_level,
-                        S2Error* error);
+                        S2Error* error, int num_threads = 1);
 
   // Same as above, but sums trees without regard for a maximum encoded size.
-  // This enables the use of a substantially faster summing algorithm.
+  // This enables the use of a substantially faster summing algorithm.  When
+  // several threads are used, each thread sums a subset of the input trees
+  // and the partial sums are then merged pairwise in parallel.
   bool InitToSumDensity(std::vector<const S2DensityTree*>& trees, int max_level,
-                        S2Error* error);
+                        S2Error* error, int num_threads = 1);
+
+  // A change to the geometry measured by a tree: "shape" was added to the
+  // index with the given positive weight, or removed from the index with the
+  // given negative weight.  "weight" should be the same value (or its
+  // negation) that the tree's ShapeWeightFunction returns for "shape".
+  struct ShapeWeightDelta {
+    const S2Shape* shape;
+    int64_t weight;
+  };
+
+  // Initializes this tree to "tree" with the given changes applied, without
+  // rescanning the unchanged shapes of the index.  The weight of every cell
+  // of "tree" that intersects a changed shape is adjusted by that shape's
+  // weight, cells whose weight drops to zero are removed (along with their
+  // descendants), and added shapes that intersect a cell whose parent has
+  // children in "tree" create new leaf cells there.  Subtrees that do not
+  // intersect any changed shape are copied unchanged.
+  //
+  // The result is close to, but not necessarily the same as, the tree that
+  // would be built from the updated index; e.g. cells are never subdivided
+  // further than in "tree", and the tree may exceed its original size limit.
+  // Occasional rebuilds from scratch are recommended if there are many
+  // changes.
+  bool InitToUpdatedDensity(const S2DensityTree& tree,
+                            absl::Span<const ShapeWeightDelta> deltas,
+                            S2Error* error);
 
   // Initialize the S2DensityTree from the given decoder.
   bool Init(Decoder* decoder, S2Error& error);
@@ -240,6 +278,59 @@ class S2DensityTree {
   std::vector<S2CellUnion> GetPartitioning(int64_t max_weight,
                                            S2Error* error) const;
 
+  // Returns a partitioning of the sphere into exactly 'num_partitions'
+  // S2CellUnions of approximately equal weight, or fewer if the tree does not
+  // have enough cells.  Cells are selected as by GetPartitioning() with
+  // 'max_weight' equal to the total weight divided by 'num_partitions', and
+  // consecutive cells along the Hilbert curve are assigned to each union.
+  std::vector<S2CellUnion> GetBalancedPartitioning(int num_partitions,
+                                                   S2Error* error) const;
+
+  // The cells that GetPartitioning() selects for a given 'max_weight', in
+  // Hilbert curve order, together with the prefix sums of their normalized
+  // weights.  Each partition boundary can then be found by binary search, so
+  // partitionings for several weights or numbers of partitions can be
+  // computed cheaply without traversing the tree again.  For example:
+  //
+  //   S2DensityTree::PartitionCells cells(tree, min_shard_weight, &error);
+  //   for (int num_shards : {10, 20, 50}) {
+  //     auto shards = cells.GetBalancedPartitioning(num_shards);
+  //     ...
+  //   }
+  class PartitionCells {
+   public:
+    PartitionCells() = default;
+
+    // Selects the cells that GetPartitioning(max_weight) would use.  Note
+    // that partitionings for weights much smaller than 'max_weight' may be
+    // uneven, since the selected cells can be too large to divide finely.
+    PartitionCells(const S2DensityTree& tree, int64_t max_weight,
+                   S2Error* error);
+
+    int num_cells() const { return cell_ids_.size(); }
+    S2CellId cell_id(int i) const { return cell_ids_[i]; }
+
+    // Returns the total normalized weight of the cells.
+    int64_t total_weight() const { return prefix_weights_.back(); }
+
+    // Greedily packs the cells into unions whose weight is less than
+    // 'max_weight', exactly as S2DensityTree::GetPartitioning() does.
+    std::vector<S2CellUnion> GetPartitioning(int64_t max_weight) const;
+
+    // Divides the cells into min(num_partitions, num_cells()) unions of
+    // consecutive cells with approximately equal weight.
+    std::vector<S2CellUnion> GetBalancedPartitioning(int num_partitions) const;
+
+   private:
+    // Returns the cells in the range [begin, end) as an S2CellUnion.
+    S2CellUnion MakeUnion(int begin, int end) const;
+
+    std::vector<S2CellId> cell_ids_;
+
+    // prefix_weights_[i] is the total weight of the first "i" cells.
+    std::vector<int64_t> prefix_weights_ = {0};
+  };
+
   // Returns a fully-decoded map of this tree.  This is only useful if far more
   // lookups will be done than there are entries in the map, and the lookups are
   // sufficiently random that a DecodedPath is not sufficient.  In that case
@@ -362,6 +453,9 @@ class S2DensityTree {
     // Inserts the given cell/weight pair into the current encoder.
     void Put(S2CellId cell, int64_t weight);
 
+    // Adds all the cell/weight pairs of "other" to the current encoder.
+    void Merge(const TreeEncoder& other);
+
     // Encodes the current set of cell/weight pairs and returns the new density
     // tree.
     void Build(S2DensityTree* tree);
@@ -410,6 +504,15 @@ class S2DensityTree {
     bool Build(const CellWeightFunction& weight_fn, S2DensityTree* tree,
                S2Error* error) const;
 
+    // As above, but the cells at each level are weighed concurrently using
+    // one thread per entry of "weight_fns".  Each function is only called by
+    // a single thread, so they may have independent mutable state.  The tree
+    // is the same as the one built using any single function.
+    //
+    // REQUIRES: !weight_fns.empty()
+    bool Build(absl::Span<const CellWeightFunction> weight_fns,
+               S2DensityTree* tree, S2Error* error) const;
+
    private:
     const int64_t approximate_size_bytes_;
     const int max_level_;
@@ -495,20 +598,27 @@ bool S2DensityTree::InitToFeatureDensity(
     const S2ShapeIndex& index,
     const FeatureLookupFunction<T>& feature_lookup_fn,
     const FeatureWeightFunction<T>& feature_weight_fn,
-    int64_t approximate_size_bytes, int max_level, S2Error* error) {
+    int64_t approximate_size_bytes, int max_level, S2Error* error,
+    int num_threads) {
   ABSL_DCHECK(error != nullptr) << "error must be non-nullptr";
   *error = S2Error::Ok();
 
-  FeatureCellWeightFunction<T> index_cell_weight_fn(&index, feature_lookup_fn,
-                                                    feature_weight_fn);
+  // Each thread needs its own S2ShapeIndexRegion.
+  std::vector<std::unique_ptr<FeatureCellWeightFunction<T>>> measures;
+  std::vector<BreadthFirstTreeBuilder::CellWeightFunction> weight_fns;
+  for (int i = 0; i < std::max(1, num_threads); ++i) {
+    auto& measure = measures.emplace_back(
+        std::make_unique<FeatureCellWeightFunction<T>>(
+            &index, feature_lookup_fn, feature_weight_fn));
+    weight_fns.push_back(
+        [measure = measure.get()](const S2CellId cell_id, S2Error* error) {
+          return measure->WeighCell(cell_id, error);
+        });
+  }
 
   TreeEncoder encoder;
   BreadthFirstTreeBuilder builder(approximate_size_bytes, max_level, encoder);
-  return builder.Build(
-      [&](const S2CellId cell_id, S2Error* error) {
-        return index_cell_weight_fn.WeighCell(cell_id, error);
-      },
-      this, error);
+  return builder.Build(weight_fns, this, error);
 }
 
 template <typename T>
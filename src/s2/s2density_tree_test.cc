@@ -15,6 +15,7 @@
 
 #include "s2/s2density_tree.h"
 
+#include <algorithm>
 #include <cmath>
 #include <cstdint>
 #include <limits>
@@ -308,6 +309,78 @@ TEST(S2DensityTreeTest, LimitsToMaxWeight) {
   }
 }
 
+TEST(S2DensityTreeTest, InitToUpdatedDensity) {
+  absl::BitGen bitgen(S2Testing::MakeTaggedSeedSeq(
+      "INIT_TO_UPDATED_DENSITY",
+      absl::LogInfoStreamer(__FILE__, __LINE__).stream()));
+
+  constexpr int kMaxLevel = 12;
+  const auto weight_fn = [](const S2Shape& shape) -> int64_t {
+    return shape.num_edges();
+  };
+  MutableS2ShapeIndex index;
+  for (int i = 0; i < 100; ++i) {
+    index.Add(make_unique<S2PointVectorShape>(
+        vector<S2Point>{s2random::Point(bitgen), s2random::Point(bitgen)}));
+  }
+  S2Error error;
+  S2DensityTree tree;
+  ASSERT_TRUE(tree.InitToShapeDensity(index, weight_fn, 1 << 20, kMaxLevel,
+                                      &error));
+  const auto original = tree.Decode(&error);
+  ASSERT_TRUE(error.ok()) << error;
+
+  // Add some shapes and remove others.
+  vector<S2DensityTree::ShapeWeightDelta> deltas;
+  for (int i = 0; i < 10; ++i) {
+    const S2Shape* shape = index.shape(index.Add(make_unique<
+        S2PointVectorShape>(vector<S2Point>{s2random::Point(bitgen)})));
+    deltas.push_back({shape, weight_fn(*shape)});
+  }
+  vector<unique_ptr<S2Shape>> removed;
+  for (int id = 0; id < 100; id += 7) {
+    removed.push_back(index.Release(id));
+    deltas.push_back({removed.back().get(), -weight_fn(*removed.back())});
+  }
+  S2DensityTree updated;
+  ASSERT_TRUE(updated.InitToUpdatedDensity(tree, deltas, &error)) << error;
+  const auto actual = updated.Decode(&error);
+  ASSERT_TRUE(error.ok()) << error;
+
+  // Since the budget is large enough to expand every cell to kMaxLevel, the
+  // rebuilt tree has every cell of the updated tree with the same weight.
+  S2DensityTree rebuilt;
+  ASSERT_TRUE(rebuilt.InitToShapeDensity(index, weight_fn, 1 << 20, kMaxLevel,
+                                         &error));
+  const auto expected = rebuilt.Decode(&error);
+  ASSERT_TRUE(error.ok()) << error;
+  EXPECT_NE(actual, original);
+  for (const auto& [cell_id, weight] : actual) {
+    auto it = expected.find(cell_id);
+    ASSERT_TRUE(it != expected.end()) << cell_id;
+    EXPECT_EQ(it->second, weight) << cell_id;
+  }
+
+  // Removing the added shapes again restores the original tree.  (This is not
+  // true of adding removed shapes back, since the subtrees of cells whose
+  // weight dropped to zero are lost.)
+  vector<S2DensityTree::ShapeWeightDelta> added(deltas.begin(),
+                                                deltas.begin() + 10);
+  S2DensityTree with_added;
+  ASSERT_TRUE(with_added.InitToUpdatedDensity(tree, added, &error));
+  for (auto& delta : added) {
+    delta.weight = -delta.weight;
+  }
+  S2DensityTree reverted;
+  ASSERT_TRUE(reverted.InitToUpdatedDensity(with_added, added, &error));
+  EXPECT_EQ(reverted.Decode(&error), original);
+
+  // An empty update leaves the tree unchanged.
+  S2DensityTree unchanged;
+  ASSERT_TRUE(unchanged.InitToUpdatedDensity(tree, {}, &error));
+  EXPECT_EQ(unchanged.Decode(&error), original);
+}
+
 TEST(S2DensityTreeTest, VisitorCancellation) {
   MutableS2ShapeIndex index;
   index.Add(make_unique<S2PointVectorShape>(
@@ -830,6 +903,92 @@ TEST_F(GetPartitioningTest, OversizeCells) {
   }
 }
 
+TEST_F(GetPartitioningTest, PartitionCellsMatchesGetPartitioning) {
+  absl::btree_map<S2CellId, int64_t> base;
+  for (int i = 0; i < 64; ++i) {
+    base.insert({S2CellId::FromFacePosLevel(2, 0, 3).advance(i), 1 + i % 7});
+  }
+  for (const auto& weighted_cell : SumToRoot(base)) {
+    Put(weighted_cell.first, weighted_cell.second);
+  }
+  auto tree = BuildTree();
+
+  S2Error error;
+  S2DensityTree::PartitionCells cells(tree, 16, &error);
+  ASSERT_TRUE(error.ok());
+  EXPECT_EQ(cells.num_cells(), 64);
+  EXPECT_EQ(cells.GetPartitioning(16), tree.GetPartitioning(16, &error));
+
+  // The selected cells are the leaves of the tree, so the binary search must
+  // give the same result as packing them greedily.
+  for (int64_t max_weight : {1, 5, 7, 16, 100, 1000}) {
+    SCOPED_TRACE(max_weight);
+    vector<S2CellUnion> expected;
+    vector<S2CellId> cover;
+    int64_t current_weight = 0;
+    for (const auto& [cell_id, weight] : base) {
+      if (!cover.empty() && current_weight + weight >= max_weight) {
+        expected.push_back(S2CellUnion::FromVerbatim(std::move(cover)));
+        cover.clear();
+        current_weight = 0;
+      }
+      cover.push_back(cell_id);
+      current_weight += weight;
+    }
+    expected.push_back(S2CellUnion::FromVerbatim(std::move(cover)));
+    EXPECT_EQ(cells.GetPartitioning(max_weight), expected);
+  }
+}
+
+TEST_F(GetPartitioningTest, BalancedPartitioning) {
+  absl::btree_map<S2CellId, int64_t> base;
+  for (int i = 0; i < 64; ++i) {
+    base.insert({S2CellId::FromFacePosLevel(2, 0, 3).advance(i), 1 + i % 7});
+  }
+  for (const auto& weighted_cell : SumToRoot(base)) {
+    Put(weighted_cell.first, weighted_cell.second);
+  }
+  auto tree = BuildTree();
+
+  int64_t total_weight = 0;
+  for (const auto& [cell_id, weight] : base) total_weight += weight;
+
+  S2Error error;
+  for (int num_partitions : {1, 2, 3, 8, 64}) {
+    SCOPED_TRACE(num_partitions);
+    vector<S2CellUnion> partitioning =
+        tree.GetBalancedPartitioning(num_partitions, &error);
+    ASSERT_TRUE(error.ok());
+    ASSERT_EQ(partitioning.size(), num_partitions);
+
+    // Each partition is within one cell weight of the ideal weight.
+    vector<int64_t> weights;
+    int64_t max_cell_weight = 0;
+    for (const auto& cover : partitioning) {
+      int64_t weight = 0;
+      for (const S2CellId cell_id : cover) {
+        int64_t cell_weight = 0;
+        for (const auto& [id, w] : base) {
+          if (cell_id.contains(id)) cell_weight += w;
+        }
+        max_cell_weight = std::max(max_cell_weight, cell_weight);
+        weight += cell_weight;
+      }
+      weights.push_back(weight);
+    }
+    int64_t sum = 0;
+    for (int64_t weight : weights) {
+      EXPECT_LE(std::abs(weight * num_partitions - total_weight),
+                max_cell_weight * num_partitions);
+      sum += weight;
+    }
+    EXPECT_EQ(sum, total_weight);
+  }
+
+  // There are only 64 cells, so no more than 64 partitions are returned.
+  EXPECT_EQ(tree.GetBalancedPartitioning(100, &error).size(), 64);
+}
+
 class SumDensityTreesTest : public ::testing::TestWithParam<bool> {
  public:
   SumDensityTreesTest() = default;
@@ -1027,6 +1186,46 @@ TEST_P(SumDensityTreesTest, SumEmptyAndNonEmpty) {
   EXPECT_EQ(decoded, sum_tree.Decode(&error));
 }
 
+TEST_P(SumDensityTreesTest, MultithreadedInitMatches) {
+  absl::BitGen bitgen(S2Testing::MakeTaggedSeedSeq(
+      "MULTITHREADED_INIT_MATCHES",
+      absl::LogInfoStreamer(__FILE__, __LINE__).stream()));
+
+  // Trees built with several threads are identical to those built with one.
+  vector<S2DensityTree> trees(9);
+  S2Error error;
+  for (S2DensityTree& tree : trees) {
+    MutableS2ShapeIndex index;
+    for (int i = 0; i < 50; ++i) {
+      index.Add(make_unique<S2PointVectorShape>(
+          vector<S2Point>{s2random::Point(bitgen), s2random::Point(bitgen)}));
+    }
+    ASSERT_TRUE(tree.InitToVertexDensity(index, 2'000, 20, &error));
+    S2DensityTree parallel_tree;
+    ASSERT_TRUE(
+        parallel_tree.InitToVertexDensity(index, 2'000, 20, &error, 4));
+    EXPECT_EQ(tree.Decode(&error), parallel_tree.Decode(&error));
+  }
+
+  vector<const S2DensityTree*> tree_ptrs;
+  for (const auto& tree : trees) {
+    tree_ptrs.push_back(&tree);
+  }
+  S2DensityTree sum_tree, parallel_sum_tree;
+  if (GetParam()) {
+    ASSERT_TRUE(sum_tree.InitToSumDensity(tree_ptrs, 5'000, 15, &error));
+    ASSERT_TRUE(
+        parallel_sum_tree.InitToSumDensity(tree_ptrs, 5'000, 15, &error, 4));
+  } else {
+    ASSERT_TRUE(sum_tree.InitToSumDensity(tree_ptrs, 15, &error));
+    ASSERT_TRUE(parallel_sum_tree.InitToSumDensity(tree_ptrs, 15, &error, 4));
+  }
+  auto decoded = sum_tree.Decode(&error);
+  ASSERT_TRUE(error.ok()) << error;
+  EXPECT_FALSE(decoded.empty());
+  EXPECT_EQ(decoded, parallel_sum_tree.Decode(&error));
+}
+
 INSTANTIATE_TEST_SUITE_P(SumTrees, SumDensityTreesTest, testing::Bool(),
                          [](const testing::TestParamInfo<bool>& info) {
                            return info.param ? "WithSizeLimit"
@@ -18,7 +18,10 @@
 #include <cmath>
 
 #include <algorithm>
+#include <cstddef>
 
+#include "absl/log/absl_check.h"
+#include "absl/types/span.h"
 #include "s2/s1angle.h"
 #include "s2/s2latlng.h"
 
@@ -35,6 +38,23 @@ double Haversine(const double radians) {
 
 }  // namespace
 
+void S2Earth::GetDistancesMeters(const S2Point& a,
+                                 absl::Span<const S2Point> b,
+                                 absl::Span<double> result) {
+  ABSL_DCHECK_EQ(b.size(), result.size());
+  for (size_t k = 0; k < b.size(); ++k) {
+    result[k] = GetDistanceMeters(a, b[k]);
+  }
+}
+
+void S2Earth::GetDistancesKm(const S2Point& a, absl::Span<const S2Point> b,
+                             absl::Span<double> result) {
+  ABSL_DCHECK_EQ(b.size(), result.size());
+  for (size_t k = 0; k < b.size(); ++k) {
+    result[k] = GetDistanceKm(a, b[k]);
+  }
+}
+
 double S2Earth::MetersToLongitudeRadians(double meters,
                                          double latitude_radians) {
   double scalar = cos(latitude_radians);
@@ -21,6 +21,7 @@
 #ifndef S2_S2EARTH_H_
 #define S2_S2EARTH_H_
 
+#include "absl/types/span.h"
 #include "s2/s1angle.h"
 #include "s2/s1chord_angle.h"
 #include "s2/s2latlng.h"
@@ -105,6 +106,17 @@ class S2Earth {
   static inline double GetDistanceKm(const S2Point& a, const S2Point& b);
   static inline double GetDistanceKm(const S2LatLng& a, const S2LatLng& b);
 
+  // Batch versions of GetDistanceMeters() and GetDistanceKm() that compute
+  // the distance from "a" to each point of "b".  The results are identical to
+  // the functions above.  (If the distances are only needed for comparison,
+  // S1ChordAngle::FromPoints() is much faster since it avoids trigonometry.)
+  //
+  // REQUIRES: b.size() == result.size()
+  static void GetDistancesMeters(const S2Point& a, absl::Span<const S2Point> b,
+                                 absl::Span<double> result);
+  static void GetDistancesKm(const S2Point& a, absl::Span<const S2Point> b,
+                             absl::Span<double> result);
+
   // CAVEAT: These versions are not as accurate because util::units::Meters
   // uses "float" rather than "double" as the underlying representation.
   static inline util::units::Meters GetDistance(const S2Point& a,
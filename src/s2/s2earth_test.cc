@@ -19,8 +19,10 @@
 
 #include <cmath>
 #include <string>
+#include <vector>
 
 #include <gtest/gtest.h>
+#include "absl/types/span.h"
 #include "s2/s1angle.h"
 #include "s2/s1chord_angle.h"
 #include "s2/s2latlng.h"
@@ -164,3 +166,16 @@ TEST(S2EarthTest, TestGetDistance) {
                                               S2LatLng::FromDegrees(55, -153)),
                    1000 * S2Earth::RadiusKm() * M_PI / 4);
 }
+
+TEST(S2EarthTest, TestGetDistances) {
+  S2Point a = S2LatLng::FromDegrees(37, -122).ToPoint();
+  std::vector<S2Point> b = {a, -a, S2Point(0, 0, 1),
+                            S2LatLng::FromDegrees(37.01, -122).ToPoint()};
+  std::vector<double> meters(b.size()), km(b.size());
+  S2Earth::GetDistancesMeters(a, b, absl::MakeSpan(meters));
+  S2Earth::GetDistancesKm(a, b, absl::MakeSpan(km));
+  for (size_t i = 0; i < b.size(); ++i) {
+    EXPECT_EQ(meters[i], S2Earth::GetDistanceMeters(a, b[i]));
+    EXPECT_EQ(km[i], S2Earth::GetDistanceKm(a, b[i]));
+  }
+}
@@ -20,8 +20,11 @@
 #include <algorithm>
 #include <cfloat>
 #include <cmath>
+#include <cstdint>
 
+#include "absl/container/fixed_array.h"
 #include "absl/log/absl_check.h"
+#include "absl/types/span.h"
 #include "s2/r1interval.h"
 #include "s2/r2.h"
 #include "s2/r2rect.h"
@@ -422,6 +425,28 @@ R2Rect GetClippedEdgeBound(const R2Point& a, const R2Point& b,
   return R2Rect::Empty();
 }
 
+void GetClippedEdgeBounds(absl::Span<const R2Point> a,
+                          absl::Span<const R2Point> b, const R2Rect& clip,
+                          absl::Span<R2Rect> bounds) {
+  ABSL_DCHECK_EQ(a.size(), b.size());
+  ABSL_DCHECK_EQ(a.size(), bounds.size());
+  const size_t n = a.size();
+  const double u_lo = clip[0].lo(), u_hi = clip[0].hi();
+  const double v_lo = clip[1].lo(), v_hi = clip[1].hi();
+  absl::FixedArray<uint8_t, 256> contained(n);
+  for (size_t i = 0; i < n; ++i) {
+    const double u0 = min(a[i][0], b[i][0]), u1 = max(a[i][0], b[i][0]);
+    const double v0 = min(a[i][1], b[i][1]), v1 = max(a[i][1], b[i][1]);
+    bounds[i] = R2Rect(R1Interval(u0, u1), R1Interval(v0, v1));
+    contained[i] = (u0 >= u_lo) & (u1 <= u_hi) & (v0 >= v_lo) & (v1 <= v_hi);
+  }
+  for (size_t i = 0; i < n; ++i) {
+    if (!contained[i] && !ClipEdgeBound(a[i], b[i], clip, &bounds[i])) {
+      bounds[i] = R2Rect::Empty();
+    }
+  }
+}
+
 bool ClipEdgeBound(const R2Point& a, const R2Point& b, const R2Rect& clip,
                    R2Rect* bound) {
   // "diag" indicates which diagonal of the bounding box is spanned by AB: it
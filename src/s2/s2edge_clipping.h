@@ -33,6 +33,7 @@
 
 #include "absl/container/inlined_vector.h"
 #include "absl/log/absl_check.h"
+#include "absl/types/span.h"
 #include "s2/_fp_contract_off.h"  // IWYU pragma: keep
 #include "s2/r2.h"
 #include "s2/r2rect.h"
@@ -123,6 +124,19 @@ bool ClipEdge(const R2Point& a, const R2Point& b, const R2Rect& clip,
 R2Rect GetClippedEdgeBound(const R2Point& a, const R2Point& b,
                            const R2Rect& clip);
 
+// Batch version of GetClippedEdgeBound() that sets bounds[i] to the bounding
+// rectangle of the portion of the edge (a[i], b[i]) intersected by "clip".
+// The results are identical to calling GetClippedEdgeBound() for each edge.
+// This is faster when most edges are contained by "clip", since the bounds
+// and containment tests for all edges are computed by a loop without
+// branches (which the compiler can vectorize), and only the remaining edges
+// are clipped individually.
+//
+// REQUIRES: a.size() == b.size() == bounds.size()
+void GetClippedEdgeBounds(absl::Span<const R2Point> a,
+                          absl::Span<const R2Point> b, const R2Rect& clip,
+                          absl::Span<R2Rect> bounds);
+
 // This function can be used to clip an edge AB to sequence of rectangles
 // efficiently.  It represents the clipped edges by their bounding boxes
 // rather than as a pair of endpoints.  Specifically, let A'B' be some
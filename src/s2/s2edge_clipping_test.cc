@@ -29,6 +29,7 @@
 #include "absl/random/random.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/string_view.h"
+#include "absl/types/span.h"
 #include "s2/r1interval.h"
 #include "s2/r2.h"
 #include "s2/r2rect.h"
@@ -370,3 +371,30 @@ TEST(S2, EdgeClipping) {
   TestEdgeClipping(bitgen, R2Rect::FromPoint(R2Point(0.3, 0.8)));
   TestEdgeClipping(bitgen, R2Rect::Empty());
 }
+
+TEST(S2, GetClippedEdgeBoundsMatchesGetClippedEdgeBound) {
+  absl::BitGen bitgen(S2Testing::MakeTaggedSeedSeq(
+      "GET_CLIPPED_EDGE_BOUNDS",
+      absl::LogInfoStreamer(__FILE__, __LINE__).stream()));
+  const R2Rect clips[] = {
+      R2Rect(R1Interval(-0.5, 0.25), R1Interval(-0.1, 0.6)),
+      R2Rect(R1Interval(0.2, 0.5), R1Interval(0.3, 0.3)),
+      R2Rect::FromPoint(R2Point(0.3, 0.8)),
+      R2Rect::Empty(),
+  };
+  for (const R2Rect& clip : clips) {
+    // Use a mix of edges that are contained by "clip" and edges that are not.
+    vector<R2Point> a, b;
+    for (int i = 0; i < 1000; ++i) {
+      a.push_back(ChooseEndpoint(bitgen, clip));
+      b.push_back(ChooseEndpoint(bitgen, clip));
+    }
+    vector<R2Rect> bounds(a.size());
+    S2::GetClippedEdgeBounds(a, b, clip, absl::MakeSpan(bounds));
+    for (int i = 0; i < a.size(); ++i) {
+      R2Rect expected = S2::GetClippedEdgeBound(a[i], b[i], clip);
+      EXPECT_EQ(bounds[i].is_empty(), expected.is_empty());
+      if (!expected.is_empty()) EXPECT_EQ(bounds[i], expected);
+    }
+  }
+}
@@ -18,7 +18,11 @@
 #ifndef S2_S2EDGE_CROSSER_H_
 #define S2_S2EDGE_CROSSER_H_
 
+#include <cstddef>
+#include <type_traits>
+
 #include "absl/log/absl_check.h"
+#include "absl/types/span.h"
 #include "s2/_fp_contract_off.h"  // IWYU pragma: keep
 #include "s2/s2edge_crossings.h"
 #include "s2/s2edge_crossings_internal.h"
@@ -135,6 +139,25 @@ class S2EdgeCrosserBase {
   // int S2CopyingEdgeCrosser::CrossingSign(const S2Point& c, const S2Point& d);
   int CrossingSign(ArgType c, ArgType d);
 
+  // Batch version of CrossingSign(c, d) that tests AB against every edge in
+  // "edges" and sets signs[i] = CrossingSign(edges[i].v0, edges[i].v1).
+  // The results are identical to calling CrossingSign() for each edge, but
+  // the common case is handled more efficiently: a first pass computes the
+  // (cheap, floating-point) orientation of every edge endpoint with respect
+  // to the great circle through AB in a branch-free loop that the compiler
+  // can vectorize, and only edges that are not clearly on one side of that
+  // great circle are passed to the exact CrossingSign() logic.
+  //
+  // After this call the current edge chain vertex c() is unspecified, so
+  // RestartAt() must be called before using the single-argument methods.
+  //
+  // "Edge" may be any type with S2Point fields "v0" and "v1", such as
+  // S2Shape::Edge.
+  //
+  // REQUIRES: signs.size() == edges.size()
+  template <class Edge>
+  void CrossingSigns(absl::Span<const Edge> edges, absl::Span<int> signs);
+
   // This method extends the concept of a "crossing" to the case where AB
   // and CD have a vertex in common.  The two edges may or may not cross,
   // according to the rules defined in VertexCrossing() below.  The rules
@@ -407,4 +430,32 @@ inline int S2EdgeCrosserBase<PointRep>::SignedEdgeOrVertexCrossing(ArgType d) {
   return S2::SignedVertexCrossing(*a_, *b_, *c, *PointRep(d));
 }
 
+template <class PointRep>
+template <class Edge>
+inline void S2EdgeCrosserBase<PointRep>::CrossingSigns(
+    absl::Span<const Edge> edges, absl::Span<int> signs) {
+  ABSL_DCHECK_EQ(edges.size(), signs.size());
+  // First pass: an edge that lies strictly on one side of the great circle
+  // through AB cannot cross AB.  This is by far the most common case, and
+  // the loop below has no data-dependent branches or function calls.  Other
+  // edges are marked with a value that CrossingSign() never returns.
+  constexpr int kUncertain = 2;
+  const S2Point& a = *a_;
+  const S2Point& b = *b_;
+  for (size_t i = 0; i < edges.size(); ++i) {
+    int c_sign = s2pred::TriageSign(a, b, edges[i].v0, a_cross_b_);
+    int d_sign = s2pred::TriageSign(a, b, edges[i].v1, a_cross_b_);
+    signs[i] = (c_sign == d_sign && c_sign != 0) ? -1 : kUncertain;
+  }
+  // Second pass: compute the exact result for the remaining edges.
+  for (size_t i = 0; i < edges.size(); ++i) {
+    if (signs[i] != kUncertain) continue;
+    if constexpr (std::is_pointer_v<ArgType>) {
+      signs[i] = CrossingSign(&edges[i].v0, &edges[i].v1);
+    } else {
+      signs[i] = CrossingSign(edges[i].v0, edges[i].v1);
+    }
+  }
+}
+
 #endif  // S2_S2EDGE_CROSSER_H_
@@ -26,12 +26,14 @@
 #include "absl/log/log_streamer.h"
 #include "absl/random/random.h"
 #include "absl/strings/str_cat.h"
+#include "absl/types/span.h"
 #include "s2/s2edge_crossings.h"
 #include "s2/s2edge_distances.h"
 #include "s2/s2point.h"
 #include "s2/s2pointutil.h"
 #include "s2/s2predicates.h"
 #include "s2/s2random.h"
+#include "s2/s2shape.h"
 #include "s2/s2testing.h"
 
 using std::vector;
@@ -262,6 +264,43 @@ TEST(S2, CollinearEdgesThatDontTouch) {
   }
 }
 
+TEST(S2, CrossingSignsMatchesCrossingSign) {
+  absl::BitGen bitgen(S2Testing::MakeTaggedSeedSeq(
+      "CROSSING_SIGNS_MATCHES_CROSSING_SIGN",
+      absl::LogInfoStreamer(__FILE__, __LINE__).stream()));
+  constexpr int kIters = 100;
+  for (int iter = 0; iter < kIters; ++iter) {
+    S2Point a = s2random::Point(bitgen);
+    S2Point b = S2::Interpolate(a, s2random::Point(bitgen), 0.1);
+    // Include edges that are far away, that cross AB, that share a vertex
+    // with AB, that are collinear with AB, and that are degenerate.
+    vector<S2Shape::Edge> edges;
+    for (int i = 0; i < 20; ++i) {
+      S2Point c = s2random::Point(bitgen);
+      S2Point m = S2::Interpolate(a, b, absl::Uniform(bitgen, 0.0, 1.0));
+      edges.emplace_back(c, s2random::Point(bitgen));
+      edges.emplace_back(c, S2::Interpolate(c, m, 2.0));
+      edges.emplace_back(a, c);
+      edges.emplace_back(c, b);
+      edges.emplace_back(S2::Interpolate(a, b, 0.5), S2::Interpolate(a, b, 2));
+      edges.emplace_back(c, c);
+    }
+    vector<int> expected;
+    for (const auto& edge : edges) {
+      expected.push_back(S2::CrossingSign(a, b, edge.v0, edge.v1));
+    }
+    vector<int> signs(edges.size());
+    S2EdgeCrosser crosser(&a, &b);
+    crosser.CrossingSigns(absl::MakeConstSpan(edges), absl::MakeSpan(signs));
+    EXPECT_EQ(signs, expected);
+
+    S2CopyingEdgeCrosser copying_crosser(a, b);
+    signs.assign(edges.size(), 0);
+    copying_crosser.CrossingSigns(absl::MakeConstSpan(edges),
+                                  absl::MakeSpan(signs));
+    EXPECT_EQ(signs, expected);
+  }
+}
 
 TEST(S2, CoincidentZeroLengthEdgesThatDontTouch) {
   // It is important that the edge primitives can handle vertices that exactly
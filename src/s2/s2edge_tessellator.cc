@@ -18,15 +18,18 @@
 #include "s2/s2edge_tessellator.h"
 
 #include <algorithm>
+#include <cstddef>
 #include <vector>
 
 #include "absl/log/absl_check.h"
 #include "absl/log/absl_log.h"
+#include "absl/types/span.h"
 #include "s2/r2.h"
 #include "s2/s1angle.h"
 #include "s2/s1chord_angle.h"
 #include "s2/s2edge_distances.h"
 #include "s2/s2point.h"
+#include "s2/s2point_span.h"
 #include "s2/s2pointutil.h"
 #include "s2/s2projections.h"
 
@@ -229,6 +232,38 @@ void S2EdgeTessellator::AppendProjected(
   AppendProjected(pa, a, pb, b, vertices);
 }
 
+void S2EdgeTessellator::AppendProjectedChain(
+    S2PointSpan chain, vector<R2Point>* vertices) const {
+  AppendProjectedChain(chain, false /*is_loop*/, vertices);
+}
+
+void S2EdgeTessellator::AppendProjectedLoop(
+    S2PointLoopSpan loop, vector<R2Point>* vertices) const {
+  AppendProjectedChain(loop, true /*is_loop*/, vertices);
+}
+
+void S2EdgeTessellator::AppendProjectedChain(
+    S2PointSpan chain, bool is_loop, vector<R2Point>* vertices) const {
+  if (chain.empty()) return;
+  // This is equivalent to calling AppendProjected() for each edge, except
+  // that the projected destination of each edge is reused as the source of
+  // the next one.
+  const R2Point p0 = proj_->Project(chain[0]);
+  R2Point pa = p0;
+  if (vertices->empty()) {
+    vertices->push_back(pa);
+  } else {
+    pa = proj_->WrapDestination(vertices->back(), pa);
+    ABSL_DCHECK_EQ(vertices->back(), pa) << "Appended edges must form a chain";
+  }
+  for (size_t i = 1; i < chain.size(); ++i) {
+    AppendProjected(pa, chain[i - 1], proj_->Project(chain[i]), chain[i],
+                    vertices);
+    pa = vertices->back();
+  }
+  if (is_loop) AppendProjected(pa, chain.back(), p0, chain[0], vertices);
+}
+
 // Given a geodesic edge AB, split the edge as necessary and append all
 // projected vertices except the first to "vertices".
 //
@@ -266,6 +301,24 @@ void S2EdgeTessellator::AppendUnprojected(
   AppendUnprojected(pa, a, pb, b, vertices);
 }
 
+void S2EdgeTessellator::AppendUnprojectedChain(
+    absl::Span<const R2Point> chain, vector<S2Point>* vertices) const {
+  if (chain.empty()) return;
+  S2Point a = proj_->Unproject(chain[0]);
+  if (vertices->empty()) {
+    vertices->push_back(a);
+  } else {
+    // See the comments in AppendUnprojected() above.
+    ABSL_DCHECK(S2::ApproxEquals(vertices->back(), a))
+        << "Appended edges must form a chain";
+  }
+  for (size_t i = 1; i < chain.size(); ++i) {
+    S2Point b = proj_->Unproject(chain[i]);
+    AppendUnprojected(chain[i - 1], a, chain[i], b, vertices);
+    a = b;
+  }
+}
+
 // Like AppendProjected, but interpolates a projected edge and appends the
 // corresponding points on the sphere.
 void S2EdgeTessellator::AppendUnprojected(
@@ -21,10 +21,12 @@
 #include <vector>
 
 #include "absl/base/nullability.h"
+#include "absl/types/span.h"
 #include "s2/r2.h"
 #include "s2/s1angle.h"
 #include "s2/s1chord_angle.h"
 #include "s2/s2point.h"
+#include "s2/s2point_span.h"
 #include "s2/s2projections.h"
 
 // Given an edge in some 2D projection (e.g., Mercator), S2EdgeTessellator
@@ -79,6 +81,27 @@ class S2EdgeTessellator {
   void AppendUnprojected(const R2Point& a, const R2Point& b,
                          std::vector<S2Point>* vertices) const;
 
+  // Converts a chain of spherical geodesic edges (e.g., a polyline) to a
+  // chain of planar edges and appends the vertices to "vertices".  This is
+  // equivalent to calling AppendProjected() for each edge, but faster since
+  // each input vertex is projected only once.  Reserving space in "vertices"
+  // beforehand avoids reallocations.
+  void AppendProjectedChain(S2PointSpan chain,
+                            std::vector<R2Point>* vertices) const;
+
+  // Like AppendProjectedChain(), but also converts the edge from the last
+  // vertex of "loop" back to the first, so that the last vertex appended
+  // corresponds to loop[0].
+  void AppendProjectedLoop(S2PointLoopSpan loop,
+                           std::vector<R2Point>* vertices) const;
+
+  // Converts a chain of planar edges in the given projection to a chain of
+  // spherical geodesic edges and appends the vertices to "vertices".  This is
+  // equivalent to calling AppendUnprojected() for each edge, but faster since
+  // each input vertex is unprojected only once.
+  void AppendUnprojectedChain(absl::Span<const R2Point> chain,
+                              std::vector<S2Point>* vertices) const;
+
   // Returns the minimum supported tolerance (which corresponds to a distance
   // less than one micrometer on the Earth's surface).
   static S1Angle kMinTolerance();
@@ -95,6 +118,9 @@ class S2EdgeTessellator {
                        const R2Point& pb, const S2Point& b,
                        std::vector<R2Point>* vertices) const;
 
+  void AppendProjectedChain(S2PointSpan chain, bool is_loop,
+                            std::vector<R2Point>* vertices) const;
+
   absl::Nonnull<const S2::Projection*> proj_;
 
   // The given tolerance scaled by a constant fraction so that it can be
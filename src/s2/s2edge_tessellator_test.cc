@@ -40,6 +40,7 @@
 #include "s2/s2edge_distances.h"
 #include "s2/s2latlng.h"
 #include "s2/s2point.h"
+#include "s2/s2point_span.h"
 #include "s2/s2projections.h"
 #include "s2/s2random.h"
 #include "s2/s2testing.h"
@@ -581,3 +582,52 @@ TEST(S2EdgeTessellator, UnwrappingDcheckRegression) {
 }
 
 }  // namespace
+
+// Checks that the chain methods give the same results as tessellating each
+// edge separately.
+void TestChainsMatchEdges(absl::BitGenRef bitgen,
+                          const S2EdgeTessellator& tess,
+                          const S2::Projection& proj) {
+  vector<S2Point> chain;
+  for (int i = 0; i < 20; ++i) chain.push_back(s2random::Point(bitgen));
+
+  vector<R2Point> expected_projected, projected;
+  for (int i = 1; i < chain.size(); ++i) {
+    tess.AppendProjected(chain[i - 1], chain[i], &expected_projected);
+  }
+  tess.AppendProjectedChain(chain, &projected);
+  EXPECT_EQ(projected, expected_projected);
+
+  tess.AppendProjected(chain.back(), chain[0], &expected_projected);
+  projected.clear();
+  tess.AppendProjectedLoop(S2PointLoopSpan(chain), &projected);
+  EXPECT_EQ(projected, expected_projected);
+
+  vector<R2Point> planar;
+  for (const S2Point& p : chain) planar.push_back(proj.Project(p));
+  vector<S2Point> expected_unprojected, unprojected;
+  for (int i = 1; i < planar.size(); ++i) {
+    tess.AppendUnprojected(planar[i - 1], planar[i], &expected_unprojected);
+  }
+  tess.AppendUnprojectedChain(planar, &unprojected);
+  EXPECT_EQ(unprojected, expected_unprojected);
+
+  // Empty chains append nothing.
+  tess.AppendProjectedChain({}, &projected);
+  tess.AppendUnprojectedChain({}, &unprojected);
+  EXPECT_EQ(projected.size(), expected_projected.size());
+  EXPECT_EQ(unprojected.size(), expected_unprojected.size());
+}
+
+TEST(S2EdgeTessellator, ChainsMatchEdges) {
+  absl::BitGen bitgen(S2Testing::MakeTaggedSeedSeq(
+      "CHAINS_MATCH_EDGES",
+      absl::LogInfoStreamer(__FILE__, __LINE__).stream()));
+  S1Angle tolerance = S2Testing::MetersToAngle(10);
+  S2::PlateCarreeProjection plate_carree(180);
+  S2::MercatorProjection mercator(180);
+  TestChainsMatchEdges(bitgen, S2EdgeTessellator(&plate_carree, tolerance),
+                       plate_carree);
+  TestChainsMatchEdges(bitgen, S2EdgeTessellator(&mercator, tolerance),
+                       mercator);
+}
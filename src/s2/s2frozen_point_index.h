@@ -0,0 +1,354 @@
+// Copyright 2024 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef S2_S2FROZEN_POINT_INDEX_H_
+#define S2_S2FROZEN_POINT_INDEX_H_
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "absl/log/absl_check.h"
+#include "absl/numeric/bits.h"
+
+#include "s2/s2cell_id.h"
+#include "s2/s2cell_iterator.h"
+#include "s2/s2point.h"
+#include "s2/s2point_index.h"
+
+// S2FrozenPointIndex is an immutable alternative to S2PointIndex for
+// read-mostly workloads.  Points are added and then Build() is called once,
+// after which the index can be queried but not modified.  It can be used
+// with S2ClosestPointQuery by specifying it as the second template argument:
+//
+//   S2FrozenPointIndex<int> index;
+//   for (int i = 0; i < points.size(); ++i) {
+//     index.Add(points[i], i);
+//   }
+//   index.Build();
+//   S2ClosestPointQuery<int, S2FrozenPointIndex<int>> query(&index);
+//
+// Rather than a btree, the index consists of the points sorted by S2CellId
+// and stored in two contiguous arrays (one of cell ids and one of point
+// data).  Seeking uses a small search tree in Eytzinger (breadth-first)
+// order that contains every kBlockSize-th cell id, followed by a binary
+// search within one block of the cell id array.  This uses about 25% less
+// memory than S2PointIndex (there is no per-node overhead) and avoids most
+// of the cache misses incurred by seeking in a btree.
+//
+// The index has the same Iterator interface as S2PointIndex.  Points with
+// the same S2CellId are kept in the order they were added.
+//
+// REQUIRES: "Data" has default and copy constructors.
+// REQUIRES: "Data" has operator== and operator<.
+template <class Data = std::tuple<> /*empty class*/>
+class S2FrozenPointIndex {
+ public:
+  using PointData = typename S2PointIndex<Data>::PointData;
+
+  S2FrozenPointIndex() = default;
+
+  // Returns the number of points in the index.
+  // REQUIRES: Build() has been called.
+  int num_points() const;
+
+  // Adds the given point to the index.
+  // REQUIRES: Build() has not been called.
+  void Add(const S2Point& point, const Data& data);
+  void Add(const PointData& point_data);
+
+  // Convenience function for the case when Data is an empty class.
+  void Add(const S2Point& point);
+
+  // Adds all the points in the given S2PointIndex.
+  // REQUIRES: Build() has not been called.
+  void AddAll(const S2PointIndex<Data>& index);
+
+  // Sorts the points and builds the search tree.  Must be called exactly
+  // once, before the index is queried.
+  void Build();
+
+  // Returns the number of bytes currently occupied by the index.
+  size_t SpaceUsed() const;
+
+  class Iterator final : public S2CellIterator {
+   public:
+    // Default constructor; must be followed by a call to Init().
+    Iterator() = default;
+
+    // Convenience constructor that calls Init().
+    explicit Iterator(const S2FrozenPointIndex* index);
+
+    // Initializes an iterator for the given S2FrozenPointIndex.  If the index
+    // is non-empty, the iterator is positioned at the first cell.
+    void Init(const S2FrozenPointIndex* index);
+
+    // The S2CellId for the current index entry.
+    // REQUIRES: !done()
+    S2CellId id() const override;
+
+    // The point associated with the current index entry.
+    // REQUIRES: !done()
+    const S2Point& point() const;
+
+    // The client-supplied data associated with the current index entry.
+    // REQUIRES: !done()
+    const Data& data() const;
+
+    // The (S2Point, data) pair associated with the current index entry.
+    const PointData& point_data() const;
+
+    // Returns true if the iterator is positioned past the last index entry.
+    bool done() const override;
+
+    // Positions the iterator at the first index entry (if any).
+    void Begin() override;
+
+    // Positions the iterator so that done() is true.
+    void Finish() override;
+
+    // Advances the iterator to the next index entry.
+    // REQUIRES: !done()
+    void Next() override;
+
+    // If the iterator is already positioned at the beginning, returns false.
+    // Otherwise positions the iterator at the previous entry and returns true.
+    bool Prev() override;
+
+    // Positions the iterator at the first entry with id() >= target, or at the
+    // end of the index if no such entry exists.
+    void Seek(S2CellId target) override;
+
+    bool Locate(const S2Point& target) override {
+      return LocateImpl(*this, target);
+    }
+
+    S2CellRelation Locate(S2CellId target) override {
+      return LocateImpl(*this, target);
+    }
+
+   private:
+    const S2FrozenPointIndex* index_ = nullptr;
+    int pos_ = 0;
+  };
+
+ private:
+  friend class Iterator;
+
+  // The number of consecutive cell ids represented by each search tree node.
+  static constexpr int kBlockSize = 16;
+
+  // Returns the position of the first cell id >= target.
+  int LowerBound(S2CellId target) const;
+
+  bool built_ = false;
+
+  // The points sorted by S2CellId.  Before Build() is called, "points_"
+  // holds the points in the order they were added and "ids_" is empty.
+  std::vector<S2CellId> ids_;
+  std::vector<PointData> points_;
+
+  // The first cell id of every block, stored in Eytzinger order starting at
+  // tree_[1] together with the block number.  (tree_[0] is unused.)
+  struct TreeNode {
+    S2CellId id;
+    int32_t block;
+  };
+  std::vector<TreeNode> tree_;
+
+  S2FrozenPointIndex(const S2FrozenPointIndex&) = delete;
+  void operator=(const S2FrozenPointIndex&) = delete;
+};
+
+
+//////////////////   Implementation details follow   ////////////////////
+
+template <class Data>
+inline int S2FrozenPointIndex<Data>::num_points() const {
+  ABSL_DCHECK(built_);
+  return points_.size();
+}
+
+template <class Data>
+inline void S2FrozenPointIndex<Data>::Add(const PointData& point_data) {
+  ABSL_DCHECK(!built_);
+  points_.push_back(point_data);
+}
+
+template <class Data>
+inline void S2FrozenPointIndex<Data>::Add(const S2Point& point,
+                                          const Data& data) {
+  Add(PointData(point, data));
+}
+
+template <class Data>
+inline void S2FrozenPointIndex<Data>::Add(const S2Point& point) {
+  static_assert(std::is_empty<Data>::value, "Data must be empty");
+  Add(point, {});
+}
+
+template <class Data>
+void S2FrozenPointIndex<Data>::AddAll(const S2PointIndex<Data>& index) {
+  points_.reserve(points_.size() + index.num_points());
+  for (typename S2PointIndex<Data>::Iterator it(&index); !it.done();
+       it.Next()) {
+    Add(it.point_data());
+  }
+}
+
+template <class Data>
+void S2FrozenPointIndex<Data>::Build() {
+  ABSL_DCHECK(!built_);
+  built_ = true;
+
+  // Sort the points by cell id, keeping points with the same cell id in the
+  // order they were added (as S2PointIndex does).
+  const int n = points_.size();
+  std::vector<std::pair<S2CellId, int>> order;
+  order.reserve(n);
+  for (int i = 0; i < n; ++i) {
+    order.emplace_back(S2CellId(points_[i].point()), i);
+  }
+  std::sort(order.begin(), order.end());
+  std::vector<PointData> sorted_points;
+  sorted_points.reserve(n);
+  ids_.reserve(n);
+  for (const auto& [id, i] : order) {
+    ids_.push_back(id);
+    sorted_points.push_back(points_[i]);
+  }
+  points_.swap(sorted_points);
+
+  // Build the Eytzinger search tree with an in-order traversal, which visits
+  // the nodes in increasing order of block number.
+  const int num_blocks = (n + kBlockSize - 1) / kBlockSize;
+  tree_.resize(num_blocks + 1);
+  int block = 0;
+  auto fill = [&](auto& self, int k) -> void {
+    if (k > num_blocks) return;
+    self(self, 2 * k);
+    tree_[k] = {ids_[block * kBlockSize], block};
+    ++block;
+    self(self, 2 * k + 1);
+  };
+  fill(fill, 1);
+}
+
+template <class Data>
+size_t S2FrozenPointIndex<Data>::SpaceUsed() const {
+  return sizeof(*this) + ids_.capacity() * sizeof(S2CellId) +
+         points_.capacity() * sizeof(PointData) +
+         tree_.capacity() * sizeof(TreeNode);
+}
+
+template <class Data>
+inline int S2FrozenPointIndex<Data>::LowerBound(S2CellId target) const {
+  ABSL_DCHECK(built_);
+  // Find the first block whose first cell id is >= target.  Every cell id
+  // before that block's first cell id is < target, except possibly those
+  // in the previous block, so the result is in the previous block.
+  const size_t num_nodes = tree_.size() - 1;
+  size_t k = 1;
+  while (k <= num_nodes) {
+    k = 2 * k + (tree_[k].id < target);
+  }
+  // Undo the trailing right turns and then one left turn ("k" becomes 0 if
+  // every node is < target).
+  k >>= absl::countr_one(k) + 1;
+  const int block = (k == 0) ? tree_.size() - 1 : tree_[k].block;
+  if (block == 0) return 0;
+  const auto first = ids_.begin() + (block - 1) * kBlockSize + 1;
+  const auto last = ids_.begin() + std::min<size_t>(block * kBlockSize,
+                                                    ids_.size());
+  return std::lower_bound(first, last, target) - ids_.begin();
+}
+
+template <class Data>
+inline S2FrozenPointIndex<Data>::Iterator::Iterator(
+    const S2FrozenPointIndex<Data>* index) {
+  Init(index);
+}
+
+template <class Data>
+inline void S2FrozenPointIndex<Data>::Iterator::Init(
+    const S2FrozenPointIndex<Data>* index) {
+  ABSL_DCHECK(index->built_);
+  index_ = index;
+  pos_ = 0;
+}
+
+template <class Data>
+inline S2CellId S2FrozenPointIndex<Data>::Iterator::id() const {
+  ABSL_DCHECK(!done());
+  return index_->ids_[pos_];
+}
+
+template <class Data>
+inline const S2Point& S2FrozenPointIndex<Data>::Iterator::point() const {
+  ABSL_DCHECK(!done());
+  return index_->points_[pos_].point();
+}
+
+template <class Data>
+inline const Data& S2FrozenPointIndex<Data>::Iterator::data() const {
+  ABSL_DCHECK(!done());
+  return index_->points_[pos_].data();
+}
+
+template <class Data>
+inline const typename S2FrozenPointIndex<Data>::PointData&
+S2FrozenPointIndex<Data>::Iterator::point_data() const {
+  ABSL_DCHECK(!done());
+  return index_->points_[pos_];
+}
+
+template <class Data>
+inline bool S2FrozenPointIndex<Data>::Iterator::done() const {
+  return pos_ == static_cast<int>(index_->ids_.size());
+}
+
+template <class Data>
+inline void S2FrozenPointIndex<Data>::Iterator::Begin() {
+  pos_ = 0;
+}
+
+template <class Data>
+inline void S2FrozenPointIndex<Data>::Iterator::Finish() {
+  pos_ = index_->ids_.size();
+}
+
+template <class Data>
+inline void S2FrozenPointIndex<Data>::Iterator::Next() {
+  ABSL_DCHECK(!done());
+  ++pos_;
+}
+
+template <class Data>
+inline bool S2FrozenPointIndex<Data>::Iterator::Prev() {
+  if (pos_ == 0) return false;
+  --pos_;
+  return true;
+}
+
+template <class Data>
+inline void S2FrozenPointIndex<Data>::Iterator::Seek(S2CellId target) {
+  pos_ = index_->LowerBound(target);
+}
+
+#endif  // S2_S2FROZEN_POINT_INDEX_H_
@@ -0,0 +1,152 @@
+// Copyright 2024 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "s2/s2frozen_point_index.h"
+
+#include <vector>
+
+#include <gtest/gtest.h>
+#include "absl/log/log_streamer.h"
+#include "absl/random/random.h"
+#include "s2/s1angle.h"
+#include "s2/s2cap.h"
+#include "s2/s2cell_id.h"
+#include "s2/s2closest_point_query.h"
+#include "s2/s2point.h"
+#include "s2/s2point_index.h"
+#include "s2/s2random.h"
+#include "s2/s2testing.h"
+
+using std::vector;
+
+namespace {
+
+using Index = S2PointIndex<int>;
+using FrozenIndex = S2FrozenPointIndex<int>;
+
+// Builds a frozen copy of "index" and checks that iterating through it and
+// seeking to arbitrary cell ids gives the same results as "index".
+void ExpectSameAsPointIndex(const Index& index, absl::BitGenRef bitgen) {
+  FrozenIndex frozen;
+  frozen.AddAll(index);
+  frozen.Build();
+  ASSERT_EQ(frozen.num_points(), index.num_points());
+
+  FrozenIndex::Iterator frozen_it(&frozen);
+  Index::Iterator it(&index);
+  EXPECT_FALSE(frozen_it.Prev());
+  for (; !it.done(); it.Next(), frozen_it.Next()) {
+    ASSERT_FALSE(frozen_it.done());
+    EXPECT_EQ(frozen_it.id(), it.id());
+    EXPECT_EQ(frozen_it.point_data(), it.point_data());
+  }
+  EXPECT_TRUE(frozen_it.done());
+
+  // Seek to the cell id of every indexed point, to the cell ids immediately
+  // before and after it, and to random cell ids at various levels.
+  vector<S2CellId> targets = {S2CellId::Begin(S2CellId::kMaxLevel),
+                              S2CellId::End(S2CellId::kMaxLevel)};
+  for (it.Begin(); !it.done(); it.Next()) {
+    targets.push_back(it.id());
+    targets.push_back(it.id().prev());
+    targets.push_back(it.id().next());
+  }
+  for (int i = 0; i < 100; ++i) {
+    targets.push_back(s2random::CellId(bitgen).range_min());
+  }
+  for (S2CellId target : targets) {
+    it.Seek(target);
+    frozen_it.Seek(target);
+    ASSERT_EQ(frozen_it.done(), it.done());
+    if (!it.done()) EXPECT_EQ(frozen_it.id(), it.id());
+  }
+}
+
+TEST(S2FrozenPointIndex, NoPoints) {
+  absl::BitGen bitgen;
+  Index index;
+  ExpectSameAsPointIndex(index, bitgen);
+}
+
+TEST(S2FrozenPointIndex, DuplicatePoints) {
+  absl::BitGen bitgen;
+  Index index;
+  for (int i = 0; i < 100; ++i) {
+    index.Add(S2Point(1, 0, 0), i);
+  }
+  ExpectSameAsPointIndex(index, bitgen);
+}
+
+TEST(S2FrozenPointIndex, RandomPoints) {
+  absl::BitGen bitgen(S2Testing::MakeTaggedSeedSeq(
+      "RANDOM_POINTS",
+      absl::LogInfoStreamer(__FILE__, __LINE__).stream()));
+  // Test a range of sizes so that the search tree is complete, incomplete,
+  // and has a partial last block.
+  for (int num_points : {1, 15, 16, 17, 100, 255, 256, 1000}) {
+    Index index;
+    for (int i = 0; i < num_points; ++i) {
+      index.Add(s2random::Point(bitgen), i);
+    }
+    ExpectSameAsPointIndex(index, bitgen);
+  }
+}
+
+TEST(S2FrozenPointIndex, ClosestPointQueryMatchesPointIndex) {
+  absl::BitGen bitgen(S2Testing::MakeTaggedSeedSeq(
+      "CLOSEST_POINT_QUERY_MATCHES_POINT_INDEX",
+      absl::LogInfoStreamer(__FILE__, __LINE__).stream()));
+  S2Cap cap(s2random::Point(bitgen), S2Testing::KmToAngle(100));
+  Index index;
+  FrozenIndex frozen;
+  for (int i = 0; i < 10000; ++i) {
+    S2Point p = s2random::SamplePoint(bitgen, cap);
+    index.Add(p, i);
+    frozen.Add(p, i);
+  }
+  frozen.Build();
+
+  S2ClosestPointQuery<int> query(&index);
+  S2ClosestPointQuery<int, FrozenIndex> frozen_query(&frozen);
+  for (auto* options : {query.mutable_options(),
+                        frozen_query.mutable_options()}) {
+    options->set_max_results(10);
+    options->set_max_distance(S2Testing::KmToAngle(5));
+  }
+  for (int i = 0; i < 100; ++i) {
+    S2ClosestPointQueryPointTarget target(s2random::SamplePoint(bitgen, cap));
+    auto expected = query.FindClosestPoints(&target);
+    auto actual = frozen_query.FindClosestPoints(&target);
+    ASSERT_EQ(actual.size(), expected.size());
+    for (size_t j = 0; j < expected.size(); ++j) {
+      EXPECT_EQ(actual[j].distance(), expected[j].distance());
+      EXPECT_EQ(actual[j].data(), expected[j].data());
+    }
+  }
+}
+
+TEST(S2FrozenPointIndex, SpaceUsed) {
+  absl::BitGen bitgen;
+  Index index;
+  for (int i = 0; i < 10000; ++i) {
+    index.Add(s2random::Point(bitgen), i);
+  }
+  FrozenIndex frozen;
+  frozen.AddAll(index);
+  frozen.Build();
+  EXPECT_LT(frozen.SpaceUsed(), index.SpaceUsed());
+}
+
+}  // namespace
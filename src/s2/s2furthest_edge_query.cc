@@ -15,12 +15,20 @@
 
 #include "s2/s2furthest_edge_query.h"
 
+#include <memory>
+#include <utility>
 #include <vector>
 
+#include "absl/log/absl_check.h"
+#include "absl/types/span.h"
+#include "s2/internal/s2parallel.h"
+#include "s2/internal/s2point_order.h"
 #include "s2/s1angle.h"
 #include "s2/s1chord_angle.h"
+#include "s2/s2cell_id.h"
 #include "s2/s2closest_edge_query_base.h"
 #include "s2/s2edge_distances.h"
+#include "s2/s2point.h"
 
 using std::vector;
 
@@ -82,9 +90,49 @@ void S2FurthestEdgeQuery::FindFurthestEdges(
   }
 }
 
+void S2FurthestEdgeQuery::FindFurthestEdges(
+    absl::Span<const S2Point> points, vector<vector<Result>>* results,
+    int num_threads) {
+  ABSL_DCHECK_GE(num_threads, 1);
+  // Sort the points by leaf cell id, so that each chunk consists of points
+  // that are close together and tend to visit the same index cells.
+  const auto order = s2internal::SortPointsByCellId(points);
+
+  // Chunks are small enough to balance the load between threads, but large
+  // enough that handing them out is cheap compared to querying them.
+  constexpr int kChunkSize = 64;
+  const int num_points = points.size();
+  results->resize(num_points);
+  // Worker 0 uses this query's own state, so that the single-threaded case
+  // does not need to initialize a new query.
+  std::vector<std::unique_ptr<Base>> worker_bases(
+      s2internal::NumChunkWorkers(num_threads, num_points, kChunkSize));
+  s2internal::ParallelForChunks(
+      num_threads, num_points, kChunkSize, [&](int worker, int begin, int end) {
+        Base* base = &base_;
+        if (worker > 0) {
+          if (!worker_bases[worker]) {
+            worker_bases[worker] = std::make_unique<Base>(&index());
+          }
+          base = worker_bases[worker].get();
+        }
+        vector<Base::Result> base_results;
+        for (int k = begin; k < end; ++k) {
+          const int i = order[k].second;
+          PointTarget target(points[i]);
+          base->FindClosestEdges(&target, options_, &base_results);
+          vector<Result>* point_results = &(*results)[i];
+          point_results->clear();
+          for (const Base::Result& result : base_results) {
+            point_results->push_back(Result(result));
+          }
+        }
+      });
+}
+
 S2FurthestEdgeQuery::Result S2FurthestEdgeQuery::FindFurthestEdge(
     Target* target) {
-  static_assert(sizeof(Options) <= 32, "Consider not copying Options here");
+  static_assert(sizeof(Options) <= 48, "Consider not copying Options here");
   Options tmp_options = options_;
   tmp_options.set_max_results(1);
   Base::Result base_result = base_.FindClosestEdge(target, tmp_options);
@@ -93,7 +141,7 @@ S2FurthestEdgeQuery::Result S2FurthestEdgeQuery::FindFurthestEdge(
 
 bool S2FurthestEdgeQuery::IsDistanceGreater(
     Target* target, S1ChordAngle limit) {
-  static_assert(sizeof(Options) <= 32, "Consider not copying Options here");
+  static_assert(sizeof(Options) <= 48, "Consider not copying Options here");
   Options tmp_options = options_;
   tmp_options.set_max_results(1);
   tmp_options.set_min_distance(limit);
@@ -103,7 +151,7 @@ bool S2FurthestEdgeQuery::IsDistanceGreater(
 
 bool S2FurthestEdgeQuery::IsDistanceGreaterOrEqual(
     Target* target, S1ChordAngle limit) {
-  static_assert(sizeof(Options) <= 32, "Consider not copying Options here");
+  static_assert(sizeof(Options) <= 48, "Consider not copying Options here");
   Options tmp_options = options_;
   tmp_options.set_max_results(1);
   tmp_options.set_inclusive_min_distance(limit);
@@ -113,7 +161,7 @@ bool S2FurthestEdgeQuery::IsDistanceGreaterOrEqual(
 
 bool S2FurthestEdgeQuery::IsConservativeDistanceGreaterOrEqual(
     Target* target, S1ChordAngle limit) {
-  static_assert(sizeof(Options) <= 32, "Consider not copying Options here");
+  static_assert(sizeof(Options) <= 48, "Consider not copying Options here");
   Options tmp_options = options_;
   tmp_options.set_max_results(1);
   tmp_options.set_conservative_min_distance(limit);
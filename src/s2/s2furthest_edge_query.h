@@ -24,6 +24,7 @@
 
 #include "absl/base/macros.h"
 #include "absl/container/inlined_vector.h"
+#include "absl/types/span.h"
 #include "s2/_fp_contract_off.h"  // IWYU pragma: keep
 #include "s2/s1angle.h"
 #include "s2/s1chord_angle.h"
@@ -159,6 +160,8 @@ class S2FurthestEdgeQuery {
     using Base::Options::set_max_error;
     using Base::Options::max_distance;
     using Base::Options::max_error;
+    using Base::Options::set_max_relative_error;
+    using Base::Options::max_relative_error;
   };
 
   // "Target" represents the geometry to which the distance is measured.
@@ -298,6 +301,10 @@ class S2FurthestEdgeQuery {
   // Returns a reference to the underlying S2ShapeIndex.
   const S2ShapeIndex& index() const;
 
+  // Returns true if the most recent query was stopped early because
+  // Options::deadline() had passed.
+  bool deadline_exceeded() const { return base_.deadline_exceeded(); }
+
   // Returns the query options.  Options can be modified between queries.
   const Options& options() const;
   Options* mutable_options();
@@ -316,6 +323,27 @@ class S2FurthestEdgeQuery {
   // since it does not require allocating a new vector on each call.
   void FindFurthestEdges(Target* target, std::vector<Result>* results);
 
+  // Batch version of FindFurthestEdges() for point targets.  Returns a vector
+  // whose i-th element contains the furthest edges to points[i], exactly as
+  // if FindFurthestEdges() had been called with a PointTarget for each point.
+  //
+  // Up to "num_threads" threads (including the calling thread) are used, each
+  // with its own query state.  The points are sorted by S2CellId and divided
+  // into small chunks of nearby points, which are handed out to the threads
+  // dynamically.  Nearby points have nearby furthest edges, so this also
+  // improves the locality of the index cells visited by each thread.
+  //
+  // REQUIRES: num_threads >= 1
+  std::vector<std::vector<Result>> FindFurthestEdges(
+      absl::Span<const S2Point> points, int num_threads = 1);
+
+  // Like the method above, but stores the results in "results".  The memory
+  // used by its elements is reused, so that calling this method repeatedly
+  // with the same "results" vector usually does not allocate memory.
+  void FindFurthestEdges(absl::Span<const S2Point> points,
+                         std::vector<std::vector<Result>>* results,
+                         int num_threads = 1);
+
   //////////////////////// Convenience Methods ////////////////////////
 
   // Returns the furthest edge to the target.  If no edge satisfies the search
@@ -455,6 +483,14 @@ S2FurthestEdgeQuery::FindFurthestEdges(Target* target) {
   return results;
 }
 
+inline std::vector<std::vector<S2FurthestEdgeQuery::Result>>
+S2FurthestEdgeQuery::FindFurthestEdges(absl::Span<const S2Point> points,
+                                       int num_threads) {
+  std::vector<std::vector<S2FurthestEdgeQuery::Result>> results;
+  FindFurthestEdges(points, &results, num_threads);
+  return results;
+}
+
 inline S1ChordAngle S2FurthestEdgeQuery::GetDistance(Target* target) {
   return FindFurthestEdge(target).distance();
 }
@@ -527,6 +527,38 @@ static void TestWithIndexFactory(const s2testing::ShapeIndexFactory& factory,
 }
 
 static constexpr int kNumIndexes = 50;
+TEST(S2FurthestEdgeQuery, BatchPointTargets) {
+  absl::BitGen bitgen(S2Testing::MakeTaggedSeedSeq(
+      "BATCH_POINT_TARGETS",
+      absl::LogInfoStreamer(__FILE__, __LINE__).stream()));
+  S2Cap index_cap(s2random::Point(bitgen), S2Testing::KmToAngle(100));
+  MutableS2ShapeIndex index;
+  s2testing::FractalLoopShapeIndexFactory(bitgen).AddEdges(index_cap, 1000,
+                                                           &index);
+  vector<S2Point> targets;
+  for (int i = 0; i < 1000; ++i) {
+    targets.push_back(s2random::Point(bitgen));
+  }
+
+  S2FurthestEdgeQuery query(&index);
+  query.mutable_options()->set_max_results(5);
+  for (int num_threads : {1, 4}) {
+    auto batch = query.FindFurthestEdges(targets, num_threads);
+    ASSERT_EQ(batch.size(), targets.size());
+    for (size_t i = 0; i < targets.size(); ++i) {
+      S2FurthestEdgeQuery::PointTarget target(targets[i]);
+      auto expected = query.FindFurthestEdges(&target);
+      ASSERT_EQ(batch[i].size(), expected.size());
+      for (size_t j = 0; j < expected.size(); ++j) {
+        EXPECT_EQ(batch[i][j].distance(), expected[j].distance());
+        EXPECT_EQ(batch[i][j].shape_id(), expected[j].shape_id());
+        EXPECT_EQ(batch[i][j].edge_id(), expected[j].edge_id());
+      }
+    }
+  }
+  EXPECT_TRUE(query.FindFurthestEdges(vector<S2Point>{}, 4).empty());
+}
+
 static constexpr int kNumEdges = 100;
 static constexpr int kNumQueries = 200;
 
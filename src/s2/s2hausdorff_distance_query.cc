@@ -15,47 +15,194 @@
 
 #include "s2/s2hausdorff_distance_query.h"
 
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include "absl/log/absl_check.h"
 #include "absl/types/optional.h"
+#include "s2/internal/s2parallel.h"
 #include "s2/s1chord_angle.h"
 #include "s2/s2closest_edge_query.h"
+#include "s2/s2edge_distances.h"
 #include "s2/s2point.h"
-#include "s2/s2predicates.h"
 #include "s2/s2shape.h"
 #include "s2/s2shape_index.h"
 
 using DirectedResult = S2HausdorffDistanceQuery::DirectedResult;
 using Options = S2HausdorffDistanceQuery::Options;
 using Result = S2HausdorffDistanceQuery::Result;
+using std::vector;
 
 namespace {
-// This internally used function computes the closest edge distance from point
-// to the source index via closest_edge_query, and, if necessary, updates the
-// max_distance, the target_point and the source_point.
-void UpdateMaxDistance(const S2Point& point,
-                       S2ClosestEdgeQuery& closest_edge_query,
-                       S1ChordAngle& max_distance, S2Point& target_point,
-                       S2Point& source_point) {
-  // In case we already have a valid result, it can be used as the lower
-  // bound estimate for the final Hausdorff distance. Therefore, if the
-  // distance between the current target point and the last source point
-  // does not exceed this lower bound, we can safely skip this target point, not
-  // updating the maximum distance.
-  if (!max_distance.is_negative() &&
-      s2pred::CompareDistance(point, source_point, max_distance) <= 0) {
-    return;
+
+// Target vertices are processed in tasks of approximately this many
+// vertices.  This is small enough to balance the load between threads but
+// large enough to make the per-task overhead negligible.
+constexpr int kVerticesPerTask = 256;
+
+// A range of vertices within one chain of a target shape.
+struct VertexRange {
+  const S2Shape* shape;
+  S2Shape::Chain chain;
+  int begin, end;
+};
+
+// Divides the vertices of "index" into tasks.  Task "i" consists of the
+// ranges [task_starts[i], task_starts[i + 1]).
+void GetVertexTasks(const S2ShapeIndex& index, vector<VertexRange>* ranges,
+                    vector<int>* task_starts) {
+  int task_vertices = kVerticesPerTask;
+  for (const S2Shape* shape : index) {
+    for (int i = 0; i < shape->num_chains(); ++i) {
+      S2Shape::Chain chain = shape->chain(i);
+      int num_vertices = shape->vertices(chain).num_vertices();
+      for (int begin = 0; begin < num_vertices;) {
+        if (task_vertices >= kVerticesPerTask) {
+          task_starts->push_back(ranges->size());
+          task_vertices = 0;
+        }
+        int end = std::min(num_vertices,
+                           begin + kVerticesPerTask - task_vertices);
+        ranges->push_back(VertexRange{shape, chain, begin, end});
+        task_vertices += end - begin;
+        begin = end;
+      }
+    }
   }
+  task_starts->push_back(ranges->size());
+}
+
+// The state shared by all threads that compute one directed distance.
+struct SharedState {
+  // The maximum distance found so far by any thread (represented by its
+  // length2() value).  Vertices that are within this distance of the source
+  // index cannot affect the result, so they are skipped.
+  std::atomic<double> max_length2{S1ChordAngle::Negative().length2()};
+
+  // Set when a vertex further than the distance limit has been found.
+  std::atomic<bool> limit_exceeded{false};
+};
+
+// Processes target vertices for one thread.
+class VertexProcessor {
+ public:
+  VertexProcessor(const S2ShapeIndex* source, const Options& options,
+                  S1ChordAngle distance_limit, SharedState* shared)
+      : closest_query_(source),
+        bounded_query_(source),
+        distance_limit_(distance_limit),
+        shared_(shared) {
+    closest_query_.mutable_options()->set_max_results(1);
+    closest_query_.mutable_options()->set_include_interiors(
+        options.include_interiors());
+    // The bounded query returns any source edge within the current bound.
+    bounded_query_.mutable_options()->set_max_results(1);
+    bounded_query_.mutable_options()->set_include_interiors(
+        options.include_interiors());
+    bounded_query_.mutable_options()->set_max_error(S1ChordAngle::Straight());
+  }
+
+  // Processes the given point.  Returns false if the distance limit has
+  // been exceeded.
+  bool Process(const S2Point& point);
+
+  S1ChordAngle max_distance() const { return max_distance_; }
+  const S2Point& target_point() const { return target_point_; }
+  bool saw_vertex() const { return saw_vertex_; }
+
+ private:
+  // Returns true if "point" is within "bound" of the source index.  Also
+  // updates source_edge_ if a new nearby source edge is found.
+  bool IsWithin(const S2Point& point, S1ChordAngle bound);
+
+  // Remembers the source edge of the given result (unless it represents a
+  // polygon interior) so that it can be tested first for the next vertex.
+  void SetSourceEdge(const S2ClosestEdgeQuery::Result& result);
+
+  S2ClosestEdgeQuery closest_query_;
+  S2ClosestEdgeQuery bounded_query_;
+  S1ChordAngle distance_limit_;
+  SharedState* shared_;
+
+  S1ChordAngle max_distance_ = S1ChordAngle::Negative();
+  S2Point target_point_;
+  bool saw_vertex_ = false;
+
+  // The source edge that was found for the previous vertex (if any).
+  // Consecutive target vertices are often close to the same part of the
+  // source geometry, so this edge is tested first.
+  S2Shape::Edge source_edge_;
+  bool have_source_edge_ = false;
+};
+
+void VertexProcessor::SetSourceEdge(const S2ClosestEdgeQuery::Result& result) {
+  have_source_edge_ = !result.is_interior();
+  if (have_source_edge_) {
+    source_edge_ =
+        closest_query_.index().shape(result.shape_id())->edge(result.edge_id());
+  }
+}
+
+bool VertexProcessor::IsWithin(const S2Point& point, S1ChordAngle bound) {
+  // The distance to the cached edge is computed exactly as S2ClosestEdgeQuery
+  // computes it, so a vertex is accepted only if GetDirectedResult() would
+  // also find it to be within "bound".
+  if (have_source_edge_) {
+    S1ChordAngle distance = S1ChordAngle::Infinity();
+    S2::UpdateMinDistance(point, source_edge_.v0, source_edge_.v1, &distance);
+    if (distance <= bound) return true;
+  }
+  bounded_query_.mutable_options()->set_inclusive_max_distance(bound);
+  S2ClosestEdgeQuery::PointTarget target(point);
+  const S2ClosestEdgeQuery::Result result =
+      bounded_query_.FindClosestEdge(&target);
+  if (result.is_empty()) return false;
+  SetSourceEdge(result);
+  return true;
+}
+
+bool VertexProcessor::Process(const S2Point& point) {
+  saw_vertex_ = true;
+  if (!distance_limit_.is_negative()) {
+    // Threshold mode: we only need to know whether some source edge is within
+    // the limit, which is much cheaper than finding the closest edge.
+    if (IsWithin(point, distance_limit_)) return true;
+    max_distance_ = S1ChordAngle::Infinity();
+    target_point_ = point;
+    shared_->limit_exceeded.store(true, std::memory_order_relaxed);
+    return false;
+  }
+
+  // In case we already have a valid result, it can be used as the lower
+  // bound estimate for the final Hausdorff distance.  Therefore, if the
+  // target point is within this lower bound of the source index, we can
+  // safely skip it.
+  S1ChordAngle bound = std::max(
+      max_distance_, S1ChordAngle::FromLength2(
+                         shared_->max_length2.load(std::memory_order_relaxed)));
+  if (!bound.is_negative() && IsWithin(point, bound)) return true;
 
   // Find the closest edge and the closest point in the source geometry
   // to the target point.
   S2ClosestEdgeQuery::PointTarget target(point);
   const S2ClosestEdgeQuery::Result closest_edge =
-      closest_edge_query.FindClosestEdge(&target);
-  if (!closest_edge.is_empty() && max_distance < closest_edge.distance()) {
-    max_distance = closest_edge.distance();
-    target_point = point;
-    source_point = closest_edge_query.Project(point, closest_edge);
+      closest_query_.FindClosestEdge(&target);
+  if (!closest_edge.is_empty() && max_distance_ < closest_edge.distance()) {
+    max_distance_ = closest_edge.distance();
+    target_point_ = point;
+    SetSourceEdge(closest_edge);
+    double length2 = max_distance_.length2();
+    double current = shared_->max_length2.load(std::memory_order_relaxed);
+    while (current < length2 && !shared_->max_length2.compare_exchange_weak(
+                                    current, length2,
+                                    std::memory_order_relaxed)) {
+    }
   }
+  return true;
 }
+
 }  // namespace
 
 S2HausdorffDistanceQuery::S2HausdorffDistanceQuery(
@@ -100,61 +247,85 @@ S1ChordAngle S2HausdorffDistanceQuery::GetDirectedDistance(
 
 absl::optional<DirectedResult> S2HausdorffDistanceQuery::GetDirectedResult(
     const S2ShapeIndex* target, const S2ShapeIndex* source) const {
-  S2ClosestEdgeQuery closest_edge_query(source);
-  closest_edge_query.mutable_options()->set_max_results(1);
-  closest_edge_query.mutable_options()->set_include_interiors(
-      options_.include_interiors());
-  S1ChordAngle max_distance = S1ChordAngle::Negative();
-  S2Point source_point, target_point;
-
-  // This approximation of Haussdorff distance is based on computing closest
-  // point distances from the _vertices_ of the target index to _edges_ of the
-  // source index.  Hence we iterate over all shapes in the target index, then
-  // over all chains in those shapes, then over all edges in those chains, and
-  // then over the edges' vertices.
-  for (const S2Shape* shape : *target) {
-    for (auto chain : shape->chains()) {
-      for (const S2Point& vertex : shape->vertices(chain)) {
-        UpdateMaxDistance(vertex, closest_edge_query, max_distance,
-                          target_point, source_point);
-      }
-    }
-  }
-
-  if (max_distance.is_negative()) {
-    return absl::nullopt;
-  } else {
-    return DirectedResult(max_distance, target_point);
-  }
+  return GetDirectedResultImpl(target, source, S1ChordAngle::Negative());
 }
 
 bool S2HausdorffDistanceQuery::IsDirectedDistanceLess(
     const S2ShapeIndex* target, const S2ShapeIndex* source,
     S1ChordAngle distance_limit) const {
-  S2ClosestEdgeQuery closest_edge_query(source);
-  closest_edge_query.mutable_options()->set_max_results(1);
-  closest_edge_query.mutable_options()->set_include_interiors(
-      options_.include_interiors());
-  S1ChordAngle max_distance = S1ChordAngle::Negative();
-  S2Point source_point, target_point;
+  // A negative limit can never be satisfied.
+  if (distance_limit.is_negative()) return false;
+  absl::optional<DirectedResult> result =
+      GetDirectedResultImpl(target, source, distance_limit);
+  return result.has_value() && !result->distance().is_infinity();
+}
+
+absl::optional<DirectedResult> S2HausdorffDistanceQuery::GetDirectedResultImpl(
+    const S2ShapeIndex* target, const S2ShapeIndex* source,
+    S1ChordAngle distance_limit) const {
+  ABSL_DCHECK_GE(options_.num_threads(), 1);
 
   // This approximation of Haussdorff distance is based on computing closest
   // point distances from the _vertices_ of the target index to _edges_ of the
   // source index.  Hence we iterate over all shapes in the target index, then
   // over all chains in those shapes, then over all edges in those chains, and
   // then over the edges' vertices.
-  for (const S2Shape* shape : *target) {
-    for (auto chain : shape->chains()) {
-      for (const S2Point& vertex : shape->vertices(chain)) {
-        UpdateMaxDistance(vertex, closest_edge_query, max_distance,
-                          target_point, source_point);
-        if (max_distance > distance_limit) {
+  vector<VertexRange> ranges;
+  vector<int> task_starts;
+  GetVertexTasks(*target, &ranges, &task_starts);
+  const int num_tasks = task_starts.size() - 1;
+
+  // Each thread processes tasks until they are exhausted (or the distance
+  // limit has been exceeded), using its own pair of queries.
+  SharedState shared;
+  vector<std::unique_ptr<VertexProcessor>> processors;
+  const int num_workers =
+      s2internal::NumChunkWorkers(options_.num_threads(), num_tasks, 1);
+  for (int t = 0; t < num_workers; ++t) {
+    processors.push_back(std::make_unique<VertexProcessor>(
+        source, options_, distance_limit, &shared));
+  }
+  s2internal::ParallelForChunks(
+      options_.num_threads(), num_tasks, 1, [&](int t, int i, int) {
+        if (shared.limit_exceeded.load(std::memory_order_relaxed)) {
           return false;
         }
-      }
+        VertexProcessor& processor = *processors[t];
+        for (int r = task_starts[i]; r < task_starts[i + 1]; ++r) {
+          const VertexRange& range = ranges[r];
+          S2Shape::ChainVertexIterator it(range.shape, range.chain,
+                                          range.begin);
+          for (int j = range.begin; j < range.end; ++j, ++it) {
+            if (!processor.Process(*it)) return false;
+          }
+        }
+        return true;
+      });
+
+  // Combine the results of all threads.  Ties are broken in favor of the
+  // lowest thread number, so that the result is deterministic when only one
+  // thread is used.
+  S1ChordAngle max_distance = S1ChordAngle::Negative();
+  S2Point target_point;
+  bool saw_vertex = false;
+  for (const auto& processor : processors) {
+    saw_vertex |= processor->saw_vertex();
+    if (max_distance < processor->max_distance()) {
+      max_distance = processor->max_distance();
+      target_point = processor->target_point();
     }
   }
-  return !max_distance.is_negative();
+  if (!distance_limit.is_negative()) {
+    // In threshold mode, every vertex was within the limit unless one of the
+    // threads recorded an infinite distance.
+    if (!saw_vertex) return absl::nullopt;
+    if (max_distance.is_negative()) max_distance = distance_limit;
+  }
+  if (max_distance.is_negative()) {
+    return absl::nullopt;
+  } else {
+    return DirectedResult(max_distance, target_point);
+  }
 }
 
 bool S2HausdorffDistanceQuery::IsDistanceLess(
@@ -104,8 +104,21 @@ class S2HausdorffDistanceQuery {
       include_interiors_ = include_interiors;
     }
 
+    // The maximum number of threads (including the calling thread) used to
+    // process the target vertices (default 1).  With more than one thread,
+    // the vertices are divided into small tasks that are handed out
+    // dynamically, and each thread runs its own S2ClosestEdgeQuery against
+    // the source index.  The resulting distance does not depend on the
+    // number of threads, but if several target vertices achieve the maximum
+    // distance then DirectedResult::target_point() may be any one of them.
+    //
+    // REQUIRES: num_threads >= 1
+    int num_threads() const { return num_threads_; }
+    void set_num_threads(int num_threads) { num_threads_ = num_threads; }
+
    private:
     bool include_interiors_ = true;
+    int num_threads_ = 1;
   };
 
   // DirectedResult stores the results of directed Hausdorff distance queries
@@ -184,6 +197,9 @@ class S2HausdorffDistanceQuery {
                                    const S2ShapeIndex* source) const;
 
   // Computes if the directed Hausdorff distance is within the distance limit.
+  // This is much faster than computing the distance: each target vertex only
+  // needs to be tested for having some source edge within "distance_limit",
+  // and the query returns as soon as any vertex is further away.
   bool IsDirectedDistanceLess(const S2ShapeIndex* target,
                               const S2ShapeIndex* source,
                               S1ChordAngle distance_limit) const;
@@ -211,6 +227,15 @@ class S2HausdorffDistanceQuery {
                       S1ChordAngle distance_limit) const;
 
  private:
+  // Computes the directed distance from the vertices of "target" to
+  // "source".  If "distance_limit" is not negative, then the exact distance
+  // is not computed: if any vertex is further than "distance_limit" from
+  // "source" the result is Infinity() (and is returned as soon as such a
+  // vertex is found), otherwise the result is "distance_limit".
+  absl::optional<DirectedResult> GetDirectedResultImpl(
+      const S2ShapeIndex* target, const S2ShapeIndex* source,
+      S1ChordAngle distance_limit) const;
+
   Options options_;
 };
 
@@ -0,0 +1,94 @@
+// Copyright 2024 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "s2/s2hausdorff_distance_query.h"
+
+#include <memory>
+#include <random>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+#include "s2/mutable_s2shape_index.h"
+#include "s2/s1angle.h"
+#include "s2/s1chord_angle.h"
+#include "s2/s2benchmark_testing.h"
+#include "s2/s2cap.h"
+#include "s2/s2lax_polygon_shape.h"
+#include "s2/s2loop.h"
+#include "s2/s2point.h"
+#include "s2/s2random.h"
+#include "s2/s2testing.h"
+
+using std::make_unique;
+using std::vector;
+
+namespace {
+
+// Returns a fractal polygon with approximately "num_edges" edges ("base") and
+// a revision of it in which every vertex has moved by up to 10 meters.
+void MakeRevisions(int num_edges, MutableS2ShapeIndex* base,
+                   MutableS2ShapeIndex* revision) {
+  std::mt19937_64 bitgen(s2benchmark::kSeed);
+  auto loop = s2benchmark::MakeFractalLoop(bitgen, num_edges);
+  vector<S2Point> vertices(&loop->vertex(0),
+                           &loop->vertex(0) + loop->num_vertices());
+  base->Add(make_unique<S2LaxPolygonShape>(vector<vector<S2Point>>{vertices}));
+  for (S2Point& p : vertices) {
+    p = s2random::SamplePoint(bitgen, S2Cap(p, S2Testing::MetersToAngle(10)));
+  }
+  revision->Add(
+      make_unique<S2LaxPolygonShape>(vector<vector<S2Point>>{vertices}));
+  base->ForceBuild();
+  revision->ForceBuild();
+}
+
+// Registers the standard edge counts, each with 1 and 4 threads.
+void EdgeCountsAndThreads(benchmark::internal::Benchmark* b) {
+  for (int num_edges : {192, 3072, 49152, 786432}) {
+    for (int num_threads : {1, 4}) b->Args({num_edges, num_threads});
+  }
+}
+
+// Measures the time to compute the Hausdorff distance between two revisions
+// of the same polygon using state.range(1) threads.
+void BM_S2HausdorffDistance(benchmark::State& state) {
+  MutableS2ShapeIndex base, revision;
+  MakeRevisions(state.range(0), &base, &revision);
+  S2HausdorffDistanceQuery query;
+  query.mutable_options()->set_num_threads(state.range(1));
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(query.GetDistance(&base, &revision));
+  }
+  state.SetItemsProcessed(state.iterations() * 2 * state.range(0));
+}
+BENCHMARK(BM_S2HausdorffDistance)->Apply(EdgeCountsAndThreads);
+
+// Measures the time to check that the Hausdorff distance between two
+// revisions is below a threshold (which requires testing every vertex) using
+// state.range(1) threads.
+void BM_S2HausdorffIsDistanceLess(benchmark::State& state) {
+  MutableS2ShapeIndex base, revision;
+  MakeRevisions(state.range(0), &base, &revision);
+  S2HausdorffDistanceQuery query;
+  query.mutable_options()->set_num_threads(state.range(1));
+  const S1ChordAngle limit(S2Testing::MetersToAngle(20));
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(query.IsDistanceLess(&base, &revision, limit));
+  }
+  state.SetItemsProcessed(state.iterations() * 2 * state.range(0));
+}
+BENCHMARK(BM_S2HausdorffIsDistanceLess)->Apply(EdgeCountsAndThreads);
+
+}  // namespace
@@ -21,16 +21,23 @@
 #include <vector>
 
 #include <gtest/gtest.h>
+#include "absl/log/log_streamer.h"
+#include "absl/random/random.h"
 #include "absl/types/optional.h"
 #include "s2/mutable_s2shape_index.h"
+#include "s2/s1angle.h"
 #include "s2/s1chord_angle.h"
+#include "s2/s2cap.h"
 #include "s2/s2latlng.h"
 #include "s2/s2lax_polygon_shape.h"
 #include "s2/s2lax_polyline_shape.h"
+#include "s2/s2loop.h"
 #include "s2/s2point.h"
 #include "s2/s2point_vector_shape.h"
+#include "s2/s2random.h"
 #include "s2/s2shape.h"
 #include "s2/s2shape_index.h"
+#include "s2/s2testing.h"
 #include "s2/s2text_format.h"
 
 using s2textformat::ParsePointsOrDie;
@@ -69,6 +76,10 @@ TEST(S2HausdorffDistanceQueryTest, OptionsConstructorsAndAccessorsWork) {
 
   EXPECT_TRUE(default_options.include_interiors());
   EXPECT_FALSE(options.include_interiors());
+
+  EXPECT_EQ(default_options.num_threads(), 1);
+  options.set_num_threads(4);
+  EXPECT_EQ(options.num_threads(), 4);
 }
 
 // Test the constructors and accessors of the Options.
@@ -403,3 +414,40 @@ TEST(S2HausdorffDistanceQueryTest, WholeWorldSameReference) {
   EXPECT_FALSE(a_to_b_distance_less_inf);
   EXPECT_FALSE(a_to_a_distance_less_inf);
 }
+
+// Checks that the parallel and bounded code paths agree with the serial
+// computation on polygons large enough to be split into many tasks.
+TEST(S2HausdorffDistanceQueryTest, ParallelAndBoundedQueriesAgree) {
+  absl::BitGen bitgen(S2Testing::MakeTaggedSeedSeq(
+      "PARALLEL_AND_BOUNDED_QUERIES_AGREE",
+      absl::LogInfoStreamer(__FILE__, __LINE__).stream()));
+  auto loop = S2Loop::MakeRegularLoop(S2Point(1, 0, 0), S1Angle::Degrees(1),
+                                      3000);
+  vector<S2Point> vertices(&loop->vertex(0),
+                           &loop->vertex(0) + loop->num_vertices());
+  MutableS2ShapeIndex a, b;
+  a.Add(make_unique<S2LaxPolygonShape>(vector<vector<S2Point>>{vertices}));
+  for (S2Point& p : vertices) {
+    p = s2random::SamplePoint(bitgen, S2Cap(p, S1Angle::Degrees(0.01)));
+  }
+  b.Add(make_unique<S2LaxPolygonShape>(vector<vector<S2Point>>{vertices}));
+
+  S2HausdorffDistanceQuery serial_query;
+  absl::optional<DirectedResult> expected =
+      serial_query.GetDirectedResult(&a, &b);
+  ASSERT_TRUE(expected.has_value());
+  const S1ChordAngle distance = expected->distance();
+  EXPECT_GT(distance, S1ChordAngle::Zero());
+
+  for (int num_threads : {1, 3, 8}) {
+    Options options;
+    options.set_num_threads(num_threads);
+    S2HausdorffDistanceQuery query(options);
+    absl::optional<DirectedResult> actual = query.GetDirectedResult(&a, &b);
+    ASSERT_TRUE(actual.has_value());
+    EXPECT_EQ(actual->distance(), distance);
+    // The limit is inclusive.
+    EXPECT_TRUE(query.IsDirectedDistanceLess(&a, &b, distance));
+    EXPECT_FALSE(query.IsDirectedDistanceLess(&a, &b, distance.Predecessor()));
+  }
+}
@@ -0,0 +1,121 @@
+// Copyright 2024 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "s2/s2huge_page_memory_resource.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+
+#include "absl/log/absl_check.h"
+#include "absl/log/absl_log.h"
+#include "absl/synchronization/mutex.h"
+
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+
+namespace {
+
+// Rounds "n" up to a multiple of "alignment", which must be a power of 2.
+size_t RoundUp(size_t n, size_t alignment) {
+  return (n + alignment - 1) & ~(alignment - 1);
+}
+
+}  // namespace
+
+S2HugePageMemoryResource::S2HugePageMemoryResource(const Options& options)
+    : options_(options) {}
+
+S2HugePageMemoryResource::~S2HugePageMemoryResource() {
+  absl::MutexLock lock(&mutex_);
+  for (const Chunk& chunk : chunks_) {
+#ifdef __linux__
+    munmap(chunk.data, chunk.size);
+#else
+    ::operator delete(chunk.data, std::align_val_t(kHugePageSize));
+#endif
+  }
+}
+
+size_t S2HugePageMemoryResource::bytes_reserved() const {
+  absl::MutexLock lock(&mutex_);
+  size_t bytes = 0;
+  for (const Chunk& chunk : chunks_) bytes += chunk.size;
+  return bytes;
+}
+
+size_t S2HugePageMemoryResource::hugetlb_bytes_reserved() const {
+  absl::MutexLock lock(&mutex_);
+  size_t bytes = 0;
+  for (const Chunk& chunk : chunks_) {
+    if (chunk.hugetlb) bytes += chunk.size;
+  }
+  return bytes;
+}
+
+void* S2HugePageMemoryResource::do_allocate(size_t bytes, size_t alignment) {
+  ABSL_DCHECK_LE(alignment, kHugePageSize);
+  absl::MutexLock lock(&mutex_);
+  char* p = reinterpret_cast<char*>(
+      RoundUp(reinterpret_cast<uintptr_t>(next_), alignment));
+  if (next_ == nullptr || bytes > static_cast<size_t>(limit_ - p)) {
+    // The rest of the current chunk is abandoned.  Chunks are much larger
+    // than typical allocations, so little memory is wasted.
+    Chunk chunk = NewChunk(bytes);
+    chunks_.push_back(chunk);
+    p = chunk.data;
+    limit_ = chunk.data + chunk.size;
+  }
+  next_ = p + bytes;
+  return p;
+}
+
+S2HugePageMemoryResource::Chunk S2HugePageMemoryResource::NewChunk(
+    size_t min_size) const {
+  const size_t size =
+      RoundUp(std::max(min_size, options_.chunk_size()), kHugePageSize);
+#ifdef __linux__
+  if (options_.use_hugetlb()) {
+    void* data = mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if (data != MAP_FAILED) return {static_cast<char*>(data), size, true};
+  }
+  // Transparent huge pages are only used for regions that are aligned to a
+  // huge page boundary, so we over-allocate and then trim the excess.
+  const size_t padded_size = size + kHugePageSize;
+  void* padded = mmap(nullptr, padded_size, PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (padded == MAP_FAILED) {
+    ABSL_LOG(FATAL) << "Could not allocate " << size << " bytes";
+  }
+  char* begin = static_cast<char*>(padded);
+  char* data = reinterpret_cast<char*>(
+      RoundUp(reinterpret_cast<uintptr_t>(begin), kHugePageSize));
+  if (data > begin) munmap(begin, data - begin);
+  char* end = begin + padded_size;
+  if (end > data + size) munmap(data + size, end - (data + size));
+#ifdef MADV_HUGEPAGE
+  // This is only a hint; it fails harmlessly if THP is disabled.
+  madvise(data, size, MADV_HUGEPAGE);
+#endif
+  return {data, size, false};
+#else
+  return {static_cast<char*>(
+              ::operator new(size, std::align_val_t(kHugePageSize))),
+          size, false};
+#endif
+}
@@ -0,0 +1,126 @@
+// Copyright 2024 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef S2_S2HUGE_PAGE_MEMORY_RESOURCE_H_
+#define S2_S2HUGE_PAGE_MEMORY_RESOURCE_H_
+
+#include <cstddef>
+#include <memory_resource>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/synchronization/mutex.h"
+
+// S2HugePageMemoryResource is a std::pmr::memory_resource that carves
+// allocations out of large chunks of memory backed by huge pages (2 MiB on
+// x86-64).  Index cells allocated from it are packed densely into a small
+// number of pages, which greatly reduces TLB misses when queries access
+// cells of a large index in random order.  It can be passed to
+// MutableS2ShapeIndex::Options::set_memory_resource() and
+// EncodedS2ShapeIndex::set_memory_resource().
+//
+// Like std::pmr::monotonic_buffer_resource, deallocation is a no-op and all
+// memory is returned to the operating system when the resource is
+// destroyed.  This is ideal for indexes that are built once and then only
+// queried.  If cells are freed and reallocated repeatedly (e.g., an
+// EncodedS2ShapeIndex that is minimized periodically), wrap the resource in
+// a pool so that freed memory is reused:
+//
+//   S2HugePageMemoryResource huge_pages;
+//   std::pmr::synchronized_pool_resource pool(&huge_pages);
+//   EncodedS2ShapeIndex index;
+//   index.set_memory_resource(&pool);
+//
+// On Linux, memory is obtained using mmap() and either marked as eligible
+// for transparent huge pages using madvise(MADV_HUGEPAGE) or, if requested,
+// allocated from the explicitly reserved huge page pool (MAP_HUGETLB).  On
+// other platforms it falls back to ordinary aligned allocations.
+//
+// This class is thread-safe.
+class S2HugePageMemoryResource final : public std::pmr::memory_resource {
+ public:
+  // The huge page size assumed for alignment purposes.
+  static constexpr size_t kHugePageSize = size_t{2} << 20;
+
+  class Options {
+   public:
+    Options() = default;
+
+    // The minimum size of each chunk requested from the operating system.
+    // This is rounded up to a multiple of kHugePageSize.
+    //
+    // DEFAULT: 32 MiB
+    size_t chunk_size() const { return chunk_size_; }
+    void set_chunk_size(size_t chunk_size) { chunk_size_ = chunk_size; }
+
+    // If true, chunks are allocated from the explicitly reserved huge page
+    // pool (see /proc/sys/vm/nr_hugepages) using MAP_HUGETLB.  If the pool
+    // is exhausted, chunks fall back to transparent huge pages.
+    //
+    // DEFAULT: false (use transparent huge pages)
+    bool use_hugetlb() const { return use_hugetlb_; }
+    void set_use_hugetlb(bool use_hugetlb) { use_hugetlb_ = use_hugetlb; }
+
+   private:
+    size_t chunk_size_ = size_t{32} << 20;
+    bool use_hugetlb_ = false;
+  };
+
+  S2HugePageMemoryResource() : S2HugePageMemoryResource(Options()) {}
+  explicit S2HugePageMemoryResource(const Options& options);
+  ~S2HugePageMemoryResource() override;
+
+  S2HugePageMemoryResource(const S2HugePageMemoryResource&) = delete;
+  S2HugePageMemoryResource& operator=(const S2HugePageMemoryResource&) =
+      delete;
+
+  const Options& options() const { return options_; }
+
+  // Returns the total size of the chunks obtained from the operating system.
+  size_t bytes_reserved() const;
+
+  // Returns the number of bytes of those chunks that are backed by
+  // MAP_HUGETLB pages (always zero unless Options::use_hugetlb() is true).
+  size_t hugetlb_bytes_reserved() const;
+
+ private:
+  struct Chunk {
+    char* data;
+    size_t size;
+    bool hugetlb;  // Allocated using MAP_HUGETLB.
+  };
+
+  void* do_allocate(size_t bytes, size_t alignment) override;
+  void do_deallocate(void* p, size_t bytes, size_t alignment) override {}
+  bool do_is_equal(
+      const std::pmr::memory_resource& other) const noexcept override {
+    return this == &other;
+  }
+
+  // Obtains a new chunk of at least the given size from the operating
+  // system.
+  Chunk NewChunk(size_t min_size) const;
+
+  const Options options_;
+
+  mutable absl::Mutex mutex_;
+  std::vector<Chunk> chunks_ ABSL_GUARDED_BY(mutex_);
+
+  // The unused part of the last chunk.
+  char* next_ ABSL_GUARDED_BY(mutex_) = nullptr;
+  char* limit_ ABSL_GUARDED_BY(mutex_) = nullptr;
+};
+
+#endif  // S2_S2HUGE_PAGE_MEMORY_RESOURCE_H_
@@ -0,0 +1,127 @@
+// Copyright 2024 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "s2/s2huge_page_memory_resource.h"
+
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <memory_resource>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include "s2/util/coding/coder.h"
+#include "s2/encoded_s2shape_index.h"
+#include "s2/mutable_s2shape_index.h"
+#include "s2/s2error.h"
+#include "s2/s2shapeutil_coding.h"
+#include "s2/s2shapeutil_testing.h"
+
+using std::make_unique;
+
+namespace {
+
+constexpr size_t kHugePageSize = S2HugePageMemoryResource::kHugePageSize;
+
+TEST(S2HugePageMemoryResource, AllocatesAlignedMemory) {
+  S2HugePageMemoryResource::Options options;
+  options.set_chunk_size(1);  // Rounded up to one huge page.
+  S2HugePageMemoryResource resource(options);
+  EXPECT_EQ(resource.bytes_reserved(), 0);
+
+  std::vector<char*> blocks;
+  for (size_t alignment : {1, 8, 64, 4096}) {
+    char* p = static_cast<char*>(resource.allocate(1000, alignment));
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(p) % alignment, 0);
+    std::memset(p, alignment & 0xff, 1000);
+    blocks.push_back(p);
+  }
+  // Allocations do not overlap.
+  EXPECT_EQ(blocks[0][999], 1);
+  EXPECT_EQ(blocks[1][999], 8);
+  EXPECT_EQ(resource.bytes_reserved(), kHugePageSize);
+
+  // Allocations larger than a chunk get a chunk of their own.
+  char* large = static_cast<char*>(resource.allocate(kHugePageSize + 1, 8));
+  large[kHugePageSize] = 1;
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(large) % kHugePageSize, 0);
+  EXPECT_EQ(resource.bytes_reserved(), 3 * kHugePageSize);
+  resource.deallocate(large, kHugePageSize + 1, 8);  // No-op.
+  EXPECT_EQ(resource.hugetlb_bytes_reserved(), 0);
+  EXPECT_TRUE(resource.is_equal(resource));
+}
+
+TEST(S2HugePageMemoryResource, HugeTlbFallsBack) {
+  // This test passes whether or not any huge pages have been reserved.
+  S2HugePageMemoryResource::Options options;
+  options.set_use_hugetlb(true);
+  S2HugePageMemoryResource resource(options);
+  char* p = static_cast<char*>(resource.allocate(100, 16));
+  std::memset(p, 0, 100);
+  EXPECT_EQ(resource.bytes_reserved(), options.chunk_size());
+  EXPECT_LE(resource.hugetlb_bytes_reserved(), resource.bytes_reserved());
+}
+
+// Returns an index containing one small loop centered on each cube face.
+std::unique_ptr<MutableS2ShapeIndex> MakeIndex(
+    const MutableS2ShapeIndex::Options& options) {
+  auto index = make_unique<MutableS2ShapeIndex>(options);
+  s2testing::AddFaceLoops(100, index.get());
+  index->ForceBuild();
+  return index;
+}
+
+TEST(S2HugePageMemoryResource, MutableS2ShapeIndexCells) {
+  S2HugePageMemoryResource resource;
+  MutableS2ShapeIndex::Options options;
+  auto expected = MakeIndex(options);
+  for (int num_threads : {1, 4}) {
+    options.set_num_threads(num_threads);
+    options.set_memory_resource(&resource);
+    auto actual = MakeIndex(options);
+    EXPECT_GT(resource.bytes_reserved(), 0);
+    s2testing::ExpectEqual(*expected, *actual);
+  }
+}
+
+TEST(S2HugePageMemoryResource, EncodedS2ShapeIndexCells) {
+  auto input = MakeIndex(MutableS2ShapeIndex::Options());
+  const std::string encoded = s2testing::CompactEncodeIndexAndShapes(*input);
+
+  S2HugePageMemoryResource resource;
+  std::pmr::synchronized_pool_resource pool(&resource);
+  Decoder decoder(encoded.data(), encoded.size());
+  S2Error error;
+  EncodedS2ShapeIndex index;
+  index.set_memory_resource(&pool);
+  EXPECT_EQ(index.memory_resource(), &pool);
+  ASSERT_TRUE(index.Init(
+      &decoder, s2shapeutil::LazyDecodeShapeFactory(&decoder, error)));
+  ASSERT_TRUE(error.ok()) << error;
+  index.DecodeAll(4 /*num_threads*/);
+  EXPECT_GT(resource.bytes_reserved(), 0);
+  s2testing::ExpectEqual(*input, index);
+
+  // Minimized cells are returned to the pool and reused.
+  const size_t reserved = resource.bytes_reserved();
+  for (int iter = 0; iter < 3; ++iter) {
+    index.Minimize();
+    s2testing::ExpectEqual(*input, index);
+  }
+  EXPECT_EQ(resource.bytes_reserved(), reserved);
+}
+
+}  // namespace
@@ -0,0 +1,167 @@
+// Copyright 2024 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+// Measures how query throughput scales when many threads share a single
+// read-only MutableS2ShapeIndex or EncodedS2ShapeIndex.  Ideally the
+// throughput per thread ("items_per_thread") is independent of the number of
+// threads; a decrease indicates contention between threads (e.g. on the
+// atomics used to decode EncodedS2ShapeIndex cells and shapes lazily, or
+// false sharing of the cache lines that contain them).
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+#include "absl/log/absl_check.h"
+#include "s2/util/coding/coder.h"
+#include "s2/encoded_s2shape_index.h"
+#include "s2/mutable_s2shape_index.h"
+#include "s2/s2benchmark_testing.h"
+#include "s2/s2closest_edge_query.h"
+#include "s2/s2contains_point_query.h"
+#include "s2/s2error.h"
+#include "s2/s2point.h"
+#include "s2/s2shapeutil_coding.h"
+
+using std::string;
+using std::vector;
+
+namespace {
+
+constexpr int kNumEdges = 49152;
+constexpr int kNumQueryPoints = 10000;
+
+const MutableS2ShapeIndex& SharedMutableIndex() {
+  static const MutableS2ShapeIndex* const index =
+      s2benchmark::MakeFractalIndex(kNumEdges).release();
+  return *index;
+}
+
+// Returns a new EncodedS2ShapeIndex for SharedMutableIndex().  The encoded
+// data is leaked, since the index refers to it.
+EncodedS2ShapeIndex* MakeEncodedIndex(bool pad_decoded_cell_flags) {
+  Encoder encoder;
+  const MutableS2ShapeIndex& mutable_index = SharedMutableIndex();
+  ABSL_CHECK(s2shapeutil::CompactEncodeTaggedShapes(mutable_index, &encoder));
+  mutable_index.Encode(&encoder);
+  auto* encoded = new string(encoder.base(), encoder.length());
+  Decoder decoder(encoded->data(), encoded->size());
+  auto* result = new EncodedS2ShapeIndex;
+  result->set_pad_decoded_cell_flags(pad_decoded_cell_flags);
+  S2Error error;
+  auto factory = s2shapeutil::LazyDecodeShapeFactory(&decoder, error);
+  ABSL_CHECK(error.ok()) << error;
+  ABSL_CHECK(result->Init(&decoder, factory));
+  return result;
+}
+
+// The encoded index is decoded lazily by the benchmark threads themselves,
+// so the first run of each benchmark also measures concurrent decoding.
+const EncodedS2ShapeIndex& SharedEncodedIndex() {
+  static const EncodedS2ShapeIndex* const index = MakeEncodedIndex(false);
+  return *index;
+}
+
+// Like the above, but the decoded cell flags are padded to avoid false
+// sharing while the index is being decoded.
+const EncodedS2ShapeIndex& SharedPaddedIndex() {
+  static const EncodedS2ShapeIndex* const index = MakeEncodedIndex(true);
+  return *index;
+}
+
+// An encoded index that is fully decoded up front by Freeze(), so that
+// cells are looked up without any atomic operations.
+const EncodedS2ShapeIndex& SharedFrozenIndex() {
+  static const EncodedS2ShapeIndex* const index = []() {
+    EncodedS2ShapeIndex* result = MakeEncodedIndex(false);
+    result->Freeze();
+    return result;
+  }();
+  return *index;
+}
+
+const vector<S2Point>& QueryPoints() {
+  static const vector<S2Point>* const points = new vector<S2Point>(
+      s2benchmark::MakeQueryPoints(SharedMutableIndex(), kNumQueryPoints));
+  return *points;
+}
+
+// Registers the thread counts used by all the benchmarks below.
+void Threads(benchmark::internal::Benchmark* b) {
+  b->ThreadRange(1, 64)->UseRealTime();
+}
+
+// Reports the total throughput and the throughput per thread.
+void ReportThroughput(benchmark::State& state) {
+  state.SetItemsProcessed(state.iterations());
+  state.counters["items_per_thread"] = benchmark::Counter(
+      state.iterations(),
+      benchmark::Counter::kIsRate | benchmark::Counter::kAvgThreads);
+}
+
+template <class IndexType, const IndexType& (*SharedIndex)()>
+void BM_ScalingContainsPoint(benchmark::State& state) {
+  const IndexType& index = SharedIndex();
+  const vector<S2Point>& points = QueryPoints();
+  auto query = MakeS2ContainsPointQuery(&index);
+  size_t i = state.thread_index() * points.size() / state.threads();
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(query.Contains(points[i]));
+    if (++i == points.size()) i = 0;
+  }
+  ReportThroughput(state);
+}
+BENCHMARK_TEMPLATE(BM_ScalingContainsPoint, MutableS2ShapeIndex,
+                   SharedMutableIndex)
+    ->Apply(Threads);
+BENCHMARK_TEMPLATE(BM_ScalingContainsPoint, EncodedS2ShapeIndex,
+                   SharedEncodedIndex)
+    ->Apply(Threads);
+BENCHMARK_TEMPLATE(BM_ScalingContainsPoint, EncodedS2ShapeIndex,
+                   SharedPaddedIndex)
+    ->Apply(Threads);
+BENCHMARK_TEMPLATE(BM_ScalingContainsPoint, EncodedS2ShapeIndex,
+                   SharedFrozenIndex)
+    ->Apply(Threads);
+
+template <class IndexType, const IndexType& (*SharedIndex)()>
+void BM_ScalingClosestEdge(benchmark::State& state) {
+  const IndexType& index = SharedIndex();
+  const vector<S2Point>& points = QueryPoints();
+  S2ClosestEdgeQuery query(&index);
+  size_t i = state.thread_index() * points.size() / state.threads();
+  for (auto _ : state) {
+    S2ClosestEdgeQuery::PointTarget target(points[i]);
+    benchmark::DoNotOptimize(query.FindClosestEdge(&target));
+    if (++i == points.size()) i = 0;
+  }
+  ReportThroughput(state);
+}
+BENCHMARK_TEMPLATE(BM_ScalingClosestEdge, MutableS2ShapeIndex,
+                   SharedMutableIndex)
+    ->Apply(Threads);
+BENCHMARK_TEMPLATE(BM_ScalingClosestEdge, EncodedS2ShapeIndex,
+                   SharedEncodedIndex)
+    ->Apply(Threads);
+BENCHMARK_TEMPLATE(BM_ScalingClosestEdge, EncodedS2ShapeIndex,
+                   SharedPaddedIndex)
+    ->Apply(Threads);
+BENCHMARK_TEMPLATE(BM_ScalingClosestEdge, EncodedS2ShapeIndex,
+                   SharedFrozenIndex)
+    ->Apply(Threads);
+
+}  // namespace
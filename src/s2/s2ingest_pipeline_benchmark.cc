@@ -0,0 +1,245 @@
+// Copyright 2024 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+// Measures the whole path from raw geometry to a served index:
+//
+//   parse:  read polygons from WKB using s2wk::Reader.
+//   snap:   snap each polygon to S2CellId centers using S2Builder with an
+//           S2CellIdSnapFunction, producing S2LaxPolygonShapes.
+//   index:  build a MutableS2ShapeIndex containing the snapped polygons.
+//   encode: CompactEncodeTaggedShapes() followed by Encode().
+//   load:   initialize an EncodedS2ShapeIndex and decode all of it.
+//   query:  run a batch of point containment queries on the encoded index.
+//
+// The pipeline is run with 1 to 8 threads, and the time of each stage is
+// reported separately (in milliseconds per run) together with the peak
+// memory tracked by S2MemoryTracker while snapping and indexing, the size of
+// the encoding, and the overall throughput in polygons per second.  This
+// makes it possible to check a library upgrade against the whole pipeline
+// rather than individual operations.
+//
+// By default the polygons are synthetic building footprints (see
+// s2benchmark::MakeFootprintIndex).  An external dataset can be used instead
+// by setting S2BENCHMARK_POLYGONS (see s2latency_benchmark.cc).
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+#include "absl/log/absl_check.h"
+#include "absl/strings/string_view.h"
+#include "s2/util/coding/coder.h"
+#include "s2/encoded_s2shape_index.h"
+#include "s2/internal/s2parallel.h"
+#include "s2/mutable_s2shape_index.h"
+#include "s2/s2benchmark_testing.h"
+#include "s2/s2builder.h"
+#include "s2/s2builderutil_lax_polygon_layer.h"
+#include "s2/s2builderutil_snap_functions.h"
+#include "s2/s2contains_point_query.h"
+#include "s2/s2error.h"
+#include "s2/s2lax_polygon_shape.h"
+#include "s2/s2memory_tracker.h"
+#include "s2/s2point.h"
+#include "s2/s2shape.h"
+#include "s2/s2shapeutil_coding.h"
+#include "s2/s2wk_format.h"
+
+using absl::string_view;
+using s2internal::ParallelFor;
+using std::make_unique;
+using std::unique_ptr;
+using std::vector;
+
+namespace {
+
+constexpr int kNumClusters = 200;
+constexpr int kNumPolygons = 50000;
+constexpr int kNumQueryPoints = 100000;
+
+// The snap level, whose cells are about 1 meter across.
+constexpr int kSnapLevel = 23;
+
+// The number of pieces into which the input and the queries are split so
+// that they can be processed by several threads.
+constexpr int kNumChunks = 64;
+
+struct Input {
+  // The WKB encoding of all the polygons, and the offset of each polygon
+  // within it (plus a final entry for the end of the encoding).
+  std::string wkb;
+  vector<size_t> offsets;
+  vector<S2Point> query_points;
+};
+
+const Input& GetInput() {
+  static const Input* const input = []() {
+    auto* in = new Input;
+    const vector<s2benchmark::Cluster> clusters =
+        s2benchmark::MakeClusters(kNumClusters);
+    unique_ptr<MutableS2ShapeIndex> index;
+    if (const char* path = std::getenv("S2BENCHMARK_POLYGONS")) {
+      index = s2benchmark::LoadPolygonIndex(path);
+    } else {
+      index = s2benchmark::MakeFootprintIndex(s2benchmark::MakeClusteredPoints(
+          clusters, kNumPolygons, s2benchmark::kSeed + 4));
+    }
+    Encoder encoder;
+    for (const S2Shape* shape : *index) {
+      in->offsets.push_back(encoder.length());
+      s2wk::EncodeWkb(*shape, &encoder);
+    }
+    in->offsets.push_back(encoder.length());
+    in->wkb.assign(encoder.base(), encoder.length());
+    in->query_points = s2benchmark::MakeClusteredPoints(
+        clusters, kNumQueryPoints, s2benchmark::kSeed + 7);
+    return in;
+  }();
+  return *input;
+}
+
+// Returns the range of elements [begin, end) of chunk "i" of "n" elements.
+std::pair<size_t, size_t> Chunk(size_t n, int i) {
+  return {n * i / kNumChunks, n * (i + 1) / kNumChunks};
+}
+
+// Runs one stage of the pipeline and adds its running time to the counter
+// "name", which reports the average time per iteration in milliseconds.
+template <class Op>
+void TimeStage(benchmark::State& state, const char* name, Op&& op) {
+  auto start = std::chrono::steady_clock::now();
+  op();
+  std::chrono::duration<double, std::milli> elapsed =
+      std::chrono::steady_clock::now() - start;
+  auto [it, inserted] = state.counters.try_emplace(
+      name, 0.0, benchmark::Counter::kAvgIterations);
+  it->second.value += elapsed.count();
+}
+
+void BM_IngestPipeline(benchmark::State& state) {
+  const Input& input = GetInput();
+  const int num_threads = state.range(0);
+  const size_t num_polygons = input.offsets.size() - 1;
+  int64_t snap_peak_bytes = 0, index_peak_bytes = 0, encoded_bytes = 0;
+  for (auto _ : state) {
+    vector<unique_ptr<S2Shape>> parsed(num_polygons);
+    TimeStage(state, "parse_ms", [&]() {
+      ParallelFor(num_threads, kNumChunks, [&](int i) {
+        auto [begin, end] = Chunk(num_polygons, i);
+        s2wk::Reader reader(
+            s2wk::Format::WKB,
+            string_view(input.wkb)
+                .substr(input.offsets[begin],
+                        input.offsets[end] - input.offsets[begin]));
+        vector<unique_ptr<S2Shape>> shapes;
+        while (reader.Next(&shapes)) continue;
+        ABSL_CHECK(reader.error().ok()) << reader.error();
+        ABSL_CHECK_EQ(shapes.size(), end - begin);
+        for (size_t j = begin; j < end; ++j) {
+          parsed[j] = std::move(shapes[j - begin]);
+        }
+      });
+    });
+
+    vector<unique_ptr<S2LaxPolygonShape>> snapped(num_polygons);
+    S2SharedMemoryBudget budget;
+    TimeStage(state, "snap_ms", [&]() {
+      ParallelFor(num_threads, kNumChunks, [&](int i) {
+        S2MemoryTracker tracker;
+        tracker.set_shared_budget(&budget);
+        S2Builder::Options options{
+            s2builderutil::S2CellIdSnapFunction(kSnapLevel)};
+        options.set_memory_tracker(&tracker);
+        options.set_retain_capacity(true);
+        S2Builder builder(options);
+        auto [begin, end] = Chunk(num_polygons, i);
+        for (size_t j = begin; j < end; ++j) {
+          snapped[j] = make_unique<S2LaxPolygonShape>();
+          builder.StartLayer(make_unique<s2builderutil::LaxPolygonLayer>(
+              snapped[j].get()));
+          builder.AddShape(*parsed[j]);
+          S2Error error;
+          ABSL_CHECK(builder.Build(&error)) << error;
+        }
+      });
+    });
+    snap_peak_bytes = budget.max_usage_bytes();
+    parsed.clear();
+
+    S2MemoryTracker index_tracker;
+    MutableS2ShapeIndex index;
+    TimeStage(state, "index_ms", [&]() {
+      MutableS2ShapeIndex::Options options;
+      options.set_num_threads(num_threads);
+      index.Init(options);
+      index.set_memory_tracker(&index_tracker);
+      for (auto& polygon : snapped) index.Add(std::move(polygon));
+      index.ForceBuild();
+      ABSL_CHECK(index_tracker.ok()) << index_tracker.error();
+    });
+    index_peak_bytes = index_tracker.max_usage_bytes();
+
+    Encoder encoder;
+    TimeStage(state, "encode_ms", [&]() {
+      ABSL_CHECK(
+          s2shapeutil::CompactEncodeTaggedShapes(index, &encoder, num_threads));
+      index.Encode(&encoder, num_threads);
+    });
+    encoded_bytes = encoder.length();
+    index.set_memory_tracker(nullptr);
+
+    EncodedS2ShapeIndex encoded;
+    TimeStage(state, "load_ms", [&]() {
+      Decoder decoder(encoder.base(), encoder.length());
+      S2Error error;
+      auto factory = s2shapeutil::LazyDecodeShapeFactory(&decoder, error);
+      ABSL_CHECK(error.ok()) << error;
+      ABSL_CHECK(encoded.Init(&decoder, factory));
+      encoded.DecodeAll(num_threads);
+    });
+
+    TimeStage(state, "query_ms", [&]() {
+      const vector<S2Point>& points = input.query_points;
+      ParallelFor(num_threads, kNumChunks, [&](int i) {
+        auto query = MakeS2ContainsPointQuery(&encoded);
+        auto [begin, end] = Chunk(points.size(), i);
+        for (size_t j = begin; j < end; ++j) {
+          benchmark::DoNotOptimize(query.Contains(points[j]));
+        }
+      });
+    });
+  }
+  state.counters["snap_peak_bytes"] = snap_peak_bytes;
+  state.counters["index_peak_bytes"] = index_peak_bytes;
+  state.counters["encoded_bytes"] = encoded_bytes;
+  state.SetItemsProcessed(state.iterations() * num_polygons);
+}
+BENCHMARK(BM_IngestPipeline)
+    ->ArgName("threads")
+    ->Arg(1)
+    ->Arg(2)
+    ->Arg(4)
+    ->Arg(8)
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+
+}  // namespace
@@ -0,0 +1,159 @@
+// Copyright 2024 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+// Latency benchmarks for the common query types on clustered geographic
+// workloads.  Each benchmark reports the p50, p99, and p999 latency of
+// individual queries and the total throughput, using 1 to 8 concurrent
+// threads that share the same index.
+//
+// By default the workloads are synthetic (see s2benchmark::MakeClusters).
+// External datasets can be used instead by setting these environment
+// variables before running s2_benchmarks:
+//
+//   S2BENCHMARK_POINTS:   a file with one "lat:lng" point per line.  These
+//                         points are indexed by the closest point benchmark
+//                         and are also used as query points.
+//   S2BENCHMARK_POLYGONS: a file with one polygon per line (in the format
+//                         of s2textformat::MakeLaxPolygon).  These polygons
+//                         are indexed by the other benchmarks.
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdlib>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+#include "s2/mutable_s2shape_index.h"
+#include "s2/s1chord_angle.h"
+#include "s2/s2benchmark_testing.h"
+#include "s2/s2closest_edge_query.h"
+#include "s2/s2closest_point_query.h"
+#include "s2/s2contains_point_query.h"
+#include "s2/s2point.h"
+#include "s2/s2point_index.h"
+#include "s2/s2testing.h"
+
+using std::vector;
+
+namespace {
+
+constexpr int kNumClusters = 200;
+constexpr int kNumPolygons = 50000;
+constexpr int kNumPoints = 200000;
+constexpr int kNumQueryPoints = 100000;
+
+struct Workload {
+  std::unique_ptr<MutableS2ShapeIndex> polygon_index;
+  S2PointIndex<int> point_index;
+  vector<S2Point> query_points;
+};
+
+const Workload& GetWorkload() {
+  static const Workload* const workload = []() {
+    auto* w = new Workload;
+    const vector<s2benchmark::Cluster> clusters =
+        s2benchmark::MakeClusters(kNumClusters);
+    if (const char* path = std::getenv("S2BENCHMARK_POLYGONS")) {
+      w->polygon_index = s2benchmark::LoadPolygonIndex(path);
+    } else {
+      w->polygon_index = s2benchmark::MakeFootprintIndex(
+          s2benchmark::MakeClusteredPoints(clusters, kNumPolygons,
+                                           s2benchmark::kSeed + 4));
+    }
+    vector<S2Point> points;
+    if (const char* path = std::getenv("S2BENCHMARK_POINTS")) {
+      points = s2benchmark::LoadPoints(path);
+      w->query_points = points;
+      std::shuffle(w->query_points.begin(), w->query_points.end(),
+                   std::mt19937_64(s2benchmark::kSeed + 5));
+    } else {
+      points = s2benchmark::MakeClusteredPoints(clusters, kNumPoints,
+                                                s2benchmark::kSeed + 6);
+      w->query_points = s2benchmark::MakeClusteredPoints(
+          clusters, kNumQueryPoints, s2benchmark::kSeed + 7);
+    }
+    for (size_t i = 0; i < points.size(); ++i) {
+      w->point_index.Add(points[i], i);
+    }
+    return w;
+  }();
+  return *workload;
+}
+
+// Registers the thread counts used by all the benchmarks below.
+void Threads(benchmark::internal::Benchmark* b) {
+  b->ThreadRange(1, 8)->UseRealTime();
+}
+
+// Returns the query point to use for iteration "i" of the given thread.
+// Each thread starts at a different offset in the query points.
+const S2Point& QueryPoint(const benchmark::State& state, size_t i) {
+  const vector<S2Point>& points = GetWorkload().query_points;
+  return points[(state.thread_index() * points.size() / state.threads() + i) %
+                points.size()];
+}
+
+// Measures the latency of testing whether a point is contained by any of
+// the indexed polygons.
+void BM_LatencyContainsPoint(benchmark::State& state) {
+  const Workload& workload = GetWorkload();
+  auto query = MakeS2ContainsPointQuery(workload.polygon_index.get());
+  s2benchmark::LatencyRecorder recorder(state);
+  size_t i = 0;
+  for (auto _ : state) {
+    const S2Point& p = QueryPoint(state, i++);
+    recorder.Time([&]() { benchmark::DoNotOptimize(query.Contains(p)); });
+  }
+  recorder.Report();
+}
+BENCHMARK(BM_LatencyContainsPoint)->Apply(Threads);
+
+// Measures the latency of finding the closest polygon edge to a point.
+void BM_LatencyClosestEdge(benchmark::State& state) {
+  const Workload& workload = GetWorkload();
+  S2ClosestEdgeQuery query(workload.polygon_index.get());
+  s2benchmark::LatencyRecorder recorder(state);
+  size_t i = 0;
+  for (auto _ : state) {
+    S2ClosestEdgeQuery::PointTarget target(QueryPoint(state, i++));
+    recorder.Time(
+        [&]() { benchmark::DoNotOptimize(query.FindClosestEdge(&target)); });
+  }
+  recorder.Report();
+}
+BENCHMARK(BM_LatencyClosestEdge)->Apply(Threads);
+
+// Measures the latency of finding the 10 closest points within 1 km, which
+// varies greatly between dense and sparse regions.
+void BM_LatencyClosestPoints(benchmark::State& state) {
+  const Workload& workload = GetWorkload();
+  S2ClosestPointQuery<int> query(&workload.point_index);
+  query.mutable_options()->set_max_results(10);
+  query.mutable_options()->set_max_distance(
+      S1ChordAngle(S2Testing::KmToAngle(1)));
+  s2benchmark::LatencyRecorder recorder(state);
+  size_t i = 0;
+  for (auto _ : state) {
+    S2ClosestPointQuery<int>::PointTarget target(QueryPoint(state, i++));
+    recorder.Time(
+        [&]() { benchmark::DoNotOptimize(query.FindClosestPoints(&target)); });
+  }
+  recorder.Report();
+}
+BENCHMARK(BM_LatencyClosestPoints)->Apply(Threads);
+
+}  // namespace
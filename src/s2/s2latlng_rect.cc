@@ -20,11 +20,13 @@
 #include <algorithm>
 #include <cfloat>
 #include <cmath>
+#include <cstddef>
 #include <ostream>
 
 #include "absl/flags/flag.h"
 #include "absl/log/absl_check.h"
 #include "absl/log/absl_log.h"
+#include "absl/types/span.h"
 #include "s2/util/coding/coder.h"
 #include "s2/r1interval.h"
 #include "s2/s1angle.h"
@@ -160,6 +162,37 @@ bool S2LatLngRect::Contains(const S2LatLng& ll) const {
           lng_.Contains(ll.lng().radians()));
 }
 
+void S2LatLngRect::ContainsLatLngs(absl::Span<const S2LatLng> lat_lngs,
+                                   absl::Span<bool> results) const {
+  ABSL_DCHECK_EQ(lat_lngs.size(), results.size());
+  // This is equivalent to calling lat_.Contains() and lng_.Contains() for
+  // each point, except that the tests of whether the longitude interval is
+  // empty or inverted are hoisted out of the loop.
+  if (lng_.is_empty()) {
+    std::fill(results.begin(), results.end(), false);
+    return;
+  }
+  const double lat_lo = lat_.lo(), lat_hi = lat_.hi();
+  const double lng_lo = lng_.lo(), lng_hi = lng_.hi();
+  if (lng_.is_inverted()) {
+    for (size_t i = 0; i < lat_lngs.size(); ++i) {
+      const double lat = lat_lngs[i].lat().radians();
+      double lng = lat_lngs[i].lng().radians();
+      lng = (lng == -M_PI) ? M_PI : lng;
+      results[i] = (lat >= lat_lo) & (lat <= lat_hi) &
+                   ((lng >= lng_lo) | (lng <= lng_hi));
+    }
+  } else {
+    for (size_t i = 0; i < lat_lngs.size(); ++i) {
+      const double lat = lat_lngs[i].lat().radians();
+      double lng = lat_lngs[i].lng().radians();
+      lng = (lng == -M_PI) ? M_PI : lng;
+      results[i] = (lat >= lat_lo) & (lat <= lat_hi) &
+                   (lng >= lng_lo) & (lng <= lng_hi);
+    }
+  }
+}
+
 bool S2LatLngRect::InteriorContains(const S2Point& p) const {
   return InteriorContains(S2LatLng(p));
 }
@@ -729,6 +762,28 @@ bool S2LatLngRect::Contains(const S2Point& p) const {
   return Contains(S2LatLng(p));
 }
 
+void S2LatLngRect::ContainsPoints(absl::Span<const S2Point> points,
+                                  absl::Span<bool> results) const {
+  ABSL_DCHECK_EQ(points.size(), results.size());
+  // The points are converted to S2LatLngs in blocks.  Since computing the
+  // longitude is expensive, it is skipped (and left as zero) for points
+  // that are outside the latitude range and therefore not contained anyway.
+  constexpr size_t kBlockSize = 256;
+  S2LatLng lat_lngs[kBlockSize];
+  for (size_t start = 0; start < points.size(); start += kBlockSize) {
+    const size_t n = min(kBlockSize, points.size() - start);
+    for (size_t i = 0; i < n; ++i) {
+      const S2Point& p = points[start + i];
+      const double lat = S2LatLng::Latitude(p).radians();
+      const double lng =
+          lat_.Contains(lat) ? S2LatLng::Longitude(p).radians() : 0;
+      lat_lngs[i] = S2LatLng::FromRadians(lat, lng);
+    }
+    ContainsLatLngs(absl::MakeConstSpan(lat_lngs, n),
+                    results.subspan(start, n));
+  }
+}
+
 bool S2LatLngRect::ApproxEquals(const S2LatLngRect& other,
                                 S1Angle max_error) const {
   return (lat_.ApproxEquals(other.lat_, max_error.radians()) &&
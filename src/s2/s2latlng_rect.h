@@ -25,6 +25,7 @@
 #include <vector>
 
 #include "absl/log/absl_log.h"
+#include "absl/types/span.h"
 #include "s2/util/coding/coder.h"
 #include "s2/_fp_contract_off.h"  // IWYU pragma: keep
 #include "s2/r1interval.h"
@@ -178,6 +179,14 @@ class S2LatLngRect final : public S2Region {
   // an S2Point.  The argument must be normalized.
   bool Contains(const S2LatLng& ll) const;
 
+  // Sets results[i] to Contains(lat_lngs[i]) for every element.  This is
+  // faster than calling Contains() in a loop, since the emptiness and
+  // inversion tests are done once and the loop can be vectorized.
+  //
+  // REQUIRES: results.size() == lat_lngs.size()
+  void ContainsLatLngs(absl::Span<const S2LatLng> lat_lngs,
+                       absl::Span<bool> results) const;
+
   // Returns true if and only if the given point is contained in the interior
   // of the region (i.e. the region excluding its boundary).  The point 'p'
   // does not need to be normalized.
@@ -352,6 +361,11 @@ class S2LatLngRect final : public S2Region {
   // The point 'p' does not need to be normalized.
   bool Contains(const S2Point& p) const override;
 
+  // Like Contains(const S2Point&) for each point.  This version skips
+  // computing the longitude of points outside the latitude range.
+  void ContainsPoints(absl::Span<const S2Point> points,
+                      absl::Span<bool> results) const override;
+
   // Appends a serialized representation of the S2LatLngRect to "encoder".
   //
   // REQUIRES: "encoder" uses the default constructor, so that its buffer
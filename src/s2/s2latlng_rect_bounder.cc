@@ -20,19 +20,24 @@
 #include <algorithm>
 #include <cfloat>
 #include <cmath>
+#include <cstdint>
+#include <vector>
 
 #include "absl/log/absl_check.h"
+#include "s2/internal/s2parallel.h"
 #include "s2/r1interval.h"
 #include "s2/s1angle.h"
 #include "s2/s1interval.h"
 #include "s2/s2latlng.h"
 #include "s2/s2latlng_rect.h"
 #include "s2/s2point.h"
+#include "s2/s2point_span.h"
 #include "s2/s2pointutil.h"
 
 using std::fabs;
 using std::max;
 using std::min;
+using std::vector;
 
 void S2LatLngRectBounder::AddPoint(const S2Point& b) {
   ABSL_DCHECK(S2::IsUnitLength(b));
@@ -211,6 +216,52 @@ S2LatLngRect S2LatLngRectBounder::GetBound() const {
   return bound_.Expanded(kExpansion).PolarClosure();
 }
 
+S2LatLngRect S2LatLngRectBounder::GetChainBound(S2PointSpan vertices,
+                                                 int num_threads) {
+  return GetBoundInternal(vertices, vertices.size(), num_threads);
+}
+
+S2LatLngRect S2LatLngRectBounder::GetLoopBound(S2PointLoopSpan vertices,
+                                                int num_threads) {
+  if (vertices.empty()) return S2LatLngRect::Empty();
+  return GetBoundInternal(vertices, vertices.size() + 1, num_threads);
+}
+
+template <class Vertices>
+S2LatLngRect S2LatLngRectBounder::GetBoundInternal(const Vertices& vertices,
+                                                   int num_vertices,
+                                                   int num_threads) {
+  ABSL_DCHECK_GE(num_threads, 1);
+  // Chains shorter than this are not worth splitting, since each edge only
+  // takes about 100 nanoseconds.
+  constexpr int kMinEdgesPerChunk = 1 << 14;
+  const int num_edges = std::max(0, num_vertices - 1);
+  const int num_chunks = min(num_threads, num_edges / kMinEdgesPerChunk);
+  if (num_chunks <= 1) {
+    S2LatLngRectBounder bounder;
+    for (int i = 0; i < num_vertices; ++i) bounder.AddPoint(vertices[i]);
+    return bounder.GetBound();
+  }
+  // Each chunk bounds a contiguous range of edges, so consecutive chunks
+  // share one vertex.  Since the longitude interval of every edge overlaps
+  // the interval of the edges bounded before it, merging the unexpanded
+  // chunk bounds in order gives exactly the same result as bounding the
+  // whole chain sequentially.
+  vector<S2LatLngRect> bounds(num_chunks);
+  s2internal::ParallelFor(num_chunks, num_chunks, [&](int chunk) {
+    const int begin = static_cast<int64_t>(num_edges) * chunk / num_chunks;
+    const int end = static_cast<int64_t>(num_edges) * (chunk + 1) / num_chunks;
+    S2LatLngRectBounder bounder;
+    for (int i = begin; i <= end; ++i) bounder.AddPoint(vertices[i]);
+    bounds[chunk] = bounder.bound_;
+  });
+  S2LatLngRectBounder result;
+  for (const S2LatLngRect& bound : bounds) {
+    result.bound_ = result.bound_.Union(bound);
+  }
+  return result.GetBound();
+}
+
 S2LatLngRect S2LatLngRectBounder::ExpandForSubregions(
     const S2LatLngRect& bound) {
   // Empty bounds don't need expansion.
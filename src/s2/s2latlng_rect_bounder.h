@@ -21,6 +21,7 @@
 #include "s2/s2latlng.h"
 #include "s2/s2latlng_rect.h"
 #include "s2/s2point.h"
+#include "s2/s2point_span.h"
 
 // This class computes a bounding rectangle that contains all edges defined
 // by a vertex chain v0, v1, v2, ...  All vertices must be unit length.
@@ -52,6 +53,20 @@ class S2LatLngRectBounder {
   // the S2LatLng coordinates of all S2Points contained by the loop.
   S2LatLngRect GetBound() const;
 
+  // Returns the bounding rectangle of the edge chain with the given
+  // vertices, i.e. the result of calling AddPoint() on each vertex and then
+  // GetBound().  Up to "num_threads" threads (including the calling thread)
+  // are used for very long chains, each bounding a contiguous piece of the
+  // chain.  The result does not depend on "num_threads".
+  //
+  // REQUIRES: num_threads >= 1
+  static S2LatLngRect GetChainBound(S2PointSpan vertices, int num_threads = 1);
+
+  // Like GetChainBound(), but also includes the edge from the last vertex
+  // back to the first (as S2Loop does).
+  static S2LatLngRect GetLoopBound(S2PointLoopSpan vertices,
+                                   int num_threads = 1);
+
   // Expands a bound returned by GetBound() so that it is guaranteed to
   // contain the bounds of any subregion whose bounds are computed using
   // this class.  For example, consider a loop L that defines a square.
@@ -78,6 +93,12 @@ class S2LatLngRectBounder {
   // must refer to the same vertex.
   void AddInternal(const S2Point& b, const S2LatLng& b_latlng);
 
+  // Common back end for GetChainBound() and GetLoopBound().  Bounds the edge
+  // chain vertices[0], ..., vertices[num_vertices - 1].
+  template <class Vertices>
+  static S2LatLngRect GetBoundInternal(const Vertices& vertices,
+                                       int num_vertices, int num_threads);
+
   S2Point a_;             // The previous vertex in the chain.
   S2LatLng a_latlng_;     // The corresponding latitude-longitude.
   S2LatLngRect bound_;    // The current bounding rectangle.
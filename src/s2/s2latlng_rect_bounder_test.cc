@@ -354,3 +354,38 @@ TEST(RectBounder, AccuracyBug) {
   EXPECT_GE(ac_expanded.lat().hi(), ac.lat().hi());
 }
 
+
+TEST(RectBounder, ChainAndLoopBoundsMatchAddPoint) {
+  absl::BitGen bitgen(S2Testing::MakeTaggedSeedSeq(
+      "CHAIN_AND_LOOP_BOUNDS_MATCH_ADD_POINT",
+      absl::LogInfoStreamer(__FILE__, __LINE__).stream()));
+  // A random walk with short steps (whose bound is much smaller than the
+  // whole sphere), and a chain of random points.  Both are long enough to be
+  // split into several chunks.
+  vector<S2Point> walk = {s2random::Point(bitgen)};
+  vector<S2Point> random;
+  for (int i = 0; i < 70000; ++i) {
+    walk.push_back(S2::GetPointOnLine(walk.back(), s2random::Point(bitgen),
+                                      S1Angle::Degrees(0.01)));
+    random.push_back(s2random::Point(bitgen));
+  }
+  vector<S2Point> small(walk.begin(), walk.begin() + 10);
+  for (const vector<S2Point>* vertices : {&walk, &random, &small}) {
+    S2LatLngRectBounder chain_bounder, loop_bounder;
+    for (const S2Point& v : *vertices) {
+      chain_bounder.AddPoint(v);
+      loop_bounder.AddPoint(v);
+    }
+    loop_bounder.AddPoint((*vertices)[0]);
+    const S2LatLngRect chain_bound = chain_bounder.GetBound();
+    const S2LatLngRect loop_bound = loop_bounder.GetBound();
+    for (int num_threads : {1, 3, 4}) {
+      EXPECT_EQ(S2LatLngRectBounder::GetChainBound(*vertices, num_threads),
+                chain_bound);
+      EXPECT_EQ(S2LatLngRectBounder::GetLoopBound(*vertices, num_threads),
+                loop_bound);
+    }
+  }
+  EXPECT_TRUE(S2LatLngRectBounder::GetChainBound({}).is_empty());
+  EXPECT_TRUE(S2LatLngRectBounder::GetLoopBound({}).is_empty());
+}
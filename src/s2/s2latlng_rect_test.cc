@@ -23,16 +23,20 @@
 
 #include <algorithm>
 #include <cmath>
+#include <cstddef>
 #include <string>
+#include <vector>
 
 #include <gtest/gtest.h>
 
+#include "absl/container/fixed_array.h"
 #include "absl/hash/hash_testing.h"
 #include "absl/log/absl_check.h"
 #include "absl/log/log_streamer.h"
 #include "absl/random/bit_gen_ref.h"
 #include "absl/random/random.h"
 #include "absl/strings/string_view.h"
+#include "absl/types/span.h"
 
 #include "s2/r1interval.h"
 #include "s2/s1angle.h"
@@ -55,6 +59,7 @@ using absl::string_view;
 using s2textformat::MakePointOrDie;
 using std::fabs;
 using std::min;
+using std::vector;
 
 static S2LatLngRect RectFromDegrees(double lat_lo, double lng_lo,
                                     double lat_hi, double lng_hi) {
@@ -1063,3 +1068,46 @@ TEST(S2LatLngRect, Hash) {
       {RectFromDegrees(-89, 0, 89, 1), RectFromDegrees(1, 5, 1, 5),
        S2LatLngRect::Empty(), S2LatLngRect::Full()}));
 }
+
+TEST(S2LatLngRect, ContainsPointsMatchesContains) {
+  absl::BitGen bitgen(S2Testing::MakeTaggedSeedSeq(
+      "CONTAINS_POINTS_MATCHES_CONTAINS",
+      absl::LogInfoStreamer(__FILE__, __LINE__).stream()));
+  vector<S2LatLngRect> rects = {
+      S2LatLngRect::Empty(), S2LatLngRect::Full(),
+      RectFromDegrees(-10, -20, 30, 40), RectFromDegrees(-90, 170, 45, -170),
+      RectFromDegrees(0, 180, 90, 180), RectFromDegrees(-45, -180, 45, 0),
+      RectFromDegrees(20, 10, 20, 10)};
+  for (int i = 0; i < 20; ++i) {
+    rects.push_back(S2LatLngRect::FromPointPair(
+        S2LatLng(s2random::Point(bitgen)), S2LatLng(s2random::Point(bitgen))));
+  }
+  for (const S2LatLngRect& rect : rects) {
+    // Test random points as well as the rectangle vertices and points on the
+    // 180 degree meridian, where the longitude may be either -180 or 180.
+    vector<S2LatLng> lat_lngs = {S2LatLng::FromDegrees(0, 180),
+                                 S2LatLng::FromDegrees(0, -180),
+                                 S2LatLng::FromDegrees(90, 0),
+                                 S2LatLng::FromDegrees(-90, 0)};
+    if (!rect.is_empty()) {
+      for (int k = 0; k < 4; ++k) lat_lngs.push_back(rect.GetVertex(k));
+    }
+    for (int i = 0; i < 300; ++i) {
+      lat_lngs.push_back(S2LatLng(s2random::Point(bitgen)));
+    }
+    vector<S2Point> points;
+    for (const S2LatLng& ll : lat_lngs) points.push_back(ll.ToPoint());
+
+    absl::FixedArray<bool> results(lat_lngs.size());
+    rect.ContainsLatLngs(lat_lngs, absl::MakeSpan(results));
+    for (size_t i = 0; i < lat_lngs.size(); ++i) {
+      EXPECT_EQ(results[i], rect.Contains(lat_lngs[i]))
+          << rect << " " << lat_lngs[i];
+    }
+    rect.ContainsPoints(points, absl::MakeSpan(results));
+    for (size_t i = 0; i < points.size(); ++i) {
+      EXPECT_EQ(results[i], rect.Contains(points[i]))
+          << rect << " " << points[i];
+    }
+  }
+}
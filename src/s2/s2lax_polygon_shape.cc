@@ -19,6 +19,7 @@
 
 #include <algorithm>
 #include <atomic>
+#include <cstddef>
 #include <cstdint>
 #include <cstdlib>
 #include <memory>
@@ -106,25 +107,89 @@ void S2LaxPolygonShape::Init(absl::Span<const S2LaxPolygonShape::Loop> loops) {
 }
 
 void S2LaxPolygonShape::Init(const S2Polygon& polygon) {
-  vector<Span<const S2Point>> spans;
-  for (int i = 0; i < polygon.num_loops(); ++i) {
+  // The full loop is represented as a loop with no vertices.
+  auto loop_span = [&polygon](int i) {
     const S2Loop* loop = polygon.loop(i);
-    if (loop->is_full()) {
-      spans.emplace_back();  // Empty span.
+    return loop->is_full() ? Span<const S2Point>()
+                           : Span<const S2Point>(&loop->vertex(0),
+                                                 loop->num_vertices());
+  };
+  vector<int> loop_sizes(polygon.num_loops());
+  int num_vertices = 0;
+  for (int i = 0; i < polygon.num_loops(); ++i) {
+    loop_sizes[i] = loop_span(i).size();
+    num_vertices += loop_sizes[i];
+  }
+  // Copy the vertices directly into a single buffer.  S2Polygon and
+  // S2LaxPolygonShape holes are oriented oppositely, so the vertices of
+  // loops representing holes are copied in reverse order.
+  auto vertices = make_unique_for_overwrite<S2Point[]>(num_vertices);
+  S2Point* out = vertices.get();
+  for (int i = 0; i < polygon.num_loops(); ++i) {
+    Span<const S2Point> loop = loop_span(i);
+    if (polygon.loop(i)->is_hole()) {
+      out = std::reverse_copy(loop.begin(), loop.end(), out);
     } else {
-      spans.emplace_back(&loop->vertex(0), loop->num_vertices());
+      out = std::copy(loop.begin(), loop.end(), out);
     }
   }
-  Init(spans);
+  Init(std::move(vertices), loop_sizes);
+}
 
-  // S2Polygon and S2LaxPolygonShape holes are oriented oppositely, so we need
-  // to reverse the orientation of any loops representing holes.
-  for (int i = 0; i < polygon.num_loops(); ++i) {
-    if (polygon.loop(i)->is_hole()) {
-      S2Point* v0 = &vertices_[loop_starts_[i]];
-      std::reverse(v0, v0 + num_loop_vertices(i));
+S2LaxPolygonShape::S2LaxPolygonShape(unique_ptr<S2Point[]> vertices,
+                                     Span<const int> loop_sizes) {
+  Init(std::move(vertices), loop_sizes);
+}
+
+void S2LaxPolygonShape::Init(unique_ptr<S2Point[]> vertices,
+                             Span<const int> loop_sizes) {
+  num_loops_ = loop_sizes.size();
+  prev_loop_.store(0, std::memory_order_relaxed);
+  vertices_ = std::move(vertices);
+  if (num_loops_ <= 1) {
+    num_vertices_ = num_loops_ == 0 ? 0 : loop_sizes[0];
+    loop_starts_.reset();
+  } else {
+    loop_starts_ = make_unique_for_overwrite<uint32_t[]>(num_loops_ + 1);
+    num_vertices_ = 0;
+    for (int i = 0; i < num_loops_; ++i) {
+      loop_starts_[i] = num_vertices_;
+      num_vertices_ += loop_sizes[i];
     }
+    loop_starts_[num_loops_] = num_vertices_;
+  }
+}
+
+void S2LaxPolygonShape::Builder::Reserve(int num_vertices, int num_loops) {
+  loop_sizes_.reserve(num_loops);
+  if (num_vertices <= capacity_) return;
+  auto vertices = make_unique_for_overwrite<S2Point[]>(num_vertices);
+  std::copy(vertices_.get(), vertices_.get() + num_vertices_, vertices.get());
+  vertices_ = std::move(vertices);
+  capacity_ = num_vertices;
+}
+
+void S2LaxPolygonShape::Builder::AddLoop(Span<const S2Point> vertices) {
+  const int size = num_vertices_ + vertices.size();
+  if (size > capacity_) {
+    Reserve(std::max(size, 2 * capacity_), num_loops() + 1);
+  }
+  std::copy(vertices.begin(), vertices.end(), vertices_.get() + num_vertices_);
+  num_vertices_ = size;
+  loop_sizes_.push_back(vertices.size());
+}
+
+unique_ptr<S2LaxPolygonShape> S2LaxPolygonShape::Builder::Build() {
+  if (capacity_ > num_vertices_) {
+    // Release the unused capacity, since the polygon does not track it.
+    capacity_ = 0;
+    Reserve(num_vertices_, num_loops());
   }
+  auto shape = make_unique<S2LaxPolygonShape>(std::move(vertices_),
+                                              loop_sizes_);
+  num_vertices_ = capacity_ = 0;
+  loop_sizes_.clear();
+  return shape;
 }
 
 void S2LaxPolygonShape::Init(Span<const Span<const S2Point>> loops) {
@@ -258,6 +323,20 @@ S2Shape::Edge S2LaxPolygonShape::edge(int e) const {
   return S2LaxPolygonShape::chain_edge(pos.chain_id, pos.offset);
 }
 
+void S2LaxPolygonShape::GetEdges(int begin, Span<Edge> edges) const {
+  ABSL_DCHECK_LE(begin + static_cast<int>(edges.size()), num_edges());
+  if (edges.empty()) return;
+  ChainPosition pos = S2LaxPolygonShape::chain_position(begin);
+  size_t k = 0;
+  for (int i = pos.chain_id, j = pos.offset; k < edges.size(); ++i, j = 0) {
+    const S2Point* v = S2LaxPolygonShape::chain_vertex_span(i).data();
+    int n = num_loop_vertices(i);
+    for (; j < n && k < edges.size(); ++j, ++k) {
+      edges[k] = Edge(v[j], v[j + 1 == n ? 0 : j + 1]);
+    }
+  }
+}
+
 S2Shape::ReferencePoint S2LaxPolygonShape::GetReferencePoint() const {
   return s2shapeutil::GetReferencePoint(*this);
 }
@@ -272,6 +351,17 @@ S2Shape::Chain S2LaxPolygonShape::chain(int i) const {
   }
 }
 
+Span<const S2Point> S2LaxPolygonShape::chain_vertex_span(int i) const {
+  ABSL_DCHECK_LT(i, num_loops());
+  if (num_loops() == 1) {
+    return Span<const S2Point>(vertices_.get(), num_vertices_);
+  } else {
+    int start = loop_starts_[i];
+    return Span<const S2Point>(vertices_.get() + start,
+                               loop_starts_[i + 1] - start);
+  }
+}
+
 EncodedS2LaxPolygonShape::EncodedS2LaxPolygonShape(
     EncodedS2LaxPolygonShape&& b) noexcept
     : num_loops_(std::exchange(b.num_loops_, 0)),
@@ -358,6 +448,27 @@ S2Shape::Edge EncodedS2LaxPolygonShape::edge(int e) const {
   }
 }
 
+void EncodedS2LaxPolygonShape::GetEdges(int begin, Span<Edge> edges) const {
+  ABSL_DCHECK_LE(begin + static_cast<int>(edges.size()), num_edges());
+  if (edges.empty()) return;
+
+  // Decode each vertex only once (except for the first vertex of each loop,
+  // which is decoded again to close the loop).
+  ChainPosition pos = EncodedS2LaxPolygonShape::chain_position(begin);
+  size_t k = 0;
+  for (int i = pos.chain_id, j = pos.offset; k < edges.size(); ++i, j = 0) {
+    int start = (num_loops() == 1) ? 0 : loop_starts_[i];
+    int n = num_loop_vertices(i);
+    if (j == n) continue;
+    S2Point v0 = vertices_[start + j];
+    for (; j < n && k < edges.size(); ++j, ++k) {
+      S2Point v1 = vertices_[start + (j + 1 == n ? 0 : j + 1)];
+      edges[k] = Edge(v0, v1);
+      v0 = v1;
+    }
+  }
+}
+
 S2Shape::ReferencePoint EncodedS2LaxPolygonShape::GetReferencePoint() const {
   return s2shapeutil::GetReferencePoint(*this);
 }
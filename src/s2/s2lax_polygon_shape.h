@@ -120,6 +120,58 @@ class S2LaxPolygonShape : public S2Shape {
   // Full and empty S2Polygons are supported.
   void Init(const S2Polygon& polygon);
 
+  // Constructs an S2LaxPolygonShape that takes ownership of "vertices", which
+  // holds the vertices of all the loops consecutively (loop "i" having
+  // loop_sizes[i] vertices).  The vertex data is not copied, so this is the
+  // fastest way to construct a polygon whose vertices have already been
+  // parsed into a buffer.  See also Builder below.
+  //
+  // REQUIRES: "vertices" has at least as many elements as the sum of
+  //           "loop_sizes".
+  S2LaxPolygonShape(std::unique_ptr<S2Point[]> vertices,
+                    absl::Span<const int> loop_sizes);
+
+  // Initializes an S2LaxPolygonShape by taking ownership of "vertices" (see
+  // the constructor above).
+  void Init(std::unique_ptr<S2Point[]> vertices,
+            absl::Span<const int> loop_sizes);
+
+  // Builds an S2LaxPolygonShape by appending loops to a single vertex buffer,
+  // which the polygon then adopts without copying.  Example:
+  //
+  //   S2LaxPolygonShape::Builder builder;
+  //   builder.Reserve(total_vertices, num_loops);
+  //   for (const auto& loop : parsed_loops) builder.AddLoop(loop);
+  //   std::unique_ptr<S2LaxPolygonShape> shape = builder.Build();
+  //
+  // When Reserve() is called with the final totals, every vertex is copied
+  // exactly once and there are no reallocations.
+  class Builder {
+   public:
+    Builder() = default;
+
+    // Ensures that loops can be added without reallocation until the totals
+    // exceed the given numbers of vertices and loops.
+    void Reserve(int num_vertices, int num_loops);
+
+    // Appends a loop with the given vertices.  An empty loop represents the
+    // full loop.
+    void AddLoop(absl::Span<const S2Point> vertices);
+
+    int num_loops() const { return loop_sizes_.size(); }
+    int num_vertices() const { return num_vertices_; }
+
+    // Returns a polygon containing the loops added so far, and resets the
+    // builder to its initial state.
+    std::unique_ptr<S2LaxPolygonShape> Build();
+
+   private:
+    std::unique_ptr<S2Point[]> vertices_;
+    int num_vertices_ = 0;
+    int capacity_ = 0;
+    std::vector<int> loop_sizes_;
+  };
+
   // Returns the number of loops.
   int num_loops() const { return num_loops_; }
 
@@ -156,12 +208,14 @@ class S2LaxPolygonShape : public S2Shape {
   // S2Shape interface:
   int num_edges() const final { return num_vertices(); }
   Edge edge(int e) const final;
+  void GetEdges(int begin, absl::Span<Edge> edges) const final;
   int dimension() const final { return 2; }
   ReferencePoint GetReferencePoint() const final;
   int num_chains() const final { return num_loops(); }
   Chain chain(int i) const final;
   Edge chain_edge(int i, int j) const final;
   ChainPosition chain_position(int e) const final;
+  absl::Span<const S2Point> chain_vertex_span(int i) const final;
   TypeTag type_tag() const override { return kTypeTag; }
 
  private:
@@ -224,6 +278,7 @@ class EncodedS2LaxPolygonShape : public S2Shape {
   // S2Shape interface:
   int num_edges() const final { return num_vertices(); }
   Edge edge(int e) const final;
+  void GetEdges(int begin, absl::Span<Edge> edges) const final;
   int dimension() const final { return 2; }
   ReferencePoint GetReferencePoint() const final;
   int num_chains() const final { return num_loops(); }
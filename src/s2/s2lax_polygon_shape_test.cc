@@ -35,6 +35,7 @@
 #include "absl/random/bit_gen_ref.h"
 #include "absl/random/random.h"
 #include "absl/strings/string_view.h"
+#include "absl/types/span.h"
 
 #include "s2/base/casts.h"
 #include "s2/util/coding/coder.h"
@@ -293,6 +294,42 @@ TEST(S2LaxPolygonShape, MultiLoopPolygon) {
   TestS2LaxPolygonShapeEncoding(shape);
 }
 
+// Checks that GetEdges() agrees with edge() for every range of edges.
+void ExpectGetEdgesMatchesEdge(const S2Shape& shape) {
+  vector<S2Shape::Edge> edges(shape.num_edges());
+  for (int begin = 0; begin <= shape.num_edges(); ++begin) {
+    for (int end = begin; end <= shape.num_edges(); ++end) {
+      shape.GetEdges(begin, absl::MakeSpan(edges.data(), end - begin));
+      for (int e = begin; e < end; ++e) {
+        EXPECT_EQ(shape.edge(e), edges[e - begin]);
+      }
+    }
+  }
+}
+
+TEST(S2LaxPolygonShape, GetEdges) {
+  // Include an empty loop, which has no edges.
+  vector<S2LaxPolygonShape::Loop> loops = {
+      s2textformat::ParsePointsOrDie("0:0, 0:3, 3:3"),
+      {},
+      s2textformat::ParsePointsOrDie("1:1, 2:2, 1:2, 1:1.5"),
+      s2textformat::ParsePointsOrDie("5:5")};
+  for (int num_loops : {1, 4}) {
+    S2LaxPolygonShape shape(absl::MakeConstSpan(loops.data(), num_loops));
+    ExpectGetEdgesMatchesEdge(shape);
+    for (int i = 0; i < num_loops; ++i) {
+      EXPECT_EQ(absl::MakeConstSpan(loops[i]), shape.chain_vertex_span(i));
+    }
+
+    Encoder encoder;
+    shape.Encode(&encoder, s2coding::CodingHint::COMPACT);
+    Decoder decoder(encoder.base(), encoder.length());
+    EncodedS2LaxPolygonShape encoded_shape;
+    ASSERT_TRUE(encoded_shape.Init(&decoder));
+    ExpectGetEdgesMatchesEdge(encoded_shape);
+  }
+}
+
 TEST(S2LaxPolygonShape, MultiLoopS2Polygon) {
   // Verify that the orientation of loops representing holes is reversed when
   // converting from an S2Polygon to an S2LaxPolygonShape.
@@ -307,6 +344,54 @@ TEST(S2LaxPolygonShape, MultiLoopS2Polygon) {
   }
 }
 
+TEST(S2LaxPolygonShape, AdoptVertexBuffer) {
+  auto expected = MakePolygonOrDie("0:0, 0:3, 3:3; 1:1, 1:2, 2:2");
+  S2LaxPolygonShape expected_shape(*expected);
+  auto vertices = make_unique<S2Point[]>(expected_shape.num_vertices());
+  const S2Point* data = vertices.get();
+  for (int i = 0; i < expected_shape.num_loops(); ++i) {
+    for (int j = 0; j < 3; ++j) {
+      vertices[3 * i + j] = expected_shape.loop_vertex(i, j);
+    }
+  }
+  S2LaxPolygonShape shape(std::move(vertices), {3, 3});
+  EXPECT_EQ(&shape.loop_vertex(0, 0), data);  // The buffer was not copied.
+  ASSERT_EQ(2, shape.num_loops());
+  for (int i = 0; i < shape.num_loops(); ++i) {
+    ASSERT_EQ(3, shape.num_loop_vertices(i));
+    for (int j = 0; j < 3; ++j) {
+      EXPECT_EQ(expected_shape.loop_vertex(i, j), shape.loop_vertex(i, j));
+    }
+  }
+  s2testing::ExpectEqual(expected_shape, shape);
+}
+
+TEST(S2LaxPolygonShape, Builder) {
+  vector<vector<S2Point>> loops = {
+      s2textformat::ParsePointsOrDie("0:0, 0:3, 3:3"),
+      {},  // The full loop.
+      s2textformat::ParsePointsOrDie("1:1, 2:2, 1:2, 1:1.5")};
+  for (bool reserve : {false, true}) {
+    S2LaxPolygonShape::Builder builder;
+    if (reserve) builder.Reserve(7, 3);
+    for (const auto& loop : loops) builder.AddLoop(loop);
+    EXPECT_EQ(3, builder.num_loops());
+    EXPECT_EQ(7, builder.num_vertices());
+    unique_ptr<S2LaxPolygonShape> shape = builder.Build();
+    EXPECT_EQ(0, builder.num_loops());
+    s2testing::ExpectEqual(S2LaxPolygonShape(loops), *shape);
+  }
+
+  // The builder can be reused after Build().
+  S2LaxPolygonShape::Builder builder;
+  builder.AddLoop(loops[0]);
+  builder.Build();
+  builder.AddLoop(loops[2]);
+  s2testing::ExpectEqual(S2LaxPolygonShape(vector<vector<S2Point>>{loops[2]}),
+                         *builder.Build());
+  EXPECT_EQ(0, builder.Build()->num_loops());
+}
+
 TEST(S2LaxPolygonShape, ManyLoopPolygon) {
   // Test a polygon with enough loops so that binary search is used to find
   // the loop containing a given edge.
@@ -18,6 +18,7 @@
 #include "s2/s2lax_polyline_shape.h"
 
 #include <algorithm>
+#include <cstddef>
 #include <memory>
 #include <utility>
 
@@ -101,6 +102,15 @@ S2Shape::Edge S2LaxPolylineShape::edge(int e) const {
   return Edge(vertex(e), vertex(e + 1));
 }
 
+void S2LaxPolylineShape::GetEdges(int begin, Span<Edge> edges) const {
+  ABSL_DCHECK_LE(begin + static_cast<int>(edges.size()), num_edges());
+  if (edges.empty()) return;
+  const S2Point* v = &vertices_[begin];
+  for (size_t i = 0; i < edges.size(); ++i) {
+    edges[i] = Edge(v[i], v[i + 1]);
+  }
+}
+
 int S2LaxPolylineShape::num_chains() const {
   return std::min(1, S2LaxPolylineShape::num_edges());  // Avoid virtual call.
 }
@@ -119,6 +129,11 @@ S2Shape::ChainPosition S2LaxPolylineShape::chain_position(int e) const {
   return S2Shape::ChainPosition(0, e);
 }
 
+Span<const S2Point> S2LaxPolylineShape::chain_vertex_span(int i) const {
+  ABSL_DCHECK_EQ(i, 0);
+  return Span<const S2Point>(vertices_.get(), num_vertices_);
+}
+
 bool EncodedS2LaxPolylineShape::Init(Decoder* decoder) {
   return vertices_.Init(decoder);
 }
@@ -134,6 +149,19 @@ S2Shape::Edge EncodedS2LaxPolylineShape::edge(int e) const {
   return Edge(vertex(e), vertex(e + 1));
 }
 
+void EncodedS2LaxPolylineShape::GetEdges(int begin, Span<Edge> edges) const {
+  ABSL_DCHECK_LE(begin + static_cast<int>(edges.size()), num_edges());
+  if (edges.empty()) return;
+
+  // Decode each vertex only once.
+  S2Point v0 = vertex(begin);
+  for (size_t i = 0; i < edges.size(); ++i) {
+    S2Point v1 = vertex(begin + i + 1);
+    edges[i] = Edge(v0, v1);
+    v0 = v1;
+  }
+}
+
 int EncodedS2LaxPolylineShape::num_chains() const {
   return std::min(1, EncodedS2LaxPolylineShape::num_edges());
 }
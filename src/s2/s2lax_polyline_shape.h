@@ -88,6 +88,7 @@ class S2LaxPolylineShape : public S2Shape {
   // S2Shape interface:
   int num_edges() const final { return std::max(0, num_vertices() - 1); }
   Edge edge(int e) const final;
+  void GetEdges(int begin, absl::Span<Edge> edges) const final;
   int dimension() const final { return 1; }
   ReferencePoint GetReferencePoint() const final {
     return ReferencePoint::Contained(false);
@@ -96,6 +97,7 @@ class S2LaxPolylineShape : public S2Shape {
   Chain chain(int i) const final;
   Edge chain_edge(int i, int j) const final;
   ChainPosition chain_position(int e) const final;
+  absl::Span<const S2Point> chain_vertex_span(int i) const final;
   TypeTag type_tag() const override { return kTypeTag; }
 
  private:
@@ -139,6 +141,7 @@ class EncodedS2LaxPolylineShape : public S2Shape {
   // S2Shape interface:
   int num_edges() const final { return std::max(0, num_vertices() - 1); }
   Edge edge(int e) const final;
+  void GetEdges(int begin, absl::Span<Edge> edges) const final;
   int dimension() const final { return 1; }
   ReferencePoint GetReferencePoint() const final {
     return ReferencePoint::Contained(false);
@@ -22,6 +22,7 @@
 #include <vector>
 
 #include <gtest/gtest.h>
+#include "absl/types/span.h"
 #include "s2/util/coding/coder.h"
 #include "s2/s2coder.h"
 #include "s2/s2coder_testing.h"
@@ -98,6 +99,37 @@ TEST(S2LaxPolylineShape, EdgeAccess) {
   EXPECT_EQ(vertices[2], edge1.v1);
 }
 
+// Checks that GetEdges() agrees with edge() for every range of edges.
+void ExpectGetEdgesMatchesEdge(const S2Shape& shape) {
+  vector<S2Shape::Edge> edges(shape.num_edges());
+  for (int begin = 0; begin <= shape.num_edges(); ++begin) {
+    for (int end = begin; end <= shape.num_edges(); ++end) {
+      shape.GetEdges(begin, absl::MakeSpan(edges.data(), end - begin));
+      for (int e = begin; e < end; ++e) {
+        EXPECT_EQ(shape.edge(e), edges[e - begin]);
+      }
+    }
+  }
+}
+
+TEST(S2LaxPolylineShape, GetEdges) {
+  vector<S2Point> vertices =
+      s2textformat::ParsePointsOrDie("0:0, 0:1, 1:1, 2:1, 2:2");
+  S2LaxPolylineShape shape(vertices);
+  ExpectGetEdgesMatchesEdge(shape);
+  EXPECT_EQ(absl::MakeConstSpan(vertices), shape.chain_vertex_span(0));
+
+  Encoder encoder;
+  shape.Encode(&encoder, s2coding::CodingHint::COMPACT);
+  Decoder decoder(encoder.base(), encoder.length());
+  EncodedS2LaxPolylineShape encoded_shape;
+  ASSERT_TRUE(encoded_shape.Init(&decoder));
+  ExpectGetEdgesMatchesEdge(encoded_shape);
+  EXPECT_TRUE(encoded_shape.chain_vertex_span(0).empty());
+
+  ExpectGetEdgesMatchesEdge(S2LaxPolylineShape());
+}
+
 TEST(EncodedS2LaxPolylineShape, RoundtripEncoding) {
   vector<S2Point> vertices = s2textformat::ParsePointsOrDie("0:0, 0:1, 1:1");
   S2LaxPolylineShape shape(vertices);
@@ -73,11 +73,13 @@
 #include "s2/s2wedge_relations.h"
 #include "s2/util/coding/coder.h"
 #include "s2/util/math/matrix3x3.h"
+#include "s2/util/math/vector.h"
 
 using absl::flat_hash_set;
 using absl::MakeSpan;
 using absl::Span;
 using std::make_unique;
+using std::min;
 using std::pair;
 using std::unique_ptr;
 using std::vector;
@@ -111,13 +113,15 @@ S2Loop::S2Loop(S2Loop&& b) noexcept
     // S2Region has no members, so does not need to be moved.
     : depth_(std::exchange(b.depth_, 0)),
       num_vertices_(std::exchange(b.num_vertices_, 0)),
-      vertices_(std::move(b.vertices_)),
+      vertices_(std::exchange(b.vertices_, nullptr)),
+      owned_vertices_(std::move(b.owned_vertices_)),
       s2debug_override_(std::move(b.s2debug_override_)),
       origin_inside_(std::move(b.origin_inside_)),
       unindexed_contains_calls_(
           b.unindexed_contains_calls_.exchange(0, std::memory_order_relaxed)),
       bound_(std::move(b.bound_)),
       subregion_bound_(std::move(b.subregion_bound_)),
+      bound_is_valid_(b.bound_is_valid_.load(std::memory_order_relaxed)),
       index_(std::move(b.index_)) {
   // Our index points to S2Loop::Shape instances which point back to S2Loop,
   // we need to update those S2Loop pointers now that we've moved.
@@ -130,7 +134,8 @@ S2Loop& S2Loop::operator=(S2Loop&& b) noexcept {
   // S2Region has no members, so does not need to be assigned.
   depth_ = std::exchange(b.depth_, 0);
   num_vertices_ = std::exchange(b.num_vertices_, 0);
-  vertices_ = std::move(b.vertices_);
+  vertices_ = std::exchange(b.vertices_, nullptr);
+  owned_vertices_ = std::move(b.owned_vertices_);
   s2debug_override_ = std::move(b.s2debug_override_);
   origin_inside_ = std::move(b.origin_inside_);
   unindexed_contains_calls_.store(
@@ -138,6 +143,8 @@ S2Loop& S2Loop::operator=(S2Loop&& b) noexcept {
       std::memory_order_relaxed);
   bound_ = std::move(b.bound_);
   subregion_bound_ = std::move(b.subregion_bound_);
+  bound_is_valid_.store(b.bound_is_valid_.load(std::memory_order_relaxed),
+                        std::memory_order_relaxed);
   index_ = std::move(b.index_);
 
   // Our index points to S2Loop::Shape instances which point back to S2Loop,
@@ -172,12 +179,18 @@ void S2Loop::ClearIndex() {
 
 void S2Loop::Init(Span<const S2Point> vertices) {
   ClearIndex();
-  num_vertices_ = vertices.size();
-  vertices_ = make_unique<S2Point[]>(num_vertices_);
-  std::copy(vertices.begin(), vertices.end(), &vertices_[0]);
+  std::copy(vertices.begin(), vertices.end(),
+            AllocateVertices(vertices.size()));
   InitOriginAndBound();
 }
 
+S2Point* S2Loop::AllocateVertices(int num_vertices) {
+  num_vertices_ = num_vertices;
+  owned_vertices_ = make_unique<S2Point[]>(num_vertices);
+  vertices_ = owned_vertices_.get();
+  return owned_vertices_.get();
+}
+
 bool S2Loop::IsValid() const {
   S2Error error;
   if (FindValidationError(&error)) {
@@ -195,7 +208,7 @@ bool S2Loop::FindValidationError(S2Error* error) const {
 bool S2Loop::FindValidationErrorNoIndex(S2Error* error) const {
   // subregion_bound_ must be at least as large as bound_.  (This is an
   // internal consistency check rather than a test of client data.)
-  ABSL_DCHECK(subregion_bound_.Contains(bound_));
+  ABSL_DCHECK(subregion_bound().Contains(bound()));
 
   // All vertices must be unit length.  (Unfortunately this check happens too
   // late in debug mode, because S2Loop construction calls s2pred::Sign which
@@ -245,6 +258,7 @@ void S2Loop::InitOriginAndBound() {
     // Check for the special empty and full loops (which have one vertex).
     if (!is_empty_or_full()) {
       origin_inside_ = false;
+      SetBound(S2LatLngRect::Empty());
       return;  // Bail out without trying to access non-existent vertices.
     }
     // If the vertex is in the southern hemisphere then the loop is full,
@@ -265,26 +279,35 @@ void S2Loop::InitOriginAndBound() {
     // we need to check the requirements of S2::AngleContainsVertex() first.
     bool v1_inside = vertex(0) != vertex(1) && vertex(2) != vertex(1) &&
                      S2::AngleContainsVertex(vertex(0), vertex(1), vertex(2));
-    origin_inside_ = false;  // Initialize before calling Contains().
+    origin_inside_ = false;  // Initialize before calling BruteForceContains().
 
-    // Note that Contains(S2Point) only does a bounds check once InitIndex()
-    // has been called, so it doesn't matter that bound_ is undefined here.
-    if (v1_inside != Contains(vertex(1))) {
+    if (v1_inside != BruteForceContains(vertex(1))) {
       origin_inside_ = true;
     }
   }
-  // We *must* call InitBound() before InitIndex(), because InitBound() calls
-  // Contains(S2Point), and Contains(S2Point) does a bounds check whenever the
-  // index is not fresh (i.e., the loop has been added to the index but the
-  // index has not been updated yet).
-  //
-  // TODO(ericv): When fewer S2Loop methods depend on internal bounds checks,
-  // consider computing the bound on demand as well.
-  InitBound();
+  // The bound is computed on demand (see bound_).
+  ResetBound();
   InitIndex();
 }
 
-void S2Loop::InitBound() {
+void S2Loop::SetBound(const S2LatLngRect& bound) {
+  bound_ = bound;
+  subregion_bound_ = S2LatLngRectBounder::ExpandForSubregions(bound_);
+  bound_is_valid_.store(true, std::memory_order_relaxed);
+}
+
+void S2Loop::ResetBound() {
+  bound_is_valid_.store(false, std::memory_order_relaxed);
+}
+
+void S2Loop::InitBoundOnce() const {
+  SpinLockHolder l(&bound_lock_);
+  if (bound_is_valid_.load(std::memory_order_relaxed)) return;
+  InitBound();
+  bound_is_valid_.store(true, std::memory_order_release);
+}
+
+void S2Loop::InitBound() const {
   // Check for the special empty and full loops.
   if (is_empty_or_full()) {
     if (is_empty()) {
@@ -307,7 +330,7 @@ void S2Loop::InitBound() {
     bounder.AddPoint(vertex(i));
   }
   S2LatLngRect b = bounder.GetBound();
-  if (Contains(S2Point(0, 0, 1))) {
+  if (BruteForceContains(S2Point(0, 0, 1))) {
     b = S2LatLngRect(R1Interval(b.lat().lo(), M_PI_2), S1Interval::Full());
   }
   // If a loop contains the south pole, then either it wraps entirely
@@ -315,7 +338,7 @@ void S2Loop::InitBound() {
   // north pole in which case b.lng().is_full() due to the test above.
   // Either way, we only need to do the south pole containment test if
   // b.lng().is_full().
-  if (b.lng().is_full() && Contains(S2Point(0, 0, -1))) {
+  if (b.lng().is_full() && BruteForceContains(S2Point(0, 0, -1))) {
     b.mutable_lat()->set_lo(-M_PI_2);
   }
   bound_ = b;
@@ -330,10 +353,10 @@ void S2Loop::InitIndex() {
   }
 }
 
-S2Loop::S2Loop(const S2Cell& cell)
-    : num_vertices_(4), vertices_(new S2Point[num_vertices_]) {
+S2Loop::S2Loop(const S2Cell& cell) {
+  S2Point* vertices = AllocateVertices(4);
   for (int i = 0; i < 4; ++i) {
-    vertices_[i] = cell.GetVertex(i);
+    vertices[i] = cell.GetVertex(i);
   }
   // We recompute the bounding rectangle ourselves, since S2Cell uses a
   // different method and we need all the bounds to be consistent.
@@ -344,13 +367,17 @@ S2Loop::~S2Loop() = default;
 
 S2Loop::S2Loop(const S2Loop& src)
     : depth_(src.depth_),
-      num_vertices_(src.num_vertices_),
-      vertices_(make_unique<S2Point[]>(num_vertices_)),
       s2debug_override_(src.s2debug_override_),
       origin_inside_(src.origin_inside_),
-      bound_(src.bound_),
-      subregion_bound_(src.subregion_bound_) {
-  std::copy(&src.vertices_[0], &src.vertices_[num_vertices_], &vertices_[0]);
+      bound_is_valid_(false) {
+  // "src" may be computing its bound in another thread.
+  if (src.bound_is_valid_.load(std::memory_order_acquire)) {
+    bound_ = src.bound_;
+    subregion_bound_ = src.subregion_bound_;
+    bound_is_valid_.store(true, std::memory_order_relaxed);
+  }
+  std::copy(src.vertices_, src.vertices_ + src.num_vertices_,
+            AllocateVertices(src.num_vertices_));
   InitIndex();
 }
 
@@ -382,7 +409,7 @@ int S2Loop::FindVertex(const S2Point& p) const {
 bool S2Loop::IsNormalized() const {
   // Optimization: if the longitude span is less than 180 degrees, then the
   // loop covers less than half the sphere and is therefore normalized.
-  if (bound_.lng().GetLength() < M_PI) return true;
+  if (bound().lng().GetLength() < M_PI) return true;
 
   return S2::IsNormalized(vertices_span());
 }
@@ -394,18 +421,27 @@ void S2Loop::Normalize() {
 
 void S2Loop::Invert() {
   ClearIndex();
+  if (vertices_ != owned_vertices_.get()) {
+    // The vertices belong to a decoder buffer (see DecodeWithinScope), so
+    // make a copy that can be modified.
+    const S2Point* vertices = vertices_;
+    std::copy(vertices, vertices + num_vertices_,
+              AllocateVertices(num_vertices_));
+  }
+  S2Point* vertices = owned_vertices_.get();
   if (is_empty_or_full()) {
-    vertices_[0] = is_full() ? kEmptyVertex : kFullVertex;
+    vertices[0] = is_full() ? kEmptyVertex : kFullVertex;
   } else {
-    std::reverse(&vertices_[0], &vertices_[num_vertices()]);
+    std::reverse(vertices, vertices + num_vertices());
   }
   // origin_inside_ must be set correctly before building the S2ShapeIndex.
   origin_inside_ ^= true;
-  if (bound_.lat().lo() > -M_PI_2 && bound_.lat().hi() < M_PI_2) {
+  if (bound_is_valid_.load(std::memory_order_relaxed) &&
+      bound_.lat().lo() > -M_PI_2 && bound_.lat().hi() < M_PI_2) {
     // The complement of this loop contains both poles.
     subregion_bound_ = bound_ = S2LatLngRect::Full();
   } else {
-    InitBound();
+    ResetBound();
   }
   InitIndex();
 }
@@ -469,7 +505,7 @@ double S2Loop::GetCurvatureMaxError() const {
 }
 
 S2Cap S2Loop::GetCapBound() const {
-  return bound_.GetCapBound();
+  return bound().GetCapBound();
 }
 
 void S2Loop::GetCellUnionBound(vector<S2CellId>* cell_ids) const {
@@ -548,8 +584,13 @@ bool S2Loop::BoundaryApproxIntersects(const MutableS2ShapeIndex::Iterator& it,
 
 bool S2Loop::Contains(const S2Point& p) const {
   // NOTE(ericv): A bounds check slows down this function by about 50%.  It is
-  // worthwhile only when it might allow us to delay building the index.
-  if (!index_.is_fresh() && !bound_.Contains(p)) return false;
+  // worthwhile only when it might allow us to delay building the index.  We
+  // also skip it if the bound has not been computed yet, since computing it
+  // costs about as much as several brute force containment tests.
+  if (!index_.is_fresh() && bound_is_valid_.load(std::memory_order_acquire) &&
+      !bound_.Contains(p)) {
+    return false;
+  }
 
   // For small loops it is faster to just check all the crossings.  We also
   // use this method during loop initialization because InitOriginAndBound()
@@ -591,11 +632,32 @@ bool S2Loop::BruteForceContains(const S2Point& p) const {
   // zero vertices do, so we might as well handle them all at once.
   if (num_vertices() < 3) return origin_inside_;
 
+  // An edge can only cross the segment from the origin to "p" if its
+  // endpoints are not strictly on the same side of the great circle through
+  // these two points.  Since this is true for only a few edges, we first
+  // triage the orientation of every vertex in a loop that has no
+  // data-dependent branches or function calls (and can therefore be
+  // vectorized), and then use S2EdgeCrosser only for the remaining edges.
+  // The vertices are processed in blocks so that the signs fit on the stack.
+  constexpr int kBlockSize = 64;
   S2Point origin = S2::Origin();
-  S2EdgeCrosser crosser(&origin, &p, &vertex(0));
+  Vector3_d origin_cross_p = origin.CrossProd(p);
+  S2EdgeCrosser crosser(&origin, &p);
   bool inside = origin_inside_;
-  for (int i = 1; i <= num_vertices(); ++i) {
-    inside ^= crosser.EdgeOrVertexCrossing(&vertex(i));
+  int8_t signs[kBlockSize + 1];
+  for (int start = 0; start < num_vertices(); start += kBlockSize) {
+    const int num_edges = min(kBlockSize, num_vertices() - start);
+    const S2Point* v = &vertices_[start];
+    for (int i = 0; i < num_edges; ++i) {
+      signs[i] = s2pred::TriageSign(origin, p, v[i], origin_cross_p);
+    }
+    signs[num_edges] = s2pred::TriageSign(origin, p, vertex(start + num_edges),
+                                          origin_cross_p);
+    for (int i = 0; i < num_edges; ++i) {
+      if (signs[i] == signs[i + 1] && signs[i] != 0) continue;
+      inside ^= crosser.EdgeOrVertexCrossing(&vertex(start + i),
+                                             &vertex(start + i + 1));
+    }
   }
   return inside;
 }
@@ -626,12 +688,12 @@ void S2Loop::Encode(Encoder* const encoder) const {
 
   encoder->put8(kCurrentLosslessEncodingVersionNumber);
   encoder->put32(num_vertices_);
-  encoder->putn(vertices_.get(), sizeof(vertices_[0]) * num_vertices_);
+  encoder->putn(vertices_, sizeof(vertices_[0]) * num_vertices_);
   encoder->put8(origin_inside_);
   encoder->put32(depth_);
   ABSL_DCHECK_GE(encoder->avail(), 0);
 
-  bound_.Encode(encoder);
+  bound().Encode(encoder);
 }
 
 bool S2Loop::Decode(Decoder* const decoder) {
@@ -639,12 +701,22 @@ bool S2Loop::Decode(Decoder* const decoder) {
   unsigned char version = decoder->get8();
   switch (version) {
     case kCurrentLosslessEncodingVersionNumber:
-      return DecodeInternal(decoder);
+      return DecodeInternal(decoder, false /*within_scope*/);
+  }
+  return false;
+}
+
+bool S2Loop::DecodeWithinScope(Decoder* const decoder) {
+  if (decoder->avail() < sizeof(unsigned char)) return false;
+  unsigned char version = decoder->get8();
+  switch (version) {
+    case kCurrentLosslessEncodingVersionNumber:
+      return DecodeInternal(decoder, true /*within_scope*/);
   }
   return false;
 }
 
-bool S2Loop::DecodeInternal(Decoder* const decoder) {
+bool S2Loop::DecodeInternal(Decoder* const decoder, bool within_scope) {
   // Perform all checks before modifying vertex state. Empty loops are
   // explicitly allowed here: a newly created loop has zero vertices
   // and such loops encode and decode properly.
@@ -659,21 +731,31 @@ bool S2Loop::DecodeInternal(Decoder* const decoder) {
     return false;
   }
   ClearIndex();
-  num_vertices_ = num_vertices;
-
-  vertices_ = make_unique<S2Point[]>(num_vertices_);
-  decoder->getn(vertices_.get(), num_vertices_ * sizeof(vertices_[0]));
+  if (within_scope) {
+    num_vertices_ = num_vertices;
+    owned_vertices_.reset();
+    vertices_ = reinterpret_cast<const S2Point*>(decoder->skip(0));
+    decoder->skip(num_vertices * sizeof(vertices_[0]));
+  } else {
+    decoder->getn(AllocateVertices(num_vertices),
+                  num_vertices * sizeof(vertices_[0]));
+  }
   origin_inside_ = decoder->get8();
   depth_ = decoder->get32();
-  if (!bound_.Decode(decoder)) return false;
-  subregion_bound_ = S2LatLngRectBounder::ExpandForSubregions(bound_);
+  S2LatLngRect bound;
+  if (!bound.Decode(decoder)) return false;
+  SetBound(bound);
 
   // An initialized loop will have some non-zero count of vertices. A default
   // (uninitialized) has zero vertices. This code supports encoding and
   // decoding of uninitialized loops, but we only want to call InitIndex for
   // initialized loops. Otherwise we defer InitIndex until the call to Init().
   if (num_vertices > 0) {
-    InitIndex();
+    if (within_scope) {
+      index_.Add(make_unique<Shape>(this));  // Skip the validity checks.
+    } else {
+      InitIndex();
+    }
   }
 
   return true;
@@ -1053,7 +1135,7 @@ bool S2Loop::Contains(const S2Loop& b) const {
   // The second part of (3) is necessary to detect the case of two loops whose
   // union is the entire sphere, i.e. two loops that contains each other's
   // boundaries but not each other's interiors.
-  if (!subregion_bound_.Contains(b.bound_)) return false;
+  if (!subregion_bound().Contains(b.bound())) return false;
 
   // Special cases to handle either loop being empty or full.
   if (is_empty_or_full() || b.is_empty_or_full()) {
@@ -1076,8 +1158,8 @@ bool S2Loop::Contains(const S2Loop& b) const {
 
   // We still need to check whether (A union B) is the entire sphere.
   // Normally this check is very cheap due to the bounding box precondition.
-  if ((b.subregion_bound_.Contains(bound_) ||
-       b.bound_.Union(bound_).is_full()) &&
+  if ((b.subregion_bound().Contains(bound()) ||
+       b.bound().Union(bound()).is_full()) &&
       b.Contains(vertex(0))) {
     return false;
   }
@@ -1109,7 +1191,7 @@ bool S2Loop::Intersects(const S2Loop& b) const {
   // a->Intersects(b) if and only if !a->Complement()->Contains(b).
   // This code is similar to Contains(), but is optimized for the case
   // where both loops enclose less than half of the sphere.
-  if (!bound_.Intersects(b.bound_)) return false;
+  if (!bound().Intersects(b.bound())) return false;
 
   // Check whether there are any edge crossings, and also check the loop
   // relationship at any shared vertices.
@@ -1125,11 +1207,12 @@ bool S2Loop::Intersects(const S2Loop& b) const {
 
   // Check whether A contains B, or A and B contain each other's boundaries.
   // (Note that A contains all the vertices of B in either case.)
-  if (subregion_bound_.Contains(b.bound_) || bound_.Union(b.bound_).is_full()) {
+  if (subregion_bound().Contains(b.bound()) ||
+      bound().Union(b.bound()).is_full()) {
     if (Contains(b.vertex(0))) return true;
   }
   // Check whether B contains A.
-  if (b.subregion_bound_.Contains(bound_)) {
+  if (b.subregion_bound().Contains(bound())) {
     if (b.Contains(vertex(0))) return true;
   }
   return false;
@@ -1199,7 +1282,7 @@ int S2Loop::CompareBoundary(const S2Loop& b) const {
   ABSL_DCHECK(!b.is_full() || !b.is_hole());
 
   // The bounds must intersect for containment or crossing.
-  if (!bound_.Intersects(b.bound_)) return -1;
+  if (!bound().Intersects(b.bound())) return -1;
 
   // Full loops are handled as though the loop surrounded the entire sphere.
   if (is_full()) return 1;
@@ -1219,7 +1302,7 @@ int S2Loop::CompareBoundary(const S2Loop& b) const {
 }
 
 bool S2Loop::ContainsNested(const S2Loop& b) const {
-  if (!subregion_bound_.Contains(b.bound_)) return false;
+  if (!subregion_bound().Contains(b.bound())) return false;
 
   // Special cases to handle either loop being empty or full.  Also bail out
   // when B has no vertices to avoid heap overflow on the vertex(1) call
@@ -1376,7 +1459,7 @@ void S2Loop::EncodeCompressed(Encoder* encoder, const S2XYZFaceSiTi* vertices,
   encoder->put_varint32(properties.to_ulong());
   encoder->put_varint32(depth_);
   if (properties.test(kBoundEncoded)) {
-    bound_.Encode(encoder);
+    bound().Encode(encoder);
   }
   ABSL_DCHECK_GE(encoder->avail(), 0);
 }
@@ -1394,11 +1477,10 @@ bool S2Loop::DecodeCompressed(Decoder* decoder, int snap_level) {
     return false;
   }
   ClearIndex();
-  num_vertices_ = unsigned_num_vertices;
-  vertices_ = make_unique<S2Point[]>(num_vertices_);
+  S2Point* vertices = AllocateVertices(unsigned_num_vertices);
 
   if (!S2DecodePointsCompressed(decoder, snap_level,
-                                MakeSpan(vertices_.get(), num_vertices_))) {
+                                MakeSpan(vertices, num_vertices_))) {
     return false;
   }
   uint32_t properties_uint32;
@@ -1415,12 +1497,13 @@ bool S2Loop::DecodeCompressed(Decoder* decoder, int snap_level) {
   depth_ = unsigned_depth;
 
   if (properties.test(kBoundEncoded)) {
-    if (!bound_.Decode(decoder)) {
+    S2LatLngRect bound;
+    if (!bound.Decode(decoder)) {
       return false;
     }
-    subregion_bound_ = S2LatLngRectBounder::ExpandForSubregions(bound_);
+    SetBound(bound);
   } else {
-    InitBound();
+    ResetBound();
   }
   InitIndex();
   return true;
@@ -1476,7 +1559,7 @@ unique_ptr<S2Loop> S2Loop::MakeRegularLoop(const Matrix3x3_d& frame,
 
 size_t S2Loop::SpaceUsed() const {
   size_t size = sizeof(*this);
-  size += num_vertices() * sizeof(S2Point);
+  if (owned_vertices_) size += num_vertices() * sizeof(S2Point);
   // index_ itself is already included in sizeof(*this).
   size += index_.SpaceUsed() - sizeof(index_);
   return size;
@@ -31,6 +31,7 @@
 #include "absl/types/span.h"
 
 #include "s2/_fp_contract_off.h"  // IWYU pragma: keep
+#include "s2/base/spinlock.h"
 #include "s2/mutable_s2shape_index.h"
 #include "s2/s1angle.h"
 #include "s2/s1chord_angle.h"
@@ -210,7 +211,7 @@ class S2Loop final : public S2Region {
   // Returns an S2PointLoopSpan containing the loop vertices, for use with the
   // functions defined in s2loop_measures.h.
   S2PointLoopSpan vertices_span() const {
-    return S2PointLoopSpan(vertices_.get(), num_vertices());
+    return S2PointLoopSpan(vertices_, num_vertices());
   }
 
   // Returns true if this is the special empty loop that contains no points.
@@ -397,8 +398,12 @@ class S2Loop final : public S2Region {
   // GetRectBound() returns essentially tight results, while GetCapBound()
   // might have a lot of extra padding.  Both bounds are conservative in that
   // if the loop contains a point P, then the bound contains P also.
+  //
+  // The rectangle bound is computed the first time it is needed (by these
+  // methods or by the relationship methods above), since many loops are
+  // only decoded and encoded again, or tested against a few points.
   S2Cap GetCapBound() const override;
-  S2LatLngRect GetRectBound() const override { return bound_; }
+  S2LatLngRect GetRectBound() const override { return bound(); }
   void GetCellUnionBound(std::vector<S2CellId>* cell_ids) const override;
 
   bool Contains(const S2Cell& cell) const override;
@@ -424,6 +429,17 @@ class S2Loop final : public S2Region {
   // This method may be called with loops that have already been initialized.
   bool Decode(Decoder* decoder);
 
+  // Like Decode(), except that the loop vertices refer directly to the data
+  // in the decoder's buffer rather than being copied, and no validity checks
+  // are performed (even in debug builds).  The buffer must persist until the
+  // loop is destroyed or reinitialized, and should contain trusted data.
+  // Only the lossless encoding written by Encode() is supported.
+  //
+  // This is intended for quickly loading large numbers of loops that were
+  // written by the same process or pipeline.  Unaligned vertex data is read
+  // in place, as with EncodedS2PointVector.
+  bool DecodeWithinScope(Decoder* decoder);
+
   ////////////////////////////////////////////////////////////////////////
   // Methods intended primarily for use by the S2Polygon implementation:
 
@@ -549,9 +565,25 @@ class S2Loop final : public S2Region {
   static const S2Point kFullVertex;
 
   void InitOriginAndBound();
-  void InitBound();
   void InitIndex();
 
+  // Returns bound_ or subregion_bound_, computing them first if necessary.
+  const S2LatLngRect& bound() const;
+  const S2LatLngRect& subregion_bound() const;
+
+  // Sets bound_ and subregion_bound_ (which must not be in use by another
+  // thread).
+  void SetBound(const S2LatLngRect& bound);
+
+  // Discards bound_ and subregion_bound_ so that they are recomputed the next
+  // time they are needed.
+  void ResetBound();
+
+  // Computes bound_ and subregion_bound_ unless another thread has already
+  // done so.
+  void InitBoundOnce() const;
+  void InitBound() const;
+
   // A version of Contains(S2Point) that does not use the S2ShapeIndex.
   // Used by the S2Polygon implementation.
   bool BruteForceContains(const S2Point& p) const;
@@ -562,8 +594,12 @@ class S2Loop final : public S2Region {
   // loop self-intersections.
   bool FindValidationErrorNoIndex(S2Error* error) const;
 
-  // Internal implementation of the Decode method above.
-  bool DecodeInternal(Decoder* decoder);
+  // Internal implementation of the Decode methods above.
+  bool DecodeInternal(Decoder* decoder, bool within_scope);
+
+  // Replaces the vertices with a newly allocated array of the given size
+  // owned by this loop, and returns a pointer to it.
+  S2Point* AllocateVertices(int num_vertices);
 
   // Converts the loop vertices to the S2XYZFaceSiTi format and store the result
   // in the given array, which must be large enough to store all the vertices.
@@ -643,7 +679,11 @@ class S2Loop final : public S2Region {
   // would be somewhat more expensive (due to division by `sizeof(S2Point) ==
   // 24`, although this is typically implemented with a multiply and shift).
   int num_vertices_ = 0;
-  std::unique_ptr<S2Point[]> vertices_;
+  const S2Point* vertices_ = nullptr;
+
+  // The storage for "vertices_", unless the vertices are owned by a decoder
+  // buffer (see DecodeWithinScope).
+  std::unique_ptr<S2Point[]> owned_vertices_;
 
   S2Debug s2debug_override_ = S2Debug::ALLOW;
   bool origin_inside_ = false;  // Does the loop contain S2::Origin()?
@@ -657,13 +697,23 @@ class S2Loop final : public S2Region {
 
   // "bound_" is a conservative bound on all points contained by this loop:
   // if A.Contains(P), then A.bound_.Contains(S2LatLng(P)).
-  S2LatLngRect bound_;
+  //
+  // Computing the bound costs several times as much as decoding the loop,
+  // so it is done lazily by the first method that needs it.  Only use these
+  // fields via bound() and subregion_bound().
+  mutable S2LatLngRect bound_;
 
   // Since "bound_" is not exact, it is possible that a loop A contains
   // another loop B whose bounds are slightly larger.  "subregion_bound_"
   // has been expanded sufficiently to account for this error, i.e.
   // if A.Contains(B), then A.subregion_bound_.Contains(B.bound_).
-  S2LatLngRect subregion_bound_;
+  mutable S2LatLngRect subregion_bound_;
+
+  // True if bound_ and subregion_bound_ have been computed.  This is set with
+  // "release" semantics while holding bound_lock_, so that threads that see
+  // it as true with "acquire" semantics may read the bounds without locking.
+  mutable std::atomic<bool> bound_is_valid_{true};
+  mutable SpinLock bound_lock_;
 
   // Spatial index for this loop.
   MutableS2ShapeIndex index_;
@@ -674,6 +724,16 @@ class S2Loop final : public S2Region {
 
 //////////////////// Implementation Details Follow ////////////////////////
 
+inline const S2LatLngRect& S2Loop::bound() const {
+  if (!bound_is_valid_.load(std::memory_order_acquire)) InitBoundOnce();
+  return bound_;
+}
+
+inline const S2LatLngRect& S2Loop::subregion_bound() const {
+  if (!bound_is_valid_.load(std::memory_order_acquire)) InitBoundOnce();
+  return subregion_bound_;
+}
+
 inline absl::Span<const S2Point> S2Loop::kEmpty() {
   return absl::MakeConstSpan(&kEmptyVertex, 1);
 }
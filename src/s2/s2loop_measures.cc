@@ -29,8 +29,10 @@
 #include "s2/s1angle.h"
 #include "s2/s2centroids.h"
 #include "s2/s2measures.h"
+#include "s2/s2edge_crossings.h"
 #include "s2/s2point.h"
 #include "s2/s2point_span.h"
+#include "s2/s2predicates.h"
 
 using std::fabs;
 using std::max;
@@ -39,6 +41,80 @@ using std::vector;
 
 namespace S2 {
 
+// The triangle fan kernels below process this many consecutive triangles at
+// a time.  First the sides of all triangles in the block are computed, then
+// their areas or centroids, and finally their sum.  Adjacent triangles of the
+// fan share a side, so each side only needs to be computed once.
+static constexpr int kFanBlockSize = 64;
+
+// Returns true if internal::GetSurfaceIntegral() would use loop[0] as the
+// origin of every triangle in its fan, i.e. if no vertex is nearly antipodal
+// to loop[0].  (Any vertex whose dot product with loop[0] is at least -0.5 is
+// within 120 degrees of it, which is far below the threshold used there.)
+static bool IsSimpleFan(S2PointLoopSpan loop) {
+  const S2Point& origin = loop[0];
+  bool simple = true;
+  for (const S2Point& v : loop) simple &= (origin.DotProd(v) >= -0.5);
+  return simple;
+}
+
+// Equivalent to GetSurfaceIntegralKahan(loop, S2::SignedArea) (the result is
+// identical) when IsSimpleFan(loop) is true.
+static double GetSimpleFanSignedArea(S2PointLoopSpan loop) {
+  ABSL_DCHECK_GE(loop.size(), 3);
+  const S2Point& origin = loop[0];
+  const int num_triangles = loop.size() - 2;
+  // fan[k] is the length of the fan edge (origin, loop[begin + k]), and
+  // edge[k] is the length of the loop edge (loop[begin + k], loop[begin+k+1]).
+  double fan[kFanBlockSize + 1], edge[kFanBlockSize], area[kFanBlockSize];
+  fan[kFanBlockSize] = internal::StableAngle(origin, loop[1]);
+  internal::KahanSum<double> sum;
+  for (int begin = 1; begin <= num_triangles; begin += kFanBlockSize) {
+    const int m = min(kFanBlockSize, num_triangles + 1 - begin);
+    const S2Point* v = &loop[begin];
+    fan[0] = fan[kFanBlockSize];
+    for (int k = 0; k < m; ++k) {
+      fan[k + 1] = internal::StableAngle(origin, v[k + 1]);
+      edge[k] = internal::StableAngle(v[k], v[k + 1]);
+    }
+    for (int k = 0; k < m; ++k) {
+      area[k] = s2pred::Sign(origin, v[k], v[k + 1]) *
+                internal::Area(origin, v[k], v[k + 1], edge[k], fan[k + 1],
+                               fan[k]);
+    }
+    for (int k = 0; k < m; ++k) sum += area[k];
+    fan[kFanBlockSize] = fan[m];
+  }
+  return static_cast<double>(sum);
+}
+
+// Equivalent to GetSurfaceIntegral(loop, S2::TrueCentroid) (the result is
+// identical) when IsSimpleFan(loop) is true.
+static S2Point GetSimpleFanCentroid(S2PointLoopSpan loop) {
+  ABSL_DCHECK_GE(loop.size(), 3);
+  const S2Point& origin = loop[0];
+  const int num_triangles = loop.size() - 2;
+  // As above, but storing the side ratios used by TrueCentroid().
+  double fan[kFanBlockSize + 1], edge[kFanBlockSize];
+  fan[kFanBlockSize] = internal::TrueCentroidSideRatio(origin, loop[1]);
+  S2Point sum;
+  for (int begin = 1; begin <= num_triangles; begin += kFanBlockSize) {
+    const int m = min(kFanBlockSize, num_triangles + 1 - begin);
+    const S2Point* v = &loop[begin];
+    fan[0] = fan[kFanBlockSize];
+    for (int k = 0; k < m; ++k) {
+      fan[k + 1] = internal::TrueCentroidSideRatio(origin, v[k + 1]);
+      edge[k] = internal::TrueCentroidSideRatio(v[k], v[k + 1]);
+    }
+    for (int k = 0; k < m; ++k) {
+      sum += internal::TrueCentroid(origin, v[k], v[k + 1], edge[k],
+                                    fan[k + 1], fan[k]);
+    }
+    fan[kFanBlockSize] = fan[m];
+  }
+  return sum;
+}
+
 S1Angle GetPerimeter(S2PointLoopSpan loop) {
   S1Angle perimeter = S1Angle::Zero();
   if (loop.size() <= 1) return perimeter;
@@ -122,7 +198,9 @@ double GetSignedArea(S2PointLoopSpan loop) {
 
   // The signed area should be between approximately -4*Pi and 4*Pi.
   // Normalize it to be in the range [-2*Pi, 2*Pi].
-  double area = GetSurfaceIntegralKahan(loop, S2::SignedArea);
+  double area = (loop.size() >= 3 && IsSimpleFan(loop))
+                    ? GetSimpleFanSignedArea(loop)
+                    : GetSurfaceIntegralKahan(loop, S2::SignedArea);
   double max_error = GetCurvatureMaxError(loop);
 
   // Normalize the area to be in the range (-2*Pi, 2*Pi].  Effectively this
@@ -225,14 +303,24 @@ double GetCurvature(S2PointLoopSpan loop) {
   // spiral shapes, where the partial sum of the turning angles can be linear
   // in the number of vertices.)  To avoid this we use the Kahan summation
   // algorithm (http://en.wikipedia.org/wiki/Kahan_summation_algorithm).
+  //
+  // Each turn angle is computed from the cross products of its two adjacent
+  // edges (see S2::TurnAngle), so we pass the cross product of each edge on
+  // to the next vertex rather than computing it twice.
   LoopOrder order = GetCanonicalLoopOrder(loop);
   int i = order.first, dir = order.dir, n = loop.size();
-  double sum = S2::TurnAngle(loop[(i + n - dir) % n], loop[i],
-                             loop[(i + dir) % n]);
+  const S2Point& a0 = loop[(i + n - dir) % n];
+  const S2Point& c0 = loop[(i + dir) % n];
+  S2Point bc = S2::RobustCrossProd(loop[i], c0);
+  double sum = S2::internal::TurnAngle(
+      a0, loop[i], c0, S2::RobustCrossProd(a0, loop[i]), bc);
   double compensation = 0;  // Kahan summation algorithm
   while (--n > 0) {
     i += dir;
-    double angle = S2::TurnAngle(loop[i - dir], loop[i], loop[i + dir]);
+    S2Point ab = bc;
+    bc = S2::RobustCrossProd(loop[i], loop[i + dir]);
+    double angle = S2::internal::TurnAngle(loop[i - dir], loop[i],
+                                           loop[i + dir], ab, bc);
     double old_sum = sum;
     angle += compensation;
     sum += angle;
@@ -268,6 +356,9 @@ S2Point GetCentroid(S2PointLoopSpan loop) {
   // interior, or the negative of the integral of position over the loop
   // exterior.  But these two values are the same (!), because the integral of
   // position over the entire sphere is (0, 0, 0).
+  if (loop.size() >= 3 && IsSimpleFan(loop)) {
+    return GetSimpleFanCentroid(loop);
+  }
   return GetSurfaceIntegral(loop, S2::TrueCentroid);
 }
 
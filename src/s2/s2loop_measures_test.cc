@@ -33,6 +33,7 @@
 #include "absl/strings/str_cat.h"
 #include "absl/strings/string_view.h"
 #include "s2/s1angle.h"
+#include "s2/s2centroids.h"
 #include "s2/s2debug.h"
 #include "s2/s2latlng.h"
 #include "s2/s2loop.h"
@@ -471,6 +472,36 @@ TEST_F(LoopTestBase, GetAreaAndCentroid) {
   }
 }
 
+// GetSignedArea() and GetCentroid() use a faster kernel when the triangle
+// fan has a fixed origin.  Check that it gives exactly the same results as the
+// generic surface integral, including for loops that span several blocks and
+// loops where the generic code must move the origin.
+TEST(GetSignedArea, FanKernelMatchesSurfaceIntegral) {
+  absl::BitGen bitgen(S2Testing::MakeTaggedSeedSeq(
+      "FAN_KERNEL_MATCHES_SURFACE_INTEGRAL",
+      absl::LogInfoStreamer(__FILE__, __LINE__).stream()));
+  for (int num_vertices : {3, 4, 63, 64, 65, 66, 130, 1000}) {
+    for (double radius_degrees : {1e-6, 0.1, 10.0, 59.0, 100.0, 170.0}) {
+      S2Point center = s2random::Point(bitgen);
+      vector<S2Point> loop = S2Testing::MakeRegularPoints(
+          center, S1Angle::Degrees(radius_degrees), num_vertices);
+      for (int reverse = 0; reverse < 2; ++reverse) {
+        double expected_area = remainder(
+            S2::GetSurfaceIntegralKahan(loop, S2::SignedArea), 4 * M_PI);
+        if (fabs(expected_area) > S2::GetCurvatureMaxError(loop) &&
+            expected_area != -2 * M_PI) {
+          EXPECT_EQ(expected_area, S2::GetSignedArea(loop))
+              << num_vertices << " vertices, radius " << radius_degrees;
+        }
+        EXPECT_EQ(S2::GetSurfaceIntegral(loop, S2::TrueCentroid),
+                  S2::GetCentroid(loop))
+            << num_vertices << " vertices, radius " << radius_degrees;
+        std::reverse(loop.begin(), loop.end());
+      }
+    }
+  }
+}
+
 static void ExpectSameOrder(S2PointLoopSpan loop1, S2::LoopOrder order1,
                             S2PointLoopSpan loop2, S2::LoopOrder order2) {
   ABSL_DCHECK_EQ(loop1.size(), loop2.size());
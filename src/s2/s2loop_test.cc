@@ -24,6 +24,7 @@
 #include <memory>
 #include <random>
 #include <string>
+#include <thread>
 #include <utility>
 #include <vector>
 
@@ -49,6 +50,7 @@
 #include "s2/r1interval.h"
 #include "s2/s1angle.h"
 #include "s2/s1interval.h"
+#include "s2/s2cap.h"
 #include "s2/s2cell.h"
 #include "s2/s2cell_id.h"
 #include "s2/s2debug.h"
@@ -64,6 +66,7 @@
 #include "s2/s2predicates.h"
 #include "s2/s2random.h"
 #include "s2/s2shape.h"
+#include "s2/s2shapeutil_contains_brute_force.h"
 #include "s2/s2testing.h"
 #include "s2/s2text_format.h"
 #include "s2/util/coding/coder.h"
@@ -292,6 +295,25 @@ TEST_F(S2LoopTestBase, GetRectBound) {
       R1Interval(-M_PI_2, 0), kRectError.lat().radians()));
 }
 
+TEST(S2Loop, GetRectBoundIsThreadSafe) {
+  // The bound is computed on first use, so check that threads computing it
+  // concurrently all get the same result.
+  unique_ptr<S2Loop> reference =
+      S2Loop::MakeRegularLoop(S2LatLng::FromDegrees(60, 10).ToPoint(),
+                              S1Angle::Degrees(40), 100);
+  const S2LatLngRect expected = reference->GetRectBound();
+  for (int iter = 0; iter < 10; ++iter) {
+    S2Loop loop(reference->vertices_span());
+    vector<S2LatLngRect> bounds(4);
+    vector<std::thread> threads;
+    for (S2LatLngRect& bound : bounds) {
+      threads.emplace_back([&loop, &bound] { bound = loop.GetRectBound(); });
+    }
+    for (std::thread& thread : threads) thread.join();
+    for (const S2LatLngRect& bound : bounds) EXPECT_EQ(bound, expected);
+  }
+}
+
 static void Rotate(unique_ptr<S2Loop>* ptr) {
   S2Loop* loop = ptr->get();
   vector<S2Point> vertices;
@@ -547,6 +569,39 @@ TEST_F(S2LoopTestBase, Contains) {
   }
 }
 
+TEST(S2Loop, BruteForceContainsMatchesEdgeCrosser) {
+  // Contains() does not use the index for the first few calls on a loop (and
+  // never for small loops).  Check that this code path returns the same
+  // results as counting crossings one edge at a time,
+  // including for loops that span several blocks of vertices and for points
+  // on the loop boundary.
+  absl::BitGen bitgen(S2Testing::MakeTaggedSeedSeq(
+      "BRUTE_FORCE_CONTAINS_MATCHES_EDGE_CROSSER",
+      absl::LogInfoStreamer(__FILE__, __LINE__).stream()));
+  for (int num_vertices : {3, 4, 10, 32, 63, 64, 65, 129, 200}) {
+    const S2Point center = s2random::Point(bitgen);
+    const S1Angle radius = S1Angle::Degrees(1);
+    unique_ptr<S2Loop> loop =
+        S2Loop::MakeRegularLoop(center, radius, num_vertices);
+    vector<S2Point> points(loop->vertices_span().begin(),
+                           loop->vertices_span().end());
+    for (int i = 0; i < num_vertices; ++i) {
+      points.push_back((loop->vertex(i) + loop->vertex(i + 1)).Normalize());
+    }
+    const S2Cap cap(center, 1.5 * radius);
+    for (int i = 0; i < 100; ++i) {
+      points.push_back(s2random::SamplePoint(bitgen, cap));
+    }
+    S2Loop::Shape shape(loop.get());
+    for (const S2Point& p : points) {
+      // Use a new loop for every point so that the index is never built.
+      S2Loop copy(loop->vertices_span());
+      EXPECT_EQ(copy.Contains(p), s2shapeutil::ContainsBruteForce(shape, p))
+          << num_vertices << " " << p;
+    }
+  }
+}
+
 TEST(S2Loop, DefaultLoopIsInvalid) {
   S2Loop loop;
   EXPECT_FALSE(loop.IsValid());
@@ -1046,6 +1101,55 @@ TEST(S2Loop, EncodeDecode) {
   TestEncodeDecode(uninitialized);
 }
 
+TEST(S2Loop, DecodeWithinScope) {
+  unique_ptr<S2Loop> l(MakeLoopOrDie("30:20, 40:20, 39:43, 33:35"));
+  l->set_depth(3);
+  Encoder encoder;
+  l->Encode(&encoder);
+  const char* begin = encoder.base();
+  const char* end = begin + encoder.length();
+  auto in_buffer = [&](const S2Loop& loop) {
+    const char* p = reinterpret_cast<const char*>(&loop.vertex(0));
+    return p >= begin && p < end;
+  };
+
+  Decoder decoder(encoder.base(), encoder.length());
+  S2Loop decoded;
+  ASSERT_TRUE(decoded.DecodeWithinScope(&decoder));
+  CheckIdentical(*l, decoded);
+  EXPECT_TRUE(in_buffer(decoded));
+  for (const S2Point& p : {S2LatLng::FromDegrees(35, 30).ToPoint(),
+                           S2LatLng::FromDegrees(0, 0).ToPoint()}) {
+    EXPECT_EQ(decoded.Contains(p), l->Contains(p));
+  }
+
+  // Copies own their vertices, while moves keep referring to the buffer.
+  unique_ptr<S2Loop> copy(decoded.Clone());
+  EXPECT_FALSE(in_buffer(*copy));
+  S2Loop moved(std::move(decoded));
+  EXPECT_TRUE(in_buffer(moved));
+  CheckIdentical(*l, moved);
+
+  // Inverting the loop copies the vertices rather than modifying the buffer.
+  const string original(begin, end);
+  moved.Invert();
+  EXPECT_FALSE(in_buffer(moved));
+  EXPECT_EQ(string(begin, end), original);
+  moved.Invert();
+  EXPECT_TRUE(moved.BoundaryEquals(*l));
+
+  // Decoding normally after decoding within scope owns the vertices again.
+  Decoder decoder2(encoder.base(), encoder.length());
+  ASSERT_TRUE(moved.DecodeWithinScope(&decoder2));
+  Decoder decoder3(encoder.base(), encoder.length());
+  ASSERT_TRUE(moved.Decode(&decoder3));
+  EXPECT_FALSE(in_buffer(moved));
+  CheckIdentical(*l, moved);
+
+  Decoder truncated(encoder.base(), encoder.length() - 1);
+  EXPECT_FALSE(decoded.DecodeWithinScope(&truncated));
+}
+
 TEST(S2Loop, Moveable) {
   // We'll need a couple identical copies of a reference loop to compare.
   auto loop_factory = []() {
@@ -50,7 +50,14 @@ double TurnAngle(const S2Point& a, const S2Point& b, const S2Point& c) {
   // Unfortunately we can't save RobustCrossProd(a, b) and pass it as the
   // optional 4th argument to Sign(), because Sign() requires a.CrossProd(b)
   // exactly (the robust version differs in magnitude).
-  double angle = RobustCrossProd(a, b).Angle(RobustCrossProd(b, c));
+  return internal::TurnAngle(a, b, c, RobustCrossProd(a, b),
+                             RobustCrossProd(b, c));
+}
+
+double internal::TurnAngle(const S2Point& a, const S2Point& b,
+                           const S2Point& c, const S2Point& ab,
+                           const S2Point& bc) {
+  double angle = ab.Angle(bc);
 
   // Don't return Sign() * angle because it is legal to have (a == c).
   return (s2pred::Sign(a, b, c) > 0) ? angle : -angle;
@@ -78,7 +85,7 @@ double TurnAngle(const S2Point& a, const S2Point& b, const S2Point& c) {
 // Reference: Kahan, W. (2006, Jan 11). "How Futile are Mindless Assessments of
 //   Roundoff in Floating-Point Computation?"
 // (p. 47). https://people.eecs.berkeley.edu/~wkahan/Mindless.pdf
-double StableAngle(S2Point a, S2Point b) {
+double internal::StableAngle(const S2Point& a, const S2Point& b) {
   ABSL_DCHECK(IsUnitLength(a));
   ABSL_DCHECK(IsUnitLength(b));
   return 2 * atan2((a - b).Norm(), (a + b).Norm());
@@ -125,9 +132,13 @@ double Area(const S2Point& a, const S2Point& b, const S2Point& c) {
   // more information.
   //
   // TODO(ericv): Implement rigorous error bounds (analysis already done).
-  double sa = StableAngle(b, c);
-  double sb = StableAngle(c, a);
-  double sc = StableAngle(a, b);
+  return internal::Area(a, b, c, internal::StableAngle(b, c),
+                        internal::StableAngle(c, a),
+                        internal::StableAngle(a, b));
+}
+
+double internal::Area(const S2Point& a, const S2Point& b, const S2Point& c,
+                      double sa, double sb, double sc) {
   double s = 0.5 * (sa + sb + sc);
   if (s >= 3e-4) {
     // Consider whether Girard's formula might be more accurate.
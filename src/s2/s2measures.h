@@ -73,6 +73,30 @@ double GirardArea(const S2Point& a, const S2Point& b, const S2Point& c);
 // and a negative value otherwise.
 double SignedArea(const S2Point& a, const S2Point& b, const S2Point& c);
 
+namespace internal {
+
+// Like TurnAngle(), but takes the values of RobustCrossProd(a, b) and
+// RobustCrossProd(b, c) as "ab" and "bc" respectively.  This allows callers
+// that compute the turn angles at consecutive loop vertices to compute each
+// cross product only once.  The result is identical to TurnAngle().
+double TurnAngle(const S2Point& a, const S2Point& b, const S2Point& c,
+                 const S2Point& ab, const S2Point& bc);
+
+// Returns the angle between the unit vectors "a" and "b" using the stable
+// formula of Area() (see s2measures.cc).  The result is exactly symmetric in
+// "a" and "b".
+double StableAngle(const S2Point& a, const S2Point& b);
+
+// Like Area(), but takes the triangle side lengths sa = StableAngle(b, c),
+// sb = StableAngle(c, a), and sc = StableAngle(a, b).  This allows callers
+// that compute the areas of many triangles with shared sides (such as a
+// triangle fan) to compute each side only once.  The result is identical to
+// Area().
+double Area(const S2Point& a, const S2Point& b, const S2Point& c,
+            double sa, double sb, double sc);
+
+}  // namespace internal
+
 }  // namespace S2
 
 #endif  // S2_S2MEASURES_H_
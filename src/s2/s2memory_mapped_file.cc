@@ -0,0 +1,137 @@
+// Copyright 2024 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "s2/s2memory_mapped_file.h"
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <string>
+
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "s2/s2error.h"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using absl::StrCat;
+using absl::string_view;
+using std::shared_ptr;
+using std::string;
+
+namespace {
+
+// Checks that [offset, offset + *length) lies within a file of the given
+// size, replacing kToEndOfFile by the actual remaining length.
+bool ClipRegion(string_view path, uint64_t file_size, uint64_t offset,
+                uint64_t* length, S2Error& error) {
+  if (offset > file_size) {
+    error = S2Error::OutOfRange(
+        StrCat("Offset ", offset, " is past the end of ", path));
+    return false;
+  }
+  if (*length == S2MemoryMappedFile::kToEndOfFile) {
+    *length = file_size - offset;
+  } else if (*length > file_size - offset) {
+    error = S2Error::OutOfRange(
+        StrCat("Region [", offset, ", ", offset, " + ", *length,
+               ") extends past the end of ", path));
+    return false;
+  }
+  return true;
+}
+
+}  // namespace
+
+shared_ptr<const S2MemoryMappedFile> S2MemoryMappedFile::Open(
+    string_view path, S2Error& error, uint64_t offset, uint64_t length) {
+  // The constructor is private, so std::make_shared cannot be used.
+  shared_ptr<S2MemoryMappedFile> file(new S2MemoryMappedFile);
+  const string path_str(path);
+#ifndef _WIN32
+  int fd = open(path_str.c_str(), O_RDONLY);
+  if (fd < 0) {
+    error = S2Error::InvalidArgument(
+        StrCat("Cannot open ", path, ": ", strerror(errno)));
+    return nullptr;
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    error = S2Error::Unknown(
+        StrCat("Cannot stat ", path, ": ", strerror(errno)));
+    close(fd);
+    return nullptr;
+  }
+  if (!ClipRegion(path, st.st_size, offset, &length, error)) {
+    close(fd);
+    return nullptr;
+  }
+  if (length == 0) {
+    // mmap() does not accept empty regions.
+    close(fd);
+    file->data_ = file->buffer_.data();
+    return file;
+  }
+  // mmap() requires the file offset to be a multiple of the page size.
+  const uint64_t page_size = sysconf(_SC_PAGESIZE);
+  const uint64_t map_offset = offset - offset % page_size;
+  const size_t map_size = length + (offset - map_offset);
+  void* mapping = mmap(nullptr, map_size, PROT_READ, MAP_SHARED, fd,
+                       static_cast<off_t>(map_offset));
+  close(fd);  // The mapping remains valid after the descriptor is closed.
+  if (mapping == MAP_FAILED) {
+    error = S2Error::Unknown(
+        StrCat("Cannot mmap ", path, ": ", strerror(errno)));
+    return nullptr;
+  }
+  file->mapping_ = mapping;
+  file->mapping_size_ = map_size;
+  file->data_ = static_cast<const char*>(mapping) + (offset - map_offset);
+  file->size_ = length;
+#else
+  std::ifstream in(path_str, std::ios::binary | std::ios::ate);
+  if (!in) {
+    error = S2Error::InvalidArgument(StrCat("Cannot open ", path));
+    return nullptr;
+  }
+  if (!ClipRegion(path, static_cast<uint64_t>(in.tellg()), offset, &length,
+                  error)) {
+    return nullptr;
+  }
+  file->buffer_.resize(length);
+  in.seekg(offset);
+  if (!in.read(&file->buffer_[0], length)) {
+    error = S2Error::DataLoss(StrCat("Cannot read ", path));
+    return nullptr;
+  }
+  file->data_ = file->buffer_.data();
+  file->size_ = length;
+#endif
+  return file;
+}
+
+S2MemoryMappedFile::~S2MemoryMappedFile() {
+#ifndef _WIN32
+  if (mapping_ != nullptr) munmap(mapping_, mapping_size_);
+#endif
+}
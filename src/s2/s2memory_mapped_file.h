@@ -0,0 +1,94 @@
+// Copyright 2024 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef S2_S2MEMORY_MAPPED_FILE_H_
+#define S2_S2MEMORY_MAPPED_FILE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "absl/strings/string_view.h"
+#include "s2/s2error.h"
+
+// S2MemoryMappedFile maps a region of a file into memory read-only.  It is
+// intended for serving large encoded geometry (e.g., EncodedS2ShapeIndex)
+// directly from disk without first reading it into a std::string.  Pages are
+// loaded by the operating system on demand, so opening even a very large
+// file is nearly instantaneous, and multiple processes that map the same
+// file share a single copy of its data in the page cache.
+//
+// Objects are always held by std::shared_ptr so that decoded structures that
+// point into the mapped region can keep it alive (see the "data_owner"
+// arguments of EncodedS2ShapeIndex::Init and s2shapeutil::
+// LazyDecodeShapeFactory).  Example usage:
+//
+//   S2Error error;
+//   auto file = S2MemoryMappedFile::Open("/path/to/index", error);
+//   if (file == nullptr) return error;
+//   Decoder decoder(file->data(), file->size());
+//   auto factory = s2shapeutil::LazyDecodeShapeFactory(&decoder, file, error);
+//   EncodedS2ShapeIndex index;
+//   if (!index.Init(&decoder, factory, file)) ...
+//
+// On platforms without mmap() support the region is read into memory
+// instead; the interface is the same.
+//
+// This class is thread-safe (it is immutable once opened).
+class S2MemoryMappedFile {
+ public:
+  // Indicates that the region should extend to the end of the file.
+  static constexpr uint64_t kToEndOfFile = ~uint64_t{0};
+
+  // Maps the region [offset, offset + length) of the file at "path".  The
+  // offset need not be aligned to a page boundary.  Returns nullptr and sets
+  // "error" if the file cannot be opened or the region extends past the end
+  // of the file.
+  static std::shared_ptr<const S2MemoryMappedFile> Open(
+      absl::string_view path, S2Error& error, uint64_t offset = 0,
+      uint64_t length = kToEndOfFile);
+
+  ~S2MemoryMappedFile();
+
+  S2MemoryMappedFile(const S2MemoryMappedFile&) = delete;
+  S2MemoryMappedFile& operator=(const S2MemoryMappedFile&) = delete;
+
+  // Returns the start of the requested region.
+  const char* data() const { return data_; }
+
+  // Returns the length of the requested region in bytes.
+  size_t size() const { return size_; }
+
+  // Returns true if the region is backed by a memory mapping (as opposed to
+  // having been read into memory).
+  bool is_mapped() const { return mapping_ != nullptr; }
+
+ private:
+  S2MemoryMappedFile() = default;
+
+  // The region returned by mmap(), which starts at a page boundary and may
+  // therefore begin before data_.  Null if the data was read into buffer_.
+  void* mapping_ = nullptr;
+  size_t mapping_size_ = 0;
+
+  // Fallback storage used when the region could not be mapped.
+  std::string buffer_;
+
+  const char* data_ = nullptr;
+  size_t size_ = 0;
+};
+
+#endif  // S2_S2MEMORY_MAPPED_FILE_H_
@@ -0,0 +1,98 @@
+// Copyright 2024 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "s2/s2memory_mapped_file.h"
+
+#include <cstddef>
+#include <cstdio>
+#include <fstream>
+#include <string>
+
+#include <gtest/gtest.h>
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "s2/s2error.h"
+
+using absl::string_view;
+using std::string;
+
+namespace {
+
+string WriteTempFile(string_view name, string_view contents) {
+  string path = absl::StrCat(testing::TempDir(), "/", name);
+  std::ofstream out(path, std::ios::binary | std::ios::trunc);
+  out.write(contents.data(), contents.size());
+  return path;
+}
+
+string_view Contents(const S2MemoryMappedFile& file) {
+  return string_view(file.data(), file.size());
+}
+
+TEST(S2MemoryMappedFile, MapsWholeFile) {
+  string path = WriteTempFile("whole", "hello world");
+  S2Error error;
+  auto file = S2MemoryMappedFile::Open(path, error);
+  ASSERT_NE(file, nullptr) << error;
+  EXPECT_EQ(Contents(*file), "hello world");
+  std::remove(path.c_str());
+}
+
+TEST(S2MemoryMappedFile, MapsUnalignedRegion) {
+  // Use a file larger than a page so that the region starts on a different
+  // page than the file itself.
+  string contents(10000, 'x');
+  for (size_t i = 0; i < contents.size(); ++i) contents[i] = 'a' + i % 26;
+  string path = WriteTempFile("region", contents);
+  S2Error error;
+  auto file = S2MemoryMappedFile::Open(path, error, 5003, 1234);
+  ASSERT_NE(file, nullptr) << error;
+  EXPECT_EQ(Contents(*file), string_view(contents).substr(5003, 1234));
+
+  auto tail = S2MemoryMappedFile::Open(path, error, 9990);
+  ASSERT_NE(tail, nullptr) << error;
+  EXPECT_EQ(Contents(*tail), string_view(contents).substr(9990));
+  std::remove(path.c_str());
+}
+
+TEST(S2MemoryMappedFile, EmptyRegion) {
+  string path = WriteTempFile("empty", "abc");
+  S2Error error;
+  auto file = S2MemoryMappedFile::Open(path, error, 3);
+  ASSERT_NE(file, nullptr) << error;
+  EXPECT_EQ(file->size(), 0);
+  std::remove(path.c_str());
+}
+
+TEST(S2MemoryMappedFile, RegionPastEndOfFile) {
+  string path = WriteTempFile("short", "abc");
+  S2Error error;
+  EXPECT_EQ(S2MemoryMappedFile::Open(path, error, 4), nullptr);
+  EXPECT_EQ(error.code(), S2Error::OUT_OF_RANGE);
+  error = S2Error::Ok();
+  EXPECT_EQ(S2MemoryMappedFile::Open(path, error, 1, 3), nullptr);
+  EXPECT_EQ(error.code(), S2Error::OUT_OF_RANGE);
+  std::remove(path.c_str());
+}
+
+TEST(S2MemoryMappedFile, MissingFile) {
+  S2Error error;
+  EXPECT_EQ(S2MemoryMappedFile::Open(
+                absl::StrCat(testing::TempDir(), "/does_not_exist"), error),
+            nullptr);
+  EXPECT_FALSE(error.ok());
+}
+
+}  // namespace
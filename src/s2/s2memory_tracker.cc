@@ -17,10 +17,15 @@
 
 #include "s2/s2memory_tracker.h"
 
+#include <algorithm>
+#include <atomic>
 #include <cstdint>
+#include <limits>
 #include <utility>
 
 #include "absl/strings/str_format.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
 #include "s2/s2error.h"
 
 void S2MemoryTracker::SetError(S2Error error) {
@@ -34,6 +39,13 @@ void S2MemoryTracker::SetLimitExceededError() {
       usage_bytes_, limit_bytes_));
 }
 
+void S2MemoryTracker::CheckDeadline() {
+  deadline_check_limit_bytes_ = GetDeadlineCheckLimit();
+  if (ok() && absl::Now() >= deadline_) {
+    error_ = S2Error::Cancelled("Deadline exceeded");
+  }
+}
+
 bool S2MemoryTracker::Client::TallyTemp(int64_t delta_bytes) {
   Tally(delta_bytes);
   return Tally(-delta_bytes);
@@ -43,3 +55,41 @@ const S2Error& S2MemoryTracker::Client::error() const {
   static S2Error error_ok;  // NOLINT
   return tracker_ ? tracker_->error() : error_ok;
 }
+
+void S2MemoryTracker::UpdateSharedReservation() {
+  const int64_t granule = shared_budget_->granule_bytes();
+  // Reserve the smallest multiple of the granule size that covers the
+  // current usage, and keep it until usage falls two granules below that.
+  const int64_t usage = std::max(int64_t{0}, usage_bytes_);
+  const int64_t reserved = (usage + granule - 1) / granule * granule;
+  const int64_t delta = reserved - reserved_bytes_;
+  reserved_bytes_ = reserved;
+  reservation_hi_ = reserved;
+  reservation_lo_ = reserved - 2 * granule;
+  if (delta != 0 && !shared_budget_->Reserve(delta) && ok()) {
+    error_ = S2Error::ResourceExhausted(absl::StrFormat(
+        "Shared memory limit exceeded (reserved %d bytes, limit %d bytes)",
+        shared_budget_->usage_bytes(), shared_budget_->limit_bytes()));
+  }
+}
+
+void S2MemoryTracker::ReleaseSharedBudget() {
+  if (shared_budget_ == nullptr) return;
+  shared_budget_->Reserve(-reserved_bytes_);
+  shared_budget_ = nullptr;
+  reserved_bytes_ = 0;
+  reservation_lo_ = std::numeric_limits<int64_t>::min();
+  reservation_hi_ = kNoLimit;
+}
+
+bool S2SharedMemoryBudget::Reserve(int64_t delta_bytes) {
+  const int64_t usage =
+      usage_bytes_.fetch_add(delta_bytes, std::memory_order_relaxed) +
+      delta_bytes;
+  int64_t max_usage = max_usage_bytes_.load(std::memory_order_relaxed);
+  while (usage > max_usage &&
+         !max_usage_bytes_.compare_exchange_weak(max_usage, usage,
+                                                 std::memory_order_relaxed)) {
+  }
+  return delta_bytes <= 0 || usage <= limit_bytes();
+}
@@ -19,6 +19,7 @@
 #define S2_S2MEMORY_TRACKER_H_
 
 #include <algorithm>
+#include <atomic>
 #include <cstdint>
 #include <functional>
 #include <limits>
@@ -27,6 +28,8 @@
 #include "absl/log/absl_check.h"
 #include "absl/log/absl_log.h"
 #include "absl/strings/str_format.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
 #include "s2/s2error.h"
 #include "s2/util/gtl/compact_array.h"
 
@@ -77,7 +80,10 @@
 // has control over what type of error is generated.
 //
 // This class is not thread-safe and therefore all objects associated with a
-// single S2MemoryTracker should be accessed using a single thread.
+// single S2MemoryTracker should be accessed using a single thread.  To
+// enforce a single memory limit across several threads, give each thread
+// its own S2MemoryTracker and connect them all to an S2SharedMemoryBudget
+// (see below).
 //
 // Implementation Notes
 // --------------------
@@ -97,10 +103,19 @@
 // lot of memory at once, so it is better to predict and avoid such
 // allocations rather than detecting them after the fact (as would happen with
 // malloc hooks).
+class S2SharedMemoryBudget;
+
 class S2MemoryTracker {
  public:
   S2MemoryTracker() = default;
 
+  // Returns any memory reserved from the shared budget (see below).
+  ~S2MemoryTracker() { ReleaseSharedBudget(); }
+
+  // Trackers cannot be copied since each one owns part of the shared budget.
+  S2MemoryTracker(const S2MemoryTracker&) = delete;
+  S2MemoryTracker& operator=(const S2MemoryTracker&) = delete;
+
   // The current tracked memory usage.
   //
   // CAVEAT: When an operation is cancelled (e.g. due to a memory limit being
@@ -174,12 +189,54 @@ class S2MemoryTracker {
   }
   const PeriodicCallback& periodic_callback() const { return callback_; }
 
+  // Specifies a deadline for the S2 operations that use this tracker.  The
+  // deadline is checked after every "check_alloc_delta_bytes" of tracked
+  // memory allocation (which also happens periodically during calculations
+  // that take a long time, as with the periodic callback above).  Once the
+  // deadline has passed, an error of type S2Error::CANCELLED is generated
+  // and the current operation is cancelled.  This makes it possible to bound
+  // the latency of operations on pathological inputs.
+  //
+  // Smaller values of "check_alloc_delta_bytes" detect an expired deadline
+  // sooner but read the clock more often.
+  //
+  // DEFAULT: absl::InfiniteFuture()
+  static constexpr int64_t kDefaultDeadlineCheckBytes = 1 << 20;
+  void set_deadline(
+      absl::Time deadline,
+      int64_t check_alloc_delta_bytes = kDefaultDeadlineCheckBytes) {
+    deadline_ = deadline;
+    deadline_check_delta_bytes_ = check_alloc_delta_bytes;
+    deadline_check_limit_bytes_ = GetDeadlineCheckLimit();
+  }
+  absl::Time deadline() const { return deadline_; }
+
+  // Specifies an S2SharedMemoryBudget that this tracker draws on in addition
+  // to its own limit_bytes().  The tracker reserves memory from the shared
+  // budget in units of budget->granule_bytes(), so that the shared atomic
+  // counter is only updated occasionally.  If the shared limit would be
+  // exceeded, an error of type S2Error::RESOURCE_EXHAUSTED is generated and
+  // the current operation is cancelled.
+  //
+  // The budget must outlive this tracker.  This method should be called
+  // before the tracker is used, and may be passed nullptr to disconnect it.
+  //
+  // DEFAULT: nullptr
+  void set_shared_budget(S2SharedMemoryBudget* budget) {
+    ReleaseSharedBudget();
+    shared_budget_ = budget;
+    if (budget != nullptr) UpdateSharedReservation();
+  }
+  S2SharedMemoryBudget* shared_budget() const { return shared_budget_; }
+
   // Resets usage() and max_usage() to zero and clears any error.  Leaves all
   // other parameters unchanged.
   void Reset() {
     error_ = S2Error::Ok();
     usage_bytes_ = max_usage_bytes_ = alloc_bytes_ = 0;
     callback_alloc_limit_bytes_ = callback_alloc_delta_bytes_;
+    deadline_check_limit_bytes_ = GetDeadlineCheckLimit();
+    if (shared_budget_ != nullptr) UpdateSharedReservation();
   }
 
   //////////////////////////////////////////////////////////////////////
@@ -273,15 +330,15 @@ class S2MemoryTracker {
 
     // Adds the memory used by the given vector to the current tally.  Returns
     // false if the current operation should be cancelled.
-    template <class T>
-    inline bool Tally(const std::vector<T>& v) {
+    template <class T, class Alloc>
+    inline bool Tally(const std::vector<T, Alloc>& v) {
       return Tally(v.capacity() * sizeof(v[0]));
     }
 
     // Subtracts the memory used by the given vector from the current tally.
     // Returns false if the current operation should be cancelled.
-    template <class T>
-    inline bool Untally(const std::vector<T>& v) {
+    template <class T, class Alloc>
+    inline bool Untally(const std::vector<T, Alloc>& v) {
       return Tally(-v.capacity() * sizeof(v[0]));
     }
 
@@ -343,6 +400,20 @@ class S2MemoryTracker {
   bool Tally(int64_t delta_bytes);
   void SetLimitExceededError();
 
+  // Returns the value of alloc_bytes_ at which the deadline is next checked.
+  int64_t GetDeadlineCheckLimit() const {
+    if (deadline_ == absl::InfiniteFuture()) return kNoLimit;
+    return alloc_bytes_ + deadline_check_delta_bytes_;
+  }
+
+  // Sets an error if the deadline has passed, and schedules the next check.
+  void CheckDeadline();
+
+  // Adjusts the memory reserved from the shared budget to match the current
+  // usage, and updates reservation_lo_ and reservation_hi_ accordingly.
+  void UpdateSharedReservation();
+  void ReleaseSharedBudget();
+
   int64_t usage_bytes_ = 0;
   int64_t max_usage_bytes_ = 0;
   int64_t limit_bytes_ = kNoLimit;
@@ -351,6 +422,86 @@ class S2MemoryTracker {
   PeriodicCallback callback_;
   int64_t callback_alloc_delta_bytes_ = 0;
   int64_t callback_alloc_limit_bytes_ = kNoLimit;
+  absl::Time deadline_ = absl::InfiniteFuture();
+  int64_t deadline_check_delta_bytes_ = kDefaultDeadlineCheckBytes;
+  int64_t deadline_check_limit_bytes_ = kNoLimit;
+
+  // The shared budget (if any), the number of bytes reserved from it, and
+  // the range of usage_bytes_ that the current reservation covers.  When no
+  // budget is set the range is unbounded, so that Tally() only needs two
+  // comparisons to decide whether the reservation must be updated.
+  S2SharedMemoryBudget* shared_budget_ = nullptr;
+  int64_t reserved_bytes_ = 0;
+  int64_t reservation_lo_ = std::numeric_limits<int64_t>::min();
+  int64_t reservation_hi_ = kNoLimit;
+};
+
+// S2SharedMemoryBudget enforces a single memory limit across several
+// S2MemoryTracker objects, which may be used concurrently by different
+// threads.  For example:
+//
+//   S2SharedMemoryBudget budget(2LL << 30);  // 2 GB for all workers
+//   ParallelFor(num_threads, num_tasks, [&](int i) {
+//     S2MemoryTracker tracker;
+//     tracker.set_shared_budget(&budget);
+//     S2Builder::Options options;
+//     options.set_memory_tracker(&tracker);
+//     ...
+//   });
+//
+// Each tracker reserves memory from the budget in units of granule_bytes()
+// and keeps the reservation while its usage remains within two granules of
+// it, so the budget is updated only after every granule_bytes() or so of
+// memory allocation.  Consequently usage_bytes() may exceed the total
+// tracked memory usage by less than (2 * granule_bytes()) per tracker.
+//
+// This class is thread-safe.
+class S2SharedMemoryBudget {
+ public:
+  // The default granule size (1 MB).
+  static constexpr int64_t kDefaultGranuleBytes = 1 << 20;
+
+  // REQUIRES: granule_bytes > 0
+  explicit S2SharedMemoryBudget(
+      int64_t limit_bytes = S2MemoryTracker::kNoLimit,
+      int64_t granule_bytes = kDefaultGranuleBytes)
+      : limit_bytes_(limit_bytes), granule_bytes_(granule_bytes) {
+    ABSL_DCHECK_GT(granule_bytes, 0);
+  }
+
+  S2SharedMemoryBudget(const S2SharedMemoryBudget&) = delete;
+  S2SharedMemoryBudget& operator=(const S2SharedMemoryBudget&) = delete;
+
+  // The maximum total memory that may be reserved by all trackers.
+  int64_t limit_bytes() const {
+    return limit_bytes_.load(std::memory_order_relaxed);
+  }
+  void set_limit_bytes(int64_t limit_bytes) {
+    limit_bytes_.store(limit_bytes, std::memory_order_relaxed);
+  }
+
+  int64_t granule_bytes() const { return granule_bytes_; }
+
+  // The total memory currently reserved by all trackers, and the maximum
+  // value this has reached.
+  int64_t usage_bytes() const {
+    return usage_bytes_.load(std::memory_order_relaxed);
+  }
+  int64_t max_usage_bytes() const {
+    return max_usage_bytes_.load(std::memory_order_relaxed);
+  }
+
+ private:
+  friend class S2MemoryTracker;
+
+  // Adds "delta_bytes" to the reserved total, and returns false if this is
+  // an increase that takes the total over the limit.
+  bool Reserve(int64_t delta_bytes);
+
+  std::atomic<int64_t> limit_bytes_;
+  const int64_t granule_bytes_;
+  std::atomic<int64_t> usage_bytes_{0};
+  std::atomic<int64_t> max_usage_bytes_{0};
 };
 
 
@@ -368,10 +519,14 @@ inline bool S2MemoryTracker::Tally(int64_t delta_bytes) {
   alloc_bytes_ += std::max(int64_t{0}, delta_bytes);
   max_usage_bytes_ = std::max(max_usage_bytes_, usage_bytes_);
   if (usage_bytes_ > limit_bytes_ && ok()) SetLimitExceededError();
+  if (usage_bytes_ > reservation_hi_ || usage_bytes_ < reservation_lo_) {
+    UpdateSharedReservation();
+  }
   if (callback_ && alloc_bytes_ >= callback_alloc_limit_bytes_) {
     callback_alloc_limit_bytes_ = alloc_bytes_ + callback_alloc_delta_bytes_;
     if (ok()) callback_();
   }
+  if (alloc_bytes_ >= deadline_check_limit_bytes_) CheckDeadline();
   return ok();
 }
 
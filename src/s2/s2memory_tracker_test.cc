@@ -17,7 +17,16 @@
 
 #include "s2/s2memory_tracker.h"
 
+#include <cstdint>
+#include <thread>
+#include <vector>
+
 #include <gtest/gtest.h>
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "s2/s2error.h"
+
+using std::vector;
 
 TEST(S2MemoryTracker, PeriodicCallback) {
   S2MemoryTracker tracker;
@@ -48,3 +57,94 @@ TEST(S2MemoryTracker, PeriodicCallback) {
   client.Tally(1);
   EXPECT_EQ(callback_count, 4);
 }
+
+TEST(S2MemoryTracker, Deadline) {
+  S2MemoryTracker tracker;
+  S2MemoryTracker::Client client(&tracker);
+
+  // A deadline in the future does not cancel the operation.
+  tracker.set_deadline(absl::Now() + absl::Hours(1), 100);
+  EXPECT_TRUE(client.Tally(1000));
+
+  // An expired deadline is detected at the next check, which happens after
+  // the given number of bytes have been allocated.
+  tracker.set_deadline(absl::Now() - absl::Seconds(1), 100);
+  EXPECT_TRUE(client.Tally(99));
+  EXPECT_FALSE(client.Tally(1));
+  EXPECT_EQ(tracker.error().code(), S2Error::CANCELLED);
+
+  // Reset() clears the error but keeps the deadline.
+  tracker.Reset();
+  EXPECT_TRUE(client.Tally(-50));
+  EXPECT_FALSE(client.Tally(100));
+  EXPECT_EQ(tracker.error().code(), S2Error::CANCELLED);
+}
+
+TEST(S2MemoryTracker, SharedBudgetLimit) {
+  S2SharedMemoryBudget budget(1000, 100 /*granule_bytes*/);
+  S2MemoryTracker tracker1, tracker2;
+  tracker1.set_shared_budget(&budget);
+  tracker2.set_shared_budget(&budget);
+  S2MemoryTracker::Client client1(&tracker1), client2(&tracker2);
+
+  // Memory is reserved in multiples of the granule size.
+  EXPECT_TRUE(client1.Tally(150));
+  EXPECT_EQ(budget.usage_bytes(), 200);
+  EXPECT_TRUE(client2.Tally(700));
+  EXPECT_EQ(budget.usage_bytes(), 900);
+
+  // Small changes do not update the shared budget.
+  EXPECT_TRUE(client1.Tally(-60));
+  EXPECT_TRUE(client1.Tally(60));
+  EXPECT_EQ(budget.usage_bytes(), 900);
+
+  // Exceeding the shared limit cancels the operation that needed the memory.
+  EXPECT_FALSE(client1.Tally(200));
+  EXPECT_EQ(tracker1.error().code(), S2Error::RESOURCE_EXHAUSTED);
+  EXPECT_TRUE(tracker2.ok());
+  EXPECT_EQ(budget.max_usage_bytes(), 1100);
+
+  // Memory is returned to the budget when it is freed.
+  EXPECT_TRUE(client2.Tally(-700));
+  EXPECT_LE(budget.usage_bytes(), 400 + 2 * budget.granule_bytes());
+  tracker1.Reset();
+  tracker2.Reset();
+  EXPECT_TRUE(client1.Tally(0));
+  EXPECT_TRUE(tracker1.ok());
+}
+
+TEST(S2MemoryTracker, SharedBudgetReleasedOnDestruction) {
+  S2SharedMemoryBudget budget;
+  {
+    S2MemoryTracker tracker;
+    tracker.set_shared_budget(&budget);
+    S2MemoryTracker::Client client(&tracker);
+    client.Tally(12345);
+    EXPECT_GE(budget.usage_bytes(), 12345);
+  }
+  EXPECT_EQ(budget.usage_bytes(), 0);
+}
+
+TEST(S2MemoryTracker, SharedBudgetIsThreadSafe) {
+  constexpr int kNumThreads = 4;
+  constexpr int64_t kGranuleBytes = 64;
+  S2SharedMemoryBudget budget(S2MemoryTracker::kNoLimit, kGranuleBytes);
+  vector<std::thread> threads;
+  for (int t = 0; t < kNumThreads; ++t) {
+    threads.emplace_back([&budget]() {
+      S2MemoryTracker tracker;
+      tracker.set_shared_budget(&budget);
+      S2MemoryTracker::Client client(&tracker);
+      for (int i = 0; i < 10000; ++i) {
+        client.Tally(100);
+        EXPECT_GE(budget.usage_bytes(), tracker.usage_bytes());
+        client.Tally(-90);
+      }
+    });
+  }
+  for (auto& thread : threads) thread.join();
+  EXPECT_EQ(budget.usage_bytes(), 0);
+  EXPECT_GE(budget.max_usage_bytes(), 10000 * 10);
+  EXPECT_LT(budget.max_usage_bytes(),
+            kNumThreads * (10000 * 10 + 90 + 2 * kGranuleBytes));
+}
@@ -44,21 +44,6 @@ S2Cap S2MinDistancePointTarget::GetCapBound() {
   return S2Cap(point_, S1ChordAngle::Zero());
 }
 
-bool S2MinDistancePointTarget::UpdateMinDistance(
-    const S2Point& p, S2MinDistance* min_dist) {
-  return min_dist->UpdateMin(S2MinDistance(S1ChordAngle(p, point_)));
-}
-
-bool S2MinDistancePointTarget::UpdateMinDistance(
-    const S2Point& v0, const S2Point& v1, S2MinDistance* min_dist) {
-  return S2::UpdateMinDistance(point_, v0, v1, min_dist);
-}
-
-bool S2MinDistancePointTarget::UpdateMinDistance(
-    const S2Cell& cell, S2MinDistance* min_dist) {
-  return min_dist->UpdateMin(S2MinDistance(cell.GetDistance(point_)));
-}
-
 bool S2MinDistancePointTarget::VisitContainingShapeIds(
     const S2ShapeIndex& index,
     absl::FunctionRef<bool(int shape_id, const S2Point& target_point)>
@@ -76,21 +61,6 @@ S2Cap S2MinDistanceEdgeTarget::GetCapBound() {
   return S2Cap((a_ + b_).Normalize(), S1ChordAngle::FromLength2(r2));
 }
 
-bool S2MinDistanceEdgeTarget::UpdateMinDistance(
-    const S2Point& p, S2MinDistance* min_dist) {
-  return S2::UpdateMinDistance(p, a_, b_, min_dist);
-}
-
-bool S2MinDistanceEdgeTarget::UpdateMinDistance(
-    const S2Point& v0, const S2Point& v1, S2MinDistance* min_dist) {
-  return S2::UpdateEdgePairMinDistance(a_, b_, v0, v1, min_dist);
-}
-
-bool S2MinDistanceEdgeTarget::UpdateMinDistance(
-    const S2Cell& cell, S2MinDistance* min_dist) {
-  return min_dist->UpdateMin(S2MinDistance(cell.GetDistance(a_, b_)));
-}
-
 bool S2MinDistanceEdgeTarget::VisitContainingShapeIds(
     const S2ShapeIndex& index,
     absl::FunctionRef<bool(int shape_id, const S2Point& target_point)>
@@ -274,9 +274,39 @@ inline S2MinDistancePointTarget::S2MinDistancePointTarget(const S2Point& point)
     : point_(point) {
 }
 
+inline bool S2MinDistancePointTarget::UpdateMinDistance(
+    const S2Point& p, S2MinDistance* min_dist) {
+  return min_dist->UpdateMin(S2MinDistance(S1ChordAngle(p, point_)));
+}
+
+inline bool S2MinDistancePointTarget::UpdateMinDistance(
+    const S2Point& v0, const S2Point& v1, S2MinDistance* min_dist) {
+  return S2::UpdateMinDistance(point_, v0, v1, min_dist);
+}
+
+inline bool S2MinDistancePointTarget::UpdateMinDistance(
+    const S2Cell& cell, S2MinDistance* min_dist) {
+  return min_dist->UpdateMin(S2MinDistance(cell.GetDistance(point_)));
+}
+
 inline S2MinDistanceEdgeTarget::S2MinDistanceEdgeTarget(const S2Point& a,
                                                         const S2Point& b)
     : a_(a), b_(b) {
 }
 
+inline bool S2MinDistanceEdgeTarget::UpdateMinDistance(
+    const S2Point& p, S2MinDistance* min_dist) {
+  return S2::UpdateMinDistance(p, a_, b_, min_dist);
+}
+
+inline bool S2MinDistanceEdgeTarget::UpdateMinDistance(
+    const S2Point& v0, const S2Point& v1, S2MinDistance* min_dist) {
+  return S2::UpdateEdgePairMinDistance(a_, b_, v0, v1, min_dist);
+}
+
+inline bool S2MinDistanceEdgeTarget::UpdateMinDistance(
+    const S2Cell& cell, S2MinDistance* min_dist) {
+  return min_dist->UpdateMin(S2MinDistance(cell.GetDistance(a_, b_)));
+}
+
 #endif  // S2_S2MIN_DISTANCE_TARGETS_H_
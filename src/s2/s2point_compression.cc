@@ -18,6 +18,7 @@
 
 #include <algorithm>
 #include <cstdint>
+#include <limits>
 #include <utility>
 #include <vector>
 
@@ -28,6 +29,7 @@
 #include "absl/types/span.h"
 
 #include "s2/base/types.h"
+#include "s2/internal/s2parallel.h"
 #include "s2/s2cell_id.h"
 #include "s2/s2coords.h"
 #include "s2/s2point.h"
@@ -390,3 +392,92 @@ bool S2DecodePointsCompressed(Decoder* decoder, int level,
   }
   return true;
 }
+
+void S2EncodePointsCompressedBlocks(Span<const S2XYZFaceSiTi> points,
+                                    int level, Encoder* encoder,
+                                    int block_size, int num_threads) {
+  ABSL_DCHECK_GE(block_size, 1);
+  const int num_points = points.size();
+  const int num_blocks = (num_points + block_size - 1) / block_size;
+  vector<Encoder> blocks(num_blocks);
+  s2internal::ParallelFor(num_threads, num_blocks, [&](int i) {
+    S2EncodePointsCompressed(points.subspan(i * block_size, block_size),
+                             level, &blocks[i]);
+  });
+  size_t data_size = 0;
+  for (const Encoder& block : blocks) data_size += block.length();
+  ABSL_DCHECK_LE(data_size, std::numeric_limits<uint32_t>::max());
+  encoder->Ensure(Encoder::kVarintMax32 + sizeof(uint32_t) * num_blocks +
+                  data_size);
+  encoder->put_varint32(block_size);
+  uint32_t end = 0;
+  for (const Encoder& block : blocks) {
+    end += block.length();
+    encoder->put32(end);
+  }
+  for (const Encoder& block : blocks) {
+    encoder->putn(block.base(), block.length());
+  }
+  ABSL_DCHECK_GE(encoder->avail(), 0);
+}
+
+bool S2DecodePointsCompressedBlocks(Decoder* decoder, int level,
+                                    Span<S2Point> points, int num_threads) {
+  S2CompressedPointBlocks blocks;
+  return blocks.Init(decoder, level, points.size()) &&
+         blocks.Decode(points, num_threads);
+}
+
+bool S2CompressedPointBlocks::Init(Decoder* decoder, int level,
+                                   int num_points) {
+  ABSL_DCHECK_LE(level, S2::kMaxCellLevel);
+  uint32_t block_size;
+  if (!decoder->get_varint32(&block_size) || block_size == 0 ||
+      block_size > static_cast<uint32_t>(std::numeric_limits<int>::max())) {
+    return false;
+  }
+  level_ = level;
+  num_points_ = num_points;
+  block_size_ = block_size;
+  num_blocks_ = (int64_t{num_points} + block_size - 1) / block_size;
+  const size_t table_size = sizeof(uint32_t) * static_cast<size_t>(num_blocks_);
+  if (decoder->avail() < table_size) return false;
+  offsets_ = decoder->skip(table_size);
+  data_ = offsets_ + table_size;
+
+  // The block end offsets must be non-decreasing and within the buffer.
+  uint32_t end = 0;
+  for (int i = 0; i < num_blocks_; ++i) {
+    if (block_end(i) < end) return false;
+    end = block_end(i);
+  }
+  if (decoder->avail() < end) return false;
+  decoder->skip(end);
+  return true;
+}
+
+uint32_t S2CompressedPointBlocks::block_end(int i) const {
+  return LittleEndian::Load32(offsets_ + sizeof(uint32_t) * i);
+}
+
+int S2CompressedPointBlocks::block_length(int i) const {
+  return std::min(block_size_, num_points_ - block_begin(i));
+}
+
+bool S2CompressedPointBlocks::DecodeBlock(int i, Span<S2Point> points) const {
+  ABSL_DCHECK_EQ(static_cast<int>(points.size()), block_length(i));
+  const uint32_t begin = (i == 0) ? 0 : block_end(i - 1);
+  Decoder decoder(data_ + begin, block_end(i) - begin);
+  return S2DecodePointsCompressed(&decoder, level_, points) &&
+         decoder.avail() == 0;
+}
+
+bool S2CompressedPointBlocks::Decode(Span<S2Point> points,
+                                     int num_threads) const {
+  ABSL_DCHECK_EQ(static_cast<int>(points.size()), num_points_);
+  vector<char> ok(num_blocks_);
+  s2internal::ParallelFor(num_threads, num_blocks_, [&](int i) {
+    ok[i] = DecodeBlock(i, points.subspan(block_begin(i), block_length(i)));
+  });
+  return std::all_of(ok.begin(), ok.end(), [](char b) { return b != 0; });
+}
@@ -46,6 +46,8 @@
 #ifndef S2_S2POINT_COMPRESSION_H_
 #define S2_S2POINT_COMPRESSION_H_
 
+#include <cstdint>
+
 #include "absl/types/span.h"
 #include "s2/util/coding/coder.h"
 #include "s2/_fp_contract_off.h"  // IWYU pragma: keep
@@ -75,4 +77,72 @@ void S2EncodePointsCompressed(absl::Span<const S2XYZFaceSiTi> points,
 bool S2DecodePointsCompressed(Decoder* decoder, int level,
                               absl::Span<S2Point> points);
 
+// Like S2EncodePointsCompressed, but splits the points into blocks of
+// "block_size" points that are encoded independently (using up to
+// "num_threads" threads), preceded by a table of block offsets.  This allows
+// the blocks to be decoded in parallel or individually (see
+// S2CompressedPointBlocks).  Each block costs about 14 extra bytes, since it
+// has its own fixed-length first point, face runs, and off-center list.
+//
+// The encoding does not depend on "num_threads".
+void S2EncodePointsCompressedBlocks(absl::Span<const S2XYZFaceSiTi> points,
+                                    int level, Encoder* encoder,
+                                    int block_size = 1024,
+                                    int num_threads = 1);
+
+// Decodes points encoded with S2EncodePointsCompressedBlocks, using up to
+// "num_threads" threads.  Requires that the level is the level that was used
+// for encoding.  Returns true on success.
+bool S2DecodePointsCompressedBlocks(Decoder* decoder, int level,
+                                    absl::Span<S2Point> points,
+                                    int num_threads = 1);
+
+// Provides random access to the blocks of points encoded with
+// S2EncodePointsCompressedBlocks.  Example usage:
+//
+//   S2CompressedPointBlocks blocks;
+//   if (!blocks.Init(&decoder, level, num_points)) return false;
+//   std::vector<S2Point> points(blocks.block_length(i));
+//   if (!blocks.DecodeBlock(i, absl::MakeSpan(points))) return false;
+//
+// The encoded data must persist for the lifetime of this object.
+class S2CompressedPointBlocks {
+ public:
+  // Validates the block offset table and advances "decoder" past the encoded
+  // points (without decoding them).  Returns false if the data is invalid.
+  bool Init(Decoder* decoder, int level, int num_points);
+
+  int num_points() const { return num_points_; }
+  int num_blocks() const { return num_blocks_; }
+
+  // Returns the index of the first point in the given block, and the number
+  // of points in the block.
+  int block_begin(int i) const { return i * block_size_; }
+  int block_length(int i) const;
+
+  // Decodes the given block into "points".  Returns false if the block data
+  // is invalid.
+  //
+  // REQUIRES: points.size() == block_length(i)
+  bool DecodeBlock(int i, absl::Span<S2Point> points) const;
+
+  // Decodes all the points using up to "num_threads" threads.
+  //
+  // REQUIRES: points.size() == num_points()
+  bool Decode(absl::Span<S2Point> points, int num_threads = 1) const;
+
+ private:
+  int level_ = 0;
+  int num_points_ = 0;
+  int block_size_ = 1;
+  int num_blocks_ = 0;
+
+  // The table of block end offsets (relative to "data_"), and the start of
+  // the block data.
+  const char* offsets_ = nullptr;
+  const char* data_ = nullptr;
+
+  uint32_t block_end(int i) const;
+};
+
 #endif  // S2_S2POINT_COMPRESSION_H_
@@ -16,6 +16,7 @@
 
 #include "s2/s2point_compression.h"
 
+#include <cstring>
 #include <string>
 #include <vector>
 
@@ -308,4 +309,74 @@ TEST_F(S2PointCompressionTest, FirstPointOnFaceEdge) {
   ABSL_CHECK(result[1] == points[1].xyz);
 }
 
+TEST_F(S2PointCompressionTest, BlocksRoundtrip) {
+  for (const vector<S2Point>* loop :
+       {&loop_4_, &loop_100_, &loop_100_mixed_15_, &loop_multi_face_}) {
+    for (int block_size : {1, 7, 1024}) {
+      FixedArray<S2XYZFaceSiTi> pts(loop->size());
+      MakeXYZFaceSiTiPoints(*loop, MakeSpan(pts));
+      Encoder encoder;
+      S2EncodePointsCompressedBlocks(pts, S2::kMaxCellLevel, &encoder,
+                                     block_size, 4);
+      Decoder decoder(encoder.base(), encoder.length());
+      vector<S2Point> points(loop->size());
+      ASSERT_TRUE(S2DecodePointsCompressedBlocks(&decoder, S2::kMaxCellLevel,
+                                                 MakeSpan(points), 4));
+      EXPECT_EQ(decoder.avail(), 0);
+      EXPECT_TRUE(*loop == points);
+    }
+  }
+}
+
+TEST_F(S2PointCompressionTest, BlocksRandomAccess) {
+  FixedArray<S2XYZFaceSiTi> pts(loop_100_mixed_25_.size());
+  MakeXYZFaceSiTiPoints(loop_100_mixed_25_, MakeSpan(pts));
+  Encoder encoder;
+  S2EncodePointsCompressedBlocks(pts, S2::kMaxCellLevel, &encoder, 16);
+
+  // The encoding does not depend on the number of threads.
+  Encoder encoder2;
+  S2EncodePointsCompressedBlocks(pts, S2::kMaxCellLevel, &encoder2, 16, 3);
+  ASSERT_EQ(encoder.length(), encoder2.length());
+  EXPECT_EQ(0, memcmp(encoder.base(), encoder2.base(), encoder.length()));
+
+  Decoder decoder(encoder.base(), encoder.length());
+  S2CompressedPointBlocks blocks;
+  ASSERT_TRUE(blocks.Init(&decoder, S2::kMaxCellLevel, pts.size()));
+  EXPECT_EQ(decoder.avail(), 0);
+  ASSERT_EQ(blocks.num_blocks(), 7);
+  EXPECT_EQ(blocks.block_length(6), 4);
+  vector<S2Point> points(blocks.block_length(3));
+  ASSERT_TRUE(blocks.DecodeBlock(3, MakeSpan(points)));
+  for (int i = 0; i < points.size(); ++i) {
+    EXPECT_EQ(points[i], loop_100_mixed_25_[blocks.block_begin(3) + i]);
+  }
+}
+
+TEST_F(S2PointCompressionTest, BlocksEmpty) {
+  Encoder encoder;
+  S2EncodePointsCompressedBlocks({}, S2::kMaxCellLevel, &encoder);
+  Decoder decoder(encoder.base(), encoder.length());
+  EXPECT_TRUE(S2DecodePointsCompressedBlocks(&decoder, S2::kMaxCellLevel,
+                                             Span<S2Point>()));
+}
+
+TEST_F(S2PointCompressionTest, BlocksRejectInvalidOffsets) {
+  FixedArray<S2XYZFaceSiTi> pts(loop_100_.size());
+  MakeXYZFaceSiTiPoints(loop_100_, MakeSpan(pts));
+  Encoder encoder;
+  S2EncodePointsCompressedBlocks(pts, S2::kMaxCellLevel, &encoder, 50);
+  std::string data(encoder.base(), encoder.length());
+
+  // Truncating the data or making the offsets decrease must be detected.
+  vector<S2Point> points(loop_100_.size());
+  Decoder truncated(data.data(), data.size() - 1);
+  EXPECT_FALSE(S2DecodePointsCompressedBlocks(&truncated, S2::kMaxCellLevel,
+                                              MakeSpan(points)));
+  data[4] = 0x7f;  // First block end > second block end.
+  Decoder decreasing(data.data(), data.size());
+  EXPECT_FALSE(S2DecodePointsCompressedBlocks(&decreasing, S2::kMaxCellLevel,
+                                              MakeSpan(points)));
+}
+
 }  // namespace
@@ -29,6 +29,7 @@
 #include "s2/s2cell_id.h"
 #include "s2/s2cell_iterator.h"
 #include "s2/s2point.h"
+#include "s2/s2space_usage.h"
 
 namespace s2internal {
 // Hack to expose bytes_used.
@@ -159,6 +160,10 @@ class S2PointIndex {
   // Returns the number of bytes currently occupied by the index.
   size_t SpaceUsed() const;
 
+  // Appends a breakdown of SpaceUsed() to "usage", consisting of the
+  // components "object" and "points" (the btree nodes).
+  void GetSpaceUsage(S2SpaceUsage* usage) const;
+
  private:
   // Defined here because the Iterator class below uses it.
   using Map = s2internal::BTreeMultimap<S2CellId, PointData>;
@@ -304,6 +309,12 @@ size_t S2PointIndex<Data>::SpaceUsed() const {
   return sizeof(*this) - sizeof(map_) + map_.bytes_used();
 }
 
+template <class Data>
+void S2PointIndex<Data>::GetSpaceUsage(S2SpaceUsage* usage) const {
+  usage->Add("object", sizeof(*this) - sizeof(map_));
+  usage->Add("points", map_.bytes_used());
+}
+
 template <class Data>
 inline S2PointIndex<Data>::Iterator::Iterator() = default;
 
@@ -0,0 +1,184 @@
+// Copyright 2024 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef S2_S2POINT_SPAN_SHAPE_H_
+#define S2_S2POINT_SPAN_SHAPE_H_
+
+#include <algorithm>
+#include <vector>
+
+#include "absl/log/absl_check.h"
+#include "absl/types/span.h"
+#include "s2/util/coding/coder.h"
+#include "s2/encoded_s2point_vector.h"
+#include "s2/s2coder.h"
+#include "s2/s2latlng.h"
+#include "s2/s2lax_polyline_shape.h"
+#include "s2/s2point.h"
+#include "s2/s2point_span.h"
+#include "s2/s2point_vector_shape.h"
+#include "s2/s2shape.h"
+
+// S2PointSpanShape is an S2Shape that refers to an existing array of S2Points
+// without copying it.  The points represent either a set of points
+// (dimension 0, like S2PointVectorShape) or the vertices of a single polyline
+// (dimension 1, like S2LaxPolylineShape).  This is useful for indexing
+// geometry that is already stored in memory (e.g., memory-mapped or in a
+// columnar store) without making a second copy of every vertex.
+//
+// The array is not owned by this class and must outlive it (and any
+// S2ShapeIndex that contains it).  The shape encodes exactly like the
+// corresponding owning shape, so it can be used with
+// s2shapeutil::EncodeTaggedShapes() and decoded as S2PointVectorShape or
+// S2LaxPolylineShape.
+class S2PointSpanShape : public S2Shape {
+ public:
+  // Constructs an empty set of points.
+  S2PointSpanShape() = default;
+
+  // REQUIRES: dimension is 0 or 1.
+  explicit S2PointSpanShape(S2PointSpan vertices, int dimension = 0)
+      : vertices_(vertices), dimension_(dimension) {
+    ABSL_DCHECK(dimension == 0 || dimension == 1);
+  }
+
+  int num_vertices() const { return static_cast<int>(vertices_.size()); }
+  const S2Point& vertex(int i) const { return vertices_[i]; }
+  S2PointSpan vertices() const { return vertices_; }
+
+  void Encode(Encoder* encoder, s2coding::CodingHint hint) const override {
+    s2coding::EncodeS2PointVector(vertices_, hint, encoder);
+  }
+
+  // S2Shape interface:
+  int num_edges() const final {
+    return std::max(0, num_vertices() - dimension_);
+  }
+  Edge edge(int e) const final {
+    return Edge(vertices_[e], vertices_[e + dimension_]);
+  }
+  void GetEdges(int begin, absl::Span<Edge> edges) const final {
+    ABSL_DCHECK_LE(begin + static_cast<int>(edges.size()), num_edges());
+    for (size_t i = 0; i < edges.size(); ++i) {
+      edges[i] = Edge(vertices_[begin + i], vertices_[begin + i + dimension_]);
+    }
+  }
+  int dimension() const final { return dimension_; }
+  ReferencePoint GetReferencePoint() const final {
+    return ReferencePoint::Contained(false);
+  }
+  int num_chains() const final {
+    return dimension_ == 0 ? num_vertices() : std::min(1, num_edges());
+  }
+  Chain chain(int i) const final {
+    return dimension_ == 0 ? Chain(i, 1) : Chain(0, num_edges());
+  }
+  Edge chain_edge(int i, int j) const final { return edge(i + j); }
+  ChainPosition chain_position(int e) const final {
+    return dimension_ == 0 ? ChainPosition(e, 0) : ChainPosition(0, e);
+  }
+  absl::Span<const S2Point> chain_vertex_span(int i) const final {
+    return dimension_ == 0 ? S2PointSpan() : vertices_;
+  }
+  TypeTag type_tag() const override {
+    return dimension_ == 0 ? TypeTag{S2PointVectorShape::kTypeTag}
+                           : TypeTag{S2LaxPolylineShape::kTypeTag};
+  }
+
+ private:
+  S2PointSpan vertices_;
+  int dimension_ = 0;
+};
+
+// Like S2PointSpanShape, except that the vertices are stored as an array of
+// packed doubles rather than S2Points, and are converted to S2Points as they
+// are accessed.  This allows indexing coordinate columns from external
+// storage (such as Apache Arrow arrays) with no copying at all.
+//
+// The array is not owned by this class and must outlive it.
+class S2CoordinateSpanShape : public S2Shape {
+ public:
+  enum class Format {
+    kXyz,            // x, y, z of each unit-length point.
+    kLatLngDegrees,  // latitude, longitude of each point in degrees.
+  };
+
+  // Constructs an empty set of points.
+  S2CoordinateSpanShape() = default;
+
+  // REQUIRES: coords.size() is a multiple of the number of values per point
+  //           (3 for kXyz and 2 for kLatLngDegrees).
+  // REQUIRES: dimension is 0 or 1.
+  S2CoordinateSpanShape(absl::Span<const double> coords, Format format,
+                        int dimension = 0)
+      : coords_(coords),
+        stride_(format == Format::kXyz ? 3 : 2),
+        dimension_(dimension) {
+    ABSL_DCHECK_EQ(coords.size() % stride_, 0);
+    ABSL_DCHECK(dimension == 0 || dimension == 1);
+  }
+
+  int num_vertices() const {
+    return static_cast<int>(coords_.size() / stride_);
+  }
+  S2Point vertex(int i) const {
+    const double* c = &coords_[i * stride_];
+    if (stride_ == 3) return S2Point(c[0], c[1], c[2]);
+    return S2LatLng::FromDegrees(c[0], c[1]).ToPoint();
+  }
+
+  void Encode(Encoder* encoder, s2coding::CodingHint hint) const override {
+    std::vector<S2Point> vertices(num_vertices());
+    for (int i = 0; i < num_vertices(); ++i) vertices[i] = vertex(i);
+    s2coding::EncodeS2PointVector(vertices, hint, encoder);
+  }
+
+  // S2Shape interface:
+  int num_edges() const final {
+    return std::max(0, num_vertices() - dimension_);
+  }
+  Edge edge(int e) const final {
+    if (dimension_ == 0) {
+      S2Point p = vertex(e);
+      return Edge(p, p);
+    }
+    return Edge(vertex(e), vertex(e + 1));
+  }
+  int dimension() const final { return dimension_; }
+  ReferencePoint GetReferencePoint() const final {
+    return ReferencePoint::Contained(false);
+  }
+  int num_chains() const final {
+    return dimension_ == 0 ? num_vertices() : std::min(1, num_edges());
+  }
+  Chain chain(int i) const final {
+    return dimension_ == 0 ? Chain(i, 1) : Chain(0, num_edges());
+  }
+  Edge chain_edge(int i, int j) const final { return edge(i + j); }
+  ChainPosition chain_position(int e) const final {
+    return dimension_ == 0 ? ChainPosition(e, 0) : ChainPosition(0, e);
+  }
+  TypeTag type_tag() const override {
+    return dimension_ == 0 ? TypeTag{S2PointVectorShape::kTypeTag}
+                           : TypeTag{S2LaxPolylineShape::kTypeTag};
+  }
+
+ private:
+  absl::Span<const double> coords_;
+  int stride_ = 3;
+  int dimension_ = 0;
+};
+
+#endif  // S2_S2POINT_SPAN_SHAPE_H_
@@ -0,0 +1,119 @@
+// Copyright 2024 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "s2/s2point_span_shape.h"
+
+#include <memory>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include "s2/util/coding/coder.h"
+#include "s2/mutable_s2shape_index.h"
+#include "s2/s2error.h"
+#include "s2/s2latlng.h"
+#include "s2/s2lax_polyline_shape.h"
+#include "s2/s2point.h"
+#include "s2/s2point_span.h"
+#include "s2/s2point_vector_shape.h"
+#include "s2/s2pointutil.h"
+#include "s2/s2shape.h"
+#include "s2/s2shapeutil_coding.h"
+#include "s2/s2shapeutil_testing.h"
+#include "s2/s2text_format.h"
+
+using std::make_unique;
+using std::vector;
+
+namespace {
+
+TEST(S2PointSpanShape, Empty) {
+  S2PointSpanShape shape;
+  EXPECT_EQ(0, shape.num_edges());
+  EXPECT_EQ(0, shape.num_chains());
+  EXPECT_EQ(0, shape.dimension());
+  EXPECT_TRUE(shape.is_empty());
+  EXPECT_EQ(0, S2PointSpanShape(S2PointSpan(), 1).num_chains());
+}
+
+TEST(S2PointSpanShape, MatchesOwningShapes) {
+  vector<S2Point> vertices = s2textformat::ParsePointsOrDie("0:0, 0:1, 1:1");
+  S2PointSpanShape points(vertices);
+  EXPECT_EQ(vertices.data(), &points.vertex(0));  // Not copied.
+  s2testing::ExpectEqual(S2PointVectorShape(vertices), points);
+
+  S2PointSpanShape polyline(vertices, 1);
+  EXPECT_EQ(1, polyline.dimension());
+  s2testing::ExpectEqual(S2LaxPolylineShape(vertices), polyline);
+  EXPECT_EQ(vertices.data(), polyline.chain_vertex_span(0).data());
+
+  // A polyline with one vertex has no edges.
+  S2PointSpanShape single_vertex(S2PointSpan(vertices).first(1), 1);
+  EXPECT_EQ(0, single_vertex.num_chains());
+}
+
+TEST(S2CoordinateSpanShape, MatchesPointSpanShape) {
+  vector<S2Point> vertices = s2textformat::ParsePointsOrDie("0:0, 0:1, 1:1");
+  vector<double> xyz, lat_lng;
+  for (const S2Point& p : vertices) {
+    xyz.insert(xyz.end(), {p.x(), p.y(), p.z()});
+    S2LatLng ll(p);
+    lat_lng.insert(lat_lng.end(), {ll.lat().degrees(), ll.lng().degrees()});
+  }
+  using Format = S2CoordinateSpanShape::Format;
+  for (int dimension : {0, 1}) {
+    S2PointSpanShape expected(vertices, dimension);
+    S2CoordinateSpanShape from_xyz(xyz, Format::kXyz, dimension);
+    ASSERT_EQ(3, from_xyz.num_vertices());
+    s2testing::ExpectEqual(expected, from_xyz);
+
+    S2CoordinateSpanShape from_lat_lng(lat_lng, Format::kLatLngDegrees,
+                                       dimension);
+    ASSERT_EQ(3, from_lat_lng.num_vertices());
+    for (int i = 0; i < 3; ++i) {
+      EXPECT_TRUE(S2::ApproxEquals(vertices[i], from_lat_lng.vertex(i)));
+    }
+  }
+}
+
+TEST(S2PointSpanShape, IndexAndEncode) {
+  vector<S2Point> vertices = s2textformat::ParsePointsOrDie("0:0, 0:1, 1:1");
+  vector<double> xyz;
+  for (const S2Point& p : vertices) {
+    xyz.insert(xyz.end(), {p.x(), p.y(), p.z()});
+  }
+
+  MutableS2ShapeIndex index;
+  index.Add(make_unique<S2PointSpanShape>(vertices));
+  index.Add(make_unique<S2CoordinateSpanShape>(
+      xyz, S2CoordinateSpanShape::Format::kXyz, 1));
+
+  // The views encode like the owning shapes, so they decode as those shapes.
+  MutableS2ShapeIndex expected;
+  expected.Add(make_unique<S2PointVectorShape>(vertices));
+  expected.Add(make_unique<S2LaxPolylineShape>(vertices));
+
+  Encoder encoder;
+  ASSERT_TRUE(s2shapeutil::FastEncodeTaggedShapes(index, &encoder));
+  index.Encode(&encoder);
+  Decoder decoder(encoder.base(), encoder.length());
+  S2Error error;
+  MutableS2ShapeIndex decoded;
+  ASSERT_TRUE(decoded.Init(
+      &decoder, s2shapeutil::FullDecodeShapeFactory(&decoder, error)));
+  ASSERT_TRUE(error.ok()) << error;
+  s2testing::ExpectEqual(expected, decoded);
+}
+
+}  // namespace
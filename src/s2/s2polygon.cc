@@ -37,10 +37,12 @@
 #include "absl/log/absl_check.h"
 #include "absl/log/absl_log.h"
 #include "absl/strings/str_format.h"
+#include "absl/types/span.h"
 #include "absl/utility/utility.h"
 
 #include "s2/base/casts.h"
 #include "s2/base/commandlineflags.h"
+#include "s2/internal/s2parallel.h"
 #include "s2/mutable_s2shape_index.h"
 #include "s2/r1interval.h"
 #include "s2/r2.h"
@@ -51,6 +53,7 @@
 #include "s2/s2boolean_operation.h"
 #include "s2/s2builder.h"
 #include "s2/s2builder_layer.h"
+#include "s2/s2builderutil_area_layer.h"
 #include "s2/s2builderutil_s2polygon_layer.h"
 #include "s2/s2builderutil_s2polyline_layer.h"
 #include "s2/s2builderutil_s2polyline_vector_layer.h"
@@ -58,6 +61,7 @@
 #include "s2/s2cap.h"
 #include "s2/s2cell.h"
 #include "s2/s2cell_id.h"
+#include "s2/s2cell_index.h"
 #include "s2/s2cell_union.h"
 #include "s2/s2closest_edge_query.h"
 #include "s2/s2coder.h"
@@ -79,11 +83,15 @@
 #include "s2/s2shape.h"
 #include "s2/s2shape_index.h"
 #include "s2/s2shape_index_region.h"
+#include "s2/s2shapeutil_shape_edge.h"
+#include "s2/s2shapeutil_shape_edge_id.h"
 #include "s2/s2shapeutil_visit_crossing_edge_pairs.h"
+#include "s2/s2space_usage.h"
 #include "s2/s2validation_query.h"
 #include "s2/util/coding/coder.h"
 
 using absl::flat_hash_set;
+using absl::Span;
 using s2builderutil::IdentitySnapFunction;
 using s2builderutil::S2CellIdSnapFunction;
 using s2builderutil::S2PolygonLayer;
@@ -309,6 +317,75 @@ void S2Polygon::InsertLoop(S2Loop* new_loop, S2Loop* parent,
   children->push_back(new_loop);
 }
 
+void S2Polygon::InitLoopMap(LoopMap* loop_map, int num_threads) {
+  // For a few loops, testing each new loop against the children of its
+  // ancestors is faster than building an S2CellIndex.
+  if (num_loops() < kMinLoopsForCellIndex && num_threads == 1) {
+    for (int i = 0; i < num_loops(); ++i) {
+      InsertLoop(loop(i), nullptr, loop_map);
+    }
+    return;
+  }
+
+  // Index a covering of each loop's cap bound.  If loop A contains loop B
+  // then every vertex of B is contained by the covering of A.
+  S2CellIndex index;
+  vector<S2CellId> covering;
+  for (int i = 0; i < num_loops(); ++i) {
+    covering.clear();
+    loop(i)->GetCapBound().GetCellUnionBound(&covering);
+    index.Add(S2CellUnion(std::move(covering)), i);
+  }
+  index.Build();
+
+  // For each loop B, find all loops A such that A.ContainsNested(B).  The
+  // candidates are the loops whose covering contains the vertex of B that
+  // ContainsNested() tests.  Since that vertex may lie on the boundary of a
+  // covering cell, we look up its leaf cell together with all its neighbors.
+  //
+  // Each loop B is processed independently, so this can be done in parallel.
+  // (S2Loop::ContainsNested() is safe to call concurrently; loops whose
+  // index has not been built yet use brute force until it is available.)
+  vector<vector<int>> ancestors(num_loops());
+  s2internal::ParallelFor(num_threads, num_loops(), [&](int b) {
+    const S2Loop& loop_b = *loop(b);
+    S2CellId leaf(loop_b.vertex(std::min(1, loop_b.num_vertices() - 1)));
+    vector<S2CellId> targets;
+    leaf.AppendAllNeighbors(S2CellId::kMaxLevel, &targets);
+    targets.push_back(leaf);
+    vector<int> candidates;
+    index.VisitIntersectingCells(S2CellUnion(std::move(targets)),
+                                 [&](S2CellId, int a) {
+                                   if (a != b) candidates.push_back(a);
+                                   return true;
+                                 });
+    std::sort(candidates.begin(), candidates.end());
+    candidates.erase(std::unique(candidates.begin(), candidates.end()),
+                     candidates.end());
+    for (int a : candidates) {
+      if (loop(a)->ContainsNested(loop_b)) ancestors[b].push_back(a);
+    }
+  });
+
+  // The ancestors of each loop form a chain, and its parent is the ancestor
+  // with the most ancestors of its own.  Loops are ordered by (number of
+  // ancestors, loop index) and parents must precede their children in this
+  // order, which ensures that the hierarchy is acyclic even when invalid
+  // loops contain each other.
+  auto precedes = [&ancestors](int a, int b) {
+    return std::make_pair(ancestors[a].size(), a) <
+           std::make_pair(ancestors[b].size(), b);
+  };
+  for (int b = 0; b < num_loops(); ++b) {
+    int parent = -1;
+    for (int a : ancestors[b]) {
+      if (precedes(a, b) && (parent < 0 || precedes(parent, a))) parent = a;
+    }
+    (*loop_map)[loop(b)];
+    (*loop_map)[parent < 0 ? nullptr : loop(parent)].push_back(loop(b));
+  }
+}
+
 void S2Polygon::InitLoops(LoopMap* loop_map) {
   std::stack<S2Loop*> loop_stack({nullptr});
   int depth = -1;
@@ -348,7 +425,8 @@ void S2Polygon::ForceBuildIndex() {
   index_.ForceBuild();
 }
 
-void S2Polygon::InitNested(vector<unique_ptr<S2Loop>> loops) {
+void S2Polygon::InitNested(vector<unique_ptr<S2Loop>> loops,
+                           int num_threads) {
   using std::swap;
 
   // Remove any empty loops, they're not allowed in a Polygon.
@@ -368,9 +446,7 @@ void S2Polygon::InitNested(vector<unique_ptr<S2Loop>> loops) {
     return;
   }
   LoopMap loop_map;
-  for (int i = 0; i < num_loops(); ++i) {
-    InsertLoop(loop(i), nullptr, &loop_map);
-  }
+  InitLoopMap(&loop_map, std::max(1, num_threads));
   // Reorder the loops in depth-first traversal order.
   // Loops are now owned by loop_map, don't let them be
   // deleted by clear().
@@ -578,9 +654,7 @@ S1Angle S2Polygon::GetDistanceToBoundary(const S2Point& x) const {
 
 /*static*/ pair<double, double> S2Polygon::GetOverlapFractions(
     const S2Polygon& a, const S2Polygon& b) {
-  S2Polygon intersection;
-  intersection.InitToIntersection(a, b);
-  double intersection_area = intersection.GetArea();
+  double intersection_area = GetIntersectionArea(a, b);
   double a_area = a.GetArea();
   double b_area = b.GetArea();
   return std::make_pair(
@@ -588,6 +662,24 @@ S1Angle S2Polygon::GetDistanceToBoundary(const S2Point& x) const {
       intersection_area >= b_area ? 1 : intersection_area / b_area);
 }
 
+/*static*/ double S2Polygon::GetIntersectionArea(const S2Polygon& a,
+                                                 const S2Polygon& b) {
+  if (!a.bound_.Intersects(b.bound_)) return 0;
+  S2BooleanOperation::Options options;
+  options.set_snap_function(
+      IdentitySnapFunction(S2::kIntersectionMergeRadius));
+  double area;
+  S2BooleanOperation op(S2BooleanOperation::OpType::INTERSECTION,
+                        make_unique<s2builderutil::AreaLayer>(&area),
+                        options);
+  S2Error error;
+  if (!op.Build(a.index_, b.index_, &error)) {
+    ABSL_LOG(ERROR) << "INTERSECTION operation failed: " << error;
+    return 0;
+  }
+  return area;
+}
+
 S2Point S2Polygon::Project(const S2Point& x) const {
   if (Contains(x)) return x;
   return ProjectToBoundary(x);
@@ -790,14 +882,26 @@ bool S2Polygon::Decode(Decoder* const decoder) {
   unsigned char version = decoder->get8();
   switch (version) {
     case kCurrentUncompressedEncodingVersionNumber:
-      return DecodeUncompressed(decoder);
+      return DecodeUncompressed(decoder, false /*within_scope*/);
     case kCurrentCompressedEncodingVersionNumber:
       return DecodeCompressed(decoder);
   }
   return false;
 }
 
-bool S2Polygon::DecodeUncompressed(Decoder* const decoder) {
+bool S2Polygon::DecodeWithinScope(Decoder* const decoder) {
+  if (decoder->avail() < sizeof(unsigned char)) return false;
+  unsigned char version = decoder->get8();
+  switch (version) {
+    case kCurrentUncompressedEncodingVersionNumber:
+      return DecodeUncompressed(decoder, true /*within_scope*/);
+    case kCurrentCompressedEncodingVersionNumber:
+      return DecodeCompressed(decoder);
+  }
+  return false;
+}
+
+bool S2Polygon::DecodeUncompressed(Decoder* const decoder, bool within_scope) {
   if (decoder->avail() < 2 * sizeof(uint8_t) + sizeof(uint32_t)) return false;
   ClearLoops();
   decoder->get8();  // Ignore irrelevant serialized owns_loops_ value.
@@ -813,7 +917,10 @@ bool S2Polygon::DecodeUncompressed(Decoder* const decoder) {
   for (size_t i = 0; i < num_loops; ++i) {
     loops_.push_back(make_unique<S2Loop>());
     loops_.back()->set_s2debug_override(s2debug_override());
-    if (!loops_.back()->Decode(decoder)) return false;
+    if (within_scope ? !loops_.back()->DecodeWithinScope(decoder)
+                     : !loops_.back()->Decode(decoder)) {
+      return false;
+    }
 
     // Ignore any empty loops that were previously encoded.
     if (loops_.back()->is_empty() || loops_.back()->num_vertices() == 0) {
@@ -825,7 +932,11 @@ bool S2Polygon::DecodeUncompressed(Decoder* const decoder) {
   }
   if (!bound_.Decode(decoder)) return false;
   subregion_bound_ = S2LatLngRectBounder::ExpandForSubregions(bound_);
-  InitIndex();
+  if (within_scope) {
+    index_.Add(make_unique<Shape>(this));  // Skip the validity checks.
+  } else {
+    InitIndex();
+  }
   return true;
 }
 
@@ -1257,6 +1368,175 @@ vector<unique_ptr<S2Polyline>> S2Polygon::SubtractFromPolyline(
                                snap_function, a);
 }
 
+namespace {
+
+// A point where an edge of a polyline ("a") crosses an edge of the polygon
+// boundary ("b") at an interior point of both edges.
+struct PolylineCrossing {
+  s2shapeutil::ShapeEdgeId a, b;
+  S2Point point;
+};
+
+// Returns true if all adjacent vertices of "polyline" are farther than
+// "snap_radius" apart, so that S2Builder would not merge them.
+bool HasSeparatedVertices(const S2Polyline& polyline, S1Angle snap_radius) {
+  if (polyline.num_vertices() < 2) return false;
+  const S1ChordAngle min_distance(snap_radius);
+  for (int i = 1; i < polyline.num_vertices(); ++i) {
+    if (S1ChordAngle(polyline.vertex(i - 1), polyline.vertex(i)) <=
+        min_distance) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Splits "polyline" at the given crossings, which must be sorted in the order
+// they are encountered along the polyline, and appends the pieces inside the
+// polygon to "result".  "inside" indicates whether the first vertex is
+// inside the polygon.  Returns false without modifying "result" if a crossing
+// point is identical to an adjacent vertex, in which case the polyline
+// should be clipped using S2Builder instead.
+bool SplitPolylineAtCrossings(const S2Polyline& polyline,
+                              Span<const PolylineCrossing> crossings,
+                              bool inside,
+                              vector<unique_ptr<S2Polyline>>* result) {
+  vector<vector<S2Point>> pieces;
+  vector<S2Point> vertices;
+  if (inside) vertices.push_back(polyline.vertex(0));
+  S2Point prev = polyline.vertex(0);
+  size_t k = 0;
+  for (int e = 0; e + 1 < polyline.num_vertices(); ++e) {
+    const S2Point& v1 = polyline.vertex(e + 1);
+    for (; k < crossings.size() && crossings[k].a.edge_id == e; ++k) {
+      const S2Point& x = crossings[k].point;
+      if (x == prev || x == v1) return false;
+      vertices.push_back(x);
+      if (inside) pieces.push_back(std::move(vertices));
+      vertices.clear();
+      if (!inside) vertices.push_back(x);
+      inside = !inside;
+      prev = x;
+    }
+    if (inside) vertices.push_back(v1);
+    prev = v1;
+  }
+  if (inside) pieces.push_back(std::move(vertices));
+  for (const auto& piece : pieces) {
+    result->push_back(make_unique<S2Polyline>(piece));
+  }
+  return true;
+}
+
+}  // namespace
+
+vector<vector<unique_ptr<S2Polyline>>> S2Polygon::IntersectWithPolylines(
+    Span<const S2Polyline* const> polylines, int num_threads) const {
+  return ApproxIntersectWithPolylines(polylines, S2::kIntersectionMergeRadius,
+                                      num_threads);
+}
+
+vector<vector<unique_ptr<S2Polyline>>>
+S2Polygon::ApproxIntersectWithPolylines(Span<const S2Polyline* const> polylines,
+                                        S1Angle snap_radius,
+                                        int num_threads) const {
+  num_threads = std::max(1, num_threads);
+
+  // Larger snap radii can merge vertices that are far apart along a
+  // polyline, so in that case every polyline is clipped using S2Builder.
+  //
+  // Index all the polylines together and find their crossings with the
+  // polygon boundary in a single pass.  Shape "i" of the index is polyline
+  // "i".  Crossings at a vertex of either edge are only recorded as a flag
+  // since such polylines are always clipped using S2Builder.
+  MutableS2ShapeIndex::Options index_options;
+  index_options.set_num_threads(num_threads);
+  MutableS2ShapeIndex polyline_index(index_options);
+  for (const S2Polyline* polyline : polylines) {
+    polyline_index.Add(make_unique<S2Polyline::Shape>(polyline));
+  }
+  polyline_index.ForceBuild();
+  index_.ForceBuild();
+  const int num_shards = 4 * num_threads;
+  vector<vector<PolylineCrossing>> shard_crossings(num_shards);
+  vector<vector<int>> shard_touching(num_shards);
+  s2shapeutil::VisitCrossingEdgePairs(
+      polyline_index, index_, s2shapeutil::CrossingType::ALL, num_shards,
+      num_threads,
+      [&](int shard, const s2shapeutil::ShapeEdge& a,
+          const s2shapeutil::ShapeEdge& b, bool is_interior) {
+        if (is_interior) {
+          shard_crossings[shard].push_back(
+              {a.id(), b.id(),
+               S2::GetIntersection(a.v0(), a.v1(), b.v0(), b.v1())});
+        } else {
+          shard_touching[shard].push_back(a.id().shape_id);
+        }
+        return true;
+      });
+  vector<PolylineCrossing> crossings;
+  vector<bool> touching(polylines.size());
+  for (int shard = 0; shard < num_shards; ++shard) {
+    crossings.insert(crossings.end(), shard_crossings[shard].begin(),
+                     shard_crossings[shard].end());
+    for (int shape_id : shard_touching[shard]) touching[shape_id] = true;
+  }
+  // Crossings may be visited more than once.
+  s2internal::ParallelSort(num_threads, crossings.begin(), crossings.end(),
+                           [](const PolylineCrossing& x,
+                              const PolylineCrossing& y) {
+                             return std::tie(x.a, x.b) < std::tie(y.a, y.b);
+                           });
+  crossings.erase(std::unique(crossings.begin(), crossings.end(),
+                              [](const PolylineCrossing& x,
+                                 const PolylineCrossing& y) {
+                                return x.a == y.a && x.b == y.b;
+                              }),
+                  crossings.end());
+  vector<size_t> first_crossing(polylines.size() + 1);
+  for (size_t i = 0, k = 0; i <= polylines.size(); ++i) {
+    while (k < crossings.size() && crossings[k].a.shape_id < i) ++k;
+    first_crossing[i] = k;
+  }
+
+  // Each task writes only to its own slots, so the result does not depend on
+  // the number of threads.
+  vector<vector<unique_ptr<S2Polyline>>> result(polylines.size());
+  s2internal::ParallelFor(num_threads, polylines.size(), [&](int i) {
+    const S2Polyline& polyline = *polylines[i];
+    Span<PolylineCrossing> polyline_crossings(
+        crossings.data() + first_crossing[i],
+        first_crossing[i + 1] - first_crossing[i]);
+    if (snap_radius <= S2::kIntersectionMergeRadius && !touching[i] &&
+        HasSeparatedVertices(polyline, snap_radius)) {
+      const bool inside = Contains(polyline.vertex(0));
+      if (polyline_crossings.empty()) {
+        if (inside) result[i].emplace_back(polyline.Clone());
+        return;
+      }
+      if (snap_radius == S1Angle::Zero()) {
+        // Sort the crossings along each edge by their distance from the
+        // edge's first vertex.
+        std::sort(polyline_crossings.begin(), polyline_crossings.end(),
+                  [&polyline](const PolylineCrossing& x,
+                              const PolylineCrossing& y) {
+                    if (x.a.edge_id != y.a.edge_id) {
+                      return x.a.edge_id < y.a.edge_id;
+                    }
+                    const S2Point& v0 = polyline.vertex(x.a.edge_id);
+                    return (x.point - v0).Norm2() < (y.point - v0).Norm2();
+                  });
+        if (SplitPolylineAtCrossings(polyline, polyline_crossings, inside,
+                                     &result[i])) {
+          return;
+        }
+      }
+    }
+    result[i] = ApproxIntersectWithPolyline(polyline, snap_radius);
+  });
+  return result;
+}
+
 bool S2Polygon::Contains(const S2Polyline& b) const {
   return ApproxContains(b, S2::kIntersectionMergeRadius);
 }
@@ -1336,6 +1616,46 @@ unique_ptr<S2Polygon> S2Polygon::DestructiveUnion(
   return std::move(*queue.top());
 }
 
+unique_ptr<S2Polygon> S2Polygon::DestructiveUnion(
+    vector<unique_ptr<S2Polygon>> polygons,
+    const S2Builder::SnapFunction& snap_function, int num_threads) {
+  if (polygons.empty()) return make_unique<S2Polygon>();
+
+  // Sort the polygons along the Hilbert curve so that neighboring entries
+  // tend to be close together.  The original index breaks ties so that the
+  // result is deterministic.
+  vector<pair<S2CellId, int>> order;
+  order.reserve(polygons.size());
+  for (size_t i = 0; i < polygons.size(); ++i) {
+    order.emplace_back(S2CellId(polygons[i]->GetCapBound().center()), i);
+  }
+  std::sort(order.begin(), order.end());
+  vector<unique_ptr<S2Polygon>> level;
+  level.reserve(polygons.size());
+  for (const auto& entry : order) {
+    level.push_back(std::move(polygons[entry.second]));
+  }
+
+  // Union adjacent pairs until only one polygon is left.  Each task writes
+  // only to its own slots, so the result does not depend on the number of
+  // threads.
+  while (level.size() > 1) {
+    const int num_pairs = level.size() / 2;
+    s2internal::ParallelFor(num_threads, num_pairs, [&](int i) {
+      auto union_polygon = make_unique<S2Polygon>();
+      union_polygon->InitToUnion(*level[2 * i], *level[2 * i + 1],
+                                 snap_function);
+      level[2 * i] = std::move(union_polygon);
+      level[2 * i + 1].reset();
+    });
+    for (size_t i = 2; i < level.size(); i += 2) {
+      level[i / 2] = std::move(level[i]);
+    }
+    level.resize((level.size() + 1) / 2);
+  }
+  return std::move(level[0]);
+}
+
 void S2Polygon::InitToCellUnionBorder(const S2CellUnion& cells) {
   // We use S2Builder to compute the union.  Due to rounding errors, we can't
   // compute an exact union - when a small cell is adjacent to a larger cell,
@@ -1547,6 +1867,23 @@ S2Shape::Edge S2Polygon::Shape::edge(int e) const {
   return S2Polygon::Shape::chain_edge(pos.chain_id, pos.offset);
 }
 
+void S2Polygon::Shape::GetEdges(int begin, Span<Edge> edges) const {
+  ABSL_DCHECK_LE(begin + static_cast<int>(edges.size()), num_edges());
+  if (edges.empty()) return;
+  ChainPosition pos = S2Polygon::Shape::chain_position(begin);
+  size_t k = 0;
+  for (int i = pos.chain_id, j = pos.offset; k < edges.size(); ++i, j = 0) {
+    const S2Loop* loop = polygon_->loop(i);
+    int n = loop->num_vertices();
+    S2Point v0 = loop->oriented_vertex(j);
+    for (; j < n && k < edges.size(); ++j, ++k) {
+      S2Point v1 = loop->oriented_vertex(j + 1);
+      edges[k] = Edge(v0, v1);
+      v0 = v1;
+    }
+  }
+}
+
 S2Shape::ReferencePoint S2Polygon::Shape::GetReferencePoint() const {
   bool contains_origin = false;
   for (int i = 0; i < polygon_->num_loops(); ++i) {
@@ -1575,10 +1912,20 @@ S2Shape::Chain S2Polygon::Shape::chain(int i) const {
 }
 
 size_t S2Polygon::SpaceUsed() const {
-  size_t size = sizeof(*this);
+  S2SpaceUsage usage;
+  GetSpaceUsage(&usage);
+  return usage.total_bytes();
+}
+
+void S2Polygon::GetSpaceUsage(S2SpaceUsage* usage) const {
+  // index_ is reported separately.
+  usage->Add("object", sizeof(*this) - sizeof(index_));
+  size_t loops = 0;
   for (int i = 0; i < num_loops(); ++i) {
-    size += loop(i)->SpaceUsed();
+    loops += loop(i)->SpaceUsed();
   }
-  size += index_.SpaceUsed() - sizeof(index_);
-  return size;
+  usage->Add("loops", loops);
+  S2SpaceUsage index_usage;
+  index_.GetSpaceUsage(&index_usage);
+  usage->Add("index", index_usage);
 }
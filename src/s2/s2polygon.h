@@ -30,6 +30,7 @@
 #include "absl/container/flat_hash_map.h"
 #include "absl/flags/flag.h"
 #include "absl/log/absl_check.h"
+#include "absl/types/span.h"
 
 #include "s2/_fp_contract_off.h"
 #include "s2/base/types.h"
@@ -48,6 +49,7 @@
 #include "s2/s2region.h"
 #include "s2/s2shape.h"
 #include "s2/s2shape_index.h"
+#include "s2/s2space_usage.h"
 #include "s2/util/coding/coder.h"
 
 class S1Angle;
@@ -171,7 +173,13 @@ class S2Polygon final : public S2Region {
   //
   // This method may be called more than once, in which case any existing
   // loops are deleted before being replaced by the input loops.
-  void InitNested(std::vector<std::unique_ptr<S2Loop>> loops);
+  //
+  // Determining the hierarchy requires testing pairs of nearby loops for
+  // containment, which is done using up to "num_threads" threads.  This is
+  // worthwhile for polygons with many large loops (e.g., a country with
+  // thousands of islands and lakes).
+  void InitNested(std::vector<std::unique_ptr<S2Loop>> loops,
+                  int num_threads = 1);
 
   // Like InitNested(), but expects loops to be oriented such that the polygon
   // interior is on the left-hand side of all loops.  This implies that shells
@@ -295,6 +303,11 @@ class S2Polygon final : public S2Region {
   static std::pair<double, double> GetOverlapFractions(const S2Polygon& a,
                                                        const S2Polygon& b);
 
+  // Return the area of the intersection of two polygons.  This gives the same
+  // result as InitToIntersection() followed by GetArea(), but is faster since
+  // the intersection is never assembled into a polygon.
+  static double GetIntersectionArea(const S2Polygon& a, const S2Polygon& b);
+
   // If the given point is contained by the polygon, return it.  Otherwise
   // return the closest point on the polygon boundary.  If the polygon is
   // empty, return the input argument.  Note that the result may or may not be
@@ -566,6 +579,33 @@ class S2Polygon final : public S2Region {
   std::vector<std::unique_ptr<S2Polyline>> SubtractFromPolyline(
       const S2Polyline& in, const S2Builder::SnapFunction& snap_function) const;
 
+  // Intersects this polygon with each of the given polylines and returns the
+  // results in the same order, i.e. element "i" of the result corresponds to
+  // IntersectWithPolyline(*polylines[i]).  This is much faster than clipping
+  // the polylines one at a time when there are many of them (e.g., GPS
+  // traces): the polylines are indexed together, their crossings with the
+  // polygon boundary are found in a single pass, and polylines that do not
+  // touch the boundary are kept or discarded without using S2Builder.  The
+  // remaining polylines are clipped using up to "num_threads" threads.
+  //
+  // The results are the same as IntersectWithPolyline() except in the
+  // degenerate case where a polyline that does not touch the boundary passes
+  // within the snap radius of one of its own non-adjacent vertices (which
+  // S2Builder would snap together).
+  std::vector<std::vector<std::unique_ptr<S2Polyline>>> IntersectWithPolylines(
+      absl::Span<const S2Polyline* const> polylines, int num_threads = 1) const;
+
+  // Like IntersectWithPolylines(), but corresponds to
+  // ApproxIntersectWithPolyline(*polylines[i], snap_radius).  The shortcuts
+  // described above are only used when "snap_radius" is at most
+  // S2::kIntersectionMergeRadius, since larger snap radii can merge vertices
+  // anywhere along a polyline.  If "snap_radius" is zero, then polylines
+  // that cross the boundary only at interior points of their edges are also
+  // split directly at the crossing points rather than using S2Builder.
+  std::vector<std::vector<std::unique_ptr<S2Polyline>>>
+  ApproxIntersectWithPolylines(absl::Span<const S2Polyline* const> polylines,
+                               S1Angle snap_radius, int num_threads = 1) const;
+
   // Return a polygon which is the union of the given polygons.
   static std::unique_ptr<S2Polygon> DestructiveUnion(
       std::vector<std::unique_ptr<S2Polygon>> polygons);
@@ -576,6 +616,20 @@ class S2Polygon final : public S2Region {
       std::vector<std::unique_ptr<S2Polygon>> polygons,
       const S2Builder::SnapFunction& snap_function);
 
+  // Like DestructiveUnion(), but computes the union using a balanced tree of
+  // pairwise unions, where the unions at each level of the tree are computed
+  // using up to "num_threads" threads.  The polygons are first sorted by the
+  // S2CellId of their bounding cap centers, so that the unions near the
+  // leaves of the tree combine polygons that are spatially close together.
+  // This keeps the intermediate results small when the input consists of
+  // many scattered polygons.
+  //
+  // The result is the same region as that of DestructiveUnion(), although
+  // the exact vertices may differ slightly due to snapping.
+  static std::unique_ptr<S2Polygon> DestructiveUnion(
+      std::vector<std::unique_ptr<S2Polygon>> polygons,
+      const S2Builder::SnapFunction& snap_function, int num_threads);
+
   // Initialize this polygon to the outline of the given cell union.
   // In principle this polygon should exactly contain the cell union and
   // this polygon's inverse should not intersect the cell union, but rounding
@@ -647,6 +701,12 @@ class S2Polygon final : public S2Region {
   // Returns the total number of bytes used by the polygon.
   size_t SpaceUsed() const;
 
+  // Appends a breakdown of SpaceUsed() to "usage", consisting of the
+  // components "object" (sizeof(*this) excluding the index), "loops" (the
+  // loops and their vertices and indexes), and the components of the
+  // polygon's MutableS2ShapeIndex prefixed by "index.".
+  void GetSpaceUsage(S2SpaceUsage* usage) const;
+
   ////////////////////////////////////////////////////////////////////////
   // S2Region interface (see s2region.h for details):
 
@@ -693,6 +753,19 @@ class S2Polygon final : public S2Region {
   // Decodes a polygon encoded with Encode().  Returns true on success.
   bool Decode(Decoder* decoder);
 
+  // Like Decode(), except that polygons written by EncodeUncompressed() are
+  // decoded without copying: the loop vertices refer directly to the data in
+  // the decoder's buffer (see S2Loop::DecodeWithinScope), and the encoded
+  // bounds are used as is.  No validity checks are performed, even in debug
+  // builds.  The buffer must persist until the polygon is destroyed or
+  // reinitialized (including any loops obtained from Release()), and should
+  // contain trusted data.  Compressed encodings are decoded as by Decode().
+  //
+  // As with Decode(), the loop and polygon indexes are not built until they
+  // are first needed, so decoding takes time proportional to the number of
+  // loops rather than the number of vertices.
+  bool DecodeWithinScope(Decoder* decoder);
+
   // Wrapper class for indexing a polygon (see S2ShapeIndex).  Once this
   // object is inserted into an S2ShapeIndex it is owned by that index, and
   // will be automatically deleted when no longer needed by the index.  Note
@@ -729,6 +802,7 @@ class S2Polygon final : public S2Region {
                                              : polygon_->is_full() ? 0 : 1;
     }
     Edge edge(int e) const final;
+    void GetEdges(int begin, absl::Span<Edge> edges) const final;
     int dimension() const final { return 2; }
     ReferencePoint GetReferencePoint() const final;
     int num_chains() const final;
@@ -823,6 +897,16 @@ class S2Polygon final : public S2Region {
   // determine which are shells and which are holes, and then discarded.
   typedef absl::flat_hash_map<S2Loop*, std::vector<S2Loop*>> LoopMap;
 
+  // Builds the LoopMap for loops_.  When there are at least
+  // kMinLoopsForCellIndex loops (or more than one thread), candidate parents
+  // are found using an S2CellIndex of the loop bounds, so that each loop is
+  // tested for containment only against nearby loops.  This takes
+  // approximately linear rather than quadratic time for polygons with many
+  // loops (e.g., a shell with thousands of holes).  Otherwise the loops are
+  // inserted one at a time with InsertLoop().  Siblings are kept in their
+  // original order.  Loops are tested using up to "num_threads" threads.
+  static constexpr int kMinLoopsForCellIndex = 256;
+  void InitLoopMap(LoopMap* loop_map, int num_threads);
   void InsertLoop(S2Loop* new_loop, S2Loop* parent, LoopMap* loop_map);
   void InitLoops(LoopMap* loop_map);
 
@@ -858,8 +942,8 @@ class S2Polygon final : public S2Region {
       const S2Polyline& a) const;
 
   // Decode a polygon encoded with EncodeUncompressed().  Used by the Decode
-  // method above.
-  bool DecodeUncompressed(Decoder* decoder);
+  // methods above.
+  bool DecodeUncompressed(Decoder* decoder, bool within_scope);
 
   // Encode the polygon's vertices using about 4 bytes / vertex plus 24 bytes /
   // unsnapped vertex. All the loop vertices must be converted first to the
@@ -0,0 +1,146 @@
+// Copyright 2024 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "s2/s2polygon.h"
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+#include "s2/util/coding/coder.h"
+#include "s2/s2benchmark_testing.h"
+#include "s2/s2builderutil_snap_functions.h"
+#include "s2/s2cap.h"
+#include "s2/s2debug.h"
+#include "s2/s2edge_crossings.h"
+#include "s2/s2latlng.h"
+#include "s2/s2loop.h"
+#include "s2/s2random.h"
+#include "s2/s2testing.h"
+
+using std::unique_ptr;
+using std::vector;
+
+namespace {
+
+// Returns a large shell followed by "num_holes" small holes arranged in a
+// grid, in random order.
+vector<unique_ptr<S2Loop>> MakeShellWithHoles(int num_holes) {
+  std::mt19937_64 bitgen(s2benchmark::kSeed);
+  const int grid_size = std::ceil(std::sqrt(num_holes));
+  vector<unique_ptr<S2Loop>> loops;
+  loops.push_back(S2Loop::MakeRegularLoop(
+      S2LatLng::FromDegrees(5, 5).ToPoint(), S2Testing::KmToAngle(2000), 16));
+  for (int i = 0; i < num_holes; ++i) {
+    const double spacing = 10.0 / grid_size;
+    S2Point center = S2LatLng::FromDegrees(spacing * (i / grid_size),
+                                           spacing * (i % grid_size))
+                         .ToPoint();
+    loops.push_back(S2Loop::MakeRegularLoop(
+        center, S2Testing::KmToAngle(30 * spacing), 8));
+  }
+  std::shuffle(loops.begin(), loops.end(), bitgen);
+  return loops;
+}
+
+// Measures the time to compute the nesting of a shell with many holes.
+void BM_S2PolygonInitNestedManyHoles(benchmark::State& state) {
+  const vector<unique_ptr<S2Loop>> loops = MakeShellWithHoles(state.range(0));
+  for (auto _ : state) {
+    state.PauseTiming();
+    vector<unique_ptr<S2Loop>> copy;
+    for (const auto& loop : loops) copy.emplace_back(loop->Clone());
+    S2Polygon polygon;
+    state.ResumeTiming();
+    polygon.InitNested(std::move(copy));
+    benchmark::DoNotOptimize(polygon.num_loops());
+  }
+}
+BENCHMARK(BM_S2PolygonInitNestedManyHoles)->Range(16, 16384);
+
+// Returns the uncompressed encoding of a fractal polygon with approximately
+// "num_edges" edges.
+Encoder EncodeFractalPolygon(int num_edges) {
+  std::mt19937_64 bitgen(s2benchmark::kSeed);
+  S2Polygon polygon(s2benchmark::MakeFractalLoop(bitgen, num_edges));
+  Encoder encoder;
+  polygon.EncodeUncompressed(&encoder);
+  return encoder;
+}
+
+void BM_S2PolygonDecode(benchmark::State& state) {
+  const Encoder encoder = EncodeFractalPolygon(state.range(0));
+  // Measure decoding rather than the validity checks done in debug builds.
+  S2Polygon polygon;
+  polygon.set_s2debug_override(S2Debug::DISABLE);
+  for (auto _ : state) {
+    Decoder decoder(encoder.base(), encoder.length());
+    benchmark::DoNotOptimize(polygon.Decode(&decoder));
+  }
+}
+BENCHMARK(BM_S2PolygonDecode)->Range(16, 16384);
+
+void BM_S2PolygonDecodeWithinScope(benchmark::State& state) {
+  const Encoder encoder = EncodeFractalPolygon(state.range(0));
+  S2Polygon polygon;
+  for (auto _ : state) {
+    Decoder decoder(encoder.base(), encoder.length());
+    benchmark::DoNotOptimize(polygon.DecodeWithinScope(&decoder));
+  }
+}
+BENCHMARK(BM_S2PolygonDecodeWithinScope)->Range(16, 16384);
+
+// Returns "num_polygons" small, partially overlapping polygons scattered
+// over a region, in random order.
+vector<unique_ptr<S2Polygon>> MakeScatteredPolygons(int num_polygons) {
+  std::mt19937_64 bitgen(s2benchmark::kSeed);
+  const S2Cap region(s2random::Point(bitgen), S2Testing::KmToAngle(1000));
+  vector<unique_ptr<S2Polygon>> polygons;
+  for (int i = 0; i < num_polygons; ++i) {
+    polygons.push_back(std::make_unique<S2Polygon>(S2Loop::MakeRegularLoop(
+        s2random::SamplePoint(bitgen, region), S2Testing::KmToAngle(20), 32)));
+  }
+  return polygons;
+}
+
+// Benchmarks DestructiveUnion() with state.range(1) threads, or without the
+// "num_threads" argument if state.range(1) is zero.
+void BM_S2PolygonDestructiveUnion(benchmark::State& state) {
+  const vector<unique_ptr<S2Polygon>> polygons =
+      MakeScatteredPolygons(state.range(0));
+  const int num_threads = state.range(1);
+  const auto snap_function =
+      s2builderutil::IdentitySnapFunction(S2::kIntersectionMergeRadius);
+  for (auto _ : state) {
+    state.PauseTiming();
+    vector<unique_ptr<S2Polygon>> copy;
+    for (const auto& polygon : polygons) copy.emplace_back(polygon->Clone());
+    state.ResumeTiming();
+    auto result =
+        num_threads == 0
+            ? S2Polygon::DestructiveUnion(std::move(copy), snap_function)
+            : S2Polygon::DestructiveUnion(std::move(copy), snap_function,
+                                          num_threads);
+    benchmark::DoNotOptimize(result->num_loops());
+  }
+}
+BENCHMARK(BM_S2PolygonDestructiveUnion)
+    ->ArgsProduct({{64, 1024}, {0, 1, 4}})
+    ->Unit(benchmark::kMillisecond);
+
+}  // namespace
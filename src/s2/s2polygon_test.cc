@@ -314,6 +314,43 @@ TEST(S2Polygon, OverlapFractions) {
   EXPECT_NEAR(0.5, result.second, 1e-14);
 }
 
+TEST(S2Polygon, GetIntersectionArea) {
+  S2Polygon empty, full(make_unique<S2Loop>(S2Loop::kFull()));
+  unique_ptr<S2Polygon> a(MakePolygon(kOverlap3));
+  EXPECT_EQ(0, S2Polygon::GetIntersectionArea(empty, *a));
+  EXPECT_EQ(0, S2Polygon::GetIntersectionArea(empty, full));
+  EXPECT_EQ(4 * M_PI, S2Polygon::GetIntersectionArea(full, full));
+  EXPECT_NEAR(a->GetArea(), S2Polygon::GetIntersectionArea(full, *a), 1e-15);
+
+  // Check that the result matches InitToIntersection() followed by
+  // GetArea() for pairs of overlapping fractal polygons, some with holes.
+  absl::BitGen bitgen(S2Testing::MakeTaggedSeedSeq(
+      "GET_INTERSECTION_AREA",
+      absl::LogInfoStreamer(__FILE__, __LINE__).stream()));
+  S2Fractal fractal(bitgen);
+  fractal.SetLevelForApproxMaxEdges(300);
+  for (int iter = 0; iter < 20; ++iter) {
+    const Matrix3x3_d frame = s2random::Frame(bitgen);
+    vector<unique_ptr<S2Loop>> loops;
+    loops.push_back(fractal.MakeLoop(frame, S1Angle::Degrees(1)));
+    if (iter % 2) {
+      loops.push_back(S2Loop::MakeRegularLoop(frame.Col(2),
+                                              S1Angle::Degrees(0.1), 10));
+    }
+    S2Polygon b, c;
+    b.InitNested(std::move(loops));
+    c.Init(fractal.MakeLoop(frame, S1Angle::Degrees(1.2)));
+    S2Polygon intersection;
+    intersection.InitToIntersection(b, c);
+    EXPECT_NEAR(intersection.GetArea(), S2Polygon::GetIntersectionArea(b, c),
+                1e-14);
+    auto fractions = S2Polygon::GetOverlapFractions(b, c);
+    EXPECT_NEAR(intersection.GetArea() / b.GetArea(), fractions.first, 1e-12);
+    EXPECT_NEAR(intersection.GetArea() / c.GetArea(), fractions.second,
+                1e-12);
+  }
+}
+
 TEST(S2Polygon, OriginNearPole) {
   // S2Polygon operations are more efficient if S2::Origin() is near a pole.
   // (Loops that contain a pole tend to have very loose bounding boxes because
@@ -1715,6 +1752,62 @@ TEST_F(S2PolygonTestBase, PolylineIntersection) {
   }
 }
 
+TEST(S2Polygon, IntersectWithPolylines) {
+  absl::BitGen bitgen(S2Testing::MakeTaggedSeedSeq(
+      "INTERSECT_WITH_POLYLINES",
+      absl::LogInfoStreamer(__FILE__, __LINE__).stream()));
+  const S2Point center = s2random::Point(bitgen);
+  vector<unique_ptr<S2Loop>> loops;
+  loops.push_back(S2Loop::MakeRegularLoop(center, S1Angle::Degrees(5), 50));
+  loops.push_back(S2Loop::MakeRegularLoop(center, S1Angle::Degrees(1), 20));
+  S2Polygon polygon;
+  polygon.InitNested(std::move(loops));
+  ASSERT_EQ(2, polygon.num_loops());
+
+  // Random walks that may cross the boundary any number of times, plus
+  // polylines that touch the boundary at a vertex and a single vertex.
+  vector<unique_ptr<S2Polyline>> owned;
+  const S2Cap cap(center, S1Angle::Degrees(7));
+  for (int i = 0; i < 200; ++i) {
+    vector<S2Point> vertices = {s2random::SamplePoint(bitgen, cap)};
+    const S1Angle step = S1Angle::Degrees(absl::Uniform(bitgen, 0.01, 3.0));
+    for (int j = absl::Uniform(bitgen, 0, 10); j > 0; --j) {
+      vertices.push_back(s2random::SamplePoint(
+          bitgen, S2Cap(vertices.back(), step)));
+    }
+    owned.push_back(make_unique<S2Polyline>(vertices));
+  }
+  owned.push_back(make_unique<S2Polyline>(
+      vector<S2Point>{center, polygon.loop(0)->vertex(0)}));
+  owned.push_back(make_unique<S2Polyline>(vector<S2Point>{
+      polygon.loop(1)->vertex(3), polygon.loop(0)->vertex(7), center}));
+  vector<const S2Polyline*> polylines;
+  for (const auto& polyline : owned) polylines.push_back(polyline.get());
+
+  for (S1Angle snap_radius : {S2::kIntersectionMergeRadius, S1Angle::Zero(),
+                              S1Angle::Degrees(0.5)}) {
+    for (int num_threads : {1, 4}) {
+      SCOPED_TRACE(StrCat(snap_radius.degrees(), " ", num_threads));
+      auto actual = polygon.ApproxIntersectWithPolylines(polylines,
+                                                         snap_radius,
+                                                         num_threads);
+      ASSERT_EQ(polylines.size(), actual.size());
+      for (size_t i = 0; i < polylines.size(); ++i) {
+        auto expected =
+            polygon.ApproxIntersectWithPolyline(*polylines[i], snap_radius);
+        ASSERT_EQ(expected.size(), actual[i].size()) << i;
+        for (size_t j = 0; j < expected.size(); ++j) {
+          EXPECT_TRUE(expected[j]->Equals(*actual[i][j]))
+              << i << ": " << s2textformat::ToString(*expected[j]) << " vs. "
+              << s2textformat::ToString(*actual[i][j]);
+        }
+      }
+    }
+  }
+  EXPECT_EQ(polylines.size(), polygon.IntersectWithPolylines(polylines).size());
+  EXPECT_TRUE(S2Polygon().IntersectWithPolylines(polylines)[0].empty());
+}
+
 static void CheckCoveringIsConservative(const S2Polygon& polygon,
                                         absl::Span<const S2CellId> cells) {
   // Check that Contains(S2Cell) and MayIntersect(S2Cell) are implemented
@@ -2115,6 +2208,107 @@ TEST(S2Polygon, MultipleInit) {
   EXPECT_TRUE(bound1 != polygon->GetRectBound());
 }
 
+TEST(S2Polygon, InitNestedManyHoles) {
+  absl::BitGen bitgen(S2Testing::MakeTaggedSeedSeq(
+      "INIT_NESTED_MANY_HOLES",
+      absl::LogInfoStreamer(__FILE__, __LINE__).stream()));
+  // A shell containing a grid of holes, where each hole contains an island.
+  // The loops are shuffled so that children often precede their parents.
+  constexpr int kGridSize = 20;
+  vector<unique_ptr<S2Loop>> loops;
+  loops.push_back(S2Loop::MakeRegularLoop(
+      S2LatLng::FromDegrees(5, 5).ToPoint(), S2Testing::KmToAngle(2000), 8));
+  for (int i = 0; i < kGridSize; ++i) {
+    for (int j = 0; j < kGridSize; ++j) {
+      S2Point center = S2LatLng::FromDegrees(0.5 * i, 0.5 * j).ToPoint();
+      loops.push_back(
+          S2Loop::MakeRegularLoop(center, S2Testing::KmToAngle(20), 6));
+      loops.push_back(
+          S2Loop::MakeRegularLoop(center, S2Testing::KmToAngle(10), 5));
+    }
+  }
+  std::shuffle(loops.begin(), loops.end(), bitgen);
+  S2Polygon polygon(std::move(loops));
+  ASSERT_TRUE(polygon.IsValid());
+  ASSERT_EQ(polygon.num_loops(), 1 + 2 * kGridSize * kGridSize);
+  EXPECT_EQ(polygon.loop(0)->depth(), 0);
+  for (int i = 1; i < polygon.num_loops(); ++i) {
+    const S2Loop& loop = *polygon.loop(i);
+    const int parent = polygon.GetParent(i);
+    ASSERT_GE(parent, 0);
+    EXPECT_EQ(polygon.loop(parent)->depth(), loop.depth() - 1);
+    EXPECT_TRUE(polygon.loop(parent)->Contains(loop));
+    EXPECT_EQ(loop.num_vertices(), loop.depth() == 1 ? 6 : 5);
+  }
+}
+
+TEST(S2Polygon, InitNestedWithThreads) {
+  absl::BitGen bitgen(S2Testing::MakeTaggedSeedSeq(
+      "INIT_NESTED_WITH_THREADS",
+      absl::LogInfoStreamer(__FILE__, __LINE__).stream()));
+  // Several groups of nested loops with many vertices, so that their
+  // indexes are built while the hierarchy is being determined.  With a
+  // single thread, this few loops are nested without an S2CellIndex, so
+  // this also checks that both methods build the same hierarchy.
+  vector<unique_ptr<S2Loop>> loops;
+  for (int i = 0; i < 10; ++i) {
+    const S2Point center = S2LatLng::FromDegrees(0, 10 * i).ToPoint();
+    for (int depth = 0; depth < 3; ++depth) {
+      loops.push_back(S2Loop::MakeRegularLoop(
+          center, S1Angle::Degrees(4 - 1.2 * depth), 500));
+    }
+  }
+  std::shuffle(loops.begin(), loops.end(), bitgen);
+  vector<unique_ptr<S2Loop>> clones;
+  for (const auto& loop : loops) clones.emplace_back(loop->Clone());
+
+  S2Polygon expected(std::move(loops));
+  S2Polygon actual;
+  actual.InitNested(std::move(clones), 4 /*num_threads*/);
+  ASSERT_TRUE(actual.IsValid());
+  ASSERT_EQ(actual.num_loops(), expected.num_loops());
+  for (int i = 0; i < actual.num_loops(); ++i) {
+    EXPECT_TRUE(actual.loop(i)->Equals(*expected.loop(i)));
+    EXPECT_EQ(actual.loop(i)->depth(), expected.loop(i)->depth());
+  }
+}
+
+TEST(S2Polygon, DestructiveUnionWithThreads) {
+  absl::BitGen bitgen(S2Testing::MakeTaggedSeedSeq(
+      "DESTRUCTIVE_UNION_WITH_THREADS",
+      absl::LogInfoStreamer(__FILE__, __LINE__).stream()));
+  // Many overlapping and disjoint loops scattered over a region.
+  const S2Cap region(s2random::Point(bitgen), S2Testing::KmToAngle(500));
+  vector<unique_ptr<S2Polygon>> polygons;
+  for (int i = 0; i < 57; ++i) {
+    polygons.push_back(make_unique<S2Polygon>(S2Loop::MakeRegularLoop(
+        s2random::SamplePoint(bitgen, region),
+        S2Testing::KmToAngle(absl::Uniform(bitgen, 10.0, 100.0)), 10)));
+  }
+  auto clone_all = [&polygons]() {
+    vector<unique_ptr<S2Polygon>> clones;
+    for (const auto& polygon : polygons) clones.emplace_back(polygon->Clone());
+    return clones;
+  };
+  const auto snap_function =
+      s2builderutil::IdentitySnapFunction(S2::kIntersectionMergeRadius);
+  unique_ptr<S2Polygon> expected =
+      S2Polygon::DestructiveUnion(clone_all(), snap_function);
+  unique_ptr<S2Polygon> sequential =
+      S2Polygon::DestructiveUnion(clone_all(), snap_function, 1);
+  EXPECT_TRUE(expected->ApproxEquals(*sequential, S2::kIntersectionMergeRadius))
+      << s2textformat::ToString(*expected) << "\nvs\n"
+      << s2textformat::ToString(*sequential);
+  for (int num_threads : {2, 4}) {
+    unique_ptr<S2Polygon> parallel =
+        S2Polygon::DestructiveUnion(clone_all(), snap_function, num_threads);
+    // The tree shape does not depend on the number of threads.
+    EXPECT_TRUE(sequential->Equals(*parallel)) << num_threads;
+  }
+
+  EXPECT_TRUE(S2Polygon::DestructiveUnion({}, snap_function, 4)->is_empty());
+}
+
 TEST(S2Polygon, InitSingleLoop) {
   S2Polygon polygon(make_unique<S2Loop>(S2Loop::kEmpty()));
   EXPECT_TRUE(polygon.is_empty());
@@ -2139,6 +2333,39 @@ TEST(S2Polygon, TestEncodeDecodeDefaultPolygon) {
   EXPECT_TRUE(TestEncodeDecode(polygon));
 }
 
+TEST_F(S2PolygonTestBase, DecodeWithinScope) {
+  for (const S2Polygon* polygon :
+       {cross1_.get(), near_3210_.get(), far_H20_.get(), empty_.get()}) {
+    Encoder encoder;
+    polygon->EncodeUncompressed(&encoder);
+    Decoder decoder(encoder.base(), encoder.length());
+    S2Polygon decoded;
+    ASSERT_TRUE(decoded.DecodeWithinScope(&decoder));
+    EXPECT_TRUE(polygon->Equals(decoded));
+    EXPECT_EQ(polygon->GetRectBound(), decoded.GetRectBound());
+    EXPECT_EQ(decoder.avail(), 0);
+    for (int i = 0; i < decoded.num_loops(); ++i) {
+      // The vertices refer to the encoded data.
+      const char* p =
+          reinterpret_cast<const char*>(&decoded.loop(i)->vertex(0));
+      EXPECT_GE(p, encoder.base());
+      EXPECT_LT(p, encoder.base() + encoder.length());
+    }
+    S2Point center = polygon->GetCapBound().center();
+    EXPECT_EQ(decoded.Contains(center), polygon->Contains(center));
+
+    // Compressed encodings are decoded normally.
+    Encoder compressed_encoder;
+    S2Polygon snapped;
+    snapped.InitToSnapped(*polygon);
+    snapped.Encode(&compressed_encoder);
+    Decoder compressed_decoder(compressed_encoder.base(),
+                               compressed_encoder.length());
+    ASSERT_TRUE(decoded.DecodeWithinScope(&compressed_decoder));
+    EXPECT_TRUE(snapped.Equals(decoded));
+  }
+}
+
 TEST(S2Polygon, CompressedEmptyPolygonRequires3Bytes) {
   S2Polygon empty_polygon;
   Encoder encoder;
@@ -3165,6 +3392,18 @@ void TestPolygonShape(const S2Polygon& polygon) {
       EXPECT_EQ(loop_i->oriented_vertex(j+1), edge.v1);
     }
   }
+  // Check that GetEdges() agrees with edge(), including for ranges that span
+  // several loops.
+  vector<S2Shape::Edge> edges(shape.num_edges());
+  for (int begin = 0; begin < shape.num_edges(); ++begin) {
+    for (int len : {1, 7, shape.num_edges() - begin}) {
+      len = min(len, shape.num_edges() - begin);
+      shape.GetEdges(begin, absl::MakeSpan(edges.data(), len));
+      for (int k = 0; k < len; ++k) {
+        EXPECT_EQ(shape.edge(begin + k), edges[k]);
+      }
+    }
+  }
   EXPECT_EQ(2, shape.dimension());
   EXPECT_FALSE(shape.is_empty());
   EXPECT_FALSE(shape.is_full());
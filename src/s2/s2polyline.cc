@@ -420,7 +420,7 @@ bool S2Polyline::MayIntersect(const S2Cell& cell) const {
 
 void S2Polyline::Encode(Encoder* const encoder,
                         s2coding::CodingHint hint) const {
-  if (hint == s2coding::CodingHint::COMPACT) {
+  if (hint != s2coding::CodingHint::FAST) {
     EncodeMostCompact(encoder);
     return;
   }
@@ -18,7 +18,9 @@
 
 #include <algorithm>
 #include <cmath>
+#include <cstddef>
 #include <memory>
+#include <numeric>
 #include <ostream>
 #include <sstream>
 #include <string>
@@ -27,6 +29,7 @@
 
 #include "absl/log/absl_check.h"
 #include "absl/types/span.h"
+#include "s2/internal/s2parallel.h"
 #include "s2/s2point.h"
 #include "s2/s2polyline.h"
 #include "s2/s2polyline_alignment_internal.h"
@@ -270,25 +273,69 @@ VertexAlignment AlignmentFn(const S2Polyline& a, const S2Polyline& b,
 
 // PUBLIC API IMPLEMENTATION DETAILS
 
-// This is the constant-space implementation of Dynamic Timewarp that can
+// This is the linear-space implementation of Dynamic Timewarp that can
 // compute the alignment cost, but not the warp path.
+//
+// The DP table is evaluated one anti-diagonal at a time.  The cells on an
+// anti-diagonal depend only on the previous two anti-diagonals, so the inner
+// loop has no loop-carried dependencies and can be vectorized by the compiler
+// (unlike a row-by-row evaluation, where each cell depends on its left
+// neighbor).  Rows correspond to the vertices of the shorter polyline, which
+// bounds the size of the anti-diagonals.  The vertex coordinates are copied
+// into separate arrays, with the vertices of the longer polyline in reverse
+// order, so that all of them are accessed sequentially along each
+// anti-diagonal.  The alignment cost is symmetric, and every cell is computed
+// exactly as in DynamicTimewarp(), so the result is the same.
 double GetExactVertexAlignmentCost(const S2Polyline& a, const S2Polyline& b) {
-  const int a_n = a.num_vertices();
-  const int b_n = b.num_vertices();
-  ABSL_CHECK(a_n > 0) << "A is empty polyline.";
-  ABSL_CHECK(b_n > 0) << "B is empty polyline.";
-  vector<double> cost(b_n, DOUBLE_MAX);
-  double left_diag_min_cost = 0;
-  for (int row = 0; row < a_n; ++row) {
-    for (int col = 0; col < b_n; ++col) {
-      double up_cost = cost[col];
-      cost[col] = std::min(left_diag_min_cost, up_cost) +
-                  (a.vertex(row) - b.vertex(col)).Norm();
-      left_diag_min_cost = std::min(cost[col], up_cost);
+  ABSL_CHECK(a.num_vertices() > 0) << "A is empty polyline.";
+  ABSL_CHECK(b.num_vertices() > 0) << "B is empty polyline.";
+  const bool a_is_rows = a.num_vertices() <= b.num_vertices();
+  const S2Polyline& rows = a_is_rows ? a : b;
+  const S2Polyline& cols = a_is_rows ? b : a;
+  const int n = rows.num_vertices();
+  const int m = cols.num_vertices();
+  vector<double> row_x(n), row_y(n), row_z(n);
+  for (int r = 0; r < n; ++r) {
+    const S2Point& p = rows.vertex(r);
+    row_x[r] = p.x();
+    row_y[r] = p.y();
+    row_z[r] = p.z();
+  }
+  // Column "c" is stored at index (m - 1 - c).
+  vector<double> col_x(m), col_y(m), col_z(m);
+  for (int c = 0; c < m; ++c) {
+    const S2Point& p = cols.vertex(m - 1 - c);
+    col_x[c] = p.x();
+    col_y[c] = p.y();
+    col_z[c] = p.z();
+  }
+
+  // Each anti-diagonal stores the cost of cell (r, d - r) at index (r + 1).
+  // Index 0 represents row -1, and the index after the last row of each
+  // anti-diagonal is set to DOUBLE_MAX, so that cells outside the table have
+  // infinite cost.
+  vector<double> prev2(n + 2, DOUBLE_MAX);  // Anti-diagonal d - 2.
+  vector<double> prev1(n + 2, DOUBLE_MAX);  // Anti-diagonal d - 1.
+  vector<double> curr(n + 2, DOUBLE_MAX);   // Anti-diagonal d.
+  prev1[1] = (rows.vertex(0) - cols.vertex(0)).Norm();
+  for (int d = 1; d < n + m - 1; ++d) {
+    const int lo = std::max(0, d - (m - 1));
+    const int hi = std::min(d, n - 1);
+    const int offset = m - 1 - d;  // Column (d - r) is at index (offset + r).
+    for (int r = lo; r <= hi; ++r) {
+      const double dx = row_x[r] - col_x[offset + r];
+      const double dy = row_y[r] - col_y[offset + r];
+      const double dz = row_z[r] - col_z[offset + r];
+      // Cells (r - 1, c - 1), (r - 1, c), and (r, c - 1) respectively.
+      const double min_cost =
+          std::min(prev2[r], std::min(prev1[r], prev1[r + 1]));
+      curr[r + 1] = min_cost + std::sqrt(dx * dx + dy * dy + dz * dz);
     }
-    left_diag_min_cost = DOUBLE_MAX;
+    if (hi + 2 <= n) curr[hi + 2] = DOUBLE_MAX;
+    prev2.swap(prev1);
+    prev1.swap(curr);
   }
-  return cost.back();
+  return prev1[n];
 }
 
 VertexAlignment GetExactVertexAlignment(const S2Polyline& a,
@@ -349,22 +396,89 @@ VertexAlignment GetApproxVertexAlignment(const S2Polyline& a,
 // alignments. Specifically, because cost_fn(a, b) = cost_fn(b, a), and
 // cost_fn(a, a) = 0, we can compute only the lower triangle of cost matrix
 // and then mirror it across the diagonal to save on cost_fn invocations.
+//
+// When several threads are used, the rows of the lower triangle are computed
+// in parallel in blocks (to bound the memory used), and then the costs are
+// summed in the same order as with a single thread so that the result does
+// not depend on the number of threads.
 int GetMedoidPolyline(absl::Span<const unique_ptr<S2Polyline>> polylines,
                       const MedoidOptions options) {
+  // The maximum number of alignment costs stored when computing each block.
+  constexpr int kMaxBlockCosts = 1 << 20;
+
   const int num_polylines = polylines.size();
   const bool approx = options.approx();
+  const int num_threads = options.num_threads();
   ABSL_CHECK_GT(num_polylines, 0);
 
   // costs[i] stores total cost of aligning [i] with all other polylines.
   vector<double> costs(num_polylines, 0.0);
-  for (int i = 0; i < num_polylines; ++i) {
-    for (int j = i + 1; j < num_polylines; ++j) {
-      double cost = CostFn(*polylines[i], *polylines[j], approx);
-      costs[i] += cost;
-      costs[j] += cost;
+  const int block_rows =
+      num_threads <= 1
+          ? 1
+          : std::max(num_threads, kMaxBlockCosts / num_polylines);
+  vector<double> block;
+  for (int begin = 0; begin < num_polylines; begin += block_rows) {
+    const int end = std::min(num_polylines, begin + block_rows);
+    block.resize(static_cast<size_t>(end - begin) * num_polylines);
+    s2internal::ParallelFor(num_threads, end - begin, [&](int r) {
+      const int i = begin + r;
+      double* row = &block[static_cast<size_t>(r) * num_polylines];
+      for (int j = i + 1; j < num_polylines; ++j) {
+        row[j] = CostFn(*polylines[i], *polylines[j], approx);
+      }
+    });
+    for (int i = begin; i < end; ++i) {
+      const double* row =
+          &block[static_cast<size_t>(i - begin) * num_polylines];
+      for (int j = i + 1; j < num_polylines; ++j) {
+        costs[i] += row[j];
+        costs[j] += row[j];
+      }
+    }
+  }
+  const int num_candidates =
+      approx ? std::min(options.num_exact_candidates(), num_polylines) : 0;
+  if (num_candidates <= 1) {
+    return std::min_element(costs.begin(), costs.end()) - costs.begin();
+  }
+
+  // Recompute the total cost of the best candidates exactly.  Ties are
+  // broken in favor of the lowest index, as above.
+  vector<int> candidates(num_polylines);
+  std::iota(candidates.begin(), candidates.end(), 0);
+  std::partial_sort(candidates.begin(), candidates.begin() + num_candidates,
+                    candidates.end(), [&costs](int x, int y) {
+                      return costs[x] < costs[y] ||
+                             (costs[x] == costs[y] && x < y);
+                    });
+  candidates.resize(num_candidates);
+  std::sort(candidates.begin(), candidates.end());
+  vector<double> exact_costs(static_cast<size_t>(num_candidates) *
+                             num_polylines);
+  s2internal::ParallelFor(
+      num_threads, num_candidates * num_polylines, [&](int k) {
+        const int i = candidates[k / num_polylines];
+        const int j = k % num_polylines;
+        // Align the polylines in the same order as when approx() is false.
+        exact_costs[k] =
+            (i == j) ? 0
+                     : GetExactVertexAlignmentCost(*polylines[std::min(i, j)],
+                                                   *polylines[std::max(i, j)]);
+      });
+  int best = -1;
+  double best_cost = 0;
+  for (int c = 0; c < num_candidates; ++c) {
+    double cost = 0;
+    for (int j = 0; j < num_polylines; ++j) {
+      if (j != candidates[c]) cost += exact_costs[c * num_polylines + j];
+    }
+    if (best < 0 || cost < best_cost) {
+      best = candidates[c];
+      best_cost = cost;
     }
   }
-  return std::min_element(costs.begin(), costs.end()) - costs.begin();
+  return best;
 }
 
 // Implements Iterative Dynamic Timewarp Barycenter Averaging algorithm from
@@ -399,20 +513,28 @@ unique_ptr<S2Polyline> GetConsensusPolyline(
   if (options.seed_medoid()) {
     MedoidOptions medoid_options;
     medoid_options.set_approx(approx);
+    medoid_options.set_num_threads(options.num_threads());
     seed_index = GetMedoidPolyline(polylines, medoid_options);
   }
   auto consensus = unique_ptr<S2Polyline>(polylines[seed_index]->Clone());
   const int num_consensus_vertices = consensus->num_vertices();
   ABSL_DCHECK_GT(num_consensus_vertices, 1);
 
+  // The alignments of each iteration are computed in parallel, and then the
+  // aligned vertices are summed in order so that the result does not depend
+  // on the number of threads.
+  vector<WarpPath> warp_paths(num_polylines);
   bool converged = false;
   int iterations = 0;
   while (!converged && iterations < options.iteration_cap()) {
+    s2internal::ParallelFor(options.num_threads(), num_polylines, [&](int i) {
+      warp_paths[i] =
+          std::move(AlignmentFn(*consensus, *polylines[i], approx).warp_path);
+    });
     vector<S2Point> points(num_consensus_vertices, S2Point());
-    for (const auto& polyline : polylines) {
-      const auto alignment = AlignmentFn(*consensus, *polyline, approx);
-      for (const auto& pair : alignment.warp_path) {
-        points[pair.first] += polyline->vertex(pair.second);
+    for (int i = 0; i < num_polylines; ++i) {
+      for (const auto& pair : warp_paths[i]) {
+        points[pair.first] += polylines[i]->vertex(pair.second);
       }
     }
     for (S2Point& p : points) {
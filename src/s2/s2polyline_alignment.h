@@ -170,7 +170,9 @@ VertexAlignment GetApproxVertexAlignment(const S2Polyline& a,
 // Computation may require up to (N^2 - N) / 2 alignment cost function
 // evaluations, for N input polylines. For polylines of length U, V, the
 // alignment cost function evaluation is O(U+V) if options.approx = true and
-// O(U*V) if options.approx = false.
+// O(U*V) if options.approx = false. Refining the result (see
+// num_exact_candidates below) requires up to K*N additional exact alignment
+// cost evaluations for K candidates.
 
 class MedoidOptions {
  public:
@@ -180,8 +182,27 @@ class MedoidOptions {
   bool approx() const { return approx_; }
   void set_approx(bool approx) { approx_ = approx; }
 
+  // If options.approx = true and options.num_exact_candidates = K > 1, the
+  // approximate costs are only used to select the K polylines with least
+  // summed approximate cost. The summed cost of each of these candidates is
+  // then recomputed exactly, and the candidate with the least exact cost is
+  // returned. This is much faster than options.approx = false when K is
+  // small compared to the number of polylines, while avoiding most of the
+  // errors due to approximate alignment.
+  int num_exact_candidates() const { return num_exact_candidates_; }
+  void set_num_exact_candidates(int num_exact_candidates) {
+    num_exact_candidates_ = num_exact_candidates;
+  }
+
+  // The number of threads used to compute alignment costs. The result does
+  // not depend on the number of threads.
+  int num_threads() const { return num_threads_; }
+  void set_num_threads(int num_threads) { num_threads_ = num_threads; }
+
  private:
   bool approx_ = true;
+  int num_exact_candidates_ = 0;
+  int num_threads_ = 1;
 };
 
 int GetMedoidPolyline(absl::Span<const std::unique_ptr<S2Polyline>> polylines,
@@ -234,10 +255,17 @@ class ConsensusOptions {
   int iteration_cap() const { return iteration_cap_; }
   void set_iteration_cap(int iteration_cap) { iteration_cap_ = iteration_cap; }
 
+  // The number of threads used to compute the vertex alignments of each
+  // iteration (and the medoid, if options.seed_medoid = true). The result
+  // does not depend on the number of threads.
+  int num_threads() const { return num_threads_; }
+  void set_num_threads(int num_threads) { num_threads_ = num_threads; }
+
  private:
   bool approx_ = true;
   bool seed_medoid_ = false;
   int iteration_cap_ = 5;
+  int num_threads_ = 1;
 };
 
 std::unique_ptr<S2Polyline> GetConsensusPolyline(
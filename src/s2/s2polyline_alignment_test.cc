@@ -495,6 +495,25 @@ TEST(S2PolylineAlignmentTest, FuzzedWithBruteForce) {
   }
 }
 
+// GetExactVertexAlignmentCost evaluates the DP table along anti-diagonals,
+// so check that it matches the table computed by GetExactVertexAlignment
+// exactly for a variety of table shapes.
+TEST(S2PolylineAlignmentTest, ExactCostMatchesExactAlignment) {
+  absl::BitGen bitgen(S2Testing::MakeTaggedSeedSeq(
+      "EXACT_COST_MATCHES_EXACT_ALIGNMENT",
+      absl::LogInfoStreamer(__FILE__, __LINE__).stream()));
+  for (int a_n : {1, 2, 3, 17, 64}) {
+    for (int b_n : {1, 2, 5, 64, 100}) {
+      const auto a = GenPolylines(bitgen, 1, a_n, 0.5);
+      const auto b = GenPolylines(bitgen, 1, b_n, 0.5);
+      const double expected =
+          GetExactVertexAlignment(*a[0], *b[0]).alignment_cost;
+      EXPECT_EQ(GetExactVertexAlignmentCost(*a[0], *b[0]), expected);
+      EXPECT_EQ(GetExactVertexAlignmentCost(*b[0], *a[0]), expected);
+    }
+  }
+}
+
 // TESTS FOR TRAJECTORY CONSENSUS ALGORITHMS
 
 // Tests for GetMedoidPolyline
@@ -610,6 +629,54 @@ TEST(S2PolylineAlignmentTest, MedoidPolylineFewLargePolylines) {
   EXPECT_EQ(approx_medoid, approx_medoid_index);
 }
 
+TEST(S2PolylineAlignmentTest, MedoidPolylineMultithreaded) {
+  absl::BitGen bitgen(S2Testing::MakeTaggedSeedSeq(
+      "MEDOID_POLYLINE_MULTITHREADED",
+      absl::LogInfoStreamer(__FILE__, __LINE__).stream()));
+  const auto polylines = GenPolylines(bitgen, 20, 64, 0.9);
+  for (bool approx : {false, true}) {
+    MedoidOptions options;
+    options.set_approx(approx);
+    const int expected = GetMedoidPolyline(polylines, options);
+    options.set_num_threads(4);
+    EXPECT_EQ(GetMedoidPolyline(polylines, options), expected);
+  }
+}
+
+TEST(S2PolylineAlignmentTest, MedoidPolylineExactCandidates) {
+  absl::BitGen bitgen(S2Testing::MakeTaggedSeedSeq(
+      "MEDOID_POLYLINE_EXACT_CANDIDATES",
+      absl::LogInfoStreamer(__FILE__, __LINE__).stream()));
+  const int num_polylines = 10;
+  const auto polylines = GenPolylines(bitgen, num_polylines, 256, 0.9);
+  MedoidOptions options;
+  options.set_approx(false);
+  const int exact_medoid = GetMedoidPolyline(polylines, options);
+  options.set_approx(true);
+  const int approx_medoid = GetMedoidPolyline(polylines, options);
+
+  // A single candidate is the approximate medoid, and refining every
+  // polyline yields the exact medoid.
+  options.set_num_exact_candidates(1);
+  EXPECT_EQ(GetMedoidPolyline(polylines, options), approx_medoid);
+  options.set_num_exact_candidates(num_polylines);
+  EXPECT_EQ(GetMedoidPolyline(polylines, options), exact_medoid);
+  options.set_num_threads(4);
+  EXPECT_EQ(GetMedoidPolyline(polylines, options), exact_medoid);
+
+  // Otherwise the result is at least as good as the approximate medoid.
+  auto exact_cost = [&polylines](int i) {
+    double cost = 0;
+    for (const auto& polyline : polylines) {
+      cost += GetExactVertexAlignmentCost(*polylines[i], *polyline);
+    }
+    return cost;
+  };
+  options.set_num_exact_candidates(3);
+  EXPECT_LE(exact_cost(GetMedoidPolyline(polylines, options)),
+            exact_cost(approx_medoid));
+}
+
 // Tests for GetConsensusPolyline
 #if GTEST_HAS_DEATH_TEST
 TEST(S2PolylineAlignmentDeathTest, ConsensusPolylineNoPolylines) {
@@ -651,4 +718,19 @@ TEST(S2PolylineAlignmentTest, ConsensusPolylineOverlappingPolylines) {
   EXPECT_TRUE(result->ApproxEquals(*expected));
 }
 
+TEST(S2PolylineAlignmentTest, ConsensusPolylineMultithreaded) {
+  absl::BitGen bitgen(S2Testing::MakeTaggedSeedSeq(
+      "CONSENSUS_POLYLINE_MULTITHREADED",
+      absl::LogInfoStreamer(__FILE__, __LINE__).stream()));
+  const auto polylines = GenPolylines(bitgen, 20, 64, 0.9);
+  for (bool approx : {false, true}) {
+    ConsensusOptions options;
+    options.set_approx(approx);
+    options.set_seed_medoid(true);
+    const auto expected = GetConsensusPolyline(polylines, options);
+    options.set_num_threads(4);
+    EXPECT_TRUE(GetConsensusPolyline(polylines, options)->Equals(*expected));
+  }
+}
+
 }  // namespace s2polyline_alignment
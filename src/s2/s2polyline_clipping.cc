@@ -0,0 +1,130 @@
+// Copyright 2024 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#include "s2/s2polyline_clipping.h"
+
+#include <algorithm>
+#include <vector>
+
+#include "s2/r2.h"
+#include "s2/r2rect.h"
+#include "s2/s2cell_id.h"
+#include "s2/s2cell_union.h"
+#include "s2/s2coords.h"
+#include "s2/s2edge_clipping.h"
+#include "s2/s2padded_cell.h"
+#include "s2/s2point.h"
+#include "s2/s2point_span.h"
+
+using std::vector;
+
+namespace S2 {
+
+namespace {
+
+// The portion of a face segment contained by one cell of the cell union.
+struct ClippedSegment {
+  S2CellId id;
+  R2Point a, b;
+};
+
+// Returns the cell of "cells" that contains "id".
+//
+// REQUIRES: cells.Contains(id)
+S2CellId GetContainingCell(const S2CellUnion& cells, S2CellId id) {
+  auto it = std::lower_bound(cells.begin(), cells.end(), id);
+  if (it != cells.end() && it->range_min() <= id) return *it;
+  return *--it;
+}
+
+// Appends the portions of "segment" contained by cells of "cells" that are
+// descendants of "pcell" to "clipped".
+//
+// REQUIRES: cells.Intersects(pcell.id())
+void ClipSegment(const FaceSegment& segment, const S2CellUnion& cells,
+                 const S2PaddedCell& pcell, vector<ClippedSegment>* clipped) {
+  R2Point a, b;
+  if (!ClipEdge(segment.a, segment.b, pcell.bound(), &a, &b)) return;
+  if (cells.Contains(pcell.id())) {
+    if (a != b) {
+      clipped->push_back({GetContainingCell(cells, pcell.id()), a, b});
+    }
+    return;
+  }
+  for (int i = 0; i < 2; ++i) {
+    for (int j = 0; j < 2; ++j) {
+      S2PaddedCell child(pcell, i, j);
+      if (cells.Intersects(child.id())) {
+        ClipSegment(segment, cells, child, clipped);
+      }
+    }
+  }
+}
+
+}  // namespace
+
+void ClipPolylineToCellUnion(S2PointSpan polyline, const S2CellUnion& cells,
+                             vector<CellClippedPolyline>* output) {
+  const size_t first_output = output->size();
+  FaceSegmentVector segments;
+  vector<ClippedSegment> clipped;
+  for (int e = 0; e + 1 < static_cast<int>(polyline.size()); ++e) {
+    const S2Point& v0 = polyline[e];
+    const S2Point& v1 = polyline[e + 1];
+    if (v0 == v1) continue;
+    GetFaceSegments(v0, v1, &segments);
+    for (int s = 0; s < segments.size(); ++s) {
+      const FaceSegment& segment = segments[s];
+      // Start from the smallest cell containing the segment, which often
+      // shows that the segment is disjoint from the cell union without any
+      // clipping.
+      const S2CellId root =
+          S2PaddedCell(S2CellId::FromFace(segment.face), 0)
+              .ShrinkToFit(R2Rect::FromPointPair(segment.a, segment.b));
+      if (!cells.Intersects(root)) continue;
+      clipped.clear();
+      ClipSegment(segment, cells, S2PaddedCell(root, 0), &clipped);
+
+      // A segment intersects each cell in at most one interval, so sorting
+      // the pieces by their distance from the start of the segment yields
+      // them in order along the polyline.
+      std::sort(clipped.begin(), clipped.end(),
+                [&segment](const ClippedSegment& x, const ClippedSegment& y) {
+                  return (x.a - segment.a).Norm2() < (y.a - segment.a).Norm2();
+                });
+
+      // The original vertices are used wherever possible so that polylines
+      // inside a single cell are returned exactly.
+      auto to_point = [&](const R2Point& uv) {
+        if (s == 0 && uv == segment.a) return v0;
+        if (s + 1 == segments.size() && uv == segment.b) return v1;
+        return FaceUVtoXYZ(segment.face, uv).Normalize();
+      };
+      for (const ClippedSegment& piece : clipped) {
+        S2Point a = to_point(piece.a), b = to_point(piece.b);
+        if (a == b) continue;
+        if (output->size() > first_output && output->back().id == piece.id &&
+            output->back().vertices.back() == a) {
+          output->back().vertices.push_back(b);
+        } else {
+          output->push_back({piece.id, {a, b}});
+        }
+      }
+    }
+  }
+}
+
+}  // namespace S2
@@ -0,0 +1,63 @@
+// Copyright 2024 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#ifndef S2_S2POLYLINE_CLIPPING_H_
+#define S2_S2POLYLINE_CLIPPING_H_
+
+#include <vector>
+
+#include "s2/s2cell_id.h"
+#include "s2/s2cell_union.h"
+#include "s2/s2point.h"
+#include "s2/s2point_span.h"
+
+// Defines functions for clipping polylines directly to S2Cells, without
+// converting the cells to polygons and using S2BooleanOperation.  This is
+// much faster for applications such as generating vector tiles, where each
+// polyline is clipped to a small number of cells.
+
+namespace S2 {
+
+// A portion of a polyline that is contained by a single cell.
+struct CellClippedPolyline {
+  S2CellId id;
+  std::vector<S2Point> vertices;
+};
+
+// Clips the given polyline to the cells of "cells" and appends the resulting
+// pieces to "output" in the order they are encountered along the polyline.
+// Each piece is labeled with the cell of "cells" that contains it, and
+// consists of a maximal sequence of consecutive edges within that cell.
+// Each edge is split wherever it crosses a cell boundary, so a polyline
+// passing through several adjacent cells yields one piece per cell.
+//
+// Cells are treated as closed, so an edge that runs exactly along the
+// boundary between two cells may appear in both, whereas pieces that only
+// touch a cell at a single point and degenerate edges are discarded.
+// Polyline vertices inside a cell are returned exactly; new vertices where
+// an edge crosses a cell boundary are within about kFaceClipErrorRadians
+// (plus kEdgeClipErrorUVDist in (u,v)-space) of the exact crossing point.
+// No snapping is performed, so the pieces may contain vertices that are
+// arbitrarily close together.
+//
+// "cells" does not need to be normalized, but it must be valid (i.e., the
+// cells must not overlap).
+void ClipPolylineToCellUnion(S2PointSpan polyline, const S2CellUnion& cells,
+                             std::vector<CellClippedPolyline>* output);
+
+}  // namespace S2
+
+#endif  // S2_S2POLYLINE_CLIPPING_H_
@@ -0,0 +1,140 @@
+// Copyright 2024 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#include "s2/s2polyline_clipping.h"
+
+#include <memory>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include "absl/log/log_streamer.h"
+#include "absl/random/random.h"
+#include "s2/s1angle.h"
+#include "s2/s2cap.h"
+#include "s2/s2cell.h"
+#include "s2/s2cell_id.h"
+#include "s2/s2cell_union.h"
+#include "s2/s2latlng.h"
+#include "s2/s2point.h"
+#include "s2/s2polygon.h"
+#include "s2/s2polyline.h"
+#include "s2/s2random.h"
+#include "s2/s2testing.h"
+#include "s2/s2text_format.h"
+
+using std::unique_ptr;
+using std::vector;
+
+namespace {
+
+// Returns the total length of the given pieces.
+S1Angle GetLength(const vector<S2::CellClippedPolyline>& pieces) {
+  S1Angle length;
+  for (const auto& piece : pieces) {
+    length += S2Polyline(piece.vertices).GetLength();
+  }
+  return length;
+}
+
+TEST(ClipPolylineToCellUnion, Empty) {
+  const S2CellUnion cells({S2CellId::FromFace(0)});
+  vector<S2::CellClippedPolyline> output;
+  S2::ClipPolylineToCellUnion({}, cells, &output);
+  S2::ClipPolylineToCellUnion(s2textformat::ParsePointsOrDie("1:1"), cells,
+                              &output);
+  S2::ClipPolylineToCellUnion(s2textformat::ParsePointsOrDie("1:1, 1:1"),
+                              cells, &output);
+  S2::ClipPolylineToCellUnion(s2textformat::ParsePointsOrDie("1:1, 2:2"),
+                              S2CellUnion(), &output);
+  EXPECT_TRUE(output.empty());
+}
+
+TEST(ClipPolylineToCellUnion, InsideOneCell) {
+  // A polyline inside a single cell is returned exactly.
+  const vector<S2Point> vertices =
+      s2textformat::ParsePointsOrDie("1:1, 2:1, 2:2, 1.5:3");
+  const S2CellUnion cells({S2CellId::FromFace(0), S2CellId::FromFace(1)});
+  vector<S2::CellClippedPolyline> output;
+  S2::ClipPolylineToCellUnion(vertices, cells, &output);
+  ASSERT_EQ(1, output.size());
+  EXPECT_EQ(S2CellId::FromFace(0), output[0].id);
+  EXPECT_EQ(vertices, output[0].vertices);
+}
+
+TEST(ClipPolylineToCellUnion, SplitAtCellBoundaries) {
+  // A polyline that enters the union and then passes through two adjacent
+  // cells of the union.
+  const S2CellId id = S2CellId(S2LatLng::FromDegrees(10, 10)).parent(6);
+  const S2CellId next = id.next();
+  const S2CellUnion cells({id, next});
+  const S2Point a = S2Cell(id).GetCenter();
+  const S2Point b = S2Cell(next).GetCenter();
+  const S2Point far = (2 * a - b).Normalize();  // Beyond "a" from "b".
+  vector<S2::CellClippedPolyline> output;
+  S2::ClipPolylineToCellUnion(vector<S2Point>{far, a, b}, cells,
+                              &output);
+  ASSERT_EQ(2, output.size());
+  EXPECT_EQ(id, output[0].id);
+  ASSERT_EQ(3, output[0].vertices.size());
+  EXPECT_EQ(a, output[0].vertices[1]);
+  EXPECT_EQ(next, output[1].id);
+  ASSERT_EQ(2, output[1].vertices.size());
+  EXPECT_EQ(output[0].vertices[2], output[1].vertices[0]);
+  EXPECT_EQ(b, output[1].vertices[1]);
+  for (const auto& piece : output) {
+    const S2Cell cell(piece.id);
+    for (const S2Point& p : piece.vertices) {
+      EXPECT_LE(cell.GetDistance(p).radians(), 1e-15);
+    }
+  }
+}
+
+TEST(ClipPolylineToCellUnion, MatchesIntersectWithPolyline) {
+  absl::BitGen bitgen(S2Testing::MakeTaggedSeedSeq(
+      "CLIP_POLYLINE_TO_CELL_UNION",
+      absl::LogInfoStreamer(__FILE__, __LINE__).stream()));
+  for (int iter = 0; iter < 50; ++iter) {
+    // A cell union whose cells are of different sizes.
+    const S2Cap cap = s2random::Cap(bitgen, 1e-4, 1e-2);
+    vector<S2CellId> ids;
+    for (int i = 0; i < 10; ++i) {
+      ids.push_back(S2CellId(s2random::SamplePoint(bitgen, cap))
+                        .parent(absl::Uniform(bitgen, 5, 12)));
+    }
+    const S2CellUnion cells(std::move(ids));
+    S2Polygon polygon;
+    polygon.InitToCellUnionBorder(cells);
+
+    vector<S2Point> vertices;
+    for (int i = 0; i < 10; ++i) {
+      vertices.push_back(s2random::SamplePoint(bitgen, cap));
+    }
+    vector<S2::CellClippedPolyline> output;
+    S2::ClipPolylineToCellUnion(vertices, cells, &output);
+    for (const auto& piece : output) {
+      EXPECT_TRUE(cells.Contains(piece.id));
+      EXPECT_GE(piece.vertices.size(), 2);
+    }
+    S1Angle expected;
+    for (const auto& polyline :
+         polygon.IntersectWithPolyline(S2Polyline(vertices))) {
+      expected += polyline->GetLength();
+    }
+    EXPECT_NEAR(expected.radians(), GetLength(output).radians(), 1e-13);
+  }
+}
+
+}  // namespace
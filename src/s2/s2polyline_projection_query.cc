@@ -0,0 +1,143 @@
+// Copyright 2024 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "s2/s2polyline_projection_query.h"
+
+#include <algorithm>
+#include <memory>
+
+#include "absl/log/absl_check.h"
+#include "s2/s1angle.h"
+#include "s2/s1chord_angle.h"
+#include "s2/s2closest_edge_query.h"
+#include "s2/s2edge_distances.h"
+#include "s2/s2point.h"
+#include "s2/s2polyline.h"
+
+using std::make_unique;
+using std::min;
+
+S2PolylineProjectionQuery::S2PolylineProjectionQuery(
+    const S2Polyline* polyline) {
+  Init(polyline);
+}
+
+void S2PolylineProjectionQuery::Init(const S2Polyline* polyline) {
+  ABSL_DCHECK_GT(polyline->num_vertices(), 0);
+  polyline_ = polyline;
+
+  // The lengths are accumulated in the same order as S2Polyline does, so
+  // that UnInterpolate() returns identical results.
+  const int n = polyline->num_vertices();
+  cumulative_lengths_.resize(n);
+  cumulative_lengths_[0] = S1Angle::Zero();
+  for (int i = 1; i < n; ++i) {
+    cumulative_lengths_[i] =
+        cumulative_lengths_[i - 1] +
+        S1Angle(polyline->vertex(i - 1), polyline->vertex(i));
+  }
+
+  // MutableS2ShapeIndex is built lazily, so Init() is cheap for queries that
+  // never call Project().
+  index_.Clear();
+  if (n >= 2) index_.Add(make_unique<S2Polyline::Shape>(polyline));
+  query_.Init(&index_);
+}
+
+S2Point S2PolylineProjectionQuery::Interpolate(double fraction) const {
+  int next_vertex;
+  return GetSuffix(fraction, &next_vertex);
+}
+
+S2Point S2PolylineProjectionQuery::GetSuffix(double fraction,
+                                             int* next_vertex) const {
+  const S2Polyline& polyline = *polyline_;
+  if (fraction <= 0) {
+    *next_vertex = 1;
+    return polyline.vertex(0);
+  }
+  // Find the first vertex "i" whose cumulative length exceeds the target.
+  // Like S2Polyline::GetSuffix(), this skips over degenerate edges.
+  S1Angle target = fraction * GetLength();
+  auto it = std::upper_bound(cumulative_lengths_.begin(),
+                             cumulative_lengths_.end(), target);
+  if (it == cumulative_lengths_.end()) {
+    *next_vertex = polyline.num_vertices();
+    return polyline.vertex(polyline.num_vertices() - 1);
+  }
+  const int i = it - cumulative_lengths_.begin();
+  S2Point result = S2::GetPointOnLine(polyline.vertex(i - 1),
+                                      polyline.vertex(i),
+                                      target - cumulative_lengths_[i - 1]);
+  // It is possible that (result == vertex(i)) due to rounding errors.
+  *next_vertex = (result == polyline.vertex(i)) ? (i + 1) : i;
+  return result;
+}
+
+double S2PolylineProjectionQuery::UnInterpolate(const S2Point& point,
+                                                int next_vertex) const {
+  if (polyline_->num_vertices() < 2) return 0;
+  S1Angle length_to_point = cumulative_lengths_[next_vertex - 1] +
+                            S1Angle(polyline_->vertex(next_vertex - 1), point);
+  // The ratio can be greater than 1.0 due to rounding errors or because the
+  // point is not exactly on the polyline.
+  return min(1.0, length_to_point / GetLength());
+}
+
+S2Point S2PolylineProjectionQuery::Project(const S2Point& point,
+                                           int* next_vertex) {
+  return Project(point, 1, next_vertex);
+}
+
+S2Point S2PolylineProjectionQuery::Project(const S2Point& point, int hint,
+                                           int* next_vertex) {
+  const S2Polyline& polyline = *polyline_;
+  ABSL_DCHECK_GE(hint, 1);
+  ABSL_DCHECK_LE(hint, polyline.num_vertices());
+  if (polyline.num_vertices() == 1) {
+    // If there is only one vertex, it is always closest to any given point.
+    *next_vertex = 1;
+    return polyline.vertex(0);
+  }
+  // The edge ending at vertex "hint" (or the last edge) bounds the search.
+  int edge_id = min(hint, polyline.num_vertices() - 1) - 1;
+  S1ChordAngle max_distance(S2::GetDistance(point, polyline.vertex(edge_id),
+                                            polyline.vertex(edge_id + 1)));
+  // The bound is expanded slightly since the index may measure distances
+  // differently.
+  int closest_edge = FindClosestEdge(
+      point,
+      max_distance.PlusError(S2::GetUpdateMinDistanceMaxError(max_distance)));
+  if (closest_edge >= 0) edge_id = closest_edge;
+  return ProjectToEdge(point, edge_id, next_vertex);
+}
+
+S2Point S2PolylineProjectionQuery::ProjectToEdge(const S2Point& point,
+                                                 int edge_id,
+                                                 int* next_vertex) const {
+  const S2Point& a = polyline_->vertex(edge_id);
+  const S2Point& b = polyline_->vertex(edge_id + 1);
+  S2Point closest_point = S2::Project(point, a, b);
+  *next_vertex = edge_id + 1 + (closest_point == b ? 1 : 0);
+  return closest_point;
+}
+
+int S2PolylineProjectionQuery::FindClosestEdge(const S2Point& point,
+                                               S1ChordAngle max_distance) {
+  query_.mutable_options()->set_inclusive_max_distance(max_distance);
+  S2ClosestEdgeQuery::PointTarget target(point);
+  S2ClosestEdgeQuery::Result result = query_.FindClosestEdge(&target);
+  return result.is_empty() ? -1 : result.edge_id();
+}
@@ -0,0 +1,120 @@
+// Copyright 2024 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef S2_S2POLYLINE_PROJECTION_QUERY_H_
+#define S2_S2POLYLINE_PROJECTION_QUERY_H_
+
+#include <vector>
+
+#include "s2/mutable_s2shape_index.h"
+#include "s2/s1angle.h"
+#include "s2/s2closest_edge_query.h"
+#include "s2/s2point.h"
+#include "s2/s2polyline.h"
+
+// S2PolylineProjectionQuery is a faster alternative to the S2Polyline methods
+// Interpolate(), GetSuffix(), UnInterpolate(), and Project() for polylines
+// that are queried many times (e.g., when matching a long sequence of GPS
+// points to a road network).  The S2Polyline methods take time linear in the
+// number of vertices.  This class precomputes the cumulative length at each
+// vertex, so that GetSuffix() takes O(log n) time and UnInterpolate() takes
+// constant time, and builds an S2ShapeIndex over the edges so that Project()
+// only examines the edges near the given point.
+//
+// The results have the same meaning as those of the corresponding S2Polyline
+// methods.  UnInterpolate() returns exactly the same value; GetSuffix() may
+// differ by a small rounding error since it measures the distance from the
+// nearest vertex rather than by repeated subtraction; and Project() may
+// choose a different edge when two edges are equally close.
+//
+// Example usage:
+//
+//   S2PolylineProjectionQuery query(&polyline);
+//   int next_vertex = 1;
+//   for (const S2Point& point : trace) {
+//     S2Point projected = query.Project(point, next_vertex, &next_vertex);
+//     double fraction = query.UnInterpolate(projected, next_vertex);
+//     ...
+//   }
+//
+// The polyline must remain unchanged (and alive) while the query is in use.
+// This class is not thread-safe.  To query the same polyline from several
+// threads, give each thread its own S2PolylineProjectionQuery.
+class S2PolylineProjectionQuery {
+ public:
+  // Default constructor; requires Init() to be called.
+  S2PolylineProjectionQuery() = default;
+
+  // Convenience constructor that calls Init().
+  explicit S2PolylineProjectionQuery(const S2Polyline* polyline);
+
+  // Initializes the query.  This takes time linear in the number of vertices
+  // of the polyline.  The edge index is built on the first call to Project().
+  //
+  // REQUIRES: polyline->num_vertices() > 0
+  void Init(const S2Polyline* polyline);
+
+  const S2Polyline& polyline() const { return *polyline_; }
+
+  // Returns the length of the polyline.
+  S1Angle GetLength() const { return cumulative_lengths_.back(); }
+
+  // Returns the length of the polyline from vertex 0 to vertex "i".
+  //
+  // REQUIRES: 0 <= i < polyline().num_vertices()
+  S1Angle GetLengthAtVertex(int i) const { return cumulative_lengths_[i]; }
+
+  // Equivalent to S2Polyline::Interpolate(), but takes O(log n) time.
+  S2Point Interpolate(double fraction) const;
+
+  // Equivalent to S2Polyline::GetSuffix(), but takes O(log n) time.
+  S2Point GetSuffix(double fraction, int* next_vertex) const;
+
+  // Equivalent to S2Polyline::UnInterpolate(), but takes constant time.
+  double UnInterpolate(const S2Point& point, int next_vertex) const;
+
+  // Equivalent to S2Polyline::Project(), but only examines the edges near
+  // "point".
+  S2Point Project(const S2Point& point, int* next_vertex);
+
+  // Like Project(), but uses a "next_vertex" value returned by a previous
+  // call (e.g., for the previous point of a GPS trace) as a hint.  The
+  // distance to the corresponding edge bounds the search, which makes it
+  // very fast when the hint is close to the answer.  The result is the same
+  // as Project() whatever the hint is.
+  //
+  // REQUIRES: 1 <= hint <= polyline().num_vertices()
+  S2Point Project(const S2Point& point, int hint, int* next_vertex);
+
+ private:
+  // Returns the closest point to "point" on edge "edge_id" and sets
+  // "next_vertex" as described for S2Polyline::Project().
+  S2Point ProjectToEdge(const S2Point& point, int edge_id,
+                        int* next_vertex) const;
+
+  // Finds the closest edge to "point" among those within "max_distance"
+  // (inclusive).  Returns -1 if there are none.
+  int FindClosestEdge(const S2Point& point, S1ChordAngle max_distance);
+
+  const S2Polyline* polyline_ = nullptr;
+
+  // cumulative_lengths_[i] is the length of the polyline up to vertex i.
+  std::vector<S1Angle> cumulative_lengths_;
+
+  MutableS2ShapeIndex index_;
+  S2ClosestEdgeQuery query_;
+};
+
+#endif  // S2_S2POLYLINE_PROJECTION_QUERY_H_
@@ -0,0 +1,113 @@
+// Copyright 2024 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "s2/s2polyline_projection_query.h"
+
+#include <memory>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include "absl/log/log_streamer.h"
+#include "absl/random/random.h"
+#include "s2/s1angle.h"
+#include "s2/s2debug.h"
+#include "s2/s2edge_distances.h"
+#include "s2/s2point.h"
+#include "s2/s2pointutil.h"
+#include "s2/s2polyline.h"
+#include "s2/s2random.h"
+#include "s2/s2testing.h"
+#include "s2/s2text_format.h"
+
+using s2textformat::MakePolylineOrDie;
+using std::unique_ptr;
+using std::vector;
+
+namespace {
+
+constexpr S1Angle kMaxError = S1Angle::Radians(1e-14);
+
+TEST(S2PolylineProjectionQuery, SingleVertex) {
+  unique_ptr<S2Polyline> polyline = MakePolylineOrDie("1:1");
+  S2PolylineProjectionQuery query(polyline.get());
+  int next_vertex;
+  EXPECT_EQ(query.GetLength(), S1Angle::Zero());
+  EXPECT_EQ(query.GetSuffix(0.5, &next_vertex), polyline->vertex(0));
+  EXPECT_EQ(next_vertex, 1);
+  EXPECT_EQ(query.UnInterpolate(polyline->vertex(0), 1), 0);
+  EXPECT_EQ(query.Project(S2Point(1, 0, 0), &next_vertex),
+            polyline->vertex(0));
+  EXPECT_EQ(next_vertex, 1);
+}
+
+TEST(S2PolylineProjectionQuery, DegenerateEdges) {
+  unique_ptr<S2Polyline> polyline =
+      MakePolylineOrDie("0:0, 0:0, 0:1, 0:1, 0:1, 0:2", S2Debug::DISABLE);
+  S2PolylineProjectionQuery query(polyline.get());
+  EXPECT_EQ(query.GetLengthAtVertex(4), S1Angle::Degrees(1));
+  for (double fraction : {0.0, 0.25, 0.5, 0.75, 1.0}) {
+    int expected_next, actual_next;
+    S2Point expected = polyline->GetSuffix(fraction, &expected_next);
+    S2Point actual = query.GetSuffix(fraction, &actual_next);
+    EXPECT_TRUE(S2::ApproxEquals(expected, actual, kMaxError)) << fraction;
+    EXPECT_EQ(expected_next, actual_next) << fraction;
+  }
+}
+
+TEST(S2PolylineProjectionQuery, MatchesS2Polyline) {
+  absl::BitGen bitgen(S2Testing::MakeTaggedSeedSeq(
+      "MATCHES_S2POLYLINE",
+      absl::LogInfoStreamer(__FILE__, __LINE__).stream()));
+  for (int iter = 0; iter < 20; ++iter) {
+    // A random walk that occasionally doubles back on itself.
+    vector<S2Point> vertices = {s2random::Point(bitgen)};
+    S2Point target = s2random::Point(bitgen);
+    for (int i = 1; i < 500; ++i) {
+      if (absl::Bernoulli(bitgen, 0.05)) target = s2random::Point(bitgen);
+      vertices.push_back(S2::GetPointOnLine(vertices.back(), target,
+                                            S1Angle::Degrees(0.01)));
+    }
+    S2Polyline polyline(vertices);
+    S2PolylineProjectionQuery query(&polyline);
+    EXPECT_NEAR(query.GetLength().radians(),
+                polyline.GetLength().radians(), 1e-14);
+    int hint = 1;
+    for (int i = 0; i < 100; ++i) {
+      double fraction = absl::Uniform(bitgen, -0.1, 1.1);
+      int expected_next, actual_next;
+      S2Point expected = polyline.GetSuffix(fraction, &expected_next);
+      S2Point actual = query.GetSuffix(fraction, &actual_next);
+      EXPECT_TRUE(S2::ApproxEquals(expected, actual, kMaxError));
+      EXPECT_EQ(polyline.UnInterpolate(actual, actual_next),
+                query.UnInterpolate(actual, actual_next));
+
+      // Project a point near the polyline, using the previous result as the
+      // hint.  Both results must be equally close to the point.
+      S2Point point = S2::GetPointOnLine(
+          actual, s2random::Point(bitgen),
+          S1Angle::Degrees(absl::Uniform(bitgen, 0.0, 0.05)));
+      S2Point expected_projection = polyline.Project(point, &expected_next);
+      S2Point projection = query.Project(point, hint, &actual_next);
+      EXPECT_NEAR(S1Angle(point, projection).radians(),
+                  S1Angle(point, expected_projection).radians(), 1e-15);
+      ASSERT_GE(actual_next, 1);
+      ASSERT_LE(actual_next, polyline.num_vertices());
+      EXPECT_EQ(query.Project(point, &hint), projection);
+      EXPECT_EQ(hint, actual_next);
+    }
+  }
+}
+
+}  // namespace
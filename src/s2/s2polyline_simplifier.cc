@@ -22,6 +22,8 @@
 #include <vector>
 
 #include "absl/log/absl_check.h"
+#include "absl/types/span.h"
+#include "s2/internal/s2parallel.h"
 #include "s2/s1chord_angle.h"
 #include "s2/s1interval.h"
 #include "s2/s2point.h"
@@ -58,6 +60,48 @@ void S2PolylineSimplifier::Init(const S2Point& src) {
   x_dir_[k] = -src[k] * src[i];
 }
 
+void S2PolylineSimplifier::SimplifyChain(absl::Span<const S2Point> vertices,
+                                         S1ChordAngle tolerance,
+                                         std::vector<int>* indices) {
+  indices->clear();
+  const int n = vertices.size();
+  if (n == 0) return;
+  indices->push_back(0);
+  Init(vertices[0]);
+  int start = 0;
+  S1ChordAngle last_distance = S1ChordAngle::Zero();
+  for (int i = 1; i < n; ++i) {
+    S1ChordAngle distance(src_, vertices[i]);
+    // The first edge from each source vertex is always accepted, even if it
+    // is longer than 90 degrees.  Otherwise vertices must be increasingly
+    // distant from the source (except within the initial disc) and the
+    // edge must satisfy all targeting constraints so far.
+    if (i > start + 1 &&
+        ((distance < last_distance && last_distance > tolerance) ||
+         !Extend(vertices[i]))) {
+      start = i - 1;
+      if (vertices[start] != src_) indices->push_back(start);
+      Init(vertices[start]);
+      distance = S1ChordAngle(src_, vertices[i]);
+    }
+    last_distance = distance;
+    TargetDisc(vertices[i], tolerance);
+  }
+  if (vertices.back() != vertices[indices->back()]) {
+    indices->push_back(n - 1);
+  }
+}
+
+void S2PolylineSimplifier::SimplifyChains(
+    absl::Span<const absl::Span<const S2Point>> chains, S1ChordAngle tolerance,
+    int num_threads, std::vector<std::vector<int>>* indices) {
+  indices->resize(chains.size());
+  s2internal::ParallelFor(num_threads, chains.size(), [&](int i) {
+    S2PolylineSimplifier simplifier;
+    simplifier.SimplifyChain(chains[i], tolerance, &(*indices)[i]);
+  });
+}
+
 bool S2PolylineSimplifier::Extend(const S2Point& dst) const {
   // We limit the maximum edge length to 90 degrees in order to simplify the
   // error bounds.  (The error gets arbitrarily large as the edge length
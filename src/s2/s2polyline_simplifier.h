@@ -59,6 +59,7 @@
 
 #include <vector>
 
+#include "absl/types/span.h"
 #include "s2/_fp_contract_off.h"  // IWYU pragma: keep
 #include "s2/s1chord_angle.h"
 #include "s2/s1interval.h"
@@ -114,6 +115,30 @@ class S2PolylineSimplifier {
   // cannot be avoided.
   bool AvoidDisc(const S2Point& point, S1ChordAngle radius, bool disc_on_left);
 
+  // Simplifies an entire chain of edges (such as an S2Polyline or one chain
+  // of an S2LaxPolylineShape) using the loop shown at the top of this file.
+  // Each output edge passes within "tolerance" of the input vertices that it
+  // replaces, in order.  Sets "indices" to the increasing indices of the
+  // vertices that are kept; these always include the first and last vertex,
+  // except that duplicate adjacent output vertices are omitted (so that a
+  // chain whose vertices are all identical yields a single index).  Like
+  // S2Polyline::SubsampleVertices(), vertices must be increasingly distant
+  // from the start of each output edge and output edges are at most 90
+  // degrees long (unless the original edge was longer).
+  //
+  // This method does not allocate memory once "indices" has sufficient
+  // capacity, so a single simplifier and vector can be reused to simplify
+  // many chains efficiently.
+  void SimplifyChain(absl::Span<const S2Point> vertices, S1ChordAngle tolerance,
+                     std::vector<int>* indices);
+
+  // Like SimplifyChain(), but simplifies many chains using up to
+  // "num_threads" threads.  Sets (*indices)[i] to the result for chains[i].
+  // The existing elements of "indices" are reused to avoid allocations.
+  static void SimplifyChains(absl::Span<const absl::Span<const S2Point>> chains,
+                             S1ChordAngle tolerance, int num_threads,
+                             std::vector<std::vector<int>>* indices);
+
  private:
   // Unfortunately, the discs to avoid cannot be processed until the direction
   // of the output edge is constrained to lie within an S1Interval of at most
@@ -23,8 +23,10 @@
 
 #include <gtest/gtest.h>
 #include "absl/log/log_streamer.h"
+#include "absl/random/bit_gen_ref.h"
 #include "absl/random/random.h"
 #include "absl/strings/string_view.h"
+#include "absl/types/span.h"
 #include "s2/s1angle.h"
 #include "s2/s1chord_angle.h"
 #include "s2/s2edge_crossings.h"
@@ -213,3 +215,107 @@ TEST(S2PolylineSimplifier, Precision) {
     EXPECT_EQ(bad_disc < 0, simplifier.Extend(dst));
   }
 }
+
+TEST(S2PolylineSimplifier, SimplifyChainBasic) {
+  S2PolylineSimplifier s;
+  S1ChordAngle tolerance(S1Angle::Degrees(0.1));
+  vector<int> indices;
+  s.SimplifyChain({}, tolerance, &indices);
+  EXPECT_TRUE(indices.empty());
+
+  // Identical vertices yield a single vertex.
+  s.SimplifyChain(s2textformat::ParsePointsOrDie("1:1, 1:1, 1:1"), tolerance,
+                  &indices);
+  EXPECT_EQ(indices, (vector<int>{0}));
+
+  // Nearly straight chains are replaced by a single edge.
+  s.SimplifyChain(s2textformat::ParsePointsOrDie("0:0, 0:1, 0.05:2, 0:3"),
+                  tolerance, &indices);
+  EXPECT_EQ(indices, (vector<int>{0, 3}));
+
+  // Vertices that are too far away are kept, and adjacent duplicate output
+  // vertices are omitted.
+  s.SimplifyChain(
+      s2textformat::ParsePointsOrDie("0:0, 0:1, 1:2, 1:2, 0:3, 0:4, 0:4"),
+      tolerance, &indices);
+  EXPECT_EQ(indices, (vector<int>{0, 1, 3, 4, 6}));
+
+  // Vertices must be increasingly distant from the start of the edge.
+  s.SimplifyChain(s2textformat::ParsePointsOrDie("0:0, 0:2, 0:1, 0:3"),
+                  tolerance, &indices);
+  EXPECT_EQ(indices, (vector<int>{0, 1, 2, 3}));
+
+  // Edges longer than 90 degrees are not created, but existing ones are kept.
+  s.SimplifyChain(s2textformat::ParsePointsOrDie("0:0, 0:60, 0:120, 0:180"),
+                  tolerance, &indices);
+  EXPECT_EQ(indices, (vector<int>{0, 1, 2, 3}));
+  s.SimplifyChain(s2textformat::ParsePointsOrDie("0:0, 0:100, 0:101, 0:102"),
+                  tolerance, &indices);
+  EXPECT_EQ(indices, (vector<int>{0, 1, 3}));
+}
+
+// Returns a random walk with "n" vertices and steps of length "step" that
+// occasionally changes direction.
+vector<S2Point> MakeRandomWalk(absl::BitGenRef bitgen, int n, S1Angle step) {
+  vector<S2Point> vertices;
+  if (n == 0) return vertices;
+  vertices.push_back(s2random::Point(bitgen));
+  S2Point target = s2random::Point(bitgen);
+  while (vertices.size() < n) {
+    if (absl::Bernoulli(bitgen, 0.1)) target = s2random::Point(bitgen);
+    vertices.push_back(S2::GetPointOnLine(vertices.back(), target, step));
+  }
+  return vertices;
+}
+
+TEST(S2PolylineSimplifier, SimplifyChainRandom) {
+  absl::BitGen bitgen(S2Testing::MakeTaggedSeedSeq(
+      "SIMPLIFY_CHAIN_RANDOM",
+      absl::LogInfoStreamer(__FILE__, __LINE__).stream()));
+  S2PolylineSimplifier s;
+  vector<int> indices;
+  for (int iter = 0; iter < 100; ++iter) {
+    vector<S2Point> v = MakeRandomWalk(bitgen, 200, S1Angle::Degrees(0.01));
+    S1ChordAngle tolerance(
+        S1Angle::Degrees(absl::Uniform(bitgen, 0.001, 0.1)));
+    s.SimplifyChain(v, tolerance, &indices);
+    ASSERT_GE(indices.size(), 2);
+    EXPECT_EQ(indices.front(), 0);
+    EXPECT_EQ(indices.back(), v.size() - 1);
+    EXPECT_LT(indices.size(), v.size());
+    // Every input vertex is within "tolerance" of its output edge.
+    for (int k = 0; k + 1 < indices.size(); ++k) {
+      ASSERT_LT(indices[k], indices[k + 1]);
+      const S2Point& a = v[indices[k]];
+      const S2Point& b = v[indices[k + 1]];
+      for (int i = indices[k]; i <= indices[k + 1]; ++i) {
+        EXPECT_LE(S1ChordAngle(S2::GetDistance(v[i], a, b)), tolerance);
+      }
+    }
+  }
+}
+
+TEST(S2PolylineSimplifier, SimplifyChainsMultithreaded) {
+  absl::BitGen bitgen(S2Testing::MakeTaggedSeedSeq(
+      "SIMPLIFY_CHAINS_MULTITHREADED",
+      absl::LogInfoStreamer(__FILE__, __LINE__).stream()));
+  vector<vector<S2Point>> walks;
+  vector<absl::Span<const S2Point>> chains;
+  for (int i = 0; i < 50; ++i) {
+    walks.push_back(MakeRandomWalk(bitgen, absl::Uniform(bitgen, 0, 100),
+                                   S1Angle::Degrees(0.01)));
+  }
+  for (const auto& walk : walks) chains.push_back(walk);
+  S1ChordAngle tolerance(S1Angle::Degrees(0.02));
+  vector<vector<int>> expected, actual;
+  S2PolylineSimplifier::SimplifyChains(chains, tolerance, 1, &expected);
+  S2PolylineSimplifier::SimplifyChains(chains, tolerance, 4, &actual);
+  ASSERT_EQ(expected.size(), chains.size());
+  EXPECT_EQ(expected, actual);
+  S2PolylineSimplifier s;
+  vector<int> indices;
+  for (int i = 0; i < chains.size(); ++i) {
+    s.SimplifyChain(chains[i], tolerance, &indices);
+    EXPECT_EQ(indices, expected[i]);
+  }
+}
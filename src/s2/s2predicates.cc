@@ -18,17 +18,21 @@
 #include "s2/s2predicates.h"
 
 #include <algorithm>
+#include <atomic>
 #include <cfloat>
 #include <cmath>
+#include <cstdint>
 #include <ostream>
 #include <utility>
 
+#include "absl/base/attributes.h"
 #include "absl/log/absl_check.h"
 #include "s2/s1chord_angle.h"
 #include "s2/s2edge_crossings.h"
 #include "s2/s2point.h"
 #include "s2/s2predicates_internal.h"
 #include "s2/util/math/exactfloat/exactfloat.h"
+#include "s2/util/math/fixed_expansion.h"
 
 using std::fabs;
 using std::max;
@@ -40,6 +44,19 @@ namespace s2pred {
 // A predefined S1ChordAngle representing (approximately) 45 degrees.
 static const S1ChordAngle k45Degrees = S1ChordAngle::FromLength2(2 - M_SQRT2);
 
+using internal::RecordPrecision;
+
+namespace internal {
+
+ABSL_CONST_INIT std::atomic<bool> predicate_stats_enabled(false);
+
+}  // namespace internal
+
+// The counters used by PredicateStats.
+ABSL_CONST_INIT static std::atomic<uint64_t>
+    precision_counts[PredicateStats::kNumPredicates]
+                    [PredicateStats::kNumPrecisions] = {};
+
 int Sign(const S2Point& a, const S2Point& b, const S2Point& c) {
   // We don't need RobustCrossProd() here because Sign() does its own
   // error estimation and calls ExpensiveSign() if there is any uncertainty
@@ -220,6 +237,33 @@ int SymbolicallyPerturbedSign(
   return 1;                                     // dc[2] * db[1] * da[0]
 }
 
+// Returns true if every coordinate of "p" is zero or has an exponent small
+// enough in magnitude that ExpansionSign() cannot underflow or overflow.
+static bool IsExpansionSafe(const S2Point& p) {
+  for (int i = 0; i < 3; ++i) {
+    double x = fabs(p[i]);
+    if (x != 0 && !(x >= 0x1p-200 && x <= 0x1p200)) return false;
+  }
+  return true;
+}
+
+// Returns the exact sign of the determinant of A, B, C using floating-point
+// expansions, which is much faster than ExactFloat since it does not
+// allocate memory.  REQUIRES: IsExpansionSafe() is true for all three points.
+static int ExpansionSign(const S2Point& a, const S2Point& b,
+                         const S2Point& c) {
+  // Each cross product coordinate has at most 4 components, and the
+  // determinant has at most 3 * 8 = 24 components.
+  using Expansion = FixedExpansion<24>;
+  Expansion bxc0 = Expansion::Product(b[1], c[2]) -
+                   Expansion::Product(b[2], c[1]);
+  Expansion bxc1 = Expansion::Product(b[2], c[0]) -
+                   Expansion::Product(b[0], c[2]);
+  Expansion bxc2 = Expansion::Product(b[0], c[1]) -
+                   Expansion::Product(b[1], c[0]);
+  return (bxc0 * a[0] + bxc1 * a[1] + bxc2 * a[2]).sgn();
+}
+
 // Compute the determinant using exact arithmetic and/or symbolic
 // permutations.  Requires that the three points are distinct.
 int ExactSign(const S2Point& a, const S2Point& b, const S2Point& c,
@@ -236,6 +280,17 @@ int ExactSign(const S2Point& a, const S2Point& b, const S2Point& c,
   if (*pa > *pb) { swap(pa, pb); perm_sign = -perm_sign; }
   ABSL_DCHECK(*pa < *pb && *pb < *pc);
 
+  // The exact determinant can almost always be computed without memory
+  // allocation.  ExactFloat is needed only for inputs with extreme exponents
+  // and for computing symbolic perturbations.
+  if (IsExpansionSafe(*pa) && IsExpansionSafe(*pb) && IsExpansionSafe(*pc)) {
+    int det_sign = ExpansionSign(*pa, *pb, *pc);
+    if (det_sign != 0 || !perturb) {
+      RecordPrecision(Predicate::SIGN, PrecisionLevel::EXACT);
+      return perm_sign * det_sign;
+    }
+  }
+
   // Construct multiple-precision versions of the sorted points and compute
   // their exact 3x3 determinant.
   Vector3_xf xa = ToExact(*pa);
@@ -256,6 +311,9 @@ int ExactSign(const S2Point& a, const S2Point& b, const S2Point& c,
     // sign of the determinant.
     det_sign = SymbolicallyPerturbedSign(xa, xb, xc, xb_cross_xc);
     ABSL_DCHECK_NE(0, det_sign);
+    RecordPrecision(Predicate::SIGN, PrecisionLevel::SYMBOLIC);
+  } else {
+    RecordPrecision(Predicate::SIGN, PrecisionLevel::EXACT);
   }
   return perm_sign * det_sign;
 }
@@ -274,7 +332,10 @@ int ExactSign(const S2Point& a, const S2Point& b, const S2Point& c,
 int ExpensiveSign(const S2Point& a, const S2Point& b, const S2Point& c,
                   bool perturb) {
   // Return zero if and only if two points are the same.  This ensures (1).
-  if (a == b || b == c || c == a) return 0;
+  if (a == b || b == c || c == a) {
+    RecordPrecision(Predicate::SIGN, PrecisionLevel::DOUBLE);
+    return 0;
+  }
 
   // Next we try recomputing the determinant still using floating-point
   // arithmetic but in a more precise way.  This is more expensive than the
@@ -283,14 +344,14 @@ int ExpensiveSign(const S2Point& a, const S2Point& b, const S2Point& c,
   // compute the correct determinant sign in virtually all cases except when
   // the three points are truly collinear (e.g., three points on the equator).
   int det_sign = StableSign(a, b, c);
-  if (det_sign != 0) return det_sign;
+  if (det_sign != 0) {
+    RecordPrecision(Predicate::SIGN, PrecisionLevel::DOUBLE);
+    return det_sign;
+  }
 
   // TODO(ericv): Create a templated version of StableSign so that we can
   // retry in "long double" precision before falling back to ExactFloat.
 
-  // TODO(ericv): Optimize ExactFloat so that it stores up to 32 bytes of
-  // mantissa inline (without requiring memory allocation).
-
   // Otherwise fall back to exact arithmetic and symbolic permutations.
   return ExactSign(a, b, c, perturb);
 }
@@ -432,10 +493,13 @@ int SymbolicCompareDistances(const S2Point& x,
   return (a < b) ? 1 : (a > b) ? -1 : 0;
 }
 
+// Sets "precision" to LONG_DOUBLE if double precision was not sufficient.
 static int CompareSin2Distances(const S2Point& x,
-                                const S2Point& a, const S2Point& b) {
+                                const S2Point& a, const S2Point& b,
+                                PrecisionLevel* precision) {
   int sign = TriageCompareSin2Distances(x, a, b);
   if (kHasLongDouble && sign == 0) {
+    *precision = PrecisionLevel::LONG_DOUBLE;
     sign = TriageCompareSin2Distances(ToLD(x), ToLD(a), ToLD(b));
   }
   return sign;
@@ -448,10 +512,12 @@ int CompareDistances(const S2Point& x, const S2Point& a, const S2Point& b) {
   // technique if both angles are less than 90 degrees or both angles are
   // greater than 90 degrees.)
   int sign = TriageCompareCosDistances(x, a, b);
-  if (sign != 0) return sign;
-
-  // Optimization for (a == b) to avoid falling back to exact arithmetic.
-  if (a == b) return 0;
+  PrecisionLevel precision = PrecisionLevel::DOUBLE;
+  if (sign != 0 || a == b) {
+    // (a == b) is checked here to avoid falling back to exact arithmetic.
+    RecordPrecision(Predicate::COMPARE_DISTANCES, precision);
+    return sign;
+  }
 
   // It is much better numerically to compare distances using cos(angle) if
   // the distances are near 90 degrees and sin^2(angle) if the distances are
@@ -461,18 +527,25 @@ int CompareDistances(const S2Point& x, const S2Point& a, const S2Point& b) {
   double cos_ax = a.DotProd(x);
   if (cos_ax > M_SQRT1_2) {
     // Angles < 45 degrees.
-    sign = CompareSin2Distances(x, a, b);
+    sign = CompareSin2Distances(x, a, b, &precision);
   } else if (cos_ax < -M_SQRT1_2) {
     // Angles > 135 degrees.  sin^2(angle) is decreasing in this range.
-    sign = -CompareSin2Distances(x, a, b);
+    sign = -CompareSin2Distances(x, a, b, &precision);
   } else if (kHasLongDouble) {
     // We've already tried double precision, so continue with "long double".
+    precision = PrecisionLevel::LONG_DOUBLE;
     sign = TriageCompareCosDistances(ToLD(x), ToLD(a), ToLD(b));
   }
-  if (sign != 0) return sign;
-  sign = ExactCompareDistances(ToExact(x), ToExact(a), ToExact(b));
-  if (sign != 0) return sign;
-  return SymbolicCompareDistances(x, a, b);
+  if (sign == 0) {
+    precision = PrecisionLevel::EXACT;
+    sign = ExactCompareDistances(ToExact(x), ToExact(a), ToExact(b));
+  }
+  if (sign == 0) {
+    precision = PrecisionLevel::SYMBOLIC;
+    sign = SymbolicCompareDistances(x, a, b);
+  }
+  RecordPrecision(Predicate::COMPARE_DISTANCES, precision);
+  return sign;
 }
 
 template <class T>
@@ -524,25 +597,33 @@ int CompareDistance(const S2Point& x, const S2Point& y, S1ChordAngle r) {
   // the sin^2 method is only valid when the distance XY and the limit "r" are
   // both less than 90 degrees.
   int sign = TriageCompareCosDistance(x, y, r.length2());
-  if (sign != 0) return sign;
-
-  // Optimization for (x == y) to avoid falling back to exact arithmetic.
-  if (r.length2() == 0 && x == y) return 0;
+  if (sign != 0 || (r.length2() == 0 && x == y)) {
+    // (x == y) is checked here to avoid falling back to exact arithmetic.
+    RecordPrecision(Predicate::COMPARE_DISTANCE, PrecisionLevel::DOUBLE);
+    return sign;
+  }
 
   // Unlike with CompareDistances(), it's not worth using the sin^2 method
   // when the distance limit is near 180 degrees because the S1ChordAngle
   // representation itself has has a rounding error of up to 2e-8 radians for
   // distances near 180 degrees.
+  PrecisionLevel precision = PrecisionLevel::DOUBLE;
   if (r < k45Degrees) {
     sign = TriageCompareSin2Distance(x, y, r.length2());
     if (kHasLongDouble && sign == 0) {
+      precision = PrecisionLevel::LONG_DOUBLE;
       sign = TriageCompareSin2Distance(ToLD(x), ToLD(y), ToLD(r.length2()));
     }
   } else if (kHasLongDouble) {
+    precision = PrecisionLevel::LONG_DOUBLE;
     sign = TriageCompareCosDistance(ToLD(x), ToLD(y), ToLD(r.length2()));
   }
-  if (sign != 0) return sign;
-  return ExactCompareDistance(ToExact(x), ToExact(y), r.length2());
+  if (sign == 0) {
+    precision = PrecisionLevel::EXACT;
+    sign = ExactCompareDistance(ToExact(x), ToExact(y), r.length2());
+  }
+  RecordPrecision(Predicate::COMPARE_DISTANCE, precision);
+  return sign;
 }
 
 // Helper function that compares the distance XY against the squared chord
@@ -760,15 +841,24 @@ int CompareEdgeDistance(const S2Point& x, const S2Point& a0, const S2Point& a1,
   ABSL_DCHECK_NE(a0, -a1);
 
   int sign = TriageCompareEdgeDistance(x, a0, a1, r.length2());
-  if (sign != 0) return sign;
+  if (sign != 0) {
+    RecordPrecision(Predicate::COMPARE_EDGE_DISTANCE, PrecisionLevel::DOUBLE);
+    return sign;
+  }
 
-  // Optimization for the case where the edge is degenerate.
+  // Optimization for the case where the edge is degenerate.  (This call is
+  // counted as COMPARE_DISTANCE instead.)
   if (a0 == a1) return CompareDistance(x, a0, r);
   if (kHasLongDouble) {
     sign = TriageCompareEdgeDistance(ToLD(x), ToLD(a0), ToLD(a1),
                                      ToLD(r.length2()));
-    if (sign != 0) return sign;
+    if (sign != 0) {
+      RecordPrecision(Predicate::COMPARE_EDGE_DISTANCE,
+                      PrecisionLevel::LONG_DOUBLE);
+      return sign;
+    }
   }
+  RecordPrecision(Predicate::COMPARE_EDGE_DISTANCE, PrecisionLevel::EXACT);
   return ExactCompareEdgeDistance(x, a0, a1, r);
 }
 
@@ -1324,22 +1414,31 @@ int EdgeCircumcenterSign(const S2Point& x0, const S2Point& x1,
 
   int abc_sign = Sign(a, b, c);
   int sign = TriageEdgeCircumcenterSign(x0, x1, a, b, c, abc_sign);
-  if (sign != 0) return sign;
-
-  // Optimization for the cases that are going to return zero anyway, in order
+  // Also check for the cases that are going to return zero anyway, in order
   // to avoid falling back to exact arithmetic.
-  if (x0 == x1 || a == b || b == c || c == a) return 0;
+  if (sign != 0 || x0 == x1 || a == b || b == c || c == a) {
+    RecordPrecision(Predicate::EDGE_CIRCUMCENTER_SIGN, PrecisionLevel::DOUBLE);
+    return sign;
+  }
   if (kHasLongDouble) {
     sign = TriageEdgeCircumcenterSign(
         ToLD(x0), ToLD(x1), ToLD(a), ToLD(b), ToLD(c), abc_sign);
-    if (sign != 0) return sign;
+    if (sign != 0) {
+      RecordPrecision(Predicate::EDGE_CIRCUMCENTER_SIGN,
+                      PrecisionLevel::LONG_DOUBLE);
+      return sign;
+    }
   }
   sign = ExactEdgeCircumcenterSign(
       ToExact(x0), ToExact(x1), ToExact(a), ToExact(b), ToExact(c), abc_sign);
-  if (sign != 0) return sign;
+  if (sign != 0) {
+    RecordPrecision(Predicate::EDGE_CIRCUMCENTER_SIGN, PrecisionLevel::EXACT);
+    return sign;
+  }
 
   // Unlike the other methods, SymbolicEdgeCircumcenterSign does not depend
   // on the sign of triangle ABC.
+  RecordPrecision(Predicate::EDGE_CIRCUMCENTER_SIGN, PrecisionLevel::SYMBOLIC);
   return SymbolicEdgeCircumcenterSign(x0, x1, a, b, c);
 }
 
@@ -1703,6 +1802,79 @@ std::ostream& operator<<(std::ostream& os, Excluded excluded) {
   }
 }
 
+namespace internal {
+
+void IncrementPrecisionCount(Predicate predicate, PrecisionLevel precision) {
+  precision_counts[static_cast<int>(predicate)][static_cast<int>(precision)]
+      .fetch_add(1, std::memory_order_relaxed);
+}
+
+}  // namespace internal
+
+uint64_t PredicateStats::total(Predicate predicate) const {
+  uint64_t sum = 0;
+  for (uint64_t count : counts[static_cast<int>(predicate)]) sum += count;
+  return sum;
+}
+
+std::ostream& operator<<(std::ostream& os, Predicate predicate) {
+  switch (predicate) {
+    case Predicate::SIGN: return os << "Sign";
+    case Predicate::COMPARE_DISTANCES: return os << "CompareDistances";
+    case Predicate::COMPARE_DISTANCE: return os << "CompareDistance";
+    case Predicate::COMPARE_EDGE_DISTANCE: return os << "CompareEdgeDistance";
+    case Predicate::EDGE_CIRCUMCENTER_SIGN:
+      return os << "EdgeCircumcenterSign";
+    default: return os << "Unknown enum value";
+  }
+}
+
+std::ostream& operator<<(std::ostream& os, PrecisionLevel precision) {
+  switch (precision) {
+    case PrecisionLevel::DOUBLE: return os << "DOUBLE";
+    case PrecisionLevel::LONG_DOUBLE: return os << "LONG_DOUBLE";
+    case PrecisionLevel::EXACT: return os << "EXACT";
+    case PrecisionLevel::SYMBOLIC: return os << "SYMBOLIC";
+    default: return os << "Unknown enum value";
+  }
+}
+
+std::ostream& operator<<(std::ostream& os, const PredicateStats& stats) {
+  for (int i = 0; i < PredicateStats::kNumPredicates; ++i) {
+    const Predicate predicate = static_cast<Predicate>(i);
+    os << predicate << ": " << stats.total(predicate) << " calls";
+    for (int j = 0; j < PredicateStats::kNumPrecisions; ++j) {
+      const PrecisionLevel precision = static_cast<PrecisionLevel>(j);
+      os << ", " << precision << "=" << stats.count(predicate, precision);
+    }
+    os << "\n";
+  }
+  return os;
+}
+
+void EnablePredicateStats(bool enabled) {
+  internal::predicate_stats_enabled.store(enabled, std::memory_order_relaxed);
+}
+
+PredicateStats GetPredicateStats() {
+  PredicateStats stats;
+  for (int i = 0; i < PredicateStats::kNumPredicates; ++i) {
+    for (int j = 0; j < PredicateStats::kNumPrecisions; ++j) {
+      stats.counts[i][j] =
+          precision_counts[i][j].load(std::memory_order_relaxed);
+    }
+  }
+  return stats;
+}
+
+void ResetPredicateStats() {
+  for (auto& predicate_counts : precision_counts) {
+    for (auto& count : predicate_counts) {
+      count.store(0, std::memory_order_relaxed);
+    }
+  }
+}
+
 // Explicitly instantiate all of the template functions above so that the
 // tests can use them without putting all the definitions in a header file.
 
@@ -47,11 +47,16 @@
 #ifndef S2_S2PREDICATES_H_
 #define S2_S2PREDICATES_H_
 
+#include <array>
+#include <atomic>
 #include <cfloat>
 #include <cmath>
+#include <cstdint>
 #include <iosfwd>
 #include <ostream>
 
+#include "absl/base/attributes.h"
+#include "absl/base/optimization.h"
 #include "absl/flags/flag.h"
 #include "absl/log/absl_check.h"
 #include "s2/_fp_contract_off.h"  // IWYU pragma: keep
@@ -315,6 +320,76 @@ Excluded GetVoronoiSiteExclusion(const S2Point& a, const S2Point& b,
                                  const S2Point& x0, const S2Point& x1,
                                  S1ChordAngle r);
 
+///////////////////////////// Statistics /////////////////////////////////
+//
+// The predicates above first compute their result in double precision, and
+// only fall back to "long double", exact arithmetic (ExactFloat, which
+// allocates memory), and finally symbolic perturbations when the result is
+// uncertain.  The following functions count how many calls to the most
+// expensive predicates were resolved at each of these precision levels, e.g.
+// to find out where ExactFloat calculations come from in a given workload:
+//
+//   s2pred::EnablePredicateStats(true);
+//   ... run the workload ...
+//   ABSL_LOG(INFO) << s2pred::GetPredicateStats();
+//
+// Counting is disabled by default, in which case each call costs only one
+// extra (well-predicted) branch.  When enabled, the counters are shared by
+// all threads and are updated with relaxed atomic operations.
+
+// The predicates that are counted.  SIGN includes calls to ExpensiveSign()
+// (e.g., from S2EdgeCrosser), but not calls where S2EdgeCrosser resolves
+// the sign itself.
+enum class Predicate : uint8_t {
+  SIGN,
+  COMPARE_DISTANCES,
+  COMPARE_DISTANCE,
+  COMPARE_EDGE_DISTANCE,
+  EDGE_CIRCUMCENTER_SIGN,
+  NUM_PREDICATES
+};
+
+// The precision used to resolve a predicate.  DOUBLE includes the stable
+// (but still double precision) determinant computed by ExpensiveSign(), and
+// calls that are resolved without computation (e.g. because two points are
+// equal).  EXACT and SYMBOLIC both use ExactFloat.
+enum class PrecisionLevel : uint8_t {
+  DOUBLE,
+  LONG_DOUBLE,
+  EXACT,
+  SYMBOLIC,
+  NUM_PRECISIONS
+};
+
+struct PredicateStats {
+  static constexpr int kNumPredicates =
+      static_cast<int>(Predicate::NUM_PREDICATES);
+  static constexpr int kNumPrecisions =
+      static_cast<int>(PrecisionLevel::NUM_PRECISIONS);
+
+  // Returns the number of calls to "predicate" resolved using "precision".
+  uint64_t count(Predicate predicate, PrecisionLevel precision) const {
+    return counts[static_cast<int>(predicate)][static_cast<int>(precision)];
+  }
+
+  // Returns the total number of calls to "predicate".
+  uint64_t total(Predicate predicate) const;
+
+  std::array<std::array<uint64_t, kNumPrecisions>, kNumPredicates> counts = {};
+};
+std::ostream& operator<<(std::ostream& os, Predicate predicate);
+std::ostream& operator<<(std::ostream& os, PrecisionLevel precision);
+std::ostream& operator<<(std::ostream& os, const PredicateStats& stats);
+
+// Enables or disables counting.  Disabling does not reset the counts.
+void EnablePredicateStats(bool enabled);
+
+// Returns the counts accumulated while counting was enabled.
+PredicateStats GetPredicateStats();
+
+// Resets all counts to zero.
+void ResetPredicateStats();
+
 /////////////////////////// Low-Level Methods ////////////////////////////
 //
 // Most clients will not need the following methods.  They can be slightly
@@ -362,11 +437,30 @@ int ExpensiveSign(const S2Point& a, const S2Point& b,
 
 //////////////////   Implementation details follow   ////////////////////
 
+namespace internal {
+
+ABSL_CONST_INIT extern std::atomic<bool> predicate_stats_enabled;
+
+void IncrementPrecisionCount(Predicate predicate, PrecisionLevel precision);
+
+// Records that a call to "predicate" was resolved using "precision".
+inline void RecordPrecision(Predicate predicate, PrecisionLevel precision) {
+  if (ABSL_PREDICT_FALSE(
+          predicate_stats_enabled.load(std::memory_order_relaxed))) {
+    IncrementPrecisionCount(predicate, precision);
+  }
+}
+
+}  // namespace internal
+
 inline int Sign(const S2Point& a, const S2Point& b, const S2Point& c,
                 const Vector3_d& a_cross_b) {
   int sign = TriageSign(a, b, c, a_cross_b);
-  if (sign == 0) sign = ExpensiveSign(a, b, c);
-  return sign;
+  if (sign != 0) {
+    internal::RecordPrecision(Predicate::SIGN, PrecisionLevel::DOUBLE);
+    return sign;
+  }
+  return ExpensiveSign(a, b, c);
 }
 
 inline int TriageSign(const S2Point& a, const S2Point& b,
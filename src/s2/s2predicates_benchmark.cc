@@ -0,0 +1,175 @@
+// Copyright 2024 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "s2/s2predicates.h"
+
+#include <cstddef>
+#include <random>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+#include "s2/s2benchmark_testing.h"
+#include "s2/s2point.h"
+#include "s2/s2predicates_internal.h"
+#include "s2/s2random.h"
+
+using std::vector;
+
+namespace s2pred {
+namespace {
+
+// The benchmarks below measure the cost of each precision level of the
+// predicates counted by PredicateStats, by calling the function that
+// implements that level directly.  Multiplying these costs by the counts
+// from GetPredicateStats() shows where the time goes in a given workload.
+
+constexpr int kNumPoints = 4096;
+
+vector<S2Point> MakePoints() {
+  std::mt19937_64 bitgen(s2benchmark::kSeed);
+  vector<S2Point> points;
+  for (int i = 0; i < kNumPoints; ++i) {
+    points.push_back(s2random::Point(bitgen));
+  }
+  return points;
+}
+
+// Calls "predicate" on consecutive triples of random points.
+template <class Function>
+void BenchmarkTriples(benchmark::State& state, Function predicate) {
+  const vector<S2Point> p = MakePoints();
+  size_t i = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(predicate(p[i], p[i + 1], p[i + 2]));
+    i = (i + 3 > p.size() - 3) ? 0 : i + 3;
+  }
+}
+
+// Calls "predicate" on consecutive groups of five random points.
+template <class Function>
+void BenchmarkQuintuples(benchmark::State& state, Function predicate) {
+  const vector<S2Point> p = MakePoints();
+  size_t i = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(
+        predicate(p[i], p[i + 1], p[i + 2], p[i + 3], p[i + 4]));
+    i = (i + 5 > p.size() - 5) ? 0 : i + 5;
+  }
+}
+
+void BM_SignDouble(benchmark::State& state) {
+  BenchmarkTriples(state, [](const S2Point& a, const S2Point& b,
+                             const S2Point& c) {
+    return TriageSign(a, b, c, a.CrossProd(b));
+  });
+}
+BENCHMARK(BM_SignDouble);
+
+void BM_SignStable(benchmark::State& state) {
+  BenchmarkTriples(state, StableSign);
+}
+BENCHMARK(BM_SignStable);
+
+void BM_SignExact(benchmark::State& state) {
+  BenchmarkTriples(state, [](const S2Point& a, const S2Point& b,
+                             const S2Point& c) {
+    return ExactSign(a, b, c, false /*perturb*/);
+  });
+}
+BENCHMARK(BM_SignExact);
+
+// Since A and -A are linearly dependent, the exact determinant is always
+// zero and symbolic perturbations are needed.  (This includes the cost of the
+// exact determinant computed first.)
+void BM_SignSymbolic(benchmark::State& state) {
+  BenchmarkTriples(state, [](const S2Point& a, const S2Point& b,
+                             const S2Point&) {
+    return ExactSign(a, -a, b, true /*perturb*/);
+  });
+}
+BENCHMARK(BM_SignSymbolic);
+
+// Measures the overhead of counting, which applies to every call.
+void BM_SignWithStats(benchmark::State& state) {
+  EnablePredicateStats(state.range(0) != 0);
+  BenchmarkTriples(state, [](const S2Point& a, const S2Point& b,
+                             const S2Point& c) { return Sign(a, b, c); });
+  EnablePredicateStats(false);
+  ResetPredicateStats();
+}
+BENCHMARK(BM_SignWithStats)->Arg(0)->Arg(1);
+
+void BM_CompareDistancesDouble(benchmark::State& state) {
+  BenchmarkTriples(state, TriageCompareCosDistances<double>);
+}
+BENCHMARK(BM_CompareDistancesDouble);
+
+void BM_CompareDistancesLongDouble(benchmark::State& state) {
+  BenchmarkTriples(state, [](const S2Point& x, const S2Point& a,
+                             const S2Point& b) {
+    return TriageCompareCosDistances(ToLD(x), ToLD(a), ToLD(b));
+  });
+}
+BENCHMARK(BM_CompareDistancesLongDouble);
+
+void BM_CompareDistancesExact(benchmark::State& state) {
+  BenchmarkTriples(state, [](const S2Point& x, const S2Point& a,
+                             const S2Point& b) {
+    return ExactCompareDistances(ToExact(x), ToExact(a), ToExact(b));
+  });
+}
+BENCHMARK(BM_CompareDistancesExact);
+
+void BM_CompareDistancesSymbolic(benchmark::State& state) {
+  BenchmarkTriples(state, SymbolicCompareDistances);
+}
+BENCHMARK(BM_CompareDistancesSymbolic);
+
+void BM_EdgeCircumcenterSignDouble(benchmark::State& state) {
+  BenchmarkQuintuples(state, [](const S2Point& x0, const S2Point& x1,
+                                const S2Point& a, const S2Point& b,
+                                const S2Point& c) {
+    return TriageEdgeCircumcenterSign(x0, x1, a, b, c, Sign(a, b, c));
+  });
+}
+BENCHMARK(BM_EdgeCircumcenterSignDouble);
+
+void BM_EdgeCircumcenterSignLongDouble(benchmark::State& state) {
+  BenchmarkQuintuples(state, [](const S2Point& x0, const S2Point& x1,
+                                const S2Point& a, const S2Point& b,
+                                const S2Point& c) {
+    return TriageEdgeCircumcenterSign(ToLD(x0), ToLD(x1), ToLD(a), ToLD(b),
+                                      ToLD(c), Sign(a, b, c));
+  });
+}
+BENCHMARK(BM_EdgeCircumcenterSignLongDouble);
+
+void BM_EdgeCircumcenterSignExact(benchmark::State& state) {
+  BenchmarkQuintuples(state, [](const S2Point& x0, const S2Point& x1,
+                                const S2Point& a, const S2Point& b,
+                                const S2Point& c) {
+    return ExactEdgeCircumcenterSign(ToExact(x0), ToExact(x1), ToExact(a),
+                                     ToExact(b), ToExact(c), Sign(a, b, c));
+  });
+}
+BENCHMARK(BM_EdgeCircumcenterSignExact);
+
+void BM_EdgeCircumcenterSignSymbolic(benchmark::State& state) {
+  BenchmarkQuintuples(state, SymbolicEdgeCircumcenterSign);
+}
+BENCHMARK(BM_EdgeCircumcenterSignSymbolic);
+
+}  // namespace
+}  // namespace s2pred
@@ -20,6 +20,7 @@
 #include <algorithm>
 #include <cfloat>
 #include <cmath>
+#include <cstdlib>
 #include <iterator>
 #include <limits>
 #include <string>
@@ -146,6 +147,43 @@ TEST(Sign, StableSignUnderflow) {
   EXPECT_EQ(Sign(a, b, c), 1);
 }
 
+TEST(Sign, ExactSignMatchesExactFloat) {
+  // ExactSign() avoids ExactFloat when possible.  Check that it agrees with
+  // the ExactFloat determinant for nearly collinear points, including points
+  // whose coordinates have extreme exponents.
+  absl::BitGen bitgen(S2Testing::MakeTaggedSeedSeq(
+      "EXACT_SIGN_MATCHES_EXACT_FLOAT",
+      absl::LogInfoStreamer(__FILE__, __LINE__).stream()));
+  for (int iter = 0; iter < 10000; ++iter) {
+    S2Point a = s2random::Point(bitgen);
+    S2Point b = s2random::Point(bitgen);
+    S2Point c = (a + b).Normalize();
+    // Perturb "c" by a few ulps so that some determinants are exactly zero.
+    for (int i = 0; i < 3; ++i) {
+      const int ulps = absl::Uniform(bitgen, -2, 3);
+      for (int j = 0; j < std::abs(ulps); ++j) {
+        c[i] = std::nextafter(c[i], ulps > 0 ? 2.0 : -2.0);
+      }
+    }
+    if (absl::Bernoulli(bitgen, 0.2)) {
+      // Give some coordinates tiny exponents.
+      int i = absl::Uniform(bitgen, 0, 3);
+      double scale = std::ldexp(1, -absl::Uniform(bitgen, 150, 300));
+      a[i] *= scale;
+      b[i] *= scale;
+      c[i] *= scale;
+    }
+    if (a == b || b == c || c == a) continue;
+    int expected = ToExact(a).DotProd(ToExact(b).CrossProd(ToExact(c))).sgn();
+    EXPECT_EQ(expected, ExactSign(a, b, c, false))
+        << a << " " << b << " " << c;
+    if (expected != 0) EXPECT_EQ(expected, ExactSign(a, b, c, true));
+
+    // Linearly dependent points have a zero determinant.
+    if (a != -b) EXPECT_EQ(0, ExactSign(a, b, -a, false));
+  }
+}
+
 // This test repeatedly constructs some number of points that are on or nearly
 // on a given great circle.  Then it chooses one of these points as the
 // "origin" and sorts the other points in CCW order around it.  Of course,
@@ -1805,4 +1843,54 @@ TEST(VoronoiSiteExclusion, Consistency) {
   ABSL_LOG(ERROR) << stats.ToString();
 }
 
+
+TEST(PredicateStats, CountsPrecisionLevels) {
+  ResetPredicateStats();
+  const S2Point x = S2Point(1, 1, 1).Normalize();
+  const S2Point a = S2Point(1, -1, 0).Normalize();
+  auto b = [](double z) { return S2Point(-1, 1, z).Normalize(); };
+
+  // Counting is disabled by default.
+  EXPECT_EQ(1, CompareDistances(x, a, b(3e-15)));
+  EXPECT_EQ(0, GetPredicateStats().total(Predicate::COMPARE_DISTANCES));
+
+  // These are the CosDistances cases from CompareDistances.Coverage.
+  EnablePredicateStats(true);
+  EXPECT_EQ(1, CompareDistances(x, a, b(3e-15)));
+  EXPECT_EQ(1, CompareDistances(x, a, b(3e-18)));
+  EXPECT_EQ(1, CompareDistances(x, a, b(1e-100)));
+  EXPECT_EQ(-1, CompareDistances(x, a, b(0)));
+
+  // A non-degenerate triangle, a degenerate one, and three distinct points
+  // that are exactly collinear (see Sign.CollinearPoints).
+  EXPECT_EQ(1, Sign(S2Point(1, 0, 0), S2Point(0, 1, 0), S2Point(0, 0, 1)));
+  EXPECT_EQ(0, Sign(x, x, a));
+  S2Point p0(0.72571927877036835, 0.46058825605889098, 0.51106749730504852);
+  S2Point p1(0.7257192746638208, 0.46058826573818168, 0.51106749441312738);
+  S2Point p2(0.72571927671709457, 0.46058826089853633, 0.51106749585908795);
+  EXPECT_NE(0, Sign(p0, p1, p2));
+  EnablePredicateStats(false);
+
+  // Disabling counting preserves the counts.
+  EXPECT_EQ(1, CompareDistances(x, a, b(3e-15)));
+  const PredicateStats stats = GetPredicateStats();
+  EXPECT_EQ(4, stats.total(Predicate::COMPARE_DISTANCES));
+  EXPECT_EQ(1, stats.count(Predicate::COMPARE_DISTANCES,
+                           PrecisionLevel::DOUBLE));
+  EXPECT_EQ(kHasLongDouble ? 1 : 0,
+            stats.count(Predicate::COMPARE_DISTANCES,
+                        PrecisionLevel::LONG_DOUBLE));
+  EXPECT_EQ(kHasLongDouble ? 1 : 2,
+            stats.count(Predicate::COMPARE_DISTANCES, PrecisionLevel::EXACT));
+  EXPECT_EQ(1, stats.count(Predicate::COMPARE_DISTANCES,
+                           PrecisionLevel::SYMBOLIC));
+  EXPECT_EQ(3, stats.total(Predicate::SIGN));
+  EXPECT_EQ(2, stats.count(Predicate::SIGN, PrecisionLevel::DOUBLE));
+  EXPECT_EQ(1, stats.count(Predicate::SIGN, PrecisionLevel::SYMBOLIC));
+  EXPECT_EQ(0, stats.total(Predicate::EDGE_CIRCUMCENTER_SIGN));
+
+  ResetPredicateStats();
+  EXPECT_EQ(0, GetPredicateStats().total(Predicate::SIGN));
+}
+
 }  // namespace s2pred
@@ -0,0 +1,147 @@
+// Copyright 2024 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "s2/s2prepared_polygon.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "absl/log/absl_check.h"
+#include "s2/mutable_s2shape_index.h"
+#include "s2/s2cell_id.h"
+#include "s2/s2edge_crosser.h"
+#include "s2/s2point.h"
+#include "s2/s2pointutil.h"
+#include "s2/s2polygon.h"
+#include "s2/s2shape.h"
+#include "s2/s2shape_index.h"
+
+S2PreparedPolygon::Options::Options() : max_edges_per_cell_(4) {}
+
+void S2PreparedPolygon::Options::set_max_edges_per_cell(
+    int max_edges_per_cell) {
+  ABSL_DCHECK_GE(max_edges_per_cell, 1);
+  max_edges_per_cell_ = max_edges_per_cell;
+}
+
+S2PreparedPolygon::S2PreparedPolygon(const S2Polygon& polygon,
+                                     const Options& options) {
+  Init(polygon, options);
+}
+
+void S2PreparedPolygon::Init(const S2Polygon& polygon,
+                             const Options& options) {
+  range_mins_.clear();
+  cells_.clear();
+  buckets_.clear();
+  edges_.clear();
+
+  // Build a temporary index with fewer edges per cell than S2Polygon's own
+  // index, and flatten its cells.  The index contains no cells outside the
+  // polygon, since cells with no clipped shapes are not stored.
+  MutableS2ShapeIndex::Options index_options;
+  index_options.set_max_edges_per_cell(options.max_edges_per_cell());
+  MutableS2ShapeIndex index(index_options);
+  index.Add(std::make_unique<S2Polygon::Shape>(&polygon));
+  index.ForceBuild();
+
+  const S2Shape& shape = *index.shape(0);
+  for (MutableS2ShapeIndex::Iterator it(&index, S2ShapeIndex::BEGIN);
+       !it.done(); it.Next()) {
+    const S2ClippedShape* clipped = it.cell().find_clipped(0);
+    if (clipped == nullptr) continue;
+    Cell cell;
+    cell.range_max = it.id().range_max();
+    cell.contains_center = clipped->contains_center();
+    cell.edges_begin = edges_.size();
+    if (clipped->num_edges() > 0) {
+      cell.center = it.id().ToPoint();
+      for (int i = 0; i < clipped->num_edges(); ++i) {
+        edges_.push_back(shape.edge(clipped->edge(i)));
+      }
+    }
+    cell.edges_end = edges_.size();
+    range_mins_.push_back(it.id().range_min());
+    cells_.push_back(cell);
+  }
+  range_mins_.shrink_to_fit();
+  cells_.shrink_to_fit();
+  edges_.shrink_to_fit();
+  InitBuckets();
+}
+
+void S2PreparedPolygon::InitBuckets() {
+  if (cells_.empty()) return;
+  const uint64_t lo = range_mins_.front().id();
+  const uint64_t span = cells_.back().range_max.id() - lo;
+  bucket_shift_ = 0;
+  while ((span >> bucket_shift_) >= cells_.size()) ++bucket_shift_;
+  const uint64_t num_buckets = (span >> bucket_shift_) + 1;
+  buckets_.resize(num_buckets + 1);
+  uint32_t i = 0;
+  for (uint64_t b = 0; b <= num_buckets; ++b) {
+    // Bucket starts beyond the last cell are clamped to the last cell.
+    const uint64_t start = (b == num_buckets) ? span : b << bucket_shift_;
+    while (i + 1 < cells_.size() && range_mins_[i + 1].id() - lo <= start) {
+      ++i;
+    }
+    buckets_[b] = i;
+  }
+}
+
+bool S2PreparedPolygon::Contains(const S2Point& p) const {
+  ABSL_DCHECK(S2::IsUnitLength(p));
+
+  // Find the last cell whose range_min() is at most the leaf cell containing
+  // "p", and check whether that cell actually contains it.  Only the cells
+  // that start within the target's bucket need to be searched.
+  if (cells_.empty()) return false;
+  const S2CellId target(p);
+  if (target < range_mins_.front() || target > cells_.back().range_max) {
+    return false;
+  }
+  const uint64_t b = (target.id() - range_mins_.front().id()) >> bucket_shift_;
+  const auto begin = range_mins_.begin() + buckets_[b];
+  const auto end = range_mins_.begin() + buckets_[b + 1] + 1;
+  const Cell& cell =
+      cells_[std::upper_bound(begin, end, target) - range_mins_.begin() - 1];
+  if (cell.range_max < target) return false;
+
+  // Test containment by drawing a line segment from the cell center to the
+  // given point and counting edge crossings (as in S2ContainsPointQuery).
+  bool inside = cell.contains_center;
+  if (cell.edges_begin == cell.edges_end) return inside;
+  // Consecutive edges usually form a chain, which lets the crosser reuse the
+  // orientation of each shared vertex.
+  S2EdgeCrosser crosser(&cell.center, &p);
+  for (uint32_t i = cell.edges_begin; i < cell.edges_end; ++i) {
+    const S2Shape::Edge& edge = edges_[i];
+    if (i == cell.edges_begin || edges_[i - 1].v1 != edge.v0) {
+      crosser.RestartAt(&edge.v0);
+    }
+    inside ^= crosser.EdgeOrVertexCrossing(&edge.v1);
+  }
+  return inside;
+}
+
+size_t S2PreparedPolygon::SpaceUsed() const {
+  return sizeof(*this) + range_mins_.capacity() * sizeof(range_mins_[0]) +
+         cells_.capacity() * sizeof(cells_[0]) +
+         buckets_.capacity() * sizeof(buckets_[0]) +
+         edges_.capacity() * sizeof(edges_[0]);
+}
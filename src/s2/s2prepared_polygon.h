@@ -0,0 +1,124 @@
+// Copyright 2024 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef S2_S2PREPARED_POLYGON_H_
+#define S2_S2PREPARED_POLYGON_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "s2/s2cell_id.h"
+#include "s2/s2point.h"
+#include "s2/s2polygon.h"
+#include "s2/s2shape.h"
+
+// S2PreparedPolygon is an immutable structure for answering point
+// containment queries against a fixed S2Polygon as quickly as possible.  It
+// is intended for applications that test very large numbers of points
+// against the same polygons.
+//
+// The polygon is decomposed into a flat, sorted array of disjoint S2Cells
+// (using a temporary MutableS2ShapeIndex with a small max_edges_per_cell),
+// where each cell is either entirely inside the polygon or intersects its
+// boundary.  Points in interior cells are answered without any edge tests,
+// points in boundary cells are tested against only the few edges that
+// intersect that cell, and points not in any cell are outside the polygon.
+// Each query therefore takes a single binary search plus a handful of edge
+// crossing tests.
+//
+// The results are identical to S2Polygon::Contains(S2Point), i.e. the
+// polygon is treated as semi-open.  The object does not refer to the
+// original polygon after construction, and it is thread-safe for concurrent
+// readers.
+//
+// Example usage:
+//
+//   S2PreparedPolygon prepared(polygon);
+//   for (const S2Point& p : points) {
+//     if (prepared.Contains(p)) ...
+//   }
+class S2PreparedPolygon {
+ public:
+  class Options {
+   public:
+    Options();
+
+    // The maximum number of edges per boundary cell.  Smaller values make
+    // queries faster at the expense of using more memory.  (Cells may
+    // contain more edges than this near vertices where many edges meet; see
+    // MutableS2ShapeIndex::Options::max_edges_per_cell.)
+    //
+    // DEFAULT: 4
+    int max_edges_per_cell() const { return max_edges_per_cell_; }
+    void set_max_edges_per_cell(int max_edges_per_cell);
+
+   private:
+    int max_edges_per_cell_;
+  };
+
+  // Creates an empty object (which contains no points) that can be
+  // initialized by calling Init().
+  S2PreparedPolygon() = default;
+
+  // Convenience constructor that calls Init().
+  explicit S2PreparedPolygon(const S2Polygon& polygon,
+                             const Options& options = Options());
+
+  // Initializes the object to answer queries for the given polygon.  The
+  // polygon does not need to outlive this object.
+  void Init(const S2Polygon& polygon, const Options& options = Options());
+
+  // Returns true if the polygon contains the given point.  This method gives
+  // the same results as S2Polygon::Contains(S2Point).
+  bool Contains(const S2Point& p) const;
+
+  // Returns the number of cells in the decomposition of the polygon.
+  int num_cells() const { return static_cast<int>(cells_.size()); }
+
+  // Returns the number of bytes used by this object.
+  size_t SpaceUsed() const;
+
+ private:
+  struct Cell {
+    S2CellId range_max;    // The last leaf cell covered by this cell.
+    S2Point center;        // The cell center (only set for boundary cells).
+    uint32_t edges_begin;  // The first edge of this cell in edges_.
+    uint32_t edges_end;    // One past the last edge of this cell.
+    bool contains_center;  // Whether the polygon contains the cell center.
+  };
+
+  // Builds "buckets_" once "range_mins_" and "cells_" are known.
+  void InitBuckets();
+
+  // The range_min() of each cell, kept separately from "cells_" so that the
+  // binary search that locates a point touches as little memory as possible.
+  std::vector<S2CellId> range_mins_;
+  std::vector<Cell> cells_;
+
+  // To avoid a binary search over all the cells, the range of leaf cell ids
+  // spanned by the polygon is divided into roughly num_cells() equal-sized
+  // buckets of 2**bucket_shift_ ids each, starting at range_mins_[0].
+  // buckets_[b] is the index of the last cell whose range_min() is at most
+  // the start of bucket "b", so the cell containing a leaf cell in bucket b
+  // (if any) is one of buckets_[b] .. buckets_[b + 1].
+  std::vector<uint32_t> buckets_;
+  int bucket_shift_ = 0;
+
+  // The edges of all boundary cells, stored consecutively.
+  std::vector<S2Shape::Edge> edges_;
+};
+
+#endif  // S2_S2PREPARED_POLYGON_H_
@@ -0,0 +1,87 @@
+// Copyright 2024 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "s2/s2prepared_polygon.h"
+
+#include <cstddef>
+#include <random>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+#include "s2/s2benchmark_testing.h"
+#include "s2/s2cap.h"
+#include "s2/s2point.h"
+#include "s2/s2polygon.h"
+#include "s2/s2random.h"
+
+using std::vector;
+
+namespace {
+
+constexpr int kNumQueryPoints = 10000;
+
+// Returns a polygon consisting of a single fractal loop with approximately
+// "num_edges" edges.
+S2Polygon MakeFractalPolygon(int num_edges) {
+  std::mt19937_64 bitgen(s2benchmark::kSeed);
+  return S2Polygon(s2benchmark::MakeFractalLoop(bitgen, num_edges));
+}
+
+// Returns query points sampled from a cap slightly larger than "polygon".
+vector<S2Point> MakeQueryPoints(const S2Polygon& polygon) {
+  std::mt19937_64 bitgen(s2benchmark::kSeed + 1);
+  S2Cap cap(polygon.GetCapBound().center(),
+            1.5 * s2benchmark::FractalRadius());
+  vector<S2Point> points;
+  for (int i = 0; i < kNumQueryPoints; ++i) {
+    points.push_back(s2random::SamplePoint(bitgen, cap));
+  }
+  return points;
+}
+
+// Baseline: S2Polygon::Contains(S2Point), which uses the polygon's own index.
+void BM_S2PolygonContainsPoint(benchmark::State& state) {
+  const S2Polygon polygon = MakeFractalPolygon(state.range(0));
+  const vector<S2Point> points = MakeQueryPoints(polygon);
+  size_t i = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(polygon.Contains(points[i]));
+    if (++i == points.size()) i = 0;
+  }
+}
+BENCHMARK(BM_S2PolygonContainsPoint)->Apply(s2benchmark::EdgeCounts);
+
+void BM_S2PreparedPolygonContains(benchmark::State& state) {
+  const S2Polygon polygon = MakeFractalPolygon(state.range(0));
+  const vector<S2Point> points = MakeQueryPoints(polygon);
+  const S2PreparedPolygon prepared(polygon);
+  size_t i = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(prepared.Contains(points[i]));
+    if (++i == points.size()) i = 0;
+  }
+}
+BENCHMARK(BM_S2PreparedPolygonContains)->Apply(s2benchmark::EdgeCounts);
+
+void BM_S2PreparedPolygonInit(benchmark::State& state) {
+  const S2Polygon polygon = MakeFractalPolygon(state.range(0));
+  for (auto _ : state) {
+    S2PreparedPolygon prepared(polygon);
+    benchmark::DoNotOptimize(prepared.num_cells());
+  }
+}
+BENCHMARK(BM_S2PreparedPolygonInit)->Apply(s2benchmark::EdgeCounts);
+
+}  // namespace
@@ -0,0 +1,115 @@
+// Copyright 2024 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "s2/s2prepared_polygon.h"
+
+#include <memory>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include "absl/log/log_streamer.h"
+#include "absl/random/random.h"
+#include "s2/s2cap.h"
+#include "s2/s2fractal.h"
+#include "s2/s2loop.h"
+#include "s2/s2point.h"
+#include "s2/s2polygon.h"
+#include "s2/s2random.h"
+#include "s2/s2testing.h"
+#include "s2/s2text_format.h"
+
+using std::make_unique;
+using std::unique_ptr;
+using std::vector;
+
+namespace {
+
+// Checks that "prepared" agrees with "polygon" at random points near the
+// polygon and at all of its vertices (which exercises the semi-open model).
+void ExpectSameAsPolygon(const S2Polygon& polygon,
+                         const S2PreparedPolygon& prepared,
+                         absl::BitGenRef bitgen) {
+  S2Cap cap = polygon.GetCapBound();
+  if (cap.is_empty() || cap.is_full()) cap = S2Cap::Full();
+  cap = S2Cap(cap.center(), 1.5 * cap.GetRadius());
+  for (int i = 0; i < 10000; ++i) {
+    S2Point p = s2random::SamplePoint(bitgen, cap);
+    ASSERT_EQ(prepared.Contains(p), polygon.Contains(p)) << p;
+  }
+  for (int i = 0; i < polygon.num_loops(); ++i) {
+    for (const S2Point& p : polygon.loop(i)->vertices_span()) {
+      ASSERT_EQ(prepared.Contains(p), polygon.Contains(p)) << p;
+    }
+  }
+}
+
+TEST(S2PreparedPolygon, EmptyAndFull) {
+  absl::BitGen bitgen;
+  S2PreparedPolygon uninitialized;
+  EXPECT_FALSE(uninitialized.Contains(S2Point(1, 0, 0)));
+  EXPECT_EQ(uninitialized.num_cells(), 0);
+
+  auto empty = s2textformat::MakePolygonOrDie("empty");
+  S2PreparedPolygon prepared_empty(*empty);
+  EXPECT_EQ(prepared_empty.num_cells(), 0);
+  ExpectSameAsPolygon(*empty, prepared_empty, bitgen);
+
+  auto full = s2textformat::MakePolygonOrDie("full");
+  S2PreparedPolygon prepared_full(*full);
+  ExpectSameAsPolygon(*full, prepared_full, bitgen);
+}
+
+TEST(S2PreparedPolygon, SharedVertices) {
+  absl::BitGen bitgen;
+  // Two loops that share a vertex, so that containment at that vertex
+  // depends on the semi-open vertex model.
+  auto polygon = s2textformat::MakePolygonOrDie("0:0, 0:2, 2:1; 0:2, 0:4, 2:3");
+  S2PreparedPolygon prepared(*polygon);
+  ExpectSameAsPolygon(*polygon, prepared, bitgen);
+}
+
+TEST(S2PreparedPolygon, MatchesPolygonContains) {
+  absl::BitGen bitgen(S2Testing::MakeTaggedSeedSeq(
+      "MATCHES_POLYGON_CONTAINS",
+      absl::LogInfoStreamer(__FILE__, __LINE__).stream()));
+  for (int iter = 0; iter < 10; ++iter) {
+    // Build a fractal shell with a smaller fractal hole.
+    S2Fractal fractal(bitgen);
+    fractal.SetLevelForApproxMaxEdges(absl::Uniform(bitgen, 10, 3000));
+    const auto frame = s2random::Frame(bitgen);
+    vector<unique_ptr<S2Loop>> loops;
+    loops.push_back(fractal.MakeLoop(frame, S2Testing::KmToAngle(1000)));
+    loops.push_back(fractal.MakeLoop(frame, S2Testing::KmToAngle(100)));
+    S2Polygon polygon(std::move(loops));
+    ASSERT_TRUE(polygon.IsValid());
+
+    S2PreparedPolygon::Options options;
+    options.set_max_edges_per_cell(absl::Uniform(bitgen, 1, 11));
+    S2PreparedPolygon prepared(polygon, options);
+    ExpectSameAsPolygon(polygon, prepared, bitgen);
+  }
+}
+
+TEST(S2PreparedPolygon, Reinit) {
+  absl::BitGen bitgen;
+  auto a = s2textformat::MakePolygonOrDie("0:0, 0:2, 2:1");
+  auto b = s2textformat::MakePolygonOrDie("10:10, 10:12, 12:11");
+  S2PreparedPolygon prepared(*a);
+  prepared.Init(*b);
+  ExpectSameAsPolygon(*b, prepared, bitgen);
+  EXPECT_GT(prepared.SpaceUsed(), sizeof(prepared));
+}
+
+}  // namespace
@@ -0,0 +1,210 @@
+// Copyright 2024 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "s2/s2prepared_shape_index.h"
+
+#include <cstddef>
+#include <vector>
+
+#include "absl/log/absl_check.h"
+#include "s2/s2boolean_operation.h"
+#include "s2/s2cell_id.h"
+#include "s2/s2cell_union.h"
+#include "s2/s2region_coverer.h"
+#include "s2/s2shape.h"
+#include "s2/s2shape_index.h"
+#include "s2/s2shape_index_region.h"
+
+using std::vector;
+
+namespace {
+
+// Returns true if the given polygon edge is known to have interior points
+// of "shape" immediately to its left, which is true unless the edge is
+// degenerate or has a sibling or duplicate edge.
+bool HasInteriorOnLeft(const S2Shape& shape, const S2Shape::Edge& edge) {
+  if (edge.IsDegenerate()) return false;
+  const S2Shape::Edge reversed = edge.Reversed();
+  int num_copies = 0;
+  for (int e = 0; e < shape.num_edges(); ++e) {
+    S2Shape::Edge other = shape.edge(e);
+    if (other == reversed) return false;
+    if (other == edge && ++num_copies > 1) return false;
+  }
+  return true;
+}
+
+// Returns true if the geometry of "index" is known to be non-empty under
+// any polygon and polyline model.  Degenerate geometry (e.g., polylines
+// consisting of degenerate edges or polygons consisting of sibling pairs)
+// may be empty under some models, so it does not count.  Only the first
+// non-degenerate edge of each polygon is checked, since each check costs
+// time proportional to the size of the polygon.
+bool IsNonEmpty(const S2ShapeIndex& index) {
+  for (int shape_id = 0; shape_id < index.num_shape_ids(); ++shape_id) {
+    const S2Shape* shape = index.shape(shape_id);
+    if (shape == nullptr) continue;
+    if (shape->dimension() == 0) {
+      if (shape->num_edges() > 0) return true;
+      continue;
+    }
+    if (shape->dimension() == 2 && shape->num_edges() == 0) {
+      if (shape->GetReferencePoint().contained) return true;  // Full.
+      continue;
+    }
+    for (int e = 0; e < shape->num_edges(); ++e) {
+      S2Shape::Edge edge = shape->edge(e);
+      if (edge.IsDegenerate()) continue;
+      if (shape->dimension() == 1 || HasInteriorOnLeft(*shape, edge)) {
+        return true;
+      }
+      break;
+    }
+  }
+  return false;
+}
+
+// Returns true if the given index cell is entirely contained by a polygon,
+// i.e. the polygon contains the cell center and has no edges nearby.
+bool IsPolygonInterior(const S2ShapeIndex& index,
+                       const S2ShapeIndexCell& cell) {
+  for (int s = 0; s < cell.num_clipped(); ++s) {
+    const S2ClippedShape& clipped = cell.clipped(s);
+    if (clipped.contains_center() && clipped.num_edges() == 0 &&
+        index.shape(clipped.shape_id())->dimension() == 2) {
+      return true;
+    }
+  }
+  return false;
+}
+
+}  // namespace
+
+S2PreparedShapeIndex::Options::Options() : max_cells_(1000) {}
+
+void S2PreparedShapeIndex::Options::set_max_cells(int max_cells) {
+  ABSL_DCHECK_GE(max_cells, 1);
+  max_cells_ = max_cells;
+}
+
+S2PreparedShapeIndex::S2PreparedShapeIndex(const S2ShapeIndex* index,
+                                           const Options& options) {
+  Init(index, options);
+}
+
+void S2PreparedShapeIndex::Init(const S2ShapeIndex* index,
+                                const Options& options) {
+  index_ = index;
+  options_ = options;
+
+  // Index cells where some polygon has no edges and contains the center are
+  // entirely inside A.  The index cells also cover A, but cells containing
+  // only a few edges can be much larger than the edges themselves, so they
+  // are refined using a covering of A.  (Both cover A, and therefore so does
+  // their intersection.)
+  vector<S2CellId> index_cells, index_interior;
+  for (S2ShapeIndex::Iterator it(index, S2ShapeIndex::BEGIN); !it.done();
+       it.Next()) {
+    index_cells.push_back(it.id());
+    if (IsPolygonInterior(*index, it.cell())) {
+      index_interior.push_back(it.id());
+    }
+  }
+  S2RegionCoverer coverer;
+  coverer.mutable_options()->set_max_cells(options.max_cells());
+  auto region = MakeS2ShapeIndexRegion(index);
+  interior_ = S2CellUnion(std::move(index_interior))
+                  .Union(coverer.GetInteriorCovering(region));
+  boundary_ = S2CellUnion(std::move(index_cells))
+                  .Intersection(coverer.GetCovering(region))
+                  .Difference(interior_);
+}
+
+bool S2PreparedShapeIndex::Intersects(const S2ShapeIndex& b) const {
+  // Every point of a geometry is contained by one of its index cells, so if
+  // no cell of B intersects the covering of A then the geometries are
+  // disjoint.
+  bool disjoint = true;
+  for (S2ShapeIndex::Iterator it(&b, S2ShapeIndex::BEGIN); !it.done();
+       it.Next()) {
+    if (IsInterior(it.id())) {
+      if (IsPolygonInterior(b, it.cell())) return true;
+      disjoint = false;
+    } else if (disjoint && IntersectsA(it.id())) {
+      disjoint = false;
+    }
+  }
+  if (disjoint) return false;
+  if (HasVertexInInterior(b)) return true;
+  return S2BooleanOperation::Intersects(*index_, b,
+                                        options_.boolean_options());
+}
+
+bool S2PreparedShapeIndex::Contains(const S2ShapeIndex& b) const {
+  // A contains B if every cell of B is inside the interior of A, and does
+  // not contain B if B is non-empty and disjoint from A.
+  bool inside = true, disjoint = true;
+  for (S2ShapeIndex::Iterator it(&b, S2ShapeIndex::BEGIN); !it.done();
+       it.Next()) {
+    if (IsInterior(it.id())) {
+      disjoint = false;
+    } else {
+      inside = false;
+      if (IntersectsA(it.id())) disjoint = false;
+    }
+    if (!inside && !disjoint) break;
+  }
+  if (inside) return true;
+  if (disjoint) {
+    if (IsNonEmpty(b)) return false;
+  } else {
+    // The cells of B's index can be much larger than B itself (e.g., when B
+    // straddles the boundary of a large cell), so also try a tighter
+    // covering of B.
+    S2RegionCoverer coverer;
+    if (interior_.Contains(coverer.GetCovering(MakeS2ShapeIndexRegion(&b)))) {
+      return true;
+    }
+  }
+  return S2BooleanOperation::Contains(*index_, b, options_.boolean_options());
+}
+
+size_t S2PreparedShapeIndex::SpaceUsed() const {
+  return sizeof(*this) +
+         (interior_.size() + boundary_.size()) * sizeof(S2CellId);
+}
+
+bool S2PreparedShapeIndex::HasVertexInInterior(const S2ShapeIndex& b) const {
+  // A vertex whose leaf cell is inside an interior cell is in the interior
+  // of A, so nearby points of B are points of A as well.  Such points exist
+  // for points, for polyline vertices with a non-degenerate edge, and for
+  // polygon vertices with an edge that has interior on its left.
+  for (int shape_id = 0; shape_id < b.num_shape_ids(); ++shape_id) {
+    const S2Shape* shape = b.shape(shape_id);
+    if (shape == nullptr) continue;
+    bool checked_polygon_edge = false;
+    for (int e = 0; e < shape->num_edges(); ++e) {
+      S2Shape::Edge edge = shape->edge(e);
+      if (shape->dimension() > 0 && edge.IsDegenerate()) continue;
+      if (!IsInterior(S2CellId(edge.v0))) continue;
+      if (shape->dimension() < 2) return true;
+      if (!checked_polygon_edge) {
+        if (HasInteriorOnLeft(*shape, edge)) return true;
+        checked_polygon_edge = true;
+      }
+    }
+  }
+  return false;
+}
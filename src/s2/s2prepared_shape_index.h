@@ -0,0 +1,144 @@
+// Copyright 2024 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef S2_S2PREPARED_SHAPE_INDEX_H_
+#define S2_S2PREPARED_SHAPE_INDEX_H_
+
+#include <cstddef>
+
+#include "s2/s2boolean_operation.h"
+#include "s2/s2cell_id.h"
+#include "s2/s2cell_union.h"
+#include "s2/s2shape_index.h"
+
+// S2PreparedShapeIndex evaluates the S2BooleanOperation predicates
+// Intersects() and Contains() between a fixed geometry "A" and many other
+// geometries "B".  It is intended for applications such as testing millions
+// of small polygons against one large polygon (e.g., a country), and is
+// similar to PreparedGeometry in GEOS.
+//
+// The cost of S2BooleanOperation grows with the number of edge chains in A
+// (e.g., islands), and it has a fixed overhead that dominates when B is
+// tiny.  This class instead caches a covering of A split into "interior"
+// cells (which are entirely inside some polygon of A) and "boundary" cells
+// (which may intersect the boundary of A).  Most predicates can then be
+// decided by looking up B in these coverings:
+//
+//  - If no cell of B's index intersects the covering, the geometries are
+//    disjoint.
+//  - If B's index cells or a small covering of B are contained by the
+//    interior cells, then A contains B.
+//  - If a point of B (e.g., one of its vertices) is in an interior cell,
+//    the geometries intersect.
+//
+// These rules are exact and do not depend on the polygon or polyline model.
+// All other cases (e.g., where B is near the boundary of A) fall back to
+// S2BooleanOperation, so the results are always identical to calling
+// S2BooleanOperation::Intersects() or Contains() with the same options.
+//
+// The object is thread-safe for concurrent readers.
+//
+// Example usage:
+//
+//   S2PreparedShapeIndex prepared(&country.index());
+//   for (const auto& b : small_polygons) {
+//     if (prepared.Intersects(b->index())) ...
+//   }
+class S2PreparedShapeIndex {
+ public:
+  class Options {
+   public:
+    Options();
+
+    // The options used to evaluate predicates with S2BooleanOperation when
+    // they cannot be decided from the coverings.
+    //
+    // DEFAULT: S2BooleanOperation::Options()
+    const S2BooleanOperation::Options& boolean_options() const {
+      return boolean_options_;
+    }
+    S2BooleanOperation::Options* mutable_boolean_options() {
+      return &boolean_options_;
+    }
+
+    // The maximum number of cells in the coverings of A computed by
+    // S2RegionCoverer.  (The coverings also include the cells of A's index,
+    // so they may be larger than this.)  Larger values allow more predicates
+    // to be decided without S2BooleanOperation, at the expense of using more
+    // memory and taking longer to initialize.
+    //
+    // DEFAULT: 1000
+    int max_cells() const { return max_cells_; }
+    void set_max_cells(int max_cells);
+
+   private:
+    S2BooleanOperation::Options boolean_options_;
+    int max_cells_;
+  };
+
+  // Creates an empty object that must be initialized by calling Init().
+  S2PreparedShapeIndex() = default;
+
+  // Convenience constructor that calls Init().
+  explicit S2PreparedShapeIndex(const S2ShapeIndex* index,
+                                const Options& options = Options());
+
+  // Initializes the object to evaluate predicates against the given index
+  // using the given options.  This builds the index if necessary.
+  //
+  // REQUIRES: "index" persists for the lifetime of this object and is not
+  //           modified.
+  void Init(const S2ShapeIndex* index, const Options& options = Options());
+
+  const S2ShapeIndex& index() const { return *index_; }
+  const Options& options() const { return options_; }
+
+  // Returns cells that are entirely inside a polygon of A.
+  const S2CellUnion& interior_covering() const { return interior_; }
+
+  // Returns the remaining cells of the covering of A.  Together with
+  // interior_covering() these cells cover A.
+  const S2CellUnion& boundary_covering() const { return boundary_; }
+
+  // Returns true if A intersects "b".  Equivalent to
+  // S2BooleanOperation::Intersects(index(), b, options().boolean_options()).
+  bool Intersects(const S2ShapeIndex& b) const;
+
+  // Returns true if A contains "b".  Equivalent to
+  // S2BooleanOperation::Contains(index(), b, options().boolean_options()).
+  bool Contains(const S2ShapeIndex& b) const;
+
+  // Returns the number of bytes used by the cached coverings.
+  size_t SpaceUsed() const;
+
+ private:
+  // Returns true if "id" is contained by an interior cell of A.
+  bool IsInterior(S2CellId id) const { return interior_.Contains(id); }
+
+  // Returns true if "id" intersects the covering of A.
+  bool IntersectsA(S2CellId id) const {
+    return interior_.Intersects(id) || boundary_.Intersects(id);
+  }
+
+  // Returns true if some vertex of "b" is known to be in both A and B.
+  bool HasVertexInInterior(const S2ShapeIndex& b) const;
+
+  const S2ShapeIndex* index_ = nullptr;
+  Options options_;
+  S2CellUnion interior_;
+  S2CellUnion boundary_;
+};
+
+#endif  // S2_S2PREPARED_SHAPE_INDEX_H_
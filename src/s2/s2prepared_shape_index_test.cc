@@ -0,0 +1,170 @@
+// Copyright 2024 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "s2/s2prepared_shape_index.h"
+
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include "absl/log/log_streamer.h"
+#include "absl/random/random.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "s2/util/math/matrix3x3.h"
+#include "s2/mutable_s2shape_index.h"
+#include "s2/s1angle.h"
+#include "s2/s2boolean_operation.h"
+#include "s2/s2cap.h"
+#include "s2/s2cell.h"
+#include "s2/s2cell_id.h"
+#include "s2/s2fractal.h"
+#include "s2/s2latlng.h"
+#include "s2/s2lax_polyline_shape.h"
+#include "s2/s2loop.h"
+#include "s2/s2point.h"
+#include "s2/s2pointutil.h"
+#include "s2/s2point_vector_shape.h"
+#include "s2/s2polygon.h"
+#include "s2/s2random.h"
+#include "s2/s2testing.h"
+#include "s2/s2text_format.h"
+
+using absl::string_view;
+using std::make_unique;
+using std::unique_ptr;
+using std::vector;
+
+using PolygonModel = S2BooleanOperation::PolygonModel;
+using PolylineModel = S2BooleanOperation::PolylineModel;
+
+namespace {
+
+// Checks that S2PreparedShapeIndex gives the same results as
+// S2BooleanOperation for the given geometry under every polygon and
+// polyline model.
+void ExpectSameResults(const S2ShapeIndex& a, const S2ShapeIndex& b) {
+  for (auto polygon_model :
+       {PolygonModel::OPEN, PolygonModel::SEMI_OPEN, PolygonModel::CLOSED}) {
+    for (auto polyline_model : {PolylineModel::OPEN, PolylineModel::SEMI_OPEN,
+                                PolylineModel::CLOSED}) {
+      for (int max_cells : {1, 1000}) {
+        S2PreparedShapeIndex::Options options;
+        options.mutable_boolean_options()->set_polygon_model(polygon_model);
+        options.mutable_boolean_options()->set_polyline_model(polyline_model);
+        options.set_max_cells(max_cells);
+        S2PreparedShapeIndex prepared(&a, options);
+        SCOPED_TRACE(absl::StrCat(static_cast<int>(polygon_model), " ",
+                                  static_cast<int>(polyline_model), " ",
+                                  max_cells));
+        EXPECT_EQ(S2BooleanOperation::Intersects(a, b,
+                                                 options.boolean_options()),
+                  prepared.Intersects(b));
+        EXPECT_EQ(
+            S2BooleanOperation::Contains(a, b, options.boolean_options()),
+            prepared.Contains(b));
+      }
+    }
+  }
+}
+
+// Returns a polygon with many edges (so that its index has interior cells)
+// centered at the given point.
+unique_ptr<S2Polygon> MakeLargePolygon(const S2Point& center) {
+  return make_unique<S2Polygon>(
+      S2Loop::MakeRegularLoop(center, S1Angle::Degrees(5), 1000));
+}
+
+TEST(S2PreparedShapeIndex, Coverings) {
+  auto polygon = MakeLargePolygon(S2LatLng::FromDegrees(10, 10).ToPoint());
+  S2PreparedShapeIndex prepared(&polygon->index());
+  EXPECT_FALSE(prepared.interior_covering().empty());
+  EXPECT_FALSE(prepared.boundary_covering().empty());
+  EXPECT_FALSE(
+      prepared.interior_covering().Intersects(prepared.boundary_covering()));
+  EXPECT_TRUE(prepared.interior_covering().Contains(
+      S2CellId(S2LatLng::FromDegrees(10, 10).ToPoint())));
+  for (const S2CellId id : prepared.interior_covering()) {
+    EXPECT_TRUE(polygon->Contains(S2Cell(id)));
+  }
+  EXPECT_GT(prepared.SpaceUsed(), sizeof(prepared));
+}
+
+TEST(S2PreparedShapeIndex, EmptyAndFull) {
+  auto empty = s2textformat::MakeIndexOrDie("# #");
+  auto full = s2textformat::MakeIndexOrDie("# # full");
+  auto point = s2textformat::MakeIndexOrDie("1:1 # #");
+  for (const auto* a : {empty.get(), full.get(), point.get()}) {
+    for (const auto* b : {empty.get(), full.get(), point.get()}) {
+      ExpectSameResults(*a, *b);
+    }
+  }
+}
+
+TEST(S2PreparedShapeIndex, DegenerateGeometry) {
+  // Geometry inside an interior cell that may or may not be empty depending
+  // on the polygon or polyline model.
+  auto polygon = MakeLargePolygon(S2LatLng::FromDegrees(0, 0).ToPoint());
+  for (string_view str :
+       {"# # 0.1:0.1", "# # 0.1:0.1, 0.1:0.2", "# 0.1:0.1, 0.1:0.1 #",
+        "# 0.1:0.1, 0.1:0.2 #", "0.1:0.1 # #",
+        "# # 0.1:0.1, 0.1:0.2, 0.2:0.1",
+        "# # 0.1:0.1, 0.1:0.2, 0.2:0.1; 0.1:0.1, 0.2:0.1, 0.1:0.2",
+        "# # 0.1:0.1, 0.1:0.2; 10:10, 10:11, 11:10"}) {
+    SCOPED_TRACE(str);
+    auto b = s2textformat::MakeIndexOrDie(str);
+    ExpectSameResults(polygon->index(), *b);
+  }
+}
+
+TEST(S2PreparedShapeIndex, MatchesBooleanOperation) {
+  absl::BitGen bitgen(S2Testing::MakeTaggedSeedSeq(
+      "PREPARED_SHAPE_INDEX",
+      absl::LogInfoStreamer(__FILE__, __LINE__).stream()));
+  S2Fractal fractal(bitgen);
+  fractal.SetLevelForApproxMaxEdges(3000);
+  const S2Point center = s2random::Point(bitgen);
+  const Matrix3x3_d frame = S2::GetFrame(center);
+  vector<unique_ptr<S2Loop>> loops;
+  loops.push_back(fractal.MakeLoop(frame, S1Angle::Degrees(10)));
+  loops.push_back(S2Loop::MakeRegularLoop(center, S1Angle::Degrees(1), 100));
+  S2Polygon polygon;
+  polygon.InitNested(std::move(loops));
+  ASSERT_EQ(2, polygon.num_loops());
+
+  const S2Cap cap(center, S1Angle::Degrees(15));
+  for (int iter = 0; iter < 100; ++iter) {
+    const S2Point b_center = s2random::SamplePoint(bitgen, cap);
+    const S1Angle radius = S1Angle::Degrees(absl::Uniform(bitgen, 0.01, 2.0));
+    MutableS2ShapeIndex b;
+    switch (iter % 3) {
+      case 0:
+        b.Add(make_unique<S2Polygon::OwningShape>(make_unique<S2Polygon>(
+            S2Loop::MakeRegularLoop(b_center, radius, 8))));
+        break;
+      case 1:
+        b.Add(make_unique<S2LaxPolylineShape>(vector<S2Point>{
+            b_center, s2random::SamplePoint(bitgen, S2Cap(b_center, radius))}));
+        break;
+      default:
+        b.Add(make_unique<S2PointVectorShape>(vector<S2Point>{b_center}));
+        break;
+    }
+    ExpectSameResults(polygon.index(), b);
+  }
+}
+
+}  // namespace
@@ -18,7 +18,10 @@
 #include "s2/s2projections.h"
 
 #include <cmath>
+#include <cstddef>
 
+#include "absl/log/absl_check.h"
+#include "absl/types/span.h"
 #include "s2/r2.h"
 #include "s2/s1angle.h"
 #include "s2/s2latlng.h"
@@ -50,6 +53,18 @@ R2Point Projection::Interpolate(double f,
   return (1 - f) * a + f * b;
 }
 
+void Projection::ProjectPoints(absl::Span<const S2Point> points,
+                               absl::Span<R2Point> results) const {
+  ABSL_DCHECK_EQ(points.size(), results.size());
+  for (size_t i = 0; i < points.size(); ++i) results[i] = Project(points[i]);
+}
+
+void Projection::UnprojectPoints(absl::Span<const R2Point> points,
+                                 absl::Span<S2Point> results) const {
+  ABSL_DCHECK_EQ(points.size(), results.size());
+  for (size_t i = 0; i < points.size(); ++i) results[i] = Unproject(points[i]);
+}
+
 PlateCarreeProjection::PlateCarreeProjection(double x_scale)
     : x_wrap_(2 * x_scale),
       to_radians_(M_PI / x_scale),
@@ -78,6 +93,22 @@ R2Point PlateCarreeProjection::wrap_distance() const {
   return R2Point(x_wrap_, 0);
 }
 
+void PlateCarreeProjection::ProjectPoints(absl::Span<const S2Point> points,
+                                          absl::Span<R2Point> results) const {
+  ABSL_DCHECK_EQ(points.size(), results.size());
+  for (size_t i = 0; i < points.size(); ++i) {
+    results[i] = PlateCarreeProjection::Project(points[i]);
+  }
+}
+
+void PlateCarreeProjection::UnprojectPoints(absl::Span<const R2Point> points,
+                                            absl::Span<S2Point> results) const {
+  ABSL_DCHECK_EQ(points.size(), results.size());
+  for (size_t i = 0; i < points.size(); ++i) {
+    results[i] = PlateCarreeProjection::Unproject(points[i]);
+  }
+}
+
 MercatorProjection::MercatorProjection(double max_x)
     : x_wrap_(2 * max_x),
       to_radians_(M_PI / max_x),
@@ -112,4 +143,44 @@ R2Point MercatorProjection::wrap_distance() const {
   return R2Point(x_wrap_, 0);
 }
 
+void MercatorProjection::ProjectPoints(absl::Span<const S2Point> points,
+                                       absl::Span<R2Point> results) const {
+  ABSL_DCHECK_EQ(points.size(), results.size());
+  for (size_t i = 0; i < points.size(); ++i) {
+    const S2Point& p = points[i];
+    // Let r = sqrt(x^2 + y^2) and n = |p|, so that sin(lat) = z / n.  Then
+    //   0.5 * log((1 + sin(lat)) / (1 - sin(lat))) = log((n + z) / r)
+    //                                             = log1p((n - r + z) / r)
+    // for z >= 0, where n - r = z^2 / (n + r), and the function is odd in z.
+    // This avoids cancellation both near the equator and near the poles.  At
+    // the poles r == 0 and the "y" coordinate is infinite, as with Project().
+    double z = fabs(p.z());
+    double r = sqrt(p.x() * p.x() + p.y() * p.y());
+    double n = sqrt(r * r + z * z);
+    double y = std::copysign(log1p((z * z / (n + r) + z) / r), p.z());
+    double lng = S2LatLng::Longitude(p).radians();
+    results[i] = R2Point(from_radians_ * lng, from_radians_ * y);
+  }
+}
+
+void MercatorProjection::UnprojectPoints(absl::Span<const R2Point> points,
+                                         absl::Span<S2Point> results) const {
+  ABSL_DCHECK_EQ(points.size(), results.size());
+  for (size_t i = 0; i < points.size(); ++i) {
+    const R2Point& p = points[i];
+    // With e = exp(y) and k = e^2, sin(lat) = (k - 1) / (k + 1) and
+    // cos(lat) = 2 * e / (k + 1), so there is no need to compute the latitude.
+    double e = exp(to_radians_ * p.y());
+    double k = e * e;
+    double sin_lat = 1, cos_lat = 0;
+    if (!std::isinf(k)) {
+      sin_lat = (k - 1) / (k + 1);
+      cos_lat = 2 * e / (k + 1);
+    }
+    S1Angle::SinCosPair lng =
+        S1Angle::Radians(to_radians_ * remainder(p.x(), x_wrap_)).SinCos();
+    results[i] = S2Point(lng.cos * cos_lat, lng.sin * cos_lat, sin_lat);
+  }
+}
+
 }  // namespace S2
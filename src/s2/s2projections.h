@@ -24,6 +24,7 @@
 
 #include <cmath>
 
+#include "absl/types/span.h"
 #include "s2/r2.h"
 #include "s2/s2latlng.h"
 #include "s2/s2point.h"
@@ -54,6 +55,19 @@ class Projection {
   // implementation may be more efficient.
   virtual S2LatLng ToLatLng(const R2Point& p) const = 0;
 
+  // Batch versions of Project() and Unproject() that set results[i] to the
+  // conversion of points[i].  The default implementations simply call the
+  // single-point methods, but subclasses can provide faster versions that
+  // avoid per-point virtual calls or use cheaper formulas.  Such versions
+  // must agree with the single-point methods up to a small rounding error,
+  // which is documented by each subclass.
+  //
+  // REQUIRES: results.size() == points.size()
+  virtual void ProjectPoints(absl::Span<const S2Point> points,
+                             absl::Span<R2Point> results) const;
+  virtual void UnprojectPoints(absl::Span<const R2Point> points,
+                               absl::Span<S2Point> results) const;
+
   // Returns the point obtained by interpolating the given fraction of the
   // distance along the line from A to B.  Almost all projections should
   // use the default implementation of this method, which simply interpolates
@@ -118,6 +132,13 @@ class PlateCarreeProjection final : public Projection {
   S2LatLng ToLatLng(const R2Point& p) const override;
   R2Point wrap_distance() const override;
 
+  // These methods return exactly the same results as Project() and
+  // Unproject(), but avoid a virtual call per point.
+  void ProjectPoints(absl::Span<const S2Point> points,
+                     absl::Span<R2Point> results) const override;
+  void UnprojectPoints(absl::Span<const R2Point> points,
+                       absl::Span<S2Point> results) const override;
+
  private:
   double x_wrap_;
   double to_radians_;    // Multiplier to convert coordinates to radians.
@@ -151,6 +172,18 @@ class MercatorProjection final : public Projection {
   S2LatLng ToLatLng(const R2Point& p) const override;
   R2Point wrap_distance() const override;
 
+  // These methods compute the projection directly from the point
+  // coordinates (and vice versa) rather than via an S2LatLng, which saves
+  // about half of the transcendental function calls.  Unprojected points
+  // agree with Unproject() to within 1e-15 radians.  Projected points agree
+  // with Project() to within a relative error of 1e-14 except near the
+  // poles, where these methods are more accurate than Project() since they
+  // avoid computing (1 - sin(lat)).
+  void ProjectPoints(absl::Span<const S2Point> points,
+                     absl::Span<R2Point> results) const override;
+  void UnprojectPoints(absl::Span<const R2Point> points,
+                       absl::Span<S2Point> results) const override;
+
  private:
   double x_wrap_;
   double to_radians_;    // Multiplier to convert coordinates to radians.
@@ -17,14 +17,20 @@
 
 #include "s2/s2projections.h"
 
+#include <cmath>
 #include <limits>
 #include <string>
+#include <vector>
 
 #include <gtest/gtest.h>
+#include "absl/log/log_streamer.h"
+#include "absl/random/random.h"
 #include "s2/r2.h"
 #include "s2/s2latlng.h"
 #include "s2/s2point.h"
 #include "s2/s2pointutil.h"
+#include "s2/s2random.h"
+#include "s2/s2testing.h"
 
 namespace S2 {
 
@@ -78,4 +84,65 @@ TEST(MercatorProjection, ProjectUnproject) {
                        S2LatLng::FromRadians(1, 0).ToPoint());
 }
 
+// Checks that UnprojectPoints() inverts ProjectPoints(), and that both agree
+// with the single-point methods away from the poles (where Project() and
+// Unproject() lose accuracy for the Mercator projection).
+void TestBatchMethods(const Projection& projection, double max_r2_error) {
+  absl::BitGen bitgen(S2Testing::MakeTaggedSeedSeq(
+      "TEST_BATCH_METHODS",
+      absl::LogInfoStreamer(__FILE__, __LINE__).stream()));
+  std::vector<S2Point> points = {S2Point(1, 0, 0), S2Point(-1, 0, 0),
+                                 S2Point(0, 0, 1), S2Point(0, 0, -1)};
+  for (int i = 0; i < 1000; ++i) points.push_back(s2random::Point(bitgen));
+  std::vector<R2Point> projected(points.size());
+  std::vector<S2Point> unprojected(points.size());
+  projection.ProjectPoints(points, absl::MakeSpan(projected));
+  projection.UnprojectPoints(projected, absl::MakeSpan(unprojected));
+  const S1Angle kMaxS2Error = S1Angle::Radians(1e-15);
+  for (int i = 0; i < points.size(); ++i) {
+    EXPECT_TRUE(S2::ApproxEquals(unprojected[i], points[i], kMaxS2Error))
+        << points[i];
+    R2Point expected = projection.Project(points[i]);
+    if (std::isinf(expected.y())) {
+      EXPECT_EQ(projected[i], expected);
+      continue;
+    }
+    if (fabs(points[i].z()) > 0.99) continue;
+    for (int j = 0; j < 2; ++j) {
+      EXPECT_NEAR(projected[i][j], expected[j],
+                  max_r2_error * std::max(1.0, fabs(expected[j])))
+          << points[i];
+    }
+    EXPECT_TRUE(S2::ApproxEquals(
+        unprojected[i], projection.Unproject(projected[i]), kMaxS2Error))
+        << projected[i];
+  }
+}
+
+TEST(PlateCarreeProjection, BatchMethods) {
+  TestBatchMethods(PlateCarreeProjection(180), 0);
+}
+
+TEST(MercatorProjection, BatchMethods) {
+  TestBatchMethods(MercatorProjection(180), 1e-14);
+}
+
+TEST(MercatorProjection, BatchMethodsNearPole) {
+  // Project() and Unproject() lose accuracy near the poles, but the batch
+  // methods do not.
+  MercatorProjection proj(180);
+  S2Point point = S2LatLng::FromDegrees(89.9999, 10).ToPoint();
+  // Compute log(tan(pi/4 + lat/2)) = log((|p| + z) / sqrt(x^2 + y^2)) in
+  // extended precision.
+  long double x = point.x(), y = point.y(), z = point.z();
+  long double r = std::sqrt(x * x + y * y);
+  double expected_y = 180 / M_PI * std::log((std::sqrt(r * r + z * z) + z) / r);
+  R2Point projected;
+  proj.ProjectPoints({&point, 1}, {&projected, 1});
+  EXPECT_NEAR(projected.y(), expected_y, 1e-14 * expected_y);
+  S2Point unprojected;
+  proj.UnprojectPoints({&projected, 1}, {&unprojected, 1});
+  EXPECT_TRUE(S2::ApproxEquals(unprojected, point, S1Angle::Radians(1e-15)));
+}
+
 }  //  namespace S2
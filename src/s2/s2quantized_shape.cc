@@ -0,0 +1,121 @@
+// Copyright 2024 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#include "s2/s2quantized_shape.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+#include "absl/log/absl_check.h"
+#include "s2/s2cell_id.h"
+#include "s2/s2point.h"
+#include "s2/s2shape.h"
+#include "s2/s2shapeutil_get_reference_point.h"
+
+using std::vector;
+
+S2QuantizedShape::S2QuantizedShape(const S2Shape& shape) { Init(shape); }
+
+void S2QuantizedShape::Init(const S2Shape& shape) {
+  dimension_ = shape.dimension();
+  vertices_.clear();
+  chain_starts_.clear();
+  if (dimension_ == 0) {
+    vertices_.reserve(shape.num_edges());
+    for (int e = 0; e < shape.num_edges(); ++e) {
+      vertices_.push_back(S2CellId(shape.edge(e).v0));
+    }
+    return;
+  }
+  vertices_.reserve(shape.num_edges() +
+                    (dimension_ == 1 ? shape.num_chains() : 0));
+  chain_starts_.reserve(shape.num_chains() + 1);
+  int num_edges = 0;
+  for (int i = 0; i < shape.num_chains(); ++i) {
+    const S2Shape::Chain chain = shape.chain(i);
+    if (dimension_ == 1 && chain.length == 0) continue;
+    chain_starts_.push_back(num_edges);
+    for (int j = 0; j < chain.length; ++j) {
+      vertices_.push_back(S2CellId(shape.chain_edge(i, j).v0));
+    }
+    if (dimension_ == 1) {
+      vertices_.push_back(S2CellId(shape.chain_edge(i, chain.length - 1).v1));
+    }
+    num_edges += chain.length;
+  }
+  chain_starts_.push_back(num_edges);
+}
+
+size_t S2QuantizedShape::SpaceUsed() const {
+  return sizeof(*this) + vertices_.capacity() * sizeof(S2CellId) +
+         chain_starts_.capacity() * sizeof(int);
+}
+
+int S2QuantizedShape::num_edges() const {
+  if (dimension_ == 0) return num_vertices();
+  return chain_starts_.empty() ? 0 : chain_starts_.back();
+}
+
+S2Shape::Edge S2QuantizedShape::edge(int e) const {
+  ABSL_DCHECK_LT(e, num_edges());
+  if (dimension_ == 0) {
+    const S2Point p = vertex(e);
+    return Edge(p, p);
+  }
+  const ChainPosition pos = chain_position(e);
+  return chain_edge(pos.chain_id, pos.offset);
+}
+
+S2Shape::ReferencePoint S2QuantizedShape::GetReferencePoint() const {
+  if (dimension_ < 2) return ReferencePoint::Contained(false);
+  return s2shapeutil::GetReferencePoint(*this);
+}
+
+int S2QuantizedShape::num_chains() const {
+  if (dimension_ == 0) return num_vertices();
+  return std::max(0, static_cast<int>(chain_starts_.size()) - 1);
+}
+
+S2Shape::Chain S2QuantizedShape::chain(int i) const {
+  ABSL_DCHECK_LT(i, num_chains());
+  if (dimension_ == 0) return Chain(i, 1);
+  return Chain(chain_starts_[i], chain_starts_[i + 1] - chain_starts_[i]);
+}
+
+S2Shape::Edge S2QuantizedShape::chain_edge(int i, int j) const {
+  ABSL_DCHECK_LT(i, num_chains());
+  if (dimension_ == 0) {
+    const S2Point p = vertex(i);
+    return Edge(p, p);
+  }
+  const int start = chain_vertex_start(i);
+  const int length = chain_starts_[i + 1] - chain_starts_[i];
+  ABSL_DCHECK_LT(j, length);
+  const int k = (dimension_ == 2 && j + 1 == length) ? 0 : j + 1;
+  return Edge(vertex(start + j), vertex(start + k));
+}
+
+S2Shape::ChainPosition S2QuantizedShape::chain_position(int e) const {
+  ABSL_DCHECK_LT(e, num_edges());
+  if (dimension_ == 0) return ChainPosition(e, 0);
+  // Find the last chain that starts at or before edge "e".  (Only the full
+  // loop has no edges, and it is the only chain in that case.)
+  const int i = std::upper_bound(chain_starts_.begin(), chain_starts_.end(),
+                                 e) -
+                chain_starts_.begin() - 1;
+  return ChainPosition(i, e - chain_starts_[i]);
+}
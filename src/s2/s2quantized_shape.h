@@ -0,0 +1,106 @@
+// Copyright 2024 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#ifndef S2_S2QUANTIZED_SHAPE_H_
+#define S2_S2QUANTIZED_SHAPE_H_
+
+#include <cstddef>
+#include <vector>
+
+#include "s2/s2cell_id.h"
+#include "s2/s2point.h"
+#include "s2/s2shape.h"
+
+// S2QuantizedShape is an S2Shape that stores each vertex as the S2CellId of
+// the leaf cell containing it (8 bytes) rather than as an S2Point (24 bytes),
+// and converts it back to the cell center when the vertex is accessed.  This
+// reduces the memory used by vertices by a factor of 3, which is useful for
+// keeping large amounts of geometry resident in an S2ShapeIndex when
+// centimeter precision is sufficient.
+//
+// Precision: each vertex is moved to the center of its leaf cell, i.e. by at
+// most S2::kMaxDiag.GetValue(S2CellId::kMaxLevel) / 2 (about 1.2e-9 radians
+// or 7 mm on the Earth's surface).  Single-precision (float32) coordinates
+// would use 12 bytes per vertex and have an error of about 6e-8 radians, so
+// they are both larger and less accurate than this representation.
+//
+// Consistency: vertices are reconstructed by the same deterministic
+// computation every time they are accessed, so all S2 predicates and
+// algorithms see a single, consistent geometry.  The shape is exactly
+// equivalent to an S2PointVectorShape, S2LaxPolylineShape (or a collection of
+// them), or S2LaxPolygonShape whose vertices are the leaf cell centers.  Note
+// that quantization may create degenerate edges (where adjacent vertices are
+// in the same leaf cell), and may create self-intersections in features
+// smaller than the error bound above.  These are allowed by the "lax" shape
+// semantics but would not be valid in S2Polygon or S2Polyline.
+//
+// This class is intended for in-memory use and does not support encoding;
+// to encode the geometry compactly, use the corresponding lax shapes with
+// s2coding::CodingHint::COMPACT (which stores cell center vertices in fewer
+// than 8 bytes each).
+class S2QuantizedShape : public S2Shape {
+ public:
+  // Constructs an empty shape of dimension 0.
+  S2QuantizedShape() = default;
+
+  // Convenience constructor that calls Init().
+  explicit S2QuantizedShape(const S2Shape& shape);
+
+  // Initializes the shape with the quantized vertices of the given shape,
+  // which must have the structure of one of the lax shape types (e.g.,
+  // S2PointVectorShape, S2LaxPolylineShape, S2LaxPolygonShape, S2Polyline,
+  // or S2Polygon shapes).  Each polyline chain is converted to a sequence of
+  // vertices and each polygon chain to a loop, so chains with no edges are
+  // discarded for polylines and represent the full loop for polygons.
+  void Init(const S2Shape& shape);
+
+  // Returns the total number of vertices in all chains.
+  int num_vertices() const { return static_cast<int>(vertices_.size()); }
+
+  // Returns vertex "i" of the concatenation of all chains.
+  S2Point vertex(int i) const { return vertices_[i].ToPoint(); }
+
+  // Returns the leaf cell that stores vertex "i".
+  S2CellId vertex_cell_id(int i) const { return vertices_[i]; }
+
+  // Returns the number of bytes used by this shape.
+  size_t SpaceUsed() const;
+
+  // S2Shape interface:
+  int num_edges() const final;
+  Edge edge(int e) const final;
+  int dimension() const final { return dimension_; }
+  ReferencePoint GetReferencePoint() const final;
+  int num_chains() const final;
+  Chain chain(int i) const final;
+  Edge chain_edge(int i, int j) const final;
+  ChainPosition chain_position(int e) const final;
+
+ private:
+  // Returns the index of the first vertex of chain "i".
+  int chain_vertex_start(int i) const {
+    return chain_starts_[i] + (dimension_ == 1 ? i : 0);
+  }
+
+  int dimension_ = 0;
+  std::vector<S2CellId> vertices_;
+
+  // For dimensions 1 and 2, the first edge id of each chain followed by
+  // num_edges().  (Points have one chain per vertex.)
+  std::vector<int> chain_starts_;
+};
+
+#endif  // S2_S2QUANTIZED_SHAPE_H_
@@ -0,0 +1,131 @@
+// Copyright 2024 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#include "s2/s2quantized_shape.h"
+
+#include <memory>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include "absl/strings/string_view.h"
+#include "s2/mutable_s2shape_index.h"
+#include "s2/s2cell_id.h"
+#include "s2/s2edge_vector_shape.h"
+#include "s2/s2latlng.h"
+#include "s2/s2lax_polygon_shape.h"
+#include "s2/s2lax_polyline_shape.h"
+#include "s2/s2metrics.h"
+#include "s2/s2point.h"
+#include "s2/s2point_vector_shape.h"
+#include "s2/s2shape.h"
+#include "s2/s2shapeutil_testing.h"
+#include "s2/s2text_format.h"
+
+using absl::string_view;
+using std::make_unique;
+using std::vector;
+
+namespace {
+
+// Returns the given vertices moved to the centers of their leaf cells.
+vector<S2Point> Quantize(const vector<S2Point>& vertices) {
+  vector<S2Point> result;
+  for (const S2Point& p : vertices) result.push_back(S2CellId(p).ToPoint());
+  return result;
+}
+
+TEST(S2QuantizedShape, Empty) {
+  S2QuantizedShape shape;
+  EXPECT_EQ(0, shape.dimension());
+  EXPECT_EQ(0, shape.num_edges());
+  EXPECT_EQ(0, shape.num_chains());
+  EXPECT_TRUE(shape.is_empty());
+}
+
+TEST(S2QuantizedShape, Points) {
+  const vector<S2Point> points =
+      s2textformat::ParsePointsOrDie("0:0, 0.1:45.123456789, -89.99:179.99");
+  const S2QuantizedShape shape{S2PointVectorShape(points)};
+  s2testing::ExpectEqual(S2PointVectorShape(Quantize(points)), shape);
+  for (int i = 0; i < shape.num_vertices(); ++i) {
+    EXPECT_LE(shape.vertex(i).Angle(points[i]),
+              S2::kMaxDiag.GetValue(S2CellId::kMaxLevel) / 2);
+  }
+}
+
+TEST(S2QuantizedShape, Polyline) {
+  const vector<S2Point> vertices =
+      s2textformat::ParsePointsOrDie("0:0, 0:1e-12, 1:1, 2:1.5");
+  const S2QuantizedShape shape{S2LaxPolylineShape(vertices)};
+  s2testing::ExpectEqual(S2LaxPolylineShape(Quantize(vertices)), shape);
+
+  // The first two vertices are in the same leaf cell.
+  EXPECT_TRUE(shape.edge(0).IsDegenerate());
+
+  // A polyline with one vertex has no edges.
+  EXPECT_EQ(
+      0, S2QuantizedShape(*s2textformat::MakeLaxPolylineOrDie("1:1"))
+             .num_chains());
+}
+
+TEST(S2QuantizedShape, MultipleChains) {
+  const vector<S2Point> vertices =
+      s2textformat::ParsePointsOrDie("0:0, 0:1, 1:1, 2:2");
+  const S2QuantizedShape shape{S2EdgeVectorShape(
+      {{vertices[0], vertices[1]}, {vertices[2], vertices[3]}})};
+  const vector<S2Point> quantized = Quantize(vertices);
+  s2testing::ExpectEqual(
+      S2EdgeVectorShape(
+          {{quantized[0], quantized[1]}, {quantized[2], quantized[3]}}),
+      shape);
+}
+
+TEST(S2QuantizedShape, Polygons) {
+  for (string_view str : {"empty", "full", "0:0, 0:1, 1:0",
+                          "0:0, 0:3, 3:0; 1:1, 2:1, 1:2",
+                          "0:0, 0:1, 1:1, 1:0; 5:5; 7:7, 8:8"}) {
+    SCOPED_TRACE(str);
+    const auto lax = s2textformat::MakeLaxPolygonOrDie(str);
+    vector<S2LaxPolygonShape::Loop> loops;
+    for (int i = 0; i < lax->num_loops(); ++i) {
+      vector<S2Point> loop;
+      for (int j = 0; j < lax->num_loop_vertices(i); ++j) {
+        loop.push_back(lax->loop_vertex(i, j));
+      }
+      loops.push_back(Quantize(loop));
+    }
+    const S2LaxPolygonShape expected(loops);
+    const S2QuantizedShape shape(*lax);
+    s2testing::ExpectEqual(expected, shape);
+
+    // Indexes containing the two shapes are identical as well.
+    MutableS2ShapeIndex expected_index, index;
+    expected_index.Add(make_unique<S2LaxPolygonShape>(loops));
+    index.Add(make_unique<S2QuantizedShape>(*lax));
+    s2testing::ExpectEqual(expected_index, index);
+  }
+}
+
+TEST(S2QuantizedShape, SpaceUsed) {
+  vector<S2Point> vertices;
+  for (int i = 0; i < 1000; ++i) {
+    vertices.push_back(S2LatLng::FromDegrees(i * 0.01, 0).ToPoint());
+  }
+  const S2QuantizedShape shape{S2LaxPolylineShape(vertices)};
+  EXPECT_LT(shape.SpaceUsed(), vertices.size() * sizeof(S2Point) / 2);
+}
+
+}  // namespace
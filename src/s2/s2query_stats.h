@@ -0,0 +1,87 @@
+// Copyright 2024 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef S2_S2QUERY_STATS_H_
+#define S2_S2QUERY_STATS_H_
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+
+#include "absl/strings/str_cat.h"
+
+// S2QueryStats counts the work done by S2ShapeIndex queries, in order to
+// understand why particular queries are slow and to tune index and query
+// parameters (e.g. MutableS2ShapeIndex::Options::max_edges_per_cell).  It is
+// populated by queries whose options have been given a pointer to it via
+// set_stats(), such as S2ClosestEdgeQuery and S2ContainsPointQuery.  The
+// counters accumulate across queries until Clear() is called.  Queries that
+// are not given a stats object do not pay for counting beyond a null check.
+//
+// Example usage:
+//
+//   S2QueryStats stats;
+//   S2ClosestEdgeQuery::Options options;
+//   options.set_stats(&stats);
+//   S2ClosestEdgeQuery query(&index, options);
+//   query.FindClosestEdge(&target);
+//   if (stats.edges_tested > 10000) ABSL_LOG(INFO) << stats.ToString();
+//
+// Like the queries themselves, this class is not thread-safe; each thread
+// should use its own S2QueryStats object.
+struct S2QueryStats {
+  // The number of S2ShapeIndexCells whose contents were examined.
+  int64_t cells_visited = 0;
+
+  // The number of S2ClippedShapes examined within those cells.
+  int64_t clipped_shapes_scanned = 0;
+
+  // The number of edges tested against the query target.
+  int64_t edges_tested = 0;
+
+  // The number of cells added to the priority queue, and the maximum size
+  // that the queue reached (for queries that use a priority queue).
+  int64_t cells_enqueued = 0;
+  int64_t max_queue_size = 0;
+
+  // The number of candidate cells that were discarded using a cheap lower
+  // bound on their distance, without computing the exact distance.
+  int64_t cells_pruned = 0;
+
+  void Clear() { *this = S2QueryStats(); }
+
+  // Adds the counters of "other" to this object (taking the maximum of the
+  // max_queue_size values).
+  S2QueryStats& operator+=(const S2QueryStats& other) {
+    cells_visited += other.cells_visited;
+    clipped_shapes_scanned += other.clipped_shapes_scanned;
+    edges_tested += other.edges_tested;
+    cells_enqueued += other.cells_enqueued;
+    max_queue_size = std::max(max_queue_size, other.max_queue_size);
+    cells_pruned += other.cells_pruned;
+    return *this;
+  }
+
+  std::string ToString() const {
+    return absl::StrCat("cells_visited=", cells_visited,
+                        " clipped_shapes_scanned=", clipped_shapes_scanned,
+                        " edges_tested=", edges_tested,
+                        " cells_enqueued=", cells_enqueued,
+                        " max_queue_size=", max_queue_size,
+                        " cells_pruned=", cells_pruned);
+  }
+};
+
+#endif  // S2_S2QUERY_STATS_H_
@@ -15,19 +15,32 @@
 
 #include "s2/s2random.h"
 
+#include <algorithm>
 #include <cmath>
+#include <cstddef>
 #include <cstdint>
+#include <memory>
+#include <vector>
 
 #include "absl/log/absl_check.h"
 #include "absl/random/bit_gen_ref.h"
 #include "absl/random/distributions.h"
+#include "absl/types/span.h"
+#include "s2/internal/s2parallel.h"
+#include "s2/s1angle.h"
 #include "s2/s2cap.h"
 #include "s2/s2cell_id.h"
 #include "s2/s2edge_crossings.h"
+#include "s2/s2edge_distances.h"
+#include "s2/s2fractal.h"
 #include "s2/s2latlng_rect.h"
+#include "s2/s2loop.h"
 #include "s2/s2point.h"
 #include "s2/util/math/matrix3x3.h"
 
+using std::unique_ptr;
+using std::vector;
+
 namespace s2random {
 
 double LogUniform(absl::BitGenRef bitgen, double lo, double hi) {
@@ -142,4 +155,97 @@ S2Point SamplePoint(absl::BitGenRef bitgen, const S2LatLngRect& rect) {
   return S2LatLng::FromRadians(lat, lng).Normalized().ToPoint();
 }
 
+namespace {
+
+// Points are generated in blocks so that the per-task overhead of
+// ParallelFor() is negligible.
+constexpr int kBlockSize = 4096;
+
+// Calls fn(i, bitgen) for every i in [0, n), where "bitgen" is the stream for
+// item "i" of the dataset with the given seed.
+template <class Fn>
+void ParallelGenerate(uint64_t seed, int num_threads, size_t n, const Fn& fn) {
+  const size_t num_blocks = (n + kBlockSize - 1) / kBlockSize;
+  s2internal::ParallelFor(
+      num_threads, static_cast<int>(num_blocks), [&](int block) {
+        const size_t begin = static_cast<size_t>(block) * kBlockSize;
+        const size_t end = std::min(n, begin + kBlockSize);
+        for (size_t i = begin; i < end; ++i) {
+          CounterBitGen bitgen(seed, i);
+          fn(i, bitgen);
+        }
+      });
+}
+
+}  // namespace
+
+void FillPoints(uint64_t seed, int num_threads, absl::Span<S2Point> points) {
+  ParallelGenerate(seed, num_threads, points.size(),
+                   [&](size_t i, CounterBitGen& bitgen) {
+                     points[i] = Point(bitgen);
+                   });
+}
+
+void FillClusteredPoints(uint64_t seed, int num_threads, int num_clusters,
+                         S1Angle min_radius, S1Angle max_radius,
+                         absl::Span<S2Point> points) {
+  ABSL_DCHECK_GT(num_clusters, 0);
+  ABSL_DCHECK_GT(min_radius, S1Angle::Zero());
+  ABSL_DCHECK_LE(min_radius, max_radius);
+
+  // The clusters use a different seed than the points so that the two
+  // sequences are independent.
+  CounterBitGen cluster_bitgen(~seed);
+  vector<S2Cap> clusters;
+  clusters.reserve(num_clusters);
+  for (int i = 0; i < num_clusters; ++i) {
+    double radians =
+        min_radius == max_radius
+            ? min_radius.radians()
+            : LogUniform(cluster_bitgen, min_radius.radians(),
+                         max_radius.radians());
+    clusters.push_back(
+        S2Cap(Point(cluster_bitgen), S1Angle::Radians(radians)));
+  }
+  ParallelGenerate(seed, num_threads, points.size(),
+                   [&](size_t i, CounterBitGen& bitgen) {
+                     const S2Cap& cap =
+                         clusters[absl::Uniform(bitgen, 0, num_clusters)];
+                     points[i] = SamplePoint(bitgen, cap);
+                   });
+}
+
+vector<vector<S2Point>> Polylines(uint64_t seed, int num_threads,
+                                  int num_polylines, int num_vertices,
+                                  S1Angle max_edge_length) {
+  ABSL_DCHECK_GE(num_vertices, 2);
+  vector<vector<S2Point>> polylines(num_polylines);
+  s2internal::ParallelFor(num_threads, num_polylines, [&](int i) {
+    CounterBitGen bitgen(seed, i);
+    vector<S2Point>& polyline = polylines[i];
+    polyline.reserve(num_vertices);
+    polyline.push_back(Point(bitgen));
+    for (int j = 1; j < num_vertices; ++j) {
+      const S2Point origin = polyline.back();
+      S2Point dir = S2::RobustCrossProd(origin, Point(bitgen)).Normalize();
+      S1Angle length = absl::Uniform(bitgen, 0.0, 1.0) * max_edge_length;
+      polyline.push_back(S2::GetPointOnRay(origin, dir, length));
+    }
+  });
+  return polylines;
+}
+
+vector<unique_ptr<S2Loop>> FractalLoops(uint64_t seed, int num_threads,
+                                        int num_loops, int max_edges,
+                                        S1Angle radius) {
+  vector<unique_ptr<S2Loop>> loops(num_loops);
+  s2internal::ParallelFor(num_threads, num_loops, [&](int i) {
+    CounterBitGen bitgen(seed, i);
+    S2Fractal fractal(bitgen);
+    fractal.SetLevelForApproxMaxEdges(max_edges);
+    loops[i] = fractal.MakeLoop(Frame(bitgen), radius);
+  });
+  return loops;
+}
+
 }  // namespace s2random
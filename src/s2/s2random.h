@@ -16,10 +16,18 @@
 #ifndef S2_S2RANDOM_H_
 #define S2_S2RANDOM_H_
 
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <vector>
+
 #include "absl/random/bit_gen_ref.h"
+#include "absl/types/span.h"
+#include "s2/s1angle.h"
 #include "s2/s2cap.h"
 #include "s2/s2cell_id.h"
 #include "s2/s2latlng_rect.h"
+#include "s2/s2loop.h"
 #include "s2/s2point.h"
 #include "s2/util/math/matrix3x3.h"
 
@@ -76,6 +84,74 @@ S2Point SamplePoint(absl::BitGenRef bitgen, const S2LatLngRect& rect);
 S2CellId CellId(absl::BitGenRef bitgen, int level);
 S2CellId CellId(absl::BitGenRef bitgen);
 
+// A fast counter-based random bit generator that can be passed to any of the
+// functions above (it satisfies the UniformRandomBitGenerator requirements).
+// Each (seed, stream) pair yields an independent, reproducible sequence that
+// does not depend on any other stream, so parallel workers can generate item
+// "i" of a dataset using stream "i" and get the same results regardless of
+// how the items are divided among threads.  It is not suitable for
+// cryptographic purposes.
+class CounterBitGen {
+ public:
+  using result_type = uint64_t;
+
+  explicit CounterBitGen(uint64_t seed, uint64_t stream = 0)
+      : key_(Mix(seed ^ Mix(stream + kIncrement))) {}
+
+  static constexpr result_type min() { return 0; }
+  static constexpr result_type max() {
+    return std::numeric_limits<result_type>::max();
+  }
+  result_type operator()() { return Mix(key_ + ++counter_ * kIncrement); }
+
+ private:
+  static constexpr uint64_t kIncrement = 0x9e3779b97f4a7c15;
+
+  // The SplitMix64 finalizer.
+  static uint64_t Mix(uint64_t z) {
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+    return z ^ (z >> 31);
+  }
+
+  uint64_t key_;
+  uint64_t counter_ = 0;
+};
+
+// The following functions generate large datasets (e.g., for benchmarks and
+// load tests) using up to "num_threads" threads.  The output depends only on
+// "seed" and the other arguments, not on "num_threads".
+
+// Fills "points" with points chosen uniformly at random from the sphere.
+void FillPoints(uint64_t seed, int num_threads, absl::Span<S2Point> points);
+
+// Fills "points" with points chosen from "num_clusters" random caps whose
+// radii are log-uniformly distributed between "min_radius" and "max_radius".
+// Each point is assigned to a random cluster, so smaller clusters have a
+// higher density of points.
+// REQUIRES: num_clusters > 0
+// REQUIRES: 0 < min_radius <= max_radius
+void FillClusteredPoints(uint64_t seed, int num_threads, int num_clusters,
+                         S1Angle min_radius, S1Angle max_radius,
+                         absl::Span<S2Point> points);
+
+// Returns "num_polylines" random walks with "num_vertices" vertices each,
+// where each edge has a random direction and a length chosen uniformly from
+// [0, max_edge_length].
+// REQUIRES: num_vertices >= 2
+std::vector<std::vector<S2Point>> Polylines(uint64_t seed, int num_threads,
+                                            int num_polylines,
+                                            int num_vertices,
+                                            S1Angle max_edge_length);
+
+// Returns "num_loops" S2Fractal loops with approximately "max_edges" edges
+// each, centered at random points with a nominal radius of "radius".
+std::vector<std::unique_ptr<S2Loop>> FractalLoops(uint64_t seed,
+                                                  int num_threads,
+                                                  int num_loops,
+                                                  int max_edges,
+                                                  S1Angle radius);
+
 }  // namespace s2random
 
 #endif  // S2_S2RANDOM_H_
@@ -17,15 +17,19 @@
 
 #include <cmath>
 #include <cstdint>
+#include <vector>
 
 #include "s2/base/commandlineflags.h"
 #include <gtest/gtest.h>
 #include "absl/flags/flag.h"
 #include "absl/log/log_streamer.h"
 #include "absl/random/random.h"
+#include "absl/types/span.h"
+#include "s2/s1angle.h"
 #include "s2/s2cap.h"
 #include "s2/s2cell_id.h"
 #include "s2/s2latlng_rect.h"
+#include "s2/s2loop.h"
 #include "s2/s2point.h"
 #include "s2/s2pointutil.h"
 #include "s2/s2testing.h"
@@ -337,4 +341,66 @@ TEST(CellId, Valid) {
   }
 }
 
+TEST(CounterBitGen, Deterministic) {
+  s2random::CounterBitGen a(1, 2), b(1, 2), c(1, 3), d(2, 2);
+  int num_equal_c = 0, num_equal_d = 0;
+  for (int i = 0; i < 100; ++i) {
+    const uint64_t value = a();
+    EXPECT_EQ(value, b());
+    num_equal_c += (value == c());
+    num_equal_d += (value == d());
+  }
+  EXPECT_EQ(0, num_equal_c);
+  EXPECT_EQ(0, num_equal_d);
+}
+
+TEST(BulkGenerators, IndependentOfNumThreads) {
+  constexpr uint64_t kSeed = 12345;
+  std::vector<S2Point> points(10'000), points4(points.size());
+  s2random::FillPoints(kSeed, 1, absl::MakeSpan(points));
+  s2random::FillPoints(kSeed, 4, absl::MakeSpan(points4));
+  EXPECT_EQ(points, points4);
+  for (const S2Point& p : points) EXPECT_TRUE(S2::IsUnitLength(p));
+
+  const S1Angle kMinRadius = S1Angle::Degrees(0.01);
+  const S1Angle kMaxRadius = S1Angle::Degrees(1);
+  s2random::FillClusteredPoints(kSeed, 1, 10, kMinRadius, kMaxRadius,
+                                absl::MakeSpan(points));
+  s2random::FillClusteredPoints(kSeed, 4, 10, kMinRadius, kMaxRadius,
+                                absl::MakeSpan(points4));
+  EXPECT_EQ(points, points4);
+
+  // Every point belongs to one of at most 10 clusters, each of which is
+  // contained by some cap of the maximum radius around one of the points.
+  std::vector<S2Point> centers;
+  for (const S2Point& p : points) {
+    bool found = false;
+    for (const S2Point& center : centers) {
+      if (S1Angle(p, center) <= 2 * kMaxRadius) found = true;
+    }
+    if (!found) centers.push_back(p);
+  }
+  EXPECT_LE(centers.size(), 10);
+
+  const S1Angle kMaxEdgeLength = S1Angle::Degrees(0.1);
+  auto polylines = s2random::Polylines(kSeed, 1, 10, 100, kMaxEdgeLength);
+  EXPECT_EQ(polylines, s2random::Polylines(kSeed, 4, 10, 100, kMaxEdgeLength));
+  ASSERT_EQ(10, polylines.size());
+  for (const auto& polyline : polylines) {
+    ASSERT_EQ(100, polyline.size());
+    for (int i = 1; i < polyline.size(); ++i) {
+      EXPECT_LE(S1Angle(polyline[i - 1], polyline[i]),
+                kMaxEdgeLength + S1Angle::Radians(1e-15));
+    }
+  }
+
+  auto loops = s2random::FractalLoops(kSeed, 1, 4, 100, S1Angle::Degrees(1));
+  auto loops4 = s2random::FractalLoops(kSeed, 4, 4, 100, S1Angle::Degrees(1));
+  ASSERT_EQ(4, loops.size());
+  for (int i = 0; i < loops.size(); ++i) {
+    EXPECT_TRUE(loops[i]->Equals(*loops4[i]));
+    EXPECT_TRUE(loops[i]->IsValid());
+  }
+}
+
 }  // namespace
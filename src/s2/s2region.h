@@ -18,8 +18,11 @@
 #ifndef S2_S2REGION_H_
 #define S2_S2REGION_H_
 
+#include <cstddef>
 #include <vector>
 
+#include "absl/log/absl_check.h"
+#include "absl/types/span.h"
 #include "s2/_fp_contract_off.h"  // IWYU pragma: keep
 #include "s2/s1angle.h"
 #include "s2/s2point.h"
@@ -95,6 +98,21 @@ class S2Region {
   // subtypes may relax this restriction.
   virtual bool Contains(const S2Point& p) const = 0;
 
+  // Sets results[i] to Contains(points[i]) for every point.  The default
+  // implementation simply calls Contains() for each point, but subtypes can
+  // provide faster versions that avoid a virtual call per point and hoist
+  // work out of the loop.  Such versions must return exactly the same
+  // results as Contains().
+  //
+  // REQUIRES: results.size() == points.size()
+  virtual void ContainsPoints(absl::Span<const S2Point> points,
+                              absl::Span<bool> results) const {
+    ABSL_DCHECK_EQ(points.size(), results.size());
+    for (size_t i = 0; i < points.size(); ++i) {
+      results[i] = Contains(points[i]);
+    }
+  }
+
   //////////////////////////////////////////////////////////////////////////
   // Many S2Region subtypes also define the following non-virtual methods.
   //////////////////////////////////////////////////////////////////////////
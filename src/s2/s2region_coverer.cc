@@ -19,6 +19,7 @@
 
 #include <algorithm>
 #include <cstdint>
+#include <iterator>
 #include <utility>
 #include <vector>
 
@@ -27,9 +28,14 @@
 #include "absl/log/absl_log.h"
 
 #include "s2/base/types.h"
+#include "s2/internal/s2parallel.h"
+#include "s2/s1angle.h"
+#include "s2/s1chord_angle.h"
+#include "s2/s2cap.h"
 #include "s2/s2cell.h"
 #include "s2/s2cell_id.h"
 #include "s2/s2cell_union.h"
+#include "s2/s2metrics.h"
 #include "s2/s2point.h"
 #include "s2/s2region.h"
 
@@ -48,10 +54,31 @@ S2RegionCoverer::S2RegionCoverer(const S2RegionCoverer::Options& options) :
 
 // Defaulted in the implementation to prevent inline bloat.
 S2RegionCoverer::S2RegionCoverer() = default;
-S2RegionCoverer::~S2RegionCoverer() = default;
 S2RegionCoverer::S2RegionCoverer(S2RegionCoverer&&) noexcept = default;
-S2RegionCoverer& S2RegionCoverer::operator=(S2RegionCoverer&&) noexcept =
-    default;
+
+S2RegionCoverer::~S2RegionCoverer() {
+  FinishIncrementalCovering();
+}
+
+S2RegionCoverer& S2RegionCoverer::operator=(S2RegionCoverer&& other) noexcept {
+  if (this == &other) return *this;
+  // Free any candidates owned by this object before taking over the state of
+  // "other", and leave "other" with no candidates.
+  FinishIncrementalCovering();
+  options_ = other.options_;
+  region_ = std::exchange(other.region_, nullptr);
+  result_ = std::move(other.result_);
+  pq_ = std::exchange(other.pq_, CandidateQueue());
+  deferred_ = std::move(other.deferred_);
+  other.deferred_.clear();
+  incremental_max_cells_ = other.incremental_max_cells_;
+  interior_covering_ = other.interior_covering_;
+  cap_bound_ = other.cap_bound_;
+  std::copy(std::begin(other.max_center_distance_),
+            std::end(other.max_center_distance_), max_center_distance_);
+  candidates_created_counter_ = other.candidates_created_counter_;
+  return *this;
+}
 
 void S2RegionCoverer::Options::set_max_cells(int max_cells) {
   max_cells_ = max_cells;
@@ -82,13 +109,41 @@ void S2RegionCoverer::Options::set_level_mod(int level_mod) {
   level_mod_ = max(1, min(3, level_mod));
 }
 
+void S2RegionCoverer::Options::set_num_threads(int num_threads) {
+  ABSL_DCHECK_GE(num_threads, 1);
+  num_threads_ = max(1, num_threads);
+}
+
 int S2RegionCoverer::Options::true_max_level() const {
   if (level_mod_ == 1) return max_level_;
   return max_level_ - (max_level_ - min_level_) % level_mod_;
 }
 
-S2RegionCoverer::Candidate* S2RegionCoverer::NewCandidate(const S2Cell& cell) {
-  if (!region_->MayIntersect(cell)) return nullptr;
+void S2RegionCoverer::InitCapBoundFilter() {
+  if (!options_.use_cap_bound_filter()) return;
+  cap_bound_ = region_->GetCapBound();
+  for (int level = 0; level <= S2CellId::kMaxLevel; ++level) {
+    // Every point of a cell is within kMaxDiag of the cell center (which is
+    // inside the cell).  The small extra margin accounts for rounding errors
+    // in the distance calculations.
+    max_center_distance_[level] = S1ChordAngle(
+        cap_bound_.GetRadius() +
+        S1Angle::Radians(S2::kMaxDiag.GetValue(level) + 1e-14));
+  }
+}
+
+inline bool S2RegionCoverer::MayIntersect(const S2Cell& cell) const {
+  if (options_.use_cap_bound_filter() &&
+      S1ChordAngle(cell.GetCenter(), cap_bound_.center()) >
+          max_center_distance_[cell.level()]) {
+    return false;
+  }
+  return region_->MayIntersect(cell);
+}
+
+S2RegionCoverer::Candidate* S2RegionCoverer::NewCandidate(
+    const S2Cell& cell) const {
+  if (!MayIntersect(cell)) return nullptr;
 
   bool is_terminal = false;
   if (cell.level() >= options_.min_level()) {
@@ -105,7 +160,6 @@ S2RegionCoverer::Candidate* S2RegionCoverer::NewCandidate(const S2Cell& cell) {
       }
     }
   }
-  ++candidates_created_counter_;
   const std::size_t max_children = is_terminal ? 0 : 1 << max_children_shift();
   return new (max_children) Candidate(cell, max_children);
 }
@@ -120,14 +174,14 @@ void S2RegionCoverer::DeleteCandidate(Candidate* candidate,
 }
 
 int S2RegionCoverer::ExpandChildren(Candidate* candidate,
-                                    const S2Cell& cell, int num_levels) {
+                                    const S2Cell& cell, int num_levels) const {
   num_levels--;
   S2Cell child_cells[4];
   cell.Subdivide(child_cells);
   int num_terminals = 0;
   for (int i = 0; i < 4; ++i) {
     if (num_levels > 0) {
-      if (region_->MayIntersect(child_cells[i])) {
+      if (MayIntersect(child_cells[i])) {
         num_terminals += ExpandChildren(candidate, child_cells[i], num_levels);
       }
       continue;
@@ -149,13 +203,11 @@ void S2RegionCoverer::AddCandidate(Candidate* candidate) {
     DeleteCandidate(candidate, true);
     return;
   }
-  ABSL_DCHECK_EQ(0, candidate->num_children);
-
-  // Expand one level at a time until we hit min_level() to ensure that we
-  // don't skip over it.
-  int num_levels = ((candidate->cell.level() < options_.min_level()) ?
-                    1 : options_.level_mod());
-  int num_terminals = ExpandChildren(candidate, candidate->cell, num_levels);
+  if (candidate->num_terminals < 0) {
+    ExpandCandidate(candidate);
+    candidates_created_counter_ += candidate->num_children;
+  }
+  const int num_terminals = candidate->num_terminals;
 
   if (candidate->num_children == 0) {
     DeleteCandidate(candidate, false);
@@ -186,6 +238,68 @@ void S2RegionCoverer::AddCandidate(Candidate* candidate) {
   }
 }
 
+void S2RegionCoverer::ExpandCandidate(Candidate* candidate) const {
+  ABSL_DCHECK(!candidate->is_terminal);
+  ABSL_DCHECK_LT(candidate->num_terminals, 0);
+  ABSL_DCHECK_EQ(0, candidate->num_children);
+
+  // Expand one level at a time until we hit min_level() to ensure that we
+  // don't skip over it.
+  int num_levels = ((candidate->cell.level() < options_.min_level()) ?
+                    1 : options_.level_mod());
+  candidate->num_terminals =
+      ExpandChildren(candidate, candidate->cell, num_levels);
+}
+
+void S2RegionCoverer::ExpandQueuedChildrenInParallel(int level, int max_cells,
+                                                     size_t covering_size) {
+  // Candidates are popped in order of increasing level, and all candidates
+  // at "level" are already in the queue (since new candidates are always at
+  // higher levels).  Those that are subdivided will need their children
+  // expanded when the children are added to the queue, so we do this now for
+  // all of them at once.
+  vector<QueueEntry> entries;
+  for (const QueueEntry& entry : pq_.entries()) {
+    if (entry.second->cell.level() == level) entries.push_back(entry);
+  }
+  if (!interior_covering_) {
+    // For exterior coverings, only the highest-priority candidates that fit
+    // within "max_cells" will be subdivided (see ExpandCandidates); the
+    // children of any others are expanded on demand.
+    std::sort(entries.begin(), entries.end(),
+              [](const QueueEntry& x, const QueueEntry& y) {
+                return x.first > y.first;
+              });
+    size_t n = 0;
+    for (; n < entries.size(); ++n) {
+      const Candidate* candidate = entries[n].second;
+      if (level >= options_.min_level() && candidate->num_children > 1 &&
+          covering_size - 1 + candidate->num_children >
+              static_cast<size_t>(max_cells)) {
+        break;
+      }
+      covering_size += candidate->num_children - 1;
+    }
+    entries.resize(n);
+  }
+  vector<Candidate*> children;
+  for (const QueueEntry& entry : entries) {
+    const Candidate* candidate = entry.second;
+    for (int i = 0; i < candidate->num_children; ++i) {
+      Candidate* child = candidate->children[i];
+      if (!child->is_terminal && child->num_terminals < 0) {
+        children.push_back(child);
+      }
+    }
+  }
+  s2internal::ParallelFor(options_.num_threads(), children.size(), [&](int i) {
+    ExpandCandidate(children[i]);
+  });
+  for (const Candidate* child : children) {
+    candidates_created_counter_ += child->num_children;
+  }
+}
+
 inline int S2RegionCoverer::AdjustLevel(int level) const {
   if (options_.level_mod() > 1 && level > options_.min_level()) {
     level -= (level - options_.min_level()) % options_.level_mod();
@@ -209,17 +323,19 @@ void S2RegionCoverer::AdjustCellLevels(vector<S2CellId>* cells) const {
   cells->resize(out);
 }
 
-void S2RegionCoverer::GetInitialCandidates() {
+void S2RegionCoverer::GetInitialCandidates(int max_cells) {
   // Optimization: start with a small (usually 4 cell) covering of the
   // region's bounding cap.
   S2RegionCoverer tmp_coverer;
-  tmp_coverer.mutable_options()->set_max_cells(min(4, options_.max_cells()));
+  tmp_coverer.mutable_options()->set_max_cells(min(4, max_cells));
   tmp_coverer.mutable_options()->set_max_level(options_.max_level());
   vector<S2CellId> cells;
   tmp_coverer.GetFastCovering(*region_, &cells);
   AdjustCellLevels(&cells);
   for (S2CellId cell_id : cells) {
-    AddCandidate(NewCandidate(S2Cell(cell_id)));
+    Candidate* candidate = NewCandidate(S2Cell(cell_id));
+    if (candidate != nullptr) ++candidates_created_counter_;
+    AddCandidate(candidate);
   }
 }
 
@@ -241,18 +357,40 @@ void S2RegionCoverer::GetCoveringInternal(const S2Region& region) {
   // children first), and then by the number of fully contained children
   // (fewest children first).
 
-  ABSL_DCHECK(pq_.empty());
-  ABSL_DCHECK(result_.empty());
+  FinishIncrementalCovering();
   region_ = &region;
+  InitCapBoundFilter();
   candidates_created_counter_ = 0;
 
-  GetInitialCandidates();
+  GetInitialCandidates(options_.max_cells());
+  ExpandCandidates(options_.max_cells(), nullptr);
+  ABSL_VLOG(2) << "Created " << result_.size() << " cells, "
+               << candidates_created_counter_ << " candidates created, "
+               << pq_.size() << " left";
+  while (!pq_.empty()) {
+    DeleteCandidate(pq_.top().second, true);
+    pq_.pop();
+  }
+  region_ = nullptr;
+  NormalizeCovering(&result_);
+  ABSL_DCHECK(IsCanonical(result_));
+}
+
+void S2RegionCoverer::ExpandCandidates(int max_cells,
+                                       vector<QueueEntry>* deferred) {
+  // The level of the most recent call to ExpandQueuedChildrenInParallel().
+  int level = -1;
   while (!pq_.empty() &&
          (!interior_covering_ ||
-          result_.size() < static_cast<size_t>(options_.max_cells()))) {
+          result_.size() < static_cast<size_t>(max_cells))) {
     Candidate* candidate = pq_.top().second;
-    pq_.pop();
     ABSL_VLOG(2) << "Pop: " << candidate->cell.id();
+    const size_t covering_size =
+        result_.size() + (deferred ? deferred->size() : 0) + pq_.size() - 1;
+    if (options_.num_threads() > 1 && candidate->cell.level() > level) {
+      level = candidate->cell.level();
+      ExpandQueuedChildrenInParallel(level, max_cells, covering_size + 1);
+    }
     // For interior coverings we keep subdividing no matter how many children
     // the candidate has.  If we reach max_cells() before expanding all
     // children, we will just use some of them.  For exterior coverings we
@@ -263,45 +401,43 @@ void S2RegionCoverer::GetCoveringInternal(const S2Region& region) {
     // child does no harm in this case.
     if (interior_covering_ || candidate->cell.level() < options_.min_level() ||
         candidate->num_children == 1 ||
-        (result_.size() + pq_.size() + candidate->num_children <=
-         static_cast<size_t>(options_.max_cells()))) {
+        (covering_size + candidate->num_children <=
+         static_cast<size_t>(max_cells))) {
+      pq_.pop();
       // Expand this candidate into its children.
       for (int i = 0; i < candidate->num_children; ++i) {
         if (interior_covering_ &&
-            result_.size() >= static_cast<size_t>(options_.max_cells())) {
+            result_.size() >= static_cast<size_t>(max_cells)) {
           DeleteCandidate(candidate->children[i], true);
         } else {
           AddCandidate(candidate->children[i]);
         }
       }
       DeleteCandidate(candidate, false);
+    } else if (deferred != nullptr) {
+      deferred->push_back(pq_.top());
+      pq_.pop();
     } else {
+      pq_.pop();
       candidate->is_terminal = true;
       AddCandidate(candidate);
     }
   }
-  ABSL_VLOG(2) << "Created " << result_.size() << " cells, "
-               << candidates_created_counter_ << " candidates created, "
-               << pq_.size() << " left";
-  while (!pq_.empty()) {
-    DeleteCandidate(pq_.top().second, true);
-    pq_.pop();
-  }
-  region_ = nullptr;
+}
 
+void S2RegionCoverer::NormalizeCovering(vector<S2CellId>* cells) const {
   // Rather than just returning the raw list of cell ids, we construct a cell
   // union and then denormalize it.  This has the effect of replacing four
   // child cells with their parent whenever this does not violate the covering
   // parameters specified (min_level, level_mod, etc).  This significantly
   // reduces the number of cells returned in many cases, and it is cheap
   // compared to computing the covering in the first place.
-  S2CellUnion::Normalize(&result_);
+  S2CellUnion::Normalize(cells);
   if (options_.min_level() > 0 || options_.level_mod() > 1) {
-    auto result_copy = result_;
-    S2CellUnion::Denormalize(result_copy, options_.min_level(),
-                             options_.level_mod(), &result_);
+    auto cells_copy = *cells;
+    S2CellUnion::Denormalize(cells_copy, options_.min_level(),
+                             options_.level_mod(), cells);
   }
-  ABSL_DCHECK(IsCanonical(result_));
 }
 
 void S2RegionCoverer::GetCovering(const S2Region& region,
@@ -330,6 +466,62 @@ S2CellUnion S2RegionCoverer::GetInteriorCovering(const S2Region& region) {
   return S2CellUnion::FromVerbatim(std::move(result_));
 }
 
+void S2RegionCoverer::StartIncrementalCovering(const S2Region& region) {
+  // We check this on each call because of mutable_options().
+  ABSL_DCHECK_LE(options_.min_level(), options_.max_level());
+
+  FinishIncrementalCovering();
+  region_ = &region;
+  InitCapBoundFilter();
+  interior_covering_ = false;
+  candidates_created_counter_ = 0;
+  incremental_max_cells_ = -1;
+}
+
+void S2RegionCoverer::GetNextCovering(int max_cells,
+                                      vector<S2CellId>* covering) {
+  ABSL_DCHECK(region_ != nullptr) << "StartIncrementalCovering() not called";
+  if (max_cells > incremental_max_cells_) {
+    // Resume subdividing the candidates that did not fit in the previous
+    // covering.  Cells that cannot be subdivided further are already in
+    // result_ and are not revisited.
+    // The initial candidates depend on max_cells, so they are computed when
+    // the first covering is requested.
+    if (incremental_max_cells_ < 0) GetInitialCandidates(max_cells);
+    incremental_max_cells_ = max_cells;
+    for (const QueueEntry& entry : deferred_) pq_.push(entry);
+    deferred_.clear();
+    ExpandCandidates(max_cells, &deferred_);
+    ABSL_VLOG(2) << "Created " << result_.size() + deferred_.size()
+                 << " cells, " << candidates_created_counter_
+                 << " candidates created, " << deferred_.size() << " pending";
+  }
+  covering->assign(result_.begin(), result_.end());
+  for (const QueueEntry& entry : deferred_) {
+    covering->push_back(entry.second->cell.id());
+  }
+  NormalizeCovering(covering);
+}
+
+S2CellUnion S2RegionCoverer::GetNextCovering(int max_cells) {
+  vector<S2CellId> covering;
+  GetNextCovering(max_cells, &covering);
+  return S2CellUnion::FromVerbatim(std::move(covering));
+}
+
+void S2RegionCoverer::FinishIncrementalCovering() {
+  while (!pq_.empty()) {
+    DeleteCandidate(pq_.top().second, true);
+    pq_.pop();
+  }
+  for (const QueueEntry& entry : deferred_) {
+    DeleteCandidate(entry.second, true);
+  }
+  deferred_.clear();
+  result_.clear();
+  region_ = nullptr;
+}
+
 void S2RegionCoverer::GetFastCovering(const S2Region& region,
                                       vector<S2CellId>* covering) {
   region.GetCellUnionBound(covering);
@@ -514,3 +706,72 @@ void S2RegionCoverer::GetSimpleCovering(
     int level, vector<S2CellId>* output) {
   return FloodFill(region, S2CellId(start).parent(level), output);
 }
+
+void S2RegionCoverer::FloodFill(const S2Region& region, S2CellId start,
+                                int num_threads, vector<S2CellId>* output) {
+  if (num_threads <= 1) {
+    FloodFill(region, start, output);
+    return;
+  }
+  // Each layer of the frontier is processed in chunks of this many cells.
+  constexpr int kChunkSize = 256;
+
+  // The visited set is split into one shard per thread.  Each shard is only
+  // modified by one task at a time, so no locking is required.
+  const int num_shards = num_threads;
+  auto shard_of = [num_shards](S2CellId id) {
+    return static_cast<int>(((id.id() * 0x9e3779b97f4a7c15) >> 32) %
+                            num_shards);
+  };
+  vector<absl::flat_hash_set<S2CellId, S2CellIdHash>> visited(num_shards);
+  visited[shard_of(start)].insert(start);
+
+  output->clear();
+  vector<S2CellId> frontier = {start};
+  while (!frontier.empty()) {
+    // Test the cells of the frontier against the region, and bucket the
+    // neighbors of the intersecting cells by shard.
+    const int num_chunks = (frontier.size() + kChunkSize - 1) / kChunkSize;
+    vector<vector<S2CellId>> found(num_chunks);
+    vector<vector<vector<S2CellId>>> neighbors(
+        num_chunks, vector<vector<S2CellId>>(num_shards));
+    s2internal::ParallelFor(num_threads, num_chunks, [&](int chunk) {
+      const int begin = chunk * kChunkSize;
+      const int end = min<int>(begin + kChunkSize, frontier.size());
+      for (int i = begin; i < end; ++i) {
+        S2CellId id = frontier[i];
+        if (!region.MayIntersect(S2Cell(id))) continue;
+        found[chunk].push_back(id);
+        S2CellId nbrs[4];
+        id.GetEdgeNeighbors(nbrs);
+        for (S2CellId nbr : nbrs) {
+          neighbors[chunk][shard_of(nbr)].push_back(nbr);
+        }
+      }
+    });
+    for (const auto& cells : found) {
+      output->insert(output->end(), cells.begin(), cells.end());
+    }
+
+    // Add the unvisited neighbors to the next frontier, one shard per task.
+    vector<vector<S2CellId>> next(num_shards);
+    s2internal::ParallelFor(num_threads, num_shards, [&](int shard) {
+      for (const auto& chunk_neighbors : neighbors) {
+        for (S2CellId nbr : chunk_neighbors[shard]) {
+          if (visited[shard].insert(nbr).second) next[shard].push_back(nbr);
+        }
+      }
+    });
+    frontier.clear();
+    for (const auto& cells : next) {
+      frontier.insert(frontier.end(), cells.begin(), cells.end());
+    }
+  }
+}
+
+void S2RegionCoverer::GetSimpleCovering(const S2Region& region,
+                                        const S2Point& start, int level,
+                                        int num_threads,
+                                        vector<S2CellId>* output) {
+  FloodFill(region, S2CellId(start).parent(level), num_threads, output);
+}
@@ -28,6 +28,8 @@
 #include "absl/base/casts.h"
 #include "absl/base/macros.h"
 #include "s2/_fp_contract_off.h"  // IWYU pragma: keep
+#include "s2/s1chord_angle.h"
+#include "s2/s2cap.h"
 #include "s2/s2cell.h"
 #include "s2/s2cell_id.h"
 #include "s2/s2cell_union.h"
@@ -154,11 +156,54 @@ class S2RegionCoverer {
     // This is the maximum level that will actually be used in coverings.
     int true_max_level() const;
 
+    // The maximum number of threads (including the calling thread) that may
+    // be used to evaluate the region's MayIntersect() and Contains(S2Cell)
+    // methods, which dominate the cost of computing large coverings.  When
+    // this value is greater than one, the candidates at each cell level that
+    // are likely to be subdivided have their children expanded in parallel
+    // ahead of time, while candidates are still selected one at a time.  The
+    // resulting coverings are therefore identical to those computed by a
+    // single thread.
+    //
+    // This option is only useful for coverings with many cells (e.g.,
+    // thousands or more) of regions whose predicates are expensive, such as
+    // large S2Polygons.
+    //
+    // REQUIRES: The region's MayIntersect() and Contains(S2Cell) methods
+    //           must be safe to call concurrently.  This is true for the
+    //           standard region types (S2Cap, S2Polygon, etc), but not for
+    //           S2ShapeIndexRegion.
+    //
+    // DEFAULT: 1
+    int num_threads() const { return num_threads_; }
+    void set_num_threads(int num_threads);
+
+    // If true, candidate cells are first tested against the region's cap
+    // bound (see S2Region::GetCapBound), and the region's MayIntersect()
+    // method is only called for cells that are not already known to be
+    // disjoint from that bound.  The bound test is a single distance
+    // comparison, so this option is useful for regions whose MayIntersect()
+    // method is expensive (such as S2Polygon) and whose cap bound is
+    // reasonably tight.
+    //
+    // The result is still a valid covering, but it is not necessarily
+    // identical to the covering computed without this option since cells
+    // that the region's MayIntersect() method would conservatively accept
+    // may be discarded.
+    //
+    // DEFAULT: false
+    bool use_cap_bound_filter() const { return use_cap_bound_filter_; }
+    void set_use_cap_bound_filter(bool use_cap_bound_filter) {
+      use_cap_bound_filter_ = use_cap_bound_filter;
+    }
+
    protected:
     int max_cells_ = kDefaultMaxCells;
     int min_level_ = 0;
     int max_level_ = S2CellId::kMaxLevel;
     int level_mod_ = 1;
+    int num_threads_ = 1;
+    bool use_cap_bound_filter_ = false;
   };
 
   // Constructs an S2RegionCoverer with the given options.
@@ -194,6 +239,43 @@ class S2RegionCoverer {
   void GetInteriorCovering(const S2Region& region,
                            std::vector<S2CellId>* interior);
 
+  // Incremental coverings.  These methods compute a sequence of successively
+  // finer exterior coverings of a region with increasing values of
+  // max_cells, resuming from the state of the previous covering rather than
+  // starting from scratch each time.  This is useful when a coarse covering
+  // is needed for filtering and a finer one for verification.  For example:
+  //
+  //   S2RegionCoverer coverer(options);
+  //   coverer.StartIncrementalCovering(region);
+  //   S2CellUnion coarse = coverer.GetNextCovering(8);
+  //   ...
+  //   S2CellUnion fine = coverer.GetNextCovering(64);
+  //
+  // All options except max_cells() are respected.  The first covering is
+  // identical to the result of GetCovering() with the given max_cells.  Later
+  // coverings satisfy the same guarantees as GetCovering() but may differ
+  // slightly from its output, since they only refine cells of the previous
+  // covering.  In particular each covering contains the next one.  If
+  // "max_cells" is not larger than in the previous call, the previous
+  // covering is returned again.
+  //
+  // The region must remain valid until FinishIncrementalCovering() is called
+  // or another covering is computed; calling any other GetCovering method,
+  // or StartIncrementalCovering() again, ends the current incremental
+  // covering.  The options must not be changed in the meantime.
+  void StartIncrementalCovering(const S2Region& region);
+  S2CellUnion GetNextCovering(int max_cells);
+  void GetNextCovering(int max_cells, std::vector<S2CellId>* covering);
+
+  // Returns the number of cells in the most recent incremental covering that
+  // could still be subdivided.  If this is zero, further calls to
+  // GetNextCovering() will return the same covering.
+  int num_pending_candidates() const { return deferred_.size(); }
+
+  // Frees the state associated with the current incremental covering (if
+  // any).  This is done automatically when the S2RegionCoverer is destroyed.
+  void FinishIncrementalCovering();
+
   // Like GetCovering(), except that this method is much faster and the
   // coverings are not as tight.  All of the usual parameters are respected
   // (max_cells, min_level, max_level, and level_mod), except that the
@@ -223,6 +305,22 @@ class S2RegionCoverer {
   static void FloodFill(const S2Region& region, S2CellId start,
                         std::vector<S2CellId>* output);
 
+  // Versions of GetSimpleCovering() and FloodFill() that use up to
+  // "num_threads" threads.  The cells are expanded one breadth-first layer
+  // at a time: the region predicates for the current layer are evaluated in
+  // parallel, and the visited set is split into shards that are updated
+  // concurrently.  This is useful for regions that cover many cells (e.g.,
+  // large regions at fine levels).  The output contains the same cells as
+  // the single-threaded versions, in arbitrary order.
+  //
+  // REQUIRES: The region's MayIntersect() method must be safe to call
+  //           concurrently (see Options::num_threads).
+  static void GetSimpleCovering(const S2Region& region, const S2Point& start,
+                                int level, int num_threads,
+                                std::vector<S2CellId>* output);
+  static void FloodFill(const S2Region& region, S2CellId start,
+                        int num_threads, std::vector<S2CellId>* output);
+
   // Returns true if the given S2CellId vector represents a valid covering
   // that conforms to the current covering parameters.  In particular:
   //
@@ -270,13 +368,44 @@ class S2RegionCoverer {
     S2Cell cell;
     bool is_terminal;        // Cell should not be expanded further.
     int num_children = 0;    // Number of children that intersect the region.
+    int num_terminals = -1;  // Number of terminal children, or -1 if the
+                             // children have not been expanded yet.
     Candidate* children[0];  // Actual size may be 0, 4, 16, or 64 elements.
   };
 
+  // We keep the candidates in a priority queue.  We specify a vector to hold
+  // the queue entries since for some reason priority_queue<> uses a deque by
+  // default.  We define our own own comparison function on QueueEntries in
+  // order to make the results deterministic.  (Using the default
+  // less<QueueEntry>, entries of equal priority would be sorted according to
+  // the memory address of the candidate.)
+  typedef std::pair<int, Candidate*> QueueEntry;
+  struct CompareQueueEntries {
+    bool operator()(const QueueEntry& x, const QueueEntry& y) const {
+      return x.first < y.first;
+    }
+  };
+  class CandidateQueue
+      : public std::priority_queue<QueueEntry, std::vector<QueueEntry>,
+                                   CompareQueueEntries> {
+   public:
+    // Returns the queue entries in heap order.
+    const std::vector<QueueEntry>& entries() const { return c; }
+  };
+
+  // Initializes the cap bound used by MayIntersect() for region_ if
+  // Options::use_cap_bound_filter() is true.
+  void InitCapBoundFilter();
+
+  // Returns false if "cell" is known to be disjoint from the cap bound of
+  // region_ (see Options::use_cap_bound_filter), and otherwise returns
+  // region_->MayIntersect(cell).
+  bool MayIntersect(const S2Cell& cell) const;
+
   // If the cell intersects the given region, return a new candidate with no
   // children, otherwise return nullptr.  Also marks the candidate as "terminal"
   // if it should not be expanded further.
-  Candidate* NewCandidate(const S2Cell& cell);
+  Candidate* NewCandidate(const S2Cell& cell) const;
 
   // Returns the log base 2 of the maximum number of children of a candidate.
   int max_children_shift() const { return 2 * options().level_mod(); }
@@ -292,14 +421,42 @@ class S2RegionCoverer {
   // Populates the children of "candidate" by expanding the given number of
   // levels from the given cell.  Returns the number of children that were
   // marked "terminal".
-  int ExpandChildren(Candidate* candidate, const S2Cell& cell, int num_levels);
-
-  // Computes a set of initial candidates that cover the given region.
-  void GetInitialCandidates();
+  int ExpandChildren(Candidate* candidate, const S2Cell& cell,
+                     int num_levels) const;
+
+  // Populates the children of a non-terminal candidate and sets its
+  // "num_terminals" field.  This method may be called concurrently for
+  // different candidates.
+  // REQUIRES: candidate->num_terminals < 0
+  void ExpandCandidate(Candidate* candidate) const;
+
+  // Expands the children of the candidates in pq_ at the given level in
+  // parallel (see Options::num_threads), so that they do not need to be
+  // expanded when they are added to the queue.  For exterior coverings, only
+  // candidates that are likely to be subdivided given "max_cells" and the
+  // current "covering_size" (the number of cells in result_, pq_, and any
+  // deferred candidates) are considered.
+  void ExpandQueuedChildrenInParallel(int level, int max_cells,
+                                      size_t covering_size);
+
+  // Computes a set of initial candidates that cover the given region, using
+  // at most min(4, max_cells) cells.
+  void GetInitialCandidates(int max_cells);
 
   // Generates a covering and stores it in result_.
   void GetCoveringInternal(const S2Region& region);
 
+  // Subdivides the candidates in pq_ until the covering (consisting of
+  // result_ and any candidates in "deferred") would exceed "max_cells".
+  // Candidates that are not subdivided are added to "deferred" if it is
+  // non-null (so that they can be subdivided later), and otherwise to result_.
+  void ExpandCandidates(int max_cells, std::vector<QueueEntry>* deferred);
+
+  // Normalizes "cells" and then denormalizes them according to min_level()
+  // and level_mod(), replacing groups of child cells with their parent where
+  // this does not violate the covering parameters.
+  void NormalizeCovering(std::vector<S2CellId>* cells) const;
+
   // If level > min_level(), then reduces "level" if necessary so that it also
   // satisfies level_mod().  Levels smaller than min_level() are not affected
   // (since cells at these levels are eventually expanded).
@@ -325,29 +482,31 @@ class S2RegionCoverer {
 
   // We save a temporary copy of the pointer passed to GetCovering() in order
   // to avoid passing this parameter around internally.  It is only used (and
-  // only valid) for the duration of a single GetCovering() call.
+  // only valid) for the duration of a single GetCovering() call, or until an
+  // incremental covering is finished.
   const S2Region* region_ = nullptr;
 
   // The set of S2CellIds that have been added to the covering so far.
   std::vector<S2CellId> result_;
 
-  // We keep the candidates in a priority queue.  We specify a vector to hold
-  // the queue entries since for some reason priority_queue<> uses a deque by
-  // default.  We define our own own comparison function on QueueEntries in
-  // order to make the results deterministic.  (Using the default
-  // less<QueueEntry>, entries of equal priority would be sorted according to
-  // the memory address of the candidate.)
-
-  typedef std::pair<int, Candidate*> QueueEntry;
-  struct CompareQueueEntries {
-    bool operator()(const QueueEntry& x, const QueueEntry& y) const {
-      return x.first < y.first;
-    }
-  };
-  typedef std::priority_queue<QueueEntry, std::vector<QueueEntry>,
-                              CompareQueueEntries> CandidateQueue;
+  // Candidates that may still be subdivided.
   CandidateQueue pq_;
 
+  // Candidates of the current incremental covering that were not subdivided
+  // because of max_cells.  They are returned to pq_ by the next call to
+  // GetNextCovering().
+  std::vector<QueueEntry> deferred_;
+
+  // The max_cells() value used for the most recent incremental covering, or
+  // -1 if no covering has been requested yet.
+  int incremental_max_cells_ = -1;
+
+  // The cap bound of region_ when Options::use_cap_bound_filter() is true,
+  // and for each level the maximum distance from the cap center to the center
+  // of a cell at that level that may intersect the cap.
+  S2Cap cap_bound_;
+  S1ChordAngle max_center_distance_[S2CellId::kMaxLevel + 1];
+
   // True if we're computing an interior covering.
   bool interior_covering_;
 
@@ -0,0 +1,98 @@
+// Copyright 2024 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "s2/s2region_coverer.h"
+
+#include <memory>
+#include <random>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+#include "s2/s2benchmark_testing.h"
+#include "s2/s2cap.h"
+#include "s2/s2cell_union.h"
+#include "s2/s2loop.h"
+#include "s2/s2random.h"
+#include "s2/s2shape_index_region.h"
+
+using std::vector;
+
+namespace {
+
+using s2benchmark::kSeed;
+
+// Measures the time to cover random caps with the given max_cells().
+void BM_S2RegionCovererGetCoveringCap(benchmark::State& state) {
+  std::mt19937_64 bitgen(kSeed);
+  vector<S2Cap> caps;
+  for (int i = 0; i < 1000; ++i) {
+    caps.push_back(s2random::Cap(bitgen, 1e-10, 0.1));
+  }
+  S2RegionCoverer::Options options;
+  options.set_max_cells(state.range(0));
+  S2RegionCoverer coverer(options);
+  size_t i = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(coverer.GetCovering(caps[i]));
+    if (++i == caps.size()) i = 0;
+  }
+}
+BENCHMARK(BM_S2RegionCovererGetCoveringCap)->RangeMultiplier(4)->Range(4, 1024);
+
+// Measures the time to cover a fractal loop with the given max_cells().
+void BM_S2RegionCovererGetCoveringLoop(benchmark::State& state) {
+  std::mt19937_64 bitgen(kSeed);
+  std::unique_ptr<S2Loop> loop =
+      s2benchmark::MakeFractalLoop(bitgen, state.range(0));
+  S2RegionCoverer::Options options;
+  options.set_max_cells(state.range(1));
+  S2RegionCoverer coverer(options);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(coverer.GetCovering(*loop));
+  }
+}
+BENCHMARK(BM_S2RegionCovererGetCoveringLoop)
+    ->ArgsProduct({{192, 3072, 49152}, {8, 64, 512}});
+
+// Measures the time to compute a large covering of a fractal loop using the
+// given number of threads.
+void BM_S2RegionCovererGetCoveringLoopThreads(benchmark::State& state) {
+  std::mt19937_64 bitgen(kSeed);
+  std::unique_ptr<S2Loop> loop = s2benchmark::MakeFractalLoop(bitgen, 49152);
+  S2RegionCoverer::Options options;
+  options.set_max_cells(20000);
+  options.set_num_threads(state.range(0));
+  S2RegionCoverer coverer(options);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(coverer.GetCovering(*loop));
+  }
+}
+BENCHMARK(BM_S2RegionCovererGetCoveringLoopThreads)->Arg(1)->Arg(2)->Arg(4);
+
+// Measures the time to cover an S2ShapeIndex containing a fractal loop.
+void BM_S2RegionCovererGetCoveringShapeIndex(benchmark::State& state) {
+  auto index = s2benchmark::MakeFractalIndex(state.range(0));
+  S2RegionCoverer::Options options;
+  options.set_max_cells(state.range(1));
+  S2RegionCoverer coverer(options);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(
+        coverer.GetCovering(MakeS2ShapeIndexRegion(index.get())));
+  }
+}
+BENCHMARK(BM_S2RegionCovererGetCoveringShapeIndex)
+    ->ArgsProduct({{192, 3072, 49152}, {8, 64, 512}});
+
+}  // namespace
@@ -47,8 +47,11 @@
 #include "s2/s2cell.h"
 #include "s2/s2cell_id.h"
 #include "s2/s2cell_union.h"
+#include "s2/s2fractal.h"
 #include "s2/s2latlng.h"
+#include "s2/s2loop.h"
 #include "s2/s2point.h"
+#include "s2/s2pointutil.h"
 #include "s2/s2polyline.h"
 #include "s2/s2random.h"
 #include "s2/s2region.h"
@@ -182,6 +185,23 @@ TEST(S2RegionCoverer, SimpleCoverings) {
   }
 }
 
+TEST(S2RegionCoverer, SimpleCoveringsWithThreads) {
+  absl::BitGen bitgen(S2Testing::MakeTaggedSeedSeq(
+      "SIMPLE_COVERINGS_WITH_THREADS",
+      absl::LogInfoStreamer(__FILE__, __LINE__).stream()));
+  for (int i = 0; i < 20; ++i) {
+    int level = absl::Uniform(bitgen, 5, 20);
+    S2Cap cap = s2random::Cap(bitgen, 10 * S2Cell::AverageArea(level),
+                              5000 * S2Cell::AverageArea(level));
+    vector<S2CellId> expected, actual;
+    S2RegionCoverer::GetSimpleCovering(cap, cap.center(), level, &expected);
+    S2RegionCoverer::GetSimpleCovering(cap, cap.center(), level, 4, &actual);
+    std::sort(expected.begin(), expected.end());
+    std::sort(actual.begin(), actual.end());
+    EXPECT_EQ(expected, actual);
+  }
+}
+
 // We keep a priority queue of the caps that had the worst approximation
 // ratios so that we can print them at the end.
 struct WorstCap {
@@ -341,6 +361,115 @@ TEST(S2RegionCoverer, InteriorCovering) {
   }
 }
 
+TEST(S2RegionCoverer, IncrementalCoverings) {
+  absl::BitGen bitgen(S2Testing::MakeTaggedSeedSeq(
+      "INCREMENTAL_COVERINGS",
+      absl::LogInfoStreamer(__FILE__, __LINE__).stream()));
+  static constexpr int kMaxLevel = S2CellId::kMaxLevel;
+  S2RegionCoverer::Options options;
+  for (int i = 0; i < 100; ++i) {
+    options.set_min_level(
+        absl::Uniform(absl::IntervalClosedClosed, bitgen, 0, 10));
+    options.set_max_level(absl::Uniform(absl::IntervalClosedClosed, bitgen,
+                                        options.min_level(), kMaxLevel));
+    options.set_level_mod(absl::Uniform(bitgen, 1, 4));
+    double max_area =
+        min(4 * M_PI, 100 * S2Cell::AverageArea(options.min_level()));
+    S2Cap cap =
+        s2random::Cap(bitgen, 0.1 * S2Cell::AverageArea(kMaxLevel), max_area);
+    S2RegionCoverer coverer(options);
+    coverer.StartIncrementalCovering(cap);
+    S2CellUnion previous = S2CellUnion::WholeSphere();
+    for (int max_cells = s2random::SkewedInt(bitgen, 4); max_cells <= 200;
+         max_cells = 1 + 2 * max_cells) {
+      S2CellUnion covering = coverer.GetNextCovering(max_cells);
+      S2RegionCoverer::Options covering_options = options;
+      covering_options.set_max_cells(max_cells);
+      CheckCovering(covering_options, cap, covering.cell_ids(), false);
+      EXPECT_TRUE(S2RegionCoverer(covering_options).IsCanonical(covering));
+      EXPECT_TRUE(previous.Contains(covering));
+      if (previous == S2CellUnion::WholeSphere()) {
+        // The first covering is the same as a non-incremental one.
+        EXPECT_EQ(covering, S2RegionCoverer(covering_options).GetCovering(cap));
+      }
+      // Asking again for the same number of cells changes nothing.
+      EXPECT_EQ(covering, coverer.GetNextCovering(max_cells));
+      previous = std::move(covering);
+    }
+  }
+}
+
+TEST(S2RegionCoverer, IncrementalCoveringRefinesUntilDone) {
+  // A cap covered with a large enough budget eventually has no candidates
+  // left to subdivide.
+  S2RegionCoverer::Options options;
+  options.set_max_level(8);
+  S2RegionCoverer coverer(options);
+  S2Cap cap(S2Point(1, 0, 0), S1Angle::Degrees(5));
+  coverer.StartIncrementalCovering(cap);
+  S2CellUnion coarse = coverer.GetNextCovering(4);
+  EXPECT_GT(coverer.num_pending_candidates(), 0);
+  S2CellUnion fine = coverer.GetNextCovering(100000);
+  EXPECT_EQ(coverer.num_pending_candidates(), 0);
+  EXPECT_TRUE(coarse.Contains(fine));
+  options.set_max_cells(100000);
+  EXPECT_EQ(fine, S2RegionCoverer(options).GetCovering(cap));
+
+  // A regular covering ends the incremental one.
+  S2CellUnion covering = coverer.GetCovering(cap);
+  EXPECT_EQ(coverer.num_pending_candidates(), 0);
+  coverer.StartIncrementalCovering(cap);
+  EXPECT_EQ(coverer.GetNextCovering(4), coarse);
+  coverer.FinishIncrementalCovering();
+  EXPECT_EQ(coverer.num_pending_candidates(), 0);
+}
+
+TEST(S2RegionCoverer, ParallelCoveringsMatchSequential) {
+  absl::BitGen bitgen(S2Testing::MakeTaggedSeedSeq(
+      "PARALLEL_COVERINGS_MATCH_SEQUENTIAL",
+      absl::LogInfoStreamer(__FILE__, __LINE__).stream()));
+  S2Fractal fractal(bitgen);
+  fractal.SetLevelForApproxMaxEdges(1000);
+  auto loop = fractal.MakeLoop(S2::GetFrame(s2random::Point(bitgen)),
+                               S1Angle::Degrees(10));
+  for (int level_mod : {1, 2, 3}) {
+    S2RegionCoverer::Options options;
+    options.set_max_cells(500);
+    options.set_level_mod(level_mod);
+    S2RegionCoverer coverer(options);
+    S2CellUnion covering = coverer.GetCovering(*loop);
+    S2CellUnion interior = coverer.GetInteriorCovering(*loop);
+    for (int num_threads : {2, 4}) {
+      options.set_num_threads(num_threads);
+      S2RegionCoverer parallel_coverer(options);
+      EXPECT_EQ(parallel_coverer.GetCovering(*loop), covering);
+      EXPECT_EQ(parallel_coverer.GetInteriorCovering(*loop), interior);
+    }
+  }
+}
+
+TEST(S2RegionCoverer, CapBoundFilter) {
+  absl::BitGen bitgen(S2Testing::MakeTaggedSeedSeq(
+      "CAP_BOUND_FILTER",
+      absl::LogInfoStreamer(__FILE__, __LINE__).stream()));
+  S2Fractal fractal(bitgen);
+  fractal.SetLevelForApproxMaxEdges(1000);
+  for (int iter = 0; iter < 10; ++iter) {
+    auto loop = fractal.MakeLoop(
+        S2::GetFrame(s2random::Point(bitgen)),
+        S1Angle::Radians(s2random::LogUniform(bitgen, 1e-6, 1.0)));
+    S2RegionCoverer::Options options;
+    options.set_max_cells(absl::Uniform(bitgen, 1, 200));
+    options.set_level_mod(absl::Uniform(bitgen, 1, 4));
+    options.set_use_cap_bound_filter(true);
+    S2RegionCoverer coverer(options);
+    CheckCovering(options, *loop, coverer.GetCovering(*loop).cell_ids(),
+                  false);
+    CheckCovering(options, *loop,
+                  coverer.GetInteriorCovering(*loop).cell_ids(), true);
+  }
+}
+
 TEST(GetFastCovering, HugeFixedLevelCovering) {
   // Test a "fast covering" with a huge number of cells due to min_level().
   S2RegionCoverer::Options options;
@@ -21,6 +21,7 @@
 #include <vector>
 
 #include "absl/base/macros.h"
+#include "absl/types/span.h"
 
 #include "s2/_fp_contract_off.h"  // IWYU pragma: keep
 #include "s2/s2point.h"
@@ -63,6 +64,11 @@ class S2RegionIntersection final : public S2Region {
   S2LatLngRect GetRectBound() const override;
   void GetCellUnionBound(std::vector<S2CellId>* cell_ids) const override;
   bool Contains(const S2Point& p) const override;
+
+  // Forwards to ContainsPoints() of each region in turn, passing only the
+  // points whose result has not been decided by the previous regions.
+  void ContainsPoints(absl::Span<const S2Point> points,
+                      absl::Span<bool> results) const override;
   bool Contains(const S2Cell& cell) const override;
   bool MayIntersect(const S2Cell& cell) const override;
 
@@ -15,12 +15,15 @@
 
 #include "s2/s2region_sharder.h"
 
+#include <algorithm>
 #include <cstdint>
 #include <utility>
 #include <vector>
 
 #include "absl/container/flat_hash_map.h"
+#include "absl/log/absl_check.h"
 #include "absl/meta/type_traits.h"
+#include "absl/types/span.h"
 #include "s2/s2cell.h"
 #include "s2/s2cell_id.h"
 #include "s2/s2cell_index.h"
@@ -48,26 +51,22 @@ absl::flat_hash_map<int, S2CellUnion> ToS2CellUnionMap(
 }
 
 absl::flat_hash_map<int, S2CellUnion> S2RegionSharder::GetIntersectionsByShard(
-    const S2Region& region) const {
-  vector<S2CellId> region_covering_cells;
-  region.GetCellUnionBound(&region_covering_cells);
-  const S2CellUnion region_covering(region_covering_cells);
-
+    const S2Region& region, const S2CellUnion& region_covering) const {
   // Compute the intersection between the region covering and each shard
   // covering.
-  absl::flat_hash_map<int, vector<S2CellId>> shards;
+  ShardCells shards;
   index_->VisitIntersectingCells(
       region_covering,
       [&](const S2CellId cell_id, const S2CellIndex::Label label) {
-        auto iter = shards.find(label);
-        if (iter == shards.end()) {
-          shards.insert({label, {cell_id}});
-        } else {
-          iter->second.push_back(cell_id);
-        }
+        shards[label].push_back(cell_id);
         return true;
       });
+  return RefineIntersections(region, region_covering, std::move(shards));
+}
 
+absl::flat_hash_map<int, S2CellUnion> S2RegionSharder::RefineIntersections(
+    const S2Region& region, const S2CellUnion& region_covering,
+    ShardCells shards) {
   // The fast covering is very loose, but often it only intersects one
   // shard.
   if (shards.size() == 1) {
@@ -111,10 +110,23 @@ absl::flat_hash_map<int, S2CellUnion> S2RegionSharder::GetIntersectionsByShard(
   return ToS2CellUnionMap(std::move(shards));
 }
 
+// Returns the covering of "region" used to find candidate shards.
+static S2CellUnion GetCovering(const S2Region& region) {
+  vector<S2CellId> region_covering_cells;
+  region.GetCellUnionBound(&region_covering_cells);
+  return S2CellUnion(std::move(region_covering_cells));
+}
+
 int S2RegionSharder::GetMostIntersectingShard(const S2Region& region,
                                               const int default_shard) const {
+  return GetMostIntersectingShard(region, GetCovering(region), default_shard);
+}
+
+int S2RegionSharder::GetMostIntersectingShard(const S2Region& region,
+                                              const S2CellUnion& covering,
+                                              const int default_shard) const {
   const absl::flat_hash_map<int, S2CellUnion> intersecting_shards =
-      GetIntersectionsByShard(region);
+      GetIntersectionsByShard(region, covering);
 
   // Having clipped each shard covering down to its intersection with the
   // region, return the best intersection, or the default shard if there are
@@ -135,15 +147,87 @@ int S2RegionSharder::GetMostIntersectingShard(const S2Region& region,
   return best_shard;
 }
 
-vector<int> S2RegionSharder::GetIntersectingShards(
-    const S2Region& region) const {
+vector<int> S2RegionSharder::GetShardNumbers(
+    const absl::flat_hash_map<int, S2CellUnion>& intersections) {
   vector<int> shard_numbers;
-
-  for (const auto& shard : GetIntersectionsByShard(region)) {
+  for (const auto& shard : intersections) {
     if (!shard.second.empty()) {
       shard_numbers.push_back(shard.first);
     }
   }
-
   return shard_numbers;
 }
+
+vector<int> S2RegionSharder::GetIntersectingShards(
+    const S2Region& region) const {
+  return GetIntersectingShards(region, GetCovering(region));
+}
+
+vector<int> S2RegionSharder::GetIntersectingShards(
+    const S2Region& region, const S2CellUnion& covering) const {
+  return GetShardNumbers(GetIntersectionsByShard(region, covering));
+}
+
+vector<vector<int>> S2RegionSharder::GetIntersectingShards(
+    absl::Span<const S2Region* const> regions) const {
+  vector<S2CellUnion> coverings;
+  coverings.reserve(regions.size());
+  for (const S2Region* region : regions) {
+    coverings.push_back(GetCovering(*region));
+  }
+  return GetIntersectingShards(regions, coverings);
+}
+
+vector<vector<int>> S2RegionSharder::GetIntersectingShards(
+    absl::Span<const S2Region* const> regions,
+    absl::Span<const S2CellUnion> coverings) const {
+  ABSL_DCHECK_EQ(regions.size(), coverings.size());
+
+  // Sort the cells of all the coverings by their first leaf cell, so that
+  // the leaf cell ranges of the index are visited in (mostly) increasing
+  // order and are rarely sought more than once.
+  struct TargetCell {
+    S2CellId range_min, cell_id;
+    int region;
+  };
+  vector<TargetCell> targets;
+  for (int i = 0; i < coverings.size(); ++i) {
+    for (S2CellId cell_id : coverings[i]) {
+      targets.push_back({cell_id.range_min(), cell_id, i});
+    }
+  }
+  std::sort(targets.begin(), targets.end(),
+            [](const TargetCell& x, const TargetCell& y) {
+              if (x.range_min != y.range_min) return x.range_min < y.range_min;
+              return x.region < y.region;
+            });
+
+  vector<ShardCells> shards(regions.size());
+  S2CellIndex::RangeIterator range(index_);
+  S2CellIndex::ContentsIterator contents(index_);
+  range.Begin();
+  for (const TargetCell& target : targets) {
+    if (target.range_min < range.start_id() ||
+        target.range_min >= range.limit_id()) {
+      range.Seek(target.range_min);  // Only seek when necessary.
+    }
+    // Duplicates are suppressed only within each target cell, but this does
+    // not matter since the shard cells are normalized later.
+    contents.Clear();
+    const S2CellId range_max = target.cell_id.range_max();
+    for (S2CellIndex::RangeIterator it = range; it.start_id() <= range_max;
+         it.Next()) {
+      for (contents.StartUnion(it); !contents.done(); contents.Next()) {
+        shards[target.region][contents.label()].push_back(contents.cell_id());
+      }
+    }
+  }
+
+  vector<vector<int>> results;
+  results.reserve(regions.size());
+  for (int i = 0; i < regions.size(); ++i) {
+    results.push_back(GetShardNumbers(RefineIntersections(
+        *regions[i], coverings[i], std::move(shards[i]))));
+  }
+  return results;
+}
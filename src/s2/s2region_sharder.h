@@ -19,6 +19,8 @@
 #include <vector>
 
 #include "absl/container/flat_hash_map.h"
+#include "absl/types/span.h"
+#include "s2/s2cell_id.h"
 #include "s2/s2cell_index.h"
 #include "s2/s2cell_union.h"
 #include "s2/s2region.h"
@@ -46,14 +48,57 @@ class S2RegionSharder {
   // with the input region, returns 'default_shard'.
   int GetMostIntersectingShard(const S2Region& region, int default_shard) const;
 
+  // As above, but uses the given precomputed "covering" of the region rather
+  // than calling region.GetCellUnionBound().  This is useful when the same
+  // region is sharded repeatedly.
+  //
+  // REQUIRES: "covering" contains the region.
+  int GetMostIntersectingShard(const S2Region& region,
+                               const S2CellUnion& covering,
+                               int default_shard) const;
+
   // Returns a list of shard numbers which intersect with the input 'region'.
   // Shard numbers are not guaranteed to be sorted in any particular order.  If
   // no shards overlap, returns an empty vector.
   std::vector<int> GetIntersectingShards(const S2Region& region) const;
 
+  // As above, but uses the given precomputed "covering" of the region.
+  //
+  // REQUIRES: "covering" contains the region.
+  std::vector<int> GetIntersectingShards(const S2Region& region,
+                                         const S2CellUnion& covering) const;
+
+  // Returns the result of GetIntersectingShards() for each of the given
+  // regions.  This is faster than sharding the regions one at a time because
+  // their coverings are sorted and matched against the index in a single
+  // pass.
+  std::vector<std::vector<int>> GetIntersectingShards(
+      absl::Span<const S2Region* const> regions) const;
+
+  // As above, but uses the given precomputed coverings of the regions.
+  //
+  // REQUIRES: coverings.size() == regions.size()
+  // REQUIRES: coverings[i] contains *regions[i] for all "i".
+  std::vector<std::vector<int>> GetIntersectingShards(
+      absl::Span<const S2Region* const> regions,
+      absl::Span<const S2CellUnion> coverings) const;
+
  private:
+  // The cells of each shard's covering that intersect a region's covering.
+  using ShardCells = absl::flat_hash_map<int, std::vector<S2CellId>>;
+
   absl::flat_hash_map<int, S2CellUnion> GetIntersectionsByShard(
-      const S2Region& region) const;
+      const S2Region& region, const S2CellUnion& covering) const;
+
+  // Clips the shard cells that intersect "covering" (the covering of
+  // "region") to their intersection with the region.  Shards that do not
+  // intersect the region are removed.
+  static absl::flat_hash_map<int, S2CellUnion> RefineIntersections(
+      const S2Region& region, const S2CellUnion& covering, ShardCells shards);
+
+  // Returns the shards in "intersections" that intersect the region.
+  static std::vector<int> GetShardNumbers(
+      const absl::flat_hash_map<int, S2CellUnion>& intersections);
 
   S2CellIndex owned_index_;
   const S2CellIndex* index_ = &owned_index_;
@@ -15,14 +15,26 @@
 
 #include "s2/s2region_sharder.h"
 
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <utility>
 #include <vector>
 
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
+#include "absl/log/log_streamer.h"
+#include "absl/random/random.h"
 #include "absl/types/span.h"
+#include "s2/s1angle.h"
+#include "s2/s2cap.h"
 #include "s2/s2cell_id.h"
 #include "s2/s2cell_index.h"
 #include "s2/s2cell_union.h"
+#include "s2/s2random.h"
+#include "s2/s2region.h"
+#include "s2/s2region_coverer.h"
+#include "s2/s2testing.h"
 
 namespace {
 
@@ -115,4 +127,57 @@ TEST_F(S2RegionSharderTest, GetIntersectingShards) {
   Run(S2RegionSharder(coverings));
 }
 
+TEST_F(S2RegionSharderTest, BatchMatchesSingleRegions) {
+  absl::BitGen bitgen(S2Testing::MakeTaggedSeedSeq(
+      "BATCH_MATCHES_SINGLE_REGIONS",
+      absl::LogInfoStreamer(__FILE__, __LINE__).stream()));
+  // Shards are coverings of random caps, which overlap frequently.
+  S2RegionCoverer coverer;
+  coverer.mutable_options()->set_max_cells(20);
+  vector<S2CellUnion> shards;
+  for (int i = 0; i < 50; ++i) {
+    S2Cap cap(s2random::Point(bitgen),
+              S1Angle::Degrees(absl::Uniform(bitgen, 1.0, 30.0)));
+    shards.push_back(coverer.GetCovering(cap));
+  }
+  S2RegionSharder sharder(shards);
+
+  // Regions range from tiny caps (which are often contained by a single
+  // shard cell) to caps that intersect many shards.
+  vector<std::unique_ptr<S2Region>> regions;
+  vector<const S2Region*> region_ptrs;
+  vector<S2CellUnion> coverings;
+  for (int i = 0; i < 200; ++i) {
+    regions.push_back(std::make_unique<S2Cap>(
+        s2random::Point(bitgen),
+        S1Angle::Degrees(std::pow(10.0, absl::Uniform(bitgen, -4.0, 1.5)))));
+    region_ptrs.push_back(regions.back().get());
+    coverings.push_back(coverer.GetCovering(*regions.back()));
+  }
+
+  const auto sorted = [](vector<int> v) {
+    std::sort(v.begin(), v.end());
+    return v;
+  };
+  vector<vector<int>> batch = sharder.GetIntersectingShards(region_ptrs);
+  vector<vector<int>> batch_with_coverings =
+      sharder.GetIntersectingShards(region_ptrs, coverings);
+  ASSERT_EQ(batch.size(), regions.size());
+  ASSERT_EQ(batch_with_coverings.size(), regions.size());
+  for (int i = 0; i < regions.size(); ++i) {
+    EXPECT_EQ(sorted(batch[i]),
+              sorted(sharder.GetIntersectingShards(*regions[i])));
+    vector<int> expected =
+        sorted(sharder.GetIntersectingShards(*regions[i], coverings[i]));
+    EXPECT_EQ(sorted(batch_with_coverings[i]), expected);
+
+    vector<S2CellId> bound;
+    regions[i]->GetCellUnionBound(&bound);
+    EXPECT_EQ(sharder.GetMostIntersectingShard(*regions[i], -1),
+              sharder.GetMostIntersectingShard(
+                  *regions[i], S2CellUnion(std::move(bound)), -1));
+  }
+  EXPECT_TRUE(sharder.GetIntersectingShards({}).empty());
+}
+
 }  // namespace
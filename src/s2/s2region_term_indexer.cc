@@ -74,6 +74,9 @@
 
 #include "s2/s2region_term_indexer.h"
 
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
 #include <string>
 #include <vector>
 
@@ -81,6 +84,8 @@
 #include "absl/strings/ascii.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/types/span.h"
 
 #include "s2/base/log_severity.h"
 #include "s2/s2cell_id.h"
@@ -89,6 +94,7 @@
 #include "s2/s2region.h"
 #include "s2/s2region_coverer.h"
 
+using absl::Span;
 using absl::string_view;
 using std::string;
 using std::vector;
@@ -129,8 +135,110 @@ string S2RegionTermIndexer::GetTerm(TermType term_type, const S2CellId id,
   }
 }
 
-vector<string> S2RegionTermIndexer::GetIndexTerms(const S2Point& point,
-                                                  string_view prefix) {
+uint64_t S2RegionTermIndexer::GetIntegerTerm(TermType term_type,
+                                             S2CellId id) {
+  // The lowest set bit of every S2CellId is at an even bit position, so
+  // setting the bit below it yields a value that is not a valid S2CellId.
+  // This is possible for every cell except leaf cells, which are never
+  // indexed as covering terms.
+  if (term_type == TermType::ANCESTOR) return id.id();
+  ABSL_DCHECK(!id.is_leaf());
+  return id.id() | (id.lsb() >> 1);
+}
+
+int S2RegionTermIndexer::num_index_terms_per_point() const {
+  return (options_.true_max_level() - options_.min_level()) /
+             options_.level_mod() +
+         1;
+}
+
+int S2RegionTermIndexer::num_query_terms_per_point() const {
+  if (options_.index_contains_points_only()) return 1;
+  // The covering term for a leaf cell is omitted (see AppendQueryTerms).
+  return num_index_terms_per_point() + 1 -
+         (options_.true_max_level() == S2CellId::kMaxLevel);
+}
+
+void S2RegionTermIndexer::AppendIndexTermsForPoints(
+    Span<const S2Point> points, vector<uint64_t>* terms) const {
+  // This produces the same terms as EmitIndexTerms(), but computes each
+  // ancestor directly from a precomputed lowest bit per level (exactly as
+  // S2CellId::parent does) and writes the terms without any reallocation.
+  const int num_levels = num_index_terms_per_point();
+  uint64_t lsbs[S2CellId::kMaxLevel + 1];
+  for (int i = 0; i < num_levels; ++i) {
+    lsbs[i] = S2CellId::lsb_for_level(options_.min_level() +
+                                      i * options_.level_mod());
+  }
+  size_t begin = terms->size();
+  terms->resize(begin + points.size() * num_levels);
+  uint64_t* dst = terms->data() + begin;
+  for (const S2Point& point : points) {
+    const uint64_t id = S2CellId(point).id();
+    for (int i = 0; i < num_levels; ++i) {
+      *dst++ = (id & (~lsbs[i] + 1)) | lsbs[i];
+    }
+  }
+}
+
+void S2RegionTermIndexer::AppendQueryTermsForPoints(
+    Span<const S2Point> points, vector<uint64_t>* terms) const {
+  // Like EmitQueryTerms(), the first term is an ancestor term at
+  // true_max_level() followed by covering terms for that cell and its
+  // ancestors, except that leaf cells have no covering term.
+  const int num_terms = num_query_terms_per_point();
+  uint64_t lsbs[S2CellId::kMaxLevel + 2];
+  lsbs[0] = S2CellId::lsb_for_level(options_.true_max_level());
+  for (int i = 1; i < num_terms; ++i) {
+    int level = options_.min_level() + (num_terms - 1 - i) *
+                                           options_.level_mod();
+    lsbs[i] = S2CellId::lsb_for_level(level);
+  }
+  size_t begin = terms->size();
+  terms->resize(begin + points.size() * num_terms);
+  uint64_t* dst = terms->data() + begin;
+  for (const S2Point& point : points) {
+    const uint64_t id = S2CellId(point).id();
+    *dst++ = (id & (~lsbs[0] + 1)) | lsbs[0];
+    for (int i = 1; i < num_terms; ++i) {
+      *dst++ = (id & (~lsbs[i] + 1)) | lsbs[i] | (lsbs[i] >> 1);
+    }
+  }
+}
+
+void S2RegionTermIndexer::AppendUniqueIndexTermsForPoints(
+    Span<const S2Point> points, vector<uint64_t>* terms) const {
+  // Sorting the leaf cells also sorts their ancestors at every level, so
+  // duplicate ancestors are adjacent.
+  vector<uint64_t> ids(points.size());
+  for (size_t i = 0; i < points.size(); ++i) {
+    ids[i] = S2CellId(points[i]).id();
+  }
+  std::sort(ids.begin(), ids.end());
+  for (int level = options_.min_level(); level <= options_.max_level();
+       level += options_.level_mod()) {
+    const uint64_t lsb = S2CellId::lsb_for_level(level);
+    uint64_t prev = 0;  // Not a valid S2CellId.
+    for (uint64_t id : ids) {
+      uint64_t ancestor = (id & (~lsb + 1)) | lsb;
+      if (ancestor != prev) terms->push_back(ancestor);
+      prev = ancestor;
+    }
+  }
+}
+
+string S2RegionTermIndexer::GetTermString(uint64_t term,
+                                          string_view prefix) const {
+  const uint64_t lsb = term & (~term + 1);
+  if (lsb & 0x5555555555555555) {
+    return GetTerm(TermType::ANCESTOR, S2CellId(term), prefix);
+  }
+  return GetTerm(TermType::COVERING, S2CellId(term - lsb), prefix);
+}
+
+template <class Emit>
+void S2RegionTermIndexer::EmitIndexTerms(const S2Point& point,
+                                         const Emit& emit) const {
   // See the top of this file for an overview of the indexing strategy.
   //
   // The last cell generated by this loop is effectively the covering for
@@ -141,27 +249,15 @@ vector<string> S2RegionTermIndexer::GetIndexTerms(const S2Point& point,
   // max_level() != true_max_level() (see S2RegionCoverer::Options).
 
   const S2CellId id(point);
-  vector<string> terms;
-  terms.reserve((options_.true_max_level() - options_.min_level()) /
-                    options_.level_mod() +
-                1);
   for (int level = options_.min_level(); level <= options_.max_level();
        level += options_.level_mod()) {
-    terms.push_back(GetTerm(TermType::ANCESTOR, id.parent(level), prefix));
+    emit(TermType::ANCESTOR, id.parent(level));
   }
-  return terms;
-}
-
-vector<string> S2RegionTermIndexer::GetIndexTerms(const S2Region& region,
-                                                  string_view prefix) {
-  // Note that options may have changed since the last call.
-  *coverer_.mutable_options() = options_;
-  S2CellUnion covering = coverer_.GetCovering(region);
-  return GetIndexTermsForCanonicalCovering(covering, prefix);
 }
 
-vector<string> S2RegionTermIndexer::GetIndexTermsForCanonicalCovering(
-    const S2CellUnion& covering, string_view prefix) {
+template <class Emit>
+void S2RegionTermIndexer::EmitIndexTermsForCanonicalCovering(
+    const S2CellUnion& covering, const Emit& emit) {
   // See the top of this file for an overview of the indexing strategy.
   //
   // Cells in the covering are normally indexed as covering terms.  If we are
@@ -176,10 +272,6 @@ vector<string> S2RegionTermIndexer::GetIndexTermsForCanonicalCovering(
     *coverer_.mutable_options() = options_;
     ABSL_CHECK(coverer_.IsCanonical(covering));
   }
-  vector<string> terms;
-  // `covering.size()` is necessary.  Double it because we'll probably add
-  // more.  This could probably reasonably be even higher.
-  terms.reserve(2 * covering.size());
   S2CellId prev_id = S2CellId::None();
   int true_max_level = options_.true_max_level();
   for (S2CellId id : covering) {
@@ -192,11 +284,11 @@ vector<string> S2RegionTermIndexer::GetIndexTermsForCanonicalCovering(
 
     if (level < true_max_level) {
       // Add a covering term for this cell.
-      terms.push_back(GetTerm(TermType::COVERING, id, prefix));
+      emit(TermType::COVERING, id);
     }
     if (level == true_max_level || !options_.optimize_for_space()) {
       // Add an ancestor term for this cell at the constrained level.
-      terms.push_back(GetTerm(TermType::ANCESTOR, id.parent(level), prefix));
+      emit(TermType::ANCESTOR, id.parent(level));
     }
     // Finally, add ancestor terms for all the ancestors of this cell.
     while ((level -= options_.level_mod()) >= options_.min_level()) {
@@ -205,54 +297,38 @@ vector<string> S2RegionTermIndexer::GetIndexTermsForCanonicalCovering(
           prev_id.parent(level) == ancestor_id) {
         break;  // We have already processed this cell and its ancestors.
       }
-      terms.push_back(GetTerm(TermType::ANCESTOR, ancestor_id, prefix));
+      emit(TermType::ANCESTOR, ancestor_id);
     }
     prev_id = id;
   }
-  return terms;
 }
 
-vector<string> S2RegionTermIndexer::GetQueryTerms(const S2Point& point,
-                                                  string_view prefix) {
+template <class Emit>
+void S2RegionTermIndexer::EmitQueryTerms(const S2Point& point,
+                                         const Emit& emit) const {
   // See the top of this file for an overview of the indexing strategy.
 
   const S2CellId id(point);
-  vector<string> terms;
-  terms.reserve(options_.index_contains_points_only()
-                    ? 1
-                    : ((options_.true_max_level() - options_.min_level()) /
-                           options_.level_mod() +
-                       2));
   // Recall that all true_max_level() cells are indexed only as ancestor terms.
   int level = options_.true_max_level();
-  terms.push_back(GetTerm(TermType::ANCESTOR, id.parent(level), prefix));
-  if (options_.index_contains_points_only()) return terms;
+  emit(TermType::ANCESTOR, id.parent(level));
+  if (options_.index_contains_points_only()) return;
 
   // Add covering terms for all the ancestor cells.
   for (; level >= options_.min_level(); level -= options_.level_mod()) {
-    terms.push_back(GetTerm(TermType::COVERING, id.parent(level), prefix));
+    emit(TermType::COVERING, id.parent(level));
   }
-  return terms;
-}
-
-vector<string> S2RegionTermIndexer::GetQueryTerms(const S2Region& region,
-                                                  string_view prefix) {
-  // Note that options may have changed since the last call.
-  *coverer_.mutable_options() = options_;
-  S2CellUnion covering = coverer_.GetCovering(region);
-  return GetQueryTermsForCanonicalCovering(covering, prefix);
 }
 
-vector<string> S2RegionTermIndexer::GetQueryTermsForCanonicalCovering(
-    const S2CellUnion& covering, string_view prefix) {
+template <class Emit>
+void S2RegionTermIndexer::EmitQueryTermsForCanonicalCovering(
+    const S2CellUnion& covering, const Emit& emit) {
   // See the top of this file for an overview of the indexing strategy.
 
   if (S2_DEBUG_MODE) {
     *coverer_.mutable_options() = options_;
     ABSL_CHECK(coverer_.IsCanonical(covering));
   }
-  vector<string> terms;
-  terms.reserve(2 * covering.size());
   S2CellId prev_id = S2CellId::None();
   int true_max_level = options_.true_max_level();
   for (S2CellId id : covering) {
@@ -264,7 +340,7 @@ vector<string> S2RegionTermIndexer::GetQueryTermsForCanonicalCovering(
     ABSL_DCHECK_EQ(0, (level - options_.min_level()) % options_.level_mod());
 
     // Cells in the covering are always queried as ancestor terms.
-    terms.push_back(GetTerm(TermType::ANCESTOR, id, prefix));
+    emit(TermType::ANCESTOR, id);
 
     // If the index only contains points, there are no covering terms.
     if (options_.index_contains_points_only()) continue;
@@ -273,7 +349,7 @@ vector<string> S2RegionTermIndexer::GetQueryTermsForCanonicalCovering(
     // also queried as covering terms (except for true_max_level() cells,
     // which are indexed and queried as ancestor cells only).
     if (options_.optimize_for_space() && level < true_max_level) {
-      terms.push_back(GetTerm(TermType::COVERING, id, prefix));
+      emit(TermType::COVERING, id);
     }
     // Finally, add covering terms for all the ancestors of this cell.
     while ((level -= options_.level_mod()) >= options_.min_level()) {
@@ -282,9 +358,226 @@ vector<string> S2RegionTermIndexer::GetQueryTermsForCanonicalCovering(
           prev_id.parent(level) == ancestor_id) {
         break;  // We have already processed this cell and its ancestors.
       }
-      terms.push_back(GetTerm(TermType::COVERING, ancestor_id, prefix));
+      emit(TermType::COVERING, ancestor_id);
     }
     prev_id = id;
   }
+}
+
+vector<string> S2RegionTermIndexer::GetIndexTerms(const S2Point& point,
+                                                  string_view prefix) {
+  vector<string> terms;
+  terms.reserve((options_.true_max_level() - options_.min_level()) /
+                    options_.level_mod() +
+                1);
+  EmitIndexTerms(point, [&](TermType term_type, S2CellId id) {
+    terms.push_back(GetTerm(term_type, id, prefix));
+  });
   return terms;
 }
+
+vector<string> S2RegionTermIndexer::GetIndexTerms(const S2Region& region,
+                                                  string_view prefix) {
+  // Note that options may have changed since the last call.
+  *coverer_.mutable_options() = options_;
+  S2CellUnion covering = coverer_.GetCovering(region);
+  return GetIndexTermsForCanonicalCovering(covering, prefix);
+}
+
+vector<string> S2RegionTermIndexer::GetIndexTermsForCanonicalCovering(
+    const S2CellUnion& covering, string_view prefix) {
+  vector<string> terms;
+  // `covering.size()` is necessary.  Double it because we'll probably add
+  // more.  This could probably reasonably be even higher.
+  terms.reserve(2 * covering.size());
+  EmitIndexTermsForCanonicalCovering(
+      covering, [&](TermType term_type, S2CellId id) {
+        terms.push_back(GetTerm(term_type, id, prefix));
+      });
+  return terms;
+}
+
+vector<string> S2RegionTermIndexer::GetQueryTerms(const S2Point& point,
+                                                  string_view prefix) {
+  vector<string> terms;
+  terms.reserve(options_.index_contains_points_only()
+                    ? 1
+                    : ((options_.true_max_level() - options_.min_level()) /
+                           options_.level_mod() +
+                       2));
+  EmitQueryTerms(point, [&](TermType term_type, S2CellId id) {
+    terms.push_back(GetTerm(term_type, id, prefix));
+  });
+  return terms;
+}
+
+vector<string> S2RegionTermIndexer::GetQueryTerms(const S2Region& region,
+                                                  string_view prefix) {
+  // Note that options may have changed since the last call.
+  *coverer_.mutable_options() = options_;
+  S2CellUnion covering = coverer_.GetCovering(region);
+  return GetQueryTermsForCanonicalCovering(covering, prefix);
+}
+
+vector<string> S2RegionTermIndexer::GetQueryTermsForCanonicalCovering(
+    const S2CellUnion& covering, string_view prefix) {
+  vector<string> terms;
+  terms.reserve(2 * covering.size());
+  EmitQueryTermsForCanonicalCovering(
+      covering, [&](TermType term_type, S2CellId id) {
+        terms.push_back(GetTerm(term_type, id, prefix));
+      });
+  return terms;
+}
+
+void S2RegionTermIndexer::AppendIndexTerms(const S2Region& region,
+                                           vector<uint64_t>* terms) {
+  // Note that options may have changed since the last call.
+  *coverer_.mutable_options() = options_;
+  S2CellUnion covering = coverer_.GetCovering(region);
+  AppendIndexTermsForCanonicalCovering(covering, terms);
+}
+
+void S2RegionTermIndexer::AppendQueryTerms(const S2Region& region,
+                                           vector<uint64_t>* terms) {
+  // Note that options may have changed since the last call.
+  *coverer_.mutable_options() = options_;
+  S2CellUnion covering = coverer_.GetCovering(region);
+  AppendQueryTermsForCanonicalCovering(covering, terms);
+}
+
+void S2RegionTermIndexer::AppendIndexTerms(const S2Point& point,
+                                           vector<uint64_t>* terms) {
+  EmitIndexTerms(point, [terms](TermType term_type, S2CellId id) {
+    terms->push_back(GetIntegerTerm(term_type, id));
+  });
+}
+
+void S2RegionTermIndexer::AppendQueryTerms(const S2Point& point,
+                                           vector<uint64_t>* terms) {
+  EmitQueryTerms(point, [terms](TermType term_type, S2CellId id) {
+    // Leaf cells are only indexed as ancestor terms (see above).
+    if (term_type == TermType::COVERING && id.is_leaf()) return;
+    terms->push_back(GetIntegerTerm(term_type, id));
+  });
+}
+
+void S2RegionTermIndexer::AppendIndexTermsForCanonicalCovering(
+    const S2CellUnion& covering, vector<uint64_t>* terms) {
+  EmitIndexTermsForCanonicalCovering(
+      covering, [terms](TermType term_type, S2CellId id) {
+        terms->push_back(GetIntegerTerm(term_type, id));
+      });
+}
+
+void S2RegionTermIndexer::AppendQueryTermsForCanonicalCovering(
+    const S2CellUnion& covering, vector<uint64_t>* terms) {
+  EmitQueryTermsForCanonicalCovering(
+      covering, [terms](TermType term_type, S2CellId id) {
+        terms->push_back(GetIntegerTerm(term_type, id));
+      });
+}
+
+vector<string> S2RegionTermIndexer::GetIndexTerms(const S2Region& region,
+                                                  uint64_t fingerprint,
+                                                  string_view prefix,
+                                                  TermCache* cache) {
+  return GetTermsWithCache(false, region, fingerprint, prefix, cache);
+}
+
+vector<string> S2RegionTermIndexer::GetQueryTerms(const S2Region& region,
+                                                  uint64_t fingerprint,
+                                                  string_view prefix,
+                                                  TermCache* cache) {
+  return GetTermsWithCache(true, region, fingerprint, prefix, cache);
+}
+
+vector<string> S2RegionTermIndexer::GetTermsWithCache(bool query,
+                                                      const S2Region& region,
+                                                      uint64_t fingerprint,
+                                                      string_view prefix,
+                                                      TermCache* cache) {
+  TermCache::Key key;
+  key.fingerprint = fingerprint;
+  key.query = query;
+  key.prefix = string(prefix);
+  key.max_cells = options_.max_cells();
+  key.min_level = options_.min_level();
+  key.max_level = options_.max_level();
+  key.level_mod = options_.level_mod();
+  key.points_only = options_.index_contains_points_only();
+  key.optimize_for_space = options_.optimize_for_space();
+  key.marker = options_.marker_character();
+  vector<string> terms;
+  if (cache->Lookup(key, &terms)) return terms;
+  terms = query ? GetQueryTerms(region, prefix) : GetIndexTerms(region, prefix);
+  cache->Insert(key, terms);
+  return terms;
+}
+
+S2RegionTermIndexer::TermCache::TermCache(size_t max_entries)
+    : max_entries_(max_entries) {
+  ABSL_DCHECK_GT(max_entries, 0);
+}
+
+bool S2RegionTermIndexer::TermCache::Key::operator==(const Key& other) const {
+  return fingerprint == other.fingerprint && query == other.query &&
+         prefix == other.prefix && max_cells == other.max_cells &&
+         min_level == other.min_level && max_level == other.max_level &&
+         level_mod == other.level_mod && points_only == other.points_only &&
+         optimize_for_space == other.optimize_for_space &&
+         marker == other.marker;
+}
+
+int64_t S2RegionTermIndexer::TermCache::hits() const {
+  absl::MutexLock lock(&lock_);
+  return hits_;
+}
+
+int64_t S2RegionTermIndexer::TermCache::misses() const {
+  absl::MutexLock lock(&lock_);
+  return misses_;
+}
+
+size_t S2RegionTermIndexer::TermCache::size() const {
+  absl::MutexLock lock(&lock_);
+  return entries_.size();
+}
+
+void S2RegionTermIndexer::TermCache::Clear() {
+  absl::MutexLock lock(&lock_);
+  map_.clear();
+  entries_.clear();
+}
+
+bool S2RegionTermIndexer::TermCache::Lookup(const Key& key,
+                                            vector<string>* terms) {
+  absl::MutexLock lock(&lock_);
+  auto it = map_.find(key);
+  if (it == map_.end()) {
+    ++misses_;
+    return false;
+  }
+  ++hits_;
+  entries_.splice(entries_.begin(), entries_, it->second);
+  *terms = it->second->second;
+  return true;
+}
+
+void S2RegionTermIndexer::TermCache::Insert(const Key& key,
+                                            const vector<string>& terms) {
+  absl::MutexLock lock(&lock_);
+  auto it = map_.find(key);
+  if (it != map_.end()) {
+    // Another thread added the same terms while we were computing them.
+    entries_.splice(entries_.begin(), entries_, it->second);
+    return;
+  }
+  if (max_entries_ == 0) return;
+  if (entries_.size() == max_entries_) {
+    map_.erase(entries_.back().first);
+    entries_.pop_back();
+  }
+  entries_.emplace_front(key, terms);
+  map_.emplace(key, entries_.begin());
+}
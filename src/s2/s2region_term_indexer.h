@@ -97,10 +97,18 @@
 #ifndef S2_S2REGION_TERM_INDEXER_H_
 #define S2_S2REGION_TERM_INDEXER_H_
 
+#include <cstddef>
+#include <cstdint>
+#include <list>
 #include <string>
+#include <utility>
 #include <vector>
 
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
 #include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/types/span.h"
 
 #include "s2/s2cell_id.h"
 #include "s2/s2cell_union.h"
@@ -245,6 +253,8 @@ class S2RegionTermIndexer {
   const Options& options() const { return options_; }
   Options* mutable_options() { return &options_; }
 
+  class TermCache;
+
   // Converts the given region into a set of terms for indexing.  Terms
   // consist of lowercase letters, numbers, '$', and an optional prefix.
   //
@@ -264,6 +274,21 @@ class S2RegionTermIndexer {
   std::vector<std::string> GetQueryTerms(const S2Region& region,
                                          absl::string_view prefix);
 
+  // Like the methods above, but first looks up the terms in the given cache
+  // (see TermCache below), and adds them to the cache if they were not
+  // found.  "fingerprint" is a client-supplied value that identifies the
+  // region, e.g. a hash of its encoding or a database id; regions that have
+  // the same fingerprint must be identical.  The current options and
+  // "prefix" are also part of the cache key.
+  std::vector<std::string> GetIndexTerms(const S2Region& region,
+                                         uint64_t fingerprint,
+                                         absl::string_view prefix,
+                                         TermCache* cache);
+  std::vector<std::string> GetQueryTerms(const S2Region& region,
+                                         uint64_t fingerprint,
+                                         absl::string_view prefix,
+                                         TermCache* cache);
+
   // Convenience methods that accept an S2Point rather than S2Region.  (These
   // methods are also faster.)
   //
@@ -289,14 +314,155 @@ class S2RegionTermIndexer {
   std::vector<std::string> GetQueryTermsForCanonicalCovering(
       const S2CellUnion& covering, absl::string_view prefix);
 
+  // Like the methods above, except that each term is represented as a 64-bit
+  // integer rather than a string, and the terms are appended to "terms"
+  // (which is not cleared first).  This avoids allocating memory for every
+  // term, and is useful for inverted indexes whose keys are integers.  The
+  // same vector can be reused for many regions to avoid allocations
+  // altogether.
+  //
+  // An ancestor term is simply the S2CellId, while a covering term is the
+  // S2CellId with the bit just below its lowest set bit also set.  Covering
+  // terms are therefore never valid S2CellIds, so the two types of terms are
+  // always distinct.  GetTermString() converts an integer term to the
+  // equivalent string term.
+  //
+  // The terms are the same as those returned by the string methods, except
+  // that AppendQueryTerms() for an S2Point omits the covering term for a
+  // leaf cell (which occurs when true_max_level() is S2CellId::kMaxLevel).
+  // Such a term never matches since leaf cells are only indexed as ancestor
+  // terms.
+  void AppendIndexTerms(const S2Region& region, std::vector<uint64_t>* terms);
+  void AppendQueryTerms(const S2Region& region, std::vector<uint64_t>* terms);
+  void AppendIndexTerms(const S2Point& point, std::vector<uint64_t>* terms);
+  void AppendQueryTerms(const S2Point& point, std::vector<uint64_t>* terms);
+  void AppendIndexTermsForCanonicalCovering(const S2CellUnion& covering,
+                                            std::vector<uint64_t>* terms);
+  void AppendQueryTermsForCanonicalCovering(const S2CellUnion& covering,
+                                            std::vector<uint64_t>* terms);
+
+  // Like AppendIndexTerms() and AppendQueryTerms() for an S2Point, but for
+  // many points at once.  This is considerably faster than computing the
+  // terms one point at a time.  Every point has the same number of terms
+  // (see num_index_terms_per_point() and num_query_terms_per_point()), so
+  // the terms of points[i] are simply the i-th group of that many terms
+  // appended to "terms".
+  void AppendIndexTermsForPoints(absl::Span<const S2Point> points,
+                                 std::vector<uint64_t>* terms) const;
+  void AppendQueryTermsForPoints(absl::Span<const S2Point> points,
+                                 std::vector<uint64_t>* terms) const;
+  int num_index_terms_per_point() const;
+  int num_query_terms_per_point() const;
+
+  // Appends the index terms for a single document that consists of all the
+  // given points, with duplicates removed.  (Nearby points share most of
+  // their ancestor terms.)  The terms are sorted by cell level and then by
+  // S2CellId.
+  void AppendUniqueIndexTermsForPoints(absl::Span<const S2Point> points,
+                                       std::vector<uint64_t>* terms) const;
+
+  // Returns the string form of the given integer term, i.e. the term that
+  // the corresponding string method would have returned.
+  std::string GetTermString(uint64_t term, absl::string_view prefix) const;
+
  private:
   enum TermType { ANCESTOR, COVERING };
 
   std::string GetTerm(TermType term_type, const S2CellId id,
                       absl::string_view prefix) const;
+  static uint64_t GetIntegerTerm(TermType term_type, S2CellId id);
+
+  // These methods generate the terms for the corresponding public methods by
+  // calling emit(term_type, id) for each term.
+  template <class Emit>
+  void EmitIndexTerms(const S2Point& point, const Emit& emit) const;
+  template <class Emit>
+  void EmitQueryTerms(const S2Point& point, const Emit& emit) const;
+  template <class Emit>
+  void EmitIndexTermsForCanonicalCovering(const S2CellUnion& covering,
+                                          const Emit& emit);
+  template <class Emit>
+  void EmitQueryTermsForCanonicalCovering(const S2CellUnion& covering,
+                                          const Emit& emit);
+
+  // Implements the cached versions of GetIndexTerms() and GetQueryTerms().
+  std::vector<std::string> GetTermsWithCache(bool query,
+                                             const S2Region& region,
+                                             uint64_t fingerprint,
+                                             absl::string_view prefix,
+                                             TermCache* cache);
 
   Options options_;
   S2RegionCoverer coverer_;
 };
 
+// A bounded cache of the terms returned by S2RegionTermIndexer, for clients
+// that compute terms for the same regions many times.  When the cache is
+// full, the least recently used entry is discarded.
+//
+// This class is thread-safe, so that a single cache can be shared by many
+// S2RegionTermIndexer objects (each of which may only be used by one thread
+// at a time).  Note that terms are computed without holding the lock, so two
+// threads that miss on the same region at the same time both compute its
+// terms.
+class S2RegionTermIndexer::TermCache {
+ public:
+  // Creates a cache that holds the terms for at most "max_entries" regions.
+  explicit TermCache(size_t max_entries);
+
+  TermCache(const TermCache&) = delete;
+  TermCache& operator=(const TermCache&) = delete;
+
+  // Returns the number of lookups that found and did not find their terms in
+  // the cache, respectively.
+  int64_t hits() const;
+  int64_t misses() const;
+
+  // Returns the number of regions whose terms are currently cached.
+  size_t size() const;
+
+  // Removes all entries from the cache (but does not reset the counters).
+  void Clear();
+
+ private:
+  friend class S2RegionTermIndexer;
+
+  // Everything that the terms for a region depend on.
+  struct Key {
+    uint64_t fingerprint;
+    bool query;
+    std::string prefix;
+    int max_cells, min_level, max_level, level_mod;
+    bool points_only, optimize_for_space;
+    char marker;
+
+    bool operator==(const Key& other) const;
+    template <typename H>
+    friend H AbslHashValue(H h, const Key& x) {
+      return H::combine(std::move(h), x.fingerprint, x.query, x.prefix,
+                        x.max_cells, x.min_level, x.max_level, x.level_mod,
+                        x.points_only, x.optimize_for_space, x.marker);
+    }
+  };
+  using Entry = std::pair<Key, std::vector<std::string>>;
+
+  // Looks up "key" and if found, copies its terms to "terms", marks it as
+  // most recently used, and returns true.
+  bool Lookup(const Key& key, std::vector<std::string>* terms);
+
+  // Adds the given terms to the cache, evicting the least recently used entry
+  // if necessary.
+  void Insert(const Key& key, const std::vector<std::string>& terms);
+
+  const size_t max_entries_;
+  mutable absl::Mutex lock_;
+
+  // The cached entries, ordered from most to least recently used.
+  std::list<Entry> entries_ ABSL_GUARDED_BY(lock_);
+  absl::flat_hash_map<Key, std::list<Entry>::iterator> map_
+      ABSL_GUARDED_BY(lock_);
+  int64_t hits_ ABSL_GUARDED_BY(lock_) = 0;
+  int64_t misses_ ABSL_GUARDED_BY(lock_) = 0;
+};
+
 #endif  // S2_S2REGION_TERM_INDEXER_H_
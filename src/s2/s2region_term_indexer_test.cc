@@ -17,7 +17,9 @@
 
 #include "s2/s2region_term_indexer.h"
 
+#include <cstdint>
 #include <string>
+#include <thread>
 #include <utility>
 #include <vector>
 
@@ -33,6 +35,7 @@
 #include "absl/strings/string_view.h"
 
 #include "s2/base/commandlineflags.h"
+#include "s2/s1angle.h"
 #include "s2/s2cap.h"
 #include "s2/s2cell.h"
 #include "s2/s2cell_id.h"
@@ -247,6 +250,142 @@ TEST(S2RegionTermIndexer, MaxLevelSetLoosely) {
             indexer2.GetQueryTerms(cap, ""));
 }
 
+// Converts the given integer terms to strings.
+vector<string> GetTermStrings(const S2RegionTermIndexer& indexer,
+                              const vector<uint64_t>& terms,
+                              string_view prefix) {
+  vector<string> result;
+  for (uint64_t term : terms) {
+    result.push_back(indexer.GetTermString(term, prefix));
+  }
+  return result;
+}
+
+TEST(S2RegionTermIndexer, IntegerTermsMatchStringTerms) {
+  absl::BitGen bitgen(S2Testing::MakeTaggedSeedSeq(
+      "INTEGER_TERMS_MATCH_STRING_TERMS",
+      absl::LogInfoStreamer(__FILE__, __LINE__).stream()));
+  for (bool points_only : {false, true}) {
+    for (bool optimize_for_space : {false, true}) {
+      for (int level_mod : {1, 2}) {
+        S2RegionTermIndexer::Options options;
+        options.set_index_contains_points_only(points_only);
+        options.set_optimize_for_space(optimize_for_space);
+        options.set_level_mod(level_mod);
+        S2RegionTermIndexer indexer(options);
+        vector<uint64_t> terms;
+        for (int iter = 0; iter < 20; ++iter) {
+          S2Point point = s2random::Point(bitgen);
+          terms.clear();
+          indexer.AppendQueryTerms(point, &terms);
+          EXPECT_EQ(GetTermStrings(indexer, terms, "p:"),
+                    indexer.GetQueryTerms(point, "p:"));
+          terms.clear();
+          indexer.AppendIndexTerms(point, &terms);
+          EXPECT_EQ(GetTermStrings(indexer, terms, "p:"),
+                    indexer.GetIndexTerms(point, "p:"));
+
+          S2Cap cap = s2random::Cap(
+              bitgen, 0.3 * S2Cell::AverageArea(options.max_level()),
+              4.0 * S2Cell::AverageArea(options.min_level()));
+          terms.clear();
+          indexer.AppendQueryTerms(cap, &terms);
+          EXPECT_EQ(GetTermStrings(indexer, terms, ""),
+                    indexer.GetQueryTerms(cap, ""));
+          if (points_only) continue;
+          terms.clear();
+          indexer.AppendIndexTerms(cap, &terms);
+          EXPECT_EQ(GetTermStrings(indexer, terms, ""),
+                    indexer.GetIndexTerms(cap, ""));
+        }
+      }
+    }
+  }
+}
+
+TEST(S2RegionTermIndexer, IntegerTermsAtMaxLevel) {
+  // Ancestor terms for leaf cells and covering terms for their parents are
+  // distinct even though both have the lowest bit set.
+  S2RegionTermIndexer::Options options;
+  options.set_min_level(29);
+  options.set_max_level(S2CellId::kMaxLevel);
+  S2RegionTermIndexer indexer(options);
+  S2Point point = S2LatLng::FromDegrees(10, 20).ToPoint();
+  S2CellId leaf(point);
+  vector<uint64_t> terms;
+  indexer.AppendQueryTerms(point, &terms);
+  S2CellId parent = leaf.parent();
+  EXPECT_EQ(terms, vector<uint64_t>(
+                       {leaf.id(), parent.id() | (parent.lsb() >> 1)}));
+
+  // The covering term for the leaf cell itself is omitted.
+  vector<string> string_terms = indexer.GetQueryTerms(point, "");
+  EXPECT_EQ(GetTermStrings(indexer, terms, ""),
+            vector<string>({string_terms[0], string_terms[2]}));
+  EXPECT_EQ(string_terms[1], "$" + leaf.ToToken());
+
+  // Appending does not clear the existing terms.
+  indexer.AppendIndexTerms(point, &terms);
+  EXPECT_EQ(terms.size(), 4);
+  EXPECT_EQ(terms[3], leaf.id());
+}
+
+TEST(S2RegionTermIndexer, TermsForPointsMatchSinglePoints) {
+  absl::BitGen bitgen(S2Testing::MakeTaggedSeedSeq(
+      "TERMS_FOR_POINTS_MATCH_SINGLE_POINTS",
+      absl::LogInfoStreamer(__FILE__, __LINE__).stream()));
+  vector<S2Point> points;
+  for (int i = 0; i < 100; ++i) points.push_back(s2random::Point(bitgen));
+  for (bool points_only : {false, true}) {
+    for (int level_mod : {1, 2, 3}) {
+      for (int max_level : {16, S2CellId::kMaxLevel}) {
+        S2RegionTermIndexer::Options options;
+        options.set_index_contains_points_only(points_only);
+        options.set_level_mod(level_mod);
+        options.set_max_level(max_level);
+        S2RegionTermIndexer indexer(options);
+        vector<uint64_t> expected_index = {1}, expected_query = {2};
+        for (const S2Point& point : points) {
+          indexer.AppendIndexTerms(point, &expected_index);
+          indexer.AppendQueryTerms(point, &expected_query);
+        }
+        vector<uint64_t> index_terms = {1}, query_terms = {2};
+        indexer.AppendIndexTermsForPoints(points, &index_terms);
+        indexer.AppendQueryTermsForPoints(points, &query_terms);
+        EXPECT_EQ(index_terms, expected_index);
+        EXPECT_EQ(query_terms, expected_query);
+        EXPECT_EQ(index_terms.size(),
+                  1 + points.size() * indexer.num_index_terms_per_point());
+        EXPECT_EQ(query_terms.size(),
+                  1 + points.size() * indexer.num_query_terms_per_point());
+      }
+    }
+  }
+}
+
+TEST(S2RegionTermIndexer, UniqueIndexTermsForPoints) {
+  absl::BitGen bitgen(S2Testing::MakeTaggedSeedSeq(
+      "UNIQUE_INDEX_TERMS_FOR_POINTS",
+      absl::LogInfoStreamer(__FILE__, __LINE__).stream()));
+  S2RegionTermIndexer indexer;
+  // Nearby points (including duplicates) share many ancestors.
+  S2Cap cap(s2random::Point(bitgen), S1Angle::Degrees(1));
+  vector<S2Point> points;
+  for (int i = 0; i < 100; ++i) {
+    points.push_back(s2random::SamplePoint(bitgen, cap));
+  }
+  points.push_back(points[0]);
+  vector<uint64_t> all_terms, unique_terms;
+  indexer.AppendIndexTermsForPoints(points, &all_terms);
+  indexer.AppendUniqueIndexTermsForPoints(points, &unique_terms);
+  absl::flat_hash_set<uint64_t> expected(all_terms.begin(), all_terms.end());
+  EXPECT_EQ(unique_terms.size(), expected.size());
+  EXPECT_EQ(absl::flat_hash_set<uint64_t>(unique_terms.begin(),
+                                          unique_terms.end()),
+            expected);
+  EXPECT_LT(unique_terms.size(), all_terms.size());
+}
+
 TEST(S2RegionTermIndexer, MoveConstructor) {
   S2RegionTermIndexer x;
   x.mutable_options()->set_max_cells(12345);
@@ -263,4 +402,71 @@ TEST(S2RegionTermIndexer, MoveAssignmentOperator) {
   EXPECT_EQ(12345, y.options().max_cells());
 }
 
+TEST(S2RegionTermIndexer, TermCache) {
+  absl::BitGen bitgen(S2Testing::MakeTaggedSeedSeq(
+      "TERM_CACHE", absl::LogInfoStreamer(__FILE__, __LINE__).stream()));
+  S2RegionTermIndexer indexer;
+  S2RegionTermIndexer::TermCache cache(2);
+  S2Cap cap1 = s2random::Cap(bitgen, 1e-6, 1e-3);
+  S2Cap cap2 = s2random::Cap(bitgen, 1e-6, 1e-3);
+  const vector<string> index1 = indexer.GetIndexTerms(cap1, "p");
+  const vector<string> query1 = indexer.GetQueryTerms(cap1, "p");
+
+  EXPECT_EQ(indexer.GetIndexTerms(cap1, 1, "p", &cache), index1);
+  EXPECT_EQ(indexer.GetIndexTerms(cap1, 1, "p", &cache), index1);
+  EXPECT_EQ(cache.hits(), 1);
+  EXPECT_EQ(cache.misses(), 1);
+
+  // Query terms, other prefixes, and other options are cached separately.
+  EXPECT_EQ(indexer.GetQueryTerms(cap1, 1, "p", &cache), query1);
+  EXPECT_EQ(indexer.GetIndexTerms(cap1, 1, "q", &cache),
+            indexer.GetIndexTerms(cap1, "q"));
+  indexer.mutable_options()->set_max_cells(4);
+  EXPECT_EQ(indexer.GetIndexTerms(cap1, 1, "p", &cache),
+            indexer.GetIndexTerms(cap1, "p"));
+  EXPECT_EQ(cache.hits(), 1);
+  EXPECT_EQ(cache.misses(), 4);
+  EXPECT_EQ(cache.size(), 2);
+
+  // The least recently used entries have been evicted.
+  indexer.mutable_options()->set_max_cells(8);
+  EXPECT_EQ(indexer.GetQueryTerms(cap1, 1, "p", &cache), query1);
+  EXPECT_EQ(cache.misses(), 5);
+  EXPECT_EQ(indexer.GetIndexTerms(cap2, 2, "p", &cache),
+            indexer.GetIndexTerms(cap2, "p"));
+  EXPECT_EQ(indexer.GetQueryTerms(cap1, 1, "p", &cache), query1);
+  EXPECT_EQ(cache.hits(), 2);
+
+  cache.Clear();
+  EXPECT_EQ(cache.size(), 0);
+  EXPECT_EQ(indexer.GetQueryTerms(cap1, 1, "p", &cache), query1);
+  EXPECT_EQ(cache.misses(), 7);
+}
+
+TEST(S2RegionTermIndexer, TermCacheConcurrentUse) {
+  absl::BitGen bitgen;
+  vector<S2Cap> caps;
+  vector<vector<string>> expected;
+  S2RegionTermIndexer indexer;
+  for (int i = 0; i < 20; ++i) {
+    caps.push_back(s2random::Cap(bitgen, 1e-6, 1e-3));
+    expected.push_back(indexer.GetIndexTerms(caps.back(), ""));
+  }
+  S2RegionTermIndexer::TermCache cache(10);
+  vector<std::thread> threads;
+  for (int t = 0; t < 4; ++t) {
+    threads.emplace_back([&, t]() {
+      S2RegionTermIndexer thread_indexer;
+      for (int i = 0; i < 200; ++i) {
+        int j = (i * (t + 1)) % caps.size();
+        EXPECT_EQ(thread_indexer.GetIndexTerms(caps[j], j, "", &cache),
+                  expected[j]);
+      }
+    });
+  }
+  for (auto& thread : threads) thread.join();
+  EXPECT_EQ(cache.hits() + cache.misses(), 800);
+  EXPECT_LE(cache.size(), 10);
+}
+
 }  // namespace
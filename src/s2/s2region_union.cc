@@ -17,11 +17,16 @@
 
 #include "s2/s2region_union.h"
 
+#include <algorithm>
+#include <cstddef>
 #include <memory>
+#include <numeric>
 #include <utility>
 #include <vector>
 
+#include "absl/container/fixed_array.h"
 #include "absl/log/absl_check.h"
+#include "absl/types/span.h"
 #include "s2/s2cap.h"
 #include "s2/s2latlng_rect.h"
 #include "s2/s2point.h"
@@ -94,6 +99,33 @@ bool S2RegionUnion::Contains(const S2Point& p) const {
   return false;
 }
 
+void S2RegionUnion::ContainsPoints(absl::Span<const S2Point> points,
+                                   absl::Span<bool> results) const {
+  ABSL_DCHECK_EQ(points.size(), results.size());
+  std::fill(results.begin(), results.end(), false);
+  // "remaining" holds the points that are not contained by any of the
+  // regions tested so far, and "ids" holds their positions in "points".
+  vector<S2Point> remaining(points.begin(), points.end());
+  vector<int> ids(points.size());
+  std::iota(ids.begin(), ids.end(), 0);
+  absl::FixedArray<bool> region_results(points.size());
+  for (int i = 0; i < num_regions() && !remaining.empty(); ++i) {
+    const size_t n = remaining.size();
+    region(i)->ContainsPoints(remaining,
+                              absl::MakeSpan(region_results.data(), n));
+    size_t num_remaining = 0;
+    for (size_t j = 0; j < n; ++j) {
+      if (region_results[j]) {
+        results[ids[j]] = true;
+      } else {
+        remaining[num_remaining] = remaining[j];
+        ids[num_remaining++] = ids[j];
+      }
+    }
+    remaining.resize(num_remaining);
+  }
+}
+
 bool S2RegionUnion::MayIntersect(const S2Cell& cell) const {
   for (int i = 0; i < num_regions(); ++i) {
     if (region(i)->MayIntersect(cell)) return true;
@@ -17,6 +17,7 @@
 
 #include "s2/s2region_union.h"
 
+#include <cstddef>
 #include <memory>
 #include <string>
 #include <utility>
@@ -24,12 +25,15 @@
 
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
+#include "absl/container/fixed_array.h"
+#include "absl/types/span.h"
 #include "s2/s1angle.h"
 #include "s2/s2cap.h"
 #include "s2/s2cell.h"
 #include "s2/s2cell_id.h"
 #include "s2/s2latlng.h"
 #include "s2/s2latlng_rect.h"
+#include "s2/s2point.h"
 #include "s2/s2point_region.h"
 #include "s2/s2region.h"
 #include "s2/s2region_coverer.h"
@@ -90,4 +94,32 @@ TEST(S2RegionUnionTest, Basic) {
   EXPECT_EQ(face0.id(), covering[0]);
 }
 
+TEST(S2RegionUnionTest, ContainsPointsMatchesContains) {
+  vector<unique_ptr<S2Region>> regions;
+  regions.push_back(make_unique<S2Cap>(
+      S2LatLng::FromDegrees(10, 20).ToPoint(), S1Angle::Degrees(15)));
+  regions.push_back(make_unique<S2LatLngRect>(
+      s2textformat::MakeLatLngRectOrDie("-30:170, 30:-170")));
+  regions.push_back(
+      make_unique<S2PointRegion>(S2LatLng::FromDegrees(-45, 0).ToPoint()));
+  S2RegionUnion region_union(std::move(regions));
+
+  vector<S2Point> points = {S2LatLng::FromDegrees(10, 20).ToPoint(),
+                            S2LatLng::FromDegrees(0, 180).ToPoint(),
+                            S2LatLng::FromDegrees(-45, 0).ToPoint()};
+  for (int lat = -90; lat <= 90; lat += 5) {
+    for (int lng = -180; lng < 180; lng += 5) {
+      points.push_back(S2LatLng::FromDegrees(lat, lng).ToPoint());
+    }
+  }
+  absl::FixedArray<bool> results(points.size());
+  region_union.ContainsPoints(points, absl::MakeSpan(results));
+  for (size_t i = 0; i < points.size(); ++i) {
+    EXPECT_EQ(results[i], region_union.Contains(points[i])) << points[i];
+  }
+  EXPECT_TRUE(results[0]);
+  EXPECT_TRUE(results[1]);
+  EXPECT_TRUE(results[2]);
+}
+
 }  // namespace
@@ -22,6 +22,7 @@
 #include <iterator>
 
 #include "absl/log/absl_log.h"
+#include "absl/types/span.h"
 
 #include "s2/base/types.h"
 #include "s2/util/coding/coder.h"
@@ -183,6 +184,19 @@ class S2Shape {
   // REQUIRES: 0 <= id < num_edges()
   virtual Edge edge(int edge_id) const = 0;
 
+  // Copies the edges with ids in the range [begin, begin + edges.size()) to
+  // "edges".  This is equivalent to calling edge() for each id, but shapes
+  // may override it to avoid a virtual call (and any repeated decoding work)
+  // per edge.  Algorithms that scan many consecutive edges of a shape should
+  // use this method, e.g. in batches of a few dozen edges.
+  //
+  // REQUIRES: 0 <= begin && begin + edges.size() <= num_edges()
+  virtual void GetEdges(int begin, absl::Span<Edge> edges) const {
+    for (int i = 0; i < static_cast<int>(edges.size()); ++i) {
+      edges[i] = edge(begin + i);
+    }
+  }
+
   // Returns the dimension of the geometry represented by this shape.
   //
   //  0 - Point geometry.  Each point is represented as a degenerate edge.
@@ -261,6 +275,20 @@ class S2Shape {
   // where     pos == shape.chain_position(edge_id).
   virtual ChainPosition chain_position(int edge_id) const = 0;
 
+  // Returns the vertices of the given edge chain if the shape stores them in
+  // a contiguous array of S2Points, and an empty span otherwise (which is the
+  // default).  For polylines (dimension 1) the span contains
+  // (chain(i).length + 1) vertices and edge "j" of the chain is
+  // (v[j], v[j+1]).  For polygons (dimension 2) the span contains
+  // chain(i).length vertices and the last edge of the chain wraps around to
+  // the first vertex.  Callers should fall back to chain_edge() or GetEdges()
+  // when the span is empty.
+  //
+  // REQUIRES: 0 <= chain_id < num_chains()
+  virtual absl::Span<const S2Point> chain_vertex_span(int chain_id) const {
+    return {};
+  }
+
   // Returns an integer that can be used to identify the type of an encoded
   // S2Shape (see TypeTag above).
   virtual TypeTag type_tag() const { return kNoTypeTag; }
@@ -35,9 +35,12 @@ bool S2ClippedShape::ContainsEdge(int id) const {
 }
 
 S2ShapeIndexCell::~S2ShapeIndexCell() {
-  // Free memory for all shapes owned by this cell.
-  for (S2ClippedShape& s : shapes_)
-    s.Destruct();
+  // Free memory for all shapes owned by this cell.  (If the edges are packed
+  // then they are freed along with packed_edges_.)
+  if (packed_edges_ == nullptr) {
+    for (S2ClippedShape& s : shapes_)
+      s.Destruct();
+  }
   shapes_.clear();
 }
 
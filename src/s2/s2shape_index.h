@@ -56,11 +56,13 @@
 #include "s2/s2cell_iterator.h"
 #include "s2/s2point.h"
 #include "s2/s2shape.h"
+#include "s2/s2space_usage.h"
 #include "s2/util/coding/coder.h"
 #include "s2/util/gtl/compact_array.h"
 
 class R1Interval;
 class S2PaddedCell;
+struct S2ShapeMetadata;
 
 // S2ClippedShape represents the part of a shape that intersects an S2Cell.
 // It consists of the set of edge ids that intersect that cell, and a boolean
@@ -93,16 +95,32 @@ class S2ClippedShape {
   // Returns true if the clipped shape contains the given edge id.
   bool ContainsEdge(int id) const;
 
+  // Calls visitor(edge_id, edge) for each edge of this clipped shape in
+  // order, where "shape" is the S2Shape with the given shape_id().  Returns
+  // false if the visitor returned false, which stops the iteration early.
+  //
+  // Runs of consecutive edge ids (which are typical, since each clipped shape
+  // usually contains one or a few contiguous pieces of a chain) are fetched
+  // with S2Shape::GetEdges().  This costs one virtual call per run rather
+  // than one per edge, and shapes such as S2LaxPolygonShape and
+  // S2Polygon::Shape implement it with an inlined loop over their vertices.
+  template <class Visitor>
+  bool VisitEdges(const S2Shape& shape, Visitor&& visitor) const;
+
  private:
   // This class may be copied by value, but note that it does *not* own its
   // underlying data.  (It is owned by the containing S2ShapeIndexCell.)
 
   friend class MutableS2ShapeIndex;
   friend class S2ShapeIndexCell;
+  friend class S2ShapeIndexPublisher;
+  friend class S2ShapeIndexSnapshot;
   friend class S2Stats;
 
   // Internal methods are documented with their definition.
   void Init(int32_t shape_id, uint32_t num_edges);
+  void InitPacked(int32_t shape_id, uint32_t num_edges,
+                  int32_t** packed_edges);
   void Destruct();
   bool is_inline() const;
   void set_contains_center(bool contains_center);
@@ -175,6 +193,8 @@ class S2ShapeIndexCell {
  private:
   friend class MutableS2ShapeIndex;
   friend class EncodedS2ShapeIndex;
+  friend class S2ShapeIndexPublisher;
+  friend class S2ShapeIndexSnapshot;
   friend class S2Stats;
 
   // Internal methods are documented with their definitions.
@@ -186,6 +206,11 @@ class S2ShapeIndexCell {
   using S2ClippedShapeSet = gtl::compact_array<S2ClippedShape>;
   S2ClippedShapeSet shapes_;
 
+  // If non-null, this single array holds the edge ids of every clipped shape
+  // in this cell whose edges are not stored inline (see
+  // MutableS2ShapeIndex::Options::packed_cells).
+  std::unique_ptr<int32_t[]> packed_edges_;
+
   S2ShapeIndexCell(const S2ShapeIndexCell&) = delete;
   void operator=(const S2ShapeIndexCell&) = delete;
 };
@@ -332,6 +357,17 @@ class S2ShapeIndex {
   // has been removed from the index.
   virtual const S2Shape* shape(int id) const = 0;
 
+  // If the index has cached metadata for the shape with the given id (see
+  // S2ShapeMetadata), stores it in "metadata" and returns true.  Otherwise
+  // returns false, in which case clients can call S2ShapeMetadata::Compute()
+  // on shape(id) instead.  Cached metadata is available without decoding the
+  // shape itself.  The default implementation always returns false.
+  //
+  // REQUIRES: 0 <= id < num_shape_ids()
+  virtual bool GetShapeMetadata(int id, S2ShapeMetadata* metadata) const {
+    return false;
+  }
+
   // Stores an encoded representation of the index into the given encoder.
   virtual void Encode(Encoder* encoder) const = 0;
 
@@ -374,6 +410,13 @@ class S2ShapeIndex {
   // unused space at the end of vectors, etc).
   virtual size_t SpaceUsed() const = 0;
 
+  // Appends a breakdown of SpaceUsed() into named components to "usage".
+  // The default implementation reports SpaceUsed() as a single component
+  // named "index".
+  virtual void GetSpaceUsage(S2SpaceUsage* usage) const {
+    usage->Add("index", SpaceUsed());
+  }
+
   // Minimizes memory usage by requesting that any data structures that can be
   // rebuilt should be discarded.  This method invalidates all iterators.
   //
@@ -548,6 +591,31 @@ inline int S2ClippedShape::edge(int i) const {
   return is_inline() ? inline_edges_[i] : edges_[i];
 }
 
+template <class Visitor>
+inline bool S2ClippedShape::VisitEdges(const S2Shape& shape,
+                                       Visitor&& visitor) const {
+  constexpr int kMaxBatchSize = 32;
+  S2Shape::Edge edges[kMaxBatchSize];
+  const int n = num_edges();
+  for (int i = 0; i < n;) {
+    const int begin = edge(i);
+    int len = 1;
+    while (len < kMaxBatchSize && i + len < n && edge(i + len) == begin + len) {
+      ++len;
+    }
+    if (len == 1) {
+      if (!visitor(begin, shape.edge(begin))) return false;
+    } else {
+      shape.GetEdges(begin, absl::MakeSpan(edges, len));
+      for (int k = 0; k < len; ++k) {
+        if (!visitor(begin + k, edges[k])) return false;
+      }
+    }
+    i += len;
+  }
+  return true;
+}
+
 // Initialize an S2ClippedShape to hold the given number of edges.
 inline void S2ClippedShape::Init(int32_t shape_id, uint32_t num_edges) {
   shape_id_ = shape_id;
@@ -558,6 +626,21 @@ inline void S2ClippedShape::Init(int32_t shape_id, uint32_t num_edges) {
   }
 }
 
+// Like Init(), except that if the edges are not stored inline they are
+// stored at "*packed_edges" (which is then advanced past them) rather than in
+// a separate allocation.  The edges are then freed by the containing
+// S2ShapeIndexCell rather than by Destruct().
+inline void S2ClippedShape::InitPacked(int32_t shape_id, uint32_t num_edges,
+                                       int32_t** packed_edges) {
+  shape_id_ = shape_id;
+  num_edges_ = num_edges;
+  contains_center_ = false;
+  if (!is_inline()) {
+    edges_ = *packed_edges;
+    *packed_edges += num_edges;
+  }
+}
+
 // Free any memory allocated by this S2ClippedShape.  We don't do this in
 // the destructor because S2ClippedShapes are copied by STL code, and we
 // don't want to repeatedly copy and free the edge data.  Instead the data
@@ -0,0 +1,114 @@
+// Copyright 2024 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "s2/s2shape_index_bounds_table.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+#include "s2/s2cap.h"
+#include "s2/s2cell_id.h"
+#include "s2/s2latlng_rect.h"
+#include "s2/s2shape.h"
+#include "s2/s2shape_index.h"
+#include "s2/s2shape_metadata.h"
+
+using std::min;
+using std::pair;
+using std::vector;
+
+S2ShapeIndexBoundsTable::S2ShapeIndexBoundsTable(const S2ShapeIndex& index) {
+  bounds_.resize(index.num_shape_ids(), S2LatLngRect::Empty());
+  vector<pair<S2CellId, int>> leaves;
+  S2ShapeMetadata metadata;
+  for (int id = 0; id < index.num_shape_ids(); ++id) {
+    if (index.GetShapeMetadata(id, &metadata)) {
+      bounds_[id] = metadata.bound;
+    } else if (const S2Shape* shape = index.shape(id)) {
+      bounds_[id] = S2ShapeMetadata::GetRectBound(*shape);
+    }
+    if (!bounds_[id].is_empty()) {
+      leaves.emplace_back(S2CellId(bounds_[id].GetCenter()), id);
+    }
+  }
+
+  // Sorting the leaves along the Hilbert curve keeps nearby shapes in the
+  // same nodes, so that the node bounds stay small.
+  std::sort(leaves.begin(), leaves.end());
+  leaf_ids_.reserve(leaves.size());
+  for (const auto& leaf : leaves) leaf_ids_.push_back(leaf.second);
+
+  // Build the tree levels from the bottom up, until a level consists of a
+  // single node (the root).
+  level_begin_.push_back(0);
+  size_t num_children = leaf_ids_.size(), child_begin = 0;
+  for (bool leaf_children = true; num_children > 0; leaf_children = false) {
+    for (size_t i = 0; i < num_children; i += kNodeSize) {
+      S2LatLngRect node = S2LatLngRect::Empty();
+      for (size_t j = i; j < min(num_children, i + kNodeSize); ++j) {
+        node = node.Union(leaf_children ? bounds_[leaf_ids_[j]]
+                                        : nodes_[child_begin + j]);
+      }
+      nodes_.push_back(node);
+    }
+    child_begin = level_begin_.back();
+    level_begin_.push_back(nodes_.size());
+    num_children = nodes_.size() - child_begin;
+    if (num_children == 1) break;
+  }
+}
+
+void S2ShapeIndexBoundsTable::GetIntersectingShapes(
+    const S2LatLngRect& rect, vector<int>* shape_ids) const {
+  shape_ids->clear();
+  if (nodes_.empty() || rect.is_empty()) return;
+
+  // Each stack entry is a (level, node position within level) pair.
+  vector<pair<int, size_t>> stack;
+  stack.emplace_back(static_cast<int>(level_begin_.size()) - 2, 0);
+  while (!stack.empty()) {
+    auto [level, pos] = stack.back();
+    stack.pop_back();
+    if (!nodes_[level_begin_[level] + pos].Intersects(rect)) continue;
+    const size_t begin = pos * kNodeSize;
+    if (level == 0) {
+      const size_t end = min(leaf_ids_.size(), begin + kNodeSize);
+      for (size_t i = begin; i < end; ++i) {
+        if (bounds_[leaf_ids_[i]].Intersects(rect)) {
+          shape_ids->push_back(leaf_ids_[i]);
+        }
+      }
+    } else {
+      const size_t num_children = level_begin_[level] - level_begin_[level - 1];
+      const size_t end = min(num_children, begin + kNodeSize);
+      for (size_t i = begin; i < end; ++i) stack.emplace_back(level - 1, i);
+    }
+  }
+  std::sort(shape_ids->begin(), shape_ids->end());
+}
+
+void S2ShapeIndexBoundsTable::GetIntersectingShapes(
+    const S2Cap& cap, vector<int>* shape_ids) const {
+  GetIntersectingShapes(cap.GetRectBound(), shape_ids);
+}
+
+size_t S2ShapeIndexBoundsTable::SpaceUsed() const {
+  return sizeof(*this) + bounds_.capacity() * sizeof(bounds_[0]) +
+         leaf_ids_.capacity() * sizeof(leaf_ids_[0]) +
+         nodes_.capacity() * sizeof(nodes_[0]) +
+         level_begin_.capacity() * sizeof(level_begin_[0]);
+}
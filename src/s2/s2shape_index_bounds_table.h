@@ -0,0 +1,99 @@
+// Copyright 2024 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef S2_S2SHAPE_INDEX_BOUNDS_TABLE_H_
+#define S2_S2SHAPE_INDEX_BOUNDS_TABLE_H_
+
+#include <cstddef>
+#include <vector>
+
+#include "s2/s2cap.h"
+#include "s2/s2latlng_rect.h"
+#include "s2/s2shape_index.h"
+
+// S2ShapeIndexBoundsTable stores a bounding rectangle for every shape in an
+// S2ShapeIndex, together with a packed R-tree over those rectangles.  This
+// makes it cheap to find the shapes that might intersect a given region
+// without visiting any index cells, which is useful as a first filtering
+// step when a query only needs shape-level candidates.
+//
+// The bounds are taken from the index's cached shape metadata when it is
+// available (see MutableS2ShapeIndex::Options::cache_shape_metadata), in
+// which case the table can be built from an EncodedS2ShapeIndex without
+// decoding any shapes.  Otherwise the bounds are computed from the shapes.
+//
+// Example usage:
+//
+//   S2ShapeIndexBoundsTable table(index);
+//   std::vector<int> shape_ids;
+//   table.GetIntersectingShapes(rect, &shape_ids);
+//   for (int shape_id : shape_ids) { ... test index.shape(shape_id) ... }
+//
+// The table uses about 40 bytes per shape.  It must be rebuilt whenever the
+// index is modified.  This class is thread-safe for concurrent readers once
+// it has been constructed.
+class S2ShapeIndexBoundsTable {
+ public:
+  explicit S2ShapeIndexBoundsTable(const S2ShapeIndex& index);
+
+  S2ShapeIndexBoundsTable(const S2ShapeIndexBoundsTable&) = delete;
+  S2ShapeIndexBoundsTable& operator=(const S2ShapeIndexBoundsTable&) = delete;
+
+  // Returns the number of shape ids in the table (i.e., index.num_shape_ids()
+  // at construction time).
+  int num_shape_ids() const { return static_cast<int>(bounds_.size()); }
+
+  // Returns the bounding rectangle of the given shape.  The bound of a shape
+  // that has been removed from the index is empty.
+  //
+  // REQUIRES: 0 <= shape_id < num_shape_ids()
+  const S2LatLngRect& bound(int shape_id) const { return bounds_[shape_id]; }
+
+  // Sets "shape_ids" to the ids of all shapes whose bound intersects "rect",
+  // in increasing order.  This is a superset of the shapes that actually
+  // intersect "rect".
+  void GetIntersectingShapes(const S2LatLngRect& rect,
+                             std::vector<int>* shape_ids) const;
+
+  // Like the method above, but for shapes that might intersect "cap".
+  void GetIntersectingShapes(const S2Cap& cap,
+                             std::vector<int>* shape_ids) const;
+
+  // Returns the approximate number of bytes used by this object.
+  size_t SpaceUsed() const;
+
+ private:
+  // The maximum number of children of each R-tree node.
+  static constexpr int kNodeSize = 16;
+
+  // The bound of each shape, indexed by shape id.
+  std::vector<S2LatLngRect> bounds_;
+
+  // The ids of the shapes with non-empty bounds, sorted by the S2CellId of
+  // the center of their bound.  These are the leaves of the R-tree.
+  std::vector<int> leaf_ids_;
+
+  // The R-tree nodes, stored level by level from the bottom up.  Level 0 has
+  // one node per kNodeSize consecutive leaves, level 1 has one node per
+  // kNodeSize level 0 nodes, and so on up to a single root.  Each node
+  // stores the union of the bounds of its children.
+  std::vector<S2LatLngRect> nodes_;
+
+  // The offset of each level in nodes_, plus a final entry equal to
+  // nodes_.size().
+  std::vector<size_t> level_begin_;
+};
+
+#endif  // S2_S2SHAPE_INDEX_BOUNDS_TABLE_H_
@@ -0,0 +1,144 @@
+// Copyright 2024 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "s2/s2shape_index_bounds_table.h"
+
+#include <memory>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include "absl/log/log_streamer.h"
+#include "absl/random/random.h"
+#include "s2/mutable_s2shape_index.h"
+#include "s2/s1angle.h"
+#include "s2/s2cap.h"
+#include "s2/s2latlng.h"
+#include "s2/s2latlng_rect.h"
+#include "s2/s2lax_polyline_shape.h"
+#include "s2/s2loop.h"
+#include "s2/s2point.h"
+#include "s2/s2point_vector_shape.h"
+#include "s2/s2random.h"
+#include "s2/s2shape.h"
+#include "s2/s2shape_metadata.h"
+#include "s2/s2testing.h"
+#include "s2/s2text_format.h"
+
+using std::make_unique;
+using std::vector;
+
+namespace {
+
+// Adds random loops, polylines, and points all over the sphere to "index".
+void AddRandomShapes(absl::BitGen& bitgen, MutableS2ShapeIndex* index) {
+  for (int i = 0; i < 300; ++i) {
+    S2Point center = s2random::Point(bitgen);
+    S1Angle radius = S1Angle::Degrees(absl::Uniform(bitgen, 0.01, 10.0));
+    switch (i % 3) {
+      case 0:
+        index->Add(make_unique<S2Loop::OwningShape>(
+            S2Loop::MakeRegularLoop(center, radius, 10)));
+        break;
+      case 1:
+        index->Add(make_unique<S2LaxPolylineShape>(vector<S2Point>{
+            center, s2random::SamplePoint(bitgen, S2Cap(center, radius))}));
+        break;
+      default:
+        index->Add(make_unique<S2PointVectorShape>(vector<S2Point>{center}));
+        break;
+    }
+  }
+}
+
+vector<int> BruteForceIntersectingShapes(const S2ShapeIndexBoundsTable& table,
+                                         const S2LatLngRect& rect) {
+  vector<int> result;
+  for (int id = 0; id < table.num_shape_ids(); ++id) {
+    if (table.bound(id).Intersects(rect)) result.push_back(id);
+  }
+  return result;
+}
+
+TEST(S2ShapeIndexBoundsTable, EmptyIndex) {
+  MutableS2ShapeIndex index;
+  S2ShapeIndexBoundsTable table(index);
+  vector<int> shape_ids{1};
+  table.GetIntersectingShapes(S2LatLngRect::Full(), &shape_ids);
+  EXPECT_TRUE(shape_ids.empty());
+}
+
+TEST(S2ShapeIndexBoundsTable, BoundsContainShapes) {
+  auto index = s2textformat::MakeIndexOrDie(
+      "0:0 | 10:10 # 20:20, 21:21 # 0:170, 0:-170, 5:180 | full");
+  S2ShapeIndexBoundsTable table(*index);
+  ASSERT_EQ(index->num_shape_ids(), table.num_shape_ids());
+  for (int id = 0; id < index->num_shape_ids(); ++id) {
+    const S2Shape& shape = *index->shape(id);
+    for (int e = 0; e < shape.num_edges(); ++e) {
+      EXPECT_TRUE(table.bound(id).Contains(S2LatLng(shape.edge(e).v0)));
+      EXPECT_TRUE(table.bound(id).Contains(S2LatLng(shape.edge(e).v1)));
+    }
+  }
+  // The full polygon intersects everything.
+  vector<int> shape_ids;
+  table.GetIntersectingShapes(
+      S2LatLngRect::FromPoint(S2LatLng::FromDegrees(-60, 60)), &shape_ids);
+  EXPECT_EQ(vector<int>{3}, shape_ids);
+}
+
+TEST(S2ShapeIndexBoundsTable, MatchesBruteForce) {
+  absl::BitGen bitgen(S2Testing::MakeTaggedSeedSeq(
+      "S2_SHAPE_INDEX_BOUNDS_TABLE_MATCHES_BRUTE_FORCE",
+      absl::LogInfoStreamer(__FILE__, __LINE__).stream()));
+  MutableS2ShapeIndex index;
+  AddRandomShapes(bitgen, &index);
+  index.Release(5);
+  S2ShapeIndexBoundsTable table(index);
+  EXPECT_TRUE(table.bound(5).is_empty());
+
+  vector<int> shape_ids;
+  for (int iter = 0; iter < 200; ++iter) {
+    S2LatLngRect rect = S2LatLngRect::FromCenterSize(
+        S2LatLng(s2random::Point(bitgen)),
+        S2LatLng::FromDegrees(absl::Uniform(bitgen, 0.0, 40.0),
+                              absl::Uniform(bitgen, 0.0, 80.0)));
+    table.GetIntersectingShapes(rect, &shape_ids);
+    EXPECT_EQ(BruteForceIntersectingShapes(table, rect), shape_ids);
+  }
+  S2Cap cap(S2Point(0, 0, 1), S1Angle::Degrees(30));
+  table.GetIntersectingShapes(cap, &shape_ids);
+  EXPECT_EQ(BruteForceIntersectingShapes(table, cap.GetRectBound()),
+            shape_ids);
+}
+
+TEST(S2ShapeIndexBoundsTable, UsesCachedShapeMetadata) {
+  absl::BitGen bitgen(S2Testing::MakeTaggedSeedSeq(
+      "S2_SHAPE_INDEX_BOUNDS_TABLE_USES_CACHED_SHAPE_METADATA",
+      absl::LogInfoStreamer(__FILE__, __LINE__).stream()));
+  MutableS2ShapeIndex::Options options;
+  options.set_cache_shape_metadata(true);
+  MutableS2ShapeIndex index(options);
+  AddRandomShapes(bitgen, &index);
+  S2ShapeIndexBoundsTable table(index);
+  for (int id = 0; id < index.num_shape_ids(); ++id) {
+    S2ShapeMetadata metadata;
+    ASSERT_TRUE(index.GetShapeMetadata(id, &metadata));
+    EXPECT_EQ(metadata.bound, table.bound(id));
+    EXPECT_EQ(S2ShapeMetadata::GetRectBound(*index.shape(id)),
+              table.bound(id));
+  }
+}
+
+}  // namespace
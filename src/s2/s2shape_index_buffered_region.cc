@@ -18,23 +18,80 @@
 #include "s2/s2shape_index_buffered_region.h"
 
 #include <algorithm>
+#include <utility>
 #include <vector>
 
+#include "absl/log/absl_check.h"
 #include "s2/s1angle.h"
 #include "s2/s1chord_angle.h"
 #include "s2/s2cap.h"
 #include "s2/s2cell.h"
 #include "s2/s2cell_id.h"
+#include "s2/s2cell_union.h"
 #include "s2/s2closest_edge_query.h"
 #include "s2/s2latlng_rect.h"
 #include "s2/s2metrics.h"
 #include "s2/s2point.h"
+#include "s2/s2region.h"
+#include "s2/s2region_coverer.h"
 #include "s2/s2shape_index.h"
 #include "s2/s2shape_index_region.h"
 
+using std::max;
 using std::min;
 using std::vector;
 
+namespace {
+
+// The covering of the index cells used by GetCovering(S2RegionCoverer*, ...)
+// has this many times more cells than the requested covering, so that the
+// expanded covering rejects most candidates that are not near the geometry.
+constexpr int kIndexCoveringCellsMultiplier = 8;
+
+// The index covering is expanded using cells at most this many levels below
+// its largest cell (see S2CellUnion::Expand).
+constexpr int kMaxExpandLevelDiff = 4;
+
+// The index covering is expanded by the buffer radius plus this amount, to
+// account for index cell padding and for the error in distance calculations.
+constexpr S1Angle kExpandError = S1Angle::Radians(1e-13);
+
+// An S2Region that equals the given buffered region intersected with the
+// given cell union.  The cell union must contain the buffered region, so
+// that both regions have the same coverings.
+class ExpandedBufferedRegion final : public S2Region {
+ public:
+  ExpandedBufferedRegion(const S2ShapeIndexBufferedRegion* region,
+                         const S2CellUnion* expanded)
+      : region_(region), expanded_(expanded) {}
+
+  ExpandedBufferedRegion* Clone() const override {
+    return new ExpandedBufferedRegion(region_, expanded_);
+  }
+  S2Cap GetCapBound() const override { return region_->GetCapBound(); }
+  S2LatLngRect GetRectBound() const override {
+    return region_->GetRectBound();
+  }
+  void GetCellUnionBound(vector<S2CellId>* cell_ids) const override {
+    region_->GetCellUnionBound(cell_ids);
+  }
+  bool Contains(const S2Cell& cell) const override {
+    return expanded_->Contains(cell.id()) && region_->Contains(cell);
+  }
+  bool MayIntersect(const S2Cell& cell) const override {
+    return expanded_->Intersects(cell.id()) && region_->MayIntersect(cell);
+  }
+  bool Contains(const S2Point& p) const override {
+    return expanded_->Contains(p) && region_->Contains(p);
+  }
+
+ private:
+  const S2ShapeIndexBufferedRegion* region_;
+  const S2CellUnion* expanded_;
+};
+
+}  // namespace
+
 S2ShapeIndexBufferedRegion::S2ShapeIndexBufferedRegion() = default;
 
 void S2ShapeIndexBufferedRegion::Init(const S2ShapeIndex* index,
@@ -125,3 +182,27 @@ bool S2ShapeIndexBufferedRegion::Contains(const S2Point& p) const {
   // Return true if the distance is less than or equal to "radius_".
   return query_.IsDistanceLess(&target, radius_successor_);
 }
+
+void S2ShapeIndexBufferedRegion::GetCovering(
+    S2RegionCoverer* coverer, vector<S2CellId>* covering) const {
+  ABSL_DCHECK_EQ(coverer->options().num_threads(), 1);
+  if (radius_successor_ > S1ChordAngle::Straight()) {
+    coverer->GetCovering(*this, covering);
+    return;
+  }
+  // Cover the index cells, using more cells than requested so that the
+  // expanded covering below is reasonably tight.
+  S2RegionCoverer::Options index_options = coverer->options();
+  index_options.set_max_cells(kIndexCoveringCellsMultiplier *
+                              max(coverer->options().max_cells(), 1));
+  S2RegionCoverer index_coverer(index_options);
+  vector<S2CellId> index_covering;
+  MakeS2ShapeIndexRegion(&index()).GetCovering(&index_coverer,
+                                               &index_covering);
+
+  // Expand the covering so that it contains every point within "radius_" of
+  // the indexed geometry.
+  S2CellUnion expanded(std::move(index_covering));
+  expanded.Expand(radius_.ToAngle() + kExpandError, kMaxExpandLevelDiff);
+  coverer->GetCovering(ExpandedBufferedRegion(this, &expanded), covering);
+}
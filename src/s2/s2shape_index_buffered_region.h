@@ -30,6 +30,7 @@
 #include "s2/s2latlng_rect.h"
 #include "s2/s2point.h"
 #include "s2/s2region.h"
+#include "s2/s2region_coverer.h"
 #include "s2/s2shape_index.h"
 
 // This class provides a way to expand an arbitrary collection of geometry by
@@ -106,6 +107,18 @@ class S2ShapeIndexBufferedRegion final : public S2Region {
   // i.e. if it is within the given radius of any original shape.
   bool Contains(const S2Point& p) const override;
 
+  // Computes the same covering as coverer->GetCovering(*this), but faster.
+  // A covering of the index cells (see S2ShapeIndexRegion::GetCovering) is
+  // first expanded by the buffer radius using S2CellUnion::Expand().  Every
+  // candidate cell outside this expanded covering is then rejected without a
+  // distance query, so that S2ClosestEdgeQuery is only used for cells near
+  // the buffered geometry.  This typically makes buffered coverings several
+  // times faster when the radius is small compared to the indexed geometry.
+  //
+  // REQUIRES: coverer->options().num_threads() == 1
+  void GetCovering(S2RegionCoverer* coverer,
+                   std::vector<S2CellId>* covering) const;
+
  private:
   S1ChordAngle radius_;
 
@@ -21,6 +21,7 @@
 #include <memory>
 #include <ostream>
 #include <string>
+#include <vector>
 
 #include <gtest/gtest.h>
 #include "absl/log/absl_log.h"
@@ -162,6 +163,11 @@ void TestBufferIndex(string_view index_str, S1Angle radius_angle,
   query.mutable_options()->set_include_interiors(false);
   S2ClosestEdgeQuery::ShapeIndexTarget target(index.get());
   EXPECT_FALSE(query.IsDistanceLess(&target, radius));
+
+  // Check that the faster covering method gives the same result.
+  std::vector<S2CellId> fast_covering;
+  region.GetCovering(coverer, &fast_covering);
+  EXPECT_EQ(covering.cell_ids(), fast_covering);
 }
 
 TEST(S2ShapeIndexBufferedRegion, PointSet) {
@@ -0,0 +1,98 @@
+// Copyright 2024 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "s2/s2shape_index_category_summary.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+#include "absl/functional/function_ref.h"
+#include "absl/log/absl_check.h"
+#include "s2/s2cell_id.h"
+#include "s2/s2shape_index.h"
+
+using std::vector;
+
+S2ShapeIndexCategorySummary::S2ShapeIndexCategorySummary(
+    const S2ShapeIndex& index, absl::FunctionRef<int(int shape_id)> category) {
+  shape_categories_.resize(index.num_shape_ids());
+  for (int id = 0; id < index.num_shape_ids(); ++id) {
+    if (index.shape(id) == nullptr) continue;
+    int c = category(id);
+    ABSL_DCHECK(c >= -1 && c < kMaxCategories) << c;
+    if (c >= 0) shape_categories_[id] = Mask(c);
+  }
+
+  vector<CategoryMask> cell_masks;
+  for (S2ShapeIndex::Iterator it(&index, S2ShapeIndex::BEGIN); !it.done();
+       it.Next()) {
+    CategoryMask mask = 0;
+    for (const S2ClippedShape& clipped : it.cell().clipped_shapes()) {
+      mask |= shape_categories_[clipped.shape_id()];
+    }
+    cell_ids_.push_back(it.id());
+    cell_masks.push_back(mask);
+  }
+
+  // Build the segment tree bottom-up.
+  const size_t n = cell_ids_.size();
+  tree_.resize(2 * n);
+  std::copy(cell_masks.begin(), cell_masks.end(), tree_.begin() + n);
+  for (size_t k = n; k-- > 1;) {
+    tree_[k] = tree_[2 * k] | tree_[2 * k + 1];
+  }
+}
+
+S2ShapeIndexCategorySummary::CategoryMask
+S2ShapeIndexCategorySummary::GetCategories(S2CellId id) const {
+  // Index cells are disjoint, so the cells that intersect "id" are either a
+  // single cell that contains "id" or the cells whose ids are in
+  // [id.range_min(), id.range_max()].  A cell that contains "id" is one of
+  // the two cells adjacent to id.range_min() in S2CellId order.
+  size_t begin =
+      std::lower_bound(cell_ids_.begin(), cell_ids_.end(), id.range_min()) -
+      cell_ids_.begin();
+  if (begin < cell_ids_.size() && cell_ids_[begin].contains(id)) {
+    return tree_[cell_ids_.size() + begin];
+  }
+  if (begin > 0 && cell_ids_[begin - 1].contains(id)) {
+    return tree_[cell_ids_.size() + begin - 1];
+  }
+  size_t end =
+      std::upper_bound(cell_ids_.begin() + begin, cell_ids_.end(),
+                       id.range_max()) -
+      cell_ids_.begin();
+  return GetRangeCategories(begin, end);
+}
+
+S2ShapeIndexCategorySummary::CategoryMask
+S2ShapeIndexCategorySummary::GetRangeCategories(size_t begin,
+                                                size_t end) const {
+  CategoryMask mask = 0;
+  for (begin += cell_ids_.size(), end += cell_ids_.size(); begin < end;
+       begin /= 2, end /= 2) {
+    if (begin & 1) mask |= tree_[begin++];
+    if (end & 1) mask |= tree_[--end];
+  }
+  return mask;
+}
+
+size_t S2ShapeIndexCategorySummary::SpaceUsed() const {
+  return sizeof(*this) +
+         shape_categories_.capacity() * sizeof(shape_categories_[0]) +
+         cell_ids_.capacity() * sizeof(cell_ids_[0]) +
+         tree_.capacity() * sizeof(tree_[0]);
+}
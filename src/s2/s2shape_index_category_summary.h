@@ -0,0 +1,103 @@
+// Copyright 2024 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef S2_S2SHAPE_INDEX_CATEGORY_SUMMARY_H_
+#define S2_S2SHAPE_INDEX_CATEGORY_SUMMARY_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "absl/functional/function_ref.h"
+#include "s2/s2cell_id.h"
+#include "s2/s2shape_index.h"
+
+// S2ShapeIndexCategorySummary records which categories of shapes (e.g., road
+// classes) intersect each cell of an S2ShapeIndex.  Each shape is assigned a
+// small user-defined category id, and the summary can then report the set of
+// categories present in any S2CellId range of the index.  This lets queries
+// that are only interested in a few categories skip entire index cells (and
+// entire subtrees of cells) that contain no matching shapes, rather than
+// visiting each cell and filtering its clipped shapes one at a time.
+//
+// Example usage:
+//
+//   S2ShapeIndexCategorySummary summary(
+//       index, [&](int shape_id) { return road_class[shape_id]; });
+//   S2ClosestEdgeQuery query(&index);
+//   query.set_category_filter(&summary,
+//                             S2ShapeIndexCategorySummary::Mask(kHighway) |
+//                             S2ShapeIndexCategorySummary::Mask(kArterial));
+//
+// The summary uses about 24 bytes per index cell plus 8 bytes per shape.  It
+// must be rebuilt whenever the index is modified.  This class is thread-safe
+// for concurrent readers once it has been constructed.
+class S2ShapeIndexCategorySummary {
+ public:
+  // A set of categories, where bit "c" represents category "c".
+  using CategoryMask = uint64_t;
+
+  // Categories must be in the range [0, kMaxCategories).
+  static constexpr int kMaxCategories = 64;
+
+  // Returns the mask containing only the given category.
+  static constexpr CategoryMask Mask(int category) {
+    return CategoryMask{1} << category;
+  }
+
+  // Builds a summary of "index", where "category" returns the category of
+  // each shape.  It may also return -1 to indicate that a shape does not
+  // belong to any category (in which case it never matches any filter).
+  //
+  // REQUIRES: -1 <= category(shape_id) < kMaxCategories
+  S2ShapeIndexCategorySummary(const S2ShapeIndex& index,
+                              absl::FunctionRef<int(int shape_id)> category);
+
+  S2ShapeIndexCategorySummary(const S2ShapeIndexCategorySummary&) = delete;
+  S2ShapeIndexCategorySummary& operator=(const S2ShapeIndexCategorySummary&) =
+      delete;
+
+  // Returns the categories of the given shape (either a single category or
+  // none at all).
+  CategoryMask shape_categories(int shape_id) const {
+    return shape_id < static_cast<int>(shape_categories_.size())
+               ? shape_categories_[shape_id]
+               : 0;
+  }
+
+  // Returns the union of the categories of all shapes that intersect an index
+  // cell that intersects "id".  (This is a superset of the categories of the
+  // shapes that actually intersect "id".)
+  CategoryMask GetCategories(S2CellId id) const;
+
+  // Returns the approximate number of bytes used by this object.
+  size_t SpaceUsed() const;
+
+ private:
+  // Returns the union of the categories of index cells [begin, end).
+  CategoryMask GetRangeCategories(size_t begin, size_t end) const;
+
+  std::vector<CategoryMask> shape_categories_;
+
+  // The index cell ids in sorted order.
+  std::vector<S2CellId> cell_ids_;
+
+  // A segment tree of category masks, where the mask of cell_ids_[i] is
+  // stored in tree_[cell_ids_.size() + i] and each internal node tree_[k]
+  // is the union of its children tree_[2 * k] and tree_[2 * k + 1].
+  std::vector<CategoryMask> tree_;
+};
+
+#endif  // S2_S2SHAPE_INDEX_CATEGORY_SUMMARY_H_
@@ -0,0 +1,146 @@
+// Copyright 2024 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "s2/s2shape_index_category_summary.h"
+
+#include <memory>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include "absl/log/log_streamer.h"
+#include "absl/random/random.h"
+#include "s2/mutable_s2shape_index.h"
+#include "s2/s1angle.h"
+#include "s2/s2cap.h"
+#include "s2/s2cell_id.h"
+#include "s2/s2closest_edge_query.h"
+#include "s2/s2lax_polyline_shape.h"
+#include "s2/s2point.h"
+#include "s2/s2random.h"
+#include "s2/s2shape_index.h"
+#include "s2/s2testing.h"
+
+using std::make_unique;
+using std::vector;
+using CategoryMask = S2ShapeIndexCategorySummary::CategoryMask;
+
+namespace {
+
+// Builds an index of random polylines near "cap" and assigns each one a
+// category in [0, num_categories).
+void MakeIndex(absl::BitGen& bitgen, const S2Cap& cap, int num_categories,
+               MutableS2ShapeIndex* index, vector<int>* categories) {
+  for (int i = 0; i < 500; ++i) {
+    vector<S2Point> vertices;
+    S2Point p = s2random::SamplePoint(bitgen, cap);
+    for (int j = 0; j < 10; ++j) {
+      vertices.push_back(p);
+      p = S2::GetPointOnLine(p, s2random::Point(bitgen),
+                             S2Testing::KmToAngle(0.2));
+    }
+    index->Add(make_unique<S2LaxPolylineShape>(vertices));
+    categories->push_back(absl::Uniform(bitgen, 0, num_categories));
+  }
+  index->ForceBuild();
+}
+
+// Returns the categories of the index cells that intersect "id".
+CategoryMask BruteForceCategories(const S2ShapeIndex& index,
+                                  const vector<int>& categories,
+                                  S2CellId id) {
+  CategoryMask mask = 0;
+  for (S2ShapeIndex::Iterator it(&index, S2ShapeIndex::BEGIN); !it.done();
+       it.Next()) {
+    if (!it.id().intersects(id)) continue;
+    for (const S2ClippedShape& clipped : it.cell().clipped_shapes()) {
+      mask |= S2ShapeIndexCategorySummary::Mask(categories[clipped.shape_id()]);
+    }
+  }
+  return mask;
+}
+
+TEST(S2ShapeIndexCategorySummary, EmptyIndex) {
+  MutableS2ShapeIndex index;
+  S2ShapeIndexCategorySummary summary(index, [](int) { return 0; });
+  EXPECT_EQ(summary.GetCategories(S2CellId::FromFace(0)), 0);
+  EXPECT_EQ(summary.shape_categories(0), 0);
+}
+
+TEST(S2ShapeIndexCategorySummary, GetCategories) {
+  absl::BitGen bitgen(S2Testing::MakeTaggedSeedSeq(
+      "GET_CATEGORIES", absl::LogInfoStreamer(__FILE__, __LINE__).stream()));
+  S2Cap cap(s2random::Point(bitgen), S2Testing::KmToAngle(20));
+  MutableS2ShapeIndex index;
+  vector<int> categories;
+  MakeIndex(bitgen, cap, 40, &index, &categories);
+  S2ShapeIndexCategorySummary summary(
+      index, [&](int shape_id) { return categories[shape_id]; });
+  for (int i = 0; i < 10; ++i) {
+    EXPECT_EQ(summary.shape_categories(i),
+              S2ShapeIndexCategorySummary::Mask(categories[i]));
+  }
+
+  // Check the index cells themselves, plus random ancestors and descendants.
+  for (MutableS2ShapeIndex::Iterator it(&index, S2ShapeIndex::BEGIN);
+       !it.done(); it.Next()) {
+    EXPECT_EQ(summary.GetCategories(it.id()),
+              BruteForceCategories(index, categories, it.id()));
+  }
+  for (int i = 0; i < 200; ++i) {
+    S2CellId id(s2random::SamplePoint(bitgen, cap));
+    id = id.parent(absl::Uniform(bitgen, 0, S2CellId::kMaxLevel + 1));
+    EXPECT_EQ(summary.GetCategories(id),
+              BruteForceCategories(index, categories, id))
+        << id;
+  }
+  EXPECT_GT(summary.SpaceUsed(), 0);
+}
+
+TEST(S2ShapeIndexCategorySummary, ClosestEdgeQuery) {
+  absl::BitGen bitgen(S2Testing::MakeTaggedSeedSeq(
+      "CLOSEST_EDGE_QUERY",
+      absl::LogInfoStreamer(__FILE__, __LINE__).stream()));
+  S2Cap cap(s2random::Point(bitgen), S2Testing::KmToAngle(20));
+  MutableS2ShapeIndex index;
+  vector<int> categories;
+  MakeIndex(bitgen, cap, 40, &index, &categories);
+  S2ShapeIndexCategorySummary summary(
+      index, [&](int shape_id) { return categories[shape_id]; });
+
+  const CategoryMask kWanted = S2ShapeIndexCategorySummary::Mask(3) |
+                               S2ShapeIndexCategorySummary::Mask(17);
+  S2ClosestEdgeQuery query(&index);
+  query.mutable_options()->set_max_results(5);
+  query.set_category_filter(&summary, kWanted);
+  S2ClosestEdgeQuery filter_query(&index);
+  filter_query.mutable_options()->set_max_results(5);
+  for (int i = 0; i < 100; ++i) {
+    S2ClosestEdgeQuery::PointTarget target(s2random::SamplePoint(bitgen, cap));
+    auto expected = filter_query.FindClosestEdges(&target, [&](int shape_id) {
+      return (S2ShapeIndexCategorySummary::Mask(categories[shape_id]) &
+              kWanted) != 0;
+    });
+    ASSERT_FALSE(expected.empty());
+    EXPECT_EQ(query.FindClosestEdges(&target), expected);
+  }
+
+  // Removing the filter restores the unfiltered results.
+  query.set_category_filter(nullptr, 0);
+  S2ClosestEdgeQuery::PointTarget target(cap.center());
+  EXPECT_EQ(query.FindClosestEdges(&target),
+            filter_query.FindClosestEdges(&target));
+}
+
+}  // namespace
@@ -0,0 +1,204 @@
+// Copyright 2024 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "s2/s2shape_index_containment_table.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "absl/functional/function_ref.h"
+#include "absl/log/absl_check.h"
+#include "absl/types/span.h"
+#include "s2/internal/s2parallel.h"
+#include "s2/s2cell_id.h"
+#include "s2/s2edge_crosser.h"
+#include "s2/s2point.h"
+#include "s2/s2pointutil.h"
+#include "s2/s2shape.h"
+#include "s2/s2shape_index.h"
+
+using std::vector;
+
+S2ShapeIndexContainmentTable::S2ShapeIndexContainmentTable(
+    const S2ShapeIndex& index) {
+  Init(index);
+}
+
+void S2ShapeIndexContainmentTable::Init(const S2ShapeIndex& index) {
+  range_mins_.clear();
+  cells_.clear();
+  interior_.clear();
+  boundaries_.clear();
+  edges_.clear();
+
+  // Only polygons can contain points under the SEMI_OPEN model.  The
+  // dimension of each shape is looked up once, since this may be expensive
+  // for some index types (e.g., EncodedS2ShapeIndex).
+  vector<int8_t> is_polygon(index.num_shape_ids(), -1);
+  auto IsPolygon = [&](int shape_id) {
+    if (is_polygon[shape_id] < 0) {
+      is_polygon[shape_id] = index.shape(shape_id)->dimension() == 2;
+    }
+    return is_polygon[shape_id] != 0;
+  };
+  for (S2ShapeIndex::Iterator it(&index, S2ShapeIndex::BEGIN); !it.done();
+       it.Next()) {
+    Cell cell;
+    cell.range_max = it.id().range_max();
+    cell.center = it.id().ToPoint();
+    cell.interior_begin = interior_.size();
+    cell.boundaries_begin = boundaries_.size();
+    for (const S2ClippedShape& clipped : it.cell().clipped_shapes()) {
+      const int shape_id = clipped.shape_id();
+      if (!IsPolygon(shape_id)) continue;
+      if (clipped.num_edges() == 0) {
+        // A polygon with no edges in the cell contains the entire cell.
+        ABSL_DCHECK(clipped.contains_center());
+        interior_.push_back(shape_id);
+        continue;
+      }
+      const S2Shape& shape = *index.shape(shape_id);
+      boundaries_.push_back({shape_id, clipped.contains_center(),
+                             static_cast<uint32_t>(edges_.size())});
+      for (int i = 0; i < clipped.num_edges(); ++i) {
+        edges_.push_back(shape.edge(clipped.edge(i)));
+      }
+    }
+    // Cells that do not intersect any polygon are not needed.
+    if (cell.interior_begin == interior_.size() &&
+        cell.boundaries_begin == boundaries_.size()) {
+      continue;
+    }
+    range_mins_.push_back(it.id().range_min());
+    cells_.push_back(cell);
+  }
+  // Add the sentinels.
+  Cell sentinel;
+  sentinel.interior_begin = interior_.size();
+  sentinel.boundaries_begin = boundaries_.size();
+  cells_.push_back(sentinel);
+  boundaries_.push_back({-1, false, static_cast<uint32_t>(edges_.size())});
+
+  range_mins_.shrink_to_fit();
+  cells_.shrink_to_fit();
+  interior_.shrink_to_fit();
+  boundaries_.shrink_to_fit();
+  edges_.shrink_to_fit();
+}
+
+int S2ShapeIndexContainmentTable::FindCell(S2CellId target) const {
+  // Find the last cell whose range_min() is at most "target", and check
+  // whether that cell actually contains it.
+  auto it = std::upper_bound(range_mins_.begin(), range_mins_.end(), target);
+  if (it == range_mins_.begin()) return -1;
+  const int c = static_cast<int>(it - range_mins_.begin()) - 1;
+  return cells_[c].range_max < target ? -1 : c;
+}
+
+bool S2ShapeIndexContainmentTable::BoundaryContains(
+    int c, uint32_t b, const S2Point& p) const {
+  // Test containment by drawing a line segment from the cell center to the
+  // given point and counting edge crossings (as in S2ContainsPointQuery).
+  const Boundary& boundary = boundaries_[b];
+  const uint32_t edges_end = boundaries_[b + 1].edges_begin;
+  bool inside = boundary.contains_center;
+  // Consecutive edges usually form a chain, which lets the crosser reuse the
+  // orientation of each shared vertex.
+  S2EdgeCrosser crosser(&cells_[c].center, &p);
+  for (uint32_t i = boundary.edges_begin; i < edges_end; ++i) {
+    const S2Shape::Edge& edge = edges_[i];
+    if (i == boundary.edges_begin || edges_[i - 1].v1 != edge.v0) {
+      crosser.RestartAt(&edge.v0);
+    }
+    inside ^= crosser.EdgeOrVertexCrossing(&edge.v1);
+  }
+  return inside;
+}
+
+bool S2ShapeIndexContainmentTable::VisitContainingShapeIds(
+    const S2Point& p, absl::FunctionRef<bool(int shape_id)> visitor) const {
+  ABSL_DCHECK(S2::IsUnitLength(p));
+  const int c = FindCell(S2CellId(p));
+  if (c < 0) return true;
+  const Cell& cell = cells_[c];
+  const Cell& next = cells_[c + 1];
+  for (uint32_t i = cell.interior_begin; i < next.interior_begin; ++i) {
+    if (!visitor(interior_[i])) return false;
+  }
+  for (uint32_t b = cell.boundaries_begin; b < next.boundaries_begin; ++b) {
+    if (BoundaryContains(c, b, p) && !visitor(boundaries_[b].shape_id)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+vector<int> S2ShapeIndexContainmentTable::GetContainingShapeIds(
+    const S2Point& p) const {
+  vector<int> result;
+  VisitContainingShapeIds(p, [&result](int shape_id) {
+    result.push_back(shape_id);
+    return true;
+  });
+  std::sort(result.begin(), result.end());
+  return result;
+}
+
+void S2ShapeIndexContainmentTable::GetContainingShapeIds(
+    absl::Span<const S2Point> points, int num_threads, vector<size_t>* offsets,
+    vector<int>* shape_ids) const {
+  // Each block of points is processed by a single thread, which first
+  // records the number of shapes containing each point in (*offsets)[i + 1]
+  // and appends their ids to a per-block vector.  The blocks are then
+  // concatenated in order so that the output does not depend on scheduling.
+  constexpr size_t kBlockSize = 1 << 12;
+  const size_t n = points.size();
+  const int num_blocks = static_cast<int>((n + kBlockSize - 1) / kBlockSize);
+  offsets->assign(n + 1, 0);
+  vector<vector<int>> block_ids(num_blocks);
+  s2internal::ParallelFor(num_threads, num_blocks, [&](int block) {
+    vector<int>& ids = block_ids[block];
+    const size_t end = std::min(n, (block + 1) * kBlockSize);
+    for (size_t i = block * kBlockSize; i < end; ++i) {
+      const size_t begin = ids.size();
+      VisitContainingShapeIds(points[i], [&ids](int shape_id) {
+        ids.push_back(shape_id);
+        return true;
+      });
+      std::sort(ids.begin() + begin, ids.end());
+      (*offsets)[i + 1] = ids.size() - begin;
+    }
+  });
+  for (size_t i = 0; i < n; ++i) (*offsets)[i + 1] += (*offsets)[i];
+  shape_ids->resize(offsets->back());
+  s2internal::ParallelFor(num_threads, num_blocks, [&](int block) {
+    std::copy(block_ids[block].begin(), block_ids[block].end(),
+              shape_ids->begin() + (*offsets)[block * kBlockSize]);
+  });
+}
+
+bool S2ShapeIndexContainmentTable::Contains(const S2Point& p) const {
+  return !VisitContainingShapeIds(p, [](int) { return false; });
+}
+
+size_t S2ShapeIndexContainmentTable::SpaceUsed() const {
+  return sizeof(*this) + range_mins_.capacity() * sizeof(range_mins_[0]) +
+         cells_.capacity() * sizeof(cells_[0]) +
+         interior_.capacity() * sizeof(interior_[0]) +
+         boundaries_.capacity() * sizeof(boundaries_[0]) +
+         edges_.capacity() * sizeof(edges_[0]);
+}
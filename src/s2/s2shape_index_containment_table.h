@@ -0,0 +1,144 @@
+// Copyright 2024 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef S2_S2SHAPE_INDEX_CONTAINMENT_TABLE_H_
+#define S2_S2SHAPE_INDEX_CONTAINMENT_TABLE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "absl/functional/function_ref.h"
+#include "absl/types/span.h"
+#include "s2/s2cell_id.h"
+#include "s2/s2point.h"
+#include "s2/s2shape.h"
+#include "s2/s2shape_index.h"
+
+// S2ShapeIndexContainmentTable is an immutable structure for finding all the
+// polygons in an S2ShapeIndex that contain a given point.  It is intended for
+// applications such as reverse geocoding, where very large numbers of points
+// are tested against a fixed set of (often nested) polygons.
+//
+// The cells of the index are flattened into a sorted array.  For each cell,
+// the table stores the ids of the shapes whose interior contains the entire
+// cell, followed by the shapes that have edges in the cell together with a
+// copy of those edges.  A query therefore consists of a single binary search,
+// after which the shapes of the first kind are reported without any edge
+// tests.  Edge crossing tests are only needed for the shapes whose boundary
+// passes through the cell containing the point.
+//
+// The results are identical to S2ContainsPointQuery::VisitContainingShapeIds
+// with the default (SEMI_OPEN) vertex model, i.e. only two-dimensional shapes
+// can contain points.  The table does not refer to the index after
+// construction, and it is thread-safe for concurrent readers.
+//
+// Example usage:
+//
+//   S2ShapeIndexContainmentTable table(index);
+//   for (const S2Point& p : points) {
+//     for (int shape_id : table.GetContainingShapeIds(p)) { ... }
+//   }
+class S2ShapeIndexContainmentTable {
+ public:
+  // Creates an empty table (which contains no points) that can be
+  // initialized by calling Init().
+  S2ShapeIndexContainmentTable() = default;
+
+  // Convenience constructor that calls Init().
+  explicit S2ShapeIndexContainmentTable(const S2ShapeIndex& index);
+
+  // Initializes the table to answer queries for the given index.  The index
+  // does not need to outlive this object.
+  void Init(const S2ShapeIndex& index);
+
+  // Visits the ids of all shapes that contain the point "p", terminating
+  // early if the visitor returns false (in which case this method returns
+  // false as well).  Each shape is visited at most once.  The shapes whose
+  // interior contains the entire index cell are visited first, in increasing
+  // order of shape id, followed by the other containing shapes in increasing
+  // order of shape id.
+  bool VisitContainingShapeIds(const S2Point& p,
+                               absl::FunctionRef<bool(int shape_id)> visitor)
+      const;
+
+  // Returns the ids of all shapes that contain the point "p", in increasing
+  // order.
+  std::vector<int> GetContainingShapeIds(const S2Point& p) const;
+
+  // Batch version of GetContainingShapeIds() for very large point sets (e.g.
+  // assigning billions of points to regions), which processes the points in
+  // blocks using up to "num_threads" threads.  On return, the ids of the
+  // shapes that contain points[i] are stored in increasing order in
+  //
+  //   (*shape_ids)[(*offsets)[i]], ..., (*shape_ids)[(*offsets)[i + 1] - 1]
+  //
+  // where "offsets" has points.size() + 1 elements.  The results do not
+  // depend on "num_threads".
+  void GetContainingShapeIds(absl::Span<const S2Point> points,
+                             int num_threads, std::vector<size_t>* offsets,
+                             std::vector<int>* shape_ids) const;
+
+  // Returns true if any shape contains the point "p".
+  bool Contains(const S2Point& p) const;
+
+  // Returns the number of index cells that intersect at least one polygon.
+  int num_cells() const { return static_cast<int>(range_mins_.size()); }
+
+  // Returns the number of bytes used by this object.
+  size_t SpaceUsed() const;
+
+ private:
+  struct Cell {
+    S2CellId range_max;         // The last leaf cell covered by this cell.
+    S2Point center;             // The cell center.
+    uint32_t interior_begin;    // The first shape of this cell in interior_.
+    uint32_t boundaries_begin;  // The first shape of this cell in boundaries_.
+  };
+
+  // A shape whose boundary intersects a cell.
+  struct Boundary {
+    int32_t shape_id;
+    bool contains_center;  // Whether the shape contains the cell center.
+    uint32_t edges_begin;  // The first edge of this shape in edges_.
+  };
+
+  // Returns the cell containing "target", or -1 if there is none.
+  int FindCell(S2CellId target) const;
+
+  // Returns true if boundaries_[b], which belongs to cells_[c], contains "p".
+  bool BoundaryContains(int c, uint32_t b, const S2Point& p) const;
+
+  // The range_min() of each cell, kept separately from "cells_" so that the
+  // binary search that locates a point touches as little memory as possible.
+  std::vector<S2CellId> range_mins_;
+
+  // The cells, followed by a sentinel whose "interior_begin" and
+  // "boundaries_begin" fields mark the end of the last cell's shapes.
+  std::vector<Cell> cells_;
+
+  // The ids of the shapes whose interior contains each cell, stored
+  // consecutively.
+  std::vector<int32_t> interior_;
+
+  // The shapes whose boundary intersects each cell, stored consecutively and
+  // followed by a sentinel whose "edges_begin" marks the end of the edges.
+  std::vector<Boundary> boundaries_;
+
+  // The edges of all boundary shapes, stored consecutively.
+  std::vector<S2Shape::Edge> edges_;
+};
+
+#endif  // S2_S2SHAPE_INDEX_CONTAINMENT_TABLE_H_
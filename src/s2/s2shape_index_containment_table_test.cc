@@ -0,0 +1,151 @@
+// Copyright 2024 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "s2/s2shape_index_containment_table.h"
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include "absl/log/log_streamer.h"
+#include "absl/random/bit_gen_ref.h"
+#include "absl/random/random.h"
+#include "s2/mutable_s2shape_index.h"
+#include "s2/s2cap.h"
+#include "s2/s2contains_point_query.h"
+#include "s2/s2fractal.h"
+#include "s2/s2loop.h"
+#include "s2/s2point.h"
+#include "s2/s2random.h"
+#include "s2/s2shape.h"
+#include "s2/s2shape_index.h"
+#include "s2/s2testing.h"
+#include "s2/s2text_format.h"
+
+using std::make_unique;
+using std::vector;
+
+namespace {
+
+// Checks that "table" agrees with S2ContainsPointQuery at random points in
+// "cap" and at all vertices of the indexed shapes.
+void ExpectSameAsContainsPointQuery(const MutableS2ShapeIndex& index,
+                                    const S2Cap& cap,
+                                    absl::BitGenRef bitgen) {
+  S2ShapeIndexContainmentTable table(index);
+  auto query = MakeS2ContainsPointQuery(&index);
+  auto check = [&](const S2Point& p) {
+    vector<int> expected = query.GetContainingShapeIds(p);
+    EXPECT_EQ(expected, table.GetContainingShapeIds(p)) << p;
+    EXPECT_EQ(!expected.empty(), table.Contains(p)) << p;
+  };
+  for (int i = 0; i < 5000; ++i) {
+    check(s2random::SamplePoint(bitgen, cap));
+  }
+  for (const S2Shape* shape : index) {
+    if (shape == nullptr) continue;
+    for (int e = 0; e < shape->num_edges(); ++e) check(shape->edge(e).v0);
+  }
+}
+
+TEST(S2ShapeIndexContainmentTable, BatchMatchesSinglePoints) {
+  absl::BitGen bitgen(S2Testing::MakeTaggedSeedSeq(
+      "S2_SHAPE_INDEX_CONTAINMENT_TABLE_BATCH",
+      absl::LogInfoStreamer(__FILE__, __LINE__).stream()));
+  MutableS2ShapeIndex index;
+  const auto frame = s2random::Frame(bitgen);
+  S2Fractal fractal(bitgen);
+  fractal.SetLevelForApproxMaxEdges(500);
+  for (double km : {3000, 1000, 300}) {
+    index.Add(make_unique<S2Loop::OwningShape>(
+        fractal.MakeLoop(frame, S2Testing::KmToAngle(km))));
+  }
+  S2ShapeIndexContainmentTable table(index);
+  // Use enough points to span several blocks, including a partial one.
+  const S2Cap cap(frame.Col(2), S2Testing::KmToAngle(4000));
+  vector<S2Point> points;
+  for (int i = 0; i < 10000; ++i) {
+    points.push_back(s2random::SamplePoint(bitgen, cap));
+  }
+  for (int num_threads : {1, 4}) {
+    vector<size_t> offsets;
+    vector<int> shape_ids;
+    table.GetContainingShapeIds(points, num_threads, &offsets, &shape_ids);
+    ASSERT_EQ(points.size() + 1, offsets.size());
+    EXPECT_EQ(0, offsets[0]);
+    EXPECT_EQ(shape_ids.size(), offsets.back());
+    for (size_t i = 0; i < points.size(); ++i) {
+      EXPECT_EQ(table.GetContainingShapeIds(points[i]),
+                vector<int>(shape_ids.begin() + offsets[i],
+                            shape_ids.begin() + offsets[i + 1]));
+    }
+  }
+
+  // An empty batch produces a single offset.
+  vector<size_t> offsets;
+  vector<int> shape_ids;
+  table.GetContainingShapeIds({}, 4, &offsets, &shape_ids);
+  EXPECT_EQ(vector<size_t>{0}, offsets);
+  EXPECT_TRUE(shape_ids.empty());
+}
+
+TEST(S2ShapeIndexContainmentTable, Empty) {
+  S2ShapeIndexContainmentTable uninitialized;
+  EXPECT_FALSE(uninitialized.Contains(S2Point(1, 0, 0)));
+  EXPECT_EQ(uninitialized.num_cells(), 0);
+
+  MutableS2ShapeIndex index;
+  S2ShapeIndexContainmentTable table(index);
+  EXPECT_FALSE(table.Contains(S2Point(1, 0, 0)));
+  EXPECT_EQ(table.num_cells(), 0);
+}
+
+TEST(S2ShapeIndexContainmentTable, IgnoresPointsAndPolylines) {
+  auto index = s2textformat::MakeIndexOrDie("0:0 # 0:0, 1:1 #");
+  S2ShapeIndexContainmentTable table(*index);
+  EXPECT_EQ(table.num_cells(), 0);
+  EXPECT_FALSE(table.Contains(s2textformat::MakePointOrDie("0:0")));
+}
+
+TEST(S2ShapeIndexContainmentTable, SharedVerticesAndFull) {
+  absl::BitGen bitgen;
+  auto index = s2textformat::MakeIndexOrDie(
+      "# # 0:0, 0:2, 2:1 | 0:2, 0:4, 2:3 | full");
+  ExpectSameAsContainsPointQuery(*index, S2Cap::Full(), bitgen);
+}
+
+TEST(S2ShapeIndexContainmentTable, NestedPolygons) {
+  absl::BitGen bitgen(S2Testing::MakeTaggedSeedSeq(
+      "S2_SHAPE_INDEX_CONTAINMENT_TABLE_NESTED_POLYGONS",
+      absl::LogInfoStreamer(__FILE__, __LINE__).stream()));
+  // Build nested fractal loops of decreasing size around a common center,
+  // similar to a hierarchy of administrative regions.
+  MutableS2ShapeIndex index;
+  const auto frame = s2random::Frame(bitgen);
+  S2Fractal fractal(bitgen);
+  fractal.SetLevelForApproxMaxEdges(500);
+  for (double km : {3000, 1000, 300, 100, 30}) {
+    index.Add(make_unique<S2Loop::OwningShape>(
+        fractal.MakeLoop(frame, S2Testing::KmToAngle(km))));
+  }
+  S2ShapeIndexContainmentTable table(index);
+  EXPECT_GT(table.num_cells(), 0);
+  EXPECT_GT(table.SpaceUsed(), sizeof(table));
+  ExpectSameAsContainsPointQuery(
+      index, S2Cap(frame.Col(2), S2Testing::KmToAngle(4000)), bitgen);
+}
+
+}  // namespace
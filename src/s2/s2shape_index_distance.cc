@@ -0,0 +1,219 @@
+// Copyright 2024 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#include "s2/s2shape_index_distance.h"
+
+#include <algorithm>
+#include <queue>
+#include <vector>
+
+#include "s2/s1chord_angle.h"
+#include "s2/s2cell.h"
+#include "s2/s2cell_id.h"
+#include "s2/s2edge_distances.h"
+#include "s2/s2min_distance_targets.h"
+#include "s2/s2point.h"
+#include "s2/s2shape.h"
+#include "s2/s2shape_index.h"
+
+using std::vector;
+
+namespace S2 {
+
+namespace {
+
+// Returns true if some polygon of "index" contains a point of "target" (as
+// defined by S2MinDistanceShapeIndexTarget::VisitContainingShapeIds).
+bool ContainsAnyChainStart(const S2ShapeIndex& index,
+                           const S2ShapeIndex& target) {
+  bool found = false;
+  S2MinDistanceShapeIndexTarget(&target).VisitContainingShapeIds(
+      index, [&found](int, const S2Point&) {
+        found = true;
+        return false;  // Stop searching.
+      });
+  return found;
+}
+
+// Finds the closest pair of edges in two indexes by traversing both cell
+// hierarchies simultaneously.  Each node of the traversal is either an
+// index cell or a cell that contains several index cells.
+class DualTreeDistance {
+ public:
+  DualTreeDistance(const S2ShapeIndex& a, const S2ShapeIndex& b)
+      : a_(a), b_(b),
+        a_iter_(&a, S2ShapeIndex::UNPOSITIONED),
+        b_iter_(&b, S2ShapeIndex::UNPOSITIONED) {}
+
+  // Returns the minimum distance between an edge of A and an edge of B if it
+  // is less than "limit", and "limit" otherwise.
+  S1ChordAngle Run(S1ChordAngle limit);
+
+ private:
+  struct Node {
+    S2CellId id;
+    // The index cell with the given id, or nullptr if "id" contains several
+    // index cells.
+    const S2ShapeIndexCell* index_cell;
+  };
+
+  struct QueueEntry {
+    S1ChordAngle distance;  // A lower bound on the distance between a and b.
+    Node a, b;
+
+    // The priority queue returns the smallest entry first.
+    bool operator<(const QueueEntry& other) const {
+      return distance > other.distance;
+    }
+  };
+
+  // Appends the nodes for the children of "id" that intersect the index, or
+  // the six face cells if "id" is S2CellId::None().
+  static void AddChildren(S2ShapeIndex::Iterator* iter, S2CellId id,
+                          vector<Node>* nodes);
+
+  // Adds the pair (a, b) to the queue unless the cells are too far apart.
+  void Enqueue(const Node& a, const Node& b);
+
+  // Updates min_distance_ using every pair of edges in the two cells.
+  void ProcessEdges(const S2ShapeIndexCell& a_cell,
+                    const S2ShapeIndexCell& b_cell);
+
+  const S2ShapeIndex& a_;
+  const S2ShapeIndex& b_;
+  S2ShapeIndex::Iterator a_iter_, b_iter_;
+  S1ChordAngle min_distance_;
+  std::priority_queue<QueueEntry> queue_;
+
+  // Temporaries, declared here to avoid repeated allocation.
+  vector<Node> children_;
+  vector<S2Shape::Edge> b_edges_;
+};
+
+S1ChordAngle DualTreeDistance::Run(S1ChordAngle limit) {
+  min_distance_ = limit;
+  vector<Node> a_roots, b_roots;
+  AddChildren(&a_iter_, S2CellId::None(), &a_roots);
+  AddChildren(&b_iter_, S2CellId::None(), &b_roots);
+  for (const Node& a : a_roots) {
+    for (const Node& b : b_roots) Enqueue(a, b);
+  }
+  while (!queue_.empty()) {
+    QueueEntry entry = queue_.top();
+    queue_.pop();
+    if (entry.distance >= min_distance_) break;
+    if (entry.a.index_cell && entry.b.index_cell) {
+      ProcessEdges(*entry.a.index_cell, *entry.b.index_cell);
+      if (min_distance_ == S1ChordAngle::Zero()) break;
+      continue;
+    }
+    // Subdivide the larger of the two cells (or the only one that can be
+    // subdivided).
+    children_.clear();
+    if (entry.b.index_cell ||
+        (!entry.a.index_cell && entry.a.id.level() <= entry.b.id.level())) {
+      AddChildren(&a_iter_, entry.a.id, &children_);
+      for (const Node& child : children_) Enqueue(child, entry.b);
+    } else {
+      AddChildren(&b_iter_, entry.b.id, &children_);
+      for (const Node& child : children_) Enqueue(entry.a, child);
+    }
+  }
+  return min_distance_;
+}
+
+void DualTreeDistance::AddChildren(S2ShapeIndex::Iterator* iter, S2CellId id,
+                                   vector<Node>* nodes) {
+  S2CellId begin, end;
+  if (id == S2CellId::None()) {
+    begin = S2CellId::FromFace(0);
+    end = S2CellId::End(0);
+  } else {
+    begin = id.child_begin();
+    end = id.child_end();
+  }
+  for (S2CellId child = begin; child != end; child = child.next()) {
+    S2CellRelation r = iter->Locate(child);
+    if (r == S2CellRelation::SUBDIVIDED) {
+      nodes->push_back(Node{child, nullptr});
+    } else if (r == S2CellRelation::INDEXED) {
+      // The parent is subdivided (or is a face), so the index cell that
+      // contains "child" is "child" itself.  Cells without edges can be
+      // skipped since only edges are used to measure distance.
+      const S2ShapeIndexCell& cell = iter->cell();
+      for (int s = 0; s < cell.num_clipped(); ++s) {
+        if (cell.clipped(s).num_edges() > 0) {
+          nodes->push_back(Node{iter->id(), &cell});
+          break;
+        }
+      }
+    }
+  }
+}
+
+void DualTreeDistance::Enqueue(const Node& a, const Node& b) {
+  S1ChordAngle distance = S2Cell(a.id).GetDistance(S2Cell(b.id));
+  if (distance < min_distance_) queue_.push(QueueEntry{distance, a, b});
+}
+
+void DualTreeDistance::ProcessEdges(const S2ShapeIndexCell& a_cell,
+                                    const S2ShapeIndexCell& b_cell) {
+  b_edges_.clear();
+  for (int s = 0; s < b_cell.num_clipped(); ++s) {
+    const S2ClippedShape& clipped = b_cell.clipped(s);
+    const S2Shape* shape = b_.shape(clipped.shape_id());
+    for (int j = 0; j < clipped.num_edges(); ++j) {
+      b_edges_.push_back(shape->edge(clipped.edge(j)));
+    }
+  }
+  for (int s = 0; s < a_cell.num_clipped(); ++s) {
+    const S2ClippedShape& clipped = a_cell.clipped(s);
+    const S2Shape* shape = a_.shape(clipped.shape_id());
+    for (int j = 0; j < clipped.num_edges(); ++j) {
+      S2Shape::Edge a_edge = shape->edge(clipped.edge(j));
+      for (const S2Shape::Edge& b_edge : b_edges_) {
+        S2::UpdateEdgePairMinDistance(a_edge.v0, a_edge.v1, b_edge.v0,
+                                      b_edge.v1, &min_distance_);
+      }
+    }
+  }
+}
+
+// Returns the minimum distance between "a" and "b" if it is less than
+// "limit", and "limit" otherwise.
+S1ChordAngle GetDistanceLimited(const S2ShapeIndex& a, const S2ShapeIndex& b,
+                                bool include_interiors, S1ChordAngle limit) {
+  if (include_interiors &&
+      (ContainsAnyChainStart(a, b) || ContainsAnyChainStart(b, a))) {
+    return std::min(limit, S1ChordAngle::Zero());
+  }
+  return DualTreeDistance(a, b).Run(limit);
+}
+
+}  // namespace
+
+S1ChordAngle GetDistance(const S2ShapeIndex& a, const S2ShapeIndex& b,
+                         bool include_interiors) {
+  return GetDistanceLimited(a, b, include_interiors,
+                            S1ChordAngle::Infinity());
+}
+
+bool IsDistanceLess(const S2ShapeIndex& a, const S2ShapeIndex& b,
+                    S1ChordAngle limit, bool include_interiors) {
+  return GetDistanceLimited(a, b, include_interiors, limit) < limit;
+}
+
+}  // namespace S2
@@ -0,0 +1,66 @@
+// Copyright 2024 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+// Functions that measure the distance between the geometry in two
+// S2ShapeIndex objects.
+//
+// These are equivalent to using S2ClosestEdgeQuery with an
+// S2ClosestEdgeQuery::ShapeIndexTarget, but they are much faster when both
+// indexes are large.  S2ClosestEdgeQuery descends the cell hierarchy of one
+// index and answers each cell or edge distance with a nested query against
+// the other index.  These functions instead descend both cell hierarchies
+// simultaneously ("dual-tree traversal"), processing pairs of cells in order
+// of increasing distance and discarding pairs that are farther apart than
+// the closest pair of edges found so far.
+
+#ifndef S2_S2SHAPE_INDEX_DISTANCE_H_
+#define S2_S2SHAPE_INDEX_DISTANCE_H_
+
+#include "s2/s1chord_angle.h"
+#include "s2/s2shape_index.h"
+
+namespace S2 {
+
+// Returns the minimum distance between the geometry in "a" and "b".  If
+// "include_interiors" is true, polygons are considered to include their
+// interiors, so that the distance is zero if a polygon of either index
+// contains any part of the other geometry.  Otherwise the distance is
+// measured to polygon boundaries only.  Returns S1ChordAngle::Infinity() if
+// either index is empty.
+//
+// The result is the same as
+//
+//   S2ClosestEdgeQuery query(&a);
+//   query.mutable_options()->set_include_interiors(include_interiors);
+//   S2ClosestEdgeQuery::ShapeIndexTarget target(&b);
+//   target.set_include_interiors(include_interiors);
+//   query.GetDistance(&target);
+//
+// except for rounding errors in the edge distance computations (which are
+// at most S2::GetUpdateMinDistanceMaxError()).
+S1ChordAngle GetDistance(const S2ShapeIndex& a, const S2ShapeIndex& b,
+                         bool include_interiors = true);
+
+// Returns true if the distance between "a" and "b" (as defined above) is
+// less than "limit".  This is faster than GetDistance() because the search
+// stops as soon as any pair of edges closer than "limit" is found, and
+// cell pairs farther than "limit" apart are never examined.
+bool IsDistanceLess(const S2ShapeIndex& a, const S2ShapeIndex& b,
+                    S1ChordAngle limit, bool include_interiors = true);
+
+}  // namespace S2
+
+#endif  // S2_S2SHAPE_INDEX_DISTANCE_H_
@@ -0,0 +1,127 @@
+// Copyright 2024 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#include "s2/s2shape_index_distance.h"
+
+#include <memory>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include "absl/log/log_streamer.h"
+#include "absl/random/random.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "s2/mutable_s2shape_index.h"
+#include "s2/s1angle.h"
+#include "s2/s1chord_angle.h"
+#include "s2/s2cap.h"
+#include "s2/s2closest_edge_query.h"
+#include "s2/s2edge_distances.h"
+#include "s2/s2fractal.h"
+#include "s2/s2lax_polyline_shape.h"
+#include "s2/s2loop.h"
+#include "s2/s2point.h"
+#include "s2/s2random.h"
+#include "s2/s2testing.h"
+#include "s2/s2text_format.h"
+
+using absl::string_view;
+using std::make_unique;
+using std::vector;
+
+namespace {
+
+// Returns the distance computed by S2ClosestEdgeQuery with a ShapeIndexTarget.
+S1ChordAngle GetExpectedDistance(const S2ShapeIndex& a, const S2ShapeIndex& b,
+                                 bool include_interiors) {
+  S2ClosestEdgeQuery query(&a);
+  query.mutable_options()->set_include_interiors(include_interiors);
+  S2ClosestEdgeQuery::ShapeIndexTarget target(&b);
+  target.set_include_interiors(include_interiors);
+  return query.GetDistance(&target);
+}
+
+void ExpectSameDistance(const S2ShapeIndex& a, const S2ShapeIndex& b) {
+  for (bool include_interiors : {false, true}) {
+    S1ChordAngle expected = GetExpectedDistance(a, b, include_interiors);
+    S1ChordAngle actual = S2::GetDistance(a, b, include_interiors);
+    if (expected.is_infinity()) {
+      EXPECT_TRUE(actual.is_infinity());
+      continue;
+    }
+    EXPECT_NEAR(expected.length2(), actual.length2(),
+                S2::GetUpdateMinDistanceMaxError(expected));
+    EXPECT_EQ(S2::GetDistance(b, a, include_interiors) == S1ChordAngle::Zero(),
+              actual == S1ChordAngle::Zero());
+  }
+}
+
+TEST(S2ShapeIndexDistance, SimpleCases) {
+  for (string_view a_str :
+       {"# #", "# # full", "0:0 # #", "# 0:0, 0:5 #", "# # 0:0, 0:5, 5:5, 5:0",
+        "# # 0:0, 0:5, 5:5, 5:0; 1:1, 4:1, 4:4, 1:4"}) {
+    for (string_view b_str :
+         {"# #", "# # full", "2:2 # #", "# 10:10, 10:11 #",
+          "# 2:2, 2:3 #", "# # 10:10, 10:11, 11:11",
+          "# # -1:-1, -1:6, 6:6, 6:-1"}) {
+      SCOPED_TRACE(absl::StrCat(a_str, " vs ", b_str));
+      auto a = s2textformat::MakeIndexOrDie(a_str);
+      auto b = s2textformat::MakeIndexOrDie(b_str);
+      ExpectSameDistance(*a, *b);
+    }
+  }
+}
+
+TEST(S2ShapeIndexDistance, IsDistanceLess) {
+  auto a = s2textformat::MakeIndexOrDie("# 0:0, 0:1 #");
+  auto b = s2textformat::MakeIndexOrDie("# 2:0, 2:1 #");
+  S1ChordAngle distance = S2::GetDistance(*a, *b);
+  EXPECT_NEAR(S1Angle(distance).degrees(), 2.0, 1e-10);
+  EXPECT_TRUE(S2::IsDistanceLess(*a, *b, distance.Successor()));
+  EXPECT_FALSE(S2::IsDistanceLess(*a, *b, distance));
+  EXPECT_FALSE(S2::IsDistanceLess(*a, *b, S1ChordAngle::Zero()));
+}
+
+TEST(S2ShapeIndexDistance, MatchesClosestEdgeQuery) {
+  absl::BitGen bitgen(S2Testing::MakeTaggedSeedSeq(
+      "SHAPE_INDEX_DISTANCE",
+      absl::LogInfoStreamer(__FILE__, __LINE__).stream()));
+  S2Fractal fractal(bitgen);
+  fractal.SetLevelForApproxMaxEdges(1000);
+  const S2Cap cap(s2random::Point(bitgen), S1Angle::Degrees(10));
+  for (int iter = 0; iter < 50; ++iter) {
+    MutableS2ShapeIndex a, b;
+    for (MutableS2ShapeIndex* index : {&a, &b}) {
+      const S2Point center = s2random::SamplePoint(bitgen, cap);
+      const S1Angle radius =
+          S1Angle::Degrees(absl::Uniform(bitgen, 0.01, 3.0));
+      if (absl::Bernoulli(bitgen, 0.7)) {
+        index->Add(make_unique<S2Loop::OwningShape>(
+            fractal.MakeLoop(s2random::FrameAt(bitgen, center), radius)));
+      } else {
+        vector<S2Point> vertices;
+        for (int i = 0; i < 100; ++i) {
+          vertices.push_back(
+              s2random::SamplePoint(bitgen, S2Cap(center, radius)));
+        }
+        index->Add(make_unique<S2LaxPolylineShape>(vertices));
+      }
+    }
+    ExpectSameDistance(a, b);
+  }
+}
+
+}  // namespace
@@ -0,0 +1,167 @@
+// Copyright 2024 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "s2/s2shape_index_join.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "s2/mutable_s2shape_index.h"
+#include "s2/s1chord_angle.h"
+#include "s2/s2boolean_operation.h"
+#include "s2/s2cell_iterator_join.h"
+#include "s2/s2contains_point_query.h"
+#include "s2/s2edge_crosser.h"
+#include "s2/s2edge_distances.h"
+#include "s2/s2shape.h"
+#include "s2/s2shape_index.h"
+#include "s2/s2wrapped_shape.h"
+
+using std::make_unique;
+using std::vector;
+
+using Predicate = S2ShapeIndexJoin::Predicate;
+using ShapePair = S2ShapeIndexJoin::ShapePair;
+
+namespace {
+
+// Returns true if the interior of "shape" contains some point of "other",
+// given that no edge of "other" intersects an edge of "shape".  In that case
+// each chain of "other" is either entirely inside or entirely outside
+// "shape", so it is enough to test one vertex per chain.  Both shapes must be
+// non-empty.
+bool InteriorContainsAnyPoint(S2ContainsPointQuery<S2ShapeIndex>* query,
+                              int shape_id, const S2Shape& shape,
+                              const S2Shape& other) {
+  if (shape.dimension() != 2) return false;
+  // A non-empty shape without edges is the full polygon.
+  if (other.num_edges() == 0) return true;
+  for (int i = 0; i < other.num_chains(); ++i) {
+    S2Shape::Chain chain = other.chain(i);
+    if (chain.length == 0) continue;
+    if (query->ShapeContains(shape_id, other.edge(chain.start).v0)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Returns true if "a" contains "b" according to S2BooleanOperation.
+bool ShapeContains(const S2Shape& a, const S2Shape& b) {
+  MutableS2ShapeIndex index_a, index_b;
+  index_a.Add(make_unique<S2WrappedShape>(&a));
+  index_b.Add(make_unique<S2WrappedShape>(&b));
+  return S2BooleanOperation::Contains(index_a, index_b);
+}
+
+}  // namespace
+
+S2ShapeIndexJoin::Options::Options()
+    : predicate_(Predicate::INTERSECTS), max_distance_(S1ChordAngle::Zero()) {}
+
+S2ShapeIndexJoin::S2ShapeIndexJoin(const S2ShapeIndex* a,
+                                   const S2ShapeIndex* b,
+                                   const Options& options)
+    : a_(*a), b_(*b), options_(options) {}
+
+bool S2ShapeIndexJoin::EdgesAreNear(const S2Shape& shape_a,
+                                    const S2ClippedShape& clipped_a,
+                                    const S2Shape& shape_b,
+                                    const S2ClippedShape& clipped_b) const {
+  const S1ChordAngle max_distance = options_.max_distance();
+  const bool test_distance = options_.predicate() ==
+                                 Predicate::WITHIN_DISTANCE &&
+                             max_distance > S1ChordAngle::Zero();
+  for (int i = 0; i < clipped_a.num_edges(); ++i) {
+    S2Shape::Edge a = shape_a.edge(clipped_a.edge(i));
+    S2EdgeCrosser crosser(&a.v0, &a.v1);
+    for (int j = 0; j < clipped_b.num_edges(); ++j) {
+      S2Shape::Edge b = shape_b.edge(clipped_b.edge(j));
+      if (test_distance) {
+        // UpdateEdgePairMinDistance() returns true if the distance is less
+        // than "dist", i.e. at most max_distance.
+        S1ChordAngle dist = max_distance.Successor();
+        if (S2::UpdateEdgePairMinDistance(a.v0, a.v1, b.v0, b.v1, &dist)) {
+          return true;
+        }
+      } else if (crosser.CrossingSign(&b.v0, &b.v1) >= 0) {
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+vector<ShapePair> S2ShapeIndexJoin::GetShapePairs() {
+  const Predicate predicate = options_.predicate();
+  S1ChordAngle tolerance = S1ChordAngle::Zero();
+  if (predicate == Predicate::WITHIN_DISTANCE) {
+    // Cell distances are computed inexactly, so the cells are joined using a
+    // slightly larger tolerance to avoid missing any pairs.
+    const S1ChordAngle max_distance = options_.max_distance();
+    tolerance = max_distance.PlusError(
+        S2::GetUpdateMinDistanceMaxError(max_distance));
+  }
+
+  // Maps each candidate pair (packed into 64 bits) to whether it is already
+  // known to satisfy the predicate.  Since the state for a pair is a single
+  // hash table entry, pairs that share many cells cost no extra memory.
+  absl::flat_hash_map<uint64_t, bool> candidates;
+  auto key = [](int a, int b) {
+    return static_cast<uint64_t>(a) << 32 | static_cast<uint32_t>(b);
+  };
+  using Iterator = S2ShapeIndex::Iterator;
+  MakeS2CellIteratorJoin(&a_, &b_, tolerance)
+      .Join([&](const Iterator& iter_a, const Iterator& iter_b) {
+        const S2ShapeIndexCell& cell_a = iter_a.cell();
+        const S2ShapeIndexCell& cell_b = iter_b.cell();
+        for (int i = 0; i < cell_a.num_clipped(); ++i) {
+          const S2ClippedShape& clipped_a = cell_a.clipped(i);
+          for (int j = 0; j < cell_b.num_clipped(); ++j) {
+            const S2ClippedShape& clipped_b = cell_b.clipped(j);
+            auto [it, inserted] = candidates.try_emplace(
+                key(clipped_a.shape_id(), clipped_b.shape_id()), false);
+            if (it->second || predicate == Predicate::CONTAINS) continue;
+            it->second = EdgesAreNear(*a_.shape(clipped_a.shape_id()),
+                                      clipped_a,
+                                      *b_.shape(clipped_b.shape_id()),
+                                      clipped_b);
+          }
+        }
+        return true;
+      });
+
+  // Resolve the candidates that were not decided by their edges.
+  S2ContainsPointQuery<S2ShapeIndex> query_a(&a_), query_b(&b_);
+  vector<ShapePair> result;
+  for (const auto& [pair_key, satisfied] : candidates) {
+    const int id_a = pair_key >> 32, id_b = static_cast<uint32_t>(pair_key);
+    const S2Shape& shape_a = *a_.shape(id_a);
+    const S2Shape& shape_b = *b_.shape(id_b);
+    if (predicate == Predicate::CONTAINS) {
+      if (!ShapeContains(shape_a, shape_b)) continue;
+    } else if (!satisfied &&
+               !InteriorContainsAnyPoint(&query_a, id_a, shape_a, shape_b) &&
+               !InteriorContainsAnyPoint(&query_b, id_b, shape_b, shape_a)) {
+      continue;
+    }
+    result.emplace_back(id_a, id_b);
+  }
+  std::sort(result.begin(), result.end());
+  return result;
+}
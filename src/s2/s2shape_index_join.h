@@ -0,0 +1,115 @@
+// Copyright 2024 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef S2_S2SHAPE_INDEX_JOIN_H_
+#define S2_S2SHAPE_INDEX_JOIN_H_
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "s2/s1chord_angle.h"
+#include "s2/s2shape_index.h"
+
+// S2ShapeIndexJoin finds all pairs of shapes (shape_a, shape_b), where
+// shape_a belongs to one S2ShapeIndex and shape_b belongs to another, that
+// satisfy a given predicate (e.g., the shapes intersect).  For example:
+//
+//   S2ShapeIndexJoin::Options options;
+//   options.set_predicate(S2ShapeIndexJoin::Predicate::WITHIN_DISTANCE);
+//   options.set_max_distance(S1ChordAngle(S2Earth::ToAngle(
+//       util::units::Meters(100))));
+//   S2ShapeIndexJoin join(&roads_index, &buildings_index, options);
+//   for (auto [road_id, building_id] : join.GetShapePairs()) { ... }
+//
+// The two indexes are first joined cell by cell (see S2CellIteratorJoin), so
+// that only shapes that appear in overlapping (or nearby) index cells become
+// candidates.  Each candidate pair is then tested using only the edges that
+// are clipped to those cells, which are usually a tiny fraction of the edges
+// of either shape.  Pairs that are not decided by their edges (e.g., because
+// one shape is inside the other) are resolved by a point containment test.
+// Each pair is reported once, no matter how many cells the shapes share.
+//
+// This class is not thread-safe, but the indexes may be shared by several
+// joins running in different threads.
+class S2ShapeIndexJoin {
+ public:
+  enum class Predicate : uint8_t {
+    // The shapes intersect when regarded as closed sets, i.e. the distance
+    // between them is zero.  (This matches S2ClosestEdgeQuery with
+    // include_interiors() == true, rather than S2BooleanOperation with its
+    // default semi-open polygon model.)
+    INTERSECTS,
+
+    // The distance between the shapes (including their interiors) is at most
+    // max_distance().
+    WITHIN_DISTANCE,
+
+    // shape_a contains shape_b, as determined by S2BooleanOperation::Contains
+    // with default options.  This builds an index for each candidate pair,
+    // so it is much slower than the other predicates.
+    CONTAINS,
+  };
+
+  class Options {
+   public:
+    Options();
+
+    // The predicate that the shape pairs must satisfy.
+    //
+    // DEFAULT: Predicate::INTERSECTS
+    Predicate predicate() const { return predicate_; }
+    void set_predicate(Predicate predicate) { predicate_ = predicate; }
+
+    // The maximum distance for Predicate::WITHIN_DISTANCE.  (It is ignored by
+    // the other predicates.)
+    //
+    // DEFAULT: S1ChordAngle::Zero()
+    S1ChordAngle max_distance() const { return max_distance_; }
+    void set_max_distance(S1ChordAngle max_distance) {
+      max_distance_ = max_distance;
+    }
+
+   private:
+    Predicate predicate_;
+    S1ChordAngle max_distance_;
+  };
+
+  // A (shape_id in index "a", shape_id in index "b") pair.
+  using ShapePair = std::pair<int, int>;
+
+  // Both indexes must persist for the lifetime of this object.
+  S2ShapeIndexJoin(const S2ShapeIndex* a, const S2ShapeIndex* b,
+                   const Options& options = Options());
+
+  const Options& options() const { return options_; }
+
+  // Returns all pairs of shapes that satisfy the predicate, sorted by shape
+  // id.
+  std::vector<ShapePair> GetShapePairs();
+
+ private:
+  // Returns true if some edge of "clipped_a" is within the join distance of
+  // some edge of "clipped_b".
+  bool EdgesAreNear(const S2Shape& shape_a, const S2ClippedShape& clipped_a,
+                    const S2Shape& shape_b,
+                    const S2ClippedShape& clipped_b) const;
+
+  const S2ShapeIndex& a_;
+  const S2ShapeIndex& b_;
+  Options options_;
+};
+
+#endif  // S2_S2SHAPE_INDEX_JOIN_H_
@@ -0,0 +1,165 @@
+// Copyright 2024 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "s2/s2shape_index_join.h"
+
+#include <memory>
+#include <vector>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include "absl/log/log_streamer.h"
+#include "absl/random/random.h"
+#include "s2/mutable_s2shape_index.h"
+#include "s2/s1angle.h"
+#include "s2/s1chord_angle.h"
+#include "s2/s2boolean_operation.h"
+#include "s2/s2cap.h"
+#include "s2/s2closest_edge_query.h"
+#include "s2/s2loop.h"
+#include "s2/s2point.h"
+#include "s2/s2point_vector_shape.h"
+#include "s2/s2polygon.h"
+#include "s2/s2polyline.h"
+#include "s2/s2random.h"
+#include "s2/s2testing.h"
+#include "s2/s2text_format.h"
+#include "s2/s2wrapped_shape.h"
+
+using Predicate = S2ShapeIndexJoin::Predicate;
+using ShapePair = S2ShapeIndexJoin::ShapePair;
+using std::make_unique;
+using std::vector;
+using ::testing::ElementsAre;
+using ::testing::Pair;
+
+namespace {
+
+// Returns the pairs that satisfy the predicate, computed by testing every
+// pair of shapes separately.
+vector<ShapePair> GetShapePairsBruteForce(
+    const S2ShapeIndex& a, const S2ShapeIndex& b,
+    const S2ShapeIndexJoin::Options& options) {
+  vector<ShapePair> result;
+  for (int i = 0; i < a.num_shape_ids(); ++i) {
+    MutableS2ShapeIndex index_a;
+    index_a.Add(make_unique<S2WrappedShape>(a.shape(i)));
+    for (int j = 0; j < b.num_shape_ids(); ++j) {
+      MutableS2ShapeIndex index_b;
+      index_b.Add(make_unique<S2WrappedShape>(b.shape(j)));
+      bool satisfied;
+      if (options.predicate() == Predicate::CONTAINS) {
+        satisfied = S2BooleanOperation::Contains(index_a, index_b);
+      } else {
+        S1ChordAngle max_distance =
+            options.predicate() == Predicate::WITHIN_DISTANCE
+                ? options.max_distance()
+                : S1ChordAngle::Zero();
+        S2ClosestEdgeQuery query(&index_a);
+        S2ClosestEdgeQuery::ShapeIndexTarget target(&index_b);
+        satisfied = query.IsDistanceLessOrEqual(&target, max_distance);
+      }
+      if (satisfied) result.emplace_back(i, j);
+    }
+  }
+  return result;
+}
+
+// Adds random polygons, polylines, and points within "cap" to "index".
+void AddRandomShapes(absl::BitGenRef bitgen, const S2Cap& cap, int num_shapes,
+                     MutableS2ShapeIndex* index) {
+  for (int i = 0; i < num_shapes; ++i) {
+    S2Point center = s2random::SamplePoint(bitgen, cap);
+    S1Angle radius = S1Angle::Degrees(absl::Uniform(bitgen, 0.01, 1.0));
+    switch (absl::Uniform(bitgen, 0, 3)) {
+      case 0:
+        index->Add(make_unique<S2Polygon::OwningShape>(make_unique<S2Polygon>(
+            S2Loop::MakeRegularLoop(center, radius,
+                                    absl::Uniform(bitgen, 3, 20)))));
+        break;
+      case 1: {
+        vector<S2Point> vertices;
+        for (int j = absl::Uniform(bitgen, 2, 10); j > 0; --j) {
+          vertices.push_back(s2random::SamplePoint(
+              bitgen, S2Cap(center, radius)));
+        }
+        index->Add(make_unique<S2Polyline::OwningShape>(
+            make_unique<S2Polyline>(vertices)));
+        break;
+      }
+      default: {
+        vector<S2Point> points;
+        for (int j = absl::Uniform(bitgen, 1, 5); j > 0; --j) {
+          points.push_back(s2random::SamplePoint(
+              bitgen, S2Cap(center, radius)));
+        }
+        index->Add(make_unique<S2PointVectorShape>(std::move(points)));
+        break;
+      }
+    }
+  }
+}
+
+TEST(S2ShapeIndexJoin, Basic) {
+  auto a = s2textformat::MakeIndexOrDie(
+      "# # 0:0, 0:10, 10:10, 10:0 | 20:20, 20:21, 21:21");
+  auto b = s2textformat::MakeIndexOrDie("5:5 # 9:9, 11:11 | 1:1, 2:2 #");
+  EXPECT_THAT(S2ShapeIndexJoin(a.get(), b.get()).GetShapePairs(),
+              ElementsAre(Pair(0, 0), Pair(0, 1), Pair(0, 2)));
+
+  S2ShapeIndexJoin::Options options;
+  options.set_predicate(Predicate::CONTAINS);
+  EXPECT_THAT(S2ShapeIndexJoin(a.get(), b.get(), options).GetShapePairs(),
+              ElementsAre(Pair(0, 0), Pair(0, 2)));
+
+  // The triangle is about 12.7 degrees from the end of the first polyline.
+  options.set_predicate(Predicate::WITHIN_DISTANCE);
+  options.set_max_distance(S1ChordAngle::Degrees(13));
+  EXPECT_THAT(S2ShapeIndexJoin(a.get(), b.get(), options).GetShapePairs(),
+              ElementsAre(Pair(0, 0), Pair(0, 1), Pair(0, 2), Pair(1, 1)));
+}
+
+TEST(S2ShapeIndexJoin, FullPolygon) {
+  auto a = s2textformat::MakeIndexOrDie("# # full");
+  auto b = s2textformat::MakeIndexOrDie("1:1 # # 0:0, 0:1, 1:0");
+  EXPECT_THAT(S2ShapeIndexJoin(a.get(), b.get()).GetShapePairs(),
+              ElementsAre(Pair(0, 0), Pair(0, 1)));
+  EXPECT_THAT(S2ShapeIndexJoin(b.get(), a.get()).GetShapePairs(),
+              ElementsAre(Pair(0, 0), Pair(1, 0)));
+}
+
+TEST(S2ShapeIndexJoin, MatchesBruteForce) {
+  absl::BitGen bitgen(S2Testing::MakeTaggedSeedSeq(
+      "MATCHES_BRUTE_FORCE",
+      absl::LogInfoStreamer(__FILE__, __LINE__).stream()));
+  for (int iter = 0; iter < 5; ++iter) {
+    S2Cap cap(s2random::Point(bitgen), S1Angle::Degrees(5));
+    MutableS2ShapeIndex a, b;
+    AddRandomShapes(bitgen, cap, 40, &a);
+    AddRandomShapes(bitgen, cap, 40, &b);
+    for (Predicate predicate : {Predicate::INTERSECTS,
+                                Predicate::WITHIN_DISTANCE,
+                                Predicate::CONTAINS}) {
+      S2ShapeIndexJoin::Options options;
+      options.set_predicate(predicate);
+      options.set_max_distance(S1ChordAngle::Degrees(0.5));
+      EXPECT_EQ(S2ShapeIndexJoin(&a, &b, options).GetShapePairs(),
+                GetShapePairsBruteForce(a, b, options))
+          << static_cast<int>(predicate);
+    }
+  }
+}
+
+}  // namespace
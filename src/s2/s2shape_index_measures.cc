@@ -18,18 +18,34 @@
 #include "s2/s2shape_index_measures.h"
 
 #include <algorithm>
+#include <cmath>
+#include <vector>
 
+#include "absl/log/absl_check.h"
+#include "s2/internal/s2parallel.h"
 #include "s2/s1angle.h"
+#include "s2/s2loop_measures.h"
 #include "s2/s2point.h"
+#include "s2/s2point_span.h"
+#include "s2/s2polyline_measures.h"
 #include "s2/s2shape.h"
 #include "s2/s2shape_index.h"
 #include "s2/s2shape_measures.h"
+#include "s2/s2shape_metadata.h"
+
+using std::vector;
 
 namespace S2 {
 
 int GetDimension(const S2ShapeIndex& index) {
   int dim = -1;
+  S2ShapeMetadata metadata;
   for (int i = 0; i < index.num_shape_ids(); ++i) {
+    // Cached metadata lets us avoid decoding the shape.
+    if (index.GetShapeMetadata(i, &metadata)) {
+      dim = std::max(dim, metadata.dimension);
+      continue;
+    }
     const S2Shape* shape = index.shape(i);
     if (shape) dim = std::max(dim, shape->dimension());
   }
@@ -67,7 +83,12 @@ S1Angle GetPerimeter(const S2ShapeIndex& index) {
 
 double GetArea(const S2ShapeIndex& index) {
   double area = 0;
+  S2ShapeMetadata metadata;
   for (int i = 0; i < index.num_shape_ids(); ++i) {
+    if (index.GetShapeMetadata(i, &metadata)) {
+      area += metadata.area;
+      continue;
+    }
     const S2Shape* shape = index.shape(i);
     if (shape) area += S2::GetArea(*shape);
   }
@@ -86,7 +107,12 @@ double GetApproxArea(const S2ShapeIndex& index) {
 S2Point GetCentroid(const S2ShapeIndex& index) {
   int dim = GetDimension(index);
   S2Point centroid;
+  S2ShapeMetadata metadata;
   for (int i = 0; i < index.num_shape_ids(); ++i) {
+    if (index.GetShapeMetadata(i, &metadata)) {
+      if (metadata.dimension == dim) centroid += metadata.centroid;
+      continue;
+    }
     const S2Shape* shape = index.shape(i);
     if (shape && shape->dimension() == dim) {
       centroid += S2::GetCentroid(*shape);
@@ -95,4 +121,146 @@ S2Point GetCentroid(const S2ShapeIndex& index) {
   return centroid;
 }
 
+namespace {
+
+// A range of consecutive chains [begin, end) of the shape "shape_id".
+struct ChainRange {
+  int shape_id;
+  int begin, end;
+};
+
+// Returns the chain ranges of all shapes of the given dimension, in order of
+// increasing shape id and chain id.  A new range is started once the current
+// range has at least this many edges, so that the ranges depend only on the
+// index contents (and not on the number of threads).
+constexpr int kMaxRangeEdges = 1 << 13;
+
+vector<ChainRange> GetChainRanges(const S2ShapeIndex& index, int dimension) {
+  vector<ChainRange> ranges;
+  for (int s = 0; s < index.num_shape_ids(); ++s) {
+    const S2Shape* shape = index.shape(s);
+    if (shape == nullptr || shape->dimension() != dimension) continue;
+    const int num_chains = shape->num_chains();
+    int begin = 0, num_edges = 0;
+    for (int c = 0; c < num_chains; ++c) {
+      num_edges += shape->chain(c).length;
+      if (num_edges >= kMaxRangeEdges) {
+        ranges.push_back({s, begin, c + 1});
+        begin = c + 1;
+        num_edges = 0;
+      }
+    }
+    if (begin < num_chains) ranges.push_back({s, begin, num_chains});
+  }
+  return ranges;
+}
+
+// Returns the sum over all shapes of the given dimension of
+// shape_measure(shape, sum), where "sum" is the sum of
+// chain_measure(shape, chain_id, &vertices) over the chains of the shape.
+// "vertices" is temporary storage that the chain measure may use.  The chain
+// measures are computed using up to "num_threads" threads, and then summed in
+// a fixed order.
+template <class T, class ChainMeasure, class ShapeMeasure>
+T SumChainMeasures(const S2ShapeIndex& index, int dimension, int num_threads,
+                   const ChainMeasure& chain_measure,
+                   const ShapeMeasure& shape_measure) {
+  ABSL_DCHECK_GE(num_threads, 1);
+  const vector<ChainRange> ranges = GetChainRanges(index, dimension);
+  vector<T> range_sums(ranges.size());
+  s2internal::ParallelFor(num_threads, ranges.size(), [&](int i) {
+    const ChainRange& range = ranges[i];
+    const S2Shape& shape = *index.shape(range.shape_id);
+    vector<S2Point> vertices;
+    T sum{};
+    for (int c = range.begin; c < range.end; ++c) {
+      sum += chain_measure(shape, c, &vertices);
+    }
+    range_sums[i] = sum;
+  });
+  T total{};
+  for (size_t i = 0; i < ranges.size();) {
+    const int shape_id = ranges[i].shape_id;
+    T shape_sum{};
+    for (; i < ranges.size() && ranges[i].shape_id == shape_id; ++i) {
+      shape_sum += range_sums[i];
+    }
+    total += shape_measure(*index.shape(shape_id), shape_sum);
+  }
+  return total;
+}
+
+template <class T>
+T Identity(const S2Shape& shape, T sum) {
+  return sum;
+}
+
+}  // namespace
+
+S1Angle GetLength(const S2ShapeIndex& index, int num_threads) {
+  return SumChainMeasures<S1Angle>(
+      index, 1, num_threads,
+      [](const S2Shape& shape, int chain_id, vector<S2Point>* vertices) {
+        GetChainVertices(shape, chain_id, vertices);
+        return S2::GetLength(*vertices);
+      },
+      Identity<S1Angle>);
+}
+
+S1Angle GetPerimeter(const S2ShapeIndex& index, int num_threads) {
+  return SumChainMeasures<S1Angle>(
+      index, 2, num_threads,
+      [](const S2Shape& shape, int chain_id, vector<S2Point>* vertices) {
+        GetChainVertices(shape, chain_id, vertices);
+        return S2::GetPerimeter(S2PointLoopSpan(*vertices));
+      },
+      Identity<S1Angle>);
+}
+
+double GetArea(const S2ShapeIndex& index, int num_threads) {
+  // See S2::GetArea(const S2Shape&) for why loop areas are summed using
+  // S2::GetSignedArea().
+  return SumChainMeasures<double>(
+      index, 2, num_threads,
+      [](const S2Shape& shape, int chain_id, vector<S2Point>* vertices) {
+        GetChainVertices(shape, chain_id, vertices);
+        return S2::GetSignedArea(S2PointLoopSpan(*vertices));
+      },
+      [](const S2Shape& shape, double area) {
+        return (area < 0.0) ? area + 4 * M_PI : area;
+      });
+}
+
+double GetApproxArea(const S2ShapeIndex& index, int num_threads) {
+  return SumChainMeasures<double>(
+      index, 2, num_threads,
+      [](const S2Shape& shape, int chain_id, vector<S2Point>* vertices) {
+        GetChainVertices(shape, chain_id, vertices);
+        return S2::GetApproxArea(S2PointLoopSpan(*vertices));
+      },
+      [](const S2Shape& shape, double area) {
+        // Special case to ensure that full polygons are handled correctly.
+        return (area <= 4 * M_PI) ? area : std::fmod(area, 4 * M_PI);
+      });
+}
+
+S2Point GetCentroid(const S2ShapeIndex& index, int num_threads) {
+  const int dim = GetDimension(index);
+  return SumChainMeasures<S2Point>(
+      index, dim, num_threads,
+      [dim](const S2Shape& shape, int chain_id, vector<S2Point>* vertices) {
+        switch (dim) {
+          case 0:
+            return shape.edge(chain_id).v0;
+          case 1:
+            GetChainVertices(shape, chain_id, vertices);
+            return S2::GetCentroid(S2PointSpan(*vertices));
+          default:
+            GetChainVertices(shape, chain_id, vertices);
+            return S2::GetCentroid(S2PointLoopSpan(*vertices));
+        }
+      },
+      Identity<S2Point>);
+}
+
 }  // namespace S2
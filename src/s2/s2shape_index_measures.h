@@ -18,6 +18,10 @@
 // Defines various angle and area measures for S2ShapeIndex objects.  In
 // general, these methods return the sum of the corresponding measure for the
 // S2Shapes in the index.
+//
+// GetDimension(), GetArea(), and GetCentroid() use the cached shape metadata
+// of the index when it is available (see S2ShapeIndex::GetShapeMetadata), in
+// which case the shapes do not need to be decoded.
 
 #ifndef S2_S2SHAPE_INDEX_MEASURES_H_
 #define S2_S2SHAPE_INDEX_MEASURES_H_
@@ -95,6 +99,25 @@ double GetApproxArea(const S2ShapeIndex& index);
 // centroids can simply be summed).
 S2Point GetCentroid(const S2ShapeIndex& index);
 
+// Multi-threaded versions of the measures above, which use up to
+// "num_threads" threads (including the calling thread).  Shapes are divided
+// into ranges of consecutive chains, where each range contains at most a few
+// thousand edges unless it consists of a single chain.  (Small shapes are
+// therefore processed as a whole, while very large shapes are split across
+// threads.)  The measures of all ranges are then summed in a fixed order, so
+// that the result does not depend on "num_threads".  The result differs from
+// the single-threaded version only by rounding, and only when some shape is
+// split into more than one range.
+//
+// REQUIRES: num_threads >= 1
+// REQUIRES: All shapes in the index support concurrent read access (which
+//           is true of all S2Shape types in this library).
+S1Angle GetLength(const S2ShapeIndex& index, int num_threads);
+S1Angle GetPerimeter(const S2ShapeIndex& index, int num_threads);
+double GetArea(const S2ShapeIndex& index, int num_threads);
+double GetApproxArea(const S2ShapeIndex& index, int num_threads);
+S2Point GetCentroid(const S2ShapeIndex& index, int num_threads);
+
 }  // namespace S2
 
 #endif  // S2_S2SHAPE_INDEX_MEASURES_H_
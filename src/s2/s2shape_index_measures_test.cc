@@ -24,18 +24,25 @@
 #include <cmath>
 #include <memory>
 #include <string>
+#include <vector>
 
 #include <gtest/gtest.h>
 #include "s2/mutable_s2shape_index.h"
 #include "s2/s1angle.h"
+#include "s2/s2latlng.h"
+#include "s2/s2lax_polygon_shape.h"
+#include "s2/s2loop.h"
 #include "s2/s2point.h"
 #include "s2/s2point_vector_shape.h"
 #include "s2/s2pointutil.h"
+#include "s2/s2polyline.h"
 #include "s2/s2shape.h"
+#include "s2/s2testing.h"
 #include "s2/s2text_format.h"
 
 using s2textformat::MakeIndexOrDie;
 using std::make_unique;
+using std::vector;
 
 namespace {
 
@@ -137,4 +144,61 @@ TEST(GetCentroid, Polygon) {
       S2::GetCentroid(*MakeIndexOrDie("5:5 # 6:6, 7:7 # 0:0, 0:90, 90:0"))));
 }
 
+TEST(MultiThreadedMeasures, Empty) {
+  auto index = MakeIndexOrDie("# #");
+  EXPECT_EQ(S1Angle::Zero(), S2::GetLength(*index, 4));
+  EXPECT_EQ(S1Angle::Zero(), S2::GetPerimeter(*index, 4));
+  EXPECT_EQ(0.0, S2::GetArea(*index, 4));
+  EXPECT_EQ(0.0, S2::GetApproxArea(*index, 4));
+  EXPECT_EQ(S2Point(0, 0, 0), S2::GetCentroid(*index, 4));
+}
+
+TEST(MultiThreadedMeasures, TwoFullPolygons) {
+  auto index = MakeIndexOrDie("# # full | full");
+  EXPECT_EQ(8 * M_PI, S2::GetArea(*index, 4));
+  EXPECT_EQ(8 * M_PI, S2::GetApproxArea(*index, 4));
+}
+
+TEST(MultiThreadedMeasures, SmallShapesMatchSingleThreaded) {
+  // When no shape is split, the results are exactly the same.
+  MutableS2ShapeIndex index;
+  for (int i = 0; i < 200; ++i) {
+    S2Point center = S2LatLng::FromDegrees(i % 80, i).ToPoint();
+    index.Add(make_unique<S2Loop::OwningShape>(
+        S2Loop::MakeRegularLoop(center, S1Angle::Degrees(0.5), 10 + i)));
+    index.Add(make_unique<S2Polyline::OwningShape>(make_unique<S2Polyline>(
+        S2Testing::MakeRegularPoints(center, S1Angle::Degrees(1), 5 + i))));
+  }
+  for (int num_threads : {1, 4}) {
+    EXPECT_EQ(S2::GetLength(index), S2::GetLength(index, num_threads));
+    EXPECT_EQ(S2::GetPerimeter(index), S2::GetPerimeter(index, num_threads));
+    EXPECT_EQ(S2::GetArea(index), S2::GetArea(index, num_threads));
+    EXPECT_EQ(S2::GetApproxArea(index), S2::GetApproxArea(index, num_threads));
+    EXPECT_EQ(S2::GetCentroid(index), S2::GetCentroid(index, num_threads));
+  }
+}
+
+TEST(MultiThreadedMeasures, LargeShapeIsDeterministic) {
+  // A polygon with enough edges that it is split across several ranges.
+  vector<vector<S2Point>> loops;
+  for (int i = 0; i < 100; ++i) {
+    S2Point center = S2LatLng::FromDegrees(i % 60, 3 * i).ToPoint();
+    loops.push_back(
+        S2Testing::MakeRegularPoints(center, S1Angle::Degrees(1), 300));
+  }
+  MutableS2ShapeIndex index;
+  index.Add(make_unique<S2LaxPolygonShape>(loops));
+
+  const double area = S2::GetArea(index, 1);
+  const S2Point centroid = S2::GetCentroid(index, 1);
+  EXPECT_NEAR(S2::GetArea(index), area, 1e-15);
+  EXPECT_TRUE(S2::ApproxEquals(S2::GetCentroid(index), centroid));
+  EXPECT_NEAR(S2::GetPerimeter(index).radians(),
+              S2::GetPerimeter(index, 1).radians(), 1e-13);
+  for (int num_threads : {2, 4, 8}) {
+    EXPECT_EQ(area, S2::GetArea(index, num_threads));
+    EXPECT_EQ(centroid, S2::GetCentroid(index, num_threads));
+  }
+}
+
 }  // namespace
@@ -36,6 +36,7 @@
 #include "s2/s2latlng_rect.h"
 #include "s2/s2point.h"
 #include "s2/s2region.h"
+#include "s2/s2region_coverer.h"
 #include "s2/s2shape.h"
 #include "s2/s2shape_index.h"
 
@@ -151,9 +152,66 @@ class S2ShapeIndexRegion final : public S2Region {
   // this method (if you need more flexibility, see S2BooleanOperation).
   bool Contains(const S2Point& p) const override;
 
+  // Computes a covering of the indexed geometry that satisfies the options
+  // of the given S2RegionCoverer.  Candidate cells are tested against the
+  // index cell structure (using a single S2ShapeIndex::Iterator::Locate()
+  // call each), and edges are clipped only when a candidate lies strictly
+  // inside an index cell with at most 10 edges.  Candidates inside denser
+  // index cells are assumed to intersect the geometry, which avoids the edge
+  // clipping that dominates coverer->GetCovering(*this) for such cells.
+  //
+  // The result matches the covering computed by GetCovering() except near
+  // dense index cells, where it may be larger by up to the area of those
+  // cells.  (Sparse index cells can be arbitrarily larger than the edges
+  // they contain, which is why they are always tested exactly.)
+  //
+  // REQUIRES: coverer->options().num_threads() == 1
+  void GetCovering(S2RegionCoverer* coverer,
+                   std::vector<S2CellId>* covering) const;
+
  private:
   using Iterator = typename IndexType::Iterator;
 
+  // The region used by GetCovering(S2RegionCoverer*, ...).  It answers
+  // Contains(S2Cell) and MayIntersect(S2Cell) using the iterator of the
+  // wrapped S2ShapeIndexRegion, and examines edges only within sparse index
+  // cells.
+  class IndexCellRegion final : public S2Region {
+   public:
+    explicit IndexCellRegion(const S2ShapeIndexRegion* region)
+        : region_(region) {}
+    IndexCellRegion* Clone() const override {
+      return new IndexCellRegion(region_);
+    }
+    S2Cap GetCapBound() const override { return region_->GetCapBound(); }
+    S2LatLngRect GetRectBound() const override {
+      return region_->GetRectBound();
+    }
+    void GetCellUnionBound(std::vector<S2CellId>* cell_ids) const override {
+      region_->GetCellUnionBound(cell_ids);
+    }
+    bool Contains(const S2Cell& target) const override;
+    bool MayIntersect(const S2Cell& target) const override;
+    bool Contains(const S2Point& p) const override {
+      return region_->iter_.Locate(p);
+    }
+
+   private:
+    // Index cells with at most this many edges are tested exactly when a
+    // candidate lies strictly inside them.  Such cells can be much larger
+    // than the edges they contain (e.g., a single long edge that crosses a
+    // face), and testing a few edges is cheap.  This matches the default
+    // MutableS2ShapeIndex::Options::max_edges_per_cell(), so that only cells
+    // that are denser than the index would normally allow are not tested.
+    static constexpr int kMaxEdgesForExactTest = 10;
+
+    // Returns true if the index cell that the iterator points to has at most
+    // kMaxEdgesForExactTest edges.
+    bool IsSparse(const S2ShapeIndexCell& cell) const;
+
+    const S2ShapeIndexRegion* region_;
+  };
+
   static void CoverRange(S2CellId first, S2CellId last,
                          std::vector<S2CellId> *cell_ids);
 
@@ -458,6 +516,70 @@ bool S2ShapeIndexRegion<IndexType>::AnyEdgeIntersects(
   return false;
 }
 
+template <class IndexType>
+void S2ShapeIndexRegion<IndexType>::GetCovering(
+    S2RegionCoverer* coverer, std::vector<S2CellId>* covering) const {
+  ABSL_DCHECK_EQ(coverer->options().num_threads(), 1);
+  coverer->GetCovering(IndexCellRegion(this), covering);
+}
+
+template <class IndexType>
+bool S2ShapeIndexRegion<IndexType>::IndexCellRegion::IsSparse(
+    const S2ShapeIndexCell& cell) const {
+  int num_edges = 0;
+  for (int s = 0; s < cell.num_clipped(); ++s) {
+    num_edges += cell.clipped(s).num_edges();
+    if (num_edges > kMaxEdgesForExactTest) return false;
+  }
+  return true;
+}
+
+template <class IndexType>
+bool S2ShapeIndexRegion<IndexType>::IndexCellRegion::Contains(
+    const S2Cell& target) const {
+  // "target" is contained if it lies within an index cell that is entirely
+  // contained by some polygon, i.e. a cell where the polygon has no edges
+  // and contains the cell center.  Within sparse index cells we also use the
+  // exact test of S2ShapeIndexRegion::Contains().
+  Iterator& iter = region_->iter_;
+  if (iter.Locate(target.id()) != S2CellRelation::INDEXED) return false;
+  const S2ShapeIndexCell& cell = iter.cell();
+  const bool exact = iter.id() != target.id() && IsSparse(cell);
+  for (int s = 0; s < cell.num_clipped(); ++s) {
+    const S2ClippedShape& clipped = cell.clipped(s);
+    if (clipped.num_edges() == 0 && clipped.contains_center()) return true;
+    if (exact &&
+        region_->index().shape(clipped.shape_id())->dimension() == 2 &&
+        !region_->AnyEdgeIntersects(clipped, target) &&
+        region_->Contains(clipped, target.GetCenter())) {
+      return true;
+    }
+  }
+  return false;
+}
+
+template <class IndexType>
+bool S2ShapeIndexRegion<IndexType>::IndexCellRegion::MayIntersect(
+    const S2Cell& target) const {
+  // Any candidate that overlaps an index cell is assumed to intersect the
+  // geometry, except for candidates that lie strictly inside a sparse index
+  // cell, which are tested exactly.
+  Iterator& iter = region_->iter_;
+  S2CellRelation relation = iter.Locate(target.id());
+  if (relation != S2CellRelation::INDEXED) {
+    return relation == S2CellRelation::SUBDIVIDED;
+  }
+  if (iter.id() == target.id()) return true;
+  const S2ShapeIndexCell& cell = iter.cell();
+  if (!IsSparse(cell)) return true;
+  for (int s = 0; s < cell.num_clipped(); ++s) {
+    const S2ClippedShape& clipped = cell.clipped(s);
+    if (region_->AnyEdgeIntersects(clipped, target)) return true;
+    if (region_->Contains(clipped, target.GetCenter())) return true;
+  }
+  return false;
+}
+
 template <class IndexType>
 inline S2ShapeIndexRegion<IndexType> MakeS2ShapeIndexRegion(
     const IndexType* index) {
@@ -35,6 +35,7 @@
 #include "s2/s2cap.h"
 #include "s2/s2cell.h"
 #include "s2/s2cell_id.h"
+#include "s2/s2cell_union.h"
 #include "s2/s2coords.h"
 #include "s2/s2edge_clipping.h"
 #include "s2/s2fractal.h"
@@ -46,14 +47,18 @@
 #include "s2/s2point.h"
 #include "s2/s2point_vector_shape.h"
 #include "s2/s2random.h"
+#include "s2/s2region_coverer.h"
 #include "s2/s2shape.h"
 #include "s2/s2shape_index.h"
 #include "s2/s2testing.h"
+#include "s2/s2text_format.h"
 #include "s2/s2wrapped_shape.h"
 
 using absl::flat_hash_map;
 using absl::string_view;
+using s2textformat::MakeIndexOrDie;
 using std::make_unique;
+using std::max;
 using std::string;
 using std::unique_ptr;
 using std::vector;
@@ -192,6 +197,72 @@ TEST(S2ShapeIndexRegion, IntersectsExactCell) {
   }
 }
 
+TEST(S2ShapeIndexRegion, GetCoveringFromIndexCells) {
+  absl::BitGen bitgen(S2Testing::MakeTaggedSeedSeq(
+      "GET_COVERING_FROM_INDEX_CELLS",
+      absl::LogInfoStreamer(__FILE__, __LINE__).stream()));
+  MutableS2ShapeIndex index;
+  S2Cap center_cap(S2Point(1, 0, 0), S1Angle::Radians(0.5));
+  S2Fractal fractal(bitgen);
+  fractal.SetLevelForApproxMaxEdges(3 * 64);
+  for (int i = 0; i < 5; ++i) {
+    S2Point center = s2random::SamplePoint(bitgen, center_cap);
+    index.Add(make_unique<S2Loop::OwningShape>(
+        fractal.MakeLoop(s2random::FrameAt(bitgen, center),
+                         S1Angle::Radians(absl::Uniform(bitgen, 0.0, 0.5)))));
+  }
+  index.Add(make_unique<S2PointVectorShape>(
+      vector<S2Point>{S2Point(0, 0, 1), S2Point(0, -1, 0)}));
+  auto region = MakeS2ShapeIndexRegion(&index);
+
+  for (int max_cells : {1, 4, 8, 20, 100}) {
+    S2RegionCoverer coverer;
+    coverer.mutable_options()->set_max_cells(max_cells);
+    vector<S2CellId> covering;
+    region.GetCovering(&coverer, &covering);
+    EXPECT_TRUE(coverer.IsCanonical(covering));
+    EXPECT_LE(covering.size(), max(max_cells, 6));
+
+    // The covering must contain every vertex and every index cell that is
+    // entirely inside a polygon.
+    S2CellUnion cell_union(std::move(covering));
+    for (const S2Shape* shape : index) {
+      for (int e = 0; e < shape->num_edges(); ++e) {
+        EXPECT_TRUE(cell_union.Contains(shape->edge(e).v0));
+      }
+    }
+    for (MutableS2ShapeIndex::Iterator it(&index, S2ShapeIndex::BEGIN);
+         !it.done(); it.Next()) {
+      for (int s = 0; s < it.cell().num_clipped(); ++s) {
+        const S2ClippedShape& clipped = it.cell().clipped(s);
+        if (clipped.num_edges() == 0 && clipped.contains_center()) {
+          EXPECT_TRUE(cell_union.Contains(it.id()));
+        }
+      }
+    }
+
+    // The covering should not be much larger than the exact covering.
+    S2CellUnion exact = coverer.GetCovering(region);
+    EXPECT_LE(cell_union.ExactArea(), 1.5 * exact.ExactArea()) << max_cells;
+  }
+}
+
+// Index cells that contain only a few long edges span far more area than the
+// edges themselves.  Check that the covering still follows the edges.
+TEST(S2ShapeIndexRegion, GetCoveringFromSparseIndexCells) {
+  auto index = MakeIndexOrDie("# -40:-40, 40:40 #");
+  auto region = MakeS2ShapeIndexRegion(index.get());
+  for (int max_cells : {8, 100}) {
+    S2RegionCoverer coverer;
+    coverer.mutable_options()->set_max_cells(max_cells);
+    vector<S2CellId> covering;
+    region.GetCovering(&coverer, &covering);
+    S2CellUnion exact = coverer.GetCovering(region);
+    EXPECT_LE(S2CellUnion(std::move(covering)).ExactArea(),
+              1.5 * exact.ExactArea());
+  }
+}
+
 // Tests that VisitIntersectingShapes() produces results that are consistent
 // with MayIntersect() and Contains() for the given S2ShapeIndex.  It tests
 // all cells in the given index, all ancestors of those cells, and a randomly
@@ -0,0 +1,185 @@
+// Copyright 2024 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "s2/s2shape_index_snapshot.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <future>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "absl/log/absl_check.h"
+#include "s2/util/coding/coder.h"
+#include "s2/util/coding/varint.h"
+#include "s2/encoded_s2cell_id_vector.h"
+#include "s2/encoded_string_vector.h"
+#include "s2/mutable_s2shape_index.h"
+#include "s2/s2cell_id.h"
+#include "s2/s2shape.h"
+#include "s2/s2shape_index.h"
+#include "s2/s2wrapped_shape.h"
+
+using std::make_unique;
+using std::shared_ptr;
+using std::vector;
+
+// The encoding version written by MutableS2ShapeIndex::Encode().
+static constexpr unsigned char kEncodingVersionNumber = 0;
+
+void S2ShapeIndexSnapshot::Iterator::Seek(S2CellId target) {
+  const vector<S2CellId>& ids = index_->cell_ids_;
+  cell_pos_ = std::lower_bound(ids.begin(), ids.end(), target) - ids.begin();
+}
+
+void S2ShapeIndexSnapshot::Encode(Encoder* encoder) const {
+  encoder->Ensure(Varint::kMax64);
+  uint64_t max_edges = max_edges_per_cell_;
+  encoder->put_varint64(max_edges << 2 | kEncodingVersionNumber);
+
+  s2coding::StringVectorEncoder encoded_cells;
+  for (const auto& cell : cells_) {
+    cell->Encode(num_shape_ids(), encoded_cells.AddViaEncoder());
+  }
+  s2coding::EncodeS2CellIdVector(cell_ids_, encoder);
+  encoded_cells.Encode(encoder);
+}
+
+size_t S2ShapeIndexSnapshot::SpaceUsed() const {
+  size_t size = sizeof(*this);
+  size += shapes_.capacity() * sizeof(shared_ptr<const S2Shape>);
+  size += cell_ids_.capacity() * sizeof(S2CellId);
+  size += cells_.capacity() * sizeof(shared_ptr<const S2ShapeIndexCell>);
+  size += cells_.size() * sizeof(S2ShapeIndexCell);
+  for (const auto& cell : cells_) {
+    size += cell->shapes_.capacity() * sizeof(S2ClippedShape);
+    for (const S2ClippedShape& clipped : cell->clipped_shapes()) {
+      if (!clipped.is_inline()) {
+        size += clipped.num_edges() * sizeof(int32_t);
+      }
+    }
+  }
+  return size;
+}
+
+S2ShapeIndexPublisher::S2ShapeIndexPublisher()
+    : S2ShapeIndexPublisher(Options()) {}
+
+S2ShapeIndexPublisher::S2ShapeIndexPublisher(const Options& options)
+    : index_(options) {
+  auto empty = shared_ptr<S2ShapeIndexSnapshot>(new S2ShapeIndexSnapshot);
+  empty->max_edges_per_cell_ = options.max_edges_per_cell();
+  snapshot_ = std::move(empty);
+}
+
+int S2ShapeIndexPublisher::Add(shared_ptr<const S2Shape> shape) {
+  int id = index_.Add(make_unique<S2WrappedShape>(shape.get()));
+  ABSL_DCHECK_EQ(id, shapes_.size());
+  shapes_.push_back(std::move(shape));
+  return id;
+}
+
+shared_ptr<const S2Shape> S2ShapeIndexPublisher::Release(int shape_id) {
+  ABSL_DCHECK(shapes_[shape_id] != nullptr);
+  index_.Release(shape_id);  // Discards the wrapper.
+  return std::move(shapes_[shape_id]);
+}
+
+shared_ptr<const S2ShapeIndexSnapshot>
+S2ShapeIndexPublisher::snapshot() const {
+  return std::atomic_load(&snapshot_);
+}
+
+// Returns true if the two cells contain the same clipped shapes.  Cells are
+// compared by value rather than by address, since MutableS2ShapeIndex may
+// reuse the memory of a deleted cell for a different cell.
+static bool CellsEqual(const S2ShapeIndexCell& a, const S2ShapeIndexCell& b) {
+  if (a.num_clipped() != b.num_clipped()) return false;
+  for (int i = 0; i < a.num_clipped(); ++i) {
+    const S2ClippedShape& a_clipped = a.clipped(i);
+    const S2ClippedShape& b_clipped = b.clipped(i);
+    if (a_clipped.shape_id() != b_clipped.shape_id() ||
+        a_clipped.contains_center() != b_clipped.contains_center() ||
+        a_clipped.num_edges() != b_clipped.num_edges()) {
+      return false;
+    }
+    for (int j = 0; j < a_clipped.num_edges(); ++j) {
+      if (a_clipped.edge(j) != b_clipped.edge(j)) return false;
+    }
+  }
+  return true;
+}
+
+shared_ptr<const S2ShapeIndexCell> S2ShapeIndexPublisher::CopyCell(
+    const S2ShapeIndexCell& cell) {
+  auto copy = std::make_shared<S2ShapeIndexCell>();
+  S2ClippedShape* clipped = copy->add_shapes(cell.num_clipped());
+  for (const S2ClippedShape& original : cell.clipped_shapes()) {
+    clipped->Init(original.shape_id(), original.num_edges());
+    clipped->set_contains_center(original.contains_center());
+    for (int j = 0; j < original.num_edges(); ++j) {
+      clipped->set_edge(j, original.edge(j));
+    }
+    ++clipped;
+  }
+  return copy;
+}
+
+void S2ShapeIndexPublisher::Publish() {
+  index_.ForceBuild();
+
+  // Only the writer ever modifies snapshot_, so no atomic load is needed.
+  const S2ShapeIndexSnapshot& prev = *snapshot_;
+  auto next = shared_ptr<S2ShapeIndexSnapshot>(new S2ShapeIndexSnapshot);
+  next->max_edges_per_cell_ = index_.options().max_edges_per_cell();
+  next->shapes_ = shapes_;
+  next->cell_ids_.reserve(prev.num_cells());
+  next->cells_.reserve(prev.num_cells());
+
+  // Walk through the index and the previous snapshot in parallel (both are
+  // sorted by S2CellId), sharing every cell whose contents are unchanged.
+  int prev_pos = 0;
+  for (MutableS2ShapeIndex::Iterator it(&index_, S2ShapeIndex::BEGIN);
+       !it.done(); it.Next()) {
+    S2CellId id = it.id();
+    while (prev_pos < prev.num_cells() && prev.cell_ids_[prev_pos] < id) {
+      ++prev_pos;
+    }
+    next->cell_ids_.push_back(id);
+    if (prev_pos < prev.num_cells() && prev.cell_ids_[prev_pos] == id &&
+        CellsEqual(*prev.cells_[prev_pos], it.cell())) {
+      next->cells_.push_back(prev.cells_[prev_pos]);
+      ++next->num_shared_cells_;
+    } else {
+      next->cells_.push_back(CopyCell(it.cell()));
+    }
+  }
+  std::atomic_store(&snapshot_,
+                    shared_ptr<const S2ShapeIndexSnapshot>(std::move(next)));
+}
+
+std::future<void> S2ShapeIndexPublisher::PublishAsync(
+    const MutableS2ShapeIndex::Executor& executor) {
+  auto done = std::make_shared<std::promise<void>>();
+  std::future<void> future = done->get_future();
+  executor([this, done]() {
+    Publish();
+    done->set_value();
+  });
+  return future;
+}
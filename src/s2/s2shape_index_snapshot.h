@@ -0,0 +1,278 @@
+// Copyright 2024 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef S2_S2SHAPE_INDEX_SNAPSHOT_H_
+#define S2_S2SHAPE_INDEX_SNAPSHOT_H_
+
+#include <cstddef>
+#include <future>
+#include <memory>
+#include <vector>
+
+#include "absl/log/absl_check.h"
+#include "s2/util/coding/coder.h"
+#include "s2/mutable_s2shape_index.h"
+#include "s2/s2cell_id.h"
+#include "s2/s2point.h"
+#include "s2/s2shape.h"
+#include "s2/s2shape_index.h"
+
+// S2ShapeIndexSnapshot is an immutable S2ShapeIndex that captures the state
+// of an S2ShapeIndexPublisher (see below) at the time it was published.
+// Since a snapshot never changes, any number of threads may query it
+// concurrently without any locking, and a snapshot remains valid (and keeps
+// its shapes and cells alive) for as long as some reader holds a reference
+// to it, even after newer snapshots have been published.
+//
+// Snapshots are copy-on-write at the granularity of index cells: cells that
+// are unchanged since the previous snapshot are shared with it rather than
+// copied, so that the memory needed for each new snapshot is proportional to
+// the part of the index that was modified.
+class S2ShapeIndexSnapshot final : public S2ShapeIndex {
+ public:
+  // The number of distinct shape ids in the snapshot.  This includes shapes
+  // that have been released (for which shape(id) returns nullptr).
+  int num_shape_ids() const override { return shapes_.size(); }
+
+  // Returns a pointer to the shape with the given id, or nullptr if the shape
+  // had been released when the snapshot was published.
+  const S2Shape* shape(int id) const override { return shapes_[id].get(); }
+
+  // Returns the number of index cells in the snapshot.
+  int num_cells() const { return cell_ids_.size(); }
+
+  // Returns the number of index cells that are shared with the snapshot that
+  // was published immediately before this one.
+  int num_shared_cells() const { return num_shared_cells_; }
+
+  // Appends an encoded representation of the snapshot to "encoder".  The
+  // format is the same as MutableS2ShapeIndex::Encode(), so the result can be
+  // decoded using either MutableS2ShapeIndex or EncodedS2ShapeIndex.  As with
+  // MutableS2ShapeIndex, the shapes themselves are not encoded.
+  void Encode(Encoder* encoder) const override;
+
+  // Returns the number of bytes occupied by the snapshot, counting cells
+  // that are shared with other snapshots in full.  Shapes are not included.
+  size_t SpaceUsed() const override;
+
+  // Snapshots are immutable, so this method does nothing.
+  void Minimize() override {}
+
+  class Iterator final : public IteratorBase {
+   public:
+    // Default constructor; must be followed by a call to Init().
+    Iterator() = default;
+
+    // Constructs an iterator positioned as specified.  By default iterators
+    // are unpositioned, since this avoids an extra seek in this situation
+    // where one of the seek methods (such as Locate) is immediately called.
+    explicit Iterator(const S2ShapeIndexSnapshot* index,
+                      InitialPosition pos = UNPOSITIONED);
+
+    // Initializes an iterator for the given S2ShapeIndexSnapshot.
+    void Init(const S2ShapeIndexSnapshot* index,
+              InitialPosition pos = UNPOSITIONED);
+
+    S2CellId id() const override;
+    bool done() const override;
+    const S2ShapeIndexCell& cell() const override;
+
+    // S2CellIterator API:
+    void Begin() override;
+    void Finish() override;
+    void Next() override;
+    bool Prev() override;
+    void Seek(S2CellId target) override;
+
+    bool Locate(const S2Point& target) override {
+      return LocateImpl(*this, target);
+    }
+
+    S2CellRelation Locate(S2CellId target) override {
+      return LocateImpl(*this, target);
+    }
+
+    std::unique_ptr<IteratorBase> Clone() const override {
+      return std::make_unique<Iterator>(*this);
+    }
+
+   private:
+    const S2ShapeIndexSnapshot* index_ = nullptr;
+    int cell_pos_ = 0;  // Current position in the vector of index cells.
+  };
+
+ protected:
+  std::unique_ptr<IteratorBase> NewIterator(InitialPosition pos) const override;
+
+ private:
+  friend class S2ShapeIndexPublisher;
+
+  S2ShapeIndexSnapshot() = default;
+
+  int max_edges_per_cell_ = 0;
+  int num_shared_cells_ = 0;
+
+  // Indexed by shape id; released shapes are represented as nullptr.
+  std::vector<std::shared_ptr<const S2Shape>> shapes_;
+
+  // The index cells, sorted by S2CellId.  Cells are shared between snapshots
+  // whenever their contents are unchanged.
+  std::vector<S2CellId> cell_ids_;
+  std::vector<std::shared_ptr<const S2ShapeIndexCell>> cells_;
+
+  S2ShapeIndexSnapshot(const S2ShapeIndexSnapshot&) = delete;
+  void operator=(const S2ShapeIndexSnapshot&) = delete;
+};
+
+// S2ShapeIndexPublisher maintains a MutableS2ShapeIndex on behalf of a single
+// writer thread and publishes immutable snapshots of it for any number of
+// reader threads.  This allows readers to keep querying the most recently
+// published state of the index without blocking while the writer adds and
+// removes shapes and rebuilds the index, which is useful for services where
+// the indexed geometry is updated continuously.
+//
+// Example usage:
+//
+//   S2ShapeIndexPublisher publisher;
+//
+//   // Writer thread:
+//   publisher.Add(std::make_shared<S2Polygon::OwningShape>(...));
+//   publisher.Release(old_shape_id);
+//   publisher.Publish();
+//
+//   // Reader threads:
+//   std::shared_ptr<const S2ShapeIndexSnapshot> index = publisher.snapshot();
+//   auto query = MakeS2ContainsPointQuery(index.get());
+//   ... query.Contains(point) ...
+//
+// Thread safety: snapshot() may be called from any thread at any time.  All
+// other methods must be called from a single thread at a time (the writer).
+//
+// Publish() takes time proportional to the total number of index cells,
+// since each cell is compared against the previous snapshot, but only the
+// cells that actually changed are copied.
+class S2ShapeIndexPublisher {
+ public:
+  using Options = MutableS2ShapeIndex::Options;
+
+  S2ShapeIndexPublisher();
+  explicit S2ShapeIndexPublisher(const Options& options);
+
+  // Adds the given shape and returns its shape id.  The shape is not visible
+  // to readers until the next call to Publish().  Shape ids are assigned
+  // exactly as in MutableS2ShapeIndex::Add().
+  int Add(std::shared_ptr<const S2Shape> shape);
+
+  // Removes the given shape and returns it.  Snapshots published earlier
+  // continue to reference the shape for as long as they exist.
+  //
+  // REQUIRES: 0 <= shape_id < num_shape_ids()
+  // REQUIRES: The shape has not been released already.
+  std::shared_ptr<const S2Shape> Release(int shape_id);
+
+  // The number of shape ids assigned so far (including released shapes).
+  int num_shape_ids() const { return shapes_.size(); }
+
+  // Applies all pending updates and makes the resulting index visible to
+  // readers via snapshot().
+  void Publish();
+
+  // Like Publish(), except that the work is done by a task passed to
+  // "executor".  Readers continue to receive the previous snapshot until the
+  // returned future is ready.
+  //
+  // REQUIRES: No other non-const methods are called, and the publisher is
+  //           not destroyed, until the returned future is ready.
+  std::future<void> PublishAsync(const MutableS2ShapeIndex::Executor& executor);
+
+  // Returns the most recently published snapshot.  Before the first call to
+  // Publish() this is an empty index.  Thread-safe.
+  std::shared_ptr<const S2ShapeIndexSnapshot> snapshot() const;
+
+ private:
+  // Returns a copy of the given cell that is owned by a shared_ptr.
+  static std::shared_ptr<const S2ShapeIndexCell> CopyCell(
+      const S2ShapeIndexCell& cell);
+
+  MutableS2ShapeIndex index_;
+
+  // The shapes owned by the publisher, indexed by shape id.  The shapes in
+  // index_ are wrappers that refer to these shapes.
+  std::vector<std::shared_ptr<const S2Shape>> shapes_;
+
+  // Always accessed using std::atomic_load() and std::atomic_store().
+  std::shared_ptr<const S2ShapeIndexSnapshot> snapshot_;
+
+  S2ShapeIndexPublisher(const S2ShapeIndexPublisher&) = delete;
+  void operator=(const S2ShapeIndexPublisher&) = delete;
+};
+
+
+//////////////////   Implementation details follow   ////////////////////
+
+inline S2ShapeIndexSnapshot::Iterator::Iterator(
+    const S2ShapeIndexSnapshot* index, InitialPosition pos) {
+  Init(index, pos);
+}
+
+inline void S2ShapeIndexSnapshot::Iterator::Init(
+    const S2ShapeIndexSnapshot* index, InitialPosition pos) {
+  index_ = index;
+  cell_pos_ = (pos == BEGIN) ? 0 : index->num_cells();
+}
+
+inline S2CellId S2ShapeIndexSnapshot::Iterator::id() const {
+  if (done()) {
+    return S2CellId::Sentinel();
+  }
+  return index_->cell_ids_[cell_pos_];
+}
+
+inline bool S2ShapeIndexSnapshot::Iterator::done() const {
+  return cell_pos_ == index_->num_cells();
+}
+
+inline const S2ShapeIndexCell& S2ShapeIndexSnapshot::Iterator::cell() const {
+  ABSL_DCHECK(!done());
+  return *index_->cells_[cell_pos_];
+}
+
+inline void S2ShapeIndexSnapshot::Iterator::Begin() {
+  cell_pos_ = 0;
+}
+
+inline void S2ShapeIndexSnapshot::Iterator::Finish() {
+  cell_pos_ = index_->num_cells();
+}
+
+inline void S2ShapeIndexSnapshot::Iterator::Next() {
+  ABSL_DCHECK(!done());
+  ++cell_pos_;
+}
+
+inline bool S2ShapeIndexSnapshot::Iterator::Prev() {
+  if (cell_pos_ == 0) {
+    return false;
+  }
+  --cell_pos_;
+  return true;
+}
+
+inline std::unique_ptr<S2ShapeIndex::IteratorBase>
+S2ShapeIndexSnapshot::NewIterator(InitialPosition pos) const {
+  return std::make_unique<Iterator>(this, pos);
+}
+
+#endif  // S2_S2SHAPE_INDEX_SNAPSHOT_H_
@@ -0,0 +1,241 @@
+// Copyright 2024 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "s2/s2shape_index_snapshot.h"
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include "s2/util/coding/coder.h"
+#include "s2/encoded_s2shape_index.h"
+#include "s2/mutable_s2shape_index.h"
+#include "s2/s2contains_point_query.h"
+#include "s2/s2fractal.h"
+#include "s2/s2latlng.h"
+#include "s2/s2loop.h"
+#include "s2/s2point.h"
+#include "s2/s2random.h"
+#include "s2/s2shape.h"
+#include "s2/s2shape_index.h"
+#include "s2/s2shapeutil_coding.h"
+#include "s2/s2shapeutil_testing.h"
+#include "s2/s2testing.h"
+#include "s2/s2text_format.h"
+#include "s2/s2wrapped_shape.h"
+
+using std::make_unique;
+using std::shared_ptr;
+using std::string;
+using std::vector;
+
+namespace {
+
+// Returns a fractal loop with roughly "num_edges" edges centered at "center".
+shared_ptr<const S2Shape> MakeFractalShape(std::mt19937_64& bitgen,
+                                           const S2Point& center,
+                                           int num_edges) {
+  S2Fractal fractal(bitgen);
+  fractal.SetLevelForApproxMaxEdges(num_edges);
+  return std::make_shared<S2Loop::OwningShape>(fractal.MakeLoop(
+      s2random::FrameAt(bitgen, center), S2Testing::KmToAngle(10)));
+}
+
+S2Point PointFromLatLngDegrees(double lat, double lng) {
+  return S2LatLng::FromDegrees(lat, lng).ToPoint();
+}
+
+string EncodeIndex(const S2ShapeIndex& index) {
+  Encoder encoder;
+  index.Encode(&encoder);
+  return string(encoder.base(), encoder.length());
+}
+
+// Builds a MutableS2ShapeIndex containing the same shapes as "publisher",
+// which is used as the expected value of its snapshots.
+class S2ShapeIndexSnapshotTest : public ::testing::Test {
+ protected:
+  int Add(shared_ptr<const S2Shape> shape) {
+    int id = expected_.Add(make_unique<S2WrappedShape>(shape.get()));
+    EXPECT_EQ(id, publisher_.Add(std::move(shape)));
+    return id;
+  }
+
+  void Release(int shape_id) {
+    expected_.Release(shape_id);
+    publisher_.Release(shape_id);
+  }
+
+  void PublishAndCheck() {
+    publisher_.Publish();
+    s2testing::ExpectEqual(expected_, *publisher_.snapshot());
+  }
+
+  std::mt19937_64 bitgen_;
+  S2ShapeIndexPublisher publisher_;
+  MutableS2ShapeIndex expected_;
+};
+
+TEST_F(S2ShapeIndexSnapshotTest, EmptyBeforePublish) {
+  auto snapshot = publisher_.snapshot();
+  ASSERT_NE(snapshot, nullptr);
+  EXPECT_EQ(snapshot->num_shape_ids(), 0);
+  EXPECT_EQ(snapshot->num_cells(), 0);
+  Add(s2textformat::MakeLaxPolygonOrDie("0:0, 0:1, 1:0"));
+  EXPECT_EQ(publisher_.snapshot()->num_shape_ids(), 0);
+  PublishAndCheck();
+}
+
+TEST_F(S2ShapeIndexSnapshotTest, MatchesMutableIndexAfterUpdates) {
+  int a = Add(MakeFractalShape(bitgen_, PointFromLatLngDegrees(0, 0), 1000));
+  Add(MakeFractalShape(bitgen_, PointFromLatLngDegrees(40, 40), 1000));
+  PublishAndCheck();
+  Add(s2textformat::MakeLaxPolylineOrDie("0:0, 0:1, 1:1"));
+  PublishAndCheck();
+  Release(a);
+  PublishAndCheck();
+  Add(MakeFractalShape(bitgen_, PointFromLatLngDegrees(0, 0), 100));
+  PublishAndCheck();
+}
+
+TEST_F(S2ShapeIndexSnapshotTest, UnchangedCellsAreShared) {
+  Add(MakeFractalShape(bitgen_, PointFromLatLngDegrees(0, 0), 1000));
+  Add(MakeFractalShape(bitgen_, PointFromLatLngDegrees(-40, 100), 1000));
+  PublishAndCheck();
+  auto before = publisher_.snapshot();
+
+  // Nothing has changed, so every cell should be shared.
+  PublishAndCheck();
+  EXPECT_EQ(publisher_.snapshot()->num_shared_cells(), before->num_cells());
+
+  // Adding a shape near the first fractal should not affect the cells
+  // covering the second one.
+  Add(MakeFractalShape(bitgen_, PointFromLatLngDegrees(0.1, 0.1), 100));
+  PublishAndCheck();
+  auto after = publisher_.snapshot();
+  EXPECT_GT(after->num_shared_cells(), 0);
+  EXPECT_LT(after->num_shared_cells(), after->num_cells());
+
+  S2ShapeIndexSnapshot::Iterator before_it(before.get(), S2ShapeIndex::BEGIN);
+  S2ShapeIndexSnapshot::Iterator after_it(after.get(), S2ShapeIndex::BEGIN);
+  int num_same_address = 0;
+  for (; !after_it.done(); after_it.Next()) {
+    if (before_it.Locate(after_it.id()) == S2CellRelation::INDEXED &&
+        before_it.id() == after_it.id() &&
+        &before_it.cell() == &after_it.cell()) {
+      ++num_same_address;
+    }
+  }
+  EXPECT_EQ(num_same_address, after->num_shared_cells());
+}
+
+TEST_F(S2ShapeIndexSnapshotTest, OldSnapshotsAreUnaffectedByUpdates) {
+  int a = Add(MakeFractalShape(bitgen_, PointFromLatLngDegrees(0, 0), 1000));
+  PublishAndCheck();
+  auto old_snapshot = publisher_.snapshot();
+  const string old_encoding = EncodeIndex(*old_snapshot);
+
+  Release(a);
+  Add(MakeFractalShape(bitgen_, PointFromLatLngDegrees(0, 0), 100));
+  PublishAndCheck();
+
+  // The old snapshot still owns the released shape.
+  EXPECT_EQ(EncodeIndex(*old_snapshot), old_encoding);
+  ASSERT_NE(old_snapshot->shape(a), nullptr);
+  EXPECT_EQ(publisher_.snapshot()->shape(a), nullptr);
+  EXPECT_EQ(old_snapshot->num_shape_ids(), 1);
+  EXPECT_EQ(publisher_.snapshot()->num_shape_ids(), 2);
+  auto query = MakeS2ContainsPointQuery(old_snapshot.get());
+  EXPECT_TRUE(query.Contains(PointFromLatLngDegrees(0, 0)));
+}
+
+TEST_F(S2ShapeIndexSnapshotTest, EncodingMatchesMutableIndex) {
+  Add(MakeFractalShape(bitgen_, PointFromLatLngDegrees(10, 10), 1000));
+  Add(s2textformat::MakeLaxPolylineOrDie("10:10, 11:11"));
+  PublishAndCheck();
+  auto snapshot = publisher_.snapshot();
+  const string encoded = EncodeIndex(*snapshot);
+  EXPECT_EQ(encoded, EncodeIndex(expected_));
+
+  Decoder decoder(encoded.data(), encoded.size());
+  EncodedS2ShapeIndex decoded;
+  ASSERT_TRUE(decoded.Init(&decoder,
+                           s2shapeutil::WrappedShapeFactory(snapshot.get())));
+  s2testing::ExpectEqual(*snapshot, decoded);
+}
+
+TEST_F(S2ShapeIndexSnapshotTest, PublishAsyncServesPreviousSnapshot) {
+  Add(MakeFractalShape(bitgen_, PointFromLatLngDegrees(0, 0), 100));
+  PublishAndCheck();
+  auto before = publisher_.snapshot();
+
+  Add(MakeFractalShape(bitgen_, PointFromLatLngDegrees(20, 20), 1000));
+  std::function<void()> pending;
+  auto future = publisher_.PublishAsync(
+      [&pending](std::function<void()> task) { pending = std::move(task); });
+
+  // The task has not run yet, so readers still see the old snapshot.
+  EXPECT_EQ(publisher_.snapshot(), before);
+  std::thread thread(std::move(pending));
+  future.wait();
+  thread.join();
+  EXPECT_EQ(publisher_.snapshot()->num_shape_ids(), 2);
+  s2testing::ExpectEqual(expected_, *publisher_.snapshot());
+}
+
+// Readers query whatever snapshot is current while the writer keeps adding
+// shapes.  Each snapshot must be internally consistent: the shapes it
+// contains are exactly the first num_shape_ids() shapes added.
+TEST(S2ShapeIndexPublisher, ConcurrentReadersDuringUpdates) {
+  constexpr int kNumReaders = 4;
+  constexpr int kNumShapes = 20;
+  std::mt19937_64 bitgen;
+  vector<S2Point> centers;
+  vector<shared_ptr<const S2Shape>> shapes;
+  for (int i = 0; i < kNumShapes; ++i) {
+    centers.push_back(PointFromLatLngDegrees(3 * i, 0));
+    shapes.push_back(MakeFractalShape(bitgen, centers.back(), 300));
+  }
+
+  S2ShapeIndexPublisher publisher;
+  std::atomic<bool> done(false);
+  vector<std::thread> readers;
+  for (int r = 0; r < kNumReaders; ++r) {
+    readers.emplace_back([&]() {
+      do {
+        auto snapshot = publisher.snapshot();
+        auto query = MakeS2ContainsPointQuery(snapshot.get());
+        for (int i = 0; i < kNumShapes; ++i) {
+          EXPECT_EQ(query.Contains(centers[i]),
+                    i < snapshot->num_shape_ids());
+        }
+      } while (!done.load(std::memory_order_acquire));
+    });
+  }
+  for (const auto& shape : shapes) {
+    publisher.Add(shape);
+    publisher.Publish();
+  }
+  done.store(true, std::memory_order_release);
+  for (auto& reader : readers) reader.join();
+  EXPECT_EQ(publisher.snapshot()->num_shape_ids(), kNumShapes);
+}
+
+}  // namespace
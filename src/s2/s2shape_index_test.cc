@@ -17,8 +17,16 @@
 
 #include "s2/s2shape_index.h"
 
+#include <algorithm>
+#include <memory>
+#include <vector>
+
 #include <gtest/gtest.h>
+#include "s2/mutable_s2shape_index.h"
+#include "s2/s2loop.h"
+#include "s2/s2polygon.h"
 #include "s2/s2shape.h"
+#include "s2/s2testing.h"
 #include "s2/s2text_format.h"
 
 // TODO(ericv): Add tests for S2ShapeIndexCell and S2ClippedShape.
@@ -46,3 +54,44 @@ TEST(S2ShapeIndexIterator, PostfixIncrement) {
   }
   EXPECT_EQ(count, 3);
 }
+
+TEST(S2ClippedShape, VisitEdges) {
+  // Index a polygon with many loops so that its clipped shapes contain runs
+  // of consecutive edges that span several loops, as well as isolated edges.
+  S2Polygon polygon;
+  S2Testing::ConcentricLoopsPolygon(S2Point(1, 0, 0), 20, 50, &polygon);
+  MutableS2ShapeIndex::Options options;
+  options.set_max_edges_per_cell(100);
+  MutableS2ShapeIndex index(options);
+  index.Add(std::make_unique<S2Polygon::Shape>(&polygon));
+  index.ForceBuild();
+  const S2Shape& shape = *index.shape(0);
+  int num_visited = 0;
+  for (MutableS2ShapeIndex::Iterator it(&index, S2ShapeIndex::BEGIN);
+       !it.done(); it.Next()) {
+    for (const S2ClippedShape& clipped : it.cell().clipped_shapes()) {
+      std::vector<int> edge_ids;
+      EXPECT_TRUE(clipped.VisitEdges(
+          shape, [&](int edge_id, const S2Shape::Edge& edge) {
+            EXPECT_EQ(edge, shape.edge(edge_id));
+            edge_ids.push_back(edge_id);
+            return true;
+          }));
+      ASSERT_EQ(edge_ids.size(), clipped.num_edges());
+      for (int i = 0; i < clipped.num_edges(); ++i) {
+        EXPECT_EQ(edge_ids[i], clipped.edge(i));
+      }
+      num_visited += clipped.num_edges();
+
+      // Stop after the second edge.
+      int count = 0;
+      EXPECT_EQ(clipped.VisitEdges(shape,
+                                   [&](int, const S2Shape::Edge&) {
+                                     return ++count < 2;
+                                   }),
+                clipped.num_edges() < 2);
+      EXPECT_EQ(count, std::min(2, clipped.num_edges()));
+    }
+  }
+  EXPECT_GE(num_visited, shape.num_edges());
+}
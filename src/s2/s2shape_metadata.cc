@@ -0,0 +1,120 @@
+// Copyright 2024 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "s2/s2shape_metadata.h"
+
+#include <cmath>
+
+#include "absl/log/absl_check.h"
+#include "s2/r1interval.h"
+#include "s2/s1interval.h"
+#include "s2/s2latlng_rect.h"
+#include "s2/s2latlng_rect_bounder.h"
+#include "s2/s2point.h"
+#include "s2/s2shape.h"
+#include "s2/s2shape_measures.h"
+#include "s2/s2shapeutil_contains_brute_force.h"
+#include "s2/util/coding/coder.h"
+
+// Returns a bounding rectangle for "shape", given its reference point.
+static S2LatLngRect GetShapeBound(const S2Shape& shape,
+                                  const S2Shape::ReferencePoint& ref_point) {
+  if (shape.num_edges() == 0) {
+    // Only shapes of dimension 2 can be full.
+    return (shape.dimension() == 2 && ref_point.contained)
+               ? S2LatLngRect::Full()
+               : S2LatLngRect::Empty();
+  }
+  S2LatLngRect bound = S2LatLngRect::Empty();
+  for (int i = 0; i < shape.num_chains(); ++i) {
+    S2Shape::Chain chain = shape.chain(i);
+    if (chain.length == 0) continue;
+    S2LatLngRectBounder bounder;
+    bounder.AddPoint(shape.chain_edge(i, 0).v0);
+    for (int j = 0; j < chain.length; ++j) {
+      bounder.AddPoint(shape.chain_edge(i, j).v1);
+    }
+    bound = bound.Union(bounder.GetBound());
+  }
+  if (shape.dimension() == 2) {
+    // As in S2Loop, the edge bounds may need to be extended to include the
+    // interior near the poles.
+    if (s2shapeutil::ContainsBruteForce(shape, ref_point,
+                                        S2Point(0, 0, 1))) {
+      bound = S2LatLngRect(R1Interval(bound.lat().lo(), M_PI_2),
+                           S1Interval::Full());
+    }
+    if (s2shapeutil::ContainsBruteForce(shape, ref_point,
+                                        S2Point(0, 0, -1))) {
+      bound = S2LatLngRect(R1Interval(-M_PI_2, bound.lat().hi()),
+                           S1Interval::Full());
+    }
+  }
+  return bound;
+}
+
+S2LatLngRect S2ShapeMetadata::GetRectBound(const S2Shape& shape) {
+  return GetShapeBound(shape, shape.GetReferencePoint());
+}
+
+S2ShapeMetadata S2ShapeMetadata::Compute(const S2Shape& shape) {
+  S2ShapeMetadata metadata;
+  metadata.dimension = shape.dimension();
+  metadata.reference_point = shape.GetReferencePoint();
+  metadata.bound = GetShapeBound(shape, metadata.reference_point);
+  metadata.area = S2::GetArea(shape);
+  metadata.centroid = S2::GetCentroid(shape);
+  return metadata;
+}
+
+void S2ShapeMetadata::Encode(Encoder* encoder) const {
+  encoder->Ensure(kEncodedSize);
+  // The low two bits hold the dimension.
+  encoder->put8(dimension | (reference_point.contained ? 4 : 0));
+  const S2Point& p = reference_point.point;
+  encoder->putdouble(p.x());
+  encoder->putdouble(p.y());
+  encoder->putdouble(p.z());
+  encoder->putdouble(bound.lat().lo());
+  encoder->putdouble(bound.lat().hi());
+  encoder->putdouble(bound.lng().lo());
+  encoder->putdouble(bound.lng().hi());
+  encoder->putdouble(area);
+  encoder->putdouble(centroid.x());
+  encoder->putdouble(centroid.y());
+  encoder->putdouble(centroid.z());
+}
+
+bool S2ShapeMetadata::Decode(Decoder* decoder) {
+  if (decoder->avail() < kEncodedSize) return false;
+  int flags = decoder->get8();
+  if (flags >= 8 || (flags & 3) == 3) return false;
+  dimension = flags & 3;
+  double x = decoder->getdouble();
+  double y = decoder->getdouble();
+  double z = decoder->getdouble();
+  reference_point = S2Shape::ReferencePoint(S2Point(x, y, z), flags & 4);
+  double lat_lo = decoder->getdouble();
+  double lat_hi = decoder->getdouble();
+  double lng_lo = decoder->getdouble();
+  double lng_hi = decoder->getdouble();
+  bound = S2LatLngRect(R1Interval(lat_lo, lat_hi), S1Interval(lng_lo, lng_hi));
+  area = decoder->getdouble();
+  x = decoder->getdouble();
+  y = decoder->getdouble();
+  z = decoder->getdouble();
+  centroid = S2Point(x, y, z);
+  return bound.is_valid();
+}
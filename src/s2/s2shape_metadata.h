@@ -0,0 +1,74 @@
+// Copyright 2024 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef S2_S2SHAPE_METADATA_H_
+#define S2_S2SHAPE_METADATA_H_
+
+#include <cstddef>
+
+#include "s2/s2latlng_rect.h"
+#include "s2/s2point.h"
+#include "s2/s2shape.h"
+#include "s2/util/coding/coder.h"
+
+// S2ShapeMetadata holds properties of an S2Shape that are expensive to
+// compute but never change once the shape has been constructed: its
+// reference point, bounding rectangle, area, and centroid.
+//
+// MutableS2ShapeIndex can compute this metadata when shapes are indexed and
+// store it as part of the index encoding (see
+// MutableS2ShapeIndex::Options::cache_shape_metadata).  Clients can then
+// obtain it using S2ShapeIndex::GetShapeMetadata() without decoding the shape
+// itself, which is especially useful for EncodedS2ShapeIndex.
+struct S2ShapeMetadata {
+  // Computes the metadata for the given shape.  The running time is linear
+  // in the number of shape edges.
+  static S2ShapeMetadata Compute(const S2Shape& shape);
+
+  // Computes only the "bound" field below.  This is cheaper than Compute()
+  // when the other fields are not needed.
+  static S2LatLngRect GetRectBound(const S2Shape& shape);
+
+  // The dimension of the shape (see S2Shape::dimension).
+  int dimension = 0;
+
+  // The value of S2Shape::GetReferencePoint().
+  S2Shape::ReferencePoint reference_point =
+      S2Shape::ReferencePoint::Contained(false);
+
+  // A bounding rectangle for the shape.  The bound is conservative in the
+  // same sense as S2Region::GetRectBound(), i.e. it contains every point of
+  // the shape but may be slightly larger than necessary.
+  S2LatLngRect bound = S2LatLngRect::Empty();
+
+  // The value of S2::GetArea(shape) (see s2shape_measures.h).
+  double area = 0;
+
+  // The value of S2::GetCentroid(shape) (see s2shape_measures.h).
+  S2Point centroid;
+
+  // The size of the fixed-length encoding used by Encode().  Since every
+  // encoding has the same length, the metadata for a given shape can be
+  // decoded from an array of encodings in constant time.
+  static constexpr size_t kEncodedSize = 1 + 11 * sizeof(double);
+
+  // Appends exactly kEncodedSize bytes to "encoder".
+  void Encode(Encoder* encoder) const;
+
+  // Decodes metadata written by Encode(), returning true on success.
+  bool Decode(Decoder* decoder);
+};
+
+#endif  // S2_S2SHAPE_METADATA_H_
@@ -0,0 +1,111 @@
+// Copyright 2024 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "s2/s2shape_metadata.h"
+
+#include <memory>
+
+#include <gtest/gtest.h>
+#include "s2/s2latlng.h"
+#include "s2/s2latlng_rect.h"
+#include "s2/s2lax_polygon_shape.h"
+#include "s2/s2lax_polyline_shape.h"
+#include "s2/s2loop.h"
+#include "s2/s2point.h"
+#include "s2/s2point_vector_shape.h"
+#include "s2/s2shape.h"
+#include "s2/s2shape_measures.h"
+#include "s2/s2text_format.h"
+#include "s2/util/coding/coder.h"
+
+using s2textformat::MakeLaxPolygonOrDie;
+using s2textformat::MakeLaxPolylineOrDie;
+using s2textformat::MakeLoopOrDie;
+using s2textformat::ParsePointsOrDie;
+using std::make_unique;
+
+namespace {
+
+void ExpectMetadataMatchesShape(const S2Shape& shape) {
+  S2ShapeMetadata metadata = S2ShapeMetadata::Compute(shape);
+  EXPECT_EQ(shape.dimension(), metadata.dimension);
+  EXPECT_EQ(shape.GetReferencePoint(), metadata.reference_point);
+  EXPECT_EQ(S2::GetArea(shape), metadata.area);
+  EXPECT_EQ(S2::GetCentroid(shape), metadata.centroid);
+  for (int e = 0; e < shape.num_edges(); ++e) {
+    EXPECT_TRUE(metadata.bound.Contains(S2LatLng(shape.edge(e).v0)));
+  }
+}
+
+void ExpectEncodeDecodeRoundTrip(const S2Shape& shape) {
+  S2ShapeMetadata metadata = S2ShapeMetadata::Compute(shape);
+  Encoder encoder;
+  metadata.Encode(&encoder);
+  EXPECT_EQ(S2ShapeMetadata::kEncodedSize, encoder.length());
+
+  Decoder decoder(encoder.base(), encoder.length());
+  S2ShapeMetadata decoded;
+  ASSERT_TRUE(decoded.Decode(&decoder));
+  EXPECT_EQ(0, decoder.avail());
+  EXPECT_EQ(metadata.dimension, decoded.dimension);
+  EXPECT_EQ(metadata.reference_point, decoded.reference_point);
+  EXPECT_EQ(metadata.bound, decoded.bound);
+  EXPECT_EQ(metadata.area, decoded.area);
+  EXPECT_EQ(metadata.centroid, decoded.centroid);
+}
+
+TEST(S2ShapeMetadata, LoopBoundMatchesS2Loop) {
+  // The bound of a single loop is computed the same way as S2Loop's.
+  for (const char* str : {"0:0, 0:1, 1:0", "80:0, 80:120, 80:-120",
+                          "-80:0, -80:-120, -80:120", "0:170, 0:-170, 5:180"}) {
+    auto loop = MakeLoopOrDie(str);
+    S2Loop::Shape shape(loop.get());
+    EXPECT_EQ(loop->GetRectBound(), S2ShapeMetadata::Compute(shape).bound)
+        << str;
+  }
+}
+
+TEST(S2ShapeMetadata, EmptyAndFullPolygons) {
+  EXPECT_TRUE(S2ShapeMetadata::Compute(*MakeLaxPolygonOrDie("empty"))
+                  .bound.is_empty());
+  EXPECT_TRUE(S2ShapeMetadata::Compute(*MakeLaxPolygonOrDie("full"))
+                  .bound.is_full());
+}
+
+TEST(S2ShapeMetadata, MatchesShape) {
+  ExpectMetadataMatchesShape(S2PointVectorShape(ParsePointsOrDie("0:0, 5:5")));
+  ExpectMetadataMatchesShape(*MakeLaxPolylineOrDie("0:0, 0:10, 10:10"));
+  ExpectMetadataMatchesShape(
+      *MakeLaxPolygonOrDie("0:0, 0:10, 10:10, 10:0; 2:2, 2:3, 3:3"));
+  ExpectMetadataMatchesShape(*MakeLaxPolygonOrDie("full"));
+}
+
+TEST(S2ShapeMetadata, EncodeDecode) {
+  ExpectEncodeDecodeRoundTrip(S2PointVectorShape(ParsePointsOrDie("1:1")));
+  ExpectEncodeDecodeRoundTrip(*MakeLaxPolylineOrDie("0:0, 0:10"));
+  ExpectEncodeDecodeRoundTrip(*MakeLaxPolygonOrDie("0:0, 0:10, 10:0"));
+  ExpectEncodeDecodeRoundTrip(*MakeLaxPolygonOrDie("full"));
+}
+
+TEST(S2ShapeMetadata, DecodeTruncated) {
+  Encoder encoder;
+  S2ShapeMetadata::Compute(*MakeLaxPolylineOrDie("0:0, 0:10"))
+      .Encode(&encoder);
+  Decoder decoder(encoder.base(), encoder.length() - 1);
+  S2ShapeMetadata decoded;
+  EXPECT_FALSE(decoded.Decode(&decoder));
+}
+
+}  // namespace
@@ -19,6 +19,7 @@
 #include <algorithm>
 #include <cstdint>
 #include <limits>
+#include <utility>
 #include <vector>
 
 #include "absl/container/fixed_array.h"
@@ -27,6 +28,8 @@
 #include "absl/log/absl_vlog_is_on.h"
 #include "absl/strings/str_format.h"
 #include "s2/util/bitmap/bitmap.h"
+#include "s2/internal/s2parallel.h"
+#include "s2/s2cell_id.h"
 #include "s2/s2crossing_edge_query.h"
 #include "s2/s2point.h"
 #include "s2/s2predicates.h"
@@ -112,10 +115,16 @@ S2ShapeNestingQuery::ComputeShapeNesting(int shape_id) {
   absl::FixedArray<Bitmap64> parents(num_chains, Bitmap64(num_chains, false));
   absl::FixedArray<Bitmap64> children(num_chains, Bitmap64(num_chains, false));
 
-  // We'll compute edge crossings along a line segment from the datum shell to a
-  // random point on the other chains.  This choice is arbitrary, so we'll use
-  // the first vertex of edge 1 so we can easily get the next and previous
-  // points to check for orientation.
+  // For each chain we need to know which chains separate it from a fixed
+  // point on the datum shell.  A chain separates two points iff any path
+  // between them crosses the chain an odd number of times, so rather than
+  // testing a (possibly long) segment from the datum shell to every chain,
+  // we walk a path that visits the chains in S2CellId order.  The path
+  // starts at the first vertex of edge 1 of the datum shell, so that we can
+  // easily get the next and previous points to check for orientation, and
+  // each step is a short segment to a vertex of the next chain.  The chains
+  // are split into contiguous ranges along this order so that several paths
+  // can be walked in parallel.
   int32_t datum_shell = options().datum_strategy()(shape);
   const S2Point vertices[3] = {
       shape->chain_edge(datum_shell, 0).v0,
@@ -124,59 +133,109 @@ S2ShapeNestingQuery::ComputeShapeNesting(int shape_id) {
   };
   const S2Point start_point = vertices[1];
 
-  S2CrossingEdgeQuery crossing_query(index_);
-  vector<s2shapeutil::ShapeEdge> edges;
+  vector<std::pair<S2CellId, int>> order;
+  order.reserve(num_chains - 1);
   for (int chain = 0; chain < num_chains; ++chain) {
     if (chain == datum_shell) {
       continue;
     }
-    ABSL_VLOG(1) << "Processing chain " << chain;
-
-    // Find a close point on the target chain out of 4 equally spaced ones.
-    int end_idx = ClosestOfNPoints(start_point, *shape, chain, 4);
-    S2Point end_point = shape->chain_edge(chain, end_idx).v0;
-
-    // We need to know whether we're inside the datum shell at the end, so we
-    // need to properly seed its starting state.  If we start by entering the
-    // datum shell's interior _and_ end by arriving from the target chain's
-    // interior, we set it to true.
-    //
-    // As we cross edges from the datum to the target chain the total number of
-    // datum shell _or_ target chain edges we'll cross is either even or odd.
-    // Each of these edges toggles our "insideness" relative to the datum shell,
-    if (s2pred::OrderedCCW(vertices[2], end_point, vertices[0], start_point)) {
-      ABSL_VLOG(1) << "  Edge starts into interior of datum chain";
-      parents[chain].Set(datum_shell, true);
-      children[datum_shell].Set(chain, true);
+    order.emplace_back(S2CellId(shape->chain_edge(chain, 0).v0), chain);
+  }
+  std::sort(order.begin(), order.end());
+
+  const int num_paths = std::min<int>(options().num_threads(), order.size());
+  s2internal::ParallelFor(num_paths, num_paths, [&](int path) {
+    // The parity of the number of times that the path so far has crossed
+    // each chain.
+    Bitmap64 sides(num_chains, false);
+    S2CrossingEdgeQuery crossing_query(index_);
+    vector<s2shapeutil::ShapeEdge> edges;
+
+    // The current path vertex (which belongs to "last_chain" unless it is
+    // the start point) and the vertex before it.
+    S2Point last_point = start_point, prev_point;
+    int last_chain = -1, last_idx = 0;
+    const int begin = order.size() * path / num_paths;
+    const int end = order.size() * (path + 1) / num_paths;
+    for (int i = begin; i < end; ++i) {
+      const int chain = order[i].second;
+      ABSL_VLOG(1) << "Processing chain " << chain;
+
+      // Find a close point on the target chain out of 4 equally spaced ones.
+      int end_idx = ClosestOfNPoints(last_point, *shape, chain, 4);
+      S2Point end_point = shape->chain_edge(chain, end_idx).v0;
+
+      if (last_chain < 0) {
+        // We need to know whether we're inside the datum shell at the end, so
+        // we need to properly seed its starting state.  As we cross edges
+        // from the datum to the target chain the total number of datum shell
+        // edges we'll cross is either even or odd.  Each of these edges
+        // toggles our "insideness" relative to the datum shell.
+        if (s2pred::OrderedCCW(vertices[2], end_point, vertices[0],
+                               start_point)) {
+          ABSL_VLOG(1) << "  Edge starts into interior of datum chain";
+          sides.Set(datum_shell, true);
+        }
+      } else {
+        // The path passes through a vertex of the previous chain, which is a
+        // crossing iff the path arrives from and leaves towards different
+        // sides of that chain.
+        S2Point next = NextChainEdge(shape, last_chain, last_idx).v0;
+        S2Point prev = PrevChainEdge(shape, last_chain, last_idx).v0;
+        if (s2pred::OrderedCCW(next, prev_point, prev, last_point) !=
+            s2pred::OrderedCCW(next, end_point, prev, last_point)) {
+          sides.Toggle(last_chain);
+        }
+      }
+
+      // Query all the edges crossed by the next segment of the path.  Only
+      // look at edges that belong to the requested shape.  Using INTERIOR
+      // here will avoid returning the edges that are touched by the
+      // endpoints of the segment.
+      crossing_query.GetCrossingEdges(last_point, end_point, shape_id, *shape,
+                                      s2shapeutil::CrossingType::INTERIOR,
+                                      &edges);
+
+      // Walk through the intersected chains and toggle corresponding bits.
+      for (const auto& edge : edges) {
+        int32_t other_chain = shape->chain_position(edge.id().edge_id).chain_id;
+        sides.Toggle(other_chain);
+        ABSL_VLOG(1) << "  Crosses chain " << other_chain;
+      }
+
+      // The possible parents of the target chain are the chains that
+      // separate it from the start point.  In addition, the bit for the
+      // datum shell records whether the target chain is inside the datum
+      // shell, and the bit for the target chain records whether the start
+      // point is inside the target chain (we're inside the target chain at
+      // the end if we arrive from its interior).
+      parents[chain] = sides;
+      S2Point next = NextChainEdge(shape, chain, end_idx).v0;
+      S2Point prev = PrevChainEdge(shape, chain, end_idx).v0;
+      if (s2pred::OrderedCCW(next, last_point, prev, end_point)) {
+        ABSL_VLOG(1) << "  Edge ends from interior of target chain";
+        parents[chain].Toggle(chain);
+      }
+      ABSL_VLOG(2) << "    Parent set: " << parents[chain].ToString(8);
+
+      prev_point = last_point;
+      last_point = end_point;
+      last_chain = chain;
+      last_idx = end_idx;
     }
+  });
 
-    // Arriving from the interior of the target chain?
-    S2Point next = NextChainEdge(shape, chain, end_idx).v0;
-    S2Point prev = PrevChainEdge(shape, chain, end_idx).v0;
-    if (s2pred::OrderedCCW(next, start_point, prev, end_point)) {
-      ABSL_VLOG(1) << "  Edge ends from interior of target chain";
-      parents[chain].Set(chain, true);
+  for (int chain = 0; chain < num_chains; ++chain) {
+    if (chain == datum_shell) {
+      continue;
     }
-    ABSL_VLOG(2) << "    Initial set: " << parents[chain].ToString(8);
-
-    // Query all the edges crossed by the line from the datum shell to a point
-    // on this chain.  Only look at edges that belong to the requested shape.
-    // Using INTERIOR here will avoid returning the two edges on the datum and
-    // target shells that are touched by the endpoints of our line segment.
-    crossing_query.GetCrossingEdges(start_point, end_point, shape_id, *shape,
-                                    s2shapeutil::CrossingType::INTERIOR,
-                                    &edges);
-
-    // Walk through the intersected chains and toggle corresponding bits.
-    for (const auto& edge : edges) {
-      int32_t other_chain = shape->chain_position(edge.id().edge_id).chain_id;
-
-      parents[chain].Toggle(other_chain);
-      if (other_chain != chain) {
-        children[other_chain].Toggle(chain);
+    // Every chain (other than itself) that separates this chain from the
+    // start point is potentially a child of this chain.
+    Bitmap64::size_type other = 0;
+    for (; parents[chain].FindNextSetBit(&other); ++other) {
+      if (other != static_cast<Bitmap64::size_type>(chain)) {
+        children[other].Set(chain, true);
       }
-      ABSL_VLOG(1) << "  Crosses chain " << other_chain;
-      ABSL_VLOG(2) << "    Parent set: " << parents[chain].ToString(8);
     }
 
     // Now set the final state.  Remove the target chain from its own parent set
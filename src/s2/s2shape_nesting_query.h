@@ -89,8 +89,21 @@ class S2ShapeNestingQuery {
       return *this;
     }
 
+    // The maximum number of threads (including the calling thread) used by
+    // ComputeShapeNesting() to classify the chains of a shape.  The result
+    // does not depend on this value.
+    //
+    // REQUIRES: num_threads >= 1
+    // DEFAULT: 1
+    int num_threads() const { return num_threads_; }
+    Options& set_num_threads(int num_threads) {
+      num_threads_ = num_threads;
+      return *this;
+    }
+
    private:
     S2DatumStrategy datum_strategy_;
+    int num_threads_ = 1;
   };
 
   // `ChainRelation` models the parent/child relationship between chains in a
@@ -0,0 +1,76 @@
+// Copyright 2024 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "s2/s2shape_nesting_query.h"
+
+#include <cmath>
+#include <memory>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+#include "s2/mutable_s2shape_index.h"
+#include "s2/s1angle.h"
+#include "s2/s2latlng.h"
+#include "s2/s2lax_polygon_shape.h"
+#include "s2/s2loop.h"
+#include "s2/s2point.h"
+
+using std::make_unique;
+using std::vector;
+
+namespace {
+
+// Returns the vertices of a regular loop with "num_vertices" vertices, which
+// is reversed (i.e., a hole) if "hole" is true.
+vector<S2Point> MakeRing(const S2LatLng& center, S1Angle radius,
+                         int num_vertices, bool hole) {
+  auto loop =
+      S2Loop::MakeRegularLoop(center.ToPoint(), radius, num_vertices);
+  vector<S2Point> vertices(&loop->vertex(0),
+                           &loop->vertex(0) + loop->num_vertices());
+  if (hole) std::reverse(vertices.begin(), vertices.end());
+  return vertices;
+}
+
+// Measures ComputeShapeNesting() for a shape consisting of a large shell
+// containing a grid of state.range(0) holes, each of which contains an
+// island shell.  This is similar to a coastline with many lakes.
+void BM_ComputeShapeNesting(benchmark::State& state) {
+  const int grid_size = std::sqrt(state.range(0) / 2);
+  vector<vector<S2Point>> loops;
+  loops.push_back(MakeRing(S2LatLng::FromDegrees(0, 0),
+                           S1Angle::Degrees(20), 1024, false));
+  for (int i = 0; i < grid_size; ++i) {
+    for (int j = 0; j < grid_size; ++j) {
+      S2LatLng center =
+          S2LatLng::FromDegrees(-10 + 20.0 * (i + 0.5) / grid_size,
+                                -10 + 20.0 * (j + 0.5) / grid_size);
+      S1Angle radius = S1Angle::Degrees(5.0 / grid_size);
+      loops.push_back(MakeRing(center, radius, 32, true));
+      loops.push_back(MakeRing(center, 0.5 * radius, 32, false));
+    }
+  }
+  MutableS2ShapeIndex index;
+  index.Add(make_unique<S2LaxPolygonShape>(loops));
+  index.ForceBuild();
+  S2ShapeNestingQuery query(&index);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(query.ComputeShapeNesting(0));
+  }
+  state.SetItemsProcessed(state.iterations() * loops.size());
+}
+BENCHMARK(BM_ComputeShapeNesting)->Range(8, 8192);
+
+}  // namespace
@@ -374,6 +374,38 @@ TEST(S2ShapeNestingQuery, ExactPathIsIrrelevant) {
   }
 }
 
+// Checks a shell containing a grid of holes, each of which contains an island
+// shell, using one or more threads.
+TEST(S2ShapeNestingQuery, ManyLakesWithIslands) {
+  constexpr int kGridSize = 12;
+  vector<RingSpec> rings = {RingSpec{S2LatLng::FromDegrees(0, 0), 20}};
+  for (int i = 0; i < kGridSize; ++i) {
+    for (int j = 0; j < kGridSize; ++j) {
+      S2LatLng center = S2LatLng::FromDegrees(-10 + 20.0 * i / kGridSize,
+                                              -10 + 20.0 * j / kGridSize);
+      rings.push_back(RingSpec{center, 0.5, true});
+      rings.push_back(RingSpec{center, 0.2});
+    }
+  }
+  MutableS2ShapeIndex index;
+  int id = index.Add(RingShape(16, rings));
+
+  for (int num_threads : {1, 4}) {
+    S2ShapeNestingQuery query(
+        &index, S2ShapeNestingQuery::Options().set_num_threads(num_threads));
+    vector<S2ShapeNestingQuery::ChainRelation> relations =
+        query.ComputeShapeNesting(id);
+    ASSERT_EQ(relations.size(), rings.size());
+    EXPECT_TRUE(relations[0].is_shell());
+    EXPECT_EQ(relations[0].num_holes(), kGridSize * kGridSize);
+    for (int chain = 1; chain < relations.size(); chain += 2) {
+      EXPECT_EQ(relations[chain].parent_id(), 0);
+      EXPECT_TRUE(relations[chain + 1].is_shell());
+      EXPECT_EQ(relations[chain + 1].num_holes(), 0);
+    }
+  }
+}
+
 struct NestingTestCase {
   int depth;        // How many nested loops to generate
   int first_chain;  // Which nested loop is the first loop in the list
@@ -17,6 +17,8 @@
 
 #include "s2/s2shapeutil_build_polygon_boundaries.h"
 
+#include <algorithm>
+#include <cstddef>
 #include <memory>
 #include <utility>
 #include <vector>
@@ -24,6 +26,7 @@
 #include "absl/container/flat_hash_map.h"
 #include "absl/log/absl_check.h"
 #include "absl/types/span.h"
+#include "s2/internal/s2parallel.h"
 #include "s2/mutable_s2shape_index.h"
 #include "s2/s2contains_point_query.h"
 #include "s2/s2pointutil.h"
@@ -36,7 +39,8 @@ using std::vector;
 namespace s2shapeutil {
 
 void BuildPolygonBoundaries(absl::Span<const vector<S2Shape*>> components,
-                            vector<vector<S2Shape*>>* polygons) {
+                            vector<vector<S2Shape*>>* polygons,
+                            const BuildPolygonBoundariesOptions& options) {
   polygons->clear();
   if (components.empty()) return;
 
@@ -61,34 +65,75 @@ void BuildPolygonBoundaries(absl::Span<const vector<S2Shape*>> components,
   //
   // 4. The outer loops of all components at depth 0 become a single face.
 
-  MutableS2ShapeIndex index;
+  // Testing whether each loop contains S2::Origin() takes time proportional
+  // to its number of edges, so the components are processed in parallel.
+  const int num_threads = options.num_threads();
+  vector<vector<bool>> is_outer(components.size());
+  s2internal::ParallelFor(num_threads, components.size(), [&](int i) {
+    const auto& component = components[i];
+    is_outer[i].resize(component.size(), true);
+    if (component.size() == 1) return;
+    for (size_t j = 0; j < component.size(); ++j) {
+      is_outer[i][j] =
+          s2shapeutil::ContainsBruteForce(*component[j], S2::Origin());
+    }
+  });
+
+  // If no component is nested inside another one, every loop that is not an
+  // outer loop is a polygon by itself.
+  if (options.components_not_nested()) {
+    polygons->emplace_back();
+    for (size_t i = 0; i < components.size(); ++i) {
+      for (size_t j = 0; j < components[i].size(); ++j) {
+        if (is_outer[i][j]) {
+          polygons->front().push_back(components[i][j]);
+        } else {
+          polygons->push_back({components[i][j]});
+        }
+      }
+    }
+    std::rotate(polygons->begin(), polygons->begin() + 1, polygons->end());
+    return;
+  }
+
+  MutableS2ShapeIndex::Options index_options;
+  index_options.set_num_threads(num_threads);
+  MutableS2ShapeIndex index(index_options);
   // A map from shape id to the corresponding component number.
   vector<int> component_ids;
   vector<S2Shape*> outer_loops;
   for (size_t i = 0; i < components.size(); ++i) {
     const auto& component = components[i];
-    for (S2Shape* loop : component) {
-      if (component.size() > 1 &&
-          !s2shapeutil::ContainsBruteForce(*loop, S2::Origin())) {
+    for (size_t j = 0; j < component.size(); ++j) {
+      if (!is_outer[i][j]) {
         // Ownership is transferred back at the end of this function.
-        index.Add(WrapUnique(loop));
+        index.Add(WrapUnique(component[j]));
         component_ids.push_back(i);
       } else {
-        outer_loops.push_back(loop);
+        outer_loops.push_back(component[j]);
       }
     }
     // Check that there is exactly one outer loop in each component.
     ABSL_DCHECK_EQ(i + 1, outer_loops.size())
         << "Component is not a subdivision";
   }
-  // Find the loops containing each component.
+  // Find the loops containing each component.  Each task processes a range
+  // of components using its own query.
+  index.ForceBuild();  // Required before querying from several threads.
+  constexpr int kComponentsPerTask = 64;
+  const int num_tasks =
+      (outer_loops.size() + kComponentsPerTask - 1) / kComponentsPerTask;
   vector<vector<int>> ancestors(components.size());
-  auto contains_query = MakeS2ContainsPointQuery(&index);
-  for (size_t i = 0; i < outer_loops.size(); ++i) {
-    auto loop = outer_loops[i];
-    ABSL_DCHECK_GT(loop->num_edges(), 0);
-    ancestors[i] = contains_query.GetContainingShapeIds(loop->edge(0).v0);
-  }
+  s2internal::ParallelFor(num_threads, num_tasks, [&](int task) {
+    auto contains_query = MakeS2ContainsPointQuery(&index);
+    const size_t end = std::min(outer_loops.size(),
+                                size_t{kComponentsPerTask} * (task + 1));
+    for (size_t i = size_t{kComponentsPerTask} * task; i < end; ++i) {
+      auto loop = outer_loops[i];
+      ABSL_DCHECK_GT(loop->num_edges(), 0);
+      ancestors[i] = contains_query.GetContainingShapeIds(loop->edge(0).v0);
+    }
+  });
   // Assign each outer loop to the component whose depth is one less.
   // Components at depth 0 become a single face.
   absl::flat_hash_map<const S2Shape*, vector<S2Shape*>> children;
@@ -26,6 +26,36 @@
 
 namespace s2shapeutil {
 
+// Options for BuildPolygonBoundaries().
+class BuildPolygonBoundariesOptions {
+ public:
+  // The maximum number of threads (including the calling thread) used to
+  // find the outer loop of each component, to index the remaining loops, and
+  // to find the loops that contain each component.  The output does not
+  // depend on the number of threads.
+  //
+  // DEFAULT: 1
+  int num_threads() const { return num_threads_; }
+  void set_num_threads(int num_threads) { num_threads_ = num_threads; }
+
+  // If true, the caller guarantees that no component is contained by a loop
+  // of another component (e.g., the input is a set of polygons without holes
+  // that are already known to be disjoint).  In that case no index is built:
+  // each loop other than the outer loops becomes a polygon by itself, and
+  // the outer loops of all components form one more polygon.  The result is
+  // undefined if components are actually nested.
+  //
+  // DEFAULT: false
+  bool components_not_nested() const { return components_not_nested_; }
+  void set_components_not_nested(bool components_not_nested) {
+    components_not_nested_ = components_not_nested;
+  }
+
+ private:
+  int num_threads_ = 1;
+  bool components_not_nested_ = false;
+};
+
 // The purpose of this function is to construct polygons consisting of
 // multiple loops.  It takes as input a collection of loops whose boundaries
 // do not cross, and groups them into polygons whose interiors do not
@@ -59,8 +89,11 @@ namespace s2shapeutil {
 // the collection of loops that form its boundary.  This function does not
 // actually construct any S2Shapes; it simply identifies the loops that belong
 // to each polygon.
-void BuildPolygonBoundaries(absl::Span<const std::vector<S2Shape*>> components,
-                            std::vector<std::vector<S2Shape*>>* polygons);
+void BuildPolygonBoundaries(
+    absl::Span<const std::vector<S2Shape*>> components,
+    std::vector<std::vector<S2Shape*>>* polygons,
+    const BuildPolygonBoundariesOptions& options =
+        BuildPolygonBoundariesOptions());
 
 }  // namespace s2shapeutil
 
@@ -18,10 +18,12 @@
 #include "s2/s2shapeutil_build_polygon_boundaries.h"
 
 #include <algorithm>
+#include <memory>
 #include <string>
 #include <vector>
 
 #include <gtest/gtest.h>
+#include "absl/strings/str_cat.h"
 #include "absl/strings/string_view.h"
 #include "s2/s2lax_loop_shape.h"
 #include "s2/s2point.h"
@@ -174,4 +176,49 @@ TEST(BuildPolygonBoundaries, ComplexTest1) {
   EXPECT_EQ(expected_faces, faces);
 }
 
+TEST(BuildPolygonBoundaries, OptionsDoNotChangeResult) {
+  // A grid of disjoint squares, each forming a component with two loops.
+  vector<std::unique_ptr<TestLaxLoop>> loops;
+  vector<vector<S2Shape*>> components;
+  for (int i = 0; i < 20; ++i) {
+    for (int j = 0; j < 20; ++j) {
+      const string a = absl::StrCat(2 * i, ":", 2 * j);
+      const string b = absl::StrCat(2 * i, ":", 2 * j + 1);
+      const string c = absl::StrCat(2 * i + 1, ":", 2 * j + 1);
+      const string d = absl::StrCat(2 * i + 1, ":", 2 * j);
+      loops.push_back(std::make_unique<TestLaxLoop>(
+          absl::StrCat(a, ", ", d, ", ", c, ", ", b)));  // Outer face
+      loops.push_back(std::make_unique<TestLaxLoop>(
+          absl::StrCat(a, ", ", b, ", ", c, ", ", d)));
+      components.push_back({loops[loops.size() - 2].get(),
+                            loops.back().get()});
+    }
+  }
+  vector<vector<S2Shape*>> expected;
+  BuildPolygonBoundaries(components, &expected);
+  ASSERT_EQ(401, expected.size());
+  for (int num_threads : {1, 4}) {
+    for (bool components_not_nested : {false, true}) {
+      BuildPolygonBoundariesOptions options;
+      options.set_num_threads(num_threads);
+      options.set_components_not_nested(components_not_nested);
+      vector<vector<S2Shape*>> faces;
+      BuildPolygonBoundaries(components, &faces, options);
+      EXPECT_EQ(expected, faces);
+    }
+  }
+
+  // Nested components are still handled when using several threads.
+  TestLaxLoop inner0("0.2:0.2, 0.8:0.2, 0.8:0.8, 0.2:0.8");  // Outer face
+  TestLaxLoop inner1("0.2:0.2, 0.2:0.8, 0.8:0.8, 0.8:0.2");
+  components.push_back({&inner0, &inner1});
+  BuildPolygonBoundaries(components, &expected);
+  BuildPolygonBoundariesOptions options;
+  options.set_num_threads(4);
+  vector<vector<S2Shape*>> faces;
+  BuildPolygonBoundaries(components, &faces, options);
+  EXPECT_EQ(expected, faces);
+  EXPECT_EQ(402, faces.size());
+}
+
 }  // namespace s2shapeutil
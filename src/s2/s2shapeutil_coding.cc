@@ -19,14 +19,18 @@
 
 #include <cstdint>
 #include <memory>
+#include <string>
 #include <utility>
 #include <vector>
 
 #include "absl/cleanup/cleanup.h"
 #include "absl/log/absl_check.h"
 #include "absl/log/absl_log.h"
+#include "absl/types/span.h"
 #include "s2/util/coding/coder.h"
 #include "s2/encoded_string_vector.h"
+#include "s2/mutable_s2shape_index.h"
+#include "s2/s2cell_union.h"
 #include "s2/s2coder.h"
 #include "s2/s2lax_polygon_shape.h"
 #include "s2/s2lax_polyline_shape.h"
@@ -39,6 +43,8 @@
 
 using std::make_shared;
 using std::make_unique;
+using std::shared_ptr;
+using std::string;
 using std::unique_ptr;
 using std::vector;
 
@@ -131,28 +137,103 @@ unique_ptr<S2Shape> LazyDecodeShape(S2Shape::TypeTag tag, Decoder* decoder) {
   }
 }
 
+// Encodes the shape with the given id, including its type tag.
+static bool EncodeTaggedShape(const S2ShapeIndex& index,
+                              const ShapeEncoder& shape_encoder, int id,
+                              Encoder* encoder) {
+  const S2Shape* shape = index.shape(id);
+  if (shape == nullptr) return true;  // Encode as zero bytes.
+
+  encoder->Ensure(Encoder::kVarintMax32);
+  encoder->put_varint32(shape->type_tag());
+  return shape_encoder(*shape, encoder);
+}
+
 bool EncodeTaggedShapes(const S2ShapeIndex& index,
                         const ShapeEncoder& shape_encoder,
-                        Encoder* encoder) {
-  s2coding::StringVectorEncoder shape_vector;
-  for (const S2Shape* shape : index) {
-    Encoder* sub_encoder = shape_vector.AddViaEncoder();
-    if (shape == nullptr) continue;  // Encode as zero bytes.
-
-    sub_encoder->Ensure(Encoder::kVarintMax32);
-    sub_encoder->put_varint32(shape->type_tag());
-    if (!shape_encoder(*shape, sub_encoder)) return false;
-  }
-  shape_vector.Encode(encoder);
-  return true;
+                        Encoder* encoder, int num_threads) {
+  return s2coding::StringVectorEncoder::EncodeParallel(
+      index.num_shape_ids(),
+      [&](size_t id, Encoder* sub_encoder) {
+        return EncodeTaggedShape(index, shape_encoder, id, sub_encoder);
+      },
+      num_threads, encoder);
 }
 
-bool FastEncodeTaggedShapes(const S2ShapeIndex& index, Encoder* encoder) {
-  return EncodeTaggedShapes(index, FastEncodeShape, encoder);
+bool FastEncodeTaggedShapes(const S2ShapeIndex& index, Encoder* encoder,
+                            int num_threads) {
+  return EncodeTaggedShapes(index, FastEncodeShape, encoder, num_threads);
 }
 
-bool CompactEncodeTaggedShapes(const S2ShapeIndex& index, Encoder* encoder) {
-  return EncodeTaggedShapes(index, CompactEncodeShape, encoder);
+bool CompactEncodeTaggedShapes(const S2ShapeIndex& index, Encoder* encoder,
+                               int num_threads) {
+  return EncodeTaggedShapes(index, CompactEncodeShape, encoder, num_threads);
+}
+
+bool EncodeTaggedShapes(const S2ShapeIndex& index,
+                        const ShapeEncoder& shape_encoder,
+                        s2coding::EncodedDataSink sink) {
+  return s2coding::StringVectorEncoder::EncodeStreaming(
+      index.num_shape_ids(),
+      [&](size_t id, Encoder* encoder) {
+        return EncodeTaggedShape(index, shape_encoder, id, encoder);
+      },
+      sink);
+}
+
+bool FastEncodeTaggedShapes(const S2ShapeIndex& index,
+                            s2coding::EncodedDataSink sink) {
+  return EncodeTaggedShapes(index, FastEncodeShape, sink);
+}
+
+bool CompactEncodeTaggedShapes(const S2ShapeIndex& index,
+                               s2coding::EncodedDataSink sink) {
+  return EncodeTaggedShapes(index, CompactEncodeShape, sink);
+}
+
+bool EncodeTaggedShards(const MutableS2ShapeIndex& index,
+                        absl::Span<const S2CellUnion> partitions,
+                        const ShapeEncoder& shape_encoder,
+                        vector<string>* shards) {
+  for (const S2CellUnion& partition : partitions) {
+    // The index cells must be encoded first in order to find the shapes
+    // that they refer to, but the shapes precede them in the shard.
+    Encoder index_encoder;
+    vector<int> shape_ids = index.EncodeRegion(partition, &index_encoder);
+    s2coding::StringVectorEncoder shapes;
+    auto next = shape_ids.begin();
+    for (int id = 0; id < index.num_shape_ids(); ++id) {
+      Encoder* sub_encoder = shapes.AddViaEncoder();
+      if (next == shape_ids.end() || *next != id) continue;  // Missing.
+      ++next;
+      if (!EncodeTaggedShape(index, shape_encoder, id, sub_encoder)) {
+        return false;
+      }
+    }
+    Encoder encoder;
+    shapes.Encode(&encoder);
+    encoder.Ensure(index_encoder.length());
+    encoder.putn(index_encoder.base(), index_encoder.length());
+    shards->emplace_back(encoder.base(), encoder.length());
+  }
+  return true;
+}
+
+bool EncodeMergedIndexes(absl::Span<const S2ShapeIndex* const> indexes,
+                         const ShapeEncoder& shape_encoder, Encoder* encoder) {
+  s2coding::StringVectorEncoder shapes;
+  for (const S2ShapeIndex* index : indexes) {
+    for (int id = 0; id < index->num_shape_ids(); ++id) {
+      if (!EncodeTaggedShape(*index, shape_encoder, id,
+                             shapes.AddViaEncoder())) {
+        return false;
+      }
+    }
+  }
+  shapes.Encode(encoder);
+  MutableS2ShapeIndex::EncodeMerged(indexes, MutableS2ShapeIndex::Options(),
+                                    encoder);
+  return true;
 }
 
 TaggedShapeFactory::TaggedShapeFactory(const ShapeDecoder& shape_decoder,
@@ -164,6 +245,14 @@ TaggedShapeFactory::TaggedShapeFactory(const ShapeDecoder& shape_decoder,
   }
 }
 
+TaggedShapeFactory::TaggedShapeFactory(const ShapeDecoder& shape_decoder,
+                                       Decoder* decoder,
+                                       shared_ptr<const void> data_owner,
+                                       S2Error& error)
+    : TaggedShapeFactory(shape_decoder, decoder, error) {
+  data_owner_ = std::move(data_owner);
+}
+
 unique_ptr<S2Shape> TaggedShapeFactory::operator[](int shape_id) const {
   Decoder decoder = encoded_shapes_.GetDecoder(shape_id);
   S2Shape::TypeTag tag;
@@ -179,6 +268,12 @@ TaggedShapeFactory LazyDecodeShapeFactory(Decoder* decoder, S2Error& error) {
   return TaggedShapeFactory(LazyDecodeShape, decoder, error);
 }
 
+TaggedShapeFactory LazyDecodeShapeFactory(
+    Decoder* decoder, shared_ptr<const void> data_owner, S2Error& error) {
+  return TaggedShapeFactory(LazyDecodeShape, decoder, std::move(data_owner),
+                            error);
+}
+
 // Deprecated, use version that accepts S2Error to detect encoding errors.
 TaggedShapeFactory FullDecodeShapeFactory(Decoder* decoder) {
   S2Error error;
@@ -35,14 +35,18 @@
 
 #include <functional>
 #include <memory>
+#include <string>
 #include <utility>
 #include <vector>
 
 #include "s2/base/casts.h"
 #include "absl/base/attributes.h"
 #include "absl/log/absl_check.h"
+#include "absl/types/span.h"
 #include "s2/util/coding/coder.h"
 #include "s2/encoded_string_vector.h"
+#include "s2/mutable_s2shape_index.h"
+#include "s2/s2cell_union.h"
 #include "s2/s2coder.h"
 #include "s2/s2shape.h"
 #include "s2/s2shape_index.h"
@@ -120,25 +124,79 @@ std::unique_ptr<S2Shape> LazyDecodeShape(S2Shape::TypeTag tag,
 // This is because when the index is decoded, the shape vector is required as
 // a parameter.
 //
+// Up to "num_threads" threads (including the calling thread) are used to
+// encode the shapes concurrently, in which case "shape_encoder" must be safe
+// to call from multiple threads.  The output does not depend on
+// "num_threads".
+//
 // REQUIRES: "encoder" uses the default constructor, so that its buffer
 //           can be enlarged as necessary by calling Ensure(int).
+// REQUIRES: num_threads >= 1
 bool EncodeTaggedShapes(const S2ShapeIndex& index,
                         const ShapeEncoder& shape_encoder,
-                        Encoder* encoder);
+                        Encoder* encoder, int num_threads = 1);
 
 // Convenience function that calls EncodeTaggedShapes using FastEncodeShape as
 // the ShapeEncoder.
 //
 // REQUIRES: "encoder" uses the default constructor, so that its buffer
 //           can be enlarged as necessary by calling Ensure(int).
-bool FastEncodeTaggedShapes(const S2ShapeIndex& index, Encoder* encoder);
+bool FastEncodeTaggedShapes(const S2ShapeIndex& index, Encoder* encoder,
+                            int num_threads = 1);
 
 // Convenience function that calls EncodeTaggedShapes using CompactEncodeShape
 // as the ShapeEncoder.
 //
 // REQUIRES: "encoder" uses the default constructor, so that its buffer
 //           can be enlarged as necessary by calling Ensure(int).
-bool CompactEncodeTaggedShapes(const S2ShapeIndex& index, Encoder* encoder);
+bool CompactEncodeTaggedShapes(const S2ShapeIndex& index, Encoder* encoder,
+                               int num_threads = 1);
+
+// Like the functions above, but passes the encoding to "sink" in pieces
+// rather than building it in memory (see
+// s2coding::StringVectorEncoder::EncodeStreaming).  Each shape is encoded
+// twice, so memory usage is proportional to the number of shapes plus the
+// size of the largest encoded shape.  Returns false if "shape_encoder" or
+// "sink" does.
+bool EncodeTaggedShapes(const S2ShapeIndex& index,
+                        const ShapeEncoder& shape_encoder,
+                        s2coding::EncodedDataSink sink);
+bool FastEncodeTaggedShapes(const S2ShapeIndex& index,
+                            s2coding::EncodedDataSink sink);
+bool CompactEncodeTaggedShapes(const S2ShapeIndex& index,
+                               s2coding::EncodedDataSink sink);
+
+// Splits "index" into one shard for each of the given "partitions" (e.g.,
+// as returned by S2DensityTree::GetPartitioning), and appends the encoded
+// shards to "shards".  Each shard consists of the shapes encoded as by
+// EncodeTaggedShapes() followed by the encoded index, so it can be decoded
+// like this:
+//
+//   Decoder decoder(shard.data(), shard.size());
+//   index.Init(&decoder, s2shapeutil::LazyDecodeShapeFactory(&decoder, error));
+//
+// Shards are built directly from the existing index cells (see
+// MutableS2ShapeIndex::EncodeRegion), so no shapes are reindexed.  Each shard
+// contains the index cells that intersect its partition and the shapes that
+// those cells refer to; shape ids are unchanged, and all other shapes are
+// encoded as missing.  Queries on a shard give the same results as queries
+// on "index" for points and edges within its partition.  Returns false if
+// "shape_encoder" does.
+bool EncodeTaggedShards(const MutableS2ShapeIndex& index,
+                        absl::Span<const S2CellUnion> partitions,
+                        const ShapeEncoder& shape_encoder,
+                        std::vector<std::string>* shards);
+
+// Combines the given indexes into a single encoding consisting of all their
+// shapes, encoded as by EncodeTaggedShapes(), followed by the merged index
+// (see MutableS2ShapeIndex::EncodeMerged).  The shapes of each index are
+// renumbered by adding the total number of shape ids in the preceding
+// indexes.  No shapes are reindexed, so this is much faster than adding all
+// the shapes to a new MutableS2ShapeIndex.  The result can be decoded using
+// EncodedS2ShapeIndex (see LazyDecodeShapeFactory).  Returns false if
+// "shape_encoder" does.
+bool EncodeMergedIndexes(absl::Span<const S2ShapeIndex* const> indexes,
+                         const ShapeEncoder& shape_encoder, Encoder* encoder);
 
 // A ShapeFactory that decodes a vector generated by EncodeTaggedShapes()
 // above.  Example usage:
@@ -159,6 +217,14 @@ class TaggedShapeFactory : public S2ShapeIndex::ShapeFactory {
   TaggedShapeFactory(const ShapeDecoder& shape_decoder, Decoder* decoder,
                      S2Error& error);
 
+  // As above, but the factory (and all of its clones) also shares ownership
+  // of "data_owner", which must keep the decoder's data buffer alive.  This
+  // allows shapes to be decoded directly from a buffer such as a
+  // memory-mapped file (see S2MemoryMappedFile) that is released only once
+  // it is no longer referenced.
+  TaggedShapeFactory(const ShapeDecoder& shape_decoder, Decoder* decoder,
+                     std::shared_ptr<const void> data_owner, S2Error& error);
+
   int size() const override { return encoded_shapes_.size(); }
 
   std::unique_ptr<S2Shape> operator[](int shape_id) const override;
@@ -169,6 +235,7 @@ class TaggedShapeFactory : public S2ShapeIndex::ShapeFactory {
 
  private:
   ShapeDecoder shape_decoder_;
+  std::shared_ptr<const void> data_owner_;
   s2coding::EncodedStringVector encoded_shapes_;
 };
 
@@ -183,6 +250,20 @@ TaggedShapeFactory FullDecodeShapeFactory(Decoder* decoder);
 // as the ShapeDecoder.
 TaggedShapeFactory LazyDecodeShapeFactory(Decoder* decoder, S2Error& error);
 
+// As above, but the returned factory shares ownership of "data_owner", which
+// keeps the decoder's data buffer alive.  Since lazily decoded shapes refer
+// directly to the encoded data, this lets shapes be served from a
+// memory-mapped region without copying:
+//
+//   auto file = S2MemoryMappedFile::Open(path, error);
+//   Decoder decoder(file->data(), file->size());
+//   auto factory = s2shapeutil::LazyDecodeShapeFactory(&decoder, file, error);
+//
+// Note that the shapes returned by the factory do not themselves own the
+// buffer; they must not outlive the factory (or the index that owns them).
+TaggedShapeFactory LazyDecodeShapeFactory(
+    Decoder* decoder, std::shared_ptr<const void> data_owner, S2Error& error);
+
 [[deprecated("Use version that accepts S2Error to detect encoding errors")]]
 TaggedShapeFactory LazyDecodeShapeFactory(Decoder* decoder);
 
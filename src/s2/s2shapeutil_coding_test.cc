@@ -20,17 +20,35 @@
 #include <memory>
 #include <string>
 #include <utility>
+#include <vector>
 
 #include "s2/base/casts.h"
 #include <gtest/gtest.h>
+#include "absl/log/log_streamer.h"
+#include "absl/random/random.h"
 #include "absl/strings/escaping.h"
+#include "absl/strings/str_format.h"
+#include "absl/strings/string_view.h"
 #include "s2/util/coding/coder.h"
+#include "s2/encoded_s2shape_index.h"
 #include "s2/mutable_s2shape_index.h"
+#include "s2/s1angle.h"
+#include "s2/s2cell_id.h"
+#include "s2/s2cap.h"
+#include "s2/s2cell_union.h"
+#include "s2/s2closest_edge_query.h"
+#include "s2/s2contains_point_query.h"
+#include "s2/s2error.h"
 #include "s2/s2lax_polygon_shape.h"
+#include "s2/s2latlng.h"
 #include "s2/s2lax_polyline_shape.h"
+#include "s2/s2loop.h"
 #include "s2/s2point_vector_shape.h"
 #include "s2/s2polygon.h"
+#include "s2/s2random.h"
 #include "s2/s2shape.h"
+#include "s2/s2shapeutil_testing.h"
+#include "s2/s2testing.h"
 #include "s2/s2text_format.h"
 
 using std::make_unique;
@@ -64,6 +82,133 @@ TEST(FastEncodeTaggedShapes, MixedShapes) {
             s2textformat::ToString(decoded_index));
 }
 
+TEST(CompactEncodeTaggedShapes, Streaming) {
+  auto index = s2textformat::MakeIndexOrDie(
+      "0:0 | 0:1 # 1:1, 1:2, 1:3 # 2:2; 2:3, 2:4, 3:3");
+  Encoder encoder;
+  ASSERT_TRUE(s2shapeutil::CompactEncodeTaggedShapes(*index, &encoder));
+  string streamed;
+  ASSERT_TRUE(s2shapeutil::CompactEncodeTaggedShapes(
+      *index, [&](absl::string_view piece) {
+        streamed.append(piece.data(), piece.size());
+        return true;
+      }));
+  EXPECT_EQ(absl::string_view(encoder.base(), encoder.length()), streamed);
+
+  // Errors reported by the sink stop the encoding.
+  EXPECT_FALSE(s2shapeutil::CompactEncodeTaggedShapes(
+      *index, [](absl::string_view) { return false; }));
+}
+
+TEST(FastEncodeTaggedShapes, Parallel) {
+  MutableS2ShapeIndex index;
+  for (int i = 0; i < 500; ++i) {
+    index.Add(make_unique<S2LaxPolylineShape>(
+        *s2textformat::MakePolylineOrDie(absl::StrFormat(
+            "%d:0, %d:1, %d:2", i % 80, i % 80, i % 80 + 1))));
+  }
+  Encoder encoder;
+  ASSERT_TRUE(s2shapeutil::FastEncodeTaggedShapes(index, &encoder));
+  Encoder parallel_encoder;
+  ASSERT_TRUE(s2shapeutil::FastEncodeTaggedShapes(index, &parallel_encoder, 4));
+  EXPECT_EQ(
+      absl::string_view(encoder.base(), encoder.length()),
+      absl::string_view(parallel_encoder.base(), parallel_encoder.length()));
+
+  // Errors reported by the shape encoder are propagated.
+  Encoder failed_encoder;
+  EXPECT_FALSE(s2shapeutil::EncodeTaggedShapes(
+      index,
+      [&](const S2Shape& shape, Encoder*) {
+        return &shape != index.shape(300);
+      },
+      &failed_encoder, 4));
+}
+
+TEST(EncodeTaggedShards, SplitsByPartition) {
+  // Build an index with one small loop centered on each cube face, and split
+  // it into two shards of three faces each.
+  MutableS2ShapeIndex index;
+  s2testing::AddFaceLoops(100, &index);
+  std::vector<S2CellUnion> partitions = {
+      S2CellUnion({S2CellId::FromFace(0), S2CellId::FromFace(1),
+                   S2CellId::FromFace(2)}),
+      S2CellUnion({S2CellId::FromFace(3), S2CellId::FromFace(4),
+                   S2CellId::FromFace(5)})};
+  std::vector<string> shards;
+  ASSERT_TRUE(EncodeTaggedShards(index, partitions, CompactEncodeShape,
+                                 &shards));
+  ASSERT_EQ(shards.size(), 2);
+  for (int i = 0; i < 2; ++i) {
+    Decoder decoder(shards[i].data(), shards[i].size());
+    S2Error error;
+    auto factory = LazyDecodeShapeFactory(&decoder, error);
+    ASSERT_TRUE(error.ok()) << error;
+    EncodedS2ShapeIndex shard;
+    ASSERT_TRUE(shard.Init(&decoder, factory));
+    ASSERT_EQ(shard.num_shape_ids(), 6);
+    auto query = MakeS2ContainsPointQuery(&shard);
+    for (int face = 0; face < 6; ++face) {
+      // Each shard contains only the shapes in its own partition.
+      const bool in_shard = face / 3 == i;
+      EXPECT_EQ(shard.shape(face) != nullptr, in_shard);
+      EXPECT_EQ(query.Contains(S2CellId::FromFace(face).ToPoint()), in_shard);
+    }
+  }
+}
+
+TEST(EncodeMergedIndexes, MatchesReindexing) {
+  // Three indexes whose loops overlap around the center of face 0, where
+  // their cells are subdivided to different levels.
+  const S2Point center = S2CellId::FromFace(0).ToPoint();
+  auto add_loop = [](MutableS2ShapeIndex* index, const S2Point& loop_center,
+                     double radius_degrees, int num_vertices) {
+    S2Polygon polygon(S2Loop::MakeRegularLoop(
+        loop_center, S1Angle::Degrees(radius_degrees), num_vertices));
+    index->Add(make_unique<S2LaxPolygonShape>(polygon));
+  };
+  MutableS2ShapeIndex a, b, c, expected;
+  for (MutableS2ShapeIndex* index : {&a, &expected}) {
+    add_loop(index, center, 5, 200);
+    add_loop(index, center, 10, 50);
+  }
+  const S2Point offset = S2LatLng::FromDegrees(3, 4).ToPoint();
+  for (MutableS2ShapeIndex* index : {&b, &expected}) {
+    add_loop(index, offset, 7, 300);
+    add_loop(index, S2CellId::FromFace(3).ToPoint(), 5, 100);
+  }
+  for (MutableS2ShapeIndex* index : {&c, &expected}) {
+    add_loop(index, S2LatLng::FromDegrees(-2, -3).ToPoint(), 1, 500);
+  }
+  Encoder encoder;
+  ASSERT_TRUE(EncodeMergedIndexes({&a, &b, &c}, CompactEncodeShape, &encoder));
+  Decoder decoder(encoder.base(), encoder.length());
+  S2Error error;
+  auto factory = LazyDecodeShapeFactory(&decoder, error);
+  ASSERT_TRUE(error.ok()) << error;
+  EncodedS2ShapeIndex merged;
+  ASSERT_TRUE(merged.Init(&decoder, factory));
+  ASSERT_EQ(merged.num_shape_ids(), expected.num_shape_ids());
+
+  // Queries on the merged index give the same results as queries on an
+  // index built from scratch.
+  absl::BitGen bitgen(S2Testing::MakeTaggedSeedSeq(
+      "MERGED_INDEXES", absl::LogInfoStreamer(__FILE__, __LINE__).stream()));
+  auto expected_query = MakeS2ContainsPointQuery(&expected);
+  auto merged_query = MakeS2ContainsPointQuery(&merged);
+  S2ClosestEdgeQuery expected_edges(&expected), merged_edges(&merged);
+  const S2Cap cap(center, S1Angle::Degrees(15));
+  for (int i = 0; i < 1000; ++i) {
+    S2Point p = i % 4 == 0 ? s2random::Point(bitgen)
+                           : s2random::SamplePoint(bitgen, cap);
+    EXPECT_EQ(expected_query.GetContainingShapeIds(p),
+              merged_query.GetContainingShapeIds(p));
+    S2ClosestEdgeQuery::PointTarget target(p);
+    EXPECT_EQ(expected_edges.GetDistance(&target),
+              merged_edges.GetDistance(&target));
+  }
+}
+
 TEST(DecodeTaggedShapes, DecodeFromByteString) {
   auto index = s2textformat::MakeIndexOrDie(
       "0:0 | 0:1 # 1:1, 1:2, 1:3 # 2:2; 2:3, 2:4, 3:3");
@@ -25,8 +25,13 @@ namespace s2shapeutil {
 
 bool ContainsBruteForce(const S2Shape& shape, const S2Point& point) {
   if (shape.dimension() < 2) return false;
+  return ContainsBruteForce(shape, shape.GetReferencePoint(), point);
+}
 
-  S2Shape::ReferencePoint ref_point = shape.GetReferencePoint();
+bool ContainsBruteForce(const S2Shape& shape,
+                        const S2Shape::ReferencePoint& ref_point,
+                        const S2Point& point) {
+  if (shape.dimension() < 2) return false;
   if (ref_point.point == point) return ref_point.contained;
 
   S2CopyingEdgeCrosser crosser(ref_point.point, point);
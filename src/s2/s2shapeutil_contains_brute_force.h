@@ -37,6 +37,14 @@ namespace s2shapeutil {
 //         linear in the number of shape edges.
 bool ContainsBruteForce(const S2Shape& shape, const S2Point& point);
 
+// Like the function above, but uses the given value of
+// shape.GetReferencePoint().  This is useful when the reference point has
+// been cached, since computing it can be as expensive as the test itself
+// (e.g., for S2LaxPolygonShape).
+bool ContainsBruteForce(const S2Shape& shape,
+                        const S2Shape::ReferencePoint& ref_point,
+                        const S2Point& point);
+
 }  // namespace s2shapeutil
 
 #endif  // S2_S2SHAPEUTIL_CONTAINS_BRUTE_FORCE_H_
@@ -0,0 +1,242 @@
+// Copyright 2024 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "s2/s2shapeutil_index_delta.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "absl/strings/string_view.h"
+#include "s2/util/coding/coder.h"
+#include "s2/encoded_s2cell_id_vector.h"
+#include "s2/encoded_string_vector.h"
+#include "s2/encoded_uint_vector.h"
+#include "s2/mutable_s2shape_index.h"
+#include "s2/s2cell_id.h"
+#include "s2/s2shape.h"
+#include "s2/s2shape_index.h"
+#include "s2/s2shapeutil_coding.h"
+
+using absl::string_view;
+using std::vector;
+
+namespace s2shapeutil {
+
+namespace {
+
+// The delta encoding consists of:
+//
+//   varint32: kCurrentDeltaVersion
+//   varint32: max_edges_per_cell() of the updated index
+//   varint32: number of shape ids in the base index
+//   varint64: number of cells in the base index
+//   varint32: number of shape ids in the updated index
+//   EncodedUintVector<uint32_t>: ids of removed shapes (in increasing order)
+//   EncodedStringVector: tagged encodings of the added shapes
+//   EncodedUintVector<uint64_t>: (copy, skip, insert) triples
+//   EncodedS2CellIdVector: ids of the inserted cells
+//   EncodedStringVector: encodings of the inserted cells
+//
+// Each triple copies the next "copy" cells of the base index to the output,
+// discards the following "skip" base cells, and then appends the next
+// "insert" inserted cells.
+constexpr uint32_t kCurrentDeltaVersion = 1;
+
+// Returns the encoding of "cell" in an index with "num_shape_ids" shapes.
+string_view EncodeCell(const S2ShapeIndexCell& cell, int num_shape_ids,
+                       Encoder* encoder) {
+  encoder->clear();
+  cell.Encode(num_shape_ids, encoder);
+  return string_view(encoder->base(), encoder->length());
+}
+
+}  // namespace
+
+bool EncodeIndexDelta(const S2ShapeIndex& base,
+                      const MutableS2ShapeIndex& updated,
+                      const ShapeEncoder& shape_encoder, Encoder* encoder) {
+  // Shape ids are never reused, so shapes can only be removed or appended.
+  const int base_num_shape_ids = base.num_shape_ids();
+  if (updated.num_shape_ids() < base_num_shape_ids) return false;
+  vector<uint32_t> removed_ids;
+  for (int id = 0; id < base_num_shape_ids; ++id) {
+    if (updated.shape(id) != nullptr) {
+      if (base.shape(id) == nullptr) return false;
+    } else if (base.shape(id) != nullptr) {
+      removed_ids.push_back(id);
+    }
+  }
+  s2coding::StringVectorEncoder added_shapes;
+  for (int id = base_num_shape_ids; id < updated.num_shape_ids(); ++id) {
+    Encoder* sub_encoder = added_shapes.AddViaEncoder();
+    const S2Shape* shape = updated.shape(id);
+    if (shape == nullptr) continue;  // Encode as zero bytes.
+
+    sub_encoder->Ensure(Encoder::kVarintMax32);
+    sub_encoder->put_varint32(shape->type_tag());
+    if (!shape_encoder(*shape, sub_encoder)) return false;
+  }
+
+  // Both iterators visit cells in increasing S2CellId order, so the cells
+  // can be compared in a single merge pass.  Cells are compared by their
+  // encodings since this is what ApplyIndexDelta() copies.
+  vector<uint64_t> ops;
+  uint64_t copy = 0, skip = 0, insert = 0;
+  vector<S2CellId> inserted_ids;
+  s2coding::StringVectorEncoder inserted_cells;
+  uint64_t base_num_cells = 0;
+  Encoder base_cell_encoder, cell_encoder;
+  S2ShapeIndex::Iterator base_it(&base, S2ShapeIndex::BEGIN);
+  MutableS2ShapeIndex::Iterator it(&updated, S2ShapeIndex::BEGIN);
+  while (!base_it.done() || !it.done()) {
+    bool skip_base =
+        it.done() || (!base_it.done() && base_it.id() <= it.id());
+    bool insert_cell =
+        base_it.done() || (!it.done() && it.id() <= base_it.id());
+    string_view cell;
+    if (insert_cell) {
+      cell = EncodeCell(it.cell(), updated.num_shape_ids(), &cell_encoder);
+    }
+    if (skip_base && insert_cell &&
+        EncodeCell(base_it.cell(), base_num_shape_ids, &base_cell_encoder) ==
+            cell) {
+      // Start a new triple unless the current one consists only of copies.
+      if (skip > 0 || insert > 0) {
+        ops.insert(ops.end(), {copy, skip, insert});
+        copy = skip = insert = 0;
+      }
+      ++copy;
+    } else {
+      if (skip_base) ++skip;
+      if (insert_cell) {
+        ++insert;
+        inserted_ids.push_back(it.id());
+        inserted_cells.Add(cell);
+      }
+    }
+    if (skip_base) {
+      base_it.Next();
+      ++base_num_cells;
+    }
+    if (insert_cell) it.Next();
+  }
+  if (copy > 0 || skip > 0 || insert > 0) {
+    ops.insert(ops.end(), {copy, skip, insert});
+  }
+
+  encoder->Ensure(Encoder::kVarintMax32 * 4 + Encoder::kVarintMax64);
+  encoder->put_varint32(kCurrentDeltaVersion);
+  encoder->put_varint32(updated.options().max_edges_per_cell());
+  encoder->put_varint32(base_num_shape_ids);
+  encoder->put_varint64(base_num_cells);
+  encoder->put_varint32(updated.num_shape_ids());
+  s2coding::EncodeUintVector<uint32_t>(removed_ids, encoder);
+  added_shapes.Encode(encoder);
+  s2coding::EncodeUintVector<uint64_t>(ops, encoder);
+  s2coding::EncodeS2CellIdVector(inserted_ids, encoder);
+  inserted_cells.Encode(encoder);
+  return true;
+}
+
+bool EncodeIndexDelta(const S2ShapeIndex& base,
+                      const MutableS2ShapeIndex& updated, Encoder* encoder) {
+  return EncodeIndexDelta(base, updated, CompactEncodeShape, encoder);
+}
+
+bool ApplyIndexDelta(Decoder* base, Decoder* delta, Encoder* encoder) {
+  // Decode the base shape vector and index.
+  s2coding::EncodedStringVector base_shapes;
+  uint64_t base_header;
+  s2coding::EncodedS2CellIdVector base_cell_ids;
+  s2coding::EncodedStringVector base_cells;
+  if (!base_shapes.Init(base) || !base->get_varint64(&base_header) ||
+      !base_cell_ids.Init(base) || !base_cells.Init(base) ||
+      base_cell_ids.size() != base_cells.size()) {
+    return false;
+  }
+
+  // Decode the delta.
+  uint32_t version, max_edges, base_num_shape_ids, num_shape_ids;
+  uint64_t base_num_cells;
+  s2coding::EncodedUintVector<uint32_t> removed_ids;
+  s2coding::EncodedStringVector added_shapes;
+  s2coding::EncodedUintVector<uint64_t> ops;
+  s2coding::EncodedS2CellIdVector inserted_ids;
+  s2coding::EncodedStringVector inserted_cells;
+  if (!delta->get_varint32(&version) || version != kCurrentDeltaVersion ||
+      !delta->get_varint32(&max_edges) ||
+      !delta->get_varint32(&base_num_shape_ids) ||
+      !delta->get_varint64(&base_num_cells) ||
+      !delta->get_varint32(&num_shape_ids) || !removed_ids.Init(delta) ||
+      !added_shapes.Init(delta) || !ops.Init(delta) ||
+      !inserted_ids.Init(delta) || !inserted_cells.Init(delta)) {
+    return false;
+  }
+  if (base_num_shape_ids != base_shapes.size() ||
+      base_num_cells != base_cells.size() ||
+      num_shape_ids != base_num_shape_ids + added_shapes.size() ||
+      inserted_ids.size() != inserted_cells.size() || ops.size() % 3 != 0) {
+    return false;
+  }
+
+  // Removed shapes are encoded as zero bytes (like EncodeTaggedShapes).
+  s2coding::StringVectorEncoder shapes;
+  size_t r = 0;
+  for (uint32_t id = 0; id < base_num_shape_ids; ++id) {
+    if (r < removed_ids.size() && removed_ids[r] == id) {
+      shapes.Add("");
+      ++r;
+    } else {
+      shapes.Add(base_shapes[id]);
+    }
+  }
+  if (r != removed_ids.size()) return false;
+  for (size_t i = 0; i < added_shapes.size(); ++i) {
+    shapes.Add(added_shapes[i]);
+  }
+
+  // Merge the cells.
+  vector<S2CellId> cell_ids;
+  s2coding::StringVectorEncoder cells;
+  uint64_t b = 0, k = 0;
+  for (size_t i = 0; i < ops.size(); i += 3) {
+    uint64_t copy = ops[i], skip = ops[i + 1], insert = ops[i + 2];
+    if (copy + skip > base_num_cells - b ||
+        insert > inserted_ids.size() - k) {
+      return false;
+    }
+    for (uint64_t end = b + copy; b < end; ++b) {
+      cell_ids.push_back(base_cell_ids[b]);
+      cells.Add(base_cells[b]);
+    }
+    b += skip;
+    for (uint64_t end = k + insert; k < end; ++k) {
+      cell_ids.push_back(inserted_ids[k]);
+      cells.Add(inserted_cells[k]);
+    }
+  }
+  if (b != base_num_cells || k != inserted_ids.size()) return false;
+
+  shapes.Encode(encoder);
+  // The updated index uses the same encoding version as the base index.
+  encoder->Ensure(Encoder::kVarintMax64);
+  encoder->put_varint64(uint64_t{max_edges} << 2 | (base_header & 3));
+  s2coding::EncodeS2CellIdVector(cell_ids, encoder);
+  cells.Encode(encoder);
+  return true;
+}
+
+}  // namespace s2shapeutil
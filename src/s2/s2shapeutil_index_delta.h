@@ -0,0 +1,88 @@
+// Copyright 2024 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+// Functions for distributing changes to a large encoded S2ShapeIndex without
+// re-sending the entire encoding.  The publisher computes a "delta" that
+// records the shapes that were added and removed since a base version,
+// together with the index cells that changed:
+//
+//   // "base" is the index that clients already have, and "updated" is a
+//   // MutableS2ShapeIndex obtained from it by adding and removing shapes.
+//   Encoder delta;
+//   s2shapeutil::EncodeIndexDelta(base, updated, &delta);
+//
+// Each client then merges the delta into its copy of the base encoding (a
+// tagged shape vector followed by the index, as written by
+// CompactEncodeTaggedShapes() and MutableS2ShapeIndex::Encode()), and loads
+// the result as usual:
+//
+//   Decoder base_decoder(base_data.data(), base_data.size());
+//   Decoder delta_decoder(delta_data.data(), delta_data.size());
+//   Encoder encoder;
+//   if (!s2shapeutil::ApplyIndexDelta(&base_decoder, &delta_decoder,
+//                                     &encoder)) { ... }
+//   Decoder decoder(encoder.base(), encoder.length());
+//   index.Init(&decoder, s2shapeutil::LazyDecodeShapeFactory(&decoder));
+//
+// Merging copies the unchanged shapes and cells as raw bytes (nothing is
+// decoded), so it is much faster than re-encoding the index, and the result
+// is byte-for-byte identical to encoding "updated" from scratch.
+
+#ifndef S2_S2SHAPEUTIL_INDEX_DELTA_H_
+#define S2_S2SHAPEUTIL_INDEX_DELTA_H_
+
+#include "s2/util/coding/coder.h"
+#include "s2/mutable_s2shape_index.h"
+#include "s2/s2shape_index.h"
+#include "s2/s2shapeutil_coding.h"
+
+namespace s2shapeutil {
+
+// Encodes the changes needed to transform "base" into "updated".  Shapes
+// added to "updated" are encoded using "shape_encoder" (which should match
+// the encoder used for the base shape vector).
+//
+// Shape ids that are present in both indexes are assumed to refer to the
+// same shape.  This is true when "updated" was derived from "base" by calling
+// MutableS2ShapeIndex::Add() and Release(), since shape ids are never
+// reused; note that S2Shapes are immutable, so a modified shape must be
+// released and added again.  Every cell of both indexes is visited, which
+// means that all of "base" is decoded if it is an EncodedS2ShapeIndex.
+//
+// REQUIRES: "encoder" uses the default constructor, so that its buffer
+//           can be enlarged as necessary by calling Ensure(int).
+bool EncodeIndexDelta(const S2ShapeIndex& base,
+                      const MutableS2ShapeIndex& updated,
+                      const ShapeEncoder& shape_encoder, Encoder* encoder);
+
+// Convenience function that calls EncodeIndexDelta using CompactEncodeShape
+// as the ShapeEncoder.
+bool EncodeIndexDelta(const S2ShapeIndex& base,
+                      const MutableS2ShapeIndex& updated, Encoder* encoder);
+
+// Applies a delta produced by EncodeIndexDelta() to "base", which must
+// contain an encoded tagged shape vector followed by an encoded S2ShapeIndex.
+// Appends the updated shape vector and index (in the same format) to
+// "encoder".  Returns false if either input is corrupt or if the delta was
+// computed against a different base (as far as can be detected cheaply: the
+// number of shapes and cells must match).
+//
+// REQUIRES: "encoder" uses the default constructor, so that its buffer
+//           can be enlarged as necessary by calling Ensure(int).
+bool ApplyIndexDelta(Decoder* base, Decoder* delta, Encoder* encoder);
+
+}  // namespace s2shapeutil
+
+#endif  // S2_S2SHAPEUTIL_INDEX_DELTA_H_
@@ -0,0 +1,173 @@
+// Copyright 2024 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "s2/s2shapeutil_index_delta.h"
+
+#include <memory>
+#include <string>
+
+#include <gtest/gtest.h>
+#include "absl/log/absl_check.h"
+#include "s2/util/coding/coder.h"
+#include "s2/encoded_s2shape_index.h"
+#include "s2/mutable_s2shape_index.h"
+#include "s2/s1angle.h"
+#include "s2/s2cell_id.h"
+#include "s2/s2error.h"
+#include "s2/s2lax_polygon_shape.h"
+#include "s2/s2loop.h"
+#include "s2/s2polygon.h"
+#include "s2/s2shapeutil_coding.h"
+#include "s2/s2shapeutil_testing.h"
+#include "s2/s2text_format.h"
+
+using std::make_unique;
+using std::string;
+
+namespace s2shapeutil {
+namespace {
+
+// Returns the encoded tagged shapes of "index" followed by the index itself.
+string EncodeTaggedIndex(const MutableS2ShapeIndex& index) {
+  Encoder encoder;
+  ABSL_CHECK(CompactEncodeTaggedShapes(index, &encoder));
+  index.Encode(&encoder);
+  return string(encoder.base(), encoder.length());
+}
+
+// Returns a small loop centered on the given S2CellId.
+std::unique_ptr<S2Shape> MakeLoopShape(S2CellId id) {
+  S2Polygon polygon(
+      S2Loop::MakeRegularLoop(id.ToPoint(), S1Angle::Degrees(0.5), 50));
+  return make_unique<S2LaxPolygonShape>(polygon);
+}
+
+// Decodes "encoded" into a MutableS2ShapeIndex with the same shape ids.
+void DecodeMutableIndex(const string& encoded, MutableS2ShapeIndex* index) {
+  Decoder decoder(encoded.data(), encoded.size());
+  S2Error error;
+  ABSL_CHECK(index->Init(&decoder, FullDecodeShapeFactory(&decoder, error)));
+  ABSL_CHECK(error.ok()) << error;
+}
+
+// Computes the delta from "base_encoded" to "updated", applies it, and checks
+// that the result matches encoding "updated" from scratch.  Returns the size of
+// the delta.
+size_t TestDelta(const string& base_encoded,
+                 const MutableS2ShapeIndex& updated) {
+  Decoder decoder(base_encoded.data(), base_encoded.size());
+  EncodedS2ShapeIndex base;
+  ABSL_CHECK(base.Init(&decoder, LazyDecodeShapeFactory(&decoder)));
+  Encoder delta;
+  EXPECT_TRUE(EncodeIndexDelta(base, updated, &delta));
+
+  Decoder base_decoder(base_encoded.data(), base_encoded.size());
+  Decoder delta_decoder(delta.base(), delta.length());
+  Encoder merged;
+  EXPECT_TRUE(ApplyIndexDelta(&base_decoder, &delta_decoder, &merged));
+  EXPECT_EQ(string(merged.base(), merged.length()), EncodeTaggedIndex(updated));
+  return delta.length();
+}
+
+TEST(IndexDelta, AddAndRemoveShapes) {
+  MutableS2ShapeIndex index;
+  for (S2CellId id = S2CellId::Begin(3); id != S2CellId::End(3);
+       id = id.next()) {
+    index.Add(MakeLoopShape(id));
+  }
+  const string base_encoded = EncodeTaggedIndex(index);
+
+  // An unchanged index yields a tiny delta.
+  MutableS2ShapeIndex updated;
+  DecodeMutableIndex(base_encoded, &updated);
+  EXPECT_LT(TestDelta(base_encoded, updated), 50);
+
+  // Changing a few shapes yields a delta that is much smaller than the index.
+  updated.Release(10);
+  updated.Release(200);
+  updated.Add(MakeLoopShape(S2CellId::FromFace(2).child_begin(6)));
+  updated.Add(MakeLoopShape(S2CellId::FromFace(5).child_begin(6)));
+  const size_t delta_size = TestDelta(base_encoded, updated);
+  EXPECT_LT(delta_size * 20, base_encoded.size());
+
+  // Check that the merged encoding decodes into the same index.
+  Decoder base_decoder(base_encoded.data(), base_encoded.size());
+  EncodedS2ShapeIndex base;
+  ASSERT_TRUE(base.Init(&base_decoder, LazyDecodeShapeFactory(&base_decoder)));
+  Encoder delta;
+  ASSERT_TRUE(EncodeIndexDelta(base, updated, &delta));
+  Decoder delta_decoder(delta.base(), delta.length());
+  base_decoder.reset(base_encoded.data(), base_encoded.size());
+  Encoder merged;
+  ASSERT_TRUE(ApplyIndexDelta(&base_decoder, &delta_decoder, &merged));
+  Decoder decoder(merged.base(), merged.length());
+  EncodedS2ShapeIndex actual;
+  ASSERT_TRUE(actual.Init(&decoder, LazyDecodeShapeFactory(&decoder)));
+  s2testing::ExpectEqual(updated, actual);
+}
+
+TEST(IndexDelta, SingleShapeBase) {
+  // Cells are encoded differently when the index has only one shape, so
+  // every cell of the base index must be replaced.
+  auto base_index = s2textformat::MakeIndexOrDie("# # 0:0, 0:5, 5:5, 5:0");
+  const string base_encoded = EncodeTaggedIndex(*base_index);
+  MutableS2ShapeIndex updated;
+  DecodeMutableIndex(base_encoded, &updated);
+  updated.Add(MakeLoopShape(S2CellId::FromFace(4)));
+  TestDelta(base_encoded, updated);
+}
+
+TEST(IndexDelta, EmptyBase) {
+  MutableS2ShapeIndex empty;
+  const string base_encoded = EncodeTaggedIndex(empty);
+  MutableS2ShapeIndex updated;
+  updated.Add(MakeLoopShape(S2CellId::FromFace(1)));
+  TestDelta(base_encoded, updated);
+
+  // Removing every shape is also supported.
+  MutableS2ShapeIndex emptied;
+  DecodeMutableIndex(EncodeTaggedIndex(updated), &emptied);
+  emptied.Release(0);
+  TestDelta(EncodeTaggedIndex(updated), emptied);
+}
+
+TEST(IndexDelta, WrongBase) {
+  MutableS2ShapeIndex index;
+  index.Add(MakeLoopShape(S2CellId::FromFace(0)));
+  index.Add(MakeLoopShape(S2CellId::FromFace(1)));
+  const string base_encoded = EncodeTaggedIndex(index);
+  MutableS2ShapeIndex updated;
+  DecodeMutableIndex(base_encoded, &updated);
+  updated.Add(MakeLoopShape(S2CellId::FromFace(2)));
+  Encoder delta;
+  ASSERT_TRUE(EncodeIndexDelta(index, updated, &delta));
+
+  // Applying the delta to a different base fails.
+  MutableS2ShapeIndex other;
+  other.Add(MakeLoopShape(S2CellId::FromFace(3)));
+  const string other_encoded = EncodeTaggedIndex(other);
+  Decoder base_decoder(other_encoded.data(), other_encoded.size());
+  Decoder delta_decoder(delta.base(), delta.length());
+  Encoder merged;
+  EXPECT_FALSE(ApplyIndexDelta(&base_decoder, &delta_decoder, &merged));
+
+  // So does applying a truncated delta.
+  base_decoder.reset(base_encoded.data(), base_encoded.size());
+  delta_decoder.reset(delta.base(), delta.length() - 1);
+  EXPECT_FALSE(ApplyIndexDelta(&base_decoder, &delta_decoder, &merged));
+}
+
+}  // namespace
+}  // namespace s2shapeutil
@@ -17,12 +17,20 @@
 
 #include "s2/s2shapeutil_testing.h"
 
+#include <memory>
 #include <string>
 
 #include <gtest/gtest.h>
+#include "s2/mutable_s2shape_index.h"
+#include "s2/s1angle.h"
 #include "s2/s2cell_id.h"
+#include "s2/s2lax_polygon_shape.h"
+#include "s2/s2loop.h"
+#include "s2/s2polygon.h"
 #include "s2/s2shape.h"
 #include "s2/s2shape_index.h"
+#include "s2/s2shapeutil_coding.h"
+#include "s2/util/coding/coder.h"
 
 namespace s2testing {
 
@@ -105,4 +113,20 @@ void ExpectEqual(const S2ShapeIndex& a, const S2ShapeIndex& b) {
   EXPECT_EQ(a_it.id(), b_it.id());
 }
 
+void AddFaceLoops(int num_vertices, MutableS2ShapeIndex* index) {
+  for (int face = 0; face < 6; ++face) {
+    S2Polygon polygon(S2Loop::MakeRegularLoop(
+        S2CellId::FromFace(face).ToPoint(), S1Angle::Degrees(5),
+        num_vertices));
+    index->Add(std::make_unique<S2LaxPolygonShape>(polygon));
+  }
+}
+
+std::string CompactEncodeIndexAndShapes(const MutableS2ShapeIndex& index) {
+  Encoder encoder;
+  EXPECT_TRUE(s2shapeutil::CompactEncodeTaggedShapes(index, &encoder));
+  index.Encode(&encoder);
+  return std::string(encoder.base(), encoder.length());
+}
+
 }  // namespace s2testing
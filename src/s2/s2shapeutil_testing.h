@@ -18,6 +18,9 @@
 #ifndef S2_S2SHAPEUTIL_TESTING_H_
 #define S2_S2SHAPEUTIL_TESTING_H_
 
+#include <string>
+
+#include "s2/mutable_s2shape_index.h"
 #include "s2/s2shape.h"
 #include "s2/s2shape_index.h"
 
@@ -31,6 +34,16 @@ void ExpectEqual(const S2Shape& a, const S2Shape& b);
 // S2Shapes in both indexes).
 void ExpectEqual(const S2ShapeIndex& a, const S2ShapeIndex& b);
 
+// Adds one S2LaxPolygonShape centered on each cube face to "index".  Each
+// shape is a regular loop with "num_vertices" vertices and a radius of 5
+// degrees.
+void AddFaceLoops(int num_vertices, MutableS2ShapeIndex* index);
+
+// Returns the shapes of "index" encoded with CompactEncodeTaggedShapes,
+// followed by the encoded index itself.  This is the layout expected by
+// EncodedS2ShapeIndex together with s2shapeutil::LazyDecodeShapeFactory.
+std::string CompactEncodeIndexAndShapes(const MutableS2ShapeIndex& index);
+
 }  // namespace s2testing
 
 #endif  // S2_S2SHAPEUTIL_TESTING_H_
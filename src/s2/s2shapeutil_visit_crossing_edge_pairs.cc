@@ -17,6 +17,8 @@
 
 #include "s2/s2shapeutil_visit_crossing_edge_pairs.h"
 
+#include <algorithm>
+#include <atomic>
 #include <cstdint>
 #include <string>
 #include <vector>
@@ -24,6 +26,8 @@
 #include "absl/container/inlined_vector.h"
 #include "absl/log/absl_check.h"
 #include "absl/strings/str_format.h"
+#include "s2/internal/s2parallel.h"
+#include "s2/s2cell_iterator.h"
 #include "s2/s2cell_id.h"
 #include "s2/s2cell_range_iterator.h"
 #include "s2/s2crossing_edge_query.h"
@@ -120,7 +124,8 @@ static bool VisitCrossings(const ShapeEdgeVector& shape_edges,
 // Visits all pairs of crossing edges in the given S2ShapeIndex, terminating
 // early if the given EdgePairVisitor function returns false (in which case
 // VisitCrossings returns false as well).  "type" indicates whether all
-// crossings should be visited, or only interior crossings.
+// crossings should be visited, or only interior crossings.  Only the index
+// cells whose range_min() is in the half-open range [begin, end) are visited.
 //
 // If "need_adjacent" is false, then edge pairs of the form (AB, BC) may
 // optionally be ignored (even if the two edges belong to different edge
@@ -128,13 +133,15 @@ static bool VisitCrossings(const ShapeEdgeVector& shape_edges,
 // which does not need such edge pairs (see below).
 static bool VisitCrossings(
     const S2ShapeIndex& index, CrossingType type, bool need_adjacent,
-    const EdgePairVisitor& visitor) {
+    const EdgePairVisitor& visitor,
+    S2CellId begin = S2CellId::Begin(S2CellId::kMaxLevel),
+    S2CellId end = S2CellId::End(S2CellId::kMaxLevel)) {
   // TODO(b/262264880): Use brute force if the total number of edges is small
   // enough (using a larger threshold if the S2ShapeIndex is not constructed
   // yet).
   ShapeEdgeVector shape_edges;
-  for (S2ShapeIndex::Iterator it(&index, S2ShapeIndex::BEGIN);
-       !it.done(); it.Next()) {
+  S2ShapeIndex::Iterator it(&index);
+  for (it.Seek(begin); !it.done() && it.id().range_min() < end; it.Next()) {
     GetShapeEdges(index, it.cell(), &shape_edges);
     if (!VisitCrossings(shape_edges, type, need_adjacent, visitor)) {
       return false;
@@ -330,9 +337,15 @@ bool IndexCrosser::VisitCrossings(
   return true;
 }
 
-bool VisitCrossingEdgePairs(const S2ShapeIndex& a_index,
-                            const S2ShapeIndex& b_index,
-                            CrossingType type, const EdgePairVisitor& visitor) {
+// Visits all pairs of crossing edges where one edge comes from each index and
+// the crossing is found while processing index cells whose range_min() is in
+// the half-open range [begin, end).  REQUIRES: no index cell of either index
+// contains both "begin" and begin.prev() (and similarly for "end").
+static bool VisitCrossingEdgePairsInRange(const S2ShapeIndex& a_index,
+                                          const S2ShapeIndex& b_index,
+                                          CrossingType type,
+                                          const EdgePairVisitor& visitor,
+                                          S2CellId begin, S2CellId end) {
   // We look for S2CellId ranges where the indexes of A and B overlap, and
   // then test those edges for crossings.
 
@@ -341,9 +354,14 @@ bool VisitCrossingEdgePairs(const S2ShapeIndex& a_index,
   // yet).
   auto ai = MakeS2CellRangeIterator(&a_index);
   auto bi = MakeS2CellRangeIterator(&b_index);
+  ai.Seek(begin);
+  bi.Seek(begin);
   IndexCrosser ab(a_index, b_index, type, visitor, false);  // Tests A against B
   IndexCrosser ba(b_index, a_index, type, visitor, true);   // Tests B against A
-  while (!ai.done() || !bi.done()) {
+
+  // Note that range_min() returns a value larger than "end" once an iterator
+  // is done.
+  while (ai.range_min() < end || bi.range_min() < end) {
     if (ai.range_max() < bi.range_min()) {
       // The A and B cells don't overlap, and A precedes B.
       ai.SeekTo(bi);
@@ -375,6 +393,120 @@ bool VisitCrossingEdgePairs(const S2ShapeIndex& a_index,
   return true;
 }
 
+bool VisitCrossingEdgePairs(const S2ShapeIndex& a_index,
+                            const S2ShapeIndex& b_index,
+                            CrossingType type, const EdgePairVisitor& visitor) {
+  return VisitCrossingEdgePairsInRange(
+      a_index, b_index, type, visitor, S2CellId::Begin(S2CellId::kMaxLevel),
+      S2CellId::End(S2CellId::kMaxLevel));
+}
+
+// Returns the largest leaf cell id "x <= id" such that no index cell of the
+// given index contains both "x" and x.prev().
+static S2CellId AlignToIndexCell(S2ShapeIndex::Iterator* it, S2CellId id) {
+  if (it->Locate(id) == S2CellRelation::INDEXED) return it->id().range_min();
+  return id;
+}
+
+// Returns "num_shards + 1" nondecreasing leaf cell ids that divide the
+// S2CellId space into ranges with roughly equal numbers of index edges (as
+// measured by the total number of clipped edges in each range), such that no
+// index cell of A or B spans a range boundary.
+static vector<S2CellId> GetShardBoundaries(const S2ShapeIndex& a_index,
+                                           const S2ShapeIndex& b_index,
+                                           int num_shards) {
+  vector<S2CellId> bounds = {S2CellId::Begin(S2CellId::kMaxLevel)};
+  S2ShapeIndex::Iterator ai(&a_index, S2ShapeIndex::BEGIN);
+  S2ShapeIndex::Iterator bi(&b_index, S2ShapeIndex::BEGIN);
+  int64_t total_edges = 0;
+  for (; !ai.done(); ai.Next()) total_edges += ai.cell().num_edges();
+  for (; !bi.done(); bi.Next()) total_edges += bi.cell().num_edges();
+
+  // Walk through the cells of both indexes in S2CellId order and choose a
+  // candidate boundary whenever the next multiple of the target shard size
+  // is reached.  (Note that id() returns S2CellId::Sentinel() once an
+  // iterator is done.)
+  ai.Begin();
+  bi.Begin();
+  int64_t num_edges = 0;
+  for (int shard = 1; shard < num_shards; ++shard) {
+    int64_t target_edges = total_edges * shard / num_shards;
+    S2CellId candidate = S2CellId::End(S2CellId::kMaxLevel);
+    while (!ai.done() || !bi.done()) {
+      S2ShapeIndex::Iterator* it = (ai.id() < bi.id()) ? &ai : &bi;
+      if (num_edges >= target_edges) {
+        candidate = it->id().range_min();
+        break;
+      }
+      num_edges += it->cell().num_edges();
+      it->Next();
+    }
+    // Move the candidate backwards until it does not split any index cell.
+    // Each step moves to the start of a larger cell, so this terminates.
+    if (candidate.is_valid()) {
+      S2ShapeIndex::Iterator a_locate(&a_index), b_locate(&b_index);
+      for (S2CellId prev; prev != candidate;) {
+        prev = candidate;
+        candidate = AlignToIndexCell(&a_locate, candidate);
+        candidate = AlignToIndexCell(&b_locate, candidate);
+      }
+    }
+    // Aligning may move a boundary before the previous boundary (which is
+    // also aligned), in which case the shard in between is empty.
+    bounds.push_back(std::max(bounds.back(), candidate));
+  }
+  bounds.push_back(S2CellId::End(S2CellId::kMaxLevel));
+  return bounds;
+}
+
+bool VisitCrossingEdgePairs(const S2ShapeIndex& a_index,
+                            const S2ShapeIndex& b_index, CrossingType type,
+                            int num_shards, int num_threads,
+                            const ShardedEdgePairVisitor& visitor) {
+  ABSL_DCHECK_GE(num_shards, 1);
+  const vector<S2CellId> bounds =
+      GetShardBoundaries(a_index, b_index, num_shards);
+  std::atomic<bool> done{false};
+  s2internal::ParallelFor(num_threads, num_shards, [&](int shard) {
+    if (done.load(std::memory_order_relaxed)) return;
+    EdgePairVisitor shard_visitor = [&, shard](const ShapeEdge& a,
+                                               const ShapeEdge& b,
+                                               bool is_interior) {
+      if (done.load(std::memory_order_relaxed)) return false;
+      return visitor(shard, a, b, is_interior);
+    };
+    if (!VisitCrossingEdgePairsInRange(a_index, b_index, type, shard_visitor,
+                                       bounds[shard], bounds[shard + 1])) {
+      done.store(true, std::memory_order_relaxed);
+    }
+  });
+  return !done.load(std::memory_order_relaxed);
+}
+
+bool VisitCrossingEdgePairs(const S2ShapeIndex& index, CrossingType type,
+                            int num_shards, int num_threads,
+                            const ShardedEdgePairVisitor& visitor) {
+  ABSL_DCHECK_GE(num_shards, 1);
+  // Passing the same index twice simply counts each edge twice.
+  const vector<S2CellId> bounds = GetShardBoundaries(index, index, num_shards);
+  const bool need_adjacent = (type == CrossingType::ALL);
+  std::atomic<bool> done{false};
+  s2internal::ParallelFor(num_threads, num_shards, [&](int shard) {
+    if (done.load(std::memory_order_relaxed)) return;
+    EdgePairVisitor shard_visitor = [&, shard](const ShapeEdge& a,
+                                               const ShapeEdge& b,
+                                               bool is_interior) {
+      if (done.load(std::memory_order_relaxed)) return false;
+      return visitor(shard, a, b, is_interior);
+    };
+    if (!VisitCrossings(index, type, need_adjacent, shard_visitor,
+                        bounds[shard], bounds[shard + 1])) {
+      done.store(true, std::memory_order_relaxed);
+    }
+  });
+  return !done.load(std::memory_order_relaxed);
+}
+
 //////////////////////////////////////////////////////////////////////
 
 // Helper function that formats a loop error message.  If the loop belongs to
@@ -470,4 +602,49 @@ bool FindSelfIntersection(const S2ShapeIndex& index, S2Error* error) {
       });
 }
 
+bool FindSelfIntersection(const S2ShapeIndex& index, S2Error* error,
+                          int num_threads) {
+  ABSL_DCHECK_GE(num_threads, 1);
+  if (num_threads <= 1) return FindSelfIntersection(index, error);
+  if (index.num_shape_ids() == 0) return false;
+  ABSL_DCHECK_EQ(1, index.num_shape_ids());
+  const S2Shape& shape = *index.shape(0);
+
+  // Use several shards per thread so that the load stays balanced when the
+  // crossings are expensive to test in some parts of the index.
+  const int num_shards = 8 * num_threads;
+  const vector<S2CellId> bounds = GetShardBoundaries(index, index, num_shards);
+
+  // Each shard records the first error that it finds.  A shard only gives up
+  // early once an error has been found in some earlier shard, which ensures
+  // that the error reported is the same one that the serial version finds.
+  vector<S2Error> errors(num_shards);
+  std::atomic<int> first_error_shard{num_shards};
+  s2internal::ParallelFor(num_threads, num_shards, [&](int shard) {
+    auto abandoned = [&first_error_shard, shard]() {
+      return first_error_shard.load(std::memory_order_relaxed) < shard;
+    };
+    if (abandoned()) return;
+    bool found = false;
+    VisitCrossings(
+        index, CrossingType::ALL, false /*need_adjacent*/,
+        [&](const ShapeEdge& a, const ShapeEdge& b, bool is_interior) {
+          if (abandoned()) return false;
+          found = FindCrossingError(shape, a, b, is_interior, &errors[shard]);
+          return !found;
+        },
+        bounds[shard], bounds[shard + 1]);
+    if (found) {
+      int prev = first_error_shard.load(std::memory_order_relaxed);
+      while (shard < prev && !first_error_shard.compare_exchange_weak(
+                                 prev, shard, std::memory_order_relaxed)) {
+      }
+    }
+  });
+  const int shard = first_error_shard.load(std::memory_order_relaxed);
+  if (shard == num_shards) return false;
+  *error = errors[shard];
+  return true;
+}
+
 }  // namespace s2shapeutil
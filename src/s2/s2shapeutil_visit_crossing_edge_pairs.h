@@ -56,6 +56,41 @@ bool VisitCrossingEdgePairs(const S2ShapeIndex& a_index,
                             const S2ShapeIndex& b_index,
                             CrossingType type, const EdgePairVisitor& visitor);
 
+// A function that is called with pairs of crossing edges found within the
+// given shard (see below).  Otherwise like EdgePairVisitor.
+using ShardedEdgePairVisitor =
+    std::function<bool(int shard, const ShapeEdge& a, const ShapeEdge& b,
+                       bool is_interior)>;
+
+// Like the above, but divides the S2CellId space into "num_shards" ranges
+// containing roughly equal numbers of index edges and visits the crossings
+// of up to "num_threads" shards concurrently.  Shard "i" is only ever
+// visited by one thread at a time, so the visitor may accumulate results for
+// each shard without locking.  Concatenating the calls for shards 0, 1, ...,
+// num_shards - 1 yields exactly the same sequence of calls as the serial
+// version above.  If any call returns false, the remaining shards are
+// abandoned as quickly as possible and this function returns false.
+//
+// Both indexes must support concurrent read access (which is true of all
+// S2ShapeIndex types in this library).
+bool VisitCrossingEdgePairs(const S2ShapeIndex& a_index,
+                            const S2ShapeIndex& b_index, CrossingType type,
+                            int num_shards, int num_threads,
+                            const ShardedEdgePairVisitor& visitor);
+
+// Like VisitCrossingEdgePairs(index, type, visitor), but divides the index
+// into "num_shards" ranges of index cells containing roughly equal numbers
+// of edges and visits the crossings of up to "num_threads" shards
+// concurrently, each with its own iterator and S2EdgeCrosser.  The guarantees
+// regarding shards, call order, and early termination are the same as for
+// the two-index version above.
+//
+// The index must support concurrent read access (which is true of all
+// S2ShapeIndex types in this library).
+bool VisitCrossingEdgePairs(const S2ShapeIndex& index, CrossingType type,
+                            int num_shards, int num_threads,
+                            const ShardedEdgePairVisitor& visitor);
+
 // Given an S2ShapeIndex containing a single polygonal shape (e.g., an
 // S2Polygon or S2Loop), return true if any loop has a self-intersection
 // (including duplicate vertices) or crosses any other loop (including vertex
@@ -69,6 +104,14 @@ bool VisitCrossingEdgePairs(const S2ShapeIndex& a_index,
 // duplicate vertices and edges are allowed, but loop crossings are not).
 bool FindSelfIntersection(const S2ShapeIndex& index, S2Error* error);
 
+// Like the above, but tests the index cells using up to "num_threads"
+// threads (including the calling thread).  The error reported (if any) is
+// exactly the same as for the serial version.
+//
+// REQUIRES: num_threads >= 1
+bool FindSelfIntersection(const S2ShapeIndex& index, S2Error* error,
+                          int num_threads);
+
 }  // namespace s2shapeutil
 
 #endif  // S2_S2SHAPEUTIL_VISIT_CROSSING_EDGE_PAIRS_H_
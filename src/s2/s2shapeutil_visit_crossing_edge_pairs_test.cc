@@ -18,33 +18,44 @@
 #include "s2/s2shapeutil_visit_crossing_edge_pairs.h"
 
 #include <algorithm>
+#include <atomic>
 #include <iostream>
 #include <memory>
 #include <ostream>
 #include <string>
+#include <tuple>
 #include <utility>
 #include <vector>
 
 #include <gtest/gtest.h>
 
 #include "absl/log/absl_log.h"
+#include "absl/log/log_streamer.h"
+#include "absl/random/random.h"
 #include "absl/strings/string_view.h"
 
+#include "s2/util/math/matrix3x3.h"
 #include "s2/mutable_s2shape_index.h"
+#include "s2/s1angle.h"
 #include "s2/s2crossing_edge_query.h"
 #include "s2/s2debug.h"
 #include "s2/s2edge_crossings.h"
 #include "s2/s2edge_vector_shape.h"
 #include "s2/s2error.h"
+#include "s2/s2fractal.h"
+#include "s2/s2lax_polygon_shape.h"
 #include "s2/s2latlng.h"
 #include "s2/s2loop.h"
 #include "s2/s2point.h"
+#include "s2/s2point_span.h"
 #include "s2/s2polygon.h"
+#include "s2/s2random.h"
 #include "s2/s2shape.h"
 #include "s2/s2shape_index.h"
 #include "s2/s2shapeutil_edge_iterator.h"
 #include "s2/s2shapeutil_shape_edge.h"
 #include "s2/s2shapeutil_shape_edge_id.h"
+#include "s2/s2testing.h"
 #include "s2/s2text_format.h"
 
 using absl::string_view;
@@ -241,12 +252,118 @@ TEST(GetCrossingEdgePairs, EdgeGridTwoIndexes) {
   TestGetCrossingEdgePairs(indexA, indexB, CrossingType::INTERIOR, 108);
 }
 
+// A sequence of visited edge pairs (including the "is_interior" flag).
+using VisitedEdgePairs = vector<std::tuple<ShapeEdgeId, ShapeEdgeId, bool>>;
+
+TEST(VisitCrossingEdgePairs, ShardedMatchesSerial) {
+  // Two overlapping fractals, so that there are many crossings spread over
+  // many index cells.
+  absl::BitGen bitgen(S2Testing::MakeTaggedSeedSeq(
+      "SHARDED_MATCHES_SERIAL",
+      absl::LogInfoStreamer(__FILE__, __LINE__).stream()));
+  S2Fractal fractal(bitgen);
+  fractal.SetLevelForApproxMaxEdges(3000);
+  const Matrix3x3_d frame = s2random::Frame(bitgen);
+  MutableS2ShapeIndex indexA, indexB;
+  indexA.Add(make_unique<S2Loop::OwningShape>(
+      fractal.MakeLoop(frame, S1Angle::Degrees(1))));
+  indexB.Add(make_unique<S2Loop::OwningShape>(
+      fractal.MakeLoop(frame, S1Angle::Degrees(1.1))));
+
+  VisitedEdgePairs expected;
+  VisitCrossingEdgePairs(
+      indexA, indexB, CrossingType::ALL,
+      [&](const ShapeEdge& a, const ShapeEdge& b, bool is_interior) {
+        expected.emplace_back(a.id(), b.id(), is_interior);
+        return true;
+      });
+  ASSERT_GT(expected.size(), 50);
+  for (int num_shards : {1, 2, 7, 64}) {
+    vector<VisitedEdgePairs> shards(num_shards);
+    EXPECT_TRUE(VisitCrossingEdgePairs(
+        indexA, indexB, CrossingType::ALL, num_shards, 4,
+        [&](int shard, const ShapeEdge& a, const ShapeEdge& b,
+            bool is_interior) {
+          shards[shard].emplace_back(a.id(), b.id(), is_interior);
+          return true;
+        }));
+    VisitedEdgePairs actual;
+    for (const auto& shard : shards) {
+      actual.insert(actual.end(), shard.begin(), shard.end());
+    }
+    EXPECT_TRUE(actual == expected) << "num_shards = " << num_shards;
+  }
+}
+
+TEST(VisitCrossingEdgePairs, ShardedCanStopEarly) {
+  MutableS2ShapeIndex indexA, indexB;
+  indexA.Add(make_unique<S2Loop::OwningShape>(
+      s2textformat::MakeLoopOrDie("0:0, 0:10, 10:10, 10:0")));
+  indexB.Add(make_unique<S2Loop::OwningShape>(
+      s2textformat::MakeLoopOrDie("5:5, 5:15, 15:15, 15:5")));
+  std::atomic<int> num_visited{0};
+  EXPECT_FALSE(VisitCrossingEdgePairs(
+      indexA, indexB, CrossingType::ALL, 4, 2,
+      [&](int, const ShapeEdge&, const ShapeEdge&, bool) {
+        ++num_visited;
+        return false;
+      }));
+  EXPECT_GE(num_visited, 1);
+}
+
+TEST(VisitCrossingEdgePairs, ShardedOneIndexMatchesSerial) {
+  // Two overlapping fractals in the same index.
+  absl::BitGen bitgen(S2Testing::MakeTaggedSeedSeq(
+      "SHARDED_ONE_INDEX_MATCHES_SERIAL",
+      absl::LogInfoStreamer(__FILE__, __LINE__).stream()));
+  S2Fractal fractal(bitgen);
+  fractal.SetLevelForApproxMaxEdges(3000);
+  const Matrix3x3_d frame = s2random::Frame(bitgen);
+  MutableS2ShapeIndex index;
+  index.Add(make_unique<S2Loop::OwningShape>(
+      fractal.MakeLoop(frame, S1Angle::Degrees(1))));
+  index.Add(make_unique<S2Loop::OwningShape>(
+      fractal.MakeLoop(frame, S1Angle::Degrees(1.1))));
+
+  for (CrossingType type : {CrossingType::ALL, CrossingType::INTERIOR}) {
+    VisitedEdgePairs expected;
+    VisitCrossingEdgePairs(
+        index, type,
+        [&](const ShapeEdge& a, const ShapeEdge& b, bool is_interior) {
+          expected.emplace_back(a.id(), b.id(), is_interior);
+          return true;
+        });
+    ASSERT_GT(expected.size(), 50);
+    for (int num_shards : {1, 2, 7, 64}) {
+      vector<VisitedEdgePairs> shards(num_shards);
+      EXPECT_TRUE(VisitCrossingEdgePairs(
+          index, type, num_shards, 4,
+          [&](int shard, const ShapeEdge& a, const ShapeEdge& b,
+              bool is_interior) {
+            shards[shard].emplace_back(a.id(), b.id(), is_interior);
+            return true;
+          }));
+      VisitedEdgePairs actual;
+      for (const auto& shard : shards) {
+        actual.insert(actual.end(), shard.begin(), shard.end());
+      }
+      EXPECT_TRUE(actual == expected) << "num_shards = " << num_shards;
+    }
+  }
+}
+
 // Return true if any loop crosses any other loop (including vertex crossings
 // and duplicate edges), or any loop has a self-intersection (including
 // duplicate vertices).
+// Also checks that the multi-threaded version reports the same error.
 static bool HasSelfIntersection(const MutableS2ShapeIndex& index) {
-  S2Error error;
-  if (s2shapeutil::FindSelfIntersection(index, &error)) {
+  S2Error error, threaded_error;
+  bool found = s2shapeutil::FindSelfIntersection(index, &error);
+  EXPECT_EQ(found,
+            s2shapeutil::FindSelfIntersection(index, &threaded_error, 4));
+  EXPECT_EQ(error.code(), threaded_error.code());
+  EXPECT_EQ(error.message(), threaded_error.message());
+  if (found) {
     ABSL_VLOG(1) << error;
     return true;
   }
@@ -301,4 +418,33 @@ TEST(FindSelfIntersection, Basic) {
                   true);  // vertex crossing
 }
 
+TEST(FindSelfIntersection, MultiThreadedLargePolygon) {
+  absl::BitGen bitgen(S2Testing::MakeTaggedSeedSeq(
+      "MULTI_THREADED_LARGE_POLYGON",
+      absl::LogInfoStreamer(__FILE__, __LINE__).stream()));
+  S2Fractal fractal(bitgen);
+  fractal.SetLevelForApproxMaxEdges(10000);
+  const Matrix3x3_d frame = s2random::Frame(bitgen);
+  auto get_vertices = [&](S1Angle radius) {
+    unique_ptr<S2Loop> loop = fractal.MakeLoop(frame, radius);
+    S2PointLoopSpan span = loop->vertices_span();
+    return vector<S2Point>(span.begin(), span.end());
+  };
+  vector<S2Point> inner = get_vertices(S1Angle::Degrees(1));
+  vector<S2Point> outer = get_vertices(S1Angle::Degrees(1.1));
+
+  // A single fractal loop is valid.
+  MutableS2ShapeIndex valid_index;
+  valid_index.Add(make_unique<S2LaxPolygonShape>(
+      vector<vector<S2Point>>{inner}));
+  EXPECT_FALSE(HasSelfIntersection(valid_index));
+
+  // Two overlapping fractal loops cross in many places, and all threads must
+  // agree on which crossing is reported.
+  MutableS2ShapeIndex invalid_index;
+  invalid_index.Add(make_unique<S2LaxPolygonShape>(
+      vector<vector<S2Point>>{inner, outer}));
+  EXPECT_TRUE(HasSelfIntersection(invalid_index));
+}
+
 }  // namespace s2shapeutil
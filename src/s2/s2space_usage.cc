@@ -0,0 +1,64 @@
+// Copyright 2024 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "s2/s2space_usage.h"
+
+#include <cstddef>
+#include <ostream>
+#include <string>
+
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_join.h"
+#include "absl/strings/string_view.h"
+
+using std::string;
+
+void S2SpaceUsage::Add(absl::string_view name, size_t bytes) {
+  // There are only a few components, so a linear search is fine.
+  for (Item& item : items_) {
+    if (item.first == name) {
+      item.second += bytes;
+      return;
+    }
+  }
+  items_.emplace_back(string(name), bytes);
+}
+
+void S2SpaceUsage::Add(absl::string_view prefix, const S2SpaceUsage& other) {
+  for (const Item& item : other.items_) {
+    Add(absl::StrCat(prefix, ".", item.first), item.second);
+  }
+}
+
+size_t S2SpaceUsage::bytes(absl::string_view name) const {
+  for (const Item& item : items_) {
+    if (item.first == name) return item.second;
+  }
+  return 0;
+}
+
+size_t S2SpaceUsage::total_bytes() const {
+  size_t total = 0;
+  for (const Item& item : items_) total += item.second;
+  return total;
+}
+
+string S2SpaceUsage::ToString() const {
+  return absl::StrJoin(items_, " ", absl::PairFormatter("="));
+}
+
+std::ostream& operator<<(std::ostream& os, const S2SpaceUsage& usage) {
+  return os << usage.ToString();
+}
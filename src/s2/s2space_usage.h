@@ -0,0 +1,78 @@
+// Copyright 2024 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef S2_S2SPACE_USAGE_H_
+#define S2_S2SPACE_USAGE_H_
+
+#include <cstddef>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/strings/string_view.h"
+
+// S2SpaceUsage is a breakdown of the memory used by an S2 object into named
+// components, e.g. "cells" and "clipped_shapes" for an S2ShapeIndex.  The
+// total of all components is the value returned by the object's SpaceUsed()
+// method.  The components can be exported as (name, bytes) pairs, e.g. for
+// monitoring:
+//
+//   S2SpaceUsage usage;
+//   index.GetSpaceUsage(&usage);
+//   for (const auto& [name, bytes] : usage.items()) {
+//     my_monitoring->SetGauge(absl::StrCat("s2index.", name), bytes);
+//   }
+//
+// To combine the breakdowns of several objects, use Add(prefix, other):
+//
+//   S2SpaceUsage total, usage;
+//   polygon.GetSpaceUsage(&usage);
+//   total.Add("polygon", usage);  // Adds "polygon.loops", etc.
+class S2SpaceUsage {
+ public:
+  using Item = std::pair<std::string, size_t>;
+
+  S2SpaceUsage() = default;
+
+  // Adds "bytes" to the component with the given name, which is created if
+  // necessary.
+  void Add(absl::string_view name, size_t bytes);
+
+  // Adds every component of "other", with its name prefixed by "prefix" and
+  // a period.
+  void Add(absl::string_view prefix, const S2SpaceUsage& other);
+
+  // Returns the components in the order in which they were first added.
+  const std::vector<Item>& items() const { return items_; }
+
+  // Returns the number of bytes in the given component, or zero if there is
+  // no such component.
+  size_t bytes(absl::string_view name) const;
+
+  // Returns the sum of all components.
+  size_t total_bytes() const;
+
+  // Returns the components as a string of the form "name1=bytes1
+  // name2=bytes2 ...".
+  std::string ToString() const;
+
+ private:
+  std::vector<Item> items_;
+};
+
+std::ostream& operator<<(std::ostream& os, const S2SpaceUsage& usage);
+
+#endif  // S2_S2SPACE_USAGE_H_
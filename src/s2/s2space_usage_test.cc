@@ -0,0 +1,120 @@
+// Copyright 2024 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "s2/s2space_usage.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include "absl/strings/str_cat.h"
+#include "s2/encoded_s2shape_index.h"
+#include "s2/mutable_s2shape_index.h"
+#include "s2/s2cell_id.h"
+#include "s2/s2cell_index.h"
+#include "s2/s2error.h"
+#include "s2/s2point_index.h"
+#include "s2/s2polygon.h"
+#include "s2/s2shapeutil_coding.h"
+#include "s2/s2text_format.h"
+#include "s2/util/coding/coder.h"
+
+using std::string;
+using std::vector;
+using ::testing::ElementsAre;
+using ::testing::Pair;
+
+namespace {
+
+TEST(S2SpaceUsage, AddAndExport) {
+  S2SpaceUsage usage;
+  EXPECT_EQ(usage.total_bytes(), 0);
+  usage.Add("cells", 100);
+  usage.Add("shapes", 20);
+  usage.Add("cells", 5);
+  EXPECT_EQ(usage.bytes("cells"), 105);
+  EXPECT_EQ(usage.bytes("edges"), 0);
+  EXPECT_EQ(usage.total_bytes(), 125);
+  EXPECT_EQ(usage.ToString(), "cells=105 shapes=20");
+
+  S2SpaceUsage total;
+  total.Add("object", 8);
+  total.Add("index", usage);
+  EXPECT_THAT(total.items(),
+              ElementsAre(Pair("object", 8), Pair("index.cells", 105),
+                          Pair("index.shapes", 20)));
+  EXPECT_EQ(total.total_bytes(), 133);
+}
+
+// Checks that GetSpaceUsage() is consistent with SpaceUsed() and that each
+// of the given components is non-empty.
+template <class T>
+void TestSpaceUsage(const T& object, const vector<string>& components) {
+  S2SpaceUsage usage;
+  object.GetSpaceUsage(&usage);
+  EXPECT_EQ(usage.total_bytes(), object.SpaceUsed()) << usage;
+  for (const string& name : components) {
+    EXPECT_GT(usage.bytes(name), 0) << name << ": " << usage;
+  }
+}
+
+TEST(S2SpaceUsage, MutableS2ShapeIndex) {
+  auto index = s2textformat::MakeIndexOrDie(
+      "0:0 | 1:1 # 0:0, 10:10, 20:0 # 0:0, 0:10, 10:10, 10:0");
+  index->ForceBuild();
+  TestSpaceUsage(*index, {"object", "shapes", "cells", "clipped_shapes"});
+}
+
+TEST(S2SpaceUsage, EncodedS2ShapeIndex) {
+  auto index = s2textformat::MakeIndexOrDie("# # 0:0, 0:10, 10:10, 10:0");
+  Encoder encoder;
+  s2shapeutil::CompactEncodeTaggedShapes(*index, &encoder);
+  index->Encode(&encoder);
+  Decoder decoder(encoder.base(), encoder.length());
+  S2Error error;
+  EncodedS2ShapeIndex encoded;
+  ASSERT_TRUE(encoded.Init(
+      &decoder, s2shapeutil::LazyDecodeShapeFactory(&decoder, error)));
+  TestSpaceUsage(encoded, {"object", "shapes", "cells"});
+}
+
+TEST(S2SpaceUsage, S2PointIndex) {
+  S2PointIndex<int> index;
+  for (int i = 0; i < 100; ++i) {
+    index.Add(s2textformat::MakePointOrDie(absl::StrCat(i % 90, ":", i)), i);
+  }
+  TestSpaceUsage(index, {"points"});
+}
+
+TEST(S2SpaceUsage, S2CellIndex) {
+  S2CellIndex index;
+  index.Add(S2CellId::FromFace(0), 1);
+  index.Add(S2CellId::FromFace(0).child(2), 2);
+  index.Build();
+  TestSpaceUsage(index, {"object", "cell_tree", "range_nodes"});
+}
+
+TEST(S2SpaceUsage, S2Polygon) {
+  auto polygon = s2textformat::MakePolygonOrDie("0:0, 0:10, 10:10, 10:0");
+  S2SpaceUsage usage;
+  polygon->GetSpaceUsage(&usage);
+  EXPECT_EQ(usage.total_bytes(), polygon->SpaceUsed());
+  EXPECT_GT(usage.bytes("loops"), 0);
+  EXPECT_GT(usage.bytes("index.object"), 0);
+}
+
+}  // namespace
@@ -22,6 +22,7 @@
 #include <cstdint>
 #include <cstdlib>
 #include <limits>
+#include <memory>
 #include <utility>
 #include <vector>
 
@@ -34,6 +35,7 @@
 #include "s2/internal/s2disjoint_set.h"
 #include "s2/internal/s2incident_edge_tracker.h"
 #include "s2/internal/s2index_cell_data.h"
+#include "s2/internal/s2parallel.h"
 #include "s2/s2cell_id.h"
 #include "s2/s2contains_point_query.h"
 #include "s2/s2contains_vertex_query.h"
@@ -107,6 +109,14 @@ template <typename IndexType> class S2LegacyValidQuery;
 // false, with the validation failure details provided through the error
 // parameter.
 //
+// Validate() optionally accepts a number of threads.  In that case shapes and
+// ranges of index cells are validated concurrently by "worker" queries
+// obtained from NewWorkerQuery(), each with its own iterator, cell data and
+// incident edge tracker.  Start() and Finish() are still called once on the
+// query itself (after merging the incident edges found by the workers), and
+// the error returned is the same one that single-threaded validation would
+// return.
+//
 // This example validates an index as containing valid geometry for
 // use with S2Polygon/S2Polyline:
 //
@@ -125,8 +135,11 @@ class S2ValidationQueryBase {
   S2ValidationQueryBase() = default;
   virtual ~S2ValidationQueryBase() = default;
 
-  // Validate the index by calling the hooks in the derived class.
-  bool Validate(const IndexType& index, S2Error* error);
+  // Validate the index by calling the hooks in the derived class.  Up to
+  // "num_threads" threads (including the calling thread) are used.
+  //
+  // REQUIRES: num_threads >= 1
+  bool Validate(const IndexType& index, S2Error* error, int num_threads = 1);
 
  protected:
   using Iterator = typename IndexType::Iterator;
@@ -167,6 +180,14 @@ class S2ValidationQueryBase {
   // Marks end of validation; called once per query.
   virtual bool Finish(S2Error* error) { return true; }
 
+  // Returns a new query with the same configuration as this one, which is
+  // used to validate part of the index on another thread.  Only CheckShape()
+  // and the per-cell hooks above are called on worker queries.  Queries that
+  // return nullptr (the default) are always validated by a single thread.
+  virtual std::unique_ptr<S2ValidationQueryBase> NewWorkerQuery() const {
+    return nullptr;
+  }
+
   // Returns a reference to the index we're validating.
   const IndexType& Index() const {
     ABSL_DCHECK(index_ != nullptr);
@@ -194,6 +215,26 @@ class S2ValidationQueryBase {
     cell_buffer_.LoadCell(index_, iter.id(), &iter.cell());
   }
 
+  // Validates the index cell at the current iterator position.
+  bool CheckCell(const Iterator& iter, S2Error* error);
+
+  // Calls task(query, iter, i, error) for each task i in [0, num_tasks)
+  // using the given worker queries, stopping at the first task that returns
+  // false.  Returns false and sets "error" to the error of the lowest failing
+  // task if any task fails.
+  template <class Task>
+  bool RunTasks(absl::Span<S2ValidationQueryBase* const> workers,
+                int num_tasks, const Task& task, S2Error* error);
+
+  // Implements Validate() with multiple threads after Start() has been
+  // called.
+  bool ValidateInParallel(int num_threads, S2Error* error);
+
+  // The number of shapes checked by each task, and the level of the S2CellId
+  // ranges checked by each task, when validating in parallel.
+  static constexpr int kShapesPerTask = 64;
+  static constexpr int kCellTaskLevel = 3;
+
   S2IndexCellData cell_buffer_;
   internal::S2IncidentEdgeTracker incident_edge_tracker_;
   const IndexType* index_ = nullptr;
@@ -346,6 +387,8 @@ class S2ValidQuery : public S2ValidationQueryBase<IndexType> {
   bool CheckEdge(const S2Shape& shape, const S2ClippedShape& clipped,
                  const EdgeAndIdChain& edge, S2Error*) override;
   bool Finish(S2Error* error) override;
+  std::unique_ptr<S2ValidationQueryBase<IndexType>> NewWorkerQuery()
+      const override;
 
  private:
   // Returns true if the given S2Point is valid, meaning none of its components
@@ -461,7 +504,9 @@ void SortEdgesCcw(S2Point origin, S2Shape::Edge first, Container& data) {
 
 template <typename IndexType>
 bool S2ValidationQueryBase<IndexType>::Validate(const IndexType& index,
-                                                S2Error* error) {
+                                                S2Error* error,
+                                                int num_threads) {
+  ABSL_DCHECK_GE(num_threads, 1);
   SetIndex(&index);
   incident_edge_tracker_.Reset();
   cell_buffer_.Reset();
@@ -469,6 +514,9 @@ bool S2ValidationQueryBase<IndexType>::Validate(const IndexType& index,
   if (!Start(error)) {
     return false;
   }
+  if (num_threads > 1) {
+    return ValidateInParallel(num_threads, error);
+  }
 
   // Run basic checks on individual shapes in the index.
   Iterator iter(&index, S2ShapeIndex::BEGIN);
@@ -482,47 +530,139 @@ bool S2ValidationQueryBase<IndexType>::Validate(const IndexType& index,
   }
 
   for (iter.Begin(); !iter.done(); iter.Next()) {
-    SetCurrentCell(iter);
+    if (!CheckCell(iter, error)) {
+      return false;
+    }
+  }
 
-    // Add two dimensional shape edges to the incident edge tracker to support
-    // checks for things like crossing polygon chains and split interiors.
-    for (const S2ClippedShape& clipped : CurrentCell().clipped_shapes()) {
-      const int shape_id = clipped.shape_id();
-      const S2Shape& shape = CurrentCell().shape(clipped);
-      if (shape.dimension() < 2) {
-        continue;
-      }
+  // Run any final checks and finish validation
+  return Finish(error);
+}
 
-      incident_edge_tracker_.StartShape(shape_id);
-      for (const auto& edge : CurrentCell().shape_edges(shape_id)) {
-        incident_edge_tracker_.AddEdge(edge.id, edge);
-      }
-      incident_edge_tracker_.FinishShape();
+template <typename IndexType>
+bool S2ValidationQueryBase<IndexType>::CheckCell(const Iterator& iter,
+                                                 S2Error* error) {
+  SetCurrentCell(iter);
+
+  // Add two dimensional shape edges to the incident edge tracker to support
+  // checks for things like crossing polygon chains and split interiors.
+  for (const S2ClippedShape& clipped : CurrentCell().clipped_shapes()) {
+    const int shape_id = clipped.shape_id();
+    const S2Shape& shape = CurrentCell().shape(clipped);
+    if (shape.dimension() < 2) {
+      continue;
+    }
+
+    incident_edge_tracker_.StartShape(shape_id);
+    for (const auto& edge : CurrentCell().shape_edges(shape_id)) {
+      incident_edge_tracker_.AddEdge(edge.id, edge);
     }
+    incident_edge_tracker_.FinishShape();
+  }
 
-    // Now notify that we're starting this cell.
-    if (!StartCell(error)) {
+  // Now notify that we're starting this cell.
+  if (!StartCell(error)) {
+    return false;
+  }
+
+  // Iterate the shapes and edges of the cell.
+  for (const S2ClippedShape& clipped : CurrentCell().clipped_shapes()) {
+    const int shape_id = clipped.shape_id();
+    const S2Shape& shape = CurrentCell().shape(clipped);
+    if (!StartShape(shape, clipped, error)) {
       return false;
     }
 
-    // Iterate the shapes and edges of the cell.
-    for (const S2ClippedShape& clipped : CurrentCell().clipped_shapes()) {
-      const int shape_id = clipped.shape_id();
-      const S2Shape& shape = CurrentCell().shape(clipped);
-      if (!StartShape(shape, clipped, error)) {
+    for (const auto& edge : CurrentCell().shape_edges(shape_id)) {
+      if (!CheckEdge(shape, clipped, edge, error)) {
         return false;
       }
+    }
 
-      for (const auto& edge : CurrentCell().shape_edges(shape_id)) {
-        if (!CheckEdge(shape, clipped, edge, error)) {
-          return false;
-        }
+    if (!FinishShape(shape, clipped, error)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+template <typename IndexType>
+template <class Task>
+bool S2ValidationQueryBase<IndexType>::RunTasks(
+    absl::Span<S2ValidationQueryBase* const> workers, int num_tasks,
+    const Task& task, S2Error* error) {
+  // Every task before the lowest failing task is run, so the error returned
+  // does not depend on the number of threads.
+  std::vector<S2Error> errors(num_tasks);
+  std::vector<Iterator> iters;
+  iters.reserve(workers.size());
+  for (int i = 0; i < static_cast<int>(workers.size()); ++i) {
+    iters.emplace_back(index_, S2ShapeIndex::BEGIN);
+  }
+  const int min_error = s2internal::ParallelForChunks(
+      workers.size(), num_tasks, 1, [&](int worker, int i, int) {
+        return task(workers[worker], iters[worker], i, &errors[i]);
+      });
+  if (min_error < num_tasks) {
+    *error = errors[min_error];
+    return false;
+  }
+  return true;
+}
+
+template <typename IndexType>
+bool S2ValidationQueryBase<IndexType>::ValidateInParallel(int num_threads,
+                                                          S2Error* error) {
+  // The first worker is this query itself.
+  std::vector<std::unique_ptr<S2ValidationQueryBase>> worker_queries;
+  std::vector<S2ValidationQueryBase*> workers = {this};
+  for (int i = 1; i < num_threads; ++i) {
+    std::unique_ptr<S2ValidationQueryBase> query = NewWorkerQuery();
+    if (query == nullptr) break;
+    query->SetIndex(index_);
+    workers.push_back(query.get());
+    worker_queries.push_back(std::move(query));
+  }
+
+  // Run basic checks on individual shapes in the index.
+  const int num_shape_ids = Index().num_shape_ids();
+  auto check_shapes = [&](S2ValidationQueryBase* query, Iterator& iter,
+                          int task, S2Error* error) {
+    const int end = std::min(num_shape_ids, (task + 1) * kShapesPerTask);
+    for (int shape_id = task * kShapesPerTask; shape_id < end; ++shape_id) {
+      const S2Shape* shape = Index().shape(shape_id);
+      if (shape != nullptr &&
+          !query->CheckShape(iter, *shape, shape_id, error)) {
+        return false;
       }
+    }
+    return true;
+  };
+  if (!RunTasks(workers, (num_shape_ids + kShapesPerTask - 1) / kShapesPerTask,
+                check_shapes, error)) {
+    return false;
+  }
 
-      if (!FinishShape(shape, clipped, error)) {
+  // Each task validates the index cells whose ids lie within one S2CellId
+  // range.  Every index cell belongs to exactly one range (even if the cell
+  // is larger than the range), and the ranges are in S2CellId order.
+  auto check_cells = [](S2ValidationQueryBase* query, Iterator& iter,
+                        int task, S2Error* error) {
+    const S2CellId range = S2CellId::Begin(kCellTaskLevel).advance(task);
+    for (iter.Seek(range.range_min());
+         !iter.done() && iter.id() <= range.range_max(); iter.Next()) {
+      if (!query->CheckCell(iter, error)) {
         return false;
       }
     }
+    return true;
+  };
+  if (!RunTasks(workers, 6 << (2 * kCellTaskLevel), check_cells, error)) {
+    return false;
+  }
+
+  for (const auto& query : worker_queries) {
+    incident_edge_tracker_.Merge(query->incident_edge_tracker_);
   }
 
   // Run any final checks and finish validation
@@ -562,6 +702,8 @@ class S2LegacyValidQuery final : public S2ValidQuery<IndexType> {
   bool StartCell(S2Error*) final;
   bool CheckEdge(const S2Shape& shape, const S2ClippedShape& clipped,
                  const EdgeAndIdChain& edge, S2Error*) override;
+  std::unique_ptr<S2ValidationQueryBase<IndexType>> NewWorkerQuery()
+      const final;
 
  private:
   // Tuple of (shape, chain, vertex) for detecting duplicate vertices in the
@@ -1216,6 +1358,14 @@ bool S2ValidQuery<IndexType>::Finish(S2Error* error) {
   return true;
 }
 
+template <typename IndexType>
+std::unique_ptr<S2ValidationQueryBase<IndexType>>
+S2ValidQuery<IndexType>::NewWorkerQuery() const {
+  auto query = std::make_unique<S2ValidQuery>();
+  query->options_ = options_;
+  return query;
+}
+
 //////////////////   S2LegacyValidQuery Implementation   ////////////////////
 
 template <typename IndexType>
@@ -1313,6 +1463,14 @@ bool S2LegacyValidQuery<IndexType>::StartCell(S2Error* error) {
   return Base::StartCell(error);
 }
 
+template <typename IndexType>
+std::unique_ptr<S2ValidationQueryBase<IndexType>>
+S2LegacyValidQuery<IndexType>::NewWorkerQuery() const {
+  auto query = std::make_unique<S2LegacyValidQuery>();
+  query->mutable_options() = Base::options();
+  return query;
+}
+
 template <typename IndexType>
 bool S2LegacyValidQuery<IndexType>::CheckEdge(const S2Shape& shape,
                                               const S2ClippedShape& clipped,
@@ -36,12 +36,16 @@
 #include "absl/types/span.h"
 #include "s2/util/coding/coder.h"
 #include "s2/mutable_s2shape_index.h"
+#include "s2/s1angle.h"
+#include "s2/s2cell_id.h"
 #include "s2/s2debug.h"
 #include "s2/s2error.h"
 #include "s2/s2fractal.h"
 #include "s2/s2latlng.h"
 #include "s2/s2lax_polygon_shape.h"
+#include "s2/s2loop.h"
 #include "s2/s2point.h"
+#include "s2/s2polygon.h"
 #include "s2/s2random.h"
 #include "s2/s2shape.h"
 #include "s2/s2shapeutil_coding.h"
@@ -607,6 +611,45 @@ TYPED_TEST(AllValidationQueries, LoopsCrossing) {
   }
 }
 
+TYPED_TEST(AllValidationQueries, MultithreadedValidationMatches) {
+  // Small loops centered on every level 3 cell, so that cells from every
+  // task range are checked.
+  MutableS2ShapeIndex index;
+  for (S2CellId id = S2CellId::Begin(3); id != S2CellId::End(3);
+       id = id.next()) {
+    S2Polygon polygon(
+        S2Loop::MakeRegularLoop(id.ToPoint(), S1Angle::Degrees(0.5), 20));
+    index.Add(make_unique<S2LaxPolygonShape>(polygon));
+  }
+  TypeParam query;
+  S2Error error;
+  EXPECT_TRUE(query.Validate(index, &error, 4)) << error;
+
+  // Add overlapping loops in several places; every thread count must report
+  // the same (first) error as single-threaded validation.
+  for (S2CellId id : {S2CellId::FromFace(5).child_begin(3),
+                      S2CellId::FromFace(1).child_begin(3)}) {
+    S2Polygon polygon(
+        S2Loop::MakeRegularLoop(id.ToPoint(), S1Angle::Degrees(0.7), 20));
+    index.Add(make_unique<S2LaxPolygonShape>(polygon));
+  }
+  S2Error expected;
+  EXPECT_FALSE(query.Validate(index, &expected, 1));
+  for (int num_threads : {2, 4, 8}) {
+    EXPECT_FALSE(query.Validate(index, &error, num_threads));
+    EXPECT_EQ(error.code(), expected.code());
+    EXPECT_EQ(error.message(), expected.message());
+  }
+
+  // Likewise for errors found by the per-shape checks.
+  index.Add(make_unique<OpenShape>());
+  EXPECT_FALSE(query.Validate(index, &expected, 1));
+  EXPECT_EQ(expected.code(), S2Error::LOOP_NOT_ENOUGH_VERTICES);
+  EXPECT_FALSE(query.Validate(index, &error, 4));
+  EXPECT_EQ(error.code(), expected.code());
+  EXPECT_EQ(error.message(), expected.message());
+}
+
 TYPED_TEST(AllValidationQueries, IndexWithUnindexVerticesFails) {
   // This was found by fuzz testing.  It contains a chain vertex that's not
   // actually indexed, so checking chain orientations will fail, which we should
@@ -18,6 +18,7 @@
 
 #include "s2/s2winding_operation.h"
 
+#include <algorithm>
 #include <cstdint>
 #include <memory>
 #include <utility>
@@ -27,25 +28,35 @@
 #include "absl/log/absl_check.h"
 #include "absl/types/span.h"
 #include "s2/id_set_lexicon.h"
+#include "s2/internal/s2parallel.h"
 #include "s2/mutable_s2shape_index.h"
 #include "s2/s1angle.h"
 #include "s2/s2builder.h"
 #include "s2/s2builder_graph.h"
 #include "s2/s2builder_layer.h"
+#include "s2/s2builder_tracer.h"
 #include "s2/s2builderutil_get_snapped_winding_delta.h"
 #include "s2/s2builderutil_graph_shape.h"
+#include "s2/s2builderutil_lax_polygon_layer.h"
 #include "s2/s2builderutil_snap_functions.h"
+#include "s2/s2cell_id.h"
 #include "s2/s2crossing_edge_query.h"
 #include "s2/s2edge_crosser.h"
 #include "s2/s2edge_crossings.h"
 #include "s2/s2error.h"
+#include "s2/s2lax_loop_shape.h"
+#include "s2/s2lax_polygon_shape.h"
 #include "s2/s2memory_tracker.h"
+#include "s2/s2pointutil.h"
 #include "s2/s2point.h"
 #include "s2/s2point_span.h"
 #include "s2/s2shape.h"
+#include "s2/s2shapeutil_contains_brute_force.h"
 #include "s2/s2shapeutil_shape_edge_id.h"
 
+using absl::Span;
 using std::make_unique;
+using std::pair;
 using std::unique_ptr;
 using std::vector;
 
@@ -483,7 +494,8 @@ S2WindingOperation::Options::Options(const SnapFunction& snap_function)
 S2WindingOperation::Options::Options(const Options& options)
     : snap_function_(options.snap_function_->Clone()),
       include_degeneracies_(options.include_degeneracies_),
-      memory_tracker_(options.memory_tracker_) {
+      memory_tracker_(options.memory_tracker_),
+      tracer_(options.tracer_) {
 }
 
 S2WindingOperation::Options& S2WindingOperation::Options::operator=(
@@ -491,6 +503,7 @@ S2WindingOperation::Options& S2WindingOperation::Options::operator=(
   snap_function_ = options.snap_function_->Clone();
   include_degeneracies_ = options.include_degeneracies_;
   memory_tracker_ = options.memory_tracker_;
+  tracer_ = options.tracer_;
   return *this;
 }
 
@@ -521,6 +534,14 @@ void S2WindingOperation::Options::set_memory_tracker(S2MemoryTracker* tracker) {
   memory_tracker_ = tracker;
 }
 
+S2BuilderTracer* S2WindingOperation::Options::tracer() const {
+  return tracer_;
+}
+
+void S2WindingOperation::Options::set_tracer(S2BuilderTracer* tracer) {
+  tracer_ = tracer;
+}
+
 S2WindingOperation::S2WindingOperation() = default;
 
 S2WindingOperation::S2WindingOperation(
@@ -534,6 +555,7 @@ void S2WindingOperation::Init(unique_ptr<S2Builder::Layer> result_layer,
   S2Builder::Options builder_options{options_.snap_function()};
   builder_options.set_split_crossing_edges(true);
   builder_options.set_memory_tracker(options.memory_tracker());
+  builder_options.set_tracer(options.tracer());
   builder_.Init(builder_options);
   builder_.StartLayer(make_unique<s2builderutil::WindingLayer>(
       this, std::move(result_layer)));
@@ -558,3 +580,109 @@ bool S2WindingOperation::Build(const S2Point& ref_p, int ref_winding,
   rule_ = rule;
   return builder_.Build(error);
 }
+
+namespace {
+
+// A tile is closed once it contains at least this many edges.  The tiles
+// depend only on the input loops (and not on the number of threads).
+constexpr int kMaxTileEdges = 1 << 14;
+
+// Returns true if the region to the left of "loop" contains "p".
+bool LoopContains(S2PointLoopSpan loop, const S2Point& p) {
+  return s2shapeutil::ContainsBruteForce(S2LaxLoopShape(loop), p);
+}
+
+// Computes the union of "loops" using a single S2WindingOperation.
+bool BuildUnionOfAll(Span<const S2PointLoopSpan> loops,
+                     unique_ptr<S2Builder::Layer> result_layer,
+                     const S2WindingOperation::Options& options,
+                     const S2Point& ref_p, S2Error* error) {
+  S2WindingOperation op(std::move(result_layer), options);
+  int ref_winding = 0;
+  for (S2PointLoopSpan loop : loops) {
+    op.AddLoop(loop);
+    ref_winding += LoopContains(loop, ref_p);
+  }
+  return op.Build(ref_p, ref_winding, WindingRule::POSITIVE, error);
+}
+
+}  // namespace
+
+bool S2WindingOperation::BuildUnion(Span<const S2PointLoopSpan> loops,
+                                    unique_ptr<S2Builder::Layer> result_layer,
+                                    const Options& options, int num_threads,
+                                    S2Error* error) {
+  ABSL_DCHECK_GE(num_threads, 1);
+  const S2Point ref_p = S2::Origin();
+
+  // Tiling is only used without snapping.  Build() chooses its snap sites
+  // from all of the input vertices, including those that a tile would remove
+  // from the interior of its union, so a final pass over the tile unions
+  // could not reproduce its result.
+  if (options.snap_function().snap_radius() > S1Angle::Zero()) {
+    return BuildUnionOfAll(loops, std::move(result_layer), options, ref_p,
+                           error);
+  }
+
+  // Sort the loops along the Hilbert curve and split them into tiles.
+  vector<pair<S2CellId, int>> sorted;
+  for (size_t i = 0; i < loops.size(); ++i) {
+    if (!loops[i].empty()) sorted.emplace_back(S2CellId(loops[i][0]), i);
+  }
+  std::sort(sorted.begin(), sorted.end());
+  vector<size_t> tile_begins = {0};
+  size_t num_edges = 0;
+  for (size_t k = 0; k < sorted.size(); ++k) {
+    num_edges += loops[sorted[k].second].size();
+    if (num_edges >= kMaxTileEdges && k + 1 < sorted.size()) {
+      tile_begins.push_back(k + 1);
+      num_edges = 0;
+    }
+  }
+  tile_begins.push_back(sorted.size());
+  const int num_tiles = tile_begins.size() - 1;
+
+  if (num_tiles == 1) {
+    return BuildUnionOfAll(loops, std::move(result_layer), options, ref_p,
+                           error);
+  }
+
+  // S2MemoryTracker is not thread-safe, and tracer events are only delivered
+  // on the calling thread.
+  Options tile_options = options;
+  tile_options.set_memory_tracker(nullptr);
+  tile_options.set_tracer(nullptr);
+  vector<S2LaxPolygonShape> tile_unions(num_tiles);
+  vector<S2Error> tile_errors(num_tiles);
+  s2internal::ParallelFor(num_threads, num_tiles, [&](int t) {
+    S2WindingOperation op(
+        make_unique<s2builderutil::LaxPolygonLayer>(&tile_unions[t]),
+        tile_options);
+    int ref_winding = 0;
+    for (size_t k = tile_begins[t]; k < tile_begins[t + 1]; ++k) {
+      S2PointLoopSpan loop = loops[sorted[k].second];
+      op.AddLoop(loop);
+      ref_winding += LoopContains(loop, ref_p);
+    }
+    op.Build(ref_p, ref_winding, WindingRule::POSITIVE, &tile_errors[t]);
+  });
+  for (const S2Error& tile_error : tile_errors) {
+    if (!tile_error.ok()) {
+      *error = tile_error;
+      return false;
+    }
+  }
+
+  // Each tile union has a winding number of 1 in its interior and 0
+  // elsewhere, so the union of the tiles is again the positive region.
+  S2WindingOperation op(std::move(result_layer), options);
+  int ref_winding = 0;
+  for (const S2LaxPolygonShape& tile_union : tile_unions) {
+    for (int i = 0; i < tile_union.num_loops(); ++i) {
+      const int n = tile_union.num_loop_vertices(i);
+      if (n > 0) op.AddLoop(S2PointLoopSpan(&tile_union.loop_vertex(i, 0), n));
+    }
+    ref_winding += s2shapeutil::ContainsBruteForce(tile_union, ref_p);
+  }
+  return op.Build(ref_p, ref_winding, WindingRule::POSITIVE, error);
+}
@@ -21,8 +21,10 @@
 #include <memory>
 
 #include "absl/log/absl_log.h"
+#include "absl/types/span.h"
 #include "s2/s2builder.h"
 #include "s2/s2builder_graph.h"
+#include "s2/s2builder_tracer.h"
 #include "s2/s2error.h"
 #include "s2/s2memory_tracker.h"
 #include "s2/s2point.h"
@@ -150,6 +152,13 @@ class S2WindingOperation {
     S2MemoryTracker* memory_tracker() const;
     void set_memory_tracker(S2MemoryTracker* tracker);
 
+    // Specifies an object that is notified at the start and end of each
+    // phase of the S2Builder used by Build() (see s2builder_tracer.h).
+    //
+    // DEFAULT: nullptr (tracing disabled)
+    S2BuilderTracer* tracer() const;
+    void set_tracer(S2BuilderTracer* tracer);
+
     // Options may be assigned and copied.
     Options(const Options& options);
     Options& operator=(const Options& options);
@@ -158,6 +167,7 @@ class S2WindingOperation {
     std::unique_ptr<S2Builder::SnapFunction> snap_function_;
     bool include_degeneracies_ = false;
     S2MemoryTracker* memory_tracker_ = nullptr;
+    S2BuilderTracer* tracer_ = nullptr;
   };
 
   // Default constructor; requires Init() to be called.
@@ -216,6 +226,37 @@ class S2WindingOperation {
   bool Build(const S2Point& ref_p, int ref_winding, WindingRule rule,
              S2Error* error);
 
+  // Computes the union of the given loops using up to "num_threads" threads
+  // and sends the result to "result_layer".  Each loop contributes a winding
+  // number of +1 to the region on its left, so this is equivalent to adding
+  // the loops to an S2WindingOperation and calling Build() with
+  // WindingRule::POSITIVE and a reference point whose winding number is the
+  // number of loops that contain it.
+  //
+  // The loops are sorted by the S2CellId of their first vertex and split into
+  // "tiles" (ranges of consecutive loops with a bounded total number of
+  // edges), so that each tile covers a compact region of the sphere.  The
+  // union of each tile is computed concurrently (crossing edges are split at
+  // their intersection points), and the tile results are then merged by a
+  // final S2WindingOperation.  Since most overlapping loops are in the same
+  // tile, most interior edges are removed before the final pass.  The result
+  // is the same as that of Build() except that vertices created by splitting
+  // crossing edges may differ by up to S2::kIntersectionError.  The memory
+  // tracker (if any) is only used for the final pass.
+  //
+  // Tiling is only used when options.snap_function() has a snap radius of
+  // zero.  Otherwise the loops are processed by a single S2WindingOperation,
+  // since the snap sites chosen by Build() depend on all of the input
+  // vertices (including those in the interior of the union).
+  //
+  // REQUIRES: Each loop is not self-intersecting (loops may overlap each
+  //           other arbitrarily).
+  // REQUIRES: error->ok() [an existing error will not be overwritten]
+  static bool BuildUnion(absl::Span<const S2PointLoopSpan> loops,
+                         std::unique_ptr<S2Builder::Layer> result_layer,
+                         const Options& options, int num_threads,
+                         S2Error* error);
+
  private:
   // Most of the implementation is in the WindingLayer class.
   friend class s2builderutil::WindingLayer;
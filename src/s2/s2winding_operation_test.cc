@@ -40,6 +40,7 @@
 #include "s2/s2builderutil_lax_polygon_layer.h"
 #include "s2/s2builderutil_snap_functions.h"
 #include "s2/s2cap.h"
+#include "s2/s2edge_crossings.h"
 #include "s2/s2error.h"
 #include "s2/s2fractal.h"
 #include "s2/s2lax_polygon_shape.h"
@@ -293,6 +294,75 @@ TEST(S2WindingOperation, SymmetricDifferenceDegeneracies) {
       "", "2:2; 5:5");
 }
 
+// Checks that BuildUnion() with the given loops produces the same result as
+// Build() with WindingRule::POSITIVE, ignoring differences that collapse
+// when snapped with the given tolerance.
+void ExpectUnionSameAsBuild(const S2WindingOperation::Options& options,
+                            const vector<vector<S2Point>>& loops,
+                            int num_threads,
+                            S1Angle tolerance = S1Angle::Zero()) {
+  vector<S2PointLoopSpan> spans(loops.begin(), loops.end());
+  MutableS2ShapeIndex expected;
+  S2WindingOperation winding_op(
+      make_unique<s2builderutil::IndexedLaxPolygonLayer>(&expected), options);
+  for (const auto& loop : loops) winding_op.AddLoop(loop);
+  const S2Point ref_p = s2textformat::MakePointOrDie("-10:-10");
+  S2Error error;
+  ASSERT_TRUE(winding_op.Build(ref_p, 0, WindingRule::POSITIVE, &error))
+      << error;
+
+  MutableS2ShapeIndex actual;
+  ASSERT_TRUE(S2WindingOperation::BuildUnion(
+      spans, make_unique<s2builderutil::IndexedLaxPolygonLayer>(&actual),
+      options, num_threads, &error)) << error;
+  // Differences that collapse to degenerate boundaries are discarded.
+  s2builderutil::LaxPolygonLayer::Options layer_options;
+  if (tolerance > S1Angle::Zero()) {
+    layer_options.set_degenerate_boundaries(
+        s2builderutil::LaxPolygonLayer::Options::DegenerateBoundaries::DISCARD);
+  }
+  S2LaxPolygonShape difference;
+  S2BooleanOperation diff_op(
+      S2BooleanOperation::OpType::SYMMETRIC_DIFFERENCE,
+      make_unique<s2builderutil::LaxPolygonLayer>(&difference, layer_options),
+      S2BooleanOperation::Options{IdentitySnapFunction(tolerance)});
+  ASSERT_TRUE(diff_op.Build(actual, expected, &error)) << error;
+  EXPECT_TRUE(difference.is_empty())
+      << "Difference S2Polygon: " << s2textformat::ToString(difference);
+}
+
+TEST(S2WindingOperation, BuildUnionSingleTile) {
+  vector<vector<S2Point>> loops;
+  for (string_view loop_str :
+       {"0:0, 0:4, 4:4, 4:0", "1:1, 1:5, 5:5, 5:1", "2:2, 2:6, 6:6, 6:2"}) {
+    loops.push_back(s2textformat::ParsePointsOrDie(loop_str));
+  }
+  ExpectUnionSameAsBuild(S2WindingOperation::Options{IntLatLngSnapFunction(1)},
+                         loops, 4);
+}
+
+TEST(S2WindingOperation, BuildUnionManyTiles) {
+  // A grid of overlapping squares with a few missing, which is large enough
+  // to be split into several tiles.
+  vector<vector<S2Point>> loops;
+  for (int i = 0; i < 70; ++i) {
+    for (int j = 0; j < 70; ++j) {
+      if ((7 * i + 3 * j) % 11 == 0) continue;
+      loops.push_back(s2textformat::ParsePointsOrDie(absl::StrCat(
+          i, ":", j, ", ", i, ":", j + 2, ", ", i + 2, ":", j + 2, ", ",
+          i + 2, ":", j)));
+    }
+  }
+  // Without snapping, the results differ only in the rounding of the
+  // points where edges from different tiles cross.
+  ExpectUnionSameAsBuild(S2WindingOperation::Options{IdentitySnapFunction()},
+                         loops, 4, S2::kIntersectionError);
+
+  // With snapping, BuildUnion() does not use tiles.
+  ExpectUnionSameAsBuild(S2WindingOperation::Options{IntLatLngSnapFunction(1)},
+                         loops, 4, S2::kIntersectionError);
+}
+
 TEST(S2WindingOperationOptions, SetGetSnapFunction) {
   // Prevent these from being detected as dead code.
   S2WindingOperation::Options opts;
@@ -0,0 +1,705 @@
+// Copyright 2024 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "s2/s2wk_format.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#include "absl/base/casts.h"
+#include "absl/strings/ascii.h"
+#include "absl/strings/charconv.h"
+#include "absl/strings/match.h"
+#include "absl/strings/str_format.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+#include "s2/mutable_s2shape_index.h"
+#include "s2/s2error.h"
+#include "s2/s2latlng.h"
+#include "s2/s2lax_polygon_shape.h"
+#include "s2/s2lax_polyline_shape.h"
+#include "s2/s2loop_measures.h"
+#include "s2/s2point.h"
+#include "s2/s2point_span.h"
+#include "s2/s2point_vector_shape.h"
+#include "s2/s2shape.h"
+#include "s2/s2shape_nesting_query.h"
+#include "s2/s2wrapped_shape.h"
+#include "s2/util/coding/coder.h"
+#include "s2/util/endian/endian.h"
+
+using absl::Span;
+using absl::string_view;
+using std::make_unique;
+using std::string;
+using std::unique_ptr;
+using std::vector;
+
+namespace s2wk {
+
+namespace {
+
+// The maximum nesting depth of geometry collections.  This prevents stack
+// overflows on malicious input.
+constexpr int kMaxDepth = 32;
+
+// Flags used by PostGIS extended WKB.
+constexpr uint32_t kEwkbZ = 0x80000000;
+constexpr uint32_t kEwkbM = 0x40000000;
+constexpr uint32_t kEwkbSrid = 0x20000000;
+
+uint32_t LoadUint32(const char* p, bool big_endian) {
+  if (!big_endian) return LittleEndian::Load32(p);
+  uint32_t value = 0;
+  for (int i = 0; i < 4; ++i) value = (value << 8) | static_cast<uint8_t>(p[i]);
+  return value;
+}
+
+double LoadDouble(const char* p, bool big_endian) {
+  if (!big_endian) return absl::bit_cast<double>(LittleEndian::Load64(p));
+  uint64_t value = 0;
+  for (int i = 0; i < 8; ++i) value = (value << 8) | static_cast<uint8_t>(p[i]);
+  return absl::bit_cast<double>(value);
+}
+
+bool IsWktNumberStart(char c) {
+  return (c >= '0' && c <= '9') || c == '-' || c == '+' || c == '.';
+}
+
+}  // namespace
+
+Reader::Reader(Format format, string_view data, const Options& options)
+    : format_(format), data_(data), options_(options) {}
+
+bool Reader::Fail(string_view message) {
+  if (error_.ok()) {
+    error_ = S2Error::InvalidArgument(absl::StrFormat(
+        "%s: %s", format_ == Format::WKB ? "WKB" : "WKT", message));
+  }
+  return false;
+}
+
+bool Reader::ToPoint(double lng, double lat, S2Point* point) {
+  if (!std::isfinite(lng) || !std::isfinite(lat) || std::fabs(lat) > 90) {
+    return Fail(absl::StrFormat("Invalid coordinate (%g %g)", lng, lat));
+  }
+  *point = S2LatLng::FromDegrees(lat, lng).ToPoint();
+  return true;
+}
+
+void Reader::FinishRing(size_t ring_begin, bool is_shell) {
+  // S2 loops are implicitly closed.
+  size_t n = vertices_.size() - ring_begin;
+  if (n >= 2 && vertices_.back() == vertices_[ring_begin]) {
+    vertices_.pop_back();
+    --n;
+  }
+  if (n == 0) return;  // Empty rings are ignored.
+  if (!options_.oriented()) {
+    S2PointLoopSpan loop(&vertices_[ring_begin], n);
+    if (S2::IsNormalized(loop) != is_shell) {
+      std::reverse(vertices_.begin() + ring_begin, vertices_.end());
+    }
+  }
+  ring_ends_.push_back(vertices_.size());
+}
+
+void Reader::EmitPoints(vector<unique_ptr<S2Shape>>* shapes) {
+  if (points_.empty()) return;
+  shapes->push_back(make_unique<S2PointVectorShape>(std::move(points_)));
+  points_.clear();
+}
+
+void Reader::EmitPolyline(vector<unique_ptr<S2Shape>>* shapes) {
+  if (vertices_.empty()) return;
+  shapes->push_back(make_unique<S2LaxPolylineShape>(vertices_));
+  vertices_.clear();
+}
+
+void Reader::EmitPolygon(vector<unique_ptr<S2Shape>>* shapes) {
+  if (!ring_ends_.empty()) {
+    vector<Span<const S2Point>> loops;
+    loops.reserve(ring_ends_.size());
+    size_t begin = 0;
+    for (size_t end : ring_ends_) {
+      loops.emplace_back(vertices_.data() + begin, end - begin);
+      begin = end;
+    }
+    shapes->push_back(make_unique<S2LaxPolygonShape>(loops));
+  }
+  vertices_.clear();
+  ring_ends_.clear();
+}
+
+bool Reader::Next(vector<unique_ptr<S2Shape>>* shapes) {
+  if (format_ == Format::WKT) {
+    while (ConsumeWkt(';')) continue;
+  }
+  if (done()) return false;
+  points_.clear();
+  vertices_.clear();
+  ring_ends_.clear();
+  const size_t old_size = shapes->size();
+  bool ok = (format_ == Format::WKB) ? ReadWkbGeometry(0, UNKNOWN, shapes)
+                                     : ReadWktGeometry(0, UNKNOWN, shapes);
+  if (!ok) {
+    shapes->resize(old_size);
+    return false;
+  }
+  if (format_ == Format::WKT) {
+    while (ConsumeWkt(';')) continue;
+  }
+  return true;
+}
+
+int Reader::AddToIndex(MutableS2ShapeIndex* index, int max_geometries) {
+  vector<unique_ptr<S2Shape>> shapes;
+  int num_geometries = 0;
+  while (num_geometries < max_geometries && Next(&shapes)) {
+    ++num_geometries;
+    for (auto& shape : shapes) index->Add(std::move(shape));
+    shapes.clear();
+  }
+  return num_geometries;
+}
+
+////////////////////////////////////////////////////////////////////////
+// WKB parsing
+
+bool Reader::ReadWkbUint32(bool big_endian, uint32_t* value) {
+  if (data_.size() < 4) return Fail("Unexpected end of input");
+  *value = LoadUint32(data_.data(), big_endian);
+  data_.remove_prefix(4);
+  return true;
+}
+
+bool Reader::ReadWkbCoords(bool big_endian, int num_dims, uint32_t num_coords,
+                           vector<S2Point>* points) {
+  const uint64_t num_bytes = uint64_t{num_coords} * num_dims * sizeof(double);
+  if (data_.size() < num_bytes) return Fail("Unexpected end of input");
+  const char* p = data_.data();
+  points->reserve(points->size() + num_coords);
+  for (uint32_t i = 0; i < num_coords; ++i, p += num_dims * sizeof(double)) {
+    S2Point point;
+    if (!ToPoint(LoadDouble(p, big_endian),
+                 LoadDouble(p + sizeof(double), big_endian), &point)) {
+      return false;
+    }
+    points->push_back(point);
+  }
+  data_.remove_prefix(num_bytes);
+  return true;
+}
+
+bool Reader::ReadWkbGeometry(int depth, Type parent,
+                             vector<unique_ptr<S2Shape>>* shapes) {
+  if (depth > kMaxDepth) return Fail("Geometry nested too deeply");
+  if (data_.empty()) return Fail("Unexpected end of input");
+  const uint8_t byte_order = data_[0];
+  if (byte_order > 1) return Fail("Invalid byte order");
+  const bool big_endian = (byte_order == 0);
+  data_.remove_prefix(1);
+
+  uint32_t code;
+  if (!ReadWkbUint32(big_endian, &code)) return false;
+  bool has_z = code & kEwkbZ, has_m = code & kEwkbM;
+  const bool has_srid = code & kEwkbSrid;
+  code &= ~(kEwkbZ | kEwkbM | kEwkbSrid);
+  switch (code / 1000) {  // ISO WKB dimensions.
+    case 0: break;
+    case 1: has_z = true; break;
+    case 2: has_m = true; break;
+    case 3: has_z = has_m = true; break;
+    default: return Fail(absl::StrFormat("Invalid geometry type %d", code));
+  }
+  code %= 1000;
+  if (code < POINT || code > GEOMETRYCOLLECTION) {
+    return Fail(absl::StrFormat("Invalid geometry type %d", code));
+  }
+  const Type type = static_cast<Type>(code);
+  if ((parent == MULTIPOINT && type != POINT) ||
+      (parent == MULTILINESTRING && type != LINESTRING) ||
+      (parent == MULTIPOLYGON && type != POLYGON)) {
+    return Fail("Invalid member of multi-geometry");
+  }
+  uint32_t unused_srid;
+  if (has_srid && !ReadWkbUint32(big_endian, &unused_srid)) return false;
+  const int num_dims = 2 + has_z + has_m;
+
+  uint32_t num_parts = 1;
+  if (type != POINT && !ReadWkbUint32(big_endian, &num_parts)) return false;
+  switch (type) {
+    case POINT: {
+      // An empty point is represented by NaN coordinates.
+      if (data_.size() < num_dims * sizeof(double)) {
+        return Fail("Unexpected end of input");
+      }
+      if (std::isnan(LoadDouble(data_.data(), big_endian)) &&
+          std::isnan(LoadDouble(data_.data() + sizeof(double), big_endian))) {
+        data_.remove_prefix(num_dims * sizeof(double));
+      } else if (!ReadWkbCoords(big_endian, num_dims, 1, &points_)) {
+        return false;
+      }
+      if (parent != MULTIPOINT) EmitPoints(shapes);
+      return true;
+    }
+    case LINESTRING:
+      if (!ReadWkbCoords(big_endian, num_dims, num_parts, &vertices_)) {
+        return false;
+      }
+      EmitPolyline(shapes);
+      return true;
+
+    case POLYGON:
+      for (uint32_t i = 0; i < num_parts; ++i) {
+        uint32_t num_coords;
+        if (!ReadWkbUint32(big_endian, &num_coords)) return false;
+        const size_t ring_begin = vertices_.size();
+        if (!ReadWkbCoords(big_endian, num_dims, num_coords, &vertices_)) {
+          return false;
+        }
+        FinishRing(ring_begin, i == 0);
+      }
+      if (parent != MULTIPOLYGON) EmitPolygon(shapes);
+      return true;
+
+    default:
+      // Each member must occupy at least 5 bytes.
+      if (data_.size() / 5 < num_parts) return Fail("Unexpected end of input");
+      for (uint32_t i = 0; i < num_parts; ++i) {
+        if (!ReadWkbGeometry(depth + 1, type, shapes)) return false;
+      }
+      if (type == MULTIPOINT) EmitPoints(shapes);
+      if (type == MULTIPOLYGON) EmitPolygon(shapes);
+      return true;
+  }
+}
+
+////////////////////////////////////////////////////////////////////////
+// WKT parsing
+
+void Reader::SkipWktSpace() {
+  size_t i = 0;
+  while (i < data_.size() && absl::ascii_isspace(data_[i])) ++i;
+  data_.remove_prefix(i);
+}
+
+bool Reader::ConsumeWkt(char c) {
+  SkipWktSpace();
+  if (data_.empty() || data_[0] != c) return false;
+  data_.remove_prefix(1);
+  return true;
+}
+
+string_view Reader::ReadWktWord() {
+  SkipWktSpace();
+  size_t i = 0;
+  while (i < data_.size() && absl::ascii_isalpha(data_[i])) ++i;
+  string_view word = data_.substr(0, i);
+  data_.remove_prefix(i);
+  return word;
+}
+
+bool Reader::ReadWktEmptyOrOpen(bool* empty) {
+  if (ConsumeWkt('(')) {
+    *empty = false;
+    return true;
+  }
+  if (absl::EqualsIgnoreCase(ReadWktWord(), "EMPTY")) {
+    *empty = true;
+    return true;
+  }
+  return Fail("Expected '(' or EMPTY");
+}
+
+bool Reader::ReadWktCoord(S2Point* point) {
+  // Parse up to 4 numbers (X Y [Z [M]]), ignoring all but the first two.
+  double values[2];
+  for (int i = 0; i < 4; ++i) {
+    SkipWktSpace();
+    if (i >= 2 && (data_.empty() || !IsWktNumberStart(data_[0]))) break;
+    if (!data_.empty() && data_[0] == '+') data_.remove_prefix(1);
+    double value;
+    auto result =
+        absl::from_chars(data_.data(), data_.data() + data_.size(), value);
+    if (result.ec != std::errc()) return Fail("Expected a number");
+    data_.remove_prefix(result.ptr - data_.data());
+    if (i < 2) values[i] = value;
+  }
+  return ToPoint(values[0], values[1], point);
+}
+
+bool Reader::ReadWktCoords(vector<S2Point>* points) {
+  do {
+    S2Point point;
+    if (!ReadWktCoord(&point)) return false;
+    points->push_back(point);
+  } while (ConsumeWkt(','));
+  return ConsumeWkt(')') || Fail("Expected ')'");
+}
+
+bool Reader::ReadWktRings(bool first_is_shell) {
+  bool is_shell = first_is_shell;
+  do {
+    bool empty;
+    if (!ReadWktEmptyOrOpen(&empty)) return false;
+    if (empty) continue;
+    const size_t ring_begin = vertices_.size();
+    if (!ReadWktCoords(&vertices_)) return false;
+    FinishRing(ring_begin, is_shell);
+    is_shell = false;
+  } while (ConsumeWkt(','));
+  return ConsumeWkt(')') || Fail("Expected ')'");
+}
+
+bool Reader::ReadWktGeometry(int depth, Type parent,
+                             vector<unique_ptr<S2Shape>>* shapes) {
+  if (depth > kMaxDepth) return Fail("Geometry nested too deeply");
+  string_view word = ReadWktWord();
+  if (depth == 0 && absl::EqualsIgnoreCase(word, "SRID")) {
+    // Skip an EWKT prefix such as "SRID=4326;".
+    if (!ConsumeWkt('=')) return Fail("Expected '='");
+    SkipWktSpace();
+    size_t i = 0;
+    while (i < data_.size() && absl::ascii_isdigit(data_[i])) ++i;
+    data_.remove_prefix(i);
+    if (!ConsumeWkt(';')) return Fail("Expected ';'");
+    word = ReadWktWord();
+  }
+  // Accept dimension suffixes either attached ("POINTZ") or separate
+  // ("POINT Z").  They are ignored since extra coordinates are skipped.
+  static constexpr struct {
+    const char* name;
+    Type type;
+  } kTypes[] = {
+      {"POINT", POINT},
+      {"LINESTRING", LINESTRING},
+      {"POLYGON", POLYGON},
+      {"MULTIPOINT", MULTIPOINT},
+      {"MULTILINESTRING", MULTILINESTRING},
+      {"MULTIPOLYGON", MULTIPOLYGON},
+      {"GEOMETRYCOLLECTION", GEOMETRYCOLLECTION},
+  };
+  Type type = UNKNOWN;
+  for (const auto& entry : kTypes) {
+    string_view name = entry.name;
+    if (!absl::StartsWithIgnoreCase(word, name)) continue;
+    string_view suffix = word.substr(name.size());
+    if (suffix.empty() || absl::EqualsIgnoreCase(suffix, "Z") ||
+        absl::EqualsIgnoreCase(suffix, "M") ||
+        absl::EqualsIgnoreCase(suffix, "ZM")) {
+      type = entry.type;
+      break;
+    }
+  }
+  if (type == UNKNOWN) {
+    return Fail(absl::StrFormat("Unknown geometry type \"%s\"", word));
+  }
+  bool empty;
+  SkipWktSpace();
+  if (!data_.empty() && absl::ascii_isalpha(data_[0])) {
+    string_view dims = ReadWktWord();
+    if (absl::EqualsIgnoreCase(dims, "EMPTY")) return true;
+    if (!absl::EqualsIgnoreCase(dims, "Z") &&
+        !absl::EqualsIgnoreCase(dims, "M") &&
+        !absl::EqualsIgnoreCase(dims, "ZM")) {
+      return Fail(absl::StrFormat("Unexpected \"%s\"", dims));
+    }
+  }
+  if (!ReadWktEmptyOrOpen(&empty)) return false;
+  if (empty) return true;
+
+  switch (type) {
+    case POINT: {
+      S2Point point;
+      if (!ReadWktCoord(&point)) return false;
+      if (!ConsumeWkt(')')) return Fail("Expected ')'");
+      points_.push_back(point);
+      EmitPoints(shapes);
+      return true;
+    }
+    case LINESTRING:
+      if (!ReadWktCoords(&vertices_)) return false;
+      EmitPolyline(shapes);
+      return true;
+
+    case POLYGON:
+      if (!ReadWktRings(true)) return false;
+      EmitPolygon(shapes);
+      return true;
+
+    case MULTIPOINT:
+      // Both "MULTIPOINT ((1 2), (3 4))" and "MULTIPOINT (1 2, 3 4)" are
+      // accepted.
+      do {
+        bool parenthesized = ConsumeWkt('(');
+        if (!parenthesized && !data_.empty() &&
+            absl::ascii_isalpha(data_[0])) {
+          if (!ReadWktEmptyOrOpen(&empty)) return false;
+          continue;  // An empty point.
+        }
+        S2Point point;
+        if (!ReadWktCoord(&point)) return false;
+        if (parenthesized && !ConsumeWkt(')')) return Fail("Expected ')'");
+        points_.push_back(point);
+      } while (ConsumeWkt(','));
+      if (!ConsumeWkt(')')) return Fail("Expected ')'");
+      EmitPoints(shapes);
+      return true;
+
+    case MULTILINESTRING:
+      do {
+        if (!ReadWktEmptyOrOpen(&empty)) return false;
+        if (empty) continue;
+        if (!ReadWktCoords(&vertices_)) return false;
+        EmitPolyline(shapes);
+      } while (ConsumeWkt(','));
+      return ConsumeWkt(')') || Fail("Expected ')'");
+
+    case MULTIPOLYGON:
+      do {
+        if (!ReadWktEmptyOrOpen(&empty)) return false;
+        if (empty) continue;
+        if (!ReadWktRings(true)) return false;
+      } while (ConsumeWkt(','));
+      if (!ConsumeWkt(')')) return Fail("Expected ')'");
+      EmitPolygon(shapes);
+      return true;
+
+    default:
+      do {
+        if (!ReadWktGeometry(depth + 1, type, shapes)) return false;
+      } while (ConsumeWkt(','));
+      return ConsumeWkt(')') || Fail("Expected ')'");
+  }
+}
+
+bool Read(Format format, string_view data, vector<unique_ptr<S2Shape>>* shapes,
+          S2Error* error, const Options& options) {
+  Reader reader(format, data, options);
+  while (reader.Next(shapes)) continue;
+  *error = reader.error();
+  return error->ok();
+}
+
+////////////////////////////////////////////////////////////////////////
+// Output
+
+namespace {
+
+// Sets "vertices" to the vertices of the given chain.  If "close_loop" is
+// true, the first vertex is repeated at the end.
+void GetChainVertices(const S2Shape& shape, int chain_id, bool close_loop,
+                      vector<S2Point>* vertices) {
+  vertices->clear();
+  const int length = shape.chain(chain_id).length;
+  for (int j = 0; j < length; ++j) {
+    vertices->push_back(shape.chain_edge(chain_id, j).v0);
+  }
+  if (length > 0) {
+    vertices->push_back(close_loop ? (*vertices)[0]
+                                   : shape.chain_edge(chain_id, length - 1).v1);
+  }
+}
+
+// Groups the loops of a polygon shape into polygons, each consisting of a
+// shell followed by its holes.  Full loops are omitted.
+vector<vector<int>> GetPolygons(const S2Shape& shape) {
+  vector<vector<int>> polygons;
+  const int num_chains = shape.num_chains();
+  if (num_chains == 1) {
+    if (shape.chain(0).length > 0) polygons.push_back({0});
+    return polygons;
+  }
+  if (num_chains == 0) return polygons;
+  MutableS2ShapeIndex index;
+  index.Add(make_unique<S2WrappedShape>(&shape));
+  S2ShapeNestingQuery query(&index);
+  auto relations = query.ComputeShapeNesting(0);
+  for (int i = 0; i < num_chains; ++i) {
+    if (!relations[i].is_shell() || shape.chain(i).length == 0) continue;
+    vector<int> polygon = {i};
+    for (int hole : relations[i].holes()) polygon.push_back(hole);
+    polygons.push_back(std::move(polygon));
+  }
+  return polygons;
+}
+
+void AppendWktCoord(const S2Point& p, int precision, string* out) {
+  S2LatLng ll(p);
+  absl::StrAppendFormat(out, "%.*g %.*g", precision, ll.lng().degrees(),
+                        precision, ll.lat().degrees());
+}
+
+void AppendWktCoords(Span<const S2Point> vertices, int precision,
+                     string* out) {
+  out->push_back('(');
+  for (size_t i = 0; i < vertices.size(); ++i) {
+    if (i > 0) out->append(", ");
+    AppendWktCoord(vertices[i], precision, out);
+  }
+  out->push_back(')');
+}
+
+void AppendWktPolygon(const S2Shape& shape, Span<const int> loops,
+                      int precision, vector<S2Point>* vertices, string* out) {
+  out->push_back('(');
+  for (size_t i = 0; i < loops.size(); ++i) {
+    if (i > 0) out->append(", ");
+    GetChainVertices(shape, loops[i], true, vertices);
+    AppendWktCoords(*vertices, precision, out);
+  }
+  out->push_back(')');
+}
+
+// Appends "name", "name EMPTY", or "MULTI<name> (", depending on the number
+// of parts.  Returns true if the parts should be written.
+bool AppendWktTag(string_view name, int num_parts, string* out) {
+  if (num_parts == 1) {
+    absl::StrAppend(out, name, " ");
+    return true;
+  }
+  absl::StrAppend(out, "MULTI", name, num_parts == 0 ? " EMPTY" : " (");
+  return num_parts > 0;
+}
+
+void PutWkbHeader(uint32_t type, Encoder* encoder) {
+  encoder->Ensure(1 + sizeof(uint32_t));
+  encoder->put8(1);  // Little endian.
+  encoder->put32(type);
+}
+
+void PutWkbCoords(Span<const S2Point> vertices, bool with_count,
+                  Encoder* encoder) {
+  encoder->Ensure(sizeof(uint32_t) + 2 * sizeof(double) * vertices.size());
+  if (with_count) encoder->put32(vertices.size());
+  for (const S2Point& p : vertices) {
+    S2LatLng ll(p);
+    encoder->putdouble(ll.lng().degrees());
+    encoder->putdouble(ll.lat().degrees());
+  }
+}
+
+void PutWkbPolygon(const S2Shape& shape, Span<const int> loops,
+                   vector<S2Point>* vertices, Encoder* encoder) {
+  PutWkbHeader(3, encoder);
+  encoder->Ensure(sizeof(uint32_t));
+  encoder->put32(loops.size());
+  for (int loop : loops) {
+    GetChainVertices(shape, loop, true, vertices);
+    PutWkbCoords(*vertices, true, encoder);
+  }
+}
+
+}  // namespace
+
+void AppendWkt(const S2Shape& shape, string* out, int precision) {
+  vector<S2Point> vertices;
+  int num_parts;
+  switch (shape.dimension()) {
+    case 0:
+      num_parts = shape.num_edges();
+      if (!AppendWktTag("POINT", num_parts, out)) return;
+      for (int i = 0; i < num_parts; ++i) {
+        if (i > 0) out->append(", ");
+        out->push_back('(');
+        AppendWktCoord(shape.edge(i).v0, precision, out);
+        out->push_back(')');
+      }
+      break;
+
+    case 1:
+      num_parts = shape.num_chains();
+      if (!AppendWktTag("LINESTRING", num_parts, out)) return;
+      for (int i = 0; i < num_parts; ++i) {
+        if (i > 0) out->append(", ");
+        GetChainVertices(shape, i, false, &vertices);
+        AppendWktCoords(vertices, precision, out);
+      }
+      break;
+
+    default: {
+      const vector<vector<int>> polygons = GetPolygons(shape);
+      num_parts = polygons.size();
+      if (!AppendWktTag("POLYGON", num_parts, out)) return;
+      for (int i = 0; i < num_parts; ++i) {
+        if (i > 0) out->append(", ");
+        AppendWktPolygon(shape, polygons[i], precision, &vertices, out);
+      }
+      break;
+    }
+  }
+  if (num_parts > 1) out->push_back(')');
+}
+
+string ToWkt(const S2Shape& shape, int precision) {
+  string out;
+  AppendWkt(shape, &out, precision);
+  return out;
+}
+
+void EncodeWkb(const S2Shape& shape, Encoder* encoder) {
+  vector<S2Point> vertices;
+  switch (shape.dimension()) {
+    case 0: {
+      const int num_points = shape.num_edges();
+      if (num_points != 1) {
+        PutWkbHeader(4, encoder);
+        encoder->Ensure(sizeof(uint32_t));
+        encoder->put32(num_points);
+      }
+      for (int i = 0; i < num_points; ++i) {
+        PutWkbHeader(1, encoder);
+        PutWkbCoords({shape.edge(i).v0}, false, encoder);
+      }
+      break;
+    }
+    case 1: {
+      const int num_lines = shape.num_chains();
+      if (num_lines != 1) {
+        PutWkbHeader(5, encoder);
+        encoder->Ensure(sizeof(uint32_t));
+        encoder->put32(num_lines);
+      }
+      for (int i = 0; i < num_lines; ++i) {
+        PutWkbHeader(2, encoder);
+        GetChainVertices(shape, i, false, &vertices);
+        PutWkbCoords(vertices, true, encoder);
+      }
+      break;
+    }
+    default: {
+      const vector<vector<int>> polygons = GetPolygons(shape);
+      if (polygons.size() != 1) {
+        PutWkbHeader(6, encoder);
+        encoder->Ensure(sizeof(uint32_t));
+        encoder->put32(polygons.size());
+      }
+      for (const auto& polygon : polygons) {
+        PutWkbPolygon(shape, polygon, &vertices, encoder);
+      }
+      break;
+    }
+  }
+}
+
+}  // namespace s2wk
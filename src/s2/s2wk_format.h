@@ -0,0 +1,202 @@
+// Copyright 2024 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef S2_S2WK_FORMAT_H_
+#define S2_S2WK_FORMAT_H_
+
+// Conversion between S2 shapes and the OGC "well-known" geometry formats:
+// well-known binary (WKB) and well-known text (WKT).  Unlike s2text_format,
+// which is intended for tests, these functions are designed for bulk import
+// and export (e.g. of PostGIS dumps).  Coordinates are parsed with
+// absl::from_chars and converted directly into the vertex buffers that are
+// used to construct each shape, which are reused across geometries.
+//
+// Coordinates are interpreted as (longitude, latitude) pairs in degrees, in
+// that order.  Z and M values are accepted and ignored.  Geometries are
+// converted to shapes as follows:
+//
+//   POINT, MULTIPOINT      -> one S2PointVectorShape
+//   LINESTRING             -> one S2LaxPolylineShape
+//   MULTILINESTRING        -> one S2LaxPolylineShape per linestring
+//   POLYGON, MULTIPOLYGON  -> one S2LaxPolygonShape (containing all rings)
+//   GEOMETRYCOLLECTION     -> the shapes of each member geometry
+//
+// Empty geometries produce no shapes.  The closing vertex of each polygon
+// ring is removed, since S2 loops are implicitly closed.
+//
+// Both the ISO and the PostGIS "extended" (EWKB/EWKT) variants are accepted,
+// including big-endian WKB, Z/M dimensions, and SRID prefixes (the SRID is
+// ignored).  The input is untrusted: malformed data produces an S2Error
+// rather than a crash.
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/strings/string_view.h"
+#include "s2/mutable_s2shape_index.h"
+#include "s2/s2error.h"
+#include "s2/s2point.h"
+#include "s2/s2shape.h"
+#include "s2/util/coding/coder.h"
+
+namespace s2wk {
+
+enum class Format { WKB, WKT };
+
+class Options {
+ public:
+  // If false, polygon rings may have either orientation.  The first ring of
+  // each polygon (the shell) is then oriented so that it encloses at most
+  // half of the sphere, and the remaining rings (the holes) are oriented so
+  // that they exclude at most half of the sphere.  This is the usual
+  // convention for planar data, where ring orientation is not significant.
+  //
+  // If true, rings are used exactly as given and must be oriented so that
+  // the polygon interior is on their left (i.e., counter-clockwise shells
+  // and clockwise holes).  This is required for polygons that cover more
+  // than half of the sphere.
+  //
+  // DEFAULT: false
+  bool oriented() const { return oriented_; }
+  void set_oriented(bool oriented) { oriented_ = oriented; }
+
+ private:
+  bool oriented_ = false;
+};
+
+// Reads a sequence of geometries from a buffer.  WKB geometries are simply
+// concatenated, while WKT geometries are separated by whitespace or
+// semicolons.  (Hex-encoded WKB should be decoded first, e.g. using
+// absl::HexStringToBytes.)
+//
+// Example usage, adding the geometries to an index in batches:
+//
+//   s2wk::Reader reader(s2wk::Format::WKB, data);
+//   MutableS2ShapeIndex index;
+//   while (reader.AddToIndex(&index, 10000) > 0) index.ForceBuild();
+//   if (!reader.error().ok()) ...
+//
+// The buffer must outlive the reader.
+class Reader {
+ public:
+  Reader(Format format, absl::string_view data,
+         const Options& options = Options());
+
+  // Returns true if all geometries have been read or an error occurred.
+  bool done() const { return data_.empty() || !error_.ok(); }
+
+  // Returns the first error encountered, if any.
+  const S2Error& error() const { return error_; }
+
+  // Reads the next geometry and appends its shapes (if any) to "shapes".
+  // Returns false (without appending anything) if there are no more
+  // geometries or an error occurs.
+  bool Next(std::vector<std::unique_ptr<S2Shape>>* shapes);
+
+  // Reads up to "max_geometries" geometries and adds their shapes to
+  // "index".  Returns the number of geometries read.
+  int AddToIndex(MutableS2ShapeIndex* index,
+                 int max_geometries = std::numeric_limits<int>::max());
+
+ private:
+  // The type codes shared by WKB and WKT.
+  enum Type {
+    UNKNOWN = 0,
+    POINT = 1,
+    LINESTRING = 2,
+    POLYGON = 3,
+    MULTIPOINT = 4,
+    MULTILINESTRING = 5,
+    MULTIPOLYGON = 6,
+    GEOMETRYCOLLECTION = 7,
+  };
+
+  // Sets "error_" and returns false.
+  bool Fail(absl::string_view message);
+
+  // Converts a (longitude, latitude) pair to an S2Point, returning false if
+  // the coordinates are invalid.
+  bool ToPoint(double lng, double lat, S2Point* point);
+
+  // Called after the vertices of a polygon ring (starting at
+  // vertices_[ring_begin]) have been appended.
+  void FinishRing(size_t ring_begin, bool is_shell);
+
+  // Adds shapes for the points in "points_", the polyline in "vertices_", or
+  // the polygon rings in "vertices_" and "ring_ends_", and clears them.
+  void EmitPoints(std::vector<std::unique_ptr<S2Shape>>* shapes);
+  void EmitPolyline(std::vector<std::unique_ptr<S2Shape>>* shapes);
+  void EmitPolygon(std::vector<std::unique_ptr<S2Shape>>* shapes);
+
+  // WKB parsing.  "parent" is the type of the enclosing geometry, or
+  // UNKNOWN at the top level.
+  bool ReadWkbGeometry(int depth, Type parent,
+                       std::vector<std::unique_ptr<S2Shape>>* shapes);
+  bool ReadWkbUint32(bool big_endian, uint32_t* value);
+  bool ReadWkbCoords(bool big_endian, int num_dims, uint32_t num_coords,
+                     std::vector<S2Point>* points);
+
+  // WKT parsing.
+  bool ReadWktGeometry(int depth, Type parent,
+                       std::vector<std::unique_ptr<S2Shape>>* shapes);
+  void SkipWktSpace();
+  bool ConsumeWkt(char c);
+  absl::string_view ReadWktWord();
+  bool ReadWktEmptyOrOpen(bool* empty);
+  bool ReadWktCoord(S2Point* point);
+  bool ReadWktCoords(std::vector<S2Point>* points);
+  bool ReadWktRings(bool first_is_shell);
+
+  Format format_;
+  absl::string_view data_;
+  Options options_;
+  S2Error error_;
+
+  // Buffers reused across geometries.
+  std::vector<S2Point> points_;
+  std::vector<S2Point> vertices_;
+  std::vector<size_t> ring_ends_;
+};
+
+// Reads all the geometries in "data" and appends their shapes to "shapes".
+// Returns false and sets "error" if the input is invalid.
+bool Read(Format format, absl::string_view data,
+          std::vector<std::unique_ptr<S2Shape>>* shapes, S2Error* error,
+          const Options& options = Options());
+
+// Appends the WKT representation of "shape" to "out", using the given
+// number of significant digits for each coordinate.  Points are written as
+// POINT or MULTIPOINT, polylines as LINESTRING or MULTILINESTRING, and
+// polygons as POLYGON or MULTIPOLYGON, where the loops of a polygon are
+// grouped into shells and holes using S2ShapeNestingQuery.  Shapes with no
+// points, chains, or non-full loops are written as "MULTIPOINT EMPTY",
+// "MULTILINESTRING EMPTY", or "MULTIPOLYGON EMPTY" respectively.  (The full
+// polygon cannot be represented.)
+void AppendWkt(const S2Shape& shape, std::string* out, int precision = 15);
+
+// Convenience function that returns the WKT representation of "shape".
+std::string ToWkt(const S2Shape& shape, int precision = 15);
+
+// Appends the little-endian WKB representation of "shape" to "encoder",
+// using the same geometry types as AppendWkt().
+void EncodeWkb(const S2Shape& shape, Encoder* encoder);
+
+}  // namespace s2wk
+
+#endif  // S2_S2WK_FORMAT_H_
@@ -0,0 +1,221 @@
+// Copyright 2024 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "s2/s2wk_format.h"
+
+#include <cmath>
+#include <limits>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "s2/mutable_s2shape_index.h"
+#include "s2/s2error.h"
+#include "s2/s2lax_polygon_shape.h"
+#include "s2/s2lax_polyline_shape.h"
+#include "s2/s2point_vector_shape.h"
+#include "s2/s2shape.h"
+#include "s2/s2shape_measures.h"
+#include "s2/util/coding/coder.h"
+
+using absl::string_view;
+using std::string;
+using std::unique_ptr;
+using std::vector;
+
+namespace s2wk {
+namespace {
+
+// Reads "data" and returns the WKT of each resulting shape.
+vector<string> ReadToWkt(Format format, string_view data) {
+  vector<unique_ptr<S2Shape>> shapes;
+  S2Error error;
+  EXPECT_TRUE(Read(format, data, &shapes, &error)) << error;
+  vector<string> result;
+  for (const auto& shape : shapes) result.push_back(ToWkt(*shape));
+  return result;
+}
+
+// Returns the WKB encoding of each shape in the given WKT string.
+string WktToWkb(string_view wkt) {
+  vector<unique_ptr<S2Shape>> shapes;
+  S2Error error;
+  EXPECT_TRUE(Read(Format::WKT, wkt, &shapes, &error)) << error;
+  Encoder encoder;
+  for (const auto& shape : shapes) EncodeWkb(*shape, &encoder);
+  return string(encoder.base(), encoder.length());
+}
+
+S2Error ReadError(Format format, string_view data) {
+  vector<unique_ptr<S2Shape>> shapes;
+  S2Error error;
+  EXPECT_FALSE(Read(format, data, &shapes, &error));
+  EXPECT_TRUE(shapes.empty());
+  return error;
+}
+
+constexpr const char* kCanonicalWkt[] = {
+    "POINT (10 20)",
+    "MULTIPOINT ((1 2), (-3.5 4.25))",
+    "LINESTRING (1 2, 3 4, 5 -6)",
+    "POLYGON ((0 0, 10 0, 10 10, 0 10, 0 0))",
+    "POLYGON ((0 0, 10 0, 10 10, 0 10, 0 0), (2 2, 2 4, 4 4, 4 2, 2 2))",
+    "MULTIPOLYGON (((0 0, 10 0, 10 10, 0 10, 0 0), (2 2, 2 4, 4 4, 4 2, 2 2)), "
+    "((20 20, 30 20, 30 30, 20 20)))",
+};
+
+TEST(S2WkFormat, WktRoundTrip) {
+  for (const char* wkt : kCanonicalWkt) {
+    EXPECT_EQ(ReadToWkt(Format::WKT, wkt), vector<string>{wkt});
+  }
+}
+
+TEST(S2WkFormat, WkbRoundTrip) {
+  for (const char* wkt : kCanonicalWkt) {
+    EXPECT_EQ(ReadToWkt(Format::WKB, WktToWkb(wkt)), vector<string>{wkt});
+  }
+}
+
+TEST(S2WkFormat, WktVariants) {
+  EXPECT_EQ(ReadToWkt(Format::WKT, "point z (1 2 3)"),
+            vector<string>{"POINT (1 2)"});
+  EXPECT_EQ(ReadToWkt(Format::WKT, "SRID=4326;POINT M (1 2 3)"),
+            vector<string>{"POINT (1 2)"});
+  EXPECT_EQ(ReadToWkt(Format::WKT, "POINTZM(1 2 3 4)"),
+            vector<string>{"POINT (1 2)"});
+  EXPECT_EQ(ReadToWkt(Format::WKT, "MULTIPOINT (1 2, 3 4)"),
+            vector<string>{"MULTIPOINT ((1 2), (3 4))"});
+  EXPECT_EQ(ReadToWkt(Format::WKT, "MULTILINESTRING ((1 2, 3 4), EMPTY, "
+                                   "(5 6, 7 8))"),
+            (vector<string>{"LINESTRING (1 2, 3 4)", "LINESTRING (5 6, 7 8)"}));
+  EXPECT_EQ(ReadToWkt(Format::WKT, "GEOMETRYCOLLECTION (POINT (1 2), "
+                                   "GEOMETRYCOLLECTION EMPTY, "
+                                   "LINESTRING (3 4, 5 6))"),
+            (vector<string>{"POINT (1 2)", "LINESTRING (3 4, 5 6)"}));
+  EXPECT_TRUE(ReadToWkt(Format::WKT, "POINT EMPTY; POLYGON EMPTY").empty());
+}
+
+TEST(S2WkFormat, WkbVariants) {
+  // Big-endian point (1 2).
+  constexpr string_view kBigEndianPoint(
+      "\x00\x00\x00\x00\x01"
+      "\x3f\xf0\x00\x00\x00\x00\x00\x00"
+      "\x40\x00\x00\x00\x00\x00\x00\x00",
+      21);
+  EXPECT_EQ(ReadToWkt(Format::WKB, kBigEndianPoint),
+            vector<string>{"POINT (1 2)"});
+
+  // EWKB point with an SRID, followed by an ISO point with a Z coordinate,
+  // followed by an empty point.
+  Encoder encoder;
+  encoder.Ensure(100);
+  encoder.put8(1);
+  encoder.put32(0x20000001);
+  encoder.put32(4326);
+  encoder.putdouble(1);
+  encoder.putdouble(2);
+  encoder.put8(1);
+  encoder.put32(1001);
+  encoder.putdouble(3);
+  encoder.putdouble(4);
+  encoder.putdouble(5);
+  encoder.put8(1);
+  encoder.put32(1);
+  encoder.putdouble(std::numeric_limits<double>::quiet_NaN());
+  encoder.putdouble(std::numeric_limits<double>::quiet_NaN());
+  EXPECT_EQ(ReadToWkt(Format::WKB, string_view(encoder.base(),
+                                               encoder.length())),
+            (vector<string>{"POINT (1 2)", "POINT (3 4)"}));
+}
+
+TEST(S2WkFormat, RingOrientation) {
+  // A clockwise shell is reversed unless the input is oriented.
+  constexpr string_view kClockwise =
+      "POLYGON ((0 0, 0 10, 10 10, 10 0, 0 0))";
+  vector<unique_ptr<S2Shape>> shapes;
+  S2Error error;
+  ASSERT_TRUE(Read(Format::WKT, kClockwise, &shapes, &error));
+  EXPECT_LT(S2::GetArea(*shapes[0]), 2 * M_PI);
+
+  Options options;
+  options.set_oriented(true);
+  shapes.clear();
+  ASSERT_TRUE(Read(Format::WKT, kClockwise, &shapes, &error, options));
+  EXPECT_GT(S2::GetArea(*shapes[0]), 2 * M_PI);
+}
+
+TEST(S2WkFormat, EmptyShapes) {
+  vector<unique_ptr<S2Shape>> shapes;
+  S2Error error;
+  ASSERT_TRUE(Read(Format::WKT, "POLYGON ((0 0, 1 0, 0 1, 0 0))", &shapes,
+                   &error));
+  EXPECT_EQ(ToWkt(*shapes[0], 3), "POLYGON ((0 0, 1 0, 0 1, 0 0))");
+  EXPECT_EQ(absl::StrCat(ToWkt(S2PointVectorShape()), ", ",
+                         ToWkt(S2LaxPolylineShape()), ", ",
+                         ToWkt(S2LaxPolygonShape())),
+            "MULTIPOINT EMPTY, MULTILINESTRING EMPTY, MULTIPOLYGON EMPTY");
+}
+
+TEST(S2WkFormat, InvalidWkt) {
+  EXPECT_EQ(ReadError(Format::WKT, "POINT (1)").code(),
+            S2Error::INVALID_ARGUMENT);
+  EXPECT_EQ(ReadError(Format::WKT, "POINT (1 95)").code(),
+            S2Error::INVALID_ARGUMENT);
+  EXPECT_EQ(ReadError(Format::WKT, "LINESTRING (1 2, 3 4").code(),
+            S2Error::INVALID_ARGUMENT);
+  EXPECT_EQ(ReadError(Format::WKT, "CIRCLE (1 2)").code(),
+            S2Error::INVALID_ARGUMENT);
+  string nested;
+  for (int i = 0; i < 100; ++i) nested += "GEOMETRYCOLLECTION (";
+  EXPECT_EQ(ReadError(Format::WKT, nested).code(), S2Error::INVALID_ARGUMENT);
+}
+
+TEST(S2WkFormat, InvalidWkb) {
+  string wkb = WktToWkb("LINESTRING (1 2, 3 4)");
+  EXPECT_EQ(ReadError(Format::WKB, string_view(wkb).substr(0, 20)).code(),
+            S2Error::INVALID_ARGUMENT);
+  wkb[0] = 2;  // Invalid byte order.
+  EXPECT_EQ(ReadError(Format::WKB, wkb).code(), S2Error::INVALID_ARGUMENT);
+
+  // A huge vertex count must not cause a huge allocation.
+  Encoder encoder;
+  encoder.Ensure(9);
+  encoder.put8(1);
+  encoder.put32(2);
+  encoder.put32(0xffffffff);
+  EXPECT_EQ(ReadError(Format::WKB, string_view(encoder.base(),
+                                               encoder.length())).code(),
+            S2Error::INVALID_ARGUMENT);
+}
+
+TEST(S2WkFormat, ReaderAddToIndexInBatches) {
+  Reader reader(Format::WKT,
+                "POINT (1 2); POINT (3 4)\nPOINT EMPTY LINESTRING (0 0, 1 1)");
+  MutableS2ShapeIndex index;
+  EXPECT_EQ(reader.AddToIndex(&index, 2), 2);
+  EXPECT_EQ(index.num_shape_ids(), 2);
+  EXPECT_FALSE(reader.done());
+  EXPECT_EQ(reader.AddToIndex(&index, 2), 2);
+  EXPECT_EQ(index.num_shape_ids(), 3);
+  EXPECT_EQ(reader.AddToIndex(&index), 0);
+  EXPECT_TRUE(reader.done());
+  EXPECT_TRUE(reader.error().ok());
+}
+
+}  // namespace
+}  // namespace s2wk
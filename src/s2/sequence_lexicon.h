@@ -23,11 +23,11 @@
 #include <cstdint>
 #include <functional>
 #include <iterator>
-#include <limits>
 #include <utility>
 #include <vector>
 
-#include "s2/util/gtl/dense_hash_set.h"
+#include "absl/container/flat_hash_set.h"
+#include "absl/log/absl_check.h"
 #include "s2/util/hash/mix.h"
 
 // SequenceLexicon is a class for compactly representing sequences of values
@@ -42,7 +42,9 @@
 // using 32-bit ids rather than 64-bit pointers.
 //
 // This class has the same thread-safety properties as "string": const methods
-// are thread safe, and non-const methods are not thread safe.
+// are thread safe, and non-const methods are not thread safe.  To build a
+// lexicon from several threads, give each thread its own lexicon and then
+// combine them using Merge().
 //
 // Example usage:
 //
@@ -87,6 +89,16 @@ class SequenceLexicon {
   template <class Container>
   uint32_t Add(const Container& container);
 
+  // Adds every sequence of "other" to this lexicon, and returns a vector
+  // that maps each id of "other" to the id of the same sequence in this
+  // lexicon.  This is equivalent to calling Add() for each sequence of
+  // "other" in order of increasing id, so merging the per-thread lexicons in
+  // a fixed order yields the same ids regardless of how the work was
+  // scheduled.
+  //
+  // REQUIRES: &other != this
+  std::vector<uint32_t> Merge(const SequenceLexicon& other);
+
   // Return the number of value sequences in the lexicon.
   uint32_t size() const;
 
@@ -111,10 +123,6 @@ class SequenceLexicon {
   Sequence sequence(uint32_t id) const;
 
  private:
-  friend class IdKeyEqual;
-  // Choose kEmptyKey to be the last key that will ever be generated.
-  static const uint32_t kEmptyKey = std::numeric_limits<uint32_t>::max();
-
   class IdHasher {
    public:
     IdHasher(const Hasher& hasher, const SequenceLexicon* lexicon);
@@ -137,7 +145,7 @@ class SequenceLexicon {
     const SequenceLexicon* lexicon_;
   };
 
-  using IdSet = gtl::dense_hash_set<uint32_t, IdHasher, IdKeyEqual>;
+  using IdSet = absl::flat_hash_set<uint32_t, IdHasher, IdKeyEqual>;
 
   std::vector<T> values_;
   std::vector<uint32_t> begins_;
@@ -147,9 +155,6 @@ class SequenceLexicon {
 
 //////////////////   Implementation details follow   ////////////////////
 
-template <class T, class Hasher, class KeyEqual>
-const uint32_t SequenceLexicon<T, Hasher, KeyEqual>::kEmptyKey;
-
 template <class T, class Hasher, class KeyEqual>
 SequenceLexicon<T, Hasher, KeyEqual>::IdHasher::IdHasher(
     const Hasher& hasher, const SequenceLexicon* lexicon)
@@ -188,9 +193,6 @@ template <class T, class Hasher, class KeyEqual>
 bool SequenceLexicon<T, Hasher, KeyEqual>::IdKeyEqual::operator()(
     uint32_t id1, uint32_t id2) const {
   if (id1 == id2) return true;
-  if (id1 == lexicon_->kEmptyKey || id2 == lexicon_->kEmptyKey) {
-    return false;
-  }
   SequenceLexicon::Sequence seq1 = lexicon_->sequence(id1);
   SequenceLexicon::Sequence seq2 = lexicon_->sequence(id2);
   return (seq1.size() == seq2.size() &&
@@ -202,7 +204,6 @@ SequenceLexicon<T, Hasher, KeyEqual>::SequenceLexicon(const Hasher& hasher,
                                                       const KeyEqual& key_equal)
     : id_set_(0, IdHasher(hasher, this),
               IdKeyEqual(key_equal, this)) {
-  id_set_.set_empty_key(kEmptyKey);
   begins_.push_back(0);
 }
 
@@ -211,8 +212,8 @@ SequenceLexicon<T, Hasher, KeyEqual>::SequenceLexicon(const SequenceLexicon& x)
     : values_(x.values_), begins_(x.begins_),
       // Unfortunately we can't copy "id_set_" because we need to change the
       // "this" pointers associated with hasher() and key_equal().
-      id_set_(x.id_set_.begin(), x.id_set_.end(), kEmptyKey, 0,
-              IdHasher(x.id_set_.hash_funct().hasher(), this),
+      id_set_(x.id_set_.begin(), x.id_set_.end(), 0,
+              IdHasher(x.id_set_.hash_function().hasher(), this),
               IdKeyEqual(x.id_set_.key_eq().key_equal(), this)) {
 }
 
@@ -221,8 +222,8 @@ SequenceLexicon<T, Hasher, KeyEqual>::SequenceLexicon(SequenceLexicon&& x)
     : values_(std::move(x.values_)), begins_(std::move(x.begins_)),
       // Unfortunately we can't move "id_set_" because we need to change the
       // "this" pointers associated with hasher() and key_equal().
-      id_set_(x.id_set_.begin(), x.id_set_.end(), kEmptyKey, 0,
-              IdHasher(x.id_set_.hash_funct().hasher(), this),
+      id_set_(x.id_set_.begin(), x.id_set_.end(), 0,
+              IdHasher(x.id_set_.hash_function().hasher(), this),
               IdKeyEqual(x.id_set_.key_eq().key_equal(), this)) {
 }
 
@@ -234,8 +235,8 @@ SequenceLexicon<T, Hasher, KeyEqual>::operator=(const SequenceLexicon& x) {
   begins_ = x.begins_;
   // Unfortunately we can't copy-assign "id_set_" because we need to change
   // the "this" pointers associated with hasher() and key_equal().
-  id_set_ = IdSet(x.id_set_.begin(), x.id_set_.end(), kEmptyKey, 0,
-                  IdHasher(x.id_set_.hash_funct().hasher(), this),
+  id_set_ = IdSet(x.id_set_.begin(), x.id_set_.end(), 0,
+                  IdHasher(x.id_set_.hash_function().hasher(), this),
                   IdKeyEqual(x.id_set_.key_eq().key_equal(), this));
   return *this;
 }
@@ -248,8 +249,8 @@ SequenceLexicon<T, Hasher, KeyEqual>::operator=(SequenceLexicon&& x) {
   begins_ = std::move(x.begins_);
   // Unfortunately we can't move-assign "id_set_" because we need to change
   // the "this" pointers associated with hasher() and key_equal().
-  id_set_ = IdSet(x.id_set_.begin(), x.id_set_.end(), kEmptyKey, 0,
-                  IdHasher(x.id_set_.hash_funct().hasher(), this),
+  id_set_ = IdSet(x.id_set_.begin(), x.id_set_.end(), 0,
+                  IdHasher(x.id_set_.hash_function().hasher(), this),
                   IdKeyEqual(x.id_set_.key_eq().key_equal(), this));
   return *this;
 }
@@ -287,6 +288,20 @@ uint32_t SequenceLexicon<T, Hasher, KeyEqual>::Add(const Container& container) {
   return Add(std::begin(container), std::end(container));
 }
 
+template <class T, class Hasher, class KeyEqual>
+std::vector<uint32_t> SequenceLexicon<T, Hasher, KeyEqual>::Merge(
+    const SequenceLexicon& other) {
+  ABSL_DCHECK_NE(&other, this);
+  std::vector<uint32_t> ids;
+  ids.reserve(other.size());
+  values_.reserve(values_.size() + other.values_.size());
+  begins_.reserve(begins_.size() + other.size());
+  for (uint32_t id = 0; id < other.size(); ++id) {
+    ids.push_back(Add(other.sequence(id)));
+  }
+  return ids;
+}
+
 template <class T, class Hasher, class KeyEqual>
 inline uint32_t SequenceLexicon<T, Hasher, KeyEqual>::size() const {
   return begins_.size() - 1;
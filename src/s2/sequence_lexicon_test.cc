@@ -115,3 +115,17 @@ TEST(SequenceLexicon, MoveAssignmentOperator) {
   ExpectSequence(Seq{7, 8}, lex.sequence(1));
 }
 
+
+TEST(SequenceLexicon, Merge) {
+  SequenceLexicon<int64_t> lex1, lex2;
+  EXPECT_EQ(0, lex1.Add(Seq{1, 2}));
+  EXPECT_EQ(1, lex1.Add(Seq{3}));
+  EXPECT_EQ(0, lex2.Add(Seq{3}));
+  EXPECT_EQ(1, lex2.Add(Seq{}));
+  EXPECT_EQ(2, lex2.Add(Seq{1, 2}));
+  EXPECT_EQ((vector<uint32_t>{1, 2, 0}), lex1.Merge(lex2));
+  EXPECT_EQ(3, lex1.size());
+  ExpectSequence(Seq{1, 2}, lex1.sequence(0));
+  ExpectSequence(Seq{3}, lex1.sequence(1));
+  ExpectSequence(Seq{}, lex1.sequence(2));
+}
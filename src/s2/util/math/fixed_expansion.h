@@ -0,0 +1,179 @@
+// Copyright 2024 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS-IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+// FixedExpansion<N> represents a real number exactly as the sum of up to N
+// non-overlapping doubles (a "floating-point expansion"), stored inline.
+// Unlike ExactFloat it never allocates memory, which makes it much faster
+// for evaluating low-degree polynomials of doubles exactly (e.g., the sign
+// of a 3x3 determinant).  Only addition, subtraction, and multiplication by
+// a double are supported.
+//
+// The results are exact provided that no intermediate product underflows or
+// overflows.  It is the caller's responsibility to check this, e.g. by
+// bounding the exponents of the inputs.  The capacity N must be large enough
+// for the result of every operation: the sum of two expansions with m and n
+// components has at most (m + n) components, and the product with a double
+// of an expansion with m components has at most (2 * m) components.
+//
+// The algorithms are from "Adaptive Precision Floating-Point Arithmetic and
+// Fast Robust Geometric Predicates" (Shewchuk, Discrete & Computational
+// Geometry, 1997).  They require IEEE 754 arithmetic with round-to-nearest
+// and without contraction of multiply-add operations, so files that use this
+// class must turn off contraction (e.g. by including s2/_fp_contract_off.h
+// first, as the S2 headers do).
+
+#ifndef S2_UTIL_MATH_FIXED_EXPANSION_H_
+#define S2_UTIL_MATH_FIXED_EXPANSION_H_
+
+#include <array>
+
+#include "absl/log/absl_check.h"
+
+template <int N>
+class FixedExpansion {
+ public:
+  // Constructs an expansion equal to zero.
+  FixedExpansion() = default;
+
+  // Constructs an expansion equal to "x".
+  explicit FixedExpansion(double x) {
+    if (x != 0) Append(x);
+  }
+
+  // Returns the exact product of two doubles.
+  static FixedExpansion Product(double a, double b) {
+    double x, y;
+    TwoProduct(a, b, &x, &y);
+    FixedExpansion result;
+    if (y != 0) result.Append(y);
+    if (x != 0) result.Append(x);
+    return result;
+  }
+
+  // Returns the number of non-zero components.
+  int size() const { return size_; }
+
+  // Returns -1, 0, or +1 according to the sign of the represented value.
+  int sgn() const {
+    // Components are stored in order of increasing magnitude.
+    if (size_ == 0) return 0;
+    return c_[size_ - 1] > 0 ? 1 : -1;
+  }
+
+  FixedExpansion operator-() const {
+    FixedExpansion result = *this;
+    for (int i = 0; i < size_; ++i) result.c_[i] = -result.c_[i];
+    return result;
+  }
+
+  friend FixedExpansion operator+(const FixedExpansion& a,
+                                  const FixedExpansion& b) {
+    ABSL_DCHECK_LE(a.size_ + b.size_, N);
+    FixedExpansion result = a;
+    for (int i = 0; i < b.size_; ++i) result.Grow(b.c_[i]);
+    return result;
+  }
+
+  friend FixedExpansion operator-(const FixedExpansion& a,
+                                  const FixedExpansion& b) {
+    return a + (-b);
+  }
+
+  friend FixedExpansion operator*(const FixedExpansion& a, double b) {
+    ABSL_DCHECK_LE(2 * a.size_, N);
+    FixedExpansion result;
+    if (a.size_ == 0 || b == 0) return result;
+    double q, h;
+    TwoProduct(a.c_[0], b, &q, &h);
+    result.AppendNonZero(h);
+    for (int i = 1; i < a.size_; ++i) {
+      double p1, p0, sum;
+      TwoProduct(a.c_[i], b, &p1, &p0);
+      TwoSum(q, p0, &sum, &h);
+      result.AppendNonZero(h);
+      FastTwoSum(p1, sum, &q, &h);
+      result.AppendNonZero(h);
+    }
+    result.AppendNonZero(q);
+    return result;
+  }
+
+ private:
+  void Append(double x) {
+    ABSL_DCHECK_LT(size_, N);
+    c_[size_++] = x;
+  }
+
+  void AppendNonZero(double x) {
+    if (x != 0) Append(x);
+  }
+
+  // Adds "b" to this expansion, eliminating zero components.
+  void Grow(double b) {
+    double q = b;
+    int size = 0;
+    for (int i = 0; i < size_; ++i) {
+      double h;
+      TwoSum(q, c_[i], &q, &h);
+      if (h != 0) c_[size++] = h;
+    }
+    size_ = size;
+    AppendNonZero(q);
+  }
+
+  // Sets x + y = a + b exactly, where x = fl(a + b).
+  static void TwoSum(double a, double b, double* x, double* y) {
+    double sum = a + b;
+    double b_virtual = sum - a;
+    double a_virtual = sum - b_virtual;
+    *y = (a - a_virtual) + (b - b_virtual);
+    *x = sum;
+  }
+
+  // Like TwoSum, but requires |a| >= |b|.
+  static void FastTwoSum(double a, double b, double* x, double* y) {
+    double sum = a + b;
+    *y = b - (sum - a);
+    *x = sum;
+  }
+
+  // Splits "a" into two halves with at most 26 significant bits each.
+  static void Split(double a, double* hi, double* lo) {
+    constexpr double kSplitter = 134217729.0;  // 2**27 + 1
+    double c = kSplitter * a;
+    double a_big = c - a;
+    *hi = c - a_big;
+    *lo = a - *hi;
+  }
+
+  // Sets x + y = a * b exactly, where x = fl(a * b).
+  static void TwoProduct(double a, double b, double* x, double* y) {
+    double product = a * b;
+    double a_hi, a_lo, b_hi, b_lo;
+    Split(a, &a_hi, &a_lo);
+    Split(b, &b_hi, &b_lo);
+    double err1 = product - a_hi * b_hi;
+    double err2 = err1 - a_lo * b_hi;
+    double err3 = err2 - a_hi * b_lo;
+    *y = a_lo * b_lo - err3;
+    *x = product;
+  }
+
+  // The non-zero components in order of increasing magnitude.
+  std::array<double, N> c_;
+  int size_ = 0;
+};
+
+#endif  // S2_UTIL_MATH_FIXED_EXPANSION_H_
@@ -21,11 +21,11 @@
 #include <cstddef>
 #include <cstdint>
 #include <functional>
-#include <limits>
 #include <utility>
 #include <vector>
 
-#include "s2/util/gtl/dense_hash_set.h"
+#include "absl/container/flat_hash_set.h"
+#include "absl/hash/hash.h"
 
 // ValueLexicon is a class that maps distinct values to sequentially numbered
 // integer identifiers.  It automatically eliminates duplicates and uses a
@@ -75,10 +75,6 @@ class ValueLexicon {
   const T& value(uint32_t id) const;
 
  private:
-  friend class IdKeyEqual;
-  // Choose kEmptyKey to be the last key that will ever be generated.
-  static const uint32_t kEmptyKey = std::numeric_limits<uint32_t>::max();
-
   class IdHasher {
    public:
     IdHasher(const Hasher& hasher, const ValueLexicon* lexicon);
@@ -100,7 +96,7 @@ class ValueLexicon {
     const ValueLexicon* lexicon_;
   };
 
-  using IdSet = gtl::dense_hash_set<uint32_t, IdHasher, IdKeyEqual>;
+  using IdSet = absl::flat_hash_set<uint32_t, IdHasher, IdKeyEqual>;
 
   KeyEqual key_equal_;
   std::vector<T> values_;
@@ -110,9 +106,6 @@ class ValueLexicon {
 
 //////////////////   Implementation details follow   ////////////////////
 
-template <class T, class Hasher, class KeyEqual>
-const uint32_t ValueLexicon<T, Hasher, KeyEqual>::kEmptyKey;
-
 template <class T, class Hasher, class KeyEqual>
 ValueLexicon<T, Hasher, KeyEqual>::IdHasher::IdHasher(
     const Hasher& hasher, const ValueLexicon* lexicon)
@@ -127,7 +120,9 @@ const Hasher& ValueLexicon<T, Hasher, KeyEqual>::IdHasher::hasher() const {
 template <class T, class Hasher, class KeyEqual>
 inline size_t ValueLexicon<T, Hasher, KeyEqual>::IdHasher::operator()(
     uint32_t id) const {
-  return hasher_(lexicon_->value(id));
+  // The hash is remixed because flat_hash_set uses the low bits of the hash
+  // as a tag, and hashers such as std::hash<int64_t> are often the identity.
+  return absl::HashOf(hasher_(lexicon_->value(id)));
 }
 
 template <class T, class Hasher, class KeyEqual>
@@ -140,9 +135,6 @@ template <class T, class Hasher, class KeyEqual>
 inline bool ValueLexicon<T, Hasher, KeyEqual>::IdKeyEqual::operator()(
     uint32_t id1, uint32_t id2) const {
   if (id1 == id2) return true;
-  if (id1 == lexicon_->kEmptyKey || id2 == lexicon_->kEmptyKey) {
-    return false;
-  }
   return key_equal_(lexicon_->value(id1), lexicon_->value(id2));
 }
 
@@ -152,7 +144,6 @@ ValueLexicon<T, Hasher, KeyEqual>::ValueLexicon(const Hasher& hasher,
     : key_equal_(key_equal),
       id_set_(0, IdHasher(hasher, this),
                  IdKeyEqual(key_equal, this)) {
-  id_set_.set_empty_key(kEmptyKey);
 }
 
 template <class T, class Hasher, class KeyEqual>
@@ -160,8 +151,8 @@ ValueLexicon<T, Hasher, KeyEqual>::ValueLexicon(const ValueLexicon& x)
     : key_equal_(x.key_equal_), values_(x.values_),
       // Unfortunately we can't copy "id_set_" because we need to change the
       // "this" pointers associated with hasher() and key_equal().
-      id_set_(x.id_set_.begin(), x.id_set_.end(), kEmptyKey, 0,
-              IdHasher(x.id_set_.hash_funct().hasher(), this),
+      id_set_(x.id_set_.begin(), x.id_set_.end(), 0,
+              IdHasher(x.id_set_.hash_function().hasher(), this),
               IdKeyEqual(x.key_equal_, this)) {
 }
 
@@ -170,8 +161,8 @@ ValueLexicon<T, Hasher, KeyEqual>::ValueLexicon(ValueLexicon&& x)
     : key_equal_(std::move(x.key_equal_)), values_(std::move(x.values_)),
       // Unfortunately we can't move "id_set_" because we need to change the
       // "this" pointers associated with hasher() and key_equal().
-      id_set_(x.id_set_.begin(), x.id_set_.end(), kEmptyKey, 0,
-              IdHasher(x.id_set_.hash_funct().hasher(), this),
+      id_set_(x.id_set_.begin(), x.id_set_.end(), 0,
+              IdHasher(x.id_set_.hash_function().hasher(), this),
               IdKeyEqual(x.key_equal_, this)) {
 }
 
@@ -183,8 +174,8 @@ ValueLexicon<T, Hasher, KeyEqual>::operator=(const ValueLexicon& x) {
   values_ = x.values_;
   // Unfortunately we can't copy-assign "id_set_" because we need to change
   // the "this" pointers associated with hasher() and key_equal().
-  id_set_ = IdSet(x.id_set_.begin(), x.id_set_.end(), kEmptyKey, 0,
-                  IdHasher(x.id_set_.hash_funct().hasher(), this),
+  id_set_ = IdSet(x.id_set_.begin(), x.id_set_.end(), 0,
+                  IdHasher(x.id_set_.hash_function().hasher(), this),
                   IdKeyEqual(x.key_equal_, this));
   return *this;
 }
@@ -197,8 +188,8 @@ ValueLexicon<T, Hasher, KeyEqual>::operator=(ValueLexicon&& x) {
   values_ = std::move(x.values_);
   // Unfortunately we can't move-assign "id_set_" because we need to change
   // the "this" pointers associated with hasher() and key_equal().
-  id_set_ = IdSet(x.id_set_.begin(), x.id_set_.end(), kEmptyKey, 0,
-                  IdHasher(x.id_set_.hash_funct().hasher(), this),
+  id_set_ = IdSet(x.id_set_.begin(), x.id_set_.end(), 0,
+                  IdHasher(x.id_set_.hash_function().hasher(), this),
                   IdKeyEqual(x.key_equal_, this));
   return *this;
 }